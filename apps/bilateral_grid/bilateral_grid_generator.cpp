@@ -6,6 +6,9 @@ namespace {
 class BilateralGrid : public Halide::Generator<BilateralGrid> {
 public:
     GeneratorParam<int>   s_sigma{"s_sigma", 8};
+    // Splat each pixel into the grid with its own GPU thread, using
+    // atomic adds into shared memory. Only used on CUDA targets.
+    GeneratorParam<bool>  atomic_splat{"atomic_splat", false};
 
     Input<Buffer<float>>  input{"input", 2};
     Input<float>          r_sigma{"r_sigma"};
@@ -93,7 +96,19 @@ public:
             // 2) Compute those histogram by iterating over lots of the input image
             // 3) Blur the set of histograms in z
             histogram.reorder(c, z, x, y).compute_at(blurz, x).gpu_threads(x, y);
-            histogram.update().reorder(c, r.x, r.y, x, y).gpu_threads(x, y).unroll(c);
+            if (atomic_splat && get_target().has_feature(Target::CUDA)) {
+                // Each thread of the 8x8 tile above iterates over all
+                // s_sigma^2 pixels of its grid cell, serially. Instead,
+                // give every pixel in a row of cells a thread of its
+                // own, which adds its value into the tile's histogram
+                // in shared memory atomically. Each block owns its tile
+                // of the grid, so blurz writes the tile out to global
+                // memory without further atomics.
+                histogram.update().atomic().reorder(c, r.x, r.y, x, y)
+                    .gpu_threads(r.x, r.y, x).unroll(c);
+            } else {
+                histogram.update().reorder(c, r.x, r.y, x, y).gpu_threads(x, y).unroll(c);
+            }
 
             // Schedule the remaining blurs and the sampling at the end similarly.
             blurx.compute_root().reorder(c, x, y, z)
@@ -6,6 +6,9 @@
 #ifndef NO_AUTO_SCHEDULE
 #include "bilateral_grid_auto_schedule.h"
 #endif
+#ifndef NO_ATOMIC_SPLAT
+#include "bilateral_grid_atomic_splat.h"
+#endif
 
 #include "halide_benchmark.h"
 #include "HalideBuffer.h"
@@ -46,6 +49,14 @@ int main(int argc, char **argv) {
     printf("Auto-scheduled time: %gms\n", min_t_auto * 1e3);
     #endif
 
+    #ifndef NO_ATOMIC_SPLAT
+    // Manually-tuned version, splatting with atomics on CUDA
+    double min_t_atomic = benchmark(timing_iterations, 10, [&]() {
+        bilateral_grid_atomic_splat(input, r_sigma, output);
+    });
+    printf("Atomic splat time: %gms\n", min_t_atomic * 1e3);
+    #endif
+
     convert_and_save_image(output, argv[2]);
 
     return 0;
@@ -24,13 +24,13 @@ Expr blur121(Expr a, Expr b, Expr c) {
 
 Func interleave_x(Func a, Func b) {
     Func out;
-    out(x, y) = select((x%2)==0, a(x/2, y), b(x/2, y));
+    out(x, y, _) = select((x%2)==0, a(x/2, y, _), b(x/2, y, _));
     return out;
 }
 
 Func interleave_y(Func a, Func b) {
     Func out;
-    out(x, y) = select((y%2)==0, a(x, y/2), b(x, y/2));
+    out(x, y, _) = select((y%2)==0, a(x, y/2, _), b(x, y/2, _));
     return out;
 }
 
@@ -40,9 +40,10 @@ public:
     GeneratorParam<LoopLevel> intermed_store_at{"intermed_store_at", LoopLevel::inlined()};
     GeneratorParam<LoopLevel> output_compute_at{"output_compute_at", LoopLevel::inlined()};
 
-    // Inputs and outputs
-    Input<Func> deinterleaved{ "deinterleaved", Int(16), 3 };
-    Output<Func> output{ "output", Int(16), 3 };
+    // Inputs and outputs. The input is x, y and channel, followed by
+    // any batch dimensions, which the output keeps after x, y and c.
+    Input<Func> deinterleaved{ "deinterleaved", Int(16) };
+    Output<Func> output{ "output", Int(16), -1 };
 
     // Defines outputs using inputs
     void generate() {
@@ -54,10 +55,10 @@ public:
         // Give more convenient names to the four channels we know
         Func r_r, g_gr, g_gb, b_b;
 
-        g_gr(x, y) = deinterleaved(x, y, 0);
-        r_r(x, y)  = deinterleaved(x, y, 1);
-        b_b(x, y)  = deinterleaved(x, y, 2);
-        g_gb(x, y) = deinterleaved(x, y, 3);
+        g_gr(x, y, _) = deinterleaved(x, y, 0, _);
+        r_r(x, y, _)  = deinterleaved(x, y, 1, _);
+        b_b(x, y, _)  = deinterleaved(x, y, 2, _);
+        g_gb(x, y, _) = deinterleaved(x, y, 3, _);
 
         // These are the ones we need to interpolate
         Func b_r, g_r, b_gr, r_gr, b_gb, r_gb, r_b, g_b;
@@ -67,37 +68,37 @@ public:
         // Try interpolating vertically and horizontally. Also compute
         // differences vertically and horizontally. Use interpolation in
         // whichever direction had the smallest difference.
-        Expr gv_r  = avg(g_gb(x, y-1), g_gb(x, y));
-        Expr gvd_r = absd(g_gb(x, y-1), g_gb(x, y));
-        Expr gh_r  = avg(g_gr(x+1, y), g_gr(x, y));
-        Expr ghd_r = absd(g_gr(x+1, y), g_gr(x, y));
+        Expr gv_r  = avg(g_gb(x, y-1, _), g_gb(x, y, _));
+        Expr gvd_r = absd(g_gb(x, y-1, _), g_gb(x, y, _));
+        Expr gh_r  = avg(g_gr(x+1, y, _), g_gr(x, y, _));
+        Expr ghd_r = absd(g_gr(x+1, y, _), g_gr(x, y, _));
 
-        g_r(x, y)  = select(ghd_r < gvd_r, gh_r, gv_r);
+        g_r(x, y, _)  = select(ghd_r < gvd_r, gh_r, gv_r);
 
-        Expr gv_b  = avg(g_gr(x, y+1), g_gr(x, y));
-        Expr gvd_b = absd(g_gr(x, y+1), g_gr(x, y));
-        Expr gh_b  = avg(g_gb(x-1, y), g_gb(x, y));
-        Expr ghd_b = absd(g_gb(x-1, y), g_gb(x, y));
+        Expr gv_b  = avg(g_gr(x, y+1, _), g_gr(x, y, _));
+        Expr gvd_b = absd(g_gr(x, y+1, _), g_gr(x, y, _));
+        Expr gh_b  = avg(g_gb(x-1, y, _), g_gb(x, y, _));
+        Expr ghd_b = absd(g_gb(x-1, y, _), g_gb(x, y, _));
 
-        g_b(x, y)  = select(ghd_b < gvd_b, gh_b, gv_b);
+        g_b(x, y, _)  = select(ghd_b < gvd_b, gh_b, gv_b);
 
         // Next interpolate red at gr by first interpolating, then
         // correcting using the error green would have had if we had
         // interpolated it in the same way (i.e. add the second derivative
         // of the green channel at the same place).
         Expr correction;
-        correction = g_gr(x, y) - avg(g_r(x, y), g_r(x-1, y));
-        r_gr(x, y) = correction + avg(r_r(x-1, y), r_r(x, y));
+        correction = g_gr(x, y, _) - avg(g_r(x, y, _), g_r(x-1, y, _));
+        r_gr(x, y, _) = correction + avg(r_r(x-1, y, _), r_r(x, y, _));
 
         // Do the same for other reds and blues at green sites
-        correction = g_gr(x, y) - avg(g_b(x, y), g_b(x, y-1));
-        b_gr(x, y) = correction + avg(b_b(x, y), b_b(x, y-1));
+        correction = g_gr(x, y, _) - avg(g_b(x, y, _), g_b(x, y-1, _));
+        b_gr(x, y, _) = correction + avg(b_b(x, y, _), b_b(x, y-1, _));
 
-        correction = g_gb(x, y) - avg(g_r(x, y), g_r(x, y+1));
-        r_gb(x, y) = correction + avg(r_r(x, y), r_r(x, y+1));
+        correction = g_gb(x, y, _) - avg(g_r(x, y, _), g_r(x, y+1, _));
+        r_gb(x, y, _) = correction + avg(r_r(x, y, _), r_r(x, y+1, _));
 
-        correction = g_gb(x, y) - avg(g_b(x, y), g_b(x+1, y));
-        b_gb(x, y) = correction + avg(b_b(x, y), b_b(x+1, y));
+        correction = g_gb(x, y, _) - avg(g_b(x, y, _), g_b(x+1, y, _));
+        b_gb(x, y, _) = correction + avg(b_b(x, y, _), b_b(x+1, y, _));
 
         // Now interpolate diagonally to get red at blue and blue at
         // red. Hold onto your hats; this gets really fancy. We do the
@@ -108,26 +109,26 @@ public:
         // sites - we correct our interpolations using the second
         // derivative of green at the same sites.
 
-        correction = g_b(x, y)  - avg(g_r(x, y), g_r(x-1, y+1));
-        Expr rp_b  = correction + avg(r_r(x, y), r_r(x-1, y+1));
-        Expr rpd_b = absd(r_r(x, y), r_r(x-1, y+1));
+        correction = g_b(x, y, _)  - avg(g_r(x, y, _), g_r(x-1, y+1, _));
+        Expr rp_b  = correction + avg(r_r(x, y, _), r_r(x-1, y+1, _));
+        Expr rpd_b = absd(r_r(x, y, _), r_r(x-1, y+1, _));
 
-        correction = g_b(x, y)  - avg(g_r(x-1, y), g_r(x, y+1));
-        Expr rn_b  = correction + avg(r_r(x-1, y), r_r(x, y+1));
-        Expr rnd_b = absd(r_r(x-1, y), r_r(x, y+1));
+        correction = g_b(x, y, _)  - avg(g_r(x-1, y, _), g_r(x, y+1, _));
+        Expr rn_b  = correction + avg(r_r(x-1, y, _), r_r(x, y+1, _));
+        Expr rnd_b = absd(r_r(x-1, y, _), r_r(x, y+1, _));
 
-        r_b(x, y)  = select(rpd_b < rnd_b, rp_b, rn_b);
+        r_b(x, y, _)  = select(rpd_b < rnd_b, rp_b, rn_b);
 
         // Same thing for blue at red
-        correction = g_r(x, y)  - avg(g_b(x, y), g_b(x+1, y-1));
-        Expr bp_r  = correction + avg(b_b(x, y), b_b(x+1, y-1));
-        Expr bpd_r = absd(b_b(x, y), b_b(x+1, y-1));
+        correction = g_r(x, y, _)  - avg(g_b(x, y, _), g_b(x+1, y-1, _));
+        Expr bp_r  = correction + avg(b_b(x, y, _), b_b(x+1, y-1, _));
+        Expr bpd_r = absd(b_b(x, y, _), b_b(x+1, y-1, _));
 
-        correction = g_r(x, y)  - avg(g_b(x+1, y), g_b(x, y-1));
-        Expr bn_r  = correction + avg(b_b(x+1, y), b_b(x, y-1));
-        Expr bnd_r = absd(b_b(x+1, y), b_b(x, y-1));
+        correction = g_r(x, y, _)  - avg(g_b(x+1, y, _), g_b(x, y-1, _));
+        Expr bn_r  = correction + avg(b_b(x+1, y, _), b_b(x, y-1, _));
+        Expr bnd_r = absd(b_b(x+1, y, _), b_b(x, y-1, _));
 
-        b_r(x, y)  =  select(bpd_r < bnd_r, bp_r, bn_r);
+        b_r(x, y, _)  =  select(bpd_r < bnd_r, bp_r, bn_r);
 
         // Resulting color channels
         Func r, g, b;
@@ -140,9 +141,9 @@ public:
         b = interleave_y(interleave_x(b_gr, b_r),
                          interleave_x(b_b, b_gb));
 
-        output(x, y, c) = select(c == 0, r(x, y),
-                                 c == 1, g(x, y),
-                                         b(x, y));
+        output(x, y, c, _) = select(c == 0, r(x, y, _),
+                                    c == 1, g(x, y, _),
+                                            b(x, y, _));
 
         // These are the stencil stages we want to schedule
         // separately. Everything else we'll just inline.
@@ -201,13 +202,23 @@ private:
     vector<Func> intermediates;
 };
 
-class CameraPipe : public Halide::Generator<CameraPipe> {
+// The pipeline for one raw frame (batch_dims = 0), or for a batch of
+// frames with the frame index as the last dimension of the input and
+// output (batch_dims = 1).
+template<int batch_dims>
+class CameraPipe : public Halide::Generator<CameraPipe<batch_dims>> {
+    using Base = Halide::Generator<CameraPipe<batch_dims>>;
+    using Base::auto_schedule;
+    using Base::get_target;
+    template<typename T> using Input = Halide::GeneratorInput<T>;
+    template<typename T> using Output = Halide::GeneratorOutput<T>;
+
 public:
     // Parameterized output type, because LLVM PTX (GPU) backend does not
     // currently allow 8-bit computations
     GeneratorParam<Type> result_type{"result_type", UInt(8)};
 
-    Input<Buffer<uint16_t>> input{"input", 2};
+    Input<Buffer<uint16_t>> input{"input", 2 + batch_dims};
     Input<Buffer<float>> matrix_3200{"matrix_3200", 2};
     Input<Buffer<float>> matrix_7000{"matrix_7000", 2};
     Input<float> color_temp{"color_temp"};
@@ -217,7 +228,7 @@ public:
     Input<int> blackLevel{"blackLevel"};
     Input<int> whiteLevel{"whiteLevel"};
 
-    Output<Buffer<uint8_t>> processed{"processed", 3};
+    Output<Buffer<uint8_t>> processed{"processed", 3 + batch_dims};
 
     void generate();
 
@@ -230,31 +241,37 @@ private:
     Func sharpen(Func input);
 };
 
-Func CameraPipe::hot_pixel_suppression(Func input) {
+// The stages below carry any batch dimensions of their inputs along
+// as implicit variables.
+
+template<int batch_dims>
+Func CameraPipe<batch_dims>::hot_pixel_suppression(Func input) {
 
-    Expr a = max(input(x - 2, y), input(x + 2, y),
-                 input(x, y - 2), input(x, y + 2));
+    Expr a = max(input(x - 2, y, _), input(x + 2, y, _),
+                 input(x, y - 2, _), input(x, y + 2, _));
 
     Func denoised;
-    denoised(x, y) = clamp(input(x, y), 0, a);
+    denoised(x, y, _) = clamp(input(x, y, _), 0, a);
 
     return denoised;
 }
 
-Func CameraPipe::deinterleave(Func raw) {
+template<int batch_dims>
+Func CameraPipe<batch_dims>::deinterleave(Func raw) {
     // Deinterleave the color channels
     Func deinterleaved("deinterleaved");
 
-    deinterleaved(x, y, c) = select(c == 0, raw(2*x, 2*y),
-                                    c == 1, raw(2*x+1, 2*y),
-                                    c == 2, raw(2*x, 2*y+1),
-                                            raw(2*x+1, 2*y+1));
+    deinterleaved(x, y, c, _) = select(c == 0, raw(2*x, 2*y, _),
+                                       c == 1, raw(2*x+1, 2*y, _),
+                                       c == 2, raw(2*x, 2*y+1, _),
+                                               raw(2*x+1, 2*y+1, _));
     return deinterleaved;
 }
 
 
 
-Func CameraPipe::color_correct(Func input) {
+template<int batch_dims>
+Func CameraPipe<batch_dims>::color_correct(Func input) {
     // Get a color matrix by linearly interpolating between two
     // calibrated matrices using inverse kelvin.
     Expr kelvin = color_temp;
@@ -269,9 +286,9 @@ Func CameraPipe::color_correct(Func input) {
     }
 
     Func corrected;
-    Expr ir = cast<int32_t>(input(x, y, 0));
-    Expr ig = cast<int32_t>(input(x, y, 1));
-    Expr ib = cast<int32_t>(input(x, y, 2));
+    Expr ir = cast<int32_t>(input(x, y, 0, _));
+    Expr ig = cast<int32_t>(input(x, y, 1, _));
+    Expr ib = cast<int32_t>(input(x, y, 2, _));
 
     Expr r = matrix(3, 0) + matrix(0, 0) * ir + matrix(1, 0) * ig + matrix(2, 0) * ib;
     Expr g = matrix(3, 1) + matrix(0, 1) * ir + matrix(1, 1) * ig + matrix(2, 1) * ib;
@@ -280,14 +297,15 @@ Func CameraPipe::color_correct(Func input) {
     r = cast<int16_t>(r/256);
     g = cast<int16_t>(g/256);
     b = cast<int16_t>(b/256);
-    corrected(x, y, c) = select(c == 0, r,
-                                c == 1, g,
-                                        b);
+    corrected(x, y, c, _) = select(c == 0, r,
+                                   c == 1, g,
+                                           b);
 
     return corrected;
 }
 
-Func CameraPipe::apply_curve(Func input) {
+template<int batch_dims>
+Func CameraPipe<batch_dims>::apply_curve(Func input) {
     // copied from FCam
     Func curve("curve");
 
@@ -341,21 +359,22 @@ Func CameraPipe::apply_curve(Func input) {
 
     if (lutResample == 1) {
         // Use clamp to restrict size of LUT as allocated by compute_root
-        curved(x, y, c) = curve(clamp(input(x, y, c), 0, 1023));
+        curved(x, y, c, _) = curve(clamp(input(x, y, c, _), 0, 1023));
     } else {
         // Use linear interpolation to sample the LUT.
-        Expr in = input(x, y, c);
+        Expr in = input(x, y, c, _);
         Expr u0 = in/lutResample;
         Expr u = in%lutResample;
         Expr y0 = curve(clamp(u0, 0, 127));
         Expr y1 = curve(clamp(u0 + 1, 0, 127));
-        curved(x, y, c) = cast<uint8_t>((cast<uint16_t>(y0)*lutResample + (y1 - y0)*u)/lutResample);
+        curved(x, y, c, _) = cast<uint8_t>((cast<uint16_t>(y0)*lutResample + (y1 - y0)*u)/lutResample);
     }
 
     return curved;
 }
 
-Func CameraPipe::sharpen(Func input) {
+template<int batch_dims>
+Func CameraPipe<batch_dims>::sharpen(Func input) {
     // Convert the sharpening strength to 2.5 fixed point. This allows sharpening in the range [0, 4].
     Func sharpen_strength_x32("sharpen_strength_x32");
     sharpen_strength_x32() = u8_sat(sharpen_strength * 32);
@@ -373,43 +392,52 @@ Func CameraPipe::sharpen(Func input) {
 
     // Make an unsharp mask by blurring in y, then in x.
     Func unsharp_y("unsharp_y");
-    unsharp_y(x, y, c) = blur121(input(x, y - 1, c), input(x, y, c), input(x, y + 1, c));
+    unsharp_y(x, y, c, _) = blur121(input(x, y - 1, c, _), input(x, y, c, _), input(x, y + 1, c, _));
 
     Func unsharp("unsharp");
-    unsharp(x, y, c) = blur121(unsharp_y(x - 1, y, c), unsharp_y(x, y, c), unsharp_y(x + 1, y, c));
+    unsharp(x, y, c, _) = blur121(unsharp_y(x - 1, y, c, _), unsharp_y(x, y, c, _), unsharp_y(x + 1, y, c, _));
 
     Func mask("mask");
-    mask(x, y, c) = cast<int16_t>(input(x, y, c)) - cast<int16_t>(unsharp(x, y, c));
+    mask(x, y, c, _) = cast<int16_t>(input(x, y, c, _)) - cast<int16_t>(unsharp(x, y, c, _));
 
     // Weight the mask with the sharpening strength, and add it to the
     // input to get the sharpened result.
     Func sharpened("sharpened");
-    sharpened(x, y, c) = u8_sat(input(x, y, c) + (mask(x, y, c) * sharpen_strength_x32()) / 32);
+    sharpened(x, y, c, _) = u8_sat(input(x, y, c, _) + (mask(x, y, c, _) * sharpen_strength_x32()) / 32);
 
     return sharpened;
 }
 
-void CameraPipe::generate() {
+template<int batch_dims>
+void CameraPipe<batch_dims>::generate() {
     // shift things inwards to give us enough padding on the
     // boundaries so that we don't need to check bounds. We're going
     // to make a 2560x1920 output image, just like the FCam pipe, so
     // shift by 16, 12. We also convert it to be signed, so we can deal
     // with values that fall below 0 during processing.
     Func shifted;
-    shifted(x, y) = cast<int16_t>(input(x+16, y+12));
+    shifted(x, y, _) = cast<int16_t>(input(x+16, y+12, _));
 
     Func denoised = hot_pixel_suppression(shifted);
 
     Func deinterleaved = deinterleave(denoised);
 
-    auto demosaiced = create<Demosaic>();
+    auto demosaiced = this->template create<Demosaic>();
     demosaiced->apply(deinterleaved);
 
-    Func corrected = color_correct(demosaiced->output);
+    // The demosaiced frame, which the batched pipeline computes a frame
+    // ahead of the rest.
+    Func front_end("front_end");
+    front_end(x, y, c, _) = demosaiced->output(x, y, c, _);
+
+    Func corrected = color_correct(front_end);
 
     Func curved = apply_curve(corrected);
 
-    processed(x, y, c) = sharpen(curved)(x, y, c);
+    processed(x, y, c, _) = sharpen(curved)(x, y, c, _);
+
+    // The frame index of the batched pipeline.
+    Var n = _0;
 
     // Schedule
     if (auto_schedule) {
@@ -426,6 +454,11 @@ void CameraPipe::generate() {
             .estimate(x, 0, 2592)
             .estimate(y, 0, 1968);
 
+        if (batch_dims) {
+            input.dim(2).set_bounds_estimate(0, 4);
+            processed.estimate(n, 0, 4);
+        }
+
     } else {
 
         Expr out_width = processed.width();
@@ -449,6 +482,8 @@ void CameraPipe::generate() {
         } else if (get_target().has_feature(Target::HVX_128)) {
             vec = 64;
         }
+        bool use_hexagon = get_target().features_any_of({Target::HVX_64, Target::HVX_128});
+
         processed.compute_root()
             .reorder(c, x, y)
             .split(y, yi, yii, 2, TailStrategy::RoundUp)
@@ -457,14 +492,42 @@ void CameraPipe::generate() {
             .unroll(c)
             .parallel(yo);
 
-        denoised.compute_at(processed, yi).store_at(processed, yo)
+        // Where the stages up to demosaicing are computed and stored:
+        // per strip of the output for a single frame.
+        LoopLevel front_compute_at(processed, yi), front_store_at(processed, yo);
+        LoopLevel demosaic_compute_at(curved, x);
+        if (batch_dims) {
+            // Frames are processed in order. The front end (denoising,
+            // deinterleaving and demosaicing) of each frame is computed
+            // in strips of its own, on another thread from the back end
+            // (color correction, tone curve and sharpening), so
+            // demosaicing frame k+1 overlaps color correcting frame k.
+            // The front end is not folded, so the batch size bounds the
+            // memory used.
+            front_end.compute_at(processed, n).store_root()
+                .reorder(c, x, y)
+                .split(y, yi, yii, 2, TailStrategy::RoundUp)
+                .split(yi, yo, yi, strip_size / 2)
+                .vectorize(x, 2*vec, TailStrategy::RoundUp)
+                .unroll(c)
+                .parallel(yo);
+            if (!use_hexagon) {
+                // Async producers run on the host.
+                front_end.async();
+            }
+            front_compute_at = LoopLevel(front_end, yi);
+            front_store_at = LoopLevel(front_end, yo);
+            demosaic_compute_at = LoopLevel(front_end, x);
+        }
+
+        denoised.compute_at(front_compute_at).store_at(front_store_at)
             .prefetch(input, y, 2)
             .fold_storage(y, 16)
             .tile(x, y, x, y, xi, yi, 2*vec, 2)
             .vectorize(xi)
             .unroll(yi);
 
-        deinterleaved.compute_at(processed, yi).store_at(processed, yo)
+        deinterleaved.compute_at(front_compute_at).store_at(front_store_at)
             .fold_storage(y, 8)
             .reorder(c, x, y)
             .vectorize(x, 2*vec, TailStrategy::RoundUp)
@@ -481,11 +544,11 @@ void CameraPipe::generate() {
             .vectorize(x)
             .unroll(c);
 
-        demosaiced->intermed_compute_at.set({processed, yi});
-        demosaiced->intermed_store_at.set({processed, yo});
-        demosaiced->output_compute_at.set({curved, x});
+        demosaiced->intermed_compute_at.set(front_compute_at);
+        demosaiced->intermed_store_at.set(front_store_at);
+        demosaiced->output_compute_at.set(demosaic_compute_at);
 
-        if (get_target().features_any_of({Target::HVX_64, Target::HVX_128})) {
+        if (use_hexagon) {
             processed.hexagon();
             denoised.align_storage(x, vec);
             deinterleaved.align_storage(x, vec);
@@ -542,4 +605,5 @@ void CameraPipe::generate() {
 
 }  // namespace
 
-HALIDE_REGISTER_GENERATOR(CameraPipe, camera_pipe)
+HALIDE_REGISTER_GENERATOR(CameraPipe<0>, camera_pipe)
+HALIDE_REGISTER_GENERATOR(CameraPipe<1>, camera_pipe_batch)
@@ -0,0 +1,92 @@
+#include "halide_benchmark.h"
+
+#include "camera_pipe.h"
+#include "camera_pipe_batch.h"
+
+#include "HalideBuffer.h"
+#include "halide_image_io.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace Halide::Runtime;
+using namespace Halide::Tools;
+
+// Measures the throughput of a stream of raw frames, processed either
+// one at a time by camera_pipe, or a batch at a time by
+// camera_pipe_batch, which demosaics each frame while the previous one
+// is being color corrected and sharpened.
+int main(int argc, char **argv) {
+    if (argc < 9) {
+        printf("Usage: ./process_batch raw.png color_temp gamma contrast sharpen batch_size timing_iterations output.png\n"
+               "e.g. ./process_batch raw.png 3200 2 50 5 8 5 output.png");
+        return 0;
+    }
+
+    fprintf(stderr, "input: %s\n", argv[1]);
+    Buffer<uint16_t> frame = load_and_convert_image(argv[1]);
+    fprintf(stderr, "       %d %d\n", frame.width(), frame.height());
+
+    int batch_size = atoi(argv[6]);
+    int timing_iterations = atoi(argv[7]);
+
+    // A stream of batch_size copies of the frame.
+    Buffer<uint16_t> input(frame.width(), frame.height(), batch_size);
+    for (int n = 0; n < batch_size; n++) {
+        input.sliced(2, n).copy_from(frame);
+    }
+    Buffer<uint8_t> output(((frame.width() - 32)/32)*32, ((frame.height() - 24)/32)*32, 3, batch_size);
+
+    // These color matrices are for the sensor in the Nokia N900 and are
+    // taken from the FCam source.
+    float _matrix_3200[][4] = {{ 1.6697f, -0.2693f, -0.4004f, -42.4346f},
+                                {-0.3576f,  1.0615f,  1.5949f, -37.1158f},
+                                {-0.2175f, -1.8751f,  6.9640f, -26.6970f}};
+
+    float _matrix_7000[][4] = {{ 2.2997f, -0.4478f,  0.1706f, -39.0923f},
+                                {-0.3826f,  1.5906f, -0.2080f, -25.4311f},
+                                {-0.0888f, -0.7344f,  2.2832f, -20.0826f}};
+    Buffer<float> matrix_3200(4, 3), matrix_7000(4, 3);
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 4; j++) {
+            matrix_3200(j, i) = _matrix_3200[i][j];
+            matrix_7000(j, i) = _matrix_7000[i][j];
+        }
+    }
+
+    float color_temp = (float) atof(argv[2]);
+    float gamma = (float) atof(argv[3]);
+    float contrast = (float) atof(argv[4]);
+    float sharpen = (float) atof(argv[5]);
+    int blackLevel = 25;
+    int whiteLevel = 1023;
+
+    double best;
+
+    best = benchmark(timing_iterations, 1, [&]() {
+        for (int n = 0; n < batch_size; n++) {
+            Buffer<uint8_t> out = output.sliced(3, n);
+            camera_pipe(input.sliced(2, n), matrix_3200, matrix_7000,
+                        color_temp, gamma, contrast, sharpen, blackLevel, whiteLevel,
+                        out);
+        }
+    });
+    fprintf(stderr, "Halide (one frame at a time):\t%gus per batch, %g frames/s\n",
+            best * 1e6, batch_size / best);
+
+    best = benchmark(timing_iterations, 1, [&]() {
+        camera_pipe_batch(input, matrix_3200, matrix_7000,
+                          color_temp, gamma, contrast, sharpen, blackLevel, whiteLevel,
+                          output);
+    });
+    fprintf(stderr, "Halide (streamed batch):\t%gus per batch, %g frames/s\n",
+            best * 1e6, batch_size / best);
+
+    fprintf(stderr, "output: %s\n", argv[8]);
+    Buffer<uint8_t> last = output.sliced(3, batch_size - 1);
+    convert_and_save_image(last, argv[8]);
+    fprintf(stderr, "        %d %d\n", output.width(), output.height());
+
+    return 0;
+}
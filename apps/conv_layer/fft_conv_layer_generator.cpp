@@ -0,0 +1,125 @@
+#include "Halide.h"
+
+#include "fft.h"
+
+namespace {
+
+using namespace Halide;
+
+// A convolution layer computed in the frequency domain with the FFTs
+// from apps/fft. The input is cut into overlapping fft_size x
+// fft_size tiles, each of which produces an (fft_size - filter_size +
+// 1)^2 tile of the output (overlap-save). The product with each
+// filter is summed over input channels in the frequency domain, so
+// the layer takes one inverse FFT per output tile and channel. This
+// pays off over the direct convolution in conv_layer_generator.cpp
+// for large filters. It has the same inputs and output, but the
+// filter must be filter_size x filter_size.
+class FFTConvolutionLayer : public Halide::Generator<FFTConvolutionLayer> {
+public:
+    GeneratorParam<int> fft_size{"fft_size", 16};
+    GeneratorParam<int> filter_size{"filter_size", 3};
+
+    Input<Buffer<float>>  input{"input", 4};
+    Input<Buffer<float>>  filter{"filter", 4};
+    Input<Buffer<float>>  bias{"bias", 1};
+
+    Output<Buffer<float>> f_ReLU{"ReLU", 4};
+
+    void generate() {
+        /* THE ALGORITHM */
+
+        const int N = fft_size;
+        const int K = filter_size;
+        _halide_user_assert(K > 0 && K < N) << "filter_size must be in [1, fft_size)\n";
+        // The size of the output tile computed from each input tile.
+        const int T = N - K + 1;
+
+        Var x("x"), y("y"), z("z"), n("n");
+        Var u("u"), v("v"), tx("tx"), ty("ty"), c("c");
+
+        // The last tiles can overhang the input.
+        Func clamped = BoundaryConditions::repeat_edge(input);
+
+        Func tiles("tiles");
+        tiles(u, v, tx, ty, c, n) = clamped(tx * T + u, ty * T + v, c, n);
+
+        Func filter_padded("filter_padded");
+        filter_padded(u, v, c, z) =
+            select(u < K && v < K,
+                   filter(clamp(u, 0, K - 1), clamp(v, 0, K - 1), c, z),
+                   0.0f);
+
+        Fft2dDesc fwd_desc;
+        Fft2dDesc inv_desc;
+        inv_desc.gain = 1.0f / (N * N);
+
+        fwd_desc.name = "dft_tiles";
+        ComplexFunc dft_tiles = fft2d_r2c(tiles, N, N, get_target(), fwd_desc);
+        fwd_desc.name = "dft_filter";
+        ComplexFunc dft_filter = fft2d_r2c(filter_padded, N, N, get_target(), fwd_desc);
+
+        // Correlation is multiplication by the conjugate of the
+        // filter's DFT. The circular wrap-around only affects the
+        // last K - 1 rows and columns of each tile, which are
+        // discarded below.
+        ComplexFunc dft_conv("dft_conv");
+        RDom r(filter.dim(2).min(), filter.dim(2).extent());
+        dft_conv(u, v, tx, ty, z, n) =
+            sum(dft_tiles(u, v, tx, ty, r, n) * conj(dft_filter(u, v, r, z)));
+
+        inv_desc.name = "conv_tiles";
+        Func conv_tiles = fft2d_c2r(dft_conv, N, N, get_target(), inv_desc);
+
+        Func f_conv("conv");
+        f_conv(x, y, z, n) = bias(z) + conv_tiles(x % T, y % T, x / T, y / T, z, n);
+
+        f_ReLU(x, y, z, n) = max(0, f_conv(x, y, z, n));
+
+        filter.dim(0).set_bounds(0, K);
+        filter.dim(1).set_bounds(0, K);
+
+        /* THE SCHEDULE */
+
+        if (auto_schedule) {
+            // Provide estimates on the input image
+            input.dim(0).set_bounds_estimate(0, 131);
+            input.dim(1).set_bounds_estimate(0, 131);
+            input.dim(2).set_bounds_estimate(0, 64);
+            input.dim(3).set_bounds_estimate(0, 4);
+
+            filter.dim(2).set_bounds_estimate(0, 64);
+            filter.dim(3).set_bounds_estimate(0, 64);
+
+            bias.dim(0).set_bounds_estimate(0, 64);
+
+            // Provide estimates on the pipeline f_ReLU
+            f_ReLU.estimate(x, 0, 128)
+                .estimate(y, 0, 128)
+                .estimate(z, 0, 64)
+                .estimate(n, 0, 4);
+        } else {
+            int vec_len = 8;
+
+            // The filters are transformed once per call.
+            dft_filter.compute_root();
+
+            // Each task transforms, multiplies and transforms back
+            // one row of tiles.
+            Var yi("yi");
+            f_ReLU.split(y, ty, yi, T)
+                .reorder(x, yi, z, ty, n)
+                .vectorize(x, vec_len)
+                .parallel(n)
+                .parallel(ty);
+            dft_tiles.compute_at(f_ReLU, ty);
+            dft_conv.compute_at(f_ReLU, ty)
+                .vectorize(u, vec_len);
+            conv_tiles.compute_at(f_ReLU, ty);
+        }
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(FFTConvolutionLayer, fft_conv_layer)
@@ -1,8 +1,12 @@
+#include <algorithm>
+#include <cmath>
 #include <cstdio>
 #include <chrono>
 
 #include "conv_layer.h"
 #include "conv_layer_auto_schedule.h"
+#include "winograd_conv_layer.h"
+#include "fft_conv_layer.h"
 
 #include "halide_benchmark.h"
 #include "HalideBuffer.h"
@@ -10,6 +14,43 @@
 using namespace Halide::Tools;
 using namespace Halide::Runtime;
 
+enum class ConvAlgorithm { Direct, Winograd, FFT };
+
+// Pick the convolution algorithm for a layer from its shape. Winograd
+// F(4x4, 3x3) does 4x fewer multiplies than the direct convolution
+// for 3x3 filters, but its transforms only pay off once the output is
+// several tiles across. The FFT's cost doesn't depend on the filter
+// size, so it wins for large filters.
+ConvAlgorithm choose_algorithm(int filter_width, int filter_height,
+                               int output_width, int output_height) {
+    if (filter_width == 3 && filter_height == 3 &&
+        output_width >= 16 && output_height >= 16) {
+        return ConvAlgorithm::Winograd;
+    } else if (filter_width >= 7 && filter_height >= 7) {
+        return ConvAlgorithm::FFT;
+    } else {
+        return ConvAlgorithm::Direct;
+    }
+}
+
+// Check that a fast convolution matches the direct one, relative to
+// the largest output.
+bool check(const char *name, Buffer<float> output, Buffer<float> reference) {
+    float max_ref = 0.0f;
+    reference.for_each_value([&](float r) { max_ref = std::max(max_ref, std::abs(r)); });
+    float tolerance = 1e-4f * std::max(1.0f, max_ref);
+    bool ok = true;
+    output.for_each_element([&](int x, int y, int z, int n) {
+        float error = std::abs(output(x, y, z, n) - reference(x, y, z, n));
+        if (ok && error > tolerance) {
+            printf("%s: output(%d, %d, %d, %d) = %f instead of %f\n",
+                   name, x, y, z, n, output(x, y, z, n), reference(x, y, z, n));
+            ok = false;
+        }
+    });
+    return ok;
+}
+
 int main(int argc, char **argv) {
     Buffer<float> input(67, 67, 32, 4);
     Buffer<float> filter(3, 3, 32, 32);
@@ -19,7 +60,7 @@ int main(int argc, char **argv) {
         for (int z = 0; z < input.channels(); z++) {
             for (int y = 0; y < input.height(); y++) {
                 for (int x = 0; x < input.width(); x++) {
-                    input(x, y) = rand();
+                    input(x, y, z, c) = (float)rand() / RAND_MAX;
                 }
             }
         }
@@ -29,20 +70,32 @@ int main(int argc, char **argv) {
         for (int z = 0; z < filter.channels(); z++) {
             for (int y = 0; y < filter.height(); y++) {
                 for (int x = 0; x < filter.width(); x++) {
-                    filter(x, y) = rand();
+                    filter(x, y, z, c) = (float)rand() / RAND_MAX;
                 }
             }
         }
     }
 
     for (int x = 0; x < bias.width(); x++) {
-        bias(x) = rand();
+        bias(x) = (float)rand() / RAND_MAX;
     }
 
     Buffer<float> output(64, 64, 32, 4);
 
     conv_layer(input, filter, bias, output);
 
+    Buffer<float> output_winograd(64, 64, 32, 4);
+    winograd_conv_layer(input, filter, bias, output_winograd);
+    if (!check("winograd_conv_layer", output_winograd, output)) {
+        return -1;
+    }
+
+    Buffer<float> output_fft(64, 64, 32, 4);
+    fft_conv_layer(input, filter, bias, output_fft);
+    if (!check("fft_conv_layer", output_fft, output)) {
+        return -1;
+    }
+
     // Timing code
 
     // Manually-tuned version
@@ -57,5 +110,22 @@ int main(int argc, char **argv) {
     });
     printf("Auto-scheduled time: %gms\n", min_t_auto * 1e3);
 
+    // Winograd F(4x4, 3x3) version
+    double min_t_winograd = benchmark(10, 10, [&]() {
+        winograd_conv_layer(input, filter, bias, output);
+    });
+    printf("Winograd time: %gms\n", min_t_winograd * 1e3);
+
+    // FFT version
+    double min_t_fft = benchmark(10, 10, [&]() {
+        fft_conv_layer(input, filter, bias, output);
+    });
+    printf("FFT time: %gms\n", min_t_fft * 1e3);
+
+    const char *names[] = {"direct", "Winograd", "FFT"};
+    ConvAlgorithm chosen = choose_algorithm(filter.width(), filter.height(),
+                                            output.width(), output.height());
+    printf("Algorithm chosen for this layer: %s\n", names[(int)chosen]);
+
     return 0;
 }
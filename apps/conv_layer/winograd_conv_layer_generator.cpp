@@ -0,0 +1,224 @@
+#include "Halide.h"
+
+namespace {
+
+using namespace Halide;
+
+// The transform matrices of the Winograd minimal filtering algorithms
+// F(m x m, 3 x 3), which compute an m x m tile of outputs of a 3 x 3
+// correlation from an (m + 2) x (m + 2) tile of inputs:
+//
+//   Y = A^T [(G g G^T) . (B^T d B)] A
+//
+// See Lavin and Gray, "Fast Algorithms for Convolutional Neural
+// Networks", 2015.
+const float F2_BT[4][4] = {
+    {1,  0, -1,  0},
+    {0,  1,  1,  0},
+    {0, -1,  1,  0},
+    {0,  1,  0, -1},
+};
+const float F2_G[4][3] = {
+    {1.0f,  0.0f, 0.0f},
+    {0.5f,  0.5f, 0.5f},
+    {0.5f, -0.5f, 0.5f},
+    {0.0f,  0.0f, 1.0f},
+};
+const float F2_AT[2][4] = {
+    {1, 1,  1,  0},
+    {0, 1, -1, -1},
+};
+
+const float F4_BT[6][6] = {
+    {4,  0, -5,  0, 1, 0},
+    {0, -4, -4,  1, 1, 0},
+    {0,  4, -4, -1, 1, 0},
+    {0, -2, -1,  2, 1, 0},
+    {0,  2, -1, -2, 1, 0},
+    {0,  4,  0, -5, 0, 1},
+};
+const float F4_G[6][3] = {
+    { 1.0f / 4,   0.0f,       0.0f},
+    {-1.0f / 6,  -1.0f / 6,  -1.0f / 6},
+    {-1.0f / 6,   1.0f / 6,  -1.0f / 6},
+    { 1.0f / 24,  1.0f / 12,  1.0f / 6},
+    { 1.0f / 24, -1.0f / 12,  1.0f / 6},
+    { 0.0f,       0.0f,       1.0f},
+};
+const float F4_AT[4][6] = {
+    {1, 1,  1, 1,  1, 0},
+    {0, 1, -1, 2, -2, 0},
+    {0, 1,  1, 4,  4, 0},
+    {0, 1, -1, 8, -8, 1},
+};
+
+// Multiply along one dimension by a constant matrix with 'rows' rows
+// and 'cols' columns: row i of the result is the sum over j of
+// matrix[i][j] * x(j). The row is selected by a pure Var, which should
+// be unrolled so that the selects and zero terms fold away.
+Expr transform(Var i, const float *matrix, int rows, int cols,
+               std::function<Expr(int)> x) {
+    std::vector<Expr> row_exprs;
+    for (int r = 0; r < rows; r++) {
+        Expr e = 0.0f;
+        for (int c = 0; c < cols; c++) {
+            float m = matrix[r * cols + c];
+            if (m == 1.0f) {
+                e += x(c);
+            } else if (m == -1.0f) {
+                e -= x(c);
+            } else if (m != 0.0f) {
+                e += m * x(c);
+            }
+        }
+        row_exprs.push_back(simplify(e));
+    }
+    Expr result = row_exprs.back();
+    for (int r = rows - 2; r >= 0; r--) {
+        result = select(i == r, row_exprs[r], result);
+    }
+    return result;
+}
+
+// A 3x3 convolution layer computed with Winograd's minimal filtering
+// algorithm, which takes 2.25x (tile_size = 2) or 4x (tile_size = 4)
+// fewer multiplies than the direct convolution in
+// conv_layer_generator.cpp. It has the same inputs and output, but
+// the filter must be 3x3. The larger tile does fewer multiplies, but
+// loses more precision in its transforms.
+class WinogradConvolutionLayer : public Halide::Generator<WinogradConvolutionLayer> {
+public:
+    GeneratorParam<int> tile_size{"tile_size", 4};
+
+    Input<Buffer<float>>  input{"input", 4};
+    Input<Buffer<float>>  filter{"filter", 4};
+    Input<Buffer<float>>  bias{"bias", 1};
+
+    Output<Buffer<float>> f_ReLU{"ReLU", 4};
+
+    void generate() {
+        /* THE ALGORITHM */
+
+        const int m = tile_size;
+        _halide_user_assert(m == 2 || m == 4) << "tile_size must be 2 or 4\n";
+        const int alpha = m + 2;
+        const float *BT = (m == 2) ? &F2_BT[0][0] : &F4_BT[0][0];
+        const float *G = (m == 2) ? &F2_G[0][0] : &F4_G[0][0];
+        const float *AT = (m == 2) ? &F2_AT[0][0] : &F4_AT[0][0];
+
+        Var x("x"), y("y"), z("z"), n("n");
+        Var xi("xi"), yi("yi"), tx("tx"), ty("ty"), c("c");
+
+        // Transform the filters, U = G g G^T.
+        Func filter_x("filter_x"), filter_t("filter_t");
+        filter_x(xi, y, c, z) =
+            transform(xi, G, alpha, 3, [&](int j) { return filter(j, y, c, z); });
+        filter_t(xi, yi, c, z) =
+            transform(yi, G, alpha, 3, [&](int j) { return filter_x(xi, j, c, z); });
+
+        // Transform the overlapping input tiles, V = B^T d B.
+        Func input_x("input_x"), input_t("input_t");
+        input_x(xi, y, tx, c, n) =
+            transform(xi, BT, alpha, alpha, [&](int j) { return input(tx * m + j, y, c, n); });
+        input_t(xi, yi, tx, ty, c, n) =
+            transform(yi, BT, alpha, alpha, [&](int j) { return input_x(xi, ty * m + j, tx, c, n); });
+
+        // Multiply the transformed tiles and filters elementwise,
+        // summing over the input channels. This is a batch of alpha^2
+        // matrix multiplies, and is where almost all of the work is.
+        Func product("product");
+        RDom r(filter.dim(2).min(), filter.dim(2).extent());
+        product(xi, yi, tx, ty, z, n) = 0.0f;
+        product(xi, yi, tx, ty, z, n) += filter_t(xi, yi, r, z) * input_t(xi, yi, tx, ty, r, n);
+
+        // Transform the products back, Y = A^T M A.
+        Func output_x("output_x"), output_t("output_t");
+        output_x(xi, yi, tx, ty, z, n) =
+            transform(xi, AT, m, alpha, [&](int j) { return product(j, yi, tx, ty, z, n); });
+        output_t(xi, yi, tx, ty, z, n) =
+            transform(yi, AT, m, alpha, [&](int j) { return output_x(xi, j, tx, ty, z, n); });
+
+        Func f_conv("conv");
+        f_conv(x, y, z, n) = bias(z) + output_t(x % m, y % m, x / m, y / m, z, n);
+
+        f_ReLU(x, y, z, n) = max(0, f_conv(x, y, z, n));
+
+        filter.dim(0).set_bounds(0, 3);
+        filter.dim(1).set_bounds(0, 3);
+
+        /* THE SCHEDULE */
+
+        if (auto_schedule) {
+            // Provide estimates on the input image
+            input.dim(0).set_bounds_estimate(0, 131);
+            input.dim(1).set_bounds_estimate(0, 131);
+            input.dim(2).set_bounds_estimate(0, 64);
+            input.dim(3).set_bounds_estimate(0, 4);
+
+            filter.dim(2).set_bounds_estimate(0, 64);
+            filter.dim(3).set_bounds_estimate(0, 64);
+
+            bias.dim(0).set_bounds_estimate(0, 64);
+
+            // Provide estimates on the pipeline f_ReLU
+            f_ReLU.estimate(x, 0, 128)
+                .estimate(y, 0, 128)
+                .estimate(z, 0, 64)
+                .estimate(n, 0, 4);
+        } else {
+            int vec_len = 8;
+            int o_block_size = 8;
+
+            // The filters are transformed once per call.
+            filter_t.compute_root()
+                .unroll(xi)
+                .unroll(yi)
+                .parallel(z);
+            filter_x.compute_at(filter_t, z)
+                .unroll(xi);
+
+            // Tiles along x are innermost in the transformed input, so
+            // that the multiplies below vectorize across them.
+            input_t.compute_root()
+                .reorder(tx, xi, yi, ty, c, n)
+                .vectorize(tx, vec_len)
+                .unroll(xi)
+                .unroll(yi)
+                .parallel(n)
+                .parallel(ty);
+            input_x.compute_at(input_t, ty)
+                .reorder(tx, xi, y)
+                .vectorize(tx, vec_len)
+                .unroll(xi);
+            input_t.reorder_storage(tx, xi, yi, ty, c, n);
+
+            // Each task multiplies and transforms back one row of
+            // tiles for a block of output channels.
+            Var z_t("z_t"), par("par");
+            f_ReLU.split(y, ty, yi, m)
+                .split(z, z, z_t, o_block_size)
+                .reorder(x, yi, z_t, ty, z, n)
+                .vectorize(x, vec_len)
+                .fuse(z, n, par)
+                .parallel(par);
+            product.compute_at(f_ReLU, ty)
+                .reorder(tx, xi, yi, z)
+                .vectorize(tx, vec_len);
+            product.update()
+                .reorder(tx, xi, yi, r, z)
+                .vectorize(tx, vec_len)
+                .unroll(xi)
+                .unroll(yi);
+            product.reorder_storage(tx, xi, yi, ty, z, n);
+            output_t.compute_at(f_ReLU, ty)
+                .reorder(tx, xi, yi)
+                .vectorize(tx, vec_len)
+                .unroll(xi)
+                .unroll(yi);
+        }
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(WinogradConvolutionLayer, winograd_conv_layer)
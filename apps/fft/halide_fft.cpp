@@ -0,0 +1,84 @@
+#include "halide_fft.h"
+
+// Generated by the Makefile: one
+//     HALIDE_FFT_VARIANT(transform, n0, n1)
+// line per pipeline in the library.
+#define HALIDE_FFT_VARIANT(transform, n0, n1) \
+    extern "C" int fft_##transform##_##n0##x##n1(halide_buffer_t *, halide_buffer_t *);
+#include "halide_fft_variants.h"
+#undef HALIDE_FFT_VARIANT
+
+struct halide_fft_plan_t {
+    halide_fft_transform_t transform;
+    int n0, n1;
+    int (*pipeline)(halide_buffer_t *, halide_buffer_t *);
+};
+
+namespace {
+
+const halide_fft_plan_t plans[] = {
+#define HALIDE_FFT_VARIANT(transform, n0, n1) \
+    {halide_fft_##transform, n0, n1, fft_##transform##_##n0##x##n1},
+#include "halide_fft_variants.h"
+#undef HALIDE_FFT_VARIANT
+};
+
+const int num_plans = sizeof(plans) / sizeof(plans[0]);
+
+bool input_is_real(halide_fft_transform_t t) {
+    return t == halide_fft_forward_r2c;
+}
+
+bool output_is_real(halide_fft_transform_t t) {
+    return t == halide_fft_inverse_c2r;
+}
+
+}  // namespace
+
+extern "C" {
+
+const halide_fft_plan_t *halide_fft_plan(halide_fft_transform_t transform, int n0, int n1) {
+    for (const halide_fft_plan_t &p : plans) {
+        if (p.transform == transform && p.n0 == n0 && p.n1 == n1) {
+            return &p;
+        }
+    }
+    return nullptr;
+}
+
+void halide_fft_plan_shape(const halide_fft_plan_t *plan,
+                           int input_extents[3], int output_extents[3]) {
+    // The complex side of a real transform only holds the
+    // non-redundant half of dimension 1.
+    int half_n1 = plan->n1 / 2 + 1;
+    bool real_in = input_is_real(plan->transform);
+    bool real_out = output_is_real(plan->transform);
+    input_extents[0] = plan->n0;
+    input_extents[1] = real_out ? half_n1 : plan->n1;
+    input_extents[2] = real_in ? 1 : 2;
+    output_extents[0] = plan->n0;
+    output_extents[1] = real_in ? half_n1 : plan->n1;
+    output_extents[2] = real_out ? 1 : 2;
+}
+
+int halide_fft_execute(const halide_fft_plan_t *plan,
+                       halide_buffer_t *input, halide_buffer_t *output) {
+    return plan->pipeline(input, output);
+}
+
+int halide_fft_plan_count(void) {
+    return num_plans;
+}
+
+const halide_fft_plan_t *halide_fft_plan_at(int index) {
+    return (index >= 0 && index < num_plans) ? &plans[index] : nullptr;
+}
+
+void halide_fft_plan_info(const halide_fft_plan_t *plan,
+                          halide_fft_transform_t *transform, int *n0, int *n1) {
+    *transform = plan->transform;
+    *n0 = plan->n0;
+    *n1 = plan->n1;
+}
+
+}  // extern "C"
@@ -0,0 +1,68 @@
+#ifndef HALIDE_FFT_LIBRARY_H
+#define HALIDE_FFT_LIBRARY_H
+
+/** \file
+ *
+ * A C interface to a library of ahead-of-time compiled FFTs. The
+ * library is built from the fft generator for a fixed set of sizes (see
+ * FFT_LIBRARY_SIZES in the Makefile); each size has its own pipeline,
+ * with its radix decomposition and twiddle factors chosen and baked in
+ * when the library is built.
+ *
+ * Buffers are three dimensional, as for the fft generator: dimensions
+ * 0 and 1 are the two dimensions of the transform, and dimension 2
+ * holds the components of each sample (1 for real, 2 for complex),
+ * which must be interleaved (stride 1). A 1D transform has n1 = 1.
+ * Real to complex transforms produce only the n1 / 2 + 1 non-redundant
+ * rows of their output, and complex to real transforms expect them.
+ *
+ * Neither direction is normalized: a forward transform followed by an
+ * inverse one scales the data by n0 * n1.
+ */
+
+struct halide_buffer_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum halide_fft_transform_t {
+    halide_fft_forward_c2c,
+    halide_fft_inverse_c2c,
+    halide_fft_forward_r2c,
+    halide_fft_inverse_c2r,
+} halide_fft_transform_t;
+
+/** An FFT of one size and kind. Plans are owned by the library and
+ * stay valid for the lifetime of the program. */
+typedef struct halide_fft_plan_t halide_fft_plan_t;
+
+/** Get the plan for a transform of the given size. Returns NULL if the
+ * library contains no pipeline of that size. This is a lookup in a
+ * static table, so there is nothing to create or destroy, and it is
+ * safe to call from many threads. */
+extern const halide_fft_plan_t *halide_fft_plan(halide_fft_transform_t transform, int n0, int n1);
+
+/** Get the extents of the three dimensions of the input and output
+ * buffers of a plan. */
+extern void halide_fft_plan_shape(const halide_fft_plan_t *plan,
+                                  int input_extents[3], int output_extents[3]);
+
+/** Run a plan. Returns zero on success, or the error code of the
+ * pipeline, e.g. if a buffer has the wrong shape. Each call may run
+ * in parallel on the halide thread pool. */
+extern int halide_fft_execute(const halide_fft_plan_t *plan,
+                              struct halide_buffer_t *input,
+                              struct halide_buffer_t *output);
+
+/** Enumerate the plans in the library. */
+extern int halide_fft_plan_count(void);
+extern const halide_fft_plan_t *halide_fft_plan_at(int index);
+extern void halide_fft_plan_info(const halide_fft_plan_t *plan,
+                                 halide_fft_transform_t *transform, int *n0, int *n1);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  // HALIDE_FFT_LIBRARY_H
@@ -0,0 +1,126 @@
+#include <cmath>
+#include <complex>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "HalideBuffer.h"
+
+#include "halide_fft.h"
+
+using Halide::Runtime::Buffer;
+
+namespace {
+
+const double kPi = 3.14159265358979310000;
+
+const char *transform_name(halide_fft_transform_t t) {
+    switch (t) {
+    case halide_fft_forward_c2c: return "forward_c2c";
+    case halide_fft_inverse_c2c: return "inverse_c2c";
+    case halide_fft_forward_r2c: return "forward_r2c";
+    case halide_fft_inverse_c2r: return "inverse_c2r";
+    }
+    return "unknown";
+}
+
+typedef std::vector<std::complex<double>> Signal;
+
+// A naive 2D DFT of an n0 x n1 signal stored with x innermost.
+Signal dft(const Signal &x, int n0, int n1, int sign) {
+    Signal X(n0 * n1);
+    for (int k1 = 0; k1 < n1; k1++) {
+        for (int k0 = 0; k0 < n0; k0++) {
+            std::complex<double> sum = 0;
+            for (int j1 = 0; j1 < n1; j1++) {
+                for (int j0 = 0; j0 < n0; j0++) {
+                    double angle = sign * 2 * kPi * ((double)k0 * j0 / n0 + (double)k1 * j1 / n1);
+                    sum += x[j0 + j1 * n0] * std::polar(1.0, angle);
+                }
+            }
+            X[k0 + k1 * n0] = sum;
+        }
+    }
+    return X;
+}
+
+bool test_plan(const halide_fft_plan_t *plan) {
+    halide_fft_transform_t transform;
+    int n0, n1;
+    halide_fft_plan_info(plan, &transform, &n0, &n1);
+    if (halide_fft_plan(transform, n0, n1) != plan) {
+        std::cerr << "Looking up " << transform_name(transform) << " " << n0 << "x" << n1
+                  << " did not find its plan" << std::endl;
+        return false;
+    }
+
+    int in_extents[3], out_extents[3];
+    halide_fft_plan_shape(plan, in_extents, out_extents);
+    auto in = Buffer<float, 3>::make_interleaved(in_extents[0], in_extents[1], in_extents[2]);
+    auto out = Buffer<float, 3>::make_interleaved(out_extents[0], out_extents[1], out_extents[2]);
+
+    // Make a random signal, real for the real transforms, and the
+    // output it should be transformed to. The input of the complex to
+    // real transform is the spectrum of a real signal.
+    bool real_signal = transform == halide_fft_forward_r2c || transform == halide_fft_inverse_c2r;
+    Signal signal(n0 * n1);
+    for (auto &s : signal) {
+        s = std::complex<double>(rand() / (double)RAND_MAX - 0.5,
+                                 real_signal ? 0.0 : rand() / (double)RAND_MAX - 0.5);
+    }
+    Signal in_values, out_values;
+    if (transform == halide_fft_inverse_c2r) {
+        in_values = dft(signal, n0, n1, -1);
+        out_values = signal;
+        for (auto &o : out_values) {
+            o *= n0 * n1;
+        }
+    } else {
+        in_values = signal;
+        out_values = dft(signal, n0, n1, transform == halide_fft_inverse_c2c ? 1 : -1);
+    }
+
+    in.for_each_element([&](int x, int y, int c) {
+        in(x, y, c) = c == 0 ? in_values[x + y * n0].real() : in_values[x + y * n0].imag();
+    });
+
+    int result = halide_fft_execute(plan, in, out);
+    if (result != 0) {
+        std::cerr << transform_name(transform) << " " << n0 << "x" << n1
+                  << " failed returning " << result << std::endl;
+        return false;
+    }
+
+    double tolerance = 1e-4 * n0 * n1;
+    bool ok = true;
+    out.for_each_element([&](int x, int y, int c) {
+        const std::complex<double> &o = out_values[x + y * n0];
+        double expected = c == 0 ? o.real() : o.imag();
+        if (ok && std::abs(out(x, y, c) - expected) > tolerance) {
+            std::cerr << transform_name(transform) << " " << n0 << "x" << n1
+                      << " output (" << x << ", " << y << ", " << c << ") is " << out(x, y, c)
+                      << " instead of " << expected << std::endl;
+            ok = false;
+        }
+    });
+    return ok;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    if (halide_fft_plan(halide_fft_forward_c2c, 3, 5) != nullptr) {
+        std::cerr << "Found a plan for a size that is not in the library" << std::endl;
+        return 1;
+    }
+
+    for (int i = 0; i < halide_fft_plan_count(); i++) {
+        if (!test_plan(halide_fft_plan_at(i))) {
+            return 1;
+        }
+    }
+
+    std::cout << "Tested " << halide_fft_plan_count() << " FFTs" << std::endl;
+    std::cout << "Success!" << std::endl;
+    return 0;
+}
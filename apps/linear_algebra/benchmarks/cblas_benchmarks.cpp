@@ -7,7 +7,8 @@
 // Accepted values for subroutine are:
 //    L1: scal, copy, axpy, dot, nrm2
 //    L2: gemv_notrans, gemv_trans
-//    L3: gemm_notrans, gemm_trans_A, gemm_trans_B, gemm_trans_AB
+//    L3: gemm_notrans, gemm_trans_A, gemm_trans_B, gemm_trans_AB,
+//        syrk_notrans, syrk_trans, trsm_lower, trsm_upper
 //
 
 #include <iomanip>
@@ -72,6 +73,16 @@ struct BenchmarksBase {
 
     BenchmarksBase(std::string n) : name(n) {}
 
+    void add_to_diagonal(Matrix &A, int N) {
+        for (int i=0; i<N; ++i) {
+            A[i * N + i] += N;
+        }
+    }
+
+    void copy_matrix(const Matrix &from, Matrix &to) {
+        to = from;
+    }
+
     void run(std::string benchmark, int size) {
         if (benchmark == "copy") {
             bench_copy(size);
@@ -97,6 +108,14 @@ struct BenchmarksBase {
             this->bench_gemm_transB(size);
         } else if (benchmark == "gemm_transAB") {
             this->bench_gemm_transAB(size);
+        } else if (benchmark == "syrk_notrans") {
+            this->bench_syrk_notrans(size);
+        } else if (benchmark == "syrk_trans") {
+            this->bench_syrk_trans(size);
+        } else if (benchmark == "trsm_lower") {
+            this->bench_trsm_lower(size);
+        } else if (benchmark == "trsm_upper") {
+            this->bench_trsm_upper(size);
         }
     }
 
@@ -112,6 +131,10 @@ struct BenchmarksBase {
     virtual void bench_gemm_transA(int N) =0;
     virtual void bench_gemm_transB(int N) =0;
     virtual void bench_gemm_transAB(int N) =0;
+    virtual void bench_syrk_notrans(int N) =0;
+    virtual void bench_syrk_trans(int N) =0;
+    virtual void bench_trsm_lower(int N) =0;
+    virtual void bench_trsm_upper(int N) =0;
 };
 
 struct BenchmarksFloat : public BenchmarksBase<float> {
@@ -153,6 +176,18 @@ struct BenchmarksFloat : public BenchmarksBase<float> {
     L3Benchmark(gemm_transAB, "s", cblas_sgemm(CblasColMajor, CblasTrans, CblasTrans, N, N, N,
                                                alpha, &(A[0]), N, &(B[0]), N,
                                                beta, &(C[0]), N))
+
+    L3TriangularBenchmark(syrk_notrans, "s", cblas_ssyrk(CblasColMajor, CblasLower, CblasNoTrans, N, N,
+                                                        alpha, &(A[0]), N, beta, &(C[0]), N))
+
+    L3TriangularBenchmark(syrk_trans, "s", cblas_ssyrk(CblasColMajor, CblasLower, CblasTrans, N, N,
+                                                      alpha, &(A[0]), N, beta, &(C[0]), N))
+
+    L3TriangularBenchmark(trsm_lower, "s", cblas_strsm(CblasColMajor, CblasLeft, CblasLower, CblasNoTrans,
+                                                      CblasNonUnit, N, N, alpha, &(A[0]), N, &(B[0]), N))
+
+    L3TriangularBenchmark(trsm_upper, "s", cblas_strsm(CblasColMajor, CblasLeft, CblasUpper, CblasNoTrans,
+                                                      CblasNonUnit, N, N, alpha, &(A[0]), N, &(B[0]), N))
 };
 
 struct BenchmarksDouble : public BenchmarksBase<double> {
@@ -194,6 +229,18 @@ struct BenchmarksDouble : public BenchmarksBase<double> {
     L3Benchmark(gemm_transAB, "d", cblas_dgemm(CblasColMajor, CblasTrans, CblasTrans, N, N, N,
                                                alpha, &(A[0]), N, &(B[0]), N,
                                                beta, &(C[0]), N))
+
+    L3TriangularBenchmark(syrk_notrans, "d", cblas_dsyrk(CblasColMajor, CblasLower, CblasNoTrans, N, N,
+                                                        alpha, &(A[0]), N, beta, &(C[0]), N))
+
+    L3TriangularBenchmark(syrk_trans, "d", cblas_dsyrk(CblasColMajor, CblasLower, CblasTrans, N, N,
+                                                      alpha, &(A[0]), N, beta, &(C[0]), N))
+
+    L3TriangularBenchmark(trsm_lower, "d", cblas_dtrsm(CblasColMajor, CblasLeft, CblasLower, CblasNoTrans,
+                                                      CblasNonUnit, N, N, alpha, &(A[0]), N, &(B[0]), N))
+
+    L3TriangularBenchmark(trsm_upper, "d", cblas_dtrsm(CblasColMajor, CblasLeft, CblasUpper, CblasNoTrans,
+                                                      CblasNonUnit, N, N, alpha, &(A[0]), N, &(B[0]), N))
 };
 
 int main(int argc, char* argv[]) {
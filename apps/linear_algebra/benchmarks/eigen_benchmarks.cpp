@@ -7,7 +7,8 @@
 // Accepted values for subroutine are:
 //    L1: scal, copy, axpy, dot, nrm2
 //    L2: gemv_notrans, gemv_trans
-//    L3: gemm_notrans, gemm_trans_A, gemm_trans_B, gemm_trans_AB
+//    L3: gemm_notrans, gemm_trans_A, gemm_trans_B, gemm_trans_AB,
+//        syrk_notrans, syrk_trans, trsm_lower, trsm_upper
 //
 
 #include <iomanip>
@@ -52,6 +53,14 @@ struct Benchmarks {
 
     Benchmarks(std::string n) : name(n) {}
 
+    void add_to_diagonal(Matrix &A, int N) {
+        A.diagonal().array() += N;
+    }
+
+    void copy_matrix(const Matrix &from, Matrix &to) {
+        to = from;
+    }
+
     void run(std::string benchmark, int size) {
         if (benchmark == "copy") {
             bench_copy(size);
@@ -77,6 +86,14 @@ struct Benchmarks {
             bench_gemm_transB(size);
         } else if (benchmark == "gemm_transAB") {
             bench_gemm_transAB(size);
+        } else if (benchmark == "syrk_notrans") {
+            bench_syrk_notrans(size);
+        } else if (benchmark == "syrk_trans") {
+            bench_syrk_trans(size);
+        } else if (benchmark == "trsm_lower") {
+            bench_trsm_lower(size);
+        } else if (benchmark == "trsm_upper") {
+            bench_trsm_upper(size);
         }
     }
 
@@ -97,6 +114,15 @@ struct Benchmarks {
     L3Benchmark(gemm_transB, type_name<T>(), C = alpha * A * B.transpose() + beta * C);
     L3Benchmark(gemm_transAB, type_name<T>(), C = alpha * A.transpose() * B.transpose() + beta * C);
 
+    L3TriangularBenchmark(syrk_notrans, type_name<T>(),
+                          C *= beta; C.template selfadjointView<Eigen::Lower>().rankUpdate(A, alpha));
+    L3TriangularBenchmark(syrk_trans, type_name<T>(),
+                          C *= beta; C.template selfadjointView<Eigen::Lower>().rankUpdate(A.transpose(), alpha));
+    L3TriangularBenchmark(trsm_lower, type_name<T>(),
+                          B *= alpha; A.template triangularView<Eigen::Lower>().solveInPlace(B));
+    L3TriangularBenchmark(trsm_upper, type_name<T>(),
+                          B *= alpha; A.template triangularView<Eigen::Upper>().solveInPlace(B));
+
   private:
     std::string name;
 };
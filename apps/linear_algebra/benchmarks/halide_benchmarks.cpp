@@ -7,7 +7,8 @@
 // Accepted values for subroutine are:
 //    L1: scal, copy, axpy, dot, nrm2
 //    L2: gemv_notrans, gemv_trans
-//    L3: gemm_notrans, gemm_trans_A, gemm_trans_B, gemm_trans_AB
+//    L3: gemm_notrans, gemm_trans_A, gemm_trans_B, gemm_trans_AB,
+//        syrk_notrans, syrk_trans, trsm_lower, trsm_upper
 //
 
 #include <iomanip>
@@ -55,6 +56,16 @@ struct BenchmarksBase {
 
     BenchmarksBase(std::string n) : name(n) {}
 
+    void add_to_diagonal(Matrix &A, int N) {
+        for (int i=0; i<N; ++i) {
+            A(i, i) += N;
+        }
+    }
+
+    void copy_matrix(const Matrix &from, Matrix &to) {
+        to.copy_from(from);
+    }
+
     void run(std::string benchmark, int size) {
         if (benchmark == "copy") {
             bench_copy(size);
@@ -80,6 +91,14 @@ struct BenchmarksBase {
             bench_gemm_transB(size);
         } else if (benchmark == "gemm_transAB") {
             bench_gemm_transAB(size);
+        } else if (benchmark == "syrk_notrans") {
+            bench_syrk_notrans(size);
+        } else if (benchmark == "syrk_trans") {
+            bench_syrk_trans(size);
+        } else if (benchmark == "trsm_lower") {
+            bench_trsm_lower(size);
+        } else if (benchmark == "trsm_upper") {
+            bench_trsm_upper(size);
         }
     }
 
@@ -95,6 +114,10 @@ struct BenchmarksBase {
     virtual void bench_gemm_transA(int N) =0;
     virtual void bench_gemm_transB(int N) =0;
     virtual void bench_gemm_transAB(int N) =0;
+    virtual void bench_syrk_notrans(int N) =0;
+    virtual void bench_syrk_trans(int N) =0;
+    virtual void bench_trsm_lower(int N) =0;
+    virtual void bench_trsm_upper(int N) =0;
 };
 
 struct BenchmarksFloat : public BenchmarksBase<float> {
@@ -130,6 +153,18 @@ struct BenchmarksFloat : public BenchmarksBase<float> {
 
     L3Benchmark(gemm_transAB, "s", halide_sgemm(true, true, alpha, A.raw_buffer(),
                                                 B.raw_buffer(), beta, C.raw_buffer()))
+
+    L3TriangularBenchmark(syrk_notrans, "s", halide_ssyrk(false, false, alpha, A.raw_buffer(),
+                                                         beta, C.raw_buffer()))
+
+    L3TriangularBenchmark(syrk_trans, "s", halide_ssyrk(true, false, alpha, A.raw_buffer(),
+                                                       beta, C.raw_buffer()))
+
+    L3TriangularBenchmark(trsm_lower, "s", halide_strsm(true, false, false, alpha, A.raw_buffer(),
+                                                       B.raw_buffer()))
+
+    L3TriangularBenchmark(trsm_upper, "s", halide_strsm(false, false, false, alpha, A.raw_buffer(),
+                                                       B.raw_buffer()))
 };
 
 struct BenchmarksDouble : public BenchmarksBase<double> {
@@ -165,6 +200,18 @@ struct BenchmarksDouble : public BenchmarksBase<double> {
 
     L3Benchmark(gemm_transAB, "d", halide_dgemm(true, true, alpha, A.raw_buffer(),
                                                 B.raw_buffer(), beta, C.raw_buffer()))
+
+    L3TriangularBenchmark(syrk_notrans, "d", halide_dsyrk(false, false, alpha, A.raw_buffer(),
+                                                         beta, C.raw_buffer()))
+
+    L3TriangularBenchmark(syrk_trans, "d", halide_dsyrk(true, false, alpha, A.raw_buffer(),
+                                                       beta, C.raw_buffer()))
+
+    L3TriangularBenchmark(trsm_lower, "d", halide_dtrsm(true, false, false, alpha, A.raw_buffer(),
+                                                       B.raw_buffer()))
+
+    L3TriangularBenchmark(trsm_upper, "d", halide_dtrsm(false, false, false, alpha, A.raw_buffer(),
+                                                       B.raw_buffer()))
 };
 
 int main(int argc, char* argv[]) {
@@ -83,3 +83,29 @@ inline void set_math_flags() {
                   << std::setw(20) << L3GFLOPS(N)                       \
                   << std::endl;                                         \
     }
+
+// syrk and trsm only touch one triangle of the N x N result or of A,
+// so do half the flops of gemm. A is made diagonally dominant so that
+// the solves of trsm are well conditioned, and B is reset before each
+// solve so that repeated solves in place don't shrink it to denormals.
+#define L3TriangularGFLOPS(N) (1.0 + N) * N * N * 1e-3 / elapsed
+#define L3TriangularBenchmark(benchmark, type, code)                    \
+    virtual void bench_##benchmark(int N) {                             \
+        Scalar alpha = random_scalar();                                 \
+        Scalar beta = random_scalar();                                  \
+        (void) beta;                                                    \
+        Matrix A(random_matrix(N));                                     \
+        Matrix B(random_matrix(N));                                     \
+        Matrix B0(random_matrix(N));                                    \
+        Matrix C(random_matrix(N));                                     \
+        add_to_diagonal(A, N);                                          \
+                                                                        \
+        time_it(copy_matrix(B0, B); code)                               \
+                                                                        \
+        std::cout << std::setw(8) << name                               \
+                  << std::setw(15) << type << #benchmark                \
+                  << std::setw(8) << std::to_string(N)                  \
+                  << std::setw(20) << std::to_string(elapsed)           \
+                  << std::setw(20) << L3TriangularGFLOPS(N)             \
+                  << std::endl;                                         \
+    }
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <vector>
 #include "Halide.h"
 
@@ -5,6 +6,96 @@ using namespace Halide;
 
 namespace {
 
+// The blocking shared by the level 3 kernels. The micro-kernel
+// accumulates an s x 4 block of the result in registers, where s is
+// twice the vector width, streaming an s x block_k panel of the packed
+// A and a block_k x 4 panel of the packed B from L1. The
+// block_m x block_k block of A it sweeps stays in L2 across the
+// columns of a block of the result, and each block_k x block_n panel
+// of B is packed into contiguous memory before use. Each
+// block_m x block_n block of the result is one task on the thread
+// pool. The defaults fit a 32KB L1 and a 256KB L2, and scale with the
+// vector width and element size of the target.
+struct L3Blocking {
+    int s, block_m, block_n, block_k;
+};
+
+L3Blocking choose_blocking(const Target &target, Type t,
+                           int block_m, int block_n, int block_k) {
+    L3Blocking b;
+    b.s = target.natural_vector_size(t) * 2;
+
+    b.block_k = block_k;
+    if (b.block_k <= 0) {
+        b.block_k = 512;
+        while (b.block_k > 32 && b.block_k * (b.s + 4) * t.bytes() > 24 * 1024) {
+            b.block_k /= 2;
+        }
+    }
+
+    const int l2_panel = 128 * 1024 / (b.block_k * t.bytes());
+    b.block_m = block_m > 0 ? block_m : std::max(b.s, l2_panel / b.s * b.s);
+    b.block_n = block_n > 0 ? block_n : std::max(4, l2_panel / 4 * 4);
+
+    _halide_user_assert(b.block_m % b.s == 0)
+        << "block_m must be a multiple of " << b.s << "\n";
+    _halide_user_assert(b.block_n % 4 == 0)
+        << "block_n must be a multiple of 4\n";
+    return b;
+}
+
+// Define the product of the packed A, As(ii, k, io), and the packed B,
+// Bp(k, j), as AB(ii, io, jj, jo), the element (io * s + ii, jo * 4 + jj)
+// of the product, so that each (io, jo) is a register block. It is
+// computed per task t of 'result', one block_k deep slice at a time,
+// packing the slice of B it needs first. If 'predicate' is defined, it
+// selects the register blocks to compute.
+Func blocked_product(Func As, Func Bp, Expr sum_size, const L3Blocking &b,
+                     Var ii, Var io, Var jj, Var jo, Expr predicate,
+                     Func result, Var t) {
+    Func AB("AB");
+    RDom rv(0, sum_size);
+    if (predicate.defined()) {
+        rv.where(predicate);
+    }
+    AB(ii, io, jj, jo) += As(ii, rv, io) * Bp(rv, jo * 4 + jj);
+
+    RVar rko("rko"), rki("rki");
+    AB.compute_at(result, t)
+        .bound_extent(ii, b.s).vectorize(ii)
+        .bound_extent(jj, 4).unroll(jj);
+    AB.update()
+        .split(rv, rko, rki, b.block_k)
+        .reorder(ii, jj, rki, io, jo, rko)
+        .vectorize(ii).unroll(jj);
+
+    Bp.compute_at(AB, rko);
+    return AB;
+}
+
+// Pack a matrix into the panels of s rows read by the micro-kernel,
+// As(i, k, io) = A(io * s + i, k). The matrix is zero beyond its
+// bounds, so the last panel is padded.
+Func pack_panels(Func Atmp, bool transpose, const L3Blocking &b, Expr parallel_if) {
+    Var i("i"), j("j"), io("io"), jo("jo"), ji("ji");
+    const int s = b.s;
+    Func As("As");
+    if (transpose) {
+        As(i, j, io) = Atmp(j, io*s + i);
+    } else {
+        As(i, j, io) = Atmp(io*s + i, j);
+    }
+
+    As.compute_root()
+        .split(j, jo, ji, s).reorder(i, ji, io, jo)
+        .unroll(i).vectorize(ji)
+        .specialize(parallel_if).parallel(jo, 4);
+
+    Atmp.compute_at(As, io)
+        .vectorize(Atmp.args()[0]).unroll(Atmp.args()[1]);
+    return As;
+}
+
 // Generator class for BLAS gemm operations.
 template<class T>
 class GEMMGenerator :
@@ -20,6 +111,12 @@ class GEMMGenerator :
     GeneratorParam<bool> transpose_A_ = {"transpose_A", false};
     GeneratorParam<bool> transpose_B_ = {"transpose_B", false};
 
+    // The blocking of the kernel (see L3Blocking). Zero picks a size
+    // for the target.
+    GeneratorParam<int> block_m_ = {"block_m", 0};
+    GeneratorParam<int> block_n_ = {"block_n", 0};
+    GeneratorParam<int> block_k_ = {"block_k", 0};
+
     // Standard ordering of parameters in GEMM functions.
     Input<T>         a_ = {"a_", 1};
     Input<Buffer<T>> A_ = {"A_", 2};
@@ -38,7 +135,9 @@ class GEMMGenerator :
         const Expr sum_size = A_.height();
 
         const int vec = natural_vector_size(a_.type());
-        const int s = vec * 2;
+        const L3Blocking blocking = choose_blocking(get_target(), a_.type(),
+                                                    block_m_, block_n_, block_k_);
+        const int s = blocking.s;
 
         Input<Buffer<T>> *A_in = &A_;
         Input<Buffer<T>> *B_in = &B_;
@@ -51,110 +150,259 @@ class GEMMGenerator :
             std::swap(A_in, B_in);
         }
 
-        Var i, j, ii, ji, jii, iii, io, jo, t;
-        Var ti[3], tj[3];
+        Var i("i"), j("j"), k("k"), ii("ii"), io("io"), jj("jj"), jo("jo");
+        Var ki("ki"), ji("ji"), ti("ti"), tj("tj"), t("t");
 
-        // Swizzle A for better memory order in the inner loop.
-        Func A("A"), B("B"), Btmp("Btmp"), As("As"), Atmp("Atmp");
+        // Pack A into panels in the order the micro-kernel reads them.
+        Func Atmp("Atmp");
         Atmp(i, j) = BoundaryConditions::constant_exterior(*A_in, cast<T>(0))(i, j);
+        Func As = pack_panels(Atmp, transpose_A, blocking,
+                              A_.width() >= 256 && A_.height() >= 256);
 
-        if (transpose_A) {
-            As(i, j, io) = Atmp(j, io*s + i);
-        } else {
-            As(i, j, io) = Atmp(io*s + i, j);
-        }
-
-        A(i, j) = As(i % s, j, i / s);
-
-        Btmp(i, j) = (*B_in)(i, j);
+        // And B into contiguous panels, a block_k deep slice of the
+        // columns of one block of the result at a time.
+        Func Btmp("Btmp"), Bp("Bp");
+        Btmp(i, j) = BoundaryConditions::constant_exterior(*B_in, cast<T>(0))(i, j);
         if (transpose_B) {
-            B(i, j) = Btmp(j, i);
+            Bp(k, j) = Btmp(j, k);
+            Bp.tile(k, j, ki, ji, 8, 8)
+                .vectorize(ki).unroll(ji);
+            Btmp.reorder_storage(j, i)
+                .compute_at(Bp, k)
+                .vectorize(i)
+                .unroll(j);
         } else {
-            B(i, j) = Btmp(i, j);
+            Bp(k, j) = Btmp(k, j);
+            Bp.vectorize(k, vec);
         }
 
-        Var k("k");
-        Func prod;
-        // Express all the products we need to do a matrix multiply as a 3D Func.
-        prod(k, i, j) = A(i, k) * B(k, j);
-
-        // Reduce the products along k.
-        Func AB("AB");
-        RDom rv(0, sum_size);
-        AB(i, j) += prod(rv, i, j);
+        Func AB = blocked_product(As, Bp, sum_size, blocking, ii, io, jj, jo,
+                                  Expr(), result_, t);
 
-        Func ABt("ABt");
+        // The product, transposed if necessary.
+        Expr prod;
         if (transpose_AB) {
-            // Transpose A*B if necessary.
-            ABt(i, j) = AB(j, i);
+            prod = AB(j % s, j / s, i % 4, i / 4);
         } else {
-            ABt(i, j) = AB(i, j);
+            prod = AB(i % s, i / s, j % 4, j / 4);
         }
 
         // Do the part that makes it a 'general' matrix multiply.
-        result_(i, j) = (a_ * ABt(i, j) + b_ * C_(i, j));
+        result_(i, j) = (a_ * prod + b_ * C_(i, j));
 
-        result_.tile(i, j, ti[1], tj[1], i, j, 2*s, 2*s, TailStrategy::GuardWithIf);
-        if (transpose_AB) {
-            result_
-                .tile(i, j, ii, ji, 4, s)
-                .tile(i, j, ti[0], tj[0], i, j, s/4, 1);
+        result_
+            .tile(i, j, ti, tj, i, j,
+                  transpose_AB ? blocking.block_n : blocking.block_m,
+                  transpose_AB ? blocking.block_m : blocking.block_n,
+                  TailStrategy::GuardWithIf)
+            .fuse(ti, tj, t).parallel(t)
+            .vectorize(i, vec);
 
-        } else {
-            result_
-                .tile(i, j, ii, ji, s, 4)
-                .tile(i, j, ti[0], tj[0], i, j, 1, s/4);
-        }
+        result_.bound(i, 0, num_rows).bound(j, 0, num_cols);
 
-        // If we have enough work per task, parallelize over these tiles.
-        result_.specialize(num_rows >= 512 && num_cols >= 512)
-            .fuse(tj[1], ti[1], t).parallel(t);
+        A_.dim(0).set_min(0).dim(1).set_min(0);
+        B_.dim(0).set_bounds(0, sum_size).dim(1).set_min(0);
+        C_.dim(0).set_bounds(0, num_rows);
+        C_.dim(1).set_bounds(0, num_cols);
+        result_.dim(0).set_bounds(0, num_rows).dim(1).set_bounds(0, num_cols);
+    }
+};
 
-        // Otherwise tile one more time before parallelizing, or don't
-        // parallelize at all.
-        result_.specialize(num_rows >= 128 && num_cols >= 128)
-            .tile(ti[1], tj[1], ti[2], tj[2], ti[1], tj[1], 2, 2)
-            .fuse(tj[2], ti[2], t).parallel(t);
+// Generator class for BLAS syrk operations, which update one triangle
+// of a symmetric matrix C with the product of a matrix and its
+// transpose. The other triangle of C is left unchanged, and the
+// register blocks of the product that lie entirely within it are not
+// computed.
+template<class T>
+class SYRKGenerator :
+        public Generator<SYRKGenerator<T>> {
+  public:
+    typedef Generator<SYRKGenerator<T>> Base;
+    using Base::target;
+    using Base::get_target;
+    using Base::natural_vector_size;
+    template<typename T2> using Input = typename Base::template Input<T2>;
+    template<typename T2> using Output = typename Base::template Output<T2>;
 
-        result_.rename(tj[0], t);
+    // If transpose is false, C = a * A * A^T + b * C, otherwise
+    // C = a * A^T * A + b * C.
+    GeneratorParam<bool> transpose_ = {"transpose", false};
 
-        result_.bound(i, 0, num_rows).bound(j, 0, num_cols);
+    // The blocking of the kernel (see L3Blocking). A block of the
+    // result is block_size square. Zero picks a size for the target.
+    GeneratorParam<int> block_size_ = {"block_size", 0};
+    GeneratorParam<int> block_k_ = {"block_k", 0};
 
-        As.compute_root()
-            .split(j, jo, ji, s).reorder(i, ji, io, jo)
-            .unroll(i).vectorize(ji)
-            .specialize(A_.width() >= 256 && A_.height() >= 256).parallel(jo, 4);
+    // Standard ordering of parameters in SYRK functions.
+    Input<bool>      upper_ = {"upper_", false};
+    Input<T>         a_ = {"a_", 1};
+    Input<Buffer<T>> A_ = {"A_", 2};
+    Input<T>         b_ = {"b_", 1};
+    Input<Buffer<T>> C_ = {"C_", 2};
 
-        Atmp.compute_at(As, io)
-            .vectorize(i).unroll(j);
+    Output<Buffer<T>> result_ = {"result", 2};
 
-        if (transpose_B) {
-            B.compute_at(result_, t)
-                .tile(i, j, ii, ji, 8, 8)
-                .vectorize(ii).unroll(ji);
+    void generate() {
+        const bool transpose = transpose_;
+        const Expr size = C_.width();
+        const Expr sum_size = transpose ? A_.width() : A_.height();
+
+        const int vec = natural_vector_size(a_.type());
+        L3Blocking blocking = choose_blocking(get_target(), a_.type(),
+                                              block_size_, block_size_, block_k_);
+        const int s = blocking.s;
+        _halide_user_assert(blocking.block_m % 4 == 0)
+            << "block_size must be a multiple of 4\n";
+        blocking.block_n = blocking.block_m;
+
+        Var i("i"), j("j"), k("k"), ii("ii"), io("io"), jj("jj"), jo("jo");
+        Var ki("ki"), ji("ji"), ti("ti"), tj("tj"), t("t");
+
+        Func A = BoundaryConditions::constant_exterior(A_, cast<T>(0));
+        Func Atmp("Atmp");
+        Atmp(i, j) = A(i, j);
+        Func As = pack_panels(Atmp, transpose, blocking,
+                              A_.width() >= 256 && A_.height() >= 256);
+
+        // The other side of the product is A transposed.
+        Func Btmp("Btmp"), Bp("Bp");
+        Btmp(i, j) = A(i, j);
+        if (transpose) {
+            Bp(k, j) = Btmp(k, j);
+            Bp.vectorize(k, vec);
+        } else {
+            Bp(k, j) = Btmp(j, k);
+            Bp.tile(k, j, ki, ji, 8, 8)
+                .vectorize(ki).unroll(ji);
             Btmp.reorder_storage(j, i)
-                .compute_at(B, i)
+                .compute_at(Bp, k)
                 .vectorize(i)
                 .unroll(j);
         }
 
+        // Only compute the register blocks with some of the triangle in them.
+        Expr block_in_triangle = select(upper_,
+                                        io * s <= jo * 4 + 3,
+                                        io * s + s - 1 >= jo * 4);
+        Func AB = blocked_product(As, Bp, sum_size, blocking, ii, io, jj, jo,
+                                  block_in_triangle, result_, t);
 
-        AB.compute_at(result_, i)
-            .bound_extent(j, 4).unroll(j)
-            .bound_extent(i, s).vectorize(i)
-            .update()
-            .reorder(i, j, rv).unroll(j).unroll(rv, 2).vectorize(i);
-        if (transpose_AB) {
-            ABt.compute_at(result_, i)
-                .bound_extent(i, 4).unroll(i)
-                .bound_extent(j, s).vectorize(j);
-        }
+        Expr in_triangle = select(upper_, i <= j, i >= j);
+        result_(i, j) = select(in_triangle,
+                               a_ * AB(i % s, i / s, j % 4, j / 4) + b_ * C_(i, j),
+                               C_(i, j));
+
+        result_
+            .tile(i, j, ti, tj, i, j, blocking.block_m, blocking.block_n,
+                  TailStrategy::GuardWithIf)
+            .fuse(ti, tj, t).parallel(t)
+            .vectorize(i, vec);
+
+        result_.bound(i, 0, size).bound(j, 0, size);
 
         A_.dim(0).set_min(0).dim(1).set_min(0);
-        B_.dim(0).set_bounds(0, sum_size).dim(1).set_min(0);
-        C_.dim(0).set_bounds(0, num_rows);
-        C_.dim(1).set_bounds(0, num_cols);
-        result_.dim(0).set_bounds(0, num_rows).dim(1).set_bounds(0, num_cols);
+        A_.dim(transpose ? 1 : 0).set_extent(size);
+        C_.dim(0).set_bounds(0, size);
+        C_.dim(1).set_bounds(0, size);
+        result_.dim(0).set_bounds(0, size).dim(1).set_bounds(0, size);
+    }
+};
+
+// Generator class for BLAS trsm operations, which solve
+// op(A) * X = a * B for X, where A is triangular, and the columns of B
+// are the right hand sides. The columns are independent, so they are
+// solved in panels of block_n columns, one panel per task on the
+// thread pool, with the rows of each panel stored contiguously so that
+// the substitution is vectorized across the columns.
+template<class T>
+class TRSMGenerator :
+        public Generator<TRSMGenerator<T>> {
+  public:
+    typedef Generator<TRSMGenerator<T>> Base;
+    using Base::target;
+    using Base::get_target;
+    using Base::natural_vector_size;
+    template<typename T2> using Input = typename Base::template Input<T2>;
+    template<typename T2> using Output = typename Base::template Output<T2>;
+
+    // Whether A is lower or upper triangular, and whether op(A) is A
+    // or its transpose.
+    GeneratorParam<bool> lower_ = {"lower", true};
+    GeneratorParam<bool> transpose_A_ = {"transpose_A", false};
+
+    // The number of columns of B solved per task. Zero picks a size
+    // for the target.
+    GeneratorParam<int> block_n_ = {"block_n", 0};
+
+    // Standard ordering of parameters in TRSM functions.
+    Input<bool>      unit_diagonal_ = {"unit_diagonal_", false};
+    Input<T>         a_ = {"a_", 1};
+    Input<Buffer<T>> A_ = {"A_", 2};
+    Input<Buffer<T>> B_ = {"B_", 2};
+
+    Output<Buffer<T>> result_ = {"result", 2};
+
+    void generate() {
+        const Expr size = A_.width();
+        const Expr num_cols = B_.height();
+
+        const int vec = natural_vector_size(a_.type());
+        const int block_n = block_n_ > 0 ? (int)block_n_ : vec * 8;
+        _halide_user_assert(block_n % vec == 0)
+            << "block_n must be a multiple of " << vec << "\n";
+
+        // op(A) is lower triangular if A is lower triangular and not
+        // transposed, or upper triangular and transposed.
+        const bool transpose_A = transpose_A_;
+        const bool lower = (bool)lower_ != transpose_A;
+
+        Var i("i"), j("j"), jo("jo"), ji("ji"), jv("jv");
+
+        Func L("L");
+        if (transpose_A) {
+            L(i, j) = A_(j, i);
+        } else {
+            L(i, j) = A_(i, j);
+        }
+
+        Func X("X");
+        X(i, j) = a_ * BoundaryConditions::constant_exterior(B_, cast<T>(0))(i, j);
+
+        // Substitute one row at a time, from the top down if op(A) is
+        // lower triangular and from the bottom up otherwise. For each
+        // row, r.x walks along the row of op(A) up to the diagonal,
+        // subtracting the contributions of the rows already solved,
+        // then divides by the diagonal.
+        RDom r(0, size, 0, size);
+        r.where(r.x <= r.y);
+        Expr row = lower ? r.y : size - 1 - r.y;
+        Expr col = lower ? r.x : size - 1 - r.x;
+        Expr diagonal = select(unit_diagonal_, cast<T>(1), L(row, row));
+        X(row, j) = select(r.x == r.y,
+                           X(row, j) / diagonal,
+                           X(row, j) - L(row, col) * X(col, j));
+
+        result_(i, j) = X(i, j);
+
+        result_
+            .split(j, jo, j, block_n, TailStrategy::GuardWithIf)
+            .parallel(jo)
+            .vectorize(i, vec);
+
+        X.compute_at(result_, jo)
+            .bound_extent(j, block_n)
+            .reorder_storage(j, i)
+            .vectorize(j, vec);
+        X.update()
+            .split(j, jv, j, vec)
+            .reorder(j, jv, r.x, r.y)
+            .vectorize(j).unroll(jv);
+
+        result_.bound(i, 0, size).bound(j, 0, num_cols);
+
+        A_.dim(0).set_min(0).dim(1).set_bounds(0, size);
+        B_.dim(0).set_bounds(0, size).dim(1).set_min(0);
+        result_.dim(0).set_bounds(0, size).dim(1).set_bounds(0, num_cols);
     }
 };
 
@@ -162,3 +410,7 @@ class GEMMGenerator :
 
 HALIDE_REGISTER_GENERATOR(GEMMGenerator<float>, sgemm)
 HALIDE_REGISTER_GENERATOR(GEMMGenerator<double>, dgemm)
+HALIDE_REGISTER_GENERATOR(SYRKGenerator<float>, ssyrk)
+HALIDE_REGISTER_GENERATOR(SYRKGenerator<double>, dsyrk)
+HALIDE_REGISTER_GENERATOR(TRSMGenerator<float>, strsm)
+HALIDE_REGISTER_GENERATOR(TRSMGenerator<double>, dtrsm)
@@ -279,6 +279,114 @@ void hblas_dgemm(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE TransA
     assert_no_error(halide_dgemm(tA, tB, alpha, buff_A, buff_B, beta, buff_C));
 }
 
+//////////
+// syrk //
+//////////
+
+void hblas_ssyrk(const enum HBLAS_ORDER Order, const enum HBLAS_UPLO Uplo,
+                 const enum HBLAS_TRANSPOSE Trans, const int N, const int K,
+                 const float alpha, const float *A, const int lda,
+                 const float beta, float *C, const int ldc) {
+    bool t = false;
+    switch (Trans) {
+    case HblasNoTrans:
+        t = false; break;
+    case HblasConjTrans:
+    case HblasTrans:
+        t = true; break;
+    };
+
+    auto buff_A = init_matrix_buffer(t ? K : N, t ? N : K, const_cast<float*>(A), lda);
+    auto buff_C = init_matrix_buffer(N, N, C, ldc);
+
+    assert_no_error(halide_ssyrk(t, Uplo == HblasUpper, alpha, buff_A, beta, buff_C));
+}
+
+void hblas_dsyrk(const enum HBLAS_ORDER Order, const enum HBLAS_UPLO Uplo,
+                 const enum HBLAS_TRANSPOSE Trans, const int N, const int K,
+                 const double alpha, const double *A, const int lda,
+                 const double beta, double *C, const int ldc) {
+    bool t = false;
+    switch (Trans) {
+    case HblasNoTrans:
+        t = false; break;
+    case HblasConjTrans:
+    case HblasTrans:
+        t = true; break;
+    };
+
+    auto buff_A = init_matrix_buffer(t ? K : N, t ? N : K, const_cast<double*>(A), lda);
+    auto buff_C = init_matrix_buffer(N, N, C, ldc);
+
+    assert_no_error(halide_dsyrk(t, Uplo == HblasUpper, alpha, buff_A, beta, buff_C));
+}
+
+//////////
+// trsm //
+//////////
+
+void hblas_strsm(const enum HBLAS_ORDER Order, const enum HBLAS_SIDE Side,
+                 const enum HBLAS_UPLO Uplo, const enum HBLAS_TRANSPOSE TransA,
+                 const enum HBLAS_DIAG Diag, const int M, const int N,
+                 const float alpha, const float *A, const int lda,
+                 float *B, const int ldb) {
+    bool tA = false;
+    switch (TransA) {
+    case HblasNoTrans:
+        tA = false; break;
+    case HblasConjTrans:
+    case HblasTrans:
+        tA = true; break;
+    };
+
+    bool lower = Uplo == HblasLower;
+    bool unit = Diag == HblasUnit;
+    auto buff_B = init_matrix_buffer(M, N, B, ldb);
+    if (Side == HblasLeft) {
+        auto buff_A = init_matrix_buffer(M, M, const_cast<float*>(A), lda);
+        assert_no_error(halide_strsm(lower, tA, unit, alpha, buff_A, buff_B));
+    } else {
+        // X * op(A) = alpha * B is op(A)^T * X^T = alpha * B^T. The
+        // kernels want dense columns, so solve on a transposed copy.
+        auto buff_A = init_matrix_buffer(N, N, const_cast<float*>(A), lda);
+        Buffer<float> buff_Bt(N, M);
+        buff_Bt.copy_from(buff_B.transposed(0, 1));
+        assert_no_error(halide_strsm(lower, !tA, unit, alpha, buff_A, buff_Bt));
+        buff_B.copy_from(buff_Bt.transposed(0, 1));
+    }
+}
+
+void hblas_dtrsm(const enum HBLAS_ORDER Order, const enum HBLAS_SIDE Side,
+                 const enum HBLAS_UPLO Uplo, const enum HBLAS_TRANSPOSE TransA,
+                 const enum HBLAS_DIAG Diag, const int M, const int N,
+                 const double alpha, const double *A, const int lda,
+                 double *B, const int ldb) {
+    bool tA = false;
+    switch (TransA) {
+    case HblasNoTrans:
+        tA = false; break;
+    case HblasConjTrans:
+    case HblasTrans:
+        tA = true; break;
+    };
+
+    bool lower = Uplo == HblasLower;
+    bool unit = Diag == HblasUnit;
+    auto buff_B = init_matrix_buffer(M, N, B, ldb);
+    if (Side == HblasLeft) {
+        auto buff_A = init_matrix_buffer(M, M, const_cast<double*>(A), lda);
+        assert_no_error(halide_dtrsm(lower, tA, unit, alpha, buff_A, buff_B));
+    } else {
+        // X * op(A) = alpha * B is op(A)^T * X^T = alpha * B^T. The
+        // kernels want dense columns, so solve on a transposed copy.
+        auto buff_A = init_matrix_buffer(N, N, const_cast<double*>(A), lda);
+        Buffer<double> buff_Bt(N, M);
+        buff_Bt.copy_from(buff_B.transposed(0, 1));
+        assert_no_error(halide_dtrsm(lower, !tA, unit, alpha, buff_A, buff_Bt));
+        buff_B.copy_from(buff_Bt.transposed(0, 1));
+    }
+}
+
 
 #ifdef __cplusplus
 }
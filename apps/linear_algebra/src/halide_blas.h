@@ -28,6 +28,18 @@
 #include "halide_dgemm_transB.h"
 #include "halide_sgemm_transAB.h"
 #include "halide_dgemm_transAB.h"
+#include "halide_ssyrk_notrans.h"
+#include "halide_ssyrk_trans.h"
+#include "halide_dsyrk_notrans.h"
+#include "halide_dsyrk_trans.h"
+#include "halide_strsm_lower_notrans.h"
+#include "halide_strsm_lower_trans.h"
+#include "halide_strsm_upper_notrans.h"
+#include "halide_strsm_upper_trans.h"
+#include "halide_dtrsm_lower_notrans.h"
+#include "halide_dtrsm_lower_trans.h"
+#include "halide_dtrsm_upper_notrans.h"
+#include "halide_dtrsm_upper_trans.h"
 
 inline int halide_scopy(halide_buffer_t *x, halide_buffer_t *y) {
     return halide_scopy_impl(0, x, nullptr, y);
@@ -103,6 +115,46 @@ inline int halide_dgemm(bool transA, bool transB, double a, halide_buffer_t *A,
     return -1;
 }
 
+inline int halide_ssyrk(bool trans, bool upper, float a, halide_buffer_t *A, float b, halide_buffer_t *C) {
+    if (trans) {
+        return halide_ssyrk_trans(upper, a, A, b, C, C);
+    } else {
+        return halide_ssyrk_notrans(upper, a, A, b, C, C);
+    }
+}
+
+inline int halide_dsyrk(bool trans, bool upper, double a, halide_buffer_t *A, double b, halide_buffer_t *C) {
+    if (trans) {
+        return halide_dsyrk_trans(upper, a, A, b, C, C);
+    } else {
+        return halide_dsyrk_notrans(upper, a, A, b, C, C);
+    }
+}
+
+inline int halide_strsm(bool lower, bool transA, bool unit, float a, halide_buffer_t *A, halide_buffer_t *B) {
+    if (lower && transA) {
+        return halide_strsm_lower_trans(unit, a, A, B, B);
+    } else if (lower) {
+        return halide_strsm_lower_notrans(unit, a, A, B, B);
+    } else if (transA) {
+        return halide_strsm_upper_trans(unit, a, A, B, B);
+    } else {
+        return halide_strsm_upper_notrans(unit, a, A, B, B);
+    }
+}
+
+inline int halide_dtrsm(bool lower, bool transA, bool unit, double a, halide_buffer_t *A, halide_buffer_t *B) {
+    if (lower && transA) {
+        return halide_dtrsm_lower_trans(unit, a, A, B, B);
+    } else if (lower) {
+        return halide_dtrsm_lower_notrans(unit, a, A, B, B);
+    } else if (transA) {
+        return halide_dtrsm_upper_trans(unit, a, A, B, B);
+    } else {
+        return halide_dtrsm_upper_notrans(unit, a, A, B, B);
+    }
+}
+
 enum HBLAS_ORDER {HblasRowMajor=101, HblasColMajor=102};
 enum HBLAS_TRANSPOSE {HblasNoTrans=111, HblasTrans=112, HblasConjTrans=113};
 enum HBLAS_UPLO {HblasUpper=121, HblasLower=122};
@@ -244,6 +296,28 @@ void hblas_dgemm(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE TransA
                  const int lda, const double *B, const int ldb,
                  const double beta, double *C, const int ldc);
 
+void hblas_ssyrk(const enum HBLAS_ORDER Order, const enum HBLAS_UPLO Uplo,
+                 const enum HBLAS_TRANSPOSE Trans, const int N, const int K,
+                 const float alpha, const float *A, const int lda,
+                 const float beta, float *C, const int ldc);
+
+void hblas_dsyrk(const enum HBLAS_ORDER Order, const enum HBLAS_UPLO Uplo,
+                 const enum HBLAS_TRANSPOSE Trans, const int N, const int K,
+                 const double alpha, const double *A, const int lda,
+                 const double beta, double *C, const int ldc);
+
+void hblas_strsm(const enum HBLAS_ORDER Order, const enum HBLAS_SIDE Side,
+                 const enum HBLAS_UPLO Uplo, const enum HBLAS_TRANSPOSE TransA,
+                 const enum HBLAS_DIAG Diag, const int M, const int N,
+                 const float alpha, const float *A, const int lda,
+                 float *B, const int ldb);
+
+void hblas_dtrsm(const enum HBLAS_ORDER Order, const enum HBLAS_SIDE Side,
+                 const enum HBLAS_UPLO Uplo, const enum HBLAS_TRANSPOSE TransA,
+                 const enum HBLAS_DIAG Diag, const int M, const int N,
+                 const double alpha, const double *A, const int lda,
+                 double *B, const int ldb);
+
 #ifdef __cplusplus
 }
 #endif
@@ -111,6 +111,35 @@
         return compareMatrices(N, eC, aC);      \
     }
 
+// Solves with a random triangular matrix are badly conditioned, so
+// make A diagonally dominant, and allow for the error of a solve
+// growing with N.
+#define L3_TRSM_TEST(method, cblas_code, hblas_code)                    \
+    bool test_##method(int N) {                                         \
+        Scalar alpha = random_scalar();                                 \
+        Matrix eA(random_matrix(N));                                    \
+        Matrix eB(random_matrix(N));                                    \
+        for (int i = 0; i < N; ++i) {                                   \
+            eA[i * N + i] += N;                                         \
+        }                                                               \
+        Matrix aA(eA), aB(eB);                                          \
+                                                                        \
+        {                                                               \
+            Scalar *A = &(eA[0]);                                       \
+            Scalar *B = &(eB[0]);                                       \
+            cblas_code;                                                 \
+        }                                                               \
+                                                                        \
+        {                                                               \
+            Scalar *A = &(aA[0]);                                       \
+            Scalar *B = &(aB[0]);                                       \
+            hblas_code;                                                 \
+        }                                                               \
+                                                                        \
+        return compareMatrices(N, eB, aB,                               \
+                               N * std::numeric_limits<Scalar>::epsilon()); \
+    }
+
 
 template<class T>
 struct BLASTestBase {
@@ -210,6 +239,13 @@ struct BLASFloatTests : public BLASTestBase<float> {
         RUN_TEST(sgemm_transA);
         RUN_TEST(sgemm_transB);
         RUN_TEST(sgemm_transAB);
+        RUN_TEST(ssyrk_notrans);
+        RUN_TEST(ssyrk_trans);
+        RUN_TEST(strsm_lower_notrans);
+        RUN_TEST(strsm_lower_trans);
+        RUN_TEST(strsm_upper_notrans);
+        RUN_TEST(strsm_upper_trans);
+        RUN_TEST(strsm_right);
     }
 
     L1_VECTOR_TEST(scopy, scopy(N, x, 1, y, 1))
@@ -241,6 +277,27 @@ struct BLASFloatTests : public BLASTestBase<float> {
     L3_TEST(sgemm_transAB,
             cblas_sgemm(CblasColMajor, CblasTrans, CblasTrans, N, N, N, alpha, A, N, B, N, beta, C, N),
             hblas_sgemm(HblasColMajor, HblasTrans, HblasTrans, N, N, N, alpha, A, N, B, N, beta, C, N));
+    L3_TEST(ssyrk_notrans,
+            cblas_ssyrk(CblasColMajor, CblasUpper, CblasNoTrans, N, N, alpha, A, N, beta, C, N),
+            hblas_ssyrk(HblasColMajor, HblasUpper, HblasNoTrans, N, N, alpha, A, N, beta, C, N));
+    L3_TEST(ssyrk_trans,
+            cblas_ssyrk(CblasColMajor, CblasLower, CblasTrans, N, N, alpha, A, N, beta, C, N),
+            hblas_ssyrk(HblasColMajor, HblasLower, HblasTrans, N, N, alpha, A, N, beta, C, N));
+    L3_TRSM_TEST(strsm_lower_notrans,
+                 cblas_strsm(CblasColMajor, CblasLeft, CblasLower, CblasNoTrans, CblasNonUnit, N, N, alpha, A, N, B, N),
+                 hblas_strsm(HblasColMajor, HblasLeft, HblasLower, HblasNoTrans, HblasNonUnit, N, N, alpha, A, N, B, N));
+    L3_TRSM_TEST(strsm_lower_trans,
+                 cblas_strsm(CblasColMajor, CblasLeft, CblasLower, CblasTrans, CblasNonUnit, N, N, alpha, A, N, B, N),
+                 hblas_strsm(HblasColMajor, HblasLeft, HblasLower, HblasTrans, HblasNonUnit, N, N, alpha, A, N, B, N));
+    L3_TRSM_TEST(strsm_upper_notrans,
+                 cblas_strsm(CblasColMajor, CblasLeft, CblasUpper, CblasNoTrans, CblasNonUnit, N, N, alpha, A, N, B, N),
+                 hblas_strsm(HblasColMajor, HblasLeft, HblasUpper, HblasNoTrans, HblasNonUnit, N, N, alpha, A, N, B, N));
+    L3_TRSM_TEST(strsm_upper_trans,
+                 cblas_strsm(CblasColMajor, CblasLeft, CblasUpper, CblasTrans, CblasNonUnit, N, N, alpha, A, N, B, N),
+                 hblas_strsm(HblasColMajor, HblasLeft, HblasUpper, HblasTrans, HblasNonUnit, N, N, alpha, A, N, B, N));
+    L3_TRSM_TEST(strsm_right,
+                 cblas_strsm(CblasColMajor, CblasRight, CblasLower, CblasNoTrans, CblasUnit, N, N, alpha, A, N, B, N),
+                 hblas_strsm(HblasColMajor, HblasRight, HblasLower, HblasNoTrans, HblasUnit, N, N, alpha, A, N, B, N));
 };
 
 struct BLASDoubleTests : public BLASTestBase<double> {
@@ -257,6 +314,13 @@ struct BLASDoubleTests : public BLASTestBase<double> {
         RUN_TEST(dgemm_transA);
         RUN_TEST(dgemm_transB);
         RUN_TEST(dgemm_transAB);
+        RUN_TEST(dsyrk_notrans);
+        RUN_TEST(dsyrk_trans);
+        RUN_TEST(dtrsm_lower_notrans);
+        RUN_TEST(dtrsm_lower_trans);
+        RUN_TEST(dtrsm_upper_notrans);
+        RUN_TEST(dtrsm_upper_trans);
+        RUN_TEST(dtrsm_right);
     }
 
     L1_VECTOR_TEST(dcopy, dcopy(N, x, 1, y, 1))
@@ -288,6 +352,27 @@ struct BLASDoubleTests : public BLASTestBase<double> {
     L3_TEST(dgemm_transAB,
             cblas_dgemm(CblasColMajor, CblasTrans, CblasTrans, N, N, N, alpha, A, N, B, N, beta, C, N),
             hblas_dgemm(HblasColMajor, HblasTrans, HblasTrans, N, N, N, alpha, A, N, B, N, beta, C, N));
+    L3_TEST(dsyrk_notrans,
+            cblas_dsyrk(CblasColMajor, CblasUpper, CblasNoTrans, N, N, alpha, A, N, beta, C, N),
+            hblas_dsyrk(HblasColMajor, HblasUpper, HblasNoTrans, N, N, alpha, A, N, beta, C, N));
+    L3_TEST(dsyrk_trans,
+            cblas_dsyrk(CblasColMajor, CblasLower, CblasTrans, N, N, alpha, A, N, beta, C, N),
+            hblas_dsyrk(HblasColMajor, HblasLower, HblasTrans, N, N, alpha, A, N, beta, C, N));
+    L3_TRSM_TEST(dtrsm_lower_notrans,
+                 cblas_dtrsm(CblasColMajor, CblasLeft, CblasLower, CblasNoTrans, CblasNonUnit, N, N, alpha, A, N, B, N),
+                 hblas_dtrsm(HblasColMajor, HblasLeft, HblasLower, HblasNoTrans, HblasNonUnit, N, N, alpha, A, N, B, N));
+    L3_TRSM_TEST(dtrsm_lower_trans,
+                 cblas_dtrsm(CblasColMajor, CblasLeft, CblasLower, CblasTrans, CblasNonUnit, N, N, alpha, A, N, B, N),
+                 hblas_dtrsm(HblasColMajor, HblasLeft, HblasLower, HblasTrans, HblasNonUnit, N, N, alpha, A, N, B, N));
+    L3_TRSM_TEST(dtrsm_upper_notrans,
+                 cblas_dtrsm(CblasColMajor, CblasLeft, CblasUpper, CblasNoTrans, CblasNonUnit, N, N, alpha, A, N, B, N),
+                 hblas_dtrsm(HblasColMajor, HblasLeft, HblasUpper, HblasNoTrans, HblasNonUnit, N, N, alpha, A, N, B, N));
+    L3_TRSM_TEST(dtrsm_upper_trans,
+                 cblas_dtrsm(CblasColMajor, CblasLeft, CblasUpper, CblasTrans, CblasNonUnit, N, N, alpha, A, N, B, N),
+                 hblas_dtrsm(HblasColMajor, HblasLeft, HblasUpper, HblasTrans, HblasNonUnit, N, N, alpha, A, N, B, N));
+    L3_TRSM_TEST(dtrsm_right,
+                 cblas_dtrsm(CblasColMajor, CblasRight, CblasLower, CblasNoTrans, CblasUnit, N, N, alpha, A, N, B, N),
+                 hblas_dtrsm(HblasColMajor, HblasRight, HblasLower, HblasNoTrans, HblasUnit, N, N, alpha, A, N, B, N));
 };
 
 int main(int argc, char *argv[]) {
@@ -37,33 +37,24 @@ public:
         gray(x, y) = 0.299f * floating(x, y, 0) + 0.587f * floating(x, y, 1) + 0.114f * floating(x, y, 2);
 
         // Make the processed Gaussian pyramid.
-        Func gPyramid[maxJ];
+        Func processed;
         // Do a lookup into a lut with 256 entires per intensity level
         Expr level = k * (1.0f / (levels - 1));
         Expr idx = gray(x, y)*cast<float>(levels-1)*256.0f;
         idx = clamp(cast<int>(idx), 0, (levels-1)*256);
-        gPyramid[0](x, y, k) = beta*(gray(x, y) - level) + level + remap(idx - 256*k);
-        for (int j = 1; j < J; j++) {
-            gPyramid[j](x, y, k) = downsample(gPyramid[j-1])(x, y, k);
-        }
+        processed(x, y, k) = beta*(gray(x, y) - level) + level + remap(idx - 256*k);
+        std::vector<Func> gPyramid = Halide::Pyramid::gaussian(processed, J);
 
         // Get its laplacian pyramid
-        Func lPyramid[maxJ];
-        lPyramid[J-1](x, y, k) = gPyramid[J-1](x, y, k);
-        for (int j = J-2; j >= 0; j--) {
-            lPyramid[j](x, y, k) = gPyramid[j](x, y, k) - upsample(gPyramid[j+1])(x, y, k);
-        }
+        std::vector<Func> lPyramid = Halide::Pyramid::laplacian(gPyramid);
 
         // Make the Gaussian pyramid of the input
-        Func inGPyramid[maxJ];
-        inGPyramid[0](x, y) = gray(x, y);
-        for (int j = 1; j < J; j++) {
-            inGPyramid[j](x, y) = downsample(inGPyramid[j-1])(x, y);
-        }
+        std::vector<Func> inGPyramid = Halide::Pyramid::gaussian(gray, J);
 
         // Make the laplacian pyramid of the output
-        Func outLPyramid[maxJ];
+        std::vector<Func> outLPyramid(J);
         for (int j = 0; j < J; j++) {
+            outLPyramid[j] = Func("outLPyramid_" + std::to_string(j));
             // Split input pyramid value into integer and floating parts
             Expr level = inGPyramid[j](x, y) * cast<float>(levels-1);
             Expr li = clamp(cast<int>(level), 0, levels-2);
@@ -73,11 +64,7 @@ public:
         }
 
         // Make the Gaussian pyramid of the output
-        Func outGPyramid[maxJ];
-        outGPyramid[J-1](x, y) = outLPyramid[J-1](x, y);
-        for (int j = J-2; j >= 0; j--) {
-            outGPyramid[j](x, y) = upsample(outGPyramid[j+1])(x, y) + outLPyramid[j](x, y);
-        }
+        std::vector<Func> outGPyramid = Halide::Pyramid::collapse(outLPyramid);
 
         // Reintroduce color (Connelly: use eps to avoid scaling up noise w/ apollo3.png input)
         Func color;
@@ -125,22 +112,22 @@ public:
             Var yo;
             output.reorder(c, x, y).split(y, yo, y, 64).parallel(yo).vectorize(x, 8);
             gray.compute_root().parallel(y, 32).vectorize(x, 8);
-            for (int j = 1; j < 5; j++) {
-                inGPyramid[j]
-                    .compute_root().parallel(y, 32).vectorize(x, 8);
+            // The finer levels are parallel over rows, and the coarser
+            // ones, which have little work, are serial.
+            Halide::Pyramid::schedule_root(inGPyramid, 1, J, 8, 4, 32);
+            for (int j = 1; j < std::min(5, J); j++) {
                 gPyramid[j]
                     .compute_root().reorder_storage(x, k, y)
                     .reorder(k, y).parallel(y, 8).vectorize(x, 8);
-                outGPyramid[j]
-                    .store_at(output, yo).compute_at(output, y).fold_storage(y, 8)
-                    .vectorize(x, 8);
             }
-            outGPyramid[0].compute_at(output, y).vectorize(x, 8);
             for (int j = 5; j < J; j++) {
-                inGPyramid[j].compute_root();
                 gPyramid[j].compute_root().parallel(k);
-                outGPyramid[j].compute_root();
             }
+            // The finer levels of the output pyramid are computed a few
+            // rows at a time as the output strips need them.
+            Halide::Pyramid::schedule_at(outGPyramid, 0, 1, LoopLevel(output, y), LoopLevel(output, y), 8);
+            Halide::Pyramid::schedule_at(outGPyramid, 1, 5, LoopLevel(output, yo), LoopLevel(output, y), 8, 8);
+            Halide::Pyramid::schedule_root(outGPyramid, 5, J, 8, 0);
         }
 
         /* Optional tags to specify layout for HalideTraceViz */
@@ -207,26 +194,6 @@ public:
     }
 private:
     Var x, y, c, k;
-
-    // Downsample with a 1 3 3 1 filter
-    Func downsample(Func f) {
-        using Halide::_;
-        Func downx, downy;
-        downx(x, y, _) = (f(2*x-1, y, _) + 3.0f * (f(2*x, y, _) + f(2*x+1, y, _)) + f(2*x+2, y, _)) / 8.0f;
-        downy(x, y, _) = (downx(x, 2*y-1, _) + 3.0f * (downx(x, 2*y, _) + downx(x, 2*y+1, _)) + downx(x, 2*y+2, _)) / 8.0f;
-        return downy;
-    }
-
-    // Upsample using bilinear interpolation
-    Func upsample(Func f) {
-        using Halide::_;
-        Func upx, upy;
-        upx(x, y, _) = 0.25f * f((x/2) - 1 + 2*(x % 2), y, _) + 0.75f * f(x/2, y, _);
-        upy(x, y, _) = 0.25f * upx(x, (y/2) - 1 + 2*(y % 2), _) + 0.75f * upx(x, y/2, _);
-        return upy;
-    }
-
-
 };
 
 }  // namespace
@@ -0,0 +1,10 @@
+CONVOLUTION_POOL=$1
+# Columns are: schedule C W H N filter_width, filter_height, output_depth,
+# input_offset, filter_offset, stride, pad_width, pad_height, output_offset,
+# output_min, output_max, pool_stride, pool_width, pool_height
+
+$CONVOLUTION_POOL 8 17 17 1 3 3 8 -128 -128 1 1 1 128 0 255 2 2 2
+$CONVOLUTION_POOL 8 17 17 1 3 3 16 -128 -140 1 1 1 128 0 255 2 3 3
+$CONVOLUTION_POOL 12 17 17 1 3 3 16 -128 -128 2 1 1 128 128 255 1 2 2
+$CONVOLUTION_POOL 8 16 16 1 5 5 32 -128 -128 1 2 2 128 128 255 2 2 2
+$CONVOLUTION_POOL 32 32 32 1 3 3 64 -128 -128 1 1 1 128 128 255 2 2 2
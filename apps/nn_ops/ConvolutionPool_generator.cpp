@@ -0,0 +1,145 @@
+// This generator implements a convolution followed by a max pool. The
+// rows of the 8-bit convolution result are computed as each row of the
+// pool needs them, so the convolution result never goes to memory.
+//
+// The pipeline implements the following operations:
+// (1) a convolution with offsets, bias, per-channel quantization and
+//     activation, as in FusedConvolution
+// (2) the local maximum of the 8-bit result of (1) over windows of
+//     pool_width x pool_height, sampled at every pool_stride in x and
+//     y. The pool is not padded, so the caller should make the output
+//     [width, height] (convolution [width, height] - pool [width, height]) /
+//     pool_stride + 1
+
+#include "common.h"
+#include <Halide.h>
+
+using Halide::Expr;
+using Halide::Func;
+using Halide::Generator;
+using Halide::RDom;
+using Halide::Var;
+using Halide::BoundaryConditions::constant_exterior;
+using Halide::ConciseCasts::u8_sat;
+
+class ConvolutionPool : public Generator<ConvolutionPool> {
+public:
+    // Unsigned 8-bit input tensor, indexed by input_depth, input_x, input_y,
+    // input_batch.
+    Input<Buffer<uint8_t>> input_{"input", 4};
+
+    // A 4D array of 8-bit filter coefficients indexed by filter_depth, filter_x,
+    // filter_y, filter_batch (aka. output_depth).
+    Input<Buffer<uint8_t>> filter_{"filter", 4};
+
+    // A 1D array of 32-bit biases, indexed by output depth.
+    Input<Buffer<int32_t>> bias_{"bias", 1};
+
+    // Offsets for the input and filter.
+    Input<int16_t> input_offset_{ "input_offset", 0, -255, 0 };
+    Input<int16_t> filter_offset_{ "filter_offset", 0, -255, 0 };
+
+    // The stride and padding of the convolution.
+    Input<int> stride_{ "stride" };
+    Input<int> pad_width_{ "pad_width" };
+    Input<int> pad_height_{ "pad_height" };
+
+    // Parameters for pointwise operations on the convolution. The
+    // multiplier and shift are 1D arrays indexed by output depth.
+    Input<Buffer<int32_t>> output_multiplier_{ "output_multiplier", 1 };
+    Input<Buffer<int32_t>> output_shift_{ "output_shift", 1 };
+    Input<int> output_offset_{ "output_offset", 0, 0, 255 };
+    Input<uint8_t> output_min_{ "output_min" };
+    Input<uint8_t> output_max_{ "output_max" };
+
+    // The max pool.
+    Input<int> pool_stride_{ "pool_stride" };
+    Input<int> pool_width_{ "pool_width" };
+    Input<int> pool_height_{ "pool_height" };
+
+    Output<Buffer<uint8_t>> output_{"output", 4};
+
+    void generate() {
+        // The algorithm.
+
+        // Some free variables, where x and y represent the spatial dimensions.
+        Var x("x"), y("y"), depth("depth"), batch("batch");
+
+        // Pad x and y with the value that produces zero after the input offset is
+        // added. The input offset is bounded to the range of a uint8, so this is
+        // safe.
+        Func input_bounded =
+            constant_exterior(input_, cast<uint8_t>(-input_offset_),
+                              { { Expr(), Expr() },
+                                { 0, input_.dim(1).extent() },
+                                { 0, input_.dim(2).extent() },
+                                { Expr(), Expr() } });
+
+        // Shift the input spatially in [x, y] by -[pad_width, pad_height].
+        Func shifted_input("shifted_input");
+        shifted_input(depth, x, y, batch) =
+            input_bounded(depth, x - pad_width_, y - pad_height_, batch);
+
+        QuantizedConvolution convolved(shifted_input, filter_, input_.dim(0).extent(),
+                                       filter_.dim(1).extent(), filter_.dim(2).extent(),
+                                       stride_, input_offset_, filter_offset_);
+
+        Func convolution("convolution");
+        convolution(depth, x, y, batch) =
+            clamp(u8_sat(multiply_quantized_multiplier(
+                             convolved.result()(depth, x, y, batch) + bias_(depth),
+                             output_multiplier_(depth), output_shift_(depth)) +
+                         output_offset_),
+                  output_min_, output_max_);
+
+        // The local maximum of the convolution.
+        RDom pool_dom(0, pool_width_, 0, pool_height_);
+        output_(depth, x, y, batch) =
+            maximum(convolution(depth, x * pool_stride_ + pool_dom.x,
+                                y * pool_stride_ + pool_dom.y, batch));
+
+        // The schedule.
+        const bool use_hexagon =
+            get_target().features_any_of({ Target::HVX_64, Target::HVX_128 });
+
+        // Specifying .hexagon() on a Func will generate an RPC to run this stage
+        // on Hexagon. If Hexagon is the host (that is, the architecture is
+        // Hexagon), we have to omit the .hexagon() directive as we are already
+        // running on Hexagon.
+        if (use_hexagon && get_target().arch != Target::Hexagon) {
+            output_.hexagon();
+        }
+
+        int vector_size_u8 = get_target().natural_vector_size<uint8_t>();
+        if (get_target().has_feature(Target::HVX_64)) {
+            vector_size_u8 = 64;
+        } else if (get_target().has_feature(Target::HVX_128)) {
+            vector_size_u8 = 128;
+        }
+
+        // We only perform vectorization when the depth >= vector size.
+        Expr can_vectorize_across_depth = output_.dim(0).extent() >= vector_size_u8;
+        output_.compute_root().parallel(y)
+            .specialize(can_vectorize_across_depth)
+            .vectorize(depth, vector_size_u8);
+
+        // Compute the rows of the convolution each row of the pool needs,
+        // scheduled as FusedConvolution.
+        constexpr int kColumns = 4;
+        Expr can_vectorize = can_vectorize_across_depth &&
+                             output_.dim(1).extent() >= kColumns;
+
+        Var xo("xo"), xi("xi");
+        convolution.compute_at(output_, y);
+        convolution.specialize(can_vectorize)
+            .split(x, xo, xi, kColumns)
+            .reorder(depth, xi, xo, y, batch)
+            .vectorize(depth, vector_size_u8);
+        convolution.split(x, xo, xi, kColumns, TailStrategy::GuardWithIf)
+            .reorder(depth, xi, xo, y, batch);
+
+        convolved.schedule(convolution, y, xo, kColumns, vector_size_u8, can_vectorize);
+    }
+};
+
+HALIDE_REGISTER_GENERATOR(ConvolutionPool, ConvolutionPool)
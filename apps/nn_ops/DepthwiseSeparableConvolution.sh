@@ -0,0 +1,15 @@
+DW_SEPARABLE_CONVOLUTION=$1
+# Columns are: schedule C W H N filter_width, filter_height, output_depth,
+# input_offset, depthwise_filter_offset, pointwise_filter_offset, stride,
+# pad_width, pad_height, depthwise_offset, output_offset, output_min,
+# output_max
+
+$DW_SEPARABLE_CONVOLUTION 8 17 17 1 3 3 8 -128 -128 -128 1 1 1 128 128 0 255
+$DW_SEPARABLE_CONVOLUTION 8 17 17 1 3 3 16 -128 -128 -128 2 1 1 128 128 0 255
+$DW_SEPARABLE_CONVOLUTION 8 17 17 1 5 5 16 -128 -140 -120 1 2 2 100 128 0 255
+$DW_SEPARABLE_CONVOLUTION 12 17 17 1 3 3 16 -128 -128 -128 1 1 1 128 128 128 255
+
+# MobileNet v1 layers.
+$DW_SEPARABLE_CONVOLUTION 32 112 112 1 3 3 64 -128 -128 -128 1 1 1 128 128 128 255
+$DW_SEPARABLE_CONVOLUTION 128 56 56 1 3 3 128 -128 -128 -128 1 1 1 128 128 128 255
+$DW_SEPARABLE_CONVOLUTION 256 28 28 1 3 3 256 -128 -128 -128 2 1 1 128 128 128 255
@@ -0,0 +1,177 @@
+// This generator implements a depthwise convolution followed by a
+// pointwise (1x1) convolution, the building block of MobileNet. The
+// 8-bit output of the depthwise convolution is computed a row at a time
+// as it is needed by the pointwise convolution, so it never goes to
+// memory.
+//
+// The pipeline implements the following operations:
+// (1) a depthwise convolution of the input with offsets, bias,
+//     per-channel quantization and activation, as in DepthwiseConvolution,
+//     with a depth multiplier of 1
+// (2) the 8-bit result of (1) is the input of a pointwise convolution,
+//     with the offset that makes its output offset zero
+// (3) the pointwise convolution result has a bias added, is quantized
+//     per-channel and offset, and is clamped to [output_min, output_max]
+//     and narrowed to 8-bit
+
+#include "common.h"
+#include <Halide.h>
+
+using Halide::Expr;
+using Halide::Func;
+using Halide::Generator;
+using Halide::RDom;
+using Halide::Var;
+using Halide::BoundaryConditions::constant_exterior;
+using Halide::ConciseCasts::u8_sat;
+
+class DepthwiseSeparableConvolution : public Generator<DepthwiseSeparableConvolution> {
+public:
+    // Unsigned 8-bit input tensor, indexed by depth, x, y, batch.
+    Input<Buffer<uint8_t>> input_{"input", 4};
+
+    // The depthwise convolution: a 3D array of 8-bit filter coefficients
+    // indexed by depth, x, y, and 1D arrays of biases, multipliers and
+    // shifts indexed by depth.
+    Input<Buffer<uint8_t>> depthwise_filter_{"depthwise_filter", 3};
+    Input<Buffer<int32_t>> depthwise_bias_{"depthwise_bias", 1};
+    Input<int16_t> input_offset_{ "input_offset", 0, -255, 0 };
+    Input<int16_t> depthwise_filter_offset_{ "depthwise_filter_offset", 0, -255, 0 };
+    Input<Buffer<int32_t>> depthwise_multiplier_{ "depthwise_multiplier", 1 };
+    Input<Buffer<int32_t>> depthwise_shift_{ "depthwise_shift", 1 };
+    Input<int> depthwise_offset_{ "depthwise_offset", 0, 0, 255 };
+    Input<uint8_t> depthwise_min_{ "depthwise_min" };
+    Input<uint8_t> depthwise_max_{ "depthwise_max" };
+
+    // The stride and padding of the depthwise convolution. The pointwise
+    // convolution has a stride of 1 and no padding.
+    Input<int> stride_{ "stride", 1, 1, 2 };
+    Input<int> pad_width_{ "pad_width" };
+    Input<int> pad_height_{ "pad_height" };
+
+    // The pointwise convolution: a 2D array of 8-bit filter coefficients
+    // indexed by input depth, output depth, and 1D arrays of biases,
+    // multipliers and shifts indexed by output depth.
+    Input<Buffer<uint8_t>> pointwise_filter_{"pointwise_filter", 2};
+    Input<Buffer<int32_t>> pointwise_bias_{"pointwise_bias", 1};
+    Input<int16_t> pointwise_filter_offset_{ "pointwise_filter_offset", 0, -255, 0 };
+    Input<Buffer<int32_t>> output_multiplier_{ "output_multiplier", 1 };
+    Input<Buffer<int32_t>> output_shift_{ "output_shift", 1 };
+    Input<int> output_offset_{ "output_offset", 0, 0, 255 };
+    Input<uint8_t> output_min_{ "output_min" };
+    Input<uint8_t> output_max_{ "output_max" };
+
+    Output<Buffer<uint8_t>> output_{"output", 4};
+
+    void generate() {
+        // The algorithm.
+
+        // Some free variables, where x and y represent the spatial dimensions.
+        Var x("x"), y("y"), depth("depth"), batch("batch");
+
+        // Pad x and y with the value that produces zero after the input offset is
+        // added. The input offset is bounded to the range of a uint8, so this is
+        // safe.
+        Func input_bounded =
+            constant_exterior(input_, cast<uint8_t>(-input_offset_),
+                              { { Expr(), Expr() },
+                                { 0, input_.dim(1).extent() },
+                                { 0, input_.dim(2).extent() },
+                                { Expr(), Expr() } });
+
+        Func input_with_offset("input_with_offset");
+        input_with_offset(depth, x, y, batch) =
+            cast<int16_t>(input_bounded(depth, x - pad_width_, y - pad_height_, batch)) +
+            input_offset_;
+
+        Func depthwise_filter_with_offset("depthwise_filter_with_offset");
+        depthwise_filter_with_offset(depth, x, y) =
+            cast<int16_t>(depthwise_filter_(depth, x, y)) + depthwise_filter_offset_;
+
+        Func depthwise_convolved("depthwise_convolved");
+        RDom filter_dom(0, depthwise_filter_.dim(1).extent(), 0, depthwise_filter_.dim(2).extent());
+        depthwise_convolved(depth, x, y, batch) +=
+            cast<int32_t>(depthwise_filter_with_offset(depth, filter_dom.x, filter_dom.y)) *
+            cast<int32_t>(input_with_offset(depth, x * stride_ + filter_dom.x,
+                                            y * stride_ + filter_dom.y, batch));
+
+        Func depthwise("depthwise");
+        depthwise(depth, x, y, batch) =
+            clamp(u8_sat(multiply_quantized_multiplier(
+                             depthwise_convolved(depth, x, y, batch) + depthwise_bias_(depth),
+                             depthwise_multiplier_(depth), depthwise_shift_(depth)) +
+                         depthwise_offset_),
+                  depthwise_min_, depthwise_max_);
+
+        // The pointwise convolution of the depthwise result, which is
+        // zero after subtracting the depthwise output offset.
+        Func pointwise_filter("pointwise_filter");
+        pointwise_filter(depth, x, y, batch) = pointwise_filter_(depth, batch);
+
+        QuantizedConvolution pointwise(depthwise, pointwise_filter, input_.dim(0).extent(),
+                                       1, 1, 1, -depthwise_offset_, pointwise_filter_offset_);
+
+        Func scaled_plus_offset("scaled_plus_offset");
+        scaled_plus_offset(depth, x, y, batch) =
+            multiply_quantized_multiplier(
+                pointwise.result()(depth, x, y, batch) + pointwise_bias_(depth),
+                output_multiplier_(depth), output_shift_(depth)) +
+            output_offset_;
+
+        // Saturate and narrow the output.
+        output_(depth, x, y, batch) =
+            clamp(u8_sat(scaled_plus_offset(depth, x, y, batch)),
+                  output_min_, output_max_);
+
+        // The schedule.
+        const bool use_hexagon =
+            get_target().features_any_of({ Target::HVX_64, Target::HVX_128 });
+
+        // Specifying .hexagon() on a Func will generate an RPC to run this stage
+        // on Hexagon. If Hexagon is the host (that is, the architecture is
+        // Hexagon), we have to omit the .hexagon() directive as we are already
+        // running on Hexagon.
+        if (use_hexagon && get_target().arch != Target::Hexagon) {
+            output_.hexagon();
+        }
+
+        int vector_size_u8 = get_target().natural_vector_size<uint8_t>();
+        if (get_target().has_feature(Target::HVX_64)) {
+            vector_size_u8 = 64;
+        } else if (get_target().has_feature(Target::HVX_128)) {
+            vector_size_u8 = 128;
+        }
+
+        // The pointwise convolution is scheduled as FusedConvolution.
+        constexpr int kColumns = 4;
+        Expr can_vectorize =
+            output_.dim(0).extent() >= vector_size_u8 &&
+            output_.dim(1).extent() >= kColumns;
+
+        Var xo("xo"), xi("xi");
+        output_.compute_root().parallel(y);
+        output_.specialize(can_vectorize)
+            .split(x, xo, xi, kColumns)
+            .reorder(depth, xi, xo, y, batch)
+            .vectorize(depth, vector_size_u8);
+        output_.split(x, xo, xi, kColumns, TailStrategy::GuardWithIf)
+            .reorder(depth, xi, xo, y, batch);
+
+        pointwise.schedule(output_, y, xo, kColumns, vector_size_u8, can_vectorize);
+
+        // Compute each row of the depthwise convolution as the pointwise
+        // convolution needs it, vectorized across depth.
+        Expr can_vectorize_depthwise = input_.dim(0).extent() >= vector_size_u8;
+        depthwise.compute_at(output_, y)
+            .specialize(can_vectorize_depthwise)
+            .vectorize(depth, vector_size_u8);
+        depthwise_convolved.compute_at(depthwise, x)
+            .specialize(can_vectorize_depthwise)
+            .vectorize(depth, vector_size_u8);
+        depthwise_convolved.update()
+            .specialize(can_vectorize_depthwise)
+            .vectorize(depth, vector_size_u8);
+    }
+};
+
+HALIDE_REGISTER_GENERATOR(DepthwiseSeparableConvolution, DepthwiseSeparableConvolution)
@@ -0,0 +1,18 @@
+FUSED_CONVOLUTION=$1
+# Columns are: schedule C W H N filter_width, filter_height, output_depth,
+# input_offset, filter_offset, stride, pad_width, pad_height, output_offset,
+# output_min, output_max
+
+$FUSED_CONVOLUTION 8 17 17 1 1 1 8 -128 -128 1 0 0 128 0 255
+$FUSED_CONVOLUTION 8 17 17 1 3 3 8 -128 -128 1 1 1 128 0 255
+$FUSED_CONVOLUTION 8 17 17 1 3 3 8 -128 -128 2 1 1 128 0 255
+$FUSED_CONVOLUTION 8 17 17 1 3 3 16 -128 -140 1 1 1 128 0 255
+$FUSED_CONVOLUTION 12 17 17 1 3 3 16 -128 -140 1 1 1 128 0 255
+
+# ReLU and ReLU6 activations.
+$FUSED_CONVOLUTION 32 17 17 1 3 3 64 -128 -128 1 1 1 128 128 255
+$FUSED_CONVOLUTION 32 17 17 1 3 3 64 -128 -128 2 1 1 128 128 224
+
+# MobileNet v1 pointwise layers.
+$FUSED_CONVOLUTION 64 56 56 1 1 1 128 -128 -128 1 0 0 128 0 255
+$FUSED_CONVOLUTION 256 14 14 1 1 1 256 -128 -128 1 0 0 128 0 255
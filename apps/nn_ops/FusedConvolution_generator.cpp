@@ -0,0 +1,146 @@
+// This generator implements a convolution fused with the operations that
+// usually follow it in a quantized network, so that the 32-bit result of
+// the convolution never goes to memory.
+//
+// The pipeline implements the following operations:
+// (1) an input offset is added to the 8-bit input
+// (2) a filter offset is added to the 8-bit filter
+// (3) perform convolution
+// (4) a bias is added for each output depth
+// (5) the result is multiplied by a multiplier and right-shifted, with a
+//     multiplier and shift for each output depth (per-channel quantization)
+// (6) an output offset is added to the quantized result
+// (7) the output is clamped to [output_min, output_max], which implements
+//     ReLU (output_min = output_offset) and ReLU6, and narrowed to 8-bit
+
+// The output dimension is a function of input dimension, filter dimension,
+// padding and stride.
+// Input dimension: {input_depth, input_width, input_height, input_batches}
+// Filter dimension: {filter_depth(=input_depth), filter_width, filter_height,
+// filter_batches}
+// Output dimension: {filter_batches, ceil((input_width + 2 * pad_width -
+// filter_width) / stride) + 1, ceil((input_height + 2 * pad_height -
+// filter_height) / stride) + 1, input_batches}
+
+#include "common.h"
+#include <Halide.h>
+
+using Halide::Generator;
+using Halide::Var;
+using Halide::BoundaryConditions::constant_exterior;
+using Halide::ConciseCasts::u8_sat;
+
+class FusedConvolution : public Generator<FusedConvolution> {
+public:
+    // Unsigned 8-bit input tensor, indexed by input_depth, input_x, input_y,
+    // input_batch.
+    Input<Buffer<uint8_t>> input_{"input", 4};
+
+    // A 4D array of 8-bit filter coefficients indexed by filter_depth, filter_x,
+    // filter_y, filter_batch (aka. output_depth).
+    Input<Buffer<uint8_t>> filter_{"filter", 4};
+
+    // A 1D array of 32-bit biases, indexed by output depth.
+    Input<Buffer<int32_t>> bias_{"bias", 1};
+
+    // Offsets for the input and filter.
+    Input<int16_t> input_offset_{ "input_offset", 0, -255, 0 };
+    Input<int16_t> filter_offset_{ "filter_offset", 0, -255, 0 };
+
+    // The stride specifies how the input [x, y] is sub-subsampled. For every
+    // spatial location [x, y] in the output buffer, the input buffer is sampled
+    // spatially at [x * stride, y * stride]. The caller is responsible for
+    // allocating the correct output memory. The input is padded with the value
+    // that is zero after the input offset is added.
+    Input<int> stride_{ "stride" };
+    Input<int> pad_width_{ "pad_width" };
+    Input<int> pad_height_{ "pad_height" };
+
+    // Parameters for pointwise operations on the output. The multiplier and
+    // shift are 1D arrays indexed by output depth.
+    Input<Buffer<int32_t>> output_multiplier_{ "output_multiplier", 1 };
+    Input<Buffer<int32_t>> output_shift_{ "output_shift", 1 };
+    Input<int> output_offset_{ "output_offset", 0, 0, 255 };
+    Input<uint8_t> output_min_{ "output_min" };
+    Input<uint8_t> output_max_{ "output_max" };
+
+    Output<Buffer<uint8_t>> output_{"output", 4};
+
+    void generate() {
+        // The algorithm.
+
+        // Some free variables, where x and y represent the spatial dimensions.
+        Var x("x"), y("y"), depth("depth"), batch("batch");
+
+        // Pad x and y with the value that produces zero after the input offset is
+        // added. The input offset is bounded to the range of a uint8, so this is
+        // safe.
+        Func input_bounded =
+            constant_exterior(input_, cast<uint8_t>(-input_offset_),
+                              { { Expr(), Expr() },
+                                { 0, input_.dim(1).extent() },
+                                { 0, input_.dim(2).extent() },
+                                { Expr(), Expr() } });
+
+        // Shift the input spatially in [x, y] by -[pad_width, pad_height].
+        Func shifted_input("shifted_input");
+        shifted_input(depth, x, y, batch) =
+            input_bounded(depth, x - pad_width_, y - pad_height_, batch);
+
+        QuantizedConvolution convolved(shifted_input, filter_, input_.dim(0).extent(),
+                                       filter_.dim(1).extent(), filter_.dim(2).extent(),
+                                       stride_, input_offset_, filter_offset_);
+
+        Func scaled_plus_offset("scaled_plus_offset");
+        scaled_plus_offset(depth, x, y, batch) =
+            multiply_quantized_multiplier(
+                convolved.result()(depth, x, y, batch) + bias_(depth),
+                output_multiplier_(depth), output_shift_(depth)) +
+            output_offset_;
+
+        // Saturate and narrow the output.
+        output_(depth, x, y, batch) =
+            clamp(u8_sat(scaled_plus_offset(depth, x, y, batch)),
+                  output_min_, output_max_);
+
+        // The schedule.
+        const bool use_hexagon =
+            get_target().features_any_of({ Target::HVX_64, Target::HVX_128 });
+
+        // Specifying .hexagon() on a Func will generate an RPC to run this stage
+        // on Hexagon. If Hexagon is the host (that is, the architecture is
+        // Hexagon), we have to omit the .hexagon() directive as we are already
+        // running on Hexagon.
+        if (use_hexagon && get_target().arch != Target::Hexagon) {
+            output_.hexagon();
+        }
+
+        int vector_size_u8 = get_target().natural_vector_size<uint8_t>();
+        if (get_target().has_feature(Target::HVX_64)) {
+            vector_size_u8 = 64;
+        } else if (get_target().has_feature(Target::HVX_128)) {
+            vector_size_u8 = 128;
+        }
+
+        // Each iteration of xo computes a vector of output depths for a few
+        // columns, with their 32-bit sums in registers. We only vectorize
+        // when the output is big enough for that.
+        constexpr int kColumns = 4;
+        Expr can_vectorize =
+            output_.dim(0).extent() >= vector_size_u8 &&
+            output_.dim(1).extent() >= kColumns;
+
+        Var xo("xo"), xi("xi");
+        output_.compute_root().parallel(y);
+        output_.specialize(can_vectorize)
+            .split(x, xo, xi, kColumns)
+            .reorder(depth, xi, xo, y, batch)
+            .vectorize(depth, vector_size_u8);
+        output_.split(x, xo, xi, kColumns, TailStrategy::GuardWithIf)
+            .reorder(depth, xi, xo, y, batch);
+
+        convolved.schedule(output_, y, xo, kColumns, vector_size_u8, can_vectorize);
+    }
+};
+
+HALIDE_REGISTER_GENERATOR(FusedConvolution, FusedConvolution)
@@ -24,3 +24,88 @@ Expr rounding_shift_right(Expr x, Expr shift) {
 Expr multiply_quantized_multiplier(Expr x, Expr q, Expr shift) {
     return rounding_shift_right(saturating_rounding_doubling_high_multiply(x, q), shift);
 }
+
+QuantizedConvolution::QuantizedConvolution(Func input, Func filter,
+                                           Expr input_depth, Expr filter_width,
+                                           Expr filter_height, Expr stride,
+                                           Expr input_offset, Expr filter_offset)
+    : depth_("depth"), x_("x"), y_("y"), batch_("batch"), k_("k"), r_("r"),
+      packed_filter_("packed_filter"), dot_("dot"), filter_sum_("filter_sum"),
+      input_depth_sum_("input_depth_sum"), input_sum_("input_sum"),
+      result_("quantized_convolution") {
+    Var depth = depth_, x = x_, y = y_, batch = batch_, k = k_, r = r_;
+    Var filter_x("filter_x"), filter_y("filter_y");
+
+    // Reorder the filter into groups of four input depths, with the
+    // output depth next, so the filter for a vector of output depths is
+    // dense. The last group is padded with zeros.
+    Expr c = r * 4 + k;
+    packed_filter_(k, depth, r, filter_x, filter_y) =
+        select(c < input_depth,
+               filter(min(c, input_depth - 1), filter_x, filter_y, depth),
+               cast(filter.value().type(), 0));
+
+    // The sum of the products of the raw 8-bit values, four input depths
+    // at a time.
+    filter_dom_ = RDom(0, (input_depth + 3) / 4, 0, filter_width, 0, filter_height);
+    Expr products;
+    for (int i = 0; i < 4; i++) {
+        Expr input_value =
+            input(min(filter_dom_.x * 4 + i, input_depth - 1),
+                  x * stride + filter_dom_.y, y * stride + filter_dom_.z, batch);
+        Expr filter_value =
+            packed_filter_(i, depth, filter_dom_.x, filter_dom_.y, filter_dom_.z);
+        Expr product = cast<int32_t>(input_value) * cast<int32_t>(filter_value);
+        products = products.defined() ? products + product : product;
+    }
+    dot_(depth, x, y, batch) += products;
+
+    // The terms for the offsets need the sums of the filter for each
+    // output depth, and of the input for each output location.
+    RDom filter_sum_dom(0, input_depth, 0, filter_width, 0, filter_height);
+    filter_sum_(depth) +=
+        cast<int32_t>(filter(filter_sum_dom.x, filter_sum_dom.y, filter_sum_dom.z, depth));
+
+    RDom depth_dom(0, input_depth);
+    input_depth_sum_(x, y, batch) += cast<int32_t>(input(depth_dom, x, y, batch));
+
+    RDom window_dom(0, filter_width, 0, filter_height);
+    input_sum_(x, y, batch) +=
+        input_depth_sum_(x * stride + window_dom.x, y * stride + window_dom.y, batch);
+
+    Expr input_offset_32 = cast<int32_t>(input_offset);
+    Expr filter_offset_32 = cast<int32_t>(filter_offset);
+    Expr taps = input_depth * filter_width * filter_height;
+    result_(depth, x, y, batch) =
+        dot_(depth, x, y, batch) +
+        filter_offset_32 * input_sum_(x, y, batch) +
+        input_offset_32 * filter_sum_(depth) +
+        taps * input_offset_32 * filter_offset_32;
+}
+
+void QuantizedConvolution::schedule(Func output, Var rows, Var cols,
+                                    int cols_extent, int vector_size,
+                                    Expr can_vectorize) {
+    // The filter terms don't depend on the input, and are small.
+    packed_filter_.compute_root();
+    filter_sum_.compute_root();
+
+    input_depth_sum_.compute_at(output, rows);
+    input_sum_.compute_at(output, rows);
+
+    // Accumulate vector_size output depths of cols_extent columns in
+    // registers, over the whole filter.
+    Var depth_outer("depth_outer"), depth_inner("depth_inner"), x_inner("x_inner");
+    dot_.compute_at(output, cols);
+    dot_.specialize(can_vectorize)
+        .vectorize(depth_, vector_size)
+        .unroll(x_, cols_extent);
+    dot_.update()
+        .specialize(can_vectorize)
+        .split(depth_, depth_outer, depth_inner, vector_size)
+        .split(x_, x_, x_inner, cols_extent)
+        .reorder(depth_inner, x_inner, filter_dom_.x, filter_dom_.y, filter_dom_.z,
+                 depth_outer, x_)
+        .vectorize(depth_inner)
+        .unroll(x_inner);
+}
@@ -16,4 +16,41 @@ Halide::Expr rounding_shift_right(Halide::Expr x, Halide::Expr shift);
 // Performs right shift and multiply by a multiplier.
 Halide::Expr multiply_quantized_multiplier(
     Halide::Expr x, Halide::Expr quantized_multiplier, Halide::Expr shift);
+
+// A convolution of 8-bit values with offsets,
+//   sum over c, filter_x, filter_y of
+//     (input(c, x * stride + filter_x, y * stride + filter_y, batch) + input_offset) *
+//     (filter(c, filter_x, filter_y, depth) + filter_offset)
+// where input is already bounded in x and y, and is defined for
+// 0 <= c < input_depth. The sum is expanded into a sum of products of the
+// raw 8-bit values plus terms for the offsets. The products are summed in
+// groups of four, which targets with widening dot product instructions
+// (sdot/udot on ARM, vpdpwssd on x86, vrmpy on Hexagon) compute in one
+// instruction.
+class QuantizedConvolution {
+public:
+    QuantizedConvolution(Halide::Func input, Halide::Func filter,
+                         Halide::Expr input_depth, Halide::Expr filter_width,
+                         Halide::Expr filter_height, Halide::Expr stride,
+                         Halide::Expr input_offset, Halide::Expr filter_offset);
+
+    // The 32-bit convolution, indexed by depth, x, y, batch.
+    Halide::Func result() const { return result_; }
+
+    // Compute the convolution at 'cols' of 'output', which has the same
+    // depth, x, y and batch as the result, with each iteration of 'cols'
+    // producing vector_size depths and 'cols_extent' columns, and the
+    // terms for the input offset at 'rows'. The vector_size products of
+    // 'cols_extent' columns are accumulated in registers.
+    void schedule(Halide::Func output, Halide::Var rows, Halide::Var cols,
+                  int cols_extent, int vector_size,
+                  Halide::Expr can_vectorize);
+
+private:
+    Halide::Var depth_, x_, y_, batch_, k_, r_;
+    Halide::RDom filter_dom_;
+    Halide::Func packed_filter_, dot_, filter_sum_, input_depth_sum_, input_sum_;
+    Halide::Func result_;
+};
+
 #endif
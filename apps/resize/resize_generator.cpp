@@ -66,6 +66,12 @@ public:
     // resample in x and in y).
     GeneratorParam<bool> upsample{"upsample", false};
 
+    // The weight tables only depend on the scale factor and
+    // the output size, so by default they are memoized: repeated calls
+    // at the same ratio (e.g. a stream of thumbnails) look them up in
+    // the runtime's cache instead of evaluating the kernel again.
+    GeneratorParam<bool> memoize_tables{"memoize_tables", true};
+
     Input<Buffer<>> input{"input", 3};
     Input<float> scale_factor{"scale_factor"};
     Output<Buffer<>> output{"output", 3};
@@ -103,7 +109,9 @@ public:
 
         // Initialize interpolation kernels. Since we allow an arbitrary
         // scaling factor, the filter coefficients are different for each x
-        // and y coordinate.
+        // and y coordinate. The normalized weights are tabulated once
+        // per call. The offset of the first tap is left inline, so that
+        // bounds inference can see which input pixels it touches.
         Expr beginx = cast<int>(ceil(sourcex - kernel_radius));
         Expr beginy = cast<int>(ceil(sourcey - kernel_radius));
 
@@ -160,8 +168,14 @@ public:
             .compute_at(kernel_y, y)
             .vectorize(y);
         kernel_y
-            .compute_at(output, y)
-            .reorder(k, y).vectorize(y, 8);
+            .compute_root()
+            .reorder(k, y)
+            .vectorize(y, 8);
+
+        if (memoize_tables) {
+            kernel_x.memoize();
+            kernel_y.memoize();
+        }
 
         if (upsample) {
             output
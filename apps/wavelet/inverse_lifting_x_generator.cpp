@@ -0,0 +1,50 @@
+#include "Halide.h"
+
+#include "lifting_scheme.h"
+
+namespace {
+
+Halide::Var x("x"), y("y"), xi("xi");
+
+// The inverse of lifting_x, taking its in-place layout.
+class inverse_lifting_x : public Halide::Generator<inverse_lifting_x> {
+public:
+    GeneratorParam<Wavelet> wavelet{"wavelet", Wavelet::CDF97, wavelet_enum_map()};
+    GeneratorParam<int> levels{"levels", 3, 1, 16};
+
+    Input<Buffer<float>> in_{"in" , 2};
+    Output<Buffer<float>> out_{"out" , 2};
+
+    void generate() {
+        const LiftingScheme scheme = lifting_scheme(wavelet);
+        const int L = levels;
+
+        std::vector<Func> stages;
+        Func band("coarsest");
+        band(x, y) = in_(x << L, y);
+        for (int k = L; k >= 1; k--) {
+            Func high("high");
+            high(x, y) = in_((x << k) + (1 << (k - 1)), y);
+            band = lifting::inverse_level(scheme, band, high, in_.width() >> (k - 1), x, y, stages);
+            if (k > 1) {
+                stages.push_back(band);
+            }
+        }
+        out_(x, y) = band(x, y);
+
+        // As in lifting_x, the levels are computed a row at a time.
+        in_.dim(0).set_min(0);
+        out_.dim(0).set_min(0);
+        const int vec = natural_vector_size<float>();
+        out_.parallel(y)
+            .split(x, x, xi, 2, TailStrategy::RoundUp)
+            .unroll(xi);
+        for (Func f : stages) {
+            f.compute_at(out_, y).vectorize(x, vec, TailStrategy::GuardWithIf);
+        }
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(inverse_lifting_x, inverse_lifting_x)
@@ -0,0 +1,129 @@
+#ifndef LIFTING_SCHEME_H_
+#define LIFTING_SCHEME_H_
+
+#include "Halide.h"
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Multi-level wavelet transforms along x, factored into lifting steps.
+// Each level splits a band into its even and odd samples, updates them
+// in place from each other a step at a time, and scales them into the
+// low and high bands of the next level. The lifting steps are exactly
+// invertible, whatever the boundary handling, so the inverse undoes
+// them in reverse order.
+
+enum class Wavelet { Haar, CDF53, CDF97 };
+inline std::map<std::string, Wavelet> wavelet_enum_map() {
+    return { { "haar", Wavelet::Haar },
+             { "cdf53", Wavelet::CDF53 },
+             { "cdf97", Wavelet::CDF97 } };
+}
+
+// A predict step updates the odd samples from their even neighbors:
+//   odd(x) += c0 * even(x) + c1 * even(x + 1)
+// and an update step updates the even samples from their odd neighbors:
+//   even(x) += c0 * odd(x) + c1 * odd(x - 1)
+// Neighbors past either end of a band are clamped to the band.
+struct LiftingStep {
+    bool predict;
+    float c0, c1;
+};
+
+// After the steps, the even samples are multiplied by scale to give
+// the low band, and the odd samples divided by it to give the high band.
+struct LiftingScheme {
+    std::vector<LiftingStep> steps;
+    float scale;
+};
+
+inline LiftingScheme lifting_scheme(Wavelet wavelet) {
+    switch (wavelet) {
+    case Wavelet::Haar:
+        return { { { true, -1.0f, 0.0f },
+                   { false, 0.5f, 0.0f } }, 1.0f };
+    case Wavelet::CDF53:
+        return { { { true, -0.5f, -0.5f },
+                   { false, 0.25f, 0.25f } }, 1.0f };
+    case Wavelet::CDF97:
+    default:
+        // The irreversible 9/7 wavelet of JPEG 2000.
+        return { { { true, -1.586134342f, -1.586134342f },
+                   { false, -0.05298011854f, -0.05298011854f },
+                   { true, 0.8829110762f, 0.8829110762f },
+                   { false, 0.4435068522f, 0.4435068522f } }, 1.149604398f };
+    }
+}
+
+namespace lifting {
+
+using Halide::Expr;
+using Halide::Func;
+using Halide::Var;
+
+// One lifting step applied to dst, reading src, where half is the
+// length of both. sign is 1 for the forward transform and -1 for the
+// inverse.
+inline Func lift(const LiftingStep &step, Func dst, Func src, Expr half, float sign, Var x, Var y) {
+    Expr neighbor = step.predict ? Halide::min(x + 1, half - 1) : Halide::max(x - 1, 0);
+    Expr delta = step.c0 * src(x, y);
+    if (step.c1 != 0.0f) {
+        delta += step.c1 * src(neighbor, y);
+    }
+    Func lifted(step.predict ? "predict" : "update");
+    lifted(x, y) = dst(x, y) + sign * delta;
+    return lifted;
+}
+
+// Transforms the first n (which must be even) samples of each row of
+// band into a low and a high band, n/2 long each. The Funcs of the
+// lifting steps are appended to stages.
+inline std::pair<Func, Func> forward_level(const LiftingScheme &scheme, Func band, Expr n,
+                                           Var x, Var y, std::vector<Func> &stages) {
+    Expr half = n / 2;
+    Func even("even"), odd("odd");
+    even(x, y) = band(2 * x, y);
+    odd(x, y) = band(2 * x + 1, y);
+    for (const LiftingStep &step : scheme.steps) {
+        if (step.predict) {
+            odd = lift(step, odd, even, half, 1.0f, x, y);
+            stages.push_back(odd);
+        } else {
+            even = lift(step, even, odd, half, 1.0f, x, y);
+            stages.push_back(even);
+        }
+    }
+    Func low("low"), high("high");
+    low(x, y) = even(x, y) * scheme.scale;
+    high(x, y) = odd(x, y) * (1.0f / scheme.scale);
+    return { low, high };
+}
+
+// The inverse of forward_level: reconstructs n samples of each row
+// from the low and high bands. The Funcs of the lifting steps are
+// appended to stages.
+inline Func inverse_level(const LiftingScheme &scheme, Func low, Func high, Expr n,
+                          Var x, Var y, std::vector<Func> &stages) {
+    Expr half = n / 2;
+    Func even("even"), odd("odd");
+    even(x, y) = low(x, y) * (1.0f / scheme.scale);
+    odd(x, y) = high(x, y) * scheme.scale;
+    for (auto it = scheme.steps.rbegin(); it != scheme.steps.rend(); it++) {
+        if (it->predict) {
+            odd = lift(*it, odd, even, half, -1.0f, x, y);
+            stages.push_back(odd);
+        } else {
+            even = lift(*it, even, odd, half, -1.0f, x, y);
+            stages.push_back(even);
+        }
+    }
+    Func band("band");
+    band(x, y) = Halide::select(x % 2 == 0, even(x / 2, y), odd(x / 2, y));
+    return band;
+}
+
+}  // namespace lifting
+
+#endif  // LIFTING_SCHEME_H_
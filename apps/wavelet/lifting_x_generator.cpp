@@ -0,0 +1,61 @@
+#include "Halide.h"
+
+#include "lifting_scheme.h"
+
+namespace {
+
+Halide::Var x("x"), y("y"), xi("xi");
+
+// A multi-level forward wavelet transform along x, computed with the
+// lifting scheme. The output has the layout of an in-place lifting
+// transform: the coefficients of level k (counting from 1) are at the
+// positions x with x % 2^k == 2^(k-1), and the final low band is at
+// the multiples of 2^levels. The width must be a multiple of 2^levels.
+class lifting_x : public Halide::Generator<lifting_x> {
+public:
+    GeneratorParam<Wavelet> wavelet{"wavelet", Wavelet::CDF97, wavelet_enum_map()};
+    GeneratorParam<int> levels{"levels", 3, 1, 16};
+
+    Input<Buffer<float>> in_{"in" , 2};
+    Output<Buffer<float>> out_{"out" , 2};
+
+    void generate() {
+        const LiftingScheme scheme = lifting_scheme(wavelet);
+        const int L = levels;
+
+        std::vector<Func> stages;
+        std::vector<Func> highs;
+        Func band = in_;
+        Expr n = in_.width();
+        for (int k = 1; k <= L; k++) {
+            auto bands = lifting::forward_level(scheme, band, n, x, y, stages);
+            band = bands.first;
+            highs.push_back(bands.second);
+            n = n / 2;
+        }
+
+        Expr value = band(x >> L, y);
+        for (int k = L; k >= 1; k--) {
+            value = select(x % (1 << k) == (1 << (k - 1)), highs[k - 1](x >> k, y), value);
+        }
+        out_(x, y) = value;
+
+        // Each level reads only the low band of the level above, so
+        // compute all of them a row at a time, in buffers a fraction
+        // of the size of the row. The input is read, and the output
+        // written, once.
+        in_.dim(0).set_min(0);
+        out_.dim(0).set_min(0);
+        const int vec = natural_vector_size<float>();
+        out_.parallel(y)
+            .split(x, x, xi, 1 << L, TailStrategy::RoundUp)
+            .unroll(xi);
+        for (Func f : stages) {
+            f.compute_at(out_, y).vectorize(x, vec, TailStrategy::GuardWithIf);
+        }
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(lifting_x, lifting_x)
@@ -4,6 +4,8 @@
 #include "inverse_haar_x.h"
 #include "daubechies_x.h"
 #include "inverse_daubechies_x.h"
+#include "lifting_x.h"
+#include "inverse_lifting_x.h"
 
 #include "HalideBuffer.h"
 #include "halide_image_io.h"
@@ -49,6 +51,20 @@ void save_transformed(Buffer<T> t, const std::string& filename) {
     printf("Saved %s\n", filename.c_str());
 }
 
+template<typename T>
+void save_lifted(Buffer<T> t, const std::string& filename) {
+    Buffer<T> clamped(t.width(), t.height(), 1);
+    for (int y = 0; y < t.height(); y++) {
+        for (int x = 0; x < t.width(); x++) {
+            // The low band is at the multiples of 8, everything else
+            // is a high band.
+            clamped(x, y, 0) = x % 8 == 0 ? clamp(t(x, y), 0.0f, 1.0f) : clamp(t(x, y)*4.f + 0.5f, 0.0f, 1.0f);
+        }
+    }
+    convert_and_save_image(clamped, filename);
+    printf("Saved %s\n", filename.c_str());
+}
+
 }  // namespace
 
 int main(int argc, char **argv) {
@@ -73,6 +89,27 @@ int main(int argc, char **argv) {
     _assert(inverse_daubechies_x(transformed, inverse_transformed) == 0, "inverse_daubechies_x failed");
     save_untransformed(inverse_transformed, dirname + "/inverse_daubechies_x.png");
 
+    // The three-level lifting transforms need a width that is a
+    // multiple of 8.
+    Buffer<float> lifting_input = input;
+    lifting_input.crop(0, 0, (input.width() / 8) * 8);
+    Buffer<float> lifted(lifting_input.width(), lifting_input.height());
+    Buffer<float> inverse_lifted(lifting_input.width(), lifting_input.height());
+
+    _assert(lifting_x(lifting_input, lifted) == 0, "lifting_x failed");
+    save_lifted(lifted, dirname + "/lifting_x.png");
+
+    _assert(inverse_lifting_x(lifted, inverse_lifted) == 0, "inverse_lifting_x failed");
+    for (int y = 0; y < lifting_input.height(); y++) {
+        for (int x = 0; x < lifting_input.width(); x++) {
+            float delta = inverse_lifted(x, y) - lifting_input(x, y);
+            _assert(delta > -1e-4f && delta < 1e-4f,
+                    "inverse_lifting_x(%d, %d) = %f instead of %f\n",
+                    x, y, inverse_lifted(x, y), lifting_input(x, y));
+        }
+    }
+    save_untransformed(inverse_lifted, dirname + "/inverse_lifting_x.png");
+
     printf("Done.\n");
     return 0;
 }
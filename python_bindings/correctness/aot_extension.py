@@ -0,0 +1,54 @@
+from __future__ import print_function
+from __future__ import division
+
+import halide as hl
+
+# Built ahead of time from aot_extension_generator.cpp, with the
+# Python extension that the Generator emits.
+import aot_extension
+
+
+def _check(b_in, b_out, scale, offset, negate):
+    for c in range(b_out.dim(2).extent()):
+        for y in range(b_out.dim(1).extent()):
+            for x in range(b_out.dim(0).extent()):
+                value = b_in[x, y] * scale + offset + c
+                if negate:
+                    value = -value
+                assert b_out[x, y, c] == value
+
+
+def test_aot_extension():
+    b_in = hl.Buffer(hl.UInt(8), [20, 3])
+    for y in range(3):
+        for x in range(20):
+            b_in[x, y] = x + 10 * y
+    b_out = hl.Buffer(hl.Float(32), [20, 3, 2])
+
+    # ----------- Arguments by-position
+    aot_extension.aot_extension(b_in, 0.5, 3, False, b_out)
+    _check(b_in, b_out, 0.5, 3, False)
+
+    # ----------- Arguments by-name
+    aot_extension.aot_extension(input=b_in, scale=2.0, offset=-7, negate=True, output=b_out)
+    _check(b_in, b_out, 2.0, -7, True)
+
+    # ----------- Bad arguments
+    def expect_error(error_type, *args):
+        try:
+            aot_extension.aot_extension(*args)
+        except error_type as e:
+            print('Got expected error:', e)
+        else:
+            assert False, 'Expected %s' % error_type.__name__
+
+    b_wrong_type = hl.Buffer(hl.UInt(16), [20, 3])
+    b_wrong_dims = hl.Buffer(hl.Float(32), [20, 3])
+    expect_error(ValueError, b_wrong_type, 1.0, 0, False, b_out)
+    expect_error(ValueError, b_in, 1.0, 0, False, b_wrong_dims)
+    expect_error(OverflowError, b_in, 1.0, 40000, False, b_out)
+    expect_error(TypeError, b_in, 1.0, 0, False)
+
+
+if __name__ == "__main__":
+    test_aot_extension()
@@ -0,0 +1,29 @@
+#include "Halide.h"
+
+namespace {
+
+class AotExtension : public Halide::Generator<AotExtension> {
+public:
+    Input<Buffer<uint8_t>> input{ "input", 2 };
+    Input<float> scale{ "scale", 1.0f };
+    Input<int16_t> offset{ "offset", 0 };
+    Input<bool> negate{ "negate", false };
+
+    Output<Buffer<float>> output{ "output", 3 };
+
+    void generate() {
+        Expr value = input(x, y) * scale + offset + c;
+        output(x, y, c) = select(negate, -value, value);
+    }
+
+    void schedule() {
+        output.vectorize(x, natural_vector_size<float>(), TailStrategy::GuardWithIf);
+    }
+
+private:
+    Var x{"x"}, y{"y"}, c{"c"};
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(AotExtension, aot_extension)
@@ -4,6 +4,7 @@ from __future__ import division
 import halide as hl
 import numpy as np
 import gc
+import threading
 
 def test_ndarray_to_buffer():
     a0 = np.ones((200, 300), dtype=np.int32)
@@ -118,10 +119,64 @@ def test_bufferinfo_sharing():
     b0[56, 34] = 12
     assert b0[56, 34] == 12
 
+def test_ndarray_formats():
+    # numpy and pybind11 use different format characters for the
+    # same types (e.g. 'l' vs 'q'), which should all be accepted.
+    for dtype, t in [(np.int64, hl.Int(64)), (np.uint64, hl.UInt(64)),
+                     (np.intc, hl.Int(32)), (np.float16, hl.Float(16)),
+                     (np.bool_, hl.Bool())]:
+        b = hl.Buffer(np.zeros((4, 4), dtype=dtype))
+        assert b.type() == t
+
+    a = np.zeros((4, 4), dtype=np.float16)
+    assert np.array(hl.Buffer(a), copy = False).dtype == np.float16
+
+
+def test_negative_strides():
+    a = np.arange(12, dtype=np.int32).reshape(3, 4)[::-1, ::-1]
+    b = hl.Buffer(a)
+    assert b.dim(0).stride() == -4
+    assert b.dim(1).stride() == -1
+    assert b[0, 0] == 11
+    assert b[2, 3] == 0
+
+    # And back again, still sharing storage.
+    c = np.array(b, copy = False)
+    assert c.strides == a.strides
+    b[1, 1] = 42
+    assert a[1, 1] == 42 and c[1, 1] == 42
+
+
+def test_realize_into_ndarray_from_threads():
+    x, y = hl.Var("x"), hl.Var("y")
+    funcs = []
+    for i in range(8):
+        f = hl.Func("f%d" % i)
+        f[x, y] = x + y * 10 + i * 100
+        f.compile_jit()
+        funcs.append(f)
+
+    # realize() releases the GIL, so these can run concurrently, and
+    # each writes straight into its ndarray. Each thread realizes a
+    # pipeline of its own.
+    arrays = [np.zeros((8, 8), dtype=np.int32) for i in range(8)]
+    def work(f, a):
+        f.realize(hl.Buffer(a))
+    threads = [threading.Thread(target=work, args=(f, a)) for f, a in zip(funcs, arrays)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    for i, a in enumerate(arrays):
+        assert a[3, 5] == 3 + 5 * 10 + i * 100
+
 if __name__ == "__main__":
     test_ndarray_to_buffer()
     test_buffer_to_ndarray()
     test_for_each_element()
     test_fill_all_equal()
     test_bufferinfo_sharing()
+    test_ndarray_formats()
+    test_negative_strides()
+    test_realize_into_ndarray_from_threads()
 
@@ -135,6 +135,28 @@ void define_boundary_conditions(py::module &m) {
         return Func();
     }, py::arg("f"), py::arg("bounds"));
 
+    // ----- stage_padded
+    bc.def("stage_padded", [](ImageParam im, Func bounded, Expr padding) -> Func {
+        return stage_padded(im, bounded, padding);
+    }, py::arg("f"), py::arg("bounded"), py::arg("padding"));
+    bc.def("stage_padded", [](Buffer<> b, Func bounded, Expr padding) -> Func {
+        return stage_padded(b, bounded, padding);
+    }, py::arg("f"), py::arg("bounded"), py::arg("padding"));
+    bc.def("stage_padded", [](py::object target, Func bounded, BoundsVec bounds, Expr padding) -> Func {
+        try {
+            return stage_padded(target.cast<Func>(), bounded, bounds, padding);
+        } catch (...) {
+            // fall thru
+        }
+        try {
+            return stage_padded(to_func(target.cast<Buffer<>>()), bounded, bounds, padding);
+        } catch (...) {
+            // fall thru
+        }
+        throw py::value_error("Invalid arguments to stage_padded");
+        return Func();
+    }, py::arg("f"), py::arg("bounded"), py::arg("bounds"), py::arg("padding"));
+
 }
 
 }  // namespace PythonBindings
@@ -1,5 +1,7 @@
 #include "PyBuffer.h"
 
+#include <limits>
+
 #include "PyFunc.h"
 #include "PyType.h"
 
@@ -103,34 +105,48 @@ std::string type_to_format_descriptor(const Type &type) {
 
     #undef HANDLE_BUFFER_TYPE
 
+    if (type == Float(16)) return "e";
+
     throw py::value_error("Unsupported Buffer<> type.");
     return std::string();
 }
 
-Type format_descriptor_to_type(const std::string &fd) {
-
-    #define HANDLE_BUFFER_TYPE(TYPE) \
-        if (fd == py::format_descriptor<TYPE>::format()) return type_of<TYPE>();
-
-    HANDLE_BUFFER_TYPE(bool)
-    HANDLE_BUFFER_TYPE(uint8_t)
-    HANDLE_BUFFER_TYPE(uint16_t)
-    HANDLE_BUFFER_TYPE(uint32_t)
-    HANDLE_BUFFER_TYPE(uint64_t)
-    HANDLE_BUFFER_TYPE(int8_t)
-    HANDLE_BUFFER_TYPE(int16_t)
-    HANDLE_BUFFER_TYPE(int32_t)
-    HANDLE_BUFFER_TYPE(int64_t)
-    HANDLE_BUFFER_TYPE(float)
-    HANDLE_BUFFER_TYPE(double)
-
-    #undef HANDLE_BUFFER_TYPE
-
-    throw py::value_error("Unsupported Buffer<> type.");
+// Map a struct-style format descriptor to a Type. Producers differ in
+// which character they use for a given width (numpy reports int64 as 'l'
+// on Linux, pybind11 as 'q'), so match on the kind of the character and
+// the item size instead of comparing against our own descriptors.
+Type format_descriptor_to_type(const std::string &fd, ssize_t itemsize) {
+    size_t i = 0;
+    if (i < fd.size() && (fd[i] == '<' || fd[i] == '>' || fd[i] == '!')) {
+        const bool big_endian = (fd[i] != '<');
+        const uint16_t probe = 1;
+        const bool host_big_endian = (*(const uint8_t *)&probe == 0);
+        if (big_endian != host_big_endian) {
+            throw py::value_error("Buffers with non-native byte order are not supported.");
+        }
+        i++;
+    } else if (i < fd.size() && (fd[i] == '@' || fd[i] == '=')) {
+        i++;
+    }
+    if (i + 1 != fd.size()) {
+        throw py::value_error("Unsupported buffer format '" + fd + "'.");
+    }
+    const int bits = (int) itemsize * 8;
+    switch (fd[i]) {
+    case '?':
+        return Bool();
+    case 'b': case 'h': case 'i': case 'l': case 'q':
+        return Int(bits);
+    case 'B': case 'H': case 'I': case 'L': case 'Q':
+        return UInt(bits);
+    case 'e': case 'f': case 'd':
+        return Float(bits);
+    default:
+        throw py::value_error("Unsupported buffer format '" + fd + "'.");
+    }
     return Type();
 }
 
-
 py::object buffer_getitem_operator(Buffer<> &buf, const std::vector<int> &pos) {
     if ((size_t) pos.size() != (size_t) buf.dimensions()) {
         throw py::value_error("Incorrect number of dimensions.");
@@ -193,19 +209,30 @@ class PyBuffer : public Buffer<> {
     py::buffer_info info;
 
     static std::vector<halide_dimension_t> make_dim_vec(const py::buffer_info &info) {
-        const Type t = format_descriptor_to_type(info.format);
+        const Type t = format_descriptor_to_type(info.format, info.itemsize);
         std::vector<halide_dimension_t> dims;
         dims.reserve(info.ndim);
         for (int i = 0; i < info.ndim; i++) {
-            // TODO: check for ssize_t -> int32_t overflow
-            dims.push_back({0, (int32_t) info.shape[i], (int32_t) (info.strides[i] / t.bytes())});
+            // Strides may be negative (e.g. a reversed numpy view), but
+            // must be a whole number of elements to be shared.
+            const ssize_t extent = info.shape[i];
+            const ssize_t stride = info.strides[i] / t.bytes();
+            if (stride * t.bytes() != info.strides[i]) {
+                throw py::value_error("Buffer strides must be a multiple of the element size.");
+            }
+            if (extent > std::numeric_limits<int32_t>::max() ||
+                stride > std::numeric_limits<int32_t>::max() ||
+                stride < std::numeric_limits<int32_t>::min()) {
+                throw py::value_error("Buffer extents and strides must fit in 32 bits.");
+            }
+            dims.push_back({0, (int32_t) extent, (int32_t) stride});
         }
         return dims;
     }
 
     PyBuffer(py::buffer_info &&info, const std::string &name)
         : Buffer<>(
-            format_descriptor_to_type(info.format),
+            format_descriptor_to_type(info.format, info.itemsize),
             info.ptr,
             (int) info.ndim,
             make_dim_vec(info).data(),
@@ -248,6 +275,8 @@ void define_buffer(py::module &m) {
             if (b.data() == nullptr) {
                 throw py::value_error("Cannot convert a Buffer<> with null host ptr to a Python buffer.");
             }
+            // The view shares host memory, so it must be current.
+            b.copy_to_host();
 
             const int d = b.dimensions();
             const int bytes = b.type().bytes();
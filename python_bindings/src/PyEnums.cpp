@@ -39,6 +39,7 @@ void define_enums(py::module &m) {
         .value("Stack", MemoryType::Stack)
         .value("Register", MemoryType::Register)
         .value("GPUShared", MemoryType::GPUShared)
+        .value("VTCM", MemoryType::VTCM)
     ;
 
     py::enum_<NameMangling>(m, "NameMangling")
@@ -61,6 +62,7 @@ void define_enums(py::module &m) {
         .value("RoundUp", TailStrategy::RoundUp)
         .value("GuardWithIf", TailStrategy::GuardWithIf)
         .value("ShiftInwards", TailStrategy::ShiftInwards)
+        .value("Predicate", TailStrategy::Predicate)
         .value("Auto", TailStrategy::Auto)
     ;
 
@@ -72,7 +74,8 @@ void define_enums(py::module &m) {
         .value("Android", Target::OS::Android)
         .value("IOS", Target::OS::IOS)
         .value("QuRT", Target::OS::QuRT)
-        .value("NoOS", Target::OS::NoOS);
+        .value("NoOS", Target::OS::NoOS)
+        .value("WebAssemblyRuntime", Target::OS::WebAssemblyRuntime);
 
     py::enum_<Target::Arch>(m, "TargetArch")
         .value("ArchUnknown", Target::Arch::ArchUnknown)
@@ -80,7 +83,9 @@ void define_enums(py::module &m) {
         .value("ARM", Target::Arch::ARM)
         .value("MIPS", Target::Arch::MIPS)
         .value("Hexagon", Target::Arch::Hexagon)
-        .value("POWERPC", Target::Arch::POWERPC);
+        .value("POWERPC", Target::Arch::POWERPC)
+        .value("WebAssembly", Target::Arch::WebAssembly)
+        .value("RISCV", Target::Arch::RISCV);
 
     py::enum_<Target::Feature>(m, "TargetFeature")
         .value("JIT", Target::Feature::JIT)
@@ -108,6 +113,7 @@ void define_enums(py::module &m) {
         .value("CLHalf", Target::Feature::CLHalf)
         .value("OpenGL", Target::Feature::OpenGL)
         .value("OpenGLCompute", Target::Feature::OpenGLCompute)
+        .value("WasmThreads", Target::Feature::WasmThreads)
         .value("UserContext", Target::Feature::UserContext)
         .value("Matlab", Target::Feature::Matlab)
         .value("Profile", Target::Feature::Profile)
@@ -134,6 +140,30 @@ void define_enums(py::module &m) {
         .value("TraceRealizations", Target::Feature::TraceRealizations)
         .value("TSAN", Target::Feature::TSAN)
         .value("ASAN", Target::Feature::ASAN)
+        .value("ArenaAllocations", Target::Feature::ArenaAllocations)
+        .value("AVX512_VNNI", Target::Feature::AVX512_VNNI)
+        .value("AVX512_BF16", Target::Feature::AVX512_BF16)
+        .value("ARMDotProd", Target::Feature::ARMDotProd)
+        .value("SVE", Target::Feature::SVE)
+        .value("ARMFp16", Target::Feature::ARMFp16)
+        .value("CUDACapability70", Target::Feature::CUDACapability70)
+        .value("CUDACapability75", Target::Feature::CUDACapability75)
+        .value("NoOptimize", Target::Feature::NoOptimize)
+        .value("CheckShapesOnce", Target::Feature::CheckShapesOnce)
+        .value("LatencyTelemetry", Target::Feature::LatencyTelemetry)
+        .value("AutoPrefetch", Target::Feature::AutoPrefetch)
+        .value("FuseGPUStages", Target::Feature::FuseGPUStages)
+        .value("FoldConstantFuncs", Target::Feature::FoldConstantFuncs)
+        .value("PerTaskStorage", Target::Feature::PerTaskStorage)
+        .value("ReuseProducerStorage", Target::Feature::ReuseProducerStorage)
+        .value("ThreefryRandom", Target::Feature::ThreefryRandom)
+        .value("PadStorageStrides", Target::Feature::PadStorageStrides)
+        .value("InferComputeWith", Target::Feature::InferComputeWith)
+        .value("CUDASass", Target::Feature::CUDASass)
+        .value("MetalLibrary", Target::Feature::MetalLibrary)
+        .value("RISCV_V", Target::Feature::RISCV_V)
+        .value("MemoizeSimplify", Target::Feature::MemoizeSimplify)
+        .value("InternExprs", Target::Feature::InternExprs)
         .value("FeatureEnd", Target::Feature::FeatureEnd);
 
     py::enum_<halide_type_code_t>(m, "TypeCode")
@@ -9,13 +9,17 @@ void halide_python_error(void *, const char *msg) {
     throw Error(msg);
 }
 
+// realize() releases the GIL, so anything that calls back into Python
+// from Halide must take it again first.
 void halide_python_print(void *, const char *msg) {
+    py::gil_scoped_acquire acquire;
     py::print(msg, py::arg("end") = "");
 }
 
 class HalidePythonCompileTimeErrorReporter : public CompileTimeErrorReporter {
 public:
     void warning(const char* msg) {
+        py::gil_scoped_acquire acquire;
         py::print(msg, py::arg("end") = "");
     }
 
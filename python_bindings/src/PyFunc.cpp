@@ -71,6 +71,7 @@ void define_func(py::module &m) {
     // overrides in Python (https://github.com/halide/Halide/issues/2790):
     // - set_error_handler()
     // - set_custom_trace()
+    // - set_custom_telemetry()
     // - set_custom_print()
 
     auto func_class = py::class_<Func>(m, "Func")
@@ -83,36 +84,36 @@ void define_func(py::module &m) {
         .def(py::init([](const ImageParam &im) -> Func { return im; }))
 
         .def("realize", [](Func &f, Buffer<> buffer, const Target &target, const ParamMap &param_map) -> void {
-            f.realize(buffer, target);
+            without_gil([&]() { f.realize(buffer, target, param_map); });
         }, py::arg("dst"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         // This will actually allow a list-of-buffers as well as a tuple-of-buffers, but that's OK.
         .def("realize", [](Func &f, std::vector<Buffer<>> buffers, const Target &t, const ParamMap &param_map) -> void {
-            f.realize(Realization(buffers), t);
+            without_gil([&]() { f.realize(Realization(buffers), t, param_map); });
         }, py::arg("dst"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         .def("realize", [](Func &f, std::vector<int32_t> sizes, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(f.realize(sizes, target, param_map));
+            return realization_to_object(without_gil([&]() { return f.realize(sizes, target, param_map); }));
         }, py::arg("sizes") = std::vector<int32_t>{}, py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         // TODO: deprecate in favor of std::vector<int32_t> size version?
         .def("realize", [](Func &f, int x_size, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(f.realize(x_size, target, param_map));
+            return realization_to_object(without_gil([&]() { return f.realize(x_size, target, param_map); }));
         }, py::arg("x_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         // TODO: deprecate in favor of std::vector<int32_t> size version?
         .def("realize", [](Func &f, int x_size, int y_size, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(f.realize(x_size, y_size, target, param_map));
+            return realization_to_object(without_gil([&]() { return f.realize(x_size, y_size, target, param_map); }));
         }, py::arg("x_size"), py::arg("y_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         // TODO: deprecate in favor of std::vector<int32_t> size version?
         .def("realize", [](Func &f, int x_size, int y_size, int z_size, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(f.realize(x_size, y_size, z_size, target, param_map));
+            return realization_to_object(without_gil([&]() { return f.realize(x_size, y_size, z_size, target, param_map); }));
         }, py::arg("x_size"), py::arg("y_size"), py::arg("z_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         // TODO: deprecate in favor of std::vector<int32_t> size version?
         .def("realize", [](Func &f, int x_size, int y_size, int z_size, int w_size, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(f.realize(x_size, y_size, z_size, w_size, target, param_map));
+            return realization_to_object(without_gil([&]() { return f.realize(x_size, y_size, z_size, w_size, target, param_map); }));
         }, py::arg("x_size"), py::arg("y_size"), py::arg("z_size"), py::arg("w_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         .def("defined", &Func::defined)
@@ -150,12 +151,19 @@ void define_func(py::module &m) {
             py::arg("loop_level"))
 
         .def("memoize", &Func::memoize)
+        .def("async_", &Func::async)
         .def("compute_inline", &Func::compute_inline)
         .def("compute_root", &Func::compute_root)
         .def("store_root", &Func::store_root)
 
         .def("store_in", &Func::store_in,
             py::arg("memory_type"))
+        .def("store_nontemporal", &Func::store_nontemporal)
+        .def("store_tuple_interleaved", &Func::store_tuple_interleaved)
+        .def("partition_budget", &Func::partition_budget, py::arg("budget"))
+        .def("distribute", &Func::distribute, py::arg("x"))
+        .def("distribute_gpus", &Func::distribute_gpus, py::arg("x"), py::arg("gpu_devices"))
+        .def("co_execute", &Func::co_execute, py::arg("x"))
 
         .def("compile_to", &Func::compile_to,
             py::arg("outputs"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
@@ -195,7 +203,7 @@ void define_func(py::module &m) {
             py::arg("filename"), py::arg("arguments"), py::arg("fn_name") = "", py::arg("target") = get_target_from_environment())
 
         .def("compile_to_lowered_stmt", &Func::compile_to_lowered_stmt,
-            py::arg("filename"), py::arg("arguments"), py::arg("fmt") = Text, py::arg("target") = get_target_from_environment())
+            py::arg("filename"), py::arg("arguments"), py::arg("fmt") = Text, py::arg("target") = get_target_from_environment(), py::arg("profile_json") = "")
 
         .def("compile_to_file", &Func::compile_to_file,
             py::arg("filename_prefix"), py::arg("arguments"), py::arg("fn_name") = "", py::arg("target") = get_target_from_environment())
@@ -283,6 +291,8 @@ void define_func(py::module &m) {
              py::arg("arguments"), py::arg("mangling"),
              py::arg("uses_old_buffer_t"))
 
+        .def("extern_footprint", &Func::extern_footprint, py::arg("reads"))
+
         .def("output_buffer", &Func::output_buffer)
         .def("output_buffers", &Func::output_buffers)
 
@@ -300,6 +310,8 @@ void define_func(py::module &m) {
         .def("in", (Func (Func::*)(const Func &)) &Func::in, py::arg("f"))
         .def("in", (Func (Func::*)(const std::vector<Func> &fs)) &Func::in, py::arg("fs"))
         .def("in", (Func (Func::*)()) &Func::in)
+        .def("stage_in_gpu_shared", &Func::stage_in_gpu_shared,
+            py::arg("consumer"), py::arg("block"), py::arg("threads_x"), py::arg("threads_y") = 1)
 
         .def("clone_in", (Func (Func::*)(const Func &)) &Func::clone_in, py::arg("f"))
         .def("clone_in", (Func (Func::*)(const std::vector<Func> &fs)) &Func::clone_in, py::arg("fs"))
@@ -329,6 +341,9 @@ void define_func(py::module &m) {
         .def("align_storage", &Func::align_storage,
             py::arg("dim"), py::arg("alignment"))
 
+        .def("store_tiled", &Func::store_tiled,
+            py::arg("x"), py::arg("y"), py::arg("tx"), py::arg("ty"))
+
         .def("fold_storage", &Func::fold_storage,
             py::arg("dim"), py::arg("extent"), py::arg("fold_forward") = true)
 
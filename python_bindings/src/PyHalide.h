@@ -32,6 +32,15 @@ std::vector<T> args_to_vector(const py::args &args, size_t start_offset = 0, siz
     return v;
 }
 
+// Run 'f' with the GIL released, so that other Python threads can run
+// while Halide compiles or executes a pipeline. 'f' must not touch any
+// Python objects.
+template<typename F>
+auto without_gil(F &&f) -> decltype(f()) {
+    py::gil_scoped_release release;
+    return f();
+}
+
 }  // namespace PythonBindings
 }  // namespace Halide
 
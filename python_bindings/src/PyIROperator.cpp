@@ -129,9 +129,13 @@ void define_operators(py::module &m) {
     m.def("log", &log);
     m.def("pow", &pow);
     m.def("erf", &erf);
-    m.def("fast_log", &fast_log);
-    m.def("fast_exp", &fast_exp);
-    m.def("fast_pow", &fast_pow);
+    m.def("fast_log", &fast_log, py::arg("x"), py::arg("max_ulp_error") = 32);
+    m.def("fast_exp", &fast_exp, py::arg("x"), py::arg("max_ulp_error") = 80);
+    m.def("fast_pow", &fast_pow, py::arg("x"), py::arg("y"), py::arg("max_ulp_error") = 80);
+    m.def("fast_sin", &fast_sin, py::arg("x"), py::arg("max_ulp_error") = 32);
+    m.def("fast_cos", &fast_cos, py::arg("x"), py::arg("max_ulp_error") = 32);
+    m.def("fast_atan", &fast_atan, py::arg("x"), py::arg("max_ulp_error") = 512);
+    m.def("fast_atan2", &fast_atan2, py::arg("y"), py::arg("x"), py::arg("max_ulp_error") = 512);
     m.def("fast_inverse", &fast_inverse);
     m.def("fast_inverse_sqrt", &fast_inverse_sqrt);
     m.def("floor", &floor);
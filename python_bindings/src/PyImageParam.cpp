@@ -76,6 +76,8 @@ void define_image_param(py::module &m) {
         .def("in", (Func (ImageParam::*)(const Func &)) &ImageParam::in)
         .def("in", (Func (ImageParam::*)(const std::vector<Func> &)) &ImageParam::in)
         .def("in", (Func (ImageParam::*)()) &ImageParam::in)
+        .def("stage_in_gpu_shared", &ImageParam::stage_in_gpu_shared,
+            py::arg("consumer"), py::arg("block"), py::arg("threads_x"), py::arg("threads_y") = 1)
         .def("trace_loads", &ImageParam::trace_loads)
 
         .def("__repr__", [](const ImageParam &im) -> std::string {
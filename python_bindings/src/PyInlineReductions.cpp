@@ -40,6 +40,18 @@ void define_inline_reductions(py::module &m) {
     m.def("argmin", [](RDom r, Expr e, const std::string &s) -> py::tuple {
         return to_python_tuple(argmin(r, e, s));
     }, py::arg("rdom"), py::arg("expr"), py::arg("name") = "argmin");
+
+    m.def("sort_network", &Halide::sort_network, py::arg("values"));
+
+    m.def("kth_smallest", (Expr (*)(Expr, int)) &Halide::kth_smallest,
+            py::arg("expr"), py::arg("k"));
+    m.def("kth_smallest", (Expr (*)(RDom, Expr, int)) &Halide::kth_smallest,
+            py::arg("rdom"), py::arg("expr"), py::arg("k"));
+
+    m.def("median", (Expr (*)(Expr)) &Halide::median,
+            py::arg("expr"));
+    m.def("median", (Expr (*)(RDom, Expr)) &Halide::median,
+            py::arg("rdom"), py::arg("expr"));
 }
 
 }  // namespace PythonBindings
@@ -36,6 +36,7 @@ void define_pipeline(py::module &m) {
     // overrides in Python (https://github.com/halide/Halide/issues/2790):
     // - set_error_handler()
     // - set_custom_trace()
+    // - set_custom_telemetry()
     // - set_custom_print()
 
     auto pipeline_class = py::class_<Pipeline>(m, "Pipeline")
@@ -45,7 +46,8 @@ void define_pipeline(py::module &m) {
 
         .def("outputs", &Pipeline::outputs)
         .def("auto_schedule", &Pipeline::auto_schedule,
-            py::arg("target"), py::arg("machine_params") = MachineParams::generic())
+            py::arg("target"), py::arg("machine_params") = MachineParams::generic(),
+            py::arg("autotune_candidates") = 0)
         .def("get_func", &Pipeline::get_func,
             py::arg("index"))
         .def("print_loop_nest", &Pipeline::print_loop_nest)
@@ -71,7 +73,7 @@ void define_pipeline(py::module &m) {
             py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
 
         .def("compile_to_lowered_stmt", &Pipeline::compile_to_lowered_stmt,
-            py::arg("filename"), py::arg("arguments"), py::arg("format") = StmtOutputFormat::Text, py::arg("target") = get_target_from_environment())
+            py::arg("filename"), py::arg("arguments"), py::arg("format") = StmtOutputFormat::Text, py::arg("target") = get_target_from_environment(), py::arg("profile_json") = "")
 
         .def("compile_to_multitarget_static_library", &Pipeline::compile_to_multitarget_static_library,
             py::arg("filename_prefix"), py::arg("arguments"), py::arg("targets") = get_target_from_environment())
@@ -85,36 +87,36 @@ void define_pipeline(py::module &m) {
 
 
         .def("realize", [](Pipeline &p, Buffer<> buffer, const Target &target, const ParamMap &param_map) -> void {
-            p.realize(Realization(buffer), target);
+            without_gil([&]() { p.realize(Realization(buffer), target, param_map); });
         }, py::arg("dst"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         // This will actually allow a list-of-buffers as well as a tuple-of-buffers, but that's OK.
         .def("realize", [](Pipeline &p, std::vector<Buffer<>> buffers, const Target &t, const ParamMap &param_map) -> void {
-            p.realize(Realization(buffers), t);
+            without_gil([&]() { p.realize(Realization(buffers), t, param_map); });
         }, py::arg("dst"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         .def("realize", [](Pipeline &p, std::vector<int32_t> sizes, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(p.realize(sizes, target, param_map));
+            return realization_to_object(without_gil([&]() { return p.realize(sizes, target, param_map); }));
         }, py::arg("sizes") = std::vector<int32_t>{}, py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         // TODO: deprecate in favor of std::vector<int32_t> size version?
         .def("realize", [](Pipeline &p, int x_size, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(p.realize(x_size, target, param_map));
+            return realization_to_object(without_gil([&]() { return p.realize(x_size, target, param_map); }));
         }, py::arg("x_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         // TODO: deprecate in favor of std::vector<int32_t> size version?
         .def("realize", [](Pipeline &p, int x_size, int y_size, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(p.realize(x_size, y_size, target, param_map));
+            return realization_to_object(without_gil([&]() { return p.realize(x_size, y_size, target, param_map); }));
         }, py::arg("x_size"), py::arg("y_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         // TODO: deprecate in favor of std::vector<int32_t> size version?
         .def("realize", [](Pipeline &p, int x_size, int y_size, int z_size, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(p.realize(x_size, y_size, z_size, target, param_map));
+            return realization_to_object(without_gil([&]() { return p.realize(x_size, y_size, z_size, target, param_map); }));
         }, py::arg("x_size"), py::arg("y_size"), py::arg("z_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         // TODO: deprecate in favor of std::vector<int32_t> size version?
         .def("realize", [](Pipeline &p, int x_size, int y_size, int z_size, int w_size, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(p.realize(x_size, y_size, z_size, w_size, target, param_map));
+            return realization_to_object(without_gil([&]() { return p.realize(x_size, y_size, z_size, w_size, target, param_map); }));
         }, py::arg("x_size"), py::arg("y_size"), py::arg("z_size"), py::arg("w_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         .def("infer_input_bounds", [](Pipeline &p, int x_size, int y_size, int z_size, int w_size, const ParamMap &param_map) -> void {
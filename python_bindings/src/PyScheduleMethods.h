@@ -22,6 +22,8 @@ HALIDE_NEVER_INLINE void add_schedule_methods(PythonClass &class_instance) {
         py::arg("var"))
     .def("unroll", (T &(T::*)(VarOrRVar, Expr, TailStrategy)) &T::unroll,
         py::arg("var"), py::arg("factor"), py::arg("tail") = TailStrategy::Auto)
+    .def("unroll_and_jam", &T::unroll_and_jam,
+        py::arg("outer"), py::arg("factor"), py::arg("tail") = TailStrategy::Auto)
 
     .def("split", (T &(T::*)(VarOrRVar, VarOrRVar, VarOrRVar, Expr, TailStrategy)) &T::split,
         py::arg("old"), py::arg("outer"), py::arg("inner"), py::arg("factor"), py::arg("tail") = TailStrategy::Auto)
@@ -37,6 +39,9 @@ HALIDE_NEVER_INLINE void add_schedule_methods(PythonClass &class_instance) {
     .def("tile", (T &(T::*)(VarOrRVar, VarOrRVar, VarOrRVar, VarOrRVar, Expr, Expr, TailStrategy)) &T::tile,
         py::arg("x"), py::arg("y"), py::arg("xi"), py::arg("yi"), py::arg("xfactor"), py::arg("yfactor"), py::arg("tail") = TailStrategy::Auto)
 
+    .def("register_tile", &T::register_tile,
+        py::arg("x"), py::arg("y"), py::arg("target") = get_target_from_environment(), py::arg("tail") = TailStrategy::Auto)
+
     .def("reorder", (T &(T::*)(const std::vector<VarOrRVar> &)) &T::reorder, py::arg("vars"))
     .def("reorder", [](T &t, py::args args) -> T & {
         return t.reorder(args_to_vector<VarOrRVar>(args));
@@ -107,6 +112,7 @@ HALIDE_NEVER_INLINE void add_schedule_methods(PythonClass &class_instance) {
         py::arg("message"))
 
     .def("allow_race_conditions", &T::allow_race_conditions)
+    .def("atomic", &T::atomic)
     .def("hexagon", &T::hexagon, py::arg("x") = Var::outermost())
 
     .def("prefetch", (T &(T::*)(const Func &, VarOrRVar, Expr, PrefetchBoundStrategy)) &T::prefetch,
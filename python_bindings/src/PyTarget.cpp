@@ -50,6 +50,7 @@ void define_target(py::module &m) {
             .def("supports_type", supports_type2_method, py::arg("type"), py::arg("device"))
             .def("supports_device_api", &Target::supports_device_api, py::arg("device"))
             .def("natural_vector_size", natural_vector_size_method, py::arg("type"))
+            .def("vector_register_count", &Target::vector_register_count)
             .def("has_large_buffers", &Target::has_large_buffers)
             .def("maximum_buffer_size", &Target::maximum_buffer_size)
             .def("supported", &Target::supported)
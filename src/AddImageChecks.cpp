@@ -1,5 +1,10 @@
+#include <atomic>
+#include <set>
+
 #include "AddImageChecks.h"
 #include "Target.h"
+#include "IROperator.h"
+#include "IRMutator.h"
 #include "IRVisitor.h"
 #include "Substitute.h"
 #include "Simplify.h"
@@ -90,6 +95,70 @@ public:
     }
 };
 
+/* Find the variables a set of checks depend on, looking through the
+ * lets that define them, and the scalar params among them. */
+class FindCheckDependencies : public IRGraphVisitor {
+    const map<string, Expr> &lets;
+    std::set<string> visited;
+
+    using IRGraphVisitor::visit;
+
+    void visit(const Variable *op) {
+        if (op->param.defined() && !op->param.is_buffer()) {
+            scalar_params[op->name] = op->param;
+        }
+        if (visited.insert(op->name).second) {
+            auto it = lets.find(op->name);
+            if (it != lets.end()) {
+                it->second.accept(this);
+            }
+        }
+    }
+
+public:
+    map<string, Parameter> scalar_params;
+
+    FindCheckDependencies(const map<string, Expr> &lets) : lets(lets) {}
+};
+
+/* Find the values of all the lets in a stmt. */
+class FindLets : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    void visit(const LetStmt *op) {
+        lets[op->name] = op->value;
+        IRGraphVisitor::visit(op);
+    }
+
+public:
+    map<string, Expr> lets;
+};
+
+/* Combine the values the checks on a pipeline's buffers depend on into
+ * a single 64-bit signature, using FNV-1a on whole values. The seed
+ * differs between pipelines, including pipelines with the same name
+ * jit-compiled at different times, so they never share signatures. */
+Expr shape_signature(const vector<Expr> &fields, const vector<Function> &outputs) {
+    static std::atomic<uint64_t> compilations(0);
+    const uint64_t prime = 0x100000001b3ULL;
+    uint64_t seed = 0xcbf29ce484222325ULL;
+    for (Function f : outputs) {
+        for (char c : f.name()) {
+            seed = (seed ^ (uint8_t)c) * prime;
+        }
+    }
+    seed = (seed ^ compilations++) * prime;
+
+    Expr signature = make_const(UInt(64), seed);
+    for (Expr e : fields) {
+        if (e.type().is_float()) {
+            e = reinterpret(UInt(e.type().bits()), e);
+        }
+        signature = (signature ^ cast<uint64_t>(e)) * make_const(UInt(64), prime);
+    }
+    return signature;
+}
+
 Stmt add_image_checks(Stmt s,
                       const vector<Function> &outputs,
                       const Target &t,
@@ -99,6 +168,7 @@ Stmt add_image_checks(Stmt s,
 
     bool no_asserts = t.has_feature(Target::NoAsserts);
     bool no_bounds_query = t.has_feature(Target::NoBoundsQuery);
+    bool check_shapes_once = !no_asserts && t.has_feature(Target::CheckShapesOnce);
 
     // First hunt for all the referenced buffers
     FindBuffers finder;
@@ -141,6 +211,9 @@ Stmt add_image_checks(Stmt s,
     vector<Stmt> asserts_host_non_null;
     vector<Stmt> buffer_rewrites;
 
+    // The buffer fields the checks depend on, for check_shapes_once.
+    vector<Expr> signature_fields;
+
     // Inject the code that conditionally returns if we're in inference mode
     Expr maybe_return_condition = const_false();
 
@@ -273,6 +346,9 @@ Stmt add_image_checks(Stmt s,
                 AssertStmt::make((type_code == type.code()) &&
                                  (type_bits == type.bits()) &&
                                  (type_lanes == type.lanes()), error));
+            signature_fields.push_back(type_code);
+            signature_fields.push_back(type_bits);
+            signature_fields.push_back(type_lanes);
         }
 
         if (touched.maybe_unused()) {
@@ -290,6 +366,9 @@ Stmt add_image_checks(Stmt s,
             Expr actual_min = Variable::make(Int(32), actual_min_name, image, param, rdom);
             Expr actual_extent = Variable::make(Int(32), actual_extent_name, image, param, rdom);
             Expr actual_stride = Variable::make(Int(32), actual_stride_name, image, param, rdom);
+            signature_fields.push_back(actual_min);
+            signature_fields.push_back(actual_extent);
+            signature_fields.push_back(actual_stride);
 
             if (!touched.empty() && !touched[j].is_bounded()) {
                 user_error << "Buffer " << name
@@ -413,6 +492,7 @@ Stmt add_image_checks(Stmt s,
             string extent_name = name + ".extent." + dim;
 
             Expr stride_constrained, extent_constrained, min_constrained;
+            int stride_multiple = 1;
 
             Expr stride_orig = Variable::make(Int(32), stride_name, image, param, rdom);
             Expr extent_orig = Variable::make(Int(32), extent_name, image, param, rdom);
@@ -465,6 +545,7 @@ Stmt add_image_checks(Stmt s,
                 stride_constrained = param.stride_constraint(i);
                 extent_constrained = param.extent_constraint(i);
                 min_constrained = param.min_constraint(i);
+                stride_multiple = param.stride_multiple(i);
             }
 
             if (stride_constrained.defined()) {
@@ -473,6 +554,15 @@ Stmt add_image_checks(Stmt s,
                 constraints.push_back({ stride_orig, stride_constrained});
                 stride_constrained = substitute(replace_with_required, stride_constrained);
                 lets_proposed.push_back({ stride_name + ".proposed", stride_constrained });
+            } else if (stride_multiple > 1) {
+                // The stride is only promised to be a multiple. Using
+                // the rounded version in the pipeline tells the alignment
+                // analysis in codegen, and the check that the two are
+                // equal enforces the promise. The proposed stride rounds
+                // up, so that rows don't overlap.
+                constraints.push_back({ stride_orig, (stride_orig / stride_multiple) * stride_multiple });
+                Expr rounded = ((stride_required + stride_multiple - 1) / stride_multiple) * stride_multiple;
+                lets_proposed.push_back({ stride_name + ".proposed", rounded });
             } else {
                 lets_proposed.push_back({ stride_name + ".proposed", stride_required });
             }
@@ -568,7 +658,7 @@ Stmt add_image_checks(Stmt s,
         }
     }
     // Inject the code that checks that no dimension math overflows
-    if (!no_asserts) {
+    if (!no_asserts && !check_shapes_once) {
         for (size_t i = dims_no_overflow_asserts.size(); i > 0; i--) {
             s = Block::make(dims_no_overflow_asserts[i-1], s);
         }
@@ -589,7 +679,55 @@ Stmt add_image_checks(Stmt s,
     // all in reverse order compared to execution, as we incrementally
     // prepending code.
 
-    if (!no_asserts) {
+    if (check_shapes_once) {
+        // Run all the checks that depend only on the shapes of the
+        // buffers and the values of params when the signature of
+        // those is not one that recently passed them.
+        FindLets find_lets;
+        s.accept(&find_lets);
+        map<string, Expr> &lets = find_lets.lets;
+        for (const auto &l : lets_required) lets[l.first] = l.second;
+        for (const auto &l : lets_constrained) lets[l.first] = l.second;
+        for (const auto &l : lets_overflow) lets[l.first] = l.second;
+
+        const string signature_name = "shape_signature";
+        Expr signature_var = Variable::make(UInt(64), signature_name);
+        Stmt checks = Evaluate::make(Call::make(Int(32), "halide_shape_check_cache_store",
+                                                {signature_var}, Call::Extern));
+        for (size_t i = dims_no_overflow_asserts.size(); i > 0; i--) {
+            checks = Block::make(dims_no_overflow_asserts[i-1], checks);
+        }
+        for (size_t i = lets_overflow.size(); i > 0; i--) {
+            checks = LetStmt::make(lets_overflow[i-1].first, lets_overflow[i-1].second, checks);
+        }
+        checks = substitute(replace_with_constrained, checks);
+        for (size_t i = asserts_constrained.size(); i > 0; i--) {
+            checks = Block::make(asserts_constrained[i-1], checks);
+        }
+        for (size_t i = asserts_required.size(); i > 0; i--) {
+            checks = Block::make(asserts_required[i-1], checks);
+        }
+        for (size_t i = asserts_elem_size.size(); i > 0; i--) {
+            checks = Block::make(asserts_elem_size[i-1], checks);
+        }
+
+        // The signature includes the scalar params the checks depend
+        // on, but not others, so that pipelines called with varying
+        // params still skip the checks.
+        FindCheckDependencies deps(lets);
+        checks.accept(&deps);
+        vector<Expr> fields = signature_fields;
+        for (const auto &p : deps.scalar_params) {
+            if (!p.second.type().is_handle()) {
+                fields.push_back(Variable::make(p.second.type(), p.first, p.second));
+            }
+        }
+
+        Expr cached = Call::make(Int(32), "halide_shape_check_cache_lookup",
+                                 {signature_var}, Call::Extern);
+        s = Block::make(IfThenElse::make(cached == 0, checks), s);
+        s = LetStmt::make(signature_name, shape_signature(fields, outputs), s);
+    } else if (!no_asserts) {
         // Inject the code that checks the constraints are correct.
         for (size_t i = asserts_constrained.size(); i > 0; i--) {
             s = Block::make(asserts_constrained[i-1], s);
@@ -616,7 +754,11 @@ Stmt add_image_checks(Stmt s,
         }
     }
 
-    if (!no_asserts) {
+    if (check_shapes_once && !asserts_proposed.empty()) {
+        // These only fail in inference mode, so only check them then.
+        Stmt checks = Block::make(asserts_proposed);
+        s = Block::make(IfThenElse::make(maybe_return_condition, checks), s);
+    } else if (!no_asserts) {
         // Inject the code that checks the proposed sizes still pass the bounds checks
         for (size_t i = asserts_proposed.size(); i > 0; i--) {
             s = Block::make(asserts_proposed[i-1], s);
@@ -641,5 +783,58 @@ Stmt add_image_checks(Stmt s,
     return s;
 }
 
+namespace {
+
+class ContainsProducerConsumer : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const ProducerConsumer *op) override {
+        result = true;
+    }
+
+public:
+    bool result = false;
+};
+
+// The body of the pipeline is guarded by the if statement injected at
+// the end of add_image_checks. Later passes rename and rewrite its
+// condition, but it stays the only top-level if without an else case
+// that produces anything.
+class StripPipelineBody : public IRMutator2 {
+    using IRMutator2::visit;
+
+    Stmt visit(const IfThenElse *op) override {
+        ContainsProducerConsumer finder;
+        op->then_case.accept(&finder);
+        if (!op->else_case.defined() && finder.result) {
+            internal_assert(!found) << "Found more than one guarded pipeline body\n";
+            found = true;
+            return Evaluate::make(0);
+        }
+        return op;
+    }
+
+    Stmt visit(const For *op) override {
+        return op;
+    }
+
+    Stmt visit(const ProducerConsumer *op) override {
+        return op;
+    }
+
+public:
+    bool found = false;
+};
+
+}  // namespace
+
+Stmt strip_to_bounds_query(Stmt s) {
+    StripPipelineBody stripper;
+    s = stripper.mutate(s);
+    internal_assert(stripper.found) << "Could not find the pipeline body to strip:\n" << s << "\n";
+    // Drops the bounds of everything the bounds query doesn't need.
+    return simplify(s);
+}
+
 }
 }
@@ -29,6 +29,11 @@ Stmt add_image_checks(Stmt s,
                       const std::map<std::string, Function> &env,
                       const FuncValueBounds &fb);
 
+/** Take a fully lowered pipeline and remove everything that only
+ * runs when none of its buffers are bounds queries, leaving the code
+ * that answers them. Used to make the <name>_bounds_query entry
+ * point. */
+Stmt strip_to_bounds_query(Stmt s);
 
 }
 }
@@ -0,0 +1,343 @@
+#include <map>
+#include <set>
+
+#include "ArenaAllocations.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Simplify.h"
+#include "Substitute.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::pair;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Each region of the arena starts on a boundary of this many bytes.
+const int arena_alignment = 64;
+
+// Only heap allocations that codegen would otherwise service with a
+// call to halide_malloc are worth moving into the arena. Constant-sized
+// allocations with no explicit memory type may end up on the stack,
+// so leave those alone.
+bool is_arena_candidate(const Allocate *op) {
+    if (op->new_expr.defined() || !op->free_function.empty()) {
+        return false;
+    }
+    if (op->memory_type == MemoryType::Heap) {
+        return true;
+    }
+    return (op->memory_type == MemoryType::Auto &&
+            Allocate::constant_allocation_size(op->extents, op->name) == 0);
+}
+
+// Check if a Stmt contains a candidate allocation outside of any loop.
+class ContainsArenaCandidate : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const For *op) override {
+    }
+
+    void visit(const Allocate *op) override {
+        if (is_arena_candidate(op)) {
+            result = true;
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+public:
+    bool result = false;
+};
+
+bool contains_arena_candidate(const Stmt &s) {
+    if (!s.defined()) {
+        return false;
+    }
+    ContainsArenaCandidate c;
+    s.accept(&c);
+    return c.result;
+}
+
+// The size of an allocation gets evaluated where the arena is
+// created, so it can't depend on anything stored in memory, and it
+// must be safe to evaluate early.
+class SizeCanBeHoisted : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Load *op) override {
+        result = false;
+    }
+
+    void visit(const Call *op) override {
+        if (!op->is_pure()) {
+            result = false;
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+public:
+    bool result = true;
+};
+
+struct ArenaRegion {
+    string name;
+    // The size in bytes, in terms of variables in scope at the arena.
+    Expr size;
+    // The lifetime of the allocation, in program order.
+    int begin, end;
+};
+
+// Walk the non-loop portion of a Stmt and find the allocations that
+// can be packed, along with their sizes and lifetimes.
+class FindArenaRegions : public IRVisitor {
+    using IRVisitor::visit;
+
+    // The LetStmts between the arena and the current node.
+    vector<pair<string, Expr>> lets;
+
+    // The regions currently live, by name.
+    map<string, size_t> live;
+
+    set<string> seen;
+    set<string> duplicated;
+    int clock = 0;
+
+    void visit(const For *op) override {
+    }
+
+    void visit(const LetStmt *op) override {
+        lets.push_back({op->name, op->value});
+        op->body.accept(this);
+        lets.pop_back();
+    }
+
+    void visit(const Allocate *op) override {
+        if (!is_arena_candidate(op)) {
+            IRVisitor::visit(op);
+            return;
+        }
+
+        if (!seen.insert(op->name).second) {
+            duplicated.insert(op->name);
+        }
+
+        // Codegen pads heap allocations by a scalar of the allocated
+        // type, as it may load one value past the end.
+        Expr size = make_const(Int(64), op->type.bytes());
+        for (const Expr &e : op->extents) {
+            size *= cast<int64_t>(e);
+        }
+        size += op->type.bytes();
+
+        // Express the size in terms of things defined at the arena.
+        for (auto it = lets.rbegin(); it != lets.rend(); it++) {
+            size = substitute(it->first, it->second, size);
+        }
+
+        SizeCanBeHoisted check;
+        size.accept(&check);
+        if (!check.result) {
+            op->body.accept(this);
+            return;
+        }
+
+        size_t idx = regions.size();
+        regions.push_back({op->name, simplify(size), clock++, -1});
+        live[op->name] = idx;
+        op->body.accept(this);
+        if (regions[idx].end < 0) {
+            regions[idx].end = clock++;
+        }
+        live.erase(op->name);
+    }
+
+    void visit(const Free *op) override {
+        auto it = live.find(op->name);
+        if (it != live.end() && regions[it->second].end < 0) {
+            // An early free marker ends the lifetime.
+            regions[it->second].end = clock++;
+        }
+    }
+
+public:
+    vector<ArenaRegion> regions;
+
+    // Names that are allocated more than once can't be told apart
+    // when rewriting, so drop them.
+    void remove_duplicates() {
+        vector<ArenaRegion> result;
+        for (const ArenaRegion &r : regions) {
+            if (!duplicated.count(r.name)) {
+                result.push_back(r);
+            }
+        }
+        regions.swap(result);
+    }
+};
+
+// Point each packed allocation into the arena.
+class UseArena : public IRMutator2 {
+    using IRMutator2::visit;
+
+    const string &arena;
+    const map<string, Expr> &offsets;
+
+    Stmt visit(const For *op) override {
+        return op;
+    }
+
+    Stmt visit(const Allocate *op) override {
+        auto it = offsets.find(op->name);
+        if (it == offsets.end() || !is_arena_candidate(op)) {
+            return IRMutator2::visit(op);
+        }
+        Expr base = reinterpret(UInt(64), Variable::make(Handle(), arena));
+        Expr ptr = reinterpret(Handle(), base + cast<uint64_t>(it->second));
+        return Allocate::make(op->name, op->type, op->memory_type, op->extents,
+                              op->condition, mutate(op->body),
+                              ptr, "halide_device_host_nop_free");
+    }
+
+public:
+    UseArena(const string &arena, const map<string, Expr> &offsets)
+        : arena(arena), offsets(offsets) {}
+};
+
+Stmt make_arena(const Stmt &s) {
+    FindArenaRegions finder;
+    s.accept(&finder);
+    finder.remove_duplicates();
+    const vector<ArenaRegion> &regions = finder.regions;
+
+    // A single allocation gains nothing from an arena.
+    if (regions.size() < 2) {
+        return s;
+    }
+
+    // Greedily place each region in the first slot that has no
+    // occupant with an overlapping lifetime. Regions are discovered in
+    // order of the start of their lifetime.
+    struct Slot {
+        Expr size;
+        vector<size_t> occupants;
+    };
+    vector<Slot> slots;
+    vector<size_t> slot_of(regions.size());
+    for (size_t i = 0; i < regions.size(); i++) {
+        const ArenaRegion &r = regions[i];
+        size_t j = 0;
+        for (; j < slots.size(); j++) {
+            bool fits = true;
+            for (size_t k : slots[j].occupants) {
+                const ArenaRegion &o = regions[k];
+                if (!(o.end < r.begin || r.end < o.begin)) {
+                    fits = false;
+                    break;
+                }
+            }
+            if (fits) break;
+        }
+        if (j == slots.size()) {
+            slots.push_back({r.size, {i}});
+        } else {
+            slots[j].size = Max::make(slots[j].size, r.size);
+            slots[j].occupants.push_back(i);
+        }
+        slot_of[i] = j;
+    }
+
+    string arena = unique_name("arena");
+    debug(3) << "Packing " << regions.size() << " allocations into "
+             << slots.size() << " slots of arena " << arena << "\n";
+
+    // The offset of each slot, and the total size of the arena, are
+    // bound in LetStmts wrapped around the arena.
+    vector<pair<string, Expr>> lets;
+    vector<Expr> slot_offsets;
+    Expr offset = make_zero(Int(64));
+    for (size_t j = 0; j < slots.size(); j++) {
+        Expr size = simplify(((slots[j].size + arena_alignment - 1) / arena_alignment) * arena_alignment);
+        if (j > 0) {
+            string name = arena + ".offset." + std::to_string(j);
+            lets.push_back({name, offset});
+            offset = Variable::make(Int(64), name);
+        }
+        slot_offsets.push_back(offset);
+        offset = offset + size;
+    }
+    string total_name = arena + ".size";
+    lets.push_back({total_name, offset});
+    Expr total = Variable::make(Int(64), total_name);
+
+    map<string, Expr> offsets;
+    for (size_t i = 0; i < regions.size(); i++) {
+        offsets[regions[i].name] = slot_offsets[slot_of[i]];
+    }
+
+    Stmt body = UseArena(arena, offsets).mutate(s);
+    Expr chunks = total / arena_alignment;
+    body = Allocate::make(arena, UInt(8), MemoryType::Heap,
+                          {arena_alignment, cast<int32_t>(chunks)},
+                          const_true(), body);
+    Expr max_size = cast<uint64_t>(Int(32).max()) * arena_alignment;
+    Expr error = Call::make(Int(32), "halide_error_buffer_allocation_too_large",
+                            {arena, cast<uint64_t>(total), max_size}, Call::Extern);
+    body = Block::make(AssertStmt::make(chunks <= Int(32).max(), error), body);
+    for (auto it = lets.rbegin(); it != lets.rend(); it++) {
+        body = LetStmt::make(it->first, it->second, body);
+    }
+    return body;
+}
+
+// Descend to the innermost statement outside of any loop that
+// contains every candidate allocation, and build the arena there. By
+// then any checks on the inputs and outputs above it have been done.
+Stmt inject_arena(const Stmt &s) {
+    if (const LetStmt *op = s.as<LetStmt>()) {
+        return LetStmt::make(op->name, op->value, inject_arena(op->body));
+    } else if (const ProducerConsumer *op = s.as<ProducerConsumer>()) {
+        return ProducerConsumer::make(op->name, op->is_producer, inject_arena(op->body));
+    } else if (const Block *op = s.as<Block>()) {
+        bool in_first = contains_arena_candidate(op->first);
+        bool in_rest = contains_arena_candidate(op->rest);
+        if (in_first && !in_rest) {
+            return Block::make(inject_arena(op->first), op->rest);
+        } else if (in_rest && !in_first) {
+            return Block::make(op->first, inject_arena(op->rest));
+        }
+    } else if (const IfThenElse *op = s.as<IfThenElse>()) {
+        bool in_then = contains_arena_candidate(op->then_case);
+        bool in_else = contains_arena_candidate(op->else_case);
+        if (in_then && !in_else) {
+            return IfThenElse::make(op->condition, inject_arena(op->then_case), op->else_case);
+        } else if (in_else && !in_then) {
+            return IfThenElse::make(op->condition, op->then_case, inject_arena(op->else_case));
+        }
+    } else if (const Allocate *op = s.as<Allocate>()) {
+        if (!is_arena_candidate(op)) {
+            return Allocate::make(op->name, op->type, op->memory_type, op->extents,
+                                  op->condition, inject_arena(op->body),
+                                  op->new_expr, op->free_function);
+        }
+    }
+    return make_arena(s);
+}
+
+}  // namespace
+
+Stmt inject_arena_allocations(Stmt s) {
+    if (!contains_arena_candidate(s)) {
+        return s;
+    }
+    return inject_arena(s);
+}
+
+}
+}
@@ -0,0 +1,25 @@
+#ifndef HALIDE_ARENA_ALLOCATIONS_H
+#define HALIDE_ARENA_ALLOCATIONS_H
+
+/** \file
+ * Defines the lowering pass that packs heap allocations into a
+ * single per-pipeline arena.
+ */
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Find the heap allocations that are made outside of any loop and
+ * whose sizes can be computed up front, and carve them all out of a
+ * single arena that is allocated once. Allocations whose lifetimes
+ * (as delimited by their Allocate node and any early Free marker) do
+ * not overlap share the same region of the arena. Must be run after
+ * inject_early_frees to get any reuse. */
+Stmt inject_arena_allocations(Stmt s);
+
+}
+}
+
+#endif
@@ -0,0 +1,239 @@
+#include "AsyncProducers.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "IRVisitor.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+Stmt semaphore_call(const string &fn, const Expr &sema) {
+    return Evaluate::make(Call::make(Int(32), fn, {sema, 1}, Call::Extern));
+}
+
+// Check that a realization of an async Func can be split into producer and
+// consumer tasks: the produce node must only be inside serial loops within
+// the realization, and must not use anything else produced within it.
+class CheckAsyncRealization : public IRVisitor {
+    using IRVisitor::visit;
+
+    const string &func;
+    vector<const For *> loops;
+    bool in_produce = false;
+    set<string> produced_outside, called_inside;
+
+    void visit(const For *op) override {
+        loops.push_back(op);
+        IRVisitor::visit(op);
+        loops.pop_back();
+    }
+
+    void visit(const ProducerConsumer *op) override {
+        if (op->is_producer && op->name == func) {
+            for (const For *loop : loops) {
+                user_assert(loop->for_type == ForType::Serial ||
+                            loop->for_type == ForType::Unrolled)
+                    << "Func " << func << " is scheduled async(), but is computed "
+                    << "within loop " << loop->name << ", which is not serial.\n";
+            }
+            in_produce = true;
+            IRVisitor::visit(op);
+            in_produce = false;
+            return;
+        }
+        if (op->is_producer && !in_produce) {
+            produced_outside.insert(op->name);
+        }
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Call *op) override {
+        if (in_produce && op->call_type == Call::Halide) {
+            called_inside.insert(op->name);
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    CheckAsyncRealization(const string &func) : func(func) {}
+
+    void check() const {
+        for (const string &f : called_inside) {
+            user_assert(!produced_outside.count(f))
+                << "Func " << func << " is scheduled async(), but uses " << f
+                << ", which is computed within the storage of " << func
+                << " by its consumer.\n";
+        }
+    }
+};
+
+// Reduce the body of a realization of an async Func to the loops and lets
+// around its produce node, and the produce node itself, releasing the
+// semaphore after each production.
+class GenerateProducerBody : public IRMutator2 {
+    using IRMutator2::visit;
+
+    const string &func;
+    Expr sema;
+
+    Stmt visit(const ProducerConsumer *op) override {
+        if (op->is_producer && op->name == func) {
+            return Block::make(op, semaphore_call("halide_semaphore_release", sema));
+        }
+        Stmt body = mutate(op->body);
+        if (is_no_op(body)) {
+            return body;
+        }
+        return ProducerConsumer::make(op->name, op->is_producer, body);
+    }
+
+    Stmt visit(const Realize *op) override {
+        Stmt body = mutate(op->body);
+        if (is_no_op(body)) {
+            return body;
+        }
+        return Realize::make(op->name, op->types, op->memory_type, op->bounds, op->condition, body);
+    }
+
+    Stmt visit(const For *op) override {
+        Stmt body = mutate(op->body);
+        if (is_no_op(body)) {
+            return body;
+        }
+        return For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+    }
+
+    Stmt visit(const LetStmt *op) override {
+        Stmt body = mutate(op->body);
+        if (is_no_op(body)) {
+            return body;
+        }
+        return LetStmt::make(op->name, op->value, body);
+    }
+
+    Stmt visit(const Block *op) override {
+        Stmt first = mutate(op->first);
+        Stmt rest = mutate(op->rest);
+        if (is_no_op(first)) {
+            return rest;
+        } else if (is_no_op(rest)) {
+            return first;
+        }
+        return Block::make(first, rest);
+    }
+
+    Stmt visit(const IfThenElse *op) override {
+        Stmt then_case = mutate(op->then_case);
+        Stmt else_case = op->else_case.defined() ? mutate(op->else_case) : Stmt();
+        if (is_no_op(then_case) && (!else_case.defined() || is_no_op(else_case))) {
+            return then_case;
+        }
+        return IfThenElse::make(op->condition, then_case, else_case);
+    }
+
+    // Everything else belongs to the consumer.
+    Stmt visit(const Provide *op) override { return Evaluate::make(0); }
+    Stmt visit(const Evaluate *op) override { return Evaluate::make(0); }
+    Stmt visit(const AssertStmt *op) override { return Evaluate::make(0); }
+    Stmt visit(const Prefetch *op) override { return Evaluate::make(0); }
+
+public:
+    GenerateProducerBody(const string &func, Expr sema) : func(func), sema(sema) {}
+};
+
+// Replace each produce node of an async Func by a wait on the semaphore.
+class GenerateConsumerBody : public IRMutator2 {
+    using IRMutator2::visit;
+
+    const string &func;
+    Expr sema;
+
+    Stmt visit(const ProducerConsumer *op) override {
+        if (op->is_producer && op->name == func) {
+            return semaphore_call("halide_semaphore_acquire", sema);
+        }
+        return IRMutator2::visit(op);
+    }
+
+public:
+    GenerateConsumerBody(const string &func, Expr sema) : func(func), sema(sema) {}
+};
+
+class ForkAsyncProducers : public IRMutator2 {
+    using IRMutator2::visit;
+
+    const map<string, Function> &env;
+
+    Stmt visit(const Realize *op) override {
+        Stmt body = mutate(op->body);
+
+        auto iter = env.find(op->name);
+        if (iter == env.end() || !iter->second.schedule().async()) {
+            if (body.same_as(op->body)) {
+                return op;
+            }
+            return Realize::make(op->name, op->types, op->memory_type, op->bounds, op->condition, body);
+        }
+        forked.insert(op->name);
+
+        CheckAsyncRealization checker(op->name);
+        body.accept(&checker);
+        checker.check();
+
+        // The semaphore counts the productions the consumer has yet to use.
+        string sema_name = op->name + ".semaphore";
+        Expr sema = Variable::make(type_of<halide_semaphore_t *>(), sema_name);
+        Stmt producer = GenerateProducerBody(op->name, sema).mutate(body);
+        Stmt consumer = GenerateConsumerBody(op->name, sema).mutate(body);
+
+        // Both tasks follow the same loops, so the consumer's n-th wait is
+        // for the producer's n-th production. The producer is task zero,
+        // which thread pools start first, and never waits, so this can't
+        // deadlock even on a single thread.
+        string task_name = op->name + ".fork";
+        Expr task = Variable::make(Int(32), task_name);
+        Stmt fork = For::make(task_name, 0, 2, ForType::Parallel, DeviceAPI::Host,
+                              IfThenElse::make(task == 0, producer, consumer));
+        Expr init = Call::make(type_of<halide_semaphore_t *>(), Call::make_struct,
+                               {make_zero(Int(32))}, Call::Intrinsic);
+        fork = LetStmt::make(sema_name, init, fork);
+
+        return Realize::make(op->name, op->types, op->memory_type, op->bounds, op->condition, fork);
+    }
+
+public:
+    set<string> forked;
+
+    ForkAsyncProducers(const map<string, Function> &env) : env(env) {}
+};
+
+}  // anonymous namespace
+
+Stmt fork_async_producers(Stmt s, const map<string, Function> &env) {
+    bool any_async = false;
+    for (const auto &iter : env) {
+        any_async = any_async || iter.second.schedule().async();
+    }
+    if (!any_async) {
+        return s;
+    }
+
+    ForkAsyncProducers forker(env);
+    s = forker.mutate(s);
+
+    for (const auto &iter : env) {
+        user_assert(!iter.second.schedule().async() || forker.forked.count(iter.first))
+            << "Func " << iter.first << " is scheduled async(), but is not computed "
+            << "at any loop level of a consumer. Outputs and inlined Funcs can't be async.\n";
+    }
+    return s;
+}
+
+}
+}
@@ -0,0 +1,26 @@
+#ifndef HALIDE_ASYNC_PRODUCERS_H
+#define HALIDE_ASYNC_PRODUCERS_H
+
+/** \file
+ * Defines the lowering pass that runs the producers of Funcs scheduled
+ * async() on another thread from their consumers.
+ */
+
+#include <map>
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Split the realization of each Func scheduled async() into a producer
+ * task, which runs the loops around the Func's produce node but only the
+ * production itself, and a consumer task, which runs everything else and
+ * waits on a semaphore in place of each production. The two tasks run as
+ * the iterations of a two-iteration parallel loop. */
+Stmt fork_async_producers(Stmt s, const std::map<std::string, Function> &env);
+
+}
+}
+
+#endif
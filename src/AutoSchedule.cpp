@@ -1,18 +1,27 @@
 #include <algorithm>
+#include <chrono>
+#include <limits>
+#include <mutex>
 #include <regex>
 
 #include "AutoSchedule.h"
+#include "Associativity.h"
 #include "AutoScheduleUtils.h"
 #include "ExprUsesVar.h"
 #include "FindCalls.h"
 #include "Func.h"
+#include "Function.h"
+#include "InferComputeWith.h"
 #include "Inline.h"
 #include "IREquality.h"
 #include "ParallelRVar.h"
+#include "Pipeline.h"
+#include "Prefetch.h"
 #include "RealizationOrder.h"
 #include "RegionCosts.h"
 #include "Scope.h"
 #include "Simplify.h"
+#include "ThreadPool.h"
 #include "Util.h"
 
 namespace Halide {
@@ -191,14 +200,89 @@ struct DependenceAnalysis {
         RegionsRequired(const DimBounds &b, const map<string, Box> &r)
             : bounds(b), regions(r) {}
     };
+    // Guards the caches below, as the Partitioner evaluates grouping choices
+    // on several threads at once.
+    std::mutex cache_mutex;
+
     // Cache for bounds queries (bound queries with the same parameters are
     // common during the grouping process).
     map<RegionsRequiredQuery, vector<RegionsRequired>> regions_required_cache;
 
+    struct StageExprQuery {
+        string f;
+        int stage;
+        // An expression in the definition of the stage, compared by identity.
+        Expr expr;
+        const Scope<Interval> *input_estimates;
+        // The bounds of the stage's loop dimensions, compared by value.
+        vector<Interval> dim_bounds;
+
+        StageExprQuery(const string &f, int stage, const Expr &expr,
+                       const Scope<Interval> *input_estimates,
+                       const vector<Interval> &dim_bounds)
+            : f(f), stage(stage), expr(expr), input_estimates(input_estimates),
+              dim_bounds(dim_bounds) {}
+
+        bool operator<(const StageExprQuery &other) const {
+            if (f != other.f) {
+                return f < other.f;
+            }
+            if (stage != other.stage) {
+                return stage < other.stage;
+            }
+            if (!expr.same_as(other.expr)) {
+                return expr.get() < other.expr.get();
+            }
+            if (input_estimates != other.input_estimates) {
+                return input_estimates < other.input_estimates;
+            }
+            if (dim_bounds.size() != other.dim_bounds.size()) {
+                return dim_bounds.size() < other.dim_bounds.size();
+            }
+            IRDeepCompare compare;
+            for (size_t i = 0; i < dim_bounds.size(); i++) {
+                const Interval &a = dim_bounds[i], &b = other.dim_bounds[i];
+                if (compare(a.min, b.min)) {
+                    return true;
+                } else if (compare(b.min, a.min)) {
+                    return false;
+                }
+                if (compare(a.max, b.max)) {
+                    return true;
+                } else if (compare(b.max, a.max)) {
+                    return false;
+                }
+            }
+            return false;
+        }
+    };
+    // Cache for the regions required by each value and argument of a stage
+    // definition. Different bounds queries keep reaching the same stages with
+    // bounds that are equal by value.
+    map<StageExprQuery, map<string, Box>> stage_expr_regions_cache;
+
+    // Return the regions required by the expression 'e' in the definition of
+    // the stage 's', given the bounds 'dim_bounds' of the loop dimensions of
+    // the stage, which are also in 'scope'.
+    map<string, Box> stage_expr_regions_required(const FStage &s, const Expr &e,
+                                                 const vector<Interval> &dim_bounds,
+                                                 const Scope<Interval> &scope,
+                                                 const Scope<Interval> *input_estimates);
+
     DependenceAnalysis(const map<string, Function> &env, const vector<string> &order,
                        const FuncValueBounds &func_val_bounds)
         : env(env), order(order), func_val_bounds(func_val_bounds) {}
 
+    // The mutex can't be moved, so this moves everything else.
+    DependenceAnalysis &operator=(DependenceAnalysis &&other) {
+        env = std::move(other.env);
+        order = std::move(other.order);
+        func_val_bounds = std::move(other.func_val_bounds);
+        regions_required_cache = std::move(other.regions_required_cache);
+        stage_expr_regions_cache = std::move(other.stage_expr_regions_cache);
+        return *this;
+    }
+
     // Return the regions of the producers ('prods') required to compute the region
     // of the function stage ('f', 'stage_num') specified by 'bounds'. When
     // 'only_regions_computed' is set to true, this only returns the computed
@@ -382,6 +466,30 @@ void merge_and_queue_regions(map<FStage, DimBounds> &fs_bounds,
     }
 }
 
+map<string, Box>
+DependenceAnalysis::stage_expr_regions_required(const FStage &s, const Expr &e,
+                                                const vector<Interval> &dim_bounds,
+                                                const Scope<Interval> &scope,
+                                                const Scope<Interval> *input_estimates) {
+    StageExprQuery query(s.func.name(), s.stage_num, e, input_estimates, dim_bounds);
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        const auto &iter = stage_expr_regions_cache.find(query);
+        if (iter != stage_expr_regions_cache.end()) {
+            return iter->second;
+        }
+    }
+
+    // Substitute the parameter estimates into the expression and get
+    // the regions required for the expression.
+    Expr subs_e = subsitute_var_estimates(e);
+    map<string, Box> regions = boxes_required(subs_e, scope, func_val_bounds);
+    substitute_estimates_region(regions);
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    stage_expr_regions_cache.emplace(query, regions);
+    return regions;
+}
+
 // Return the regions of the producers ('prods') required to compute the region
 // of the function stage ('f', 'stage_num') specified by 'bounds'.
 map<string, Box>
@@ -395,13 +503,16 @@ DependenceAnalysis::regions_required(Function f, int stage_num,
 
     // Check the cache if we've already computed this previously.
     RegionsRequiredQuery query(f.name(), stage_num, prods, only_regions_computed);
-    const auto &iter = regions_required_cache.find(query);
-    if (iter != regions_required_cache.end()) {
-        const auto &it = std::find_if(iter->second.begin(), iter->second.end(),
-            [&bounds](const RegionsRequired &r) { return (r.bounds == bounds); });
-        if (it != iter->second.end()) {
-            internal_assert((iter->first == query) && (it->bounds == bounds));
-            return it->regions;
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        const auto &iter = regions_required_cache.find(query);
+        if (iter != regions_required_cache.end()) {
+            const auto &it = std::find_if(iter->second.begin(), iter->second.end(),
+                [&bounds](const RegionsRequired &r) { return (r.bounds == bounds); });
+            if (it != iter->second.end()) {
+                internal_assert((iter->first == query) && (it->bounds == bounds));
+                return it->regions;
+            }
         }
     }
 
@@ -487,30 +598,28 @@ DependenceAnalysis::regions_required(Function f, int stage_num,
 
                     // Substitute parameter estimates into the bounds and add them to the
                     // current scope.
+                    vector<Interval> dim_bounds;
                     for (int d = 0; d < (int)dims.size() - 1; d++) {
                         Interval simple_bounds = get_element(curr_bounds, dims[d].var);
                         simple_bounds.min = subsitute_var_estimates(simple_bounds.min);
                         simple_bounds.max = subsitute_var_estimates(simple_bounds.max);
                         curr_scope.push(dims[d].var, simple_bounds);
+                        dim_bounds.push_back(simple_bounds);
                     }
 
                     // Find the regions required for each value of the current function stage,
                     // update the region map, and add them to the queue.
                     for (const auto &val : def.values()) {
-                        // Substitute the parameter estimates into the expression and get
-                        // the regions required for the expression.
-                        Expr subs_val = subsitute_var_estimates(val);
-                        map<string, Box> curr_regions = boxes_required(subs_val, curr_scope, func_val_bounds);
-                        substitute_estimates_region(curr_regions);
+                        map<string, Box> curr_regions =
+                            stage_expr_regions_required(s, val, dim_bounds, curr_scope, input_estimates);
 
                         // Arguments to the definition may require regions of functions.
                         // For example, update definitions in histograms where the bin is
                         // based on the value of a function.
                         Box left_reg;
                         for (const Expr &arg : def.args()) {
-                            Expr subs_arg = subsitute_var_estimates(arg);
-                            map<string, Box> arg_regions = boxes_required(subs_arg, curr_scope, func_val_bounds);
-                            substitute_estimates_region(arg_regions);
+                            map<string, Box> arg_regions =
+                                stage_expr_regions_required(s, arg, dim_bounds, curr_scope, input_estimates);
 
                             // Merge the regions with the regions found while looking at
                             // the values.
@@ -584,6 +693,7 @@ DependenceAnalysis::regions_required(Function f, int stage_num,
         concrete_regions[f_reg.first] = concrete_box;
     }
 
+    std::lock_guard<std::mutex> lock(cache_mutex);
     regions_required_cache[query].push_back(RegionsRequired(bounds, concrete_regions));
     return concrete_regions;
 }
@@ -722,6 +832,17 @@ map<string, Box> get_pipeline_bounds(DependenceAnalysis &analysis,
     return pipeline_bounds;
 }
 
+// An update definition that was split into independent slices with
+// rfactor before grouping (see rfactor_serial_reductions). 'directive' is
+// the string representation of the split and rfactor applied to update
+// 'update' of 'func', which returns the Func 'intermediate'.
+struct RFactoredUpdate {
+    string func;
+    int update;
+    string intermediate;
+    string directive;
+};
+
 struct AutoSchedule {
     struct Stage {
         string function;
@@ -755,6 +876,11 @@ struct AutoSchedule {
     // function stages.
     map<string, map<int, set<string>>> used_vars;
 
+    // The intermediate Funcs introduced by rfactor, in the order they were
+    // created. These are not in the original pipeline, so they are declared
+    // from the Func they were factored out of rather than by index.
+    vector<RFactoredUpdate> rfactored;
+
     AutoSchedule(const map<string, Function> &env, const vector<string> &order) : env(env) {
         for (size_t i = 0; i < order.size(); ++i) {
             topological_order.emplace(order[i], i);
@@ -789,9 +915,35 @@ struct AutoSchedule {
         std::ostringstream func_ss;
         std::ostringstream schedule_ss;
 
+        // Declare the handles to the Funcs of the original pipeline before
+        // applying any rfactor, which adds Funcs to the pipeline and so
+        // changes the indices used by get_func.
+        set<string> intermediates, declared;
+        for (const auto &r : sched.rfactored) {
+            intermediates.insert(r.intermediate);
+        }
+        for (const auto &f : sched.func_schedules) {
+            if (!intermediates.count(f.first)) {
+                func_ss << "Func " << get_sanitized_name(f.first) << " = "
+                        << sched.get_func_handle(f.first) << ";\n";
+                declared.insert(f.first);
+            }
+        }
+        for (const auto &r : sched.rfactored) {
+            if (!declared.count(r.func)) {
+                func_ss << "Func " << get_sanitized_name(r.func) << " = "
+                        << sched.get_func_handle(r.func) << ";\n";
+                declared.insert(r.func);
+            }
+        }
+        for (const auto &r : sched.rfactored) {
+            func_ss << "Func " << get_sanitized_name(r.intermediate) << " = "
+                    << get_sanitized_name(r.func) << ".update(" << r.update << ")."
+                    << r.directive << ";\n";
+        }
+
         for (const auto &f : sched.func_schedules) {
             const string &fname = get_sanitized_name(f.first);
-            func_ss << "Func " << fname << " = " << sched.get_func_handle(f.first) << ";\n";
 
             schedule_ss << "{\n";
 
@@ -1058,12 +1210,16 @@ struct Partitioner {
     RegionCosts &costs;
     // Output functions of the pipeline.
     const vector<Function> &outputs;
+    // The target the schedule is for. Groups are mapped to GPU blocks and
+    // threads if it has a GPU feature.
+    const Target &target;
 
     Partitioner(const map<string, Box> &_pipeline_bounds,
                 const MachineParams &_arch_params,
                 const vector<Function> &_outputs,
                 DependenceAnalysis &_dep_analysis,
-                RegionCosts &_costs);
+                RegionCosts &_costs,
+                const Target &_target);
 
     void initialize_groups();
 
@@ -1157,6 +1313,14 @@ struct Partitioner {
         const FStage &stg, const map<string, Box> &parent_bounds,
         const set<string> &inlines = set<string>());
 
+    // Return the stride of each access in a function stage along each of the
+    // loop variables, as a list of (allocation, stride) pairs per variable.
+    // The last pair in each list is the store. Return an empty map if it
+    // can't figure out any of the strides.
+    map<string, vector<pair<string, Expr>>> analyze_access_strides(
+        const FStage &stg, const map<string, Box> &allocation_bounds,
+        const set<string> &inlines = set<string>());
+
     map<string, Expr> evaluate_reuse(const FStage &stg, const set<string> &prods);
 
     // Generate and apply schedules for all functions within a pipeline by
@@ -1197,6 +1361,26 @@ struct Partitioner {
         Function func, bool is_group_output, const Target &t, set<string> &rvars,
         map<string, Expr> &estimates, AutoSchedule &sched);
 
+    // Map the innermost loops 'thread_dims' of stage 'f_handle' to GPU threads,
+    // and the loops 'block_dims' immediately outside them to GPU blocks. Each
+    // list is cut short at the first loop that can't run in parallel, and at
+    // three loops. Returns false and schedules nothing if there would be no
+    // threads, or no blocks when 'need_blocks' is set.
+    bool gpu_map_stage(Stage f_handle, int stage_num, const Definition &def,
+                       const Function &func,
+                       const vector<VarOrRVar> &thread_dims,
+                       const vector<VarOrRVar> &block_dims, bool need_blocks,
+                       AutoSchedule &sched);
+
+    // If automatic prefetching is enabled, prefetch ahead in the innermost
+    // serial loop of the output stage of group 'g' for each read of another
+    // group or an input whose stride along that loop is too large for the
+    // hardware prefetcher. 'strides' are the strides of the accesses along
+    // each loop variable of the stage before it was tiled.
+    void prefetch_stage(const Group &g, Stage f_handle, const Definition &def,
+                        const map<string, vector<pair<string, Expr>>> &strides,
+                        AutoSchedule &sched);
+
     // Reorder the dimensions to preserve spatial locality. This function
     // checks the stride of each access. The dimensions of the loop are reordered
     // such that the dimension with the smallest access stride is innermost.
@@ -1303,9 +1487,11 @@ Partitioner::Partitioner(const map<string, Box> &_pipeline_bounds,
                          const MachineParams &_arch_params,
                          const vector<Function> &_outputs,
                          DependenceAnalysis &_dep_analysis,
-                         RegionCosts &_costs)
+                         RegionCosts &_costs,
+                         const Target &_target)
         : pipeline_bounds(_pipeline_bounds), arch_params(_arch_params),
-          dep_analysis(_dep_analysis), costs(_costs), outputs(_outputs) {
+          dep_analysis(_dep_analysis), costs(_costs), outputs(_outputs),
+          target(_target) {
     // Place each stage of a function in its own group. Each stage is
     // a node in the pipeline graph.
     for (const auto &f : dep_analysis.env) {
@@ -1407,6 +1593,61 @@ Partitioner::choose_candidate_grouping(const vector<pair<string, string>> &cands
                                        Partitioner::Level level) {
     vector<pair<GroupingChoice, GroupConfig>> best_grouping;
     Expr best_benefit = make_zero(Int(64));
+
+    // Evaluate all the choices not already in the cache on a pool of
+    // threads. The choices are independent, and they are added to the cache
+    // in a fixed order, so the result doesn't depend on the scheduling of
+    // the threads.
+    vector<GroupingChoice> new_choices;
+    set<GroupingChoice> seen;
+    for (const auto &p : cands) {
+        const Function &prod_f = get_element(dep_analysis.env, p.first);
+        FStage prod(prod_f, prod_f.updates().size());
+        for (const FStage &c : get_element(children, prod)) {
+            GroupingChoice cand_choice(prod_f.name(), c);
+            if (grouping_cache.find(cand_choice) == grouping_cache.end() &&
+                seen.insert(cand_choice).second) {
+                new_choices.push_back(cand_choice);
+            }
+        }
+    }
+    if (new_choices.size() > 1) {
+        // Errors on the workers are rethrown here.
+        vector<std::exception_ptr> errors(new_choices.size());
+        vector<std::future<GroupConfig>> configs;
+        {
+            size_t threads = std::min(new_choices.size(), ThreadPool<GroupConfig>::num_processors_online());
+            ThreadPool<GroupConfig> pool(std::max(threads, (size_t)1));
+            for (size_t i = 0; i < new_choices.size(); i++) {
+                GroupingChoice choice = new_choices[i];
+                std::exception_ptr *error = &errors[i];
+                configs.push_back(pool.async([this, choice, level, error]() -> GroupConfig {
+#ifdef WITH_EXCEPTIONS
+                    try {
+                        return evaluate_choice(choice, level);
+                    } catch (...) {
+                        *error = std::current_exception();
+                        return GroupConfig();
+                    }
+#else
+                    return evaluate_choice(choice, level);
+#endif
+                }));
+            }
+            for (auto &c : configs) {
+                c.wait();
+            }
+        }
+        for (const auto &e : errors) {
+            if (e) {
+                std::rethrow_exception(e);
+            }
+        }
+        for (size_t i = 0; i < new_choices.size(); i++) {
+            grouping_cache.emplace(new_choices[i], configs[i].get());
+        }
+    }
+
     for (const auto &p : cands) {
         // Compute the aggregate benefit of inlining into all the children.
         vector<pair<GroupingChoice, GroupConfig>> grouping;
@@ -1497,6 +1738,32 @@ vector<map<string, Expr>> Partitioner::generate_tile_configs(const FStage &stg)
     vector<int> size_variants = {1, 4, 8, 16, 32, 64, 128, 256};
     vector<map<string, Expr>> tile_configs;
 
+    if (target.has_gpu_feature()) {
+        // Each tile becomes a GPU block with a thread per point. Keep the
+        // innermost extent of the tile a multiple of the warp size (32), so
+        // that accesses along it coalesce, and the number of threads between
+        // two warps and the maximum block size, so that enough warps are
+        // resident on each core to hide memory latency.
+        const int min_threads = 64, max_threads = 1024;
+        for (int inner : {32, 64, 128, 256}) {
+            for (int outer : {1, 2, 4, 8, 16, 32}) {
+                if (tile_vars.size() < 2 && outer > 1) {
+                    break;
+                }
+                int threads = inner * outer;
+                if (tile_vars.empty() || threads < min_threads || threads > max_threads) {
+                    continue;
+                }
+                map<string, Expr> tiling;
+                for (size_t j = 0; j < tile_vars.size(); j++) {
+                    tiling.emplace(tile_vars[j], (j == 0) ? inner : (j == 1) ? outer : 1);
+                }
+                tile_configs.push_back(tiling);
+            }
+        }
+        return tile_configs;
+    }
+
     // For all the tile configurations generated, we force the innermost dimension
     // to be at least of size 64 to ensure enough values for vectorization.
 
@@ -1608,7 +1875,11 @@ Partitioner::find_best_tile_config(const Group &g) {
                 << ", mem cost:" << cast<float>(new_analysis.cost.memory / no_tile_analysis.cost.memory) << '\n';
         }
 
-        if (benefit.defined() && can_prove(benefit > 0)) {
+        // An untiled group can't be mapped to GPU blocks and threads, so on
+        // GPU targets any tiling that is no worse beats no tiling.
+        bool prefer_tiling = target.has_gpu_feature() && best_config.empty();
+        if (benefit.defined() &&
+            (can_prove(benefit > 0) || (prefer_tiling && can_prove(benefit >= 0)))) {
             best_config = config;
             best_analysis = new_analysis;
             best_group = new_group;
@@ -2413,6 +2684,9 @@ pair<VarOrRVar, VarOrRVar> Partitioner::split_dim(
         case TailStrategy::ShiftInwards:
             oss << ", TailStrategy::ShiftInwards)";
             break;
+        case TailStrategy::Predicate:
+            oss << ", TailStrategy::Predicate)";
+            break;
         case TailStrategy::Auto:
             oss << ")";
             break;
@@ -2633,6 +2907,154 @@ public :
     }
 };
 
+// Collect the parameters of the images called in an IR node.
+class FindImageParams : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Call *call) {
+        IRVisitor::visit(call);
+        if (call->call_type == Call::Image && call->param.defined()) {
+            params.emplace(call->name, call->param);
+        }
+    }
+public:
+    map<string, Parameter> params;
+};
+
+void Partitioner::prefetch_stage(const Group &g, Stage f_handle, const Definition &def,
+                                 const map<string, vector<pair<string, Expr>>> &strides,
+                                 AutoSchedule &sched) {
+    int distance = auto_prefetch_distance(target);
+    if (distance <= 0 || strides.empty()) {
+        return;
+    }
+
+    // Find the innermost serial loop, and the variable of the original
+    // definition it was split from.
+    const vector<Dim> &dims = def.schedule().dims();
+    int d = 0;
+    while ((d < (int)dims.size() - 1) && (dims[d].for_type != ForType::Serial)) {
+        d++;
+    }
+    if (d == (int)dims.size() - 1) {
+        return;
+    }
+    string loop_var = get_base_name(dims[d].var);
+    string var = loop_var;
+    const vector<Split> &splits = def.schedule().splits();
+    for (int i = (int)splits.size() - 1; i >= 0; i--) {
+        const Split &split = splits[i];
+        if (split.is_fuse()) {
+            if (get_base_name(split.old_var) == var) {
+                return;
+            }
+        } else if ((get_base_name(split.outer) == var) ||
+                   (split.is_split() && (get_base_name(split.inner) == var))) {
+            var = get_base_name(split.old_var);
+        }
+    }
+
+    const vector<pair<string, Expr>> *var_strides = nullptr;
+    for (const auto &iter : strides) {
+        if (get_base_name(iter.first) == var) {
+            var_strides = &iter.second;
+        }
+    }
+    if (!var_strides) {
+        return;
+    }
+
+    FindImageParams find;
+    def.accept(&find);
+    for (const string &f : g.inlined) {
+        get_element(dep_analysis.env, f).accept(&find);
+    }
+
+    set<string> skip;
+    for (const FStage &mem : g.members) {
+        skip.insert(mem.func.name());
+    }
+
+    // The last access is the store, which isn't prefetched.
+    VarOrRVar v(loop_var, dims[d].is_rvar());
+    for (size_t i = 0; i + 1 < var_strides->size(); i++) {
+        const string &name = (*var_strides)[i].first;
+        const Expr &stride = (*var_strides)[i].second;
+        if (skip.count(name) || !can_prove(stride >= auto_prefetch_min_stride_bytes)) {
+            continue;
+        }
+        skip.insert(name);
+
+        string args = ", " + loop_var + ", " + std::to_string(distance) + ")";
+        const auto &iter = dep_analysis.env.find(name);
+        if (iter != dep_analysis.env.end()) {
+            f_handle.prefetch(Func(iter->second), v, distance);
+            sched.push_schedule(f_handle.name(), g.output.stage_num,
+                                "prefetch(" + get_sanitized_name(name) + args, {loop_var});
+        } else if (find.params.count(name)) {
+            f_handle.prefetch(find.params.at(name), v, distance);
+            sched.push_schedule(f_handle.name(), g.output.stage_num,
+                                "prefetch(" + name + args, {loop_var});
+        }
+    }
+}
+
+bool Partitioner::gpu_map_stage(Stage f_handle, int stage_num,
+                                const Definition &def, const Function &func,
+                                const vector<VarOrRVar> &thread_dims,
+                                const vector<VarOrRVar> &block_dims,
+                                bool need_blocks, AutoSchedule &sched) {
+    auto parallel_prefix = [&](const vector<VarOrRVar> &vars) {
+        vector<VarOrRVar> prefix;
+        for (const VarOrRVar &v : vars) {
+            if ((prefix.size() == 3) ||
+                (v.is_rvar && !can_parallelize_rvar(v.name(), func.name(), def))) {
+                break;
+            }
+            prefix.push_back(v);
+        }
+        return prefix;
+    };
+
+    vector<VarOrRVar> threads = parallel_prefix(thread_dims);
+    vector<VarOrRVar> blocks = parallel_prefix(block_dims);
+    if (threads.empty() || (need_blocks && blocks.empty())) {
+        return false;
+    }
+
+    auto record = [&](const string &directive, const vector<VarOrRVar> &vars) {
+        string var_order = vars[0].name();
+        set<string> var_list = {vars[0].name()};
+        for (size_t i = 1; i < vars.size(); i++) {
+            var_order += ", " + vars[i].name();
+            var_list.insert(vars[i].name());
+        }
+        sched.push_schedule(f_handle.name(), stage_num,
+                            directive + "(" + var_order + ")", var_list);
+    };
+
+    if (threads.size() == 1) {
+        f_handle.gpu_threads(threads[0]);
+    } else if (threads.size() == 2) {
+        f_handle.gpu_threads(threads[0], threads[1]);
+    } else {
+        f_handle.gpu_threads(threads[0], threads[1], threads[2]);
+    }
+    record("gpu_threads", threads);
+
+    if (blocks.size() == 1) {
+        f_handle.gpu_blocks(blocks[0]);
+    } else if (blocks.size() == 2) {
+        f_handle.gpu_blocks(blocks[0], blocks[1]);
+    } else if (blocks.size() == 3) {
+        f_handle.gpu_blocks(blocks[0], blocks[1], blocks[2]);
+    }
+    if (!blocks.empty()) {
+        record("gpu_blocks", blocks);
+    }
+    return true;
+}
+
 void Partitioner::generate_group_cpu_schedule(
         const Group &g, const Target &t,
         const map<FStage, DimBounds> &group_loop_bounds,
@@ -2699,6 +3121,13 @@ void Partitioner::generate_group_cpu_schedule(
         }
     }
 
+    // Remember the strides of the accesses along each loop before tiling,
+    // to decide what to prefetch once the loops are scheduled.
+    map<string, vector<pair<string, Expr>>> access_strides;
+    if (auto_prefetch_distance(target) > 0) {
+        access_strides = analyze_access_strides(g.output, group_storage_bounds, inlines);
+    }
+
     vector<string> dim_vars(dims.size() - 1);
     for (int d = 0; d < (int)dims.size() - 1; d++) {
         dim_vars[d] = get_base_name(dims[d].var);
@@ -2760,65 +3189,103 @@ void Partitioner::generate_group_cpu_schedule(
         }
     }
 
-    vectorize_stage(g, f_handle, g.output.stage_num, def, g_out, true, t,
-                    rvars, stg_estimates, sched);
+    // On GPU targets, each tile of the output becomes a block with a thread
+    // per point, in place of the vectorized and parallel loops below.
+    bool on_gpu = false;
+    if (t.has_gpu_feature() && !inner_dims.empty()) {
+        bool has_members = false;
+        for (const FStage &mem : g.members) {
+            if ((g.inlined.find(mem.func.name()) == g.inlined.end()) &&
+                (mem.func.name() != g_out.name())) {
+                has_members = true;
+            }
+        }
 
-    // Parallelize definition
-    Expr def_par = 1;
-    // TODO: Investigate if it is better to pull one large dimension and
-    // parallelize over it or to generate nested parallelism.
-    //
-    // Go from the outer to the innermost loop until sufficient parallelism
-    // is achieved. Stop the search once we find a vectorized dimension since
-    // it doesn't make any sense to have a parallelized inner loop within a
-    // vectorized outer loop.
-    bool nested_parallelism = true;
-    if (nested_parallelism) {
-        int dim_start = dims.size() - 2;
-        string seq_var = "";
-        for (int d = dim_start; d >= 0; d--) {
-            if (dims[d].for_type == ForType::Vectorized) {
-                break;
+        vector<VarOrRVar> thread_dims = inner_dims;
+        vector<VarOrRVar> block_dims = outer_dims;
+        if (outer_dims.empty() && !has_members) {
+            // Nothing was tiled, so split the innermost loop into blocks of
+            // threads instead.
+            const VarOrRVar v = inner_dims[0];
+            const auto &iter = stg_estimates.find(v.name());
+            if ((iter != stg_estimates.end()) && iter->second.defined() &&
+                can_prove(iter->second > 64) &&
+                (!v.is_rvar || can_parallelize_rvar(v.name(), g_out.name(), def))) {
+                pair<VarOrRVar, VarOrRVar> split_vars =
+                    split_dim(g, f_handle, g.output.stage_num, def, true, v, 64,
+                              "_i", "_o", stg_estimates, sched);
+                thread_dims = {split_vars.first};
+                block_dims = {split_vars.second};
+                block_dims.insert(block_dims.end(), inner_dims.begin() + 1, inner_dims.end());
             }
+        }
+        on_gpu = gpu_map_stage(f_handle, g.output.stage_num, def, g_out,
+                               thread_dims, block_dims, true, sched);
+    }
 
-            string var = get_base_name(dims[d].var);
-            bool is_rvar = (rvars.find(var) != rvars.end());
-            internal_assert(is_rvar == dims[d].is_rvar());
-            VarOrRVar v(var, is_rvar);
+    if (!on_gpu) {
+        vectorize_stage(g, f_handle, g.output.stage_num, def, g_out, true, t,
+                        rvars, stg_estimates, sched);
 
-            if (is_rvar && !can_parallelize_rvar(var, g_out.name(), def)) {
-                if (seq_var == "") {
-                    seq_var = var;
+        // Parallelize definition
+        Expr def_par = 1;
+        // TODO: Investigate if it is better to pull one large dimension and
+        // parallelize over it or to generate nested parallelism.
+        //
+        // Go from the outer to the innermost loop until sufficient parallelism
+        // is achieved. Stop the search once we find a vectorized dimension since
+        // it doesn't make any sense to have a parallelized inner loop within a
+        // vectorized outer loop.
+        bool nested_parallelism = true;
+        if (nested_parallelism) {
+            int dim_start = dims.size() - 2;
+            string seq_var = "";
+            for (int d = dim_start; d >= 0; d--) {
+                if (dims[d].for_type == ForType::Vectorized) {
+                    break;
                 }
-                continue;
-            }
 
-            if (can_prove(def_par >= arch_params.parallelism)) {
-                // Enough parallelism to saturate target machine
-                break;
-            }
+                string var = get_base_name(dims[d].var);
+                bool is_rvar = (rvars.find(var) != rvars.end());
+                internal_assert(is_rvar == dims[d].is_rvar());
+                VarOrRVar v(var, is_rvar);
+
+                if (is_rvar && !can_parallelize_rvar(var, g_out.name(), def)) {
+                    if (seq_var == "") {
+                        seq_var = var;
+                    }
+                    continue;
+                }
+
+                if (can_prove(def_par >= arch_params.parallelism)) {
+                    // Enough parallelism to saturate target machine
+                    break;
+                }
 
-            const auto &iter = stg_estimates.find(var);
-            if ((iter != stg_estimates.end()) && iter->second.defined()) {
-                if (seq_var != "") {
-                    VarOrRVar seq(seq_var, (rvars.find(seq_var) != rvars.end()));
-                    f_handle.reorder(seq, v);
+                const auto &iter = stg_estimates.find(var);
+                if ((iter != stg_estimates.end()) && iter->second.defined()) {
+                    if (seq_var != "") {
+                        VarOrRVar seq(seq_var, (rvars.find(seq_var) != rvars.end()));
+                        f_handle.reorder(seq, v);
+                        sched.push_schedule(f_handle.name(), g.output.stage_num,
+                                            "reorder(" + seq_var + ", " + var + ")",
+                                            {seq_var, var});
+                    }
+                    f_handle.parallel(v);
                     sched.push_schedule(f_handle.name(), g.output.stage_num,
-                                        "reorder(" + seq_var + ", " + var + ")",
-                                        {seq_var, var});
+                                        "parallel(" + var + ")", {var});
+                    def_par = simplify(def_par * iter->second);
+                } else {
+                    break;
                 }
-                f_handle.parallel(v);
-                sched.push_schedule(f_handle.name(), g.output.stage_num,
-                                    "parallel(" + var + ")", {var});
-                def_par = simplify(def_par * iter->second);
-            } else {
-                break;
             }
         }
-    }
 
-    if (can_prove(def_par < arch_params.parallelism)) {
-        user_warning << "Insufficient parallelism for " << f_handle.name() << '\n';
+        if (can_prove(def_par < arch_params.parallelism)) {
+            user_warning << "Insufficient parallelism for " << f_handle.name() << '\n';
+        }
+
+        prefetch_stage(g, f_handle, def, access_strides, sched);
     }
 
     // Find the level at which group members will be computed.
@@ -2887,6 +3354,31 @@ void Partitioner::generate_group_cpu_schedule(
             }
         }
 
+        if (on_gpu) {
+            // Members computed within a block are stored in shared memory if
+            // they provably fit, and computed by the threads of the block.
+            const auto &iter = group_storage_bounds.find(mem.func.name());
+            if ((mem.stage_num == 0) && !outer_dims.empty() &&
+                (iter != group_storage_bounds.end())) {
+                Expr footprint = costs.region_size(mem.func.name(), iter->second);
+                if (footprint.defined() && can_prove(footprint <= 48 * 1024)) {
+                    Func(mem.func).store_in(MemoryType::GPUShared);
+                    sched.push_schedule(mem_handle.name(), mem.stage_num,
+                                        "store_in(MemoryType::GPUShared)", {});
+                }
+            }
+
+            vector<VarOrRVar> mem_thread_dims;
+            for (int d = 0; d < (int)mem_dims.size() - 1; d++) {
+                mem_thread_dims.push_back(
+                    VarOrRVar(get_base_name(mem_dims[d].var), mem_dims[d].is_rvar()));
+            }
+            if (gpu_map_stage(mem_handle, mem.stage_num, mem_def, mem.func,
+                              mem_thread_dims, {}, false, sched)) {
+                continue;
+            }
+        }
+
         vectorize_stage(g, mem_handle, mem.stage_num, mem_def, mem.func, false,
                         t, mem_rvars, mem_estimates, sched);
     }
@@ -2968,6 +3460,26 @@ map<string, Expr>
 Partitioner::analyze_spatial_locality(const FStage &stg,
                                       const map<string, Box> &allocation_bounds,
                                       const set<string> &inlines) {
+    map<string, vector<pair<string, Expr>>> access_strides =
+        analyze_access_strides(stg, allocation_bounds, inlines);
+
+    // Map for holding the strides across each dimension
+    map<string, Expr> var_strides;
+    for (const auto &iter : access_strides) {
+        // Accumulate the stride of each access to a loop dimension.
+        Expr total_stride = 0;
+        for (const pair<string, Expr> &access : iter.second) {
+            total_stride += access.second;
+        }
+        var_strides.emplace(iter.first, simplify(total_stride));
+    }
+    return var_strides;
+}
+
+map<string, vector<pair<string, Expr>>>
+Partitioner::analyze_access_strides(const FStage &stg,
+                                    const map<string, Box> &allocation_bounds,
+                                    const set<string> &inlines) {
     internal_assert(!stg.func.has_extern_definition());
     // Handle inlining. When a function is inlined into another, the stride of
     // the accesses should be computed on the expression post inlining.
@@ -3003,8 +3515,7 @@ Partitioner::analyze_spatial_locality(const FStage &stg,
     // left hand side to call_args.
     call_args.push_back(make_pair(stg.func.name(), def.args()));
 
-    // Map for holding the strides across each dimension
-    map<string, Expr> var_strides;
+    map<string, vector<pair<string, Expr>>> var_strides;
     const vector<Dim> &dims = def.schedule().dims();
 
     for (int d = 0; d < (int)dims.size() - 1; d++) {
@@ -3012,8 +3523,7 @@ Partitioner::analyze_spatial_locality(const FStage &stg,
         FindVarsUsingVar dep_vars(dims[d].var);
         def.accept(&dep_vars);
 
-        // Accumulate the stride of each access to a loop dimension.
-        Expr total_stride = 0;
+        vector<pair<string, Expr>> &strides = var_strides[dims[d].var];
         for (const pair<string, vector<Expr>> &call : call_args) {
             Box call_alloc_reg;
             const auto &iter = allocation_bounds.find(call.first);
@@ -3025,11 +3535,10 @@ Partitioner::analyze_spatial_locality(const FStage &stg,
             Expr current_stride = find_max_access_stride(dep_vars.vars, call.first,
                                                          call.second, call_alloc_reg);
             if (!current_stride.defined()) {
-                return map<string, Expr>();
+                return map<string, vector<pair<string, Expr>>>();
             }
-            total_stride += current_stride;
+            strides.push_back(make_pair(call.first, current_stride));
         }
-        var_strides.emplace(dims[d].var, simplify(total_stride));
     }
 
     return var_strides;
@@ -3320,13 +3829,147 @@ bool inline_unbounded(const vector<Function> &outputs,
     return inlined;
 }
 
+// Find the estimated extent of a pure dimension of an output, or an
+// undefined Expr if there isn't one.
+Expr output_estimate(const Function &f, const string &var) {
+    const vector<Bound> &estimates = f.schedule().estimates();
+    for (int i = (int)estimates.size() - 1; i >= 0; --i) {
+        if (estimates[i].var == var && estimates[i].extent.defined()) {
+            return estimates[i].extent;
+        }
+    }
+    return Expr();
+}
+
+// Apply rfactor to the large associative reductions in the pipeline that
+// can't otherwise occupy the machine: update definitions whose pure
+// dimensions have fewer points than there are cores, and none of whose
+// reduction variables can be parallelized directly. The outermost
+// reduction variable is split into 'parallelism' slices, which are
+// computed independently by a new intermediate Func and then merged by the
+// original update. The partitioner then schedules the intermediate like
+// any other Func, which parallelizes it across the slices. Only one update
+// of a Func is factored, since rfactor names the intermediate after the
+// Func. The rfactors applied are appended to 'rfactored', and the Vars
+// and RVars they introduce are added to 'internal_vars'. Returns true if
+// any Func was changed.
+bool rfactor_serial_reductions(const vector<Function> &outputs,
+                               const map<string, Function> &env,
+                               const MachineParams &params,
+                               vector<RFactoredUpdate> &rfactored,
+                               map<string, VarOrRVar> &internal_vars) {
+    // Don't bother unless each slice does enough work to amortize
+    // launching a task and merging its result.
+    const int64_t min_work_per_slice = 1024;
+
+    const int64_t *parallelism = as_const_int(params.parallelism);
+    if (!parallelism || *parallelism < 2) {
+        return false;
+    }
+
+    bool changed = false;
+    for (const auto &iter : env) {
+        Function f = iter.second;
+        bool is_output = false;
+        for (const Function &o : outputs) {
+            is_output = is_output || o.same_as(f);
+        }
+
+        for (size_t u = 0; u < f.updates().size(); u++) {
+            const Definition &def = f.update(u);
+            const vector<ReductionVariable> &rvars = def.schedule().rvars();
+            if (rvars.empty() || f.has_extern_definition() ||
+                !prove_associativity(f.name(), def.args(), def.values()).associative()) {
+                continue;
+            }
+
+            bool any_parallel_rvar = false;
+            int64_t reduction_size = 1;
+            for (const ReductionVariable &rv : rvars) {
+                any_parallel_rvar = any_parallel_rvar || can_parallelize_rvar(rv.var, f.name(), def);
+                const int64_t *extent = as_const_int(simplify(subsitute_var_estimates(rv.extent)));
+                reduction_size = extent ? reduction_size * (*extent) : -1;
+                if (reduction_size < 0) {
+                    break;
+                }
+            }
+            if (any_parallel_rvar || reduction_size < 0) {
+                continue;
+            }
+
+            // Count the points of the pure dimensions of the update. This is
+            // only known for outputs, unless there are no pure dimensions.
+            int64_t pure_size = 1;
+            for (const Expr &arg : def.args()) {
+                const Variable *v = arg.as<Variable>();
+                if (!v || v->reduction_domain.defined()) {
+                    continue;
+                }
+                Expr est = is_output ? output_estimate(f, v->name) : Expr();
+                const int64_t *extent = est.defined() ? as_const_int(simplify(est)) : nullptr;
+                pure_size = extent ? pure_size * (*extent) : -1;
+                if (pure_size < 0) {
+                    break;
+                }
+            }
+            if (pure_size < 0 || pure_size >= *parallelism) {
+                continue;
+            }
+
+            const ReductionVariable &outer = rvars.back();
+            const int64_t outer_extent = *as_const_int(simplify(subsitute_var_estimates(outer.extent)));
+            if (outer_extent < *parallelism ||
+                reduction_size < *parallelism * min_work_per_slice) {
+                continue;
+            }
+
+            const int64_t factor = (outer_extent + *parallelism - 1) / *parallelism;
+            const string base = get_sanitized_name(outer.var);
+            RVar rvo(base + "_rfo"), rvi(base + "_rfi");
+            Var v(base + "_rfu");
+            internal_vars.emplace(rvo.name(), VarOrRVar(rvo));
+            internal_vars.emplace(rvi.name(), VarOrRVar(rvi));
+            internal_vars.emplace(v.name(), VarOrRVar(v));
+
+            debug(2) << "rfactor " << f.name() << ".update(" << u << ") over "
+                     << outer.var << " into " << *parallelism << " slices\n";
+            Stage stage = Func(f).update(u);
+            stage.split(RVar(outer.var), rvo, rvi, (int)factor);
+            Func intm = stage.rfactor(rvo, v);
+
+            std::ostringstream oss;
+            oss << "split(RVar(" << get_sanitized_name(f.name()) << ".update(" << u
+                << ").get_schedule().rvars()[" << rvars.size() - 1 << "].var), "
+                << rvo.name() << ", " << rvi.name() << ", " << factor << ")"
+                << ".rfactor(" << rvo.name() << ", " << v.name() << ")";
+            rfactored.push_back({f.name(), (int)u, intm.name(), oss.str()});
+            changed = true;
+            break;
+        }
+    }
+    return changed;
+}
+
 } // anonymous namespace
 
 // Generate schedules for all functions in the pipeline required to compute the
 // outputs. This applies the schedules and returns a string representation of
 // the schedules. The target architecture is specified by 'target'.
 string generate_schedules(const vector<Function> &outputs, const Target &target,
-                          const MachineParams &arch_params) {
+                          const MachineParams &machine_params) {
+    // Use the calibrated cost model in place of the default heuristic if
+    // there is one.
+    CostModel cost_model;
+    MachineParams arch_params = machine_params;
+    string cost_model_file = get_env_variable("HL_AUTOSCHEDULE_COST_MODEL");
+    if (!cost_model_file.empty()) {
+        debug(2) << "Loading cost model from " << cost_model_file << "...\n";
+        cost_model = CostModel::from_file(cost_model_file);
+        if (cost_model.balance.defined()) {
+            arch_params.balance = cost_model.balance;
+        }
+    }
+
     // Make an environment map which is used throughout the auto scheduling process.
     map<string, Function> env;
     for (Function f : outputs) {
@@ -3410,6 +4053,22 @@ string generate_schedules(const vector<Function> &outputs, const Target &target,
         order = realization_order(outputs, env).first;
     }
 
+    // Split large serial reductions into slices that can be computed in
+    // parallel on the CPU. This adds Funcs to the pipeline, so we need to
+    // recompute 'env' and the realization order.
+    debug(2) << "Applying rfactor to serial reductions...\n";
+    vector<RFactoredUpdate> rfactored;
+    map<string, VarOrRVar> rfactor_vars;
+    if (!target.has_gpu_feature() &&
+        rfactor_serial_reductions(outputs, env, arch_params, rfactored, rfactor_vars)) {
+        env.clear();
+        for (Function f : outputs) {
+            map<string, Function> more_funcs = find_transitive_calls(f);
+            env.insert(more_funcs.begin(), more_funcs.end());
+        }
+        order = realization_order(outputs, env).first;
+    }
+
     // Compute the bounds of function values which are used for dependence analysis.
     debug(2) << "Computing function value bounds...\n";
     FuncValueBounds func_val_bounds = compute_function_value_bounds(order, env);
@@ -3417,7 +4076,7 @@ string generate_schedules(const vector<Function> &outputs, const Target &target,
     // Initialize the cost model.
     // Compute the expression costs for each function in the pipeline.
     debug(2) << "Initializing region costs...\n";
-    RegionCosts costs(env);
+    RegionCosts costs(env, cost_model);
     if (debug::debug_level() >= 3) {
         costs.disp_func_costs();
     }
@@ -3452,7 +4111,7 @@ string generate_schedules(const vector<Function> &outputs, const Target &target,
         debug(2) << "Re-computing function value bounds...\n";
         func_val_bounds = compute_function_value_bounds(order, env);
         debug(2) << "Re-initializing region costs...\n";
-        RegionCosts costs(env);
+        RegionCosts costs(env, cost_model);
         debug(2) << "Re-initializing dependence analysis...\n";
         dep_analysis = DependenceAnalysis(env, order, func_val_bounds);
         debug(2) << "Re-computing pipeline bounds...\n";
@@ -3460,7 +4119,7 @@ string generate_schedules(const vector<Function> &outputs, const Target &target,
     }
 
     debug(2) << "Initializing partitioner...\n";
-    Partitioner part(pipeline_bounds, arch_params, outputs, dep_analysis, costs);
+    Partitioner part(pipeline_bounds, arch_params, outputs, dep_analysis, costs, target);
 
     // Compute and display reuse
     /* TODO: Use the reuse estimates to reorder loops
@@ -3509,12 +4168,32 @@ string generate_schedules(const vector<Function> &outputs, const Target &target,
 
     debug(2) << "Initializing AutoSchedule...\n";
     AutoSchedule sched(env, top_order);
-    debug(2) << "Generating CPU schedule...\n";
+    sched.rfactored = rfactored;
+    sched.internal_vars.insert(rfactor_vars.begin(), rfactor_vars.end());
+    debug(2) << (target.has_gpu_feature() ? "Generating GPU schedule...\n"
+                                           : "Generating CPU schedule...\n");
     part.generate_cpu_schedule(target, sched);
 
+    // Fuse the loops of sibling Funcs that read the same inputs.
+    if (target.has_feature(Target::InferComputeWith)) {
+        for (const ComputeWithGroup &group : find_compute_with_groups(outputs, env)) {
+            Func parent(get_element(env, group.parent));
+            for (const string &name : group.fused) {
+                Func(get_element(env, name)).compute_with(parent, Var(group.var));
+                sched.push_schedule(name, 0,
+                                    "compute_with(" + get_sanitized_name(group.parent) +
+                                    ", " + group.var + ")",
+                                    {group.var});
+            }
+        }
+    }
+
     std::ostringstream oss;
     oss << "// Target: " << target.to_string() << "\n";
     oss << "// MachineParams: " << arch_params.to_string() << "\n";
+    if (!cost_model_file.empty()) {
+        oss << "// CostModel: " << cost_model_file << "\n";
+    }
     oss << "\n";
     oss << sched;
     string sched_string = oss.str();
@@ -3523,12 +4202,329 @@ string generate_schedules(const vector<Function> &outputs, const Target &target,
              << "*******************************\n" << sched_string << "\n\n";
 
     // TODO: Unify both inlining and grouping for fast mem
-    // TODO: GPU scheduling
     // TODO: Hierarchical tiling
 
     return sched_string;
 }
 
+PipelineCostEstimates estimate_pipeline_costs(const vector<Function> &outputs,
+                                              const map<string, Function> &env,
+                                              const vector<string> &order) {
+    PipelineCostEstimates estimates;
+
+    set<string> output_names;
+    for (const Function &out : outputs) {
+        output_names.insert(out.name());
+    }
+
+    // Whether any loop runs on a GPU doesn't depend on the sizes.
+    set<string> inlines;
+    for (const auto &iter : env) {
+        const Function &f = iter.second;
+        if (f.has_extern_definition()) {
+            continue;
+        }
+        if (f.schedule().compute_level().is_inlined() && f.is_pure() &&
+            !output_names.count(f.name())) {
+            inlines.insert(f.name());
+        }
+        for (int s = 0; s < (int)f.updates().size() + 1; s++) {
+            for (const Dim &d : get_stage_dims(f, s)) {
+                if (d.for_type == ForType::GPUBlock || d.for_type == ForType::GPUThread) {
+                    estimates.uses_gpu = true;
+                }
+            }
+        }
+    }
+
+    // Everything else needs estimates on every dimension of the outputs.
+    for (const Function &out : outputs) {
+        for (const string &arg : out.args()) {
+            bool found = false;
+            for (const Bound &b : out.schedule().estimates()) {
+                found = found || (b.var == arg && b.min.defined() && b.extent.defined());
+            }
+            if (!found) {
+                return estimates;
+            }
+        }
+    }
+
+    auto to_int = [](Expr e) -> int64_t {
+        if (!e.defined()) {
+            return -1;
+        }
+        e = simplify(subsitute_var_estimates(e));
+        const int64_t *i = as_const_int(e);
+        return (i && *i >= 0) ? *i : -1;
+    };
+
+    FuncValueBounds func_val_bounds = compute_function_value_bounds(order, env);
+    RegionCosts costs(env);
+    DependenceAnalysis dep_analysis(env, order, func_val_bounds);
+    map<string, Box> pipeline_bounds =
+        get_pipeline_bounds(dep_analysis, outputs, &costs.input_estimates);
+
+    Cost cost = costs.region_cost(pipeline_bounds, inlines);
+    if (cost.defined()) {
+        estimates.arithmetic_ops = to_int(cost.arith);
+        estimates.bytes_loaded = to_int(cost.memory);
+    }
+
+    // The outputs are allocated by the caller.
+    map<string, Box> intermediates = pipeline_bounds;
+    for (const string &out : output_names) {
+        intermediates.erase(out);
+    }
+    estimates.peak_intermediate_bytes = to_int(costs.region_footprint(intermediates, inlines));
+
+    // Follow the splits and fuses of each stage from the bounds of its
+    // pure and reduction variables to the extents of its loops.
+    int64_t parallelism = 1;
+    for (const auto &iter : pipeline_bounds) {
+        const Function &f = get_element(env, iter.first);
+        if (f.has_extern_definition() || inlines.count(f.name()) ||
+            is_box_unbounded(iter.second)) {
+            continue;
+        }
+        DimBounds pure_bounds;
+        for (size_t d = 0; d < f.args().size(); d++) {
+            pure_bounds[f.args()[d]] = iter.second[d];
+        }
+        for (int s = 0; s < (int)f.updates().size() + 1; s++) {
+            map<string, Expr> extents;
+            for (const auto &b : get_stage_bounds(f, s, pure_bounds)) {
+                extents[b.first] = get_extent(b.second);
+            }
+            StageSchedule sched = get_stage_definition(f, s).schedule();
+            for (const Split &split : sched.splits()) {
+                if (split.is_split()) {
+                    Expr e = extents[split.old_var];
+                    if (e.defined()) {
+                        extents[split.outer] = (e + split.factor - 1) / split.factor;
+                    }
+                    extents[split.inner] = split.factor;
+                } else if (split.is_fuse()) {
+                    Expr outer = extents[split.outer], inner = extents[split.inner];
+                    if (outer.defined() && inner.defined()) {
+                        extents[split.old_var] = outer * inner;
+                    }
+                } else {
+                    extents[split.outer] = extents[split.old_var];
+                }
+            }
+            int64_t stage_parallelism = 1;
+            for (const Dim &d : sched.dims()) {
+                if (d.is_parallel()) {
+                    int64_t extent = to_int(extents[d.var]);
+                    if (extent < 0) {
+                        // Don't underestimate.
+                        return estimates;
+                    }
+                    stage_parallelism *= extent;
+                }
+            }
+            parallelism = std::max(parallelism, stage_parallelism);
+        }
+    }
+    estimates.parallelism = parallelism;
+
+    return estimates;
+}
+
+namespace {
+
+// Visitor that collects the ImageParams with no buffer bound to them.
+class FindUnboundImageParams : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    void visit(const Call *call) override {
+        IRGraphVisitor::visit(call);
+        if ((call->call_type == Call::Image) && call->param.defined() &&
+            !call->param.buffer().defined()) {
+            params.emplace(call->param.name(), call->param);
+        }
+    }
+public:
+    map<string, Parameter> params;
+};
+
+// Return the machine parameters of the index-th autotuning candidate, or
+// false if there are no more candidates. The candidates scale the cache size
+// and balance seen by the partitioner by powers of four, which shifts its
+// trade-off between locality and redundant work, and so the groupings and
+// tile sizes it chooses.
+bool autotune_candidate_params(const MachineParams &params, int index,
+                               MachineParams &candidate) {
+    static const int scales[][2] = {
+        {0, 0}, {-2, 0}, {2, 0}, {0, -2}, {0, 2}, {-2, -2}, {2, 2},
+        {-2, 2}, {2, -2}, {-4, 0}, {4, 0}, {0, -4}, {0, 4}};
+    if (index >= (int)(sizeof(scales) / sizeof(scales[0]))) {
+        return false;
+    }
+    auto scale = [](const Expr &e, int shift) {
+        Expr scaled = (shift >= 0) ? e * (1 << shift) : e / (1 << -shift);
+        return simplify(max(scaled, 1));
+    };
+    candidate = params;
+    candidate.last_level_cache_size = scale(params.last_level_cache_size, scales[index][0]);
+    candidate.balance = scale(params.balance, scales[index][1]);
+    return true;
+}
+
+}  // anonymous namespace
+
+string autotune_schedules(const vector<Function> &outputs, const Target &target,
+                          const MachineParams &arch_params, int num_candidates) {
+    check_estimates_on_outputs(outputs);
+
+    map<string, Function> env;
+    for (Function f : outputs) {
+        map<string, Function> more_funcs = find_transitive_calls(f);
+        env.insert(more_funcs.begin(), more_funcs.end());
+    }
+
+    // Allocate the outputs over their estimated bounds.
+    vector<Buffer<>> output_buffers;
+    for (const Function &out : outputs) {
+        vector<int> mins, extents;
+        for (const string &arg : out.args()) {
+            const int64_t *min = nullptr, *extent = nullptr;
+            for (const Bound &b : out.schedule().estimates()) {
+                if ((b.var == arg) && b.min.defined() && b.extent.defined()) {
+                    min = as_const_int(b.min);
+                    extent = as_const_int(b.extent);
+                }
+            }
+            if (!min || !extent) {
+                user_warning << "Not autotuning because the estimates on output \""
+                             << out.name() << "\" are not constant\n";
+                return generate_schedules(outputs, target, arch_params);
+            }
+            mins.push_back((int)*min);
+            extents.push_back((int)*extent);
+        }
+        for (const Type &t : out.output_types()) {
+            Buffer<> buf(t, extents);
+            buf.set_min(mins);
+            output_buffers.push_back(buf);
+        }
+    }
+    Realization dst(output_buffers);
+
+    // Schedule a copy of the pipeline for each candidate. Candidates that
+    // come out the same as an earlier one are skipped.
+    struct Candidate {
+        MachineParams params;
+        string schedule;
+        Pipeline pipeline;
+        double time;
+    };
+    vector<Candidate> candidates;
+    MachineParams params = arch_params;
+    for (int i = 0; (int)candidates.size() < num_candidates &&
+                    autotune_candidate_params(arch_params, i, params); i++) {
+        vector<Function> copies = deep_copy(outputs, env).first;
+        string schedule = generate_schedules(copies, target, params);
+        // Leave out the header, which names the MachineParams.
+        string body = schedule.substr(schedule.find("\n\n"));
+        bool seen = false;
+        for (const Candidate &c : candidates) {
+            seen = seen || (c.schedule.substr(c.schedule.find("\n\n")) == body);
+        }
+        if (!seen) {
+            vector<Func> funcs;
+            for (const Function &f : copies) {
+                funcs.push_back(Func(f));
+            }
+            candidates.push_back({params, schedule, Pipeline(funcs), 0});
+        }
+    }
+
+    // Compile the candidates in parallel.
+    if (candidates.size() > 1) {
+        vector<std::exception_ptr> errors(candidates.size());
+        {
+            size_t threads = std::min(candidates.size(), ThreadPool<void>::num_processors_online());
+            ThreadPool<void> pool(std::max(threads, (size_t)1));
+            vector<std::future<void>> compiled;
+            for (size_t i = 0; i < candidates.size(); i++) {
+                Pipeline p = candidates[i].pipeline;
+                std::exception_ptr *error = &errors[i];
+                compiled.push_back(pool.async([p, target, error]() mutable {
+#ifdef WITH_EXCEPTIONS
+                    try {
+                        p.compile_jit(target);
+                    } catch (...) {
+                        *error = std::current_exception();
+                    }
+#else
+                    p.compile_jit(target);
+#endif
+                }));
+            }
+            for (auto &c : compiled) {
+                c.wait();
+            }
+        }
+        for (const auto &e : errors) {
+            if (e) {
+                std::rethrow_exception(e);
+            }
+        }
+    }
+
+    // Time the candidates one at a time, on inputs allocated over the bounds
+    // the outputs require.
+    FindUnboundImageParams unbound;
+    for (const auto &iter : env) {
+        iter.second.accept(&unbound);
+    }
+    size_t best = 0;
+    for (size_t i = 0; i < candidates.size() && candidates.size() > 1; i++) {
+        Candidate &c = candidates[i];
+        for (auto &iter : unbound.params) {
+            iter.second.set_buffer(Buffer<>());
+        }
+        c.pipeline.infer_input_bounds(dst);
+
+        c.time = std::numeric_limits<double>::max();
+        for (int run = 0; run < 4; run++) {
+            auto start = std::chrono::steady_clock::now();
+            c.pipeline.realize(dst, target);
+            dst.device_sync();
+            auto end = std::chrono::steady_clock::now();
+            // The first run includes one-off costs, such as copying to the
+            // device.
+            if (run > 0) {
+                c.time = std::min(c.time, std::chrono::duration<double>(end - start).count());
+            }
+        }
+        debug(1) << "Autotuning candidate " << i << " with MachineParams "
+                 << c.params.to_string() << " took " << c.time * 1000 << " ms\n";
+        if (c.time < candidates[best].time) {
+            best = i;
+        }
+    }
+    for (auto &iter : unbound.params) {
+        iter.second.set_buffer(Buffer<>());
+    }
+
+    // Apply the fastest candidate to the pipeline itself. Scheduling is
+    // deterministic, so passing its MachineParams to auto_schedule reproduces
+    // this schedule.
+    string schedule = generate_schedules(outputs, target, candidates[best].params);
+    std::ostringstream oss;
+    oss << "// Autotuned over " << candidates.size() << " candidate schedules\n";
+    for (size_t i = 0; i < candidates.size() && candidates.size() > 1; i++) {
+        oss << "// " << ((i == best) ? "* " : "  ")
+            << "MachineParams: " << candidates[i].params.to_string()
+            << ", time: " << candidates[i].time * 1000 << " ms\n";
+    }
+    oss << schedule;
+    return oss.str();
+}
+
 }
 
 MachineParams MachineParams::generic() {
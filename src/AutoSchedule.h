@@ -7,6 +7,7 @@
  */
 
 #include "Function.h"
+#include "Module.h"
 #include "Target.h"
 
 namespace Halide {
@@ -46,6 +47,24 @@ std::string generate_schedules(const std::vector<Function> &outputs,
                                const Target &target,
                                const MachineParams &arch_params);
 
+/** Like generate_schedules, but JIT-compiles up to 'num_candidates' schedules
+ * generated under different machine parameters, and applies the one that runs
+ * the fastest over the estimated output bounds. The returned string lists the
+ * time taken by each candidate. */
+std::string autotune_schedules(const std::vector<Function> &outputs,
+                               const Target &target,
+                               const MachineParams &arch_params,
+                               int num_candidates);
+
+/** Estimate the cost of running a pipeline as scheduled, for outputs of
+ * the sizes given by their estimates. 'env' holds all the Funcs in the
+ * pipeline and 'order' is their realization order. Unlike
+ * generate_schedules, this does not change the Funcs, and doesn't
+ * require estimates: those that can't be computed are left at -1. */
+PipelineCostEstimates estimate_pipeline_costs(const std::vector<Function> &outputs,
+                                              const std::map<std::string, Function> &env,
+                                              const std::vector<std::string> &order);
+
 }
 }
 
@@ -0,0 +1,92 @@
+#include "BatchEntryPoint.h"
+#include "IROperator.h"
+#include "Util.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::string;
+using std::vector;
+
+void add_batch_entry_point(Module &m, const string &fn_name) {
+    LoweredFunc fn = m.get_function_by_name(fn_name);
+    // The items are run with a plain extern "C" call.
+    user_assert(fn.name_mangling == NameMangling::C ||
+                (fn.name_mangling == NameMangling::Default &&
+                 !m.target().has_feature(Target::CPlusPlusMangling)))
+        << "Cannot add a batch entry point to " << fn_name
+        << ", which uses C++ name mangling.\n";
+
+    vector<LoweredArgument> args;
+    vector<Expr> call_args;
+    Expr batch_size;
+    string batch_size_name;
+    vector<Stmt> checks;
+
+    string item_name = unique_name("batch_item");
+    Expr item = Variable::make(Int(32), item_name);
+
+    for (const LoweredArgument &arg : fn.args) {
+        if (!arg.is_buffer()) {
+            args.push_back(arg);
+            call_args.push_back(Variable::make(arg.type, arg.name));
+            continue;
+        }
+
+        LoweredArgument batched = arg;
+        batched.dimensions = arg.dimensions + 1;
+        args.push_back(batched);
+
+        const int d = arg.dimensions;
+        Expr buf = Variable::make(type_of<struct halide_buffer_t *>(), arg.name + ".buffer");
+        Expr extent = Call::make(Int(32), Call::buffer_get_extent, {buf, d}, Call::Extern);
+        Expr stride = Call::make(Int(32), Call::buffer_get_stride, {buf, d}, Call::Extern);
+
+        // Every buffer must have the same number of items as the first.
+        string extent_name = arg.name + ".extent." + std::to_string(d);
+        if (!batch_size.defined()) {
+            batch_size = extent;
+            batch_size_name = extent_name;
+        } else {
+            Expr error = Call::make(Int(32), "halide_error_constraint_violated",
+                                    {extent_name, extent, batch_size_name, batch_size},
+                                    Call::Extern);
+            checks.push_back(AssertStmt::make(extent == batch_size, error));
+        }
+
+        // The slice for an item is the same buffer without its
+        // outermost dimension, with the host pointer moved to the
+        // start of the item.
+        Expr host = reinterpret(UInt(64), Call::make(Handle(), Call::buffer_get_host, {buf}, Call::Extern));
+        Expr offset = cast<int64_t>(item) * stride * arg.type.bytes();
+        BufferBuilder builder;
+        builder.host = reinterpret(Handle(), host + reinterpret(UInt(64), offset));
+        builder.type = arg.type;
+        builder.dimensions = d;
+        for (int i = 0; i < d; i++) {
+            builder.mins.push_back(Call::make(Int(32), Call::buffer_get_min, {buf, i}, Call::Extern));
+            builder.extents.push_back(Call::make(Int(32), Call::buffer_get_extent, {buf, i}, Call::Extern));
+            builder.strides.push_back(Call::make(Int(32), Call::buffer_get_stride, {buf, i}, Call::Extern));
+        }
+        builder.host_dirty = Call::make(Bool(), Call::buffer_get_host_dirty, {buf}, Call::Extern);
+        call_args.push_back(builder.build());
+    }
+
+    user_assert(batch_size.defined())
+        << "Cannot add a batch entry point to " << fn_name
+        << ", which has no buffer arguments.\n";
+
+    string result_name = unique_name('t');
+    Expr result = Variable::make(Int(32), result_name);
+    Stmt body = AssertStmt::make(result == 0, result);
+    body = LetStmt::make(result_name, Call::make(Int(32), fn_name, call_args, Call::Extern), body);
+    body = For::make(item_name, 0, batch_size, ForType::Parallel, DeviceAPI::Host, body);
+    for (size_t i = checks.size(); i > 0; i--) {
+        body = Block::make(checks[i - 1], body);
+    }
+
+    m.append(LoweredFunc(fn_name + "_batch", args, body, LinkageType::External, fn.name_mangling));
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,27 @@
+#ifndef HALIDE_BATCH_ENTRY_POINT_H
+#define HALIDE_BATCH_ENTRY_POINT_H
+
+/** \file
+ *
+ * Defines a pass that adds an entry point running a pipeline over a
+ * batch of independent inputs.
+ */
+
+#include "Module.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Append a function named fn_name + "_batch" to the module. It takes
+ * the same arguments as the function fn_name, except that every buffer
+ * has one extra outermost dimension indexing items of the batch. All
+ * buffers must have the same extent in that dimension, and scalar
+ * arguments are shared by every item. It calls fn_name on the slice of
+ * each item, in parallel, from a single parallel loop on the host. The
+ * buffers must be in host memory. */
+void add_batch_entry_point(Module &m, const std::string &fn_name);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -1,7 +1,13 @@
+#include <limits>
+
 #include "BoundSmallAllocations.h"
 #include "Bounds.h"
+#include "CodeGen_Internal.h"
+#include "ExprUsesVar.h"
 #include "IRMutator.h"
+#include "IROperator.h"
 #include "Simplify.h"
+#include "Substitute.h"
 
 namespace Halide {
 namespace Internal {
@@ -13,10 +19,19 @@ class BoundSmallAllocations : public IRMutator2 {
     // Track constant bounds
     Scope<Interval> scope;
 
+    // The enclosing lets, outermost first. The extents of an
+    // allocation are often the difference of two lets that are not
+    // constant, such as the max and min of a tile, so we substitute
+    // them in to find a constant bound on the difference.
+    std::vector<std::pair<std::string, Expr>> lets;
+
     Stmt visit(const LetStmt *op) override {
         Interval b = find_constant_bounds(op->value, scope);
         ScopedBinding<Interval> bind(scope, op->name, b);
-        return IRMutator2::visit(op);
+        lets.emplace_back(op->name, op->value);
+        Stmt s = IRMutator2::visit(op);
+        lets.pop_back();
+        return s;
     }
 
     Expr visit(const Let *op) override {
@@ -45,6 +60,15 @@ class BoundSmallAllocations : public IRMutator2 {
             total_extent *= e;
         }
         Expr bound = find_constant_bound(total_extent, Direction::Upper, scope);
+        if (!bound.defined()) {
+            Expr e = total_extent;
+            for (auto it = lets.rbegin(); it != lets.rend(); it++) {
+                if (expr_uses_var(e, it->first)) {
+                    e = substitute(it->first, it->second, e);
+                }
+            }
+            bound = find_constant_bound(simplify(e), Direction::Upper, scope);
+        }
         user_assert(bound.defined() ||
                     (op->memory_type != MemoryType::Stack &&
                      op->memory_type != MemoryType::Register))
@@ -56,14 +80,25 @@ class BoundSmallAllocations : public IRMutator2 {
             << "Only fixed-size allocations are supported on the gpu. "
             << "Try storing into shared memory instead.";
         // 128 bytes is a typical minimum allocation size in
-        // halide_malloc. For now we are very conservative, and only
-        // round sizes up to a constant if they're smaller than that.
+        // halide_malloc, so rounding sizes up to a constant smaller
+        // than that costs nothing. Sizes bounded by a constant small
+        // enough to go on the stack are also rounded up, so that
+        // they are placed on the stack instead of calling
+        // halide_malloc, which matters most for scratch buffers
+        // inside parallel tasks.
         Expr malloc_overhead = 128 / op->type.bytes();
+        bool fits_on_stack = false;
+        if (bound.defined()) {
+            const int64_t *b = as_const_int(bound);
+            fits_on_stack = (b && *b > 0 && *b <= std::numeric_limits<int32_t>::max() &&
+                             can_allocation_fit_on_stack(*b * op->type.bytes()));
+        }
         if (bound.defined() &&
             (in_thread_loop ||
              op->memory_type == MemoryType::Stack ||
              op->memory_type == MemoryType::Register ||
-             (op->memory_type == MemoryType::Auto && can_prove(bound <= malloc_overhead)))) {
+             (op->memory_type == MemoryType::Auto &&
+              (fits_on_stack || can_prove(bound <= malloc_overhead))))) {
             user_assert(can_prove(bound <= Int(32).max()))
                 << "Allocation " << op->name << " has a size greater than 2^31: " << bound << "\n";
             bound = simplify(cast<int32_t>(bound));
@@ -210,6 +210,109 @@ Func mirror_interior(const Func &source,
     return bounded;
 }
 
+Func stage_padded(const Func &source, const Func &bounded,
+                  const std::vector<std::pair<Expr, Expr>> &bounds,
+                  Expr padding) {
+    std::vector<Var> args(source.args());
+    user_assert(args.size() >= bounds.size()) <<
+        "stage_padded called with more bounds (" << bounds.size() <<
+        ") than dimensions (" << args.size() << ") Func " <<
+        source.name() << "has.\n";
+    user_assert(bounded.dimensions() == source.dimensions() &&
+                bounded.outputs() == source.outputs()) <<
+        "stage_padded called with a boundary condition Func " << bounded.name() <<
+        " that does not have the same dimensions and outputs as Func " << source.name() << "\n";
+    user_assert(padding.defined() && padding.type().is_int()) <<
+        "stage_padded requires a defined integer padding\n";
+
+    for (size_t i = 0; i < bounds.size(); i++) {
+        user_assert(bounds[i].first.defined() == bounds[i].second.defined())
+            << "Partially undefined bounds for dimension " << args[i]
+            << " of Func " << source.name() << "\n";
+    }
+
+    Func padded("stage_padded");
+
+    // The interior is a straight copy of the source. Unbounded
+    // dimensions are left as pure vars in every update.
+    std::vector<std::pair<Expr, Expr>> interior_ranges;
+    for (size_t i = 0; i < bounds.size(); i++) {
+        if (bounds[i].first.defined()) {
+            interior_ranges.push_back(bounds[i]);
+        }
+    }
+    if (interior_ranges.empty()) {
+        padded(args) = source(args);
+        padded.compute_root();
+        return padded;
+    }
+
+    std::vector<Expr> undefs;
+    for (Type t : source.output_types()) {
+        undefs.push_back(undef(t));
+    }
+    if (undefs.size() == 1) {
+        padded(args) = undefs[0];
+    } else {
+        padded(args) = Tuple(undefs);
+    }
+
+    RDom interior(interior_ranges, "interior");
+    std::vector<Expr> interior_args(args.begin(), args.end());
+    for (size_t i = 0, j = 0; i < bounds.size(); i++) {
+        if (bounds[i].first.defined()) {
+            interior_args[i] = interior[j++];
+        }
+    }
+    padded(interior_args) = source(interior_args);
+
+    // The border is covered by two slabs per bounded dimension: the
+    // slabs for dimension i span the padded range of the dimensions
+    // before it, and the unpadded range of the dimensions after it, so
+    // every point of the border is evaluated exactly once.
+    for (size_t i = 0; i < bounds.size(); i++) {
+        if (!bounds[i].first.defined()) {
+            continue;
+        }
+        for (int side = 0; side < 2; side++) {
+            std::vector<std::pair<Expr, Expr>> ranges;
+            for (size_t j = 0; j < bounds.size(); j++) {
+                Expr min = bounds[j].first, extent = bounds[j].second;
+                if (!min.defined()) {
+                    continue;
+                }
+                if (j < i) {
+                    ranges.push_back({min - padding, extent + 2 * padding});
+                } else if (j == i) {
+                    ranges.push_back({side == 0 ? min - padding : min + extent, padding});
+                } else {
+                    ranges.push_back({min, extent});
+                }
+            }
+            RDom border(ranges, "border");
+            std::vector<Expr> border_args(args.begin(), args.end());
+            for (size_t j = 0, k = 0; j < bounds.size(); j++) {
+                if (bounds[j].first.defined()) {
+                    border_args[j] = border[k++];
+                }
+            }
+            padded(border_args) = bounded(border_args);
+        }
+    }
+
+    // Fix the realized region to the padded box. Consumers that reach
+    // further than the padding fail this bound at runtime instead of
+    // reading uninitialized values.
+    for (size_t i = 0; i < bounds.size(); i++) {
+        if (bounds[i].first.defined()) {
+            padded.bound(args[i], bounds[i].first - padding, bounds[i].second + 2 * padding);
+        }
+    }
+    padded.compute_root();
+
+    return padded;
+}
+
 }
 
 }
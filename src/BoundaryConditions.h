@@ -260,6 +260,44 @@ inline HALIDE_NO_USER_CODE_INLINE Func mirror_interior(const T &func_like, Bound
 }
 // @}
 
+/** Materialize a boundary condition into a buffer covering the given
+ *  region grown by 'padding' on every side, so that consumers read it
+ *  with no per-access boundary logic. The region is copied straight
+ *  from 'source', and 'bounded' (usually one of the boundary
+ *  conditions above applied to 'source') is only evaluated in the
+ *  border. This is worthwhile when consumers are tiled finely enough
+ *  that loop partitioning leaves most of the work in the boundary
+ *  cases.
+ *
+ *  The result is computed at root and bounded to the padded region;
+ *  consumers that reach further than 'padding' outside the region
+ *  fail at runtime. The interior copy is the first update definition
+ *  of the result, with reduction variables named "interior".
+ *
+ *  An ImageParam, Buffer<T>, or similar can be passed instead of a
+ *  Func. If this is done and no bounds are given, the boundaries will
+ *  be taken from the min and extent methods of the passed object.
+ *
+ *  You may pass undefined Exprs for dimensions that you do not wish
+ *  to pad.
+ */
+// @{
+Func stage_padded(const Func &source, const Func &bounded,
+                  const std::vector<std::pair<Expr, Expr>> &bounds,
+                  Expr padding);
+
+template <typename T>
+inline HALIDE_NO_USER_CODE_INLINE Func stage_padded(const T &func_like, const Func &bounded,
+                                                    Expr padding) {
+    std::vector<std::pair<Expr, Expr>> object_bounds;
+    for (int i = 0; i < func_like.dimensions(); i++) {
+        object_bounds.push_back({ Expr(func_like.dim(i).min()), Expr(func_like.dim(i).extent()) });
+    }
+
+    return stage_padded(Internal::func_like_to_func(func_like), bounded, object_bounds, padding);
+}
+// @}
+
 }
 
 }
@@ -42,6 +42,48 @@ int static_sign(Expr x) {
     }
     return 0;
 }
+
+// Interval analysis of deep chains of selects, mins and maxes can make
+// bounds exponentially larger, as trees, than the expression they
+// bound. Past this many nodes, a bound is replaced by a looser one.
+const int bounds_size_budget = 2048;
+
+// Whether e has more than bounds_size_budget nodes when considered as
+// a tree. Stops counting once it has.
+class ExceedsSizeBudget : public IRVisitor {
+    using IRVisitor::visit;
+
+    int count = 0;
+
+    void visit(const Add *op) override { node(op); }
+    void visit(const Sub *op) override { node(op); }
+    void visit(const Mul *op) override { node(op); }
+    void visit(const Div *op) override { node(op); }
+    void visit(const Mod *op) override { node(op); }
+    void visit(const Min *op) override { node(op); }
+    void visit(const Max *op) override { node(op); }
+    void visit(const Select *op) override { node(op); }
+    void visit(const Let *op) override { node(op); }
+    void visit(const Cast *op) override { node(op); }
+    void visit(const Call *op) override { node(op); }
+
+    template<typename T>
+    void node(const T *op) {
+        if (++count <= bounds_size_budget) {
+            IRVisitor::visit(op);
+        }
+    }
+
+public:
+    bool check(const Expr &e) {
+        e.accept(this);
+        return count > bounds_size_budget;
+    }
+};
+
+bool exceeds_size_budget(const Expr &e) {
+    return ExceedsSizeBudget().check(e);
+}
 } // anonymous namespace
 
 Expr find_constant_bound(const Expr &e, Direction d, const Scope<Interval> &scope) {
@@ -104,6 +146,69 @@ private:
         }
     }
 
+    // If set, the bounds of a select are those of its two values,
+    // whatever its condition.
+    bool ignore_select_conditions = false;
+
+    // If the bounds just found for op are too large, replace them
+    // with looser ones: the constant bounds of op if it has them, and
+    // otherwise its bounds with the conditions of its selects
+    // ignored. The conditions are what make the bounds grow
+    // exponentially, so the latter are usually small enough. Only if
+    // they aren't is op unbounded.
+    void enforce_size_budget(const Expr &op) {
+        if (const_bound || ignore_select_conditions) {
+            // The bounds are already as small as they get, or the
+            // caller checks their size.
+            return;
+        }
+        bool large_min = interval.has_lower_bound() && exceeds_size_budget(interval.min);
+        bool large_max = interval.has_upper_bound() && exceeds_size_budget(interval.max);
+        if (!large_min && !large_max) {
+            return;
+        }
+        debug(1) << "Bounds exceed the size budget. Using looser bounds instead.\n";
+        debug(2) << "Bounds exceed the size budget for: " << op << "\n";
+
+        Interval result = interval;
+        const_bound = true;
+        op.accept(this);
+        const_bound = false;
+        Interval loose = interval;
+        loose.min = simplify(loose.min);
+        loose.max = simplify(loose.max);
+        bool const_min = is_const(loose.min);
+        bool const_max = is_const(loose.max);
+
+        Interval unconditional;
+        if ((large_min && !const_min) || (large_max && !const_max)) {
+            ignore_select_conditions = true;
+            op.accept(this);
+            ignore_select_conditions = false;
+            unconditional = interval;
+        }
+
+        if (large_min) {
+            if (const_min) {
+                result.min = loose.min;
+            } else if (unconditional.has_lower_bound() && !exceeds_size_budget(unconditional.min)) {
+                result.min = unconditional.min;
+            } else {
+                result.min = Interval::neg_inf;
+            }
+        }
+        if (large_max) {
+            if (const_max) {
+                result.max = loose.max;
+            } else if (unconditional.has_upper_bound() && !exceeds_size_budget(unconditional.max)) {
+                result.max = unconditional.max;
+            } else {
+                result.max = Interval::pos_inf;
+            }
+        }
+        interval = result;
+    }
+
     void bounds_of_type(Type t) {
         t = t.element_of();
         if ((t.is_uint() || t.is_int()) && t.bits() <= 16) {
@@ -495,6 +600,7 @@ private:
         } else {
             interval = Interval(Interval::make_min(a.min, b.min),
                                 Interval::make_min(a.max, b.max));
+            enforce_size_budget(op);
         }
     }
 
@@ -511,6 +617,7 @@ private:
         } else {
             interval = Interval(Interval::make_max(a.min, b.min),
                                 Interval::make_max(a.max, b.max));
+            enforce_size_budget(op);
         }
     }
 
@@ -690,6 +797,12 @@ private:
         }
         Interval b = interval;
 
+        if (ignore_select_conditions) {
+            interval = Interval(Interval::make_min(a.min, b.min),
+                                Interval::make_max(a.max, b.max));
+            return;
+        }
+
         op->condition.accept(this);
         Interval cond = interval;
 
@@ -760,6 +873,8 @@ private:
             interval.max = Let::make(a_var_name, a.max, interval.max);
             interval.max = Let::make(b_var_name, b.max, interval.max);
         }
+
+        enforce_size_budget(op);
     }
 
     void visit(const Load *op) {
@@ -841,7 +956,9 @@ private:
             }
         } else if (op->is_intrinsic(Call::likely) ||
                    op->is_intrinsic(Call::likely_if_innermost) ||
-                   op->is_intrinsic(Call::strict_float)) {
+                   op->is_intrinsic(Call::strict_float) ||
+                   op->is_intrinsic(Call::atomic_update) ||
+                   op->is_intrinsic(Call::nontemporal_store)) {
             assert(op->args.size() == 1);
             op->args[0].accept(this);
         } else if (op->is_intrinsic(Call::return_second)) {
@@ -1967,6 +2084,149 @@ FuncValueBounds compute_function_value_bounds(const vector<string> &order,
 
 namespace {
 
+// Find the calls to any of a set of functions or buffers.
+class FindCallsTo : public IRVisitor {
+    const map<string, Box> &targets;
+
+    using IRVisitor::visit;
+
+    void visit(const Call *op) {
+        IRVisitor::visit(op);
+        if ((op->call_type == Call::Halide || op->call_type == Call::Image) &&
+            targets.count(op->name)) {
+            calls.push_back(op);
+        }
+    }
+
+public:
+    vector<const Call *> calls;
+    FindCallsTo(const map<string, Box> &targets) : targets(targets) {}
+};
+
+// The region of a definition that may read from a call when its
+// arguments are in the given box.
+Box box_of_definition_reading(const Definition &def, const vector<string> &pure_args,
+                              const Call *call, const Box &box) {
+    Expr cond = const_true();
+    for (size_t i = 0; i < call->args.size() && i < box.size(); i++) {
+        if (box[i].has_lower_bound()) {
+            cond = cond && call->args[i] >= box[i].min;
+        }
+        if (box[i].has_upper_bound()) {
+            cond = cond && call->args[i] <= box[i].max;
+        }
+    }
+
+    Scope<Interval> scope;
+    for (const string &arg : pure_args) {
+        scope.push(arg, Interval::everything());
+    }
+    for (const ReductionVariable &rv : def.schedule().rvars()) {
+        scope.push(rv.var, Interval(rv.min, simplify(rv.min + rv.extent - 1)));
+    }
+
+    Box result;
+    for (const Expr &arg : def.args()) {
+        const Variable *v = arg.as<Variable>();
+        if (v && scope.contains(v->name)) {
+            // Solve for where the call is in the box, and then bound
+            // that over the other variables.
+            Interval i = solve_for_outer_interval(cond, v->name);
+            if (i.has_lower_bound()) {
+                i.min = bounds_of_expr_in_scope(i.min, scope).min;
+            }
+            if (i.has_upper_bound()) {
+                i.max = bounds_of_expr_in_scope(i.max, scope).max;
+            }
+            i = Interval::make_intersection(i, scope.get(v->name));
+            if (i.has_lower_bound()) {
+                i.min = simplify(i.min);
+            }
+            if (i.has_upper_bound()) {
+                i.max = simplify(i.max);
+            }
+            result.push_back(i);
+        } else {
+            // Anywhere the argument could be.
+            result.push_back(bounds_of_expr_in_scope(arg, scope));
+        }
+    }
+    return result;
+}
+
+}  // namespace
+
+map<string, Box> boxes_affected(const vector<string> &order,
+                                const map<string, Function> &env,
+                                const string &changed, const Box &changed_box) {
+    map<string, Box> affected;
+    affected[changed] = changed_box;
+
+    for (const string &name : order) {
+        if (name == changed) {
+            continue;
+        }
+        const Function &f = env.find(name)->second;
+        const Box everything(f.dimensions());
+
+        if (f.has_extern_definition()) {
+            // We can't see inside extern stages, so any change to an
+            // input may change all of the output.
+            for (const ExternFuncArgument &arg : f.extern_arguments()) {
+                string input;
+                if (arg.is_func()) {
+                    input = Function(arg.func).name();
+                } else if (arg.is_buffer()) {
+                    input = arg.buffer.name();
+                } else if (arg.is_image_param()) {
+                    input = arg.image_param.name();
+                }
+                if (affected.count(input)) {
+                    affected[name] = everything;
+                }
+            }
+            continue;
+        }
+
+        vector<Definition> definitions = {f.definition()};
+        definitions.insert(definitions.end(), f.updates().begin(), f.updates().end());
+        for (const Definition &def : definitions) {
+            FindCallsTo finder(affected);
+            def.accept(&finder);
+            for (const Call *call : finder.calls) {
+                if (call->name == name) {
+                    // An update that reads the function somewhere other
+                    // than where it writes can carry the change to
+                    // anywhere.
+                    bool in_place = call->args.size() == def.args().size();
+                    for (size_t i = 0; in_place && i < call->args.size(); i++) {
+                        in_place = equal(call->args[i], def.args()[i]);
+                    }
+                    if (!in_place) {
+                        affected[name] = everything;
+                    }
+                    continue;
+                }
+                Box b = box_of_definition_reading(def, f.args(), call, affected[call->name]);
+                if (affected.count(name)) {
+                    merge_boxes(affected[name], b);
+                } else {
+                    affected[name] = b;
+                }
+            }
+        }
+
+        if (affected.count(name)) {
+            debug(3) << "Region of " << name << " affected by a change to "
+                     << changed << ": " << affected[name] << "\n";
+        }
+    }
+
+    return affected;
+}
+
+namespace {
+
 void check(const Scope<Interval> &scope, Expr e, Expr correct_min, Expr correct_max) {
     FuncValueBounds fb;
     Interval result = bounds_of_expr_in_scope(e, scope, fb);
@@ -2218,6 +2478,22 @@ void bounds_test() {
     internal_assert(equal(simplify(r2[0].min), 4));
     internal_assert(equal(simplify(r2[0].max), 19));
 
+    {
+        // Each condition puts both bounds of the select before it into
+        // the bounds of this one, so without the size budget these
+        // bounds would double in size at each step.
+        Scope<Interval> chain_scope;
+        chain_scope.push("x", Interval(Expr(0), y));
+        Expr e = x;
+        for (int i = 0; i < 24; i++) {
+            e = select(e > i, x + i, x - i);
+        }
+        Interval result = bounds_of_expr_in_scope(e, chain_scope);
+        internal_assert(result.is_bounded());
+        internal_assert(!exceeds_size_budget(result.min));
+        internal_assert(!exceeds_size_budget(result.max));
+    }
+
     boxes_touched_test();
 
     std::cout << "Bounds test passed" << std::endl;
@@ -162,6 +162,16 @@ Box box_touched(Stmt s, std::string fn,
 FuncValueBounds compute_function_value_bounds(const std::vector<std::string> &order,
                                               const std::map<std::string, Function> &env);
 
+/** Given a box of a function or input buffer that changed, compute boxes
+ * large enough to cover the region of each function in an environment
+ * (visited in the given producer-first order) that may depend on the
+ * change. Functions that can't be affected are left out of the
+ * result. This is the forward counterpart of boxes_required, for
+ * recomputing only what changed. */
+std::map<std::string, Box> boxes_affected(const std::vector<std::string> &order,
+                                          const std::map<std::string, Function> &env,
+                                          const std::string &changed, const Box &changed_box);
+
 void bounds_test();
 
 }
@@ -188,6 +188,12 @@ public:
                 }
             }
 
+            // The conditions of skip_unless directives may call other
+            // Funcs, e.g. to look up a per-tile activity mask.
+            for (const SkipDirective &skip : def.schedule().skips()) {
+                result[1].push_back(CondValue(const_true(), skip.condition));
+            }
+
             const vector<Specialization> &specializations = def.specializations();
             for (size_t i = specializations.size(); i > 0; i--) {
                 Expr s_cond = specializations[i-1].condition;
@@ -221,6 +221,15 @@ public:
                     const std::string &name = "") :
         Buffer(Runtime::Buffer<T>(t, data, d, shape), name) {}
 
+    explicit Buffer(Type t,
+                    Internal::add_const_if_T_is_const<T, void> *data,
+                    int d,
+                    const halide_dimension_t *shape,
+                    void (*release_fn)(void *),
+                    void *release_context,
+                    const std::string &name = "") :
+        Buffer(Runtime::Buffer<T>(t, data, d, shape, release_fn, release_context), name) {}
+
     explicit Buffer(T *data,
                     int d,
                     const halide_dimension_t *shape,
@@ -1,4 +1,6 @@
+#include <cstring>
 #include <map>
+#include <unordered_map>
 
 #include "CSE.h"
 #include "IRMutator.h"
@@ -78,6 +80,76 @@ bool should_extract(const Expr &e, bool lift_all) {
     return true;
 }
 
+// A structural hash of Exprs: equal Exprs have equal hashes. Hashes
+// are memoized per node, so hashing a graph of IR costs time linear in
+// its number of distinct nodes, however large it is as a tree.
+class ExprHash {
+    std::unordered_map<const IRNode *, uint64_t> hashes;
+    // Keeps the hashed nodes alive, so their addresses aren't reused.
+    vector<Expr> hashed;
+
+    static uint64_t mix(uint64_t h, uint64_t x) {
+        return h ^ (x + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2));
+    }
+
+    static uint64_t hash_string(const string &s) {
+        return std::hash<string>()(s);
+    }
+
+    // Mixes in the hashes of the Exprs directly under a node.
+    class Children : public IRGraphVisitor {
+        ExprHash &parent;
+    public:
+        uint64_t h;
+        Children(ExprHash &p, uint64_t h) : parent(p), h(h) {}
+
+        using IRGraphVisitor::include;
+        void include(const Expr &e) override {
+            h = mix(h, parent.hash(e));
+        }
+    };
+
+public:
+    uint64_t hash(const Expr &e) {
+        auto iter = hashes.find(e.get());
+        if (iter != hashes.end()) {
+            return iter->second;
+        }
+
+        uint64_t h = mix((uint64_t)e->node_type, e.type().bits());
+        h = mix(h, ((uint64_t)e.type().code() << 32) | (uint64_t)e.type().lanes());
+        if (const IntImm *op = e.as<IntImm>()) {
+            h = mix(h, (uint64_t)op->value);
+        } else if (const UIntImm *op = e.as<UIntImm>()) {
+            h = mix(h, op->value);
+        } else if (const FloatImm *op = e.as<FloatImm>()) {
+            uint64_t bits;
+            memcpy(&bits, &op->value, sizeof(bits));
+            h = mix(h, bits);
+        } else if (const StringImm *op = e.as<StringImm>()) {
+            h = mix(h, hash_string(op->value));
+        } else if (const Variable *op = e.as<Variable>()) {
+            h = mix(h, hash_string(op->name));
+        } else if (const Load *op = e.as<Load>()) {
+            h = mix(h, hash_string(op->name));
+        } else if (const Call *op = e.as<Call>()) {
+            h = mix(h, hash_string(op->name));
+            h = mix(h, ((uint64_t)op->call_type << 32) | (uint64_t)op->value_index);
+        } else if (const Shuffle *op = e.as<Shuffle>()) {
+            for (int i : op->indices) {
+                h = mix(h, (uint64_t)i);
+            }
+        }
+
+        Children children(*this, h);
+        e.accept(&children);
+
+        hashes[e.get()] = children.h;
+        hashed.push_back(e);
+        return children.h;
+    }
+};
+
 // A global-value-numbering of expressions. Returns canonical form of
 // the Expr and writes out a global value numbering as a side-effect.
 class GVN : public IRMutator2 {
@@ -88,8 +160,11 @@ public:
     };
     vector<Entry> entries;
 
-    typedef map<ExprWithCompareCache, int> CacheType;
+    // Ordered first by structural hash, so that the deep comparisons
+    // are only needed to resolve an exact match or a collision.
+    typedef map<pair<uint64_t, ExprWithCompareCache>, int> CacheType;
     CacheType numbering;
+    ExprHash hasher;
 
     map<Expr, int, ExprCompare> shallow_numbering;
 
@@ -105,8 +180,8 @@ public:
         return Stmt();
     }
 
-    ExprWithCompareCache with_cache(Expr e) {
-        return ExprWithCompareCache(e, &cache);
+    pair<uint64_t, ExprWithCompareCache> with_cache(Expr e) {
+        return {hasher.hash(e), ExprWithCompareCache(e, &cache)};
     }
 
     Expr mutate(const Expr &e) override {
@@ -267,14 +342,51 @@ public:
     }
 };
 
+/** Give fresh names to the lets made by CSE, so that a copy of a
+ * CSE'd Expr can be used elsewhere in the same Stmt. */
+class RenameLets : public IRMutator2 {
+    Scope<string> new_names;
+
+    using IRMutator2::visit;
+
+    Expr visit(const Variable *op) override {
+        if (new_names.contains(op->name)) {
+            return Variable::make(op->type, new_names.get(op->name));
+        }
+        return op;
+    }
+
+    Expr visit(const Let *op) override {
+        string name = unique_name('t');
+        Expr value = mutate(op->value);
+        ScopedBinding<string> bind(new_names, op->name, name);
+        Expr body = mutate(op->body);
+        return Let::make(name, value, body);
+    }
+};
+
 class CSEEveryExprInStmt : public IRMutator2 {
     bool lift_all;
 
+    // Loop partitioning and unrolling make copies of loop bodies that
+    // share most of their Exprs, so each distinct Expr is only
+    // processed once.
+    map<Expr, Expr, ExprCompare> done;
+
 public:
     using IRMutator2::mutate;
 
     Expr mutate(const Expr &e) override {
-        return common_subexpression_elimination(e, lift_all);
+        auto iter = done.find(e);
+        if (iter != done.end()) {
+            if (iter->second.as<Let>()) {
+                return RenameLets().mutate(iter->second);
+            }
+            return iter->second;
+        }
+        Expr result = common_subexpression_elimination(e, lift_all);
+        done[e] = result;
+        return result;
     }
 
     CSEEveryExprInStmt(bool l) : lift_all(l) {}
@@ -532,6 +644,22 @@ void cse_test() {
         check(e, correct);
     }
 
+    {
+        // An Expr used twice in a Stmt is only CSE'd once, but each
+        // use gets lets of its own.
+        Expr x = Variable::make(Int(32), "x");
+        e = (x * x + 1) * (x * x + 1);
+        Stmt s = Block::make(Evaluate::make(e), Evaluate::make(e));
+        s = common_subexpression_elimination(s);
+        const Block *b = s.as<Block>();
+        internal_assert(b);
+        const Let *first = b->first.as<Evaluate>()->value.as<Let>();
+        const Let *rest = b->rest.as<Evaluate>()->value.as<Let>();
+        internal_assert(first && rest && first->name != rest->name)
+            << "Copies of a CSE'd Expr share a let:\n" << s << "\n";
+        internal_assert(equal(first->value, rest->value));
+    }
+
     debug(0) << "common_subexpression_elimination test passed\n";
 }
 
@@ -427,8 +427,109 @@ void CodeGen_ARM::visit(const Div *op) {
     CodeGen_Posix::visit(op);
 }
 
+namespace {
+
+// Flatten a tree of adds into its list of terms.
+void collect_add_terms(Expr e, vector<Expr> &terms) {
+    if (const Add *add = e.as<Add>()) {
+        collect_add_terms(add->a, terms);
+        collect_add_terms(add->b, terms);
+    } else {
+        terms.push_back(e);
+    }
+}
+
+}
+
+bool CodeGen_ARM::try_dot_prod(const Add *op) {
+#if LLVM_VERSION >= 70
+    // A 32-bit accumulator plus a sum of products of 8-bit values is
+    // a dot product, if we interleave the operands of groups of four
+    // products. sdot sums products of i8 with i8, and udot sums
+    // products of u8 with u8.
+    Type t = op->type;
+    if (!target.has_feature(Target::ARMDotProd) ||
+        t.is_float() || t.bits() != 32 || t.lanes() < 4) {
+        return false;
+    }
+
+    vector<Expr> terms;
+    collect_add_terms(op, terms);
+
+    Type i8_t = Int(8, t.lanes()), u8_t = UInt(8, t.lanes());
+    vector<Expr> acc_terms, signed_a, signed_b, unsigned_a, unsigned_b;
+    for (const Expr &e : terms) {
+        const Mul *mul = e.as<Mul>();
+        Expr sa, sb, ua, ub;
+        if (mul) {
+            sa = lossless_cast(i8_t, mul->a);
+            sb = lossless_cast(i8_t, mul->b);
+            ua = lossless_cast(u8_t, mul->a);
+            ub = lossless_cast(u8_t, mul->b);
+        }
+        if (sa.defined() && sb.defined()) {
+            signed_a.push_back(sa);
+            signed_b.push_back(sb);
+        } else if (ua.defined() && ub.defined()) {
+            unsigned_a.push_back(ua);
+            unsigned_b.push_back(ub);
+        } else {
+            acc_terms.push_back(e);
+        }
+    }
+
+    // Products that don't fill a group of four stay in the accumulator.
+    while (signed_a.size() % 4) {
+        acc_terms.push_back(cast(t, signed_a.back()) * cast(t, signed_b.back()));
+        signed_a.pop_back();
+        signed_b.pop_back();
+    }
+    while (unsigned_a.size() % 4) {
+        acc_terms.push_back(cast(t, unsigned_a.back()) * cast(t, unsigned_b.back()));
+        unsigned_a.pop_back();
+        unsigned_b.pop_back();
+    }
+    if (signed_a.empty() && unsigned_a.empty()) {
+        return false;
+    }
+
+    Expr acc_expr;
+    for (const Expr &e : acc_terms) {
+        acc_expr = acc_expr.defined() ? acc_expr + e : e;
+    }
+    if (!acc_expr.defined()) {
+        acc_expr = make_zero(t);
+    }
+
+    Value *acc = codegen(acc_expr);
+    auto dot = [&](const Pattern &p, const vector<Expr> &a, const vector<Expr> &b) {
+        Value *va = codegen(Shuffle::make_interleave(a));
+        Value *vb = codegen(Shuffle::make_interleave(b));
+        acc = call_pattern(p, acc->getType(), {acc, va, vb});
+    };
+    Pattern sdot("sdot.v4i32.v16i8", "sdot.v4i32.v16i8", 4, Expr());
+    Pattern udot("udot.v4i32.v16i8", "udot.v4i32.v16i8", 4, Expr());
+    for (size_t i = 0; i < signed_a.size(); i += 4) {
+        dot(sdot,
+            {signed_a.begin() + i, signed_a.begin() + i + 4},
+            {signed_b.begin() + i, signed_b.begin() + i + 4});
+    }
+    for (size_t i = 0; i < unsigned_a.size(); i += 4) {
+        dot(udot,
+            {unsigned_a.begin() + i, unsigned_a.begin() + i + 4},
+            {unsigned_b.begin() + i, unsigned_b.begin() + i + 4});
+    }
+    value = acc;
+    return true;
+#else
+    return false;
+#endif
+}
+
 void CodeGen_ARM::visit(const Add *op) {
-    CodeGen_Posix::visit(op);
+    if (neon_intrinsics_disabled() || !try_dot_prod(op)) {
+        CodeGen_Posix::visit(op);
+    }
 }
 
 void CodeGen_ARM::visit(const Sub *op) {
@@ -972,19 +1073,29 @@ string CodeGen_ARM::mcpu() const {
 }
 
 string CodeGen_ARM::mattrs() const {
+    string extensions = target.has_feature(Target::ARMDotProd) ? "+dotprod" : "";
+    if (target.has_feature(Target::ARMFp16)) {
+        // Keep Float(16) arithmetic in half registers.
+        extensions += extensions.empty() ? "+fullfp16" : ",+fullfp16";
+    }
+    if (target.bits == 64 && target.has_feature(Target::SVE)) {
+        // LLVM can't yet represent scalable vectors, so this only
+        // lets it select SVE instructions for fixed-width code.
+        extensions += extensions.empty() ? "+sve" : ",+sve";
+    }
     if (target.bits == 32) {
         if (target.has_feature(Target::ARMv7s)) {
             return "+neon";
         } if (!target.has_feature(Target::NoNEON)) {
-            return "+neon";
+            return extensions.empty() ? "+neon" : "+neon," + extensions;
         } else {
             return "-neon";
         }
     } else {
         if (target.os == Target::IOS || target.os == Target::OSX) {
-            return "+reserve-x18";
+            return extensions.empty() ? "+reserve-x18" : "+reserve-x18," + extensions;
         } else {
-            return "";
+            return extensions;
         }
     }
 }
@@ -1002,4 +1113,9 @@ int CodeGen_ARM::native_vector_bits() const {
     return 128;
 }
 
+bool CodeGen_ARM::use_nontemporal_stores() const {
+    // AArch64 has stnp. The default fence (dmb ish) orders them.
+    return target.bits == 64;
+}
+
 }}
@@ -20,6 +20,8 @@ protected:
 
     Expr sorted_avg(Expr a, Expr b);
 
+    bool use_nontemporal_stores() const;
+
     using CodeGen_Posix::visit;
 
     /** Nodes for which we want to emit specific neon intrinsics */
@@ -56,6 +58,10 @@ protected:
     };
     std::vector<Pattern> casts, left_shifts, averagings, negations;
 
+    /** Try to generate an add of products of 8-bit values as ARMv8.2
+     * dot products. Returns false if it doesn't match. */
+    bool try_dot_prod(const Add *op);
+
     // Call an intrinsic as defined by a pattern. Dispatches to the
     // 32- or 64-bit name depending on the target's bit width.
     // @{
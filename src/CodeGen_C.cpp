@@ -183,6 +183,12 @@ public:
     // the size of its input vector. Make sure this type exists.
     void visit(const Shuffle *op) {
         vector_types_used.insert(Int(32, op->vectors[0].type().lanes()));
+        if (op->vectors.size() > 1) {
+            // The inputs are concatenated before shuffling.
+            Type t = op->vectors[0].type();
+            t = (t.is_bool() ? UInt(8) : t).with_lanes(t.lanes() * (int)op->vectors.size());
+            vector_types_used.insert(t);
+        }
         IRGraphVisitor::visit(op);
     }
 
@@ -491,7 +497,9 @@ public:
         }
     }
 
-    static Vec shuffle(const Vec &a, const int32_t indices[Lanes]) {
+    // The input may have a different number of lanes than the result.
+    template<typename InputVec>
+    static Vec shuffle(const InputVec &a, const int32_t indices[Lanes]) {
         Vec r(empty);
         for (size_t i = 0; i < Lanes; i++) {
             if (indices[i] < 0) {
@@ -502,11 +510,11 @@ public:
         return r;
     }
 
-    template<size_t InputLanes>
-    static Vec concat(size_t count, const CppVector<ElementType, InputLanes> vecs[]) {
+    template<typename InputVec>
+    static Vec concat(size_t count, const InputVec vecs[]) {
         Vec r(empty);
         for (size_t i = 0; i < Lanes; i++) {
-            r.elements[i] = vecs[i / InputLanes][i % InputLanes];
+            r.elements[i] = vecs[i / InputVec::Lanes][i % InputVec::Lanes];
         }
         return r;
     }
@@ -818,6 +826,14 @@ private:
 
         const char *native_vector_decl = R"INLINE_CODE(
 #if __has_attribute(ext_vector_type) || __has_attribute(vector_size)
+// The signed integer type with the same size as a vector element; native
+// vector comparisons produce vectors of these.
+template <size_t Bytes> struct halide_cpp_int_of_size {};
+template <> struct halide_cpp_int_of_size<1> { typedef int8_t type; };
+template <> struct halide_cpp_int_of_size<2> { typedef int16_t type; };
+template <> struct halide_cpp_int_of_size<4> { typedef int32_t type; };
+template <> struct halide_cpp_int_of_size<8> { typedef int64_t type; };
+
 template <typename ElementType_, size_t Lanes_>
 class NativeVector {
 public:
@@ -826,10 +842,13 @@ public:
     typedef NativeVector<ElementType, Lanes> Vec;
     typedef NativeVector<uint8_t, Lanes> Mask;
 
+    typedef typename halide_cpp_int_of_size<sizeof(ElementType)>::type BitsElementType;
 #if __has_attribute(ext_vector_type)
     typedef ElementType_ NativeVectorType __attribute__((ext_vector_type(Lanes), aligned(sizeof(ElementType))));
+    typedef BitsElementType NativeBitsType __attribute__((ext_vector_type(Lanes), aligned(sizeof(ElementType))));
 #elif __has_attribute(vector_size) || __GNUC__
     typedef ElementType_ NativeVectorType __attribute__((vector_size(Lanes * sizeof(ElementType)), aligned(sizeof(ElementType))));
+    typedef BitsElementType NativeBitsType __attribute__((vector_size(Lanes * sizeof(ElementType)), aligned(sizeof(ElementType))));
 #endif
 
     NativeVector &operator=(const Vec &src) {
@@ -891,8 +910,11 @@ public:
         }
     }
 
-    // TODO: this should be improved by taking advantage of native operator support.
-    static Vec shuffle(const Vec &a, const int32_t indices[Lanes]) {
+    // The input may have a different number of lanes than the result. The
+    // indices are compile-time constants in generated code, so compilers
+    // can turn this into a single shuffle.
+    template<typename InputVec>
+    static Vec shuffle(const InputVec &a, const int32_t indices[Lanes]) {
         Vec r(empty);
         for (size_t i = 0; i < Lanes; i++) {
             if (indices[i] < 0) {
@@ -904,11 +926,11 @@ public:
     }
 
     // TODO: this should be improved by taking advantage of native operator support.
-    template<size_t InputLanes>
-    static Vec concat(size_t count, const NativeVector<ElementType, InputLanes> vecs[]) {
+    template<typename InputVec>
+    static Vec concat(size_t count, const InputVec vecs[]) {
         Vec r(empty);
         for (size_t i = 0; i < Lanes; i++) {
-            r.native_vector[i] = vecs[i / InputLanes][i % InputLanes];
+            r.native_vector[i] = vecs[i / InputVec::Lanes][i % InputVec::Lanes];
         }
         return r;
     }
@@ -1012,67 +1034,32 @@ public:
         return Vec(from_native_vector, a | b.native_vector);
     }
 
-    // TODO: this should be improved by taking advantage of native operator support.
     friend Mask operator<(const Vec &a, const Vec &b) {
-        Mask r;
-        for (size_t i = 0; i < Lanes; i++) {
-            r.native_vector[i] = a[i] < b[i] ? 0xff : 0x00;
-        }
-        return r;
+        return to_mask((NativeBitsType)(a.native_vector < b.native_vector));
     }
 
-    // TODO: this should be improved by taking advantage of native operator support.
     friend Mask operator<=(const Vec &a, const Vec &b) {
-        Mask r;
-        for (size_t i = 0; i < Lanes; i++) {
-            r.native_vector[i] = a[i] <= b[i] ? 0xff : 0x00;
-        }
-        return r;
+        return to_mask((NativeBitsType)(a.native_vector <= b.native_vector));
     }
 
-    // TODO: this should be improved by taking advantage of native operator support.
     friend Mask operator>(const Vec &a, const Vec &b) {
-        Mask r;
-        for (size_t i = 0; i < Lanes; i++) {
-            r.native_vector[i] = a[i] > b[i] ? 0xff : 0x00;
-        }
-        return r;
+        return to_mask((NativeBitsType)(a.native_vector > b.native_vector));
     }
 
-    // TODO: this should be improved by taking advantage of native operator support.
     friend Mask operator>=(const Vec &a, const Vec &b) {
-        Mask r;
-        for (size_t i = 0; i < Lanes; i++) {
-            r.native_vector[i] = a[i] >= b[i] ? 0xff : 0x00;
-        }
-        return r;
+        return to_mask((NativeBitsType)(a.native_vector >= b.native_vector));
     }
 
-    // TODO: this should be improved by taking advantage of native operator support.
     friend Mask operator==(const Vec &a, const Vec &b) {
-        Mask r;
-        for (size_t i = 0; i < Lanes; i++) {
-            r.native_vector[i] = a[i] == b[i] ? 0xff : 0x00;
-        }
-        return r;
+        return to_mask((NativeBitsType)(a.native_vector == b.native_vector));
     }
 
-    // TODO: this should be improved by taking advantage of native operator support.
     friend Mask operator!=(const Vec &a, const Vec &b) {
-        Mask r;
-        for (size_t i = 0; i < Lanes; i++) {
-            r.native_vector[i] = a[i] != b[i] ? 0xff : 0x00;
-        }
-        return r;
+        return to_mask((NativeBitsType)(a.native_vector != b.native_vector));
     }
 
-    // TODO: this should be improved by taking advantage of native operator support.
     static Vec select(const Mask &cond, const Vec &true_value, const Vec &false_value) {
-        Vec r(empty);
-        for (size_t i = 0; i < Lanes; i++) {
-            r.native_vector[i] = cond[i] ? true_value[i] : false_value[i];
-        }
-        return r;
+        return Vec(from_native_vector, blend(from_mask(cond), true_value.native_vector, false_value.native_vector));
     }
 
     template <typename OtherVec>
@@ -1095,27 +1082,51 @@ public:
 #endif
     }
 
-    // TODO: this should be improved by taking advantage of native operator support.
+    // Same semantics as halide_cpp_max/halide_cpp_min, including for NaNs.
     static Vec max(const Vec &a, const Vec &b) {
-        Vec r(empty);
+        return Vec(from_native_vector, blend((NativeBitsType)(a.native_vector > b.native_vector), a.native_vector, b.native_vector));
+    }
+
+    static Vec min(const Vec &a, const Vec &b) {
+        return Vec(from_native_vector, blend((NativeBitsType)(a.native_vector < b.native_vector), a.native_vector, b.native_vector));
+    }
+
+private:
+    template<typename, size_t> friend class NativeVector;
+
+    // Pick lanes from a where mask is all ones, and from b where it is zero.
+    // Casts between vectors of the same size are bitcasts.
+    static NativeVectorType blend(const NativeBitsType &mask, const NativeVectorType &a, const NativeVectorType &b) {
+        return (NativeVectorType)((((NativeBitsType)a) & mask) | (((NativeBitsType)b) & ~mask));
+    }
+
+    // Narrow the result of a native comparison (all ones or zero in each lane) to a Mask.
+    static Mask to_mask(const NativeBitsType &bits) {
+        Mask r(Mask::empty);
+#if __has_builtin(__builtin_convertvector)
+        r.native_vector = __builtin_convertvector(bits, typename Mask::NativeVectorType);
+#else
         for (size_t i = 0; i < Lanes; i++) {
-            r.native_vector[i] = ::halide_cpp_max(a[i], b[i]);
+            r.native_vector[i] = bits[i] ? 0xff : 0x00;
         }
+#endif
         return r;
     }
 
-    // TODO: this should be improved by taking advantage of native operator support.
-    static Vec min(const Vec &a, const Vec &b) {
-        Vec r(empty);
+    // Widen a Mask (any nonzero value is true) to all ones or zero in each lane.
+    static NativeBitsType from_mask(const Mask &cond) {
+        const typename Mask::NativeBitsType bits8 = (typename Mask::NativeBitsType)(cond.native_vector != 0);
+#if __has_builtin(__builtin_convertvector)
+        return __builtin_convertvector(bits8, NativeBitsType);
+#else
+        NativeBitsType r;
         for (size_t i = 0; i < Lanes; i++) {
-            r.native_vector[i] = ::halide_cpp_min(a[i], b[i]);
+            r[i] = bits8[i];
         }
         return r;
+#endif
     }
 
-private:
-    template<typename, size_t> friend class NativeVector;
-
     NativeVectorType native_vector;
 
     // Leave vector uninitialized for cases where we overwrite every entry
@@ -2143,6 +2154,13 @@ void CodeGen_C::visit(const Call *op) {
         internal_assert(op->args.size() == 1);
         string arg0 = print_expr(op->args[0]);
         rhs << "(" << arg0 << ")";
+    } else if (op->is_intrinsic(Call::nontemporal_store)) {
+        // Non-temporal stores are only a hint.
+        internal_assert(op->args.size() == 1);
+        string arg0 = print_expr(op->args[0]);
+        rhs << "(" << arg0 << ")";
+    } else if (op->is_intrinsic(Call::atomic_update)) {
+        user_error << "Atomic updates are not supported by the C backend, or by GPU APIs other than CUDA.\n";
     } else if (op->is_intrinsic()) {
         // TODO: other intrinsics
         internal_error << "Unhandled intrinsic in C backend: " << op->name << '\n';
@@ -2603,13 +2621,16 @@ void CodeGen_C::visit(const Shuffle *op) {
     }
     string src = vecs[0];
     if (op->vectors.size() > 1) {
+        // Concatenate all of the inputs, which may be more lanes than
+        // the result (e.g. when deinterleaving).
+        Type concat_type = op->vectors[0].type().with_lanes(max_index);
         ostringstream rhs;
         string storage_name = unique_name('_');
         do_indent();
         stream << "const " << print_type(op->vectors[0].type()) << " " << storage_name << "[] = { " << with_commas(vecs) << " };\n";
 
-        rhs << print_type(op->type) << "::concat(" << op->vectors.size() << ", " << storage_name << ")";
-        src = print_assignment(op->type, rhs.str());
+        rhs << print_type(concat_type) << "::concat(" << op->vectors.size() << ", " << storage_name << ")";
+        src = print_assignment(concat_type, rhs.str());
     }
     ostringstream rhs;
     if (op->type.is_scalar()) {
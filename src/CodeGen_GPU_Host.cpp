@@ -539,4 +539,12 @@ template class CodeGen_GPU_Host<CodeGen_MIPS>;
 template class CodeGen_GPU_Host<CodeGen_PowerPC>;
 #endif
 
+#ifdef WITH_WEBASSEMBLY
+template class CodeGen_GPU_Host<CodeGen_WebAssembly>;
+#endif
+
+#ifdef WITH_RISCV
+template class CodeGen_GPU_Host<CodeGen_RISCV>;
+#endif
+
 }}
@@ -11,6 +11,8 @@
 #include "CodeGen_X86.h"
 #include "CodeGen_MIPS.h"
 #include "CodeGen_PowerPC.h"
+#include "CodeGen_WebAssembly.h"
+#include "CodeGen_RISCV.h"
 
 #include "IR.h"
 
@@ -337,6 +337,12 @@ void CodeGen_Hexagon::compile_func(const LoweredFunc &f,
     debug(1) << "Optimizing Hexagon instructions...\n";
     body = optimize_hexagon_instructions(body, target);
 
+#if LLVM_VERSION >= 70
+    debug(1) << "Generating vgathers...\n";
+    body = vgather_generator(body, target);
+    debug(2) << "Lowering after generating vgathers:\n" << body << "\n\n";
+#endif
+
     debug(1) << "Adding calls to qurt_hvx_lock, if necessary...\n";
     body = inject_hvx_lock_unlock(body, target);
 
@@ -1765,6 +1771,41 @@ void CodeGen_Hexagon::visit(const Call *op) {
             << "see https://github.com/halide/Halide/issues/1582\n" << Expr(op) << "\n";
     }
 
+#if LLVM_VERSION >= 70
+    if (op->name == "halide.hexagon.vgather") {
+        // Generated by vgather_generator: gather op->type from the VTCM
+        // buffer args[2] (of size args[3] + 1 bytes) at the byte offsets
+        // args[4] into the VTCM buffer args[0] at element args[1].
+        internal_assert(op->args.size() == 5);
+        const Variable *dst = op->args[0].as<Variable>();
+        internal_assert(dst);
+        bool is_128B = target.has_feature(Halide::Target::HVX_128);
+        Type ty = op->type;
+        Intrinsic::ID id;
+        if (ty.bits() == 32) {
+            id = IPICK(is_128B, Intrinsic::hexagon_V6_vgathermw);
+        } else if (op->args[4].type().bits() == 16) {
+            id = IPICK(is_128B, Intrinsic::hexagon_V6_vgathermh);
+        } else {
+            // 16-bit elements at 32-bit offsets, held in a vector pair.
+            id = IPICK(is_128B, Intrinsic::hexagon_V6_vgathermhw);
+        }
+
+        Value *src = builder->CreatePtrToInt(codegen(op->args[2]), i32_t);
+        Value *region = codegen(op->args[3]);
+        Value *offsets = codegen(op->args[4]);
+        int native_lanes = native_vector_bits() / ty.bits();
+        for (int i = 0; i < ty.lanes(); i += native_lanes) {
+            Value *dst_ptr = codegen_buffer_pointer(dst->name, ty.element_of(),
+                                                    simplify(op->args[1] + i));
+            call_intrin_cast(void_t, id, {dst_ptr, src, region,
+                                          slice_vector(offsets, i, native_lanes)});
+        }
+        value = UndefValue::get(llvm_type_of(ty));
+        return;
+    }
+#endif
+
     if (starts_with(op->name, "halide.hexagon.")) {
         // Handle all of the intrinsics we generated in
         // hexagon_optimize.  I'm not sure why this is different than
@@ -1934,6 +1975,24 @@ void CodeGen_Hexagon::visit(const Select *op) {
     }
 }
 
+void CodeGen_Hexagon::visit(const Allocate *alloc) {
+    if (alloc->memory_type == MemoryType::VTCM && !alloc->new_expr.defined()) {
+        // Allocate from the VTCM scratchpad via the runtime, which falls
+        // back to the heap if there is no VTCM, or not enough of it.
+        Expr size = alloc->type.bytes();
+        for (const Expr &e : alloc->extents) {
+            size *= e;
+        }
+        size = cast(UInt(target.bits), simplify(size + allocation_padding(alloc->type)));
+        Expr new_expr = Call::make(Handle(), "halide_vtcm_malloc", {size}, Call::Extern);
+        Stmt s = Allocate::make(alloc->name, alloc->type, alloc->memory_type, alloc->extents,
+                                alloc->condition, alloc->body, new_expr, "halide_vtcm_free");
+        s.accept(this);
+        return;
+    }
+    CodeGen_Posix::visit(alloc);
+}
+
 void CodeGen_Hexagon::visit(const GT *op) {
     if (op->type.is_vector()) {
         value = call_intrin(eliminated_bool_type(op->type, op->a.type()),
@@ -166,8 +166,10 @@ bool function_takes_user_context(const std::string &name) {
         "halide_spawn_thread",
         "halide_device_release",
         "halide_start_clock",
+        "halide_telemetry_report",
         "halide_trace",
         "halide_trace_helper",
+        "halide_memoization_cache_hash_buffer",
         "halide_memoization_cache_lookup",
         "halide_memoization_cache_store",
         "halide_memoization_cache_release",
@@ -190,6 +192,8 @@ bool function_takes_user_context(const std::string &name) {
         "halide_qurt_hvx_lock",
         "halide_qurt_hvx_unlock",
         "halide_qurt_hvx_unlock_as_destructor",
+        "halide_vtcm_malloc",
+        "halide_vtcm_free",
         "halide_cuda_initialize_kernels",
         "halide_opencl_initialize_kernels",
         "halide_opengl_initialize_kernels",
@@ -412,6 +416,16 @@ void get_target_options(const llvm::Module &module, llvm::TargetOptions &options
     options.FloatABIType =
         use_soft_float_abi ? llvm::FloatABI::Soft : llvm::FloatABI::Hard;
     options.RelaxELFRelocations = false;
+    #if LLVM_VERSION >= 90
+    // RISC-V picks its calling convention by name rather than by
+    // FloatABIType. Pass floats in registers, as C code on Linux does.
+    llvm::Triple triple(module.getTargetTriple());
+    if (!use_soft_float_abi && triple.getArch() == llvm::Triple::riscv64) {
+        options.MCOptions.ABIName = "lp64d";
+    } else if (!use_soft_float_abi && triple.getArch() == llvm::Triple::riscv32) {
+        options.MCOptions.ABIName = "ilp32d";
+    }
+    #endif
 }
 
 
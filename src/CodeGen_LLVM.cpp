@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <exception>
 #include <iostream>
 #include <limits>
 #include <sstream>
@@ -10,12 +12,17 @@
 #include "CodeGen_Internal.h"
 #include "CodeGen_MIPS.h"
 #include "CodeGen_PowerPC.h"
+#include "CodeGen_RISCV.h"
+#include "CodeGen_WebAssembly.h"
 #include "CodeGen_X86.h"
 #include "CPlusPlusMangle.h"
 #include "CSE.h"
 #include "Debug.h"
 #include "Deinterleave.h"
+#include "ExprUsesVar.h"
 #include "IntegerDivisionTable.h"
+#include "IREquality.h"
+#include "IRMutator.h"
 #include "IRPrinter.h"
 #include "IROperator.h"
 #include "JITModule.h"
@@ -23,7 +30,10 @@
 #include "LLVM_Headers.h"
 #include "LLVM_Runtime_Linker.h"
 #include "MatlabWrapper.h"
+#include "NarrowIndices.h"
 #include "Simplify.h"
+#include "Substitute.h"
+#include "ThreadPool.h"
 #include "Util.h"
 
 #if !(__cplusplus > 199711L || _MSC_VER >= 1800)
@@ -36,7 +46,113 @@
 
 namespace Halide {
 
+namespace {
+
+// A module's functions can be compiled separately when they don't call
+// each other and don't share any global state, which lives in its
+// buffers and external code.
+bool can_codegen_in_parallel(const Module &module) {
+    if (module.functions().size() < 2 ||
+        !module.buffers().empty() ||
+        !module.external_code().empty()) {
+        return false;
+    }
+    for (const auto &f : module.functions()) {
+        if (f.linkage == LinkageType::Internal) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Generate and optimize the code for a module in a context of its
+// own, and return it as bitcode, which is the only way to move it
+// into another context.
+std::string codegen_llvm_to_bitcode(const Module &module) {
+    llvm::LLVMContext context;
+    std::unique_ptr<Internal::CodeGen_LLVM> cg(Internal::CodeGen_LLVM::new_for_target(module.target(), context));
+    std::unique_ptr<llvm::Module> m = cg->compile(module);
+
+    std::string bitcode;
+    llvm::raw_string_ostream out(bitcode);
+#if LLVM_VERSION >= 70
+    WriteBitcodeToFile(*m, out);
+#else
+    WriteBitcodeToFile(m.get(), out);
+#endif
+    out.flush();
+    return bitcode;
+}
+
+// Generate and optimize the code for each function of a module on a
+// thread of its own, and then link the results together. The runtime
+// linked into each one is weak, so the copies get merged.
+std::unique_ptr<llvm::Module> codegen_llvm_in_parallel(const Module &module, llvm::LLVMContext &context) {
+    Internal::CodeGen_LLVM::initialize_llvm();
+
+    const std::vector<Internal::LoweredFunc> &functions = module.functions();
+    Internal::debug(1) << "Generating llvm bitcode for " << functions.size() << " functions in parallel...\n";
+
+    // Errors are reported on this thread, so they can be caught.
+    std::vector<std::exception_ptr> errors(functions.size());
+    std::vector<std::future<std::string>> bitcode;
+    {
+        size_t threads = std::min(functions.size(), Internal::ThreadPool<std::string>::num_processors_online());
+        Internal::ThreadPool<std::string> pool(std::max(threads, (size_t)1));
+        for (size_t i = 0; i < functions.size(); i++) {
+            Module part(module.name(), module.target());
+            part.append(functions[i]);
+            part.set_any_strict_float(module.any_strict_float());
+            for (const auto &it : module.get_metadata_name_map()) {
+                part.remap_metadata_name(it.first, it.second);
+            }
+            std::exception_ptr *error = &errors[i];
+            bitcode.push_back(pool.async([part, error]() -> std::string {
+#ifdef WITH_EXCEPTIONS
+                try {
+                    return codegen_llvm_to_bitcode(part);
+                } catch (...) {
+                    *error = std::current_exception();
+                    return std::string();
+                }
+#else
+                return codegen_llvm_to_bitcode(part);
+#endif
+            }));
+        }
+        for (auto &b : bitcode) {
+            b.wait();
+        }
+    }
+    for (const auto &e : errors) {
+        if (e) {
+            std::rethrow_exception(e);
+        }
+    }
+
+    std::unique_ptr<llvm::Module> result;
+    for (size_t i = 0; i < bitcode.size(); i++) {
+        std::string b = bitcode[i].get();
+        llvm::MemoryBufferRef buffer(b, functions[i].name);
+        auto m = llvm::expectedToErrorOr(llvm::parseBitcodeFile(buffer, context));
+        internal_assert(m) << "Could not read back the code generated for " << functions[i].name << "\n";
+        if (!result) {
+            result = std::move(*m);
+        } else {
+            bool failed = llvm::Linker::linkModules(*result, std::move(*m));
+            internal_assert(!failed) << "Failure linking the code generated for " << functions[i].name << "\n";
+        }
+    }
+    result->setModuleIdentifier(module.name());
+    return result;
+}
+
+}  // namespace
+
 std::unique_ptr<llvm::Module> codegen_llvm(const Module &module, llvm::LLVMContext &context) {
+    if (can_codegen_in_parallel(module)) {
+        return codegen_llvm_in_parallel(module, context);
+    }
     std::unique_ptr<Internal::CodeGen_LLVM> cg(Internal::CodeGen_LLVM::new_for_target(module.target(), context));
     return cg->compile(module);
 }
@@ -125,6 +241,18 @@ using std::stack;
 #define InitializePowerPCAsmPrinter()   InitializeAsmPrinter(PowerPC)
 #endif
 
+#ifdef WITH_WEBASSEMBLY
+#define InitializeWebAssemblyTarget()       InitializeTarget(WebAssembly)
+#define InitializeWebAssemblyAsmParser()    InitializeAsmParser(WebAssembly)
+#define InitializeWebAssemblyAsmPrinter()   InitializeAsmPrinter(WebAssembly)
+#endif
+
+#ifdef WITH_RISCV
+#define InitializeRISCVTarget()       InitializeTarget(RISCV)
+#define InitializeRISCVAsmParser()    InitializeAsmParser(RISCV)
+#define InitializeRISCVAsmPrinter()   InitializeAsmPrinter(RISCV)
+#endif
+
 #ifdef WITH_HEXAGON
 #define InitializeHexagonTarget()       InitializeTarget(Hexagon)
 #define InitializeHexagonAsmParser()    InitializeAsmParser(Hexagon)
@@ -259,7 +387,8 @@ CodeGen_LLVM::CodeGen_LLVM(Target t) :
     min_f64(Float(64).min()),
     max_f64(Float(64).max()),
     destructor_block(nullptr),
-    strict_float(t.has_feature(Target::StrictFloat)) {
+    strict_float(t.has_feature(Target::StrictFloat)),
+    in_nontemporal_store(false), emitted_nontemporal_store(false) {
     initialize_llvm();
 }
 
@@ -307,6 +436,16 @@ CodeGen_LLVM *CodeGen_LLVM::new_for_target(const Target &target,
             return make_codegen<CodeGen_GPU_Host<CodeGen_PowerPC>>(target, context);
         }
 #endif
+#ifdef WITH_WEBASSEMBLY
+        if (target.arch == Target::WebAssembly) {
+            return make_codegen<CodeGen_GPU_Host<CodeGen_WebAssembly>>(target, context);
+        }
+#endif
+#ifdef WITH_RISCV
+        if (target.arch == Target::RISCV) {
+            return make_codegen<CodeGen_GPU_Host<CodeGen_RISCV>>(target, context);
+        }
+#endif
 
         user_error << "Invalid target architecture for GPU backend: "
                    << target.to_string() << "\n";
@@ -320,6 +459,10 @@ CodeGen_LLVM *CodeGen_LLVM::new_for_target(const Target &target,
         return make_codegen<CodeGen_MIPS>(target, context);
     } else if (target.arch == Target::POWERPC) {
         return make_codegen<CodeGen_PowerPC>(target, context);
+    } else if (target.arch == Target::WebAssembly) {
+        return make_codegen<CodeGen_WebAssembly>(target, context);
+    } else if (target.arch == Target::RISCV) {
+        return make_codegen<CodeGen_RISCV>(target, context);
     } else if (target.arch == Target::Hexagon) {
         return make_codegen<CodeGen_Hexagon>(target, context);
     }
@@ -455,6 +598,8 @@ bool CodeGen_LLVM::llvm_AArch64_enabled = false;
 bool CodeGen_LLVM::llvm_NVPTX_enabled = false;
 bool CodeGen_LLVM::llvm_Mips_enabled = false;
 bool CodeGen_LLVM::llvm_PowerPC_enabled = false;
+bool CodeGen_LLVM::llvm_WebAssembly_enabled = false;
+bool CodeGen_LLVM::llvm_RISCV_enabled = false;
 bool CodeGen_LLVM::llvm_AMDGPU_enabled = false;
 
 namespace {
@@ -564,7 +709,7 @@ std::unique_ptr<llvm::Module> CodeGen_LLVM::compile(const Module &input) {
         if (f.linkage == LinkageType::ExternalPlusMetadata) {
             llvm::Function *wrapper = add_argv_wrapper(names.argv_name);
             llvm::Function *metadata_getter = embed_metadata_getter(names.metadata_name,
-                names.simple_name, f.args, input.get_metadata_name_map());
+                names.simple_name, f.args, input.get_metadata_name_map(), input.cost_estimates());
 
             if (target.has_feature(Target::Matlab)) {
                 define_matlab_wrapper(module.get(), wrapper, metadata_getter);
@@ -937,7 +1082,8 @@ llvm::Function *CodeGen_LLVM::add_argv_wrapper(const std::string &name) {
 
 llvm::Function *CodeGen_LLVM::embed_metadata_getter(const std::string &metadata_name,
         const std::string &function_name, const std::vector<LoweredArgument> &args,
-        const std::map<std::string, std::string> &metadata_name_map) {
+        const std::map<std::string, std::string> &metadata_name_map,
+        const PipelineCostEstimates &cost_estimates) {
     Constant *zero = ConstantInt::get(i32_t, 0);
 
     const int num_args = (int) args.size();
@@ -989,11 +1135,16 @@ llvm::Function *CodeGen_LLVM::embed_metadata_getter(const std::string &metadata_
 
     Value *zeros[] = {zero, zero};
     Constant *metadata_fields[] = {
-        /* version */ zero,
+        /* version */ ConstantInt::get(i32_t, 1),
         /* num_arguments */ ConstantInt::get(i32_t, num_args),
         /* arguments */ ConstantExpr::getInBoundsGetElementPtr(arguments_array, arguments_array_storage, zeros),
         /* target */ create_string_constant(map_string(target.to_string())),
-        /* name */ create_string_constant(map_string(function_name))
+        /* name */ create_string_constant(map_string(function_name)),
+        /* estimated_peak_intermediate_bytes */ ConstantInt::get(i64_t, cost_estimates.peak_intermediate_bytes),
+        /* estimated_arithmetic_ops */ ConstantInt::get(i64_t, cost_estimates.arithmetic_ops),
+        /* estimated_bytes_loaded */ ConstantInt::get(i64_t, cost_estimates.bytes_loaded),
+        /* estimated_parallelism */ ConstantInt::get(i64_t, cost_estimates.parallelism),
+        /* uses_gpu */ ConstantInt::get(i32_t, cost_estimates.uses_gpu ? 1 : 0)
     };
 
     GlobalVariable *metadata_storage = new GlobalVariable(
@@ -1055,15 +1206,21 @@ void CodeGen_LLVM::optimize_module() {
     module_pass_manager.add(createTargetTransformInfoWrapperPass(TM ? TM->getTargetIRAnalysis() : TargetIRAnalysis()));
     function_pass_manager.add(createTargetTransformInfoWrapperPass(TM ? TM->getTargetIRAnalysis() : TargetIRAnalysis()));
 
+    // NoOptimize trades code quality for compile time, e.g. for a
+    // first-tier jit compile, but still runs the sanitizer passes.
+    const bool optimize = !get_target().has_feature(Target::NoOptimize);
+
     PassManagerBuilder b;
-    b.OptLevel = 3;
+    b.OptLevel = optimize ? 3 : 0;
+    if (optimize) {
 #if LLVM_VERSION >= 50
-    b.Inliner = createFunctionInliningPass(b.OptLevel, 0, false);
+        b.Inliner = createFunctionInliningPass(b.OptLevel, 0, false);
 #else
-    b.Inliner = createFunctionInliningPass(b.OptLevel, 0);
+        b.Inliner = createFunctionInliningPass(b.OptLevel, 0);
 #endif
-    b.LoopVectorize = true;
-    b.SLPVectorize = true;
+    }
+    b.LoopVectorize = optimize;
+    b.SLPVectorize = optimize;
 
 #if LLVM_VERSION >= 50
     if (TM) {
@@ -1804,12 +1961,22 @@ void CodeGen_LLVM::visit(const Load *op) {
             }
             value = vec;
         } else {
-            // General gathers
-            Value *index = codegen(op->index);
+            // General gathers. If the index has been narrowed to 32-bit
+            // offsets from a 64-bit base, only the base is 64-bit.
+            Expr base_index, offsets;
+            Value *base = nullptr, *index = nullptr;
+            if (is_narrowed_index(op->index, &base_index, &offsets)) {
+                base = codegen_buffer_pointer(op->name, op->type.element_of(), base_index);
+                index = codegen(offsets);
+            } else {
+                index = codegen(op->index);
+            }
             Value *vec = UndefValue::get(llvm_type_of(op->type));
             for (int i = 0; i < op->type.lanes(); i++) {
                 Value *idx = builder->CreateExtractElement(index, ConstantInt::get(i32_t, i));
-                Value *ptr = codegen_buffer_pointer(op->name, op->type.element_of(), idx);
+                Value *ptr = base ?
+                    codegen_buffer_pointer(base, op->type.element_of(), idx) :
+                    codegen_buffer_pointer(op->name, op->type.element_of(), idx);
                 LoadInst *val = builder->CreateLoad(ptr);
                 add_tbaa_metadata(val, op->name, op->index);
                 vec = builder->CreateInsertElement(vec, val, ConstantInt::get(i32_t, i));
@@ -2715,6 +2882,14 @@ void CodeGen_LLVM::visit(const Call *op) {
     } else if (op->is_intrinsic(Call::size_of_halide_buffer_t)) {
         llvm::DataLayout d(module.get());
         value = ConstantInt::get(i32_t, (int)d.getTypeAllocSize(buffer_t_type));
+    } else if (op->is_intrinsic(Call::nontemporal_store)) {
+        // Handled by the enclosing store.
+        internal_assert(op->args.size() == 1);
+        value = codegen(op->args[0]);
+    } else if (op->is_intrinsic(Call::atomic_update)) {
+        // The atomicity is handled by the enclosing store.
+        internal_assert(op->args.size() == 1);
+        value = codegen(op->args[0]);
     } else if (op->is_intrinsic(Call::strict_float)) {
         IRBuilder<llvm::ConstantFolder, llvm::IRBuilderDefaultInserter>::FastMathFlagGuard guard(*builder);
         llvm::FastMathFlags safe_flags;
@@ -2738,6 +2913,20 @@ void CodeGen_LLVM::visit(const Call *op) {
         internal_assert(op->args.size() == 1);
         Expr e = Internal::halide_exp(op->args[0]);
         e.accept(this);
+    } else if (op->call_type == Call::PureExtern && op->type.is_vector() &&
+               (op->name == "sin_f32" || op->name == "cos_f32" || op->name == "atan_f32")) {
+        // libm only has scalar versions of these, so vectors would
+        // be scalarized. Use the vectorizable polynomials instead.
+        internal_assert(op->args.size() == 1);
+        Expr e = (op->name == "sin_f32" ? Internal::halide_sin(op->args[0]) :
+                  op->name == "cos_f32" ? Internal::halide_cos(op->args[0]) :
+                  Internal::halide_atan(op->args[0]));
+        e.accept(this);
+    } else if (op->call_type == Call::PureExtern && op->type.is_vector() &&
+               op->name == "atan2_f32") {
+        internal_assert(op->args.size() == 2);
+        Expr e = Internal::halide_atan2(op->args[0], op->args[1]);
+        e.accept(this);
     } else if (op->call_type == Call::PureExtern &&
                (op->name == "is_nan_f32" || op->name == "is_nan_f64")) {
         internal_assert(op->args.size() == 1);
@@ -3030,7 +3219,23 @@ void CodeGen_LLVM::visit(const ProducerConsumer *op) {
     BasicBlock *produce = BasicBlock::Create(*context, name, function);
     builder->CreateBr(produce);
     builder->SetInsertPoint(produce);
-    codegen(op->body);
+    if (op->is_producer) {
+        // Make the non-temporal stores of a producer visible to its
+        // consumers.
+        bool old_emitted = emitted_nontemporal_store;
+        emitted_nontemporal_store = false;
+        codegen(op->body);
+        if (emitted_nontemporal_store) {
+            codegen_nontemporal_store_fence();
+        }
+        emitted_nontemporal_store = emitted_nontemporal_store || old_emitted;
+    } else {
+        codegen(op->body);
+    }
+}
+
+void CodeGen_LLVM::codegen_nontemporal_store_fence() {
+    builder->CreateFence(llvm::AtomicOrdering::SequentiallyConsistent);
 }
 
 void CodeGen_LLVM::visit(const For *op) {
@@ -3142,8 +3347,15 @@ void CodeGen_LLVM::visit(const For *op) {
         // Load everything from the closure into the new scope
         unpack_closure(closure, symbol_table, closure_t, closure_handle, builder);
 
-        // Generate the new function body
+        // Generate the new function body. Each task fences its own
+        // non-temporal stores before it reports that it is done.
+        bool old_emitted = emitted_nontemporal_store;
+        emitted_nontemporal_store = false;
         codegen(op->body);
+        if (emitted_nontemporal_store) {
+            codegen_nontemporal_store_fence();
+        }
+        emitted_nontemporal_store = emitted_nontemporal_store || old_emitted;
 
         // Return success
         return_with_error_code(ConstantInt::get(i32_t, 0));
@@ -3181,7 +3393,162 @@ void CodeGen_LLVM::visit(const For *op) {
     }
 }
 
+namespace {
+
+// Replace loads of the site being atomically updated with a variable
+// standing for its current value.
+class ReplaceAtomicLoad : public IRMutator2 {
+    using IRMutator2::visit;
+
+    const string &name;
+    const Expr &index;
+    const string &var;
+
+    Expr visit(const Load *op) override {
+        if (op->name == name && equal(op->index, index)) {
+            found = true;
+            return Variable::make(op->type, var);
+        }
+        return IRMutator2::visit(op);
+    }
+
+public:
+    bool found = false;
+    ReplaceAtomicLoad(const string &name, const Expr &index, const string &var)
+        : name(name), index(index), var(var) {}
+};
+
+}  // namespace
+
+namespace {
+
+// Remove the nontemporal_store marker from the value of a store, which
+// may be under some lets introduced by CSE.
+Expr strip_nontemporal_store(const Expr &e) {
+    if (const Let *let = e.as<Let>()) {
+        return Let::make(let->name, let->value, strip_nontemporal_store(let->body));
+    }
+    const Call *call = e.as<Call>();
+    internal_assert(call && call->is_intrinsic(Call::nontemporal_store) && call->args.size() == 1);
+    return call->args[0];
+}
+
+}  // namespace
+
+void CodeGen_LLVM::codegen_atomic_store(const Store *op) {
+    Halide::Type t = op->value.type();
+    user_assert(t.is_scalar() && is_one(op->predicate))
+        << "Can't vectorize the atomic update of " << op->name << "\n";
+    user_assert(t.bits() >= 8)
+        << "Can't make the update of the boolean Func " << op->name << " atomic\n";
+
+    // Inline any lets, so that we can find the load of the current
+    // value of the site being stored to.
+    Expr value = substitute_in_all_lets(op->value);
+    const Call *call = value.as<Call>();
+    internal_assert(call && call->is_intrinsic(Call::atomic_update) && call->args.size() == 1);
+    string old_name = unique_name(op->name + ".atomic_old");
+    ReplaceAtomicLoad replacer(op->name, substitute_in_all_lets(op->index), old_name);
+    Expr update = replacer.mutate(call->args[0]);
+
+    Value *ptr = codegen_buffer_pointer(op->name, t, op->index);
+
+    if (!replacer.found) {
+        // The update doesn't depend on the current value, so a
+        // plain store is already atomic.
+        StoreInst *store = builder->CreateAlignedStore(codegen(update), ptr, t.bytes());
+        add_tbaa_metadata(store, op->name, op->index);
+        return;
+    }
+
+    // Integer updates that are a single operator of the current
+    // value map directly to an atomicrmw instruction.
+    if (t.is_int() || t.is_uint()) {
+        Expr old_var = Variable::make(t, old_name);
+        Expr other;
+        llvm::AtomicRMWInst::BinOp rmw_op = llvm::AtomicRMWInst::BAD_BINOP;
+        auto match_commutative = [&](Expr a, Expr b, llvm::AtomicRMWInst::BinOp o) {
+            if (equal(a, old_var) && !expr_uses_var(b, old_name)) {
+                other = b;
+                rmw_op = o;
+            } else if (equal(b, old_var) && !expr_uses_var(a, old_name)) {
+                other = a;
+                rmw_op = o;
+            }
+        };
+        const Call *c = update.as<Call>();
+        if (const Add *add = update.as<Add>()) {
+            match_commutative(add->a, add->b, llvm::AtomicRMWInst::Add);
+        } else if (const Sub *sub = update.as<Sub>()) {
+            if (equal(sub->a, old_var) && !expr_uses_var(sub->b, old_name)) {
+                other = sub->b;
+                rmw_op = llvm::AtomicRMWInst::Sub;
+            }
+        } else if (const Min *min = update.as<Min>()) {
+            match_commutative(min->a, min->b, t.is_int() ? llvm::AtomicRMWInst::Min : llvm::AtomicRMWInst::UMin);
+        } else if (const Max *max = update.as<Max>()) {
+            match_commutative(max->a, max->b, t.is_int() ? llvm::AtomicRMWInst::Max : llvm::AtomicRMWInst::UMax);
+        } else if (c && c->is_intrinsic(Call::bitwise_and)) {
+            match_commutative(c->args[0], c->args[1], llvm::AtomicRMWInst::And);
+        } else if (c && c->is_intrinsic(Call::bitwise_or)) {
+            match_commutative(c->args[0], c->args[1], llvm::AtomicRMWInst::Or);
+        } else if (c && c->is_intrinsic(Call::bitwise_xor)) {
+            match_commutative(c->args[0], c->args[1], llvm::AtomicRMWInst::Xor);
+        }
+        if (other.defined()) {
+            builder->CreateAtomicRMW(rmw_op, ptr, codegen(other), llvm::AtomicOrdering::Monotonic);
+            return;
+        }
+    }
+
+    // Otherwise, use a compare-and-swap loop on the bits of the value.
+    llvm::Type *int_t = llvm::Type::getIntNTy(*context, t.bits());
+    Value *int_ptr = builder->CreatePointerCast(ptr, int_t->getPointerTo(ptr->getType()->getPointerAddressSpace()));
+    Value *orig = builder->CreateAlignedLoad(int_ptr, t.bytes());
+
+    BasicBlock *entry_bb = builder->GetInsertBlock();
+    BasicBlock *loop_bb = BasicBlock::Create(*context, op->name + "_atomic_loop", function);
+    BasicBlock *after_bb = BasicBlock::Create(*context, op->name + "_atomic_after", function);
+    builder->CreateBr(loop_bb);
+    builder->SetInsertPoint(loop_bb);
+
+    PHINode *old_bits = builder->CreatePHI(int_t, 2);
+    old_bits->addIncoming(orig, entry_bb);
+    sym_push(old_name, builder->CreateBitCast(old_bits, llvm_type_of(t)));
+    Value *new_bits = builder->CreateBitCast(codegen(update), int_t);
+    sym_pop(old_name);
+
+    Value *result = builder->CreateAtomicCmpXchg(int_ptr, old_bits, new_bits,
+                                                 llvm::AtomicOrdering::Monotonic,
+                                                 llvm::AtomicOrdering::Monotonic);
+    old_bits->addIncoming(builder->CreateExtractValue(result, {0}), builder->GetInsertBlock());
+    builder->CreateCondBr(builder->CreateExtractValue(result, {1}), after_bb, loop_bb);
+    builder->SetInsertPoint(after_bb);
+}
+
 void CodeGen_LLVM::visit(const Store *op) {
+    // Atomic updates are marked by an atomic_update call, possibly
+    // under some lets introduced by CSE.
+    Expr value = op->value;
+    while (const Let *let = value.as<Let>()) {
+        value = let->body;
+    }
+    if (const Call *call = value.as<Call>()) {
+        if (call->is_intrinsic(Call::atomic_update)) {
+            codegen_atomic_store(op);
+            return;
+        } else if (call->is_intrinsic(Call::nontemporal_store)) {
+            // Store the value with the marker stripped, remembering
+            // to make the store non-temporal.
+            ScopedValue<bool> old_in_nontemporal_store(in_nontemporal_store,
+                                                       use_nontemporal_stores());
+            Stmt s = Store::make(op->name, strip_nontemporal_store(op->value),
+                                 op->index, op->param, op->predicate);
+            codegen(s);
+            return;
+        }
+    }
+
     // Even on 32-bit systems, Handles are treated as 64-bit in
     // memory, so convert stores of handles to stores of uint64_ts.
     if (op->value.type().is_handle()) {
@@ -3248,6 +3615,11 @@ void CodeGen_LLVM::visit(const Store *op) {
                 Value *vec_ptr = builder->CreatePointerCast(elt_ptr, slice_val->getType()->getPointerTo());
                 StoreInst *store = builder->CreateAlignedStore(slice_val, vec_ptr, alignment);
                 add_tbaa_metadata(store, op->name, slice_index);
+                if (in_nontemporal_store && alignment >= slice_lanes * value_type.bytes()) {
+                    llvm::Metadata *one = ConstantAsMetadata::get(ConstantInt::get(i32_t, 1));
+                    store->setMetadata(LLVMContext::MD_nontemporal, MDNode::get(*context, {one}));
+                    emitted_nontemporal_store = true;
+                }
             }
         } else if (ramp) {
             Type ptr_type = value_type.element_of();
@@ -3276,12 +3648,21 @@ void CodeGen_LLVM::visit(const Store *op) {
             }
         } else {
             // Scatter
-            Value *index = codegen(op->index);
+            Expr base_index, offsets;
+            Value *base = nullptr, *index = nullptr;
+            if (is_narrowed_index(op->index, &base_index, &offsets)) {
+                base = codegen_buffer_pointer(op->name, value_type.element_of(), base_index);
+                index = codegen(offsets);
+            } else {
+                index = codegen(op->index);
+            }
             for (int i = 0; i < value_type.lanes(); i++) {
                 Value *lane = ConstantInt::get(i32_t, i);
                 Value *idx = builder->CreateExtractElement(index, lane);
                 Value *v = builder->CreateExtractElement(val, lane);
-                Value *ptr = codegen_buffer_pointer(op->name, value_type.element_of(), idx);
+                Value *ptr = base ?
+                    codegen_buffer_pointer(base, value_type.element_of(), idx) :
+                    codegen_buffer_pointer(op->name, value_type.element_of(), idx);
                 StoreInst *store = builder->CreateStore(v, ptr);
                 add_tbaa_metadata(store, op->name, op->index);
             }
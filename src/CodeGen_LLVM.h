@@ -107,6 +107,14 @@ protected:
     /** What's the natural vector bit-width to use for loads, stores, etc. */
     virtual int native_vector_bits() const = 0;
 
+    /** Should stores to Funcs scheduled with store_nontemporal be
+     * marked as non-temporal? */
+    virtual bool use_nontemporal_stores() const {return false;}
+
+    /** Emit a fence that orders all previous non-temporal stores
+     * before any later stores. */
+    virtual void codegen_nontemporal_store_fence();
+
     /** State needed by llvm for code generation, including the
      * current module, function, context, builder, and most recently
      * generated llvm value. */
@@ -119,6 +127,8 @@ protected:
     static bool llvm_NVPTX_enabled;
     static bool llvm_Mips_enabled;
     static bool llvm_PowerPC_enabled;
+    static bool llvm_WebAssembly_enabled;
+    static bool llvm_RISCV_enabled;
     static bool llvm_AMDGPU_enabled;
 
     const Module *input_module;
@@ -463,6 +473,11 @@ private:
     /** Turn off all unsafe math flags in scopes while this is set. */
     bool strict_float;
 
+    /** Set while generating a store that should be non-temporal, and
+     * whether any non-temporal store has been emitted since the
+     * start of the current producer or parallel task. */
+    bool in_nontemporal_store, emitted_nontemporal_store;
+
     /** Embed an instance of halide_filter_metadata_t in the code, using
      * the given name (by convention, this should be ${FUNCTIONNAME}_metadata)
      * as extern "C" linkage. Note that the return value is a function-returning-
@@ -470,7 +485,8 @@ private:
      */
     llvm::Function* embed_metadata_getter(const std::string &metadata_getter_name,
         const std::string &function_name, const std::vector<LoweredArgument> &args,
-        const std::map<std::string, std::string> &metadata_name_map);
+        const std::map<std::string, std::string> &metadata_name_map,
+        const PipelineCostEstimates &cost_estimates);
 
     /** Embed a constant expression as a global variable. */
     llvm::Constant *embed_constant_expr(Expr e);
@@ -481,6 +497,11 @@ private:
 
     virtual void codegen_predicated_vector_load(const Load *op);
     virtual void codegen_predicated_vector_store(const Store *op);
+
+    /** Generate code for a store of a value computed by an atomic
+     * update definition, using an atomic read-modify-write of the
+     * site stored to. */
+    void codegen_atomic_store(const Store *op);
 };
 
 }
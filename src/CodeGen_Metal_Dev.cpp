@@ -5,6 +5,7 @@
 #include "CodeGen_Internal.h"
 #include "Debug.h"
 #include "IROperator.h"
+#include "Util.h"
 
 namespace Halide {
 namespace Internal {
@@ -17,7 +18,7 @@ using std::sort;
 static ostringstream nil;
 
 CodeGen_Metal_Dev::CodeGen_Metal_Dev(Target t) :
-    metal_c(src_stream, t) {
+    metal_c(src_stream, t), target(t) {
 }
 
 string CodeGen_Metal_Dev::CodeGen_Metal_C::print_type_maybe_storage(Type type, bool storage, AppendSpaceIfNeeded space) {
@@ -634,10 +635,60 @@ void CodeGen_Metal_Dev::init_module() {
     cur_kernel_name = "";
 }
 
+namespace {
+
+// Build a Metal library from Metal source with the Xcode tools. Returns
+// an empty vector if they fail.
+vector<char> compile_to_metallib(const vector<char> &src, const Target &target) {
+    string sdk = target.os == Target::IOS ? "iphoneos" : "macosx";
+
+    TemporaryFile metal("halide_kernels", ".metal");
+    TemporaryFile air("halide_kernels", ".air");
+    TemporaryFile metallib("halide_kernels", ".metallib");
+    write_entire_file(metal.pathname(), src);
+
+    // The runtime turns fast math off when it compiles the source, so
+    // do the same here.
+    string cmd = "xcrun -sdk " + sdk + " metal -fno-fast-math -c " + metal.pathname() + " -o " + air.pathname();
+    debug(1) << "Compiling Metal source: " << cmd << "\n";
+    if (system(cmd.c_str()) == 0) {
+        cmd = "xcrun -sdk " + sdk + " metallib " + air.pathname() + " -o " + metallib.pathname();
+        debug(1) << "Making Metal library: " << cmd << "\n";
+        if (system(cmd.c_str()) == 0) {
+            return read_entire_file(metallib.pathname());
+        }
+    }
+    user_warning << "Could not build a Metal library, so only the Metal source will be embedded. "
+                 << "Are the Xcode command line tools installed?\n";
+    return vector<char>();
+}
+
+}  // namespace
+
 vector<char> CodeGen_Metal_Dev::compile_to_src() {
     string str = src_stream.str();
     debug(1) << "Metal kernel:\n" << str << "\n";
     vector<char> buffer(str.begin(), str.end());
+
+    // With the MetalLibrary feature, pipelines embed a prebuilt Metal
+    // library ahead of the source, so that the kernels don't have to be
+    // compiled at startup. The source is kept in case the library can't
+    // be loaded on the device. The runtime recognizes the pair by the
+    // "HLML" tag and 32-bit little-endian library size in front of it.
+    if (target.has_feature(Target::MetalLibrary)) {
+        vector<char> library = compile_to_metallib(buffer, target);
+        if (!library.empty()) {
+            vector<char> blob = {'H', 'L', 'M', 'L'};
+            uint32_t size = (uint32_t)library.size();
+            for (int i = 0; i < 4; i++) {
+                blob.push_back((char)((size >> (i * 8)) & 0xff));
+            }
+            blob.insert(blob.end(), library.begin(), library.end());
+            blob.insert(blob.end(), buffer.begin(), buffer.end());
+            buffer.swap(blob);
+        }
+    }
+
     buffer.push_back(0);
     return buffer;
 }
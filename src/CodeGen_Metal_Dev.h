@@ -84,6 +84,7 @@ protected:
     std::ostringstream src_stream;
     std::string cur_kernel_name;
     CodeGen_Metal_C metal_c;
+    Target target;
 };
 
 }}
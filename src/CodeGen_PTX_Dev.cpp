@@ -10,10 +10,12 @@
 #include "Simplify.h"
 #include "Solve.h"
 #include "Target.h"
+#include "Util.h"
 #include "LLVM_Headers.h"
 #include "LLVM_Runtime_Linker.h"
 
 #include <fstream>
+#include <memory>
 
 // This is declared in NVPTX.h, which is not exported. Ugly, but seems better than
 // hardcoding a path to the .h file.
@@ -280,7 +282,24 @@ string CodeGen_PTX_Dev::march() const {
 }
 
 string CodeGen_PTX_Dev::mcpu() const {
-    if (target.has_feature(Target::CUDACapability61)) {
+    // Volta and Turing only change the sm and ptx versions used. There
+    // is no lowering to their tensor core (wmma or mma.sync)
+    // instructions, whose operands are fragments shared by a whole warp,
+    // which Halide's per-thread GPU loops can't express.
+#if LLVM_VERSION >= 80
+    if (target.has_feature(Target::CUDACapability75)) {
+        return "sm_75";
+    }
+#endif
+#if LLVM_VERSION >= 60
+    if (target.features_any_of({Target::CUDACapability70,
+                                Target::CUDACapability75})) {
+        return "sm_70";
+    }
+#endif
+    if (target.features_any_of({Target::CUDACapability61,
+                                Target::CUDACapability70,
+                                Target::CUDACapability75})) {
         return "sm_61";
     } else if (target.has_feature(Target::CUDACapability50)) {
         return "sm_50";
@@ -296,7 +315,24 @@ string CodeGen_PTX_Dev::mcpu() const {
 }
 
 string CodeGen_PTX_Dev::mattrs() const {
-    if (target.has_feature(Target::CUDACapability61)) {
+#if LLVM_VERSION >= 80
+    if (target.has_feature(Target::CUDACapability75)) {
+        // sm_75 needs ptx isa 6.3.
+        return "+ptx63";
+    }
+#endif
+#if LLVM_VERSION >= 60
+    if (target.features_any_of({Target::CUDACapability70,
+                                Target::CUDACapability75})) {
+        // sm_70 needs ptx isa 6.0. This is the last version in which
+        // the non-sync warp shuffles used by LowerWarpShuffles are
+        // still accepted for sm_70.
+        return "+ptx60";
+    }
+#endif
+    if (target.features_any_of({Target::CUDACapability61,
+                                Target::CUDACapability70,
+                                Target::CUDACapability75})) {
         return "+ptx50";
     } else if (target.features_any_of({Target::CUDACapability32,
                                 Target::CUDACapability50})) {
@@ -313,6 +349,54 @@ bool CodeGen_PTX_Dev::use_soft_float_abi() const {
     return false;
 }
 
+#ifdef WITH_PTX
+namespace {
+
+// Compile PTX source to SASS with ptxas for each of the given GPU
+// architectures, and bundle the results and the PTX itself into a
+// fatbin, which cuModuleLoadData accepts in place of PTX. Returns an
+// empty vector if the CUDA tools fail.
+vector<char> compile_ptx_to_fatbin(const vector<char> &ptx_src, const string &ptx_arch,
+                                   const vector<string> &sass_archs, bool is_64_bit) {
+    TemporaryFile ptx("halide_kernels", ".ptx");
+    write_entire_file(ptx.pathname(), ptx_src);
+
+    vector<std::unique_ptr<TemporaryFile>> cubins;
+    string images;
+    for (const string &arch : sass_archs) {
+        if (arch.empty()) {
+            continue;
+        }
+        cubins.emplace_back(new TemporaryFile("halide_kernels_" + arch, ".cubin"));
+        // The runtime limits the registers of a kernel compiled from
+        // PTX to 64 unless told otherwise, so do the same here.
+        string cmd = "ptxas --gpu-name " + arch + (is_64_bit ? " -m64" : " -m32") +
+            " --maxrregcount 64 " + ptx.pathname() + " -o " + cubins.back()->pathname();
+        debug(1) << "Compiling PTX to SASS: " << cmd << "\n";
+        if (system(cmd.c_str()) != 0) {
+            user_warning << "Could not compile PTX to SASS for " << arch
+                         << ", so only the PTX will be embedded. Is ptxas in the path?\n";
+            return vector<char>();
+        }
+        images += " --image=profile=" + arch + ",file=" + cubins.back()->pathname();
+    }
+    // Keep the PTX, for GPUs that none of the SASS runs on.
+    images += " --image=profile=compute_" + ptx_arch.substr(3) + ",file=" + ptx.pathname();
+
+    TemporaryFile fatbin("halide_kernels", ".fatbin");
+    string cmd = "fatbinary --create=" + fatbin.pathname() + (is_64_bit ? " -64" : " -32") + images;
+    debug(1) << "Making fatbin: " << cmd << "\n";
+    if (system(cmd.c_str()) != 0) {
+        user_warning << "Could not make a fatbin of the SASS, so only the PTX will be embedded. "
+                     << "Is fatbinary in the path?\n";
+        return vector<char>();
+    }
+    return read_entire_file(fatbin.pathname());
+}
+
+}  // namespace
+#endif
+
 vector<char> CodeGen_PTX_Dev::compile_to_src() {
 
     #ifdef WITH_PTX
@@ -329,8 +413,8 @@ vector<char> CodeGen_PTX_Dev::compile_to_src() {
     // Allocate target machine
 
     std::string err_str;
-    const llvm::Target *target = TargetRegistry::lookupTarget(triple.str(), err_str);
-    internal_assert(target) << err_str << "\n";
+    const llvm::Target *llvm_target = TargetRegistry::lookupTarget(triple.str(), err_str);
+    internal_assert(llvm_target) << err_str << "\n";
 
     TargetOptions options;
     #if LLVM_VERSION < 50
@@ -347,15 +431,15 @@ vector<char> CodeGen_PTX_Dev::compile_to_src() {
     options.StackAlignmentOverride = 0;
 
     std::unique_ptr<TargetMachine>
-        target_machine(target->createTargetMachine(triple.str(),
-                                                   mcpu(), mattrs(), options,
-                                                   llvm::Reloc::PIC_,
+        target_machine(llvm_target->createTargetMachine(triple.str(),
+                                                        mcpu(), mattrs(), options,
+                                                        llvm::Reloc::PIC_,
 #if LLVM_VERSION < 60
-                                                   llvm::CodeModel::Default,
+                                                        llvm::CodeModel::Default,
 #else
-                                                   llvm::CodeModel::Small,
+                                                        llvm::CodeModel::Small,
 #endif
-                                                   CodeGenOpt::Aggressive));
+                                                        CodeGenOpt::Aggressive));
 
     internal_assert(target_machine.get()) << "Could not allocate target machine!";
 
@@ -488,6 +572,18 @@ vector<char> CodeGen_PTX_Dev::compile_to_src() {
         */
     }
 
+    // Compiling the PTX at startup can take a while, so pipelines
+    // compiled with the CUDASass feature embed SASS for the
+    // architecture the PTX targets as well. This is mostly for AOT
+    // compilation; when jitting, the PTX would be compiled in this
+    // process anyway.
+    if (target.has_feature(Target::CUDASass)) {
+        vector<char> fatbin = compile_ptx_to_fatbin(buffer, mcpu(), {mcpu()}, target.bits == 64);
+        if (!fatbin.empty()) {
+            return fatbin;
+        }
+    }
+
     // Null-terminate the ptx source
     buffer.push_back(0);
     return buffer;
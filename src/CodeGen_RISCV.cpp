@@ -0,0 +1,134 @@
+#include <mutex>
+
+#include "CodeGen_RISCV.h"
+#include "ConciseCasts.h"
+#include "IROperator.h"
+#include "IRMatch.h"
+#include "Util.h"
+#include "LLVM_Headers.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::vector;
+using std::string;
+
+using namespace Halide::ConciseCasts;
+using namespace llvm;
+
+CodeGen_RISCV::CodeGen_RISCV(Target t) : CodeGen_Posix(t) {
+    #if !(WITH_RISCV)
+    user_error << "llvm build not configured with RISC-V target enabled.\n";
+    #endif
+    user_assert(llvm_RISCV_enabled) << "llvm build not configured with RISC-V target enabled.\n";
+}
+
+std::unique_ptr<llvm::Module> CodeGen_RISCV::compile(const Module &module) {
+    auto llvm_module = CodeGen_Posix::compile(module);
+
+    #if LLVM_VERSION >= 140
+    // Halide vectors have a fixed number of lanes, which LLVM only
+    // lowers to RVV if it knows how many fit in a vector
+    // register. Tell it the minimum VLEN the V extension guarantees;
+    // the vsetvli it emits for each operation keeps the code correct
+    // on cores with longer vectors. As for Hexagon, this has to be a
+    // command-line option.
+    if (target.has_feature(Target::RISCV_V)) {
+        static std::once_flag set_options_once;
+        std::call_once(set_options_once, []() {
+            std::vector<const char *> options = {
+                "halide-riscv-be",
+                "-riscv-v-vector-bits-min=128"
+            };
+            cl::ParseCommandLineOptions(options.size(), options.data());
+        });
+    }
+    #endif
+
+    return llvm_module;
+}
+
+void CodeGen_RISCV::visit(const Cast *op) {
+    if (!op->type.is_vector() || !target.has_feature(Target::RISCV_V)) {
+        // We only have peephole optimizations for RVV in here.
+        CodeGen_Posix::visit(op);
+        return;
+    }
+
+    #if LLVM_VERSION >= 140
+    vector<Expr> matches;
+
+    struct Pattern {
+        Type type;
+        string intrin;
+        Expr pattern;
+    };
+
+    // RVV has saturating add and subtract of every integer width
+    // (vsadd, vsaddu, vssub, vssubu). LLVM lowers its generic
+    // saturating intrinsics to them.
+    static Pattern patterns[] = {
+        {Int(8, 16), "llvm.sadd.sat.v16i8", i8_sat(wild_i16x_ + wild_i16x_)},
+        {Int(8, 16), "llvm.ssub.sat.v16i8", i8_sat(wild_i16x_ - wild_i16x_)},
+        {UInt(8, 16), "llvm.uadd.sat.v16i8", u8_sat(wild_u16x_ + wild_u16x_)},
+        {UInt(8, 16), "llvm.usub.sat.v16i8", u8(max(wild_i16x_ - wild_i16x_, 0))},
+        {Int(16, 8), "llvm.sadd.sat.v8i16", i16_sat(wild_i32x_ + wild_i32x_)},
+        {Int(16, 8), "llvm.ssub.sat.v8i16", i16_sat(wild_i32x_ - wild_i32x_)},
+        {UInt(16, 8), "llvm.uadd.sat.v8i16", u16_sat(wild_u32x_ + wild_u32x_)},
+        {UInt(16, 8), "llvm.usub.sat.v8i16", u16(max(wild_i32x_ - wild_i32x_, 0))},
+        {Int(32, 4), "llvm.sadd.sat.v4i32", i32_sat(wild_i64x_ + wild_i64x_)},
+        {Int(32, 4), "llvm.ssub.sat.v4i32", i32_sat(wild_i64x_ - wild_i64x_)},
+        {UInt(32, 4), "llvm.uadd.sat.v4i32", u32_sat(wild_u64x_ + wild_u64x_)},
+        {UInt(32, 4), "llvm.usub.sat.v4i32", u32(max(wild_i64x_ - wild_i64x_, 0))},
+    };
+
+    for (size_t i = 0; i < sizeof(patterns)/sizeof(patterns[0]); i++) {
+        const Pattern &pattern = patterns[i];
+
+        if (expr_match(pattern.pattern, op, matches)) {
+            bool match = true;
+            // Try to narrow the matches to the target type.
+            for (size_t i = 0; i < matches.size(); i++) {
+                matches[i] = lossless_cast(op->type, matches[i]);
+                if (!matches[i].defined()) match = false;
+            }
+            if (match) {
+                value = call_intrin(op->type, pattern.type.lanes(), pattern.intrin, matches);
+                return;
+            }
+        }
+    }
+    #endif
+
+    CodeGen_Posix::visit(op);
+}
+
+string CodeGen_RISCV::mcpu() const {
+    return "";
+}
+
+string CodeGen_RISCV::mattrs() const {
+    // The G and C extensions of the Linux ABIs.
+    string features = "+m,+a,+f,+d,+c";
+    #if LLVM_VERSION >= 140
+    // Older LLVMs only know drafts of the V extension, whose
+    // encodings differ from RVV 1.0, so vectors are scalarized there,
+    // even with riscv_v in the target.
+    if (target.has_feature(Target::RISCV_V)) {
+        features += ",+v";
+    }
+    #endif
+    return features;
+}
+
+bool CodeGen_RISCV::use_soft_float_abi() const {
+    return false;
+}
+
+int CodeGen_RISCV::native_vector_bits() const {
+    // The minimum VLEN of the V extension. Without it, vectors of this
+    // width are scalarized.
+    return 128;
+}
+
+}}
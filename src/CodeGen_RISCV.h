@@ -0,0 +1,39 @@
+#ifndef HALIDE_CODEGEN_RISCV_H
+#define HALIDE_CODEGEN_RISCV_H
+
+/** \file
+ * Defines the code-generator for producing RISC-V machine code.
+ */
+
+#include "CodeGen_Posix.h"
+
+namespace Halide {
+namespace Internal {
+
+/** A code generator that emits RISC-V code from a given Halide
+ * stmt. Vectors are lowered to the V extension (RVV 1.0). */
+class CodeGen_RISCV : public CodeGen_Posix {
+public:
+    /** Create a RISC-V code generator for RV32GCV or RV64GCV. */
+    CodeGen_RISCV(Target);
+
+    std::unique_ptr<llvm::Module> compile(const Module &module);
+
+protected:
+
+    using CodeGen_Posix::visit;
+
+    std::string mcpu() const;
+    std::string mattrs() const;
+    bool use_soft_float_abi() const;
+    int native_vector_bits() const;
+
+    /** Nodes for which we want to emit specific RVV instructions */
+    // @{
+    void visit(const Cast *);
+    // @}
+};
+
+}}
+
+#endif
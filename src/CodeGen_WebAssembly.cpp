@@ -0,0 +1,96 @@
+#include "CodeGen_WebAssembly.h"
+#include "ConciseCasts.h"
+#include "IROperator.h"
+#include "IRMatch.h"
+#include "Util.h"
+#include "LLVM_Headers.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::vector;
+using std::string;
+
+using namespace Halide::ConciseCasts;
+using namespace llvm;
+
+CodeGen_WebAssembly::CodeGen_WebAssembly(Target t) : CodeGen_Posix(t) {
+    #if !(WITH_WEBASSEMBLY)
+    user_error << "llvm build not configured with WebAssembly target enabled.\n";
+    #endif
+    user_assert(llvm_WebAssembly_enabled) << "llvm build not configured with WebAssembly target enabled.\n";
+    user_assert(target.bits == 32) << "WebAssembly target must be 32-bit.\n";
+}
+
+void CodeGen_WebAssembly::visit(const Cast *op) {
+    if (!op->type.is_vector()) {
+        // We only have peephole optimizations for vectors in here.
+        CodeGen_Posix::visit(op);
+        return;
+    }
+
+    #if LLVM_VERSION >= 80
+    vector<Expr> matches;
+
+    struct Pattern {
+        Type type;
+        string intrin;
+        Expr pattern;
+    };
+
+    // simd128 has saturating add and subtract of 8 and 16-bit
+    // lanes. LLVM lowers its generic saturating intrinsics to them.
+    static Pattern patterns[] = {
+        {Int(8, 16), "llvm.sadd.sat.v16i8", i8_sat(wild_i16x_ + wild_i16x_)},
+        {Int(8, 16), "llvm.ssub.sat.v16i8", i8_sat(wild_i16x_ - wild_i16x_)},
+        {UInt(8, 16), "llvm.uadd.sat.v16i8", u8_sat(wild_u16x_ + wild_u16x_)},
+        {UInt(8, 16), "llvm.usub.sat.v16i8", u8(max(wild_i16x_ - wild_i16x_, 0))},
+        {Int(16, 8), "llvm.sadd.sat.v8i16", i16_sat(wild_i32x_ + wild_i32x_)},
+        {Int(16, 8), "llvm.ssub.sat.v8i16", i16_sat(wild_i32x_ - wild_i32x_)},
+        {UInt(16, 8), "llvm.uadd.sat.v8i16", u16_sat(wild_u32x_ + wild_u32x_)},
+        {UInt(16, 8), "llvm.usub.sat.v8i16", u16(max(wild_i32x_ - wild_i32x_, 0))},
+    };
+
+    for (size_t i = 0; i < sizeof(patterns)/sizeof(patterns[0]); i++) {
+        const Pattern &pattern = patterns[i];
+
+        if (expr_match(pattern.pattern, op, matches)) {
+            bool match = true;
+            // Try to narrow the matches to the target type.
+            for (size_t i = 0; i < matches.size(); i++) {
+                matches[i] = lossless_cast(op->type, matches[i]);
+                if (!matches[i].defined()) match = false;
+            }
+            if (match) {
+                value = call_intrin(op->type, pattern.type.lanes(), pattern.intrin, matches);
+                return;
+            }
+        }
+    }
+    #endif
+
+    CodeGen_Posix::visit(op);
+}
+
+string CodeGen_WebAssembly::mcpu() const {
+    return "";
+}
+
+string CodeGen_WebAssembly::mattrs() const {
+    std::string features = "+simd128,+sign-ext,+nontrapping-fptoint";
+    if (target.has_feature(Target::WasmThreads)) {
+        // Threads need shared memory, which needs both of these.
+        features += ",+atomics,+bulk-memory";
+    }
+    return features;
+}
+
+bool CodeGen_WebAssembly::use_soft_float_abi() const {
+    return false;
+}
+
+int CodeGen_WebAssembly::native_vector_bits() const {
+    return 128;
+}
+
+}}
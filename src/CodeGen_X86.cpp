@@ -5,12 +5,14 @@
 #include "JITModule.h"
 #include "IROperator.h"
 #include "IRMatch.h"
+#include "NarrowIndices.h"
 #include "Debug.h"
 #include "Util.h"
 #include "Var.h"
 #include "Param.h"
 #include "LLVM_Headers.h"
 #include "IRMutator.h"
+#include "Simplify.h"
 
 namespace Halide {
 namespace Internal {
@@ -60,12 +62,116 @@ bool should_use_pmaddwd(Expr a, Expr b, vector<Expr> &result) {
     return true;
 }
 
+// Flatten a tree of adds into its list of terms.
+void collect_add_terms(Expr e, vector<Expr> &terms) {
+    if (const Add *add = e.as<Add>()) {
+        collect_add_terms(add->a, terms);
+        collect_add_terms(add->b, terms);
+    } else {
+        terms.push_back(e);
+    }
+}
+
+}
+
+bool CodeGen_X86::try_vnni(const Add *op) {
+#if LLVM_VERSION >= 80
+    // An i32 accumulator plus a sum of products of narrow values is
+    // a VNNI dot product, if we interleave the operands of groups
+    // of products. vpdpbusd sums four products of u8 with i8, and
+    // vpdpwssd sums two products of i16 with i16.
+    Type t = op->type;
+    if (!target.has_feature(Target::AVX512_VNNI) ||
+        !t.is_int() || t.bits() != 32 || t.lanes() < 4) {
+        return false;
+    }
+
+    vector<Expr> terms;
+    collect_add_terms(op, terms);
+
+    Type u8_t = t.with_bits(8).with_code(Type::UInt);
+    Type i8_t = t.with_bits(8);
+    Type i16_t = t.with_bits(16);
+    vector<Expr> acc_terms, byte_a, byte_b, word_a, word_b;
+    for (const Expr &e : terms) {
+        const Mul *mul = e.as<Mul>();
+        if (!mul) {
+            acc_terms.push_back(e);
+            continue;
+        }
+        Expr ua = lossless_cast(u8_t, mul->a), ib = lossless_cast(i8_t, mul->b);
+        if (!ua.defined() || !ib.defined()) {
+            ua = lossless_cast(u8_t, mul->b);
+            ib = lossless_cast(i8_t, mul->a);
+        }
+        Expr wa = lossless_cast(i16_t, mul->a), wb = lossless_cast(i16_t, mul->b);
+        if (ua.defined() && ib.defined()) {
+            byte_a.push_back(ua);
+            byte_b.push_back(ib);
+        } else if (wa.defined() && wb.defined()) {
+            word_a.push_back(wa);
+            word_b.push_back(wb);
+        } else {
+            acc_terms.push_back(e);
+        }
+    }
+
+    // Leftover byte products that don't fill a group of four can
+    // still go in a pair of word products.
+    while (byte_a.size() % 4) {
+        word_a.push_back(cast(i16_t, byte_a.back()));
+        word_b.push_back(cast(i16_t, byte_b.back()));
+        byte_a.pop_back();
+        byte_b.pop_back();
+    }
+    if (word_a.size() % 2) {
+        acc_terms.push_back(cast(t, word_a.back()) * cast(t, word_b.back()));
+        word_a.pop_back();
+        word_b.pop_back();
+    }
+    if (byte_a.empty() && word_a.empty()) {
+        return false;
+    }
+
+    Expr acc_expr;
+    for (const Expr &e : acc_terms) {
+        acc_expr = acc_expr.defined() ? acc_expr + e : e;
+    }
+    if (!acc_expr.defined()) {
+        acc_expr = make_zero(t);
+    }
+
+    int intrin_lanes = t.lanes() >= 16 ? 16 : (t.lanes() >= 8 ? 8 : 4);
+    string suffix = "." + std::to_string(intrin_lanes * 32);
+    Value *acc = codegen(acc_expr);
+    auto dot = [&](const string &name, const vector<Expr> &a, const vector<Expr> &b) {
+        Value *va = codegen(reinterpret(t, Shuffle::make_interleave(a)));
+        Value *vb = codegen(reinterpret(t, Shuffle::make_interleave(b)));
+        acc = call_intrin(acc->getType(), intrin_lanes, name + suffix, {acc, va, vb});
+    };
+    for (size_t i = 0; i < byte_a.size(); i += 4) {
+        dot("llvm.x86.avx512.vpdpbusd",
+            {byte_a.begin() + i, byte_a.begin() + i + 4},
+            {byte_b.begin() + i, byte_b.begin() + i + 4});
+    }
+    for (size_t i = 0; i < word_a.size(); i += 2) {
+        dot("llvm.x86.avx512.vpdpwssd",
+            {word_a.begin() + i, word_a.begin() + i + 2},
+            {word_b.begin() + i, word_b.begin() + i + 2});
+    }
+    value = acc;
+    return true;
+#else
+    return false;
+#endif
 }
 
 
 void CodeGen_X86::visit(const Add *op) {
     vector<Expr> matches;
-    if (should_use_pmaddwd(op->a, op->b, matches)) {
+    if (try_vnni(op)) {
+        return;
+    } else if (should_use_pmaddwd(op->a, op->b, matches)) {
         codegen(Call::make(op->type, "pmaddwd", matches, Call::Extern));
     } else {
         CodeGen_Posix::visit(op);
@@ -155,20 +261,82 @@ void CodeGen_X86::visit(const EQ *op) {
     }
 }
 
+Value *CodeGen_X86::codegen_mask_compare(const Expr &cmp) {
+    // AVX-512 compares write k registers, and there is a single
+    // instruction for every predicate, so there's no need to negate
+    // another comparison. The float predicates are the unordered ones,
+    // to match the negated ordered comparisons used otherwise.
+    Expr a, b;
+    CmpInst::Predicate int_pred, uint_pred, float_pred;
+    if (const LE *le = cmp.as<LE>()) {
+        a = le->a;
+        b = le->b;
+        int_pred = CmpInst::ICMP_SLE;
+        uint_pred = CmpInst::ICMP_ULE;
+        float_pred = CmpInst::FCMP_ULE;
+    } else if (const GE *ge = cmp.as<GE>()) {
+        a = ge->a;
+        b = ge->b;
+        int_pred = CmpInst::ICMP_SGE;
+        uint_pred = CmpInst::ICMP_UGE;
+        float_pred = CmpInst::FCMP_UGE;
+    } else {
+        const NE *ne = cmp.as<NE>();
+        internal_assert(ne) << "codegen_mask_compare of unhandled comparison: " << cmp << "\n";
+        a = ne->a;
+        b = ne->b;
+        int_pred = uint_pred = CmpInst::ICMP_NE;
+        float_pred = CmpInst::FCMP_UNE;
+    }
+
+    // Slice at the native width, as for GT and EQ.
+    Type t = a.type();
+    int slice_size = target.natural_vector_size(t);
+
+    Value *va = codegen(a), *vb = codegen(b);
+    vector<Value *> result;
+    for (int i = 0; i < t.lanes(); i += slice_size) {
+        Value *sa = slice_vector(va, i, slice_size);
+        Value *sb = slice_vector(vb, i, slice_size);
+        if (t.is_float()) {
+            result.push_back(builder->CreateFCmp(float_pred, sa, sb));
+        } else if (t.is_int()) {
+            result.push_back(builder->CreateICmp(int_pred, sa, sb));
+        } else {
+            result.push_back(builder->CreateICmp(uint_pred, sa, sb));
+        }
+    }
+
+    Value *v = concat_vectors(result);
+    return slice_vector(v, 0, t.lanes());
+}
+
 void CodeGen_X86::visit(const LT *op) {
     codegen(op->b > op->a);
 }
 
 void CodeGen_X86::visit(const LE *op) {
-    codegen(!(op->a > op->b));
+    if (op->type.is_vector() && use_mask_registers()) {
+        value = codegen_mask_compare(op);
+    } else {
+        codegen(!(op->a > op->b));
+    }
 }
 
 void CodeGen_X86::visit(const GE *op) {
-    codegen(!(op->b > op->a));
+    if (op->type.is_vector() && use_mask_registers()) {
+        value = codegen_mask_compare(op);
+    } else {
+        codegen(!(op->b > op->a));
+    }
 }
 
 void CodeGen_X86::visit(const NE *op) {
-    codegen(!(op->a == op->b));
+    if (op->type.is_vector() && use_mask_registers()) {
+        value = codegen_mask_compare(op);
+    } else {
+        codegen(!(op->a == op->b));
+    }
 }
 
 void CodeGen_X86::visit(const Select *op) {
@@ -199,6 +367,243 @@ void CodeGen_X86::visit(const Select *op) {
     }
 }
 
+bool CodeGen_X86::use_masked_gather_scatter(Type t, const Expr &index, const Expr &predicate) const {
+    // Predicated vector accesses at indices that aren't dense are
+    // otherwise scalarized, with a branch per lane. With AVX-512 they
+    // can be a gather or scatter under a k register mask instead.
+    if (is_one(predicate) || t.is_scalar() || t.is_handle() ||
+        (t.bits() != 32 && t.bits() != 64) || !use_mask_registers()) {
+        return false;
+    }
+    const Ramp *ramp = index.as<Ramp>();
+    return !(ramp && is_one(ramp->stride));
+}
+
+Value *CodeGen_X86::codegen_element_pointers(const string &name, Type t, const Expr &index) {
+    Value *base = codegen_buffer_pointer(name, t.element_of(), make_zero(Int(32)));
+    return builder->CreateInBoundsGEP(base, codegen(index));
+}
+
+Value *CodeGen_X86::padded_mask(const Expr &predicate, int slice_size) {
+    // Lanes past the end of a partial last slice must be masked off,
+    // not undefined.
+    Value *mask = codegen(predicate);
+    int lanes = predicate.type().lanes();
+    if (lanes % slice_size != 0) {
+        mask = concat_vectors({mask, Constant::getNullValue(VectorType::get(i1_t, slice_size))});
+    }
+    return mask;
+}
+
+void CodeGen_X86::visit(const Load *op) {
+    if (use_masked_gather_scatter(op->type, op->index, op->predicate)) {
+        const int lanes = op->type.lanes();
+        const int slice_size = std::min(lanes, target.natural_vector_size(op->type));
+        Value *ptrs = codegen_element_pointers(op->name, op->type, op->index);
+        Value *mask = padded_mask(op->predicate, slice_size);
+        llvm::Type *slice_t = llvm_type_of(op->type.with_lanes(slice_size));
+        Value *zero = Constant::getNullValue(slice_t);
+
+        vector<Value *> result;
+        for (int i = 0; i < lanes; i += slice_size) {
+            Instruction *gather =
+                builder->CreateMaskedGather(slice_vector(ptrs, i, slice_size), op->type.bytes(),
+                                            slice_vector(mask, i, slice_size), zero);
+            add_tbaa_metadata(gather, op->name, op->index);
+            result.push_back(gather);
+        }
+        value = concat_vectors(result);
+        value = slice_vector(value, 0, lanes);
+        return;
+    }
+
+    // We only deal with unpredicated loads with a stride of three or
+    // four, or at data-dependent indices, here. The rest are handled
+    // by the vanilla codegen.
+    if (op->type.is_scalar() || op->type.is_handle() || !is_one(op->predicate)) {
+        CodeGen_Posix::visit(op);
+        return;
+    }
+
+    const int lanes = op->type.lanes();
+    const Ramp *ramp = op->index.as<Ramp>();
+    const IntImm *stride = ramp ? ramp->stride.as<IntImm>() : nullptr;
+
+    if (ramp && stride && (stride->value == 3 || stride->value == 4)) {
+        // Load each slice of the interleaved data as one dense vector,
+        // and take every stride'th element of it. LLVM lowers this
+        // form to the best shuffle sequence for the target. If the base
+        // is known to be at an offset within a group of stride
+        // elements, start the load at the beginning of the group, so
+        // that loads of the other fields in the group (e.g. the other
+        // channels of packed RGB) become the same load.
+        Expr base = ramp->base;
+        int offset = 0;
+        bool known_offset = true;
+        ModulusRemainder mod_rem = modulus_remainder(ramp->base);
+        const Add *add = base.as<Add>();
+        const IntImm *add_b = add ? add->b.as<IntImm>() : nullptr;
+        if ((mod_rem.modulus % stride->value) == 0) {
+            offset = mod_rem.remainder % stride->value;
+        } else if ((mod_rem.modulus == 1) && add_b) {
+            offset = add_b->value % stride->value;
+            if (offset < 0) {
+                offset += stride->value;
+            }
+        } else {
+            known_offset = false;
+        }
+        if (offset) {
+            base = simplify(base - offset);
+        }
+
+        // If we don't know where the group starts, the load may read
+        // past the end of the last group, which is only safe for
+        // internal buffers. (In ASAN mode, not even then.)
+        bool external = op->param.defined() || op->image.defined();
+        bool safe = known_offset || !(external || target.has_feature(Target::ASAN));
+
+        const int slice_lanes = std::min(lanes, native_vector_bits() / op->type.bits());
+        if (safe && lanes % slice_lanes == 0) {
+            llvm::Type *load_type = llvm_type_of(op->type.with_lanes(slice_lanes * stride->value));
+            vector<int> indices(slice_lanes);
+            for (int j = 0; j < slice_lanes; j++) {
+                indices[j] = j * stride->value + offset;
+            }
+
+            vector<Value *> results;
+            for (int i = 0; i < lanes; i += slice_lanes) {
+                Expr slice_base = simplify(base + i * ramp->stride);
+                Expr slice_index = Ramp::make(slice_base, 1, slice_lanes * stride->value);
+                Value *ptr = codegen_buffer_pointer(op->name, op->type.element_of(), slice_base);
+                ptr = builder->CreatePointerCast(ptr, load_type->getPointerTo());
+                LoadInst *load = builder->CreateAlignedLoad(ptr, op->type.bytes());
+                add_tbaa_metadata(load, op->name, slice_index);
+                results.push_back(shuffle_vectors(load, indices));
+            }
+            value = concat_vectors(results);
+            return;
+        }
+    }
+
+    if (ramp) {
+        CodeGen_Posix::visit(op);
+        return;
+    }
+
+    // Lookups into a table of at most 16 bytes can be done within
+    // registers using pshufb. All the indices are in bounds, so they
+    // fit in the low bits of each byte.
+    int table_bytes = 0;
+    if (op->image.defined()) {
+        table_bytes = (int)std::min(op->image.size_in_bytes(), (size_t)17);
+    } else if (allocations.contains(op->name)) {
+        table_bytes = allocations.get(op->name).constant_bytes;
+    }
+    if (op->type.bits() == 8 && table_bytes > 0 && table_bytes <= 16 &&
+        lanes % 16 == 0 && target.has_feature(Target::SSE41)) {
+        // Assemble the table from scalar loads so that LLVM can hoist
+        // it out of loops along with the loads.
+        Value *table = UndefValue::get(VectorType::get(i8_t, 16));
+        for (int i = 0; i < table_bytes; i++) {
+            Value *entry = codegen(Load::make(op->type.element_of(), op->name, i,
+                                              op->image, op->param, const_true()));
+            table = builder->CreateInsertElement(table, entry, ConstantInt::get(i32_t, i));
+        }
+
+        // pshufb on 256-bit vectors looks up each half in its own
+        // copy of the table.
+        int slice_size = 16;
+        string intrin = "llvm.x86.ssse3.pshuf.b.128";
+        if (target.has_feature(Target::AVX2) && lanes % 32 == 0) {
+            table = concat_vectors({table, table});
+            slice_size = 32;
+            intrin = "llvm.x86.avx2.pshuf.b";
+        }
+
+        Value *index = builder->CreateTrunc(codegen(op->index), VectorType::get(i8_t, lanes));
+        vector<Value *> result;
+        for (int i = 0; i < lanes; i += slice_size) {
+            result.push_back(call_intrin(table->getType(), slice_size, intrin,
+                                         {table, slice_vector(index, i, slice_size)}));
+        }
+        value = concat_vectors(result);
+        return;
+    }
+
+    // Gathers of 32-bit values are cheaper as AVX2 gathers than as a
+    // load and insert per lane. Narrower values would need wider reads
+    // than are safe, and wider ones have only four lanes per gather,
+    // which doesn't pay.
+    Expr base_index = make_zero(Int(32)), offsets = op->index;
+    is_narrowed_index(op->index, &base_index, &offsets);
+    if (op->type.bits() == 32 && lanes % 8 == 0 &&
+        offsets.type().bits() == 32 &&
+        (target.has_feature(Target::AVX2) || target.has_feature(Target::AVX512))) {
+        llvm::Function *fn =
+            llvm::Intrinsic::getDeclaration(module.get(),
+                                            op->type.is_float() ?
+                                            Intrinsic::x86_avx2_gather_d_ps_256 :
+                                            Intrinsic::x86_avx2_gather_d_d_256);
+        llvm::Type *slice_t = VectorType::get(llvm_type_of(op->type.element_of()), 8);
+        Value *base = codegen_buffer_pointer(op->name, op->type.element_of(), base_index);
+        base = builder->CreatePointerCast(base, i8_t->getPointerTo());
+        Value *index = codegen(offsets);
+        Value *mask = Constant::getAllOnesValue(slice_t);
+        Value *scale = ConstantInt::get(i8_t, op->type.bytes());
+
+        vector<Value *> result;
+        for (int i = 0; i < lanes; i += 8) {
+            Value *args[] = {UndefValue::get(slice_t), base, slice_vector(index, i, 8), mask, scale};
+            result.push_back(builder->CreateCall(fn, args));
+        }
+        value = concat_vectors(result);
+        return;
+    }
+
+    CodeGen_Posix::visit(op);
+}
+
+void CodeGen_X86::visit(const Store *op) {
+    Type t = op->value.type();
+    if (use_masked_gather_scatter(t, op->index, op->predicate)) {
+        const int lanes = t.lanes();
+        const int slice_size = std::min(lanes, target.natural_vector_size(t));
+        Value *val = codegen(op->value);
+        Value *ptrs = codegen_element_pointers(op->name, t, op->index);
+        Value *mask = padded_mask(op->predicate, slice_size);
+        for (int i = 0; i < lanes; i += slice_size) {
+            Instruction *scatter =
+                builder->CreateMaskedScatter(slice_vector(val, i, slice_size),
+                                             slice_vector(ptrs, i, slice_size),
+                                             t.bytes(), slice_vector(mask, i, slice_size));
+            add_tbaa_metadata(scatter, op->name, op->index);
+        }
+        return;
+    }
+
+    CodeGen_Posix::visit(op);
+}
+
+Value *CodeGen_X86::interleave_vectors(const vector<Value *> &vecs) {
+    // Interleave three or four vectors with a single shuffle of two
+    // concatenated pairs of them. LLVM recognizes this form when it's
+    // stored, and lowers it to the best shuffle sequence for the
+    // target instead of the chain of shuffles the general case makes.
+    if (vecs.size() == 3 || vecs.size() == 4) {
+        const int n = vecs[0]->getType()->getVectorNumElements();
+        const int k = (int)vecs.size();
+        Value *a = concat_vectors({vecs[0], vecs[1]});
+        Value *b = (k == 4) ? concat_vectors({vecs[2], vecs[3]}) : slice_vector(vecs[2], 0, 2 * n);
+        vector<int> indices(n * k);
+        for (int i = 0; i < n * k; i++) {
+            indices[i] = (i % k) * n + i / k;
+        }
+        return shuffle_vectors(a, b, indices);
+    }
+    return CodeGen_Posix::interleave_vectors(vecs);
+}
+
 void CodeGen_X86::visit(const Cast *op) {
 
     if (!op->type.is_vector()) {
@@ -262,6 +667,12 @@ void CodeGen_X86::visit(const Cast *op) {
          i16((wild_i32x_ * wild_i32x_) / 65536)},
         {Target::FeatureEnd, true, UInt(16, 8), 0, "llvm.x86.sse2.pmulhu.w",
          u16((wild_u32x_ * wild_u32x_) / 65536)},
+
+        // Q15 multiplication, rounded to nearest
+        {Target::AVX2, true, Int(16, 16), 9, "llvm.x86.avx2.pmul.hr.sw",
+         i16((wild_i32x_ * wild_i32x_ + 16384) / 32768)},
+        {Target::SSE41, true, Int(16, 8), 0, "llvm.x86.ssse3.pmul.hr.sw.128",
+         i16((wild_i32x_ * wild_i32x_ + 16384) / 32768)},
 #if LLVM_VERSION < 60
         // Older LLVM versions support this as an intrinsic
         {Target::AVX2, true, UInt(8, 32), 0, "llvm.x86.avx2.pavg.b",
@@ -301,6 +712,39 @@ void CodeGen_X86::visit(const Cast *op) {
          u16_sat(wild_i32x_)}
     };
 
+    // A rounding right shift of an int16 by n is a Q15 multiplication
+    // by 2^(15 - n), which pmulhrsw does without widening.
+    if (target.has_feature(Target::SSE41) && op->type.element_of() == Int(16) &&
+        expr_match(i16((wild_i32x_ + wild_i32x_) / wild_i32x_), op, matches)) {
+        const int64_t *round = as_const_int(matches[1]);
+        const int64_t *divisor = as_const_int(matches[2]);
+        Expr a = lossless_cast(op->type, matches[0]);
+        int shift = 0;
+        if (a.defined() && divisor && is_const_power_of_two_integer(matches[2], &shift) &&
+            shift >= 1 && shift <= 15 && round && *round == *divisor / 2) {
+            const bool avx2 = target.has_feature(Target::AVX2) && op->type.lanes() > 8;
+            Expr multiplier = make_const(op->type, 1 << (15 - shift));
+            value = call_intrin(op->type, avx2 ? 16 : 8,
+                                avx2 ? "llvm.x86.avx2.pmul.hr.sw" : "llvm.x86.ssse3.pmul.hr.sw.128",
+                                {a, multiplier});
+            return;
+        }
+    }
+
+    // The average of two unsigned values, rounded down, is the
+    // rounded-up average from pavg, less one where the sum is odd.
+    if (expr_match(u8((wild_u16x_ + wild_u16x_) / 2), op, matches) ||
+        expr_match(u16((wild_u32x_ + wild_u32x_) / 2), op, matches)) {
+        Expr a = lossless_cast(op->type, matches[0]);
+        Expr b = lossless_cast(op->type, matches[1]);
+        if (a.defined() && b.defined()) {
+            Type wide = matches[0].type();
+            Expr rounded_up = cast(op->type, (cast(wide, a) + cast(wide, b) + 1) / 2);
+            codegen(rounded_up - ((a ^ b) & make_one(op->type)));
+            return;
+        }
+    }
+
     for (size_t i = 0; i < sizeof(patterns)/sizeof(patterns[0]); i++) {
         const Pattern &pattern = patterns[i];
 
@@ -375,6 +819,12 @@ Expr CodeGen_X86::mulhi_shr(Expr a, Expr b, int shr) {
 
 string CodeGen_X86::mcpu() const {
     if (target.has_feature(Target::AVX512_Cannonlake)) return "cannonlake";
+#if LLVM_VERSION >= 100
+    if (target.has_feature(Target::AVX512_BF16)) return "cooperlake";
+#endif
+#if LLVM_VERSION >= 80
+    if (target.has_feature(Target::AVX512_VNNI)) return "cascadelake";
+#endif
     if (target.has_feature(Target::AVX512_Skylake)) return "skylake-avx512";
     if (target.has_feature(Target::AVX512_KNL)) return "knl";
     if (target.has_feature(Target::AVX2)) return "haswell";
@@ -416,6 +866,14 @@ string CodeGen_X86::mattrs() const {
         if (target.has_feature(Target::AVX512_Cannonlake)) {
             features += ",+avx512ifma,+avx512vbmi";
         }
+        if (target.has_feature(Target::AVX512_VNNI)) {
+            features += ",+avx512vnni";
+        }
+#if LLVM_VERSION >= 90
+        if (target.has_feature(Target::AVX512_BF16)) {
+            features += ",+avx512bf16";
+        }
+#endif
     }
     return features;
 }
@@ -424,6 +882,24 @@ bool CodeGen_X86::use_soft_float_abi() const {
     return false;
 }
 
+bool CodeGen_X86::use_nontemporal_stores() const {
+    return true;
+}
+
+void CodeGen_X86::codegen_nontemporal_store_fence() {
+    // Non-temporal stores are weakly ordered, and only fences (or
+    // locked instructions) order them with other stores. sfence is
+    // enough.
+    builder->CreateCall(Intrinsic::getDeclaration(module.get(), Intrinsic::x86_sse_sfence));
+}
+
+bool CodeGen_X86::use_mask_registers() const {
+    return (target.has_feature(Target::AVX512) ||
+            target.has_feature(Target::AVX512_Skylake) ||
+            target.has_feature(Target::AVX512_KNL) ||
+            target.has_feature(Target::AVX512_Cannonlake));
+}
+
 int CodeGen_X86::native_vector_bits() const {
     if (target.has_feature(Target::AVX512) ||
         target.has_feature(Target::AVX512_Skylake) ||
@@ -28,9 +28,37 @@ protected:
     std::string mattrs() const;
     bool use_soft_float_abi() const;
     int native_vector_bits() const;
+    bool use_nontemporal_stores() const;
+    /** Whether vectors of bools live in AVX-512 mask registers. */
+    bool use_mask_registers() const;
+    void codegen_nontemporal_store_fence();
 
     Expr mulhi_shr(Expr a, Expr b, int shr);
 
+    /** Try to generate an add of products of narrow values as AVX512
+     * VNNI dot products. Returns false if it doesn't match. */
+    bool try_vnni(const Add *op);
+
+    /** Interleave three or four vectors in a form LLVM can lower to
+     * efficient shuffles when stored. */
+    llvm::Value *interleave_vectors(const std::vector<llvm::Value *> &);
+
+    /** Generate a vector LE, GE, or NE as a single AVX-512 compare
+     * per native vector. */
+    llvm::Value *codegen_mask_compare(const Expr &cmp);
+
+    /** Whether a predicated access should be an AVX-512 masked
+     * gather or scatter. */
+    bool use_masked_gather_scatter(Type t, const Expr &index, const Expr &predicate) const;
+
+    /** A vector of pointers to the elements of a buffer at the given
+     * indices. */
+    llvm::Value *codegen_element_pointers(const std::string &name, Type t, const Expr &index);
+
+    /** Generate a predicate, padded with false lanes to a multiple of
+     * slice_size. */
+    llvm::Value *padded_mask(const Expr &predicate, int slice_size);
+
     using CodeGen_Posix::visit;
 
     /** Nodes for which we want to emit specific sse/avx intrinsics */
@@ -45,6 +73,8 @@ protected:
     void visit(const EQ *);
     void visit(const NE *);
     void visit(const Select *);
+    void visit(const Load *);
+    void visit(const Store *);
     // @}
 };
 
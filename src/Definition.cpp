@@ -21,6 +21,10 @@ struct DefinitionContents {
     std::vector<Expr> values, args;
     StageSchedule stage_schedule;
     std::vector<Specialization> specializations;
+    // Where the definition was made. Finding the source location needs
+    // the debug info, so only the call stack is kept until it's asked
+    // for.
+    std::vector<void *> call_stack;
     std::string source_location;
 
     DefinitionContents() : is_init(true), predicate(const_true()) {}
@@ -93,7 +97,7 @@ Definition::Definition(const std::vector<Expr> &args, const std::vector<Expr> &v
     contents->is_init = is_init;
     contents->values = values;
     contents->args = args;
-    contents->source_location = Introspection::get_source_location();
+    contents->call_stack = Introspection::get_call_stack();
     if (rdom.defined()) {
         contents->predicate = rdom.predicate();
         for (size_t i = 0; i < rdom.domain().size(); i++) {
@@ -111,6 +115,7 @@ Definition Definition::get_copy() const {
     copy.contents->values = contents->values;
     copy.contents->args = contents->args;
     copy.contents->stage_schedule = contents->stage_schedule.get_copy();
+    copy.contents->call_stack = contents->call_stack;
     copy.contents->source_location = contents->source_location;
 
     // Deep-copy specializations
@@ -187,6 +192,10 @@ const std::vector<Specialization> &Definition::specializations() const {
 }
 
 std::string Definition::source_location() const {
+    if (!contents->call_stack.empty()) {
+        contents->source_location = Introspection::get_source_location(contents->call_stack);
+        contents->call_stack.clear();
+    }
     return contents->source_location;
 }
 
@@ -198,6 +207,7 @@ const Specialization &Definition::add_specialization(Expr condition) {
     s.definition.contents->predicate = contents->predicate;
     s.definition.contents->values = contents->values;
     s.definition.contents->args   = contents->args;
+    s.definition.contents->call_stack = contents->call_stack;
     s.definition.contents->source_location = contents->source_location;
 
     // The sub-schedule inherits everything about its parent except for its specializations.
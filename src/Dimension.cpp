@@ -60,6 +60,11 @@ Dimension Dimension::set_stride(Expr stride) {
     return *this;
 }
 
+Dimension Dimension::set_stride_multiple(int multiple) {
+    param.set_stride_multiple(d, multiple);
+    return *this;
+}
+
 Dimension Dimension::set_bounds(Expr min, Expr extent) {
     return set_min(min).set_extent(extent);
 }
@@ -72,6 +72,19 @@ public:
      * generate better code. */
     Dimension set_stride(Expr stride);
 
+    /** Promise that the stride in a given dimension is a multiple of
+     * the given number of elements, without fixing its value. This is
+     * checked when the pipeline runs. Combined with
+     * OutputImageParam::set_host_alignment, it lets the compiler know
+     * that vectors at the start of each row (or plane, etc.) are
+     * aligned, so it can emit aligned loads and stores of them
+     * (e.g. if all rows of an 8-bit image start on 64-byte boundaries,
+     * set the host alignment to 64 and the stride of dimension 1 to a
+     * multiple of 64). Ignored if the stride is constrained with
+     * set_stride. In bounds query mode, the proposed stride is rounded
+     * up to the multiple. */
+    Dimension set_stride_multiple(int multiple);
+
     /** Set the min and extent in one call. */
     Dimension set_bounds(Expr min, Expr extent);
 
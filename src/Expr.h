@@ -366,6 +366,12 @@ enum class MemoryType {
      * "local" in OpenCL, and "threadgroup" in metal. Can be shared
      * across GPU threads within the same block. */
     GPUShared,
+
+    /** Allocation is stored in the VTCM scratchpad of Hexagon v65 and
+     * later, which has much lower latency than DDR. Allocated using
+     * halide_vtcm_malloc, which falls back to the heap if VTCM is
+     * unavailable. Treated as Auto on other targets. */
+    VTCM,
 };
 
 namespace Internal {
@@ -0,0 +1,288 @@
+#include "FoldConstantFuncs.h"
+#include "Debug.h"
+#include "FindCalls.h"
+#include "Func.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "IRVisitor.h"
+#include "Pipeline.h"
+#include "Simplify.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Find everything that stops a Func from being evaluated at compile
+// time, and the Funcs it calls.
+class FindNonConstant : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Variable *op) override {
+        if (op->param.defined()) {
+            constant = false;
+        }
+    }
+
+    void visit(const Call *op) override {
+        switch (op->call_type) {
+        case Call::Halide:
+            callees.insert(op->name);
+            break;
+        case Call::Image:
+            // Embedded Buffers are constant; ImageParams are not.
+            constant &= !op->param.defined();
+            break;
+        case Call::PureExtern:
+        case Call::PureIntrinsic:
+            break;
+        default:
+            constant = false;
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    bool constant = true;
+    set<string> callees;
+};
+
+bool runs_on_host(const Definition &def) {
+    for (const Dim &d : def.schedule().dims()) {
+        if (d.for_type == ForType::GPUBlock ||
+            d.for_type == ForType::GPUThread ||
+            d.for_type == ForType::GPULane ||
+            (d.device_api != DeviceAPI::None && d.device_api != DeviceAPI::Host)) {
+            return false;
+        }
+    }
+    for (const Specialization &s : def.specializations()) {
+        if (!runs_on_host(s.definition)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The constant region f is bounded to, or false if some dimension
+// isn't bounded by constants.
+bool constant_bounds(const Function &f, vector<int> &mins, vector<int> &extents) {
+    for (const string &arg : f.args()) {
+        const Bound *bound = nullptr;
+        for (const Bound &b : f.schedule().bounds()) {
+            if (b.var == arg && b.min.defined() && b.extent.defined()) {
+                bound = &b;
+            }
+        }
+        if (!bound) {
+            return false;
+        }
+        const int64_t *min = as_const_int(simplify(bound->min));
+        const int64_t *extent = as_const_int(simplify(bound->extent));
+        if (!min || !extent) {
+            return false;
+        }
+        mins.push_back((int)*min);
+        extents.push_back((int)*extent);
+    }
+    return true;
+}
+
+// Whether f depends only on constants, given that all of the Funcs it
+// calls do.
+bool is_constant(const Function &f, set<string> &callees) {
+    const FuncSchedule &s = f.schedule();
+    if (f.has_extern_definition() ||
+        s.memoized() ||
+        s.async() ||
+        !f.debug_file().empty() ||
+        f.is_tracing_loads() ||
+        f.is_tracing_stores() ||
+        f.is_tracing_realizations()) {
+        return false;
+    }
+    for (const Type &t : f.output_types()) {
+        if (t.is_handle()) {
+            return false;
+        }
+    }
+    if (!runs_on_host(f.definition())) {
+        return false;
+    }
+    for (const Definition &def : f.updates()) {
+        if (!runs_on_host(def)) {
+            return false;
+        }
+    }
+    FindNonConstant finder;
+    f.accept(&finder);
+    callees.swap(finder.callees);
+    return finder.constant;
+}
+
+// Replace calls to folded Funcs with loads from their Buffers.
+class ReplaceWithBuffers : public IRMutator2 {
+    using IRMutator2::visit;
+
+    Expr visit(const Call *op) override {
+        if (op->call_type == Call::Halide) {
+            auto it = buffers.find(op->name);
+            if (it != buffers.end()) {
+                vector<Expr> args;
+                for (const Expr &a : op->args) {
+                    args.push_back(mutate(a));
+                }
+                return Call::make(it->second[op->value_index], args);
+            }
+        }
+        return IRMutator2::visit(op);
+    }
+
+public:
+    const map<string, vector<Buffer<>>> &buffers;
+    ReplaceWithBuffers(const map<string, vector<Buffer<>>> &buffers)
+        : buffers(buffers) {}
+};
+
+}  // namespace
+
+void fold_constant_funcs(const vector<Function> &outputs, map<string, Function> &env) {
+    // Find the Funcs that depend only on constants, directly and
+    // through everything they call.
+    set<string> constant;
+    map<string, set<string>> callees;
+    for (const auto &iter : env) {
+        if (is_constant(iter.second, callees[iter.first])) {
+            constant.insert(iter.first);
+        }
+    }
+    for (const Function &o : outputs) {
+        constant.erase(o.name());
+    }
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto it = constant.begin(); it != constant.end();) {
+            bool calls_non_constant = false;
+            for (const string &c : callees[*it]) {
+                calls_non_constant |= !constant.count(c);
+            }
+            if (calls_non_constant) {
+                it = constant.erase(it);
+                changed = true;
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    // Fold the constant Funcs with constant bounds that something
+    // outside the constant subgraph calls. Everything still reachable
+    // from the outputs once they are gone is kept. A Func stays unfolded
+    // if a kept Func is computed or stored within it, or consumes it as
+    // an extern stage.
+    set<string> folded;
+    for (const auto &iter : env) {
+        if (!constant.count(iter.first)) {
+            for (const auto &c : find_direct_calls(iter.second)) {
+                folded.insert(c.first);
+            }
+        }
+    }
+    for (auto it = folded.begin(); it != folded.end();) {
+        vector<int> mins, extents;
+        if (constant.count(*it) && constant_bounds(env.at(*it), mins, extents)) {
+            ++it;
+        } else {
+            it = folded.erase(it);
+        }
+    }
+
+    set<string> kept;
+    changed = true;
+    while (changed) {
+        changed = false;
+        kept.clear();
+        vector<string> pending;
+        for (const Function &o : outputs) {
+            pending.push_back(o.name());
+        }
+        while (!pending.empty()) {
+            string name = pending.back();
+            pending.pop_back();
+            if (folded.count(name) || !kept.insert(name).second) {
+                continue;
+            }
+            const Function &f = env.at(name);
+            for (const auto &c : find_direct_calls(f)) {
+                pending.push_back(c.first);
+            }
+            for (const ExternFuncArgument &arg : f.extern_arguments()) {
+                if (arg.is_func()) {
+                    pending.push_back(Function(arg.func).name());
+                }
+            }
+        }
+
+        for (const string &name : kept) {
+            const Function &f = env.at(name);
+            vector<string> pinned;
+            for (const ExternFuncArgument &arg : f.extern_arguments()) {
+                if (arg.is_func()) {
+                    pinned.push_back(Function(arg.func).name());
+                }
+            }
+            const FuncSchedule &s = f.schedule();
+            if (!s.compute_level().is_inlined() && !s.compute_level().is_root()) {
+                pinned.push_back(s.compute_level().func());
+            }
+            if (!s.store_level().is_inlined() && !s.store_level().is_root()) {
+                pinned.push_back(s.store_level().func());
+            }
+            for (const string &p : pinned) {
+                changed |= folded.erase(p) > 0;
+            }
+        }
+    }
+
+    if (folded.empty()) {
+        return;
+    }
+
+    map<string, vector<Buffer<>>> buffers;
+    Target host = get_host_target();
+    for (const string &name : folded) {
+        const Function &f = env.at(name);
+        vector<int> mins, extents;
+        constant_bounds(f, mins, extents);
+
+        vector<Buffer<>> outs;
+        for (const Type &t : f.output_types()) {
+            Buffer<> b(t, extents, unique_name(name + "_folded"));
+            b.set_min(mins);
+            outs.push_back(b);
+        }
+        debug(2) << "Evaluating constant Func " << name << " at compile time\n";
+        Realization r(outs);
+        Func(f).realize(r, host);
+        buffers[name] = outs;
+    }
+
+    ReplaceWithBuffers replacer(buffers);
+    for (auto it = env.begin(); it != env.end();) {
+        if (kept.count(it->first)) {
+            it->second.mutate(&replacer);
+            ++it;
+        } else {
+            it = env.erase(it);
+        }
+    }
+}
+
+}  // namespace Internal
+}  // namespace Halide
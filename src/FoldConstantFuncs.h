@@ -0,0 +1,37 @@
+#ifndef HALIDE_FOLD_CONSTANT_FUNCS_H
+#define HALIDE_FOLD_CONSTANT_FUNCS_H
+
+/** \file
+ * Defines a pass that evaluates Funcs which depend on no inputs at
+ * compile time.
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Function.h"
+#include "Target.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Find Funcs that depend only on constants: they use no Params,
+ * ImageParams, extern functions or impure intrinsics, and only call
+ * other such Funcs. Realize each one that the rest of the pipeline
+ * calls and that has a constant bound on every dimension (see
+ * Func::bound) on the host with the JIT, replace the calls to it with
+ * loads from the resulting Buffer, and remove the Funcs no longer
+ * needed from the environment. The Buffer is then embedded in the
+ * compiled module as constant data. Funcs that are outputs, traced,
+ * memoized, debug_to_file'd, scheduled on a device, consumed by an
+ * extern stage, or that contain the compute or storage site of a Func
+ * still computed at runtime are left alone. Called after wrappers are
+ * substituted; enabled by the FoldConstantFuncs target feature. */
+void fold_constant_funcs(const std::vector<Function> &outputs,
+                         std::map<std::string, Function> &env);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
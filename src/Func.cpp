@@ -174,6 +174,58 @@ void Func::define_extern(const std::string &function_name,
                        mangling, device_api, uses_old_buffer_t);
 }
 
+namespace {
+
+// Check that the reads declared for an extern stage are of its input Funcs.
+class CheckExternFootprint : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Call *op) override {
+        if (op->call_type == Call::Halide) {
+            user_assert(inputs.count(op->name))
+                << "The footprint of extern stage " << func << " reads " << op->name
+                << ", which is not one of its inputs\n";
+        } else if (op->call_type == Call::Image) {
+            user_assert(false)
+                << "The footprint of extern stage " << func << " reads " << op->name
+                << ". Only reads of input Funcs can be declared\n";
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    const string &func;
+    std::set<string> inputs;
+    CheckExternFootprint(const string &func) : func(func) {}
+};
+
+}  // namespace
+
+Func &Func::extern_footprint(const vector<Expr> &reads) {
+    user_assert(is_extern())
+        << "Can't declare the footprint of Func " << name()
+        << ", because it is not an extern stage\n";
+    user_assert(!reads.empty())
+        << "The footprint of extern stage " << name() << " must list at least one read\n";
+    CheckExternFootprint check(name());
+    for (const ExternFuncArgument &arg : func.extern_arguments()) {
+        if (arg.is_func()) {
+            check.inputs.insert(Function(arg.func).name());
+        }
+    }
+    for (const Expr &e : reads) {
+        user_assert(e.defined())
+            << "Undefined read in the footprint of extern stage " << name() << "\n";
+        e.accept(&check);
+    }
+    invalidate_cache();
+    // Bounds inference treats the proxy expression as the values the
+    // extern stage reads, in place of a bounds query.
+    func.extern_definition_proxy_expr() =
+        Call::make(Handle(), Call::make_struct, reads, Call::Intrinsic);
+    return *this;
+}
+
 /** Get the types of the buffers returned by an extern definition. */
 const std::vector<Type> &Func::output_types() const {
     return func.output_types();
@@ -295,13 +347,16 @@ void Stage::set_dim_type(VarOrRVar var, ForType t) {
                 (t == ForType::Vectorized || t == ForType::Parallel ||
                  t == ForType::GPUBlock || t == ForType::GPUThread ||
                  t == ForType::GPULane)) {
-                user_assert(definition.schedule().allow_race_conditions())
+                user_assert(definition.schedule().allow_race_conditions() ||
+                            (definition.schedule().atomic() && t != ForType::Vectorized))
                     << "In schedule for " << name()
                     << ", marking var " << var.name()
                     << " as parallel or vectorized may introduce a race"
                     << " condition resulting in incorrect output."
                     << " It is possible to override this error using"
-                    << " the allow_race_conditions() method. Use this"
+                    << " the allow_race_conditions() method, or by making"
+                    << " the update atomic() if it is associative. Use"
+                    << " allow_race_conditions()"
                     << " with great caution, and only when you are willing"
                     << " to accept non-deterministic output, or you can prove"
                     << " that any race conditions in this code do not change"
@@ -399,6 +454,39 @@ Expr substitute_self_reference(Expr val, const string &func, const Function &sub
     return val;
 }
 
+/** Replace the calls to 'func' at exactly 'args' with the values of
+ * its init definition at those args. Only valid in the first update
+ * definition, where those calls read values set by the init. */
+class SubstituteInitValue : public IRMutator2 {
+    using IRMutator2::visit;
+
+    const Function func;
+    const vector<Expr> &args;
+
+    Expr visit(const Call *c) override {
+        Expr expr = IRMutator2::visit(c);
+        c = expr.as<Call>();
+        internal_assert(c);
+
+        if ((c->call_type == Call::Halide) && (func.name() == c->name)) {
+            for (size_t i = 0; i < args.size(); i++) {
+                if (!equal(c->args[i], args[i])) {
+                    return expr;
+                }
+            }
+            map<string, Expr> replacements;
+            for (size_t i = 0; i < args.size(); i++) {
+                replacements.emplace(func.args()[i], args[i]);
+            }
+            expr = substitute(replacements, func.values()[c->value_index]);
+        }
+        return expr;
+    }
+public:
+    SubstituteInitValue(const Function &func, const vector<Expr> &args)
+            : func(func), args(args) {}
+};
+
 // Substitute the occurrence of 'name' in 'exprs' with 'value'.
 void substitute_var_in_exprs(const string &name, Expr value, vector<Expr> &exprs) {
     for (auto &expr : exprs) {
@@ -892,6 +980,201 @@ Func Stage::rfactor(vector<pair<RVar, Var>> preserved) {
     return intm;
 }
 
+Func Stage::parallel_scan(RVar r, Var u, Expr block_size) {
+    user_assert(stage_index == 1)
+        << "parallel_scan() must be called on the first update definition of a Func\n";
+    user_assert(definition.schedule().splits().empty())
+        << "In schedule for " << name()
+        << ", parallel_scan() must be called before the stage is split\n";
+    user_assert(!definition.predicate().defined() || is_one(definition.predicate()))
+        << "In schedule for " << name()
+        << ", can't call parallel_scan() on an update with a predicate\n";
+
+    const string &func_name = function.name();
+    vector<Expr> &args = definition.args();
+    vector<Expr> &values = definition.values();
+
+    const vector<ReductionVariable> &rvars = definition.schedule().rvars();
+    const auto &rv_iter = std::find_if(rvars.begin(), rvars.end(),
+        [&r](const ReductionVariable &rv) { return var_name_match(rv.var, r.name()); });
+    user_assert(rv_iter != rvars.end())
+        << "In schedule for " << name()
+        << ", can't scan along " << r.name()
+        << " since it is not in the reduction domain\n"
+        << dump_argument_list();
+    const ReductionVariable scan_rv = *rv_iter;
+
+    // Every arg must be a distinct variable, and exactly one of them
+    // the RVar being scanned along, so that each iteration stores to
+    // its own site.
+    int scan_dim = -1;
+    for (size_t i = 0; i < args.size(); i++) {
+        const Variable *v = args[i].as<Variable>();
+        user_assert(v)
+            << "In schedule for " << name()
+            << ", can't call parallel_scan() since arg " << i
+            << " of the update is not a variable: " << args[i] << "\n";
+        for (size_t j = 0; j < i; j++) {
+            user_assert(!equal(args[i], args[j]))
+                << "In schedule for " << name()
+                << ", can't call parallel_scan() since " << args[i]
+                << " appears in more than one arg of the update\n";
+        }
+        if (v->name == scan_rv.var) {
+            scan_dim = i;
+        }
+    }
+    user_assert(scan_dim >= 0)
+        << "In schedule for " << name()
+        << ", can't call parallel_scan() since " << r.name()
+        << " is not an arg of the update\n";
+
+    // The value at r was set by the init definition.
+    vector<Expr> init_inlined(values.size());
+    for (size_t i = 0; i < values.size(); i++) {
+        init_inlined[i] = SubstituteInitValue(function, args).mutate(values[i]);
+    }
+
+    // The scan reads the value before it along r.
+    const Expr rv_expr = args[scan_dim];
+    vector<Expr> prev_args = args;
+    prev_args[scan_dim] = rv_expr - 1;
+    const auto &prover_result = prove_associativity(func_name, prev_args, init_inlined);
+    user_assert(prover_result.associative())
+        << "Failed to call parallel_scan() on " << name()
+        << " since it can't prove associativity of the operator\n";
+    internal_assert(prover_result.size() == values.size());
+
+    // Combine a, the scan so far, with b, the next element.
+    auto combine = [&](const vector<Expr> &a, const vector<Expr> &b) {
+        map<string, Expr> replacements;
+        for (size_t i = 0; i < values.size(); i++) {
+            if (!prover_result.xs[i].var.empty()) {
+                replacements.emplace(prover_result.xs[i].var, a[i]);
+            }
+            if (!prover_result.ys[i].var.empty()) {
+                replacements.emplace(prover_result.ys[i].var, b[i]);
+            }
+        }
+        vector<Expr> result(values.size());
+        for (size_t i = 0; i < values.size(); i++) {
+            result[i] = substitute(replacements, prover_result.pattern.ops[i]);
+        }
+        return result;
+    };
+
+    auto elements = [&](Func f, const vector<Expr> &f_args) {
+        vector<Expr> result(values.size());
+        for (size_t i = 0; i < values.size(); i++) {
+            result[i] = (values.size() == 1) ? Expr(f(f_args)) : Expr(f(f_args)[i]);
+        }
+        return result;
+    };
+
+    // The intermediates have a pure Var in place of each arg other
+    // than the scanned one.
+    vector<Var> outer_vars;
+    vector<Expr> outer_args;
+    map<string, Expr> to_outer_vars;
+    for (size_t i = 0; i < args.size(); i++) {
+        if ((int)i == scan_dim) {
+            continue;
+        }
+        const string &arg_name = args[i].as<Variable>()->name;
+        Var v = (arg_name == function.args()[i]) ? Var(arg_name) : Var(unique_name('v'));
+        user_assert(v.name() != u.name())
+            << "In schedule for " << name()
+            << ", can't name the blocks " << u.name()
+            << ", since it is already used by this Func\n";
+        outer_vars.push_back(v);
+        outer_args.push_back(args[i]);
+        to_outer_vars.emplace(arg_name, v);
+    }
+
+    const Expr scan_min = scan_rv.min, scan_extent = scan_rv.extent;
+    const Expr num_blocks = (scan_extent + block_size - 1) / block_size;
+
+    // Scan each block. The last block is padded with the identity.
+    Var i(unique_name('i'));
+    Func local(func_name + "_scan");
+    {
+        Expr pos = scan_min + u * block_size + i;
+        map<string, Expr> replacements = to_outer_vars;
+        replacements.emplace(scan_rv.var, Halide::min(pos, scan_min + scan_extent - 1));
+        vector<Expr> init_vals(values.size());
+        for (size_t k = 0; k < values.size(); k++) {
+            Expr y = prover_result.ys[k].var.empty() ?
+                prover_result.pattern.identities[k] :
+                substitute(replacements, prover_result.ys[k].expr);
+            init_vals[k] = select(pos < scan_min + scan_extent, y, prover_result.pattern.identities[k]);
+        }
+        vector<Var> local_args = outer_vars;
+        local_args.push_back(i);
+        local_args.push_back(u);
+        local(local_args) = Tuple(init_vals);
+
+        RDom ri(1, block_size - 1, func_name + "_scan_ri");
+        vector<Expr> prev = vector<Expr>(outer_vars.begin(), outer_vars.end());
+        vector<Expr> cur = prev;
+        prev.push_back(ri - 1);
+        prev.push_back(u);
+        cur.push_back(ri);
+        cur.push_back(u);
+        local(cur) = Tuple(combine(elements(local, prev), elements(local, cur)));
+    }
+    local.compute_root().update(0).parallel(u);
+
+    // Scan the totals of the blocks, starting from the value before
+    // the first element.
+    Func carry(func_name + "_scan_carry");
+    {
+        map<string, Expr> replacements;
+        for (size_t k = 0; k < args.size(); k++) {
+            const string &arg_name = function.args()[k];
+            if ((int)k == scan_dim) {
+                replacements.emplace(arg_name, scan_min - 1);
+            } else {
+                replacements.emplace(arg_name, to_outer_vars.at(args[k].as<Variable>()->name));
+            }
+        }
+        vector<Expr> init_vals(values.size());
+        for (size_t k = 0; k < values.size(); k++) {
+            init_vals[k] = substitute(replacements, function.values()[k]);
+        }
+        vector<Var> carry_args = outer_vars;
+        carry_args.push_back(u);
+        carry(carry_args) = Tuple(init_vals);
+
+        RDom ru(1, num_blocks - 1, func_name + "_scan_ru");
+        vector<Expr> prev = vector<Expr>(outer_vars.begin(), outer_vars.end());
+        vector<Expr> cur = prev;
+        vector<Expr> total = prev;
+        prev.push_back(ru - 1);
+        cur.push_back(ru);
+        total.push_back(block_size - 1);
+        total.push_back(ru - 1);
+        carry(cur) = Tuple(combine(elements(carry, prev), elements(local, total)));
+    }
+    carry.compute_root();
+
+    // Each element is the carry into its block combined with its scan
+    // within the block.
+    Expr offset = rv_expr - scan_min;
+    vector<Expr> carry_args = outer_args;
+    carry_args.push_back(offset / block_size);
+    vector<Expr> local_args = outer_args;
+    local_args.push_back(offset % block_size);
+    local_args.push_back(offset / block_size);
+    values = combine(elements(carry, carry_args), elements(local, local_args));
+
+    // The update no longer reads its previous values, and every
+    // iteration stores to a distinct site, so its RVars may be
+    // parallelized.
+    definition.schedule().allow_race_conditions() = true;
+
+    return local;
+}
+
 void Stage::split(const string &old, const string &outer, const string &inner, Expr factor, bool exact, TailStrategy tail) {
     debug(4) << "In schedule for " << name() << ", split " << old << " into "
              << outer << " and " << inner << " with factor of " << factor << "\n";
@@ -1029,9 +1312,9 @@ void Stage::split(const string &old, const string &outer, const string &inner, E
     }
 
     if (exact) {
-        user_assert(tail == TailStrategy::GuardWithIf)
+        user_assert(tail == TailStrategy::GuardWithIf || tail == TailStrategy::Predicate)
             << "When splitting Var " << old_name
-            << " the tail strategy must be GuardWithIf or Auto. "
+            << " the tail strategy must be GuardWithIf, Predicate, or Auto. "
             << "Anything else may change the meaning of the algorithm\n";
     }
 
@@ -1406,6 +1689,14 @@ Stage &Stage::allow_race_conditions() {
     return *this;
 }
 
+Stage &Stage::atomic() {
+    user_assert(!definition.is_init())
+        << "In schedule for " << name()
+        << ", can't make the pure definition atomic. Only update definitions can be atomic.\n";
+    definition.schedule().atomic() = true;
+    return *this;
+}
+
 Stage &Stage::serial(VarOrRVar var) {
     set_dim_type(var, ForType::Serial);
     return *this;
@@ -1465,6 +1756,60 @@ Stage &Stage::unroll(VarOrRVar var, Expr factor, TailStrategy tail) {
     return *this;
 }
 
+Stage &Stage::unroll_and_jam(VarOrRVar outer, Expr factor, TailStrategy tail) {
+    const vector<Dim> &dims = definition.schedule().dims();
+    size_t outer_idx = dims.size();
+    for (size_t i = 0; i < dims.size(); i++) {
+        if (var_name_match(dims[i].var, outer.name())) {
+            outer_idx = i;
+        }
+    }
+    user_assert(outer_idx < dims.size())
+        << "In schedule for " << name()
+        << ", could not find var " << outer.name()
+        << " to unroll and jam in the argument list.\n"
+        << dump_argument_list();
+
+    // Jamming moves the unrolled copies of the outer loop inside all
+    // of the loops nested within it. That's always fine for a pure
+    // var, because each iteration of it writes to different sites. An
+    // RVar's iterations may depend on each other, so an RVar can only
+    // be jammed past pure vars.
+    if (dims[outer_idx].is_rvar()) {
+        for (size_t i = 0; i < outer_idx; i++) {
+            user_assert(dims[i].is_pure())
+                << "In schedule for " << name()
+                << ", can't unroll and jam RVar " << outer.name()
+                << " inside RVar " << dims[i].var
+                << " because it may change the meaning of the algorithm.\n";
+        }
+    }
+
+    string inner_name = outer.name() + "_jam";
+    if (outer.is_rvar) {
+        split(outer.rvar, outer.rvar, RVar(inner_name), factor, tail);
+    } else {
+        split(outer.var, outer.var, Var(inner_name), factor, tail);
+    }
+
+    // The split put the unrolled dimension just inside the outer
+    // one. Move it inwards, stopping outside any vectorized loops so
+    // that each copy of the body stays a whole vector.
+    vector<Dim> &new_dims = definition.schedule().dims();
+    size_t inner_idx = outer_idx;
+    internal_assert(var_name_match(new_dims[inner_idx].var, inner_name));
+    size_t jam_idx = 0;
+    while (jam_idx < inner_idx && new_dims[jam_idx].for_type == ForType::Vectorized) {
+        jam_idx++;
+    }
+    Dim jammed = new_dims[inner_idx];
+    jammed.for_type = ForType::Unrolled;
+    new_dims.erase(new_dims.begin() + inner_idx);
+    new_dims.insert(new_dims.begin() + jam_idx, jammed);
+
+    return *this;
+}
+
 Stage &Stage::tile(VarOrRVar x, VarOrRVar y,
                    VarOrRVar xo, VarOrRVar yo,
                    VarOrRVar xi, VarOrRVar yi,
@@ -1486,6 +1831,55 @@ Stage &Stage::tile(VarOrRVar x, VarOrRVar y,
     return *this;
 }
 
+namespace {
+// The vector width to use when blocking a Func into registers: the
+// natural vector size of the widest type it computes.
+int register_tile_vector_size(const Function &f, const Target &t) {
+    int vec = 0;
+    for (Type type : f.output_types()) {
+        int n = t.natural_vector_size(type);
+        vec = vec ? std::min(vec, n) : n;
+    }
+    return vec;
+}
+}  // namespace
+
+Stage &Stage::register_tile(Var x, Var y, const Target &t, TailStrategy tail) {
+    const int vec = register_tile_vector_size(function, t);
+
+    // Leave a few registers for the operands loaded inside the
+    // reduction, and fill the rest with a block of accumulators a few
+    // vectors wide.
+    const int accumulators = std::max(1, t.vector_register_count() - 4) / (int)function.outputs();
+    const int cols = accumulators >= 24 ? 4 : (accumulators >= 8 ? 2 : 1);
+    const int rows = std::max(1, std::min(8, accumulators / cols));
+
+    debug(3) << "Register tiling " << name() << " with a block of "
+             << rows << " rows of " << cols << " vectors of width " << vec << "\n";
+
+    Var xi(x.name() + "_block"), xii(x.name() + "_vec"), yi(y.name() + "_block");
+    split(x, x, xi, vec * cols, tail);
+    split(xi, xi, xii, vec, tail);
+    split(y, y, yi, rows, tail);
+
+    // The block goes innermost, inside any reduction loops, so that
+    // each accumulator stays live across the whole reduction.
+    vector<VarOrRVar> order = {xii, xi, yi};
+    for (const Dim &d : definition.schedule().dims()) {
+        if (d.is_rvar()) {
+            order.push_back(VarOrRVar(d.var, true));
+        }
+    }
+    order.push_back(x);
+    order.push_back(y);
+    reorder(order);
+
+    vectorize(xii);
+    unroll(xi);
+    unroll(yi);
+    return *this;
+}
+
 namespace {
 // An helper function for reordering vars in a schedule.
 void reorder_vars(vector<Dim> &dims_old, const VarOrRVar *vars, size_t size, const Stage &stage) {
@@ -1723,6 +2117,15 @@ Stage &Stage::prefetch(const Internal::Parameter &param, VarOrRVar var, Expr off
     return *this;
 }
 
+Stage &Stage::skip_unless(Expr condition, VarOrRVar var) {
+    user_assert(condition.defined() && condition.type().is_bool())
+        << "In schedule for " << name()
+        << ", the condition of skip_unless must be a boolean: " << condition << "\n";
+    SkipDirective skip = {var.name(), condition};
+    definition.schedule().skips().push_back(skip);
+    return *this;
+}
+
 Stage &Stage::compute_with(LoopLevel loop_level, const map<string, LoopAlignStrategy> &align) {
     loop_level.lock();
     user_assert(!loop_level.is_inlined() && !loop_level.is_root())
@@ -1885,6 +2288,34 @@ Func Func::in() {
     return get_wrapper(func, name() + "_global_wrapper", {}, false);
 }
 
+Func Func::stage_in_gpu_shared(const Func &consumer, const VarOrRVar &block,
+                               int threads_x, int threads_y) {
+    user_assert(threads_x > 0 && threads_y > 0)
+        << "The thread counts for staging " << name() << " in shared memory must be positive.\n";
+    user_assert(dimensions() > 0)
+        << "Can't stage zero-dimensional Func " << name() << " in shared memory.\n";
+
+    Func staged = in(consumer);
+    staged.compute_at(LoopLevel(consumer, block)).store_in(MemoryType::GPUShared);
+
+    // Each thread loads every threads_x-th value of the innermost
+    // dimension, so that a warp loads consecutive addresses. Guard
+    // rather than round up, so that no values outside the footprint
+    // are loaded.
+    vector<Var> args = staged.args();
+    Var xo(args[0].name() + "_so"), xi(args[0].name() + "_si");
+    staged.split(args[0], xo, xi, threads_x, TailStrategy::GuardWithIf);
+    if (args.size() > 1 && threads_y > 1) {
+        Var yo(args[1].name() + "_so"), yi(args[1].name() + "_si");
+        staged.split(args[1], yo, yi, threads_y, TailStrategy::GuardWithIf)
+            .reorder(xi, yi, xo, yo)
+            .gpu_threads(xi, yi);
+    } else {
+        staged.gpu_threads(xi);
+    }
+    return staged;
+}
+
 Func Func::clone_in(const Func &f) {
     invalidate_cache();
     vector<Func> fs = {f};
@@ -1974,12 +2405,106 @@ Func &Func::allow_race_conditions() {
     return *this;
 }
 
+Func &Func::atomic() {
+    invalidate_cache();
+    user_assert(has_update_definition())
+        << "In schedule for " << name()
+        << ", can't make a Func with no update definitions atomic.\n";
+    for (size_t i = 0; i < func.updates().size(); i++) {
+        func.update(i).schedule().atomic() = true;
+    }
+    return *this;
+}
+
 Func &Func::memoize() {
     invalidate_cache();
     func.schedule().memoized() = true;
     return *this;
 }
 
+Func &Func::memoize(MemoizeKey key, Expr version) {
+    user_assert(!version.defined() || (version.type().is_int() || version.type().is_uint()))
+        << "In schedule for " << name()
+        << ", the version tag passed to memoize must be an integer.\n";
+    invalidate_cache();
+    func.schedule().memoized() = true;
+    func.schedule().memoize_key() = key;
+    func.schedule().memoize_version() = version;
+    return *this;
+}
+
+Func &Func::async() {
+    invalidate_cache();
+    func.schedule().async() = true;
+    return *this;
+}
+
+Func &Func::store_nontemporal() {
+    invalidate_cache();
+    func.schedule().nontemporal() = true;
+    return *this;
+}
+
+Func &Func::store_tuple_interleaved() {
+    user_assert(defined() && outputs() > 1)
+        << "Can't interleave the storage of Func " << name()
+        << ", because it is not Tuple-valued.\n";
+    for (const Type &t : output_types()) {
+        user_assert(t == output_types()[0])
+            << "Can't interleave the storage of Func " << name()
+            << ", because the elements of its Tuple have different types.\n";
+    }
+    invalidate_cache();
+    func.schedule().interleave_tuple() = true;
+    return *this;
+}
+
+Func &Func::partition_budget(float budget) {
+    user_assert(budget >= 1.0f)
+        << "The partition budget of Func " << name() << " is " << budget
+        << ", but it must be at least 1.\n";
+    invalidate_cache();
+    func.schedule().partition_budget() = budget;
+    return *this;
+}
+
+Func &Func::distribute(Var x) {
+    const vector<string> &args = func.args();
+    user_assert(std::find(args.begin(), args.end(), x.name()) != args.end())
+        << "Can't distribute Func " << name() << " along " << x.name()
+        << ", because it is not a dimension of the Func.\n";
+    invalidate_cache();
+    func.schedule().distributed_dim() = x.name();
+    return *this;
+}
+
+Func &Func::distribute_gpus(Var x, const std::vector<int> &gpu_devices) {
+    const vector<string> &args = func.args();
+    user_assert(std::find(args.begin(), args.end(), x.name()) != args.end())
+        << "Can't distribute Func " << name() << " across GPUs along " << x.name()
+        << ", because it is not a dimension of the Func.\n";
+    user_assert(!gpu_devices.empty())
+        << "Can't distribute Func " << name() << " across an empty list of GPU devices.\n";
+    invalidate_cache();
+    func.schedule().distributed_gpu_dim() = x.name();
+    func.schedule().distributed_gpu_devices() = gpu_devices;
+    return *this;
+}
+
+Stage Func::co_execute(Var x) {
+    const vector<string> &args = func.args();
+    user_assert(std::find(args.begin(), args.end(), x.name()) != args.end())
+        << "Can't co-execute Func " << name() << " along " << x.name()
+        << ", because it is not a dimension of the Func.\n";
+    user_assert(func.schedule().co_execute_dim().empty())
+        << "Func " << name() << " is already co-executed along "
+        << func.schedule().co_execute_dim() << ".\n";
+    func.schedule().co_execute_dim() = x.name();
+    Parameter on_gpu(Bool(), false, 0, name() + "_on_gpu", true);
+    on_gpu.set_scalar<bool>(false);
+    return specialize(Variable::make(Bool(), on_gpu.name(), on_gpu));
+}
+
 Func &Func::store_in(MemoryType t) {
     invalidate_cache();
     func.schedule().memory_type() = t;
@@ -2038,6 +2563,23 @@ Func &Func::unroll(VarOrRVar var, Expr factor, TailStrategy tail) {
     return *this;
 }
 
+Func &Func::unroll_and_jam(VarOrRVar outer, Expr factor, TailStrategy tail) {
+    invalidate_cache();
+    Stage(func, func.definition(), 0, args()).unroll_and_jam(outer, factor, tail);
+    return *this;
+}
+
+Func &Func::register_tile(Var x, Var y, const Target &t, TailStrategy tail) {
+    invalidate_cache();
+    Stage(func, func.definition(), 0, args()).vectorize(x, register_tile_vector_size(func, t));
+    for (int i = 0; i < num_update_definitions(); i++) {
+        if (!func.update(i).schedule().rvars().empty()) {
+            update(i).register_tile(x, y, t, tail);
+        }
+    }
+    return *this;
+}
+
 Func &Func::bound(Var var, Expr min, Expr extent) {
     user_assert(!min.defined() || Int(32).can_represent(min.type())) << "Can't represent min bound in int32\n";
     user_assert(extent.defined()) << "Extent bound of a Func can't be undefined\n";
@@ -2072,6 +2614,19 @@ Func &Func::estimate(Var var, Expr min, Expr extent) {
 
     Bound b = {var.name(), min, extent, Expr(), Expr()};
     func.schedule().estimates().push_back(b);
+
+    // Propagate the estimate into the output buffers, so that it is
+    // known to anything that only sees the lowered code, such as the
+    // memory report.
+    const vector<string> &args = func.args();
+    for (size_t d = 0; d < args.size(); d++) {
+        if (args[d] == var.name()) {
+            for (Parameter p : func.output_buffers()) {
+                p.set_min_constraint_estimate((int)d, min);
+                p.set_extent_constraint_estimate((int)d, extent);
+            }
+        }
+    }
     return *this;
 }
 
@@ -2301,6 +2856,12 @@ Func &Func::prefetch(const Internal::Parameter &param, VarOrRVar var, Expr offse
     return *this;
 }
 
+Func &Func::skip_unless(Expr condition, VarOrRVar var) {
+    invalidate_cache();
+    Stage(func, func.definition(), 0, args()).skip_unless(condition, var);
+    return *this;
+}
+
 Func &Func::reorder_storage(Var x, Var y) {
     invalidate_cache();
 
@@ -2355,6 +2916,34 @@ Func &Func::align_storage(Var dim, Expr alignment) {
     return *this;
 }
 
+Func &Func::store_tiled(Var x, Var y, int tx, int ty) {
+    user_assert(tx > 0 && ty > 0)
+        << "Tile sizes for the storage of " << name() << " must be positive.\n";
+    invalidate_cache();
+
+    vector<StorageDim> &dims = func.schedule().storage_dims();
+    vector<StorageDim> reordered;
+    for (const Var &v : {x, y}) {
+        bool found = false;
+        for (size_t i = 0; i < dims.size(); i++) {
+            if (var_name_match(dims[i].var, v.name())) {
+                found = true;
+                reordered.push_back(dims[i]);
+                reordered.back().tile_factor = (v.same_as(x) ? tx : ty);
+                dims.erase(dims.begin() + i);
+                break;
+            }
+        }
+        user_assert(found) << "Could not find variable " << v.name()
+                           << " to tile the storage of.\n";
+    }
+    for (StorageDim &d : dims) {
+        d.tile_factor = Expr();
+    }
+    dims.insert(dims.begin(), reordered.begin(), reordered.end());
+    return *this;
+}
+
 Func &Func::fold_storage(Var dim, Expr factor, bool fold_forward) {
     invalidate_cache();
 
@@ -2973,8 +3562,9 @@ void Func::compile_to_c(const string &filename, const vector<Argument> &args,
 void Func::compile_to_lowered_stmt(const string &filename,
                                    const vector<Argument> &args,
                                    StmtOutputFormat fmt,
-                                   const Target &target) {
-    pipeline().compile_to_lowered_stmt(filename, args, fmt, target);
+                                   const Target &target,
+                                   const std::string &profile_json) {
+    pipeline().compile_to_lowered_stmt(filename, args, fmt, target, profile_json);
 }
 
 void Func::print_loop_nest() {
@@ -3001,6 +3591,12 @@ void Func::compile_to_multitarget_static_library(const std::string &filename_pre
     pipeline().compile_to_multitarget_static_library(filename_prefix, args, targets);
 }
 
+void Func::compile_to_multitarget_object(const std::string &filename_prefix,
+                                         const std::vector<Argument> &args,
+                                         const std::vector<Target> &targets) {
+    pipeline().compile_to_multitarget_object(filename_prefix, args, targets);
+}
+
 void Func::compile_to_assembly(const string &filename, const vector<Argument> &args, const string &fn_name,
                                const Target &target) {
     pipeline().compile_to_assembly(filename, args, fn_name, target);
@@ -3033,6 +3629,10 @@ void Func::set_custom_trace(int (*trace_fn)(void *, const halide_trace_event_t *
     pipeline().set_custom_trace(trace_fn);
 }
 
+void Func::set_custom_telemetry(void (*telemetry_fn)(void *, const halide_telemetry_record_t *)) {
+    pipeline().set_custom_telemetry(telemetry_fn);
+}
+
 void Func::set_custom_print(void (*cust_print)(void *, const char *)) {
     pipeline().set_custom_print(cust_print);
 }
@@ -180,6 +180,55 @@ public:
     Func rfactor(RVar r, Var v);
     // @}
 
+    /** Calling parallel_scan() on the first update definition of a Func
+     * that is an associative scan along the RVar 'r' rewrites it into a
+     * parallel block scan. The update must store to r in one argument
+     * and read the value before it, at r - 1, with the other arguments
+     * unchanged; it may also read the value at r itself, which is the
+     * value of the init definition. The associative operator and its
+     * identity are inferred as they are for rfactor(), but the
+     * operator need not be commutative.
+     *
+     * The range of 'r' is cut into blocks of 'block_size' elements,
+     * indexed by the new pure Var 'u'. An intermediate Func, which is
+     * returned, scans each block independently. A second intermediate
+     * scans the totals of the blocks, which is short and serial, and
+     * the update of the original Func then combines the two. That
+     * update no longer depends on its previous values along r, so it
+     * may be split, vectorized and parallelized over r. Both
+     * intermediates are computed at root, and the blocks of the
+     * returned one are scanned in parallel over 'u'.
+     *
+     * For example, f.update(0).parallel_scan(r, u, 64) rewrites a
+     * pipeline like this:
+     \code
+     f(x, y) = g(x, y);
+     f(r, y) = f(r - 1, y) + f(r, y);
+     \endcode
+     * into a pipeline like this, where r runs over [min, min + extent),
+     * ri over [1, 64), and ru over [1, num_blocks):
+     \code
+     f_scan(y, i, u) = select(min + 64*u + i < min + extent, g(min + 64*u + i, y), 0);
+     f_scan(y, ri, u) = f_scan(y, ri - 1, u) + f_scan(y, ri, u);
+
+     f_scan_carry(y, u) = g(min - 1, y);
+     f_scan_carry(y, ru) = f_scan_carry(y, ru - 1) + f_scan(y, 63, ru - 1);
+
+     f(x, y) = g(x, y);
+     f(r, y) = f_scan_carry(y, (r - min) / 64) + f_scan(y, (r - min) % 64, (r - min) / 64);
+     \endcode
+     *
+     * The blocks are vectorized by vectorizing the returned Func
+     * across another of its dimensions, e.g. across y for a summed
+     * area table:
+     \code
+     Func f_scan = f.update(0).parallel_scan(r, u, 64);
+     f_scan.update(0).vectorize(y, 8);
+     f.update(0).split(r, ro, rin, 64).parallel(ro).vectorize(rin, 8);
+     \endcode
+     */
+    Func parallel_scan(RVar r, Var u, Expr block_size);
+
     /** Schedule the iteration over this stage to be fused with another
      * stage 's' from outermost loop to a given LoopLevel. 'this' stage will
      * be computed AFTER 's' in the innermost fused dimension. There should not
@@ -319,6 +368,7 @@ public:
     Stage &parallel(VarOrRVar var, Expr task_size, TailStrategy tail = TailStrategy::Auto);
     Stage &vectorize(VarOrRVar var, Expr factor, TailStrategy tail = TailStrategy::Auto);
     Stage &unroll(VarOrRVar var, Expr factor, TailStrategy tail = TailStrategy::Auto);
+    Stage &unroll_and_jam(VarOrRVar outer, Expr factor, TailStrategy tail = TailStrategy::Auto);
     Stage &tile(VarOrRVar x, VarOrRVar y,
                 VarOrRVar xo, VarOrRVar yo,
                 VarOrRVar xi, VarOrRVar yi, Expr
@@ -328,6 +378,8 @@ public:
                 VarOrRVar xi, VarOrRVar yi,
                 Expr xfactor, Expr yfactor,
                 TailStrategy tail = TailStrategy::Auto);
+    Stage &register_tile(Var x, Var y, const Target &t = get_target_from_environment(),
+                         TailStrategy tail = TailStrategy::Auto);
     Stage &reorder(const std::vector<VarOrRVar> &vars);
 
     template <typename... Args>
@@ -395,6 +447,29 @@ public:
 
     Stage &allow_race_conditions();
 
+    /** Compute this update definition using atomic read-modify-write
+     * operations on the Func being updated, which permits
+     * parallelizing over its RVars without a race condition. The
+     * update must be an associative and commutative operator of the
+     * Func's current value at the site being updated, e.g. a
+     * histogram:
+     *
+     \code
+     Func hist;
+     RDom r(0, input.width(), 0, input.height());
+     hist(x) = 0;
+     hist(input(r.x, r.y)) += 1;
+     hist.update().atomic().parallel(r.y);
+     \endcode
+     *
+     * Integer updates that are a simple add, subtract, min, max, or
+     * bitwise op map to a single atomic instruction (atomicAdd and
+     * friends on the GPU). Anything else is computed with a
+     * compare-and-swap loop. Tuple-valued updates are not supported,
+     * and an atomic update may not be vectorized. Call this before
+     * parallelizing over an RVar. */
+    Stage &atomic();
+
     Stage &hexagon(VarOrRVar x = Var::outermost());
     Stage &prefetch(const Func &f, VarOrRVar var, Expr offset = 1,
                            PrefetchBoundStrategy strategy = PrefetchBoundStrategy::GuardWithIf);
@@ -407,6 +482,10 @@ public:
     }
     // @}
 
+    /** Skip the iterations of the loop over var for which condition is
+     * false. See \ref Func::skip_unless */
+    Stage &skip_unless(Expr condition, VarOrRVar var);
+
     /** Attempt to get the source file and line where this stage was
      * defined by parsing the process's own debug symbols. Returns an
      * empty string if no debug symbols were found or the debug
@@ -855,11 +934,15 @@ public:
 
     /** Write out an internal representation of lowered code. Useful
      * for analyzing and debugging scheduling. Can emit html or plain
-     * text. */
+     * text. When emitting html, profile_json may name a JSON profiler
+     * report (see HL_PROFILER_JSON_FILE) from an earlier run of this
+     * pipeline, and the time measured for each Func is shown on its
+     * produce node. */
     void compile_to_lowered_stmt(const std::string &filename,
                                  const std::vector<Argument> &args,
                                  StmtOutputFormat fmt = Text,
-                                 const Target &target = get_target_from_environment());
+                                 const Target &target = get_target_from_environment(),
+                                 const std::string &profile_json = "");
 
     /** Write out the loop nests specified by the schedule for this
      * Function. Helpful for understanding what a schedule is
@@ -893,6 +976,14 @@ public:
                                                const std::vector<Argument> &args,
                                                const std::vector<Target> &targets);
 
+    /** Like compile_to_multitarget_static_library, but produces a
+     * single object file and header pair. The object contains the
+     * code for every target, the feature-detecting dispatcher, and
+     * (unless the targets have no_runtime) the runtime. */
+    void compile_to_multitarget_object(const std::string &filename_prefix,
+                                       const std::vector<Argument> &args,
+                                       const std::vector<Target> &targets);
+
     /** Store an internal representation of lowered code as a self
      * contained Module suitable for further compilation. */
     Module compile_to_module(const std::vector<Argument> &args, const std::string &fn_name = "",
@@ -1003,6 +1094,16 @@ public:
      * and they will clobber Halide's versions. */
     void set_custom_trace(int (*trace_fn)(void *, const halide_trace_event_t *));
 
+    /** Set the function called at the end of each call of the
+     * pipeline of this Func when it was compiled with the
+     * LatencyTelemetry target feature, with timestamps of the call and of each
+     * of its compute_root stages. Call this on the output Func of your
+     * pipeline. See halide_telemetry_record_t in HalideRuntime.h.
+     *
+     * If you are statically compiling, call
+     * halide_set_custom_telemetry instead. */
+    void set_custom_telemetry(void (*telemetry_fn)(void *, const halide_telemetry_record_t *));
+
     /** Set the function called to print messages from the runtime.
      * If you are compiling statically, you can also just define your
      * own function with signature
@@ -1060,7 +1161,12 @@ public:
      * 5, uint32_t = 6, int32_t = 7, uint64_t = 8, int64_t = 9. The
      * data follows the header, as a densely packed array of the given
      * size and the given type. If given the extension .tmp, this file
-     * format can be natively read by the program ImageStack. */
+     * format can be natively read by the program ImageStack.
+     *
+     * Files are written synchronously inside the pipeline unless the
+     * environment variable HL_DEBUG_TO_FILE_ASYNC=1 is set, in which
+     * case the data is copied and written by a background thread; see
+     * halide_debug_to_file_flush. */
     void debug_to_file(const std::string &filename);
 
     /** The name of this function, either given during construction,
@@ -1206,6 +1312,21 @@ public:
                        bool uses_old_buffer_t = false);
     // @}
 
+    /** Declare statically which values of its input Funcs an extern
+     * stage reads. Each Expr calls an input Func at the coordinates the
+     * extern reads when computing the output site given by the Vars
+     * passed to define_extern (or the implicit Vars _0, _1, ... for the
+     * overloads that take a dimension count). For example, a 3x1 box
+     * filter of a Func g declares {g(x - 1, y), g(x + 1, y)}. Bounds
+     * inference then uses these in place of calling the extern in
+     * bounds-query mode, which saves a call each time it runs when the
+     * extern is computed inside a tile loop. The extern is always asked
+     * to produce exactly the region its consumers need, so it must not
+     * rely on a bounds query to round its output up. Only Func inputs
+     * can be read; ImageParam and Buffer inputs still need a bounds
+     * query. */
+    Func &extern_footprint(const std::vector<Expr> &reads);
+
     /** Get the types of the outputs of this Func. */
     const std::vector<Type> &output_types() const;
 
@@ -1356,6 +1477,25 @@ public:
      */
     Func in();
 
+    /** Stage the footprint of each GPU block of 'consumer' in this
+     * Func in shared memory. Creates a wrapper with in(consumer),
+     * computes it at the consumer's block loop 'block' in
+     * MemoryType::GPUShared, and loads it cooperatively with a
+     * threads_x by threads_y block of threads, which should match the
+     * consumer's block size. The threads are assigned to the
+     * innermost dimensions of the wrapper, so that adjacent threads
+     * load adjacent values and the loads coalesce. The footprint is
+     * found by bounds inference, and the thread loops are fused with
+     * those of the consumer. For example:
+     \code
+     blur(x, y) = (input(x - 1, y) + input(x, y) + input(x + 1, y)) / 3;
+     blur.gpu_tile(x, y, bx, by, tx, ty, 16, 16);
+     input.stage_in_gpu_shared(blur, bx, 16, 16);
+     \endcode
+     * Returns the wrapper, which may be scheduled further. */
+    Func stage_in_gpu_shared(const Func &consumer, const VarOrRVar &block,
+                             int threads_x, int threads_y = 1);
+
     /** Similar to \ref Func::in; however, instead of replacing the call to
      * this Func with an identity Func that refers to it, this replaces the
      * call with a clone of this Func.
@@ -1459,6 +1599,27 @@ public:
      * dimension of the split. 'factor' must be an integer. */
     Func &unroll(VarOrRVar var, Expr factor, TailStrategy tail = TailStrategy::Auto);
 
+    /** Split a dimension by the given factor, unroll the inner
+     * dimension, and move it inside all of the loops nested within
+     * the dimension (but outside any vectorized innermost loops). This
+     * interleaves several iterations of an outer loop in the
+     * innermost loop body. For example, to compute four rows of a
+     * matrix multiply at once, each with its own accumulator:
+     *
+     \code
+     Func c;
+     RDom k(0, 512);
+     c(x, y) = 0.0f;
+     c(x, y) += a(k, y) * b(x, k);
+     c.update().reorder(x, k, y).vectorize(x, 8).unroll_and_jam(y, 4);
+     \endcode
+     *
+     * An RVar can only be jammed inside pure vars, because reordering
+     * it with another RVar may change the meaning of the
+     * algorithm. After this call, outer refers to the outer dimension
+     * of the split. 'factor' must be an integer. */
+    Func &unroll_and_jam(VarOrRVar outer, Expr factor, TailStrategy tail = TailStrategy::Auto);
+
     /** Statically declare that the range over which a function should
      * be evaluated is given by the second and third arguments. This
      * can let Halide perform some optimizations. E.g. if you know
@@ -1511,6 +1672,19 @@ public:
                Expr xfactor, Expr yfactor,
                TailStrategy tail = TailStrategy::Auto);
 
+    /** Block a small dense reduction (such as a matrix multiply) into
+     * registers. The pure definition is vectorized across x. Each update
+     * definition that has reduction variables gets a block of x and y
+     * sized from the target's natural vector width and vector register
+     * count, so that the accumulators stay in registers across the
+     * reduction: the block is split into vectors along x, which are
+     * vectorized, and the vectors and rows of the block are unrolled
+     * inside the reduction loops. The tail strategy applies to the
+     * splits of the update definitions. Use Stage::register_tile to
+     * block a single update definition. */
+    Func &register_tile(Var x, Var y, const Target &t = get_target_from_environment(),
+                        TailStrategy tail = TailStrategy::Auto);
+
     /** Reorder variables to have the given nesting order, from
      * innermost out */
     Func &reorder(const std::vector<VarOrRVar> &vars);
@@ -1533,6 +1707,10 @@ public:
      * different values at different times or on different machines. */
     Func &allow_race_conditions();
 
+    /** Compute all update definitions of this Func using atomic
+     * read-modify-write operations. See \ref Stage::atomic */
+    Func &atomic();
+
 
     /** Specialize a Func. This creates a special-case version of the
      * Func where the given condition is true. The most effective
@@ -1884,6 +2062,33 @@ public:
     }
     // @}
 
+    /** Skip the iterations of the loop over var for which condition is
+     * false, along with everything computed inside them, including
+     * any Funcs computed at or inside that loop level. The condition
+     * is written in terms of the pure Vars of this Func, and is
+     * evaluated at the first point of each iteration of var. It is
+     * meant to be a cheap lookup into a precomputed activity mask with
+     * one entry per tile, which lets sparse workloads skip the tiles
+     * they do not need:
+     *
+     \code
+     Func mask, f, g;
+     Var x, y, xo, yo, xi, yi;
+     mask(x, y) = ...;  // Whether the 16x16 tile at (x, y) is active
+     g(x, y) = f(x - 1, y) + f(x + 1, y);
+     g.tile(x, y, xo, yo, xi, yi, 16, 16, TailStrategy::GuardWithIf)
+      .skip_unless(mask(x / 16, y / 16), xo);
+     mask.compute_root();
+     f.compute_at(g, xo);
+     \endcode
+     *
+     * The values of the Func in skipped iterations are not written. The
+     * condition should be the same for every point of an iteration of
+     * var; a tail strategy that keeps the tiles aligned with the mask,
+     * such as GuardWithIf or RoundUp, keeps it so. var may not be
+     * vectorized. */
+    Func &skip_unless(Expr condition, VarOrRVar var);
+
     /** Specify how the storage for the function is laid out. These
      * calls let you specify the nesting order of the dimensions. For
      * example, foo.reorder_storage(y, x) tells Halide to use
@@ -1922,6 +2127,20 @@ public:
      * aligned to multiples of 16, use foo.align_storage(x, 16). */
     Func &align_storage(Var dim, Expr alignment);
 
+    /** Store realizations of this function in tiles of size tx by ty
+     * over the dimensions x and y. Each tile is contiguous in memory and
+     * stored with x innermost, and the tiles are stored with x
+     * innermost. x and y become the two innermost storage dimensions,
+     * and the storage extents of both are padded up to a multiple of
+     * the tile size. This suits consumers that access the function
+     * along y as much as along x, such as transposes and warps, which
+     * otherwise touch a new cache line and page for each row. Tiles are
+     * aligned to the min of the realization. This has no effect on
+     * outputs of the pipeline, or on memoized Funcs, Funcs with
+     * debug_to_file, and Funcs consumed by extern stages, which all need
+     * a strided layout. */
+    Func &store_tiled(Var x, Var y, int tx, int ty);
+
     /** Store realizations of this function in a circular buffer of a
      * given extent. This is more efficient when the extent of the
      * circular buffer is a power of 2. If the fold factor is too
@@ -1951,6 +2170,13 @@ public:
      * Then g will be computed at each row of f and stored in a buffer
      * with an extent in y of 2, alternately storing each computed row
      * of g in row y=0 or y=1.
+     *
+     * The extent need not be a power of two. If the footprint of each
+     * iteration can be statically proven to fit in the fold, the
+     * folded coordinate is found from a rotating base computed once
+     * per iteration instead of a modulo on each access, so an exact
+     * fold (e.g. 5 rows for a 5-tap stencil) costs no more than a
+     * power-of-two one.
      */
     Func &fold_storage(Var dim, Expr extent, bool fold_forward = true);
 
@@ -2086,6 +2312,118 @@ public:
      */
     Func &memoize();
 
+    /** Memoize this Func, choosing how its input buffers go into the
+     * cache key. With MemoizeKey::ContentHash, the contents of each
+     * input buffer the Func depends on are hashed every time it is
+     * realized, so that results are reused for equal data in any
+     * buffer, and not reused for changed data in the same buffer. The
+     * whole buffer is hashed, not just the region the Func reads.
+     *
+     * Hashing large inputs on every realization can be costly. If the
+     * caller keeps a version tag that changes whenever the input data
+     * does (e.g. a frame counter passed as a Param), pass it as
+     * version: a buffer whose host pointer, shape and version are the
+     * same as at the last hash is not hashed again. A version of zero
+     * always hashes.
+     */
+    Func &memoize(MemoizeKey key, Expr version = Expr());
+
+    /** Produce this Func on another thread from the one that consumes it,
+     * so that the two run concurrently. Each time the consumer reaches the
+     * loop level this Func is computed at, it waits until the producer
+     * thread has computed the values it needs, while the producer thread
+     * goes on to compute the values for later iterations. This overlaps
+     * serial stages of a pipeline such as a scanline pipeline. The loops
+     * between the store and compute levels must be serial, the Func must
+     * not use values computed at the same level by its consumer, and its
+     * storage is not folded, since the producer may run any number of
+     * iterations ahead. Only applies to Funcs computed on the host. */
+    Func &async();
+
+    /** Store the values of this Func with non-temporal stores, which
+     * write around the cache instead of through it. Use this for large
+     * outputs that are written once and not read again by the pipeline,
+     * so that writing them doesn't evict data that later stages need.
+     * Dense vector stores that are aligned to their size become
+     * non-temporal (movntps and friends on x86, stnp on ARM), and the
+     * producer ends with a store fence. For an output of the pipeline,
+     * the alignment assumed is that of its Parameter (see
+     * OutputImageParam::set_host_alignment). The Func must not have update
+     * definitions. This has no effect if the Func is inlined. */
+    Func &store_nontemporal();
+
+    /** Store the elements of a Tuple-valued Func interleaved in a single
+     * allocation (an array of structs), instead of in one allocation per
+     * element. This suits Funcs such as complex numbers or RGBA
+     * accumulators, whose consumers use all of the elements together. A
+     * vectorized store of all the elements becomes a single dense store of
+     * the interleaved vectors, and loads of the elements become dense
+     * loads and shuffles. All elements of the Tuple must have the same
+     * type. This has no effect on outputs of the pipeline, Funcs that are
+     * inlined, memoized or traced with debug_to_file, or Funcs consumed by
+     * extern stages, which all need one buffer per element. */
+    Func &store_tuple_interleaved();
+
+    /** Limit how much partitioning the loops of this Func into a
+     * prologue, steady state and epilogue (see Func::bound and
+     * BoundaryConditions) may grow its code, as a multiple of its size
+     * before partitioning, e.g. 1.5. Outer loops are then only
+     * partitioned if that simplifies their inner loops, and loops
+     * that would go over the budget are left whole. With
+     * HL_DEBUG_CODEGEN=1, lowering reports which loops were
+     * partitioned and what fraction of each runs in the steady
+     * state. By default there is no limit. */
+    Func &partition_budget(float budget);
+
+    /** Partition this output Func along the given dimension across the
+     * ranks of a distributed realization. See
+     * Pipeline::realize_distributed, which gives each rank an equal
+     * slice of the output along this dimension. Each rank computes its
+     * slice, and gets the inputs the slice needs, including the halos
+     * held by other ranks, by bounds inference. Without this,
+     * realize_distributed partitions the outermost dimension. */
+    Func &distribute(Var x);
+
+    /** Split realizations of this output Func along the given
+     * dimension across several GPU devices of this process, such as
+     * the indices of the GPUs on a node. A device may be listed more
+     * than once. When the Pipeline is realized with JIT for a GPU
+     * target, the output is split into an equal slice per entry of
+     * gpu_devices, and the slices are computed concurrently, each on
+     * its device (see halide_set_gpu_device_for_user_context). So x
+     * should be, or enclose, the loop marked gpu_blocks. Bounds
+     * inference finds the region of each input each slice needs, halo
+     * included, and only that region goes to the slice's device: from
+     * the host, or peer to peer from the device it's on. The outputs
+     * must have host memory, and end up there. Other targets compute
+     * the whole output as usual. This is independent of distribute,
+     * which partitions across the ranks of realize_distributed. */
+    Func &distribute_gpus(Var x, const std::vector<int> &gpu_devices);
+
+    /** Split realizations of this output Func along the given
+     * dimension between a GPU and the host's cores, computing both
+     * parts at once. Returns a specialization of the Func for the part
+     * on the GPU, which takes its GPU schedule, while the schedule of
+     * the Func itself is for the part on the host, e.g.:
+     *
+     \code
+     f.parallel(y).vectorize(x, 8);
+     f.co_execute(y).gpu_tile(x, y, xi, yi, 16, 16);
+     \endcode
+     *
+     * When the Pipeline is realized for a GPU target, the GPU gets a
+     * share of the rows of x starting at its min, and the host the
+     * rest. Both share the pipeline's compiled code, and each part
+     * gets just the region of the inputs it needs, as with distribute.
+     * The share starts at one half, and after each realization moves
+     * toward the ratio of the rates at which the two parts were
+     * computed, so that both finish at about the same time. The
+     * outputs must have host memory, and end up there. Other targets,
+     * and pipelines compiled ahead of time, compute everything on the
+     * host unless the bool argument that selects the specialization,
+     * named after the Func with the suffix "_on_gpu", is set. */
+    Stage co_execute(Var x);
+
 
     /** Allocate storage for this function within f's loop over
      * var. Scheduling storage is optional, and can be used to
@@ -0,0 +1,203 @@
+#include "FuseGPUStages.h"
+#include "Debug.h"
+#include "FindCalls.h"
+#include "Func.h"
+#include "IREquality.h"
+#include "IRVisitor.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Count the calls to a Func, and check whether they are all at the
+// given pure variables of the caller.
+class FindPointwiseCalls : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Call *op) override {
+        if (op->call_type == Call::Halide && op->name == func) {
+            count++;
+            if (op->args.size() != args.size()) {
+                pointwise = false;
+            } else {
+                for (size_t i = 0; i < args.size(); i++) {
+                    const Variable *v = op->args[i].as<Variable>();
+                    if (!v || v->name != args[i]) {
+                        pointwise = false;
+                    }
+                }
+            }
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    const string &func;
+    const vector<string> &args;
+    int count = 0;
+    bool pointwise = true;
+
+    FindPointwiseCalls(const string &func, const vector<string> &args)
+        : func(func), args(args) {}
+};
+
+bool same_splits(const vector<Split> &a, const vector<Split> &b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].old_var != b[i].old_var ||
+            a[i].outer != b[i].outer ||
+            a[i].inner != b[i].inner ||
+            a[i].split_type != b[i].split_type ||
+            a[i].tail != b[i].tail ||
+            a[i].exact != b[i].exact ||
+            !equal(a[i].factor, b[i].factor)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool same_dims(const vector<Dim> &a, const vector<Dim> &b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].var != b[i].var ||
+            a[i].for_type != b[i].for_type ||
+            a[i].device_api != b[i].device_api ||
+            a[i].dim_type != b[i].dim_type) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The innermost GPU thread loop of the pure definition of f, or "" if it
+// doesn't have one.
+string innermost_gpu_thread_var(const Function &f) {
+    for (const Dim &d : f.definition().schedule().dims()) {
+        if (d.for_type == ForType::GPUThread) {
+            return d.var;
+        }
+    }
+    return "";
+}
+
+// Whether f is a compute_root GPU stage whose schedule and storage we're
+// free to change.
+bool is_fusable_producer(const Function &f) {
+    const FuncSchedule &s = f.schedule();
+    return (f.is_pure() &&
+            f.definition().specializations().empty() &&
+            !innermost_gpu_thread_var(f).empty() &&
+            s.compute_level().is_root() &&
+            s.store_level().is_root() &&
+            f.definition().schedule().fuse_level().level.is_inlined() &&
+            f.definition().schedule().fused_pairs().empty() &&
+            s.bounds().empty() &&
+            s.memory_type() == MemoryType::Auto &&
+            !s.memoized() &&
+            !s.async() &&
+            f.debug_file().empty() &&
+            !f.is_tracing_loads() &&
+            !f.is_tracing_stores() &&
+            !f.is_tracing_realizations());
+}
+
+}  // namespace
+
+void fuse_gpu_stages(const vector<Function> &outputs, map<string, Function> &env) {
+    // Who calls each Func.
+    map<string, vector<string>> callers;
+    for (const auto &iter : env) {
+        for (const auto &callee : find_direct_calls(iter.second)) {
+            callers[callee.first].push_back(iter.first);
+        }
+        for (const ExternFuncArgument &arg : iter.second.extern_arguments()) {
+            if (arg.is_func()) {
+                // Never fuse a Func into an extern stage.
+                callers[Function(arg.func).name()].push_back(iter.first);
+            }
+        }
+    }
+
+    // Find the consumer each fusable Func can be merged into.
+    map<string, string> fused_into;
+    for (const auto &iter : env) {
+        const Function &f = iter.second;
+        bool is_output = false;
+        for (const Function &o : outputs) {
+            is_output |= o.same_as(f);
+        }
+        if (is_output || !is_fusable_producer(f)) {
+            continue;
+        }
+
+        const vector<string> &c = callers[f.name()];
+        if (c.size() != 1 || c[0] == f.name()) {
+            continue;
+        }
+        const Function &g = env.at(c[0]);
+        if (g.has_extern_definition() ||
+            g.args() != f.args() ||
+            !same_splits(f.definition().schedule().splits(), g.definition().schedule().splits()) ||
+            !same_dims(f.definition().schedule().dims(), g.definition().schedule().dims())) {
+            continue;
+        }
+
+        // Every call must be in the pure definition of the consumer, at
+        // its own pure vars, so each GPU thread reads only the values it
+        // produced itself.
+        FindPointwiseCalls in_pure(f.name(), g.args());
+        g.definition().accept(&in_pure);
+        FindPointwiseCalls anywhere(f.name(), g.args());
+        g.accept(&anywhere);
+        if (!in_pure.pointwise || in_pure.count != anywhere.count) {
+            continue;
+        }
+
+        fused_into[f.name()] = g.name();
+    }
+
+    for (const auto &iter : fused_into) {
+        // Follow chains of fused stages to the one that still launches
+        // the kernel. Each Func has one consumer, so this terminates.
+        string consumer = iter.second;
+        while (fused_into.count(consumer)) {
+            consumer = fused_into[consumer];
+        }
+        const Function &g = env.at(consumer);
+        string var = innermost_gpu_thread_var(g);
+
+        debug(2) << "Fusing GPU stage " << iter.first << " into "
+                 << consumer << " at " << var << "\n";
+
+        Function &f = env.at(iter.first);
+        LoopLevel level = LoopLevel(g, Var(var), 0).lock();
+        f.schedule().compute_level() = level;
+        f.schedule().store_level() = level;
+
+        // The Func now covers only the points of one thread, so drop its
+        // own loop structure.
+        StageSchedule &s = f.definition().schedule();
+        s.splits().clear();
+        s.prefetches().clear();
+        s.dims().clear();
+        for (const string &arg : f.args()) {
+            Dim d = {arg, ForType::Serial, DeviceAPI::None, Dim::Type::PureVar};
+            s.dims().push_back(d);
+        }
+        Dim d = {Var::outermost().name(), ForType::Serial, DeviceAPI::None, Dim::Type::PureVar};
+        s.dims().push_back(d);
+    }
+}
+
+}  // namespace Internal
+}  // namespace Halide
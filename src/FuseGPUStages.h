@@ -0,0 +1,32 @@
+#ifndef HALIDE_FUSE_GPU_STAGES_H
+#define HALIDE_FUSE_GPU_STAGES_H
+
+/** \file
+ * Defines a schedule rewrite that merges consecutive pointwise GPU stages
+ * into a single kernel.
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Function.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Find Funcs that are computed at root on the GPU, have a single
+ * consumer which calls them only at its own pure variables, and are
+ * scheduled over exactly the same GPU blocks and threads as that consumer.
+ * Reschedule each of them to be computed at the innermost GPU thread loop
+ * of the consumer (or of the Func the consumer was itself merged into),
+ * so the two stages become one kernel launch and the intermediate lives
+ * in registers instead of global memory. Called before the realization
+ * order is computed; enabled by the FuseGPUStages target feature. */
+void fuse_gpu_stages(const std::vector<Function> &outputs,
+                     std::map<std::string, Function> &env);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
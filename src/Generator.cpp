@@ -1,9 +1,15 @@
+#include <atomic>
 #include <cmath>
 #include <fstream>
+#include <mutex>
 #include <set>
+#include <sstream>
+#include <thread>
 
+#include "BatchEntryPoint.h"
 #include "Generator.h"
 #include "Outputs.h"
+#include "ScheduleFile.h"
 #include "Simplify.h"
 
 namespace Halide {
@@ -95,6 +101,9 @@ Outputs compute_outputs(const Target &target,
         // and passed to LLVM.
         output_files.bitcode_name = base_path + get_extension(".bc", options);
     }
+    if (options.emit_thinlto_bitcode) {
+        output_files.thinlto_bitcode_name = base_path + get_extension(".thinlto.bc", options);
+    }
     if (options.emit_h) {
         output_files.c_header_name = base_path + get_extension(".h", options);
     }
@@ -117,6 +126,12 @@ Outputs compute_outputs(const Target &target,
     if (options.emit_schedule) {
         output_files.schedule_name = base_path + get_extension(".schedule", options);
     }
+    if (options.emit_memory_report) {
+        output_files.memory_report_name = base_path + get_extension(".memory_report", options);
+    }
+    if (options.emit_python_extension) {
+        output_files.python_extension_name = base_path + get_extension(".py.c", options);
+    }
     return output_files;
 }
 
@@ -219,6 +234,7 @@ std::vector<Expr> parameter_constraints(const Parameter &p) {
             values.push_back(p.min_constraint(i));
             values.push_back(p.extent_constraint(i));
             values.push_back(p.stride_constraint(i));
+            values.push_back(Expr(p.stride_multiple(i)));
         }
     } else {
         values.push_back(p.min_value());
@@ -270,7 +286,8 @@ private:
             // These are always propagated specially.
             if (p->name == "target" ||
                 p->name == "auto_schedule" ||
-                p->name == "machine_params") continue;
+                p->name == "machine_params" ||
+                p->name == "batch_entry_point") continue;
             if (p->is_synthetic_param()) continue;
             out.push_back(p);
         }
@@ -767,13 +784,122 @@ std::string halide_type_to_c_type(const Type &t) {
     return m.at(encode(t));
 }
 
+namespace {
+
+// Run generate_filter_main once for each line of a manifest file, using
+// up to 'jobs' threads. Each line holds the arguments for one
+// invocation, separated by whitespace; blank lines and lines starting
+// with '#' are ignored. The output of each invocation is reported in
+// one piece once it finishes, so that the output of concurrent
+// invocations doesn't interleave.
+int generate_filters_from_manifest(const std::string &argv0, const std::string &manifest,
+                                   int jobs, std::ostream &cerr) {
+    std::ifstream file(manifest);
+    if (!file) {
+        cerr << "Unable to open manifest " << manifest << "\n";
+        return 1;
+    }
+
+    std::vector<std::vector<std::string>> invocations;
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream words(line);
+        std::vector<std::string> args = {argv0};
+        std::string word;
+        while (words >> word) {
+            args.push_back(word);
+        }
+        if (args.size() > 1 && args[1][0] != '#') {
+            invocations.push_back(args);
+        }
+    }
+
+    if (jobs <= 0) {
+        jobs = std::max(1, (int)std::thread::hardware_concurrency());
+    }
+    jobs = std::min(jobs, (int)invocations.size());
+
+    std::atomic<size_t> next{0};
+    std::atomic<int> failures{0};
+    std::mutex output_mutex;
+    auto worker = [&]() {
+        for (size_t i = next++; i < invocations.size(); i = next++) {
+            std::vector<char *> argv;
+            for (std::string &s : invocations[i]) {
+                argv.push_back(&s[0]);
+            }
+            argv.push_back(nullptr);
+
+            std::ostringstream out;
+            int result = 1;
+#ifdef WITH_EXCEPTIONS
+            try {
+                result = generate_filter_main((int)argv.size() - 1, argv.data(), out);
+            } catch (const Halide::Error &e) {
+                out << e.what() << "\n";
+            }
+#else
+            result = generate_filter_main((int)argv.size() - 1, argv.data(), out);
+#endif
+            if (result != 0) {
+                failures++;
+            }
+            std::string message = out.str();
+            if (!message.empty() || result != 0) {
+                std::lock_guard<std::mutex> lock(output_mutex);
+                cerr << message;
+                if (result != 0) {
+                    cerr << "Manifest entry " << (i + 1) << " failed\n";
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < jobs; i++) {
+        threads.emplace_back(worker);
+    }
+    for (std::thread &t : threads) {
+        t.join();
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+}  // namespace
+
 int generate_filter_main(int argc, char **argv, std::ostream &cerr) {
-    const char kUsage[] = "gengen [-g GENERATOR_NAME] [-f FUNCTION_NAME] [-o OUTPUT_DIR] [-r RUNTIME_NAME] [-e EMIT_OPTIONS] [-x EXTENSION_OPTIONS] [-n FILE_BASE_NAME] "
-                          "target=target-string[,target-string...] [generator_arg=value [...]]\n\n"
+    const char kUsage[] = "gengen [-g GENERATOR_NAME] [-f FUNCTION_NAME] [-o OUTPUT_DIR] [-r RUNTIME_NAME] [-e EMIT_OPTIONS] [-x EXTENSION_OPTIONS] [-n FILE_BASE_NAME] [-s SCHEDULE_FILE] [-c CONNECTIONS] "
+                          "target=target-string[,target-string...] [generator_arg=value [...]]\n"
+                          "gengen -m MANIFEST [-j JOBS]\n\n"
                           "  -e  A comma separated list of files to emit. Accepted values are "
-                          "[assembly, bitcode, cpp, h, html, o, static_library, stmt, cpp_stub, schedule]. If omitted, default value is [static_library, h].\n"
+                          "[assembly, bitcode, thinlto_bitcode, cpp, h, html, o, static_library, stmt, cpp_stub, schedule, memory_report, python_extension]. If omitted, default value is [static_library, h].\n"
+                          "      thinlto_bitcode is LLVM bitcode for link-time optimization with clang -flto=thin. "
+                          "python_extension is the C source of a Python extension module that calls the pipeline, "
+                          "to be compiled against Python.h and linked with the static library. "
+                          "To share one runtime between many Generators, build them for targets with no_runtime, "
+                          "and emit the runtime once with -r.\n"
                           "  -x  A comma separated list of file extension pairs to substitute during file naming, "
-                          "in the form [.old=.new[,.old2=.new2]]\n";
+                          "in the form [.old=.new[,.old2=.new2]]\n"
+                          "  -s  A file with a schedule to apply to the pipeline after the Generator's schedule(), "
+                          "so that schedules can be changed without recompiling the Generator.\n"
+                          "  -c  When -g is a comma separated list of Generators, they are composed into one pipeline. "
+                          "This is a comma separated list of the connections between them, in the form "
+                          "[generator.input=generator.output[,...]]. Generator args of the form "
+                          "generator.param=value apply only to that Generator.\n"
+                          "  -m  A file with the arguments for one invocation of gengen per line. The invocations are run "
+                          "in parallel in this process, sharing its initialization of LLVM.\n"
+                          "  -j  The maximum number of manifest entries to build at once. Defaults to the number of cores.\n";
+
+    if (argc >= 3 && std::string(argv[1]) == "-m") {
+        int jobs = 0;
+        if (argc == 5 && std::string(argv[3]) == "-j") {
+            jobs = std::atoi(argv[4]);
+        } else if (argc != 3) {
+            cerr << kUsage;
+            return 1;
+        }
+        return generate_filters_from_manifest(argv[0], argv[2], jobs, cerr);
+    }
 
     std::map<std::string, std::string> flags_info = { { "-f", "" },
                                                       { "-g", "" },
@@ -781,7 +907,9 @@ int generate_filter_main(int argc, char **argv, std::ostream &cerr) {
                                                       { "-e", "" },
                                                       { "-n", "" },
                                                       { "-x", "" },
-                                                      { "-r", "" }};
+                                                      { "-r", "" },
+                                                      { "-s", "" },
+                                                      { "-c", "" }};
     GeneratorParamsMap generator_args;
 
     for (int i = 1; i < argc; ++i) {
@@ -832,7 +960,27 @@ int generate_filter_main(int argc, char **argv, std::ostream &cerr) {
         }
         return 1;
     }
+    const std::vector<std::string> composed_names = split_string(generator_name, ",");
+    const bool composed = composed_names.size() > 1;
+    std::map<std::string, std::string> connections;
+    for (const std::string &c : split_string(flags_info["-c"], ",")) {
+        if (c.empty()) {
+            continue;
+        }
+        auto connection = split_string(c, "=");
+        if (connection.size() != 2 || !composed) {
+            cerr << "Malformed -c option: " << c << "\n";
+            cerr << kUsage;
+            return 1;
+        }
+        connections[connection[0]] = connection[1];
+    }
     std::string function_name = flags_info["-f"];
+    if (composed && function_name.empty()) {
+        cerr << "-f must be specified when composing Generators.\n";
+        cerr << kUsage;
+        return 1;
+    }
     if (function_name.empty()) {
         // If -f isn't specified, assume function name = generator name.
         function_name = generator_name;
@@ -872,6 +1020,8 @@ int generate_filter_main(int argc, char **argv, std::ostream &cerr) {
                 emit_options.emit_assembly = true;
             } else if (opt == "bitcode") {
                 emit_options.emit_bitcode = true;
+            } else if (opt == "thinlto_bitcode") {
+                emit_options.emit_thinlto_bitcode = true;
             } else if (opt == "stmt") {
                 emit_options.emit_stmt = true;
             } else if (opt == "html") {
@@ -888,9 +1038,13 @@ int generate_filter_main(int argc, char **argv, std::ostream &cerr) {
                 emit_options.emit_cpp_stub = true;
             } else if (opt == "schedule") {
                 emit_options.emit_schedule = true;
+            } else if (opt == "memory_report") {
+                emit_options.emit_memory_report = true;
+            } else if (opt == "python_extension") {
+                emit_options.emit_python_extension = true;
             } else if (!opt.empty()) {
                 cerr << "Unrecognized emit option: " << opt
-                     << " not one of [assembly, bitcode, cpp, h, html, o, static_library, stmt, cpp_stub], ignoring.\n";
+                     << " not one of [assembly, bitcode, thinlto_bitcode, cpp, h, html, o, static_library, stmt, cpp_stub, schedule, memory_report, python_extension], ignoring.\n";
             }
         }
     }
@@ -928,6 +1082,10 @@ int generate_filter_main(int argc, char **argv, std::ostream &cerr) {
     if (!generator_name.empty()) {
         std::string base_path = compute_base_path(output_dir, function_name, file_base_name);
         debug(1) << "Generator " << generator_name << " has base_path " << base_path << "\n";
+        if (emit_options.emit_cpp_stub && composed) {
+            cerr << "cpp_stub can't be emitted for composed Generators.\n";
+            return 1;
+        }
         if (emit_options.emit_cpp_stub) {
             // When generating cpp_stub, we ignore all generator args passed in, and supply a fake Target.
             auto gen = GeneratorRegistry::create(generator_name, GeneratorContext(Target()));
@@ -938,13 +1096,38 @@ int generate_filter_main(int argc, char **argv, std::ostream &cerr) {
         // Don't bother with this if we're just emitting a cpp_stub.
         if (!stub_only) {
             Outputs output_files = compute_outputs(targets[0], base_path, emit_options);
-            auto module_producer = [&generator_name, &generator_args]
+            std::string schedule_file = flags_info["-s"];
+            auto module_producer = [&generator_name, &generator_args, &schedule_file,
+                                    composed, &composed_names, &connections]
                 (const std::string &name, const Target &target) -> Module {
                     auto sub_generator_args = generator_args;
                     sub_generator_args.erase("target");
+                    if (composed) {
+                        std::vector<std::unique_ptr<GeneratorBase>> gens;
+                        std::vector<GeneratorBase *> gen_ptrs;
+                        for (const std::string &gen_name : composed_names) {
+                            // Args qualified with a Generator's name apply only to it.
+                            GeneratorParamsMap gen_args;
+                            for (const auto &arg : sub_generator_args) {
+                                size_t dot = arg.first.find('.');
+                                std::string qualifier = dot == std::string::npos ? "" : arg.first.substr(0, dot);
+                                if (qualifier == gen_name) {
+                                    gen_args[arg.first.substr(dot + 1)] = arg.second;
+                                } else if (std::find(composed_names.begin(), composed_names.end(), qualifier) ==
+                                           composed_names.end()) {
+                                    gen_args[arg.first] = arg.second;
+                                }
+                            }
+                            gens.push_back(GeneratorRegistry::create(gen_name, GeneratorContext(target)));
+                            gens.back()->set_generator_param_values(gen_args);
+                            gen_ptrs.push_back(gens.back().get());
+                        }
+                        return GeneratorBase::build_composed_module(gen_ptrs, connections, name, schedule_file);
+                    }
                     // Must re-create each time since each instance will have a different Target.
                     auto gen = GeneratorRegistry::create(generator_name, GeneratorContext(target));
                     gen->set_generator_param_values(sub_generator_args);
+                    gen->set_schedule_file(schedule_file);
                     return gen->build_module(name);
                 };
             if (targets.size() > 1 || !emit_options.substitutions.empty()) {
@@ -1375,6 +1558,9 @@ Module GeneratorBase::build_module(const std::string &function_name,
                                    const LinkageType linkage_type) {
     std::string auto_schedule_result;
     Pipeline pipeline = build_pipeline();
+    if (!schedule_file.empty()) {
+        apply_schedule_file(pipeline, schedule_file);
+    }
     if (get_auto_schedule()) {
         auto_schedule_result = pipeline.auto_schedule(get_target(), get_machine_params());
     }
@@ -1400,24 +1586,146 @@ Module GeneratorBase::build_module(const std::string &function_name,
     }
 
     Module result = pipeline.compile_to_module(filter_arguments, function_name, target, linkage_type);
+    if (batch_entry_point) {
+        add_batch_entry_point(result, function_name);
+    }
     std::shared_ptr<ExternsMap> externs_map = get_externs_map();
     for (const auto &map_entry : *externs_map) {
         result.append(map_entry.second);
     }
 
-    auto outputs = pipeline.outputs();
     for (auto *output : pi.filter_outputs) {
-        for (size_t i = 0; i < output->funcs().size(); ++i) {
-            auto from = output->funcs()[i].name();
-            auto to = output->array_name(i);
-            size_t tuple_size = output->types_defined() ? output->types().size() : 1;
-            for (size_t t = 0; t < tuple_size; ++t) {
-                std::string suffix = (tuple_size > 1) ? ("." + std::to_string(t)) : "";
-                result.remap_metadata_name(from + suffix, to + suffix);
+        remap_output_names(result, output);
+    }
+
+    result.set_auto_schedule(auto_schedule_result);
+
+    return result;
+}
+
+void GeneratorBase::remap_output_names(Module &module, GeneratorOutputBase *output) {
+    for (size_t i = 0; i < output->funcs().size(); ++i) {
+        auto from = output->funcs()[i].name();
+        auto to = output->array_name(i);
+        size_t tuple_size = output->types_defined() ? output->types().size() : 1;
+        for (size_t t = 0; t < tuple_size; ++t) {
+            std::string suffix = (tuple_size > 1) ? ("." + std::to_string(t)) : "";
+            module.remap_metadata_name(from + suffix, to + suffix);
+        }
+    }
+}
+
+Module GeneratorBase::build_composed_module(const std::vector<GeneratorBase *> &generators,
+                                            const std::map<std::string, std::string> &connections,
+                                            const std::string &function_name,
+                                            const std::string &schedule_file,
+                                            const LinkageType linkage_type) {
+    user_assert(!generators.empty()) << "There are no Generators to compose.\n";
+    const Target target = generators[0]->get_target();
+
+    // The Outputs of the Generators built so far, by "generator.output".
+    std::map<std::string, Func> built_outputs;
+    std::set<std::string> connected_inputs, connected_outputs;
+    // The names of the arguments of the composed pipeline, which must
+    // be unique across the Generators.
+    std::set<std::string> argument_names;
+    std::vector<Argument> filter_arguments;
+    std::set<std::string> generator_names;
+    for (GeneratorBase *gen : generators) {
+        const std::string &gen_name = gen->generator_registered_name;
+        user_assert(generator_names.insert(gen_name).second)
+            << "Generator " << gen_name << " can only be composed with other Generators once.\n";
+        user_assert(gen->get_target() == target)
+            << "Generator " << gen_name << " has a different target to the Generators it is composed with.\n";
+        ParamInfo &pi = gen->param_info();
+        user_assert(pi.filter_params.empty() && !pi.filter_outputs.empty())
+            << "Generator " << gen_name << " must use Input<> and Output<> to be composed with other Generators.\n";
+
+        gen->advance_phase(InputsSet);
+        for (auto *input : pi.filter_inputs) {
+            const std::string key = gen_name + "." + input->name();
+            auto c = connections.find(key);
+            if (c == connections.end()) {
+                input->init_internals();
+                for (const auto &p : input->parameters_) {
+                    user_assert(argument_names.insert(p.name()).second)
+                        << "Composed Generators have more than one unconnected Input called " << p.name() << ".\n";
+                    filter_arguments.push_back(to_argument(p));
+                }
+                continue;
+            }
+            auto o = built_outputs.find(c->second);
+            user_assert(o != built_outputs.end())
+                << "Input " << key << " is connected to " << c->second
+                << ", which is not an Output of an earlier Generator.\n";
+            user_assert(input->kind() == IOKind::Function && !input->is_array())
+                << "Input " << key << " must be an Input<Func> to be connected to the Output of another Generator.\n";
+            input->set_inputs({StubInput(o->second)});
+            connected_inputs.insert(key);
+            connected_outputs.insert(c->second);
+        }
+        gen->inputs_set = true;
+        gen->build_pipeline();
+
+        for (auto *output : pi.filter_outputs) {
+            if (!output->is_array()) {
+                built_outputs[gen_name + "." + output->name()] = output->funcs().at(0);
+            }
+        }
+    }
+    for (const auto &c : connections) {
+        user_assert(connected_inputs.count(c.first))
+            << "There is no Input called " << c.first << " to connect to " << c.second << ".\n";
+    }
+
+    // Outputs that feed other Generators become intermediate Funcs of
+    // the composed pipeline. They stay compute_root, as they were when
+    // they were the outputs of separate pipelines, unless a schedule
+    // file moves them; the rest are the outputs of the pipeline.
+    std::vector<Func> output_funcs;
+    std::vector<GeneratorOutputBase *> pipeline_outputs;
+    for (GeneratorBase *gen : generators) {
+        for (auto *output : gen->param_info().filter_outputs) {
+            if (connected_outputs.count(gen->generator_registered_name + "." + output->name())) {
+                Func f = output->funcs().at(0);
+                LoopLevel compute_level = f.function().schedule().compute_level();
+                compute_level.lock();
+                if (compute_level.is_inlined()) {
+                    f.compute_root();
+                }
+                continue;
+            }
+            for (size_t i = 0; i < output->funcs().size(); i++) {
+                user_assert(argument_names.insert(output->array_name(i)).second)
+                    << "Composed Generators have more than one unconnected Output or Input called "
+                    << output->array_name(i) << ".\n";
+                output_funcs.push_back(output->funcs()[i]);
             }
+            pipeline_outputs.push_back(output);
         }
     }
 
+    Pipeline pipeline(output_funcs);
+    if (!schedule_file.empty()) {
+        apply_schedule_file(pipeline, schedule_file);
+    }
+    std::string auto_schedule_result;
+    for (GeneratorBase *gen : generators) {
+        if (gen->get_auto_schedule()) {
+            auto_schedule_result = pipeline.auto_schedule(target, gen->get_machine_params());
+            break;
+        }
+    }
+
+    Module result = pipeline.compile_to_module(filter_arguments, function_name, target, linkage_type);
+    for (GeneratorBase *gen : generators) {
+        for (const auto &map_entry : *gen->get_externs_map()) {
+            result.append(map_entry.second);
+        }
+    }
+    for (auto *output : pipeline_outputs) {
+        remap_output_names(result, output);
+    }
     result.set_auto_schedule(auto_schedule_result);
 
     return result;
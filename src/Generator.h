@@ -194,6 +194,11 @@
  *    being targeted which may be used to enhance the automatically-generated
  *    schedule.
  *
+ *  Generators also have a 'batch_entry_point' GeneratorParam (default false).
+ *  If set, the compiled output has a second entry point, <function_name>_batch,
+ *  that takes each buffer with one extra outermost dimension and runs the
+ *  pipeline on each item of that dimension in parallel.
+ *
  * Generators are added to a global registry to simplify AOT build mechanics; this
  * is done by simply using the HALIDE_REGISTER_GENERATOR macro at global scope:
  *
@@ -317,7 +322,9 @@ std::string halide_type_to_c_type(const Type &t);
 
 /** generate_filter_main() is a convenient wrapper for GeneratorRegistry::create() +
  * compile_to_files(); it can be trivially wrapped by a "real" main() to produce a
- * command-line utility for ahead-of-time filter compilation. */
+ * command-line utility for ahead-of-time filter compilation. Invoked as
+ * "-m manifest", it instead runs the invocations listed in the manifest
+ * file (one per line) in parallel. */
 int generate_filter_main(int argc, char **argv, std::ostream &cerr);
 
 // select_type<> is to std::conditional as switch is to if:
@@ -2622,11 +2629,14 @@ public:
         bool emit_cpp{false};
         bool emit_assembly{false};
         bool emit_bitcode{false};
+        bool emit_thinlto_bitcode{false};
         bool emit_stmt{false};
         bool emit_stmt_html{false};
         bool emit_static_library{true};
         bool emit_cpp_stub{false};
         bool emit_schedule{false};
+        bool emit_memory_report{false};
+        bool emit_python_extension{false};
 
         // This is an optional map used to replace the default extensions generated for
         // a file: if an key matches an output extension, emit those files with the
@@ -2656,11 +2666,37 @@ public:
 
     void emit_cpp_stub(const std::string &stub_file_path);
 
+    /** Apply the schedule in the given file to the pipeline in
+     * build_module(), after schedule() has been called. See
+     * Halide::apply_schedule for the format. */
+    void set_schedule_file(const std::string &path) {
+        schedule_file = path;
+    }
+
     // Call build() and produce a Module for the result.
     // If function_name is empty, generator_name() will be used for the function.
     Module build_module(const std::string &function_name = "",
                         const LinkageType linkage_type = LinkageType::ExternalPlusMetadata);
 
+    /** Build a single Module from several Generators, so that the
+     * pipelines they define are lowered together and can be scheduled
+     * across the boundaries between them (e.g. by computing a stage
+     * of one Generator at a loop of the next one in a schedule file),
+     * rather than passing full buffers from one to the next.
+     *
+     * The Generators are built in order. connections maps Inputs of
+     * the form "generator.input", which must be Input<Func>s, to
+     * Outputs of earlier Generators of the form "generator.output".
+     * The unconnected Inputs and Outputs of all the Generators become
+     * the arguments of the Module's function, so their names must be
+     * unique. Connected Outputs are compute_root unless their
+     * Generator or the schedule file schedules them otherwise. */
+    static Module build_composed_module(const std::vector<GeneratorBase *> &generators,
+                                        const std::map<std::string, std::string> &connections,
+                                        const std::string &function_name,
+                                        const std::string &schedule_file = "",
+                                        const LinkageType linkage_type = LinkageType::ExternalPlusMetadata);
+
     /**
      * set_inputs is a variadic wrapper around set_inputs_vector, which makes usage much simpler
      * in many cases, as it constructs the relevant entries for the vector for you, which
@@ -2755,6 +2791,16 @@ protected:
     void check_min_phase(Phase expected_phase) const;
     void advance_phase(Phase new_phase);
 
+    // If true, build_module() also adds an entry point named
+    // <function_name>_batch, which takes every buffer with an extra
+    // outermost dimension and runs the pipeline on each item of the
+    // batch in parallel. See Internal::add_batch_entry_point.
+    GeneratorParam<bool> batch_entry_point{"batch_entry_point", false};
+
+    // A file with a schedule to apply in build_module(). See
+    // set_schedule_file.
+    std::string schedule_file;
+
 private:
     friend void ::Halide::Internal::generator_test();
     friend class GeneratorParamBase;
@@ -2831,6 +2877,10 @@ private:
 
     void set_inputs_vector(const std::vector<std::vector<StubInput>> &inputs);
 
+    // Rename the metadata for an Output's Funcs in a Module to the
+    // Output's name.
+    static void remap_output_names(Module &module, Internal::GeneratorOutputBase *output);
+
     static void check_input_is_singular(Internal::GeneratorInputBase *in);
     static void check_input_is_array(Internal::GeneratorInputBase *in);
     static void check_input_kind(Internal::GeneratorInputBase *in, Internal::IOKind kind);
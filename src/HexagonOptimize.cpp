@@ -1859,8 +1859,79 @@ private:
     }
 };
 
+// Replace stores of gathers (loads at a vector of indices) from one
+// VTCM allocation into another with calls to
+// halide.hexagon.vgather, which CodeGen_Hexagon maps to the vgather
+// instructions of v65 and later. Only 16 and 32-bit elements can be
+// gathered.
+class VGatherGenerator : public IRMutator2 {
+    std::map<string, const Allocate *> allocations;
+
+    using IRMutator2::visit;
+
+    Stmt visit(const Allocate *op) override {
+        allocations[op->name] = op;
+        Stmt s = IRMutator2::visit(op);
+        allocations.erase(op->name);
+        return s;
+    }
+
+    bool in_vtcm(const string &name) {
+        auto it = allocations.find(name);
+        return it != allocations.end() && it->second->memory_type == MemoryType::VTCM;
+    }
+
+    Stmt visit(const Store *op) override {
+        Type ty = op->value.type();
+        const Ramp *ramp = op->index.as<Ramp>();
+        const Load *load = op->value.as<Load>();
+        if (!ty.is_vector() || (ty.bits() != 16 && ty.bits() != 32) ||
+            !is_one(op->predicate) || !ramp || !is_one(ramp->stride) ||
+            !load || !is_one(load->predicate) || load->index.as<Ramp>() ||
+            ty.lanes() % (native_vector_bytes / ty.bytes()) != 0 ||
+            !in_vtcm(op->name) || !in_vtcm(load->name)) {
+            return IRMutator2::visit(op);
+        }
+
+        // The gather instructions take byte offsets, which must all lie
+        // within a region given by its size minus one.
+        const Allocate *src = allocations[load->name];
+        Expr size = src->type.bytes();
+        for (const Expr &e : src->extents) {
+            size *= e;
+        }
+        size = simplify(size);
+        Expr offsets = load->index * ty.bytes();
+        // 16-bit elements can use 16-bit offsets if the source is small
+        // enough, otherwise the offsets are 32-bit.
+        const int64_t *const_size = as_const_int(size);
+        if (ty.bits() == 16 && const_size && *const_size <= 65536) {
+            offsets = cast(UInt(16, ty.lanes()), offsets);
+        }
+
+        Expr gather = Call::make(ty, "halide.hexagon.vgather",
+                                 {Variable::make(Handle(), op->name), ramp->base,
+                                  Variable::make(Handle(), load->name), size - 1, offsets},
+                                 Call::Extern);
+        return Evaluate::make(gather);
+    }
+
+    int native_vector_bytes;
+
+public:
+    VGatherGenerator(int native_vector_bytes)
+        : native_vector_bytes(native_vector_bytes) {}
+};
+
 }  // namespace
 
+Stmt vgather_generator(Stmt s, const Target &t) {
+    if (!t.features_any_of({Target::HVX_v65, Target::HVX_v66})) {
+        return s;
+    }
+    return VGatherGenerator(t.natural_vector_size(Int(8))).mutate(s);
+}
+
 Stmt optimize_hexagon_shuffles(Stmt s, int lut_alignment) {
     // Replace indirect and other complicated loads with
     // dynamic_shuffle (vlut) calls.
@@ -14,6 +14,10 @@ namespace Internal {
  * calls. */
 Stmt optimize_hexagon_shuffles(Stmt s, int lut_alignment);
 
+/** Replace stores of vectors gathered from one VTCM allocation into
+ * another with vgather instructions, on Hexagon v65 and later. */
+Stmt vgather_generator(Stmt s, const Target &t);
+
 /** Generate vtmpy instruction if possible */
 Stmt vtmpy_generator(Stmt s);
 
@@ -0,0 +1,267 @@
+#include "HoistDivisors.h"
+#include "IREquality.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+
+#include <map>
+#include <set>
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+// The variables an Expr depends on, and whether it is safe to
+// evaluate somewhere else at all.
+class DivisorDependencies : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    void visit(const Variable *op) override {
+        vars.insert(op->name);
+    }
+
+    void visit(const Load *op) override {
+        can_hoist = false;
+    }
+
+    void visit(const Call *op) override {
+        if (!op->is_pure()) {
+            can_hoist = false;
+        }
+        IRGraphVisitor::visit(op);
+    }
+
+public:
+    set<string> vars;
+    bool can_hoist = true;
+};
+
+// The values computed outside a loop that replace division by a
+// particular denominator within it. Uses the round-up method of
+// Granlund and Montgomery, "Division by Invariant Integers using
+// Multiplication" (1994), section 4, which needs no branches.
+struct Divisor {
+    string mul, shift1, shift2, sign;
+};
+
+class HoistDivisors : public IRMutator2 {
+    using IRMutator2::visit;
+
+    struct Loop {
+        // The names defined at or inside this loop.
+        set<string> defined;
+        // The denominators hoisted to just outside this loop.
+        map<Expr, Divisor, IRDeepCompare> divisors;
+        vector<Expr> order;
+    };
+    vector<Loop> loops;
+
+    void define(const string &name) {
+        if (!loops.empty()) {
+            loops.back().defined.insert(name);
+        }
+    }
+
+    // Find the outermost enclosing loop over which the denominator is
+    // invariant, and get the magic numbers for it there.
+    const Divisor *find_divisor(const Expr &denominator) {
+        if (loops.empty()) {
+            return nullptr;
+        }
+        DivisorDependencies deps;
+        denominator.accept(&deps);
+        if (!deps.can_hoist) {
+            return nullptr;
+        }
+        int outermost = (int)loops.size();
+        while (outermost > 0) {
+            bool invariant = true;
+            for (const string &v : deps.vars) {
+                invariant = invariant && !loops[outermost - 1].defined.count(v);
+            }
+            if (!invariant) {
+                break;
+            }
+            outermost--;
+        }
+        if (outermost == (int)loops.size()) {
+            return nullptr;
+        }
+        // Once not invariant in a loop, it can't be invariant in the
+        // loops inside it either, as they're defined in it.
+        Loop &loop = loops[outermost];
+        auto it = loop.divisors.find(denominator);
+        if (it == loop.divisors.end()) {
+            Divisor d;
+            const string prefix = unique_name('d');
+            d.mul = prefix + ".mul";
+            d.shift1 = prefix + ".shift1";
+            d.shift2 = prefix + ".shift2";
+            d.sign = prefix + ".sign";
+            it = loop.divisors.emplace(denominator, d).first;
+            loop.order.push_back(denominator);
+        }
+        return &it->second;
+    }
+
+    // Integer division or mod by a non-constant scalar (or broadcast
+    // scalar) denominator of a type we know how to handle.
+    static Expr scalar_denominator(const Expr &b) {
+        Type t = b.type();
+        if (!(t.is_int() || t.is_uint()) ||
+            !(t.bits() == 8 || t.bits() == 16 || t.bits() == 32)) {
+            return Expr();
+        }
+        Expr d = b;
+        if (const Broadcast *bc = b.as<Broadcast>()) {
+            d = bc->value;
+        }
+        if (!d.type().is_scalar() || is_const(d)) {
+            return Expr();
+        }
+        return d;
+    }
+
+    // Euclidean division, as Halide defines it, of a by the
+    // denominator for which d has the magic numbers.
+    static Expr divide(const Expr &a, const Divisor &d) {
+        Type t = a.type();
+        const int bits = t.bits();
+        Type ut = t.with_code(Type::UInt);
+        Type wide = ut.with_bits(bits * 2);
+        Type scalar_ut = ut.element_of();
+        Expr mul = Variable::make(scalar_ut, d.mul);
+        Expr shift1 = Variable::make(scalar_ut, d.shift1);
+        Expr shift2 = Variable::make(scalar_ut, d.shift2);
+
+        // For signed numerators, floor(a / |b|) = ~(~a / |b|) when a
+        // is negative, and ~a is then non-negative.
+        Expr a_sign, n = a;
+        if (t.is_int()) {
+            a_sign = a >> (bits - 1);
+            n = reinterpret(ut, a ^ a_sign);
+        }
+        Expr hi = cast(ut, (cast(wide, n) * cast(wide, mul)) >> bits);
+        Expr q = (hi + ((n - hi) >> shift1)) >> shift2;
+        if (t.is_int()) {
+            // Negate the result when the denominator is negative.
+            Expr b_sign = Variable::make(t.element_of(), d.sign);
+            q = reinterpret(t, q) ^ a_sign;
+            q = (q ^ b_sign) - b_sign;
+        }
+        return q;
+    }
+
+    Expr visit(const Div *op) override {
+        Expr a = mutate(op->a), b = mutate(op->b);
+        Expr d = scalar_denominator(b);
+        const Divisor *divisor = d.defined() ? find_divisor(d) : nullptr;
+        if (divisor) {
+            return divide(a, *divisor);
+        } else if (a.same_as(op->a) && b.same_as(op->b)) {
+            return op;
+        } else {
+            return Div::make(a, b);
+        }
+    }
+
+    Expr visit(const Mod *op) override {
+        Expr a = mutate(op->a), b = mutate(op->b);
+        Expr d = scalar_denominator(b);
+        const Divisor *divisor = d.defined() ? find_divisor(d) : nullptr;
+        if (divisor) {
+            return a - divide(a, *divisor) * b;
+        } else if (a.same_as(op->a) && b.same_as(op->b)) {
+            return op;
+        } else {
+            return Mod::make(a, b);
+        }
+    }
+
+    Expr visit(const Let *op) override {
+        define(op->name);
+        return IRMutator2::visit(op);
+    }
+
+    Stmt visit(const LetStmt *op) override {
+        define(op->name);
+        return IRMutator2::visit(op);
+    }
+
+    Stmt visit(const For *op) override {
+        if (op->device_api != DeviceAPI::None &&
+            op->device_api != DeviceAPI::Host) {
+            // Leave device code alone.
+            return op;
+        }
+
+        Expr min = mutate(op->min);
+        Expr extent = mutate(op->extent);
+
+        loops.emplace_back();
+        loops.back().defined.insert(op->name);
+        Stmt body = mutate(op->body);
+        Loop loop = std::move(loops.back());
+        loops.pop_back();
+
+        Stmt result;
+        if (min.same_as(op->min) && extent.same_as(op->extent) && body.same_as(op->body)) {
+            result = op;
+        } else {
+            result = For::make(op->name, min, extent, op->for_type, op->device_api, body);
+        }
+
+        // Compute the magic numbers for each denominator hoisted to
+        // just outside this loop, in 64-bit arithmetic: with
+        // l = ceil(log2(|b|)), mul = 2^bits * (2^l - |b|) / |b| + 1.
+        for (auto it = loop.order.rbegin(); it != loop.order.rend(); it++) {
+            const Expr &b = *it;
+            const Divisor &d = loop.divisors[b];
+            Type t = b.type();
+            const int bits = t.bits();
+            Type ut = t.with_code(Type::UInt);
+
+            // Division by zero is undefined, so use a denominator of
+            // one instead of trapping here when the loop may never run.
+            Expr abs_b = t.is_int() ? abs(b) : b;
+            abs_b = max(cast(UInt(64), abs_b), make_one(UInt(64)));
+            Expr abs_b_var = Variable::make(UInt(64), d.mul + ".abs");
+
+            // The number of bits needed to hold |b| - 1. The + 1
+            // keeps the argument to count_leading_zeros nonzero.
+            Expr l = 63 - cast(UInt(64), count_leading_zeros(((abs_b_var - 1) << 1) + 1));
+            Expr l_var = Variable::make(UInt(64), d.mul + ".l");
+
+            Expr mul = ((((make_one(UInt(64)) << l_var) - abs_b_var) << bits) / abs_b_var) + 1;
+
+            if (t.is_int()) {
+                result = LetStmt::make(d.sign, b >> (bits - 1), result);
+            }
+            result = LetStmt::make(d.shift2, cast(ut, Halide::max(l_var, 1) - 1), result);
+            result = LetStmt::make(d.shift1, cast(ut, Halide::min(l_var, 1)), result);
+            result = LetStmt::make(d.mul, cast(ut, mul), result);
+            result = LetStmt::make(d.mul + ".l", l, result);
+            result = LetStmt::make(d.mul + ".abs", abs_b, result);
+        }
+
+        define(op->name);
+        for (const auto &p : loop.defined) {
+            define(p);
+        }
+        return result;
+    }
+};
+
+}  // namespace
+
+Stmt hoist_divisors(Stmt s) {
+    return HoistDivisors().mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
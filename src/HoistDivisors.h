@@ -0,0 +1,25 @@
+#ifndef HALIDE_HOIST_DIVISORS_H
+#define HALIDE_HOIST_DIVISORS_H
+
+/** \file
+ * Defines a lowering pass that strength-reduces integer division by
+ * loop-invariant, non-constant denominators.
+ */
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Replace integer divisions and mods inside loops whose denominators
+ * are not constant but do not vary within the loop (e.g. a
+ * Param<int>) with a multiply and shifts. The magic numbers are
+ * computed once, outside the outermost loop over which the
+ * denominator is invariant. Division by constants is handled in
+ * codegen instead. */
+Stmt hoist_divisors(Stmt s);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -517,7 +517,10 @@ struct Call : public ExprNode<Call> {
         extract_mask_element,
         require,
         size_of_halide_buffer_t,
-        strict_float;
+        strict_float,
+        atomic_update,
+        nontemporal_store,
+        keyed_random;
 
     // We also declare some symbolic names for some of the runtime
     // functions that we want to construct Call nodes to here to avoid
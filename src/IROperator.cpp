@@ -615,6 +615,146 @@ Expr halide_erf(Expr x_full) {
     return result;
 }
 
+namespace {
+
+// Compute sin(x), or cos(x) if is_cos is set. x is reduced to r in
+// [-pi/4, pi/4] with x = j*pi/2 + r, then the quadrant j selects
+// between the polynomials for sin(r) and cos(r) and their negations.
+Expr halide_sin_or_cos(const Expr &x_full, bool is_cos, int max_ulp_error) {
+    Type type = x_full.type();
+    internal_assert(type.element_of() == Float(32));
+
+    // pi/2 split into three parts. The first two have few enough
+    // mantissa bits that multiplying them by j is exact for |x| < 2^16.
+    float pio2_part1 = 1.5703125f;
+    float pio2_part2 = 4.837512969970703125e-4f;
+    float pio2_part3 = 7.54978995489188216e-8f;
+    float two_over_pi = 0.636619772367581343f;
+
+    Expr j_real = floor(x_full * two_over_pi + 0.5f);
+    Expr j = cast(Int(32, type.lanes()), j_real);
+
+    Expr r = x_full - j_real * pio2_part1;
+    r -= j_real * pio2_part2;
+    r -= j_real * pio2_part3;
+    Expr z = r * r;
+
+    // sin(r) = r + r*z*P(z) and cos(r) = 1 - z/2 + z*z*Q(z). The
+    // accurate coefficients are from Cephes.
+    Expr p, q;
+    if (max_ulp_error >= 32) {
+        float sin_coeff[] = {
+            0.008162303314839374f,
+            -0.1666333752374699f};
+        float cos_coeff[] = {
+            -0.0013650475943035928f,
+            0.04166116709010865f};
+        p = evaluate_polynomial(z, sin_coeff, sizeof(sin_coeff)/sizeof(sin_coeff[0]));
+        q = evaluate_polynomial(z, cos_coeff, sizeof(cos_coeff)/sizeof(cos_coeff[0]));
+    } else {
+        float sin_coeff[] = {
+            -1.9515295891e-4f,
+            8.3321608736e-3f,
+            -1.6666654611e-1f};
+        float cos_coeff[] = {
+            2.443315711809948e-5f,
+            -1.388731625493765e-3f,
+            4.166664568298827e-2f};
+        p = evaluate_polynomial(z, sin_coeff, sizeof(sin_coeff)/sizeof(sin_coeff[0]));
+        q = evaluate_polynomial(z, cos_coeff, sizeof(cos_coeff)/sizeof(cos_coeff[0]));
+    }
+    Expr sin_r = r + r * z * p;
+    Expr cos_r = 1.0f - 0.5f * z + z * z * q;
+
+    // cos(x) = sin(x + pi/2), so cos is one quadrant further along.
+    Expr quadrant = (is_cos ? j + 1 : j) & 3;
+    Expr result = select((quadrant & 1) == 1, cos_r, sin_r);
+    result = select((quadrant & 2) == 2, -result, result);
+
+    // This introduces lots of common subexpressions
+    result = common_subexpression_elimination(result);
+
+    return result;
+}
+
+// atan without the final common subexpression elimination, so that
+// atan2 can eliminate across the whole thing once.
+Expr halide_atan_no_cse(const Expr &x_full, int max_ulp_error) {
+    Type type = x_full.type();
+    internal_assert(type.element_of() == Float(32));
+
+    float pi_over_2 = 1.57079632679489662f;
+    float pi_over_4 = 0.785398163397448310f;
+
+    // Reduce |x| to t in [-tan(pi/8), tan(pi/8)] using
+    // atan(x) = pi/2 + atan(-1/x) and atan(x) = pi/4 + atan((x-1)/(x+1)).
+    Expr x = abs(x_full);
+    Expr large = x > 2.41421356f;
+    Expr medium = x > 0.414213562f;
+    Expr offset = select(large, pi_over_2, select(medium, pi_over_4, 0.0f));
+    Expr t = select(large, -1.0f / x, select(medium, (x - 1.0f) / (x + 1.0f), x));
+    Expr z = t * t;
+
+    // atan(t) = t + t*z*P(z). The accurate coefficients are from Cephes.
+    Expr p;
+    if (max_ulp_error >= 512) {
+        float coeff[] = {
+            0.17006986948349942f,
+            -0.3317938124485069f};
+        p = evaluate_polynomial(z, coeff, sizeof(coeff)/sizeof(coeff[0]));
+    } else if (max_ulp_error >= 16) {
+        float coeff[] = {
+            -0.11204195673030194f,
+            0.1970892219317658f,
+            -0.3332521004915641f};
+        p = evaluate_polynomial(z, coeff, sizeof(coeff)/sizeof(coeff[0]));
+    } else {
+        float coeff[] = {
+            8.05374449538e-2f,
+            -1.38776856032e-1f,
+            1.99777106478e-1f,
+            -3.33329491539e-1f};
+        p = evaluate_polynomial(z, coeff, sizeof(coeff)/sizeof(coeff[0]));
+    }
+    Expr result = offset + (t + t * z * p);
+
+    return select(x_full < 0.0f, -result, result);
+}
+
+}  // namespace
+
+Expr halide_sin(Expr x, int max_ulp_error) {
+    return halide_sin_or_cos(x, false, max_ulp_error);
+}
+
+Expr halide_cos(Expr x, int max_ulp_error) {
+    return halide_sin_or_cos(x, true, max_ulp_error);
+}
+
+Expr halide_atan(Expr x, int max_ulp_error) {
+    return common_subexpression_elimination(halide_atan_no_cse(x, max_ulp_error));
+}
+
+Expr halide_atan2(Expr y, Expr x, int max_ulp_error) {
+    Type type = x.type();
+    internal_assert(type.element_of() == Float(32) && y.type() == type);
+
+    float pi = 3.14159265358979324f;
+    float pi_over_2 = 1.57079632679489662f;
+
+    // Move atan(y/x) into the right half-plane, and handle the y axis
+    // separately, where y/x is not finite.
+    Expr result = halide_atan_no_cse(y / x, max_ulp_error);
+    result = select(x < 0.0f, select(y < 0.0f, result - pi, result + pi), result);
+    Expr on_y_axis = select(y > 0.0f, pi_over_2, select(y < 0.0f, -pi_over_2, 0.0f));
+    result = select(x == 0.0f, on_y_axis, result);
+
+    // This introduces lots of common subexpressions
+    result = common_subexpression_elimination(result);
+
+    return result;
+}
+
 Expr raise_to_integer_power(Expr e, int64_t p) {
     Expr result;
     if (p == 0) {
@@ -762,9 +902,13 @@ Expr strided_ramp_base(Expr e, int stride) {
 
 } // namespace Internal
 
-Expr fast_log(Expr x) {
+Expr fast_log(Expr x, int max_ulp_error) {
     user_assert(x.type() == Float(32)) << "fast_log only works for Float(32)";
 
+    if (max_ulp_error < 32) {
+        return Internal::halide_log(x);
+    }
+
     Expr reduced, exponent;
     range_reduce_log(x, &reduced, &exponent);
 
@@ -786,9 +930,13 @@ Expr fast_log(Expr x) {
     return result;
 }
 
-Expr fast_exp(Expr x_full) {
+Expr fast_exp(Expr x_full, int max_ulp_error) {
     user_assert(x_full.type() == Float(32)) << "fast_exp only works for Float(32)";
 
+    if (max_ulp_error < 80) {
+        return Internal::halide_exp(x_full);
+    }
+
     Expr scaled = x_full / logf(2.0);
     Expr k_real = floor(scaled);
     Expr k = cast<int>(k_real);
@@ -814,6 +962,28 @@ Expr fast_exp(Expr x_full) {
     result = common_subexpression_elimination(result);
     return result;
 }
+
+Expr fast_sin(Expr x, int max_ulp_error) {
+    user_assert(x.type() == Float(32)) << "fast_sin only works for Float(32)";
+    return Internal::halide_sin(x, max_ulp_error);
+}
+
+Expr fast_cos(Expr x, int max_ulp_error) {
+    user_assert(x.type() == Float(32)) << "fast_cos only works for Float(32)";
+    return Internal::halide_cos(x, max_ulp_error);
+}
+
+Expr fast_atan(Expr x, int max_ulp_error) {
+    user_assert(x.type() == Float(32)) << "fast_atan only works for Float(32)";
+    return Internal::halide_atan(x, max_ulp_error);
+}
+
+Expr fast_atan2(Expr y, Expr x, int max_ulp_error) {
+    user_assert(y.type() == Float(32) && x.type() == Float(32))
+        << "fast_atan2 only works for Float(32)";
+    return Internal::halide_atan2(y, x, max_ulp_error);
+}
+
 Expr stringify(const std::vector<Expr> &args) {
     return Internal::Call::make(type_of<const char *>(), Internal::Call::stringify,
                                 args, Internal::Call::Intrinsic);
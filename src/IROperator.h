@@ -167,6 +167,16 @@ Expr halide_exp(Expr a);
 Expr halide_erf(Expr a);
 // @}
 
+/** Vectorizable Float(32) sin, cos, atan and atan2. The polynomials
+ * used are chosen by the maximum error in ULP the caller can
+ * tolerate. The most accurate versions are within 3 ULP. */
+// @{
+Expr halide_sin(Expr a, int max_ulp_error = 0);
+Expr halide_cos(Expr a, int max_ulp_error = 0);
+Expr halide_atan(Expr a, int max_ulp_error = 0);
+Expr halide_atan2(Expr y, Expr x, int max_ulp_error = 0);
+// @}
+
 /** Raise an expression to an integer power by repeatedly multiplying
  * it by itself. */
 Expr raise_to_integer_power(Expr a, int64_t b);
@@ -908,8 +918,9 @@ inline Tuple tuple_select(const Expr &c0, const Tuple &v0, const Expr &c1, const
 // No backend supports these yet.
 
 /** Return the sine of a floating-point expression. If the argument is
- * not floating-point, it is cast to Float(32). Does not vectorize
- * well. */
+ * not floating-point, it is cast to Float(32). Float(32) vectors
+ * compiled for the CPU use fast_sin with its most accurate
+ * polynomial. Other types do not vectorize well. */
 inline Expr sin(Expr x) {
     user_assert(x.defined()) << "sin of undefined Expr\n";
     if (x.type() == Float(64)) {
@@ -936,8 +947,9 @@ inline Expr asin(Expr x) {
 }
 
 /** Return the cosine of a floating-point expression. If the argument
- * is not floating-point, it is cast to Float(32). Does not vectorize
- * well. */
+ * is not floating-point, it is cast to Float(32). Float(32) vectors
+ * compiled for the CPU use fast_cos with its most accurate
+ * polynomial. Other types do not vectorize well. */
 inline Expr cos(Expr x) {
     user_assert(x.defined()) << "cos of undefined Expr\n";
     if (x.type() == Float(64)) {
@@ -978,8 +990,9 @@ inline Expr tan(Expr x) {
 }
 
 /** Return the arctangent of a floating-point expression. If the
- * argument is not floating-point, it is cast to Float(32). Does not
- * vectorize well. */
+ * argument is not floating-point, it is cast to Float(32). Float(32)
+ * vectors compiled for the CPU use fast_atan with its most accurate
+ * polynomial. Other types do not vectorize well. */
 inline Expr atan(Expr x) {
     user_assert(x.defined()) << "atan of undefined Expr\n";
     if (x.type() == Float(64)) {
@@ -992,8 +1005,9 @@ inline Expr atan(Expr x) {
 }
 
 /** Return the angle of a floating-point gradient. If the argument is
- * not floating-point, it is cast to Float(32). Does not vectorize
- * well. */
+ * not floating-point, it is cast to Float(32). Float(32) vectors
+ * compiled for the CPU use fast_atan2 with its most accurate
+ * polynomial. Other types do not vectorize well. */
 inline Expr atan2(Expr y, Expr x) {
     user_assert(x.defined() && y.defined()) << "atan2 of undefined Expr\n";
 
@@ -1188,29 +1202,55 @@ inline Expr erf(Expr x) {
 
 /** Fast approximate cleanly vectorizable log for Float(32). Returns
  * nonsense for x <= 0.0f. Accurate up to the last 5 bits of the
- * mantissa. Vectorizes cleanly. */
-Expr fast_log(Expr x);
+ * mantissa. Vectorizes cleanly. Passing a max_ulp_error below 32
+ * selects a slower polynomial accurate to within 2 ULP, which is
+ * also what log uses for vectors. */
+Expr fast_log(Expr x, int max_ulp_error = 32);
 
 /** Fast approximate cleanly vectorizable exp for Float(32). Returns
  * nonsense for inputs that would overflow or underflow. Typically
  * accurate up to the last 5 bits of the mantissa. Gets worse when
- * approaching overflow. Vectorizes cleanly. */
-Expr fast_exp(Expr x);
+ * approaching overflow. Vectorizes cleanly. Passing a max_ulp_error
+ * below 80 selects a slower polynomial accurate to within 2 ULP,
+ * which is also what exp uses for vectors. */
+Expr fast_exp(Expr x, int max_ulp_error = 80);
 
 /** Fast approximate cleanly vectorizable pow for Float(32). Returns
  * nonsense for x < 0.0f. Accurate up to the last 5 bits of the
  * mantissa for typical exponents. Gets worse when approaching
- * overflow. Vectorizes cleanly. */
-inline Expr fast_pow(Expr x, Expr y) {
+ * overflow. Vectorizes cleanly. The max_ulp_error is passed on to
+ * fast_log and fast_exp. */
+inline Expr fast_pow(Expr x, Expr y, int max_ulp_error = 80) {
     if (const int64_t *i = as_const_int(y)) {
         return raise_to_integer_power(std::move(x), *i);
     }
 
     x = cast<float>(std::move(x));
     y = cast<float>(std::move(y));
-    return select(x == 0.0f, 0.0f, fast_exp(fast_log(x) * std::move(y)));
+    return select(x == 0.0f, 0.0f, fast_exp(fast_log(x, max_ulp_error) * std::move(y), max_ulp_error));
 }
 
+/** Fast approximate cleanly vectorizable sin and cos for
+ * Float(32). Accurate for |x| < 2^16. With the default max_ulp_error
+ * they are within 32 ULP, or 2e-6 absolute error near the zeros of
+ * the result. Passing a max_ulp_error below 32 selects a slower
+ * polynomial within 2 ULP, or 1e-7 absolute error near zeros, which
+ * is also what sin and cos use for vectors. */
+// @{
+Expr fast_sin(Expr x, int max_ulp_error = 32);
+Expr fast_cos(Expr x, int max_ulp_error = 32);
+// @}
+
+/** Fast approximate cleanly vectorizable atan and atan2 for
+ * Float(32). With the default max_ulp_error they are within 512
+ * ULP. Passing a max_ulp_error below 512 selects a polynomial within
+ * 16 ULP, and below 16 one within 4 ULP, which is also what atan and
+ * atan2 use for vectors. */
+// @{
+Expr fast_atan(Expr x, int max_ulp_error = 512);
+Expr fast_atan2(Expr y, Expr x, int max_ulp_error = 512);
+// @}
+
 /** Fast approximate inverse for Float(32). Corresponds to the rcpps
  * instruction on x86, and the vrecpe instruction on ARM. Vectorizes
  * cleanly. */
@@ -72,6 +72,12 @@ Func ImageParam::in(const Func &f) {
     return func.in(f);
 }
 
+Func ImageParam::stage_in_gpu_shared(const Func &consumer, const VarOrRVar &block,
+                                     int threads_x, int threads_y) {
+    internal_assert(func.defined());
+    return func.stage_in_gpu_shared(consumer, block, threads_x, threads_y);
+}
+
 Func ImageParam::in(const std::vector<Func> &fs) {
     internal_assert(func.defined());
     return func.in(fs);
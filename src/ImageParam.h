@@ -124,6 +124,11 @@ public:
     Func in();
     // @}
 
+    /** Stage the footprint of each GPU block of 'consumer' in this
+     * image in shared memory. See \ref Func::stage_in_gpu_shared. */
+    Func stage_in_gpu_shared(const Func &consumer, const VarOrRVar &block,
+                             int threads_x, int threads_y = 1);
+
     /** Return true iff the name was explicitly specified in the ctor (vs autogenerated). */
     bool is_explicit_name() const {
         return param.is_explicit_name();
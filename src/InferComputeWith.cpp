@@ -0,0 +1,249 @@
+#include "InferComputeWith.h"
+#include "Debug.h"
+#include "FindCalls.h"
+#include "Func.h"
+#include "IREquality.h"
+#include "IRVisitor.h"
+#include "Schedule.h"
+
+#include <algorithm>
+#include <set>
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+// The Funcs and input buffers called by a Func.
+class FindCalledNames : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Call *op) override {
+        IRVisitor::visit(op);
+        if (op->call_type == Call::Halide || op->call_type == Call::Image) {
+            names.insert(op->name);
+        }
+    }
+
+public:
+    set<string> names;
+};
+
+bool same_splits(const vector<Split> &a, const vector<Split> &b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].old_var != b[i].old_var ||
+            a[i].outer != b[i].outer ||
+            a[i].inner != b[i].inner ||
+            a[i].split_type != b[i].split_type ||
+            a[i].tail != b[i].tail ||
+            a[i].exact != b[i].exact ||
+            !equal(a[i].factor, b[i].factor)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool same_dims(const vector<Dim> &a, const vector<Dim> &b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].var != b[i].var ||
+            a[i].for_type != b[i].for_type ||
+            a[i].device_api != b[i].device_api ||
+            a[i].dim_type != b[i].dim_type) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool intersects(const set<string> &a, const set<string> &b) {
+    for (const string &s : a) {
+        if (b.count(s)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// The unqualified name of the loop f should be fused at: its innermost
+// serial or parallel loop, outside of any vectorized or unrolled
+// ones. Returns "" if there is no such loop, or f has loops we don't
+// fuse across, such as GPU loops.
+string fuse_var(const Function &f) {
+    const vector<Dim> &dims = f.definition().schedule().dims();
+    string var;
+    // Skip the outermost dim, which is a placeholder.
+    for (size_t i = 0; i + 1 < dims.size(); i++) {
+        const Dim &d = dims[i];
+        if (d.device_api != DeviceAPI::None &&
+            d.device_api != DeviceAPI::Host) {
+            return "";
+        }
+        if (d.for_type == ForType::Serial || d.for_type == ForType::Parallel) {
+            if (var.empty()) {
+                var = d.var.substr(d.var.rfind('.') + 1);
+            }
+        } else if (d.for_type != ForType::Vectorized &&
+                   d.for_type != ForType::Unrolled) {
+            return "";
+        }
+    }
+    return var;
+}
+
+// A locked copy of a LoopLevel, so that we can inspect the schedules of
+// Funcs that are still being scheduled without locking them.
+LoopLevel locked(const LoopLevel &l) {
+    LoopLevel copy;
+    copy.set(l);
+    return copy.lock();
+}
+
+LoopLevel compute_level(const Function &f) {
+    return locked(f.schedule().compute_level());
+}
+
+LoopLevel store_level(const Function &f) {
+    LoopLevel store = locked(f.schedule().store_level());
+    return store.is_inlined() ? compute_level(f) : store;
+}
+
+// Whether f is computed at a loop level that we're free to fuse with
+// another Func's.
+bool is_fusable(const Function &f) {
+    const FuncSchedule &s = f.schedule();
+    return (f.is_pure() &&
+            !f.has_extern_definition() &&
+            f.definition().specializations().empty() &&
+            locked(f.definition().schedule().fuse_level().level).is_inlined() &&
+            f.definition().schedule().fused_pairs().empty() &&
+            !compute_level(f).is_inlined() &&
+            compute_level(f) == store_level(f) &&
+            !s.memoized() &&
+            !s.async() &&
+            !fuse_var(f).empty());
+}
+
+}  // namespace
+
+vector<ComputeWithGroup> find_compute_with_groups(const vector<Function> &outputs,
+                                                  const map<string, Function> &env) {
+    // What each Func calls, who calls it, and which Funcs it depends on
+    // at all.
+    map<string, set<string>> callees, callers;
+    for (const auto &iter : env) {
+        FindCalledNames calls;
+        iter.second.accept(&calls);
+        for (const ExternFuncArgument &arg : iter.second.extern_arguments()) {
+            if (arg.is_func()) {
+                calls.names.insert(Function(arg.func).name());
+            } else if (arg.is_buffer()) {
+                calls.names.insert(arg.buffer.name());
+            } else if (arg.is_image_param()) {
+                calls.names.insert(arg.image_param.name());
+            }
+        }
+        for (const string &c : calls.names) {
+            callers[c].insert(iter.first);
+        }
+        callees[iter.first] = std::move(calls.names);
+    }
+
+    // Funcs that have compute_with or compute_at directives pointing at
+    // them already.
+    set<string> busy;
+    for (const Function &o : outputs) {
+        busy.insert(o.name());
+    }
+    for (const auto &iter : env) {
+        const Function &f = iter.second;
+        for (const LoopLevel &l : {compute_level(f), store_level(f)}) {
+            if (!l.is_inlined() && !l.is_root()) {
+                busy.insert(l.func());
+            }
+        }
+        vector<Definition> defs = {f.definition()};
+        defs.insert(defs.end(), f.updates().begin(), f.updates().end());
+        for (const Definition &d : defs) {
+            if (!d.defined()) {
+                continue;
+            }
+            LoopLevel l = locked(d.schedule().fuse_level().level);
+            if (!l.is_inlined() && !l.is_root()) {
+                busy.insert(l.func());
+            }
+        }
+    }
+
+    vector<ComputeWithGroup> groups;
+    map<string, map<string, Function>> depends_on;
+    for (const auto &iter : env) {
+        const Function &f = iter.second;
+        if (busy.count(f.name()) || !is_fusable(f)) {
+            continue;
+        }
+        depends_on[f.name()] = find_transitive_calls(f);
+
+        // Add f to the first group it is compatible with.
+        bool added = false;
+        for (ComputeWithGroup &group : groups) {
+            const Function &p = env.at(group.parent);
+            if (!(compute_level(f) == compute_level(p)) ||
+                f.args() != p.args() ||
+                !same_splits(f.definition().schedule().splits(), p.definition().schedule().splits()) ||
+                !same_dims(f.definition().schedule().dims(), p.definition().schedule().dims()) ||
+                !intersects(callers[f.name()], callers[p.name()]) ||
+                !intersects(callees[f.name()], callees[p.name()])) {
+                continue;
+            }
+            vector<string> members = group.fused;
+            members.push_back(group.parent);
+            bool independent = true;
+            for (const string &m : members) {
+                independent = independent &&
+                    !depends_on[f.name()].count(m) &&
+                    !depends_on[m].count(f.name());
+            }
+            if (independent) {
+                group.fused.push_back(f.name());
+                added = true;
+                break;
+            }
+        }
+        if (!added) {
+            groups.push_back({f.name(), {}, fuse_var(f)});
+        }
+    }
+
+    groups.erase(std::remove_if(groups.begin(), groups.end(),
+                                [](const ComputeWithGroup &g) { return g.fused.empty(); }),
+                 groups.end());
+    return groups;
+}
+
+void infer_compute_with(const vector<Function> &outputs, map<string, Function> &env) {
+    for (const ComputeWithGroup &group : find_compute_with_groups(outputs, env)) {
+        const Function &parent = env.at(group.parent);
+        for (const string &name : group.fused) {
+            debug(2) << "Computing " << name << " with " << group.parent
+                     << " at " << group.var << "\n";
+            FuseLoopLevel &fuse_level = env.at(name).definition().schedule().fuse_level();
+            fuse_level.level = LoopLevel(parent, Var(group.var), 0).lock();
+            fuse_level.align = {{group.var, LoopAlignStrategy::Auto}};
+        }
+    }
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,48 @@
+#ifndef HALIDE_INFER_COMPUTE_WITH_H
+#define HALIDE_INFER_COMPUTE_WITH_H
+
+/** \file
+ * Defines an analysis that finds sibling Funcs whose loops can be fused
+ * with compute_with, and a schedule rewrite that fuses them.
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Function.h"
+
+namespace Halide {
+namespace Internal {
+
+/** A set of Funcs to fuse: each Func in 'fused' is computed with 'parent'
+ * at the loop over 'var' (an unqualified var name), aligned with
+ * LoopAlignStrategy::Auto. */
+struct ComputeWithGroup {
+    std::string parent;
+    std::vector<std::string> fused;
+    std::string var;
+};
+
+/** Find groups of Funcs that can be computed with each other: Funcs that
+ * are computed (and stored) at the same loop level, have a consumer in
+ * common, read at least one Func or input buffer in common, don't depend
+ * on each other, and are scheduled over exactly the same loops. Each is
+ * fused at its innermost serial or parallel loop, so that the values of
+ * the inputs they share are loaded once while still in cache. Funcs with
+ * update definitions, specializations, an existing compute_with, or other
+ * Funcs computed within them are left alone. The schedules of the Funcs
+ * in env may still be unlocked, so this can be used while scheduling. */
+std::vector<ComputeWithGroup> find_compute_with_groups(const std::vector<Function> &outputs,
+                                                       const std::map<std::string, Function> &env);
+
+/** Schedule the Funcs found by find_compute_with_groups to be computed
+ * with each other. Called before the realization order is computed;
+ * enabled by the InferComputeWith target feature. */
+void infer_compute_with(const std::vector<Function> &outputs,
+                        std::map<std::string, Function> &env);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
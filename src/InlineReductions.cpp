@@ -5,12 +5,16 @@
 #include "IRMutator.h"
 #include "Debug.h"
 #include "CSE.h"
+#include "Simplify.h"
+#include "Substitute.h"
 
 namespace Halide {
 
 using std::string;
 using std::vector;
 using std::ostringstream;
+using std::map;
+using std::pair;
 
 namespace Internal {
 
@@ -101,6 +105,158 @@ private:
         return expr;
     }
 };
+
+// Accumulate the innermost dimension of an inline reduction in a
+// number of independent lanes, and combine the lanes at the end. This
+// breaks the serial dependence of each step of the reduction on the
+// last, so the lanes can be computed with vector instructions, or at
+// least in parallel by the pipeline. The lanes are unrolled rather than
+// vectorized, because the consumer of an inline reduction is often
+// vectorized itself, and vectorized loops can't nest.
+void tree_reduce(Func f, const RDom &r, Type t) {
+    if (t.bits() < 8 || !is_one(r.domain().predicate())) {
+        return;
+    }
+    const int lanes = std::max(1, std::min(16, 32 / t.bytes()));
+    const int64_t *extent = as_const_int(r[0].extent());
+    if (lanes < 2 || (extent && *extent < 2 * lanes)) {
+        // Not enough work to be worth the horizontal step.
+        return;
+    }
+    RVar rxo, rxi;
+    Var u;
+    f.update().split(r[0], rxo, rxi, lanes);
+    Func intm = f.update().rfactor(rxi, u);
+    intm.unroll(u);
+    intm.update().unroll(u);
+    f.update().unroll(rxi);
+}
+
+// The comparators of Batcher's odd-even merge sort on n elements, as
+// pairs of indices (i, j) with i < j that are replaced by their min and
+// max respectively.
+vector<pair<int, int>> sorting_network(int n) {
+    vector<pair<int, int>> result;
+    for (int p = 1; p < n; p *= 2) {
+        for (int k = p; k >= 1; k /= 2) {
+            for (int j = k % p; j + k < n; j += 2 * k) {
+                for (int i = 0; i < std::min(k, n - j - k); i++) {
+                    if ((i + j) / (2 * p) == (i + j + k) / (2 * p)) {
+                        result.push_back({i + j, i + j + k});
+                    }
+                }
+            }
+        }
+    }
+    return result;
+}
+
+// The k'th element of the sorted values, computed with only the
+// comparators (and only the halves of them) it depends on. Each step is
+// a let, as every value is used by both the min and the max of a
+// comparator, and the Expr graph would be exponential as a tree.
+Expr sorted_element(const vector<Expr> &values, int k) {
+    const int n = (int)values.size();
+    const vector<pair<int, int>> network = sorting_network(n);
+
+    // Walk the network backwards to find which outputs of each
+    // comparator are needed.
+    vector<bool> needed(n, false), need_min(network.size()), need_max(network.size());
+    needed[k] = true;
+    for (size_t c = network.size(); c > 0; c--) {
+        const pair<int, int> &p = network[c - 1];
+        need_min[c - 1] = needed[p.first];
+        need_max[c - 1] = needed[p.second];
+        if (needed[p.first] || needed[p.second]) {
+            needed[p.first] = needed[p.second] = true;
+        }
+    }
+
+    vector<pair<string, Expr>> lets;
+    auto bind = [&](Expr e) {
+        if (e.as<Variable>() || is_const(e)) {
+            return e;
+        }
+        string name = unique_name('s');
+        lets.push_back({name, e});
+        return Variable::make(e.type(), name);
+    };
+
+    vector<Expr> v(n);
+    for (int i = 0; i < n; i++) {
+        if (needed[i]) {
+            v[i] = bind(values[i]);
+        }
+    }
+    for (size_t c = 0; c < network.size(); c++) {
+        const pair<int, int> &p = network[c];
+        Expr a = v[p.first], b = v[p.second];
+        if (need_min[c]) {
+            v[p.first] = bind(min(a, b));
+        }
+        if (need_max[c]) {
+            v[p.second] = bind(max(a, b));
+        }
+    }
+
+    Expr result = v[k];
+    for (size_t i = lets.size(); i > 0; i--) {
+        result = Let::make(lets[i - 1].first, lets[i - 1].second, result);
+    }
+    return result;
+}
+
+// The values of an expression at each point of a reduction domain with
+// constant bounds.
+vector<Expr> unroll_over_rdom(const RDom &r, Expr e, const char *name) {
+    vector<int> mins, extents;
+    int64_t points = 1;
+    for (int i = 0; i < r.dimensions(); i++) {
+        const int64_t *min = as_const_int(simplify(r[i].min()));
+        const int64_t *extent = as_const_int(simplify(r[i].extent()));
+        user_assert(min && extent)
+            << "The reduction domain passed to " << name << " must have constant bounds\n";
+        mins.push_back((int)*min);
+        extents.push_back((int)*extent);
+        points *= std::max((int64_t)0, *extent);
+    }
+    user_assert(points > 0 && points <= 1024)
+        << "The reduction domain passed to " << name << " must have between 1 and 1024 points\n";
+
+    vector<Expr> result;
+    vector<int> coords(mins);
+    for (int64_t p = 0; p < points; p++) {
+        map<string, Expr> point;
+        for (int i = 0; i < r.dimensions(); i++) {
+            point[r[i].name()] = coords[i];
+        }
+        Expr pred = simplify(substitute(point, r.domain().predicate()));
+        user_assert(is_const(pred))
+            << "The predicate of the reduction domain passed to " << name
+            << " must be constant at each point, but at one point is " << pred << "\n";
+        if (is_one(pred)) {
+            result.push_back(substitute(point, e));
+        }
+        // Step to the next point, with the first dimension innermost.
+        for (int i = 0; i < r.dimensions(); i++) {
+            if (++coords[i] < mins[i] + extents[i]) {
+                break;
+            }
+            coords[i] = mins[i];
+        }
+    }
+    user_assert(!result.empty())
+        << "The predicate of the reduction domain passed to " << name << " excludes every point\n";
+    return result;
+}
+
+// Find the reduction domain an expression refers to.
+RDom find_rdom(Expr e, const string &name) {
+    FindFreeVars v(RDom(), name);
+    v.mutate(e);
+    user_assert(v.rdom.defined()) << "Expression passed to " << name << " must reference a reduction domain";
+    return v.rdom;
+}
 }
 
 Expr sum(Expr e, const std::string &name) {
@@ -115,6 +271,9 @@ Expr sum(RDom r, Expr e, const std::string &name) {
 
     Func f(name);
     f(v.free_vars) += e;
+    if (!e.type().is_float()) {
+        Internal::tree_reduce(f, v.rdom, e.type());
+    }
     return f(v.call_args);
 }
 
@@ -130,6 +289,9 @@ Expr product(RDom r, Expr e, const std::string &name) {
 
     Func f(name);
     f(v.free_vars) *= e;
+    if (!e.type().is_float()) {
+        Internal::tree_reduce(f, v.rdom, e.type());
+    }
     return f(v.call_args);
 }
 
@@ -146,6 +308,7 @@ Expr maximum(RDom r, Expr e, const std::string &name) {
     Func f(name);
     f(v.free_vars) = e.type().min();
     f(v.free_vars) = max(f(v.free_vars), e);
+    Internal::tree_reduce(f, v.rdom, e.type());
     return f(v.call_args);
 }
 
@@ -162,6 +325,7 @@ Expr minimum(RDom r, Expr e, const std::string &name) {
     Func f(name);
     f(v.free_vars) = e.type().max();
     f(v.free_vars) = min(f(v.free_vars), e);
+    Internal::tree_reduce(f, v.rdom, e.type());
     return f(v.call_args);
 }
 
@@ -222,4 +386,38 @@ Tuple argmin(RDom r, Expr e, const std::string &name) {
     return f(v.call_args);
 }
 
+std::vector<Expr> sort_network(const std::vector<Expr> &values) {
+    for (const Expr &e : values) {
+        user_assert(e.defined() && e.type() == values[0].type())
+            << "The values passed to sort_network must all have the same type\n";
+    }
+    vector<Expr> result;
+    for (size_t i = 0; i < values.size(); i++) {
+        result.push_back(Internal::sorted_element(values, (int)i));
+    }
+    return result;
+}
+
+Expr kth_smallest(Expr e, int k) {
+    return kth_smallest(Internal::find_rdom(e, "kth_smallest"), e, k);
+}
+
+Expr kth_smallest(RDom r, Expr e, int k) {
+    user_assert(r.defined()) << "kth_smallest requires a defined reduction domain\n";
+    vector<Expr> values = Internal::unroll_over_rdom(r, common_subexpression_elimination(e), "kth_smallest");
+    user_assert(k >= 0 && k < (int)values.size())
+        << "kth_smallest of " << values.size() << " values can't return element " << k << "\n";
+    return Internal::sorted_element(values, k);
+}
+
+Expr median(Expr e) {
+    return median(Internal::find_rdom(e, "median"), e);
+}
+
+Expr median(RDom r, Expr e) {
+    user_assert(r.defined()) << "median requires a defined reduction domain\n";
+    vector<Expr> values = Internal::unroll_over_rdom(r, common_subexpression_elimination(e), "median");
+    return Internal::sorted_element(values, ((int)values.size() - 1) / 2);
+}
+
 }
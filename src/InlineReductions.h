@@ -31,6 +31,12 @@ namespace Halide {
  * Here g computes some blur of x, but g is still a pure function. The
  * sum is being computed by an anonymous reduction function that is
  * scheduled innermost within g.
+ *
+ * When the innermost dimension of the reduction domain is long enough,
+ * sum, product, minimum and maximum accumulate it in several
+ * independent lanes that are combined at the end. Floating-point sums
+ * and products are left serial, as reassociating them would change
+ * the result; use rfactor to do this explicitly.
  */
 //@{
 Expr sum(Expr, const std::string &s = "sum");
@@ -67,6 +73,39 @@ Tuple argmax(RDom, Expr, const std::string &s = "argmax");
 Tuple argmin(RDom, Expr, const std::string &s = "argmin");
 // @}
 
+/** Sort a list of expressions of the same type into increasing order
+ * with a sorting network (Batcher's odd-even merge sort) of mins and
+ * maxes. There are no branches or loads, so the network vectorizes
+ * across the free variables with the native min and max instructions of
+ * each target. Each element of the result only computes the parts of
+ * the network it depends on. */
+std::vector<Expr> sort_network(const std::vector<Expr> &values);
+
+/** Returns the k'th smallest value (counting from zero) of an
+ * expression over a reduction domain, for example for a rank-order
+ * filter. Unlike the other inline reductions, this doesn't make a Func:
+ * the domain must have constant bounds, the expression is fully
+ * unrolled over it, and the k'th element is selected with the parts of a
+ * sorting network that it depends on. The predicate of the domain, if
+ * any, must be constant at each point. */
+// @{
+Expr kth_smallest(Expr, int k);
+Expr kth_smallest(RDom, Expr, int k);
+// @}
+
+/** Returns the median of an expression over a reduction domain, using
+ * \ref kth_smallest. For an even number of points, this is the lower of
+ * the two middle values. For example, a 3x3 median filter is:
+ \code
+ RDom r(-1, 3, -1, 3);
+ f(x, y) = median(in(x + r.x, y + r.y));
+ \endcode
+ */
+// @{
+Expr median(Expr);
+Expr median(RDom, Expr);
+// @}
+
 }
 
 #endif
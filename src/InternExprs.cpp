@@ -0,0 +1,36 @@
+#include "InternExprs.h"
+
+namespace Halide {
+namespace Internal {
+
+Expr ExprInterner::mutate(const Expr &e) {
+    if (!e.defined()) {
+        return e;
+    }
+
+    auto it = done.find(e);
+    if (it != done.end()) {
+        return it->second;
+    }
+
+    // Intern the children first, then find or add the canonical copy
+    // of the result.
+    Expr new_e = IRMutator2::mutate(e);
+    Expr result = canonical.emplace(new_e, new_e).first->second;
+    done.emplace(e, result);
+    if (!new_e.same_as(e)) {
+        done.emplace(new_e, result);
+    }
+    return result;
+}
+
+Expr intern_exprs(const Expr &e) {
+    return ExprInterner().mutate(e);
+}
+
+Stmt intern_exprs(const Stmt &s) {
+    return ExprInterner().mutate(s);
+}
+
+}
+}
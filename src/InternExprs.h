@@ -0,0 +1,54 @@
+#ifndef HALIDE_INTERNAL_INTERN_EXPRS_H
+#define HALIDE_INTERNAL_INTERN_EXPRS_H
+
+/** \file
+ * Defines a pass that makes structurally identical sub-expressions
+ * share the same IR node. */
+
+#include <map>
+
+#include "IREquality.h"
+#include "IRMutator.h"
+
+namespace Halide {
+namespace Internal {
+
+/** A mutator that replaces each Expr with a canonical copy, so that
+ * Exprs passed through the same ExprInterner are equal by value if
+ * and only if they are the same node. The canonical copies live as
+ * long as the interner, so one can be kept alive across several
+ * passes to share nodes between all of them. Comparisons of interned
+ * Exprs with equal() stop at the first shared node, and interned IR
+ * takes less memory, which matters for large bounds expressions. */
+class ExprInterner : public IRMutator2 {
+    // The canonical copy of each Expr seen so far. The children of
+    // each key are themselves canonical, so comparing keys stops at
+    // the first level at which they share nodes.
+    std::map<Expr, Expr, IRDeepCompare> canonical;
+
+    // The result for each node already mutated. This keeps the cost
+    // linear in the size of the graph rather than of the tree.
+    std::map<Expr, Expr, ExprCompare> done;
+
+public:
+    using IRMutator2::mutate;
+
+    Expr mutate(const Expr &e) override;
+
+    /** The number of distinct Exprs interned so far. */
+    size_t size() const {
+        return canonical.size();
+    }
+};
+
+/** Make all structurally identical sub-expressions of the argument
+ * the same node. */
+// @{
+Expr intern_exprs(const Expr &);
+Stmt intern_exprs(const Stmt &);
+// @}
+
+}
+}
+
+#endif
@@ -14,7 +14,9 @@
 // defines backtrace, which gets the call stack as instruction pointers
 #include <execinfo.h>
 
+#include <mutex>
 #include <regex>
+#include <tuple>
 
 using std::vector;
 using std::pair;
@@ -164,6 +166,10 @@ public:
 
     bool working;
 
+    // Names found by get_stack_variable_name, by the program counter
+    // of the call, the offset in the frame, and the expected type.
+    map<std::tuple<uint64_t, int, std::string>, std::string> stack_variable_names;
+
     DebugSections(std::string binary) : calibrated(false), working(false) {
         #ifdef __APPLE__
         size_t last_slash = binary.rfind('/');
@@ -645,6 +651,23 @@ public:
             return "";
         }
 
+        // The same call site always puts the same variable at the
+        // same offset in its frame, so names are cached per call site.
+        auto key = std::make_tuple(pc, offset, type_name);
+        auto cached = stack_variable_names.find(key);
+        if (cached != stack_variable_names.end()) {
+            debug(5) << "Found cached name " << cached->second << "\n";
+            return cached->second;
+        }
+        std::string name = find_stack_variable(func, pc, offset, type_name);
+        stack_variable_names[key] = name;
+        return name;
+    }
+
+    // Find the variable of a function at an offset in its frame that
+    // is live at the given program counter.
+    std::string find_stack_variable(FunctionInfo *func, uint64_t pc, int offset,
+                                    const std::string &type_name) {
         debug(5) << "Searching for var at offset " << offset << "\n";
 
         std::regex re(type_name);
@@ -708,8 +731,9 @@ public:
     }
 
 
-    // Look up n stack frames and get the source location as filename:line
-    std::string get_source_location() {
+    // Find the first frame of a call stack outside of the Halide
+    // namespace, and get its source location as filename:line
+    std::string get_source_location(const vector<void *> &trace) {
         debug(5) << "Finding source location\n";
 
         if (!source_lines.size()) {
@@ -717,13 +741,7 @@ public:
             return "";
         }
 
-        const int max_stack_frames = 256;
-
-        // Get the backtrace
-        vector<void *> trace(max_stack_frames);
-        int trace_size = backtrace(&trace[0], (int)(trace.size()));
-
-        for (int frame = 2; frame < trace_size; frame++) {
+        for (size_t frame = 0; frame < trace.size(); frame++) {
             uint64_t address = (uint64_t)trace[frame];
 
             debug(5) << "Considering address " << ((void *)address) << "\n";
@@ -2168,42 +2186,139 @@ private:
 };
 
 namespace {
+
 DebugSections *debug_sections = nullptr;
+
+// Set if some compilation unit that uses introspection can't support
+// it, in which case introspection is off for the whole program.
+bool disabled = false;
+
+// The compilation units that have asked for introspection but have not
+// been tested yet. Loading and parsing the debug info of the binary is
+// expensive, so it is put off until there is a query.
+struct CompilationUnitTest {
+    bool (*test)(bool (*)(const void *, const std::string &));
+    bool (*test_a)(const void *, const std::string &);
+    void (*calib)();
+};
+
+vector<CompilationUnitTest> &pending_tests() {
+    static vector<CompilationUnitTest> tests;
+    return tests;
+}
+
+std::recursive_mutex &introspection_lock() {
+    static std::recursive_mutex lock;
+    return lock;
+}
+
+// Get the debug sections, loading them and testing any pending
+// compilation units first. Returns nullptr if introspection doesn't
+// work. Must be called with the introspection lock held.
+DebugSections *get_debug_sections() {
+    if (disabled) return nullptr;
+
+    if (!pending_tests().empty()) {
+        if (!debug_sections) {
+            char path[2048];
+            get_program_name(path, sizeof(path));
+            debug_sections = new DebugSections(path);
+        }
+
+        // The tests query introspection themselves, so take them off
+        // the pending list first.
+        vector<CompilationUnitTest> tests;
+        tests.swap(pending_tests());
+        for (const CompilationUnitTest &t : tests) {
+            if (!debug_sections->working) break;
+
+            debug(5) << "Testing compilation unit with offset_marker at " << reinterpret_bits<void *>(t.calib) << "\n";
+
+            debug_sections->calibrate_pc_offset(t.calib);
+            if (!debug_sections->working) {
+                debug(5) << "Failed because offset calibration failed\n";
+                break;
+            }
+
+            debug_sections->working = (*t.test)(t.test_a);
+            if (!debug_sections->working) {
+                debug(5) << "Failed because test routine failed\n";
+                break;
+            }
+
+            debug(5) << "Test passed\n";
+        }
+    }
+
+    if (!debug_sections || !debug_sections->working) return nullptr;
+    return debug_sections;
 }
 
+}  // namespace
+
 std::string get_variable_name(const void *var, const std::string &expected_type) {
-    if (!debug_sections) return "";
-    if (!debug_sections->working) return "";
-    std::string name = debug_sections->get_stack_variable_name(var, expected_type);
+    std::lock_guard<std::recursive_mutex> lock(introspection_lock());
+    DebugSections *sections = get_debug_sections();
+    if (!sections) return "";
+    std::string name = sections->get_stack_variable_name(var, expected_type);
     if (name.empty()) {
         // Maybe it's a member of a heap object.
-        name = debug_sections->get_heap_member_name(var, expected_type);
+        name = sections->get_heap_member_name(var, expected_type);
     }
     if (name.empty()) {
         // Maybe it's a global
-        name = debug_sections->get_global_variable_name(var, expected_type);
+        name = sections->get_global_variable_name(var, expected_type);
     }
 
     return name;
 }
 
+vector<void *> get_call_stack() {
+    {
+        std::lock_guard<std::recursive_mutex> lock(introspection_lock());
+        if (disabled || (pending_tests().empty() && !debug_sections)) {
+            // Nothing has asked for introspection.
+            return {};
+        }
+    }
+
+    const int max_stack_frames = 256;
+
+    // Get the backtrace, skipping this function.
+    vector<void *> trace(max_stack_frames);
+    int trace_size = backtrace(&trace[0], (int)(trace.size()));
+    trace.resize(trace_size);
+    if (!trace.empty()) {
+        trace.erase(trace.begin());
+    }
+    return trace;
+}
+
+std::string get_source_location(const vector<void *> &call_stack) {
+    if (call_stack.empty()) return "";
+    std::lock_guard<std::recursive_mutex> lock(introspection_lock());
+    DebugSections *sections = get_debug_sections();
+    if (!sections) return "";
+    return sections->get_source_location(call_stack);
+}
+
 std::string get_source_location() {
-    if (!debug_sections) return "";
-    if (!debug_sections->working) return "";
-    return debug_sections->get_source_location();
+    return get_source_location(get_call_stack());
 }
 
 void register_heap_object(const void *obj, size_t size, const void *helper) {
-    if (!debug_sections) return;
-    if (!debug_sections->working) return;
     if (!helper) return;
-    debug_sections->register_heap_object(obj, size, helper);
+    std::lock_guard<std::recursive_mutex> lock(introspection_lock());
+    DebugSections *sections = get_debug_sections();
+    if (!sections) return;
+    sections->register_heap_object(obj, size, helper);
 }
 
 void deregister_heap_object(const void *obj, size_t size) {
-    if (!debug_sections) return;
-    if (!debug_sections->working) return;
-    debug_sections->deregister_heap_object(obj, size);
+    std::lock_guard<std::recursive_mutex> lock(introspection_lock());
+    DebugSections *sections = get_debug_sections();
+    if (!sections) return;
+    sections->deregister_heap_object(obj, size);
 }
 
 bool saves_frame_pointer(void *fn) {
@@ -2225,37 +2340,20 @@ void test_compilation_unit(bool (*test)(bool (*)(const void *, const std::string
         return;
     }
 
-    debug(5) << "Testing compilation unit with offset_marker at " << reinterpret_bits<void *>(calib) << "\n";
-
-    if (!debug_sections) {
-        char path[2048];
-        get_program_name(path, sizeof(path));
-        debug_sections = new DebugSections(path);
-    }
+    std::lock_guard<std::recursive_mutex> lock(introspection_lock());
 
     if (!saves_frame_pointer(reinterpret_bits<void *>(&test_compilation_unit)) ||
         !saves_frame_pointer(reinterpret_bits<void *>(test))) {
-        // Make sure libHalide and the test compilation unit both save the frame pointer
-        debug_sections->working = false;
+        // Make sure libHalide and the test compilation unit both save
+        // the frame pointer. If they don't, the debug info is never
+        // loaded.
+        disabled = true;
         debug(5) << "Failed because frame pointer not saved\n";
-    } else if (debug_sections->working) {
-        debug_sections->calibrate_pc_offset(calib);
-        if (!debug_sections->working) {
-            debug(5) << "Failed because offset calibration failed\n";
-            return;
-        }
-
-        debug_sections->working = (*test)(test_a);
-        if (!debug_sections->working) {
-            debug(5) << "Failed because test routine failed\n";
-            return;
-        }
-
-        debug(5) << "Test passed\n";
+    } else {
+        // The test itself, and the calibration, wait for the first query.
+        pending_tests().push_back({test, test_a, calib});
     }
 
-    //debug_sections->dump();
-
     #endif
 }
 
@@ -2273,6 +2371,14 @@ std::string get_variable_name(const void *var, const std::string &expected_type)
     return "";
 }
 
+std::vector<void *> get_call_stack() {
+    return {};
+}
+
+std::string get_source_location(const std::vector<void *> &call_stack) {
+    return "";
+}
+
 std::string get_source_location() {
     return "";
 }
@@ -4,6 +4,7 @@
 #include <string>
 #include <iostream>
 #include <stdint.h>
+#include <vector>
 
 #include "Util.h"
 
@@ -46,9 +47,21 @@ const void *get_introspection_helper() {
  * the Halide namespace. */
 std::string get_source_location();
 
+/** Capture the current call stack, to find its source location later
+ * with get_source_location(call_stack). This is cheap: it doesn't need
+ * the debug info, which is only loaded when a location or a name is
+ * actually looked up. Returns an empty call stack if introspection is
+ * not in use. */
+std::vector<void *> get_call_stack();
+
+/** Get the source location of a call stack captured by
+ * get_call_stack, skipping over calls in the Halide namespace. */
+std::string get_source_location(const std::vector<void *> &call_stack);
+
 // This gets called automatically by anyone who includes Halide.h by
-// the code below. It tests if this functionality works for the given
-// compilation unit, and disables it if not.
+// the code below. It registers a test of whether this functionality
+// works for the given compilation unit, which is run at the first
+// query, and disables introspection if it fails.
 void test_compilation_unit(bool (*test)(bool (*)(const void *, const std::string &)),
                            bool (*test_a)(const void *, const std::string &),
                            void (*calib)());
@@ -1,3 +1,8 @@
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <sstream>
 #include <string>
 #include <stdint.h>
 #include <mutex>
@@ -154,13 +159,14 @@ namespace {
 // Retrieve a function pointer from an llvm module, possibly by compiling it.
 JITModule::Symbol compile_and_get_function(ExecutionEngine &ee, const string &name) {
     debug(2) << "JIT Compiling " << name << "\n";
+    // Code loaded from the JIT cache has no llvm::Function.
     llvm::Function *fn = ee.FindFunctionNamed(name.c_str());
     void *f = (void *)ee.getFunctionAddress(name);
     if (!f) {
         internal_error << "Compiling " << name << " returned nullptr\n";
     }
 
-    JITModule::Symbol symbol(f, fn->getFunctionType());
+    JITModule::Symbol symbol(f, fn ? fn->getFunctionType() : nullptr);
 
     debug(2) << "Function " << name << " is at " << f << "\n";
 
@@ -233,8 +239,185 @@ public:
     }
 };
 
+// If the environment variable HL_JIT_CACHE_DIR names a directory, the
+// object code of each jitted pipeline is stored there, so that other
+// processes jitting the same pipeline can skip LLVM code generation
+// and optimization. Cache entries are keyed by the lowered module,
+// which includes the target, by the version of LLVM, and by a hash of
+// Halide's runtime. Changes to Halide's code generation that don't
+// touch the runtime aren't detected, so clear the cache when
+// rebuilding Halide. Each file holds the full key, which is compared on load, as
+// the file name is just a hash of it. Lowering still happens, as the
+// key is its result.
+struct JITCacheEntry {
+    // What's needed to set up an execution engine for the object
+    // just as for the module it was compiled from.
+    string triple, data_layout, mcpu, mattrs;
+    bool use_soft_float_abi = false;
+    bool per_instruction_fast_math_flags = false;
+    string object;
+};
+
+uint64_t fnv1a_hash(uint64_t h, const char *data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        h = (h ^ (uint8_t)data[i]) * 1099511628211ULL;
+    }
+    return h;
+}
+
+string jit_cache_key(const Module &m) {
+    std::ostringstream key;
+    // Floating point constants must be printed exactly.
+    key.precision(std::numeric_limits<double>::max_digits10);
+    key << "Halide JIT cache\n"
+        << "LLVM " << LLVM_VERSION << "\n"
+        << "Halide runtime " << std::hex << get_runtime_hash() << std::dec << "\n"
+        << m;
+    // The printed module only names its buffers.
+    for (const Buffer<> &b : m.buffers()) {
+        const halide_buffer_t *raw = b.raw_buffer();
+        key << "buffer " << b.name() << " " << b.type();
+        for (int i = 0; i < raw->dimensions; i++) {
+            key << " " << raw->dim[i].min << "," << raw->dim[i].extent << "," << raw->dim[i].stride;
+        }
+        uint64_t contents = raw->host ? fnv1a_hash(14695981039346656037ULL, (const char *)raw->host, raw->size_in_bytes()) : 0;
+        key << " " << contents << "\n";
+    }
+    return key.str();
+}
+
+string jit_cache_path(const string &key) {
+    string dir = get_env_variable("HL_JIT_CACHE_DIR");
+    if (dir.empty()) {
+        return "";
+    }
+    std::ostringstream path;
+    path << dir << "/halide_jit_" << std::hex << fnv1a_hash(14695981039346656037ULL, key.data(), key.size()) << ".o";
+    return path.str();
+}
+
+void write_cache_string(std::ostream &out, const string &s) {
+    uint64_t size = s.size();
+    out.write((const char *)&size, sizeof(size));
+    out.write(s.data(), s.size());
+}
+
+bool read_cache_string(std::istream &in, string &s) {
+    uint64_t size = 0;
+    if (!in.read((char *)&size, sizeof(size))) {
+        return false;
+    }
+    // Don't trust the size of a truncated or corrupt file.
+    std::streampos here = in.tellg();
+    in.seekg(0, std::ios::end);
+    std::streampos end = in.tellg();
+    in.seekg(here);
+    if (here < 0 || end < here || (uint64_t)(end - here) < size) {
+        return false;
+    }
+    s.resize(size);
+    return size == 0 || (bool)in.read(&s[0], size);
+}
+
+bool load_jit_cache_entry(const string &path, const string &key, JITCacheEntry &entry) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    string stored_key, flags;
+    if (!read_cache_string(in, stored_key) || stored_key != key ||
+        !read_cache_string(in, entry.triple) ||
+        !read_cache_string(in, entry.data_layout) ||
+        !read_cache_string(in, entry.mcpu) ||
+        !read_cache_string(in, entry.mattrs) ||
+        !read_cache_string(in, flags) || flags.size() != 2 ||
+        !read_cache_string(in, entry.object)) {
+        return false;
+    }
+    entry.use_soft_float_abi = flags[0] != 0;
+    entry.per_instruction_fast_math_flags = flags[1] != 0;
+    return true;
+}
+
+void save_jit_cache_entry(const string &path, const string &key, const JITCacheEntry &entry) {
+    // Write to a temporary file and rename it into place, so that
+    // other processes never see a partial entry.
+    std::random_device rd;
+    string temp_path = path + ".tmp" + std::to_string(((uint64_t)rd() << 32) | rd());
+    {
+        std::ofstream out(temp_path, std::ios::binary);
+        if (!out) {
+            debug(1) << "Could not write JIT cache entry " << temp_path << "\n";
+            return;
+        }
+        string flags = {(char)entry.use_soft_float_abi, (char)entry.per_instruction_fast_math_flags};
+        write_cache_string(out, key);
+        write_cache_string(out, entry.triple);
+        write_cache_string(out, entry.data_layout);
+        write_cache_string(out, entry.mcpu);
+        write_cache_string(out, entry.mattrs);
+        write_cache_string(out, flags);
+        write_cache_string(out, entry.object);
+        if (!out) {
+            out.close();
+            std::remove(temp_path.c_str());
+            return;
+        }
+    }
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+    }
 }
 
+// Make a module with no code, but with the target information of the
+// module a cache entry was compiled from.
+std::unique_ptr<llvm::Module> make_module_for_cache_entry(const JITCacheEntry &entry, const string &name,
+                                                          llvm::LLVMContext &context) {
+    std::unique_ptr<llvm::Module> m(new llvm::Module(name, context));
+    m->setTargetTriple(entry.triple);
+    m->setDataLayout(entry.data_layout);
+    m->addModuleFlag(llvm::Module::Warning, "halide_use_soft_float_abi", entry.use_soft_float_abi ? 1 : 0);
+    m->addModuleFlag(llvm::Module::Warning, "halide_mcpu", llvm::MDString::get(context, entry.mcpu));
+    m->addModuleFlag(llvm::Module::Warning, "halide_mattrs", llvm::MDString::get(context, entry.mattrs));
+    m->addModuleFlag(llvm::Module::Warning, "halide_per_instruction_fast_math_flags", entry.per_instruction_fast_math_flags);
+    return m;
+}
+
+// Saves the object MCJIT produces for a module to the JIT cache.
+class JITCacheWriter : public llvm::ObjectCache {
+    string path, key;
+    JITCacheEntry entry;
+
+public:
+    JITCacheWriter(const string &path, const string &key, const llvm::Module &m)
+        : path(path), key(key) {
+        llvm::TargetOptions options;
+        get_target_options(m, options, entry.mcpu, entry.mattrs);
+        entry.triple = m.getTargetTriple();
+        entry.data_layout = m.getDataLayout().getStringRepresentation();
+        entry.use_soft_float_abi = options.FloatABIType == llvm::FloatABI::Soft;
+        entry.per_instruction_fast_math_flags = !options.UnsafeFPMath;
+    }
+
+    void notifyObjectCompiled(const llvm::Module *, llvm::MemoryBufferRef obj) override {
+        entry.object.assign(obj.getBufferStart(), obj.getBufferSize());
+        debug(1) << "Saving JIT cache entry " << path << "\n";
+        save_jit_cache_entry(path, key, entry);
+    }
+
+    std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module *) override {
+        return nullptr;
+    }
+};
+
+void compile_module_impl(JITModule &jit, std::unique_ptr<llvm::Module> m, const string &function_name, const Target &target,
+                         const std::vector<JITModule> &dependencies,
+                         const std::vector<std::string> &requested_exports,
+                         const string *cached_object, llvm::ObjectCache *object_cache,
+                         bool drop_ir = false);
+
+}  // namespace
+
 JITModule::JITModule() {
     jit_module = new JITModuleContents();
 }
@@ -242,16 +425,90 @@ JITModule::JITModule() {
 JITModule::JITModule(const Module &m, const LoweredFunc &fn,
                      const std::vector<JITModule> &dependencies) {
     jit_module = new JITModuleContents();
-    std::unique_ptr<llvm::Module> llvm_module(compile_module_to_llvm_module(m, jit_module->context));
+
+    string cache_key, cache_path;
+    JITCacheEntry cache_entry;
+    bool cache_hit = false;
+    if (!get_env_variable("HL_JIT_CACHE_DIR").empty()) {
+        cache_key = jit_cache_key(m);
+        cache_path = jit_cache_path(cache_key);
+        cache_hit = load_jit_cache_entry(cache_path, cache_key, cache_entry);
+        debug(1) << "JIT cache " << (cache_hit ? "hit: " : "miss: ") << cache_path << "\n";
+    }
+
+    std::unique_ptr<llvm::Module> llvm_module;
+    if (cache_hit) {
+        llvm_module = make_module_for_cache_entry(cache_entry, m.name(), jit_module->context);
+    } else {
+        llvm_module = compile_module_to_llvm_module(m, jit_module->context);
+    }
     std::vector<JITModule> deps_with_runtime = dependencies;
     std::vector<JITModule> shared_runtime = JITSharedRuntime::get(llvm_module.get(), m.target());
     deps_with_runtime.insert(deps_with_runtime.end(), shared_runtime.begin(), shared_runtime.end());
-    compile_module(std::move(llvm_module), fn.name, m.target(), deps_with_runtime);
+    if (cache_hit) {
+        compile_module_impl(*this, std::move(llvm_module), fn.name, m.target(), deps_with_runtime, {},
+                            &cache_entry.object, nullptr, true);
+    } else if (!cache_path.empty()) {
+        JITCacheWriter writer(cache_path, cache_key, *llvm_module);
+        compile_module_impl(*this, std::move(llvm_module), fn.name, m.target(), deps_with_runtime, {},
+                            nullptr, &writer, true);
+    } else {
+        compile_module_impl(*this, std::move(llvm_module), fn.name, m.target(), deps_with_runtime, {},
+                            nullptr, nullptr, true);
+    }
+}
+
+std::vector<JITModule> JITModule::compile_functions(const Module &m,
+                                                   const std::vector<std::string> &function_names,
+                                                   const std::vector<JITModule> &dependencies) {
+    JITModule shared;
+    std::unique_ptr<llvm::Module> llvm_module = compile_module_to_llvm_module(m, shared.jit_module->context);
+    std::vector<JITModule> deps_with_runtime = dependencies;
+    std::vector<JITModule> shared_runtime = JITSharedRuntime::get(llvm_module.get(), m.target());
+    deps_with_runtime.insert(deps_with_runtime.end(), shared_runtime.begin(), shared_runtime.end());
+
+    std::vector<std::string> requested_exports;
+    for (const std::string &name : function_names) {
+        requested_exports.push_back(name);
+        requested_exports.push_back(name + "_argv");
+    }
+    compile_module_impl(shared, std::move(llvm_module), "", m.target(), deps_with_runtime, requested_exports,
+                        nullptr, nullptr, true);
+
+    // Each function gets a module of its own that just points into the
+    // shared one, so that it can be used like any other jitted function.
+    std::vector<JITModule> result;
+    for (const std::string &name : function_names) {
+        JITModule f;
+        f.jit_module->entrypoint = shared.jit_module->exports[name];
+        f.jit_module->argv_entrypoint = shared.jit_module->exports[name + "_argv"];
+        f.jit_module->exports[name] = f.jit_module->entrypoint;
+        f.jit_module->exports[name + "_argv"] = f.jit_module->argv_entrypoint;
+        f.jit_module->name = name;
+        f.add_dependency(shared);
+        result.push_back(f);
+    }
+    return result;
 }
 
 void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &function_name, const Target &target,
                                const std::vector<JITModule> &dependencies,
                                const std::vector<std::string> &requested_exports) {
+    compile_module_impl(*this, std::move(m), function_name, target, dependencies, requested_exports, nullptr, nullptr);
+}
+
+namespace {
+
+// Compile an llvm module, or if cached_object is non-null, load that
+// object instead, with the module only supplying the target
+// information. The object_cache, if any, is told about the object
+// that gets compiled. If drop_ir is set, the llvm module is freed once
+// it has been compiled, leaving only the machine code.
+void compile_module_impl(JITModule &jit, std::unique_ptr<llvm::Module> m, const string &function_name, const Target &target,
+                         const std::vector<JITModule> &dependencies,
+                         const std::vector<std::string> &requested_exports,
+                         const string *cached_object, llvm::ObjectCache *object_cache,
+                         bool drop_ir) {
 
     // Ensure that LLVM is initialized
     CodeGen_LLVM::initialize_llvm();
@@ -268,6 +525,7 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
 
     DataLayout initial_module_data_layout = m->getDataLayout();
     string module_name = m->getModuleIdentifier();
+    llvm::Module *llvm_module = m.get();
 
     llvm::EngineBuilder engine_builder((std::move(m)));
     engine_builder.setTargetOptions(options);
@@ -276,7 +534,8 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
     HalideJITMemoryManager *memory_manager = new HalideJITMemoryManager(dependencies);
     engine_builder.setMCJITMemoryManager(std::unique_ptr<RTDyldMemoryManager>(memory_manager));
 
-    engine_builder.setOptLevel(CodeGenOpt::Aggressive);
+    engine_builder.setOptLevel(target.has_feature(Target::NoOptimize) ?
+                               CodeGenOpt::None : CodeGenOpt::Aggressive);
     if (!mcpu.empty()) {
         engine_builder.setMCPU(mcpu);
     }
@@ -297,6 +556,16 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
     if (!ee) std::cerr << error_string << "\n";
     internal_assert(ee) << "Couldn't create execution engine\n";
 
+    if (cached_object) {
+        std::unique_ptr<llvm::MemoryBuffer> buf =
+            llvm::MemoryBuffer::getMemBufferCopy(*cached_object, module_name);
+        auto obj = llvm::object::ObjectFile::createObjectFile(buf->getMemBufferRef());
+        internal_assert(obj) << "Could not load JIT cache entry for " << module_name << "\n";
+        ee->addObjectFile(llvm::object::OwningBinary<llvm::object::ObjectFile>(std::move(*obj), std::move(buf)));
+    } else if (object_cache) {
+        ee->setObjectCache(object_cache);
+    }
+
     // Do any target-specific initialization
     std::vector<llvm::JITEventListener *> listeners;
 
@@ -314,10 +583,10 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
     // triggers compilation)
     debug(1) << "JIT compiling " << module_name << "\n";
 
-    std::map<std::string, Symbol> exports;
+    std::map<std::string, JITModule::Symbol> exports;
 
-    Symbol entrypoint;
-    Symbol argv_entrypoint;
+    JITModule::Symbol entrypoint;
+    JITModule::Symbol argv_entrypoint;
     if (!function_name.empty()) {
         entrypoint = compile_and_get_function(*ee, function_name);
         exports[function_name] = entrypoint;
@@ -343,15 +612,32 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
     // TODO: I don't think this is necessary, we shouldn't have any static constructors
     ee->runStaticConstructorsDestructors(false);
 
+    // The cache has already been told about the object, and doesn't
+    // outlive this call.
+    ee->setObjectCache(nullptr);
+
+    // Pipelines only need their machine code from here on, so free the
+    // IR, which is often larger. The shared runtime modules keep theirs,
+    // as they are searched for globals by name, and so does any module
+    // with static destructors still to run.
+    if (drop_ir && !llvm_module->getNamedGlobal("llvm.global_dtors")) {
+        debug(2) << "Dropping llvm module " << module_name << "\n";
+        if (ee->removeModule(llvm_module)) {
+            delete llvm_module;
+        }
+    }
+
     // Stash the various objects that need to stay alive behind a reference-counted pointer.
-    jit_module->exports = exports;
-    jit_module->execution_engine = ee;
-    jit_module->dependencies = dependencies;
-    jit_module->entrypoint = entrypoint;
-    jit_module->argv_entrypoint = argv_entrypoint;
-    jit_module->name = function_name;
+    jit.jit_module->exports = exports;
+    jit.jit_module->execution_engine = ee;
+    jit.jit_module->dependencies = dependencies;
+    jit.jit_module->entrypoint = entrypoint;
+    jit.jit_module->argv_entrypoint = argv_entrypoint;
+    jit.jit_module->name = function_name;
 }
 
+}  // namespace
+
 const std::map<std::string, JITModule::Symbol> &JITModule::exports() const {
     return jit_module->exports;
 }
@@ -454,7 +740,8 @@ void JITModule::memoization_cache_set_size(int64_t size) const {
 }
 
 bool JITModule::compiled() const {
-  return jit_module->execution_engine != nullptr;
+    return jit_module->execution_engine != nullptr ||
+        jit_module->entrypoint.address != nullptr;
 }
 
 namespace {
@@ -486,6 +773,9 @@ void merge_handlers(JITHandlers &base, const JITHandlers &addins) {
     if (addins.custom_trace) {
         base.custom_trace = addins.custom_trace;
     }
+    if (addins.custom_telemetry) {
+        base.custom_telemetry = addins.custom_telemetry;
+    }
     if (addins.custom_get_symbol) {
         base.custom_get_symbol = addins.custom_get_symbol;
     }
@@ -562,6 +852,16 @@ int32_t trace_handler(void *context, const halide_trace_event_t *e) {
     }
 }
 
+// Unlike the other handlers, the runtime has no default telemetry
+// handler, so there may be nothing to call.
+void telemetry_handler(void *context, const halide_telemetry_record_t *r) {
+    void (*handler)(void *, const halide_telemetry_record_t *) =
+        context ? ((JITUserContext *)context)->handlers.custom_telemetry : active_handlers.custom_telemetry;
+    if (handler) {
+        (*handler)(context, r);
+    }
+}
+
 void *get_symbol_handler(const char *name) {
     return (*active_handlers.custom_get_symbol)(name);
 }
@@ -725,6 +1025,9 @@ JITModule &make_module(llvm::Module *for_module, Target target,
             runtime_internal_handlers.custom_trace =
                 hook_function(runtime.exports(), "halide_set_custom_trace", trace_handler);
 
+            runtime_internal_handlers.custom_telemetry =
+                hook_function(runtime.exports(), "halide_set_custom_telemetry", telemetry_handler);
+
             runtime_internal_handlers.custom_get_symbol =
                 hook_function(shared_runtimes(MainShared).exports(), "halide_set_custom_get_symbol", get_symbol_handler);
 
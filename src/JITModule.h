@@ -43,6 +43,18 @@ struct JITModule {
     JITModule();
     JITModule(const Module &m, const LoweredFunc &fn,
                      const std::vector<JITModule> &dependencies = std::vector<JITModule>());
+
+    /** Compile several functions of a Halide Module together, with a
+     * single llvm module, execution engine and optimization pass, so
+     * that the runtime and the target machine are only set up once for
+     * all of them. Returns a JITModule per name in function_names, in
+     * the same order, each with its function as the entrypoint. They
+     * share their code, which stays alive as long as any of them
+     * does. */
+    static std::vector<JITModule> compile_functions(const Module &m,
+                                                    const std::vector<std::string> &function_names,
+                                                    const std::vector<JITModule> &dependencies = std::vector<JITModule>());
+
     /** The exports map of a JITModule contains all symbols which are
      * available to other JITModules which depend on this one. For
      * runtime modules, this is all of the symbols exported from the
@@ -116,7 +128,8 @@ struct JITModule {
     /** Encapsulate device (GPU) and buffer interactions. */
     void memoization_cache_set_size(int64_t size) const;
 
-    /** Return true if compile_module has been called on this module. */
+    /** Return true if compile_module has been called on this module,
+     * or if it is one of the modules returned by compile_functions. */
     bool compiled() const;
 };
 
@@ -130,6 +143,7 @@ struct JITHandlers {
     int (*custom_do_par_for)(void *, halide_task, int, int, uint8_t *){nullptr};
     void (*custom_error)(void *, const char *){nullptr};
     int32_t (*custom_trace)(void *, const halide_trace_event_t *){nullptr};
+    void (*custom_telemetry)(void *, const halide_telemetry_record_t *){nullptr};
     void *(*custom_get_symbol)(const char *name){nullptr};
     void *(*custom_load_library)(const char *name){nullptr};
     void *(*custom_get_library_symbol)(void *lib, const char *name){nullptr};
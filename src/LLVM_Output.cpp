@@ -407,6 +407,30 @@ void compile_llvm_module_to_llvm_assembly(llvm::Module &module, Internal::LLVMOS
     module.print(out, nullptr);
 }
 
+void compile_llvm_module_to_thinlto_bitcode(llvm::Module &module_in, Internal::LLVMOStream& out) {
+    // Work on a copy of the module to avoid modifying the original.
+    std::unique_ptr<llvm::Module> module = clone_module(module_in);
+
+    llvm::TargetOptions options;
+    std::string mcpu, mattrs;
+    Internal::get_target_options(*module, options, mcpu, mattrs);
+    for (llvm::Function &f : *module) {
+        if (f.isDeclaration()) {
+            continue;
+        }
+        if (!mcpu.empty() && !f.hasFnAttribute("target-cpu")) {
+            f.addFnAttr("target-cpu", mcpu);
+        }
+        if (!mattrs.empty() && !f.hasFnAttribute("target-features")) {
+            f.addFnAttr("target-features", mattrs);
+        }
+    }
+
+    llvm::legacy::PassManager pass_manager;
+    pass_manager.add(llvm::createWriteThinLTOBitcodePass(out));
+    pass_manager.run(*module);
+}
+
 // Note that the utilities for get/set working directory are deliberately *not* in Util.h;
 // generally speaking, you shouldn't ever need or want to do this, and doing so is asking for
 // trouble. This exists solely to work around an issue with LLVM, hence its restricted
@@ -45,6 +45,13 @@ void compile_llvm_module_to_llvm_bitcode(llvm::Module &module, Internal::LLVMOSt
 void compile_llvm_module_to_llvm_assembly(llvm::Module &module, Internal::LLVMOStream& out);
 // @}
 
+/** Compile an LLVM module to bitcode with a ThinLTO summary, to be
+ * optimized together with the code that calls it at link time (e.g. by
+ * linking with clang -flto=thin). Each function is marked with the CPU
+ * and features of the module's Target, as the link-time code generator
+ * otherwise knows nothing of them. */
+void compile_llvm_module_to_thinlto_bitcode(llvm::Module &module, Internal::LLVMOStream& out);
+
 /**
  * Concatenate the list of src_files into dst_file, using the appropriate
  * static library format for the given target (e.g., .a or .lib).
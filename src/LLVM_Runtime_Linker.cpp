@@ -1,5 +1,14 @@
 #include "LLVM_Runtime_Linker.h"
 #include "LLVM_Headers.h"
+#include "Debug.h"
+#include "Util.h"
+
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
 
 namespace Halide {
 
@@ -25,11 +34,26 @@ std::unique_ptr<llvm::Module> parse_bitcode_file(llvm::StringRef buf, llvm::LLVM
     return result;
 }
 
+// The bitcode of every initmod, so that caches of compiled code can be
+// keyed by a hash of the whole runtime.
+vector<std::pair<const unsigned char *, const int *>> &all_initmods() {
+    static vector<std::pair<const unsigned char *, const int *>> initmods;
+    return initmods;
+}
+
+struct RegisterInitmod {
+    RegisterInitmod(const unsigned char *bitcode, const int *length) {
+        all_initmods().push_back({bitcode, length});
+    }
+};
+
 }  // namespace
 
 #define DECLARE_INITMOD(mod)                                                              \
     extern "C" unsigned char halide_internal_initmod_##mod[];                             \
     extern "C" int halide_internal_initmod_##mod##_length;                                \
+    RegisterInitmod register_initmod_##mod(halide_internal_initmod_##mod,                 \
+                                           &halide_internal_initmod_##mod##_length);      \
     std::unique_ptr<llvm::Module> get_initmod_##mod(llvm::LLVMContext *context) {         \
         llvm::StringRef sb = llvm::StringRef((const char *)halide_internal_initmod_##mod, \
                                              halide_internal_initmod_##mod##_length);     \
@@ -68,6 +92,7 @@ std::unique_ptr<llvm::Module> parse_bitcode_file(llvm::StringRef buf, llvm::LLVM
 DECLARE_CPP_INITMOD(alignment_128)
 DECLARE_CPP_INITMOD(alignment_32)
 DECLARE_CPP_INITMOD(android_clock)
+DECLARE_CPP_INITMOD(android_hardware_buffer)
 DECLARE_CPP_INITMOD(android_host_cpu_count)
 DECLARE_CPP_INITMOD(android_io)
 DECLARE_CPP_INITMOD(android_opengl_context)
@@ -87,6 +112,7 @@ DECLARE_CPP_INITMOD(ios_io)
 DECLARE_CPP_INITMOD(linux_clock)
 DECLARE_CPP_INITMOD(linux_host_cpu_count)
 DECLARE_CPP_INITMOD(linux_opengl_context)
+DECLARE_CPP_INITMOD(linux_perf_counters)
 DECLARE_CPP_INITMOD(linux_yield)
 DECLARE_CPP_INITMOD(matlab)
 DECLARE_CPP_INITMOD(metadata)
@@ -100,10 +126,12 @@ DECLARE_CPP_INITMOD(opencl)
 DECLARE_CPP_INITMOD(opengl)
 DECLARE_CPP_INITMOD(openglcompute)
 DECLARE_CPP_INITMOD(osx_clock)
+DECLARE_CPP_INITMOD(osx_cv_pixel_buffer)
 DECLARE_CPP_INITMOD(osx_get_symbol)
 DECLARE_CPP_INITMOD(osx_host_cpu_count)
 DECLARE_CPP_INITMOD(osx_opengl_context)
 DECLARE_CPP_INITMOD(osx_yield)
+DECLARE_CPP_INITMOD(perf_counters_stubs)
 DECLARE_CPP_INITMOD(posix_allocator)
 DECLARE_CPP_INITMOD(posix_clock)
 DECLARE_CPP_INITMOD(posix_error_handler)
@@ -123,7 +151,10 @@ DECLARE_CPP_INITMOD(qurt_threads)
 DECLARE_CPP_INITMOD(qurt_threads_tsan)
 DECLARE_CPP_INITMOD(qurt_yield)
 DECLARE_CPP_INITMOD(runtime_api)
+DECLARE_CPP_INITMOD(shape_check_cache)
 DECLARE_CPP_INITMOD(ssp)
+DECLARE_CPP_INITMOD(telemetry)
+DECLARE_CPP_INITMOD(telemetry_inlined)
 DECLARE_CPP_INITMOD(to_string)
 DECLARE_CPP_INITMOD(tracing)
 DECLARE_CPP_INITMOD(windows_clock)
@@ -216,14 +247,32 @@ DECLARE_NO_INITMOD(powerpc)
 DECLARE_NO_INITMOD(powerpc_cpu_features)
 #endif  // WITH_POWERPC
 
+#ifdef WITH_WEBASSEMBLY
+DECLARE_CPP_INITMOD(wasm_allocator)
+DECLARE_CPP_INITMOD(wasm_cpu_features)
+DECLARE_CPP_INITMOD(wasm_host_cpu_count)
+#else
+DECLARE_NO_INITMOD(wasm_allocator)
+DECLARE_NO_INITMOD(wasm_cpu_features)
+DECLARE_NO_INITMOD(wasm_host_cpu_count)
+#endif  // WITH_WEBASSEMBLY
+
+#ifdef WITH_RISCV
+DECLARE_CPP_INITMOD(riscv_cpu_features)
+#else
+DECLARE_NO_INITMOD(riscv_cpu_features)
+#endif  // WITH_RISCV
+
 #ifdef WITH_HEXAGON
 DECLARE_LL_INITMOD(hvx_64)
 DECLARE_LL_INITMOD(hvx_128)
 DECLARE_CPP_INITMOD(hexagon_cpu_features)
+DECLARE_CPP_INITMOD(hexagon_dma)
 #else
 DECLARE_NO_INITMOD(hvx_64)
 DECLARE_NO_INITMOD(hvx_128)
 DECLARE_NO_INITMOD(hexagon_cpu_features)
+DECLARE_NO_INITMOD(hexagon_dma)
 #endif  // WITH_HEXAGON
 
 namespace {
@@ -282,6 +331,14 @@ llvm::DataLayout get_data_layout_for_target(Target target) {
         } else {
             return llvm::DataLayout("e-m:e-i64:64-n32:64");
         }
+    } else if (target.arch == Target::WebAssembly) {
+        return llvm::DataLayout("e-m:e-p:32:32-i64:64-n32:64-S128");
+    } else if (target.arch == Target::RISCV) {
+        if (target.bits == 32) {
+            return llvm::DataLayout("e-m:e-p:32:32-i64:64-n32-S128");
+        } else {
+            return llvm::DataLayout("e-m:e-p:64:64-i64:64-i128:128-n64-S128");
+        }
     } else if (target.arch == Target::Hexagon) {
         return llvm::DataLayout(
             "e-m:e-p:32:32:32-a:0-n16:32-i64:64:64-i32:32:32-i16:16:16-i1:8:8"
@@ -393,6 +450,43 @@ llvm::Triple get_triple_for_target(const Target &target) {
         #else
         user_error << "PowerPC llvm target not enabled in this build of Halide\n";
         #endif
+    } else if (target.arch == Target::WebAssembly) {
+        #if (WITH_WEBASSEMBLY)
+        user_assert(target.bits == 32) << "WebAssembly target must be 32-bit.\n";
+        user_assert(target.os == Target::WebAssemblyRuntime)
+            << "WebAssembly target must use the wasmrt OS.\n";
+        triple.setArch(llvm::Triple::wasm32);
+        triple.setVendor(llvm::Triple::UnknownVendor);
+        triple.setOS(llvm::Triple::UnknownOS);
+        #if LLVM_VERSION >= 50
+        triple.setObjectFormat(llvm::Triple::Wasm);
+        #endif
+        #else
+        user_error << "WebAssembly llvm target not enabled in this build of Halide\n";
+        #endif
+    } else if (target.arch == Target::RISCV) {
+        #if (WITH_RISCV)
+        if (target.bits == 32) {
+            triple.setArch(llvm::Triple::riscv32);
+        } else {
+            user_assert(target.bits == 64) << "Target must be 32- or 64-bit.\n";
+            triple.setArch(llvm::Triple::riscv64);
+        }
+        triple.setVendor(llvm::Triple::UnknownVendor);
+        if (target.os == Target::Linux) {
+            triple.setOS(llvm::Triple::Linux);
+            triple.setEnvironment(llvm::Triple::GNU);
+        } else if (target.os == Target::Android) {
+            triple.setOS(llvm::Triple::Linux);
+            triple.setEnvironment(llvm::Triple::Android);
+        } else if (target.os == Target::NoOS) {
+            triple.setOS(llvm::Triple::UnknownOS);
+        } else {
+            user_error << "No RISC-V support for this OS\n";
+        }
+        #else
+        user_error << "RISC-V llvm target not enabled in this build of Halide\n";
+        #endif
     } else if (target.arch == Target::Hexagon) {
         triple.setVendor(llvm::Triple::UnknownVendor);
         triple.setArch(llvm::Triple::hexagon);
@@ -591,31 +685,17 @@ void add_underscores_to_posix_calls_on_windows(llvm::Module *m) {
     }
 }
 
-/** Create an llvm module containing the support code for a given target. */
-std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVMContext *c, bool for_shared_jit_runtime, bool just_gpu) {
-    enum InitialModuleType {
-        ModuleAOT,
-        ModuleAOTNoRuntime,
-        ModuleJITShared,
-        ModuleJITInlined,
-        ModuleGPU
-    } module_type;
+namespace {
 
-    if (t.has_feature(Target::JIT)) {
-        if (just_gpu) {
-            module_type = ModuleGPU;
-        } else if (for_shared_jit_runtime) {
-            module_type = ModuleJITShared;
-        } else {
-            module_type = ModuleJITInlined;
-        }
-    } else if (t.has_feature(Target::NoRuntime)) {
-        module_type = ModuleAOTNoRuntime;
-    } else {
-        module_type = ModuleAOT;
-    }
+enum InitialModuleType {
+    ModuleAOT,
+    ModuleAOTNoRuntime,
+    ModuleJITShared,
+    ModuleJITInlined,
+    ModuleGPU
+};
 
-    //    Halide::Internal::debug(0) << "Getting initial module type " << (int)module_type << "\n";
+std::unique_ptr<llvm::Module> link_initial_module(Target t, InitialModuleType module_type, llvm::LLVMContext *c) {
 
     internal_assert(t.bits == 32 || t.bits == 64)
         << "Bad target: " << t.to_string();
@@ -662,6 +742,7 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                     modules.push_back(get_initmod_posix_threads(c, bits_64, debug));
                 }
                 modules.push_back(get_initmod_osx_get_symbol(c, bits_64, debug));
+                modules.push_back(get_initmod_osx_cv_pixel_buffer(c, bits_64, debug));
             } else if (t.os == Target::Android) {
                 modules.push_back(get_initmod_posix_allocator(c, bits_64, debug));
                 modules.push_back(get_initmod_posix_error_handler(c, bits_64, debug));
@@ -681,6 +762,7 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                     modules.push_back(get_initmod_posix_threads(c, bits_64, debug));
                 }
                 modules.push_back(get_initmod_posix_get_symbol(c, bits_64, debug));
+                modules.push_back(get_initmod_android_hardware_buffer(c, bits_64, debug));
             } else if (t.os == Target::Windows) {
                 modules.push_back(get_initmod_posix_allocator(c, bits_64, debug));
                 modules.push_back(get_initmod_posix_error_handler(c, bits_64, debug));
@@ -712,6 +794,8 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 } else {
                     modules.push_back(get_initmod_posix_threads(c, bits_64, debug));
                 }
+                modules.push_back(get_initmod_osx_get_symbol(c, bits_64, debug));
+                modules.push_back(get_initmod_osx_cv_pixel_buffer(c, bits_64, debug));
             } else if (t.os == Target::QuRT) {
                 modules.push_back(get_initmod_qurt_allocator(c, bits_64, debug));
                 modules.push_back(get_initmod_qurt_yield(c, bits_64, debug));
@@ -731,6 +815,21 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                     modules.push_back(get_initmod_qurt_allocator(c, bits_64, debug));
                 }
                 modules.push_back(get_initmod_fake_thread_pool(c, bits_64, debug));
+            } else if (t.os == Target::WebAssemblyRuntime) {
+                modules.push_back(get_initmod_wasm_allocator(c, bits_64, debug));
+                modules.push_back(get_initmod_posix_error_handler(c, bits_64, debug));
+                modules.push_back(get_initmod_posix_print(c, bits_64, debug));
+                modules.push_back(get_initmod_posix_clock(c, bits_64, debug));
+                modules.push_back(get_initmod_posix_io(c, bits_64, debug));
+                modules.push_back(get_initmod_wasm_host_cpu_count(c, bits_64, debug));
+                if (t.has_feature(Target::WasmThreads)) {
+                    // Emscripten runs pthreads on web workers that
+                    // share the module's memory.
+                    modules.push_back(get_initmod_linux_yield(c, bits_64, debug));
+                    modules.push_back(get_initmod_posix_threads(c, bits_64, debug));
+                } else {
+                    modules.push_back(get_initmod_fake_thread_pool(c, bits_64, debug));
+                }
             }
         }
 
@@ -761,6 +860,7 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 // though...).
                 modules.push_back(get_initmod_tracing(c, bits_64, debug));
                 modules.push_back(get_initmod_write_debug_image(c, bits_64, debug));
+                modules.push_back(get_initmod_telemetry(c, bits_64, debug));
 
                 // TODO: Support this module in the Hexagon backend,
                 // currently generates assert at src/HexagonOffload.cpp:279
@@ -780,6 +880,7 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
             modules.push_back(get_initmod_metadata(c, bits_64, debug));
             modules.push_back(get_initmod_float16_t(c, bits_64, debug));
             modules.push_back(get_initmod_errors(c, bits_64, debug));
+            modules.push_back(get_initmod_shape_check_cache(c, bits_64, debug));
 
 
             // Note that we deliberately include this module, even if Target::LegacyBufferWrappers
@@ -788,14 +889,21 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
             // built without.
             modules.push_back(get_initmod_old_buffer_t(c, bits_64, debug));
 
-            // MIPS doesn't support the atomics the profiler requires.
+            // MIPS doesn't support the atomics the profiler requires,
+            // and WebAssembly only has them with threads.
             if (t.arch != Target::MIPS && t.os != Target::NoOS &&
-                t.os != Target::QuRT) {
+                t.os != Target::QuRT &&
+                (t.arch != Target::WebAssembly || t.has_feature(Target::WasmThreads))) {
                 if (t.os == Target::Windows) {
                     modules.push_back(get_initmod_windows_profiler(c, bits_64, debug));
                 } else {
                     modules.push_back(get_initmod_profiler(c, bits_64, debug));
                 }
+                if (t.os == Target::Linux && t.arch == Target::X86) {
+                    modules.push_back(get_initmod_linux_perf_counters(c, bits_64, debug));
+                } else {
+                    modules.push_back(get_initmod_perf_counters_stubs(c, bits_64, debug));
+                }
             }
 
             if (t.has_feature(Target::MSAN)) {
@@ -849,6 +957,12 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
             if (t.has_feature(Target::Profile)) {
                 modules.push_back(get_initmod_profiler_inlined(c, bits_64, debug));
             }
+            // x86.ll and aarch64.ll read the cycle counter for latency
+            // telemetry. Elsewhere it falls back to the clock.
+            if (t.arch != Target::X86 && t.arch != Target::Hexagon &&
+                !(t.arch == Target::ARM && t.bits == 64)) {
+                modules.push_back(get_initmod_telemetry_inlined(c, bits_64, debug));
+            }
         }
 
         if (module_type == ModuleAOT) {
@@ -870,8 +984,17 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
             if (t.arch == Target::POWERPC) {
                 modules.push_back(get_initmod_powerpc_cpu_features(c, bits_64, debug));
             }
+            if (t.arch == Target::WebAssembly) {
+                modules.push_back(get_initmod_wasm_cpu_features(c, bits_64, debug));
+            }
+            if (t.arch == Target::RISCV) {
+                modules.push_back(get_initmod_riscv_cpu_features(c, bits_64, debug));
+            }
             if (t.arch == Target::Hexagon) {
                 modules.push_back(get_initmod_hexagon_cpu_features(c, bits_64, debug));
+                // Code on the DSP, offloaded or not, can move its
+                // inputs into VTCM with the user DMA engine.
+                modules.push_back(get_initmod_hexagon_dma(c, bits_64, debug));
             }
         }
 
@@ -965,6 +1088,155 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
     return std::move(modules[0]);
 }
 
+// The linked runtime depends only on the target and the module type,
+// but llvm modules belong to a single LLVMContext, so the cache holds
+// bitcode and parses a fresh module out of it for each request.
+// Parsing one module is much cheaper than parsing and linking the
+// dozens of initmods it was built from.
+std::mutex runtime_cache_mutex;
+std::map<string, string> runtime_cache;
+
+uint64_t fnv1a_hash(uint64_t h, const char *data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        h = (h ^ (uint8_t)data[i]) * 1099511628211ULL;
+    }
+    return h;
+}
+
+string runtime_cache_key(const Target &t, InitialModuleType module_type) {
+    std::ostringstream key;
+    key << "Halide runtime cache\n"
+        << "LLVM " << LLVM_VERSION << "\n"
+        << "Halide runtime " << std::hex << get_runtime_hash() << std::dec << "\n"
+        << (int)module_type << " " << t.to_string() << "\n";
+    return key.str();
+}
+
+string runtime_cache_path(const string &key) {
+    string dir = get_env_variable("HL_RUNTIME_CACHE_DIR");
+    if (dir.empty()) {
+        return "";
+    }
+    std::ostringstream path;
+    path << dir << "/halide_runtime_" << std::hex << fnv1a_hash(14695981039346656037ULL, key.data(), key.size()) << ".bc";
+    return path.str();
+}
+
+// A cache file is the key followed by the bitcode, so that a hash
+// collision reads as a miss.
+bool load_runtime_cache_file(const string &path, const string &key, string &bitcode) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    string stored_key(key.size(), '\0');
+    if (!in.read(&stored_key[0], key.size()) || stored_key != key) {
+        return false;
+    }
+    std::ostringstream contents;
+    contents << in.rdbuf();
+    bitcode = contents.str();
+    return !bitcode.empty();
+}
+
+void save_runtime_cache_file(const string &path, const string &key, const string &bitcode) {
+    // Write to a temporary file and rename it into place, so that
+    // concurrent builds never see a partial file.
+    std::random_device rd;
+    string tmp = path + ".tmp" + std::to_string(((uint64_t)rd() << 32) | rd());
+    {
+        std::ofstream out(tmp, std::ios::binary);
+        out.write(key.data(), key.size());
+        out.write(bitcode.data(), bitcode.size());
+        if (!out) {
+            debug(1) << "Unable to write runtime cache file " << tmp << "\n";
+            return;
+        }
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::remove(tmp.c_str());
+    }
+}
+
+}  // namespace
+
+uint64_t get_runtime_hash() {
+    static uint64_t hash = 0;
+    static std::once_flag hash_once;
+    std::call_once(hash_once, []() {
+        uint64_t h = 14695981039346656037ULL;
+        for (const auto &initmod : all_initmods()) {
+            h = fnv1a_hash(h, (const char *)initmod.first, *initmod.second);
+        }
+        hash = h;
+    });
+    return hash;
+}
+
+/** Create an llvm module containing the support code for a given target. */
+std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVMContext *c, bool for_shared_jit_runtime, bool just_gpu) {
+    InitialModuleType module_type;
+    if (t.has_feature(Target::JIT)) {
+        if (just_gpu) {
+            module_type = ModuleGPU;
+        } else if (for_shared_jit_runtime) {
+            module_type = ModuleJITShared;
+        } else {
+            module_type = ModuleJITInlined;
+        }
+    } else if (t.has_feature(Target::NoRuntime)) {
+        module_type = ModuleAOTNoRuntime;
+    } else {
+        module_type = ModuleAOT;
+    }
+
+    //    Halide::Internal::debug(0) << "Getting initial module type " << (int)module_type << "\n";
+
+    string key = runtime_cache_key(t, module_type);
+    string bitcode;
+    {
+        std::lock_guard<std::mutex> lock(runtime_cache_mutex);
+        auto it = runtime_cache.find(key);
+        if (it != runtime_cache.end()) {
+            bitcode = it->second;
+        }
+    }
+
+    string path;
+    if (bitcode.empty()) {
+        path = runtime_cache_path(key);
+        if (!path.empty() && load_runtime_cache_file(path, key, bitcode)) {
+            debug(1) << "Runtime cache hit: " << path << "\n";
+            std::lock_guard<std::mutex> lock(runtime_cache_mutex);
+            runtime_cache[key] = bitcode;
+        }
+    }
+
+    if (!bitcode.empty()) {
+        return parse_bitcode_file(bitcode, c, "runtime");
+    }
+
+    std::unique_ptr<llvm::Module> module = link_initial_module(t, module_type, c);
+
+    {
+        llvm::SmallVector<char, 16> buffer;
+        llvm::raw_svector_ostream out(buffer);
+#if LLVM_VERSION >= 70
+        WriteBitcodeToFile(*module, out);
+#else
+        WriteBitcodeToFile(module.get(), out);
+#endif
+        bitcode.assign(buffer.data(), buffer.size());
+    }
+    if (!path.empty()) {
+        debug(1) << "Runtime cache miss: " << path << "\n";
+        save_runtime_cache_file(path, key, bitcode);
+    }
+    std::lock_guard<std::mutex> lock(runtime_cache_mutex);
+    runtime_cache[key] = std::move(bitcode);
+    return module;
+}
+
 #ifdef WITH_PTX
 std::unique_ptr<llvm::Module> get_initial_module_for_ptx_device(Target target, llvm::LLVMContext *c) {
     std::vector<std::unique_ptr<llvm::Module>> modules;
@@ -20,6 +20,11 @@ namespace Internal {
 /** Return the llvm::Triple that corresponds to the given Halide Target */
 llvm::Triple get_triple_for_target(const Target &target);
 
+/** A hash of the bitcode of every part of the runtime built into
+ * Halide. It changes whenever the runtime does, so it keys caches of
+ * compiled code by the version of Halide that made them. */
+uint64_t get_runtime_hash();
+
 /** Create an llvm module containing the support code for a given target. */
 std::unique_ptr<llvm::Module> get_initial_module_for_target(Target, llvm::LLVMContext *, bool for_shared_jit_runtime = false, bool just_gpu = false);
 
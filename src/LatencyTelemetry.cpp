@@ -0,0 +1,85 @@
+#include "LatencyTelemetry.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+
+#include <algorithm>
+
+namespace Halide {
+namespace Internal {
+
+using std::string;
+using std::vector;
+
+namespace {
+
+const char *ticks_buf_name = "telemetry_ticks";
+const char *stage_names_buf_name = "telemetry_stage_names";
+
+Stmt record_ticks(int slot) {
+    Expr ticks = Call::make(UInt(64), "halide_telemetry_ticks", {}, Call::Extern);
+    return Store::make(ticks_buf_name, ticks, slot, Parameter(), const_true());
+}
+
+class InjectLatencyTelemetry : public IRMutator2 {
+    using IRMutator2::visit;
+
+    int loop_depth = 0;
+
+    Stmt visit(const For *op) override {
+        loop_depth++;
+        Stmt s = IRMutator2::visit(op);
+        loop_depth--;
+        return s;
+    }
+
+    Stmt visit(const ProducerConsumer *op) override {
+        if (!op->is_producer || loop_depth > 0) {
+            return IRMutator2::visit(op);
+        }
+        int slot = 2 + 2 * (int)stages.size();
+        stages.push_back(op->name);
+        Stmt body = mutate(op->body);
+        body = Block::make({record_ticks(slot), body, record_ticks(slot + 1)});
+        return ProducerConsumer::make(op->name, op->is_producer, body);
+    }
+
+public:
+    vector<string> stages;
+};
+
+}  // namespace
+
+Stmt inject_latency_telemetry(Stmt s, const string &pipeline_name) {
+    InjectLatencyTelemetry telemetry;
+    s = telemetry.mutate(s);
+
+    int num_stages = (int)telemetry.stages.size();
+    int num_ticks = 2 + 2 * num_stages;
+
+    Expr report = Call::make(Int(32), "halide_telemetry_report",
+                             {pipeline_name, num_stages,
+                              Variable::make(Handle(), stage_names_buf_name),
+                              Variable::make(Handle(), ticks_buf_name)},
+                             Call::Extern);
+    s = Block::make({record_ticks(0), s, record_ticks(1), Evaluate::make(report)});
+
+    // Stages that don't run, e.g. in bounds queries, report zero.
+    for (int i = num_ticks - 1; i >= 2; i--) {
+        s = Block::make(Store::make(ticks_buf_name, make_zero(UInt(64)), i,
+                                    Parameter(), const_true()), s);
+    }
+    s = Allocate::make(ticks_buf_name, UInt(64), MemoryType::Stack,
+                       {num_ticks}, const_true(), s);
+
+    for (int i = num_stages - 1; i >= 0; i--) {
+        s = Block::make(Store::make(stage_names_buf_name, telemetry.stages[i], i,
+                                    Parameter(), const_true()), s);
+    }
+    s = Allocate::make(stage_names_buf_name, Handle(), MemoryType::Stack,
+                       {std::max(num_stages, 1)}, const_true(), s);
+
+    return s;
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,25 @@
+#ifndef HALIDE_LATENCY_TELEMETRY_H
+#define HALIDE_LATENCY_TELEMETRY_H
+
+/** \file
+ * Defines the lowering pass that times pipeline calls and their
+ * compute_root stages for latency telemetry.
+ */
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Record the value of the CPU's cycle counter at the start and end of
+ * the pipeline, and of the production of each stage that isn't inside
+ * any loop, into a buffer on the stack. At the end of the pipeline the
+ * buffer is passed to halide_telemetry_report, which hands it to the
+ * function set with halide_set_custom_telemetry. Should be done after
+ * storage flattening. Enabled by the LatencyTelemetry target feature. */
+Stmt inject_latency_telemetry(Stmt s, const std::string &pipeline_name);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
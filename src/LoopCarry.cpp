@@ -193,8 +193,31 @@ class LoopCarryOverLoop : public IRMutator2 {
 
     int max_carried_values;
 
+    // When carrying values across an outer loop, the inner loop whose
+    // iterations each get their own scratch slots, and the number of
+    // containing lets outside of it.
+    string inner_var;
+    Expr inner_min;
+    int inner_extent = 1;
+    size_t inner_lets_begin = 0;
+
     using IRMutator2::visit;
 
+    /** The index in a chain's scratch buffer of the i'th value of the
+     * chain, for the current iteration of the inner loop if there is
+     * one. */
+    Expr slot_index(int i, Type t, int chain_size) {
+        if (inner_var.empty()) {
+            return scratch_index(i, t);
+        }
+        Expr slot = simplify((Variable::make(Int(32), inner_var) - inner_min) * chain_size + i);
+        if (t.is_scalar()) {
+            return slot;
+        } else {
+            return Ramp::make(slot * t.lanes(), 1, t.lanes());
+        }
+    }
+
     Stmt visit(const LetStmt *op) override {
         // Track containing LetStmts and their linearity w.r.t. the
         // loop variable.
@@ -309,7 +332,7 @@ class LoopCarryOverLoop : public IRMutator2 {
         }
 
         if (chains.empty()) {
-            return orig_stmt;
+            return deduplicate_loads(orig_stmt, graph_stmt, loads, {});
         }
 
         // Agglomerate chains of carries
@@ -351,13 +374,16 @@ class LoopCarryOverLoop : public IRMutator2 {
         // Only keep the top N carried values. Otherwise we'll just
         // spray stack spills everywhere. This is ugly, because we're
         // relying on a heuristic.
+        // When carrying across an outer loop, each value in a chain
+        // is held once per iteration of the inner loop.
         vector<vector<int>> trimmed;
         size_t sz = 0;
+        const size_t budget = max_carried_values / inner_extent;
         for (const vector<int> &c : chains) {
-            if (sz + c.size() > (size_t)max_carried_values) {
-                if (sz < (size_t)max_carried_values - 1) {
+            if (sz + c.size() > budget) {
+                if (sz + 1 < budget) {
                     // Take a partial chain
-                    trimmed.emplace_back(c.begin(), c.begin() + max_carried_values - sz);
+                    trimmed.emplace_back(c.begin(), c.begin() + budget - sz);
                 }
                 break;
             }
@@ -366,6 +392,10 @@ class LoopCarryOverLoop : public IRMutator2 {
         }
         chains.swap(trimmed);
 
+        if (chains.empty()) {
+            return deduplicate_loads(orig_stmt, graph_stmt, loads, {});
+        }
+
         // We now have chains of the form:
         // f[x] <- f[x+1] <- ... <- f[x+N-1]
 
@@ -382,14 +412,17 @@ class LoopCarryOverLoop : public IRMutator2 {
         vector<Stmt> not_first_iteration_scratch_stores;
         vector<Stmt> scratch_shuffles;
         Stmt core = graph_stmt;
+        set<int> carried;
 
         for (const vector<int> &c : chains) {
             string scratch = unique_name('c');
             vector<Expr> initial_scratch_values;
+            const int chain_size = (int)c.size();
 
             for (size_t i = 0; i < c.size(); i++) {
                 const Load *orig_load = loads[c[i]][0];
-                Expr scratch_idx = scratch_index(i, orig_load->type);
+                carried.insert(c[i]);
+                Expr scratch_idx = slot_index(i, orig_load->type, chain_size);
                 Expr load_from_scratch = Load::make(orig_load->type, scratch, scratch_idx,
                                                     Buffer<>(), Parameter(), const_true(orig_load->type.lanes()));
                 for (const Load *l : loads[c[i]]) {
@@ -405,7 +438,7 @@ class LoopCarryOverLoop : public IRMutator2 {
                 }
                 if (i > 0) {
                     Stmt shuffle = Store::make(scratch, load_from_scratch,
-                                               scratch_index(i-1, orig_load->type),
+                                               slot_index(i-1, orig_load->type, chain_size),
                                                Parameter(), const_true(orig_load->type.lanes()));
                     scratch_shuffles.push_back(shuffle);
                 }
@@ -432,7 +465,7 @@ class LoopCarryOverLoop : public IRMutator2 {
             // Create the initial stores to scratch
             vector<Stmt> initial_scratch_stores;
             for (size_t i = 0; i < c.size() - 1; i++) {
-                Expr scratch_idx = scratch_index(i, initial_scratch_values[i].type());
+                Expr scratch_idx = slot_index(i, initial_scratch_values[i].type(), chain_size);
                 Stmt store_to_scratch = Store::make(scratch, initial_scratch_values[i],
                                                     scratch_idx, Parameter(),
                                                     const_true(scratch_idx.type().lanes()));
@@ -447,32 +480,101 @@ class LoopCarryOverLoop : public IRMutator2 {
                 initial_stores = LetStmt::make(l.first, l.second, initial_stores);
             }
             // We may be lifting the initial stores out of let stmts,
-            // so rewrap them in the necessary ones.
+            // so rewrap them in the necessary ones. If there's an inner
+            // loop, the initial stores populate the slots of all of its
+            // iterations.
             for (size_t i = containing_lets.size(); i > 0; i--) {
+                if (!inner_var.empty() && i == inner_lets_begin) {
+                    initial_stores = For::make(inner_var, inner_min, inner_extent,
+                                               ForType::Serial, DeviceAPI::None, initial_stores);
+                }
                 auto l = containing_lets[i-1];
                 if (stmt_uses_var(initial_stores, l.first)) {
                     initial_stores = LetStmt::make(l.first, l.second, initial_stores);
                 }
             }
+            if (!inner_var.empty() && inner_lets_begin == 0) {
+                initial_stores = For::make(inner_var, inner_min, inner_extent,
+                                           ForType::Serial, DeviceAPI::None, initial_stores);
+            }
 
             allocs.push_back({scratch,
                         loads[c.front()][0]->type.element_of(),
-                        (int)c.size() * loads[c.front()][0]->type.lanes(),
+                        chain_size * inner_extent * loads[c.front()][0]->type.lanes(),
                         initial_stores});
         }
 
         Stmt s = Block::make(not_first_iteration_scratch_stores);
-        s = Block::make(s, core);
+        s = Block::make(s, deduplicate_loads(Stmt(), core, loads, carried));
         s = Block::make(s, Block::make(scratch_shuffles));
         s = common_subexpression_elimination(s);
         return s;
     }
 
+    /** Loads of the same value in different stmts of a block (e.g. the
+     * neighboring taps of an unrolled stencil) aren't shared by
+     * CSE. Load each one once, before the stmts. Returns orig_stmt if
+     * there's nothing to share. */
+    Stmt deduplicate_loads(const Stmt &orig_stmt, const Stmt &graph_stmt,
+                           const vector<vector<const Load *>> &loads,
+                           const set<int> &carried) {
+        Stmt s = graph_stmt;
+        vector<pair<string, Expr>> lets;
+        for (int i = 0; i < (int)loads.size(); i++) {
+            if (loads[i].size() < 2 || carried.count(i)) {
+                continue;
+            }
+            string name = unique_name('t');
+            Expr var = Variable::make(loads[i][0]->type, name);
+            for (const Load *l : loads[i]) {
+                s = graph_substitute(l, var, s);
+            }
+            lets.push_back({name, loads[i][0]});
+        }
+        if (lets.empty() && orig_stmt.defined()) {
+            return orig_stmt;
+        }
+        debug(3) << "Sharing " << lets.size() << " repeated loads\n";
+        for (size_t i = lets.size(); i > 0; i--) {
+            s = LetStmt::make(lets[i-1].first, lets[i-1].second, s);
+        }
+        if (orig_stmt.defined()) {
+            s = common_subexpression_elimination(s);
+        }
+        return s;
+    }
+
     Stmt visit(const For *op) override {
         // Don't lift loads out of code that might not run. Besides,
         // stashing things in registers while we run an inner loop
-        // probably isn't a good use of registers.
-        return op;
+        // probably isn't a good use of registers, unless the inner loop
+        // is short enough that the values for every one of its
+        // iterations fit in registers. In that case, carry values
+        // across the loop we're in, with a slot per iteration of the
+        // inner loop.
+        const int64_t *extent = as_const_int(op->extent);
+        if (!inner_var.empty() ||
+            op->for_type != ForType::Serial ||
+            !extent || *extent < 1 ||
+            *extent * 2 > max_carried_values ||
+            !is_zero(is_linear(op->min, linear))) {
+            return op;
+        }
+
+        inner_var = op->name;
+        inner_min = op->min;
+        inner_extent = (int)*extent;
+        inner_lets_begin = containing_lets.size();
+        Stmt body = mutate(op->body);
+        inner_var.clear();
+        inner_min = Expr();
+        inner_extent = 1;
+
+        if (body.same_as(op->body)) {
+            return op;
+        } else {
+            return For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+        }
     }
 
     Stmt visit(const IfThenElse *op) override {
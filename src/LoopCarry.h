@@ -8,7 +8,11 @@ namespace Internal {
 
 /** Reuse loads done on previous loop iterations by stashing them in
  * induction variables instead of redoing the load. If the loads are
- * predicated, the predicates need to match. Can be an optimization or
+ * predicated, the predicates need to match. Values can also be carried
+ * across a loop containing a short serial inner loop, in which case
+ * each iteration of the inner loop gets its own slots, counted against
+ * max_carried_values. Equal loads in neighboring stores (e.g. unrolled
+ * stencil taps) are done once. Can be an optimization or
  * pessimization depending on how good the L1 cache is on the architecture
  * and how many memory issue slots there are. Currently only intended
  * for Hexagon. */
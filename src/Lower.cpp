@@ -1,13 +1,25 @@
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <set>
 #include <sstream>
 #include <algorithm>
 
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
 #include "Lower.h"
 
 #include "AddImageChecks.h"
 #include "AddParameterChecks.h"
 #include "AllocationBoundsInference.h"
+#include "ArenaAllocations.h"
+#include "AsyncProducers.h"
+#include "AutoSchedule.h"
 #include "Bounds.h"
 #include "BoundsInference.h"
 #include "BoundSmallAllocations.h"
@@ -19,30 +31,39 @@
 #include "Deinterleave.h"
 #include "EarlyFree.h"
 #include "FindCalls.h"
+#include "FoldConstantFuncs.h"
 #include "Func.h"
 #include "Function.h"
+#include "FuseGPUStages.h"
 #include "FuseGPUThreadLoops.h"
 #include "FuzzFloatStores.h"
 #include "HexagonOffload.h"
+#include "HoistDivisors.h"
 #include "InferArguments.h"
+#include "InferComputeWith.h"
 #include "InjectHostDevBufferCopies.h"
 #include "InjectOpenGLIntrinsics.h"
 #include "Inline.h"
+#include "InternExprs.h"
 #include "IRMutator.h"
 #include "IROperator.h"
 #include "IRPrinter.h"
+#include "LatencyTelemetry.h"
 #include "LICM.h"
 #include "LoopCarry.h"
 #include "LowerWarpShuffles.h"
 #include "Memoization.h"
+#include "NarrowIndices.h"
 #include "PartitionLoops.h"
 #include "Prefetch.h"
 #include "Profiling.h"
 #include "Qualify.h"
+#include "Random.h"
 #include "RealizationOrder.h"
 #include "RemoveDeadAllocations.h"
 #include "RemoveTrivialForLoops.h"
 #include "RemoveUndef.h"
+#include "ReuseProducerStorage.h"
 #include "ScheduleFunctions.h"
 #include "SelectGPUAPI.h"
 #include "SkipStages.h"
@@ -60,6 +81,7 @@
 #include "UniquifyVariableNames.h"
 #include "UnpackBuffers.h"
 #include "UnrollLoops.h"
+#include "Util.h"
 #include "VaryingAttributes.h"
 #include "VectorizeLoops.h"
 #include "WrapCalls.h"
@@ -74,6 +96,176 @@ using std::string;
 using std::vector;
 using std::map;
 
+namespace {
+
+// Count the distinct IR nodes in a Stmt.
+class CountNodes : public IRGraphVisitor {
+    using IRGraphVisitor::include;
+
+    void include(const Expr &e) override {
+        count++;
+        IRGraphVisitor::include(e);
+    }
+
+    void include(const Stmt &s) override {
+        count++;
+        IRGraphVisitor::include(s);
+    }
+
+public:
+    int64_t count = 0;
+};
+
+int64_t count_nodes(const Stmt &s) {
+    if (!s.defined()) {
+        return 0;
+    }
+    CountNodes c;
+    s.accept(&c);
+    return c.count;
+}
+
+string json_escape(const string &str) {
+    ostringstream out;
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if ((unsigned char)c < 0x20) {
+            out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c << std::dec;
+        } else {
+            out << c;
+        }
+    }
+    return out.str();
+}
+
+// The resident set size of the process, and the peak resident set
+// size so far, in bytes. Either is zero where the platform doesn't
+// report it.
+void get_memory_usage(int64_t &resident, int64_t &peak) {
+    resident = peak = 0;
+#ifndef _WIN32
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+        peak = (int64_t)usage.ru_maxrss;
+#else
+        peak = (int64_t)usage.ru_maxrss * 1024;
+#endif
+    }
+#endif
+#ifdef __linux__
+    std::ifstream statm("/proc/self/statm");
+    int64_t size = 0, pages = 0;
+    if (statm >> size >> pages) {
+        resident = pages * (int64_t)sysconf(_SC_PAGESIZE);
+    }
+#endif
+}
+
+// Records the wall time, the change in IR size, the memory use, and
+// the number of calls to the simplifier of each pass of lowering. The
+// numbers are printed at debug level 1, and if HL_LOWER_PROFILE names
+// a file, a line of JSON per pipeline is appended to it. Simplifier
+// calls made, and memory allocated, by other threads lowering at the
+// same time are counted too.
+class LoweringProfiler {
+    typedef std::chrono::high_resolution_clock Clock;
+
+    struct Pass {
+        string name;
+        double seconds;
+        int64_t nodes_before, nodes_after, simplify_calls;
+        // The process's resident and peak resident memory at the end
+        // of the pass.
+        int64_t resident_bytes, peak_bytes;
+    };
+
+    string pipeline_name, target, profile_file;
+    bool enabled;
+    vector<Pass> passes;
+    Clock::time_point start, pass_start;
+    int64_t pass_simplify_calls = 0;
+
+    void end_pass(const Stmt &s) {
+        if (passes.empty()) {
+            return;
+        }
+        Pass &p = passes.back();
+        p.seconds = std::chrono::duration<double>(Clock::now() - pass_start).count();
+        p.nodes_after = count_nodes(s);
+        p.simplify_calls = simplify_call_count() - pass_simplify_calls;
+        get_memory_usage(p.resident_bytes, p.peak_bytes);
+    }
+
+public:
+    LoweringProfiler(const string &pipeline_name, const Target &t)
+        : pipeline_name(pipeline_name), target(t.to_string()),
+          profile_file(get_env_variable("HL_LOWER_PROFILE")) {
+        enabled = debug::debug_level() >= 1 || !profile_file.empty();
+        start = Clock::now();
+    }
+
+    // Finish the current pass, if any, and start a new one. The
+    // argument is the IR as it stands between the two.
+    void begin_pass(const string &name, const Stmt &s) {
+        debug(1) << name << "\n";
+        if (!enabled) {
+            return;
+        }
+        end_pass(s);
+        passes.push_back({name, 0, passes.empty() ? count_nodes(s) : passes.back().nodes_after, 0, 0, 0, 0});
+        pass_simplify_calls = simplify_call_count();
+        pass_start = Clock::now();
+    }
+
+    void finish(const Stmt &s) {
+        if (!enabled) {
+            return;
+        }
+        end_pass(s);
+        double total = std::chrono::duration<double>(Clock::now() - start).count();
+
+        // Format into a string stream, so the stream state of
+        // std::cerr is left alone.
+        ostringstream table;
+        table << std::fixed << std::setprecision(6);
+        for (const Pass &p : passes) {
+            table << "  " << std::setw(10) << p.seconds << "s "
+                  << std::setw(8) << p.nodes_before << " -> " << std::setw(8) << p.nodes_after << " nodes "
+                  << std::setw(8) << p.simplify_calls << " simplifications "
+                  << std::setw(8) << (p.resident_bytes >> 20) << " MB resident "
+                  << std::setw(8) << (p.peak_bytes >> 20) << " MB peak  " << p.name << "\n";
+        }
+        table << "  " << std::setw(10) << total << "s total\n";
+        debug(1) << "Lowering profile for " << pipeline_name << ":\n" << table.str();
+
+        if (profile_file.empty()) {
+            return;
+        }
+        ostringstream json;
+        json << "{\"pipeline\": \"" << json_escape(pipeline_name) << "\", "
+             << "\"target\": \"" << json_escape(target) << "\", "
+             << "\"seconds\": " << total << ", \"passes\": [";
+        for (size_t i = 0; i < passes.size(); i++) {
+            const Pass &p = passes[i];
+            json << (i > 0 ? ", " : "")
+                 << "{\"name\": \"" << json_escape(p.name) << "\", "
+                 << "\"seconds\": " << p.seconds << ", "
+                 << "\"nodes_before\": " << p.nodes_before << ", "
+                 << "\"nodes_after\": " << p.nodes_after << ", "
+                 << "\"simplify_calls\": " << p.simplify_calls << ", "
+                 << "\"resident_bytes\": " << p.resident_bytes << ", "
+                 << "\"peak_bytes\": " << p.peak_bytes << "}";
+        }
+        json << "]}\n";
+        std::ofstream out(profile_file, std::ios::app);
+        out << json.str();
+    }
+};
+
+}  // namespace
+
 Module lower(const vector<Function> &output_funcs, const string &pipeline_name, const Target &t,
              const vector<Argument> &args, const LinkageType linkage_type,
              const vector<IRMutator2 *> &custom_passes) {
@@ -82,6 +274,15 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
 
     Module result_module(simple_pipeline_name, t);
 
+    LoweringProfiler profiler(pipeline_name, t);
+
+    std::unique_ptr<SimplifyMemoization> simplify_memoization;
+    if (t.has_feature(Target::MemoizeSimplify)) {
+        simplify_memoization.reset(new SimplifyMemoization);
+    }
+
+    bool intern = t.has_feature(Target::InternExprs);
+
     // Compute an environment
     map<string, Function> env;
     for (Function f : output_funcs) {
@@ -92,6 +293,9 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
     vector<Function> outputs;
     std::tie(outputs, env) = deep_copy(output_funcs, env);
 
+    // Pick the generator used by calls to random()
+    select_random_generator(env, t);
+
     bool any_strict_float = strictify_float(env, t);
     result_module.set_any_strict_float(any_strict_float);
 
@@ -108,217 +312,300 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
     // Substitute in wrapper Funcs
     env = wrap_func_calls(env);
 
+    // Evaluate Funcs that depend on no inputs now, and embed the results
+    if (t.has_feature(Target::FoldConstantFuncs)) {
+        fold_constant_funcs(outputs, env);
+    }
+
+    // Merge pointwise GPU stages into their consumers' kernels
+    if (t.has_feature(Target::FuseGPUStages)) {
+        fuse_gpu_stages(outputs, env);
+    }
+
+    // Fuse the loops of sibling Funcs that read the same inputs
+    if (t.has_feature(Target::InferComputeWith)) {
+        infer_compute_with(outputs, env);
+    }
+
     // Compute a realization order and determine group of functions which loops
     // are to be fused together
     vector<string> order;
     vector<vector<string>> fused_groups;
     std::tie(order, fused_groups) = realization_order(outputs, env);
 
+    // Estimate the cost of the pipeline for its metadata.
+    if (linkage_type == LinkageType::ExternalPlusMetadata && !t.has_feature(Target::JIT)) {
+        result_module.set_cost_estimates(estimate_pipeline_costs(outputs, env, order));
+    }
+
     // Try to simplify the RHS/LHS of a function definition by propagating its
     // specializations' conditions
     simplify_specializations(env);
 
-    debug(1) << "Creating initial loop nests...\n";
+    profiler.begin_pass("Creating initial loop nests...", Stmt());
     bool any_memoized = false;
     Stmt s = schedule_functions(outputs, fused_groups, env, t, any_memoized);
     debug(2) << "Lowering after creating initial loop nests:\n" << s << '\n';
 
-    debug(1) << "Canonicalizing GPU var names...\n";
+    profiler.begin_pass("Canonicalizing GPU var names...", s);
     s = canonicalize_gpu_vars(s);
     debug(2) << "Lowering after canonicalizing GPU var names:\n" << s << '\n';
 
     if (any_memoized) {
-        debug(1) << "Injecting memoization...\n";
+        profiler.begin_pass("Injecting memoization...", s);
         s = inject_memoization(s, env, pipeline_name, outputs);
         debug(2) << "Lowering after injecting memoization:\n" << s << '\n';
     } else {
-        debug(1) << "Skipping injecting memoization...\n";
+        profiler.begin_pass("Skipping injecting memoization...", s);
     }
 
-    debug(1) << "Injecting tracing...\n";
+    profiler.begin_pass("Injecting tracing...", s);
     s = inject_tracing(s, pipeline_name, env, outputs, t);
     debug(2) << "Lowering after injecting tracing:\n" << s << '\n';
 
-    debug(1) << "Adding checks for parameters\n";
+    profiler.begin_pass("Adding checks for parameters", s);
     s = add_parameter_checks(s, t);
     debug(2) << "Lowering after injecting parameter checks:\n" << s << '\n';
 
     // Compute the maximum and minimum possible value of each
     // function. Used in later bounds inference passes.
-    debug(1) << "Computing bounds of each function's value\n";
+    profiler.begin_pass("Computing bounds of each function's value", s);
     FuncValueBounds func_bounds = compute_function_value_bounds(order, env);
 
     // The checks will be in terms of the symbols defined by bounds
     // inference.
-    debug(1) << "Adding checks for images\n";
+    profiler.begin_pass("Adding checks for images", s);
     s = add_image_checks(s, outputs, t, order, env, func_bounds);
     debug(2) << "Lowering after injecting image checks:\n" << s << '\n';
 
     // This pass injects nested definitions of variable names, so we
     // can't simplify statements from here until we fix them up. (We
     // can still simplify Exprs).
-    debug(1) << "Performing computation bounds inference...\n";
+    profiler.begin_pass("Performing computation bounds inference...", s);
     s = bounds_inference(s, outputs, order, fused_groups, env, func_bounds, t);
     debug(2) << "Lowering after computation bounds inference:\n" << s << '\n';
 
-    debug(1) << "Performing sliding window optimization...\n";
-    s = sliding_window(s, env);
+    if (intern) {
+        profiler.begin_pass("Interning expressions...", s);
+        s = intern_exprs(s);
+    }
+
+    profiler.begin_pass("Performing sliding window optimization...", s);
+    s = sliding_window(s, env, t);
     debug(2) << "Lowering after sliding window:\n" << s << '\n';
 
-    debug(1) << "Performing allocation bounds inference...\n";
+    if (t.has_feature(Target::ReuseProducerStorage)) {
+        profiler.begin_pass("Computing pointwise consumers in place...", s);
+        s = reuse_producer_storage(s, outputs, env);
+        debug(2) << "Lowering after computing pointwise consumers in place:\n" << s << '\n';
+    }
+
+    profiler.begin_pass("Performing allocation bounds inference...", s);
     s = allocation_bounds_inference(s, env, func_bounds);
     debug(2) << "Lowering after allocation bounds inference:\n" << s << '\n';
 
-    debug(1) << "Removing code that depends on undef values...\n";
+    // That was the last use of the bounds of the Funcs' values, which
+    // can be large for big pipelines, so free them now.
+    FuncValueBounds().swap(func_bounds);
+
+    profiler.begin_pass("Removing code that depends on undef values...", s);
     s = remove_undef(s);
     debug(2) << "Lowering after removing code that depends on undef values:\n" << s << "\n\n";
 
     // This uniquifies the variable names, so we're good to simplify
     // after this point. This lets later passes assume syntactic
     // equivalence means semantic equivalence.
-    debug(1) << "Uniquifying variable names...\n";
+    profiler.begin_pass("Uniquifying variable names...", s);
     s = uniquify_variable_names(s);
     debug(2) << "Lowering after uniquifying variable names:\n" << s << "\n\n";
 
-    debug(1) << "Simplifying...\n";
+    profiler.begin_pass("Simplifying...", s);
     s = simplify(s, false); // Keep dead lets. Storage flattening needs them.
     debug(2) << "Lowering after first simplification:\n" << s << "\n\n";
 
-    debug(1) << "Performing storage folding optimization...\n";
-    s = storage_folding(s, env);
+    profiler.begin_pass("Performing storage folding optimization...", s);
+    s = storage_folding(s, env, t);
     debug(2) << "Lowering after storage folding:\n" << s << '\n';
 
-    debug(1) << "Injecting debug_to_file calls...\n";
+    profiler.begin_pass("Injecting debug_to_file calls...", s);
     s = debug_to_file(s, outputs, env);
     debug(2) << "Lowering after injecting debug_to_file calls:\n" << s << '\n';
 
-    debug(1) << "Injecting prefetches...\n";
-    s = inject_prefetch(s, env);
+    profiler.begin_pass("Injecting prefetches...", s);
+    s = inject_prefetch(s, env, auto_prefetch_distance(t));
     debug(2) << "Lowering after injecting prefetches:\n" << s << "\n\n";
 
-    debug(1) << "Dynamically skipping stages...\n";
+    profiler.begin_pass("Dynamically skipping stages...", s);
     s = skip_stages(s, order);
     debug(2) << "Lowering after dynamically skipping stages:\n" << s << "\n\n";
 
-    debug(1) << "Destructuring tuple-valued realizations...\n";
+    profiler.begin_pass("Forking asynchronous producers...", s);
+    s = fork_async_producers(s, env);
+    debug(2) << "Lowering after forking asynchronous producers:\n" << s << "\n\n";
+
+    profiler.begin_pass("Destructuring tuple-valued realizations...", s);
     s = split_tuples(s, env);
     debug(2) << "Lowering after destructuring tuple-valued realizations:\n" << s << "\n\n";
 
-    debug(1) << "Performing storage flattening...\n";
+    profiler.begin_pass("Performing storage flattening...", s);
     s = storage_flattening(s, outputs, env, t);
     debug(2) << "Lowering after storage flattening:\n" << s << "\n\n";
 
-    debug(1) << "Unpacking buffer arguments...\n";
+    if (intern) {
+        profiler.begin_pass("Interning expressions...", s);
+        s = intern_exprs(s);
+    }
+
+    profiler.begin_pass("Unpacking buffer arguments...", s);
     s = unpack_buffers(s);
     debug(2) << "Lowering after unpacking buffer arguments...\n" << s << "\n\n";
 
     if (any_memoized) {
-        debug(1) << "Rewriting memoized allocations...\n";
+        profiler.begin_pass("Rewriting memoized allocations...", s);
         s = rewrite_memoized_allocations(s, env);
         debug(2) << "Lowering after rewriting memoized allocations:\n" << s << "\n\n";
     } else {
-        debug(1) << "Skipping rewriting memoized allocations...\n";
+        profiler.begin_pass("Skipping rewriting memoized allocations...", s);
     }
 
     if (t.has_gpu_feature() ||
         t.has_feature(Target::OpenGLCompute) ||
         t.has_feature(Target::OpenGL) ||
         (t.arch != Target::Hexagon && (t.features_any_of({Target::HVX_64, Target::HVX_128})))) {
-        debug(1) << "Selecting a GPU API for GPU loops...\n";
+        profiler.begin_pass("Selecting a GPU API for GPU loops...", s);
         s = select_gpu_api(s, t);
         debug(2) << "Lowering after selecting a GPU API:\n" << s << "\n\n";
 
-        debug(1) << "Injecting host <-> dev buffer copies...\n";
+        profiler.begin_pass("Injecting host <-> dev buffer copies...", s);
         s = inject_host_dev_buffer_copies(s, t);
         debug(2) << "Lowering after injecting host <-> dev buffer copies:\n" << s << "\n\n";
 
-        debug(1) << "Selecting a GPU API for extern stages...\n";
+        profiler.begin_pass("Selecting a GPU API for extern stages...", s);
         s = select_gpu_api(s, t);
         debug(2) << "Lowering after selecting a GPU API for extern stages:\n" << s << "\n\n";
     }
 
     if (t.has_feature(Target::OpenGL)) {
-        debug(1) << "Injecting OpenGL texture intrinsics...\n";
+        profiler.begin_pass("Injecting OpenGL texture intrinsics...", s);
         s = inject_opengl_intrinsics(s);
         debug(2) << "Lowering after OpenGL intrinsics:\n" << s << "\n\n";
     }
 
     if (t.has_gpu_feature() ||
         t.has_feature(Target::OpenGLCompute)) {
-        debug(1) << "Injecting per-block gpu synchronization...\n";
+        profiler.begin_pass("Injecting per-block gpu synchronization...", s);
         s = fuse_gpu_thread_loops(s);
         debug(2) << "Lowering after injecting per-block gpu synchronization:\n" << s << "\n\n";
     }
 
-    debug(1) << "Simplifying...\n";
+    profiler.begin_pass("Simplifying...", s);
     s = simplify(s);
     s = unify_duplicate_lets(s);
     s = remove_trivial_for_loops(s);
     debug(2) << "Lowering after second simplifcation:\n" << s << "\n\n";
 
-    debug(1) << "Reduce prefetch dimension...\n";
+    profiler.begin_pass("Reduce prefetch dimension...", s);
     s = reduce_prefetch_dimension(s, t);
     debug(2) << "Lowering after reduce prefetch dimension:\n" << s << "\n";
 
-    debug(1) << "Unrolling...\n";
+    profiler.begin_pass("Unrolling...", s);
     s = unroll_loops(s);
     s = simplify(s);
     debug(2) << "Lowering after unrolling:\n" << s << "\n\n";
 
-    debug(1) << "Vectorizing...\n";
+    profiler.begin_pass("Vectorizing...", s);
     s = vectorize_loops(s, t);
     s = simplify(s);
     debug(2) << "Lowering after vectorizing:\n" << s << "\n\n";
 
-    debug(1) << "Detecting vector interleavings...\n";
+    profiler.begin_pass("Detecting vector interleavings...", s);
     s = rewrite_interleavings(s);
     s = simplify(s);
     debug(2) << "Lowering after rewriting vector interleavings:\n" << s << "\n\n";
 
-    debug(1) << "Partitioning loops to simplify boundary conditions...\n";
-    s = partition_loops(s);
-    s = simplify(s);
-    debug(2) << "Lowering after partitioning loops:\n" << s << "\n\n";
+    if (!t.has_feature(Target::NoOptimize)) {
+        profiler.begin_pass("Partitioning loops to simplify boundary conditions...", s);
+        map<string, float> partition_budgets;
+        for (const auto &p : env) {
+            if (p.second.schedule().partition_budget() > 0) {
+                partition_budgets[p.first] = p.second.schedule().partition_budget();
+            }
+        }
+        s = partition_loops(s, partition_budgets);
+        s = simplify(s);
+        debug(2) << "Lowering after partitioning loops:\n" << s << "\n\n";
+    } else {
+        profiler.begin_pass("Skipping loop partitioning...", s);
+    }
 
-    debug(1) << "Trimming loops to the region over which they do something...\n";
+    profiler.begin_pass("Trimming loops to the region over which they do something...", s);
     s = trim_no_ops(s);
     debug(2) << "Lowering after loop trimming:\n" << s << "\n\n";
 
-    debug(1) << "Injecting early frees...\n";
+    profiler.begin_pass("Hoisting loop-invariant divisors...", s);
+    s = hoist_divisors(s);
+    debug(2) << "Lowering after hoisting loop-invariant divisors:\n" << s << "\n\n";
+
+    profiler.begin_pass("Injecting early frees...", s);
     s = inject_early_frees(s);
     debug(2) << "Lowering after injecting early frees:\n" << s << "\n\n";
 
+    // AOT pipelines get a second entry point, <name>_bounds_query,
+    // which only answers bounds queries. It's made from the pipeline as
+    // it stands now, so that it isn't profiled.
+    Stmt bounds_query_body;
+    if (!t.has_feature(Target::JIT) &&
+        !t.has_feature(Target::NoBoundsQuery) &&
+        linkage_type != LinkageType::Internal) {
+        profiler.begin_pass("Making the bounds query entry point...", s);
+        bounds_query_body = strip_to_bounds_query(s);
+        debug(2) << "Bounds query entry point:\n" << bounds_query_body << "\n\n";
+    }
+
     if (t.has_feature(Target::Profile)) {
-        debug(1) << "Injecting profiling...\n";
+        profiler.begin_pass("Injecting profiling...", s);
         s = inject_profiling(s, pipeline_name);
         debug(2) << "Lowering after injecting profiling:\n" << s << "\n\n";
     }
 
+    if (t.has_feature(Target::LatencyTelemetry) &&
+        t.arch != Target::Hexagon) {
+        profiler.begin_pass("Injecting latency telemetry...", s);
+        s = inject_latency_telemetry(s, pipeline_name);
+        debug(2) << "Lowering after injecting latency telemetry:\n" << s << "\n\n";
+    }
+
     if (t.has_feature(Target::FuzzFloatStores)) {
-        debug(1) << "Fuzzing floating point stores...\n";
+        profiler.begin_pass("Fuzzing floating point stores...", s);
         s = fuzz_float_stores(s);
         debug(2) << "Lowering after fuzzing floating point stores:\n" << s << "\n\n";
     }
 
-    debug(1) << "Bounding small allocations...\n";
+    profiler.begin_pass("Bounding small allocations...", s);
     s = bound_small_allocations(s);
     debug(2) << "Lowering after bounding small allocations:\n" << s << "\n\n";
 
+    if (t.has_feature(Target::ArenaAllocations)) {
+        profiler.begin_pass("Packing allocations into an arena...", s);
+        s = inject_arena_allocations(s);
+        debug(2) << "Lowering after packing allocations into an arena:\n" << s << "\n\n";
+    }
+
     if (t.has_feature(Target::CUDA)) {
-        debug(1) << "Injecting warp shuffles...\n";
+        profiler.begin_pass("Injecting warp shuffles...", s);
         s = lower_warp_shuffles(s);
         debug(2) << "Lowering after injecting warp shuffles:\n" << s << "\n\n";
     }
 
-    debug(1) << "Simplifying...\n";
+    profiler.begin_pass("Simplifying...", s);
     s = common_subexpression_elimination(s);
 
     if (t.has_feature(Target::OpenGL)) {
-        debug(1) << "Detecting varying attributes...\n";
+        profiler.begin_pass("Detecting varying attributes...", s);
         s = find_linear_expressions(s);
         debug(2) << "Lowering after detecting varying attributes:\n" << s << "\n\n";
 
-        debug(1) << "Moving varying attribute expressions out of the shader...\n";
+        profiler.begin_pass("Moving varying attribute expressions out of the shader...", s);
         s = setup_gpu_vertex_buffer(s);
         debug(2) << "Lowering after removing varying attributes:\n" << s << "\n\n";
     }
@@ -329,22 +616,30 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
     s = loop_invariant_code_motion(s);
     debug(1) << "Lowering after final simplification:\n" << s << "\n\n";
 
+    if (t.has_large_buffers()) {
+        profiler.begin_pass("Narrowing gather and scatter indices...", s);
+        s = narrow_large_buffer_indices(s);
+        debug(2) << "Lowering after narrowing gather and scatter indices:\n" << s << "\n\n";
+    }
+
     if (t.arch != Target::Hexagon && (t.features_any_of({Target::HVX_64, Target::HVX_128}))) {
-        debug(1) << "Splitting off Hexagon offload...\n";
+        profiler.begin_pass("Splitting off Hexagon offload...", s);
         s = inject_hexagon_rpc(s, t, result_module);
         debug(2) << "Lowering after splitting off Hexagon offload:\n" << s << '\n';
     } else {
-        debug(1) << "Skipping Hexagon offload...\n";
+        profiler.begin_pass("Skipping Hexagon offload...", s);
     }
 
     if (!custom_passes.empty()) {
         for (size_t i = 0; i < custom_passes.size(); i++) {
-            debug(1) << "Running custom lowering pass " << i << "...\n";
+            profiler.begin_pass("Running custom lowering pass " + std::to_string(i) + "...", s);
             s = custom_passes[i]->mutate(s);
             debug(1) << "Lowering after custom pass " << i << ":\n" << s << "\n\n";
         }
     }
 
+    profiler.finish(s);
+
     vector<Argument> public_args = args;
     for (const auto &out : outputs) {
         for (Parameter buf : out.output_buffers()) {
@@ -428,6 +723,12 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
 
     result_module.append(main_func);
 
+    if (bounds_query_body.defined()) {
+        bounds_query_body = StrengthenRefs().mutate(bounds_query_body);
+        result_module.append(LoweredFunc(pipeline_name + "_bounds_query", public_args,
+                                         bounds_query_body, LinkageType::External));
+    }
+
     // Append a wrapper for this pipeline that accepts old buffer_ts
     // and upgrades them. It will use the same name, so it will
     // require C++ linkage. We don't need it when jitting.
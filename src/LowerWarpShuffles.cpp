@@ -436,11 +436,133 @@ class LowerWarpShuffles : public IRMutator2 {
 
             return For::make(op->name, op->min, warp_size,
                              op->for_type, op->device_api, body);
+        } else if (may_use_warp_shuffle && op->for_type == ForType::Serial) {
+            Stmt s = reduce_across_lanes(op);
+            if (s.defined()) {
+                return s;
+            }
+            return IRMutator2::visit(op);
         } else {
             return IRMutator2::visit(op);
         }
     }
 
+    // Shuffle a scalar value of any type up to 32 bits from lane
+    // this_lane ^ lane_mask.
+    Expr make_butterfly_shuffle(Expr val, int lane_mask) {
+        Type type = val.type();
+        Expr base_val = val;
+        string intrin = "llvm.nvvm.shfl.bfly.i32";
+        if (type.bits() < 32) {
+            base_val = cast(UInt(32), reinterpret(type.with_code(Type::UInt), base_val));
+        } else if (type.is_float()) {
+            intrin = "llvm.nvvm.shfl.bfly.f32";
+        }
+        Expr mask = simplify(((31 & ~(warp_size - 1)) << 8) | 31);
+        Expr shuffled = Call::make(base_val.type(), intrin,
+                                   {base_val, lane_mask, mask}, Call::PureExtern);
+        if (shuffled.type() != type) {
+            shuffled = reinterpret(type, cast(type.with_code(Type::UInt), shuffled));
+        }
+        return shuffled;
+    }
+
+    // A serial loop over every lane of a warp-level allocation which
+    // folds it into a single value (e.g. the final stage of an
+    // rfactor whose intermediate was scheduled with gpu_lanes) does
+    // one warp shuffle per lane. Rewrite it as a butterfly tree, which
+    // needs log2(warp_size) shuffles and leaves the result in every
+    // lane. Returns an undefined Stmt if the loop doesn't match.
+    Stmt reduce_across_lanes(const For *op) {
+        const int64_t *ws = as_const_int(warp_size);
+        const Store *store = op->body.as<Store>();
+        if (!ws || !is_zero(op->min) || !equal(op->extent, warp_size) ||
+            !store || !is_one(store->predicate) || !store->value.type().is_scalar() ||
+            store->value.type().bits() > 32 || expr_uses_var(store->index, op->name)) {
+            return Stmt();
+        }
+
+        // Match store[idx] = store[idx] op alloc[f(loop var)], for a
+        // commutative and associative op.
+        Expr a, b;
+        IRNodeType node_type = store->value->node_type;
+        if (const Add *add = store->value.as<Add>()) {
+            a = add->a;
+            b = add->b;
+        } else if (const Mul *mul = store->value.as<Mul>()) {
+            a = mul->a;
+            b = mul->b;
+        } else if (const Min *min = store->value.as<Min>()) {
+            a = min->a;
+            b = min->b;
+        } else if (const Max *max = store->value.as<Max>()) {
+            a = max->a;
+            b = max->b;
+        } else {
+            return Stmt();
+        }
+        const Load *self = a.as<Load>();
+        const Load *other = b.as<Load>();
+        if (!self || self->name != store->name) {
+            std::swap(self, other);
+        }
+        if (!self || !other ||
+            self->name != store->name ||
+            !equal(self->index, store->index) ||
+            !allocation_info.contains(other->name) ||
+            !is_one(other->predicate)) {
+            return Stmt();
+        }
+
+        // Each lane must contribute exactly one value, taken from the
+        // same place in its own stripe.
+        ScopedBinding<Interval> bind(bounds, op->name, Interval(0, simplify(warp_size - 1)));
+        Expr idx = mutate(other->index);
+        Expr stride = allocation_info.get(other->name).stride;
+        Expr lane = simplify(reduce_expr(idx / stride, warp_size, bounds), true, bounds);
+        idx = simplify((idx / (warp_size * stride)) * stride + reduce_expr(idx, stride, bounds), true, bounds);
+        idx = simplify(solve_expression(idx, this_lane_name).result, true, bounds);
+        if (!equal(lane, Variable::make(Int(32), op->name)) ||
+            expr_uses_var(idx, op->name) ||
+            expr_uses_var(idx, this_lane_name)) {
+            return Stmt();
+        }
+
+        auto combine = [&](Expr x, Expr y) {
+            switch (node_type) {
+            case IRNodeType::Add:
+                return x + y;
+            case IRNodeType::Mul:
+                return x * y;
+            case IRNodeType::Min:
+                return min(x, y);
+            default:
+                return max(x, y);
+            }
+        };
+
+        // Build the tree out of lets, so that the shuffles can be
+        // hoisted out of any enclosing single-lane conditional.
+        vector<pair<string, Expr>> lets;
+        string name = unique_name('t');
+        lets.push_back({name, Load::make(other->type, other->name, idx, Buffer<>(),
+                                         Parameter(), const_true())});
+        for (int lane_mask = (int)(*ws) / 2; lane_mask > 0; lane_mask /= 2) {
+            Expr t = Variable::make(other->type, name);
+            name = unique_name('t');
+            lets.push_back({name, combine(t, make_butterfly_shuffle(t, lane_mask))});
+        }
+
+        Expr total = Variable::make(other->type, name);
+        Stmt s = mutate(Store::make(store->name, combine(Expr(self), total),
+                                    store->index, store->param, store->predicate));
+        while (!lets.empty()) {
+            s = LetStmt::make(lets.back().first, lets.back().second, s);
+            lets.pop_back();
+        }
+        return s;
+    }
+
     Stmt visit(const IfThenElse *op) override {
         // Consider lane-masking if-then-elses when determining the
         // active bounds of the lane index.
@@ -656,14 +778,15 @@ class HoistWarpShufflesFromSingleIfStmt : public IRMutator2 {
         ExprOrStmt body = mutate(op->body);
 
         // If any of the lifted expressions use this, we also need to
-        // lift this.
-        bool should_lift = false;
-        for (const auto &p : lifted_lets) {
-            should_lift |= expr_uses_var(p.second, op->name);
+        // lift this. It must be rewrapped outside the first of them.
+        auto first_use = lifted_lets.begin();
+        while (first_use != lifted_lets.end() &&
+               !expr_uses_var(first_use->second, op->name)) {
+            first_use++;
         }
 
-        if (should_lift) {
-            lifted_lets.push_back({op->name, value});
+        if (first_use != lifted_lets.end()) {
+            lifted_lets.insert(first_use, {op->name, value});
             return body;
         } else {
             return LetOrLetStmt::make(op->name, value, body);
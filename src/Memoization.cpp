@@ -15,8 +15,15 @@ namespace Internal {
 namespace {
 
 class FindParameterDependencies : public IRGraphVisitor {
+    // Whether input buffers go into the key as a hash of their
+    // contents (see MemoizeKey::ContentHash), and the version tag
+    // passed to the hash.
+    bool hash_buffers;
+    Expr version;
+
 public:
-    FindParameterDependencies() { }
+    FindParameterDependencies(bool hash_buffers, Expr version)
+        : hash_buffers(hash_buffers), version(version) { }
     ~FindParameterDependencies() { }
 
     void visit_function(const Function &function) {
@@ -26,7 +33,10 @@ public:
             const std::vector<ExternFuncArgument> &extern_args =
                 function.extern_arguments();
             for (size_t i = 0; i < extern_args.size(); i++) {
-                if (extern_args[i].is_buffer()) {
+                if (extern_args[i].is_buffer() && hash_buffers) {
+                    const Buffer<> &b = extern_args[i].buffer;
+                    record_buffer(b.name(), Variable::make(type_of<halide_buffer_t *>(), b.name() + ".buffer", b));
+                } else if (extern_args[i].is_buffer()) {
                     // Function with an extern definition
                     record(Halide::Internal::Parameter(extern_args[i].buffer.type(), true,
                                                        extern_args[i].buffer.dimensions(),
@@ -43,6 +53,9 @@ public:
     void visit(const Call *call) {
         if (call->param.defined()) {
             record(call->param);
+        } else if (call->image.defined() && hash_buffers) {
+            const Buffer<> &b = call->image;
+            record_buffer(b.name(), Variable::make(type_of<halide_buffer_t *>(), b.name() + ".buffer", b));
         }
 
         if (call->is_intrinsic(Call::memoize_expr)) {
@@ -84,12 +97,17 @@ public:
 
         info.type = parameter.type();
 
-        if (parameter.is_buffer()) {
+        if (parameter.is_buffer() && hash_buffers) {
+            record_buffer(parameter.name(),
+                          Variable::make(type_of<halide_buffer_t *>(), parameter.name() + ".buffer", parameter));
+            return;
+        } else if (parameter.is_buffer()) {
             internal_error << "Buffer parameter " << parameter.name() <<
                 " encountered in computed_cached computation.\n" <<
                 "Computations which depend on buffer parameters " <<
                 "cannot be scheduled compute_cached.\n" <<
-                "Use memoize_tag to provide cache key information for buffer.\n";
+                "Use memoize_tag to provide cache key information for buffer,\n" <<
+                "or memoize(MemoizeKey::ContentHash) to key on its contents.\n";
         } else if (info.type.is_handle()) {
             internal_error << "Handle parameter " << parameter.name() <<
                 " encountered in computed_cached computation.\n" <<
@@ -104,6 +122,17 @@ public:
         dependency_info[DependencyKey(info.type.bytes(), parameter.name())] = info;
     }
 
+    // Key on a hash of the contents of a buffer.
+    void record_buffer(const std::string &name, Expr buffer) {
+        struct DependencyInfo info;
+        info.type = UInt(64);
+        info.size_expr = info.type.bytes();
+        Expr v = version.defined() ? cast<uint64_t>(version) : make_zero(UInt(64));
+        info.value_expr = Call::make(UInt(64), "halide_memoization_cache_hash_buffer",
+                                     {buffer, v}, Call::Extern);
+        dependency_info[DependencyKey(info.type.bytes(), name + ".contents")] = info;
+    }
+
     void record(const Expr &expr) {
         struct DependencyInfo info;
         info.type = expr.type();
@@ -183,11 +212,21 @@ class KeyInfo {
 
 public:
     KeyInfo(const Function &function, const std::string &name, int memoize_instance)
-        : top_level_name(name),
+        : dependencies(function.schedule().memoize_key() == MemoizeKey::ContentHash,
+                       function.schedule().memoize_version()),
+          top_level_name(name),
           function_name(function.origin_name()),
           memoize_instance(memoize_instance)
     {
-        dependencies.visit_function(function);
+        // The version tag is part of the schedule, which the visitor
+        // would otherwise put in the key too. It only says when the
+        // hashes of the buffers need recomputing, so equal data with
+        // different versions should still hit in the cache.
+        Function f = function;
+        Expr version = f.schedule().memoize_version();
+        f.schedule().memoize_version() = Expr();
+        dependencies.visit_function(f);
+        f.schedule().memoize_version() = version;
         size_t size_so_far = 0;
         size_so_far += Handle().bytes() + 4;
 
@@ -0,0 +1,317 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+
+#include "MemoryReport.h"
+#include "Bounds.h"
+#include "CodeGen_Internal.h"
+#include "ExprUsesVar.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "IRPrinter.h"
+#include "IRVisitor.h"
+#include "Scope.h"
+#include "Simplify.h"
+#include "Substitute.h"
+#include "Util.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::pair;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Replace the mins and extents of buffer parameters, and the values
+// of scalar parameters, with their estimates where there are any.
+class SubstituteEstimates : public IRMutator2 {
+    using IRMutator2::visit;
+
+    Expr visit(const Variable *op) override {
+        if (!op->param.defined()) {
+            return op;
+        }
+        Expr est;
+        if (op->param.is_buffer()) {
+            // These are of the form name.min.d or name.extent.d
+            vector<string> v = split_string(op->name, ".");
+            if (v.size() >= 3 && !v.back().empty() && isdigit(v.back()[0])) {
+                int d = atoi(v.back().c_str());
+                const string &field = v[v.size() - 2];
+                if (field == "min") {
+                    est = op->param.min_constraint_estimate(d);
+                } else if (field == "extent") {
+                    est = op->param.extent_constraint_estimate(d);
+                }
+            }
+        } else {
+            est = op->param.estimate();
+        }
+        return est.defined() ? cast(op->type, est) : Expr(op);
+    }
+};
+
+// The number of bytes of an estimate, or -1 if it has no constant
+// upper bound.
+int64_t upper_bound_bytes(const Interval &i) {
+    if (i.has_upper_bound()) {
+        if (const int64_t *v = as_const_int(i.max)) {
+            return std::max<int64_t>(*v, 0);
+        }
+    }
+    return -1;
+}
+
+string bytes_string(int64_t bytes) {
+    return bytes < 0 ? "unknown size" : std::to_string(bytes) + " bytes";
+}
+
+struct AllocationEstimate {
+    string name;
+    Type type;
+    int64_t bytes;
+    string placement;
+    // The loops the allocation lives inside, outermost first.
+    vector<string> loops;
+};
+
+class EstimateMemory : public IRVisitor {
+    using IRVisitor::visit;
+
+    // The lets around the current statement, outermost first.
+    vector<pair<string, Expr>> lets;
+
+    // The bounds of the enclosing loop variables.
+    Scope<Interval> loop_bounds;
+
+    vector<string> loops;
+
+    // The bytes held by each live allocation counted in the peak.
+    Scope<int64_t> live;
+
+    int64_t current = 0;
+
+    Interval estimate(Expr e) {
+        for (auto it = lets.rbegin(); it != lets.rend(); it++) {
+            if (expr_uses_var(e, it->first)) {
+                e = substitute(it->first, it->second, e);
+            }
+        }
+        e = simplify(SubstituteEstimates().mutate(e));
+        Interval i = bounds_of_expr_in_scope(e, loop_bounds);
+        if (i.has_lower_bound()) {
+            i.min = simplify(i.min);
+        }
+        if (i.has_upper_bound()) {
+            i.max = simplify(i.max);
+        }
+        return i;
+    }
+
+    void visit(const Variable *op) override {
+        if (op->param.defined() && op->param.is_buffer()) {
+            params.emplace(op->param.name(), op->param);
+        }
+    }
+
+    void visit(const LetStmt *op) override {
+        op->value.accept(this);
+        lets.push_back({op->name, op->value});
+        op->body.accept(this);
+        lets.pop_back();
+    }
+
+    void visit(const For *op) override {
+        op->min.accept(this);
+        op->extent.accept(this);
+
+        Interval min = estimate(op->min);
+        Interval extent = estimate(op->extent);
+        int64_t iterations = upper_bound_bytes(extent);
+        Interval bounds = Interval::everything();
+        if (min.has_lower_bound()) {
+            bounds.min = min.min;
+        }
+        if (min.has_upper_bound() && extent.has_upper_bound()) {
+            bounds.max = simplify(min.max + extent.max - 1);
+        }
+
+        std::ostringstream desc;
+        desc << op->name;
+        if (op->for_type != ForType::Serial) {
+            desc << " (" << op->for_type;
+            if (iterations >= 0) {
+                desc << ", " << iterations << " iterations";
+            }
+            desc << ")";
+        }
+
+        loop_bounds.push(op->name, bounds);
+        loops.push_back(desc.str());
+        if (op->is_parallel()) {
+            // Every iteration may be running at once, so the
+            // allocations inside count once per iteration.
+            int64_t old_current = current, old_peak = peak;
+            current = peak = 0;
+            op->body.accept(this);
+            if (peak > 0 && iterations < 0) {
+                unknown_parallel_extent = true;
+            }
+            peak = std::max(old_peak, old_current + peak * std::max<int64_t>(iterations, 1));
+            current = old_current;
+        } else {
+            op->body.accept(this);
+        }
+        loops.pop_back();
+        loop_bounds.pop(op->name);
+    }
+
+    void visit(const Allocate *op) override {
+        for (const Expr &e : op->extents) {
+            e.accept(this);
+        }
+        op->condition.accept(this);
+        if (op->new_expr.defined()) {
+            op->new_expr.accept(this);
+        }
+
+        AllocationEstimate a;
+        a.name = op->name;
+        a.type = op->type;
+        a.loops = loops;
+
+        Expr size = make_const(Int(64), op->type.bytes());
+        for (const Expr &e : op->extents) {
+            size *= cast<int64_t>(e);
+        }
+        a.bytes = is_zero(simplify(op->condition)) ? 0 : upper_bound_bytes(estimate(size));
+
+        // Follows the placement in CodeGen_Posix::create_allocation.
+        int64_t constant_bytes = (int64_t)Allocate::constant_allocation_size(op->extents, op->name) * op->type.bytes();
+        bool counted = true;
+        if (op->new_expr.defined()) {
+            a.placement = "custom";
+        } else if (op->memory_type == MemoryType::GPUShared) {
+            a.placement = "gpu_shared";
+            counted = false;
+        } else if (op->memory_type == MemoryType::VTCM) {
+            a.placement = "vtcm";
+            counted = false;
+        } else if (constant_bytes > 0 &&
+                   op->memory_type != MemoryType::Heap &&
+                   (op->memory_type == MemoryType::Stack ||
+                    op->memory_type == MemoryType::Register ||
+                    can_allocation_fit_on_stack(constant_bytes))) {
+            a.placement = "stack";
+        } else {
+            a.placement = "heap";
+        }
+        allocations.push_back(a);
+
+        int64_t held = 0;
+        if (counted && a.bytes < 0) {
+            unknown_allocations++;
+        } else if (counted) {
+            held = a.bytes;
+        }
+        current += held;
+        peak = std::max(peak, current);
+        live.push(op->name, held);
+        op->body.accept(this);
+        current -= live.get(op->name);
+        live.pop(op->name);
+    }
+
+    void visit(const Free *op) override {
+        if (live.contains(op->name)) {
+            current -= live.get(op->name);
+            live.ref(op->name) = 0;
+        }
+    }
+
+public:
+    vector<AllocationEstimate> allocations;
+    map<string, Parameter> params;
+    int64_t peak = 0;
+    int unknown_allocations = 0;
+    bool unknown_parallel_extent = false;
+};
+
+void print_function_report(std::ostream &stream, const LoweredFunc &f) {
+    EstimateMemory est;
+    f.body.accept(&est);
+
+    stream << "Function " << f.name << ":\n";
+
+    stream << "  Buffers:\n";
+    for (const LoweredArgument &arg : f.args) {
+        if (!arg.is_buffer()) {
+            continue;
+        }
+        int64_t bytes = arg.type.bytes();
+        auto it = est.params.find(arg.name);
+        for (int d = 0; d < arg.dimensions && bytes >= 0; d++) {
+            const int64_t *extent = nullptr;
+            if (it != est.params.end()) {
+                Expr e = it->second.extent_constraint_estimate(d);
+                if (e.defined()) {
+                    e = simplify(cast<int64_t>(e));
+                    extent = as_const_int(e);
+                }
+            }
+            bytes = extent ? bytes * *extent : -1;
+        }
+        stream << "    " << (arg.is_input() ? "input " : "output ") << arg.name << ": "
+               << arg.type << ", " << (int)arg.dimensions << " dimensions, "
+               << bytes_string(bytes) << "\n";
+    }
+
+    stream << "  Allocations:\n";
+    if (est.allocations.empty()) {
+        stream << "    none\n";
+    }
+    for (const AllocationEstimate &a : est.allocations) {
+        stream << "    " << a.name << ": " << a.type << ", " << bytes_string(a.bytes)
+               << ", " << a.placement << ", ";
+        if (a.loops.empty()) {
+            stream << "for the whole function\n";
+        } else {
+            stream << "inside";
+            for (size_t i = 0; i < a.loops.size(); i++) {
+                stream << (i == 0 ? " " : " > ") << a.loops[i];
+            }
+            stream << "\n";
+        }
+    }
+
+    stream << "  Peak: " << bytes_string(est.peak);
+    if (est.unknown_allocations) {
+        stream << ", plus " << est.unknown_allocations
+               << (est.unknown_allocations == 1 ? " allocation" : " allocations") << " of unknown size";
+    }
+    if (est.unknown_parallel_extent) {
+        stream << ", counting parallel loops of unknown extent once";
+    }
+    stream << "\n\n";
+}
+
+}  // namespace
+
+void print_memory_report(std::ostream &stream, const Module &m) {
+    stream << "Memory report for module " << m.name()
+           << " (target " << m.target().to_string() << ")\n\n";
+    for (const LoweredFunc &f : m.functions()) {
+        print_function_report(stream, f);
+    }
+    for (const Module &sub : m.submodules()) {
+        print_memory_report(stream, sub);
+    }
+}
+
+}  // namespace Internal
+}  // namespace Halide
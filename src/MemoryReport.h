@@ -0,0 +1,28 @@
+#ifndef HALIDE_MEMORY_REPORT_H
+#define HALIDE_MEMORY_REPORT_H
+
+/** \file
+ * Defines a function to estimate the memory a compiled pipeline uses.
+ */
+
+#include <ostream>
+
+#include "Module.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Print an estimate of the memory used by each function in a
+ * Module. Every allocation is listed with its size in bytes, whether
+ * it goes on the stack or the heap, and the loops it lives inside,
+ * followed by the peak memory of the function. Sizes that depend on
+ * the pipeline's arguments are estimated from the estimates given to
+ * the input and output buffers and scalar params (e.g. with
+ * Func::estimate), and allocations inside parallel loops are counted
+ * once per iteration, as an upper bound. */
+void print_memory_report(std::ostream &stream, const Module &m);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
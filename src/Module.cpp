@@ -1,5 +1,6 @@
 #include "Module.h"
 
+#include <algorithm>
 #include <array>
 #include <fstream>
 #include <future>
@@ -12,7 +13,9 @@
 #include "LLVM_Output.h"
 #include "LLVM_Runtime_Linker.h"
 #include "IROperator.h"
+#include "MemoryReport.h"
 #include "Outputs.h"
+#include "PythonExtensionGen.h"
 #include "StmtToHtml.h"
 #include "WrapExternStages.h"
 
@@ -85,18 +88,62 @@ Outputs add_suffixes(const Outputs &in, const std::string &suffix) {
     if (!in.object_name.empty()) out.object_name = add_suffix(in.object_name, suffix);
     if (!in.assembly_name.empty()) out.assembly_name = add_suffix(in.assembly_name, suffix);
     if (!in.bitcode_name.empty()) out.bitcode_name = add_suffix(in.bitcode_name, suffix);
+    if (!in.thinlto_bitcode_name.empty()) out.thinlto_bitcode_name = add_suffix(in.thinlto_bitcode_name, suffix);
     if (!in.llvm_assembly_name.empty()) out.llvm_assembly_name = add_suffix(in.llvm_assembly_name, suffix);
     if (!in.c_source_name.empty()) out.c_source_name = add_suffix(in.c_source_name, suffix);
     if (!in.stmt_name.empty()) out.stmt_name = add_suffix(in.stmt_name, suffix);
     if (!in.stmt_html_name.empty()) out.stmt_html_name = add_suffix(in.stmt_html_name, suffix);
     if (!in.schedule_name.empty()) out.schedule_name = add_suffix(in.schedule_name, suffix);
+    if (!in.memory_report_name.empty()) out.memory_report_name = add_suffix(in.memory_report_name, suffix);
     return out;
 }
 
+// Prepare the llvm module for one part of a multitarget object to be
+// linked into the wrapper, which was compiled for the base target. If
+// pin_features is set, everything the module defines is pinned to its
+// own cpu and features, which otherwise come from the module flags and
+// would be lost (the linked module keeps the wrapper's flags, so ours
+// are dropped). Definitions of ODR symbols that the sub-targets share
+// (e.g. vector math from the initial modules) are made private, so
+// that the linker can't pick one built with features another
+// sub-target can't use.
+void prepare_for_multitarget_linking(llvm::Module &module, bool pin_features) {
+    llvm::TargetOptions options;
+    std::string mcpu, mattrs;
+    get_target_options(module, options, mcpu, mattrs);
+    if (llvm::NamedMDNode *flags = module.getModuleFlagsMetadata()) {
+        module.eraseNamedMetadata(flags);
+    }
+    if (!pin_features) {
+        return;
+    }
+
+    for (llvm::Function &f : module) {
+        if (f.isDeclaration()) {
+            continue;
+        }
+        if (f.hasLinkOnceODRLinkage() || f.hasWeakODRLinkage()) {
+            f.setLinkage(llvm::GlobalValue::InternalLinkage);
+        }
+        if (f.hasLocalLinkage() || f.hasExternalLinkage()) {
+            if (!mcpu.empty()) {
+                f.addFnAttr("target-cpu", mcpu);
+            }
+            if (!mattrs.empty()) {
+                f.addFnAttr("target-features", mattrs);
+            }
+        }
+    }
+}
+
+// The number of features that fit in the mask passed to
+// halide_can_use_target_features. The features after these only change
+// how code is generated, so the runtime never needs to check them.
+const int runtime_checked_features = std::min((int)Target::FeatureEnd, 64);
+
 uint64_t target_feature_mask(const Target &target) {
-    static_assert(sizeof(uint64_t)*8 >= Target::FeatureEnd, "Features will not fit in uint64_t");
     uint64_t feature_mask = 0;
-    for (int i = 0; i < Target::FeatureEnd; ++i) {
+    for (int i = 0; i < runtime_checked_features; ++i) {
         if (target.has_feature((Target::Feature) i)) {
             feature_mask |= ((uint64_t) 1) << i;
         }
@@ -116,6 +163,7 @@ struct ModuleContents {
     std::vector<ExternalCode> external_code;
     std::map<std::string, std::string> metadata_name_map;
     bool any_strict_float{false};
+    PipelineCostEstimates cost_estimates;
 };
 
 template<>
@@ -165,6 +213,10 @@ void Module::set_any_strict_float(bool any_strict_float) {
     contents->any_strict_float = any_strict_float;
 }
 
+void Module::set_cost_estimates(const PipelineCostEstimates &cost_estimates) {
+    contents->cost_estimates = cost_estimates;
+}
+
 const Target &Module::target() const {
     return contents->target;
 }
@@ -181,6 +233,10 @@ bool Module::any_strict_float() const {
     return contents->any_strict_float;
 }
 
+const PipelineCostEstimates &Module::cost_estimates() const {
+    return contents->cost_estimates;
+}
+
 const std::vector<Buffer<>> &Module::buffers() const {
     return contents->buffers;
 }
@@ -335,7 +391,7 @@ std::map<std::string, std::string> Module::get_metadata_name_map() const {
 void Module::compile(const Outputs &output_files_arg) const {
     Outputs output_files = output_files_arg;
 
-    // output stmt and html prior to resolving submodules. We need to
+    // output stmt, html and the memory report prior to resolving submodules. We need to
     // clear the output after writing it, otherwise the output will
     // be overwritten by recursive calls after submodules are resolved.
     if (!output_files.stmt_name.empty()) {
@@ -349,6 +405,12 @@ void Module::compile(const Outputs &output_files_arg) const {
         Internal::print_to_html(output_files.stmt_html_name, *this);
         output_files.stmt_html_name.clear();
     }
+    if (!output_files.memory_report_name.empty()) {
+        debug(1) << "Module.compile(): memory_report_name " << output_files.memory_report_name << "\n";
+        std::ofstream file(output_files.memory_report_name);
+        Internal::print_memory_report(file, *this);
+        output_files.memory_report_name.clear();
+    }
 
 
     // If there are submodules, recursively lower submodules to
@@ -360,8 +422,8 @@ void Module::compile(const Outputs &output_files_arg) const {
     }
 
     if (!output_files.object_name.empty() || !output_files.assembly_name.empty() ||
-        !output_files.bitcode_name.empty() || !output_files.llvm_assembly_name.empty() ||
-        !output_files.static_library_name.empty()) {
+        !output_files.bitcode_name.empty() || !output_files.thinlto_bitcode_name.empty() ||
+        !output_files.llvm_assembly_name.empty() || !output_files.static_library_name.empty()) {
         llvm::LLVMContext context;
         std::unique_ptr<llvm::Module> llvm_module(compile_module_to_llvm_module(*this, context));
 
@@ -398,6 +460,11 @@ void Module::compile(const Outputs &output_files_arg) const {
             auto out = make_raw_fd_ostream(output_files.bitcode_name);
             compile_llvm_module_to_llvm_bitcode(*llvm_module, *out);
         }
+        if (!output_files.thinlto_bitcode_name.empty()) {
+            debug(1) << "Module.compile(): thinlto_bitcode_name " << output_files.thinlto_bitcode_name << "\n";
+            auto out = make_raw_fd_ostream(output_files.thinlto_bitcode_name);
+            compile_llvm_module_to_thinlto_bitcode(*llvm_module, *out);
+        }
         if (!output_files.llvm_assembly_name.empty()) {
             debug(1) << "Module.compile(): llvm_assembly_name " << output_files.llvm_assembly_name << "\n";
             auto out = make_raw_fd_ostream(output_files.llvm_assembly_name);
@@ -423,6 +490,11 @@ void Module::compile(const Outputs &output_files_arg) const {
                                Internal::CodeGen_C::CPlusPlusImplementation : Internal::CodeGen_C::CImplementation);
         cg.compile(*this);
     }
+    if (!output_files.python_extension_name.empty()) {
+        debug(1) << "Module.compile(): python_extension_name " << output_files.python_extension_name << "\n";
+        std::ofstream file(output_files.python_extension_name);
+        Internal::print_python_extension(file, *this);
+    }
     if (!output_files.schedule_name.empty()) {
         debug(1) << "Module.compile(): schedule_name " << output_files.schedule_name << "\n";
         std::ofstream file(output_files.schedule_name);
@@ -436,9 +508,12 @@ void Module::compile(const Outputs &output_files_arg) const {
 
 Outputs compile_standalone_runtime(const Outputs &output_files, Target t) {
     Module empty("standalone_runtime", t.without_feature(Target::NoRuntime).without_feature(Target::JIT));
-    // For runtime, it only makes sense to output object files or static_library, so ignore
-    // everything else.
-    Outputs actual_outputs = Outputs().object(output_files.object_name).static_library(output_files.static_library_name);
+    // For runtime, it only makes sense to output object files, static_library, or
+    // ThinLTO bitcode (so that pipelines emitted as ThinLTO bitcode with NoRuntime can
+    // share one runtime, and be optimized along with it), so ignore everything else.
+    Outputs actual_outputs = Outputs().object(output_files.object_name)
+                                      .static_library(output_files.static_library_name)
+                                      .thinlto_bitcode(output_files.thinlto_bitcode_name);
     empty.compile(actual_outputs);
     return actual_outputs;
 }
@@ -455,11 +530,12 @@ void compile_multitarget(const std::string &fn_name,
     user_assert(!fn_name.empty()) << "Function name must be specified.\n";
     user_assert(!targets.empty()) << "Must specify at least one target.\n";
 
-    // You can't ask for .o files when doing this; it's not really useful,
-    // and would complicate output (we might have to do multiple passes
-    // if different values for NoRuntime are specified)... so just forbid
-    // it up front.
-    user_assert(output_files.object_name.empty()) << "Cannot request object_name for compile_multitarget.\n";
+    // If an object is requested, all sub-targets, the runtime, and the
+    // wrapper are linked into that single object, rather than put in
+    // a static library.
+    const bool single_object = !output_files.object_name.empty();
+    user_assert(!single_object || output_files.static_library_name.empty())
+        << "Cannot request both object_name and static_library_name for compile_multitarget.\n";
 
     // The final target in the list is considered "baseline", and is used
     // for (e.g.) the runtime and shared code. It is often just os-arch-bits
@@ -489,8 +565,15 @@ void compile_multitarget(const std::string &fn_name,
     uint64_t runtime_features_mask = (uint64_t)-1LL;
 
     TemporaryObjectFileDir temp_dir;
+    llvm::LLVMContext context;
+    std::vector<std::unique_ptr<llvm::Module>> llvm_modules;
     std::vector<Expr> wrapper_args;
+    std::vector<Expr> bounds_query_wrapper_args;
+    // Every sub-target must have a bounds query entry point for the
+    // wrapper to have one.
+    bool has_bounds_query_entry = true;
     std::vector<LoweredArgument> base_target_args;
+    PipelineCostEstimates base_target_cost_estimates;
     for (const Target &target : targets) {
         // arch-bits-os must be identical across all targets.
         if (target.os != base_target.os ||
@@ -537,11 +620,20 @@ void compile_multitarget(const std::string &fn_name,
         // Re-assign every time -- should be the same across all targets anyway,
         // but base_target is always the last one we encounter.
         base_target_args = sub_module.get_function_by_name(sub_fn_name).args;
+        base_target_cost_estimates = sub_module.cost_estimates();
 
         Outputs sub_out = add_suffixes(output_files, suffix);
-        internal_assert(sub_out.object_name.empty());
-        sub_out.object_name = temp_dir.add_temp_object_file(output_files.static_library_name, suffix, target);
-        debug(1) << "compile_multitarget: compile_sub_target " << sub_out.object_name << "\n";
+        if (single_object) {
+            sub_out.object_name.clear();
+            debug(1) << "compile_multitarget: compile_sub_target " << sub_fn_name << "\n";
+            Module resolved = sub_module.submodules().empty() ? sub_module : sub_module.resolve_submodules();
+            llvm_modules.push_back(compile_module_to_llvm_module(resolved, context));
+            prepare_for_multitarget_linking(*llvm_modules.back(), true);
+        } else {
+            internal_assert(sub_out.object_name.empty());
+            sub_out.object_name = temp_dir.add_temp_object_file(output_files.static_library_name, suffix, target);
+            debug(1) << "compile_multitarget: compile_sub_target " << sub_out.object_name << "\n";
+        }
         sub_module.compile(sub_out);
 
         const uint64_t cur_target_mask = target_feature_mask(target);
@@ -555,6 +647,9 @@ void compile_multitarget(const std::string &fn_name,
 
         wrapper_args.push_back(can_use != 0);
         wrapper_args.push_back(sub_fn_name);
+        bounds_query_wrapper_args.push_back(can_use != 0);
+        bounds_query_wrapper_args.push_back(sub_fn_name + "_bounds_query");
+        has_bounds_query_entry &= !sub_fn_target.has_feature(Target::NoBoundsQuery);
     }
 
     // If we haven't specified "no runtime", build a runtime with the base target
@@ -565,16 +660,23 @@ void compile_multitarget(const std::string &fn_name,
         // We never want NoRuntime set here.
         runtime_features_mask &= ~(((uint64_t)(1)) << Target::NoRuntime);
         if (runtime_features_mask) {
-            for (int i = 0; i < Target::FeatureEnd; ++i) {
+            for (int i = 0; i < runtime_checked_features; ++i) {
                 if (runtime_features_mask & (((uint64_t) 1) << i)) {
                     runtime_target.set_feature((Target::Feature) i);
                 }
             }
         }
-        Outputs runtime_out = Outputs().object(
-            temp_dir.add_temp_object_file(output_files.static_library_name, "_runtime", runtime_target));
-        debug(1) << "compile_multitarget: compile_standalone_runtime " << runtime_out.static_library_name << "\n";
-        compile_standalone_runtime(runtime_out, runtime_target);
+        if (single_object) {
+            debug(1) << "compile_multitarget: compile_standalone_runtime " << runtime_target << "\n";
+            Module runtime("standalone_runtime", runtime_target.without_feature(Target::NoRuntime).without_feature(Target::JIT));
+            llvm_modules.push_back(compile_module_to_llvm_module(runtime, context));
+            prepare_for_multitarget_linking(*llvm_modules.back(), false);
+        } else {
+            Outputs runtime_out = Outputs().object(
+                temp_dir.add_temp_object_file(output_files.static_library_name, "_runtime", runtime_target));
+            debug(1) << "compile_multitarget: compile_standalone_runtime " << runtime_out.static_library_name << "\n";
+            compile_standalone_runtime(runtime_out, runtime_target);
+        }
     }
 
     if (needs_wrapper) {
@@ -605,24 +707,55 @@ void compile_multitarget(const std::string &fn_name,
         }
 
         Module wrapper_module(fn_name, wrapper_target);
+        wrapper_module.set_cost_estimates(base_target_cost_estimates);
         wrapper_module.append(LoweredFunc(fn_name, base_target_args, wrapper_body, LinkageType::ExternalPlusMetadata));
 
         // Add a wrapper to accept old buffer_ts
         add_legacy_wrapper(wrapper_module, wrapper_module.functions().back());
 
-        Outputs wrapper_out = Outputs().object(
-            temp_dir.add_temp_object_file(output_files.static_library_name, "_wrapper", base_target, /* in_front*/ true));
-        debug(1) << "compile_multitarget: wrapper " << wrapper_out.object_name << "\n";
-        wrapper_module.compile(wrapper_out);
+        if (has_bounds_query_entry) {
+            Expr bounds_query_result = Call::make(Int(32), Call::call_cached_indirect_function,
+                                                  bounds_query_wrapper_args, Call::Intrinsic);
+            std::string bounds_query_result_name = unique_name(fn_name + "_bounds_query_result");
+            Expr bounds_query_result_var = Variable::make(Int(32), bounds_query_result_name);
+            Stmt bounds_query_body = AssertStmt::make(bounds_query_result_var == 0, bounds_query_result_var);
+            bounds_query_body = LetStmt::make(bounds_query_result_name, bounds_query_result, bounds_query_body);
+            wrapper_module.append(LoweredFunc(fn_name + "_bounds_query", base_target_args,
+                                              bounds_query_body, LinkageType::External));
+        }
+
+        if (single_object) {
+            // The wrapper is built for the base target, so link
+            // everything else into it and emit the result.
+            debug(1) << "compile_multitarget: wrapper " << output_files.object_name << "\n";
+            std::unique_ptr<llvm::Module> linked = compile_module_to_llvm_module(wrapper_module, context);
+            for (auto &m : llvm_modules) {
+                bool failed = llvm::Linker::linkModules(*linked, std::move(m));
+                internal_assert(!failed) << "Failure linking multitarget object " << output_files.object_name << "\n";
+            }
+            auto out = make_raw_fd_ostream(output_files.object_name);
+            compile_llvm_module_to_object(*linked, *out);
+        } else {
+            Outputs wrapper_out = Outputs().object(
+                temp_dir.add_temp_object_file(output_files.static_library_name, "_wrapper", base_target, /* in_front*/ true));
+            debug(1) << "compile_multitarget: wrapper " << wrapper_out.object_name << "\n";
+            wrapper_module.compile(wrapper_out);
+        }
     }
 
-    if (!output_files.c_header_name.empty()) {
+    if (!output_files.c_header_name.empty() || !output_files.python_extension_name.empty()) {
         Module header_module(fn_name, base_target);
         header_module.append(LoweredFunc(fn_name, base_target_args, {}, LinkageType::ExternalPlusMetadata));
         // Add a wrapper to accept old buffer_ts
         add_legacy_wrapper(header_module, header_module.functions().back());
-        Outputs header_out = Outputs().c_header(output_files.c_header_name);
-        debug(1) << "compile_multitarget: c_header_name " << header_out.c_header_name << "\n";
+        if (has_bounds_query_entry) {
+            header_module.append(LoweredFunc(fn_name + "_bounds_query", base_target_args, {}, LinkageType::External));
+        }
+        Outputs header_out;
+        header_out.c_header_name = output_files.c_header_name;
+        header_out.python_extension_name = output_files.python_extension_name;
+        debug(1) << "compile_multitarget: c_header_name " << header_out.c_header_name
+                 << " python_extension_name " << header_out.python_extension_name << "\n";
         header_module.compile(header_out);
     }
 
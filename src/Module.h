@@ -80,6 +80,19 @@ namespace Internal {
 struct ModuleContents;
 }
 
+/** Compile-time estimates of the cost of running a pipeline, made from
+ * the estimates on the sizes of its outputs and the values of its
+ * inputs. These are embedded in the halide_filter_metadata_t of the
+ * pipeline; see there for their meaning. Estimates that could not be
+ * made are -1. */
+struct PipelineCostEstimates {
+    int64_t peak_intermediate_bytes = -1;
+    int64_t arithmetic_ops = -1;
+    int64_t bytes_loaded = -1;
+    int64_t parallelism = -1;
+    bool uses_gpu = false;
+};
+
 /** A halide module. This represents IR containing lowered function
  * definitions and buffers. */
 class Module {
@@ -102,6 +115,10 @@ public:
     /** Return whether this module uses strict floating-point anywhere. */
     bool any_strict_float() const;
 
+    /** The estimated cost of running the pipeline this module was
+     * lowered from. */
+    const PipelineCostEstimates &cost_estimates() const;
+
     /** The declarations contained in this module. */
     // @{
     const std::vector<Buffer<>> &buffers() const;
@@ -149,6 +166,9 @@ public:
 
     /** Set whether this module uses strict floating-point directives anywhere. */
     void set_any_strict_float(bool any_strict_float);
+
+    /** Set the estimated cost of running the pipeline in this module. */
+    void set_cost_estimates(const PipelineCostEstimates &cost_estimates);
 };
 
 /** Link a set of modules together into one module. */
@@ -166,6 +186,13 @@ Outputs compile_standalone_runtime(const Outputs &output_files, Target t);
 
 typedef std::function<Module(const std::string &, const Target &)> ModuleProducer;
 
+/** Compile the Module made by module_producer once for each target,
+ * along with a wrapper named fn_name that picks the first target
+ * whose features are usable (via halide_can_use_target_features) on
+ * its first call, and caches that choice. The last target is the
+ * baseline, and is always usable. If the outputs include an object,
+ * everything is linked into that one object; otherwise the pieces go
+ * into a static library. */
 void compile_multitarget(const std::string &fn_name,
                          const Outputs &output_files,
                          const std::vector<Target> &targets,
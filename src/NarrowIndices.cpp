@@ -0,0 +1,215 @@
+#include "NarrowIndices.h"
+#include "Bounds.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Scope.h"
+
+namespace Halide {
+namespace Internal {
+
+namespace {
+
+class NarrowIndices : public IRMutator2 {
+    using IRMutator2::visit;
+
+    Scope<Interval> scope;
+
+    bool fits_in_int32(const Expr &e) {
+        Interval b = bounds_of_expr_in_scope(e, scope, FuncValueBounds(), true);
+        if (!b.is_bounded()) {
+            return false;
+        }
+        const int64_t *lo = as_const_int(b.min);
+        const int64_t *hi = as_const_int(b.max);
+        return lo && hi && Int(32).can_represent(*lo) && Int(32).can_represent(*hi);
+    }
+
+    static Expr add(const Expr &a, const Expr &b) {
+        return !a.defined() ? b : !b.defined() ? a : a + b;
+    }
+
+    static Expr sub(const Expr &a, const Expr &b) {
+        return !b.defined() ? a : !a.defined() ? make_zero(b.type()) - b : a - b;
+    }
+
+    // Split a vector index into a scalar part common to all lanes and
+    // the per-lane part. Undefined parts are zero.
+    void split(const Expr &e, Expr *scalar, Expr *vector) {
+        if (const Broadcast *b = e.as<Broadcast>()) {
+            *scalar = b->value;
+        } else if (const Ramp *r = e.as<Ramp>()) {
+            if (r->base.type().is_scalar()) {
+                *scalar = r->base;
+                *vector = Ramp::make(make_zero(r->base.type()), r->stride, r->lanes);
+            } else {
+                *vector = e;
+            }
+        } else if (const Add *a = e.as<Add>()) {
+            Expr sa, va, sb, vb;
+            split(a->a, &sa, &va);
+            split(a->b, &sb, &vb);
+            *scalar = add(sa, sb);
+            *vector = add(va, vb);
+        } else if (const Sub *s = e.as<Sub>()) {
+            Expr sa, va, sb, vb;
+            split(s->a, &sa, &va);
+            split(s->b, &sb, &vb);
+            *scalar = sub(sa, sb);
+            *vector = sub(va, vb);
+        } else if (const Mul *m = e.as<Mul>()) {
+            const Broadcast *factor = m->b.as<Broadcast>();
+            Expr other = m->a;
+            if (!factor) {
+                factor = m->a.as<Broadcast>();
+                other = m->b;
+            }
+            if (factor) {
+                Expr so, vo;
+                split(other, &so, &vo);
+                if (so.defined()) {
+                    *scalar = so * factor->value;
+                }
+                if (vo.defined()) {
+                    *vector = vo * Broadcast::make(factor->value, factor->lanes);
+                }
+            } else {
+                *vector = e;
+            }
+        } else {
+            *vector = e;
+        }
+    }
+
+    // The same value as the 64-bit e computed in 32 bits, or an
+    // undefined Expr if that might overflow.
+    Expr narrow(const Expr &e) {
+        Type t = Int(32, e.type().lanes());
+        if (const Cast *c = e.as<Cast>()) {
+            Type from = c->value.type();
+            if (!(from.is_int() || from.is_uint()) || from.bits() > 32) {
+                return Expr();
+            }
+            // A uint32 may not fit in an int32.
+            return (Int(32).can_represent(from) || fits_in_int32(e)) ? cast(t, c->value) : Expr();
+        } else if (const IntImm *i = e.as<IntImm>()) {
+            return fits_in_int32(e) ? make_const(t, i->value) : Expr();
+        } else if (const Broadcast *b = e.as<Broadcast>()) {
+            Expr value = narrow(b->value);
+            return value.defined() ? Broadcast::make(value, b->lanes) : Expr();
+        } else if (const Ramp *r = e.as<Ramp>()) {
+            Expr base = narrow(r->base), stride = narrow(r->stride);
+            return (base.defined() && stride.defined() && fits_in_int32(e)) ?
+                Ramp::make(base, stride, r->lanes) : Expr();
+        } else if (!fits_in_int32(e)) {
+            return Expr();
+        } else if (const Add *a = e.as<Add>()) {
+            Expr na = narrow(a->a), nb = narrow(a->b);
+            return (na.defined() && nb.defined()) ? Add::make(na, nb) : Expr();
+        } else if (const Sub *s = e.as<Sub>()) {
+            Expr na = narrow(s->a), nb = narrow(s->b);
+            return (na.defined() && nb.defined()) ? Sub::make(na, nb) : Expr();
+        } else if (const Mul *m = e.as<Mul>()) {
+            Expr na = narrow(m->a), nb = narrow(m->b);
+            return (na.defined() && nb.defined()) ? Mul::make(na, nb) : Expr();
+        } else if (const Min *m = e.as<Min>()) {
+            Expr na = narrow(m->a), nb = narrow(m->b);
+            return (na.defined() && nb.defined()) ? Min::make(na, nb) : Expr();
+        } else if (const Max *m = e.as<Max>()) {
+            Expr na = narrow(m->a), nb = narrow(m->b);
+            return (na.defined() && nb.defined()) ? Max::make(na, nb) : Expr();
+        } else if (e.as<Variable>()) {
+            // Usually a let of a widened 32-bit value, so llvm folds
+            // the truncation away.
+            return cast(t, e);
+        }
+        return Expr();
+    }
+
+    Expr narrow_index(const Expr &index) {
+        if (index.type().is_scalar() || index.type().element_of() != Int(64) ||
+            index.as<Ramp>()) {
+            // Dense and strided accesses already use a scalar base.
+            return index;
+        }
+        Expr scalar, vector;
+        split(index, &scalar, &vector);
+        if (!vector.defined()) {
+            return index;
+        }
+        Expr offsets = narrow(vector);
+        if (!offsets.defined()) {
+            return index;
+        }
+        if (!scalar.defined()) {
+            scalar = make_zero(Int(64));
+        }
+        return Add::make(Broadcast::make(scalar, index.type().lanes()),
+                         Cast::make(index.type(), offsets));
+    }
+
+    Expr visit(const Load *op) override {
+        Expr predicate = mutate(op->predicate);
+        Expr index = narrow_index(mutate(op->index));
+        if (predicate.same_as(op->predicate) && index.same_as(op->index)) {
+            return op;
+        }
+        return Load::make(op->type, op->name, index, op->image, op->param, predicate);
+    }
+
+    Stmt visit(const Store *op) override {
+        Expr predicate = mutate(op->predicate);
+        Expr value = mutate(op->value);
+        Expr index = narrow_index(mutate(op->index));
+        if (predicate.same_as(op->predicate) && value.same_as(op->value) &&
+            index.same_as(op->index)) {
+            return op;
+        }
+        return Store::make(op->name, value, index, op->param, predicate);
+    }
+
+    // Only integer lets can bound an index.
+    Interval bounds_of_let(const Expr &value) {
+        return (value.type().is_int() || value.type().is_uint()) ? bounds_of_expr_in_scope(value, scope) : Interval();
+    }
+
+    Expr visit(const Let *op) override {
+        ScopedBinding<Interval> bind(scope, op->name, bounds_of_let(op->value));
+        return IRMutator2::visit(op);
+    }
+
+    Stmt visit(const LetStmt *op) override {
+        ScopedBinding<Interval> bind(scope, op->name, bounds_of_let(op->value));
+        return IRMutator2::visit(op);
+    }
+
+    Stmt visit(const For *op) override {
+        Interval min = bounds_of_expr_in_scope(op->min, scope);
+        Interval max = bounds_of_expr_in_scope(op->min + op->extent - 1, scope);
+        ScopedBinding<Interval> bind(scope, op->name, Interval(min.min, max.max));
+        return IRMutator2::visit(op);
+    }
+};
+
+}  // namespace
+
+Stmt narrow_large_buffer_indices(Stmt s) {
+    return NarrowIndices().mutate(s);
+}
+
+bool is_narrowed_index(const Expr &index, Expr *base, Expr *offsets) {
+    const Add *add = index.as<Add>();
+    if (!add || index.type().element_of() != Int(64)) {
+        return false;
+    }
+    const Broadcast *b = add->a.as<Broadcast>();
+    const Cast *c = add->b.as<Cast>();
+    if (!b || !c || c->value.type().element_of() != Int(32)) {
+        return false;
+    }
+    *base = b->value;
+    *offsets = c->value;
+    return true;
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,32 @@
+#ifndef HALIDE_NARROW_INDICES_H
+#define HALIDE_NARROW_INDICES_H
+
+/** \file
+ * Defines a lowering pass that keeps the per-lane part of gather and
+ * scatter indices in 32 bits on targets with large buffers.
+ */
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** With Target::LargeBuffers, buffer indices are 64-bit, so the index
+ * vector of a gather or scatter is computed with 64-bit lanes. Split
+ * such an index into the part common to all lanes, which stays 64-bit,
+ * and the per-lane offsets from it, which are computed in 32 bits
+ * where the bounds of the loops and lets around them prove they
+ * fit. The result has the form broadcast(base) + cast<int64>(offsets),
+ * and should be the last change made to the Stmt before codegen, as
+ * simplification may undo it. */
+Stmt narrow_large_buffer_indices(Stmt s);
+
+/** If index has the form made by narrow_large_buffer_indices, set base
+ * to its 64-bit scalar base and offsets to its 32-bit vector of
+ * offsets, and return true. */
+bool is_narrowed_index(const Expr &index, Expr *base, Expr *offsets);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -26,6 +26,11 @@ struct Outputs {
      * output is desired. */
     std::string bitcode_name;
 
+    /** The name of the emitted llvm bitcode with a ThinLTO summary,
+     * for link-time optimization with the code that calls it. Empty if
+     * no ThinLTO bitcode output is desired. */
+    std::string thinlto_bitcode_name;
+
     /** The name of the emitted llvm assembly. Empty if no llvm assembly
      * output is desired. */
     std::string llvm_assembly_name;
@@ -54,6 +59,15 @@ struct Outputs {
      * output is desired. */
     std::string schedule_name;
 
+    /** The name of the emitted memory report file. Empty if no memory
+     * report output is desired. */
+    std::string memory_report_name;
+
+    /** The name of the emitted C source of a Python extension module
+     * that calls the pipeline. Empty if no Python extension output is
+     * desired. */
+    std::string python_extension_name;
+
     /** Make a new Outputs struct that emits everything this one does
      * and also an object file with the given name. */
     Outputs object(const std::string &object_name) const {
@@ -78,6 +92,15 @@ struct Outputs {
         return updated;
     }
 
+    /** Make a new Outputs struct that emits everything this one does
+     * and also an llvm bitcode file with a ThinLTO summary with the
+     * given name. */
+    Outputs thinlto_bitcode(const std::string &thinlto_bitcode_name) const {
+        Outputs updated = *this;
+        updated.thinlto_bitcode_name = thinlto_bitcode_name;
+        return updated;
+    }
+
     /** Make a new Outputs struct that emits everything this one does
      * and also an llvm assembly file with the given name. */
     Outputs llvm_assembly(const std::string &llvm_assembly_name) const {
@@ -133,6 +156,23 @@ struct Outputs {
         updated.schedule_name = schedule_name;
         return updated;
     }
+
+    /** Make a new Outputs struct that emits everything this one does
+     * and also a memory report file with the given name. */
+    Outputs memory_report(const std::string &memory_report_name) const {
+        Outputs updated = *this;
+        updated.memory_report_name = memory_report_name;
+        return updated;
+    }
+
+    /** Make a new Outputs struct that emits everything this one does
+     * and also the C source of a Python extension module with the
+     * given name. */
+    Outputs python_extension(const std::string &python_extension_name) const {
+        Outputs updated = *this;
+        updated.python_extension_name = python_extension_name;
+        return updated;
+    }
 };
 
 }
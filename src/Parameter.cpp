@@ -19,6 +19,7 @@ struct ParameterContents {
     std::vector<Expr> min_constraint;
     std::vector<Expr> extent_constraint;
     std::vector<Expr> stride_constraint;
+    std::vector<int> stride_multiple;
     std::vector<Expr> min_constraint_estimate;
     std::vector<Expr> extent_constraint_estimate;
     Expr min_value, max_value;
@@ -33,6 +34,7 @@ struct ParameterContents {
         min_constraint.resize(dimensions);
         extent_constraint.resize(dimensions);
         stride_constraint.resize(dimensions);
+        stride_multiple.resize(dimensions, 1);
         min_constraint_estimate.resize(dimensions);
         extent_constraint_estimate.resize(dimensions);
 
@@ -211,6 +213,15 @@ void Parameter::set_host_alignment(int bytes) {
     contents->host_alignment = bytes;
 }
 
+void Parameter::set_stride_multiple(int dim, int multiple) {
+    check_is_buffer();
+    check_dim_ok(dim);
+    user_assert(multiple > 0)
+        << "Can't require the stride of dimension " << dim << " of " << name()
+        << " to be a multiple of " << multiple << "\n";
+    contents->stride_multiple[dim] = multiple;
+}
+
 Expr Parameter::min_constraint(int dim) const {
     check_is_buffer();
     check_dim_ok(dim);
@@ -245,6 +256,12 @@ int Parameter::host_alignment() const {
     check_is_buffer();
     return contents->host_alignment;
 }
+
+int Parameter::stride_multiple(int dim) const {
+    check_is_buffer();
+    check_dim_ok(dim);
+    return contents->stride_multiple[dim];
+}
 void Parameter::set_min_value(Expr e) {
     check_is_scalar();
     if (e.defined()) {
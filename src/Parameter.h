@@ -136,12 +136,14 @@ public:
     void set_min_constraint_estimate(int dim, Expr min);
     void set_extent_constraint_estimate(int dim, Expr extent);
     void set_host_alignment(int bytes);
+    void set_stride_multiple(int dim, int multiple);
     Expr min_constraint(int dim) const;
     Expr extent_constraint(int dim) const;
     Expr stride_constraint(int dim) const;
     Expr min_constraint_estimate(int dim) const;
     Expr extent_constraint_estimate(int dim) const;
     int host_alignment() const;
+    int stride_multiple(int dim) const;
     //@}
 
     /** Get and set constraints for scalar parameters. These are used
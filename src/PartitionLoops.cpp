@@ -12,6 +12,7 @@
 #include "CodeGen_GPU_Dev.h"
 #include "Var.h"
 #include "CSE.h"
+#include "Util.h"
 
 namespace Halide {
 namespace Internal {
@@ -436,17 +437,169 @@ bool contains_warp_synchronous_logic(Stmt s) {
     return c.result;
 }
 
+// Measure the size of the code a Stmt will generate, in IR nodes. Unlike
+// a count of the distinct nodes, shared subtrees count once per use.
+class CodeSize : public IRGraphVisitor {
+    using IRGraphVisitor::include;
+
+    void include(const Expr &e) override {
+        size++;
+        e.accept(this);
+    }
+
+    void include(const Stmt &s) override {
+        size++;
+        s.accept(this);
+    }
+
+public:
+    int64_t size = 0;
+};
+
+int64_t code_size(const Stmt &s) {
+    if (!s.defined()) {
+        return 0;
+    }
+    CodeSize c;
+    s.accept(&c);
+    return c.size;
+}
+
+// Check whether any of the given expressions are evaluated inside a
+// loop nested in the visited Stmt.
+class UsedInInnerLoop : public IRGraphVisitor {
+    using IRGraphVisitor::include;
+    using IRGraphVisitor::visit;
+
+    const std::set<const IRNode *> &exprs;
+    int depth = 0;
+
+    void include(const Expr &e) override {
+        if (depth > 0 && exprs.count(e.get())) {
+            result = true;
+        }
+        if (!result) {
+            e.accept(this);
+        }
+    }
+
+    void include(const Stmt &s) override {
+        if (!result) {
+            s.accept(this);
+        }
+    }
+
+    void visit(const For *op) override {
+        include(op->min);
+        include(op->extent);
+        depth++;
+        include(op->body);
+        depth--;
+    }
+
+public:
+    bool result = false;
+
+    UsedInInnerLoop(const std::set<const IRNode *> &exprs) : exprs(exprs) {}
+};
+
 class PartitionLoops : public IRMutator2 {
     using IRMutator2::visit;
 
     bool in_gpu_loop = false;
 
+    // The code for each Func in here may grow to at most this many
+    // times its size before partitioning.
+    const map<string, float> &budgets;
+
+    // The size of the loop nests of each Func before partitioning, and
+    // how much partitioning has added to them so far.
+    map<string, int64_t> func_size, func_growth;
+
+    // The Func whose loop nest we're in.
+    string current_func;
+
+    // Decide whether partitioning a loop is worth the code it adds, and
+    // if so, count the code against the budget of its Func.
+    bool within_budget(const For *op, const vector<Simplification> &simps,
+                       const Stmt &prologue, const Stmt &epilogue) {
+        auto it = budgets.find(current_func);
+        if (it == budgets.end()) {
+            return true;
+        }
+        const float budget = it->second;
+
+        // Outer loops are only worth partitioning if doing so
+        // simplifies work done in their inner loops.
+        std::set<const IRNode *> exprs;
+        for (const auto &s : simps) {
+            exprs.insert(s.old_expr.get());
+        }
+        UsedInInnerLoop inner(exprs);
+        op->body.accept(&inner);
+        ContainsFor has_inner_loop;
+        op->body.accept(&has_inner_loop);
+        if (has_inner_loop.result && !inner.result) {
+            debug(1) << "Not partitioning " << op->name
+                     << ": it would not simplify its inner loops\n";
+            return false;
+        }
+
+        int64_t growth = code_size(prologue) + code_size(epilogue);
+        int64_t allowed = (int64_t)((budget - 1) * func_size[current_func]);
+        if (func_growth[current_func] + growth > allowed) {
+            debug(1) << "Not partitioning " << op->name
+                     << ": it would add " << growth << " IR nodes to " << current_func
+                     << ", which has " << allowed - func_growth[current_func]
+                     << " left in its budget\n";
+            return false;
+        }
+        func_growth[current_func] += growth;
+        return true;
+    }
+
+    // Report the fraction of the iterations of a partitioned loop that
+    // run in the steady state.
+    void report(const For *op, const Expr &prologue_val, const Expr &epilogue_val) {
+        if (debug::debug_level() < 1) {
+            return;
+        }
+        Expr steady = simplify(max(epilogue_val - prologue_val, 0));
+        Expr extent = simplify(op->extent);
+        const int64_t *s = as_const_int(steady);
+        const int64_t *e = as_const_int(extent);
+        if (s && e && *e > 0) {
+            debug(1) << "Partitioned " << op->name << ": " << *s << " of " << *e
+                     << " iterations (" << (100.0 * *s) / *e << "%) are in the steady state\n";
+        } else {
+            debug(1) << "Partitioned " << op->name << ": " << steady << " of " << extent
+                     << " iterations are in the steady state\n";
+        }
+    }
+
+    class ContainsFor : public IRVisitor {
+        using IRVisitor::visit;
+        void visit(const For *op) override {
+            result = true;
+        }
+    public:
+        bool result = false;
+    };
+
     Stmt visit(const For *op) override {
         Stmt body = op->body;
 
         ScopedValue<bool> old_in_gpu_loop(in_gpu_loop, in_gpu_loop ||
                                              CodeGen_GPU_Dev::is_gpu_var(op->name));
 
+        // Loops are named after the Func they compute. Count the size of
+        // each loop nest a Func starts against its budget.
+        string func = op->name.substr(0, op->name.find('.'));
+        if (budgets.count(func) && func != current_func) {
+            func_size[func] += code_size(op);
+        }
+        ScopedValue<string> old_current_func(current_func, func);
+
         // If we're inside GPU kernel, and the body contains thread
         // barriers or warp shuffles, it's not safe to duplicate code.
         if (in_gpu_loop && contains_warp_synchronous_logic(op)) {
@@ -591,6 +744,12 @@ class PartitionLoops : public IRMutator2 {
         bool make_prologue = !equal(prologue, simpler_body);
         bool make_epilogue = !equal(epilogue, simpler_body);
 
+        if (!within_budget(op, middle_simps,
+                           make_prologue ? prologue : Stmt(),
+                           make_epilogue ? epilogue : Stmt())) {
+            return IRMutator2::visit(op);
+        }
+
         // Recurse on the middle section.
         simpler_body = mutate(simpler_body);
 
@@ -691,8 +850,13 @@ class PartitionLoops : public IRMutator2 {
                  << "Old: " << Stmt(op) << "\n"
                  << "New: " << stmt << "\n";
 
+        report(op, prologue_val, epilogue_val);
+
         return stmt;
     }
+
+public:
+    PartitionLoops(const map<string, float> &budgets) : budgets(budgets) {}
 };
 
 class ExprContainsLoad : public IRVisitor {
@@ -988,11 +1152,11 @@ bool has_likely_tag(Expr e) {
     return h.result;
 }
 
-Stmt partition_loops(Stmt s) {
+Stmt partition_loops(Stmt s, const map<string, float> &budgets) {
     s = LowerLikelyIfInnermost().mutate(s);
     s = MarkClampedRampsAsLikely().mutate(s);
     s = ExpandSelects().mutate(s);
-    s = PartitionLoops().mutate(s);
+    s = PartitionLoops(budgets).mutate(s);
     s = RenormalizeGPULoops().mutate(s);
     s = RemoveLikelyTags().mutate(s);
     s = CollapseSelects().mutate(s);
@@ -7,6 +7,9 @@
  * steady-stage, and an epilogue.
  */
 
+#include <map>
+#include <string>
+
 #include "IR.h"
 
 namespace Halide {
@@ -17,8 +20,14 @@ bool has_likely_tag(Expr e);
 
 /** Partitions loop bodies into a prologue, a steady state, and an
  * epilogue. Finds the steady state by hunting for use of clamped
- * ramps, or the 'likely' intrinsic. */
-Stmt partition_loops(Stmt s);
+ * ramps, or the 'likely' intrinsic.
+ *
+ * The loop nests of each Func named in 'budgets' may grow to at most
+ * its budget times their original size, and their outer loops are only
+ * partitioned if that simplifies their inner loops. Loops that would go
+ * over the budget are left whole, though loops inside them may still be
+ * partitioned. */
+Stmt partition_loops(Stmt s, const std::map<std::string, float> &budgets = {});
 
 }
 }
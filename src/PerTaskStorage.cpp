@@ -0,0 +1,181 @@
+#include "PerTaskStorage.h"
+#include "Bounds.h"
+#include "Debug.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Simplify.h"
+#include "Util.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::string;
+
+namespace {
+
+// Check if a statement refers to a Func, other than inside a
+// realization of it.
+class UsesFuncOutsideRealize : public IRVisitor {
+    const string &func;
+
+    using IRVisitor::visit;
+
+    void visit(const Realize *op) override {
+        if (op->name != func) {
+            IRVisitor::visit(op);
+        }
+    }
+
+    void visit(const ProducerConsumer *op) override {
+        if (op->name == func) {
+            result = true;
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+    void visit(const Provide *op) override {
+        if (op->name == func) {
+            result = true;
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+    void visit(const Call *op) override {
+        if (op->name == func) {
+            result = true;
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+    void visit(const Variable *op) override {
+        if (starts_with(op->name, func + ".")) {
+            result = true;
+        }
+    }
+
+public:
+    bool result = false;
+    UsesFuncOutsideRealize(const string &f) : func(f) {}
+};
+
+bool uses_func_outside_realize(Stmt s, const string &func) {
+    UsesFuncOutsideRealize uses(func);
+    s.accept(&uses);
+    return uses.result;
+}
+
+class SinkRealizeIntoParallelLoop : public IRMutator2 {
+    const Realize *realize;
+    const std::function<Stmt(const Realize *)> &transform;
+
+    using IRMutator2::visit;
+
+    // Realize the Func around a statement, sized to its footprint
+    // there, and transform the realization. Returns an undefined Stmt
+    // if the footprint isn't bounded or the transformation fails.
+    Stmt realize_around(Stmt s) {
+        Box box = box_union(box_provided(s, realize->name), box_required(s, realize->name));
+        if (box.size() != realize->bounds.size()) {
+            return Stmt();
+        }
+        Region bounds;
+        for (size_t i = 0; i < box.size(); i++) {
+            if (!box[i].is_bounded()) {
+                return Stmt();
+            }
+            Expr min = simplify(box[i].min);
+            Expr extent = simplify(box[i].max - box[i].min + 1);
+            bounds.push_back(Range(min, extent));
+        }
+        Stmt r = Realize::make(realize->name, realize->types, realize->memory_type,
+                               bounds, realize->condition, s);
+        return transform(r.as<Realize>());
+    }
+
+    Stmt visit(const ProducerConsumer *op) override {
+        if (op->name == realize->name) {
+            // The Func is produced outside of any parallel loop.
+            return op;
+        } else {
+            return IRMutator2::visit(op);
+        }
+    }
+
+    Stmt visit(const For *op) override {
+        if (!uses_func_outside_realize(op->body, realize->name)) {
+            return op;
+        }
+
+        if (op->for_type == ForType::Serial ||
+            op->for_type == ForType::Unrolled) {
+            Box provided = box_provided(op->body, realize->name);
+            Box required = box_required(op->body, realize->name);
+            if (box_contains(provided, required)) {
+                return IRMutator2::visit(op);
+            } else {
+                return op;
+            }
+        } else if (op->for_type != ForType::Parallel) {
+            return op;
+        }
+
+        Stmt body = realize_around(op->body);
+        if (body.defined()) {
+            debug(3) << "Moving realization of " << realize->name
+                     << " into parallel loop " << op->name << "\n";
+            loops_entered++;
+            return For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+        }
+
+        // The number of threads is only known at runtime, so the
+        // strips are counted there.
+        string strip_name = op->name + ".strip";
+        Expr strip = Variable::make(Int(32), strip_name);
+        string num_strips_name = op->name + ".num_strips";
+        Expr num_strips = Variable::make(Int(32), num_strips_name);
+        string strip_min_name = op->name + ".strip_min";
+        string strip_extent_name = op->name + ".strip_extent";
+        Expr strip_min = Variable::make(Int(32), strip_min_name);
+        Expr strip_extent = Variable::make(Int(32), strip_extent_name);
+
+        Stmt serial = For::make(op->name, strip_min, strip_extent,
+                                ForType::Serial, op->device_api, op->body);
+        body = realize_around(serial);
+        if (!body.defined()) {
+            return op;
+        }
+        debug(3) << "Moving realization of " << realize->name
+                 << " into a strip per thread of parallel loop " << op->name << "\n";
+        loops_entered++;
+        body = LetStmt::make(strip_extent_name,
+                             op->min + ((strip + 1) * op->extent) / num_strips - strip_min, body);
+        body = LetStmt::make(strip_min_name, op->min + (strip * op->extent) / num_strips, body);
+        Stmt strips = For::make(strip_name, 0, num_strips, ForType::Parallel, op->device_api, body);
+        Expr num_threads = Call::make(Int(32), "halide_get_num_threads", {}, Call::Extern);
+        return LetStmt::make(num_strips_name, max(min(op->extent, num_threads), 1), strips);
+    }
+
+public:
+    int loops_entered = 0;
+    SinkRealizeIntoParallelLoop(const Realize *r, const std::function<Stmt(const Realize *)> &t)
+        : realize(r), transform(t) {}
+};
+
+}  // namespace
+
+Stmt sink_realize_into_parallel_loop(const Realize *realize, Stmt body,
+                                     const std::function<Stmt(const Realize *)> &transform) {
+    SinkRealizeIntoParallelLoop sinker(realize, transform);
+    Stmt sunk = sinker.mutate(body);
+    if (sinker.loops_entered == 1 &&
+        !uses_func_outside_realize(sunk, realize->name)) {
+        return sunk;
+    }
+    return Stmt();
+}
+
+}  // namespace Internal
+}  // namespace Halide
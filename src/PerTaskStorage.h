@@ -0,0 +1,37 @@
+#ifndef HALIDE_PER_TASK_STORAGE_H
+#define HALIDE_PER_TASK_STORAGE_H
+
+/** \file
+ * Defines a helper for the lowering passes that give each task of a
+ * parallel loop its own storage for a Func stored outside the loop.
+ */
+
+#include <functional>
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** A Func stored outside a parallel loop (e.g. store_root with
+ * compute_at inside a parallel loop) can't slide or be folded across
+ * it, because the tasks run concurrently. Find the parallel loop in
+ * the body of its realization that contains all uses of the Func,
+ * entering serial loops that don't pass values of the Func from one
+ * iteration to the next. Move the realization into the loop body,
+ * sized to the footprint of one iteration, and pass it to
+ * transform. If transform returns an undefined Stmt, split the loop
+ * into one parallel strip of serial iterations per thread instead,
+ * with the realization inside each strip sized to the footprint of
+ * the strip, and pass that to transform. Returns the statement that
+ * replaces the realization, or an undefined Stmt if the Func is used
+ * elsewhere or transform fails both times. Used by the sliding window
+ * and storage folding passes under the PerTaskStorage target
+ * feature. */
+Stmt sink_realize_into_parallel_loop(const Realize *realize, Stmt body,
+                                     const std::function<Stmt(const Realize *)> &transform);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
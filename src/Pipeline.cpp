@@ -1,7 +1,14 @@
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <list>
+#include <mutex>
+#include <thread>
 
 #include "Pipeline.h"
 #include "Argument.h"
+#include "Bounds.h"
 #include "FindCalls.h"
 #include "Func.h"
 #include "InferArguments.h"
@@ -13,6 +20,10 @@
 #include "ParamMap.h"
 #include "PrintLoopNest.h"
 #include "RealizationOrder.h"
+#include "StmtToHtml.h"
+#include "Simplify.h"
+#include "Substitute.h"
+#include "ThreadPool.h"
 
 using namespace Halide::Internal;
 
@@ -42,6 +53,66 @@ Outputs static_library_outputs(const string &filename_prefix, const Target &targ
     return outputs;
 }
 
+// The threads that compile_jit_async compiles on.
+ThreadPool<void *> &jit_compile_pool() {
+    static ThreadPool<void *> pool;
+    return pool;
+}
+
+Outputs object_outputs(const string &filename_prefix, const Target &target) {
+    Outputs outputs = Outputs().c_header(filename_prefix + ".h");
+    if (target.os == Target::Windows && !target.has_feature(Target::MinGW)) {
+        outputs = outputs.object(filename_prefix + ".obj");
+    } else {
+        outputs = outputs.object(filename_prefix + ".o");
+    }
+    return outputs;
+}
+
+}  // namespace
+
+struct PipelineContents;
+
+namespace {
+
+/** The pipelines that hold jit-compiled code, most recently used
+ * first. If the environment variable HL_JIT_CODE_CACHE_SIZE is set to
+ * a positive number, at most that many pipelines keep their code, and
+ * the least recently used one gives its up (and so frees its
+ * executable pages) when another one would exceed the limit. Its code
+ * is compiled again the next time it's used. Otherwise, pipelines
+ * keep their code for as long as they are alive. */
+struct JITCodeCache {
+    std::mutex mutex;
+    std::list<PipelineContents *> pipelines;
+    size_t capacity = 0;
+
+    JITCodeCache() {
+        int size = atoi(get_env_variable("HL_JIT_CODE_CACHE_SIZE").c_str());
+        if (size > 0) {
+            capacity = (size_t)size;
+        }
+    }
+
+    bool bounded() const {
+        return capacity > 0;
+    }
+
+    /** Mark p as the most recently used pipeline, and evict the code
+     * of the least recently used ones over the limit. Must not be
+     * called with the jit_mutex of any pipeline held. */
+    void touch(PipelineContents *p);
+
+    /** Forget p. Must not be called with the jit_mutex of any pipeline
+     * held. */
+    void remove(PipelineContents *p);
+};
+
+JITCodeCache &jit_code_cache() {
+    static JITCodeCache cache;
+    return cache;
+}
+
 }  // namespace
 
 struct PipelineContents {
@@ -55,14 +126,109 @@ struct PipelineContents {
 
     // Cached jit-compiled code
     JITModule jit_module;
+
+    /** The target jit_module was compiled for. Guarded by jit_mutex:
+     * once a bounded JITCodeCache has evicted the module, a realize on
+     * one thread may recompile it while others read the target. */
     Target jit_target;
 
+    /** Held while compile_jit checks for and compiles the jit module,
+     * which realizes running concurrently may all do once a bounded
+     * JITCodeCache has evicted it. */
+    std::mutex jit_compile_mutex;
+
+    /** Where this pipeline is in the JITCodeCache, if it's there.
+     * Guarded by the mutex of the cache. */
+    std::list<PipelineContents *>::iterator jit_code_cache_entry;
+    bool in_jit_code_cache = false;
+
     /** Clear all cached state */
     void invalidate_cache() {
+        // This also takes the pipeline out of the JITCodeCache before
+        // it's destroyed.
+        jit_code_cache().remove(this);
+        std::lock_guard<std::mutex> lock(jit_mutex);
         module = Module("", Target());
         jit_module = JITModule();
         jit_target = Target();
         inferred_args.clear();
+        adaptive_configs.clear();
+        tier_up = std::shared_future<void *>();
+        tier_up_module.reset();
+        tier_up_pending = false;
+        co_execute_gpu_share = 0.5;
+    }
+
+    /** Guards the state that realize changes after the pipeline is
+     * compiled: the switch to the tier_up module, and the
+     * adaptive_configs. Once neither is in use, calls of a compiled
+     * pipeline only read its state, and don't take the lock, so many
+     * threads can realize one pipeline at once. */
+    std::mutex jit_mutex;
+
+    /** The fully optimized jit module being compiled in the background
+     * by a tiered compile_jit_async, to replace the quick one in
+     * jit_module once it's ready. */
+    std::shared_future<void *> tier_up;
+    std::shared_ptr<JITModule> tier_up_module;
+
+    /** Whether tier_up is set. While it is, jit_module may be replaced
+     * at any time, so it's only read with the lock held. */
+    std::atomic<bool> tier_up_pending{false};
+
+    /** The share of the rows of a co-executed realization that goes
+     * to the GPU. See Func::co_execute. */
+    std::atomic<double> co_execute_gpu_share{0.5};
+
+    /** Switch to the fully optimized jit module if it has finished
+     * compiling. Must be called with jit_mutex held. */
+    void check_tier_up() {
+        if (tier_up.valid() &&
+            tier_up.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            tier_up.get();
+            debug(2) << "Switching to the optimized jit module\n";
+            jit_module = *tier_up_module;
+            tier_up = std::shared_future<void *>();
+            tier_up_module.reset();
+            tier_up_pending.store(false, std::memory_order_release);
+        }
+    }
+
+    Target get_jit_target() {
+        std::lock_guard<std::mutex> lock(jit_mutex);
+        return jit_target;
+    }
+
+    void set_jit_target(const Target &t) {
+        std::lock_guard<std::mutex> lock(jit_mutex);
+        jit_target = t;
+    }
+
+    /** The target to realize for when none is given: the one the
+     * pipeline has been jit-compiled for, if it has been, and
+     * otherwise the one from the environment. */
+    Target default_jit_target() {
+        {
+            std::lock_guard<std::mutex> lock(jit_mutex);
+            if (jit_module.compiled()) {
+                return jit_target;
+            }
+        }
+        return get_jit_target_from_environment();
+    }
+
+    /** The jit module to call, switching to the tier_up module first
+     * if it's ready. This is safe to call from many threads at once. */
+    JITModule current_jit_module() {
+        // A bounded JITCodeCache may evict the module at any time, so
+        // then it's always read with the lock held too.
+        if (!tier_up_pending.load(std::memory_order_acquire) &&
+            !jit_code_cache().bounded()) {
+            return jit_module;
+        }
+        std::lock_guard<std::mutex> lock(jit_mutex);
+        check_tier_up();
+        return jit_module;
     }
 
     // The outputs
@@ -90,6 +256,21 @@ struct PipelineContents {
      * define_extern calls. */
     std::map<std::string, JITExtern> jit_externs;
 
+    /** The number of realizes with the same Param values after which
+     * the jit module is specialized for them, or zero for never. */
+    int adaptive_jit_threshold = 0;
+
+    /** A set of Param values seen by realize: the bits of each scalar
+     * Param and the shape of each input buffer, in the order of
+     * inferred_args. The jit module is undefined until the pipeline
+     * has been specialized for them. */
+    struct AdaptiveConfig {
+        vector<int64_t> key;
+        int hits = 0;
+        JITModule jit_module;
+    };
+    vector<AdaptiveConfig> adaptive_configs;
+
     PipelineContents() :
         module("", Target()) {
         user_context_arg.arg = Argument("__user_context", Argument::InputScalar, type_of<const void*>(), 0);
@@ -112,6 +293,56 @@ struct PipelineContents {
     }
 };
 
+namespace {
+
+void JITCodeCache::touch(PipelineContents *p) {
+    if (!bounded()) {
+        return;
+    }
+    // The evicted modules are destroyed, freeing their code, once the
+    // locks are released.
+    vector<JITModule> evicted;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (p->in_jit_code_cache) {
+        pipelines.splice(pipelines.begin(), pipelines, p->jit_code_cache_entry);
+    } else {
+        pipelines.push_front(p);
+        p->jit_code_cache_entry = pipelines.begin();
+        p->in_jit_code_cache = true;
+    }
+    while (pipelines.size() > capacity) {
+        PipelineContents *victim = pipelines.back();
+        pipelines.pop_back();
+        victim->in_jit_code_cache = false;
+        debug(2) << "Evicting the jit code of " << victim->outputs[0].name() << "\n";
+        // Any realize of the victim in flight holds its own reference
+        // to the module it's calling, so this only frees the code once
+        // that returns. The target is kept, so that the pipeline is
+        // compiled again the same way.
+        std::lock_guard<std::mutex> victim_lock(victim->jit_mutex);
+        evicted.push_back(victim->jit_module);
+        victim->jit_module = JITModule();
+        for (PipelineContents::AdaptiveConfig &a : victim->adaptive_configs) {
+            evicted.push_back(a.jit_module);
+            a.jit_module = JITModule();
+            a.hits = 0;
+        }
+    }
+}
+
+void JITCodeCache::remove(PipelineContents *p) {
+    if (!bounded()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (p->in_jit_code_cache) {
+        pipelines.erase(p->jit_code_cache_entry);
+        p->in_jit_code_cache = false;
+    }
+}
+
+}  // namespace
+
 namespace Internal {
 template<>
 RefCount &ref_count<PipelineContents>(const PipelineContents *p) {
@@ -151,10 +382,15 @@ vector<Func> Pipeline::outputs() const {
     return funcs;
 }
 
-string Pipeline::auto_schedule(const Target &target, const MachineParams &arch_params) {
+string Pipeline::auto_schedule(const Target &target, const MachineParams &arch_params,
+                               int autotune_candidates) {
     user_assert(target.arch == Target::X86 || target.arch == Target::ARM ||
-                target.arch == Target::POWERPC || target.arch == Target::MIPS)
+                target.arch == Target::POWERPC || target.arch == Target::MIPS ||
+                target.arch == Target::WebAssembly || target.arch == Target::RISCV)
         << "Automatic scheduling is currently supported only on these architectures.";
+    if (autotune_candidates > 1) {
+        return autotune_schedules(contents->outputs, target, arch_params, autotune_candidates);
+    }
     return generate_schedules(contents->outputs, target, arch_params);
 }
 
@@ -240,10 +476,14 @@ void Pipeline::print_loop_nest() {
 void Pipeline::compile_to_lowered_stmt(const string &filename,
                                        const vector<Argument> &args,
                                        StmtOutputFormat fmt,
-                                       const Target &target) {
+                                       const Target &target,
+                                       const string &profile_json) {
     Module m = compile_to_module(args, "", target);
     Outputs outputs;
-    if (fmt == HTML) {
+    if (fmt == HTML && !profile_json.empty()) {
+        print_to_html(output_name(filename, m, ".html"), m, profile_json);
+        return;
+    } else if (fmt == HTML) {
         outputs = Outputs().stmt_html(output_name(filename, m, ".html"));
     } else {
         outputs = Outputs().stmt(output_name(filename, m, ".stmt"));
@@ -270,6 +510,16 @@ void Pipeline::compile_to_multitarget_static_library(const std::string &filename
     compile_multitarget(generate_function_name(), outputs, targets, module_producer);
 }
 
+void Pipeline::compile_to_multitarget_object(const std::string &filename_prefix,
+                                             const std::vector<Argument> &args,
+                                             const std::vector<Target> &targets) {
+    auto module_producer = [this, &args](const std::string &name, const Target &target) -> Module {
+        return compile_to_module(args, name, target);
+    };
+    Outputs outputs = object_outputs(filename_prefix, targets.back());
+    compile_multitarget(generate_function_name(), outputs, targets, module_producer);
+}
+
 void Pipeline::compile_to_file(const string &filename_prefix,
                                const vector<Argument> &args,
                                const std::string &fn_name,
@@ -403,6 +653,8 @@ std::string Pipeline::generate_function_name() const {
 
 void *Pipeline::compile_jit(const Target &target_arg) {
     user_assert(defined()) << "Pipeline is undefined\n";
+    user_assert(target_arg.arch != Target::WebAssembly)
+        << "WebAssembly code can't be jit-compiled. Compile it ahead of time instead.\n";
 
     Target target(target_arg);
     target.set_feature(Target::JIT);
@@ -410,17 +662,20 @@ void *Pipeline::compile_jit(const Target &target_arg) {
 
     debug(2) << "jit-compiling for: " << target_arg << "\n";
 
+    std::lock_guard<std::mutex> compile_lock(contents->jit_compile_mutex);
+
     // If we're re-jitting for the same target, we can just keep the
     // old jit module.
-    if (contents->jit_target == target &&
-        contents->jit_module.compiled()) {
-        debug(2) << "Reusing old jit module compiled for :\n" << contents->jit_target << "\n";
-        return contents->jit_module.main_function();
+    JITModule current = contents->current_jit_module();
+    if (contents->get_jit_target() == target && current.compiled()) {
+        debug(2) << "Reusing old jit module compiled for :\n" << target << "\n";
+        jit_code_cache().touch(contents.get());
+        return current.main_function();
     }
     // Clear all cached info in case there is an error.
     contents->invalidate_cache();
 
-    contents->jit_target = target;
+    contents->set_jit_target(target);
 
     // Infer an arguments vector
     infer_arguments();
@@ -458,11 +713,316 @@ void *Pipeline::compile_jit(const Target &target_arg) {
         module.compile(Outputs().bitcode(file_name));
     }
 
-    contents->jit_module = jit_module;
+    {
+        // A bounded JITCodeCache reads and evicts it concurrently.
+        std::lock_guard<std::mutex> lock(contents->jit_mutex);
+        contents->jit_module = jit_module;
+    }
+    jit_code_cache().touch(contents.get());
 
     return jit_module.main_function();
 }
 
+JITModule Pipeline::compiled_jit_module() {
+    JITModule m = contents->current_jit_module();
+    while (!m.compiled()) {
+        compile_jit(contents->get_jit_target());
+        m = contents->current_jit_module();
+    }
+    return m;
+}
+
+std::vector<void *> Pipeline::compile_jit(const std::vector<Pipeline> &pipelines, const Target &target_arg) {
+    user_assert(!pipelines.empty()) << "No Pipelines to compile\n";
+    user_assert(target_arg.arch != Target::WebAssembly)
+        << "WebAssembly code can't be jit-compiled. Compile it ahead of time instead.\n";
+
+    Target target(target_arg);
+    target.set_feature(Target::JIT);
+    target.set_feature(Target::UserContext);
+
+    debug(2) << "jit-compiling " << pipelines.size() << " pipelines for: " << target_arg << "\n";
+
+    // Hold the compile lock of every Pipeline, as compile_jit does for
+    // one. They are taken in address order, so that batches sharing
+    // Pipelines can't deadlock.
+    vector<PipelineContents *> contents;
+    for (const Pipeline &p : pipelines) {
+        user_assert(p.defined()) << "Pipeline is undefined\n";
+        contents.push_back(p.contents.get());
+    }
+    std::sort(contents.begin(), contents.end());
+    contents.erase(std::unique(contents.begin(), contents.end()), contents.end());
+    vector<std::unique_lock<std::mutex>> compile_locks;
+    for (PipelineContents *c : contents) {
+        compile_locks.emplace_back(c->jit_compile_mutex);
+    }
+
+    // Lower each pipeline to a module of its own, as compile_jit does,
+    // and then link them into one so that llvm only has to be set up
+    // and run once.
+    vector<Module> modules;
+    vector<string> names;
+    set<string> seen_names;
+    vector<JITModule> externs;
+    for (Pipeline p : pipelines) {
+        p.contents->invalidate_cache();
+        p.contents->set_jit_target(target);
+
+        p.infer_arguments();
+        vector<Argument> args;
+        for (const InferredArgument &arg : p.contents->inferred_args) {
+            args.push_back(arg.arg);
+        }
+
+        string name = p.generate_function_name();
+        user_assert(seen_names.insert(name).second)
+            << "Pipeline " << name << " was passed to compile_jit more than once\n";
+        names.push_back(name);
+        modules.push_back(p.compile_to_module(args, name, target).resolve_submodules());
+
+        std::map<std::string, JITExtern> lowered_externs = p.contents->jit_externs;
+        vector<JITModule> deps = make_externs_jit_module(target_arg, lowered_externs);
+        externs.insert(externs.end(), deps.begin(), deps.end());
+    }
+
+    Module module = link_modules(names[0] + "_batch", modules);
+    for (const Module &m : modules) {
+        if (m.any_strict_float()) {
+            module.set_any_strict_float(true);
+        }
+    }
+
+    vector<JITModule> jit_modules = JITModule::compile_functions(module, names, externs);
+
+    vector<void *> result;
+    for (size_t i = 0; i < pipelines.size(); i++) {
+        {
+            std::lock_guard<std::mutex> lock(pipelines[i].contents->jit_mutex);
+            pipelines[i].contents->jit_module = jit_modules[i];
+        }
+        result.push_back(jit_modules[i].main_function());
+    }
+    // The pipelines share their code, which is only freed once all of
+    // them have been evicted.
+    for (Pipeline p : pipelines) {
+        jit_code_cache().touch(p.contents.get());
+    }
+    return result;
+}
+
+std::future<void *> Pipeline::compile_jit_async(const Target &target_arg, bool tiered) {
+    user_assert(defined()) << "Pipeline is undefined\n";
+
+    if (!tiered) {
+        Pipeline p = *this;
+        return jit_compile_pool().async([p, target_arg]() mutable {
+            return p.compile_jit(target_arg);
+        });
+    }
+
+    Target target(target_arg);
+    target.set_feature(Target::JIT);
+    target.set_feature(Target::UserContext);
+
+    JITModule current = contents->current_jit_module();
+    if (contents->get_jit_target() == target && current.compiled()) {
+        std::shared_future<void *> pending;
+        {
+            std::lock_guard<std::mutex> lock(contents->jit_mutex);
+            pending = contents->tier_up;
+        }
+        if (!pending.valid()) {
+            std::promise<void *> compiled;
+            compiled.set_value(current.main_function());
+            return compiled.get_future();
+        }
+        return std::async(std::launch::deferred, [pending]() { return pending.get(); });
+    }
+
+    // The quick version. Record it as compiled for the requested
+    // target, so that realize uses it rather than compiling again.
+    compile_jit(target.with_feature(Target::NoOptimize));
+    contents->set_jit_target(target);
+
+    // Lowering works on a deep copy of the Funcs, so the background
+    // compile only needs its own copies of the inputs to lowering.
+    vector<Argument> args;
+    for (const InferredArgument &arg : contents->inferred_args) {
+        args.push_back(arg.arg);
+    }
+    string name = generate_function_name();
+    vector<Function> outputs = contents->outputs;
+    vector<IRMutator2 *> custom_passes;
+    for (CustomLoweringPass p : contents->custom_lowering_passes) {
+        custom_passes.push_back(p.pass);
+    }
+    std::map<std::string, JITExtern> externs = contents->jit_externs;
+    std::shared_ptr<JITModule> optimized = std::make_shared<JITModule>();
+
+    std::shared_future<void *> pending = jit_compile_pool().async([=]() {
+        Module module = lower(outputs, name, target, args, LinkageType::ExternalPlusMetadata,
+                              custom_passes).resolve_submodules();
+        std::map<std::string, JITExtern> lowered_externs = externs;
+        *optimized = JITModule(module, module.get_function_by_name(name),
+                               make_externs_jit_module(target_arg, lowered_externs));
+        return optimized->main_function();
+    }).share();
+
+    {
+        std::lock_guard<std::mutex> lock(contents->jit_mutex);
+        contents->tier_up = pending;
+        contents->tier_up_module = optimized;
+        contents->tier_up_pending.store(true, std::memory_order_release);
+    }
+    return std::async(std::launch::deferred, [pending]() { return pending.get(); });
+}
+
+void Pipeline::set_adaptive_jit(int threshold) {
+    user_assert(defined()) << "Pipeline is undefined\n";
+    user_assert(threshold >= 0) << "Adaptive jit threshold must be non-negative\n";
+    std::lock_guard<std::mutex> lock(contents->jit_mutex);
+    contents->adaptive_jit_threshold = threshold;
+    contents->adaptive_configs.clear();
+}
+
+namespace {
+
+// How many sets of Param values to track at once.
+const size_t max_adaptive_configs = 8;
+
+// Restores the constraints of the input buffers after compiling a
+// specialized pipeline.
+struct SavedConstraints {
+    struct Saved {
+        Parameter param;
+        int dim;
+        Expr extent, stride;
+    };
+    vector<Saved> saved;
+
+    ~SavedConstraints() {
+        for (Saved &s : saved) {
+            s.param.set_extent_constraint(s.dim, s.extent);
+            s.param.set_stride_constraint(s.dim, s.stride);
+        }
+    }
+};
+
+}  // namespace
+
+JITModule Pipeline::adaptive_jit_module(const Target &target) {
+    PipelineContents &c = *contents;
+    // Concurrent realizes share the configs, and a specialized module
+    // is compiled once, by the realize that reaches the threshold.
+    std::lock_guard<std::mutex> lock(c.jit_mutex);
+    c.check_tier_up();
+
+    vector<int64_t> key;
+    for (const InferredArgument &arg : c.inferred_args) {
+        if (!arg.param.defined() || arg.param.same_as(c.user_context_arg.param)) {
+            continue;
+        }
+        if (arg.param.is_buffer()) {
+            if (!arg.param.buffer().defined()) {
+                return c.jit_module;
+            }
+            const halide_buffer_t *buf = arg.param.raw_buffer();
+            key.push_back(buf->dimensions);
+            for (int i = 0; i < buf->dimensions; i++) {
+                key.push_back(buf->dim[i].extent);
+                key.push_back(buf->dim[i].stride);
+            }
+        } else if (!arg.param.type().is_handle()) {
+            // Pointers are rarely worth specializing on.
+            int64_t bits = 0;
+            memcpy(&bits, arg.param.scalar_address(), arg.param.type().bytes());
+            key.push_back(bits);
+        }
+    }
+
+    PipelineContents::AdaptiveConfig *config = nullptr;
+    for (PipelineContents::AdaptiveConfig &a : c.adaptive_configs) {
+        if (a.key == key) {
+            config = &a;
+            break;
+        }
+    }
+    if (!config) {
+        if (c.adaptive_configs.size() < max_adaptive_configs) {
+            c.adaptive_configs.emplace_back();
+            config = &c.adaptive_configs.back();
+        } else {
+            // Forget the coldest set of values we haven't compiled.
+            for (PipelineContents::AdaptiveConfig &a : c.adaptive_configs) {
+                if (!a.jit_module.compiled() && (!config || a.hits < config->hits)) {
+                    config = &a;
+                }
+            }
+            if (!config) {
+                return c.jit_module;
+            }
+            *config = PipelineContents::AdaptiveConfig();
+        }
+        config->key = key;
+    }
+
+    if (config->jit_module.compiled()) {
+        return config->jit_module;
+    }
+    if (++config->hits < c.adaptive_jit_threshold) {
+        return c.jit_module;
+    }
+
+    // Bind the shapes of the input buffers with constraints, which
+    // lowering applies before it vectorizes or simplifies anything,
+    // and the scalars by substituting them into the lowered code. The
+    // specialized module has the same arguments as the general one, so
+    // realize calls either in the same way.
+    SavedConstraints saved;
+    std::map<string, Expr> scalars;
+    vector<Argument> args;
+    for (const InferredArgument &arg : c.inferred_args) {
+        args.push_back(arg.arg);
+        if (!arg.param.defined() || arg.param.same_as(c.user_context_arg.param)) {
+            continue;
+        }
+        Parameter p = arg.param;
+        if (p.is_buffer()) {
+            const halide_buffer_t *buf = p.raw_buffer();
+            for (int i = 0; i < std::min(p.dimensions(), buf->dimensions); i++) {
+                saved.saved.push_back({p, i, p.extent_constraint(i), p.stride_constraint(i)});
+                if (!p.extent_constraint(i).defined()) {
+                    p.set_extent_constraint(i, buf->dim[i].extent);
+                }
+                if (!p.stride_constraint(i).defined()) {
+                    p.set_stride_constraint(i, buf->dim[i].stride);
+                }
+            }
+        } else if (!p.type().is_handle()) {
+            scalars[p.name()] = p.scalar_expr();
+        }
+    }
+
+    string name = generate_function_name() + "_adaptive" + unique_name('_');
+    debug(1) << "Specializing jit module " << name << " for observed parameter values\n";
+
+    vector<IRMutator2 *> custom_passes;
+    for (CustomLoweringPass p : c.custom_lowering_passes) {
+        custom_passes.push_back(p.pass);
+    }
+    Module module = lower(c.outputs, name, c.jit_target, args, LinkageType::ExternalPlusMetadata, custom_passes);
+    for (LoweredFunc &f : module.functions()) {
+        f.body = simplify(substitute(scalars, f.body));
+    }
+    module = module.resolve_submodules();
+
+    std::map<std::string, JITExtern> lowered_externs = c.jit_externs;
+    config->jit_module = JITModule(module, module.get_function_by_name(name),
+                                   make_externs_jit_module(target, lowered_externs));
+    return config->jit_module;
+}
+
 
 void Pipeline::set_error_handler(void (*handler)(void *, const char *)) {
     user_assert(defined()) << "Pipeline is undefined\n";
@@ -491,6 +1051,11 @@ void Pipeline::set_custom_trace(int (*trace_fn)(void *, const halide_trace_event
     contents->jit_handlers.custom_trace = trace_fn;
 }
 
+void Pipeline::set_custom_telemetry(void (*telemetry_fn)(void *, const halide_telemetry_record_t *)) {
+    user_assert(defined()) << "Pipeline is undefined\n";
+    contents->jit_handlers.custom_telemetry = telemetry_fn;
+}
+
 void Pipeline::set_custom_print(void (*cust_print)(void *, const char *)) {
     user_assert(defined()) << "Pipeline is undefined\n";
     contents->jit_handlers.custom_print = cust_print;
@@ -651,7 +1216,8 @@ struct JITFuncCallContext {
                  << "custom_do_task: " << (void *)jit_context.handlers.custom_do_task << '\n'
                  << "custom_do_par_for: " << (void *)jit_context.handlers.custom_do_par_for << '\n'
                  << "custom_error: " << (void *)jit_context.handlers.custom_error << '\n'
-                 << "custom_trace: " << (void *)jit_context.handlers.custom_trace << '\n';
+                 << "custom_trace: " << (void *)jit_context.handlers.custom_trace << '\n'
+                 << "custom_telemetry: " << (void *)jit_context.handlers.custom_telemetry << '\n';
     }
 
     void report_if_error(int exit_status) {
@@ -673,6 +1239,69 @@ struct JITFuncCallContext {
     }
 };
 
+// If we're profiling, report runtimes and reset profiler stats.
+void report_profile_if_enabled(JITModule &module, const Target &target, JITFuncCallContext &jit_context) {
+    if (target.has_feature(Target::Profile)) {
+        JITModule::Symbol report_sym =
+            module.find_symbol_by_name("halide_profiler_report");
+        JITModule::Symbol reset_sym =
+            module.find_symbol_by_name("halide_profiler_reset");
+        if (report_sym.address && reset_sym.address) {
+            void *uc = &jit_context.jit_context;
+            void (*report_fn_ptr)(void *) = (void (*)(void *))(report_sym.address);
+            report_fn_ptr(uc);
+
+            void (*reset_fn_ptr)() = (void (*)())(reset_sym.address);
+            reset_fn_ptr();
+        }
+    }
+}
+
+// Call a jitted pipeline in bounds query mode until the shapes of the
+// query buffers stop changing. Returns the number of iterations taken,
+// which is max_iters if it didn't converge.
+int iterate_bounds_query(JITModule::argv_wrapper argv_function, const void **args,
+                         JITFuncCallContext &jit_context,
+                         const vector<Runtime::Buffer<> *> &queries, int max_iters) {
+    // A copy of the metadata of each query buffer, to check for
+    // changes.
+    vector<Runtime::Buffer<>> orig(queries.size());
+    int iter = 0;
+    for (iter = 0; iter < max_iters; iter++) {
+        for (size_t i = 0; i < queries.size(); i++) {
+            orig[i] = *queries[i];
+        }
+
+        Internal::debug(2) << "Calling jitted function\n";
+        int exit_status = argv_function(args);
+        jit_context.report_if_error(exit_status);
+        Internal::debug(2) << "Back from jitted function\n";
+        bool changed = false;
+
+        // Check if there were any changes
+        for (size_t i = 0; i < queries.size(); i++) {
+            const Runtime::Buffer<> &query = *queries[i];
+            for (int d = 0; d < query.dimensions(); d++) {
+                if (query.dim(d).min() != orig[i].dim(d).min() ||
+                    query.dim(d).extent() != orig[i].dim(d).extent() ||
+                    query.dim(d).stride() != orig[i].dim(d).stride()) {
+                    changed = true;
+                }
+            }
+        }
+        if (!changed) {
+            break;
+        }
+    }
+    return iter;
+}
+
+// The threads that realize_streaming fetches inputs on.
+ThreadPool<void> &streaming_fetch_pool() {
+    static ThreadPool<void> pool;
+    return pool;
+}
+
 }  // namespace
 
 struct Pipeline::JITCallArgs {
@@ -709,9 +1338,6 @@ void Pipeline::prepare_jit_call_arguments(RealizationArg &outputs, const Target
                                           bool is_bounds_inference, JITCallArgs &args_result) {
     user_assert(defined()) << "Can't realize an undefined Pipeline\n";
 
-    JITModule &compiled_module = contents->jit_module;
-    internal_assert(compiled_module.argv_function());
-
     const bool no_param_map = &param_map == &ParamMap::empty_map();
 
     // Come up with the void * arguments to pass to the argv function
@@ -844,15 +1470,10 @@ void Pipeline::realize(RealizationArg outputs, const Target &t,
             << "The Buffers passed to realize must all be allocated\n";
     }
 
-    // If target is unspecified...
+    // If target is unspecified, use the one we've already jit-compiled
+    // for, or else the one from the environment.
     if (target.os == Target::OSUnknown) {
-        // If we've already jit-compiled for a specific target, use that.
-        if (contents->jit_module.compiled()) {
-            target = contents->jit_target;
-        } else {
-            // Otherwise get the target from the environment
-            target = get_jit_target_from_environment();
-        }
+        target = contents->default_jit_target();
     }
 
     // We need to make a context for calling the jitted function to
@@ -880,6 +1501,17 @@ void Pipeline::realize(RealizationArg outputs, const Target &t,
     // Ensure the module is compiled.
     compile_jit(target);
 
+    if (!contents->outputs[0].schedule().distributed_gpu_devices().empty() &&
+        target.has_gpu_feature()) {
+        realize_across_gpus(outputs, target, param_map);
+        return;
+    }
+    if (!contents->outputs[0].schedule().co_execute_dim().empty() &&
+        target.has_gpu_feature()) {
+        realize_co_executed(outputs, target, param_map);
+        return;
+    }
+
     // This has to happen after a runtime has been compiled in compile_jit.
     JITFuncCallContext jit_context(jit_handlers());
     void *user_context_storage = &jit_context.jit_context;
@@ -888,6 +1520,14 @@ void Pipeline::realize(RealizationArg outputs, const Target &t,
     prepare_jit_call_arguments(outputs, target, param_map,
                                &user_context_storage, false, args);
 
+    // Values passed through a ParamMap aren't the bound ones, so they
+    // always use the general code.
+    JITModule jit_module =
+        (contents->adaptive_jit_threshold > 0 && &param_map == &ParamMap::empty_map()) ?
+        adaptive_jit_module(target) : contents->current_jit_module();
+    if (!jit_module.compiled()) {
+        jit_module = compiled_jit_module();
+    }
 
     // The handlers in the jit_context default to the default handlers
     // in the runtime of the shared module (e.g. halide_print_impl,
@@ -927,25 +1567,89 @@ void Pipeline::realize(RealizationArg outputs, const Target &t,
     // exception.
 
     debug(2) << "Calling jitted function\n";
-    int exit_status = contents->jit_module.argv_function()(args.store);
+    int exit_status = jit_module.argv_function()(args.store);
     debug(2) << "Back from jitted function. Exit status was " << exit_status << "\n";
 
-    // If we're profiling, report runtimes and reset profiler stats.
-    if (target.has_feature(Target::Profile)) {
-        JITModule::Symbol report_sym =
-            contents->jit_module.find_symbol_by_name("halide_profiler_report");
-        JITModule::Symbol reset_sym =
-            contents->jit_module.find_symbol_by_name("halide_profiler_reset");
-        if (report_sym.address && reset_sym.address) {
-            void *uc = &jit_context.jit_context;
-            void (*report_fn_ptr)(void *) = (void (*)(void *))(report_sym.address);
-            report_fn_ptr(uc);
+    report_profile_if_enabled(jit_module, target, jit_context);
 
-            void (*reset_fn_ptr)() = (void (*)())(reset_sym.address);
-            reset_fn_ptr();
+    jit_context.finalize(exit_status);
+}
+
+Callable Pipeline::bind(const Target &t) {
+    Target target = t;
+    user_assert(defined()) << "Can't bind an undefined Pipeline\n";
+
+    // Pick the target the same way realize does.
+    if (target.os == Target::OSUnknown) {
+        target = contents->default_jit_target();
+    }
+
+    compile_jit(target);
+
+    Callable c;
+    c.module = compiled_jit_module();
+    c.handlers = jit_handlers();
+    c.target = target;
+    c.argv.resize(contents->inferred_args.size());
+
+    size_t arg_index = 0;
+    for (const InferredArgument &arg : contents->inferred_args) {
+        if (arg.param.defined()) {
+            if (arg.param.same_as(contents->user_context_arg.param)) {
+                c.user_context_slot = arg_index;
+            } else {
+                c.call_slots.push_back(arg_index);
+                c.call_is_buffer.push_back(arg.param.is_buffer());
+                c.call_types.push_back(arg.param.type());
+                c.call_names.push_back(arg.param.name());
+            }
+        } else {
+            internal_assert(arg.buffer.defined());
+            c.bound_buffers.push_back(arg.buffer);
+            c.argv[arg_index] = arg.buffer.raw_buffer();
         }
+        arg_index++;
     }
 
+    for (const Func &out : outputs()) {
+        for (int i = 0; i < out.outputs(); i++) {
+            c.call_slots.push_back(arg_index++);
+            c.call_is_buffer.push_back(true);
+            c.call_types.push_back(out.output_types()[i]);
+            c.call_names.push_back(out.name());
+        }
+    }
+    c.argv.resize(arg_index);
+
+    return c;
+}
+
+void Callable::call(const Slot *slots, size_t count) {
+    user_assert(defined()) << "Can't call an undefined Callable\n";
+    user_assert(count == call_slots.size())
+        << "Callable expects " << call_slots.size()
+        << " arguments (its inputs followed by its outputs), but was passed " << count << "\n";
+
+    for (size_t i = 0; i < count; i++) {
+        if (call_is_buffer[i]) {
+            user_assert(slots[i].is_buffer)
+                << "Argument " << i << " of Callable (" << call_names[i] << ") should be a buffer\n";
+        } else {
+            user_assert(!slots[i].is_buffer && call_types[i] == Type(slots[i].type))
+                << "Argument " << i << " of Callable (" << call_names[i] << ") should be a scalar of type "
+                << call_types[i] << "\n";
+        }
+        argv[call_slots[i]] = slots[i].ptr;
+    }
+
+    JITFuncCallContext jit_context(handlers);
+    void *user_context_storage = &jit_context.jit_context;
+    argv[user_context_slot] = &user_context_storage;
+
+    int exit_status = module.argv_function()(argv.data());
+
+    report_profile_if_enabled(module, target, jit_context);
+
     jit_context.finalize(exit_status);
 }
 
@@ -963,14 +1667,8 @@ void Pipeline::infer_input_bounds(RealizationArg outputs, const ParamMap &param_
     prepare_jit_call_arguments(outputs, target, param_map,
                                &user_context_storage, true, args);
 
-    struct TrackedBuffer {
-        // The query buffer, and a backup to check for changes. We
-        // want wrappers around actual buffer_ts so that we can copy
-        // the metadata, not shared pointers to a single buffer, so
-        // it's simpler to use the runtime buffer class.
-        Runtime::Buffer<> query, orig;
-    };
-    vector<TrackedBuffer> tracked_buffers(args_size);
+    vector<Runtime::Buffer<>> query_buffers(args_size);
+    vector<Runtime::Buffer<> *> queries;
 
     vector<size_t> query_indices;
     for (size_t i = 0; i < contents->inferred_args.size(); i++) {
@@ -980,9 +1678,9 @@ void Pipeline::infer_input_bounds(RealizationArg outputs, const ParamMap &param_
             internal_assert(ia.param.defined() && ia.param.is_buffer());
             // Make some empty Buffers of the right dimensionality
             vector<int> initial_shape(ia.param.dimensions(), 0);
-            tracked_buffers[i].query = Runtime::Buffer<>(ia.param.type(), nullptr, initial_shape);
-            tracked_buffers[i].orig = Runtime::Buffer<>(ia.param.type(), nullptr, initial_shape);
-            args.store[i] = tracked_buffers[i].query.raw_buffer();
+            query_buffers[i] = Runtime::Buffer<>(ia.param.type(), nullptr, initial_shape);
+            queries.push_back(&query_buffers[i]);
+            args.store[i] = query_buffers[i].raw_buffer();
         }
     }
 
@@ -992,35 +1690,10 @@ void Pipeline::infer_input_bounds(RealizationArg outputs, const ParamMap &param_
         return;
     }
 
-    int iter = 0;
     const int max_iters = 16;
-    for (iter = 0; iter < max_iters; iter++) {
-        // Make a copy of the buffers that might be mutated
-        for (TrackedBuffer &tb : tracked_buffers) {
-            // Make a copy of the buffer sizes, etc.
-            tb.orig = tb.query;
-        }
-
-        Internal::debug(2) << "Calling jitted function\n";
-        int exit_status = contents->jit_module.argv_function()(args.store);
-        jit_context.report_if_error(exit_status);
-        Internal::debug(2) << "Back from jitted function\n";
-        bool changed = false;
-
-        // Check if there were any changes
-        for (TrackedBuffer &tb : tracked_buffers) {
-            for (int i = 0; i < tb.query.dimensions(); i++) {
-                if (tb.query.dim(i).min() != tb.orig.dim(i).min() ||
-                    tb.query.dim(i).extent() != tb.orig.dim(i).extent() ||
-                    tb.query.dim(i).stride() != tb.orig.dim(i).stride()) {
-                    changed = true;
-                }
-            }
-        }
-        if (!changed) {
-            break;
-        }
-    }
+    JITModule jit_module = compiled_jit_module();
+    int iter = iterate_bounds_query(jit_module.argv_function(), args.store,
+                                    jit_context, queries, max_iters);
 
     jit_context.finalize(0);
 
@@ -1043,14 +1716,14 @@ void Pipeline::infer_input_bounds(RealizationArg outputs, const ParamMap &param_
         internal_assert(!p.buffer().defined());
 
         // Allocate enough memory with the right type and dimensionality.
-        tracked_buffers[i].query.allocate();
+        query_buffers[i].allocate();
 
         if (buf_out_param != nullptr) {
-            *buf_out_param = Buffer<>(*tracked_buffers[i].query.raw_buffer());
+            *buf_out_param = Buffer<>(*query_buffers[i].raw_buffer());
         } else {
             // Bind this parameter to this buffer, giving away the
             // buffer. The user retrieves it via ImageParam::get.
-            p.set_buffer(Buffer<>(std::move(tracked_buffers[i].query)));
+            p.set_buffer(Buffer<>(std::move(query_buffers[i])));
         }
     }
 }
@@ -1073,6 +1746,846 @@ void Pipeline::infer_input_bounds(int x_size, int y_size, int z_size, int w_size
     infer_input_bounds(r, param_map);
 }
 
+void Pipeline::realize_streaming(vector<int32_t> sizes, vector<int32_t> tile_sizes,
+                                 StreamingInputFn fetch, StreamingOutputFn sink,
+                                 const Target &t, const ParamMap &param_map) {
+    user_assert(defined()) << "Can't realize an undefined Pipeline\n";
+    user_assert(fetch && sink) << "realize_streaming requires an input and an output callback\n";
+    user_assert(sizes.size() == tile_sizes.size())
+        << "realize_streaming was given " << sizes.size() << " output sizes but "
+        << tile_sizes.size() << " tile sizes\n";
+
+    // The number of tiles along each dimension. Tiles are visited with
+    // the first dimension innermost.
+    vector<int> tile_counts;
+    int num_tiles = 1;
+    for (size_t d = 0; d < sizes.size(); d++) {
+        user_assert(sizes[d] > 0 && tile_sizes[d] > 0)
+            << "The output and tile sizes passed to realize_streaming must be positive\n";
+        tile_counts.push_back((sizes[d] + tile_sizes[d] - 1) / tile_sizes[d]);
+        num_tiles *= tile_counts.back();
+    }
+
+    // Pick the target the same way realize does.
+    Target target = t;
+    if (target.os == Target::OSUnknown) {
+        target = contents->default_jit_target();
+    }
+
+    compile_jit(target);
+
+    // This has to happen after a runtime has been compiled in compile_jit.
+    JITFuncCallContext jit_context(jit_handlers());
+    void *user_context_storage = &jit_context.jit_context;
+
+    vector<Type> output_types;
+    for (const Func &out : outputs()) {
+        for (Type type : out.output_types()) {
+            output_types.push_back(type);
+        }
+    }
+    const size_t args_size = contents->inferred_args.size() + output_types.size();
+    // Held so that a switch to a tiered-up module can't free the code.
+    const JITModule jit_module = compiled_jit_module();
+    const JITModule::argv_wrapper argv_function = jit_module.argv_function();
+
+    // The state of one tile: its outputs, the regions of the streamed
+    // inputs it needs, and the fetch of those regions in flight.
+    struct Tile {
+        vector<Buffer<>> outputs;
+        vector<size_t> input_indices;
+        vector<Runtime::Buffer<>> inputs;
+        std::future<void> fetched;
+        std::exception_ptr fetch_error;
+
+        ~Tile() {
+            // The fetch refers to the buffers of this tile.
+            if (fetched.valid()) {
+                fetched.wait();
+            }
+        }
+    };
+
+    // Make the buffers of a tile, and start fetching its inputs.
+    auto start_tile = [&](int index) {
+        std::unique_ptr<Tile> tile(new Tile);
+        vector<int> mins, extents;
+        for (size_t d = 0; d < sizes.size(); d++) {
+            mins.push_back((index % tile_counts[d]) * tile_sizes[d]);
+            extents.push_back(std::min(tile_sizes[d], sizes[d] - mins.back()));
+            index /= tile_counts[d];
+        }
+        for (Type type : output_types) {
+            Buffer<> buf(type, extents);
+            buf.set_min(mins);
+            tile->outputs.push_back(buf);
+        }
+
+        Realization r(tile->outputs);
+        RealizationArg outputs(r);
+        JITCallArgs args(args_size);
+        prepare_jit_call_arguments(outputs, target, param_map,
+                                   &user_context_storage, true, args);
+
+        for (size_t i = 0; i < contents->inferred_args.size(); i++) {
+            if (args.store[i] == nullptr) {
+                const Parameter &p = contents->inferred_args[i].param;
+                internal_assert(p.defined() && p.is_buffer());
+                tile->input_indices.push_back(i);
+                tile->inputs.emplace_back(p.type(), nullptr, vector<int>(p.dimensions(), 0));
+            }
+        }
+        if (tile->inputs.empty()) {
+            return tile;
+        }
+
+        vector<Runtime::Buffer<> *> queries;
+        for (size_t i = 0; i < tile->inputs.size(); i++) {
+            queries.push_back(&tile->inputs[i]);
+            args.store[tile->input_indices[i]] = tile->inputs[i].raw_buffer();
+        }
+        const int max_iters = 16;
+        int iter = iterate_bounds_query(argv_function, args.store, jit_context, queries, max_iters);
+        user_assert(iter < max_iters)
+            << "Inferring input bounds on Pipeline"
+            << " didn't converge after " << max_iters
+            << " iterations. There may be unsatisfiable constraints\n";
+
+        vector<string> names;
+        for (size_t i = 0; i < tile->inputs.size(); i++) {
+            tile->inputs[i].allocate();
+            names.push_back(contents->inferred_args[tile->input_indices[i]].param.name());
+        }
+
+        Tile *tile_ptr = tile.get();
+        tile->fetched = streaming_fetch_pool().async([tile_ptr, names, &fetch]() {
+            try {
+                for (size_t i = 0; i < tile_ptr->inputs.size(); i++) {
+                    Buffer<> region(*tile_ptr->inputs[i].raw_buffer());
+                    fetch(names[i], region);
+                    tile_ptr->inputs[i].set_host_dirty();
+                }
+            } catch (...) {
+                tile_ptr->fetch_error = std::current_exception();
+            }
+        });
+        return tile;
+    };
+
+    std::unique_ptr<Tile> next = start_tile(0);
+    for (int i = 0; i < num_tiles; i++) {
+        std::unique_ptr<Tile> tile = std::move(next);
+        if (i + 1 < num_tiles) {
+            next = start_tile(i + 1);
+        }
+
+        if (tile->fetched.valid()) {
+            tile->fetched.wait();
+        }
+        if (tile->fetch_error) {
+            std::rethrow_exception(tile->fetch_error);
+        }
+
+        Realization r(tile->outputs);
+        RealizationArg outputs(r);
+        JITCallArgs args(args_size);
+        prepare_jit_call_arguments(outputs, target, param_map,
+                                   &user_context_storage, false, args);
+        for (size_t j = 0; j < tile->inputs.size(); j++) {
+            args.store[tile->input_indices[j]] = tile->inputs[j].raw_buffer();
+        }
+
+        debug(2) << "Calling jitted function for tile " << i << " of " << num_tiles << "\n";
+        int exit_status = argv_function(args.store);
+        jit_context.report_if_error(exit_status);
+
+        for (Buffer<> &buf : tile->outputs) {
+            buf.copy_to_host();
+        }
+        sink(r);
+    }
+
+    jit_context.finalize(0);
+}
+
+namespace {
+
+// A (min, extent) in each dimension.
+typedef vector<std::pair<int, int>> DistributedRegion;
+
+// The intersection of two regions, or an empty region if they don't
+// overlap.
+DistributedRegion intersect_regions(const DistributedRegion &a, const DistributedRegion &b) {
+    DistributedRegion result;
+    for (size_t d = 0; d < a.size() && d < b.size(); d++) {
+        int lo = std::max(a[d].first, b[d].first);
+        int hi = std::min(a[d].first + a[d].second, b[d].first + b[d].second);
+        if (hi <= lo) {
+            return DistributedRegion();
+        }
+        result.push_back({lo, hi - lo});
+    }
+    return result;
+}
+
+DistributedRegion region_of(const Runtime::Buffer<> &buf) {
+    DistributedRegion result;
+    for (int d = 0; d < buf.dimensions(); d++) {
+        result.push_back({buf.dim(d).min(), buf.dim(d).extent()});
+    }
+    return result;
+}
+
+// Exchange a message with every other rank. Each pair of ranks
+// exchanges in the same order, with the lower rank sending first, so
+// this can't deadlock even if sends block.
+void exchange_with_peers(DistributedTransport &transport,
+                         std::function<void(int)> send_to, std::function<void(int)> recv_from) {
+    const int rank = transport.rank();
+    for (int peer = 0; peer < transport.size(); peer++) {
+        if (peer == rank) {
+            continue;
+        }
+        if (rank < peer) {
+            send_to(peer);
+            recv_from(peer);
+        } else {
+            recv_from(peer);
+            send_to(peer);
+        }
+    }
+}
+
+}  // namespace
+
+Realization Pipeline::realize_distributed(vector<int32_t> sizes,
+                                          const std::map<string, Buffer<>> &local_inputs,
+                                          DistributedTransport &transport,
+                                          const Target &t, const ParamMap &param_map) {
+    user_assert(defined()) << "Can't realize an undefined Pipeline\n";
+    const int rank = transport.rank(), num_ranks = transport.size();
+    user_assert(num_ranks > 0 && rank >= 0 && rank < num_ranks)
+        << "Bad distributed transport: rank " << rank << " of " << num_ranks << "\n";
+
+    // Pick the dimension to partition.
+    const Function &first_output = contents->outputs[0];
+    user_assert((int)sizes.size() == first_output.dimensions())
+        << "realize_distributed was given " << sizes.size() << " output sizes for Func "
+        << first_output.name() << ", which has " << first_output.dimensions() << " dimensions\n";
+    int dim = (int)sizes.size() - 1;
+    const string &distributed = first_output.schedule().distributed_dim();
+    for (size_t i = 0; i < first_output.args().size(); i++) {
+        if (first_output.args()[i] == distributed) {
+            dim = (int)i;
+        }
+    }
+
+    // The slice of the output each rank computes.
+    vector<DistributedRegion> slices(num_ranks);
+    const int slice_size = (sizes[dim] + num_ranks - 1) / num_ranks;
+    for (int r = 0; r < num_ranks; r++) {
+        for (int d = 0; d < (int)sizes.size(); d++) {
+            slices[r].push_back({0, sizes[d]});
+        }
+        const int min = std::min(sizes[dim], r * slice_size);
+        slices[r][dim] = {min, std::min(slice_size, sizes[dim] - min)};
+    }
+
+    // Pick the target the same way realize does.
+    Target target = t;
+    if (target.os == Target::OSUnknown) {
+        target = contents->default_jit_target();
+    }
+
+    compile_jit(target);
+
+    // This has to happen after a runtime has been compiled in compile_jit.
+    JITFuncCallContext jit_context(jit_handlers());
+    void *user_context_storage = &jit_context.jit_context;
+
+    vector<Type> output_types;
+    for (const Func &out : outputs()) {
+        for (Type type : out.output_types()) {
+            output_types.push_back(type);
+        }
+    }
+    const size_t args_size = contents->inferred_args.size() + output_types.size();
+    // Held so that a switch to a tiered-up module can't free the code.
+    const JITModule jit_module = compiled_jit_module();
+    const JITModule::argv_wrapper argv_function = jit_module.argv_function();
+
+    // The region of each unbound input that the slice of each rank
+    // needs, found by a bounds query on that slice.
+    vector<size_t> input_indices;
+    vector<Runtime::Buffer<>> local;
+    vector<vector<DistributedRegion>> required;
+    for (int r = 0; r < num_ranks; r++) {
+        vector<int> mins, extents;
+        bool empty = false;
+        for (const std::pair<int, int> &s : slices[r]) {
+            mins.push_back(s.first);
+            extents.push_back(s.second);
+            empty = empty || s.second <= 0;
+        }
+        vector<Buffer<>> output_queries;
+        for (Type type : output_types) {
+            Buffer<> query(Runtime::Buffer<>(type, nullptr, extents));
+            query.set_min(mins);
+            output_queries.push_back(query);
+        }
+        Realization outputs_r(output_queries);
+        RealizationArg outputs(outputs_r);
+        JITCallArgs args(args_size);
+        prepare_jit_call_arguments(outputs, target, param_map,
+                                   &user_context_storage, true, args);
+
+        vector<Runtime::Buffer<>> queries;
+        for (size_t i = 0; i < contents->inferred_args.size(); i++) {
+            if (args.store[i] != nullptr) {
+                continue;
+            }
+            const Parameter &p = contents->inferred_args[i].param;
+            internal_assert(p.defined() && p.is_buffer());
+            if (r == 0) {
+                auto it = local_inputs.find(p.name());
+                user_assert(it != local_inputs.end() && it->second.defined())
+                    << "realize_distributed needs this rank's part of the input " << p.name() << "\n";
+                user_assert(it->second.type() == p.type() && it->second.dimensions() == p.dimensions())
+                    << "The part of the input " << p.name() << " passed to realize_distributed "
+                    << "doesn't match its type or dimensionality\n";
+                input_indices.push_back(i);
+                local.push_back(*it->second.get());
+                required.emplace_back(num_ranks);
+            }
+            queries.emplace_back(p.type(), nullptr, vector<int>(p.dimensions(), 0));
+        }
+        if (empty || queries.empty()) {
+            continue;
+        }
+
+        vector<Runtime::Buffer<> *> query_ptrs;
+        for (size_t i = 0; i < queries.size(); i++) {
+            query_ptrs.push_back(&queries[i]);
+            args.store[input_indices[i]] = queries[i].raw_buffer();
+        }
+        const int max_iters = 16;
+        int iter = iterate_bounds_query(argv_function, args.store, jit_context, query_ptrs, max_iters);
+        user_assert(iter < max_iters)
+            << "Inferring input bounds on Pipeline"
+            << " didn't converge after " << max_iters
+            << " iterations. There may be unsatisfiable constraints\n";
+        for (size_t i = 0; i < queries.size(); i++) {
+            required[i][r] = region_of(queries[i]);
+        }
+    }
+
+    // Tell every other rank which parts of the inputs this rank holds.
+    vector<vector<DistributedRegion>> held(local.size(), vector<DistributedRegion>(num_ranks));
+    for (size_t i = 0; i < local.size(); i++) {
+        held[i][rank] = region_of(local[i]);
+    }
+    exchange_with_peers(transport,
+                        [&](int peer) {
+                            vector<int32_t> msg;
+                            for (size_t i = 0; i < local.size(); i++) {
+                                for (const std::pair<int, int> &d : held[i][rank]) {
+                                    msg.push_back(d.first);
+                                    msg.push_back(d.second);
+                                }
+                            }
+                            transport.send(peer, msg.data(), msg.size() * sizeof(int32_t));
+                        },
+                        [&](int peer) {
+                            size_t count = 0;
+                            for (const Runtime::Buffer<> &buf : local) {
+                                count += 2 * buf.dimensions();
+                            }
+                            vector<int32_t> msg(count);
+                            transport.recv(peer, msg.data(), msg.size() * sizeof(int32_t));
+                            size_t j = 0;
+                            for (size_t i = 0; i < local.size(); i++) {
+                                for (int d = 0; d < local[i].dimensions(); d++, j += 2) {
+                                    held[i][peer].push_back({msg[j], msg[j + 1]});
+                                }
+                            }
+                        });
+
+    // Gather the region of each input this rank needs: the part it
+    // holds itself, and the halos held by other ranks.
+    vector<Runtime::Buffer<>> gathered;
+    for (size_t i = 0; i < local.size(); i++) {
+        const DistributedRegion &r = required[i][rank];
+        if (r.empty()) {
+            gathered.emplace_back();
+            continue;
+        }
+        vector<int> extents;
+        for (const std::pair<int, int> &d : r) {
+            extents.push_back(d.second);
+        }
+        Runtime::Buffer<> buf(local[i].type(), extents);
+        for (size_t d = 0; d < r.size(); d++) {
+            buf.translate(d, r[d].first);
+        }
+        buf.copy_from(local[i]);
+        gathered.push_back(buf);
+    }
+    exchange_with_peers(transport,
+                        [&](int peer) {
+                            for (size_t i = 0; i < local.size(); i++) {
+                                DistributedRegion r = intersect_regions(required[i][peer], held[i][rank]);
+                                if (r.empty()) {
+                                    continue;
+                                }
+                                Runtime::Buffer<> part = local[i].cropped(r).copy();
+                                transport.send(peer, part.data(), part.size_in_bytes());
+                            }
+                        },
+                        [&](int peer) {
+                            for (size_t i = 0; i < local.size(); i++) {
+                                DistributedRegion r = intersect_regions(required[i][rank], held[i][peer]);
+                                if (r.empty()) {
+                                    continue;
+                                }
+                                Runtime::Buffer<> part = gathered[i].cropped(r).copy();
+                                transport.recv(peer, part.data(), part.size_in_bytes());
+                                gathered[i].copy_from(part);
+                            }
+                        });
+
+    // Compute this rank's slice.
+    vector<int> mins, extents;
+    bool empty = false;
+    for (const std::pair<int, int> &s : slices[rank]) {
+        mins.push_back(s.first);
+        extents.push_back(s.second);
+        empty = empty || s.second <= 0;
+    }
+    vector<Buffer<>> result;
+    for (Type type : output_types) {
+        Buffer<> buf(type, extents);
+        buf.set_min(mins);
+        result.push_back(buf);
+    }
+    Realization r(result);
+    if (!empty) {
+        RealizationArg outputs(r);
+        JITCallArgs args(args_size);
+        prepare_jit_call_arguments(outputs, target, param_map,
+                                   &user_context_storage, false, args);
+        for (size_t i = 0; i < input_indices.size(); i++) {
+            gathered[i].set_host_dirty();
+            args.store[input_indices[i]] = gathered[i].raw_buffer();
+        }
+
+        debug(2) << "Calling jitted function for rank " << rank << " of " << num_ranks << "\n";
+        int exit_status = argv_function(args.store);
+        jit_context.report_if_error(exit_status);
+
+        for (Buffer<> &buf : result) {
+            buf.copy_to_host();
+        }
+    }
+
+    jit_context.finalize(0);
+    return r;
+}
+
+namespace {
+
+// A buffer over the given region of the host memory of buf, with no
+// device allocation, so it can get one of its own.
+Runtime::Buffer<> host_alias(const halide_buffer_t &buf, const DistributedRegion &region) {
+    halide_buffer_t alias = buf;
+    alias.device = 0;
+    alias.device_interface = nullptr;
+    alias.flags = 0;
+    Runtime::Buffer<> result(alias);
+    for (size_t d = 0; d < region.size(); d++) {
+        result.crop((int)d, region[d].first, region[d].second);
+    }
+    return result;
+}
+
+}  // namespace
+
+// The output buffers of a realization.
+vector<halide_buffer_t *> Pipeline::output_buffers(RealizationArg &outputs) {
+    vector<halide_buffer_t *> result;
+    if (outputs.r) {
+        for (size_t i = 0; i < outputs.r->size(); i++) {
+            result.push_back((*outputs.r)[i].raw_buffer());
+        }
+    } else if (outputs.buf) {
+        result.push_back(outputs.buf);
+    } else {
+        for (Buffer<> &buf : *outputs.buffer_list) {
+            result.push_back(buf.raw_buffer());
+        }
+    }
+    return result;
+}
+
+void Pipeline::realize_slice(const vector<halide_buffer_t *> &output_bufs, int dim, int min, int extent,
+                             const Target &target, const ParamMap &param_map,
+                             int gpu_device, int flag_index, bool flag) {
+    // Held so that a switch to a tiered-up module can't free the code.
+    const JITModule jit_module = compiled_jit_module();
+    const JITModule::argv_wrapper argv_function = jit_module.argv_function();
+    int (*set_device)(void *, int) = (int (*)(void *, int))
+        jit_module.find_symbol_by_name("halide_set_gpu_device_for_user_context").address;
+    void (*clear_device)(void *) = (void (*)(void *))
+        jit_module.find_symbol_by_name("halide_clear_gpu_device_for_user_context").address;
+    internal_assert(set_device && clear_device);
+
+    vector<size_t> input_indices;
+    for (size_t i = 0; i < contents->inferred_args.size(); i++) {
+        if (contents->inferred_args[i].arg.is_buffer()) {
+            input_indices.push_back(i);
+        }
+    }
+    const size_t args_size = contents->inferred_args.size() + output_bufs.size();
+
+    JITFuncCallContext jit_context(jit_handlers());
+    void *user_context_storage = &jit_context.jit_context;
+    if (gpu_device >= -1) {
+        user_assert(set_device(user_context_storage, gpu_device) == 0)
+            << "Too many pipelines are using their own GPU device at once\n";
+    }
+
+    // The slices of the outputs, and the regions of the inputs they
+    // need, are aliases of the host memory of the originals with no
+    // device allocation, so each can get its own on the slice's
+    // device.
+    vector<Buffer<>> slice_outputs, output_queries;
+    for (halide_buffer_t *buf : output_bufs) {
+        DistributedRegion region = region_of(Runtime::Buffer<>(*buf));
+        region[dim] = {min, extent};
+        slice_outputs.emplace_back(host_alias(*buf, region));
+        vector<int> mins, extents;
+        for (const std::pair<int, int> &d : region) {
+            mins.push_back(d.first);
+            extents.push_back(d.second);
+        }
+        Buffer<> query(Runtime::Buffer<>(buf->type, nullptr, extents));
+        query.set_min(mins);
+        output_queries.push_back(query);
+    }
+
+    vector<Runtime::Buffer<>> slice_inputs;
+    auto release = [&]() {
+        for (Buffer<> &buf : slice_outputs) {
+            halide_buffer_t *raw = buf.raw_buffer();
+            if (raw->device_interface) {
+                raw->device_interface->device_free(user_context_storage, raw);
+            }
+        }
+        for (Runtime::Buffer<> &buf : slice_inputs) {
+            buf.device_free(user_context_storage);
+        }
+        clear_device(user_context_storage);
+    };
+
+    try {
+        // Find the region of each input the slice needs.
+        Realization queries_r(output_queries);
+        RealizationArg queries_arg(queries_r);
+        JITCallArgs query_args(args_size);
+        prepare_jit_call_arguments(queries_arg, target, param_map,
+                                   &user_context_storage, true, query_args);
+        if (flag_index >= 0) {
+            query_args.store[flag_index] = &flag;
+        }
+        vector<Runtime::Buffer<>> queries;
+        for (size_t i : input_indices) {
+            const halide_buffer_t *orig = (const halide_buffer_t *)query_args.store[i];
+            user_assert(orig) << "Realizing a Pipeline in slices needs all inputs to be bound\n";
+            queries.emplace_back(orig->type, nullptr, vector<int>(orig->dimensions, 0));
+        }
+        vector<Runtime::Buffer<> *> query_ptrs;
+        for (size_t i = 0; i < queries.size(); i++) {
+            query_ptrs.push_back(&queries[i]);
+            query_args.store[input_indices[i]] = queries[i].raw_buffer();
+        }
+        const int max_iters = 16;
+        int iter = iterate_bounds_query(argv_function, query_args.store, jit_context, query_ptrs, max_iters);
+        user_assert(iter < max_iters)
+            << "Inferring input bounds on Pipeline"
+            << " didn't converge after " << max_iters
+            << " iterations. There may be unsatisfiable constraints\n";
+
+        // Give the slice just those regions of the inputs. Regions
+        // of inputs already on a device come directly from there,
+        // peer to peer where the devices support it. The rest are
+        // copied from the host by the pipeline as usual.
+        Realization outputs_r(slice_outputs);
+        RealizationArg outputs_arg(outputs_r);
+        JITCallArgs args(args_size);
+        prepare_jit_call_arguments(outputs_arg, target, param_map,
+                                   &user_context_storage, false, args);
+        if (flag_index >= 0) {
+            args.store[flag_index] = &flag;
+        }
+        slice_inputs.reserve(input_indices.size());
+        for (size_t i = 0; i < input_indices.size(); i++) {
+            halide_buffer_t *orig = (halide_buffer_t *)args.store[input_indices[i]];
+            DistributedRegion needed = region_of(queries[i]);
+            user_assert(intersect_regions(needed, region_of(Runtime::Buffer<>(*orig))) == needed)
+                << "Input buffer " << contents->inferred_args[input_indices[i]].arg.name
+                << " doesn't cover the region needed by a slice of the output "
+                << "over [" << min << ", " << min + extent << ")\n";
+            slice_inputs.push_back(host_alias(*orig, needed));
+            halide_buffer_t *in = slice_inputs.back().raw_buffer();
+            if (orig->device_dirty()) {
+                int err = orig->device_interface->buffer_copy(user_context_storage, orig,
+                                                              orig->device_interface, in);
+                jit_context.report_if_error(err);
+            } else {
+                in->set_host_dirty(true);
+            }
+            args.store[input_indices[i]] = in;
+        }
+
+        debug(2) << "Calling jitted function for the slice over [" << min << ", " << min + extent << ")\n";
+        int exit_status = argv_function(args.store);
+        jit_context.report_if_error(exit_status);
+
+        for (Buffer<> &buf : slice_outputs) {
+            halide_buffer_t *raw = buf.raw_buffer();
+            if (raw->device_dirty()) {
+                jit_context.report_if_error(raw->device_interface->copy_to_host(user_context_storage, raw));
+            }
+        }
+    } catch (...) {
+        release();
+        throw;
+    }
+    release();
+}
+
+namespace {
+
+// Run the given functions concurrently, one per thread, and rethrow
+// the first exception any of them threw.
+void run_concurrently(const vector<std::function<void()>> &fns) {
+    vector<std::thread> threads;
+    vector<std::exception_ptr> errors(fns.size());
+    for (size_t i = 0; i < fns.size(); i++) {
+        threads.emplace_back([&, i]() {
+            try {
+                fns[i]();
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        });
+    }
+    for (std::thread &t : threads) {
+        t.join();
+    }
+    for (std::exception_ptr &e : errors) {
+        if (e) {
+            std::rethrow_exception(e);
+        }
+    }
+}
+
+// The results of a realization in slices are in host memory.
+void mark_host_results(const vector<halide_buffer_t *> &output_bufs) {
+    for (halide_buffer_t *buf : output_bufs) {
+        buf->set_device_dirty(false);
+        buf->set_host_dirty(buf->device != 0);
+    }
+}
+
+// The index of the dimension of f that the given schedule marks, or
+// its outermost one.
+int dimension_named(const Function &f, const string &name) {
+    for (size_t i = 0; i < f.args().size(); i++) {
+        if (f.args()[i] == name) {
+            return (int)i;
+        }
+    }
+    return f.dimensions() - 1;
+}
+
+}  // namespace
+
+void Pipeline::realize_across_gpus(RealizationArg &outputs, const Target &target,
+                                   const ParamMap &param_map) {
+    const Function &first_output = contents->outputs[0];
+    const vector<int> &devices = first_output.schedule().distributed_gpu_devices();
+    const int dim = dimension_named(first_output, first_output.schedule().distributed_gpu_dim());
+
+    vector<halide_buffer_t *> output_bufs = output_buffers(outputs);
+    for (halide_buffer_t *buf : output_bufs) {
+        user_assert(buf->host)
+            << "Realizing across GPU devices needs output buffers with host memory\n";
+    }
+
+    // Each slice runs the ordinary pipeline on its own thread, with a
+    // user_context that selects its device.
+    const int num_slices = (int)devices.size();
+    const halide_dimension_t whole = output_bufs[0]->dim[dim];
+    const int slice_size = (whole.extent + num_slices - 1) / num_slices;
+    vector<std::function<void()>> slices;
+    for (int s = 0; s < num_slices; s++) {
+        const int min = whole.min + std::min(whole.extent, s * slice_size);
+        const int extent = std::min(slice_size, whole.min + whole.extent - min);
+        if (extent > 0) {
+            slices.push_back([&, s, min, extent]() {
+                realize_slice(output_bufs, dim, min, extent, target, param_map, devices[s], -1, false);
+            });
+        }
+    }
+    run_concurrently(slices);
+    mark_host_results(output_bufs);
+}
+
+void Pipeline::realize_co_executed(RealizationArg &outputs, const Target &target,
+                                   const ParamMap &param_map) {
+    const Function &first_output = contents->outputs[0];
+    const int dim = dimension_named(first_output, first_output.schedule().co_execute_dim());
+    const string flag_name = first_output.name() + "_on_gpu";
+    int flag_index = -1;
+    for (size_t i = 0; i < contents->inferred_args.size(); i++) {
+        if (contents->inferred_args[i].arg.name == flag_name) {
+            flag_index = (int)i;
+        }
+    }
+    internal_assert(flag_index >= 0) << "No argument " << flag_name << " to select the GPU part\n";
+
+    vector<halide_buffer_t *> output_bufs = output_buffers(outputs);
+    for (halide_buffer_t *buf : output_bufs) {
+        user_assert(buf->host)
+            << "Co-executing on a GPU and the host needs output buffers with host memory\n";
+    }
+
+    // The GPU part gets the first rows, and the host part the rest,
+    // keeping at least one row for each where there are two.
+    const halide_dimension_t whole = output_bufs[0]->dim[dim];
+    const double share = contents->co_execute_gpu_share.load();
+    int gpu_extent = (int)std::lround(whole.extent * share);
+    if (whole.extent > 1) {
+        gpu_extent = std::max(1, std::min(whole.extent - 1, gpu_extent));
+    }
+    const int cpu_extent = whole.extent - gpu_extent;
+
+    // Time each part, to rebalance the next realization.
+    double gpu_seconds = 0, cpu_seconds = 0;
+    auto timed = [&](double *seconds, int min, int extent, bool on_gpu) {
+        return [=, &target, &param_map, &output_bufs]() {
+            if (extent <= 0) {
+                return;
+            }
+            auto start = std::chrono::high_resolution_clock::now();
+            realize_slice(output_bufs, dim, min, extent, target, param_map, -2, flag_index, on_gpu);
+            auto end = std::chrono::high_resolution_clock::now();
+            *seconds = std::chrono::duration<double>(end - start).count();
+        };
+    };
+    run_concurrently({timed(&gpu_seconds, whole.min, gpu_extent, true),
+                      timed(&cpu_seconds, whole.min + gpu_extent, cpu_extent, false)});
+    mark_host_results(output_bufs);
+
+    // Move the share halfway toward the one at which both parts would
+    // have taken the same time, but never give either all the rows, so
+    // that both keep being measured.
+    if (gpu_seconds > 0 && cpu_seconds > 0) {
+        const double gpu_rate = gpu_extent / gpu_seconds;
+        const double cpu_rate = cpu_extent / cpu_seconds;
+        const double balanced = gpu_rate / (gpu_rate + cpu_rate);
+        const double next = std::min(31.0 / 32, std::max(1.0 / 32, 0.5 * share + 0.5 * balanced));
+        debug(2) << "Co-executed " << gpu_extent << " rows on the GPU in " << gpu_seconds
+                 << "s and " << cpu_extent << " on the host in " << cpu_seconds
+                 << "s. The GPU now gets a share of " << next << "\n";
+        contents->co_execute_gpu_share = next;
+    }
+}
+
+vector<vector<std::pair<int, int>>> Pipeline::realize_incremental(
+    Realization &previous, const string &changed, const vector<std::pair<int, int>> &changed_region,
+    const Target &target, const ParamMap &param_map) {
+    user_assert(defined()) << "Can't realize an undefined Pipeline\n";
+
+    std::map<string, Function> env;
+    for (Function f : contents->outputs) {
+        std::map<string, Function> more_funcs = find_transitive_calls(f);
+        env.insert(more_funcs.begin(), more_funcs.end());
+    }
+    vector<string> order = topological_order(contents->outputs, env);
+
+    Box changed_box;
+    for (const std::pair<int, int> &r : changed_region) {
+        changed_box.push_back(Interval(r.first, r.first + r.second - 1));
+    }
+    std::map<string, Box> affected = boxes_affected(order, env, changed, changed_box);
+
+    // Crop each output buffer to the region that may have changed. All
+    // outputs must be passed to a realization, so an output that didn't
+    // change but has one that did gets whatever part of that region it
+    // has, or a single element.
+    vector<Buffer<>> crops;
+    vector<vector<std::pair<int, int>>> result;
+    bool any_affected = false;
+    size_t buffer_index = 0;
+    for (Function f : contents->outputs) {
+        user_assert(buffer_index + f.outputs() <= previous.size())
+            << "The Realization passed to realize_incremental has " << previous.size()
+            << " buffers, which is too few for the outputs of the Pipeline\n";
+        const Buffer<> &buf = previous[buffer_index];
+        user_assert(buf.defined() && buf.dimensions() == f.dimensions())
+            << "The Realization passed to realize_incremental doesn't match the output "
+            << f.name() << " of the Pipeline\n";
+
+        // Any bound of the affected box that isn't a constant is
+        // taken to be the edge of the buffer.
+        auto it = affected.find(f.name());
+        vector<std::pair<int, int>> region;
+        for (int d = 0; d < buf.dimensions(); d++) {
+            int lo = buf.dim(d).min(), hi = buf.dim(d).max();
+            if (it != affected.end()) {
+                const Interval &i = it->second[d];
+                const int64_t *min = i.has_lower_bound() ? as_const_int(simplify(i.min)) : nullptr;
+                const int64_t *max = i.has_upper_bound() ? as_const_int(simplify(i.max)) : nullptr;
+                if (min) {
+                    lo = (int)std::max((int64_t)lo, *min);
+                }
+                if (max) {
+                    hi = (int)std::min((int64_t)hi, *max);
+                }
+            }
+            region.push_back({lo, hi - lo + 1});
+        }
+        bool empty = it == affected.end();
+        for (const std::pair<int, int> &r : region) {
+            empty = empty || r.second <= 0;
+        }
+        any_affected = any_affected || !empty;
+        if (empty) {
+            for (int d = 0; d < buf.dimensions(); d++) {
+                region[d] = {buf.dim(d).min(), 1};
+            }
+        }
+        result.push_back(region);
+
+        for (int i = 0; i < f.outputs(); i++) {
+            Buffer<> crop(*previous[buffer_index + i].raw_buffer());
+            crop.crop(region);
+            crops.push_back(crop);
+        }
+        buffer_index += f.outputs();
+    }
+
+    if (!any_affected) {
+        debug(1) << "No output of the Pipeline depends on the change to " << changed << "\n";
+        return vector<vector<std::pair<int, int>>>();
+    }
+
+    Realization r(crops);
+    realize(r, target, param_map);
+    return result;
+}
+
 void Pipeline::invalidate_cache() {
     if (defined()) {
         contents->invalidate_cache();
@@ -7,6 +7,7 @@
  * pipeline.
  */
 
+#include <future>
 #include <vector>
 
 #include "AutoSchedule.h"
@@ -54,6 +55,125 @@ struct CustomLoweringPass {
 
 struct JITExtern;
 
+/** The callbacks of Pipeline::realize_streaming. The input callback is
+ * given the name of an ImageParam and a buffer covering the region of
+ * it that one tile of the output needs, which it must fill in. The
+ * output callback is given each finished tile of the output. */
+// @{
+typedef std::function<void(const std::string &, Buffer<> &)> StreamingInputFn;
+typedef std::function<void(Realization &)> StreamingOutputFn;
+// @}
+
+/** How the ranks of Pipeline::realize_distributed talk to each
+ * other. Implement this over MPI (see tools/halide_mpi_transport.h) or
+ * another message-passing library. Messages between each pair of ranks
+ * must arrive in the order they were sent. send may block until the
+ * matching recv begins. */
+class DistributedTransport {
+public:
+    virtual ~DistributedTransport() {}
+
+    /** The index of this rank, and the number of ranks. */
+    // @{
+    virtual int rank() = 0;
+    virtual int size() = 0;
+    // @}
+
+    /** Send a message to another rank, or receive one from it. */
+    // @{
+    virtual void send(int to, const void *data, size_t size) = 0;
+    virtual void recv(int from, void *data, size_t size) = 0;
+    // @}
+};
+
+/** A jit-compiled Pipeline with its argument slots resolved ahead of
+ * time, for calling repeatedly with low overhead. Made by
+ * Pipeline::bind. Calling it does no argument inference, no ParamMap
+ * lookups, and no heap allocation. A Callable captures the compiled
+ * code and the custom handlers of the Pipeline at the time it was
+ * bound, and is unaffected by later changes to the Pipeline. A
+ * single Callable should not be called from multiple threads at
+ * once. */
+class Callable {
+public:
+    /** The value passed for one argument slot. */
+    struct Slot {
+        const void *ptr{nullptr};
+        halide_type_t type;
+        bool is_buffer{false};
+    };
+
+    Callable() = default;
+
+    /** Run the pipeline. The arguments are the values of the Params
+     * and ImageParams of the Pipeline, in the order returned by
+     * Pipeline::infer_arguments, followed by the output buffers.
+     * Scalars must have exactly the type of the corresponding Param.
+     * Buffers may be passed as a Buffer, a Runtime::Buffer, or a
+     * halide_buffer_t pointer. As for Pipeline::realize, output
+     * buffers must be allocated, and are not copied back from the
+     * device. */
+    template<typename ...Args>
+    void operator()(Args&&... args) {
+        // One extra entry so that the array is never empty.
+        const Slot slots[sizeof...(Args) + 1] = {make_slot(args)..., Slot()};
+        call(slots, sizeof...(Args));
+    }
+
+    /** Check if this Callable has been bound to a Pipeline. */
+    bool defined() const {
+        return module.argv_function() != nullptr;
+    }
+
+private:
+    friend class Pipeline;
+
+    static Slot make_slot(halide_buffer_t *buf) {
+        Slot s;
+        s.ptr = buf;
+        s.is_buffer = true;
+        return s;
+    }
+
+    template<typename T, int D>
+    static Slot make_slot(Runtime::Buffer<T, D> &buf) {
+        return make_slot(buf.raw_buffer());
+    }
+
+    template<typename T>
+    static Slot make_slot(Buffer<T> &buf) {
+        return make_slot(buf.raw_buffer());
+    }
+
+    template<typename T,
+             typename = typename std::enable_if<std::is_scalar<T>::value>::type>
+    static Slot make_slot(const T &scalar) {
+        Slot s;
+        s.ptr = &scalar;
+        s.type = halide_type_of<T>();
+        return s;
+    }
+
+    void call(const Slot *slots, size_t count);
+
+    Internal::JITModule module;
+    Internal::JITHandlers handlers;
+    Target target;
+
+    // The arguments to the argv function. Constant images are filled
+    // in at bind time, the rest at each call.
+    std::vector<const void *> argv;
+    std::vector<Buffer<>> bound_buffers;
+    size_t user_context_slot{0};
+
+    // The slots the caller supplies, in order, and what is expected
+    // in each of them.
+    std::vector<size_t> call_slots;
+    std::vector<bool> call_is_buffer;
+    std::vector<Type> call_types;
+    std::vector<std::string> call_names;
+};
+
 /** A class representing a Halide pipeline. Constructed from the Func
  * or Funcs that it outputs. */
 class Pipeline {
@@ -116,10 +236,13 @@ public:
     /** Get the Funcs this pipeline outputs. */
     std::vector<Func> outputs() const;
 
-    /** Generate a schedule for the pipeline. */
+    /** Generate a schedule for the pipeline. If 'autotune_candidates' is
+     * greater than one, up to that many candidate schedules are JIT-compiled
+     * and timed over the estimated output bounds, and the fastest is used. */
     //@{
     std::string auto_schedule(const Target &target,
-                              const MachineParams &arch_params = MachineParams::generic());
+                              const MachineParams &arch_params = MachineParams::generic(),
+                              int autotune_candidates = 0);
     //@}
 
     /** Return handle to the index-th Func within the pipeline based on the
@@ -195,11 +318,15 @@ public:
 
     /** Write out an internal representation of lowered code. Useful
      * for analyzing and debugging scheduling. Can emit html or plain
-     * text. */
+     * text. When emitting html, profile_json may name a JSON profiler
+     * report (see HL_PROFILER_JSON_FILE) from an earlier run of this
+     * pipeline, and the time measured for each Func is shown on its
+     * produce node. */
     void compile_to_lowered_stmt(const std::string &filename,
                                  const std::vector<Argument> &args,
                                  StmtOutputFormat fmt = Text,
-                                 const Target &target = get_target_from_environment());
+                                 const Target &target = get_target_from_environment(),
+                                 const std::string &profile_json = "");
 
     /** Write out the loop nests specified by the schedule for this
      * Pipeline's Funcs. Helpful for understanding what a schedule is
@@ -231,6 +358,14 @@ public:
                                                const std::vector<Argument> &args,
                                                const std::vector<Target> &targets);
 
+    /** Like compile_to_multitarget_static_library, but produces a
+     * single object file and header pair. The object contains the
+     * code for every target, the feature-detecting dispatcher, and
+     * (unless the targets have no_runtime) the runtime. */
+    void compile_to_multitarget_object(const std::string &filename_prefix,
+                                       const std::vector<Argument> &args,
+                                       const std::vector<Target> &targets);
+
     /** Create an internal representation of lowered code as a self
      * contained Module suitable for further compilation. */
     Module compile_to_module(const std::vector<Argument> &args,
@@ -248,6 +383,40 @@ public:
      */
      void *compile_jit(const Target &target = get_jit_target_from_environment());
 
+    /** Jit compile several Pipelines at once. They are lowered
+     * separately, but compiled to machine code together in a single
+     * llvm module, which is much faster than compiling each of them
+     * on its own when there are many small pipelines. Returns the raw
+     * function pointer of each Pipeline, in the same order; each
+     * Pipeline can then also be realized as usual without being
+     * compiled again. */
+    static std::vector<void *> compile_jit(const std::vector<Pipeline> &pipelines,
+                                           const Target &target = get_jit_target_from_environment());
+
+    /** Jit compile the function on a background thread, returning a
+     * future for the same function pointer as compile_jit. The Pipeline
+     * (and the Funcs it calls) must not be used or modified until the
+     * future is ready.
+     *
+     * If 'tiered' is true, a quickly-compiled, unoptimized version of
+     * the pipeline (see Target::NoOptimize) is jit compiled before this
+     * returns, so the Pipeline can be realized straight away. The fully
+     * optimized version is compiled in the background, and replaces the
+     * quick one in the first call to realize after it is ready. The
+     * Funcs must not be modified until the future is ready. */
+    std::future<void *> compile_jit_async(const Target &target = get_jit_target_from_environment(),
+                                          bool tiered = false);
+
+    /** Turn on adaptive JIT compilation. Each call to realize records
+     * the values of the scalar Params and the extents and strides of
+     * the input buffers it was called with. Once the same values have
+     * been seen 'threshold' times, the pipeline is recompiled with
+     * those values baked in as constants, and later calls with the
+     * same values run the specialized code. Calls with any other
+     * values run the general code. A threshold of zero (the default)
+     * disables this. */
+    void set_adaptive_jit(int threshold);
+
     /** Set the error handler function that be called in the case of
      * runtime errors during halide pipelines. If you are compiling
      * statically, you can also just define your own function with
@@ -334,6 +503,15 @@ public:
      * and they will clobber Halide's versions. */
     void set_custom_trace(int (*trace_fn)(void *, const halide_trace_event_t *));
 
+    /** Set the function called at the end of each call of the
+     * pipeline when it was compiled with the LatencyTelemetry target
+     * feature, with timestamps of the call and of each of its compute_root
+     * stages. See halide_telemetry_record_t in HalideRuntime.h.
+     *
+     * If you are statically compiling, call
+     * halide_set_custom_telemetry instead. */
+    void set_custom_telemetry(void (*telemetry_fn)(void *, const halide_telemetry_record_t *));
+
     /** Set the function called to print messages from the runtime.
      * If you are compiling statically, you can also just define your
      * own function with signature
@@ -412,6 +590,12 @@ public:
     void realize(RealizationArg output, const Target &target = Target(),
                  const ParamMap &param_map = ParamMap::empty_map());
 
+    /** JIT-compile the pipeline, and resolve the slots of its
+     * arguments once, returning an object that runs it with much less
+     * per-call overhead than realize. Useful when calling a pipeline
+     * many times on small inputs. See Callable. */
+    Callable bind(const Target &target = Target());
+
     /** For a given size of output, or a given set of output buffers,
      * determine the bounds required of all unbound ImageParams
      * referenced. Communicates the result by allocating new buffers
@@ -424,6 +608,61 @@ public:
                             const ParamMap &param_map = ParamMap::empty_map());
     // @}
 
+    /** Evaluate this Pipeline one tile of the output at a time, for
+     * inputs and outputs too large to hold in memory. This runs the
+     * pipeline on an output of the given sizes split into tiles of
+     * tile_sizes (smaller at the far edges). Every ImageParam that has
+     * no buffer bound is streamed: for each tile, bounds inference
+     * finds the region of it that the tile needs, a buffer of just that
+     * region is allocated, and fetch is called to fill it in. The
+     * inputs of the next tile are fetched on another thread while the
+     * current tile runs, so at most two tiles of inputs are held at
+     * once. Each finished tile is passed to sink, with its mins set to
+     * its position in the whole output, before the next one runs. Note
+     * that inputs the tiles have in common, such as the overlap of
+     * stencils, are fetched once per tile that uses them. */
+    void realize_streaming(std::vector<int32_t> sizes, std::vector<int32_t> tile_sizes,
+                           StreamingInputFn fetch, StreamingOutputFn sink,
+                           const Target &target = Target(),
+                           const ParamMap &param_map = ParamMap::empty_map());
+
+    /** Evaluate this Pipeline across a group of ranks, such as the
+     * processes of an MPI job, which each call this with the same
+     * output sizes. The output is split into equal slices along the
+     * dimension of the first output Func marked with Func::distribute
+     * (by default its outermost dimension), and each rank computes and
+     * returns its own slice, with mins set to the slice's position in
+     * the whole output. Each rank holds a part of each ImageParam that
+     * has no buffer bound, given in local_inputs by name, with mins set
+     * to its position in the whole input. Bounds inference finds the
+     * region of each input that each rank's slice needs, and the ranks
+     * send each other the parts of those regions that they hold,
+     * through the transport, before computing. The parts held by all
+     * ranks must together cover the regions needed. */
+    Realization realize_distributed(std::vector<int32_t> sizes,
+                                    const std::map<std::string, Buffer<>> &local_inputs,
+                                    DistributedTransport &transport,
+                                    const Target &target = Target(),
+                                    const ParamMap &param_map = ParamMap::empty_map());
+
+    /** Bring the outputs of a previous realization up to date after
+     * part of an input changed, recomputing only the region of each
+     * output that may depend on the change. 'changed' names the
+     * ImageParam, Buffer or Func that changed, and changed_region
+     * gives the (min, extent) of the part of it that changed in each
+     * dimension. The affected regions of the Funcs downstream of it
+     * are found by bounds analysis, and the pipeline is realized into
+     * a crop of each output buffer covering that region. The rest of
+     * each output is kept. The intermediate Funcs are computed over
+     * just what the crop needs. Returns the (min, extent) recomputed
+     * in each dimension of each output Func, which is empty if no
+     * output depends on the change. */
+    std::vector<std::vector<std::pair<int, int>>> realize_incremental(
+        Realization &previous, const std::string &changed,
+        const std::vector<std::pair<int, int>> &changed_region,
+        const Target &target = Target(),
+        const ParamMap &param_map = ParamMap::empty_map());
+
     /** Infer the arguments to the Pipeline, sorted into a canonical order:
      * all buffers (sorted alphabetically by name), followed by all non-buffers
      * (sorted alphabetically by name).
@@ -445,6 +684,39 @@ public:
 private:
 
     std::string generate_function_name() const;
+
+    /** The jit module compile_jit last compiled, compiling it again
+     * if a bounded jit code cache has evicted it since. */
+    Internal::JITModule compiled_jit_module();
+
+    /** The jit module to use for a realize with the currently bound
+     * Param values: an adaptively specialized one if these values are
+     * hot, or the general one. */
+    Internal::JITModule adaptive_jit_module(const Target &target);
+
+    /** Realize into outputs by splitting them into one slice per GPU
+     * device given to Func::distribute_gpus, and computing the slices
+     * concurrently. */
+    void realize_across_gpus(RealizationArg &outputs, const Target &target,
+                             const ParamMap &param_map);
+
+    /** Realize into outputs by splitting them between a GPU and the
+     * host along the dimension given to Func::co_execute, and
+     * computing both parts concurrently. */
+    void realize_co_executed(RealizationArg &outputs, const Target &target,
+                             const ParamMap &param_map);
+
+    /** The raw buffers of the outputs of a realization. */
+    static std::vector<halide_buffer_t *> output_buffers(RealizationArg &outputs);
+
+    /** Realize the slice [min, min + extent) along dimension dim of
+     * the given outputs into their host memory, on the given GPU
+     * device, or leaving the device alone if it is less than
+     * -1. If flag_index is non-negative, the argument with that index
+     * is the given bool, instead of its bound value. */
+    void realize_slice(const std::vector<halide_buffer_t *> &output_bufs, int dim, int min, int extent,
+                       const Target &target, const ParamMap &param_map,
+                       int gpu_device, int flag_index, bool flag);
 };
 
 struct ExternSignature {
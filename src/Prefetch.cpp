@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <cstdlib>
 #include <map>
 #include <string>
 
@@ -62,12 +63,15 @@ public:
 
 class InjectPrefetch : public IRMutator2 {
 public:
-    InjectPrefetch(const map<string, Function> &e, const map<string, Box> &buffers)
-        : env(e), external_buffers(buffers), current_func(nullptr), stage(-1) { }
+    InjectPrefetch(const map<string, Function> &e, const map<string, Box> &buffers,
+                   int auto_distance)
+        : env(e), external_buffers(buffers), auto_distance(auto_distance),
+          current_func(nullptr), stage(-1) { }
 
 private:
     const map<string, Function> &env;
     const map<string, Box> &external_buffers;
+    int auto_distance;
     const Function *current_func;
     int stage;
     Scope<Box> buffer_bounds;
@@ -152,6 +156,139 @@ private:
         return Block::make({prefetch, body});
     }
 
+    // Restrict a box to prefetch to the bounds of the buffer, according to
+    // the strategy, and add the prefetch at the start of the body.
+    Stmt add_bounded_prefetch(const string &buf_name, const Parameter &param,
+                              Box prefetch_box, PrefetchBoundStrategy strategy,
+                              Stmt body) {
+        // Only prefetch the region that is in bounds.
+        Box bounds = get_buffer_bounds(buf_name, prefetch_box.size());
+        internal_assert(prefetch_box.size() == bounds.size());
+
+        if (strategy == PrefetchBoundStrategy::Clamp) {
+            prefetch_box = box_intersection(prefetch_box, bounds);
+        } else if (strategy == PrefetchBoundStrategy::GuardWithIf) {
+            Expr predicate = prefetch_box.used.defined() ? prefetch_box.used : const_true();
+            for (size_t i = 0; i < bounds.size(); ++i) {
+                predicate = predicate && (prefetch_box[i].min >= bounds[i].min) &&
+                            (prefetch_box[i].max <= bounds[i].max);
+            }
+            prefetch_box.used = simplify(predicate);
+        } else {
+            internal_assert(strategy == PrefetchBoundStrategy::NonFaulting);
+            // Assume the prefetch won't fault when accessing region
+            // outside the bounds.
+        }
+        return add_prefetch(buf_name, param, prefetch_box, body);
+    }
+
+    // Is this a serial loop with no serial or parallel loops inside it?
+    // Vectorized and unrolled loops inside are fine: they are part of
+    // the work of one iteration.
+    class IsInnermostLoop : public IRVisitor {
+        using IRVisitor::visit;
+        void visit(const For *op) override {
+            if (op->for_type == ForType::Vectorized ||
+                op->for_type == ForType::Unrolled) {
+                IRVisitor::visit(op);
+            } else {
+                result = false;
+            }
+        }
+    public:
+        bool result = true;
+    };
+
+    bool is_innermost_serial_loop(const For *op) {
+        if (op->for_type != ForType::Serial ||
+            (op->device_api != DeviceAPI::None && op->device_api != DeviceAPI::Host) ||
+            ends_with(op->name, ".__outermost")) {
+            return false;
+        }
+        IsInnermostLoop check;
+        op->body.accept(&check);
+        return check.result;
+    }
+
+    // Find the buffers read in a loop body that prefetches could be
+    // issued for: those allocated outside the body, or passed in.
+    class FindReads : public IRVisitor {
+        using IRVisitor::visit;
+        void visit(const Call *op) override {
+            IRVisitor::visit(op);
+            if ((op->call_type == Call::Halide) ||
+                (op->call_type == Call::Image && op->param.defined())) {
+                reads.emplace(op->name, std::make_pair(op->param, op->type.bytes()));
+            }
+        }
+    public:
+        map<string, std::pair<Parameter, int>> reads;
+    };
+
+    // Prefetch 'auto_distance' iterations ahead for each read in the loop
+    // whose address moves too far per iteration for the hardware prefetcher
+    // to follow.
+    Stmt add_auto_prefetches(const For *op, Stmt body, const set<string> &seen) {
+        FindReads finder;
+        body.accept(&finder);
+
+        Expr loop_var = Variable::make(Int(32), op->name);
+        map<string, Box> here = boxes_required(body);
+        map<string, Box> next = boxes_required(LetStmt::make(op->name, loop_var + 1, body));
+        map<string, Box> ahead =
+            boxes_required(LetStmt::make(op->name, loop_var + auto_distance, body));
+
+        for (const auto &r : finder.reads) {
+            const string &name = r.first;
+            if (seen.count(name) ||
+                (!buffer_bounds.contains(name) && !external_buffers.count(name))) {
+                continue;
+            }
+            const auto &b0 = here.find(name);
+            const auto &b1 = next.find(name);
+            const auto &b2 = ahead.find(name);
+            if (b0 == here.end() || b1 == next.end() || b2 == ahead.end()) {
+                continue;
+            }
+
+            // The stride in bytes of each dimension of the buffer, assuming
+            // the dimensions are stored densely in order.
+            Box bounds = get_buffer_bounds(name, b0->second.size());
+            Expr dim_stride = r.second.second;
+            Expr stride = 0;
+            bool affine = true;
+            for (size_t i = 0; i < b0->second.size(); i++) {
+                if (!b0->second[i].is_bounded() || !b1->second[i].is_bounded()) {
+                    affine = false;
+                    break;
+                }
+                Expr delta = simplify(b1->second[i].min - b0->second[i].min);
+                if (expr_uses_var(delta, op->name)) {
+                    affine = false;
+                    break;
+                }
+                stride += delta * dim_stride;
+                dim_stride *= bounds[i].max - bounds[i].min + 1;
+            }
+            if (!affine) {
+                continue;
+            }
+            stride = simplify(stride);
+            if (can_prove(stride == 0) ||
+                can_prove(stride < auto_prefetch_min_stride_bytes &&
+                          stride > -auto_prefetch_min_stride_bytes)) {
+                continue;
+            }
+
+            debug(3) << "Automatically prefetching " << name << " in " << op->name
+                     << ", " << auto_distance << " iterations ahead (stride "
+                     << stride << " bytes)\n";
+            body = add_bounded_prefetch(name, r.second.first, b2->second,
+                                        PrefetchBoundStrategy::Clamp, body);
+        }
+        return body;
+    }
+
     Stmt visit(const For *op) override {
         const Function *old_func = current_func;
         int old_stage = stage;
@@ -161,54 +298,37 @@ private:
         Expr loop_var = Variable::make(Int(32), op->name);
         Stmt body = mutate(op->body);
 
-        if (!prefetch_list.empty()) {
-            // If there are multiple prefetches of the same Func or ImageParam,
-            // use the most recent one
-            set<string> seen;
-            for (int i = prefetch_list.size() - 1; i >= 0; --i) {
-                const PrefetchDirective &p = prefetch_list[i];
-                if (!ends_with(op->name, "." + p.var) || (seen.find(p.name) != seen.end())) {
-                    continue;
-                }
-                seen.insert(p.name);
-
-                // Add loop variable + prefetch offset to interval scope for box computation
-                Expr fetch_at = loop_var + p.offset;
-                map<string, Box> boxes_rw = boxes_touched(LetStmt::make(op->name, fetch_at, body));
-
-                // TODO(psuriana): Only prefetch the newly accessed data. We
-                // should subtract the box accessed during previous iteration
-                // from the one accessed during this iteration.
-
-                // TODO(psuriana): Add a new PrefetchBoundStrategy::ShiftInwards
-                // that shifts the base address of the prefetched box so that
-                // the box is completely within the bounds.
-                const auto &b = boxes_rw.find(p.name);
-                if (b != boxes_rw.end()) {
-                    Box prefetch_box = b->second;
-                    // Only prefetch the region that is in bounds.
-                    Box bounds = get_buffer_bounds(b->first, b->second.size());
-                    internal_assert(prefetch_box.size() == bounds.size());
-
-                    if (p.strategy == PrefetchBoundStrategy::Clamp) {
-                        prefetch_box = box_intersection(prefetch_box, bounds);
-                    } else if (p.strategy == PrefetchBoundStrategy::GuardWithIf) {
-                        Expr predicate = prefetch_box.used.defined() ? prefetch_box.used : const_true();
-                        for (size_t i = 0; i < bounds.size(); ++i) {
-                            predicate = predicate && (prefetch_box[i].min >= bounds[i].min) &&
-                                        (prefetch_box[i].max <= bounds[i].max);
-                        }
-                        prefetch_box.used = simplify(predicate);
-                    } else {
-                        internal_assert(p.strategy == PrefetchBoundStrategy::NonFaulting);
-                        // Assume the prefetch won't fault when accessing region
-                        // outside the bounds.
-                    }
-                    body = add_prefetch(b->first, p.param, prefetch_box, body);
-                }
+        // If there are multiple prefetches of the same Func or ImageParam,
+        // use the most recent one
+        set<string> seen;
+        for (int i = prefetch_list.size() - 1; i >= 0; --i) {
+            const PrefetchDirective &p = prefetch_list[i];
+            if (!ends_with(op->name, "." + p.var) || (seen.find(p.name) != seen.end())) {
+                continue;
+            }
+            seen.insert(p.name);
+
+            // Add loop variable + prefetch offset to interval scope for box computation
+            Expr fetch_at = loop_var + p.offset;
+            map<string, Box> boxes_rw = boxes_touched(LetStmt::make(op->name, fetch_at, body));
+
+            // TODO(psuriana): Only prefetch the newly accessed data. We
+            // should subtract the box accessed during previous iteration
+            // from the one accessed during this iteration.
+
+            // TODO(psuriana): Add a new PrefetchBoundStrategy::ShiftInwards
+            // that shifts the base address of the prefetched box so that
+            // the box is completely within the bounds.
+            const auto &b = boxes_rw.find(p.name);
+            if (b != boxes_rw.end()) {
+                body = add_bounded_prefetch(b->first, p.param, b->second, p.strategy, body);
             }
         }
 
+        if (auto_distance > 0 && is_innermost_serial_loop(op)) {
+            body = add_auto_prefetches(op, body, seen);
+        }
+
         Stmt stmt;
         if (!body.same_as(op->body)) {
             stmt = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
@@ -340,10 +460,14 @@ public:
 
 } // anonymous namespace
 
-Stmt inject_prefetch(Stmt s, const map<string, Function> &env) {
+Stmt inject_prefetch(Stmt s, const map<string, Function> &env, int auto_distance) {
     CollectExternalBufferBounds finder;
     s.accept(&finder);
-    return InjectPrefetch(env, finder.buffers).mutate(s);
+    return InjectPrefetch(env, finder.buffers, auto_distance).mutate(s);
+}
+
+int auto_prefetch_distance(const Target &t) {
+    return t.has_feature(Target::AutoPrefetch) ? auto_prefetch_iterations : 0;
 }
 
 Stmt reduce_prefetch_dimension(Stmt stmt, const Target &t) {
@@ -14,7 +14,25 @@
 namespace Halide {
 namespace Internal {
 
-Stmt inject_prefetch(Stmt s, const std::map<std::string, Function> &env);
+/** Inject the prefetches in the schedule. If 'auto_distance' is positive,
+ * also prefetch that many iterations ahead in each innermost serial loop
+ * for any read whose address moves by at least
+ * auto_prefetch_min_stride_bytes per iteration, unless the schedule
+ * already prefetches that buffer in that loop. */
+Stmt inject_prefetch(Stmt s, const std::map<std::string, Function> &env,
+                     int auto_distance = 0);
+
+/** Reads with a smaller stride than this (in bytes) are left to the
+ * hardware prefetcher, which usually follows strides of up to 2KB. */
+const int auto_prefetch_min_stride_bytes = 2048;
+
+/** How many iterations ahead reads are prefetched with the AutoPrefetch
+ * target feature. Use Func::prefetch for other distances. */
+const int auto_prefetch_iterations = 4;
+
+/** The distance (in loop iterations) to prefetch automatically for the
+ * given target, or zero if automatic prefetching is off. */
+int auto_prefetch_distance(const Target &t);
 
 /** Reduce a multi-dimensional prefetch into a prefetch of lower dimension
  * (max dimension of the prefetch is specified by target architecture).
@@ -47,6 +47,25 @@ private:
 
     bool profiling_memory = true;
 
+    // The number of host parallel loops we are inside the body of. Each
+    // task of a parallel loop records its current func in a per-thread
+    // slot, pointed to by profiler_thread_func_<depth>, rather than in
+    // the profiler state, so that the profiler can see what every
+    // worker is doing.
+    int parallel_depth = 0;
+
+    string thread_func_name(int depth) const {
+        return "profiler_thread_func_" + std::to_string(depth);
+    }
+
+    Expr thread_func() const {
+        if (parallel_depth > 0) {
+            return Variable::make(Handle(), thread_func_name(parallel_depth));
+        } else {
+            return make_zero(Handle());
+        }
+    }
+
     // Strip down the tuple name, e.g. f.0 into f
     string normalize_name(const string &name) {
         vector<string> v = split_string(name, ".");
@@ -205,7 +224,7 @@ private:
 
         // This call gets inlined and becomes a single store instruction.
         Expr set_task = Call::make(Int(32), "halide_profiler_set_current_func",
-                                   {profiler_state, profiler_token, idx}, Call::Extern);
+                                   {profiler_state, profiler_token, idx, thread_func()}, Call::Extern);
 
         body = Block::make(Evaluate::make(set_task), body);
 
@@ -240,10 +259,14 @@ private:
             // limited internal profiling, which is currently just
             // hexagon. We don't support per-func stats remotely,
             // which means we can't do memory accounting.
+            // The per-thread slots live on the host too.
             bool old_profiling_memory = profiling_memory;
+            int old_parallel_depth = parallel_depth;
             profiling_memory = false;
+            parallel_depth = std::numeric_limits<int>::min();
             body = mutate(body);
             profiling_memory = old_profiling_memory;
+            parallel_depth = old_parallel_depth;
 
             // Get the profiler state pointer from scratch inside the
             // kernel. There will be a separate copy of the state on
@@ -253,16 +276,50 @@ private:
             body = LetStmt::make("hvx_profiler_state", get_state, body);
         } else if (op->device_api == DeviceAPI::None ||
                    op->device_api == DeviceAPI::Host) {
+            if (op->is_parallel()) {
+                parallel_depth++;
+            }
             body = mutate(body);
+            if (op->is_parallel()) {
+                parallel_depth--;
+            }
         } else {
             body = op->body;
         }
 
+        // Each task of a parallel loop takes a per-thread slot for its
+        // duration, starting out in the func that launched the loop.
+        bool use_thread_slot = op->is_parallel() && parallel_depth >= 0 &&
+            (op->device_api == DeviceAPI::None || op->device_api == DeviceAPI::Host);
+        Expr profiler_token = Variable::make(Int(32), "profiler_token");
+        if (use_thread_slot) {
+            Expr acquire = Call::make(Handle(), "halide_profiler_acquire_thread_slot",
+                                      {state, profiler_token + stack.back()}, Call::Extern);
+            string slot = thread_func_name(parallel_depth + 1);
+            Stmt release =
+                Evaluate::make(Call::make(Int(32), "halide_profiler_release_thread_slot",
+                                          {state, Variable::make(Handle(), slot)},
+                                          Call::Extern));
+            body = LetStmt::make(slot, acquire, Block::make(body, release));
+        }
+
         Stmt stmt = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
 
         if (update_active_threads) {
             stmt = Block::make({decr_active_threads, stmt, incr_active_threads});
         }
+
+        // A task that launches a nested parallel loop waits for it to
+        // finish, possibly running some of its tasks in other slots.
+        if (use_thread_slot && parallel_depth > 0) {
+            Expr wait = Call::make(Int(32), "halide_profiler_set_current_func",
+                                   {state, 0, halide_profiler_waiting_for_tasks, thread_func()},
+                                   Call::Extern);
+            Expr resume = Call::make(Int(32), "halide_profiler_set_current_func",
+                                     {state, profiler_token, stack.back(), thread_func()},
+                                     Call::Extern);
+            stmt = Block::make({Evaluate::make(wait), stmt, Evaluate::make(resume)});
+        }
         return stmt;
     }
 };
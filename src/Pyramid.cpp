@@ -0,0 +1,129 @@
+#include "Pyramid.h"
+
+#include <algorithm>
+
+namespace Halide {
+
+namespace Pyramid {
+
+namespace {
+
+// The first two dimensions of a pyramid level, which are the ones
+// resampled. The levels reuse the names of the base Func's dimensions,
+// so they can be scheduled with the same Vars.
+std::pair<Var, Var> spatial_args(const Func &f) {
+    std::vector<Var> args = f.args();
+    user_assert(args.size() >= 2)
+        << "Func " << f.name() << " has " << args.size()
+        << " dimensions, but pyramids need at least two.\n";
+    return {args[0], args[1]};
+}
+
+// Call f at (x, y) in its first two dimensions, and at the pure args
+// in the rest.
+Expr at(const Func &f, const std::vector<Var> &args, Expr x, Expr y) {
+    std::vector<Expr> site(args.begin(), args.end());
+    site[0] = x;
+    site[1] = y;
+    return f(site);
+}
+
+int end_level(const std::vector<Func> &pyramid, int last) {
+    int size = (int)pyramid.size();
+    return last < 0 ? size : std::min(last, size);
+}
+
+}  // namespace
+
+Func downsample(const Func &f) {
+    std::vector<Var> args = f.args();
+    Var x, y;
+    std::tie(x, y) = spatial_args(f);
+    Func downx(f.name() + "_downx"), downy(f.name() + "_down");
+    downx(args) = (at(f, args, 2*x-1, y) + 3.0f * (at(f, args, 2*x, y) + at(f, args, 2*x+1, y)) +
+                   at(f, args, 2*x+2, y)) / 8.0f;
+    downy(args) = (at(downx, args, x, 2*y-1) + 3.0f * (at(downx, args, x, 2*y) + at(downx, args, x, 2*y+1)) +
+                   at(downx, args, x, 2*y+2)) / 8.0f;
+    return downy;
+}
+
+Func upsample(const Func &f) {
+    std::vector<Var> args = f.args();
+    Var x, y;
+    std::tie(x, y) = spatial_args(f);
+    Func upx(f.name() + "_upx"), upy(f.name() + "_up");
+    upx(args) = 0.25f * at(f, args, (x/2) - 1 + 2*(x % 2), y) + 0.75f * at(f, args, x/2, y);
+    upy(args) = 0.25f * at(upx, args, x, (y/2) - 1 + 2*(y % 2)) + 0.75f * at(upx, args, x, y/2);
+    return upy;
+}
+
+std::vector<Func> gaussian(const Func &base, int levels) {
+    user_assert(levels > 0) << "A pyramid needs at least one level.\n";
+    std::vector<Func> pyramid = {base};
+    for (int j = 1; j < levels; j++) {
+        pyramid.push_back(downsample(pyramid[j-1]));
+    }
+    return pyramid;
+}
+
+std::vector<Func> laplacian(const std::vector<Func> &gaussian) {
+    user_assert(!gaussian.empty()) << "A pyramid needs at least one level.\n";
+    const int J = (int)gaussian.size();
+    std::vector<Func> pyramid(J);
+    pyramid[J-1] = gaussian[J-1];
+    for (int j = J-2; j >= 0; j--) {
+        Func up = upsample(gaussian[j+1]);
+        std::vector<Var> args = gaussian[j].args();
+        pyramid[j] = Func(gaussian[j].name() + "_laplacian");
+        pyramid[j](args) = gaussian[j](args) - up(args);
+    }
+    return pyramid;
+}
+
+std::vector<Func> collapse(const std::vector<Func> &laplacian) {
+    user_assert(!laplacian.empty()) << "A pyramid needs at least one level.\n";
+    const int J = (int)laplacian.size();
+    std::vector<Func> pyramid(J);
+    pyramid[J-1] = laplacian[J-1];
+    for (int j = J-2; j >= 0; j--) {
+        Func up = upsample(pyramid[j+1]);
+        std::vector<Var> args = laplacian[j].args();
+        pyramid[j] = Func(laplacian[j].name() + "_collapsed");
+        pyramid[j](args) = up(args) + laplacian[j](args);
+    }
+    return pyramid;
+}
+
+void schedule_root(const std::vector<Func> &pyramid, int first, int last,
+                   int vector_size, int parallel_levels, int rows_per_task) {
+    last = end_level(pyramid, last);
+    for (int j = first; j < last; j++) {
+        Func f = pyramid[j];
+        f.compute_root();
+        if (j <= parallel_levels) {
+            Var x, y;
+            std::tie(x, y) = spatial_args(f);
+            f.parallel(y, rows_per_task).vectorize(x, vector_size);
+        }
+    }
+}
+
+void schedule_at(const std::vector<Func> &pyramid, int first, int last,
+                 LoopLevel store_level, LoopLevel compute_level,
+                 int vector_size, int fold_factor) {
+    last = end_level(pyramid, last);
+    for (int j = first; j < last; j++) {
+        Func f = pyramid[j];
+        Var x, y;
+        std::tie(x, y) = spatial_args(f);
+        f.store_at(store_level).compute_at(compute_level);
+        if (fold_factor > 0) {
+            f.fold_storage(y, fold_factor);
+        }
+        f.vectorize(x, vector_size);
+    }
+}
+
+}  // namespace Pyramid
+
+}  // namespace Halide
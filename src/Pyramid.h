@@ -0,0 +1,75 @@
+#ifndef HALIDE_PYRAMID_H
+#define HALIDE_PYRAMID_H
+
+/** \file
+ * Building blocks for Gaussian and Laplacian image pyramids.
+ */
+
+#include <vector>
+
+#include "Func.h"
+
+namespace Halide {
+
+/** namespace to hold functions for building and scheduling image
+ * pyramids.
+ *
+ * A pyramid is a std::vector of Funcs, one per level, with level 0 at
+ * full resolution and each further level half the size of the one
+ * before it in the first two dimensions. Any other dimensions of the
+ * Funcs (e.g. color channels) are carried through unchanged. The
+ * number of levels is fixed when the pipeline is defined, so
+ * generators usually take it as a GeneratorParam.
+ *
+ * The levels do not impose a boundary condition; apply one to the
+ * base Func (e.g. with BoundaryConditions::repeat_edge) before
+ * building the pyramid.
+ */
+namespace Pyramid {
+
+/** Downsample the first two dimensions of a Func by a factor of two
+ * with a separable 1 3 3 1 filter. */
+Func downsample(const Func &f);
+
+/** Upsample the first two dimensions of a Func by a factor of two
+ * with bilinear interpolation. */
+Func upsample(const Func &f);
+
+/** Make a Gaussian pyramid with the given number of levels. Level 0
+ * is the base Func itself. */
+std::vector<Func> gaussian(const Func &base, int levels);
+
+/** Make the Laplacian pyramid of a Gaussian pyramid: each level is the
+ * difference between a Gaussian level and the upsampled next one, and
+ * the last level is the last Gaussian level. */
+std::vector<Func> laplacian(const std::vector<Func> &gaussian);
+
+/** Collapse a Laplacian pyramid, by upsampling from the coarsest level
+ * and adding in each finer level. Returns the intermediate levels, so
+ * that they can be scheduled; level 0 is the reconstructed image. */
+std::vector<Func> collapse(const std::vector<Func> &laplacian);
+
+/** A default schedule for the levels [first, last) of a pyramid that
+ * are computed at root. Levels up to parallel_levels are vectorized and
+ * parallelized over tasks of rows_per_task rows. The coarser levels
+ * have so little work that they are computed serially, which also
+ * keeps them resident in cache for their consumers. A negative last
+ * means the whole pyramid. */
+void schedule_root(const std::vector<Func> &pyramid, int first, int last,
+                   int vector_size, int parallel_levels = 4, int rows_per_task = 32);
+
+/** A default schedule for the levels [first, last) of a pyramid that
+ * are consumed a strip at a time: each level is stored at the consumer's
+ * store_level and computed at its compute_level, so that it slides down
+ * the strip with the consumer and only a few rows of it are live at a
+ * time. If fold_factor is positive, the storage of each level is folded
+ * over that many rows. */
+void schedule_at(const std::vector<Func> &pyramid, int first, int last,
+                 LoopLevel store_level, LoopLevel compute_level,
+                 int vector_size, int fold_factor = 0);
+
+}  // namespace Pyramid
+
+}  // namespace Halide
+
+#endif
@@ -0,0 +1,359 @@
+#include <algorithm>
+
+#include "PythonExtensionGen.h"
+#include "Debug.h"
+#include "Error.h"
+#include "Util.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::string;
+using std::vector;
+
+namespace {
+
+// The parts of the extension that don't depend on the pipeline: the
+// conversion of buffer protocol objects to halide_buffer_t and back.
+const char *const python_extension_prelude = R"(
+#include <Python.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "HalideRuntime.h"
+
+/* Point buf at the memory of obj, which must support the buffer
+   protocol, and have elements of the given type and the given number
+   of dimensions. Dimension i of buf is axis i of obj. */
+static int _halide_buffer_from_py(PyObject *obj, const char *name, int writable,
+                                  uint8_t code, uint8_t bits, int dimensions,
+                                  Py_buffer *view, halide_dimension_t *dim,
+                                  halide_buffer_t *buf) {
+    int flags = PyBUF_STRIDED_RO | PyBUF_FORMAT | (writable ? PyBUF_WRITABLE : 0);
+    if (PyObject_GetBuffer(obj, view, flags) < 0) {
+        return -1;
+    }
+    const char *format = view->format ? view->format : "B";
+    int foreign = 0;
+    while (strchr("@=<>!", *format)) {
+        foreign = (*format == '>' || *format == '!');
+        format++;
+    }
+    int format_code = -1;
+    if (strchr("efd", *format)) {
+        format_code = halide_type_float;
+    } else if (strchr("bhilqn", *format)) {
+        format_code = halide_type_int;
+    } else if (strchr("BHILQN?", *format)) {
+        format_code = halide_type_uint;
+    }
+    if (foreign || format_code != code || view->itemsize != (bits + 7) / 8) {
+        PyErr_Format(PyExc_ValueError,
+                     "%s has elements of format '%s' that don't match the type of the argument",
+                     name, view->format ? view->format : "B");
+        PyBuffer_Release(view);
+        return -1;
+    }
+    if (view->ndim != dimensions) {
+        PyErr_Format(PyExc_ValueError, "%s has %d dimensions instead of %d",
+                     name, (int)view->ndim, dimensions);
+        PyBuffer_Release(view);
+        return -1;
+    }
+    memset(buf, 0, sizeof(*buf));
+    buf->host = (uint8_t *)view->buf;
+    buf->type.code = (halide_type_code_t)code;
+    buf->type.bits = bits;
+    buf->type.lanes = 1;
+    buf->dimensions = dimensions;
+    buf->dim = dim;
+    for (int i = 0; i < dimensions; i++) {
+        Py_ssize_t extent = view->shape[i];
+        Py_ssize_t stride = view->strides[i] / view->itemsize;
+        if (stride * view->itemsize != view->strides[i] ||
+            extent > INT32_MAX || stride > INT32_MAX || stride < INT32_MIN) {
+            PyErr_Format(PyExc_ValueError,
+                         "%s has strides that aren't a multiple of its element size, "
+                         "or extents or strides that don't fit in 32 bits", name);
+            PyBuffer_Release(view);
+            return -1;
+        }
+        dim[i].min = 0;
+        dim[i].extent = (int32_t)extent;
+        dim[i].stride = (int32_t)stride;
+        dim[i].flags = 0;
+    }
+    return 0;
+}
+
+/* Release the first count buffers, copying the results in any that
+   are writable back from their devices if the pipeline succeeded. */
+static int _halide_release_buffers(Py_buffer *views, halide_buffer_t *bufs,
+                                   const int *writable, int count, int succeeded) {
+    int result = 0;
+    for (int i = count - 1; i >= 0; i--) {
+        if (bufs[i].device) {
+            if (succeeded && writable[i] && result == 0) {
+                result = halide_copy_to_host(NULL, &bufs[i]);
+            }
+            halide_device_free(NULL, &bufs[i]);
+        }
+        PyBuffer_Release(&views[i]);
+    }
+    return result;
+}
+)";
+
+const char *const user_context = "__user_context";
+
+// The C type of a scalar argument.
+string scalar_c_type(const Type &t) {
+    if (t.is_bool()) {
+        return "bool";
+    } else if (t.is_float()) {
+        return t.bits() == 32 ? "float" : "double";
+    }
+    return string(t.is_uint() ? "uint" : "int") + std::to_string(t.bits()) + "_t";
+}
+
+// Whether Python can pass all the arguments of f, other than the user
+// context. Pointers can't be passed, which rules out the wrappers that
+// take legacy buffer_t pointers, and neither can float16 scalars.
+bool callable_from_python(const LoweredFunc &f) {
+    for (const LoweredArgument &arg : f.args) {
+        if (arg.name == user_context) {
+            continue;
+        }
+        if (arg.type.is_handle() ||
+            (!arg.is_buffer() && arg.type.is_float() && arg.type.bits() != 32 && arg.type.bits() != 64)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The halide_type_code_t of a buffer's elements, as C.
+const char *type_code_name(const Type &t) {
+    if (t.is_float()) {
+        return "halide_type_float";
+    } else if (t.is_uint()) {
+        return "halide_type_uint";
+    } else if (t.is_int()) {
+        return "halide_type_int";
+    }
+    return "halide_type_handle";
+}
+
+void print_function(std::ostream &stream, const LoweredFunc &f, const string &name) {
+    // The arguments that Python passes, and their order among all of
+    // them.
+    vector<const LoweredArgument *> py_args;
+    vector<string> kwlist;
+    string format;
+    int num_buffers = 0;
+    for (const LoweredArgument &arg : f.args) {
+        if (arg.name == user_context) {
+            continue;
+        }
+        py_args.push_back(&arg);
+        kwlist.push_back("\"" + arg.name + "\"");
+        if (arg.is_buffer()) {
+            format += "O";
+            num_buffers++;
+        } else if (arg.type.is_bool()) {
+            format += "O";
+        } else if (arg.type.is_float()) {
+            format += "d";
+        } else if (arg.type.is_uint() && arg.type.bits() == 64) {
+            format += "K";
+        } else {
+            format += "L";
+        }
+    }
+
+    // The declaration of the pipeline.
+    stream << "\nint " << name << "(";
+    for (size_t i = 0; i < f.args.size(); i++) {
+        const LoweredArgument &arg = f.args[i];
+        if (arg.is_buffer()) {
+            stream << "struct halide_buffer_t *";
+        } else if (arg.name == user_context) {
+            stream << "void const *";
+        } else {
+            stream << scalar_c_type(arg.type);
+        }
+        stream << (i + 1 < f.args.size() ? ", " : "");
+    }
+    stream << ");\n\n";
+
+    stream << "static PyObject *_halide_py_" << name << "(PyObject *module, PyObject *args, PyObject *kwargs) {\n"
+           << "    static const char *const kwlist[] = {";
+    for (const string &k : kwlist) {
+        stream << k << ", ";
+    }
+    stream << "NULL};\n";
+
+    // Parse the arguments, and check the ranges of the narrow integers.
+    for (size_t i = 0; i < py_args.size(); i++) {
+        const LoweredArgument &arg = *py_args[i];
+        if (arg.is_buffer() || arg.type.is_bool()) {
+            stream << "    PyObject *py_" << i << " = NULL;\n";
+        } else if (arg.type.is_float()) {
+            stream << "    double py_" << i << " = 0;\n";
+        } else if (arg.type.is_uint() && arg.type.bits() == 64) {
+            stream << "    unsigned long long py_" << i << " = 0;\n";
+        } else {
+            stream << "    long long py_" << i << " = 0;\n";
+        }
+    }
+    stream << "    if (!PyArg_ParseTupleAndKeywords(args, kwargs, \"" << format << ":" << name
+           << "\", (char **)kwlist";
+    for (size_t i = 0; i < py_args.size(); i++) {
+        stream << ", &py_" << i;
+    }
+    stream << ")) {\n"
+           << "        return NULL;\n"
+           << "    }\n";
+    for (size_t i = 0; i < py_args.size(); i++) {
+        const LoweredArgument &arg = *py_args[i];
+        if (arg.type.is_bool() && !arg.is_buffer()) {
+            stream << "    int truth_" << i << " = PyObject_IsTrue(py_" << i << ");\n"
+                   << "    if (truth_" << i << " < 0) {\n"
+                   << "        return NULL;\n"
+                   << "    }\n";
+        }
+        if (arg.is_buffer() || arg.type.is_bool() || arg.type.is_float() || arg.type.bits() == 64) {
+            continue;
+        }
+        string bits = std::to_string(arg.type.bits());
+        string lo = arg.type.is_uint() ? "0" : "INT" + bits + "_MIN";
+        string hi = (arg.type.is_uint() ? "UINT" : "INT") + bits + "_MAX";
+        stream << "    if (py_" << i << " < " << lo << " || py_" << i << " > " << hi << ") {\n"
+               << "        PyErr_Format(PyExc_OverflowError, \"" << arg.name << " is out of range\");\n"
+               << "        return NULL;\n"
+               << "    }\n";
+    }
+
+    // Convert the buffers, and call the pipeline without the GIL.
+    const int num_slots = std::max(num_buffers, 1);
+    stream << "    Py_buffer views[" << num_slots << "];\n"
+           << "    halide_buffer_t bufs[" << num_slots << "];\n"
+           << "    static const int writable[" << num_slots << "] = {";
+    int b = 0;
+    for (const LoweredArgument *arg : py_args) {
+        if (arg->is_buffer()) {
+            stream << (b++ ? ", " : "") << (arg->is_output() ? 1 : 0);
+        }
+    }
+    stream << (num_buffers ? "" : "0") << "};\n";
+    b = 0;
+    for (size_t i = 0; i < py_args.size(); i++) {
+        if (py_args[i]->is_buffer()) {
+            stream << "    halide_dimension_t dim_" << b++ << "[" << (int)py_args[i]->dimensions + 1 << "];\n";
+        }
+    }
+    stream << "    int converted = 0, result = 0;\n";
+    b = 0;
+    for (size_t i = 0; i < py_args.size(); i++) {
+        const LoweredArgument &arg = *py_args[i];
+        if (!arg.is_buffer()) {
+            continue;
+        }
+        stream << "    if (_halide_buffer_from_py(py_" << i << ", \"" << arg.name << "\", writable[" << b << "], "
+               << type_code_name(arg.type) << ", " << arg.type.bits() << ", " << (int)arg.dimensions
+               << ", &views[" << b << "], dim_" << b << ", &bufs[" << b << "]) < 0) {\n"
+               << "        goto release;\n"
+               << "    }\n"
+               << "    converted++;\n";
+        b++;
+    }
+    stream << "    Py_BEGIN_ALLOW_THREADS\n"
+           << "    result = " << name << "(";
+    b = 0;
+    for (size_t i = 0, j = 0; i < f.args.size(); i++) {
+        const LoweredArgument &arg = f.args[i];
+        if (arg.name == user_context) {
+            stream << "NULL";
+        } else {
+            if (arg.is_buffer()) {
+                stream << "&bufs[" << b++ << "]";
+            } else if (arg.type.is_bool()) {
+                stream << "(bool)truth_" << j;
+            } else {
+                stream << "(" << scalar_c_type(arg.type) << ")py_" << j;
+            }
+            j++;
+        }
+        stream << (i + 1 < f.args.size() ? ", " : "");
+    }
+    stream << ");\n"
+           << "    Py_END_ALLOW_THREADS\n"
+           << "    if (result == 0) {\n"
+           << "        result = _halide_release_buffers(views, bufs, writable, converted, 1);\n"
+           << "    } else {\n"
+           << "        _halide_release_buffers(views, bufs, writable, converted, 0);\n"
+           << "    }\n"
+           << "    if (result != 0) {\n"
+           << "        PyErr_Format(PyExc_RuntimeError, \"" << name << " failed with Halide error %d\", result);\n"
+           << "        return NULL;\n"
+           << "    }\n"
+           << "    Py_RETURN_NONE;\n"
+           << "release:\n"
+           << "    _halide_release_buffers(views, bufs, writable, converted, 0);\n"
+           << "    return NULL;\n"
+           << "}\n";
+}
+
+}  // namespace
+
+void print_python_extension(std::ostream &stream, const Module &m) {
+    user_assert(!m.target().has_feature(Target::CPlusPlusMangling))
+        << "Python extensions can only call pipelines with C linkage\n";
+
+    vector<string> namespaces;
+    const string module_name = extract_namespaces(m.name(), namespaces);
+
+    stream << "/* A Python extension module that calls the pipelines in " << module_name
+           << ". Generated by Halide. */\n"
+           << python_extension_prelude;
+
+    vector<string> names;
+    for (const LoweredFunc &f : m.functions()) {
+        if (f.linkage == LinkageType::Internal) {
+            continue;
+        }
+        if (!callable_from_python(f)) {
+            debug(1) << "Not calling " << f.name << " from Python, as Python can't pass its arguments\n";
+            continue;
+        }
+        string name = extract_namespaces(f.name, namespaces);
+        user_assert(namespaces.empty())
+            << "Python extensions can only call pipelines with C linkage, not " << f.name << "\n";
+        print_function(stream, f, name);
+        names.push_back(name);
+    }
+
+    stream << "\nstatic PyMethodDef _halide_py_methods[] = {\n";
+    for (const string &name : names) {
+        stream << "    {\"" << name << "\", (PyCFunction)_halide_py_" << name
+               << ", METH_VARARGS | METH_KEYWORDS, NULL},\n";
+    }
+    stream << "    {NULL, NULL, 0, NULL}\n"
+           << "};\n\n"
+           << "#if PY_MAJOR_VERSION >= 3\n"
+           << "static struct PyModuleDef _halide_py_module = {\n"
+           << "    PyModuleDef_HEAD_INIT, \"" << module_name << "\", NULL, -1, _halide_py_methods\n"
+           << "};\n\n"
+           << "PyMODINIT_FUNC PyInit_" << module_name << "(void) {\n"
+           << "    return PyModule_Create(&_halide_py_module);\n"
+           << "}\n"
+           << "#else\n"
+           << "PyMODINIT_FUNC init" << module_name << "(void) {\n"
+           << "    Py_InitModule(\"" << module_name << "\", _halide_py_methods);\n"
+           << "}\n"
+           << "#endif\n";
+}
+
+}  // namespace Internal
+}  // namespace Halide
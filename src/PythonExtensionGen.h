@@ -0,0 +1,32 @@
+#ifndef HALIDE_PYTHON_EXTENSION_GEN_H_
+#define HALIDE_PYTHON_EXTENSION_GEN_H_
+
+/** \file
+ * Defines a code generator for Python extension modules that call
+ * ahead-of-time compiled pipelines.
+ */
+
+#include <ostream>
+
+#include "Module.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Write the C source of a Python extension module with one function
+ * for each externally visible function in a Module. The extension is
+ * named after the Module and is linked against its object file or
+ * static library. Each Python function takes the arguments of the
+ * pipeline in order (or by name), with buffers given as any object
+ * that supports the buffer protocol, such as a NumPy array or a
+ * halide.Buffer, and with dimension i of a buffer being axis i of the
+ * object. The type and number of dimensions of each buffer are
+ * checked against the ones compiled into the wrapper, and the buffers
+ * are passed to the pipeline without any copies. The GIL is released
+ * while the pipeline runs. */
+void print_python_extension(std::ostream &stream, const Module &m);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
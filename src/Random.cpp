@@ -1,12 +1,14 @@
 #include "Random.h"
 #include "IROperator.h"
 #include "IRMutator.h"
+#include "Util.h"
 
 namespace Halide {
 namespace Internal {
 
 using std::vector;
 using std::string;
+using std::map;
 
 namespace {
 
@@ -61,6 +63,49 @@ Expr rng32(Expr x) {
     return (((C2 * x) + C1) * x) + C0;
 }
 
+// The rotation amounts and key schedule parity constant of Threefry-2x32.
+const int threefry_rotations[8] = {13, 15, 26, 6, 17, 29, 16, 24};
+#define THREEFRY_PARITY 0x1BD11BDA
+
+// Threefry-2x32 with 13 rounds, the fewest that pass BigCrush (see
+// Salmon et al., "Parallel random numbers: as easy as 1, 2, 3"). It
+// only uses 32-bit adds, xors and rotates, which are cheap vector ops
+// on every target. The rounds are built as a chain of lets, because the
+// state words are each used more than once per round. Returns the first
+// word of the encrypted counter.
+Expr threefry(Expr x0, Expr x1, Expr k0, Expr k1) {
+    vector<std::pair<string, Expr>> lets;
+    auto bind = [&](Expr e) {
+        string name = unique_name('R');
+        lets.push_back({name, e});
+        return Variable::make(UInt(32), name);
+    };
+
+    k0 = bind(k0);
+    k1 = bind(k1);
+    Expr ks[3] = {k0, k1, bind((k0 ^ k1) ^ make_const(UInt(32), THREEFRY_PARITY))};
+
+    Expr a = bind(x0 + k0);
+    Expr b = bind(x1 + k1);
+    const int rounds = 13;
+    for (int i = 0; i < rounds; i++) {
+        const int r = threefry_rotations[i % 8];
+        a = bind(a + b);
+        b = bind(((b << r) | (b >> (32 - r))) ^ a);
+        if (i % 4 == 3) {
+            const int j = (i + 1) / 4;
+            a = bind(a + ks[j % 3]);
+            b = bind(b + ks[(j + 1) % 3] + make_const(UInt(32), j));
+        }
+    }
+
+    Expr result = a;
+    for (size_t i = lets.size(); i > 0; i--) {
+        result = Let::make(lets[i - 1].first, lets[i - 1].second, result);
+    }
+    return result;
+}
+
 }
 
 Expr random_int(const vector<Expr> &e) {
@@ -86,50 +131,126 @@ Expr random_int(const vector<Expr> &e) {
 }
 
 Expr random_float(const vector<Expr> &e) {
-    Expr result = random_int(e);
+    return random_int_to_float(random_int(e));
+}
+
+Expr counter_based_random_int(const vector<Expr> &key, const vector<Expr> &counter) {
+    // Hash the key down to two words. It doesn't vary across the
+    // domain, so this is lifted out of loops.
+    Expr k0 = random_int(key);
+    Expr k1 = rng32(k0 ^ make_const(UInt(32), C2));
+
+    // Encrypt the counter two words at a time, using each result as
+    // the key for the next pair.
+    Expr result;
+    for (size_t i = 0; i == 0 || i < counter.size(); i += 2) {
+        Expr x0 = i < counter.size() ? cast<uint32_t>(counter[i]) : make_zero(UInt(32));
+        Expr x1 = i + 1 < counter.size() ? cast<uint32_t>(counter[i + 1]) : make_zero(UInt(32));
+        if (result.defined()) {
+            k1 = result;
+        }
+        result = threefry(x0, x1, k0, k1);
+    }
+    return result;
+}
+
+Expr counter_based_random_float(const vector<Expr> &key, const vector<Expr> &counter) {
+    return random_int_to_float(counter_based_random_int(key, counter));
+}
+
+Expr random_int_to_float(Expr result) {
     // Set the exponent to one, and fill the mantissa with 23 random bits.
     result = (127 << 23) | (cast<uint32_t>(result) >> 9);
     // The clamp is purely for the benefit of bounds inference.
     return clamp(reinterpret(Float(32), result) - 1.0f, 0.0f, 1.0f);
 }
 
+namespace {
+
+// Tag calls to random() with the free vars and the tag of the
+// definition. The generator is picked later, by SelectRandomGenerator,
+// once the target is known. The arguments of the keyed_random
+// intrinsic are the number of key arguments, the key (the seed, call
+// id and tag, which select a stream), then the counter (the free vars,
+// which index into it).
 class LowerRandom : public IRMutator2 {
     using IRMutator2::visit;
 
     Expr visit(const Call *op) override {
         if (op->is_intrinsic(Call::random)) {
-            vector<Expr> args = op->args;
-            args.insert(args.end(), extra_args.begin(), extra_args.end());
-            if (op->type == Float(32)) {
-                return random_float(args);
-            } else if (op->type == Int(32)) {
-                return cast<int32_t>(random_int(args));
-            } else if (op->type == UInt(32)) {
-                return random_int(args);
-            } else {
-                internal_error << "The intrinsic random() returns an Int(32), UInt(32) or a Float(32).\n";
-                return Expr();
-            }
+            internal_assert(op->type == Float(32) || op->type == Int(32) || op->type == UInt(32))
+                << "The intrinsic random() returns an Int(32), UInt(32) or a Float(32).\n";
+            vector<Expr> args;
+            args.push_back((int)op->args.size() + 1);
+            args.insert(args.end(), op->args.begin(), op->args.end());
+            args.push_back(tag);
+            args.insert(args.end(), free_vars.begin(), free_vars.end());
+            return Call::make(op->type, Call::keyed_random, args, Call::PureIntrinsic);
         } else {
             return IRMutator2::visit(op);
         }
     }
 
-    vector<Expr> extra_args;
+    Expr tag;
+    vector<Expr> free_vars;
 public:
-    LowerRandom(const vector<string> &free_vars, int tag) {
-        extra_args.push_back(tag);
+    LowerRandom(const vector<string> &free_vars, int tag) : tag(tag) {
         for (size_t i = 0; i < free_vars.size(); i++) {
             internal_assert(!free_vars[i].empty());
-            extra_args.push_back(Variable::make(Int(32), free_vars[i]));
+            this->free_vars.push_back(Variable::make(Int(32), free_vars[i]));
+        }
+    }
+};
+
+class SelectRandomGenerator : public IRMutator2 {
+    using IRMutator2::visit;
+
+    Expr visit(const Call *op) override {
+        if (!op->is_intrinsic(Call::keyed_random)) {
+            return IRMutator2::visit(op);
+        }
+        const int64_t *num_key_args = as_const_int(op->args[0]);
+        internal_assert(num_key_args);
+        vector<Expr> key(op->args.begin() + 1, op->args.begin() + 1 + *num_key_args);
+        vector<Expr> counter(op->args.begin() + 1 + *num_key_args, op->args.end());
+        if (counter_based) {
+            if (op->type == Float(32)) {
+                return counter_based_random_float(key, counter);
+            } else if (op->type == Int(32)) {
+                return cast<int32_t>(counter_based_random_int(key, counter));
+            } else {
+                return counter_based_random_int(key, counter);
+            }
+        }
+        vector<Expr> args = key;
+        args.insert(args.end(), counter.begin(), counter.end());
+        if (op->type == Float(32)) {
+            return random_float(args);
+        } else if (op->type == Int(32)) {
+            return cast<int32_t>(random_int(args));
+        } else {
+            return random_int(args);
         }
     }
+
+    bool counter_based;
+public:
+    SelectRandomGenerator(bool c) : counter_based(c) {}
 };
 
+}  // namespace
+
 Expr lower_random(Expr e, const vector<string> &free_vars, int tag) {
     LowerRandom r(free_vars, tag);
     return r.mutate(e);
 }
 
+void select_random_generator(map<string, Function> &env, const Target &t) {
+    SelectRandomGenerator selector(t.has_feature(Target::ThreefryRandom));
+    for (auto &p : env) {
+        p.second.mutate(&selector);
+    }
+}
+
 }
 }
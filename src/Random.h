@@ -6,7 +6,11 @@
  * Defines deterministic random functions, and methods to redirect
  * front-end calls to random_float and random_int to use them. */
 
+#include <map>
+
+#include "Function.h"
 #include "IR.h"
+#include "Target.h"
 
 namespace Halide {
 namespace Internal {
@@ -20,11 +24,33 @@ Expr random_float(const std::vector<Expr> &);
  * be integers or unsigned integers). */
 Expr random_int(const std::vector<Expr> &);
 
-/** Convert calls to random() to IR generated by random_float and
- * random_int. Tags all calls with the variables in free_vars, and the
- * integer given as the last argument. */
+/** Return a random unsigned integer between zero and 2^32-1 from a
+ * counter-based generator (Threefry-2x32). The key expressions (which
+ * should not vary across the domain) select a stream, and the counter
+ * expressions index into it. The result depends only on the values of
+ * the inputs, so it is the same at any vector width. */
+Expr counter_based_random_int(const std::vector<Expr> &key, const std::vector<Expr> &counter);
+
+/** Return a random floating-point number between zero and one from
+ * the generator used by counter_based_random_int. */
+Expr counter_based_random_float(const std::vector<Expr> &key, const std::vector<Expr> &counter);
+
+/** Map a random unsigned integer to a floating-point number between
+ * zero and one. */
+Expr random_int_to_float(Expr);
+
+/** Tag calls to random() with the variables in free_vars, and the
+ * integer given as the last argument, by converting them to calls to
+ * the keyed_random intrinsic. Done when a Func is defined. */
 Expr lower_random(Expr e, const std::vector<std::string> &free_vars, int tag);
 
+/** Convert the calls to keyed_random in the definitions of the Funcs in
+ * env to IR generated by random_float and random_int, or, with the
+ * ThreefryRandom target feature, by the counter-based generator, keyed
+ * by the call's seed and identity and indexed by the free vars. Done
+ * at the start of lowering. */
+void select_random_generator(std::map<std::string, Function> &env, const Target &t);
+
 }
 }
 
@@ -0,0 +1,110 @@
+#include "RecursiveFilter.h"
+#include "IROperator.h"
+#include "RDom.h"
+#include "Util.h"
+
+namespace Halide {
+
+using std::string;
+using std::vector;
+
+using namespace Internal;
+
+Func recursive_filter(Func input, int dim, Expr min, Expr extent,
+                      Expr feedback, Expr block_size, bool reverse) {
+    user_assert(input.defined())
+        << "Can't run a recursive filter over an undefined Func\n";
+    user_assert(dim >= 0 && dim < input.dimensions())
+        << "Can't run a recursive filter along dimension " << dim
+        << " of " << input.name() << ", which has "
+        << input.dimensions() << " dimensions\n";
+    user_assert(input.outputs() == 1 && input.output_types()[0].is_float())
+        << "Can't run a recursive filter over " << input.name()
+        << ", since it doesn't have a single floating point value\n";
+
+    const Type t = input.output_types()[0];
+    const string name = input.name() + "_iir";
+    feedback = cast(t, feedback);
+
+    vector<Var> args(input.dimensions());
+    vector<Expr> outer;
+    vector<VarOrRVar> outer_loops;
+    for (int d = 0; d < (int)args.size(); d++) {
+        if (d != dim) {
+            outer.push_back(args[d]);
+            outer_loops.push_back(args[d]);
+        }
+    }
+
+    // Element n of the recursion, counted from where it starts.
+    Expr last = min + extent - 1;
+    auto position = [&](Expr n) {
+        return reverse ? last - n : min + n;
+    };
+
+    // The powers of the feedback, weights(i) = feedback^(i + 1).
+    Var i(unique_name('i')), k(unique_name('k'));
+    Func weights(name + "_weights");
+    weights(i) = feedback;
+    RDom rw(1, block_size - 1, name + "_rw");
+    weights(rw) = weights(rw - 1) * feedback;
+    weights.compute_root();
+
+    // Filter each block from zero. Reads past the ends of the range
+    // are clamped; their results are never used.
+    Func blocks(name + "_blocks");
+    {
+        vector<Expr> input_args(args.begin(), args.end());
+        input_args[dim] = position(clamp(k * block_size + i, 0, extent - 1));
+        vector<Expr> lhs = outer;
+        lhs.push_back(i);
+        lhs.push_back(k);
+        blocks(lhs) = input(input_args);
+
+        RDom ri(1, block_size - 1, name + "_ri");
+        vector<Expr> prev = outer, cur = outer;
+        prev.push_back(ri - 1);
+        prev.push_back(k);
+        cur.push_back(ri);
+        cur.push_back(k);
+        blocks(cur) = feedback * blocks(prev) + blocks(cur);
+
+        vector<VarOrRVar> order = outer_loops;
+        order.push_back(ri);
+        order.push_back(k);
+        blocks.compute_root().update(0).reorder(order).parallel(k);
+    }
+
+    // The state carried into each block.
+    Func carry(name + "_carry");
+    {
+        vector<Expr> lhs = outer;
+        lhs.push_back(k);
+        carry(lhs) = make_zero(t);
+
+        RDom rk(1, (extent + block_size - 1) / block_size - 1, name + "_rk");
+        vector<Expr> prev = outer, cur = outer, tail = outer;
+        prev.push_back(rk - 1);
+        cur.push_back(rk);
+        tail.push_back(block_size - 1);
+        tail.push_back(rk - 1);
+        carry(cur) = weights(block_size - 1) * carry(prev) + blocks(tail);
+
+        vector<VarOrRVar> order = outer_loops;
+        order.push_back(rk);
+        carry.compute_root().update(0).reorder(order);
+    }
+
+    Func out(name);
+    {
+        Expr n = reverse ? last - args[dim] : args[dim] - min;
+        vector<Expr> block_args = outer, carry_args = outer;
+        block_args.push_back(n % block_size);
+        block_args.push_back(n / block_size);
+        carry_args.push_back(n / block_size);
+        out(args) = blocks(block_args) + weights(n % block_size) * carry(carry_args);
+    }
+    return out;
+}
+
+}
@@ -0,0 +1,54 @@
+#ifndef HALIDE_RECURSIVE_FILTER_H
+#define HALIDE_RECURSIVE_FILTER_H
+
+/** \file
+ * Defines a block-parallel first-order recursive (IIR) filter.
+ */
+
+#include "Func.h"
+
+namespace Halide {
+
+/** Run the first-order recursive filter
+ \code
+ out(..., x, ...) = feedback * out(..., x - 1, ...) + input(..., x, ...)
+ \endcode
+ * along dimension 'dim' of 'input' over [min, min + extent), starting
+ * from zero before the first element. If 'reverse' is true, the
+ * filter is anti-causal instead, running from the last element to
+ * the first:
+ \code
+ out(..., x, ...) = feedback * out(..., x + 1, ...) + input(..., x, ...)
+ \endcode
+ *
+ * Written as an update definition, such a filter is serial along
+ * 'dim', so it can only be parallelized and vectorized across the
+ * other dimensions, which starves on narrow images. This instead
+ * cuts the range into blocks of 'block_size' elements, filters each
+ * block independently from zero in parallel, then runs the
+ * recurrence over the last element of each block to find the state
+ * carried into the next, which is short and serial. Each element of
+ * the result is its filtered block plus the carried state times the
+ * power of 'feedback' matching its distance into the block, so the
+ * returned Func is pure and may be vectorized and parallelized along
+ * 'dim' too.
+ *
+ * The input must have a single floating point value. The blocks are
+ * computed at root; the result is only meaningful over [min, min +
+ * extent) along 'dim'. For example, a causal and an anti-causal
+ * exponential blur down the columns of a tall image:
+ \code
+ Func scaled;
+ scaled(x, y) = alpha * input(x, y);
+ Func down = recursive_filter(scaled, 1, 0, height, 1 - alpha, 64);
+ Func scaled_down;
+ scaled_down(x, y) = alpha * down(x, y);
+ Func up = recursive_filter(scaled_down, 1, 0, height, 1 - alpha, 64, true);
+ \endcode
+ */
+Func recursive_filter(Func input, int dim, Expr min, Expr extent,
+                      Expr feedback, Expr block_size, bool reverse = false);
+
+}
+
+#endif
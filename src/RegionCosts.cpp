@@ -1,3 +1,6 @@
+#include <fstream>
+#include <sstream>
+
 #include "RegionCosts.h"
 #include "IRVisitor.h"
 #include "IRMutator.h"
@@ -69,7 +72,7 @@ class ExprCost : public IRVisitor {
 
     void visit(const Cast *op) {
         op->value.accept(this);
-        arith += 1;
+        arith += model.cast;
     }
 
     template<typename T>
@@ -79,37 +82,37 @@ class ExprCost : public IRVisitor {
         arith += op_cost;
     }
 
-    // The costs of all the simple binary operations is set to one.
-    // TODO: Changing the costs for division and multiplication may be
-    // beneficial. Write a test case to validate this and update the costs
-    // accordingly.
-
-    void visit(const Add *op) { visit_binary_operator(op, 1); }
-    void visit(const Sub *op) { visit_binary_operator(op, 1); }
-    void visit(const Mul *op) { visit_binary_operator(op, 1); }
-    void visit(const Div *op) { visit_binary_operator(op, 1); }
-    void visit(const Mod *op) { visit_binary_operator(op, 1); }
-    void visit(const Min *op) { visit_binary_operator(op, 1); }
-    void visit(const Max *op) { visit_binary_operator(op, 1); }
-    void visit(const EQ *op) { visit_binary_operator(op, 1); }
-    void visit(const NE *op) { visit_binary_operator(op, 1); }
-    void visit(const LT *op) { visit_binary_operator(op, 1); }
-    void visit(const LE *op) { visit_binary_operator(op, 1); }
-    void visit(const GT *op) { visit_binary_operator(op, 1); }
-    void visit(const GE *op) { visit_binary_operator(op, 1); }
-    void visit(const And *op) { visit_binary_operator(op, 1); }
-    void visit(const Or *op) { visit_binary_operator(op, 1); }
+    // By default the costs of all the simple binary operations is set to
+    // one. Calibrating the cost model on the target machine (see
+    // tools/calibrate_cost_model.cpp) gives better costs for division and
+    // multiplication.
+
+    void visit(const Add *op) { visit_binary_operator(op, model.add); }
+    void visit(const Sub *op) { visit_binary_operator(op, model.add); }
+    void visit(const Mul *op) { visit_binary_operator(op, model.mul); }
+    void visit(const Div *op) { visit_binary_operator(op, model.div); }
+    void visit(const Mod *op) { visit_binary_operator(op, model.div); }
+    void visit(const Min *op) { visit_binary_operator(op, model.add); }
+    void visit(const Max *op) { visit_binary_operator(op, model.add); }
+    void visit(const EQ *op) { visit_binary_operator(op, model.compare); }
+    void visit(const NE *op) { visit_binary_operator(op, model.compare); }
+    void visit(const LT *op) { visit_binary_operator(op, model.compare); }
+    void visit(const LE *op) { visit_binary_operator(op, model.compare); }
+    void visit(const GT *op) { visit_binary_operator(op, model.compare); }
+    void visit(const GE *op) { visit_binary_operator(op, model.compare); }
+    void visit(const And *op) { visit_binary_operator(op, model.compare); }
+    void visit(const Or *op) { visit_binary_operator(op, model.compare); }
 
     void visit(const Not *op) {
         op->a.accept(this);
-        arith += 1;
+        arith += model.compare;
     }
 
     void visit(const Select *op) {
         op->condition.accept(this);
         op->true_value.accept(this);
         op->false_value.accept(this);
-        arith += 1;
+        arith += model.select;
     }
 
     void visit(const Call *call) {
@@ -157,18 +160,18 @@ class ExprCost : public IRVisitor {
 
         if (call->call_type == Call::Halide || call->call_type == Call::Image) {
             // Each call also counts as an op since it results in a load instruction.
-            arith += 1;
+            arith += model.load;
             memory += call->type.bytes();
             detailed_byte_loads[call->name] += (int64_t)call->type.bytes();
         } else if (call->is_extern()) {
             // TODO: Suffix based matching is kind of sketchy; but going ahead with
             // it for now. Also not all the PureExtern's are accounted for yet.
             if (ends_with(call->name, "_f64")) {
-                arith += 20;
+                arith += model.math_f64;
             } else if (ends_with(call->name, "_f32")) {
-                arith += 10;
+                arith += model.math_f32;
             } else if (ends_with(call->name, "_f16")) {
-                arith += 5;
+                arith += model.math_f16;
             } else {
                 // There is no visibility into an extern stage so there is no
                 // way to know the cost of the call statically. Modeling the
@@ -184,12 +187,13 @@ class ExprCost : public IRVisitor {
                     call->is_intrinsic(Call::bitwise_or) || call->is_intrinsic(Call::shift_left) ||
                     call->is_intrinsic(Call::shift_right) || call->is_intrinsic(Call::div_round_to_zero) ||
                     call->is_intrinsic(Call::mod_round_to_zero) || call->is_intrinsic(Call::undef)) {
-                arith += 1;
+                arith += model.bitwise;
             } else if (call->is_intrinsic(Call::abs) || call->is_intrinsic(Call::absd) ||
                        call->is_intrinsic(Call::lerp) || call->is_intrinsic(Call::random) ||
+                       call->is_intrinsic(Call::keyed_random) ||
                        call->is_intrinsic(Call::count_leading_zeros) ||
                        call->is_intrinsic(Call::count_trailing_zeros)) {
-                arith += 5;
+                arith += model.intrinsic;
             } else if (call->is_intrinsic(Call::likely) ||
                        call->is_intrinsic(Call::likely_if_innermost)) {
                 // Likely does not result in actual operations.
@@ -232,6 +236,8 @@ class ExprCost : public IRVisitor {
     void visit(const IfThenElse *) { internal_assert(false); }
     void visit(const Evaluate *) { internal_assert(false); }
 
+    const CostModel &model;
+
 public:
     int64_t arith;
     int64_t memory;
@@ -239,7 +245,7 @@ public:
     // they are loaded from.
     map<string, int64_t> detailed_byte_loads;
 
-    ExprCost() : arith(0), memory(0) {}
+    ExprCost(const CostModel &model) : model(model), arith(0), memory(0) {}
 };
 
 // Return the number of bytes required to store a single value of the
@@ -299,20 +305,20 @@ Expr get_func_value_size(const Function &f) {
     }
 };*/
 
-Cost compute_expr_cost(Expr expr) {
+Cost compute_expr_cost(Expr expr, const CostModel &model) {
     // TODO: Handle likely
     //expr = LikelyExpression().mutate(expr);
     expr = simplify(expr);
-    ExprCost cost_visitor;
+    ExprCost cost_visitor(model);
     expr.accept(&cost_visitor);
     return Cost(cost_visitor.arith, cost_visitor.memory);
 }
 
-map<string, Expr> compute_expr_detailed_byte_loads(Expr expr) {
+map<string, Expr> compute_expr_detailed_byte_loads(Expr expr, const CostModel &model) {
     // TODO: Handle likely
     //expr = LikelyExpression().mutate(expr);
     expr = simplify(expr);
-    ExprCost cost_visitor;
+    ExprCost cost_visitor(model);
     expr.accept(&cost_visitor);
 
     map<string, Expr> loads;
@@ -324,7 +330,63 @@ map<string, Expr> compute_expr_detailed_byte_loads(Expr expr) {
 
 } // anonymous namespace
 
-RegionCosts::RegionCosts(const map<string, Function> &_env) : env(_env) {
+CostModel CostModel::from_file(const string &filename) {
+    std::ifstream f(filename);
+    user_assert(f.is_open()) << "Unable to open cost model file: " << filename << "\n";
+
+    CostModel model;
+    map<string, int64_t *> fields = {
+        {"add", &model.add}, {"mul", &model.mul}, {"div", &model.div},
+        {"compare", &model.compare}, {"select", &model.select},
+        {"cast", &model.cast}, {"load", &model.load},
+        {"bitwise", &model.bitwise}, {"intrinsic", &model.intrinsic},
+        {"math_f16", &model.math_f16}, {"math_f32", &model.math_f32},
+        {"math_f64", &model.math_f64}};
+
+    string line;
+    while (std::getline(f, line)) {
+        std::istringstream in(line);
+        string name;
+        int64_t value;
+        if (!(in >> name) || name[0] == '#') {
+            continue;
+        }
+        user_assert(in >> value && value >= 0)
+            << "Malformed line in cost model file " << filename << ": " << line << "\n";
+        if (name == "balance") {
+            model.balance = make_const(Int(32), value);
+            continue;
+        }
+        auto iter = fields.find(name);
+        user_assert(iter != fields.end())
+            << "Unknown cost \"" << name << "\" in cost model file " << filename << "\n";
+        *iter->second = value;
+    }
+    return model;
+}
+
+string CostModel::to_string() const {
+    std::ostringstream o;
+    o << "add " << add << "\n"
+      << "mul " << mul << "\n"
+      << "div " << div << "\n"
+      << "compare " << compare << "\n"
+      << "select " << select << "\n"
+      << "cast " << cast << "\n"
+      << "load " << load << "\n"
+      << "bitwise " << bitwise << "\n"
+      << "intrinsic " << intrinsic << "\n"
+      << "math_f16 " << math_f16 << "\n"
+      << "math_f32 " << math_f32 << "\n"
+      << "math_f64 " << math_f64 << "\n";
+    if (balance.defined()) {
+        o << "balance " << balance << "\n";
+    }
+    return o.str();
+}
+
+RegionCosts::RegionCosts(const map<string, Function> &_env,
+                         const CostModel &_model) : env(_env), model(_model) {
     for (const auto &kv : env) {
         // Pre-compute the function costs without any inlining.
         func_cost[kv.first] = get_func_cost(kv.second);
@@ -344,7 +406,7 @@ RegionCosts::RegionCosts(const map<string, Function> &_env) : env(_env) {
 }
 
 Cost RegionCosts::stage_region_cost(string func, int stage, const DimBounds &bounds,
-                                    const set<string> &inlines) {
+                                    const set<string> &inlines) const {
     Function curr_f = get_element(env, func);
 
     Box stage_region;
@@ -371,7 +433,7 @@ Cost RegionCosts::stage_region_cost(string func, int stage, const DimBounds &bou
 }
 
 Cost RegionCosts::stage_region_cost(string func, int stage, const Box &region,
-                                    const set<string> &inlines) {
+                                    const set<string> &inlines) const {
     Function curr_f = get_element(env, func);
 
     DimBounds pure_bounds;
@@ -385,7 +447,7 @@ Cost RegionCosts::stage_region_cost(string func, int stage, const Box &region,
     return stage_region_cost(func, stage, stage_bounds, inlines);
 }
 
-Cost RegionCosts::region_cost(string func, const Box &region, const set<string> &inlines) {
+Cost RegionCosts::region_cost(string func, const Box &region, const set<string> &inlines) const {
     Function curr_f = get_element(env, func);
     Cost region_cost(0, 0);
 
@@ -405,7 +467,7 @@ Cost RegionCosts::region_cost(string func, const Box &region, const set<string>
     return region_cost;
 }
 
-Cost RegionCosts::region_cost(const map<string, Box> &regions, const set<string> &inlines){
+Cost RegionCosts::region_cost(const map<string, Box> &regions, const set<string> &inlines) const {
     Cost total_cost(0, 0);
     for (const auto &f : regions) {
         // The cost for pure inlined functions will be accounted in the
@@ -431,7 +493,7 @@ Cost RegionCosts::region_cost(const map<string, Box> &regions, const set<string>
 
 map<string, Expr>
 RegionCosts::stage_detailed_load_costs(string func, int stage,
-                                       const set<string> &inlines) {
+                                       const set<string> &inlines) const {
     map<string, Expr> load_costs;
     Function curr_f = get_element(env, func);
 
@@ -445,7 +507,7 @@ RegionCosts::stage_detailed_load_costs(string func, int stage,
             Expr inlined_expr = perform_inline(e, env, inlines);
             inlined_expr = simplify(inlined_expr);
 
-            map<string, Expr> expr_load_costs = compute_expr_detailed_byte_loads(inlined_expr);
+            map<string, Expr> expr_load_costs = compute_expr_detailed_byte_loads(inlined_expr, model);
             combine_load_costs(load_costs, expr_load_costs);
 
             auto iter = load_costs.find(func);
@@ -464,7 +526,7 @@ RegionCosts::stage_detailed_load_costs(string func, int stage,
 map<string, Expr>
 RegionCosts::stage_detailed_load_costs(string func, int stage,
                                        DimBounds &bounds,
-                                       const set<string> &inlines) {
+                                       const set<string> &inlines) const {
     Function curr_f = get_element(env, func);
 
     Box stage_region;
@@ -492,7 +554,7 @@ RegionCosts::stage_detailed_load_costs(string func, int stage,
 
 map<string, Expr>
 RegionCosts::detailed_load_costs(string func, const Box &region,
-                                 const set<string> &inlines) {
+                                 const set<string> &inlines) const {
     Function curr_f = get_element(env, func);
     map<string, Expr> load_costs;
 
@@ -536,7 +598,7 @@ RegionCosts::detailed_load_costs(string func, const Box &region,
 
 map<string, Expr>
 RegionCosts::detailed_load_costs(const map<string, Box> &regions,
-                                 const set<string> &inlines) {
+                                 const set<string> &inlines) const {
     map<string, Expr> load_costs;
     for (const auto &r : regions) {
         // The cost for pure inlined functions will be accounted in the
@@ -553,7 +615,7 @@ RegionCosts::detailed_load_costs(const map<string, Box> &regions,
     return load_costs;
 }
 
-Cost RegionCosts::get_func_stage_cost(const Function &f, int stage, const set<string> &inlines) {
+Cost RegionCosts::get_func_stage_cost(const Function &f, int stage, const set<string> &inlines) const {
     if (f.has_extern_definition()) {
         return Cost();
     }
@@ -566,7 +628,7 @@ Cost RegionCosts::get_func_stage_cost(const Function &f, int stage, const set<st
         Expr inlined_expr = perform_inline(e, env, inlines);
         inlined_expr = simplify(inlined_expr);
 
-        Cost expr_cost = compute_expr_cost(inlined_expr);
+        Cost expr_cost = compute_expr_cost(inlined_expr, model);
         internal_assert(expr_cost.defined());
         cost.arith += expr_cost.arith;
         cost.memory += expr_cost.memory;
@@ -581,7 +643,7 @@ Cost RegionCosts::get_func_stage_cost(const Function &f, int stage, const set<st
             Expr inlined_arg = perform_inline(arg, env, inlines);
             inlined_arg = simplify(inlined_arg);
 
-            Cost expr_cost = compute_expr_cost(inlined_arg);
+            Cost expr_cost = compute_expr_cost(inlined_arg, model);
             internal_assert(expr_cost.defined());
             cost.arith += expr_cost.arith;
             cost.memory += expr_cost.memory;
@@ -592,7 +654,7 @@ Cost RegionCosts::get_func_stage_cost(const Function &f, int stage, const set<st
     return cost;
 }
 
-vector<Cost> RegionCosts::get_func_cost(const Function &f, const set<string> &inlines) {
+vector<Cost> RegionCosts::get_func_cost(const Function &f, const set<string> &inlines) const {
     if (f.has_extern_definition()) {
         return { Cost() };
     }
@@ -605,7 +667,7 @@ vector<Cost> RegionCosts::get_func_cost(const Function &f, const set<string> &in
     return func_costs;
 }
 
-Expr RegionCosts::region_size(string func, const Box &region) {
+Expr RegionCosts::region_size(string func, const Box &region) const {
     const Function &f = get_element(env, func);
     Expr size = box_size(region);
     if (!size.defined()) {
@@ -617,7 +679,7 @@ Expr RegionCosts::region_size(string func, const Box &region) {
 }
 
 Expr RegionCosts::region_footprint(const map<string, Box> &regions,
-                                   const set<string> &inlined) {
+                                   const set<string> &inlined) const {
     map<string, int> num_consumers;
     for (const auto &f : regions) {
         num_consumers[f.first] = 0;
@@ -678,7 +740,7 @@ Expr RegionCosts::region_footprint(const map<string, Box> &regions,
     return simplify(working_set_size);
 }
 
-Expr RegionCosts::input_region_size(string input, const Box &region) {
+Expr RegionCosts::input_region_size(string input, const Box &region) const {
     Expr size = box_size(region);
     if (!size.defined()) {
         return Expr();
@@ -688,7 +750,7 @@ Expr RegionCosts::input_region_size(string input, const Box &region) {
     return simplify(size * size_per_ele);
 }
 
-Expr RegionCosts::input_region_size(const map<string, Box> &input_regions) {
+Expr RegionCosts::input_region_size(const map<string, Box> &input_regions) const {
     Expr total_size = make_zero(Int(64));
     for (const auto &reg : input_regions) {
         Expr size = input_region_size(reg.first, reg.second);
@@ -734,7 +796,7 @@ bool is_func_trivial_to_inline(const Function &func) {
 
     Cost inline_cost(0, 0);
     for (const auto &val : func.values()) {
-        Cost cost = compute_expr_cost(val);
+        Cost cost = compute_expr_cost(val, CostModel());
         internal_assert(cost.defined());
         inline_cost.arith = max(cost.arith, inline_cost.arith);
         inline_cost.memory = max(cost.memory, inline_cost.memory);
@@ -36,6 +36,47 @@ struct Cost {
     }
 };
 
+/** The number of arithmetic cycles charged to each class of operation when
+ * costing an expression. The defaults are the built-in heuristic; a
+ * calibration file written by tools/calibrate_cost_model.cpp replaces them
+ * with coefficients measured on a particular machine. */
+struct CostModel {
+    /** Add, Sub, Min and Max. Everything else is relative to this. */
+    int64_t add = 1;
+    /** Mul. */
+    int64_t mul = 1;
+    /** Div and Mod. */
+    int64_t div = 1;
+    /** Comparisons and boolean operators. */
+    int64_t compare = 1;
+    /** Select. */
+    int64_t select = 1;
+    /** Cast. */
+    int64_t cast = 1;
+    /** The address computation and issue of a load from a Func or image,
+     * on top of the bytes loaded. */
+    int64_t load = 1;
+    /** Bitwise and shift intrinsics. */
+    int64_t bitwise = 1;
+    /** abs, absd, lerp, random and the bit counting intrinsics. */
+    int64_t intrinsic = 5;
+    /** Calls to extern math functions on 16, 32 and 64-bit floats. */
+    int64_t math_f16 = 5;
+    int64_t math_f32 = 10;
+    int64_t math_f64 = 20;
+    /** If defined, replaces MachineParams::balance. */
+    Expr balance;
+
+    /** Load a cost model from a calibration file. The file holds one
+     * "name value" pair per line, using the names of the fields above.
+     * Blank lines and lines starting with '#' are ignored, as are fields
+     * missing from the file. */
+    static CostModel from_file(const std::string &filename);
+
+    /** Write the cost model in the format read by from_file(). */
+    std::string to_string() const;
+};
+
 /** Auto scheduling component which is used to assign costs for computing a
  * region of a function or one of its stages. */
 struct RegionCosts {
@@ -50,40 +91,42 @@ struct RegionCosts {
     /** A scope containing the estimated min/extent values of ImageParams
      * in the pipeline. */
     Scope<Interval> input_estimates;
+    /** The per-operation costs used to cost the stages. */
+    CostModel model;
 
     /** Return the cost of producing a region (specified by 'bounds') of a
      * function stage (specified by 'func' and 'stage'). 'inlines' specifies
      * names of all the inlined functions. */
     Cost stage_region_cost(std::string func, int stage, const DimBounds &bounds,
-                           const std::set<std::string> &inlines = std::set<std::string>());
+                           const std::set<std::string> &inlines = std::set<std::string>()) const;
 
     /** Return the cost of producing a region of a function stage (specified
      * by 'func' and 'stage'). 'inlines' specifies names of all the inlined
      * functions. */
     Cost stage_region_cost(std::string func, int stage, const Box &region,
-                           const std::set<std::string> &inlines = std::set<std::string>());
+                           const std::set<std::string> &inlines = std::set<std::string>()) const;
 
     /** Return the cost of producing a region of function 'func'. This adds up the
      * costs of all stages of 'func' required to produce the region. 'inlines'
      * specifies names of all the inlined functions. */
     Cost region_cost(std::string func, const Box &region,
-                     const std::set<std::string> &inlines = std::set<std::string>());
+                     const std::set<std::string> &inlines = std::set<std::string>()) const;
 
     /** Same as region_cost above but this computes the total cost of many
      * function regions. */
     Cost region_cost(const std::map<std::string, Box> &regions,
-                     const std::set<std::string> &inlines = std::set<std::string>());
+                     const std::set<std::string> &inlines = std::set<std::string>()) const;
 
     /** Compute the cost of producing a single value by one stage of 'f'.
      * 'inlines' specifies names of all the inlined functions. */
     Cost get_func_stage_cost(const Function &f, int stage,
-                             const std::set<std::string> &inlines = std::set<std::string>());
+                             const std::set<std::string> &inlines = std::set<std::string>()) const;
 
     /** Compute the cost of producing a single value by all stages of 'f'.
      * 'inlines' specifies names of all the inlined functions. This returns a
      * vector of costs. Each entry in the vector corresponds to a stage in 'f'. */
     std::vector<Cost> get_func_cost(const Function &f,
-                                    const std::set<std::string> &inlines = std::set<std::string>());
+                                    const std::set<std::string> &inlines = std::set<std::string>()) const;
 
     /** Computes the memory costs of computing a region (specified by 'bounds')
      * of a function stage (specified by 'func' and 'stage'). This returns a map
@@ -91,47 +134,48 @@ struct RegionCosts {
      * to produce 'func'. */
     std::map<std::string, Expr>
         stage_detailed_load_costs(std::string func, int stage, DimBounds &bounds,
-                                  const std::set<std::string> &inlines = std::set<std::string>());
+                                  const std::set<std::string> &inlines = std::set<std::string>()) const;
 
     /** Return a map containing the costs incurred to access each of the functions
      * required to produce a single value of a function stage. */
     std::map<std::string, Expr>
         stage_detailed_load_costs(std::string func, int stage,
-                                  const std::set<std::string> &inlines = std::set<std::string>());
+                                  const std::set<std::string> &inlines = std::set<std::string>()) const;
 
     /** Same as stage_detailed_load_costs above but this computes the cost of a region
      * of 'func'. */
     std::map<std::string, Expr>
         detailed_load_costs(std::string func, const Box &region,
-                            const std::set<std::string> &inlines = std::set<std::string>());
+                            const std::set<std::string> &inlines = std::set<std::string>()) const;
 
     /** Same as detailed_load_costs above but this computes the cost of many function
      * regions and aggregates them. */
     std::map<std::string, Expr>
         detailed_load_costs(const std::map<std::string, Box> &regions,
-                            const std::set<std::string> &inlines = std::set<std::string>());
+                            const std::set<std::string> &inlines = std::set<std::string>()) const;
 
     /** Return the size of the region of 'func' in bytes. */
-    Expr region_size(std::string func, const Box &region);
+    Expr region_size(std::string func, const Box &region) const;
 
     /** Return the size of the peak amount of memory allocated in bytes. This takes
      * the realization (topological) order of the function regions and the early
      * free mechanism into account while computing the peak footprint. */
     Expr region_footprint(const std::map<std::string, Box> &regions,
-                          const std::set<std::string> &inlined = std::set<std::string>());
+                          const std::set<std::string> &inlined = std::set<std::string>()) const;
 
     /** Return the size of the input region in bytes. */
-    Expr input_region_size(std::string input, const Box &region);
+    Expr input_region_size(std::string input, const Box &region) const;
 
     /** Return the total size of the many input regions in bytes. */
-    Expr input_region_size(const std::map<std::string, Box> &input_regions);
+    Expr input_region_size(const std::map<std::string, Box> &input_regions) const;
 
     /** Display the cost of each function in the pipeline. */
     void disp_func_costs();
 
     /** Construct a region cost object for the pipeline. 'env' is a map of all
-     * functions in the pipeline.*/
-    RegionCosts(const std::map<std::string, Function> &env);
+     * functions in the pipeline. 'model' gives the cost of each operation. */
+    RegionCosts(const std::map<std::string, Function> &env,
+                const CostModel &model = CostModel());
 };
 
 /** Return true if the cost of inlining a function is equivalent to the
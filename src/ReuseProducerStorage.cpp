@@ -0,0 +1,209 @@
+#include "ReuseProducerStorage.h"
+#include "Debug.h"
+#include "FindCalls.h"
+#include "Function.h"
+#include "IRMutator.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Check whether all calls to a Func are at the given pure variables.
+class AllCallsPointwise : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Call *op) override {
+        if (op->call_type == Call::Halide && op->name == func) {
+            count++;
+            if (op->args.size() != args.size()) {
+                pointwise = false;
+            } else {
+                for (size_t i = 0; i < args.size(); i++) {
+                    const Variable *v = op->args[i].as<Variable>();
+                    if (!v || v->name != args[i]) {
+                        pointwise = false;
+                    }
+                }
+            }
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    const string &func;
+    const vector<string> &args;
+    int count = 0;
+    bool pointwise = true;
+
+    AllCallsPointwise(const string &func, const vector<string> &args)
+        : func(func), args(args) {}
+};
+
+bool schedule_allows_reuse(const Function &f) {
+    const FuncSchedule &s = f.schedule();
+    if (!s.compute_level().is_root() ||
+        !s.store_level().is_root() ||
+        s.memoized() ||
+        s.async() ||
+        !f.debug_file().empty() ||
+        f.is_tracing_loads() ||
+        f.is_tracing_stores() ||
+        f.is_tracing_realizations() ||
+        f.has_extern_definition() ||
+        f.outputs() != 1) {
+        return false;
+    }
+    const StageSchedule &stage = f.definition().schedule();
+    if (!stage.fuse_level().level.is_inlined() || !stage.fused_pairs().empty()) {
+        return false;
+    }
+    for (const Dim &d : stage.dims()) {
+        if (d.device_api != DeviceAPI::None && d.device_api != DeviceAPI::Host) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Whether each point of the pure definition of f is computed exactly
+// once. Splits that shift the last tile inwards compute some points
+// twice, which would read values that have already been overwritten.
+bool computes_each_point_once(const Function &f) {
+    for (const Split &s : f.definition().schedule().splits()) {
+        if (s.is_split() && !s.exact &&
+            s.tail != TailStrategy::RoundUp &&
+            s.tail != TailStrategy::GuardWithIf) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Rename the producers and consumers of Funcs that reuse the storage
+// of another.
+class ReuseStorage : public IRMutator2 {
+    using IRMutator2::visit;
+
+    const map<string, string> &candidates;
+    const map<string, Function> &env;
+
+    // The storage each renamed Func now lives in.
+    map<string, string> renamed;
+    set<string> realized;
+
+    string storage_of(string name) const {
+        auto it = renamed.find(name);
+        while (it != renamed.end()) {
+            name = it->second;
+            it = renamed.find(name);
+        }
+        return name;
+    }
+
+    Stmt visit(const Realize *op) override {
+        auto it = candidates.find(op->name);
+        if (it != candidates.end()) {
+            string storage = storage_of(it->second);
+            if (realized.count(storage)) {
+                debug(3) << "Computing " << op->name << " in place over " << storage << "\n";
+                renamed[op->name] = storage;
+                return mutate(op->body);
+            }
+        }
+        realized.insert(op->name);
+        Stmt s = IRMutator2::visit(op);
+        realized.erase(op->name);
+        return s;
+    }
+
+    Stmt visit(const Provide *op) override {
+        Stmt s = IRMutator2::visit(op);
+        if (renamed.count(op->name)) {
+            op = s.as<Provide>();
+            internal_assert(op);
+            s = Provide::make(storage_of(op->name), op->values, op->args);
+        }
+        return s;
+    }
+
+    Expr visit(const Call *op) override {
+        Expr e = IRMutator2::visit(op);
+        if (op->call_type == Call::Halide && renamed.count(op->name)) {
+            op = e.as<Call>();
+            internal_assert(op);
+            e = Call::make(env.at(storage_of(op->name)), op->args, op->value_index);
+        }
+        return e;
+    }
+
+public:
+    ReuseStorage(const map<string, string> &c, const map<string, Function> &e)
+        : candidates(c), env(e) {}
+};
+
+}  // namespace
+
+Stmt reuse_producer_storage(Stmt s, const vector<Function> &outputs,
+                            const map<string, Function> &env) {
+    set<string> is_output;
+    for (const Function &o : outputs) {
+        is_output.insert(o.name());
+    }
+
+    // Who calls each Func.
+    map<string, vector<string>> callers;
+    for (const auto &iter : env) {
+        for (const auto &callee : find_direct_calls(iter.second)) {
+            callers[callee.first].push_back(iter.first);
+        }
+        for (const ExternFuncArgument &arg : iter.second.extern_arguments()) {
+            if (arg.is_func()) {
+                // The extern stage reads the producer's buffer by name.
+                callers[Function(arg.func).name()].push_back(iter.first);
+            }
+        }
+    }
+
+    // Map each consumer to the producer whose storage it can reuse.
+    map<string, string> candidates;
+    for (const auto &iter : env) {
+        const Function &f = iter.second;
+        if (is_output.count(f.name()) || !schedule_allows_reuse(f)) {
+            continue;
+        }
+        const vector<string> &c = callers[f.name()];
+        if (c.size() != 1 || c[0] == f.name()) {
+            continue;
+        }
+        const Function &g = env.at(c[0]);
+        if (is_output.count(g.name()) ||
+            !schedule_allows_reuse(g) ||
+            !g.is_pure() ||
+            !g.definition().specializations().empty() ||
+            !computes_each_point_once(g) ||
+            g.args().size() != f.args().size() ||
+            g.output_types()[0] != f.output_types()[0]) {
+            continue;
+        }
+        AllCallsPointwise pointwise(f.name(), g.args());
+        g.accept(&pointwise);
+        if (!pointwise.pointwise) {
+            continue;
+        }
+        candidates[g.name()] = f.name();
+    }
+
+    if (candidates.empty()) {
+        return s;
+    }
+    return ReuseStorage(candidates, env).mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,34 @@
+#ifndef HALIDE_REUSE_PRODUCER_STORAGE_H
+#define HALIDE_REUSE_PRODUCER_STORAGE_H
+
+/** \file
+ * Defines a lowering pass that computes pointwise consumers in place
+ * over the storage of their producers.
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Find pairs of compute_root Funcs where the consumer is the only Func
+ * that calls the producer, has the same type and dimensionality, and
+ * only reads the producer at its own pure coordinates, and where the
+ * consumer computes each point exactly once. The consumer then writes
+ * each value over the producer value it was computed from, so drop its
+ * realization and rename its stores and loads to the producer's. Chains
+ * of such stages share a single buffer. Must be run after bounds
+ * inference and before allocation bounds inference, which then sizes
+ * the shared buffer to cover both. Enabled by the ReuseProducerStorage
+ * target feature. */
+Stmt reuse_producer_storage(Stmt s, const std::vector<Function> &outputs,
+                            const std::map<std::string, Function> &env);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
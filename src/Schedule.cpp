@@ -213,11 +213,22 @@ struct FuncScheduleContents {
     std::vector<Bound> estimates;
     std::map<std::string, Internal::FunctionPtr> wrappers;
     bool memoized;
+    MemoizeKey memoize_key;
+    Expr memoize_version;
+    bool async;
+    bool nontemporal;
+    bool interleave_tuple;
+    float partition_budget;
+    std::string distributed_dim;
+    std::string distributed_gpu_dim;
+    std::vector<int> distributed_gpu_devices;
+    std::string co_execute_dim;
     MemoryType memory_type;
 
     FuncScheduleContents() :
         store_level(LoopLevel::inlined()), compute_level(LoopLevel::inlined()),
-        memoized(false), memory_type(MemoryType::Auto) {};
+        memoized(false), memoize_key(MemoizeKey::Default), async(false), nontemporal(false), interleave_tuple(false),
+        partition_budget(0), memory_type(MemoryType::Auto) {};
 
     // Pass an IRMutator2 through to all Exprs referenced in the FuncScheduleContents
     void mutate(IRMutator2 *mutator) {
@@ -249,6 +260,9 @@ struct FuncScheduleContents {
                 b.remainder = mutator->mutate(b.remainder);
             }
         }
+        if (memoize_version.defined()) {
+            memoize_version = mutator->mutate(memoize_version);
+        }
     }
 };
 
@@ -272,13 +286,15 @@ struct StageScheduleContents {
     std::vector<Split> splits;
     std::vector<Dim> dims;
     std::vector<PrefetchDirective> prefetches;
+    std::vector<SkipDirective> skips;
     FuseLoopLevel fuse_level;
     std::vector<FusedPair> fused_pairs;
     bool touched;
     bool allow_race_conditions;
+    bool atomic;
 
     StageScheduleContents() : fuse_level(FuseLoopLevel()), touched(false),
-                              allow_race_conditions(false) {};
+                              allow_race_conditions(false), atomic(false) {};
 
     // Pass an IRMutator2 through to all Exprs referenced in the StageScheduleContents
     void mutate(IRMutator2 *mutator) {
@@ -300,6 +316,9 @@ struct StageScheduleContents {
                 p.offset = mutator->mutate(p.offset);
             }
         }
+        for (SkipDirective &s : skips) {
+            s.condition = mutator->mutate(s.condition);
+        }
     }
 };
 
@@ -327,6 +346,16 @@ FuncSchedule FuncSchedule::deep_copy(
     copy.contents->bounds = contents->bounds;
     copy.contents->estimates = contents->estimates;
     copy.contents->memoized = contents->memoized;
+    copy.contents->memoize_key = contents->memoize_key;
+    copy.contents->memoize_version = contents->memoize_version;
+    copy.contents->async = contents->async;
+    copy.contents->nontemporal = contents->nontemporal;
+    copy.contents->interleave_tuple = contents->interleave_tuple;
+    copy.contents->partition_budget = contents->partition_budget;
+    copy.contents->distributed_dim = contents->distributed_dim;
+    copy.contents->distributed_gpu_dim = contents->distributed_gpu_dim;
+    copy.contents->distributed_gpu_devices = contents->distributed_gpu_devices;
+    copy.contents->co_execute_dim = contents->co_execute_dim;
     copy.contents->memory_type = contents->memory_type;
 
     // Deep-copy wrapper functions.
@@ -347,6 +376,86 @@ bool FuncSchedule::memoized() const {
     return contents->memoized;
 }
 
+MemoizeKey &FuncSchedule::memoize_key() {
+    return contents->memoize_key;
+}
+
+MemoizeKey FuncSchedule::memoize_key() const {
+    return contents->memoize_key;
+}
+
+Expr &FuncSchedule::memoize_version() {
+    return contents->memoize_version;
+}
+
+Expr FuncSchedule::memoize_version() const {
+    return contents->memoize_version;
+}
+
+bool &FuncSchedule::async() {
+    return contents->async;
+}
+
+bool FuncSchedule::async() const {
+    return contents->async;
+}
+
+bool &FuncSchedule::nontemporal() {
+    return contents->nontemporal;
+}
+
+bool FuncSchedule::nontemporal() const {
+    return contents->nontemporal;
+}
+
+bool &FuncSchedule::interleave_tuple() {
+    return contents->interleave_tuple;
+}
+
+bool FuncSchedule::interleave_tuple() const {
+    return contents->interleave_tuple;
+}
+
+float &FuncSchedule::partition_budget() {
+    return contents->partition_budget;
+}
+
+float FuncSchedule::partition_budget() const {
+    return contents->partition_budget;
+}
+
+std::string &FuncSchedule::distributed_dim() {
+    return contents->distributed_dim;
+}
+
+const std::string &FuncSchedule::distributed_dim() const {
+    return contents->distributed_dim;
+}
+
+std::string &FuncSchedule::distributed_gpu_dim() {
+    return contents->distributed_gpu_dim;
+}
+
+const std::string &FuncSchedule::distributed_gpu_dim() const {
+    return contents->distributed_gpu_dim;
+}
+
+std::vector<int> &FuncSchedule::distributed_gpu_devices() {
+    return contents->distributed_gpu_devices;
+}
+
+const std::vector<int> &FuncSchedule::distributed_gpu_devices() const {
+    return contents->distributed_gpu_devices;
+}
+
+std::string &FuncSchedule::co_execute_dim() {
+    return contents->co_execute_dim;
+}
+
+const std::string &FuncSchedule::co_execute_dim() const {
+    return contents->co_execute_dim;
+}
+
 MemoryType FuncSchedule::memory_type() const {
     return contents->memory_type;
 }
@@ -445,6 +554,9 @@ void FuncSchedule::accept(IRVisitor *visitor) const {
             b.remainder.accept(visitor);
         }
     }
+    if (memoize_version().defined()) {
+        memoize_version().accept(visitor);
+    }
 }
 
 void FuncSchedule::mutate(IRMutator2 *mutator) {
@@ -463,10 +575,12 @@ StageSchedule StageSchedule::get_copy() const {
     copy.contents->splits = contents->splits;
     copy.contents->dims = contents->dims;
     copy.contents->prefetches = contents->prefetches;
+    copy.contents->skips = contents->skips;
     copy.contents->fuse_level = contents->fuse_level;
     copy.contents->fused_pairs = contents->fused_pairs;
     copy.contents->touched = contents->touched;
     copy.contents->allow_race_conditions = contents->allow_race_conditions;
+    copy.contents->atomic = contents->atomic;
     return copy;
 }
 
@@ -510,6 +624,14 @@ const std::vector<PrefetchDirective> &StageSchedule::prefetches() const {
     return contents->prefetches;
 }
 
+std::vector<SkipDirective> &StageSchedule::skips() {
+    return contents->skips;
+}
+
+const std::vector<SkipDirective> &StageSchedule::skips() const {
+    return contents->skips;
+}
+
 FuseLoopLevel &StageSchedule::fuse_level() {
     return contents->fuse_level;
 }
@@ -534,6 +656,14 @@ bool StageSchedule::allow_race_conditions() const {
     return contents->allow_race_conditions;
 }
 
+bool &StageSchedule::atomic() {
+    return contents->atomic;
+}
+
+bool StageSchedule::atomic() const {
+    return contents->atomic;
+}
+
 void StageSchedule::accept(IRVisitor *visitor) const {
     for (const ReductionVariable &r : rvars()) {
         if (r.min.defined()) {
@@ -553,6 +683,9 @@ void StageSchedule::accept(IRVisitor *visitor) const {
             p.offset.accept(visitor);
         }
     }
+    for (const SkipDirective &s : skips()) {
+        s.condition.accept(visitor);
+    }
 }
 
 void StageSchedule::mutate(IRMutator2 *mutator) {
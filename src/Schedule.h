@@ -61,6 +61,19 @@ enum class TailStrategy {
      * instead of a multiple of the split factor as with RoundUp. */
     ShiftInwards,
 
+    /** Guard the loads and stores of the inner loop with a
+     * predicate that prevents evaluation beyond the original
+     * extent. Always legal. Unlike GuardWithIf, the condition is
+     * not factored out into an epilogue, so a vectorized inner loop
+     * runs entirely as predicated vector loads and stores, including
+     * the final partial vector. Pros: no redundant re-evaluation,
+     * no scalar tail, and no epilogue code; does not constrain input
+     * or output sizes. Cons: only fast on targets with native
+     * predicated loads and stores (e.g. AVX-512 and HVX). Elsewhere,
+     * a vectorized loop that can't be predicated is
+     * scalarized. */
+    Predicate,
+
     /** For pure definitions use ShiftInwards. For pure vars in
      * update definitions use RoundUp. For RVars in update
      * definitions use GuardWithIf. */
@@ -104,6 +117,20 @@ enum class PrefetchBoundStrategy {
     NonFaulting
 };
 
+/** How the cache key of a memoized Func accounts for the input buffers
+ * it depends on. See Func::memoize. */
+enum class MemoizeKey {
+    /** Input buffers may not be in the key. A memoized Func that
+     * depends on one must bracket the access with memoize_tag. */
+    Default,
+
+    /** The contents of each input buffer the Func depends on are
+     * hashed on every realization, and the hash is part of the key.
+     * A new buffer holding the same data hits in the cache, and
+     * changed data in the same buffer misses. */
+    ContentHash
+};
+
 /** A reference to a site in a Halide statement at the top of the
  * body of a particular for loop. Evaluating a region of a halide
  * function is done by generating a loop nest that spans its
@@ -310,6 +337,9 @@ struct StorageDim {
     Expr alignment;
     Expr fold_factor;
     bool fold_forward;
+    // Defined for the two innermost storage dimensions of a Func stored
+    // in tiles of this size in each of them. See Func::store_tiled.
+    Expr tile_factor;
 };
 
 /** This represents two stages with fused loop nests from outermost to a specific
@@ -360,6 +390,13 @@ struct PrefetchDirective {
     Parameter param;
 };
 
+/** A condition under which the iterations of one loop of a stage are
+ * skipped. See \ref Stage::skip_unless */
+struct SkipDirective {
+    std::string var;
+    Expr condition;
+};
+
 struct FuncScheduleContents;
 struct StageScheduleContents;
 struct FunctionContents;
@@ -393,6 +430,80 @@ public:
     bool memoized() const;
     // @}
 
+    /** How the cache key of a memoized Func covers its input buffers,
+     * and the version tag that lets a buffer's content hash be reused
+     * (undefined if there is none). See Func::memoize. */
+    // @{
+    MemoizeKey &memoize_key();
+    MemoizeKey memoize_key() const;
+    Expr &memoize_version();
+    Expr memoize_version() const;
+    // @}
+
+    /** This flag is set to true if the Func is produced on another thread
+     * from its consumer. See Func::async. */
+    // @{
+    bool &async();
+    bool async() const;
+    // @}
+
+    /** This flag is set to true if the values of the Func are stored with
+     * non-temporal stores that bypass the cache. See
+     * Func::store_nontemporal. */
+    // @{
+    bool &nontemporal();
+    bool nontemporal() const;
+    // @}
+
+    /** This flag is set to true if the elements of a Tuple-valued Func
+     * are stored interleaved in a single allocation. See
+     * Func::store_tuple_interleaved. */
+    // @{
+    bool &interleave_tuple();
+    bool interleave_tuple() const;
+    // @}
+
+    /** The multiple of their size before loop partitioning that the
+     * loop nests of the Func may grow to when their loops are
+     * partitioned, or zero if there is no limit. See
+     * Func::partition_budget. */
+    // @{
+    float &partition_budget();
+    float partition_budget() const;
+    // @}
+
+    /** The dimension that the Func is partitioned along across the ranks
+     * of a distributed realization, or empty if it isn't. See
+     * Func::distribute. */
+    // @{
+    std::string &distributed_dim();
+    const std::string &distributed_dim() const;
+    // @}
+
+    /** The dimension that realizations of the Func are split along
+     * across GPU devices of this process, or empty if they
+     * aren't. See Func::distribute_gpus. */
+    // @{
+    std::string &distributed_gpu_dim();
+    const std::string &distributed_gpu_dim() const;
+    // @}
+
+    /** The GPU devices of this process that realizations of the Func
+     * are split across, along distributed_gpu_dim, or empty if they
+     * aren't. See Func::distribute_gpus. */
+    // @{
+    std::vector<int> &distributed_gpu_devices();
+    const std::vector<int> &distributed_gpu_devices() const;
+    // @}
+
+    /** The dimension whose range realizations of the Func split
+     * between a GPU and the host, or empty if they don't. See
+     * Func::co_execute. */
+    // @{
+    std::string &co_execute_dim();
+    const std::string &co_execute_dim() const;
+    // @}
+
     /** The list and order of dimensions used to store this
      * function. The first dimension in the vector corresponds to the
      * innermost dimension for storage (i.e. which dimension is
@@ -514,6 +625,13 @@ public:
     std::vector<PrefetchDirective> &prefetches();
     // @}
 
+    /** Conditions under which iterations of some of the loops of this
+     * stage are skipped. See \ref Stage::skip_unless */
+    // @{
+    const std::vector<SkipDirective> &skips() const;
+    std::vector<SkipDirective> &skips();
+    // @}
+
     /** Innermost loop level of fused loop nest for this function stage.
      * Fusion runs from outermost to this loop level. The stages being fused
      * should not have producer/consumer relationship. See \ref Func::compute_with
@@ -538,6 +656,13 @@ public:
     bool &allow_race_conditions();
     // @}
 
+    /** Is this stage computed using atomic read-modify-write
+     * operations, so that it may be parallelized over its RVars? */
+    // @{
+    bool atomic() const;
+    bool &atomic();
+    // @}
+
     /** Pass an IRVisitor through to all Exprs referenced in the
      * Schedule. */
     void accept(IRVisitor *) const;
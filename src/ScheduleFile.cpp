@@ -0,0 +1,609 @@
+#include "ScheduleFile.h"
+
+#include <cctype>
+#include <fstream>
+#include <sstream>
+
+#include "FindCalls.h"
+#include "Func.h"
+#include "IROperator.h"
+
+namespace Halide {
+
+using std::map;
+using std::string;
+using std::vector;
+
+using Internal::Definition;
+using Internal::Dim;
+using Internal::ForType;
+using Internal::Function;
+using Internal::Split;
+
+namespace {
+
+// The names of the enums that appear in schedules. The first entry of
+// each table is the default.
+const vector<std::pair<string, TailStrategy>> tail_strategy_names = {
+    {"Auto", TailStrategy::Auto},
+    {"RoundUp", TailStrategy::RoundUp},
+    {"GuardWithIf", TailStrategy::GuardWithIf},
+    {"ShiftInwards", TailStrategy::ShiftInwards},
+    {"Predicate", TailStrategy::Predicate},
+};
+
+const vector<std::pair<string, MemoryType>> memory_type_names = {
+    {"Auto", MemoryType::Auto},
+    {"Heap", MemoryType::Heap},
+    {"Stack", MemoryType::Stack},
+    {"Register", MemoryType::Register},
+    {"GPUShared", MemoryType::GPUShared},
+    {"VTCM", MemoryType::VTCM},
+};
+
+const vector<std::pair<string, DeviceAPI>> device_api_names = {
+    {"Default_GPU", DeviceAPI::Default_GPU},
+    {"None", DeviceAPI::None},
+    {"Host", DeviceAPI::Host},
+    {"CUDA", DeviceAPI::CUDA},
+    {"OpenCL", DeviceAPI::OpenCL},
+    {"GLSL", DeviceAPI::GLSL},
+    {"OpenGLCompute", DeviceAPI::OpenGLCompute},
+    {"Metal", DeviceAPI::Metal},
+    {"Hexagon", DeviceAPI::Hexagon},
+};
+
+template<typename T>
+string enum_name(const vector<std::pair<string, T>> &names, T value) {
+    for (const auto &n : names) {
+        if (n.second == value) {
+            return n.first;
+        }
+    }
+    internal_error << "Unknown enum value in schedule\n";
+    return "";
+}
+
+// The names in the dims of a stage are qualified by the vars they
+// were split from, e.g. "x.xo". Directives refer to them by the last
+// part, as the scheduling calls do.
+string short_name(const string &name) {
+    size_t dot = name.rfind('.');
+    return dot == string::npos ? name : name.substr(dot + 1);
+}
+
+string constant(const Expr &e, const string &func, const string &what) {
+    const int64_t *i = Internal::as_const_int(e);
+    user_assert(i) << "Can't serialize the schedule of " << func << ", because its "
+                   << what << " " << e << " is not a constant.\n";
+    return std::to_string(*i);
+}
+
+string loop_level(const LoopLevel &l, const map<string, string> &names) {
+    if (l.is_root()) {
+        return "root";
+    }
+    auto it = names.find(l.func());
+    user_assert(it != names.end()) << "Can't serialize a schedule computed at "
+                                   << l.func() << ", which is not in the pipeline.\n";
+    string result = it->second + ", " + short_name(l.var().name());
+    // A LoopLevel that doesn't name a stage prints without one.
+    if (l.to_string() != l.func() + "." + l.var().name()) {
+        result += ", " + std::to_string(l.stage_index());
+    }
+    return result;
+}
+
+void write_stage(std::ostream &s, const string &stage, const Definition &def) {
+    const Internal::StageSchedule &sched = def.schedule();
+    for (const Split &split : sched.splits()) {
+        if (split.is_split()) {
+            s << stage << ".split(" << short_name(split.old_var) << ", "
+              << short_name(split.outer) << ", " << short_name(split.inner) << ", "
+              << constant(split.factor, stage, "split factor") << ", "
+              << enum_name(tail_strategy_names, split.tail) << ")\n";
+        } else if (split.is_fuse()) {
+            s << stage << ".fuse(" << short_name(split.inner) << ", "
+              << short_name(split.outer) << ", " << short_name(split.old_var) << ")\n";
+        } else if (split.is_rename()) {
+            s << stage << ".rename(" << short_name(split.old_var) << ", "
+              << short_name(split.outer) << ")\n";
+        } else {
+            user_error << "Can't serialize the schedule of " << stage
+                       << ", because it was made with rfactor.\n";
+        }
+    }
+
+    // The loop order, innermost first, leaving out the outermost
+    // placeholder dimension. It is left out if it is the default.
+    const vector<Dim> &dims = sched.dims();
+    bool reordered = !sched.splits().empty() || dims.size() != def.args().size() + 1;
+    for (size_t i = 0; !reordered && i < def.args().size(); i++) {
+        const Internal::Variable *v = def.args()[i].as<Internal::Variable>();
+        reordered = !v || v->name != dims[i].var;
+    }
+    if (reordered && dims.size() > 2) {
+        s << stage << ".reorder(";
+        for (size_t i = 0; i + 1 < dims.size(); i++) {
+            s << (i > 0 ? ", " : "") << short_name(dims[i].var);
+        }
+        s << ")\n";
+    }
+    for (size_t i = 0; i + 1 < dims.size(); i++) {
+        const Dim &d = dims[i];
+        string v = short_name(d.var);
+        string device = d.device_api == DeviceAPI::Default_GPU ? "" :
+            ", " + enum_name(device_api_names, d.device_api);
+        switch (d.for_type) {
+        case ForType::Serial:
+            break;
+        case ForType::Parallel:
+            s << stage << ".parallel(" << v << ")\n";
+            break;
+        case ForType::Vectorized:
+            s << stage << ".vectorize(" << v << ")\n";
+            break;
+        case ForType::Unrolled:
+            s << stage << ".unroll(" << v << ")\n";
+            break;
+        case ForType::GPUBlock:
+            s << stage << ".gpu_blocks(" << v << device << ")\n";
+            break;
+        case ForType::GPUThread:
+            s << stage << ".gpu_threads(" << v << device << ")\n";
+            break;
+        case ForType::GPULane:
+            s << stage << ".gpu_lanes(" << v << device << ")\n";
+            break;
+        }
+    }
+    if (sched.atomic()) {
+        s << stage << ".atomic()\n";
+    }
+    if (sched.allow_race_conditions()) {
+        s << stage << ".allow_race_conditions()\n";
+    }
+}
+
+void write_func(std::ostream &s, const string &name, const Function &f,
+                const map<string, string> &names) {
+    const Internal::FuncSchedule &sched = f.schedule();
+
+    LoopLevel compute = sched.compute_level();
+    LoopLevel store = sched.store_level();
+    compute.lock();
+    store.lock();
+    if (!compute.is_inlined()) {
+        if (compute.is_root()) {
+            s << name << ".compute_root()\n";
+        } else {
+            s << name << ".compute_at(" << loop_level(compute, names) << ")\n";
+        }
+        if (!store.is_inlined() && store != compute) {
+            if (store.is_root()) {
+                s << name << ".store_root()\n";
+            } else {
+                s << name << ".store_at(" << loop_level(store, names) << ")\n";
+            }
+        }
+    }
+    if (sched.memory_type() != MemoryType::Auto) {
+        s << name << ".store_in(" << enum_name(memory_type_names, sched.memory_type()) << ")\n";
+    }
+    if (sched.memoized()) {
+        s << name << ".memoize()\n";
+    }
+
+    const vector<Internal::StorageDim> &storage = sched.storage_dims();
+    bool reordered = false;
+    for (size_t i = 0; i < storage.size(); i++) {
+        reordered |= storage[i].var != f.args()[i];
+    }
+    if (reordered) {
+        s << name << ".reorder_storage(";
+        for (size_t i = 0; i < storage.size(); i++) {
+            s << (i > 0 ? ", " : "") << storage[i].var;
+        }
+        s << ")\n";
+    }
+    for (const Internal::StorageDim &d : storage) {
+        if (d.alignment.defined()) {
+            s << name << ".align_storage(" << d.var << ", "
+              << constant(d.alignment, name, "storage alignment") << ")\n";
+        }
+        if (d.fold_factor.defined()) {
+            s << name << ".fold_storage(" << d.var << ", "
+              << constant(d.fold_factor, name, "fold factor") << ", "
+              << (d.fold_forward ? "true" : "false") << ")\n";
+        }
+    }
+    for (const Internal::Bound &b : sched.bounds()) {
+        if (b.min.defined()) {
+            s << name << ".bound(" << b.var << ", "
+              << constant(b.min, name, "bound") << ", "
+              << constant(b.extent, name, "bound") << ")\n";
+        } else if (b.extent.defined()) {
+            s << name << ".bound_extent(" << b.var << ", "
+              << constant(b.extent, name, "bound") << ")\n";
+        }
+        if (b.modulus.defined()) {
+            s << name << ".align_bounds(" << b.var << ", "
+              << constant(b.modulus, name, "bound alignment") << ", "
+              << constant(b.remainder, name, "bound alignment") << ")\n";
+        }
+    }
+
+    if (f.has_extern_definition()) {
+        return;
+    }
+    write_stage(s, name, f.definition());
+    for (size_t i = 0; i < f.updates().size(); i++) {
+        write_stage(s, name + ".update(" + std::to_string(i) + ")", f.updates()[i]);
+    }
+}
+
+// Func names are made unique within a process by adding "$n" to
+// them, so building the same pipeline twice gives different names the
+// second time. Schedules refer to Funcs by the names they were given,
+// unless two Funcs in the pipeline were given the same one.
+string given_name(const string &name) {
+    size_t dollar = name.rfind('$');
+    if (dollar == string::npos || dollar + 1 == name.size()) {
+        return name;
+    }
+    for (size_t i = dollar + 1; i < name.size(); i++) {
+        if (!isdigit((unsigned char)name[i])) {
+            return name;
+        }
+    }
+    return name.substr(0, dollar);
+}
+
+// The Funcs of a pipeline, by the names schedules use for them.
+map<string, Function> pipeline_env(const Pipeline &pipeline) {
+    map<string, Function> env;
+    for (const Func &f : pipeline.outputs()) {
+        Internal::populate_environment(f.function(), env);
+    }
+    map<string, int> count;
+    for (const auto &i : env) {
+        count[given_name(i.first)]++;
+    }
+    map<string, Function> result;
+    for (const auto &i : env) {
+        string name = given_name(i.first);
+        result[count[name] == 1 ? name : i.first] = i.second;
+    }
+    return result;
+}
+
+// A scheduling call parsed from a schedule.
+struct Directive {
+    string func;
+    int update;  // -1 for the pure definition
+    string name;
+    vector<string> args;
+    int line;
+};
+
+class Parser {
+    const string &text;
+    size_t pos = 0;
+    int line = 1;
+
+    void skip_space() {
+        while (pos < text.size()) {
+            char c = text[pos];
+            if (c == '#') {
+                while (pos < text.size() && text[pos] != '\n') {
+                    pos++;
+                }
+            } else if (c == '\n') {
+                line++;
+                pos++;
+            } else if (isspace((unsigned char)c) || c == ';') {
+                pos++;
+            } else {
+                break;
+            }
+        }
+    }
+
+    bool is_token_char(char c) {
+        return isalnum((unsigned char)c) || c == '_' || c == '$' || c == ':' || c == '-';
+    }
+
+    string token() {
+        skip_space();
+        size_t start = pos;
+        while (pos < text.size() && is_token_char(text[pos])) {
+            pos++;
+        }
+        user_assert(pos > start) << "Syntax error on line " << line << " of schedule: "
+                                 << "expected a name or a number.\n";
+        return text.substr(start, pos - start);
+    }
+
+    void expect(char c) {
+        skip_space();
+        user_assert(pos < text.size() && text[pos] == c)
+            << "Syntax error on line " << line << " of schedule: expected '" << c << "'.\n";
+        pos++;
+    }
+
+    bool next_is(char c) {
+        skip_space();
+        return pos < text.size() && text[pos] == c;
+    }
+
+public:
+    Parser(const string &t) : text(t) {}
+
+    vector<Directive> parse() {
+        vector<Directive> result;
+        while (true) {
+            skip_space();
+            if (pos >= text.size()) {
+                break;
+            }
+            Directive d;
+            d.line = line;
+            d.func = token();
+            d.update = -1;
+            // A chain of calls on one Func or stage.
+            do {
+                expect('.');
+                d.name = token();
+                d.args.clear();
+                expect('(');
+                if (!next_is(')')) {
+                    d.args.push_back(token());
+                    while (next_is(',')) {
+                        expect(',');
+                        d.args.push_back(token());
+                    }
+                }
+                expect(')');
+                if (d.name == "update") {
+                    user_assert(d.update < 0 && d.args.size() <= 1)
+                        << "Syntax error on line " << d.line << " of schedule: bad update().\n";
+                    d.update = d.args.empty() ? 0 : std::atoi(d.args[0].c_str());
+                } else {
+                    result.push_back(d);
+                }
+            } while (next_is('.'));
+        }
+        return result;
+    }
+};
+
+class Applier {
+    const map<string, Function> &env;
+    const Directive *d = nullptr;
+
+    string where() const {
+        return "On line " + std::to_string(d->line) + " of schedule, " + d->func + "." + d->name + ": ";
+    }
+
+    void check_args(size_t min, size_t max) {
+        user_assert(d->args.size() >= min && d->args.size() <= max)
+            << where() << "wrong number of arguments.\n";
+    }
+
+    Func func(const string &name) {
+        auto it = env.find(name);
+        user_assert(it != env.end()) << where() << "there is no Func called " << name << ".\n";
+        return Func(it->second);
+    }
+
+    const Definition &definition(const Function &f, int update) {
+        return update < 0 ? f.definition() : f.updates()[update];
+    }
+
+    // A Var or RVar of a stage, depending on what the stage's loop of
+    // that name is. Names that aren't loops of the stage yet (e.g. the
+    // results of a split) get the kind of like_var.
+    VarOrRVar var(const Function &f, int update, const string &name, const string &like_var = "") {
+        const string &lookup = like_var.empty() ? name : like_var;
+        for (const Dim &dim : definition(f, update).schedule().dims()) {
+            if (dim.var == lookup || Internal::ends_with(dim.var, "." + lookup)) {
+                return VarOrRVar(name, dim.is_rvar());
+            }
+        }
+        return VarOrRVar(name, false);
+    }
+
+    int integer(const string &s) {
+        char *end = nullptr;
+        long v = strtol(s.c_str(), &end, 10);
+        user_assert(!s.empty() && *end == 0) << where() << "expected a number, got " << s << ".\n";
+        return (int)v;
+    }
+
+    bool boolean(const string &s) {
+        user_assert(s == "true" || s == "false") << where() << "expected true or false, got " << s << ".\n";
+        return s == "true";
+    }
+
+    template<typename T>
+    T enum_value(const vector<std::pair<string, T>> &names, const string &s) {
+        string n = s.substr(s.rfind(':') == string::npos ? 0 : s.rfind(':') + 1);
+        for (const auto &i : names) {
+            if (i.first == n) {
+                return i.second;
+            }
+        }
+        user_error << where() << "unknown value " << s << ".\n";
+        return names[0].second;
+    }
+
+    LoopLevel loop_level(size_t first_arg) {
+        Func g = func(d->args[first_arg]);
+        int stage = d->args.size() > first_arg + 2 ? integer(d->args[first_arg + 2]) : -1;
+        int update = stage > 0 ? stage - 1 : -1;
+        user_assert(update < g.num_update_definitions())
+            << where() << g.name() << " has no stage " << stage << ".\n";
+        return LoopLevel(g, var(g.function(), update, d->args[first_arg + 1]), stage);
+    }
+
+    void apply_func_directive(Func f) {
+        const string &n = d->name;
+        const vector<string> &a = d->args;
+        if (n == "compute_root") {
+            check_args(0, 0);
+            f.compute_root();
+        } else if (n == "compute_at") {
+            check_args(2, 3);
+            f.compute_at(loop_level(0));
+        } else if (n == "store_root") {
+            check_args(0, 0);
+            f.store_root();
+        } else if (n == "store_at") {
+            check_args(2, 3);
+            f.store_at(loop_level(0));
+        } else if (n == "compute_inline") {
+            check_args(0, 0);
+            f.compute_inline();
+        } else if (n == "store_in") {
+            check_args(1, 1);
+            f.store_in(enum_value(memory_type_names, a[0]));
+        } else if (n == "memoize") {
+            check_args(0, 0);
+            f.memoize();
+        } else if (n == "reorder_storage") {
+            vector<Var> vars;
+            for (const string &v : a) {
+                vars.push_back(Var(v));
+            }
+            f.reorder_storage(vars);
+        } else if (n == "align_storage") {
+            check_args(2, 2);
+            f.align_storage(Var(a[0]), integer(a[1]));
+        } else if (n == "fold_storage") {
+            check_args(2, 3);
+            f.fold_storage(Var(a[0]), integer(a[1]), a.size() < 3 || boolean(a[2]));
+        } else if (n == "bound") {
+            check_args(3, 3);
+            f.bound(Var(a[0]), integer(a[1]), integer(a[2]));
+        } else if (n == "bound_extent") {
+            check_args(2, 2);
+            f.bound_extent(Var(a[0]), integer(a[1]));
+        } else if (n == "align_bounds") {
+            check_args(2, 3);
+            f.align_bounds(Var(a[0]), integer(a[1]), a.size() < 3 ? 0 : integer(a[2]));
+        } else {
+            user_error << where() << "unknown scheduling directive.\n";
+        }
+    }
+
+    void apply_stage_directive(Func f, int update) {
+        const Function &fn = f.function();
+        Stage s = update < 0 ? Stage(f) : f.update(update);
+        const string &n = d->name;
+        const vector<string> &a = d->args;
+        if (n == "split") {
+            check_args(4, 5);
+            s.split(var(fn, update, a[0]), var(fn, update, a[1], a[0]), var(fn, update, a[2], a[0]),
+                    integer(a[3]), a.size() < 5 ? TailStrategy::Auto : enum_value(tail_strategy_names, a[4]));
+        } else if (n == "fuse") {
+            check_args(3, 3);
+            s.fuse(var(fn, update, a[0]), var(fn, update, a[1]), var(fn, update, a[2], a[0]));
+        } else if (n == "rename") {
+            check_args(2, 2);
+            s.rename(var(fn, update, a[0]), var(fn, update, a[1], a[0]));
+        } else if (n == "reorder") {
+            vector<VarOrRVar> vars;
+            for (const string &v : a) {
+                vars.push_back(var(fn, update, v));
+            }
+            s.reorder(vars);
+        } else if (n == "serial" || n == "parallel" || n == "vectorize" || n == "unroll") {
+            check_args(1, 2);
+            VarOrRVar v = var(fn, update, a[0]);
+            if (n == "serial") {
+                check_args(1, 1);
+                s.serial(v);
+            } else if (n == "parallel") {
+                a.size() > 1 ? s.parallel(v, integer(a[1])) : s.parallel(v);
+            } else if (n == "vectorize") {
+                a.size() > 1 ? s.vectorize(v, integer(a[1])) : s.vectorize(v);
+            } else {
+                a.size() > 1 ? s.unroll(v, integer(a[1])) : s.unroll(v);
+            }
+        } else if (n == "gpu_blocks" || n == "gpu_threads" || n == "gpu_lanes") {
+            check_args(1, 2);
+            VarOrRVar v = var(fn, update, a[0]);
+            DeviceAPI device = a.size() > 1 ? enum_value(device_api_names, a[1]) : DeviceAPI::Default_GPU;
+            if (n == "gpu_blocks") {
+                s.gpu_blocks(v, device);
+            } else if (n == "gpu_threads") {
+                s.gpu_threads(v, device);
+            } else {
+                s.gpu_lanes(v, device);
+            }
+        } else if (n == "atomic") {
+            check_args(0, 0);
+            s.atomic();
+        } else if (n == "allow_race_conditions") {
+            check_args(0, 0);
+            s.allow_race_conditions();
+        } else if (update < 0) {
+            apply_func_directive(f);
+        } else {
+            user_error << where() << "unknown scheduling directive for an update definition.\n";
+        }
+    }
+
+public:
+    Applier(const map<string, Function> &env) : env(env) {}
+
+    void apply(const Directive &directive) {
+        d = &directive;
+        Func f = func(d->func);
+        user_assert(d->update < f.num_update_definitions())
+            << where() << f.name() << " has no update definition " << d->update << ".\n";
+        apply_stage_directive(f, d->update);
+    }
+};
+
+}  // namespace
+
+std::string serialize_schedule(const Pipeline &pipeline) {
+    map<string, Function> env = pipeline_env(pipeline);
+    map<string, string> names;
+    for (const auto &i : env) {
+        names[i.second.name()] = i.first;
+    }
+    std::ostringstream s;
+    for (const auto &i : env) {
+        write_func(s, i.first, i.second, names);
+    }
+    return s.str();
+}
+
+void apply_schedule(const Pipeline &pipeline, const std::string &schedule) {
+    map<string, Function> env = pipeline_env(pipeline);
+    Applier applier(env);
+    // Loop levels name the loops of other Funcs, which may be made by
+    // later directives, so they are applied last.
+    vector<Directive> directives = Parser(schedule).parse();
+    for (int loop_levels = 0; loop_levels < 2; loop_levels++) {
+        for (const Directive &d : directives) {
+            bool is_loop_level = d.name == "compute_at" || d.name == "store_at";
+            if (is_loop_level == (loop_levels == 1)) {
+                applier.apply(d);
+            }
+        }
+    }
+    Pipeline(pipeline).invalidate_cache();
+}
+
+void apply_schedule_file(const Pipeline &pipeline, const std::string &filename) {
+    std::ifstream file(filename);
+    user_assert(file) << "Could not open schedule file " << filename << "\n";
+    std::stringstream schedule;
+    schedule << file.rdbuf();
+    apply_schedule(pipeline, schedule.str());
+}
+
+}  // namespace Halide
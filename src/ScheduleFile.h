@@ -0,0 +1,54 @@
+#ifndef HALIDE_SCHEDULE_FILE_H
+#define HALIDE_SCHEDULE_FILE_H
+
+/** \file
+ * A text format for the schedules of the Funcs of a Pipeline, so that
+ * they can be stored in a file and applied without recompiling the
+ * code that defines the pipeline.
+ */
+
+#include <string>
+
+#include "Pipeline.h"
+
+namespace Halide {
+
+/** Write the schedules of the Funcs of a Pipeline as text. Each line
+ * is one scheduling directive, written like the call that makes it,
+ * e.g.:
+ *
+ \code
+ blur_x.compute_at(blur_y, yo)
+ blur_x.vectorize(x)
+ blur_y.split(y, yo, yi, 32, Auto)
+ blur_y.reorder(x, yi, yo)
+ blur_y.parallel(yo)
+ hist.update(0).atomic()
+ \endcode
+ *
+ * The loop levels, splits, fuses, renames, loop order and loop
+ * types of every stage are written, along with each Func's storage
+ * order, alignment, folding, bounds and memory type. Split factors
+ * and bounds must be constants. Specializations, rfactor,
+ * compute_with, prefetches and other directives with no equivalent
+ * here are not written.
+ *
+ * Applying the result with apply_schedule to the same pipeline
+ * left unscheduled reproduces the schedule. */
+std::string serialize_schedule(const Pipeline &pipeline);
+
+/** Apply a schedule in the format written by serialize_schedule to
+ * the Funcs of a Pipeline. Lines starting with '#' are comments, and
+ * several directives may be chained on a line as in C++, e.g.
+ * "f.split(x, xo, xi, 8).vectorize(xi)". Vars and RVars are referred
+ * to by name. The directives are applied on top of any schedule the
+ * Funcs already have. */
+void apply_schedule(const Pipeline &pipeline, const std::string &schedule);
+
+/** Apply the schedule in a file, in the format written by
+ * serialize_schedule, to the Funcs of a Pipeline. */
+void apply_schedule_file(const Pipeline &pipeline, const std::string &filename);
+
+}  // namespace Halide
+
+#endif
@@ -16,6 +16,7 @@
 #include "IREquality.h"
 #include "ExprUsesVar.h"
 #include "Solve.h"
+#include "Associativity.h"
 
 #include <algorithm>
 
@@ -72,6 +73,29 @@ bool contains_impure_call(const Expr &expr) {
     return is_not_pure.result;
 }
 
+// Mark the values of an atomic update definition, so that codegen
+// computes them with an atomic read-modify-write of the site being
+// updated.
+vector<Expr> make_atomic_values(const string &func_name,
+                                const vector<Expr> &site,
+                                const vector<Expr> &values,
+                                const StageSchedule &stage_s) {
+    user_assert(values.size() == 1)
+        << "Can't make the update of the Tuple-valued Func " << func_name << " atomic.\n";
+    for (const Dim &d : stage_s.dims()) {
+        user_assert(d.for_type != ForType::Vectorized)
+            << "Can't vectorize the atomic update of " << func_name << " over " << d.var << ".\n";
+    }
+
+    const AssociativeOp &prover_result = prove_associativity(func_name, site, values);
+    user_assert(prover_result.associative() && prover_result.commutative())
+        << "Can't make the update of " << func_name << " atomic, since it can't prove "
+        << "that the update is an associative and commutative operator: "
+        << values[0] << "\n";
+
+    return {Call::make(values[0].type(), Call::atomic_update, values, Call::Intrinsic)};
+}
+
 // Build a loop nest about a provide node using a schedule
 Stmt build_provide_loop_nest_helper(string func_name,
                                     string prefix,
@@ -87,7 +111,23 @@ Stmt build_provide_loop_nest_helper(string func_name,
     // then wrapping it in for loops.
 
     // Make the (multi-dimensional multi-valued) store node.
-    Stmt stmt = Provide::make(func_name, values, site);
+    Stmt stmt;
+    if (stage_s.atomic()) {
+        stmt = Provide::make(func_name, make_atomic_values(func_name, site, values, stage_s), site);
+    } else if (func_s.nontemporal()) {
+        user_assert(!is_update)
+            << "Func " << func_name << " is stored with non-temporal stores, "
+            << "so it can't have update definitions.\n";
+        // Codegen makes stores of these values non-temporal.
+        vector<Expr> nontemporal_values;
+        for (const Expr &v : values) {
+            nontemporal_values.push_back(
+                Call::make(v.type(), Call::nontemporal_store, {v}, Call::Intrinsic));
+        }
+        stmt = Provide::make(func_name, nontemporal_values, site);
+    } else {
+        stmt = Provide::make(func_name, values, site);
+    }
 
     // A map of the dimensions for which we know the extent is a
     // multiple of some Expr. This can happen due to a bound, or
@@ -111,6 +151,14 @@ Stmt build_provide_loop_nest_helper(string func_name,
 
     vector<Split> splits = stage_s.splits();
 
+    // The conditions of any skip_unless directives, which are written
+    // in terms of the pure vars. They get rewritten in terms of the
+    // loop variables along with the stmt.
+    vector<Expr> skip_conditions;
+    for (const SkipDirective &skip : stage_s.skips()) {
+        skip_conditions.push_back(qualify(prefix, skip.condition));
+    }
+
     // Define the function args in terms of the loop variables using the splits
     for (const Split &split : splits) {
         vector<ApplySplitResult> splits_result = apply_split(split, is_update, prefix, dim_extent_alignment);
@@ -118,8 +166,14 @@ Stmt build_provide_loop_nest_helper(string func_name,
         for (const auto &res : splits_result) {
             if (res.is_substitution()) {
                 stmt = substitute(res.name, res.value, stmt);
+                for (Expr &c : skip_conditions) {
+                    c = substitute(res.name, res.value, c);
+                }
             } else if (res.is_let()) {
                 stmt = LetStmt::make(res.name, res.value, stmt);
+                for (Expr &c : skip_conditions) {
+                    c = substitute(res.name, res.value, c);
+                }
             } else {
                 internal_assert(res.is_predicate());
                 stmt = IfThenElse::make(res.value, stmt, Stmt());
@@ -258,6 +312,39 @@ Stmt build_provide_loop_nest_helper(string func_name,
         }
     }
 
+    // Put the skip conditions just inside their loops, where they
+    // guard everything computed in an iteration. Each one is evaluated
+    // at the first point of the iteration, so the loops inside it are
+    // replaced by their mins.
+    for (size_t i = 0; i < skip_conditions.size(); i++) {
+        const SkipDirective &skip = stage_s.skips()[i];
+        int dim_idx = -1;
+        for (size_t j = 0; j < stage_s.dims().size(); j++) {
+            if (var_name_match(stage_s.dims()[j].var, skip.var)) {
+                dim_idx = (int)j;
+                break;
+            }
+        }
+        user_assert(dim_idx >= 0)
+            << "In schedule for " << func_name << ", can't skip iterations of "
+            << skip.var << " because it is not one of the loops of this stage.\n";
+        user_assert(stage_s.dims()[dim_idx].for_type != ForType::Vectorized)
+            << "In schedule for " << func_name << ", can't skip iterations of "
+            << skip.var << " because it is vectorized.\n";
+        Expr cond = skip_conditions[i];
+        for (int j = 0; j < dim_idx; j++) {
+            string inner = prefix + stage_s.dims()[j].var;
+            cond = substitute(inner, Variable::make(Int(32), inner + ".loop_min"), cond);
+        }
+        for (size_t j = 0; j < nest.size(); j++) {
+            if (nest[j].type == Container::For && nest[j].dim_idx == dim_idx) {
+                Container c = {Container::If, 0, "", cond};
+                nest.insert(nest.begin() + j + 1, c);
+                break;
+            }
+        }
+    }
+
     // Rewrap the statement in the containing lets and fors.
     for (int i = (int)nest.size() - 1; i >= 0; i--) {
         if (nest[i].type == Container::Let) {
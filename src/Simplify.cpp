@@ -1,5 +1,7 @@
 #include <iostream>
 #include <algorithm>
+#include <atomic>
+#include <mutex>
 #include <cmath>
 #include <limits>
 #include <stdio.h>
@@ -5898,15 +5900,112 @@ private:
     }
 };
 
+namespace {
+std::atomic<int64_t> simplify_calls(0);
+std::atomic<int64_t> simplify_memo_hits(0);
+
+// Results of simplification, for each value of remove_dead_lets.
+struct SimplifyMemo {
+    std::mutex mutex;
+    std::atomic<int> users;
+    IRCompareCache cache;
+    std::map<ExprWithCompareCache, Expr> results[2];
+
+    SimplifyMemo() : users(0), cache(8) {}
+};
+
+SimplifyMemo &simplify_memo() {
+    static SimplifyMemo memo;
+    return memo;
+}
+
+// Beyond this many entries the table is started again.
+const size_t simplify_memo_max_size = 1 << 16;
+
+// The poison values made by constant folding are each unique, so that
+// they can't cancel. Results containing them must not be reused.
+class ContainsPoison : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    void visit(const Call *op) override {
+        if (op->is_intrinsic(Call::signed_integer_overflow) ||
+            op->is_intrinsic(Call::indeterminate_expression)) {
+            result = true;
+        } else {
+            IRGraphVisitor::visit(op);
+        }
+    }
+
+public:
+    bool result = false;
+};
+
+}  // namespace
+
+int64_t simplify_call_count() {
+    return simplify_calls;
+}
+
+int64_t simplify_memo_hit_count() {
+    return simplify_memo_hits;
+}
+
+SimplifyMemoization::SimplifyMemoization() {
+    simplify_memo().users++;
+}
+
+SimplifyMemoization::~SimplifyMemoization() {
+    SimplifyMemo &memo = simplify_memo();
+    std::lock_guard<std::mutex> lock(memo.mutex);
+    if (--memo.users == 0) {
+        memo.results[0].clear();
+        memo.results[1].clear();
+        memo.cache.clear();
+    }
+}
+
 Expr simplify(Expr e, bool remove_dead_lets,
               const Scope<Interval> &bounds,
               const Scope<ModulusRemainder> &alignment) {
-    return Simplify(remove_dead_lets, &bounds, &alignment).mutate(e);
+    simplify_calls++;
+
+    // Without outside information, the result depends only on the Expr.
+    SimplifyMemo &memo = simplify_memo();
+    bool memoize = (memo.users > 0 && e.defined() &&
+                    &bounds == &Scope<Interval>::empty_scope() &&
+                    &alignment == &Scope<ModulusRemainder>::empty_scope());
+    if (memoize) {
+        std::lock_guard<std::mutex> lock(memo.mutex);
+        auto &results = memo.results[remove_dead_lets];
+        auto it = results.find(ExprWithCompareCache(e, &memo.cache));
+        if (it != results.end()) {
+            simplify_memo_hits++;
+            return it->second;
+        }
+    }
+
+    Expr result = Simplify(remove_dead_lets, &bounds, &alignment).mutate(e);
+
+    if (memoize) {
+        ContainsPoison poison;
+        result.accept(&poison);
+        if (!poison.result) {
+            std::lock_guard<std::mutex> lock(memo.mutex);
+            auto &results = memo.results[remove_dead_lets];
+            if (results.size() >= simplify_memo_max_size) {
+                results.clear();
+                memo.cache.clear();
+            }
+            results.emplace(ExprWithCompareCache(e, &memo.cache), result);
+        }
+    }
+    return result;
 }
 
 Stmt simplify(Stmt s, bool remove_dead_lets,
               const Scope<Interval> &bounds,
               const Scope<ModulusRemainder> &alignment) {
+    simplify_calls++;
     return Simplify(remove_dead_lets, &bounds, &alignment).mutate(s);
 }
 
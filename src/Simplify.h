@@ -29,6 +29,29 @@ Expr simplify(Expr, bool remove_dead_lets = true,
               const Scope<ModulusRemainder> &alignment = Scope<ModulusRemainder>::empty_scope());
 // @}
 
+/** The number of times either form of simplify has been called in
+ * this process. Used to profile lowering. */
+int64_t simplify_call_count();
+
+/** The number of times simplify has reused the result remembered by
+ * a SimplifyMemoization instead of simplifying again. */
+int64_t simplify_memo_hit_count();
+
+/** While an object of this type exists, results of simplifying an
+ * Expr with no bounds or alignment information are remembered, and
+ * reused when an equal Expr is simplified again. The table is shared
+ * by all threads, and is cleared when the last such object is
+ * destroyed. Used by lower() for targets with the memoize_simplify
+ * feature. */
+class SimplifyMemoization {
+    SimplifyMemoization(const SimplifyMemoization &) = delete;
+    SimplifyMemoization &operator=(const SimplifyMemoization &) = delete;
+
+public:
+    SimplifyMemoization();
+    ~SimplifyMemoization();
+};
+
 /** A common use of the simplifier is to prove boolean expressions are
  * true at compile time. Equivalent to is_one(simplify(e)) */
 bool can_prove(Expr e);
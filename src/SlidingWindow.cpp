@@ -8,12 +8,15 @@
 #include "Simplify.h"
 #include "Monotonic.h"
 #include "Bounds.h"
+#include "Util.h"
+#include "PerTaskStorage.h"
 
 namespace Halide {
 namespace Internal {
 
 using std::string;
 using std::map;
+using std::set;
 
 namespace {
 
@@ -363,6 +366,10 @@ public:
 // Perform sliding window optimization for all functions
 class SlidingWindow : public IRMutator2 {
     const map<string, Function> &env;
+    // Whether realizations may be moved into parallel loops.
+    bool per_task_storage;
+    // Realizations already moved into a parallel loop and slid.
+    set<string> slid_in_parallel_loop;
 
     using IRMutator2::visit;
 
@@ -372,7 +379,7 @@ class SlidingWindow : public IRMutator2 {
 
         // If it's not in the environment it's some anonymous
         // realization that we should skip (e.g. an inlined reduction)
-        if (iter == env.end()) {
+        if (iter == env.end() || slid_in_parallel_loop.count(op->name)) {
             return IRMutator2::visit(op);
         }
 
@@ -389,6 +396,25 @@ class SlidingWindow : public IRMutator2 {
 
         new_body = SlidingWindowOnFunction(iter->second).mutate(new_body);
 
+        // A Func stored outside a parallel loop that it is computed at
+        // can't slide across it, but it can slide within the strip of
+        // the loop run by each thread, given storage per strip.
+        if (new_body.same_as(op->body) && per_task_storage) {
+            Function func = iter->second;
+            Stmt sunk = sink_realize_into_parallel_loop(op, op->body, [&](const Realize *r) -> Stmt {
+                Stmt slid = SlidingWindowOnFunction(func).mutate(r->body);
+                if (slid.same_as(r->body)) {
+                    return Stmt();
+                }
+                return Realize::make(r->name, r->types, r->memory_type, r->bounds, r->condition, slid);
+            });
+            if (sunk.defined()) {
+                debug(3) << "Sliding " << op->name << " within each task of a parallel loop\n";
+                slid_in_parallel_loop.insert(op->name);
+                return mutate(sunk);
+            }
+        }
+
         new_body = mutate(new_body);
 
         if (new_body.same_as(op->body)) {
@@ -399,12 +425,12 @@ class SlidingWindow : public IRMutator2 {
         }
     }
 public:
-    SlidingWindow(const map<string, Function> &e) : env(e) {}
+    SlidingWindow(const map<string, Function> &e, bool p) : env(e), per_task_storage(p) {}
 
 };
 
-Stmt sliding_window(Stmt s, const map<string, Function> &env) {
-    return SlidingWindow(env).mutate(s);
+Stmt sliding_window(Stmt s, const map<string, Function> &env, const Target &t) {
+    return SlidingWindow(env, t.has_feature(Target::PerTaskStorage)).mutate(s);
 }
 
 }
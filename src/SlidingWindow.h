@@ -10,15 +10,19 @@
 #include <map>
 
 #include "IR.h"
+#include "Target.h"
 
 namespace Halide {
 namespace Internal {
 
 /** Perform sliding window optimizations on a halide
  * statement. I.e. don't bother computing points in a function that
- * have provably already been computed by a previous iteration.
+ * have provably already been computed by a previous iteration. With
+ * the PerTaskStorage target feature, a Func stored outside a parallel
+ * loop but computed inside it gets storage per task (or per strip of
+ * the loop, one per thread), within which it can slide.
  */
-Stmt sliding_window(Stmt s, const std::map<std::string, Function> &env);
+Stmt sliding_window(Stmt s, const std::map<std::string, Function> &env, const Target &t);
 
 }
 }
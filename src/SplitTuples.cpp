@@ -56,9 +56,18 @@ class SplitTuples : public IRMutator2 {
 
     map<string, set<int>> func_value_indices;
 
+    // The elements of a Tuple-valued Func scheduled with
+    // store_tuple_interleaved are stored in a single realization with an
+    // extra innermost dimension that indexes the Tuple element.
     Stmt visit(const Realize *op) override {
         ScopedBinding<int> bind(realizations, op->name, 0);
-        if (op->types.size() > 1) {
+        if (op->types.size() > 1 && can_interleave.count(op->name)) {
+            ScopedBinding<> bind_interleaved(interleaved, op->name);
+            Stmt body = mutate(op->body);
+            Region bounds = op->bounds;
+            bounds.insert(bounds.begin(), Range(0, (int)op->types.size()));
+            return Realize::make(op->name, {op->types[0]}, op->memory_type, bounds, op->condition, body);
+        } else if (op->types.size() > 1) {
             // Make a nested set of realize nodes for each tuple element
             Stmt body = mutate(op->body);
             for (int i = (int)op->types.size() - 1; i >= 0; i--) {
@@ -84,7 +93,11 @@ class SplitTuples : public IRMutator2 {
 
     Stmt visit(const Prefetch *op) override {
         Stmt stmt;
-        if (!op->param.defined() && (op->types.size() > 1)) {
+        if (!op->param.defined() && (op->types.size() > 1) && interleaved.contains(op->name)) {
+            Region bounds = op->bounds;
+            bounds.insert(bounds.begin(), Range(0, (int)op->types.size()));
+            stmt = Prefetch::make(op->name, {op->types[0]}, bounds);
+        } else if (!op->param.defined() && (op->types.size() > 1)) {
             // Split the prefetch from a multi-dimensional halide tuple to
             // prefetches of each tuple element. Keep only prefetches of
             // elements that are actually used in the loop body.
@@ -110,10 +123,12 @@ class SplitTuples : public IRMutator2 {
             internal_assert(it != env.end());
             Function f = it->second;
             string name = op->name;
-            if (f.outputs() > 1) {
+            vector<Expr> args;
+            if (f.outputs() > 1 && interleaved.contains(op->name)) {
+                args.push_back(op->value_index);
+            } else if (f.outputs() > 1) {
                 name += "." + std::to_string(op->value_index);
             }
-            vector<Expr> args;
             for (Expr e : op->args) {
                 args.push_back(mutate(e));
             }
@@ -176,7 +191,13 @@ class SplitTuples : public IRMutator2 {
                 lets.push_back({ var_name, val });
                 val = Variable::make(val.type(), var_name);
             }
-            provides.push_back(Provide::make(name, {val}, args));
+            if (interleaved.contains(op->name)) {
+                vector<Expr> element_args = args;
+                element_args.insert(element_args.begin(), (int)i);
+                provides.push_back(Provide::make(op->name, {val}, element_args));
+            } else {
+                provides.push_back(Provide::make(name, {val}, args));
+            }
         }
 
         Stmt result = Block::make(provides);
@@ -192,10 +213,32 @@ class SplitTuples : public IRMutator2 {
 
     const map<string, Function> &env;
     Scope<int> realizations;
+    Scope<> interleaved;
+    set<string> can_interleave;
 
 public:
 
-    SplitTuples(const map<string, Function> &e) : env(e) {}
+    SplitTuples(const map<string, Function> &e) : env(e) {
+        // Memoization, debug_to_file, and extern stages all expect a
+        // buffer per Tuple element.
+        for (const auto &it : env) {
+            const Function &f = it.second;
+            if (f.outputs() > 1 &&
+                f.schedule().interleave_tuple() &&
+                !f.schedule().memoized() &&
+                f.debug_file().empty() &&
+                !f.has_extern_definition()) {
+                can_interleave.insert(f.name());
+            }
+        }
+        for (const auto &it : env) {
+            for (const ExternFuncArgument &arg : it.second.extern_arguments()) {
+                if (arg.is_func()) {
+                    can_interleave.erase(Function(arg.func).name());
+                }
+            }
+        }
+    }
 };
 
 }
@@ -6,8 +6,10 @@
 #include <iterator>
 #include <iostream>
 #include <fstream>
+#include <map>
 #include <sstream>
 #include <stdio.h>
+#include <stdlib.h>
 
 namespace Halide {
 namespace Internal {
@@ -22,6 +24,194 @@ std::string to_string(T value) {
     return os.str() ;
 }
 
+// The parts of a profiler report (see HL_PROFILER_JSON_FILE) used to
+// annotate the html.
+struct FuncProfile {
+    double time_ns = 0, average_threads = 0;
+    double heap_allocations = 0, memory_total = 0, memory_peak = 0;
+};
+
+struct PipelineProfile {
+    double time_ns = 0, runs = 0;
+    std::map<string, FuncProfile> funcs;
+};
+
+// Just enough of a JSON parser to read a profiler report.
+class ProfileParser {
+    const string &text;
+    size_t pos = 0;
+
+    void skip_space() {
+        while (pos < text.size() && isspace((unsigned char)text[pos])) {
+            pos++;
+        }
+    }
+
+    void expect(char c) {
+        skip_space();
+        user_assert(pos < text.size() && text[pos] == c)
+            << "Malformed profiler report: expected '" << c << "' at offset " << pos << "\n";
+        pos++;
+    }
+
+    bool next_is(char c) {
+        skip_space();
+        return pos < text.size() && text[pos] == c;
+    }
+
+    string parse_string() {
+        expect('"');
+        string result;
+        while (pos < text.size() && text[pos] != '"') {
+            if (text[pos] == '\\' && pos + 1 < text.size()) {
+                pos++;
+                if (text[pos] == 'u') {
+                    // Non-ascii characters never appear in Func names.
+                    result += '?';
+                    pos += 4;
+                } else {
+                    result += text[pos] == 'n' ? '\n' : text[pos] == 't' ? '\t' : text[pos];
+                }
+            } else {
+                result += text[pos];
+            }
+            pos++;
+        }
+        expect('"');
+        return result;
+    }
+
+    double parse_number() {
+        skip_space();
+        const char *start = text.c_str() + pos;
+        char *end = nullptr;
+        double result = strtod(start, &end);
+        user_assert(end != start) << "Malformed profiler report: expected a number at offset " << pos << "\n";
+        pos += end - start;
+        return result;
+    }
+
+    bool parse_literal(const char *lit) {
+        skip_space();
+        size_t len = strlen(lit);
+        if (text.compare(pos, len, lit) == 0) {
+            pos += len;
+            return true;
+        }
+        return false;
+    }
+
+    // Parse an object, calling field for each key.
+    template<typename F>
+    void parse_object(F field) {
+        expect('{');
+        if (next_is('}')) {
+            pos++;
+            return;
+        }
+        do {
+            string key = parse_string();
+            expect(':');
+            field(key);
+        } while (next_is(',') && ++pos);
+        expect('}');
+    }
+
+    template<typename F>
+    void parse_array(F item) {
+        expect('[');
+        if (next_is(']')) {
+            pos++;
+            return;
+        }
+        do {
+            item();
+        } while (next_is(',') && ++pos);
+        expect(']');
+    }
+
+    void skip_value() {
+        if (next_is('{')) {
+            parse_object([&](const string &) { skip_value(); });
+        } else if (next_is('[')) {
+            parse_array([&]() { skip_value(); });
+        } else if (next_is('"')) {
+            parse_string();
+        } else if (!parse_literal("true") && !parse_literal("false") && !parse_literal("null")) {
+            parse_number();
+        }
+    }
+
+    FuncProfile parse_func(string *name) {
+        FuncProfile f;
+        parse_object([&](const string &key) {
+            if (key == "name") {
+                *name = parse_string();
+            } else if (key == "time_ns") {
+                f.time_ns = parse_number();
+            } else if (key == "average_threads") {
+                f.average_threads = parse_number();
+            } else if (key == "heap_allocations") {
+                f.heap_allocations = parse_number();
+            } else if (key == "memory_total") {
+                f.memory_total = parse_number();
+            } else if (key == "memory_peak") {
+                f.memory_peak = parse_number();
+            } else {
+                skip_value();
+            }
+        });
+        return f;
+    }
+
+public:
+    ProfileParser(const string &text) : text(text) {}
+
+    std::map<string, PipelineProfile> parse() {
+        std::map<string, PipelineProfile> result;
+        parse_object([&](const string &key) {
+            if (key != "pipelines") {
+                skip_value();
+                return;
+            }
+            parse_array([&]() {
+                string name;
+                PipelineProfile p;
+                parse_object([&](const string &key) {
+                    if (key == "name") {
+                        name = parse_string();
+                    } else if (key == "time_ns") {
+                        p.time_ns = parse_number();
+                    } else if (key == "runs") {
+                        p.runs = parse_number();
+                    } else if (key == "funcs") {
+                        parse_array([&]() {
+                            string func_name;
+                            FuncProfile f = parse_func(&func_name);
+                            p.funcs[func_name] = f;
+                        });
+                    } else {
+                        skip_value();
+                    }
+                });
+                result[name] = p;
+            });
+        });
+        return result;
+    }
+};
+
+std::map<string, PipelineProfile> load_profile(const string &filename) {
+    std::ifstream in(filename.c_str());
+    user_assert(in) << "Could not open profiler report " << filename << "\n";
+    std::stringstream text;
+    text << in.rdbuf();
+    string str = text.str();
+    return ProfileParser(str).parse();
+}
+
+const int num_heat_levels = 10;
+
 class StmtToHtml : public IRVisitor {
 
     static const std::string css, js;
@@ -92,6 +282,44 @@ private:
     string type(const string &x) { return span("Type", x); }
     string symbol(const string &x) { return span("Symbol", x); }
 
+    // The measured times of the Funcs of the pipeline being printed,
+    // if we were given a profiler report.
+    std::map<string, PipelineProfile> profiles;
+    const PipelineProfile *profile = nullptr;
+
+    const FuncProfile *func_profile(const string &name) {
+        if (!profile) {
+            return nullptr;
+        }
+        auto it = profile->funcs.find(name);
+        return it == profile->funcs.end() ? nullptr : &it->second;
+    }
+
+    // How hot a Func is, as a fraction of the pipeline's time, bucketed.
+    int heat(const FuncProfile &f) {
+        if (profile->time_ns <= 0) {
+            return 0;
+        }
+        int h = (int)(num_heat_levels * f.time_ns / profile->time_ns);
+        return std::max(0, std::min(h, num_heat_levels - 1));
+    }
+
+    string profile_annotation(const FuncProfile &f) {
+        double runs = std::max(profile->runs, 1.0);
+        std::ostringstream s;
+        s.precision(3);
+        s << "// " << f.time_ns / runs / 1e6 << " ms/run";
+        if (profile->time_ns > 0) {
+            s << " (" << 100 * f.time_ns / profile->time_ns << "%)";
+        }
+        s << ", " << f.average_threads << " threads";
+        if (f.heap_allocations > 0) {
+            s << ", " << f.heap_allocations / runs << " allocations/run, "
+              << f.memory_total / runs << " bytes/run, peak " << f.memory_peak << " bytes";
+        }
+        return span("Comment", s.str());
+    }
+
     Scope<int> scope;
     string var(const string &x) {
         int id;
@@ -326,7 +554,12 @@ private:
     }
     void visit(const ProducerConsumer *op) {
         scope.push(op->name, unique_id());
-        stream << open_div(op->is_producer ? "Produce" : "Consumer");
+        const FuncProfile *f = op->is_producer ? func_profile(op->name) : nullptr;
+        string cls = op->is_producer ? "Produce" : "Consumer";
+        if (f) {
+            cls += " Heat" + std::to_string(heat(*f));
+        }
+        stream << open_div(cls);
         int produce_id = unique_id();
         stream << open_span("Matched");
         stream << open_expand_button(produce_id);
@@ -334,6 +567,9 @@ private:
         stream << var(op->name);
         stream << close_expand_button() << " {";
         stream << close_span();;
+        if (f) {
+            stream << " " << profile_annotation(*f);
+        }
         stream << open_div(op->is_producer ? "ProduceBody Indent" : "ConsumeBody Indent", produce_id);
         print(op->body);
         stream << close_div();
@@ -343,7 +579,10 @@ private:
     }
     void visit(const For *op) {
         scope.push(op->name, unique_id());
-        stream << open_div("For");
+        // The profiler measures whole Funcs, so a loop is marked with
+        // the heat of the Func it belongs to.
+        const FuncProfile *f = func_profile(op->name.substr(0, op->name.find('.')));
+        stream << open_div(f ? "For LoopHeat" + std::to_string(heat(*f)) : "For");
 
         int id = unique_id();
         stream << open_expand_button(id);
@@ -602,6 +841,8 @@ public:
 
     void print(const LoweredFunc &op) {
         scope.push(op.name, unique_id());
+        auto it = profiles.find(op.name);
+        profile = it == profiles.end() ? nullptr : &it->second;
         stream << open_div("Function");
 
         int id = unique_id();
@@ -626,6 +867,7 @@ public:
 
         stream << close_div();
         scope.pop(op.name);
+        profile = nullptr;
     }
 
     void print(const Buffer<> &op) {
@@ -664,10 +906,20 @@ public:
         scope.pop(m.name());
     }
 
-    StmtToHtml(string filename) : id_count(0), context_stack(1, 0) {
+    StmtToHtml(string filename, const string &profile_filename = "") : id_count(0), context_stack(1, 0) {
+        if (!profile_filename.empty()) {
+            profiles = load_profile(profile_filename);
+        }
         stream.open(filename.c_str());
         stream << "<head>";
-        stream << "<style type='text/css'>" << css << "</style>\n";
+        stream << "<style type='text/css'>" << css;
+        // Heat colors for profiled Funcs, from white to red.
+        for (int i = 0; i < num_heat_levels; i++) {
+            int lightness = 100 - 4 * i;
+            stream << "div.Heat" << i << " { background-color: hsl(0, 100%, " << lightness << "%); }\n";
+            stream << "div.LoopHeat" << i << " { border-left: 2px solid hsl(0, 100%, " << lightness - 10 << "%); }\n";
+        }
+        stream << "</style>\n";
         stream << "<script language='javascript' type='text/javascript'>" + js + "</script>\n";
         stream <<"<link rel='stylesheet' type='text/css' href='my.css'>\n";
         stream << "<script language='javascript' type='text/javascript' src='my.js'></script>\n";
@@ -730,8 +982,8 @@ void print_to_html(string filename, Stmt s) {
     sth.print(s);
 }
 
-void print_to_html(string filename, const Module &m) {
-    StmtToHtml sth(filename);
+void print_to_html(string filename, const Module &m, const string &profile_filename) {
+    StmtToHtml sth(filename, profile_filename);
     sth.print(m);
 }
 
@@ -15,8 +15,14 @@ namespace Internal {
  */
 void print_to_html(std::string filename, Stmt s);
 
-/** Dump an HTML-formatted print of a Module to filename. */
-void print_to_html(std::string filename, const Module &m);
+/** Dump an HTML-formatted print of a Module to filename. If
+ * profile_filename names a JSON profiler report (as written to
+ * HL_PROFILER_JSON_FILE by a pipeline compiled with the profile
+ * feature), each produce node is annotated with the time, threads and
+ * heap memory measured for that Func, and colored by how much of the
+ * pipeline's time it took. */
+void print_to_html(std::string filename, const Module &m,
+                   const std::string &profile_filename = "");
 
 }}
 
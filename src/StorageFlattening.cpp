@@ -6,6 +6,7 @@
 #include "IROperator.h"
 #include "Parameter.h"
 #include "Scope.h"
+#include "Simplify.h"
 
 #include <sstream>
 
@@ -25,8 +26,10 @@ class FlattenDimensions : public IRMutator2 {
 public:
     FlattenDimensions(const map<string, pair<Function, int>> &e,
                       const vector<Function> &o,
-                      const Target &t)
-        : env(e), target(t) {
+                      const set<string> &tileable,
+                      const Target &t,
+                      bool pad_row_strides)
+        : env(e), tileable(tileable), target(t), pad_row_strides(pad_row_strides) {
         for (auto &f : o) {
             outputs.insert(f.name());
         }
@@ -34,11 +37,57 @@ public:
     Scope<> scope;
 private:
     const map<string, pair<Function, int>> &env;
+    const set<string> &tileable;
     set<string> outputs;
     const Target &target;
+    const bool pad_row_strides;
     Scope<> realizations, shader_scope_realizations;
     bool in_shader = false;
 
+    // A Tuple-valued Function realized under its own name, rather than
+    // one realization per element, has its elements interleaved.
+    bool is_interleaved_tuple(const string &name) const {
+        auto iter = env.find(name);
+        return (iter != env.end() &&
+                iter->second.first.outputs() > 1 &&
+                iter->second.first.name() == name);
+    }
+
+    // A realization stored in tiles (see Func::store_tiled): the indices of
+    // the two tiled dimensions of the realization, and the tile sizes.
+    struct Tiling {
+        int x, y, tx, ty;
+    };
+
+    bool get_tiling(const string &name, Tiling *tiling) const {
+        auto iter = env.find(name);
+        if (iter == env.end()) {
+            return false;
+        }
+        const Function &f = iter->second.first;
+        const vector<StorageDim> &storage_dims = f.schedule().storage_dims();
+        if (!tileable.count(f.name()) || storage_dims.size() < 2 ||
+            !storage_dims[0].tile_factor.defined() ||
+            !storage_dims[1].tile_factor.defined()) {
+            return false;
+        }
+        const int offset = is_interleaved_tuple(name) ? 1 : 0;
+        const vector<string> &args = f.args();
+        for (size_t j = 0; j < args.size(); j++) {
+            if (args[j] == storage_dims[0].var) {
+                tiling->x = (int)j + offset;
+            } else if (args[j] == storage_dims[1].var) {
+                tiling->y = (int)j + offset;
+            }
+        }
+        const int64_t *tx = as_const_int(storage_dims[0].tile_factor);
+        const int64_t *ty = as_const_int(storage_dims[1].tile_factor);
+        internal_assert(tx && ty);
+        tiling->tx = (int)*tx;
+        tiling->ty = (int)*ty;
+        return true;
+    }
+
     Expr make_shape_var(string name, string field, size_t dim,
                         const Buffer<> &buf, const Parameter &param) {
         ReductionDomain rdom;
@@ -65,10 +114,30 @@ private:
 
         Expr zero = target.has_large_buffers() ? make_zero(Int(64)) : 0;
 
+        // In a tiled realization, the tiled dimensions are split into
+        // the coordinate within the tile and the index of the tile:
+        // f(x, y) -> f[xi*xstride + yi*tx*xstride + xo*tx*ty*xstride + yo*ty*ystride]
+        Tiling tiling;
+        bool tiled = internal && get_tiling(name, &tiling);
+        if (tiled) {
+            Expr x = args[tiling.x] - mins[tiling.x];
+            Expr y = args[tiling.y] - mins[tiling.y];
+            if (target.has_large_buffers()) {
+                x = cast<int64_t>(x);
+                y = cast<int64_t>(y);
+            }
+            Expr sx = strides[tiling.x], sy = strides[tiling.y];
+            idx += (x % tiling.tx + (y % tiling.ty) * tiling.tx + (x / tiling.tx) * (tiling.tx * tiling.ty)) * sx +
+                (y / tiling.ty) * tiling.ty * sy;
+        }
+
         // We peel off constant offsets so that multiple stencil
         // taps can share the same base address.
         Expr constant_term = zero;
         for (size_t i = 0; i < args.size(); i++) {
+            if (tiled && ((int)i == tiling.x || (int)i == tiling.y)) {
+                continue;
+            }
             const Add *add = args[i].as<Add>();
             if (add && is_const(add->b)) {
                 constant_term += strides[i] * add->b;
@@ -81,6 +150,9 @@ private:
             // strategy makes sense when we expect x to cancel with
             // something in xmin.  We use this for internal allocations.
             for (size_t i = 0; i < args.size(); i++) {
+                if (tiled && ((int)i == tiling.x || (int)i == tiling.y)) {
+                    continue;
+                }
                 idx += (args[i] - mins[i]) * strides[i];
             }
         } else {
@@ -135,30 +207,67 @@ private:
         // also affects the device allocation in some backends).
         vector<Expr> allocation_extents(extents.size());
         vector<int> storage_permutation;
+        bool innermost_aligned = false;
+        bool layout_is_free = false;
         {
             auto iter = env.find(op->name);
             internal_assert(iter != env.end()) << "Realize node refers to function not in environment.\n";
             Function f = iter->second.first;
+            // An interleaved Tuple has an extra innermost dimension for
+            // the Tuple element (see SplitTuples).
+            const int offset = is_interleaved_tuple(op->name) ? 1 : 0;
+            if (offset) {
+                storage_permutation.push_back(0);
+                allocation_extents[0] = extents[0];
+            }
             const vector<StorageDim> &storage_dims = f.schedule().storage_dims();
+            innermost_aligned = !storage_dims.empty() && storage_dims[0].alignment.defined();
+            layout_is_free = !offset && tileable.count(f.name());
             const vector<string> &args = f.args();
             for (size_t i = 0; i < storage_dims.size(); i++) {
                 for (size_t j = 0; j < args.size(); j++) {
                     if (args[j] == storage_dims[i].var) {
-                        storage_permutation.push_back((int)j);
+                        storage_permutation.push_back((int)j + offset);
                         Expr alignment = storage_dims[i].alignment;
                         if (alignment.defined()) {
-                            allocation_extents[j] = ((extents[j] + alignment - 1)/alignment)*alignment;
+                            allocation_extents[j + offset] = ((extents[j + offset] + alignment - 1)/alignment)*alignment;
                         } else {
-                            allocation_extents[j] = extents[j];
+                            allocation_extents[j + offset] = extents[j + offset];
                         }
                     }
                 }
-                internal_assert(storage_permutation.size() == i+1);
+                internal_assert(storage_permutation.size() == i + offset + 1);
             }
         }
 
+        // Tiled dimensions are padded to a whole number of tiles.
+        Tiling tiling;
+        bool tiled = get_tiling(op->name, &tiling);
+        if (tiled) {
+            allocation_extents[tiling.x] = ((extents[tiling.x] + tiling.tx - 1) / tiling.tx) * tiling.tx;
+            allocation_extents[tiling.y] = ((extents[tiling.y] + tiling.ty - 1) / tiling.ty) * tiling.ty;
+        }
+
         internal_assert(storage_permutation.size() == op->bounds.size());
 
+        // Rows a multiple of 1024 bytes apart map to the same few cache
+        // sets, so walking down the columns of, say, a 1024-wide float
+        // image keeps evicting the same lines. Pad such rows apart by a
+        // cache line. Rows aligned with align_storage are left alone.
+        if (pad_row_strides && layout_is_free && !tiled && !innermost_aligned &&
+            !in_shader && op->bounds.size() > 1 &&
+            (op->memory_type == MemoryType::Auto ||
+             op->memory_type == MemoryType::Heap ||
+             op->memory_type == MemoryType::Stack)) {
+            const int innermost = storage_permutation[0];
+            const int bytes = op->types[0].bytes();
+            Expr extent = allocation_extents[innermost];
+            Expr row_bytes = extent * bytes;
+            allocation_extents[innermost] =
+                simplify(select(row_bytes >= 1024 && row_bytes % 1024 == 0,
+                                extent + std::max(64 / bytes, 1), extent));
+        }
+
         Stmt stmt = body;
         internal_assert(op->types.size() == 1);
 
@@ -185,7 +294,13 @@ private:
         builder.dimensions = dims;
         for (int i = 0; i < dims; i++) {
             builder.mins.push_back(min_var[i]);
-            builder.extents.push_back(extent_var[i]);
+            // The buffer of a tiled realization must span the padding of
+            // the last tiles, which it can't describe with strides alone.
+            if (tiled && (i == tiling.x || i == tiling.y)) {
+                builder.extents.push_back(allocation_extents[i]);
+            } else {
+                builder.extents.push_back(extent_var[i]);
+            }
             builder.strides.push_back(stride_var[i]);
         }
         stmt = LetStmt::make(op->name + ".buffer", builder.build(), stmt);
@@ -326,15 +441,19 @@ private:
             vector<int> storage_permutation;
             {
                 Function f = iter->second.first;
+                const int offset = is_interleaved_tuple(op->name) ? 1 : 0;
+                if (offset) {
+                    storage_permutation.push_back(0);
+                }
                 const vector<StorageDim> &storage_dims = f.schedule().storage_dims();
                 const vector<string> &args = f.args();
                 for (size_t i = 0; i < storage_dims.size(); i++) {
                     for (size_t j = 0; j < args.size(); j++) {
                         if (args[j] == storage_dims[i].var) {
-                            storage_permutation.push_back((int)j);
+                            storage_permutation.push_back((int)j + offset);
                         }
                     }
-                    internal_assert(storage_permutation.size() == i+1);
+                    internal_assert(storage_permutation.size() == i + offset + 1);
                 }
             }
             internal_assert(storage_permutation.size() == op->bounds.size());
@@ -447,12 +566,33 @@ Stmt storage_flattening(Stmt s,
             for (int i = 0; i < p.second.outputs(); i++) {
                 tuple_env[p.first + "." + std::to_string(i)] = {p.second, i};
             }
+            // Interleaved Tuples are stored under the Function's name.
+            tuple_env[p.first] = {p.second, 0};
         } else {
             tuple_env[p.first] = {p.second, 0};
         }
     }
 
-    s = FlattenDimensions(tuple_env, outputs, target).mutate(s);
+    // Storage tiling is ignored for Funcs that need a strided layout.
+    set<string> tileable;
+    for (const auto &p : env) {
+        const Function &f = p.second;
+        if (!f.schedule().memoized() &&
+            f.debug_file().empty() &&
+            !f.has_extern_definition()) {
+            tileable.insert(f.name());
+        }
+    }
+    for (const auto &p : env) {
+        for (const ExternFuncArgument &arg : p.second.extern_arguments()) {
+            if (arg.is_func()) {
+                tileable.erase(Function(arg.func).name());
+            }
+        }
+    }
+
+    s = FlattenDimensions(tuple_env, outputs, tileable, target,
+                          target.has_feature(Target::PadStorageStrides)).mutate(s);
     s = PromoteToMemoryType().mutate(s);
     return s;
 }
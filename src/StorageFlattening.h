@@ -16,7 +16,11 @@ namespace Internal {
 
 /** Take a statement with multi-dimensional Realize, Provide, and Call
  * nodes, and turn it into a statement with single-dimensional
- * Allocate, Store, and Load nodes respectively. */
+ * Allocate, Store, and Load nodes respectively. With the
+ * PadStorageStrides target feature, rows of intermediate allocations
+ * that would be a multiple of 1024 bytes apart are padded apart by 64
+ * bytes, to avoid cache set conflicts when walking down their
+ * columns. */
 Stmt storage_flattening(Stmt s,
                         const std::vector<Function> &outputs,
                         const std::map<std::string, Function> &env,
@@ -9,6 +9,7 @@
 #include "Debug.h"
 #include "Monotonic.h"
 #include "ExprUsesVar.h"
+#include "PerTaskStorage.h"
 
 namespace Halide {
 namespace Internal {
@@ -58,6 +59,23 @@ class FoldStorageOfFunction : public IRMutator {
     Expr factor;
     string dynamic_footprint;
 
+    // If defined, every access in this loop iteration lies within
+    // [window_min, window_min + factor), and base holds window_min %
+    // factor. This lets us fold each coordinate using a compare and
+    // subtract instead of a modulo.
+    Expr base, window_min;
+
+    Expr fold_coordinate(Expr arg) {
+        if (is_one(factor)) {
+            return 0;
+        } else if (base.defined()) {
+            Expr t = base + simplify(arg - window_min);
+            return t - select(t < factor, 0, factor);
+        } else {
+            return arg % factor;
+        }
+    }
+
     using IRMutator::visit;
 
     void visit(const Call *op) {
@@ -67,7 +85,7 @@ class FoldStorageOfFunction : public IRMutator {
         if (op->name == func && op->call_type == Call::Halide) {
             vector<Expr> args = op->args;
             internal_assert(dim < (int)args.size());
-            args[dim] = is_one(factor) ? 0 : (args[dim] % factor);
+            args[dim] = fold_coordinate(args[dim]);
             expr = Call::make(op->type, op->name, args, op->call_type,
                               op->func, op->value_index, op->image, op->param);
         } else if (op->name == Call::buffer_crop) {
@@ -139,15 +157,15 @@ class FoldStorageOfFunction : public IRMutator {
         internal_assert(op);
         if (op->name == func) {
             vector<Expr> args = op->args;
-            args[dim] = is_one(factor) ? 0 : (args[dim] % factor);
+            args[dim] = fold_coordinate(args[dim]);
             stmt = Provide::make(op->name, op->values, args);
         }
     }
 
 
 public:
-    FoldStorageOfFunction(string f, int d, Expr e, string p) :
-        func(f), dim(d), factor(e), dynamic_footprint(p) {}
+    FoldStorageOfFunction(string f, int d, Expr e, string p, Expr b = Expr(), Expr m = Expr()) :
+        func(f), dim(d), factor(e), dynamic_footprint(p), base(b), window_min(m) {}
 };
 
 // Inject dynamic folding checks against a tracked live range.
@@ -439,7 +457,26 @@ class AttemptStorageFoldingOfFunction : public IRMutator {
 
                     Fold fold = {(int)i - 1, factor};
                     dims_folded.push_back(fold);
-                    body = FoldStorageOfFunction(func.name(), (int)i - 1, factor, dynamic_footprint).mutate(body);
+
+                    // Modulo by a factor that isn't a power of two is
+                    // expensive. If we know statically that the
+                    // footprint of each iteration fits in the fold,
+                    // compute the rotating offset of the footprint
+                    // once per iteration instead.
+                    Expr base, window_min;
+                    int bits;
+                    if (!is_const_power_of_two_integer(factor, &bits) &&
+                        dynamic_footprint.empty() &&
+                        can_prove(extent <= factor)) {
+                        string base_name = unique_name(func.name() + ".fold_base");
+                        base = Variable::make(Int(32), base_name);
+                        window_min = min;
+                        body = FoldStorageOfFunction(func.name(), (int)i - 1, factor, dynamic_footprint,
+                                                     base, window_min).mutate(body);
+                        body = LetStmt::make(base_name, min % factor, body);
+                    } else {
+                        body = FoldStorageOfFunction(func.name(), (int)i - 1, factor, dynamic_footprint).mutate(body);
+                    }
 
                     Expr next_var = Variable::make(Int(32), op->name) + 1;
                     Expr next_min = substitute(op->name, next_var, min);
@@ -504,28 +541,73 @@ public:
 // Look for opportunities for storage folding in a statement
 class StorageFolding : public IRMutator {
     const map<string, Function> &env;
+    // Whether realizations may be moved into parallel loops.
+    bool per_task_storage;
 
     using IRMutator::visit;
 
     void visit(const Realize *op) {
         Stmt body = mutate(op->body);
+        stmt = fold_realization(op, body, true);
+    }
+
+    // Attempt to fold a realization, the body of which has already
+    // been mutated.
+    Stmt fold_realization(const Realize *op, Stmt body, bool allow_sinking) {
+        Stmt result;
 
         // Get the function associated with this realization, which
         // contains the explicit fold directives from the schedule.
         auto func_it = env.find(op->name);
         Function func = func_it != env.end() ? func_it->second : Function();
 
+        // The producer of an async Func may run any number of iterations
+        // ahead of its consumer, so its storage can't be reused.
+        if (func_it != env.end() && func.schedule().async()) {
+            for (const StorageDim &d : func.schedule().storage_dims()) {
+                user_assert(!d.fold_factor.defined())
+                    << "Can't fold the storage of " << op->name
+                    << " because it is scheduled async()\n";
+            }
+            if (body.same_as(op->body)) {
+                result = op;
+            } else {
+                result = Realize::make(op->name, op->types, op->memory_type, op->bounds, op->condition, body);
+            }
+            return result;
+        }
+
         // Don't attempt automatic storage folding if there is
         // more than one produce node for this func.
         bool explicit_only = count_producers(body, op->name) != 1;
         AttemptStorageFoldingOfFunction folder(func, explicit_only);
         debug(3) << "Attempting to fold " << op->name << "\n";
+        Stmt unfolded_body = body;
         body = folder.mutate(body);
 
+        // A Func stored outside a parallel loop can't be folded across
+        // it, but it can be given storage per task, sized to the
+        // footprint of one iteration, and folded over the serial loops
+        // inside. Memory is then the number of threads times the fold,
+        // rather than the whole image.
+        if (folder.dims_folded.empty() &&
+            allow_sinking &&
+            per_task_storage &&
+            func_it != env.end() &&
+            !func.has_extern_definition() &&
+            func.schedule().bounds().empty()) {
+            Stmt sunk = sink_realize_into_parallel_loop(op, unfolded_body, [&](const Realize *r) {
+                return fold_realization(r, r->body, false);
+            });
+            if (sunk.defined()) {
+                return sunk;
+            }
+        }
+
         if (body.same_as(op->body)) {
-            stmt = op;
+            result = op;
         } else if (folder.dims_folded.empty()) {
-            stmt = Realize::make(op->name, op->types, op->memory_type, op->bounds, op->condition, body);
+            result = Realize::make(op->name, op->types, op->memory_type, op->bounds, op->condition, body);
         } else {
             Region bounds = op->bounds;
 
@@ -538,12 +620,13 @@ class StorageFolding : public IRMutator {
                 bounds[d] = Range(0, f);
             }
 
-            stmt = Realize::make(op->name, op->types, op->memory_type, bounds, op->condition, body);
+            result = Realize::make(op->name, op->types, op->memory_type, bounds, op->condition, body);
         }
+        return result;
     }
 
 public:
-    StorageFolding(const map<string, Function> &env) : env(env) {}
+    StorageFolding(const map<string, Function> &env, bool p) : env(env), per_task_storage(p) {}
 };
 
 // Because storage folding runs before simplification, it's useful to
@@ -580,9 +663,9 @@ class SubstituteInConstants : public IRMutator {
     }
 };
 
-Stmt storage_folding(Stmt s, const std::map<std::string, Function> &env) {
+Stmt storage_folding(Stmt s, const std::map<std::string, Function> &env, const Target &t) {
     s = SubstituteInConstants().mutate(s);
-    s = StorageFolding(env).mutate(s);
+    s = StorageFolding(env, t.has_feature(Target::PerTaskStorage)).mutate(s);
     return s;
 }
 
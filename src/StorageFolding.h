@@ -7,6 +7,7 @@
  */
 
 #include "IR.h"
+#include "Target.h"
 
 namespace Halide {
 namespace Internal {
@@ -22,9 +23,12 @@ namespace Internal {
  \endcode
  *
  * We can store f as a circular buffer of size two, instead of
- * allocating space for all of it.
+ * allocating space for all of it. With the PerTaskStorage target
+ * feature, a Func stored outside a parallel loop but computed inside
+ * it gets storage per task, which can be folded over the serial loops
+ * within the task.
  */
-Stmt storage_folding(Stmt s, const std::map<std::string, Function> &env);
+Stmt storage_folding(Stmt s, const std::map<std::string, Function> &env, const Target &t);
 
 }
 }
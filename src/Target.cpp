@@ -9,7 +9,7 @@
 #include "LLVM_Headers.h"
 #include "Util.h"
 
-#if defined(__powerpc__) && defined(__linux__)
+#if (defined(__powerpc__) || defined(__riscv)) && defined(__linux__)
 // This uses elf.h and must be included after "LLVM_Headers.h", which
 // uses llvm/support/Elf.h.
 #include <sys/auxv.h>
@@ -72,6 +72,18 @@ Target calculate_host_target() {
 #if __mips__ || __mips || __MIPS__
     Target::Arch arch = Target::MIPS;
 #else
+#if defined(__riscv)
+    Target::Arch arch = Target::RISCV;
+
+#ifdef __linux__
+    // Each single-letter extension has a bit in AT_HWCAP.
+    unsigned long hwcap = getauxval(AT_HWCAP);
+    bool have_v = (hwcap & (1UL << ('V' - 'A'))) != 0;
+    if (have_v) {
+        initial_features.push_back(Target::RISCV_V);
+    }
+#endif
+#else
 #if defined(__arm__) || defined(__aarch64__)
     Target::Arch arch = Target::ARM;
 #else
@@ -134,6 +146,8 @@ Target calculate_host_target() {
         const uint32_t avx512_knl = avx512 | avx512pf | avx512er;
         const uint32_t avx512_skylake = avx512 | avx512vl | avx512bw | avx512dq;
         const uint32_t avx512_cannonlake = avx512_skylake | avx512ifma; // Assume ifma => vbmi
+        // These are in ecx, vs ebx for the above
+        const uint32_t avx512vnni = 1U << 11;
         if ((info2[1] & avx2) == avx2) {
             initial_features.push_back(Target::AVX2);
         }
@@ -144,6 +158,18 @@ Target calculate_host_target() {
             }
             if ((info2[1] & avx512_skylake) == avx512_skylake) {
                 initial_features.push_back(Target::AVX512_Skylake);
+                if ((info2[2] & avx512vnni) == avx512vnni) {
+                    initial_features.push_back(Target::AVX512_VNNI);
+                    // BF16 is in eax of the next sub-leaf, if there is one
+                    if (info2[0] >= 1) {
+                        int info3[4];
+                        cpuid(info3, 7, 1);
+                        const uint32_t avx512bf16 = 1U << 5;
+                        if ((info3[0] & avx512bf16) == avx512bf16) {
+                            initial_features.push_back(Target::AVX512_BF16);
+                        }
+                    }
+                }
             }
             if ((info2[1] & avx512_cannonlake) == avx512_cannonlake) {
                 initial_features.push_back(Target::AVX512_Cannonlake);
@@ -158,6 +184,7 @@ Target calculate_host_target() {
 
 #endif
 #endif
+#endif
 #endif
 
     return Target(os, arch, bits, initial_features);
@@ -185,6 +212,7 @@ const std::map<std::string, Target::OS> os_name_map = {
     {"ios", Target::IOS},
     {"qurt", Target::QuRT},
     {"noos", Target::NoOS},
+    {"wasmrt", Target::WebAssemblyRuntime},
 };
 
 bool lookup_os(const std::string &tok, Target::OS &result) {
@@ -203,6 +231,8 @@ const std::map<std::string, Target::Arch> arch_name_map = {
     {"mips", Target::MIPS},
     {"powerpc", Target::POWERPC},
     {"hexagon", Target::Hexagon},
+    {"wasm", Target::WebAssembly},
+    {"riscv", Target::RISCV},
 };
 
 bool lookup_arch(const std::string &tok, Target::Arch &result) {
@@ -240,6 +270,7 @@ const std::map<std::string, Target::Feature> feature_name_map = {
     {"cl_half", Target::CLHalf},
     {"opengl", Target::OpenGL},
     {"openglcompute", Target::OpenGLCompute},
+    {"wasm_threads", Target::WasmThreads},
     {"user_context", Target::UserContext},
     {"matlab", Target::Matlab},
     {"profile", Target::Profile},
@@ -268,6 +299,30 @@ const std::map<std::string, Target::Feature> feature_name_map = {
     {"legacy_buffer_wrappers", Target::LegacyBufferWrappers},
     {"tsan", Target::TSAN},
     {"asan", Target::ASAN},
+    {"arena_allocations", Target::ArenaAllocations},
+    {"avx512_vnni", Target::AVX512_VNNI},
+    {"avx512_bf16", Target::AVX512_BF16},
+    {"arm_dot_prod", Target::ARMDotProd},
+    {"sve", Target::SVE},
+    {"arm_fp16", Target::ARMFp16},
+    {"cuda_capability_70", Target::CUDACapability70},
+    {"cuda_capability_75", Target::CUDACapability75},
+    {"no_optimize", Target::NoOptimize},
+    {"check_shapes_once", Target::CheckShapesOnce},
+    {"latency_telemetry", Target::LatencyTelemetry},
+    {"auto_prefetch", Target::AutoPrefetch},
+    {"fuse_gpu_stages", Target::FuseGPUStages},
+    {"fold_constant_funcs", Target::FoldConstantFuncs},
+    {"per_task_storage", Target::PerTaskStorage},
+    {"reuse_producer_storage", Target::ReuseProducerStorage},
+    {"threefry_random", Target::ThreefryRandom},
+    {"pad_storage_strides", Target::PadStorageStrides},
+    {"infer_compute_with", Target::InferComputeWith},
+    {"cuda_sass", Target::CUDASass},
+    {"metal_library", Target::MetalLibrary},
+    {"riscv_v", Target::RISCV_V},
+    {"memoize_simplify", Target::MemoizeSimplify},
+    {"intern_exprs", Target::InternExprs},
 };
 
 bool lookup_feature(const std::string &tok, Target::Feature &result) {
@@ -503,6 +558,12 @@ bool Target::supported() const {
 #if !defined(WITH_HEXAGON)
     bad |= arch == Target::Hexagon;
 #endif
+#if !defined(WITH_WEBASSEMBLY)
+    bad |= arch == Target::WebAssembly;
+#endif
+#if !defined(WITH_RISCV)
+    bad |= arch == Target::RISCV;
+#endif
 #if !defined(WITH_PTX)
     bad |= has_feature(Target::CUDA);
 #endif
@@ -572,7 +633,6 @@ void target_test() {
         t.set_feature(feature.second);
     }
     for (int i = 0; i < (int)(Target::FeatureEnd); i++) {
-        if (i == halide_target_feature_unused_23) continue;
         internal_assert(t.has_feature((Target::Feature)i)) << "Feature " << i << " not in feature_names_map.\n";
     }
     std::cout << "Target test passed" << std::endl;
@@ -22,12 +22,12 @@ struct Target {
     /** The operating system used by the target. Determines which
      * system calls to generate.
      * Corresponds to os_name_map in Target.cpp. */
-    enum OS {OSUnknown = 0, Linux, Windows, OSX, Android, IOS, QuRT, NoOS} os;
+    enum OS {OSUnknown = 0, Linux, Windows, OSX, Android, IOS, QuRT, NoOS, WebAssemblyRuntime} os;
 
     /** The architecture used by the target. Determines the
      * instruction set to use.
      * Corresponds to arch_name_map in Target.cpp. */
-    enum Arch {ArchUnknown = 0, X86, ARM, MIPS, Hexagon, POWERPC} arch;
+    enum Arch {ArchUnknown = 0, X86, ARM, MIPS, Hexagon, POWERPC, WebAssembly, RISCV} arch;
 
     /** The bit-width of the target machine. Must be 0 for unknown, or 32 or 64. */
     int bits;
@@ -62,6 +62,7 @@ struct Target {
         CLHalf = halide_target_feature_cl_half,
         OpenGL = halide_target_feature_opengl,
         OpenGLCompute = halide_target_feature_openglcompute,
+        WasmThreads = halide_target_feature_wasm_threads,
         UserContext = halide_target_feature_user_context,
         Matlab = halide_target_feature_matlab,
         Profile = halide_target_feature_profile,
@@ -90,6 +91,30 @@ struct Target {
         LegacyBufferWrappers = halide_target_feature_legacy_buffer_wrappers,
         TSAN = halide_target_feature_tsan,
         ASAN = halide_target_feature_asan,
+        ArenaAllocations = halide_target_feature_arena_allocations,
+        AVX512_VNNI = halide_target_feature_avx512_vnni,
+        AVX512_BF16 = halide_target_feature_avx512_bf16,
+        ARMDotProd = halide_target_feature_arm_dot_prod,
+        SVE = halide_target_feature_sve,
+        ARMFp16 = halide_target_feature_arm_fp16,
+        CUDACapability70 = halide_target_feature_cuda_capability70,
+        CUDACapability75 = halide_target_feature_cuda_capability75,
+        NoOptimize = halide_target_feature_no_optimize,
+        CheckShapesOnce = halide_target_feature_check_shapes_once,
+        LatencyTelemetry = halide_target_feature_latency_telemetry,
+        AutoPrefetch = halide_target_feature_auto_prefetch,
+        FuseGPUStages = halide_target_feature_fuse_gpu_stages,
+        FoldConstantFuncs = halide_target_feature_fold_constant_funcs,
+        PerTaskStorage = halide_target_feature_per_task_storage,
+        ReuseProducerStorage = halide_target_feature_reuse_producer_storage,
+        ThreefryRandom = halide_target_feature_threefry_random,
+        PadStorageStrides = halide_target_feature_pad_storage_strides,
+        InferComputeWith = halide_target_feature_infer_compute_with,
+        CUDASass = halide_target_feature_cuda_sass,
+        MetalLibrary = halide_target_feature_metal_library,
+        RISCV_V = halide_target_feature_riscv_v,
+        MemoizeSimplify = halide_target_feature_memoize_simplify,
+        InternExprs = halide_target_feature_intern_exprs,
         FeatureEnd = halide_target_feature_end
     };
     Target() : os(OSUnknown), arch(ArchUnknown), bits(0) {}
@@ -294,6 +319,31 @@ struct Target {
         return natural_vector_size(type_of<data_t>());
     }
 
+    /** Return an estimate of the number of architectural vector
+     * registers available when compiling for this Target. */
+    int vector_register_count() const {
+        user_assert(arch != ArchUnknown && bits != 0)
+            << "vector_register_count cannot be used on a Target with Unknown values.\n";
+
+        if (arch == Target::X86) {
+            if (has_feature(Halide::Target::AVX512) ||
+                has_feature(Halide::Target::AVX512_KNL) ||
+                has_feature(Halide::Target::AVX512_Skylake) ||
+                has_feature(Halide::Target::AVX512_Cannonlake)) {
+                return 32;
+            }
+            return bits == 64 ? 16 : 8;
+        } else if (arch == Target::ARM) {
+            return bits == 64 ? 32 : 16;
+        } else if (arch == Target::POWERPC) {
+            return has_feature(Halide::Target::VSX) ? 64 : 32;
+        } else if (arch == Target::Hexagon || arch == Target::MIPS) {
+            return 32;
+        } else {
+            return 16;
+        }
+    }
+
     /** Return true iff 64 bits and has_feature(LargeBuffers). */
     bool has_large_buffers() const {
         return bits == 64 && has_feature(LargeBuffers);
@@ -305,6 +305,9 @@ class SimplifyUsingBounds : public IRMutator2 {
         containing_loops.push_back({op->name, {value, value}});
         StmtOrExpr body = mutate(op->body);
         containing_loops.pop_back();
+        if (value.same_as(op->value) && body.same_as(op->body)) {
+            return op;
+        }
         return LetStmtOrLet::make(op->name, value, body);
     }
 
@@ -323,6 +326,9 @@ class SimplifyUsingBounds : public IRMutator2 {
         containing_loops.push_back({op->name, {min, min + extent - 1}});
         Stmt body = mutate(op->body);
         containing_loops.pop_back();
+        if (min.same_as(op->min) && extent.same_as(op->extent) && body.same_as(op->body)) {
+            return op;
+        }
         return For::make(op->name, min, extent, op->for_type, op->device_api, body);
     }
 public:
@@ -0,0 +1,98 @@
+#include "TuneGPUTile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+#include "Debug.h"
+#include "DeviceInterface.h"
+#include "Pipeline.h"
+#include "ScheduleFile.h"
+
+namespace Halide {
+
+using std::string;
+using std::vector;
+
+namespace {
+
+// The directives that tile a Func with blocks of the given shape, in
+// the format read by apply_schedule.
+string tile_schedule(const string &f, const string &x, const string &y,
+                     int x_size, int y_size, bool gpu) {
+    string xi = x + "i", yi = y + "i";
+    std::ostringstream s;
+    s << f << ".split(" << x << ", " << x << ", " << xi << ", " << x_size << ", Auto)\n"
+      << f << ".split(" << y << ", " << y << ", " << yi << ", " << y_size << ", Auto)\n"
+      << f << ".reorder(" << xi << ", " << yi << ", " << x << ", " << y << ")\n";
+    if (gpu) {
+        s << f << ".gpu_blocks(" << x << ")\n"
+          << f << ".gpu_blocks(" << y << ")\n"
+          << f << ".gpu_threads(" << xi << ")\n"
+          << f << ".gpu_threads(" << yi << ")\n";
+    } else {
+        s << f << ".parallel(" << y << ")\n";
+    }
+    return s.str();
+}
+
+}  // namespace
+
+string tune_gpu_tile(const std::function<Func()> &define,
+                     const string &func,
+                     const Var &x, const Var &y,
+                     const vector<std::pair<int, int>> &shapes,
+                     const vector<int32_t> &sizes,
+                     const Target &target,
+                     const string &schedule_file,
+                     int samples) {
+    user_assert(!shapes.empty()) << "tune_gpu_tile needs at least one block shape.\n";
+    user_assert(samples > 0) << "tune_gpu_tile needs at least one sample.\n";
+
+    bool gpu = get_default_device_api_for_target(target) != DeviceAPI::Host;
+
+    std::ostringstream report;
+    report << "# " << (gpu ? "gpu_tile" : "tile") << " of " << func
+           << " tuned for " << target.to_string() << "\n";
+    string best_schedule;
+    double best_time = std::numeric_limits<double>::infinity();
+    for (const auto &shape : shapes) {
+        string schedule = tile_schedule(func, x.name(), y.name(), shape.first, shape.second, gpu);
+        Pipeline p(define());
+        apply_schedule(p, schedule);
+        p.compile_jit(target);
+
+        // The first run compiles the kernels and uploads the inputs.
+        Realization r = p.realize(sizes, target);
+        r.device_sync();
+
+        double fastest = std::numeric_limits<double>::infinity();
+        for (int i = 0; i < samples; i++) {
+            auto start = std::chrono::high_resolution_clock::now();
+            p.realize(r, target);
+            r.device_sync();
+            auto end = std::chrono::high_resolution_clock::now();
+            fastest = std::min(fastest, std::chrono::duration<double>(end - start).count());
+        }
+
+        Internal::debug(1) << "Blocks of " << shape.first << "x" << shape.second
+                           << " for " << func << ": " << fastest * 1e3 << " ms\n";
+        report << "# " << shape.first << "x" << shape.second << ": " << fastest * 1e3 << " ms\n";
+        if (fastest < best_time) {
+            best_time = fastest;
+            best_schedule = schedule;
+        }
+    }
+
+    string result = report.str() + best_schedule;
+    if (!schedule_file.empty()) {
+        std::ofstream file(schedule_file);
+        user_assert(file) << "Could not open schedule file " << schedule_file << "\n";
+        file << result;
+    }
+    return result;
+}
+
+}  // namespace Halide
@@ -0,0 +1,54 @@
+#ifndef HALIDE_TUNE_GPU_TILE_H
+#define HALIDE_TUNE_GPU_TILE_H
+
+/** \file
+ * Defines a tuning mode that picks the thread block shape of a
+ * gpu_tile by compiling and timing candidate shapes.
+ */
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Func.h"
+
+namespace Halide {
+
+/** Pick the thread block shape of a Func's gpu_tile by measurement.
+ *
+ * define builds the pipeline and returns its output, with everything
+ * scheduled except the loops of the Func to be tiled, which is called
+ * func (as given to its constructor). define is called again for each
+ * candidate, so that each one is compiled from the same starting
+ * schedule. The Func is tiled over x and y, which must be named Vars,
+ * with blocks of each of the given (x, y) shapes, as with
+ * gpu_tile(x, y, xi, yi, x_size, y_size), where xi and yi are named
+ * after x and y with an "i" appended. Each candidate is compiled for
+ * the target and realized over sizes once to compile its kernels and
+ * upload its inputs, and then the fastest of samples runs is kept.
+ *
+ * Returns the schedule of the fastest candidate in the format read by
+ * apply_schedule, preceded by comments giving the time of each
+ * candidate. It is also written to schedule_file if that is
+ * non-empty. To use the choice later, define the pipeline the same
+ * way and pass the file to apply_schedule_file, or to a Generator
+ * with -s. The registers, shared memory and occupancy of each CUDA
+ * kernel can be printed while tuning by setting
+ * HL_CUDA_KERNEL_STATS=1.
+ *
+ * On targets without a GPU API the candidates are CPU tiles instead,
+ * with the loop over rows of tiles parallel, so the same mode can pick
+ * CPU tile sizes. */
+std::string tune_gpu_tile(const std::function<Func()> &define,
+                          const std::string &func,
+                          const Var &x, const Var &y,
+                          const std::vector<std::pair<int, int>> &shapes,
+                          const std::vector<int32_t> &sizes,
+                          const Target &target,
+                          const std::string &schedule_file = "",
+                          int samples = 5);
+
+}  // namespace Halide
+
+#endif
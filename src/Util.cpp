@@ -2,6 +2,7 @@
 #include "Introspection.h"
 #include "Debug.h"
 #include "Error.h"
+#include <fstream>
 #include <sstream>
 #include <map>
 #include <atomic>
@@ -300,6 +301,29 @@ FileStat file_stat(const std::string &name) {
             static_cast<uint32_t>(a.st_mode)};
 }
 
+std::vector<char> read_entire_file(const std::string &pathname) {
+    std::ifstream f(pathname, std::ios::in | std::ios::binary);
+    user_assert(f.is_open()) << "Unable to open file: " << pathname << "\n";
+    std::vector<char> result;
+    f.seekg(0, std::ifstream::end);
+    size_t size = f.tellg();
+    result.resize(size);
+    f.seekg(0, std::ifstream::beg);
+    f.read(result.data(), result.size());
+    internal_assert(f.good()) << "Unable to read file: " << pathname << "\n";
+    f.close();
+    return result;
+}
+
+void write_entire_file(const std::string &pathname, const std::vector<char> &source) {
+    std::ofstream f(pathname, std::ios::out | std::ios::binary);
+    user_assert(f.is_open()) << "Unable to open file: " << pathname << "\n";
+    f.write(source.data(), source.size());
+    f.flush();
+    internal_assert(f.good()) << "Unable to write file: " << pathname << "\n";
+    f.close();
+}
+
 #ifdef _WIN32
 namespace {
 
@@ -262,6 +262,13 @@ void dir_rmdir(const std::string &name);
 /** Wrapper for stat(). Asserts upon error. */
 FileStat file_stat(const std::string &name);
 
+/** Read the whole of a binary file. Asserts upon error. */
+std::vector<char> read_entire_file(const std::string &pathname);
+
+/** Create or replace a binary file with the given contents. Asserts
+ * upon error. */
+void write_entire_file(const std::string &pathname, const std::vector<char> &source);
+
 /** A simple utility class that creates a temporary file in its ctor and
  * deletes that file in its dtor; this is useful for temporary files that you
  * want to ensure are deleted when exiting a certain scope. Since this is essentially
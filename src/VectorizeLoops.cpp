@@ -249,6 +249,14 @@ class PredicateLoadStore : public IRMutator2 {
                 << "We are inside a hexagon loop, but the target doesn't have hexagon's features\n";
             return true;
         } else if (target.arch == Target::X86) {
+            // AVX-512 has masked loads and stores of every lane size
+            // with AVX512-BW, and of 32 and 64-bit lanes otherwise.
+            if (target.has_feature(Target::AVX512_Skylake) ||
+                target.has_feature(Target::AVX512_Cannonlake)) {
+                return lanes >= 4;
+            } else if (target.features_any_of({Target::AVX512, Target::AVX512_KNL})) {
+                return (bit_size == 32 || bit_size == 64) && (lanes >= 4);
+            }
             // Should only attempt to predicate store/load if the lane size is
             // no less than 4
             return (bit_size == 32) && (lanes >= 4);
@@ -7,6 +7,7 @@
 #define HALIDE_RUNTIME_BUFFER_H
 
 #include <memory>
+#include <new>
 #include <vector>
 #include <cassert>
 #include <atomic>
@@ -17,6 +18,10 @@
 
 #include "HalideRuntime.h"
 
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
 #ifdef _MSC_VER
 #define HALIDE_ALLOCA _alloca
 #else
@@ -34,6 +39,27 @@ namespace Runtime {
 // Forward-declare our Buffer class
 template<typename T, int D> class Buffer;
 
+/** An executor for the parallel Buffer methods (see
+ * Buffer::parallel_for_each_value) that runs the tasks on Halide's
+ * thread pool with halide_do_par_for. Using it requires linking a
+ * Halide runtime. */
+struct HalideThreadPoolExecutor {
+    void *user_context = nullptr;
+
+    template<typename Task>
+    void operator()(int num_tasks, Task &&task) const {
+        using TaskType = typename std::remove_reference<Task>::type;
+        halide_do_par_for(user_context, run_task<TaskType>, 0, num_tasks, (uint8_t *)&task);
+    }
+
+private:
+    template<typename TaskType>
+    static int run_task(void *, int i, uint8_t *closure) {
+        (*(TaskType *)closure)(i);
+        return 0;
+    }
+};
+
 // A helper to check if a parameter pack is entirely implicitly
 // int-convertible to use with std::enable_if
 template<typename ...Args>
@@ -66,6 +92,23 @@ struct AllocationHeader {
     AllocationHeader(void (*deallocate_fn)(void *)) : deallocate_fn(deallocate_fn), ref_count(1) {}
 };
 
+/** An AllocationHeader for host memory that a Buffer did not allocate
+ * itself, but was handed along with a function to release it (e.g. a
+ * memory-mapped file). */
+struct ExternalAllocationHeader : AllocationHeader {
+    void (*release_fn)(void *);
+    void *release_context;
+
+    ExternalAllocationHeader(void (*release_fn)(void *), void *release_context) :
+        AllocationHeader(release), release_fn(release_fn), release_context(release_context) {}
+
+    static void release(void *p) {
+        ExternalAllocationHeader *h = (ExternalAllocationHeader *)p;
+        h->release_fn(h->release_context);
+        free(h);
+    }
+};
+
 /** This indicates how to deallocate the device for a Halide::Runtime::Buffer. */
 enum struct BufferDeviceOwnership : int {
     Allocated,     ///> halide_device_free will be called when device ref count goes to zero
@@ -83,6 +126,15 @@ struct DeviceRefCount {
     BufferDeviceOwnership ownership{BufferDeviceOwnership::Allocated};
 };
 
+/** Allocations made by the Buffer class itself of at least this many
+ * bytes are aligned to 2MB, and on Linux are advised to use
+ * transparent huge pages. Zero (the default) disables this. Shared by
+ * all Buffer types; see Buffer::set_huge_page_threshold. */
+inline size_t &buffer_huge_page_threshold() {
+    static size_t threshold = 0;
+    return threshold;
+}
+
 /** A templated Buffer class that wraps halide_buffer_t and adds
  * functionality. When using Halide from C++, this is the preferred
  * way to create input and output buffers. The overhead of using this
@@ -180,10 +232,49 @@ private:
         }
     };
 
+    /** Tiling loops can make and release thousands of device crops
+     * per frame, so the storage for their reference counts is
+     * recycled through a small per-thread free list instead of going
+     * back to the heap. */
+    struct CroppedRefCountPool {
+        static const size_t max_size = 64;
+        void *storage[max_size];
+        size_t size = 0;
+        // Crops destroyed after the pool at thread exit bypass it.
+        bool destroyed = false;
+
+        ~CroppedRefCountPool() {
+            while (size) {
+                ::operator delete(storage[--size]);
+            }
+            destroyed = true;
+        }
+
+        static CroppedRefCountPool &get() {
+            static thread_local CroppedRefCountPool pool;
+            return pool;
+        }
+    };
+
     /** Setup the device ref count for a buffer to indicate it is a crop of cropped_from */
     void crop_from(const Buffer<T, D> &cropped_from) {
         assert(dev_ref_count == nullptr);
-        dev_ref_count = new DevRefCountCropped(cropped_from);
+        CroppedRefCountPool &pool = CroppedRefCountPool::get();
+        void *storage = pool.size ? pool.storage[--pool.size] : ::operator new(sizeof(DevRefCountCropped));
+        dev_ref_count = new (storage) DevRefCountCropped(cropped_from);
+    }
+
+    static void free_cropped_ref_count(DevRefCountCropped *ref_count) {
+        // Destroying the ref count releases the buffer it was cropped
+        // from, which may free another crop, so don't touch the pool
+        // until that's done.
+        ref_count->~DevRefCountCropped();
+        CroppedRefCountPool &pool = CroppedRefCountPool::get();
+        if (!pool.destroyed && pool.size < CroppedRefCountPool::max_size) {
+            pool.storage[pool.size++] = ref_count;
+        } else {
+            ::operator delete(ref_count);
+        }
     }
 
     /** Decrement the reference count of any owned allocation and free host
@@ -227,7 +318,7 @@ private:
             }
             if (dev_ref_count) {
                 if (dev_ref_count->ownership == BufferDeviceOwnership::Cropped) {
-                    delete (DevRefCountCropped *)dev_ref_count;
+                    free_cropped_ref_count((DevRefCountCropped *)dev_ref_count);
                 } else {
                     delete dev_ref_count;
                 }
@@ -743,14 +834,33 @@ public:
         deallocate();
 
         // Conservatively align images to 128 bytes. This is enough
-        // alignment for all the platforms we might use.
+        // alignment for all the platforms we might use. Large images
+        // are aligned to a huge page boundary instead.
         size_t size = size_in_bytes();
-        const size_t alignment = 128;
+        size_t alignment = 128;
+        const size_t huge_page_threshold = buffer_huge_page_threshold();
+        const bool huge = huge_page_threshold != 0 && size >= huge_page_threshold;
+        if (huge) {
+            alignment = 2 * 1024 * 1024;
+        }
         size = (size + alignment - 1) & ~(alignment - 1);
         void *alloc_storage = allocate_fn(size + sizeof(AllocationHeader) + alignment - 1);
         alloc = new (alloc_storage) AllocationHeader(deallocate_fn);
         uint8_t *unaligned_ptr = ((uint8_t *)alloc) + sizeof(AllocationHeader);
         buf.host = (uint8_t *)((uintptr_t)(unaligned_ptr + alignment - 1) & ~(alignment - 1));
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+        if (huge) {
+            // Just a hint, so ignore failure.
+            (void)madvise(buf.host, size, MADV_HUGEPAGE);
+        }
+#endif
+    }
+
+    /** Set the size in bytes above which Buffers allocate their host
+     * memory aligned to huge pages. Applies to all Buffer types. Pass
+     * zero to disable. */
+    static void set_huge_page_threshold(size_t bytes) {
+        buffer_huge_page_threshold() = bytes;
     }
 
     /** Drop reference to any owned host or device memory, possibly
@@ -935,6 +1045,16 @@ public:
         }
     }
 
+    /** Initialize an Buffer from a pointer to the min coordinate and
+     * an array describing the shape, and take ownership of the
+     * data: release_fn(release_context) is called once no Buffer
+     * refers to it any more. Does not set the host_dirty flag. */
+    explicit Buffer(halide_type_t t, add_const_if_T_is_const<void> *data, int d, const halide_dimension_t *shape,
+                    void (*release_fn)(void *), void *release_context) :
+        Buffer(t, data, d, shape) {
+        alloc = new (malloc(sizeof(ExternalAllocationHeader))) ExternalAllocationHeader(release_fn, release_context);
+    }
+
     /** Initialize an Buffer from a pointer to the min coordinate and
      * an array describing the shape.  Does not take ownership of the
      * data and does not set the host_dirty flag. */
@@ -1057,6 +1177,41 @@ public:
     */
     template<typename T2, int D2>
     void copy_from(const Buffer<T2, D2> &other) {
+        copy_from_impl(other, (SerialExecutor *)nullptr);
+    }
+
+    /** Like copy_from, but splits the copy into tasks over the
+     * outermost dimensions, which are run with the given executor. See
+     * parallel_for_each_value. */
+    template<typename T2, int D2, typename Executor = HalideThreadPoolExecutor>
+    void parallel_copy_from(const Buffer<T2, D2> &other, Executor &&executor = Executor()) {
+        copy_from_impl(other, &executor);
+    }
+
+private:
+    // Never called, as copy_from passes a null executor. Using it
+    // rather than HalideThreadPoolExecutor means copy_from doesn't
+    // need a Halide runtime.
+    struct SerialExecutor {
+        template<typename Task>
+        void operator()(int num_tasks, Task &&task) const {
+            for (int i = 0; i < num_tasks; i++) {
+                task(i);
+            }
+        }
+    };
+
+    template<typename MemType, typename Executor>
+    static void copy_values(Buffer<MemType, D> &dst, Buffer<const MemType, D> &src, Executor *executor) {
+        if (executor) {
+            dst.parallel_for_each_value(*executor, [&](MemType &dst, MemType src) {dst = src;}, src);
+        } else {
+            dst.for_each_value([&](MemType &dst, MemType src) {dst = src;}, src);
+        }
+    }
+
+    template<typename T2, int D2, typename Executor>
+    void copy_from_impl(const Buffer<T2, D2> &other, Executor *executor) {
         assert(!device_dirty() && "Cannot call Halide::Runtime::Buffer::copy_from on a device dirty destination.");
         assert(!other.device_dirty() && "Cannot call Halide::Runtime::Buffer::copy_from on a device dirty source.");
 
@@ -1077,35 +1232,53 @@ public:
             src.crop(i, min_coord, max_coord - min_coord + 1);
         }
 
+        // If both buffers are dense with the same layout, the copy is
+        // a single memcpy.
+        bool same_dense_layout = true;
+        for (int i = 0; i < dimensions(); i++) {
+            same_dense_layout &= dst.dim(i).stride() == src.dim(i).stride();
+        }
+        const size_t bytes = dst.number_of_elements() * type().bytes();
+        if (same_dense_layout && dst.size_in_bytes() == bytes) {
+            uint8_t *dst_bytes = (uint8_t *)dst.begin();
+            const uint8_t *src_bytes = (const uint8_t *)src.begin();
+            // Split large copies into chunks of at least 1MB.
+            const int num_tasks = executor ? (int)std::min<size_t>(256, std::max<size_t>(1, bytes >> 20)) : 1;
+            if (num_tasks > 1) {
+                (*executor)(num_tasks, [&](int i) {
+                    size_t begin = bytes * i / num_tasks, end = bytes * (i + 1) / num_tasks;
+                    memcpy(dst_bytes + begin, src_bytes + begin, end - begin);
+                });
+            } else {
+                memcpy(dst_bytes, src_bytes, bytes);
+            }
+            set_host_dirty();
+            return;
+        }
+
         // If T is void, we need to do runtime dispatch to an
         // appropriately-typed lambda. We're copying, so we only care
         // about the element size.
         if (type().bytes() == 1) {
             using MemType = uint8_t;
-            auto &typed_dst = (Buffer<MemType, D> &)dst;
-            auto &typed_src = (Buffer<const MemType, D> &)src;
-            typed_dst.for_each_value([&](MemType &dst, MemType src) {dst = src;}, typed_src);
+            copy_values((Buffer<MemType, D> &)dst, (Buffer<const MemType, D> &)src, executor);
         } else if (type().bytes() == 2) {
             using MemType = uint16_t;
-            auto &typed_dst = (Buffer<MemType, D> &)dst;
-            auto &typed_src = (Buffer<const MemType, D> &)src;
-            typed_dst.for_each_value([&](MemType &dst, MemType src) {dst = src;}, typed_src);
+            copy_values((Buffer<MemType, D> &)dst, (Buffer<const MemType, D> &)src, executor);
         } else if (type().bytes() == 4) {
             using MemType = uint32_t;
-            auto &typed_dst = (Buffer<MemType, D> &)dst;
-            auto &typed_src = (Buffer<const MemType, D> &)src;
-            typed_dst.for_each_value([&](MemType &dst, MemType src) {dst = src;}, typed_src);
+            copy_values((Buffer<MemType, D> &)dst, (Buffer<const MemType, D> &)src, executor);
         } else if (type().bytes() == 8) {
             using MemType = uint64_t;
-            auto &typed_dst = (Buffer<MemType, D> &)dst;
-            auto &typed_src = (Buffer<const MemType, D> &)src;
-            typed_dst.for_each_value([&](MemType &dst, MemType src) {dst = src;}, typed_src);
+            copy_values((Buffer<MemType, D> &)dst, (Buffer<const MemType, D> &)src, executor);
         } else {
             assert(false && "type().bytes() must be 1, 2, 4, or 8");
         }
         set_host_dirty();
     }
 
+public:
+
     /** Make an image that refers to a sub-range of this image along
      * the given dimension. Does not assert the crop region is within
      * the existing bounds. */
@@ -1437,8 +1610,18 @@ public:
         return ret;
     }
 
+    /** Allocate host and device memory together. Device interfaces
+     * may use this to allocate host memory that is faster to copy to
+     * and from the device, such as page-locked memory on CUDA or
+     * OpenCL. The memory is released with device_and_host_free, which
+     * is called automatically when the last reference goes away. */
     int device_and_host_malloc(const struct halide_device_interface_t *device_interface, void *ctx = nullptr) {
-        return device_interface->device_and_host_malloc(ctx, &buf, device_interface);
+        int ret = device_interface->device_and_host_malloc(ctx, &buf, device_interface);
+        if (ret == 0 && !dev_ref_count) {
+            dev_ref_count = new DeviceRefCount;
+            dev_ref_count->ownership = BufferDeviceOwnership::AllocatedDeviceAndHost;
+        }
+        return ret;
     }
 
     int device_and_host_free(const struct halide_device_interface_t *device_interface, void *ctx = nullptr) {
@@ -1542,6 +1725,45 @@ public:
         return buf;
     }
 
+    /** Allocate a new image of the given size with a runtime type,
+     * with its rows (dimension 1) padded apart by 64 bytes when their
+     * dense stride would be a multiple of 1024 bytes, such as a width
+     * of 1024 floats. Rows a multiple of 1024 bytes apart map to the
+     * same few cache sets, so walking down a column of a dense image of
+     * a power of two width keeps evicting the same cache lines. Padded
+     * images aren't dense, so copy them element-wise, or with
+     * Buffer::copy_from, rather than with memcpy. */
+    static Buffer<T, D> make_with_padded_rows(halide_type_t t, const std::vector<int> &sizes) {
+        if (!T_is_void) {
+            assert(static_halide_type() == t);
+        }
+        std::vector<halide_dimension_t> shape(sizes.size());
+        int64_t stride = 1;
+        for (size_t i = 0; i < sizes.size(); i++) {
+            shape[i] = halide_dimension_t(0, sizes[i], (int32_t)stride);
+            int64_t extent = sizes[i];
+            const int64_t row_bytes = extent * t.bytes();
+            if (i == 0 && sizes.size() > 1 && row_bytes >= 1024 && row_bytes % 1024 == 0) {
+                extent += std::max(64 / t.bytes(), 1);
+            }
+            stride *= extent;
+            assert(stride <= std::numeric_limits<int32_t>::max());
+        }
+        Buffer<> dst(t, nullptr, (int)sizes.size(), shape.data());
+        if (!any_zero(sizes)) {
+            dst.allocate();
+        }
+        return dst;
+    }
+
+    /** Allocate a new image of the given size with its rows padded
+     * apart to avoid cache set conflicts. See above. */
+    static Buffer<T, D> make_with_padded_rows(const std::vector<int> &sizes) {
+        static_assert(!T_is_void,
+                      "To make a padded Buffer<void>, pass a halide_type_t as the first argument");
+        return make_with_padded_rows(static_halide_type(), sizes);
+    }
+
     /** Make a buffer with the same shape and memory nesting order as
      * another buffer. It may have a different type. */
     template<typename T2, int D2>
@@ -1718,6 +1940,15 @@ public:
         for_each_value([=](T &v) {v = val;});
     }
 
+    /** Like fill, but splits the work into tasks over the outermost
+     * dimensions, which are run with the given executor. See
+     * parallel_for_each_value. */
+    template<typename Executor = HalideThreadPoolExecutor>
+    void parallel_fill(not_void_T val, Executor &&executor = Executor()) {
+        set_host_dirty();
+        parallel_for_each_value(executor, [=](T &v) {v = val;});
+    }
+
 private:
     /** Helper functions for for_each_value. */
     // @{
@@ -1799,21 +2030,22 @@ private:
             }
         }
     }
-    // @}
 
-public:
-    /** Call a function on every value in the buffer, and the
-     * corresponding values in some number of other buffers of the
-     * same size. The function should take a reference, const
-     * reference, or value of the correct type for each buffer. This
-     * effectively lifts a function of scalars to an element-wise
-     * function of buffers. This produces code that the compiler can
-     * autovectorize. This is slightly cheaper than for_each_element,
-     * because it does not need to track the coordinates. */
-    template<typename Fn, typename ...Args, int N = sizeof...(Args) + 1>
-    void for_each_value(Fn &&f, Args... other_buffers) {
-        for_each_value_task_dim<N> *t =
-            (for_each_value_task_dim<N> *)HALIDE_ALLOCA((dimensions()+1) * sizeof(for_each_value_task_dim<N>));
+    // Run for_each_value_helper with the pointers advanced by some
+    // offsets.
+    template<bool innermost_strides_are_one, typename Fn, typename... Ptrs>
+    static void for_each_value_offset(Fn &&f, int d, const for_each_value_task_dim<sizeof...(Ptrs)> *t,
+                                      const int *offsets, Ptrs... ptrs) {
+        advance_ptrs(offsets, (&ptrs)...);
+        for_each_value_helper<innermost_strides_are_one>(f, d, t, ptrs...);
+    }
+
+    // Fill in the loop nest for for_each_value, ordered by stride and
+    // with dimensions flattened where possible. Returns the number of
+    // dimensions left after flattening.
+    template<int N, typename ...Args>
+    int for_each_value_prep(for_each_value_task_dim<N> *t, bool *innermost_strides_are_one,
+                            const Args *... other_buffers) {
         for (int i = 0; i <= dimensions(); i++) {
             for (int j = 0; j < N; j++) {
                 t[i].stride[j] = 0;
@@ -1822,7 +2054,7 @@ public:
         }
 
         for (int i = 0; i < dimensions(); i++) {
-            extract_strides(i, t[i].stride, this, &other_buffers...);
+            extract_strides(i, t[i].stride, this, other_buffers...);
             t[i].extent = dim(i).extent();
             // Order the dimensions by stride, so that the traversal is cache-coherent.
             for (int j = i; j > 0 && t[j].stride[0] < t[j-1].stride[0]; j--) {
@@ -1848,13 +2080,32 @@ public:
             }
         }
 
-        bool innermost_strides_are_one = false;
+        *innermost_strides_are_one = false;
         if (dimensions() > 0) {
-            innermost_strides_are_one = true;
+            *innermost_strides_are_one = true;
             for (int j = 0; j < N; j++) {
-                innermost_strides_are_one &= t[0].stride[j] == 1;
+                *innermost_strides_are_one &= t[0].stride[j] == 1;
             }
         }
+        return d;
+    }
+    // @}
+
+public:
+    /** Call a function on every value in the buffer, and the
+     * corresponding values in some number of other buffers of the
+     * same size. The function should take a reference, const
+     * reference, or value of the correct type for each buffer. This
+     * effectively lifts a function of scalars to an element-wise
+     * function of buffers. This produces code that the compiler can
+     * autovectorize. This is slightly cheaper than for_each_element,
+     * because it does not need to track the coordinates. */
+    template<typename Fn, typename ...Args, int N = sizeof...(Args) + 1>
+    void for_each_value(Fn &&f, Args... other_buffers) {
+        for_each_value_task_dim<N> *t =
+            (for_each_value_task_dim<N> *)HALIDE_ALLOCA((dimensions()+1) * sizeof(for_each_value_task_dim<N>));
+        bool innermost_strides_are_one;
+        for_each_value_prep(t, &innermost_strides_are_one, &other_buffers...);
 
         if (innermost_strides_are_one) {
             for_each_value_helper<true>(f, dimensions() - 1, t, begin(), (other_buffers.begin())...);
@@ -1863,6 +2114,58 @@ public:
         }
     }
 
+    /** Like for_each_value, but splits the outermost dimension (after
+     * ordering the dimensions by stride and flattening them where
+     * possible) into tasks of at least 64k values, which are run with
+     * the given executor. The executor is called as
+     * executor(num_tasks, task), and must call task(i) exactly once for
+     * each i in [0, num_tasks), in any order and on any threads, and
+     * return when they have all finished. HalideThreadPoolExecutor runs
+     * them on Halide's thread pool. The function may be called
+     * concurrently on different values, so it must be thread-safe. */
+    template<typename Executor, typename Fn, typename ...Args, int N = sizeof...(Args) + 1>
+    void parallel_for_each_value(Executor &&executor, Fn &&f, Args... other_buffers) {
+        for_each_value_task_dim<N> *t =
+            (for_each_value_task_dim<N> *)HALIDE_ALLOCA((dimensions()+1) * sizeof(for_each_value_task_dim<N>));
+        bool innermost_strides_are_one;
+        const int d = for_each_value_prep(t, &innermost_strides_are_one, &other_buffers...);
+
+        const int outer = d - 1;
+        const int extent = outer >= 0 ? t[outer].extent : 1;
+        const int64_t values = (int64_t)number_of_elements();
+        const int num_tasks = (int)std::min<int64_t>(std::min<int64_t>(extent, 256),
+                                                     std::max<int64_t>(1, values >> 16));
+        if (num_tasks <= 1) {
+            if (innermost_strides_are_one) {
+                for_each_value_helper<true>(f, dimensions() - 1, t, begin(), (other_buffers.begin())...);
+            } else {
+                for_each_value_helper<false>(f, dimensions() - 1, t, begin(), (other_buffers.begin())...);
+            }
+            return;
+        }
+
+        executor(num_tasks, [&](int i) {
+            // Each task does a slice of the outermost dimension.
+            const int slice_begin = (int)((int64_t)extent * i / num_tasks);
+            const int slice_end = (int)((int64_t)extent * (i + 1) / num_tasks);
+            for_each_value_task_dim<N> *slice =
+                (for_each_value_task_dim<N> *)HALIDE_ALLOCA(d * sizeof(for_each_value_task_dim<N>));
+            for (int j = 0; j < d; j++) {
+                slice[j] = t[j];
+            }
+            slice[outer].extent = slice_end - slice_begin;
+            int offsets[N];
+            for (int j = 0; j < N; j++) {
+                offsets[j] = slice_begin * t[outer].stride[j];
+            }
+            if (innermost_strides_are_one) {
+                for_each_value_offset<true>(f, outer, slice, offsets, begin(), (other_buffers.begin())...);
+            } else {
+                for_each_value_offset<false>(f, outer, slice, offsets, begin(), (other_buffers.begin())...);
+            }
+        });
+    }
+
 private:
 
     // Helper functions for for_each_element
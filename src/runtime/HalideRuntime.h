@@ -149,6 +149,63 @@ extern int halide_default_do_task(void *user_context, halide_task_t f, int idx,
                                   uint8_t *closure);
 // @}
 
+/** An alternative do_par_for that divides the loop range into one
+ * contiguous slice per worker thread up front, with idle workers
+ * stealing half of a busy worker's remaining slice. This keeps
+ * fine-grained parallel loops from contending on the thread pool
+ * lock for every iteration. Enable it with
+ * halide_set_custom_do_par_for(halide_work_stealing_do_par_for). Uses
+ * at most 64 workers per loop. */
+extern int halide_work_stealing_do_par_for(void *user_context,
+                                           halide_task_t task,
+                                           int min, int size, uint8_t *closure);
+
+/** An alternative do_par_for that uses guided scheduling: each time a
+ * thread takes work from the loop it claims a chunk of the remaining
+ * iterations, proportional to how many are left, rather than a single
+ * one. Chunks start large, so threads rarely contend on the thread
+ * pool lock, and shrink to single iterations near the end of the loop,
+ * so that threads finish together even when iterations vary in cost
+ * or some cpus are slower than others. This lets loops like
+ * f.parallel(y) over many small rows go without a static task size
+ * chosen with f.parallel(y, task_size). Respects the limits set with
+ * halide_thread_pool_set_limits. Enable it with
+ * halide_set_custom_do_par_for(halide_guided_do_par_for). */
+extern int halide_guided_do_par_for(void *user_context,
+                                    halide_task_t task,
+                                    int min, int size, uint8_t *closure);
+
+/** An alternative do_par_for for pipelines called repeatedly on the
+ * same buffers. Like halide_work_stealing_do_par_for, it divides the
+ * loop range into one contiguous slice per thread up front, but each
+ * slice always goes to the same thread: the first to the calling
+ * thread, and slice i to worker thread i - 1. So a loop over the same
+ * range, e.g. over store_root state carried between calls, touches the
+ * same memory from the same thread every call, and finds it in that
+ * core's private caches. Workers only take other slices' iterations by
+ * stealing when they run out of their own. Combine it with
+ * HL_THREAD_AFFINITY=1, so that the workers also stay on the same
+ * cores. Enable it with
+ * halide_set_custom_do_par_for(halide_affinity_do_par_for). Uses at
+ * most 64 threads per loop. */
+extern int halide_affinity_do_par_for(void *user_context,
+                                      halide_task_t task,
+                                      int min, int size, uint8_t *closure);
+
+/** A counting semaphore, used to synchronize the producer and consumer
+ * sides of a Func scheduled async(). Must be initialized with zero, which
+ * is a count of zero. */
+struct halide_semaphore_t {
+    int32_t _private[1];
+};
+
+/** Add 'n' to the count of a semaphore. Returns zero. */
+extern int halide_semaphore_release(struct halide_semaphore_t *sema, int n);
+
+/** Wait until the count of a semaphore is at least 'n', then subtract
+ * 'n' from it. Returns zero on success. */
+extern int halide_semaphore_acquire(struct halide_semaphore_t *sema, int n);
+
 struct halide_thread;
 
 /** Spawn a thread. Returns a handle to the thread for the purposes of
@@ -177,6 +234,145 @@ extern void halide_join_thread(struct halide_thread *);
  */
 extern int halide_set_num_threads(int n);
 
+/** Get the number of threads parallel loops are run on: the number set
+ * with halide_set_num_threads, or the default if none has been set.
+ * Pipelines compiled with the per_task_storage target feature split
+ * parallel loops into this many strips. Returns 1 if there is no
+ * thread pool. */
+extern int halide_get_num_threads();
+
+/** Set how long idle workers in Halide's thread pool spin looking for
+ * new work before going to sleep, in microseconds. Returns the old
+ * value.
+ *
+ * spin_us < 0  : error condition
+ * spin_us == 0 : use the default, which is HL_THREAD_POOL_SPIN_US if set,
+ *                and otherwise 0 (sleep as soon as there is no work)
+ * spin_us > 0  : spin for up to this long
+ *
+ * Spinning avoids the latency of waking sleeping workers for pipelines
+ * that launch parallel loops in quick succession, at the cost of cpu
+ * time while the pool is idle. A worker that spins without finding work
+ * halves the time it spins the next time, until it finds work again.
+ *
+ * (As with halide_set_num_threads, this only affects the default
+ * implementation of halide_do_par_for().)
+ */
+extern int halide_thread_pool_set_idle_policy(int spin_us);
+
+/** Bound the share of Halide's thread pool used by parallel loops
+ * launched with the given user_context, and set their priority. At
+ * most max_threads threads (counting the calling thread) work on each
+ * such loop at once, or any number if max_threads is 0. Idle threads
+ * take tasks from the highest priority loop first, so a batch pipeline
+ * given a low priority can't starve a latency-critical pipeline sharing
+ * the pool. The default priority is 0. Nested parallel loops in a
+ * pipeline are launched with the same user_context, and so get the same
+ * limits.
+ *
+ * The user_context is only passed to halide_do_par_for by pipelines
+ * compiled with the user_context target feature; it is NULL otherwise.
+ * Calling this with max_threads == 0 and priority == 0 removes the
+ * limits for a user_context. Up to 16 user_contexts may have limits at
+ * once. Returns zero on success.
+ *
+ * (As with halide_set_num_threads, this only affects the default
+ * implementation of halide_do_par_for().)
+ */
+extern int halide_thread_pool_set_limits(void *user_context, int max_threads, int priority);
+
+/** Separate thread pools, each with their own worker threads, for
+ * hosting pipelines that must not share threads. A pool made with
+ * halide_thread_pool_create has num_threads threads (or the default
+ * number if it is 0), which start when it first runs a parallel loop.
+ * If num_cpus is non-zero, its workers are pinned round-robin to the
+ * cpus first_cpu to first_cpu + num_cpus - 1 (which on linux index the
+ * cpus in the affinity mask of the process).
+ *
+ * halide_thread_pool_bind makes parallel loops launched with the given
+ * user_context run on the pool, or go back to the global pool if pool
+ * is NULL. Like halide_thread_pool_set_limits, this is keyed on the
+ * user_context, which is only passed to halide_do_par_for by pipelines
+ * compiled with the user_context target feature. Up to 16 user_contexts
+ * may be bound at once. Returns zero on success.
+ *
+ * halide_set_num_threads, halide_thread_pool_set_idle_policy and
+ * halide_shutdown_thread_pool only affect the global pool.
+ * halide_thread_pool_destroy unbinds a pool from all user_contexts,
+ * stops its threads and frees it. It must not be called while the pool
+ * is running a parallel loop.
+ */
+//@{
+struct halide_thread_pool;
+extern struct halide_thread_pool *halide_thread_pool_create(int num_threads, int first_cpu, int num_cpus);
+extern int halide_thread_pool_bind(void *user_context, struct halide_thread_pool *pool);
+extern void halide_thread_pool_destroy(struct halide_thread_pool *pool);
+//@}
+
+/** The classes of cores a thread pool can be restricted to. The big
+ * cores are those with the largest capacity, such as the big cores of
+ * big.LITTLE chips or the performance cores of hybrid x86 chips, and
+ * the little cores are the rest. On platforms that can't tell cores
+ * apart, all cores are big. */
+typedef enum halide_core_class_t {
+    halide_core_class_all = 0,
+    halide_core_class_big = 1,
+    halide_core_class_little = 2,
+} halide_core_class_t;
+
+/** Restrict the workers of a thread pool made with
+ * halide_thread_pool_create, or the global pool if pool is NULL, to
+ * the cores of the given class, with one worker per core. A
+ * latency-critical pipeline can then run on the big cores, so that its
+ * parallel loops don't wait on stragglers on the little ones, while a
+ * pool for background work uses the little cores. halide_core_class_all
+ * lifts the restriction, and goes back to the default number of
+ * threads. Stops the pool's workers, so must not be called while it is
+ * running a parallel loop. Returns zero on success, or -1 if there are
+ * no cores of the class.
+ *
+ * Independently of this, workers pinned by HL_THREAD_AFFINITY go on
+ * the fastest cores first.
+ *
+ * (As with halide_set_num_threads, this only affects the default
+ * implementation of halide_do_par_for().)
+ */
+extern int halide_thread_pool_set_core_class(struct halide_thread_pool *pool, halide_core_class_t core_class);
+
+/** Record what the thread pool does, to see how parallel loops are
+ * spread over the threads. halide_thread_pool_record_events discards
+ * any events recorded so far and starts recording up to max_events
+ * more, or stops recording if max_events is 0. Each task run by the
+ * pool is an event, as is each parallel loop (job) as a whole. Once the
+ * buffer is full further events are dropped. Returns zero on success.
+ *
+ * halide_thread_pool_events_json writes the events into buf as a
+ * Chrome trace (viewable in chrome://tracing or Perfetto). Jobs span
+ * from being enqueued to finishing on the lane of the thread that
+ * launched them, and record their number of tasks and how many threads
+ * worked on them. Tasks are on the lane of the thread that ran them,
+ * and record how long they were queued before starting. A chunk of
+ * tasks claimed together by halide_guided_do_par_for is one event, which
+ * records the size of the chunk. Worker lanes
+ * are numbered from 1, and lane 0 is any thread outside the pool. Each
+ * pool made with halide_thread_pool_create is a separate process in
+ * the trace. At most size bytes are written, including a null
+ * terminator. Returns the length of the full trace, not counting the
+ * terminator, so call with a null buf to find the size needed.
+ *
+ * Neither should be called while parallel loops are running. If
+ * HL_THREAD_POOL_TRACE_FILE is set, events are recorded from when the
+ * thread pool starts, and the trace is written to that file at process
+ * exit.
+ *
+ * (As with halide_set_num_threads, this only affects the default
+ * implementation of halide_do_par_for().)
+ */
+//@{
+extern int halide_thread_pool_record_events(int max_events);
+extern int halide_thread_pool_events_json(char *buf, size_t size);
+//@}
+
 /** Halide calls these functions to allocate and free memory. To
  * replace in AOT code, use the halide_set_custom_malloc and
  * halide_set_custom_free, or (on platforms that support weak
@@ -205,6 +401,33 @@ extern halide_malloc_t halide_set_custom_malloc(halide_malloc_t user_malloc);
 extern halide_free_t halide_set_custom_free(halide_free_t user_free);
 //@}
 
+/** An alternative allocator that rounds requests up to a power of two
+ * and recycles freed blocks of the same size class instead of
+ * returning them to the system. This helps pipelines that allocate
+ * the same intermediates on every call. Install both halves with
+ * halide_set_custom_malloc(halide_pool_malloc) and
+ * halide_set_custom_free(halide_pool_free), before any allocation is
+ * made. Blocks larger than 64MB are not pooled.
+ *
+ * By default at most 256MB of free blocks are kept. Use
+ * halide_pool_allocator_set_limit to change that, and
+ * halide_pool_allocator_release to hand everything currently unused
+ * back to the system, e.g. under memory pressure.
+ */
+//@{
+extern void *halide_pool_malloc(void *user_context, size_t x);
+extern void halide_pool_free(void *user_context, void *ptr);
+extern void halide_pool_allocator_release(void *user_context);
+extern void halide_pool_allocator_set_limit(void *user_context, size_t bytes);
+//@}
+
+/** Make the default allocator align allocations of at least the given
+ * number of bytes to a 2MB boundary and ask the OS to back them with
+ * transparent huge pages, to cut down on TLB misses for large
+ * intermediates. Currently only has an effect on Linux and
+ * Android. Pass zero (the default) to disable. */
+extern void halide_set_huge_page_threshold(size_t bytes);
+
 /** Halide calls these functions to interact with the underlying
  * system runtime functions. To replace in AOT code on platforms that
  * support weak linking, define these functions yourself, or use
@@ -239,6 +462,15 @@ extern int32_t halide_debug_to_file(void *user_context, const char *filename,
                                     int32_t type_code,
                                     struct halide_buffer_t *buf);
 
+/** Wait for any debug_to_file writes still queued for the background
+ * writer to reach their files. Writes are only queued when the
+ * environment variable HL_DEBUG_TO_FILE_ASYNC=1 is set; otherwise
+ * halide_debug_to_file writes synchronously and this returns
+ * immediately. Returns the error code of the first write that failed
+ * since the last flush, or zero. Pending writes are also flushed at
+ * process exit. */
+extern int halide_debug_to_file_flush(void *user_context);
+
 /** Types in the halide type system. They can be ints, unsigned ints,
  * or floats (of various bit-widths), or a handle (which is always 64-bits).
  * Note that the int/uint/float values do not imply a specific bit width
@@ -522,6 +754,31 @@ extern int halide_get_trace_file(void *user_context);
  * (flushing the trace). Returns zero on success. */
 extern int halide_shutdown_trace();
 
+/** Keep trace packets in an in-memory ring buffer of the given size,
+ * instead of writing them to the trace file. Once the ring is full,
+ * the oldest packets are overwritten, so the memory used is bounded
+ * no matter how long tracing is left on. Pass zero to free the ring
+ * and go back to the trace file. Must not be called while a pipeline
+ * is running. Returns zero on success. */
+extern int halide_set_trace_ring_buffer(void *user_context, size_t bytes);
+
+/** Write the packets in the trace ring buffer to the given file
+ * descriptor, oldest first, in the same format as HL_TRACE_FILE, and
+ * empty the ring. Returns the number of bytes written, or -1 on
+ * failure. */
+extern int halide_dump_trace_ring_buffer(void *user_context, int fd);
+
+/** Dump the trace ring buffer to the given file descriptor whenever
+ * halide_error is called. Pass -1 (the default) to disable. */
+extern void halide_set_trace_ring_buffer_error_fd(int fd);
+
+/** Only trace every Nth load and store event, to cut down the volume
+ * of traces from the trace_loads and trace_stores target
+ * features. Zero traces no loads or stores at all, leaving only
+ * realizations, produces and consumes. Other events are always traced
+ * so that traces stay well-nested. The default is 1. */
+extern void halide_set_trace_sampling(int load_store_period);
+
 /** All Halide GPU or device backend implementations provide an
  * interface to be used with halide_device_malloc, etc. This is
  * accessed via the functions below.
@@ -591,6 +848,23 @@ extern int halide_copy_to_host(void *user_context, struct halide_buffer_t *buf);
 extern int halide_copy_to_device(void *user_context, struct halide_buffer_t *buf,
                                  const struct halide_device_interface_t *device_interface);
 
+/** Mark a region of a buffer's host memory as modified, and the buffer
+ * as host dirty. min and extent give the region in each dimension, and
+ * are clamped to the buffer. If the host and device memory were in sync
+ * before the first such call, the next halide_copy_to_device copies
+ * only the bounding box of the regions marked since, rather than the
+ * whole buffer. This needs a device interface that supports
+ * halide_device_crop. Otherwise the whole buffer is copied as usual.
+ *
+ * The caller must mark every host write made since the host and device
+ * were last in sync. Other writes (e.g. by a pipeline running on the
+ * host) are not tracked, and would be skipped by the next copy. The
+ * regions are forgotten when the buffer is next copied to or from the
+ * device, or its device memory is freed. Returns zero on success, or an
+ * error if the buffer is device dirty. */
+extern int halide_set_host_dirty_region(void *user_context, struct halide_buffer_t *buf,
+                                        const int *min, const int *extent);
+
 /** Copy data from one buffer to another. The buffers may have
  * different shapes and sizes, but the destination buffer's shape must
  * be contained within the source buffer's shape. That is, for each
@@ -676,6 +950,19 @@ extern void halide_set_gpu_device(int n);
  * HL_GPU_DEVICE. */
 extern int halide_get_gpu_device(void *user_context);
 
+/** Select the gpu device used by calls with a particular
+ * user_context, in place of the one set by halide_set_gpu_device, so
+ * that one process can drive several devices at once. The default
+ * halide_get_gpu_device checks these first. The CUDA runtime keeps a
+ * context per device. Up to 64 user_contexts can have a device at
+ * once. Returns nonzero if there's no room for another. Clear the
+ * setting when the user_context is no longer in use, as the same
+ * address may be reused as a user_context later. */
+// @{
+extern int halide_set_gpu_device_for_user_context(void *user_context, int n);
+extern void halide_clear_gpu_device_for_user_context(void *user_context);
+// @}
+
 /** Set the soft maximum amount of memory, in bytes, that the LRU
  *  cache will use to memoize Func results.  This is not a strict
  *  maximum in that concurrency and simultaneous use of memoized
@@ -684,6 +971,64 @@ extern int halide_get_gpu_device(void *user_context);
  */
 extern void halide_memoization_cache_set_size(int64_t size);
 
+/** Set a directory to use as a second, on-disk tier of the
+ *  memoization cache. Entries evicted from memory are written to
+ *  files in it, and lookups that miss in memory check it before
+ *  recomputing, so results survive process restarts. The directory
+ *  must already exist. Pass NULL or an empty string to disable. The
+ *  default is taken from the environment variable
+ *  HL_MEMOIZATION_CACHE_DIR. Nothing is ever deleted from the
+ *  directory.
+ */
+extern void halide_memoization_cache_set_persistent_dir(const char *dir);
+
+/** Usage counters for the memoization cache, as reported by
+ * halide_memoization_cache_get_stats. Counters accumulate from the
+ * start of the process, or the last call to
+ * halide_memoization_cache_reset_stats. */
+struct halide_memoization_cache_stats_t {
+    /** Lookups satisfied from memory. */
+    uint64_t hits;
+    /** Lookups satisfied from the on-disk tier. */
+    uint64_t disk_hits;
+    /** Lookups that required the result to be computed. */
+    uint64_t misses;
+    /** Results added to the cache. */
+    uint64_t insertions;
+    /** Entries removed to make room. */
+    uint64_t evictions;
+    /** Bytes of buffer data currently held, and the current limit. */
+    int64_t bytes_in_use, max_bytes;
+    /** Number of entries currently held. */
+    int32_t entries;
+};
+
+/** Fill in the current memoization cache statistics. */
+extern void halide_memoization_cache_get_stats(struct halide_memoization_cache_stats_t *stats);
+
+/** Zero the counters in the memoization cache statistics. */
+extern void halide_memoization_cache_reset_stats();
+
+/** The policy used to choose which entries to evict when the
+ * memoization cache is over its size limit. */
+typedef enum halide_memoization_eviction_policy_t {
+    /** Evict the least recently used entry first. The default. */
+    halide_memoization_evict_lru = 0,
+    /** Evict the entry with the fewest hits per byte first, so that
+     * large, rarely reused results go before small, hot ones. */
+    halide_memoization_evict_lfu_size = 1
+} halide_memoization_eviction_policy_t;
+
+extern void halide_memoization_cache_set_eviction_policy(halide_memoization_eviction_policy_t policy);
+
+/** Limit the number of bytes of memoized results held for the
+ * pipeline with the given name, in addition to the overall cache
+ * size. A pipeline at its quota evicts its own entries to make room,
+ * and results that still don't fit are not cached. A size <= 0 lifts
+ * the limit. Returns non-zero if too many pipelines (more than 32)
+ * have quotas. */
+extern int halide_memoization_cache_set_pipeline_quota(const char *pipeline_name, int64_t size);
+
 /** Given a cache key for a memoized result, currently constructed
  *  from the Func name and top-level Func name plus the arguments of
  *  the computation, determine if the result is in the cache and
@@ -741,11 +1086,35 @@ extern int halide_memoization_cache_store(void *user_context, const uint8_t *cac
   */
 extern void halide_memoization_cache_release(void *user_context, void *host);
 
+/** Hash the contents of a buffer, for the cache key of a Func memoized
+ * with MemoizeKey::ContentHash. The hash covers the buffer's type and
+ * shape, and the data of every element, which is copied to the host
+ * first if it is dirty on a device. If version is non-zero and the last
+ * buffer hashed with the same host pointer had the same shape and
+ * version, its hash is returned without reading the data; the caller
+ * must change the version whenever the data changes.
+ */
+extern uint64_t halide_memoization_cache_hash_buffer(void *user_context, struct halide_buffer_t *buf,
+                                                     uint64_t version);
+
 /** Free all memory and resources associated with the memoization cache.
  * Must be called at a time when no other threads are accessing the cache.
  */
 extern void halide_memoization_cache_cleanup();
 
+/** Pipelines compiled with the check_shapes_once target feature
+ * compute a signature of the shapes of their buffers and the values of
+ * their scalar params on each call, and skip the checks on them if
+ * halide_shape_check_cache_lookup returns true for the signature.
+ * Otherwise they run the checks, and then call
+ * halide_shape_check_cache_store with the signature. The cache holds
+ * the signatures of a few hundred recent shapes across all
+ * pipelines. */
+// @{
+extern int halide_shape_check_cache_lookup(uint64_t signature);
+extern int halide_shape_check_cache_store(uint64_t signature);
+// @}
+
 /** Create a unique file with a name of the form prefixXXXXXsuffix in an arbitrary
  * (but writable) directory; this is typically $TMP or /tmp, but the specific
  * location is not guaranteed. (Note that the exact form of the file name
@@ -1071,7 +1440,7 @@ typedef enum halide_target_feature_t {
     halide_target_feature_opengl = 21,  ///< Enable the OpenGL runtime.
     halide_target_feature_openglcompute = 22, ///< Enable OpenGL Compute runtime.
 
-    halide_target_feature_unused_23 = 23, ///< Unused. (Formerly: Enable the RenderScript runtime.)
+    halide_target_feature_wasm_threads = 23, ///< Use shared memory and atomics for a thread pool of web workers. Only relevant on WebAssembly.
 
     halide_target_feature_user_context = 24,  ///< Generated code takes a user_context pointer as first argument
 
@@ -1109,12 +1478,40 @@ typedef enum halide_target_feature_t {
     halide_target_feature_legacy_buffer_wrappers = 51,  ///< Emit legacy wrapper code for buffer_t (vs halide_buffer_t) when AOT-compiled.
     halide_target_feature_tsan = 52, ///< Enable hooks for TSAN support.
     halide_target_feature_asan = 53, ///< Enable hooks for ASAN support.
-    halide_target_feature_end = 54 ///< A sentinel. Every target is considered to have this feature, and setting this feature does nothing.
+    halide_target_feature_arena_allocations = 54, ///< Pack heap allocations made outside of loops into a single per-pipeline arena.
+    halide_target_feature_avx512_vnni = 55, ///< Enable the AVX512-VNNI dot-product instructions of Cascade Lake Xeon server processors. Use in addition to avx512_skylake or avx512_cannonlake.
+    halide_target_feature_avx512_bf16 = 56, ///< Enable the AVX512-BF16 instructions of Cooper Lake Xeon server processors. Use in addition to avx512_vnni.
+    halide_target_feature_arm_dot_prod = 57, ///< Enable the ARMv8.2 dot-product instructions (sdot and udot).
+    halide_target_feature_sve = 58, ///< Enable the ARM Scalable Vector Extension. Vectors are still 128 bits wide.
+    halide_target_feature_arm_fp16 = 59, ///< Enable ARMv8.2 half-precision arithmetic, so that Float(16) math is done in half registers rather than widened to float.
+    halide_target_feature_cuda_capability70 = 60, ///< Enable CUDA compute capability 7.0 (Volta). Tensor cores are not used.
+    halide_target_feature_cuda_capability75 = 61, ///< Enable CUDA compute capability 7.5 (Turing). Tensor cores are not used.
+    halide_target_feature_no_optimize = 62, ///< Compile quickly rather than well: skip loop partitioning and LLVM's optimization passes.
+    halide_target_feature_check_shapes_once = 63, ///< Skip the checks on the buffers and params of a pipeline when their shapes match ones that recently passed them.
+    halide_target_feature_latency_telemetry = 64, ///< Time each pipeline call and its compute_root stages with the cycle counter, and report them to the telemetry handler.
+    halide_target_feature_auto_prefetch = 65, ///< Prefetch reads with a large stride a few iterations ahead in each innermost serial loop.
+    halide_target_feature_fuse_gpu_stages = 66, ///< Merge pointwise compute_root GPU Funcs into the kernels of their only consumers.
+    halide_target_feature_fold_constant_funcs = 67, ///< Evaluate Funcs that depend on no inputs and have constant bounds at compile time, and embed the results.
+    halide_target_feature_per_task_storage = 68, ///< Give each task of a parallel loop its own storage for Funcs computed inside it that would otherwise be stored outside it, so they can slide and be folded within the task.
+    halide_target_feature_reuse_producer_storage = 69, ///< Compute a compute_root Func in place over the storage of its producer when it is the producer's only consumer and reads it only at its own coordinates.
+    halide_target_feature_threefry_random = 70, ///< Make random_float, random_int and random_uint use the Threefry-2x32 counter-based generator instead of the default hash.
+    halide_target_feature_pad_storage_strides = 71, ///< Pad the rows of intermediate allocations that would be a multiple of 1024 bytes apart by a cache line, to avoid cache set conflicts.
+    halide_target_feature_infer_compute_with = 72, ///< Fuse the loops of sibling Funcs that read the same inputs with compute_with, in lowering and in the auto-scheduler.
+    halide_target_feature_cuda_sass = 73, ///< When compiling ahead of time, embed SASS compiled with ptxas for the GPU architecture of the cuda_capability features, alongside the PTX.
+    halide_target_feature_metal_library = 74, ///< When compiling ahead of time, embed a Metal library built with xcrun alongside the Metal source.
+    halide_target_feature_riscv_v = 75, ///< Generate code for the RISC-V V vector extension (RVV 1.0). Only used with LLVM 14 or later; older LLVMs scalarize vectors.
+    halide_target_feature_memoize_simplify = 76, ///< Remember the result of simplifying each expression during lowering, and reuse it when an equal expression is simplified again.
+    halide_target_feature_intern_exprs = 77, ///< Make identical expressions share the same IR node after bounds inference and storage flattening during lowering.
+    halide_target_feature_end = 78 ///< A sentinel. Every target is considered to have this feature, and setting this feature does nothing.
 } halide_target_feature_t;
 
 /** This function is called internally by Halide in some situations to determine
  * if the current execution environment can support the given set of
- * halide_target_feature_t flags. The implementation must do the following:
+ * halide_target_feature_t flags. Bit i of features is set if the code was
+ * compiled with feature i. Only the features below 64 are passed; the
+ * ones above only change the code Halide generates, and not what the
+ * execution environment must support.
+ * The implementation must do the following:
  *
  * -- If there are flags set in features that the function knows *cannot* be supported, return 0.
  * -- Otherwise, return 1.
@@ -1426,7 +1823,8 @@ struct halide_filter_argument_t {
 };
 
 struct halide_filter_metadata_t {
-    /** version of this metadata; currently always 0. */
+    /** version of this metadata; currently always 1. Version 0 lacked
+     * the cost estimates below. */
     int32_t version;
 
     /** The number of entries in the arguments field. This is always >= 1. */
@@ -1444,6 +1842,38 @@ struct halide_filter_metadata_t {
 
     /** The function name of the filter. */
     const char* name;
+
+    /** Compile-time estimates of the cost of running the filter, for
+     * outputs of the sizes given by their estimates (see
+     * Func::estimate), and inputs of the sizes and values given by the
+     * estimates on the input parameters. Each is -1 if the filter
+     * lacks the estimates needed to compute it. */
+    // @{
+
+    /** The peak number of bytes of intermediate Func storage live at
+     * once, not counting the outputs. This assumes each non-inlined
+     * Func is stored over the whole region of it that the outputs
+     * need, so it is an upper bound for Funcs computed inside the
+     * loops of their consumers. */
+    int64_t estimated_peak_intermediate_bytes;
+
+    /** The number of arithmetic operations done, as costed by the
+     * auto-scheduler: one for each simple operation, and more for
+     * transcendental math functions. Recomputation due to the
+     * schedule is not counted. */
+    int64_t estimated_arithmetic_ops;
+
+    /** The number of bytes loaded from Funcs and input buffers. */
+    int64_t estimated_bytes_loaded;
+
+    /** The largest number of iterations of the parallel loops (or GPU
+     * blocks and threads) of any one stage, or 1 if no loop is
+     * parallel. */
+    int64_t estimated_parallelism;
+    // @}
+
+    /** Nonzero if the filter runs any loops on a GPU. */
+    int32_t uses_gpu;
 };
 
 /** The functions below here are relevant for pipelines compiled with
@@ -1470,6 +1900,19 @@ struct halide_profiler_func_stats {
     /** The average number of thread pool worker threads active while computing this Func. */
     uint64_t active_threads_numerator, active_threads_denominator;
 
+    /** Total time spent by all threads evaluating this Func (in
+     * nanoseconds). Each task of a parallel loop is sampled
+     * separately, so this can be up to the number of threads times
+     * time. */
+    uint64_t thread_time;
+
+    /** Hardware performance counter totals for this Func. Only
+     * gathered if HL_PROFILER_PERF_COUNTERS is set and the platform
+     * supports it (currently x86 linux). Counts are for the thread
+     * that called the pipeline. Code offloaded to the Hexagon
+     * simulator adds the simulated cycles it spent in each Func. */
+    uint64_t cycles, instructions, cache_misses;
+
     /** The name of this Func. A global constant string. */
     const char *name;
 
@@ -1496,6 +1939,17 @@ struct halide_profiler_pipeline_stats {
      * work while computing this pipeline. */
     uint64_t active_threads_numerator, active_threads_denominator;
 
+    /** Time summed over threads (in nanoseconds): spent evaluating the
+     * funcs of this pipeline; spent idle by threads that were not
+     * running one of its tasks while others were, counting up to the
+     * most threads ever seen running its tasks at once; and spent by
+     * tasks waiting for a nested parallel loop to finish. */
+    uint64_t thread_time, idle_time, wait_time;
+
+    /** Hardware performance counter totals for this pipeline. See
+     * halide_profiler_func_stats. */
+    uint64_t cycles, instructions, cache_misses;
+
     /** The name of this pipeline. A global constant string. */
     const char *name;
 
@@ -1506,6 +1960,10 @@ struct halide_profiler_pipeline_stats {
      * in the Halide runtime may not currently be recursive. */
     void *next;
 
+    /** Internal bookkeeping for the per-run latency histograms
+     * reported by halide_profiler_report_json. */
+    void *run_info;
+
     /** The number of funcs in this pipeline. */
     int num_funcs;
 
@@ -1563,7 +2021,10 @@ enum {
     /// Set current_func to this value to tell the profiling thread to
     /// halt. It will start up again next time you run a pipeline with
     /// profiling enabled.
-    halide_profiler_please_stop = -2
+    halide_profiler_please_stop = -2,
+    /// A task's per-thread slot takes on this value while it waits
+    /// for a nested parallel loop to finish.
+    halide_profiler_waiting_for_tasks = -3
 };
 
 /** Get a pointer to the global profiler state for programmatic
@@ -1589,10 +2050,77 @@ extern void halide_profiler_reset();
  * state without grabbing the global profiler state's lock. */
 void halide_profiler_shutdown();
 
+/** Add counts measured outside of the profiler to the hardware
+ * performance counter totals of a Func and its pipeline, e.g. the
+ * cycles a simulator spent in code offloaded from it. func_id is the
+ * id the Func had in halide_profiler_state::current_func. Funcs with
+ * cycles but no instructions are reported with just their cycles. */
+extern void halide_profiler_add_perf_counters(void *user_context, int func_id, uint64_t cycles,
+                                              uint64_t instructions, uint64_t cache_misses);
+
 /** Print out timing statistics for everything run since the last
  * reset. Also happens at process exit. */
 extern void halide_profiler_report(void *user_context);
 
+/** Write everything halide_profiler_report would print, as JSON, into
+ * buf. Also includes histograms and percentiles of the latency of
+ * each run of each pipeline, and of the time spent in each Func per
+ * run in which it was sampled. At most size bytes are written,
+ * including a null terminator. Returns the length of the full report,
+ * not counting the terminator, so call with a null buf to find the
+ * size needed. If HL_PROFILER_JSON_FILE is set, this report is also
+ * written to that file at process exit. */
+extern int halide_profiler_report_json(void *user_context, char *buf, size_t size);
+
+/** The functions below here are relevant for pipelines compiled with
+ * the latency_telemetry target feature, which time each call of the pipeline and
+ * of each of its compute_root stages with the CPU's cycle counter, and
+ * pass the timestamps to a handler at the end of each call. Unlike the
+ * profiler, there is no sampling thread; the cost is a read of the
+ * counter per stage. */
+
+/** The timestamps of one call of a pipeline. */
+struct halide_telemetry_record_t {
+    /** The name of the pipeline. */
+    const char *pipeline_name;
+
+    /** The number of stages of the pipeline that are computed at root,
+     * and their names. */
+    int32_t num_stages;
+    const char *const *stage_names;
+
+    /** 2 + 2 * num_stages timestamps: the start and end of the call,
+     * then the start and end of the production of each stage. The
+     * timestamps of stages that didn't run (e.g. in a bounds query) are
+     * zero. The ticks are those of the time stamp counter on x86, of
+     * cntvct_el0 on aarch64, and nanoseconds elsewhere. */
+    const uint64_t *ticks;
+
+    /** The length of a tick in nanoseconds, measured against
+     * halide_current_time_ns since the first report in the
+     * process. Zero until a millisecond has passed. */
+    double ns_per_tick;
+};
+
+typedef void (*halide_telemetry_t)(void *user_context, const struct halide_telemetry_record_t *record);
+
+/** Set the function called at the end of each successful call of a
+ * pipeline compiled with latency telemetry. It is called on the thread
+ * that called the pipeline, and the record is only valid during the
+ * call. No function is set by default. Returns the old function. */
+extern halide_telemetry_t halide_set_custom_telemetry(halide_telemetry_t t);
+
+/** Called at the end of each call of a pipeline compiled with latency
+ * telemetry. Passes the timestamps to the function set with
+ * halide_set_custom_telemetry, if any. */
+extern int halide_telemetry_report(void *user_context, const char *pipeline_name,
+                                   int num_stages, const char *const *stage_names,
+                                   const uint64_t *ticks);
+
+/** Read the counter pipelines compiled with latency telemetry are timed
+ * with. */
+extern uint64_t halide_telemetry_ticks();
+
 /// \name "Float16" functions
 /// These functions operate of bits (``uint16_t``) representing a half
 /// precision floating point number (IEEE-754 2008 binary16).
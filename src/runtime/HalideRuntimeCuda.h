@@ -59,6 +59,60 @@ extern int halide_cuda_detach_device_ptr(void *user_context, struct halide_buffe
  */
 extern uintptr_t halide_cuda_get_device_ptr(void *user_context, struct halide_buffer_t *buf);
 
+/** Device allocations freed by Halide are kept in a pool for reuse by
+ * later allocations in the same context, instead of being returned to
+ * the driver with cuMemFree. This frees all such pooled allocations
+ * belonging to the current context. Pooled allocations are also freed
+ * by halide_device_release, and when an allocation fails for lack of
+ * memory. */
+extern int halide_cuda_release_unused_device_allocations(void *user_context);
+
+/** In async mode, kernel launches and copies to and from the device
+ * are queued on the stream returned by halide_cuda_get_stream without
+ * waiting for them to complete, and the default halide_cuda_get_stream
+ * returns the per-thread default stream, so pipelines running on
+ * different threads (such as successive frames) can overlap. The host
+ * only waits for the device in copies to the host and in
+ * halide_device_sync. Defaults to off, in which case all copies are
+ * synchronous and everything runs on the legacy default stream. */
+extern void halide_cuda_set_async_mode(int async);
+
+/** In managed memory mode, buffers allocated on both the host and the
+ * device (with halide_device_and_host_malloc, as Halide does for
+ * buffers used by both CPU and GPU stages) are allocated with
+ * cuMemAllocManaged, so the host and device pointers are the same
+ * and the driver pages the memory between them on demand. Such
+ * buffers may be larger than device memory. Copies to and from the
+ * device become prefetches of the memory the buffer spans (which for
+ * a crop is only the cropped region) to where it's needed next, and
+ * copies to the host then wait for the device. Allocations fall back
+ * to separate host and device memory if the driver doesn't support
+ * managed memory. Buffers allocated this way must be freed with
+ * halide_device_and_host_free. Defaults to off. */
+extern void halide_cuda_set_managed_memory_mode(int managed);
+
+/** Reduce kernel launch overhead for pipelines that are run repeatedly
+ * by capturing their kernel launches in a CUDA graph. The kernels
+ * launched between halide_cuda_begin_graph and halide_cuda_end_graph
+ * with the same user_context are recorded, and at the end of the first
+ * region with a given key they're built into a graph. In later regions
+ * with the same key the launches are deferred, and
+ * halide_cuda_end_graph launches the whole graph at once, after
+ * updating any kernel arguments (such as device pointers) that
+ * changed. The key should identify the pipeline and the shapes of its
+ * buffers, as those determine which kernels are launched and with
+ * what grid sizes. If the launches in a region don't match the graph,
+ * or the host has to wait for the device in the middle of the region
+ * (for example to copy to the host), the deferred launches are issued
+ * as usual and the graph for the key is rebuilt at the end of the
+ * region. Only one region may be active at a time. Graphs are freed by
+ * halide_device_release. If the driver doesn't support graphs, these
+ * have no effect. */
+// @{
+extern int halide_cuda_begin_graph(void *user_context, uint64_t key);
+extern int halide_cuda_end_graph(void *user_context);
+// @}
+
 #ifdef __cplusplus
 } // End extern "C"
 #endif
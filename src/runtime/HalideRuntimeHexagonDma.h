@@ -0,0 +1,91 @@
+#ifndef HALIDE_HALIDERUNTIMEHEXAGONDMA_H
+#define HALIDE_HALIDERUNTIMEHEXAGONDMA_H
+
+#include "HalideRuntime.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \file
+ *  Routines specific to the Halide Hexagon user DMA runtime.
+ *
+ *  The user DMA engine of the Hexagon DSP moves 2D regions of frames
+ *  in DDR, such as camera frames, into VTCM or locked L2 without
+ *  using vector loads, decompressing UBWC frames on the way where
+ *  the hardware supports it. A frame is the device memory of a
+ *  buffer with the device interface returned by
+ *  halide_hexagon_dma_device_interface, wrapped with
+ *  halide_hexagon_dma_device_wrap_native. A Func scheduled with
+ *  copy_to_host on a wrapper of such an input then moves each tile
+ *  its consumers need with the DMA engine. Making it async and
+ *  folding its storage double-buffers the tiles, so the DMA of the
+ *  next tile overlaps the compute of the current one:
+ *
+ \code
+ Func copy = input.in().copy_to_host();
+ copy.compute_at(f, tx).store_at(f, ty).async()
+     .fold_storage(x, tile_width * 2).store_in(MemoryType::VTCM);
+ \endcode
+ *
+ *  The tiles must be aligned to the walk size the DMA engine
+ *  recommends for the frame's format.
+ */
+
+#define HALIDE_RUNTIME_HEXAGON_DMA
+
+/** The formats of frames the DMA engine can read. The _Y and _UV
+ * formats are the planes of the semi-planar formats. */
+typedef enum {
+    halide_hexagon_fmt_RawData,
+    halide_hexagon_fmt_NV12,
+    halide_hexagon_fmt_NV12_Y,
+    halide_hexagon_fmt_NV12_UV,
+    halide_hexagon_fmt_P010,
+    halide_hexagon_fmt_P010_Y,
+    halide_hexagon_fmt_P010_UV,
+    halide_hexagon_fmt_TP10,
+    halide_hexagon_fmt_TP10_Y,
+    halide_hexagon_fmt_TP10_UV,
+    halide_hexagon_fmt_NV124R,
+    halide_hexagon_fmt_NV124R_Y,
+    halide_hexagon_fmt_NV124R_UV
+} halide_hexagon_image_fmt_t;
+
+extern const struct halide_device_interface_t *halide_hexagon_dma_device_interface();
+
+/** Make the frame at the given DDR address the device memory of buf,
+ * which describes the frame's width, height and row stride. The
+ * device field of buf must be zero. The frame is not owned by buf,
+ * and isn't freed by halide_hexagon_dma_device_detach_native. */
+extern int halide_hexagon_dma_device_wrap_native(void *user_context, struct halide_buffer_t *buf,
+                                                 uint64_t mem);
+
+/** Disconnect buf from the frame it was wrapped around by
+ * halide_hexagon_dma_device_wrap_native. */
+extern int halide_hexagon_dma_device_detach_native(void *user_context, struct halide_buffer_t *buf);
+
+/** Allocate and free a DMA engine. An engine does one transfer at a
+ * time, so inputs copied concurrently should use their own. */
+// @{
+extern int halide_hexagon_dma_allocate_engine(void *user_context, void **dma_engine);
+extern int halide_hexagon_dma_deallocate_engine(void *user_context, void *dma_engine);
+// @}
+
+/** Set up a wrapped frame for copies to the host with the given DMA
+ * engine, reading it with the given format, which is compressed
+ * with UBWC if is_ubwc is set. Must be called before the frame is
+ * used by a pipeline. halide_hexagon_dma_unprepare tells the engine
+ * the frame is done. */
+// @{
+extern int halide_hexagon_dma_prepare_for_copy_to_host(void *user_context, struct halide_buffer_t *buf,
+                                                       void *dma_engine, bool is_ubwc,
+                                                       halide_hexagon_image_fmt_t fmt);
+extern int halide_hexagon_dma_unprepare(void *user_context, struct halide_buffer_t *buf);
+// @}
+
+#ifdef __cplusplus
+}  // End extern "C"
+#endif
+
+#endif  // HALIDE_HALIDERUNTIMEHEXAGONDMA_H
@@ -128,6 +128,13 @@ extern int halide_hexagon_run(void *user_context,
                               void *args[],
                               int arg_flags[]);
 extern int halide_hexagon_device_release(void* user_context);
+
+/** ION allocations freed by Halide are kept in a pool for reuse by
+ * later device allocations, still mapped and registered with FastRPC,
+ * rather than being freed. This frees all such pooled allocations.
+ * They are also freed by halide_hexagon_device_release, and when an
+ * ION allocation fails. */
+extern int halide_hexagon_release_unused_device_allocations(void *user_context);
 // @}
 
 #ifdef __cplusplus
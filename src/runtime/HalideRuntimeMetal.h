@@ -54,6 +54,14 @@ extern int halide_metal_wrap_buffer(void *user_context, struct halide_buffer_t *
  */
 extern int halide_metal_detach_buffer(void *user_context, struct halide_buffer_t *buf);
 
+/** Give a halide_buffer_t an MTLBuffer that uses its existing host
+ * memory as storage (newBufferWithBytesNoCopy), for example the base
+ * address of a locked CVPixelBuffer. Copies between host and device
+ * are then skipped. The host pointer must be page aligned, and the
+ * dev field must be NULL. Free the MTLBuffer with halide_device_free,
+ * which leaves the host memory allocated. */
+extern int halide_metal_wrap_host_memory(void *user_context, struct halide_buffer_t *buf);
+
 /** Return the underlying MTLBuffer for a halide_buffer_t. This buffer must be
  * valid on an Metal device, or not have any associated device
  * memory. If there is no device memory (dev field is NULL), this
@@ -64,6 +72,16 @@ extern uintptr_t halide_metal_get_buffer(void *user_context, struct halide_buffe
 /** Returns the offset associated with the Metal Buffer allocation via device_crop. */
 extern uint64_t halide_metal_get_crop_offset(void *user_context, struct halide_buffer_t *buf);
 
+/** In batch mode, halide_metal_run encodes kernels into a single
+ * command buffer, which is only committed when the results are
+ * needed: by halide_device_sync, by a copy to or from the device, or
+ * by a kernel run after batch mode is turned off. So all the kernels
+ * of a pipeline invocation are submitted together, and the host
+ * must call halide_device_sync (or copy the outputs to the host)
+ * before using the outputs on the device by other means. Defaults to
+ * off, in which case each kernel is committed as it is run. */
+extern void halide_metal_set_batch_mode(int batch);
+
 struct halide_metal_device;
 struct halide_metal_command_queue;
 
@@ -0,0 +1,82 @@
+#ifndef HALIDE_HALIDERUNTIMENATIVEBUFFER_H
+#define HALIDE_HALIDERUNTIMENATIVEBUFFER_H
+
+#include "HalideRuntime.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \file
+ *  Routines for wrapping the image buffers of Android and Apple
+ *  platforms as halide_buffer_t, without copying them.
+ *
+ *  Each wrap routine locks the native buffer for CPU access and points
+ *  the host field of a halide_buffer_t at the locked memory, filling
+ *  in its type and the extents and strides of its dimensions. The
+ *  halide_buffer_t must have a dim array with room for its dimensions
+ *  field, which must be 2 for single channel images, 3 (x, y and
+ *  interleaved channels) for others, and 1 for raw data. Its host and
+ *  device fields must be zero.
+ *
+ *  To use the memory on a GPU as well, pass the wrapped buffer to
+ *  halide_opencl_wrap_host_memory or halide_metal_wrap_host_memory,
+ *  which make a device buffer over the same storage. The unwrap
+ *  routines copy back and free any such device buffer before
+ *  unlocking the native buffer.
+ */
+
+struct AHardwareBuffer;
+
+/** Lock an Android AHardwareBuffer (API level 26 and up) and wrap it
+ * in buf. The buffer must have a single plane format: RGBA or RGBX
+ * 8888 and RGB 888 wrap as 4 or 3 channel uint8 images, R8 as a 1
+ * channel uint8 image, RGBA FP16 as a 4 channel float16 image, and
+ * BLOB as a 1D uint8 buffer of the buffer's width in bytes. */
+extern int halide_android_hardware_buffer_wrap(void *user_context, struct halide_buffer_t *buf,
+                                               struct AHardwareBuffer *hardware_buffer);
+
+/** Lock a Y8Cb8Cr8_420 Android AHardwareBuffer (API level 29 and up)
+ * and wrap its planes in three 2D uint8 buffers. The chroma planes
+ * are half the size of the luma plane in each dimension, and have an
+ * x stride of 2 when the buffer is semi-planar. */
+extern int halide_android_hardware_buffer_wrap_yuv(void *user_context, struct AHardwareBuffer *hardware_buffer,
+                                                   struct halide_buffer_t *y, struct halide_buffer_t *u,
+                                                   struct halide_buffer_t *v);
+
+/** Unlock an AHardwareBuffer wrapped by
+ * halide_android_hardware_buffer_wrap, and clear the host field of
+ * buf. */
+extern int halide_android_hardware_buffer_unwrap(void *user_context, struct halide_buffer_t *buf,
+                                                 struct AHardwareBuffer *hardware_buffer);
+
+/** Unlock an AHardwareBuffer wrapped by
+ * halide_android_hardware_buffer_wrap_yuv, and clear the host fields
+ * of its planes. */
+extern int halide_android_hardware_buffer_unwrap_yuv(void *user_context, struct AHardwareBuffer *hardware_buffer,
+                                                     struct halide_buffer_t *y, struct halide_buffer_t *u,
+                                                     struct halide_buffer_t *v);
+
+/** Lock a plane of a CVPixelBufferRef on iOS or OS X and wrap it in
+ * buf. Non-planar buffers have only plane 0. 32BGRA, 32RGBA and
+ * 32ARGB wrap as 4 channel uint8 images, 24RGB as a 3 channel uint8
+ * image, OneComponent8 as a 1 channel uint8 image, 64RGBAHalf and
+ * OneComponent16Half as 4 and 1 channel float16 images, and
+ * 128RGBAFloat as a 4 channel float image. Plane 0 of a 420YpCbCr8
+ * bi-planar buffer is a 1 channel uint8 image, and plane 1 a 2
+ * channel one. Pixel buffers backed by an IOSurface have page aligned
+ * planes, which halide_metal_wrap_host_memory requires. */
+extern int halide_cv_pixel_buffer_wrap(void *user_context, struct halide_buffer_t *buf,
+                                       void *pixel_buffer, int plane);
+
+/** Unlock a CVPixelBufferRef wrapped by halide_cv_pixel_buffer_wrap,
+ * and clear the host field of buf. Each plane wrapped must be
+ * unwrapped. */
+extern int halide_cv_pixel_buffer_unwrap(void *user_context, struct halide_buffer_t *buf,
+                                         void *pixel_buffer);
+
+#ifdef __cplusplus
+} // End extern "C"
+#endif
+
+#endif // HALIDE_HALIDERUNTIMENATIVEBUFFER_H
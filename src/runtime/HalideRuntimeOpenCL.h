@@ -63,6 +63,38 @@ extern void halide_opencl_set_device_type(const char *n);
  * halide_set_ocl_device_type. */
 extern const char *halide_opencl_get_device_type(void *user_context);
 
+/** Set a directory in which compiled OpenCL programs are cached, so
+ * that later processes can load the binary instead of compiling the
+ * kernel source again. Binaries are only reused for the same source,
+ * build options, device, device version and driver version. The
+ * argument is copied internally. If never called, Halide uses the
+ * environment variable HL_OCL_PROGRAM_CACHE_DIR. If neither is set,
+ * or the directory is empty, nothing is cached. */
+extern void halide_opencl_set_program_cache_dir(const char *dir);
+
+/** Halide calls this to get the directory in which to cache compiled
+ * OpenCL programs. The default implementation returns the value set
+ * by halide_opencl_set_program_cache_dir, or the environment variable
+ * HL_OCL_PROGRAM_CACHE_DIR. */
+extern const char *halide_opencl_get_program_cache_dir(void *user_context);
+
+/** Set whether to create the OpenCL command queue out-of-order
+ * (CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE), which lets copies and
+ * kernels that use different buffers overlap on devices that support
+ * it. Commands that use the same buffer are ordered by events either
+ * way, and the host only waits for commands where it reads their
+ * results. Code that uses Halide's cl_mem objects directly on the
+ * queue must then order its own commands with halide_device_sync. Only
+ * takes effect when the context is created. If never called, Halide
+ * uses the environment variable HL_OCL_OUT_OF_ORDER. */
+extern void halide_opencl_set_out_of_order_queue(int enable);
+
+/** Halide calls this to get whether to create an out-of-order command
+ * queue. The default implementation returns the value set by
+ * halide_opencl_set_out_of_order_queue, or whether the environment
+ * variable HL_OCL_OUT_OF_ORDER is 1. */
+extern int halide_opencl_get_out_of_order_queue(void *user_context);
+
 /** Set the underlying cl_mem for a halide_buffer_t. This memory should be
  * allocated using clCreateBuffer or similar and must have an extent
  * large enough to cover that specified by the halide_buffer_t extent
@@ -81,6 +113,15 @@ extern int halide_opencl_wrap_cl_mem(void *user_context, struct halide_buffer_t
  */
 extern int halide_opencl_detach_cl_mem(void *user_context, struct halide_buffer_t *buf);
 
+/** Give a halide_buffer_t a cl_mem that uses its existing host memory
+ * as storage (CL_MEM_USE_HOST_PTR), for example memory mapped from an
+ * Android AHardwareBuffer. On devices that share memory with the
+ * host, copies between host and device then map or unmap the cl_mem
+ * instead of copying. The host field must be set, and the dev field
+ * must be NULL. Free the cl_mem with halide_device_free, which hands
+ * the host memory back to the host and leaves it allocated. */
+extern int halide_opencl_wrap_host_memory(void *user_context, struct halide_buffer_t *buf);
+
 /** Return the underlying cl_mem for a halide_buffer_t. This buffer must be
  *  valid on an OpenCL device, or not have any associated device
  *  memory. If there is no device memory (dev field is NULL), this
@@ -91,6 +132,14 @@ extern uintptr_t halide_opencl_get_cl_mem(void *user_context, struct halide_buff
 /** Returns the offset associated with the OpenCL memory allocation via device_crop. */
 extern uint64_t halide_opencl_get_crop_offset(void *user_context, halide_buffer_t *buf);
 
+/** Device buffers freed by Halide are kept in a pool for reuse by
+ * later allocations in the same context, instead of being released
+ * with clReleaseMemObject. This releases all such pooled buffers
+ * belonging to the current context. Pooled buffers are also released
+ * by halide_device_release, and when an allocation fails for lack of
+ * memory. */
+extern int halide_opencl_release_unused_device_allocations(void *user_context);
+
 #ifdef __cplusplus
 } // End extern "C"
 #endif
@@ -20,6 +20,15 @@ extern int halide_qurt_hvx_unlock(void *user_context);
 extern void halide_qurt_hvx_unlock_as_destructor(void *user_context, void * /*obj*/);
 // @}
 
+/** Allocate and free memory in the VTCM scratchpad of Hexagon v65 and
+ * later, for allocations with MemoryType::VTCM. If VTCM isn't available
+ * or is exhausted, halide_vtcm_malloc falls back to halide_malloc, and
+ * halide_vtcm_free frees either kind. */
+// @{
+extern void *halide_vtcm_malloc(void *user_context, size_t size);
+extern void halide_vtcm_free(void *user_context, void *ptr);
+// @}
+
 #ifdef __cplusplus
 } // End extern "C"
 #endif
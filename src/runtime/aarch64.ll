@@ -179,6 +179,85 @@ define weak_odr <2 x double> @sqrt_f64x2(<2 x double> %x) nounwind alwaysinline
        ret <2 x double> %tmp
 }
 
+; Half-precision math. With the fullfp16 extension these stay in half
+; registers; otherwise llvm widens them to float.
+
+declare half @llvm.sqrt.f16(half);
+declare <4 x half> @llvm.sqrt.v4f16(<4 x half>);
+declare <8 x half> @llvm.sqrt.v8f16(<8 x half>);
+
+define weak_odr half @sqrt_f16(half %x) nounwind alwaysinline {
+       %tmp = call half @llvm.sqrt.f16(half %x)
+       ret half %tmp
+}
+
+define weak_odr <4 x half> @sqrt_f16x4(<4 x half> %x) nounwind alwaysinline {
+       %tmp = call <4 x half> @llvm.sqrt.v4f16(<4 x half> %x)
+       ret <4 x half> %tmp
+}
+
+define weak_odr <8 x half> @sqrt_f16x8(<8 x half> %x) nounwind alwaysinline {
+       %tmp = call <8 x half> @llvm.sqrt.v8f16(<8 x half> %x)
+       ret <8 x half> %tmp
+}
+
+declare half @llvm.floor.f16(half);
+declare <4 x half> @llvm.floor.v4f16(<4 x half>);
+declare <8 x half> @llvm.floor.v8f16(<8 x half>);
+
+define weak_odr half @floor_f16(half %x) nounwind alwaysinline {
+       %tmp = call half @llvm.floor.f16(half %x)
+       ret half %tmp
+}
+
+define weak_odr <4 x half> @floor_f16x4(<4 x half> %x) nounwind alwaysinline {
+       %tmp = call <4 x half> @llvm.floor.v4f16(<4 x half> %x)
+       ret <4 x half> %tmp
+}
+
+define weak_odr <8 x half> @floor_f16x8(<8 x half> %x) nounwind alwaysinline {
+       %tmp = call <8 x half> @llvm.floor.v8f16(<8 x half> %x)
+       ret <8 x half> %tmp
+}
+
+declare half @llvm.ceil.f16(half);
+declare <4 x half> @llvm.ceil.v4f16(<4 x half>);
+declare <8 x half> @llvm.ceil.v8f16(<8 x half>);
+
+define weak_odr half @ceil_f16(half %x) nounwind alwaysinline {
+       %tmp = call half @llvm.ceil.f16(half %x)
+       ret half %tmp
+}
+
+define weak_odr <4 x half> @ceil_f16x4(<4 x half> %x) nounwind alwaysinline {
+       %tmp = call <4 x half> @llvm.ceil.v4f16(<4 x half> %x)
+       ret <4 x half> %tmp
+}
+
+define weak_odr <8 x half> @ceil_f16x8(<8 x half> %x) nounwind alwaysinline {
+       %tmp = call <8 x half> @llvm.ceil.v8f16(<8 x half> %x)
+       ret <8 x half> %tmp
+}
+
+declare half @llvm.trunc.f16(half);
+declare <4 x half> @llvm.trunc.v4f16(<4 x half>);
+declare <8 x half> @llvm.trunc.v8f16(<8 x half>);
+
+define weak_odr half @trunc_f16(half %x) nounwind alwaysinline {
+       %tmp = call half @llvm.trunc.f16(half %x)
+       ret half %tmp
+}
+
+define weak_odr <4 x half> @trunc_f16x4(<4 x half> %x) nounwind alwaysinline {
+       %tmp = call <4 x half> @llvm.trunc.v4f16(<4 x half> %x)
+       ret <4 x half> %tmp
+}
+
+define weak_odr <8 x half> @trunc_f16x8(<8 x half> %x) nounwind alwaysinline {
+       %tmp = call <8 x half> @llvm.trunc.v8f16(<8 x half> %x)
+       ret <8 x half> %tmp
+}
+
 declare <4 x float> @llvm.aarch64.neon.frecpe.v4f32(<4 x float> %x) nounwind readnone;
 declare <2 x float> @llvm.aarch64.neon.frecpe.v2f32(<2 x float> %x) nounwind readnone;
 declare <4 x float> @llvm.aarch64.neon.frsqrte.v4f32(<4 x float> %x) nounwind readnone;
@@ -231,3 +310,11 @@ define weak_odr <4 x float> @fast_inverse_sqrt_f32x4(<4 x float> %x) nounwind al
        %result = fmul <4 x float> %approx, %correction
        ret <4 x float> %result
 }
+
+; The cycle counter read by pipelines compiled with latency
+; telemetry. This is the virtual counter, which is readable from user
+; space, unlike the PMU cycle counter llvm.readcyclecounter reads.
+define weak_odr i64 @halide_telemetry_ticks() nounwind alwaysinline {
+       %ticks = tail call i64 asm sideeffect "mrs $0, cntvct_el0", "=r"()
+       ret i64 %ticks
+}
@@ -0,0 +1,245 @@
+#include "runtime_internal.h"
+#include "HalideRuntimeNativeBuffer.h"
+#include "native_buffer_utils.h"
+#include "printer.h"
+
+extern "C" {
+
+// From android/hardware_buffer.h
+typedef struct AHardwareBuffer_Desc {
+    uint32_t width;
+    uint32_t height;
+    uint32_t layers;
+    uint32_t format;
+    uint64_t usage;
+    uint32_t stride;
+    uint32_t rfu0;
+    uint64_t rfu1;
+} AHardwareBuffer_Desc;
+
+typedef struct AHardwareBuffer_Plane {
+    void *data;
+    uint32_t pixelStride;
+    uint32_t rowStride;
+} AHardwareBuffer_Plane;
+
+typedef struct AHardwareBuffer_Planes {
+    uint32_t planeCount;
+    AHardwareBuffer_Plane planes[4];
+} AHardwareBuffer_Planes;
+
+}  // extern "C"
+
+namespace Halide { namespace Runtime { namespace Internal { namespace AndroidHardwareBuffer {
+
+enum {
+    AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM = 1,
+    AHARDWAREBUFFER_FORMAT_R8G8B8X8_UNORM = 2,
+    AHARDWAREBUFFER_FORMAT_R8G8B8_UNORM = 3,
+    AHARDWAREBUFFER_FORMAT_R16G16B16A16_FLOAT = 0x16,
+    AHARDWAREBUFFER_FORMAT_BLOB = 0x21,
+    AHARDWAREBUFFER_FORMAT_Y8Cb8Cr8_420 = 0x23,
+    AHARDWAREBUFFER_FORMAT_R8_UNORM = 0x38,
+};
+
+const uint64_t cpu_usage = 3ULL /* AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN */ |
+                           (3ULL << 4) /* AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN */;
+
+// The AHardwareBuffer API is in libandroid, which an app process
+// always has loaded, but which pipelines aren't linked against. Look
+// it up when first used instead.
+typedef void (*describe_fn)(const AHardwareBuffer *, AHardwareBuffer_Desc *);
+typedef int (*lock_fn)(AHardwareBuffer *, uint64_t, int32_t, const void *, void **);
+typedef int (*lock_planes_fn)(AHardwareBuffer *, uint64_t, int32_t, const void *, AHardwareBuffer_Planes *);
+typedef int (*unlock_fn)(AHardwareBuffer *, int32_t *);
+
+WEAK describe_fn AHardwareBuffer_describe = NULL;
+WEAK lock_fn AHardwareBuffer_lock = NULL;
+WEAK lock_planes_fn AHardwareBuffer_lockPlanes = NULL;
+WEAK unlock_fn AHardwareBuffer_unlock = NULL;
+
+WEAK void *get_android_symbol(const char *name) {
+    void *symbol = halide_get_symbol(name);
+    if (!symbol) {
+        void *lib = halide_load_library("libandroid.so");
+        if (lib) {
+            symbol = halide_get_library_symbol(lib, name);
+        }
+    }
+    return symbol;
+}
+
+WEAK bool load_hardware_buffer_api(void *user_context) {
+    if (AHardwareBuffer_unlock == NULL) {
+        AHardwareBuffer_describe = (describe_fn)get_android_symbol("AHardwareBuffer_describe");
+        AHardwareBuffer_lock = (lock_fn)get_android_symbol("AHardwareBuffer_lock");
+        // Only available from API level 29.
+        AHardwareBuffer_lockPlanes = (lock_planes_fn)get_android_symbol("AHardwareBuffer_lockPlanes");
+        AHardwareBuffer_unlock = (unlock_fn)get_android_symbol("AHardwareBuffer_unlock");
+    }
+    if (AHardwareBuffer_describe == NULL || AHardwareBuffer_lock == NULL || AHardwareBuffer_unlock == NULL) {
+        error(user_context) << "AHardwareBuffer API not found (requires API level 26).\n";
+        return false;
+    }
+    return true;
+}
+
+}}}}  // namespace Halide::Runtime::Internal::AndroidHardwareBuffer
+
+using namespace Halide::Runtime::Internal::AndroidHardwareBuffer;
+
+extern "C" {
+
+WEAK int halide_android_hardware_buffer_wrap(void *user_context, struct halide_buffer_t *buf,
+                                             struct AHardwareBuffer *hardware_buffer) {
+    debug(user_context)
+        << "halide_android_hardware_buffer_wrap (user_context: " << user_context
+        << ", buf: " << buf << ", hardware_buffer: " << hardware_buffer << ")\n";
+
+    if (!load_hardware_buffer_api(user_context)) {
+        return halide_error_code_generic_error;
+    }
+
+    AHardwareBuffer_Desc desc;
+    AHardwareBuffer_describe(hardware_buffer, &desc);
+
+    halide_type_t type(halide_type_uint, 8);
+    int channels = 0;
+    switch (desc.format) {
+    case AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM:
+    case AHARDWAREBUFFER_FORMAT_R8G8B8X8_UNORM:
+        channels = 4;
+        break;
+    case AHARDWAREBUFFER_FORMAT_R8G8B8_UNORM:
+        channels = 3;
+        break;
+    case AHARDWAREBUFFER_FORMAT_R8_UNORM:
+        channels = 1;
+        break;
+    case AHARDWAREBUFFER_FORMAT_R16G16B16A16_FLOAT:
+        type = halide_type_t(halide_type_float, 16);
+        channels = 4;
+        break;
+    case AHARDWAREBUFFER_FORMAT_BLOB:
+        break;
+    default:
+        error(user_context) << "Can't wrap an AHardwareBuffer of format " << desc.format << ".\n";
+        return halide_error_code_generic_error;
+    }
+
+    if (channels == 0 && buf->dimensions != 1) {
+        error(user_context) << "A BLOB AHardwareBuffer must be wrapped in a 1D halide_buffer_t.\n";
+        return halide_error_code_generic_error;
+    }
+
+    void *host = NULL;
+    int err = AHardwareBuffer_lock(hardware_buffer, cpu_usage, -1, NULL, &host);
+    if (err != 0 || host == NULL) {
+        error(user_context) << "AHardwareBuffer_lock failed: " << err << "\n";
+        return halide_error_code_generic_error;
+    }
+
+    if (channels == 0) {
+        buf->host = (uint8_t *)host;
+        buf->type = type;
+        buf->flags = 0;
+        buf->dim[0].min = 0;
+        buf->dim[0].extent = desc.width;
+        buf->dim[0].stride = 1;
+        buf->dim[0].flags = 0;
+        return 0;
+    }
+    // The stride of the description is in pixels.
+    err = set_image_shape(user_context, buf, host, type, desc.width, desc.height,
+                          channels, channels, desc.stride * channels);
+    if (err != 0) {
+        AHardwareBuffer_unlock(hardware_buffer, NULL);
+    }
+    return err;
+}
+
+WEAK int halide_android_hardware_buffer_wrap_yuv(void *user_context, struct AHardwareBuffer *hardware_buffer,
+                                                 struct halide_buffer_t *y, struct halide_buffer_t *u,
+                                                 struct halide_buffer_t *v) {
+    debug(user_context)
+        << "halide_android_hardware_buffer_wrap_yuv (user_context: " << user_context
+        << ", hardware_buffer: " << hardware_buffer << ")\n";
+
+    if (!load_hardware_buffer_api(user_context)) {
+        return halide_error_code_generic_error;
+    }
+    if (AHardwareBuffer_lockPlanes == NULL) {
+        error(user_context) << "AHardwareBuffer_lockPlanes not found (requires API level 29).\n";
+        return halide_error_code_generic_error;
+    }
+
+    AHardwareBuffer_Desc desc;
+    AHardwareBuffer_describe(hardware_buffer, &desc);
+    if (desc.format != AHARDWAREBUFFER_FORMAT_Y8Cb8Cr8_420) {
+        error(user_context) << "Can't wrap an AHardwareBuffer of format " << desc.format << " as YUV.\n";
+        return halide_error_code_generic_error;
+    }
+
+    AHardwareBuffer_Planes planes;
+    int err = AHardwareBuffer_lockPlanes(hardware_buffer, cpu_usage, -1, NULL, &planes);
+    if (err != 0 || planes.planeCount != 3) {
+        error(user_context) << "AHardwareBuffer_lockPlanes failed: " << err << "\n";
+        if (err == 0) {
+            AHardwareBuffer_unlock(hardware_buffer, NULL);
+        }
+        return halide_error_code_generic_error;
+    }
+
+    halide_buffer_t *bufs[] = {y, u, v};
+    for (int i = 0; i < 3; i++) {
+        const AHardwareBuffer_Plane &p = planes.planes[i];
+        int width = i == 0 ? desc.width : desc.width / 2;
+        int height = i == 0 ? desc.height : desc.height / 2;
+        err = set_image_shape(user_context, bufs[i], p.data, halide_type_t(halide_type_uint, 8),
+                              width, height, 1, p.pixelStride, p.rowStride);
+        if (err != 0) {
+            for (int j = 0; j < i; j++) {
+                bufs[j]->host = NULL;
+            }
+            AHardwareBuffer_unlock(hardware_buffer, NULL);
+            return err;
+        }
+    }
+    return 0;
+}
+
+WEAK int halide_android_hardware_buffer_unwrap(void *user_context, struct halide_buffer_t *buf,
+                                               struct AHardwareBuffer *hardware_buffer) {
+    debug(user_context)
+        << "halide_android_hardware_buffer_unwrap (user_context: " << user_context
+        << ", buf: " << buf << ", hardware_buffer: " << hardware_buffer << ")\n";
+
+    if (!load_hardware_buffer_api(user_context)) {
+        return halide_error_code_generic_error;
+    }
+    int result = release_device_over_host(user_context, buf);
+    buf->host = NULL;
+    // Waits for any writes to finish.
+    int err = AHardwareBuffer_unlock(hardware_buffer, NULL);
+    if (err != 0) {
+        error(user_context) << "AHardwareBuffer_unlock failed: " << err << "\n";
+        return halide_error_code_generic_error;
+    }
+    return result;
+}
+
+WEAK int halide_android_hardware_buffer_unwrap_yuv(void *user_context, struct AHardwareBuffer *hardware_buffer,
+                                                   struct halide_buffer_t *y, struct halide_buffer_t *u,
+                                                   struct halide_buffer_t *v) {
+    int result = release_device_over_host(user_context, u);
+    int v_result = release_device_over_host(user_context, v);
+    u->host = NULL;
+    v->host = NULL;
+    int y_result = halide_android_hardware_buffer_unwrap(user_context, y, hardware_buffer);
+    if (result == 0) {
+        result = v_result;
+    }
+    return result != 0 ? result : y_result;
+}
+
+}  // extern "C"
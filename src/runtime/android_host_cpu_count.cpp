@@ -1,12 +1,67 @@
 #include "HalideRuntime.h"
+#include "runtime_internal.h"
 
 extern "C" {
 
 extern long sysconf(int);
+extern int sched_setaffinity(int pid, size_t cpusetsize, const void *mask);
+extern int madvise(void *addr, size_t length, int advice);
 
 WEAK int halide_host_cpu_count() {
     // Works for Android ARMv7. Probably bogus on other platforms.
     return sysconf(97);
 }
 
+WEAK int halide_set_current_thread_affinity(int cpu) {
+    // Large enough for a bionic cpu_set_t.
+    uint64_t mask[16] = {};
+    if (cpu < 0 || cpu >= 1024) {
+        return -1;
+    }
+    mask[cpu / 64] = (uint64_t)1 << (cpu % 64);
+    return sched_setaffinity(0, sizeof(mask), mask);
+}
+
+WEAK int halide_host_cpu_capacities(int *capacities, int max_cpus) {
+    // The capacities of big.LITTLE cores are in sysfs. Older kernels
+    // only have their maximum frequencies, which are as good a guide.
+    const char *files[] = {"cpu_capacity", "cpufreq/cpuinfo_max_freq"};
+    int count = halide_host_cpu_count();
+    int n = 0;
+    for (int cpu = 0; cpu < count && n < max_cpus; cpu++) {
+        int capacity = 0;
+        for (const char *file : files) {
+            char path[96];
+            char *end = path + sizeof(path);
+            char *p = halide_string_to_string(path, end, "/sys/devices/system/cpu/cpu");
+            p = halide_int64_to_string(p, end, cpu, 1);
+            p = halide_string_to_string(p, end, "/");
+            halide_string_to_string(p, end, file);
+            void *f = fopen(path, "r");
+            if (!f) {
+                continue;
+            }
+            char buf[32];
+            size_t len = fread(buf, 1, sizeof(buf) - 1, f);
+            fclose(f);
+            buf[len] = 0;
+            capacity = atoi(buf);
+            if (capacity > 0) {
+                break;
+            }
+        }
+        if (capacity <= 0) {
+            return 0;
+        }
+        capacities[n++] = capacity;
+    }
+    return n;
+}
+
+WEAK int halide_advise_huge_pages(void *ptr, size_t size) {
+    // MADV_HUGEPAGE. Fails harmlessly on kernels without transparent
+    // huge page support.
+    return madvise(ptr, size, 14);
+}
+
 }
@@ -75,6 +75,10 @@ struct CacheEntry {
     uint32_t hash;
     uint32_t in_use_count; // 0 if none returned from halide_cache_lookup
     uint32_t tuple_count;
+    // Number of lookups that have hit this entry, for the LFU policy.
+    uint32_t hit_count;
+    // Index into pipeline_quotas, or -1 if the pipeline has no quota.
+    int32_t quota_index;
     // The shape of the computed data. There may be more data allocated than this.
     int32_t dimensions;
     halide_dimension_t *computed_bounds;
@@ -120,6 +124,8 @@ WEAK bool CacheEntry::init(const uint8_t *cache_key, size_t cache_key_size,
     hash = key_hash;
     in_use_count = 0;
     tuple_count = tuples;
+    hit_count = 0;
+    quota_index = -1;
     dimensions = computed_bounds_buf->dimensions;
 
     // Allocate all the necessary space (or die)
@@ -169,6 +175,14 @@ WEAK bool CacheEntry::init(const uint8_t *cache_key, size_t cache_key_size,
     return true;
 }
 
+WEAK uint64_t entry_bytes(const CacheEntry *entry) {
+    uint64_t bytes = 0;
+    for (uint32_t i = 0; i < entry->tuple_count; i++) {
+        bytes += entry->buf[i].size_in_bytes();
+    }
+    return bytes;
+}
+
 WEAK void CacheEntry::destroy() {
     for (uint32_t i = 0; i < tuple_count; i++) {
         halide_device_free(NULL, &buf[i]);
@@ -185,34 +199,122 @@ WEAK uint32_t djb_hash(const uint8_t *key, size_t key_size)  {
     return h;
 }
 
-WEAK halide_mutex memoization_lock = { { 0 } };
-
+// The cache is split into shards by key hash. Each shard has its own
+// lock, hash buckets, and LRU list, so lookups of unrelated keys from
+// different threads don't serialize on a single lock. The size limit
+// applies to the sum over all shards.
+const size_t kCacheShards = 16;
 const size_t kHashTableSize = 256;
+const size_t kBucketsPerShard = kHashTableSize / kCacheShards;
+
+struct CacheShard {
+    halide_mutex lock;
+    CacheEntry *entries[kBucketsPerShard];
+    CacheEntry *most_recently_used;
+    CacheEntry *least_recently_used;
+    // Bytes of buffer data held by this shard.
+    int64_t current_size;
+    int32_t num_entries;
+    // Counters reported by halide_memoization_cache_get_stats.
+    uint64_t hits, disk_hits, misses, insertions, evictions;
+};
 
-WEAK CacheEntry *cache_entries[kHashTableSize];
+WEAK CacheShard cache_shards[kCacheShards];
 
-WEAK CacheEntry *most_recently_used = NULL;
-WEAK CacheEntry *least_recently_used = NULL;
+WEAK __attribute((always_inline)) CacheShard *shard_for_hash(uint32_t h) {
+    return &cache_shards[h % kCacheShards];
+}
+
+WEAK __attribute((always_inline)) CacheEntry **bucket_for_hash(CacheShard *shard, uint32_t h) {
+    return &shard->entries[(h / kCacheShards) % kBucketsPerShard];
+}
 
 const uint64_t kDefaultCacheSize = 1 << 20;
 WEAK int64_t max_cache_size = kDefaultCacheSize;
-WEAK int64_t current_cache_size = 0;
+
+WEAK halide_memoization_eviction_policy_t eviction_policy = halide_memoization_evict_lru;
+
+// Optional per-pipeline limits on cache usage, keyed by the name of
+// the top-level pipeline. Only consulted when num_pipeline_quotas is
+// non-zero, so pipelines without quotas never take quota_lock.
+const int kMaxPipelineQuotas = 32;
+
+struct PipelineQuota {
+    char name[128];
+    int64_t quota;
+    int64_t used;
+};
+
+WEAK halide_mutex quota_lock = { { 0 } };
+WEAK PipelineQuota pipeline_quotas[kMaxPipelineQuotas];
+WEAK int num_pipeline_quotas = 0;
+
+// Find the quota for the pipeline a cache key belongs to. The key
+// starts with a pointer to a string of the form
+// "<length>:<pipeline name><length>:<func name>" (see
+// Memoization.cpp).
+WEAK int32_t find_pipeline_quota(const uint8_t *key, size_t key_size) {
+    if (num_pipeline_quotas == 0 || key_size < sizeof(const char *)) {
+        return -1;
+    }
+    const char *name;
+    memcpy(&name, key, sizeof(const char *));
+    size_t len = 0;
+    while (*name >= '0' && *name <= '9') {
+        len = len * 10 + (*name++ - '0');
+    }
+    if (*name++ != ':') {
+        return -1;
+    }
+    ScopedMutexLock lock(&quota_lock);
+    for (int i = 0; i < num_pipeline_quotas; i++) {
+        if (strlen(pipeline_quotas[i].name) == len &&
+            strncmp(pipeline_quotas[i].name, name, len) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+WEAK void adjust_quota_usage(int32_t quota_index, int64_t delta) {
+    if (quota_index >= 0) {
+        ScopedMutexLock lock(&quota_lock);
+        pipeline_quotas[quota_index].used += delta;
+    }
+}
+
+WEAK bool quota_exceeded(int32_t quota_index) {
+    ScopedMutexLock lock(&quota_lock);
+    return pipeline_quotas[quota_index].used > pipeline_quotas[quota_index].quota;
+}
+
+// The total is read without taking the shard locks, so it may be
+// slightly stale. That's fine for deciding when to prune.
+WEAK int64_t current_cache_size() {
+    int64_t total = 0;
+    for (size_t i = 0; i < kCacheShards; i++) {
+        total += cache_shards[i].current_size;
+    }
+    return total;
+}
 
 #if CACHE_DEBUGGING
-WEAK void validate_cache() {
-    print(NULL) << "validating cache, "
-                << "current size " << current_cache_size
+// Must be called with the shard lock held.
+WEAK void validate_shard(CacheShard *shard) {
+    print(NULL) << "validating cache shard " << (int)(shard - cache_shards) << ", "
+                << "current size " << shard->current_size
+                << ", total " << current_cache_size()
                 << " of maximum " << max_cache_size << "\n";
     int entries_in_hash_table = 0;
-    for (size_t i = 0; i < kHashTableSize; i++) {
-        CacheEntry *entry = cache_entries[i];
+    for (size_t i = 0; i < kBucketsPerShard; i++) {
+        CacheEntry *entry = shard->entries[i];
         while (entry != NULL) {
             entries_in_hash_table++;
-            if (entry->more_recent == NULL && entry != most_recently_used) {
+            if (entry->more_recent == NULL && entry != shard->most_recently_used) {
                 halide_print(NULL, "cache invalid case 1\n");
                 __builtin_trap();
             }
-            if (entry->less_recent == NULL && entry != least_recently_used) {
+            if (entry->less_recent == NULL && entry != shard->least_recently_used) {
                 halide_print(NULL, "cache invalid case 2\n");
                 __builtin_trap();
             }
@@ -220,13 +322,13 @@ WEAK void validate_cache() {
         }
     }
     int entries_from_mru = 0;
-    CacheEntry *mru_chain = most_recently_used;
+    CacheEntry *mru_chain = shard->most_recently_used;
     while (mru_chain != NULL) {
         entries_from_mru++;
         mru_chain = mru_chain->less_recent;
     }
     int entries_from_lru = 0;
-    CacheEntry *lru_chain = least_recently_used;
+    CacheEntry *lru_chain = shard->least_recently_used;
     while (lru_chain != NULL) {
         entries_from_lru++;
         lru_chain = lru_chain->more_recent;
@@ -242,69 +344,535 @@ WEAK void validate_cache() {
         halide_print(NULL, "cache invalid case 4\n");
         __builtin_trap();
     }
-    if (current_cache_size < 0) {
+    if (shard->current_size < 0) {
         halide_print(NULL, "cache size is negative\n");
         __builtin_trap();
     }
 }
 #endif
 
+// The optional on-disk tier. When a directory is set, entries evicted
+// from memory are written to a file in it named after the key hash,
+// and lookups that miss in memory check there before recomputing. The
+// file holds the full key and the shapes, so a hash collision or a
+// change of bounds just reads as a miss.
+const uint32_t kPersistentMagic = 0x4f4d454d;  // "MEMO"
+
+struct PersistentHeader {
+    uint32_t magic;
+    uint32_t name_size;
+    uint32_t rest_size;
+    int32_t tuple_count;
+    int32_t dimensions;
+};
+
+// The first pointer-sized word of a cache key points at a string
+// naming the pipeline and Func (see Memoization.cpp). That address
+// isn't stable from one process to the next, so on disk the key is
+// stored with the string itself in place of the pointer.
+struct StableKey {
+    const char *name;
+    size_t name_size;
+    const uint8_t *rest;
+    size_t rest_size;
+    uint32_t hash;
+};
+
+WEAK bool make_stable_key(const uint8_t *key, size_t key_size, StableKey *result) {
+    if (key_size < sizeof(const char *)) {
+        return false;
+    }
+    memcpy(&result->name, key, sizeof(const char *));
+    result->name_size = strlen(result->name);
+    result->rest = key + sizeof(const char *);
+    result->rest_size = key_size - sizeof(const char *);
+    uint32_t h = 5381;
+    for (size_t i = 0; i < result->name_size; i++) {
+        h = (h << 5) + h + (uint8_t)result->name[i];
+    }
+    for (size_t i = 0; i < result->rest_size; i++) {
+        h = (h << 5) + h + result->rest[i];
+    }
+    result->hash = h;
+    return true;
+}
+
+WEAK halide_mutex persistent_dir_lock = { { 0 } };
+WEAK char persistent_dir[1024];
+WEAK bool persistent_dir_initialized = false;
+
+// Build the file name for a key. Returns false if there is no
+// persistent directory, or the name doesn't fit.
+WEAK bool persistent_path(char *dst, char *end, const StableKey &key) {
+    ScopedMutexLock lock(&persistent_dir_lock);
+    if (!persistent_dir_initialized) {
+        const char *dir = getenv("HL_MEMOIZATION_CACHE_DIR");
+        halide_string_to_string(persistent_dir, persistent_dir + sizeof(persistent_dir), dir ? dir : "");
+        persistent_dir_initialized = true;
+    }
+    if (!persistent_dir[0]) {
+        return false;
+    }
+    char *c = halide_string_to_string(dst, end, persistent_dir);
+    c = halide_string_to_string(c, end, "/halide_memoize_");
+    c = halide_uint64_to_string(c, end, key.hash, 1);
+    c = halide_string_to_string(c, end, "_");
+    c = halide_uint64_to_string(c, end, key.name_size + key.rest_size, 1);
+    c = halide_string_to_string(c, end, ".bin");
+    return c < end - 1;
+}
+
+WEAK bool write_bytes(void *f, const void *data, size_t bytes) {
+    return bytes == 0 || fwrite(data, bytes, 1, f) == 1;
+}
+
+WEAK bool read_bytes(void *f, void *data, size_t bytes) {
+    return bytes == 0 || fread(data, bytes, 1, f) == 1;
+}
+
+// Read bytes and check that they match the expected ones.
+WEAK bool read_and_compare(void *f, const uint8_t *expected, size_t bytes) {
+    uint8_t chunk[256];
+    while (bytes > 0) {
+        size_t n = bytes < sizeof(chunk) ? bytes : sizeof(chunk);
+        if (!read_bytes(f, chunk, n) || !keys_equal(chunk, expected, n)) {
+            return false;
+        }
+        expected += n;
+        bytes -= n;
+    }
+    return true;
+}
+
+// Write an entry that is about to be evicted out to disk.
+WEAK void persist_entry(CacheEntry *entry) {
+    StableKey key;
+    char path[1024];
+    if (!make_stable_key(entry->key, entry->key_size, &key) ||
+        !persistent_path(path, path + sizeof(path), key)) {
+        return;
+    }
+    for (uint32_t i = 0; i < entry->tuple_count; i++) {
+        // The host copy may be stale.
+        if (entry->buf[i].device_dirty()) {
+            return;
+        }
+    }
+    void *f = fopen(path, "wb");
+    if (!f) {
+        return;
+    }
+    PersistentHeader header = {kPersistentMagic, (uint32_t)key.name_size, (uint32_t)key.rest_size,
+                               (int32_t)entry->tuple_count, entry->dimensions};
+    bool ok = (write_bytes(f, &header, sizeof(header)) &&
+               write_bytes(f, key.name, key.name_size) &&
+               write_bytes(f, key.rest, key.rest_size) &&
+               write_bytes(f, entry->computed_bounds, sizeof(halide_dimension_t) * entry->dimensions));
+    for (uint32_t i = 0; ok && i < entry->tuple_count; i++) {
+        const halide_buffer_t &buf = entry->buf[i];
+        ok = (write_bytes(f, &buf.type, sizeof(buf.type)) &&
+              write_bytes(f, buf.dim, sizeof(halide_dimension_t) * entry->dimensions) &&
+              write_bytes(f, buf.begin(), buf.size_in_bytes()));
+    }
+    fclose(f);
+    if (!ok) {
+        remove(path);
+    }
+}
+
+// Try to fill freshly allocated tuple buffers from disk. Returns true
+// on success.
+WEAK bool load_persistent_entry(void *user_context, const uint8_t *cache_key, int32_t size,
+                                const halide_buffer_t *computed_bounds,
+                                int32_t tuple_count, halide_buffer_t **tuple_buffers) {
+    StableKey key;
+    char path[1024];
+    if (!make_stable_key(cache_key, size, &key) ||
+        !persistent_path(path, path + sizeof(path), key)) {
+        return false;
+    }
+    void *f = fopen(path, "rb");
+    if (!f) {
+        return false;
+    }
+    PersistentHeader header;
+    bool ok = (read_bytes(f, &header, sizeof(header)) &&
+               header.magic == kPersistentMagic &&
+               header.name_size == key.name_size &&
+               header.rest_size == key.rest_size &&
+               header.tuple_count == tuple_count &&
+               header.dimensions == computed_bounds->dimensions &&
+               read_and_compare(f, (const uint8_t *)key.name, key.name_size) &&
+               read_and_compare(f, key.rest, key.rest_size));
+    halide_dimension_t dim;
+    for (int32_t d = 0; ok && d < header.dimensions; d++) {
+        ok = read_bytes(f, &dim, sizeof(dim)) && dim == computed_bounds->dim[d];
+    }
+    for (int32_t i = 0; ok && i < tuple_count; i++) {
+        halide_buffer_t *buf = tuple_buffers[i];
+        halide_type_t type;
+        ok = read_bytes(f, &type, sizeof(type)) && type == buf->type;
+        for (int32_t d = 0; ok && d < header.dimensions; d++) {
+            ok = read_bytes(f, &dim, sizeof(dim)) && dim == buf->dim[d];
+        }
+        ok = ok && read_bytes(f, buf->begin(), buf->size_in_bytes());
+        if (ok) {
+            buf->set_host_dirty(true);
+        }
+    }
+    fclose(f);
+    return ok;
+}
+
+// Unlink an entry from its shard and free it. Must be called with the
+// shard lock held.
+WEAK void evict_entry(CacheShard *shard, CacheEntry *entry) {
+    CacheEntry *more_recent = entry->more_recent;
+    CacheEntry **bucket = bucket_for_hash(shard, entry->hash);
+
+    // Remove from hash table
+    CacheEntry *prev_hash_entry = *bucket;
+    if (prev_hash_entry == entry) {
+        *bucket = entry->next;
+    } else {
+        while (prev_hash_entry != NULL && prev_hash_entry->next != entry) {
+            prev_hash_entry = prev_hash_entry->next;
+        }
+        halide_assert(NULL, prev_hash_entry != NULL);
+        prev_hash_entry->next = entry->next;
+    }
+
+    // Remove from less recent chain.
+    if (shard->least_recently_used == entry) {
+        shard->least_recently_used = more_recent;
+    }
+    if (more_recent != NULL) {
+        more_recent->less_recent = entry->less_recent;
+    }
+
+    // Remove from more recent chain.
+    if (shard->most_recently_used == entry) {
+        shard->most_recently_used = entry->less_recent;
+    }
+    if (entry->less_recent != NULL) {
+        entry->less_recent->more_recent = more_recent;
+    }
+
+    // Decrease cache used amount.
+    int64_t bytes = entry_bytes(entry);
+    shard->current_size -= bytes;
+    adjust_quota_usage(entry->quota_index, -bytes);
+    shard->num_entries--;
+    shard->evictions++;
+
+    // Deallocate the entry, spilling it to disk first if there is a
+    // persistent tier.
+    persist_entry(entry);
+    entry->destroy();
+    halide_free(NULL, entry);
+}
+
+// Choose the next entry to evict from a shard according to the
+// eviction policy, considering only entries that aren't in use and,
+// if quota_index is non-negative, belong to that pipeline. Must be
+// called with the shard lock held.
+WEAK CacheEntry *pick_victim(CacheShard *shard, int32_t quota_index) {
+    CacheEntry *best = NULL;
+    uint64_t best_score = 0;
+    for (CacheEntry *entry = shard->least_recently_used; entry != NULL; entry = entry->more_recent) {
+        if (entry->in_use_count != 0 ||
+            (quota_index >= 0 && entry->quota_index != quota_index)) {
+            continue;
+        }
+        if (eviction_policy == halide_memoization_evict_lru) {
+            return entry;
+        }
+        // Size-aware LFU: evict whatever has earned the fewest hits
+        // per byte held. Ties go to the least recently used entry.
+        uint64_t score = ((uint64_t)(entry->hit_count + 1) << 32) / (entry_bytes(entry) + 1);
+        if (best == NULL || score < best_score) {
+            best = entry;
+            best_score = score;
+        }
+    }
+    return best;
+}
+
+// Evict unused entries from one shard until the cache as a whole
+// fits, or, if quota_index is non-negative, until that pipeline is
+// within its quota. Must be called with the shard lock held.
+WEAK void prune_shard(CacheShard *shard, int32_t quota_index = -1) {
+#if CACHE_DEBUGGING
+    validate_shard(shard);
+#endif
+    while (quota_index >= 0 ? quota_exceeded(quota_index) : current_cache_size() > max_cache_size) {
+        CacheEntry *victim = pick_victim(shard, quota_index);
+        if (victim == NULL) {
+            break;
+        }
+        evict_entry(shard, victim);
+    }
+#if CACHE_DEBUGGING
+    validate_shard(shard);
+#endif
+}
+
+// Prune each shard in turn until the cache fits. Must be called with
+// no shard locks held.
 WEAK void prune_cache() {
+    for (size_t i = 0; i < kCacheShards && current_cache_size() > max_cache_size; i++) {
+        ScopedMutexLock lock(&cache_shards[i].lock);
+        prune_shard(&cache_shards[i]);
+    }
+}
+
+// Insert a newly computed entry into a shard, pruning the shard to
+// make room. Returns true if a new entry was added. Must be called
+// with the shard lock held.
+WEAK bool store_in_shard(void *user_context, CacheShard *shard,
+                         const uint8_t *cache_key, int32_t size, uint32_t h,
+                         halide_buffer_t *computed_bounds,
+                         int32_t tuple_count, halide_buffer_t **tuple_buffers) {
 #if CACHE_DEBUGGING
-    validate_cache();
+    debug_print_key(user_context, "halide_memoization_cache_store", cache_key, size);
+
+    debug_print_buffer(user_context, "computed_bounds", *computed_bounds);
+
+    {
+        for (int32_t i = 0; i < tuple_count; i++) {
+            halide_buffer_t *buf = tuple_buffers[i];
+            debug_print_buffer(user_context, "Allocation bounds", *buf);
+        }
+    }
 #endif
-    CacheEntry *prune_candidate = least_recently_used;
-    while (current_cache_size > max_cache_size &&
-           prune_candidate != NULL) {
-        CacheEntry *more_recent = prune_candidate->more_recent;
-
-        if (prune_candidate->in_use_count == 0) {
-            uint32_t h = prune_candidate->hash;
-            uint32_t index = h % kHashTableSize;
-
-            // Remove from hash table
-            CacheEntry *prev_hash_entry = cache_entries[index];
-            if (prev_hash_entry == prune_candidate) {
-                cache_entries[index] = prune_candidate->next;
-            } else {
-                while (prev_hash_entry != NULL && prev_hash_entry->next != prune_candidate) {
-                    prev_hash_entry = prev_hash_entry->next;
+
+    CacheEntry **bucket = bucket_for_hash(shard, h);
+    CacheEntry *entry = *bucket;
+    while (entry != NULL) {
+        if (entry->hash == h && entry->key_size == (size_t)size &&
+            keys_equal(entry->key, cache_key, size) &&
+            buffer_has_shape(computed_bounds, entry->computed_bounds) &&
+            entry->tuple_count == (uint32_t)tuple_count) {
+
+            bool all_bounds_equal = true;
+            bool no_host_pointers_equal = true;
+            {
+                for (int32_t i = 0; all_bounds_equal && i < tuple_count; i++) {
+                    halide_buffer_t *buf = tuple_buffers[i];
+                    all_bounds_equal = buffer_has_shape(tuple_buffers[i], entry->buf[i].dim);
+                    if (entry->buf[i].host == buf->host) {
+                        no_host_pointers_equal = false;
+                    }
                 }
-                halide_assert(NULL, prev_hash_entry != NULL);
-                prev_hash_entry->next = prune_candidate->next;
             }
+            if (all_bounds_equal) {
+                halide_assert(user_context, no_host_pointers_equal);
+                // This entry is still in use by the caller. Mark it as having no cache entry
+                // so halide_memoization_cache_release can free the buffer.
+                for (int32_t i = 0; i < tuple_count; i++) {
+                    get_pointer_to_header(tuple_buffers[i]->host)->entry = NULL;
 
-            // Remove from less recent chain.
-            if (least_recently_used == prune_candidate) {
-                least_recently_used = more_recent;
-            }
-            if (more_recent != NULL) {
-                more_recent->less_recent = prune_candidate->less_recent;
+                }
+                return false;
             }
+        }
+        entry = entry->next;
+    }
 
-            // Remove from more recent chain.
-            if (most_recently_used == prune_candidate) {
-                most_recently_used = prune_candidate->less_recent;
-            }
-            if (prune_candidate->less_recent != NULL) {
-                prune_candidate->less_recent = more_recent;
-            }
+    uint64_t added_size = 0;
+    {
+        for (int32_t i = 0; i < tuple_count; i++) {
+            halide_buffer_t *buf = tuple_buffers[i];
+            added_size += buf->size_in_bytes();
+        }
+    }
+    // A pipeline over its quota first makes room from its own
+    // entries in this shard. If that isn't enough, the result just
+    // isn't cached.
+    int32_t quota_index = find_pipeline_quota(cache_key, size);
+    bool within_quota = true;
+    if (quota_index >= 0) {
+        adjust_quota_usage(quota_index, added_size);
+        prune_shard(shard, quota_index);
+        within_quota = !quota_exceeded(quota_index);
+    }
 
-            // Decrease cache used amount.
-            for (uint32_t i = 0; i < prune_candidate->tuple_count; i++) {
-                current_cache_size -= prune_candidate->buf[i].size_in_bytes();
-            }
+    shard->current_size += added_size;
+    prune_shard(shard);
+
+    CacheEntry *new_entry = NULL;
+    bool inited = false;
+    if (within_quota) {
+        new_entry = (CacheEntry *)halide_malloc(NULL, sizeof(CacheEntry));
+    }
+    if (new_entry) {
+        inited = new_entry->init(cache_key, size, h, computed_bounds, tuple_count, tuple_buffers);
+    }
+    if (!inited) {
+        shard->current_size -= added_size;
+        adjust_quota_usage(quota_index, -(int64_t)added_size);
 
-            // Deallocate the entry.
-            prune_candidate->destroy();
-            halide_free(NULL, prune_candidate);
+        // This entry is still in use by the caller. Mark it as having no cache entry
+        // so halide_memoization_cache_release can free the buffer.
+        for (int32_t i = 0; i < tuple_count; i++) {
+            get_pointer_to_header(tuple_buffers[i]->host)->entry = NULL;
         }
 
-        prune_candidate = more_recent;
+        if (new_entry) {
+            halide_free(user_context, new_entry);
+        }
+        return false;
+    }
+
+    new_entry->next = *bucket;
+    new_entry->less_recent = shard->most_recently_used;
+    if (shard->most_recently_used != NULL) {
+        shard->most_recently_used->more_recent = new_entry;
+    }
+    shard->most_recently_used = new_entry;
+    if (shard->least_recently_used == NULL) {
+        shard->least_recently_used = new_entry;
     }
+    *bucket = new_entry;
+
+    new_entry->in_use_count = tuple_count;
+    new_entry->quota_index = quota_index;
+    shard->num_entries++;
+    shard->insertions++;
+
+    for (int32_t i = 0; i < tuple_count; i++) {
+        get_pointer_to_header(tuple_buffers[i]->host)->entry = new_entry;
+    }
+
 #if CACHE_DEBUGGING
-    validate_cache();
+    validate_shard(shard);
 #endif
+
+    return true;
+}
+
+// Hashing of buffer contents, for Funcs memoized with
+// MemoizeKey::ContentHash. This is xxHash64: four independent
+// accumulators over 32-byte stripes, which keeps the multipliers busy
+// and runs at several bytes per cycle.
+const uint64_t kXXPrime1 = 0x9E3779B185EBCA87ULL;
+const uint64_t kXXPrime2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t kXXPrime3 = 0x165667B19E3779F9ULL;
+const uint64_t kXXPrime4 = 0x85EBCA77C2B2AE63ULL;
+const uint64_t kXXPrime5 = 0x27D4EB2F165667C5ULL;
+
+WEAK __attribute((always_inline)) uint64_t xx_rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+WEAK __attribute((always_inline)) uint64_t xx_read64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+WEAK __attribute((always_inline)) uint32_t xx_read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+WEAK __attribute((always_inline)) uint64_t xx_round(uint64_t acc, uint64_t input) {
+    acc += input * kXXPrime2;
+    acc = xx_rotl(acc, 31);
+    return acc * kXXPrime1;
+}
+
+WEAK __attribute((always_inline)) uint64_t xx_merge_round(uint64_t acc, uint64_t val) {
+    acc ^= xx_round(0, val);
+    return acc * kXXPrime1 + kXXPrime4;
+}
+
+WEAK uint64_t xxhash64(const uint8_t *p, size_t len, uint64_t seed) {
+    const uint8_t *end = p + len;
+    uint64_t h;
+    if (len >= 32) {
+        uint64_t v1 = seed + kXXPrime1 + kXXPrime2;
+        uint64_t v2 = seed + kXXPrime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - kXXPrime1;
+        const uint8_t *limit = end - 32;
+        do {
+            v1 = xx_round(v1, xx_read64(p));
+            v2 = xx_round(v2, xx_read64(p + 8));
+            v3 = xx_round(v3, xx_read64(p + 16));
+            v4 = xx_round(v4, xx_read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+        h = xx_rotl(v1, 1) + xx_rotl(v2, 7) + xx_rotl(v3, 12) + xx_rotl(v4, 18);
+        h = xx_merge_round(h, v1);
+        h = xx_merge_round(h, v2);
+        h = xx_merge_round(h, v3);
+        h = xx_merge_round(h, v4);
+    } else {
+        h = seed + kXXPrime5;
+    }
+    h += (uint64_t)len;
+    for (; p + 8 <= end; p += 8) {
+        h ^= xx_round(0, xx_read64(p));
+        h = xx_rotl(h, 27) * kXXPrime1 + kXXPrime4;
+    }
+    if (p + 4 <= end) {
+        h ^= (uint64_t)xx_read32(p) * kXXPrime1;
+        h = xx_rotl(h, 23) * kXXPrime2 + kXXPrime3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        h ^= (*p) * kXXPrime5;
+        h = xx_rotl(h, 11) * kXXPrime1;
+    }
+    h ^= h >> 33;
+    h *= kXXPrime2;
+    h ^= h >> 29;
+    h *= kXXPrime3;
+    h ^= h >> 32;
+    return h;
+}
+
+// Hash the elements of a buffer in dimensions [0, d] starting at the
+// given address, chaining the hash of each contiguous span into the
+// next. The span_dims innermost dimensions are dense, and hashed as one
+// span of span_bytes.
+WEAK uint64_t hash_buffer_dims(const halide_buffer_t *buf, int d, const uint8_t *host,
+                               int span_dims, size_t span_bytes, uint64_t h) {
+    if (d < span_dims) {
+        return xxhash64(host, span_bytes, h);
+    }
+    const halide_dimension_t &dim = buf->dim[d];
+    for (int i = 0; i < dim.extent; i++) {
+        h = hash_buffer_dims(buf, d - 1, host + (int64_t)i * dim.stride * buf->type.bytes(),
+                             span_dims, span_bytes, h);
+    }
+    return h;
+}
+
+// The hash of everything about a buffer's shape that is in its
+// content hash: the type and the min, extent and stride of each
+// dimension.
+WEAK uint64_t buffer_shape_hash(const halide_buffer_t *buf) {
+    uint64_t h = xxhash64((const uint8_t *)&buf->type, sizeof(buf->type), buf->dimensions);
+    return xxhash64((const uint8_t *)buf->dim, buf->dimensions * sizeof(halide_dimension_t), h);
+}
+
+// Content hashes computed with a non-zero version tag, so that a
+// buffer with the same host pointer, shape and version need not be
+// hashed again. A direct-mapped table, indexed by host pointer.
+struct ContentHashEntry {
+    const void *host;
+    uint64_t shape_hash, version, hash;
+};
+
+const int kContentHashEntries = 64;
+WEAK halide_mutex content_hash_lock = { { 0 } };
+WEAK ContentHashEntry content_hashes[kContentHashEntries];
+
+WEAK __attribute((always_inline)) ContentHashEntry *content_hash_entry(const void *host) {
+    return &content_hashes[(((uintptr_t)host) >> 6) % kContentHashEntries];
 }
 
 }}} // namespace Halide::Runtime::Internal
@@ -316,18 +884,22 @@ WEAK void halide_memoization_cache_set_size(int64_t size) {
         size = kDefaultCacheSize;
     }
 
-    ScopedMutexLock lock(&memoization_lock);
-
     max_cache_size = size;
     prune_cache();
 }
 
+WEAK void halide_memoization_cache_set_persistent_dir(const char *dir) {
+    ScopedMutexLock lock(&persistent_dir_lock);
+    halide_string_to_string(persistent_dir, persistent_dir + sizeof(persistent_dir), dir ? dir : "");
+    persistent_dir_initialized = true;
+}
+
 WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cache_key, int32_t size,
                                          halide_buffer_t *computed_bounds, int32_t tuple_count, halide_buffer_t **tuple_buffers) {
     uint32_t h = djb_hash(cache_key, size);
-    uint32_t index = h % kHashTableSize;
+    CacheShard *shard = shard_for_hash(h);
 
-    ScopedMutexLock lock(&memoization_lock);
+    ScopedMutexLock lock(&shard->lock);
 
 #if CACHE_DEBUGGING
     debug_print_key(user_context, "halide_memoization_cache_lookup", cache_key, size);
@@ -342,7 +914,7 @@ WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cach
     }
 #endif
 
-    CacheEntry *entry = cache_entries[index];
+    CacheEntry *entry = *bucket_for_hash(shard, h);
     while (entry != NULL) {
         if (entry->hash == h && entry->key_size == (size_t)size &&
             keys_equal(entry->key, cache_key, size) &&
@@ -356,23 +928,23 @@ WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cach
             }
 
             if (all_bounds_equal) {
-                if (entry != most_recently_used) {
+                if (entry != shard->most_recently_used) {
                     halide_assert(user_context, entry->more_recent != NULL);
                     if (entry->less_recent != NULL) {
                         entry->less_recent->more_recent = entry->more_recent;
                     } else {
-                        halide_assert(user_context, least_recently_used == entry);
-                        least_recently_used = entry->more_recent;
+                        halide_assert(user_context, shard->least_recently_used == entry);
+                        shard->least_recently_used = entry->more_recent;
                     }
                     halide_assert(user_context, entry->more_recent != NULL);
                     entry->more_recent->less_recent = entry->less_recent;
 
                     entry->more_recent = NULL;
-                    entry->less_recent = most_recently_used;
-                    if (most_recently_used != NULL) {
-                        most_recently_used->more_recent = entry;
+                    entry->less_recent = shard->most_recently_used;
+                    if (shard->most_recently_used != NULL) {
+                        shard->most_recently_used->more_recent = entry;
                     }
-                    most_recently_used = entry;
+                    shard->most_recently_used = entry;
                 }
 
                 for (int32_t i = 0; i < tuple_count; i++) {
@@ -380,7 +952,11 @@ WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cach
                     *buf = entry->buf[i];
                 }
 
-                entry->in_use_count += tuple_count;
+                // Releases decrement this without taking the shard
+                // lock, so the bump must be atomic too.
+                __sync_add_and_fetch(&entry->in_use_count, tuple_count);
+                entry->hit_count++;
+                shard->hits++;
 
                 return 0;
             }
@@ -405,8 +981,22 @@ WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cach
         header->entry = NULL;
     }
 
+    // Not in memory, but it may have been spilled to disk by an
+    // earlier eviction (possibly by another process). This is done
+    // with the shard lock held so that concurrent lookups of the same
+    // key don't all read the same file.
+    if (load_persistent_entry(user_context, cache_key, size,
+                              computed_bounds, tuple_count, tuple_buffers)) {
+        store_in_shard(user_context, shard, cache_key, size, h,
+                       computed_bounds, tuple_count, tuple_buffers);
+        shard->disk_hits++;
+        return 0;
+    }
+
+    shard->misses++;
+
 #if CACHE_DEBUGGING
-    validate_cache();
+    validate_shard(shard);
 #endif
 
     return 1;
@@ -418,108 +1008,23 @@ WEAK int halide_memoization_cache_store(void *user_context, const uint8_t *cache
     debug(user_context) << "halide_memoization_cache_store\n";
 
     uint32_t h = get_pointer_to_header(tuple_buffers[0]->host)->hash;
+    CacheShard *shard = shard_for_hash(h);
 
-    uint32_t index = h % kHashTableSize;
-
-    ScopedMutexLock lock(&memoization_lock);
-
-#if CACHE_DEBUGGING
-    debug_print_key(user_context, "halide_memoization_cache_store", cache_key, size);
-
-    debug_print_buffer(user_context, "computed_bounds", *computed_bounds);
-
+    bool stored;
     {
-        for (int32_t i = 0; i < tuple_count; i++) {
-            halide_buffer_t *buf = tuple_buffers[i];
-            debug_print_buffer(user_context, "Allocation bounds", *buf);
-        }
+        ScopedMutexLock lock(&shard->lock);
+        stored = store_in_shard(user_context, shard, cache_key, size, h,
+                                computed_bounds, tuple_count, tuple_buffers);
     }
-#endif
-
-    CacheEntry *entry = cache_entries[index];
-    while (entry != NULL) {
-        if (entry->hash == h && entry->key_size == (size_t)size &&
-            keys_equal(entry->key, cache_key, size) &&
-            buffer_has_shape(computed_bounds, entry->computed_bounds) &&
-            entry->tuple_count == (uint32_t)tuple_count) {
 
-            bool all_bounds_equal = true;
-            bool no_host_pointers_equal = true;
-            {
-                for (int32_t i = 0; all_bounds_equal && i < tuple_count; i++) {
-                    halide_buffer_t *buf = tuple_buffers[i];
-                    all_bounds_equal = buffer_has_shape(tuple_buffers[i], entry->buf[i].dim);
-                    if (entry->buf[i].host == buf->host) {
-                        no_host_pointers_equal = false;
-                    }
-                }
-            }
-            if (all_bounds_equal) {
-                halide_assert(user_context, no_host_pointers_equal);
-                // This entry is still in use by the caller. Mark it as having no cache entry
-                // so halide_memoization_cache_release can free the buffer.
-                for (int32_t i = 0; i < tuple_count; i++) {
-                    get_pointer_to_header(tuple_buffers[i]->host)->entry = NULL;
-
-                }
-                return 0;
-            }
-        }
-        entry = entry->next;
-    }
-
-    uint64_t added_size = 0;
-    {
-        for (int32_t i = 0; i < tuple_count; i++) {
-            halide_buffer_t *buf = tuple_buffers[i];
-            added_size += buf->size_in_bytes();
-        }
-    }
-    current_cache_size += added_size;
-    prune_cache();
-
-    CacheEntry *new_entry = (CacheEntry *)halide_malloc(NULL, sizeof(CacheEntry));
-    bool inited = false;
-    if (new_entry) {
-        inited = new_entry->init(cache_key, size, h, computed_bounds, tuple_count, tuple_buffers);
-    }
-    if (!inited) {
-        current_cache_size -= added_size;
-
-        // This entry is still in use by the caller. Mark it as having no cache entry
-        // so halide_memoization_cache_release can free the buffer.
-        for (int32_t i = 0; i < tuple_count; i++) {
-            get_pointer_to_header(tuple_buffers[i]->host)->entry = NULL;
-        }
-
-        if (new_entry) {
-            halide_free(user_context, new_entry);
-        }
-        return 0;
-    }
-
-    new_entry->next = cache_entries[index];
-    new_entry->less_recent = most_recently_used;
-    if (most_recently_used != NULL) {
-        most_recently_used->more_recent = new_entry;
-    }
-    most_recently_used = new_entry;
-    if (least_recently_used == NULL) {
-        least_recently_used = new_entry;
+    // If pruning this shard wasn't enough to get back under the size
+    // limit, evict from the others too. This has to happen after the
+    // shard lock is dropped so we never hold two shard locks at once.
+    if (stored && current_cache_size() > max_cache_size) {
+        prune_cache();
     }
-    cache_entries[index] = new_entry;
 
-    new_entry->in_use_count = tuple_count;
-
-    for (int32_t i = 0; i < tuple_count; i++) {
-        get_pointer_to_header(tuple_buffers[i]->host)->entry = new_entry;
-    }
-
-#if CACHE_DEBUGGING
-    validate_cache();
-#endif
     debug(user_context) << "Exiting halide_memoization_cache_store\n";
-
     return 0;
 }
 
@@ -531,13 +1036,11 @@ WEAK void halide_memoization_cache_release(void *user_context, void *host) {
     if (entry == NULL) {
         halide_free(user_context, header);
     } else {
-        ScopedMutexLock lock(&memoization_lock);
-
-        halide_assert(user_context, entry->in_use_count > 0);
-        entry->in_use_count--;
-#if CACHE_DEBUGGING
-        validate_cache();
-#endif
+        // Entries are only freed while unused, so the entry can't
+        // go away under us, and the count can be dropped without
+        // taking the shard lock.
+        uint32_t old_count = __sync_fetch_and_sub(&entry->in_use_count, 1);
+        halide_assert(user_context, old_count > 0);
     }
 
     debug(user_context) << "Exited halide_memoization_cache_release.\n";
@@ -545,19 +1048,125 @@ WEAK void halide_memoization_cache_release(void *user_context, void *host) {
 
 WEAK void halide_memoization_cache_cleanup() {
     debug(NULL) << "halide_memoization_cache_cleanup\n";
-    for (size_t i = 0; i < kHashTableSize; i++) {
-        CacheEntry *entry = cache_entries[i];
-        cache_entries[i] = NULL;
-        while (entry != NULL) {
-            CacheEntry *next = entry->next;
-            entry->destroy();
-            halide_free(NULL, entry);
-            entry = next;
+    for (size_t s = 0; s < kCacheShards; s++) {
+        CacheShard *shard = &cache_shards[s];
+        ScopedMutexLock lock(&shard->lock);
+        for (size_t i = 0; i < kBucketsPerShard; i++) {
+            CacheEntry *entry = shard->entries[i];
+            shard->entries[i] = NULL;
+            while (entry != NULL) {
+                CacheEntry *next = entry->next;
+                // Everything still resident gets written out, so the
+                // next process can start warm.
+                persist_entry(entry);
+                entry->destroy();
+                halide_free(NULL, entry);
+                entry = next;
+            }
+        }
+        shard->current_size = 0;
+        shard->num_entries = 0;
+        shard->most_recently_used = NULL;
+        shard->least_recently_used = NULL;
+    }
+
+    ScopedMutexLock lock(&quota_lock);
+    for (int i = 0; i < num_pipeline_quotas; i++) {
+        pipeline_quotas[i].used = 0;
+    }
+}
+
+WEAK void halide_memoization_cache_get_stats(halide_memoization_cache_stats_t *stats) {
+    memset(stats, 0, sizeof(*stats));
+    for (size_t i = 0; i < kCacheShards; i++) {
+        CacheShard *shard = &cache_shards[i];
+        ScopedMutexLock lock(&shard->lock);
+        stats->hits += shard->hits;
+        stats->disk_hits += shard->disk_hits;
+        stats->misses += shard->misses;
+        stats->insertions += shard->insertions;
+        stats->evictions += shard->evictions;
+        stats->bytes_in_use += shard->current_size;
+        stats->entries += shard->num_entries;
+    }
+    stats->max_bytes = max_cache_size;
+}
+
+WEAK void halide_memoization_cache_reset_stats() {
+    for (size_t i = 0; i < kCacheShards; i++) {
+        CacheShard *shard = &cache_shards[i];
+        ScopedMutexLock lock(&shard->lock);
+        shard->hits = shard->disk_hits = shard->misses = 0;
+        shard->insertions = shard->evictions = 0;
+    }
+}
+
+WEAK void halide_memoization_cache_set_eviction_policy(halide_memoization_eviction_policy_t policy) {
+    eviction_policy = policy;
+}
+
+WEAK int halide_memoization_cache_set_pipeline_quota(const char *pipeline_name, int64_t size) {
+    ScopedMutexLock lock(&quota_lock);
+    int i = 0;
+    while (i < num_pipeline_quotas && strcmp(pipeline_quotas[i].name, pipeline_name) != 0) {
+        i++;
+    }
+    if (i == num_pipeline_quotas) {
+        if (num_pipeline_quotas == kMaxPipelineQuotas ||
+            strlen(pipeline_name) >= sizeof(pipeline_quotas[i].name)) {
+            return -1;
         }
+        halide_string_to_string(pipeline_quotas[i].name,
+                                pipeline_quotas[i].name + sizeof(pipeline_quotas[i].name),
+                                pipeline_name);
+        pipeline_quotas[i].used = 0;
+        num_pipeline_quotas++;
+    }
+    // A non-positive size removes the limit without forgetting the
+    // usage already accounted to the pipeline.
+    pipeline_quotas[i].quota = size > 0 ? size : INT64_C(0x7fffffffffffffff);
+    return 0;
+}
+
+WEAK uint64_t halide_memoization_cache_hash_buffer(void *user_context, halide_buffer_t *buf,
+                                                   uint64_t version) {
+    uint64_t shape_hash = buffer_shape_hash(buf);
+    if (!buf->host) {
+        return shape_hash;
+    }
+    if (version) {
+        ScopedMutexLock lock(&content_hash_lock);
+        ContentHashEntry *e = content_hash_entry(buf->host);
+        if (e->host == buf->host && e->shape_hash == shape_hash && e->version == version) {
+            return e->hash;
+        }
+    }
+    if (buf->device_dirty()) {
+        halide_copy_to_host(user_context, buf);
+    }
+
+    // Hash the densely packed innermost dimensions as one span, and
+    // walk over the rest. If the innermost dimension isn't dense,
+    // each span is a single element.
+    int span_dims = 0;
+    int64_t span_elems = 1;
+    while (span_dims < buf->dimensions &&
+           buf->dim[span_dims].stride == span_elems) {
+        span_elems *= buf->dim[span_dims].extent;
+        span_dims++;
+    }
+    uint64_t hash = hash_buffer_dims(buf, buf->dimensions - 1, buf->host, span_dims,
+                                     span_elems * buf->type.bytes(), shape_hash);
+
+    if (version) {
+        ScopedMutexLock lock(&content_hash_lock);
+        ContentHashEntry *e = content_hash_entry(buf->host);
+        e->host = buf->host;
+        e->shape_hash = shape_hash;
+        e->version = version;
+        e->hash = hash;
     }
-    current_cache_size = 0;
-    most_recently_used = NULL;
-    least_recently_used = NULL;
+    return hash;
 }
 
 namespace {
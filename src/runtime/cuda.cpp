@@ -1,6 +1,7 @@
 #include "HalideRuntimeCuda.h"
 #include "device_buffer_utils.h"
 #include "device_interface.h"
+#include "device_pool_utils.h"
 #include "printer.h"
 #include "mini_cuda.h"
 #include "scoped_spin_lock.h"
@@ -75,11 +76,31 @@ extern WEAK halide_device_interface_t cuda_device_interface;
 WEAK const char *get_error_name(CUresult error);
 WEAK CUresult create_cuda_context(void *user_context, CUcontext *ctx);
 
-// A cuda context defined in this module with weak linkage
-CUcontext WEAK context = 0;
-// This spinlock protexts the above context variable.
+// A cuda context for each device, defined in this module with weak
+// linkage. The device is the one halide_get_gpu_device returns for
+// the user_context. The last slot is for device -1, which lets
+// create_cuda_context pick the device.
+const int max_cuda_devices = 64;
+CUcontext WEAK contexts[max_cuda_devices + 1];
+// This spinlock protexts the above contexts.
 volatile int WEAK context_lock = 0;
 
+WEAK CUcontext *context_for_device(void *user_context) {
+    int device = halide_get_gpu_device(user_context);
+    if (device >= 0 && device < max_cuda_devices) {
+        return &contexts[device];
+    }
+    return &contexts[max_cuda_devices];
+}
+
+// Whether kernels and copies are issued asynchronously on per-thread
+// streams. See halide_cuda_set_async_mode.
+WEAK int async_mode = 0;
+
+// Whether buffers on both the host and device use managed memory. See
+// halide_cuda_set_managed_memory_mode.
+WEAK int managed_memory_mode = 0;
+
 }}}} // namespace Halide::Runtime::Internal::Cuda
 
 using namespace Halide::Runtime::Internal;
@@ -102,14 +123,15 @@ WEAK int halide_cuda_acquire_context(void *user_context, CUcontext *ctx, bool cr
     halide_assert(user_context, ctx != NULL);
 
     // If the context has not been initialized, initialize it now.
-    halide_assert(user_context, &context != NULL);
+    CUcontext *context = context_for_device(user_context);
+    halide_assert(user_context, context != NULL);
 
     // Note that this null-check of the context is *not* locked with
     // respect to device_release, so we may get a non-null context
     // that's in the process of being destroyed. Things will go badly
     // in general if you call device_release while other Halide code
     // is running though.
-    CUcontext local_val = context;
+    CUcontext local_val = *context;
     if (local_val == NULL) {
         if (!create) {
             *ctx = NULL;
@@ -118,7 +140,7 @@ WEAK int halide_cuda_acquire_context(void *user_context, CUcontext *ctx, bool cr
 
         {
             ScopedSpinLock spinlock(&context_lock);
-            local_val = context;
+            local_val = *context;
             if (local_val == NULL) {
                 CUresult error = create_cuda_context(user_context, &local_val);
                 if (error != CUDA_SUCCESS) {
@@ -131,7 +153,7 @@ WEAK int halide_cuda_acquire_context(void *user_context, CUcontext *ctx, bool cr
             // assigning to the global, but there's no way that
             // create_cuda_context can access the "context" global, so
             // we should be OK just storing to it here.
-            context = local_val;
+            *context = local_val;
         }  // spinlock
     }
 
@@ -151,11 +173,19 @@ WEAK int halide_cuda_release_context(void *user_context) {
 WEAK int halide_cuda_get_stream(void *user_context, CUcontext ctx, CUstream *stream) {
     // There are two default streams we could use. stream 0 is fully
     // synchronous. stream 2 gives a separate non-blocking stream per
-    // thread.
-    *stream = 0;
+    // thread, which is what async mode uses.
+    *stream = async_mode ? CU_STREAM_PER_THREAD : 0;
     return 0;
 }
 
+WEAK void halide_cuda_set_async_mode(int async) {
+    async_mode = async ? 1 : 0;
+}
+
+WEAK void halide_cuda_set_managed_memory_mode(int managed) {
+    managed_memory_mode = managed ? 1 : 0;
+}
+
 } // extern "C"
 
 namespace Halide { namespace Runtime { namespace Internal { namespace Cuda {
@@ -196,6 +226,20 @@ public:
     }
 };
 
+// Get the stream that work in the given context should be issued on.
+WEAK CUstream stream_for_context(void *user_context, CUcontext ctx) {
+    CUstream stream = NULL;
+    // We use whether this routine was defined in the cuda driver library
+    // as a test for streams support in the cuda implementation.
+    if (cuStreamSynchronize != NULL) {
+        int result = halide_cuda_get_stream(user_context, ctx, &stream);
+        if (result != 0) {
+            error(user_context) << "CUDA: halide_cuda_get_stream returned " << result << "\n";
+        }
+    }
+    return stream;
+}
+
 // Halide allocates a device API controlled pointer slot as part of
 // each compiled module. The slot is used to store information to
 // avoid having to reload/recompile kernel code on each call into a
@@ -234,6 +278,376 @@ WEAK module_state *find_module_for_context(const registered_filters *filters, CU
     return NULL;
 }
 
+// cuMemAlloc and cuMemFree both synchronize with the device, so
+// device allocations freed by Halide are kept in a pool and handed
+// back out to later allocations of a similar size, rather than being
+// returned to the driver. Blocks are binned into the size classes
+// defined in device_pool_utils.h. Each block records the context that
+// owns it, and is only reused within that context. In async mode, freeing a block records
+// an event on the freeing stream, which the stream that reuses the
+// block waits on, so that work in flight on the first stream is done
+// with the block before the second stream touches it.
+
+struct pooled_block {
+    CUcontext context;
+    CUdeviceptr ptr;
+    size_t size;
+    CUevent freed;
+    pooled_block *next;
+};
+
+WEAK pooled_block *device_pool[num_pool_bins];
+// This spinlock protects the above device_pool.
+volatile int WEAK device_pool_lock = 0;
+
+// Take a block of at least the given size class for the given context
+// from the pool, to be used on the given stream. Returns 0 if there is
+// none.
+WEAK CUdeviceptr take_pooled_block(CUcontext ctx, size_t size, CUstream stream) {
+    pooled_block *b = NULL;
+    {
+        ScopedSpinLock spinlock(&device_pool_lock);
+        pooled_block **prev_ptr = &device_pool[pool_bin_for_size(size)];
+        b = *prev_ptr;
+        while (b != NULL) {
+            if (b->context == ctx && b->size >= size) {
+                *prev_ptr = b->next;
+                break;
+            }
+            prev_ptr = &b->next;
+            b = b->next;
+        }
+    }  // spinlock
+    if (b == NULL) {
+        return 0;
+    }
+    CUdeviceptr ptr = b->ptr;
+    if (b->freed) {
+        cuStreamWaitEvent(stream, b->freed, 0);
+        cuEventDestroy(b->freed);
+    }
+    free(b);
+    return ptr;
+}
+
+// Put a block of the given size, last used on the given stream, into
+// the pool. Returns false if the block should be freed instead.
+WEAK bool return_pooled_block(CUcontext ctx, CUdeviceptr ptr, size_t size, CUstream stream) {
+    pooled_block *b = (pooled_block *)malloc(sizeof(pooled_block));
+    if (b == NULL) {
+        return false;
+    }
+    b->context = ctx;
+    b->ptr = ptr;
+    b->size = size;
+    b->freed = NULL;
+    if (async_mode && cuEventCreate != NULL && cuStreamWaitEvent != NULL) {
+        if (cuEventCreate(&b->freed, CU_EVENT_DISABLE_TIMING) == CUDA_SUCCESS) {
+            if (cuEventRecord(b->freed, stream) != CUDA_SUCCESS) {
+                cuEventDestroy(b->freed);
+                b->freed = NULL;
+            }
+        } else {
+            b->freed = NULL;
+        }
+    }
+    ScopedSpinLock spinlock(&device_pool_lock);
+    pooled_block **bin = &device_pool[pool_bin_for_size(size)];
+    b->next = *bin;
+    *bin = b;
+    return true;
+}
+
+// Free all pooled blocks owned by the given context, which must be
+// current.
+WEAK CUresult release_pooled_blocks(void *user_context, CUcontext ctx) {
+    // Unlink the blocks under the lock, and free them outside it.
+    pooled_block *to_free = NULL;
+    {
+        ScopedSpinLock spinlock(&device_pool_lock);
+        for (int i = 0; i < num_pool_bins; i++) {
+            pooled_block **prev_ptr = &device_pool[i];
+            pooled_block *b = *prev_ptr;
+            while (b != NULL) {
+                pooled_block *next = b->next;
+                if (b->context == ctx) {
+                    *prev_ptr = next;
+                    b->next = to_free;
+                    to_free = b;
+                } else {
+                    prev_ptr = &b->next;
+                }
+                b = next;
+            }
+        }
+    }  // spinlock
+
+    CUresult result = CUDA_SUCCESS;
+    while (to_free != NULL) {
+        pooled_block *next = to_free->next;
+        if (to_free->freed) {
+            cuEventDestroy(to_free->freed);
+        }
+        debug(user_context) << "    cuMemFree " << (void *)(to_free->ptr) << "\n";
+        CUresult err = cuMemFree(to_free->ptr);
+        if (err != CUDA_SUCCESS) {
+            result = err;
+        }
+        free(to_free);
+        to_free = next;
+    }
+    return result;
+}
+
+// Kernel launches made between halide_cuda_begin_graph and
+// halide_cuda_end_graph are recorded. At the end of the first such
+// region with a given key, the launches are built into a CUDA graph
+// (as a chain, in the order they were issued), which is cached under
+// the key. Later regions with the same key defer their launches, and
+// at the end of the region update the parameters that changed and
+// launch the whole graph at once. If the launches in a region don't
+// match the cached graph, or the host needs to wait for the device
+// part way through, the deferred launches are issued individually and
+// the graph is rebuilt from that region at its end.
+
+struct graph_launch {
+    CUfunction f;
+    unsigned int grid[3], block[3];
+    unsigned int shared_mem_bytes;
+    // Pointers to each parameter value, terminated by NULL, followed
+    // by the values themselves.
+    void **params;
+    uint8_t *arg_data;
+    size_t arg_data_size;
+    graph_launch *next;
+};
+
+struct cached_graph {
+    CUcontext context;
+    uint64_t key;
+    CUgraph graph;
+    // NULL if the graph could not be instantiated, in which case
+    // regions with this key just run their launches as usual.
+    CUgraphExec exec;
+    int num_nodes;
+    CUgraphNode *nodes;
+    // The launches whose parameters the nodes of exec currently hold.
+    graph_launch *launches;
+    cached_graph *next;
+};
+WEAK cached_graph *cached_graphs = NULL;
+// This spinlock protects the above cached_graphs list.
+volatile int WEAK cached_graphs_lock = 0;
+
+// There is at most one region active at a time. Only launches using
+// the user_context that began it are captured.
+struct graph_region {
+    bool active;
+    void *owner;
+    CUcontext context;
+    uint64_t key;
+    cached_graph *cached;
+    bool replaying;
+    // The next launch of the cached graph to match against.
+    graph_launch *next_cached;
+    graph_launch *launches, **tail;
+    int num_launches;
+    // Set if the launches could not all be recorded.
+    bool abandoned;
+};
+WEAK graph_region current_graph_region;
+// This spinlock protects the above current_graph_region.
+volatile int WEAK graph_region_lock = 0;
+
+WEAK bool graphs_supported() {
+    return (cuGraphCreate != NULL && cuGraphAddKernelNode != NULL &&
+            cuGraphInstantiate != NULL && cuGraphExecKernelNodeSetParams != NULL &&
+            cuGraphLaunch != NULL && cuGraphExecDestroy != NULL && cuGraphDestroy != NULL);
+}
+
+WEAK graph_launch *make_graph_launch(CUfunction f,
+                                     int blocksX, int blocksY, int blocksZ,
+                                     int threadsX, int threadsY, int threadsZ,
+                                     int shared_mem_bytes, size_t num_args,
+                                     size_t arg_sizes[], void **translated_args) {
+    size_t arg_data_size = 0;
+    for (size_t i = 0; i < num_args; i++) {
+        arg_data_size += (arg_sizes[i] + 7) & ~7;
+    }
+    size_t params_size = (num_args + 1) * sizeof(void *);
+    graph_launch *l = (graph_launch *)malloc(sizeof(graph_launch) + params_size + arg_data_size);
+    if (l == NULL) {
+        return NULL;
+    }
+    l->f = f;
+    l->grid[0] = blocksX;
+    l->grid[1] = blocksY;
+    l->grid[2] = blocksZ;
+    l->block[0] = threadsX;
+    l->block[1] = threadsY;
+    l->block[2] = threadsZ;
+    l->shared_mem_bytes = shared_mem_bytes;
+    l->params = (void **)(l + 1);
+    l->arg_data = (uint8_t *)l->params + params_size;
+    l->arg_data_size = arg_data_size;
+    l->next = NULL;
+    // Zero the padding so that the argument data can be compared.
+    memset(l->arg_data, 0, arg_data_size);
+    uint8_t *p = l->arg_data;
+    for (size_t i = 0; i < num_args; i++) {
+        memcpy(p, translated_args[i], arg_sizes[i]);
+        l->params[i] = p;
+        p += (arg_sizes[i] + 7) & ~7;
+    }
+    l->params[num_args] = NULL;
+    return l;
+}
+
+WEAK void free_graph_launches(graph_launch *l) {
+    while (l != NULL) {
+        graph_launch *next = l->next;
+        free(l);
+        l = next;
+    }
+}
+
+WEAK void set_kernel_node_params(CUDA_KERNEL_NODE_PARAMS *p, const graph_launch *l) {
+    p->func = l->f;
+    p->gridDimX = l->grid[0];
+    p->gridDimY = l->grid[1];
+    p->gridDimZ = l->grid[2];
+    p->blockDimX = l->block[0];
+    p->blockDimY = l->block[1];
+    p->blockDimZ = l->block[2];
+    p->sharedMemBytes = l->shared_mem_bytes;
+    p->kernelParams = l->params;
+    p->extra = NULL;
+}
+
+WEAK CUresult launch_graph_launch(const graph_launch *l, CUstream stream) {
+    return cuLaunchKernel(l->f,
+                          l->grid[0], l->grid[1], l->grid[2],
+                          l->block[0], l->block[1], l->block[2],
+                          l->shared_mem_bytes,
+                          stream,
+                          l->params,
+                          NULL);
+}
+
+WEAK bool same_kernel_launch(const graph_launch *a, const graph_launch *b) {
+    return (a->f == b->f &&
+            a->grid[0] == b->grid[0] && a->grid[1] == b->grid[1] && a->grid[2] == b->grid[2] &&
+            a->block[0] == b->block[0] && a->block[1] == b->block[1] && a->block[2] == b->block[2] &&
+            a->shared_mem_bytes == b->shared_mem_bytes &&
+            a->arg_data_size == b->arg_data_size);
+}
+
+WEAK void destroy_cached_graph(cached_graph *g) {
+    if (g->exec) {
+        cuGraphExecDestroy(g->exec);
+    }
+    if (g->graph) {
+        cuGraphDestroy(g->graph);
+    }
+    free(g->nodes);
+    free_graph_launches(g->launches);
+    free(g);
+}
+
+// Destroy all cached graphs for the given context, which must be
+// current.
+WEAK void release_cached_graphs(CUcontext ctx) {
+    cached_graph *to_free = NULL;
+    {
+        ScopedSpinLock spinlock(&cached_graphs_lock);
+        cached_graph **prev_ptr = &cached_graphs;
+        while (*prev_ptr != NULL) {
+            cached_graph *g = *prev_ptr;
+            if (g->context == ctx) {
+                *prev_ptr = g->next;
+                g->next = to_free;
+                to_free = g;
+            } else {
+                prev_ptr = &g->next;
+            }
+        }
+    }  // spinlock
+    while (to_free != NULL) {
+        cached_graph *next = to_free->next;
+        destroy_cached_graph(to_free);
+        to_free = next;
+    }
+}
+
+// Whether kernel launches from this user_context are being recorded.
+WEAK bool in_graph_region(void *user_context) {
+    return current_graph_region.active && current_graph_region.owner == user_context;
+}
+
+// Issue any launches that were deferred in the current region, and stop
+// deferring launches for the rest of it. Called when the host is about
+// to depend on the results of earlier launches.
+WEAK CUresult flush_graph_region(void *user_context, CUstream stream) {
+    if (!in_graph_region(user_context) || !current_graph_region.replaying) {
+        return CUDA_SUCCESS;
+    }
+    debug(user_context) << "    flushing " << current_graph_region.num_launches
+                        << " deferred kernel launches\n";
+    current_graph_region.replaying = false;
+    for (graph_launch *l = current_graph_region.launches; l != NULL; l = l->next) {
+        CUresult err = launch_graph_launch(l, stream);
+        if (err != CUDA_SUCCESS) {
+            return err;
+        }
+    }
+    return CUDA_SUCCESS;
+}
+
+// Build a graph from the launches recorded in the current region.
+WEAK cached_graph *build_cached_graph(void *user_context) {
+    cached_graph *g = (cached_graph *)malloc(sizeof(cached_graph));
+    if (g == NULL) {
+        return NULL;
+    }
+    g->context = current_graph_region.context;
+    g->key = current_graph_region.key;
+    g->graph = NULL;
+    g->exec = NULL;
+    g->num_nodes = current_graph_region.num_launches;
+    g->nodes = (CUgraphNode *)malloc(g->num_nodes * sizeof(CUgraphNode));
+    g->launches = current_graph_region.launches;
+    g->next = NULL;
+    current_graph_region.launches = NULL;
+    if (g->nodes == NULL) {
+        return g;
+    }
+
+    CUresult err = cuGraphCreate(&g->graph, 0);
+    if (err != CUDA_SUCCESS) {
+        g->graph = NULL;
+        return g;
+    }
+    int i = 0;
+    for (graph_launch *l = g->launches; l != NULL; l = l->next, i++) {
+        CUDA_KERNEL_NODE_PARAMS params;
+        set_kernel_node_params(&params, l);
+        err = cuGraphAddKernelNode(&g->nodes[i], g->graph, i > 0 ? &g->nodes[i - 1] : NULL,
+                                   i > 0 ? 1 : 0, &params);
+        if (err != CUDA_SUCCESS) {
+            debug(user_context) << "    cuGraphAddKernelNode failed: " << get_error_name(err) << "\n";
+            return g;
+        }
+    }
+    err = cuGraphInstantiate(&g->exec, g->graph, NULL, NULL, 0);
+    if (err != CUDA_SUCCESS) {
+        debug(user_context) << "    cuGraphInstantiate failed: " << get_error_name(err) << "\n";
+        g->exec = NULL;
+    } else {
+        debug(user_context) << "    instantiated graph of " << g->num_nodes << " kernels\n";
+    }
+    return g;
+}
+
 WEAK CUresult create_cuda_context(void *user_context, CUcontext *ctx) {
     // Initialize CUDA
     CUresult err = cuInit(0);
@@ -431,6 +845,191 @@ WEAK bool validate_device_pointer(void *user_context, halide_buffer_t* buf, size
 #endif
 }
 
+// Buffers in managed memory are the only ones with the same host and
+// device pointers.
+WEAK bool is_managed(const halide_buffer_t *buf) {
+    return buf->host && buf->device && (uint64_t)(uintptr_t)buf->host == buf->device;
+}
+
+// Stands in for a copy of a buffer in managed memory to or from the
+// device. The driver would page the memory over on demand anyway, so
+// the prefetch is only a hint and failures are ignored, but the host
+// must still wait for the device before touching the memory.
+WEAK CUresult prefetch_managed(void *user_context, const halide_buffer_t *buf,
+                               bool to_host, CUstream stream) {
+    CUdevice dst = CU_DEVICE_CPU;
+    if (cuMemPrefetchAsync != NULL &&
+        (to_host || (cuCtxGetDevice != NULL && cuCtxGetDevice(&dst) == CUDA_SUCCESS))) {
+        debug(user_context) << "    cuMemPrefetchAsync " << (void *)buf->begin()
+                            << " " << (uint64_t)buf->size_in_bytes()
+                            << (to_host ? " to host" : " to device") << "\n";
+        // Devices without concurrent managed access don't support
+        // prefetching.
+        cuMemPrefetchAsync((CUdeviceptr)buf->begin(), buf->size_in_bytes(), dst, stream);
+    }
+    if (!to_host) {
+        return CUDA_SUCCESS;
+    }
+    return cuStreamSynchronize != NULL ? cuStreamSynchronize(stream) : cuCtxSynchronize();
+}
+
+// With HL_CUDA_KERNEL_STATS=1, the resources and theoretical occupancy
+// of each kernel are printed the first time it is launched with a given
+// block shape, to help choose the tile sizes passed to gpu_tile.
+struct reported_launch {
+    CUfunction func;
+    int threads[3];
+    int shared_mem_bytes;
+};
+
+const int max_reported_launches = 256;
+WEAK reported_launch reported_launches[max_reported_launches];
+WEAK int num_reported_launches = 0;
+WEAK int report_kernel_stats_mode = -1;
+// This spinlock protects the above table.
+volatile int WEAK reported_launches_lock = 0;
+
+WEAK void report_kernel_stats(void *user_context, CUfunction f, const char *entry_name,
+                              int threadsX, int threadsY, int threadsZ, int shared_mem_bytes) {
+    {
+        ScopedSpinLock spinlock(&reported_launches_lock);
+        if (report_kernel_stats_mode < 0) {
+            const char *mode = getenv("HL_CUDA_KERNEL_STATS");
+            report_kernel_stats_mode = (mode && atoi(mode) != 0) ? 1 : 0;
+        }
+        if (!report_kernel_stats_mode) {
+            return;
+        }
+        for (int i = 0; i < num_reported_launches; i++) {
+            const reported_launch &r = reported_launches[i];
+            if (r.func == f && r.threads[0] == threadsX && r.threads[1] == threadsY &&
+                r.threads[2] == threadsZ && r.shared_mem_bytes == shared_mem_bytes) {
+                return;
+            }
+        }
+        if (num_reported_launches == max_reported_launches) {
+            return;
+        }
+        reported_launch &r = reported_launches[num_reported_launches++];
+        r.func = f;
+        r.threads[0] = threadsX;
+        r.threads[1] = threadsY;
+        r.threads[2] = threadsZ;
+        r.shared_mem_bytes = shared_mem_bytes;
+    }
+
+    if (!cuFuncGetAttribute || !cuCtxGetDevice) {
+        print(user_context) << "CUDA: " << entry_name << ": kernel attributes are not available\n";
+        return;
+    }
+
+    int regs = 0, static_shared = 0, local = 0;
+    cuFuncGetAttribute(&regs, CU_FUNC_ATTRIBUTE_NUM_REGS, f);
+    cuFuncGetAttribute(&static_shared, CU_FUNC_ATTRIBUTE_SHARED_SIZE_BYTES, f);
+    cuFuncGetAttribute(&local, CU_FUNC_ATTRIBUTE_LOCAL_SIZE_BYTES, f);
+
+    int block_size = threadsX * threadsY * threadsZ;
+    stringstream sstr(user_context);
+    sstr << "CUDA: " << entry_name << " with "
+         << threadsX << "x" << threadsY << "x" << threadsZ << " threads: "
+         << regs << " registers/thread, "
+         << static_shared + shared_mem_bytes << " bytes shared ("
+         << static_shared << " static), "
+         << local << " bytes local/thread";
+
+    CUdevice dev;
+    int warp_size = 0, max_threads_per_sm = 0, blocks_per_sm = 0;
+    if (cuOccupancyMaxActiveBlocksPerMultiprocessor &&
+        cuCtxGetDevice(&dev) == CUDA_SUCCESS &&
+        cuDeviceGetAttribute(&warp_size, CU_DEVICE_ATTRIBUTE_WARP_SIZE, dev) == CUDA_SUCCESS &&
+        cuDeviceGetAttribute(&max_threads_per_sm, CU_DEVICE_ATTRIBUTE_MAX_THREADS_PER_MULTIPROCESSOR, dev) == CUDA_SUCCESS &&
+        cuOccupancyMaxActiveBlocksPerMultiprocessor(&blocks_per_sm, f, block_size, shared_mem_bytes) == CUDA_SUCCESS &&
+        warp_size > 0 && max_threads_per_sm > 0) {
+        // Each block occupies a whole number of warps.
+        int warps_per_block = (block_size + warp_size - 1) / warp_size;
+        int max_warps_per_sm = max_threads_per_sm / warp_size;
+        sstr << ", " << blocks_per_sm << " blocks/SM, occupancy "
+             << (100 * blocks_per_sm * warps_per_block) / max_warps_per_sm << "%";
+    }
+    print(user_context) << sstr.str() << "\n";
+}
+
+// Unload the modules and free the pooled allocations and graphs of a
+// context, and destroy it if this module made it.
+WEAK void release_context(void *user_context, CUcontext ctx) {
+    CUresult err;
+    // It's possible that this is being called from the destructor of
+    // a static variable, in which case the driver may already be
+    // shutting down.
+    err = cuCtxPushCurrent(ctx);
+    if (err != CUDA_SUCCESS) {
+        err = cuCtxSynchronize();
+    }
+    halide_assert(user_context, err == CUDA_SUCCESS || err == CUDA_ERROR_DEINITIALIZED);
+
+    {
+        ScopedSpinLock spinlock(&filters_list_lock);
+
+        // Unload the modules attached to this context. Note that the list
+        // nodes themselves are not freed, only the module objects are
+        // released. Subsequent calls to halide_init_kernels might re-create
+        // the program object using the same list node to store the module
+        // object.
+        registered_filters *filters = filters_list;
+        while (filters) {
+            module_state **prev_ptr = &filters->modules;
+            module_state *loaded_module = filters->modules;
+            while (loaded_module != NULL) {
+                if (loaded_module->context == ctx) {
+                    debug(user_context) << "    cuModuleUnload " << loaded_module->module << "\n";
+                    err = cuModuleUnload(loaded_module->module);
+                    halide_assert(user_context, err == CUDA_SUCCESS || err == CUDA_ERROR_DEINITIALIZED);
+                    *prev_ptr = loaded_module->next;
+                    free(loaded_module);
+                    loaded_module = *prev_ptr;
+                } else {
+                    loaded_module = loaded_module->next;
+                    prev_ptr = &loaded_module->next;
+                }
+            }
+            filters = filters->next;
+        }
+    }  // spinlock
+
+    // Return any pooled device allocations made in this context
+    // to the driver.
+    err = release_pooled_blocks(user_context, ctx);
+    halide_assert(user_context, err == CUDA_SUCCESS || err == CUDA_ERROR_DEINITIALIZED);
+
+    // The cached graphs refer to the modules unloaded above.
+    release_cached_graphs(ctx);
+
+    // So do the kernels already reported with HL_CUDA_KERNEL_STATS.
+    {
+        ScopedSpinLock spinlock(&reported_launches_lock);
+        num_reported_launches = 0;
+    }
+
+    CUcontext old_ctx;
+    cuCtxPopCurrent(&old_ctx);
+
+    // Only destroy the context if we own it
+
+    {
+        ScopedSpinLock spinlock(&context_lock);
+
+        for (int i = 0; i <= max_cuda_devices; i++) {
+            if (ctx == contexts[i]) {
+                debug(user_context) << "    cuCtxDestroy " << ctx << "\n";
+                err = cuProfilerStop();
+                err = cuCtxDestroy(ctx);
+                halide_assert(user_context, err == CUDA_SUCCESS || err == CUDA_ERROR_DEINITIALIZED);
+                contexts[i] = NULL;
+            }
+        }
+    }  // spinlock
+}
+
 }}}} // namespace Halide::Runtime::Internal
 
 extern "C" {
@@ -483,6 +1082,10 @@ WEAK int halide_cuda_initialize_kernels(void *user_context, void **state_ptr, co
                 max_regs_per_thread = atoi(regs);
             }
             void *optionValues[] = { (void*)(uintptr_t) max_regs_per_thread };
+            // This is either PTX, or a fatbin of SASS and PTX built at
+            // compile time (see the cuda_sass feature), which the driver
+            // loads without compiling anything if it has SASS for
+            // this GPU.
             CUresult err = cuModuleLoadDataEx(&loaded_module->module, ptx_src, 1, options, optionValues);
 
             if (err != CUDA_SUCCESS) {
@@ -531,8 +1134,29 @@ WEAK int halide_cuda_device_free(void *user_context, halide_buffer_t* buf) {
 
     halide_assert(user_context, validate_device_pointer(user_context, buf));
 
-    debug(user_context) <<  "    cuMemFree " << (void *)(dev_ptr) << "\n";
-    CUresult err = cuMemFree(dev_ptr);
+    // Hand the allocation back to the pool, unless it can't be
+    // identified as a whole allocation of its own.
+    // Deferred kernel launches may still use the allocation. Within a
+    // single stream, a pooled block is only reused after them, but in
+    // async mode it may be reused by another stream, and a block given
+    // back to the driver is gone.
+    CUstream stream = stream_for_context(user_context, ctx.context);
+    CUresult err = CUDA_SUCCESS;
+    if (async_mode) {
+        err = flush_graph_region(user_context, stream);
+    }
+    CUdeviceptr base = 0;
+    size_t size = 0;
+    if (err == CUDA_SUCCESS && !is_managed(buf) &&
+        cuMemGetAddressRange(&base, &size, dev_ptr) == CUDA_SUCCESS &&
+        base == dev_ptr &&
+        return_pooled_block(ctx.context, dev_ptr, size, stream)) {
+        debug(user_context) << "    returning " << (void *)(dev_ptr) << " to the pool\n";
+    } else {
+        flush_graph_region(user_context, stream);
+        debug(user_context) << "    cuMemFree " << (void *)(dev_ptr) << "\n";
+        err = cuMemFree(dev_ptr);
+    }
     // If cuMemFree fails, it isn't likely to succeed later, so just drop
     // the reference.
     buf->device_interface->impl->release_module();
@@ -563,67 +1187,169 @@ WEAK int halide_cuda_device_release(void *user_context) {
     }
 
     if (ctx) {
-        // It's possible that this is being called from the destructor of
-        // a static variable, in which case the driver may already be
-        // shutting down.
-        err = cuCtxPushCurrent(ctx);
-        if (err != CUDA_SUCCESS) {
-            err = cuCtxSynchronize();
+        release_context(user_context, ctx);
+    }
+
+    // Also release the contexts made for other devices, by
+    // user_contexts that selected them.
+    for (int i = 0; i <= max_cuda_devices; i++) {
+        CUcontext other = contexts[i];
+        if (other && other != ctx) {
+            release_context(user_context, other);
         }
-        halide_assert(user_context, err == CUDA_SUCCESS || err == CUDA_ERROR_DEINITIALIZED);
+    }
 
-        {
-            ScopedSpinLock spinlock(&filters_list_lock);
-
-            // Unload the modules attached to this context. Note that the list
-            // nodes themselves are not freed, only the module objects are
-            // released. Subsequent calls to halide_init_kernels might re-create
-            // the program object using the same list node to store the module
-            // object.
-            registered_filters *filters = filters_list;
-            while (filters) {
-                module_state **prev_ptr = &filters->modules;
-                module_state *loaded_module = filters->modules;
-                while (loaded_module != NULL) {
-                    if (loaded_module->context == ctx) {
-                        debug(user_context) << "    cuModuleUnload " << loaded_module->module << "\n";
-                        err = cuModuleUnload(loaded_module->module);
-                        halide_assert(user_context, err == CUDA_SUCCESS || err == CUDA_ERROR_DEINITIALIZED);
-                        *prev_ptr = loaded_module->next;
-                        free(loaded_module);
-                        loaded_module = *prev_ptr;
-                    } else {
-                        loaded_module = loaded_module->next;
-                        prev_ptr = &loaded_module->next;
-                    }
-                }
-                filters = filters->next;
-            }
-        }  // spinlock
+    halide_cuda_release_context(user_context);
 
-        CUcontext old_ctx;
-        cuCtxPopCurrent(&old_ctx);
+    return 0;
+}
 
-        // Only destroy the context if we own it
+WEAK int halide_cuda_release_unused_device_allocations(void *user_context) {
+    debug(user_context)
+        << "CUDA: halide_cuda_release_unused_device_allocations (user_context: "
+        << user_context << ")\n";
 
-        {
-            ScopedSpinLock spinlock(&context_lock);
+    // Don't create a context just to find that it has nothing pooled.
+    CUcontext current;
+    int err = halide_cuda_acquire_context(user_context, &current, false);
+    halide_cuda_release_context(user_context);
+    if (err != CUDA_SUCCESS || current == NULL) {
+        return err;
+    }
 
-            if (ctx == context) {
-                debug(user_context) << "    cuCtxDestroy " << context << "\n";
-                err = cuProfilerStop();
-                err = cuCtxDestroy(context);
-                halide_assert(user_context, err == CUDA_SUCCESS || err == CUDA_ERROR_DEINITIALIZED);
-                context = NULL;
-            }
-        }  // spinlock
+    Context ctx(user_context);
+    if (ctx.error != CUDA_SUCCESS) {
+        return ctx.error;
     }
 
-    halide_cuda_release_context(user_context);
+    return release_pooled_blocks(user_context, ctx.context);
+}
 
+WEAK int halide_cuda_begin_graph(void *user_context, uint64_t key) {
+    debug(user_context)
+        << "CUDA: halide_cuda_begin_graph (user_context: " << user_context
+        << ", key: " << key << ")\n";
+
+    Context ctx(user_context);
+    if (ctx.error != CUDA_SUCCESS) {
+        return ctx.error;
+    }
+
+    if (!graphs_supported()) {
+        debug(user_context) << "    CUDA graphs not supported by the driver\n";
+        return 0;
+    }
+
+    {
+        ScopedSpinLock spinlock(&graph_region_lock);
+        if (current_graph_region.active) {
+            error(user_context) << "CUDA: halide_cuda_begin_graph called while another graph region is active\n";
+            return -1;
+        }
+        current_graph_region.active = true;
+        current_graph_region.owner = user_context;
+    }  // spinlock
+
+    cached_graph *cached = NULL;
+    {
+        ScopedSpinLock spinlock(&cached_graphs_lock);
+        for (cached_graph *g = cached_graphs; g != NULL; g = g->next) {
+            if (g->context == ctx.context && g->key == key) {
+                cached = g;
+                break;
+            }
+        }
+    }  // spinlock
+
+    current_graph_region.context = ctx.context;
+    current_graph_region.key = key;
+    current_graph_region.cached = cached;
+    current_graph_region.replaying = (cached != NULL && cached->exec != NULL);
+    current_graph_region.next_cached = cached ? cached->launches : NULL;
+    current_graph_region.launches = NULL;
+    current_graph_region.tail = &current_graph_region.launches;
+    current_graph_region.num_launches = 0;
+    current_graph_region.abandoned = false;
+    debug(user_context) << (current_graph_region.replaying ? "    replaying" : "    recording")
+                        << " graph for key " << key << "\n";
     return 0;
 }
 
+WEAK int halide_cuda_end_graph(void *user_context) {
+    debug(user_context)
+        << "CUDA: halide_cuda_end_graph (user_context: " << user_context << ")\n";
+
+    if (!in_graph_region(user_context)) {
+        return 0;
+    }
+
+    Context ctx(user_context);
+    if (ctx.error != CUDA_SUCCESS) {
+        return ctx.error;
+    }
+    CUstream stream = stream_for_context(user_context, ctx.context);
+
+    graph_region &r = current_graph_region;
+    cached_graph *cached = r.cached;
+    CUresult err = CUDA_SUCCESS;
+    if (r.replaying && r.num_launches != cached->num_nodes) {
+        // The region issued fewer launches than the graph holds.
+        err = flush_graph_region(user_context, stream);
+    }
+
+    if (err == CUDA_SUCCESS && r.replaying) {
+        // Only hand the driver the parameters that changed.
+        graph_launch *old_launch = cached->launches;
+        int i = 0;
+        for (graph_launch *l = r.launches; l != NULL && err == CUDA_SUCCESS; l = l->next, i++) {
+            if (memcmp(l->arg_data, old_launch->arg_data, l->arg_data_size) != 0) {
+                CUDA_KERNEL_NODE_PARAMS params;
+                set_kernel_node_params(&params, l);
+                err = cuGraphExecKernelNodeSetParams(cached->exec, cached->nodes[i], &params);
+            }
+            old_launch = old_launch->next;
+        }
+        free_graph_launches(cached->launches);
+        cached->launches = r.launches;
+        r.launches = NULL;
+        if (err == CUDA_SUCCESS) {
+            debug(user_context) << "    cuGraphLaunch " << cached->num_nodes << " kernels\n";
+            err = cuGraphLaunch(cached->exec, stream);
+        }
+        if (err != CUDA_SUCCESS) {
+            error(user_context) << "CUDA: replaying graph failed: " << get_error_name(err);
+        }
+    } else if (err == CUDA_SUCCESS && r.num_launches > 0 && !r.abandoned &&
+               !(cached != NULL && cached->exec == NULL && cached->num_nodes == r.num_launches)) {
+        // Build a graph from this region's launches, replacing any
+        // stale graph for the key. Don't keep retrying graphs of the
+        // same size that the driver failed to instantiate.
+        cached_graph *g = build_cached_graph(user_context);
+        if (g != NULL) {
+            ScopedSpinLock spinlock(&cached_graphs_lock);
+            if (cached != NULL) {
+                cached_graph **prev_ptr = &cached_graphs;
+                while (*prev_ptr != cached) {
+                    prev_ptr = &(*prev_ptr)->next;
+                }
+                *prev_ptr = cached->next;
+            }
+            g->next = cached_graphs;
+            cached_graphs = g;
+        }
+        if (g != NULL && cached != NULL) {
+            destroy_cached_graph(cached);
+        }
+    }
+
+    free_graph_launches(r.launches);
+    r.launches = NULL;
+    ScopedSpinLock spinlock(&graph_region_lock);
+    r.active = false;
+    r.owner = NULL;
+    return err;
+}
+
 WEAK int halide_cuda_device_malloc(void *user_context, halide_buffer_t *buf) {
     debug(user_context)
         << "CUDA: halide_cuda_device_malloc (user_context: " << user_context
@@ -653,9 +1379,25 @@ WEAK int halide_cuda_device_malloc(void *user_context, halide_buffer_t *buf) {
     uint64_t t_before = halide_current_time_ns(user_context);
     #endif
 
-    CUdeviceptr p;
+    size = pool_size_class(size);
+    CUdeviceptr p = take_pooled_block(ctx.context, size, stream_for_context(user_context, ctx.context));
+    if (p) {
+        debug(user_context) << "    reusing pooled allocation " << (void *)p << "\n";
+        buf->device = p;
+        buf->device_interface = &cuda_device_interface;
+        buf->device_interface->impl->use_module();
+        return 0;
+    }
+
     debug(user_context) << "    cuMemAlloc " << (uint64_t)size << " -> ";
     CUresult err = cuMemAlloc(&p, size);
+    if (err == CUDA_ERROR_OUT_OF_MEMORY) {
+        // Blocks sitting in the pool may be what's using up the
+        // memory, so give them back and try again.
+        debug(user_context) << "out of memory, trimming the pool -> ";
+        release_pooled_blocks(user_context, ctx.context);
+        err = cuMemAlloc(&p, size);
+    }
     if (err != CUDA_SUCCESS) {
         debug(user_context) << get_error_name(err) << "\n";
         error(user_context) << "CUDA: cuMemAlloc failed: "
@@ -678,22 +1420,50 @@ WEAK int halide_cuda_device_malloc(void *user_context, halide_buffer_t *buf) {
 }
 
 namespace {
+// Copies between device buffers in the context ctx and peer_ctx use
+// cuMemcpyPeerAsync, unless ctx == peer_ctx.
 WEAK int do_multidimensional_copy(void *user_context, const device_copy &c,
-                                  uint64_t src, uint64_t dst, int d, bool from_host, bool to_host) {
+                                  uint64_t src, uint64_t dst, int d, bool from_host, bool to_host,
+                                  CUstream stream, CUcontext ctx, CUcontext peer_ctx) {
     if (d > MAX_COPY_DIMS) {
         error(user_context) << "Buffer has too many dimensions to copy to/from GPU\n";
         return -1;
     } else if (d == 0) {
         CUresult err = CUDA_SUCCESS;
-        const char *copy_name;
+        const char *copy_name = "memcpy";
         debug(user_context) << "    from " << (from_host ? "host" : "device")
                             << " to " << (to_host ? "host" : "device") << ", "
                             << (void *)src << " -> " << (void *)dst << ", " << c.chunk_size << " bytes\n";
-        if (!from_host && to_host) {
+        if (!from_host && !to_host && peer_ctx != ctx) {
+            // The source lives in another context, probably on
+            // another device. This is asynchronous with respect to the
+            // host, like cuMemcpyDtoD.
+            copy_name = "cuMemcpyPeerAsync";
+            err = cuMemcpyPeerAsync((CUdeviceptr)dst, ctx, (CUdeviceptr)src, peer_ctx, c.chunk_size, stream);
+        } else if (async_mode) {
+            // Queue the copy behind any kernels on the stream. The
+            // caller synchronizes the stream before a copy to the host
+            // returns.
+            if (!from_host && to_host) {
+                copy_name = "cuMemcpyDtoHAsync";
+                err = cuMemcpyDtoHAsync((void *)dst, (CUdeviceptr)src, c.chunk_size, stream);
+            } else if (from_host && !to_host) {
+                copy_name = "cuMemcpyHtoDAsync";
+                err = cuMemcpyHtoDAsync((CUdeviceptr)dst, (void *)src, c.chunk_size, stream);
+            } else if (!from_host && !to_host) {
+                copy_name = "cuMemcpyDtoDAsync";
+                err = cuMemcpyDtoDAsync((CUdeviceptr)dst, (CUdeviceptr)src, c.chunk_size, stream);
+            } else if (dst != src) {
+                memcpy((void *)dst, (void *)src, c.chunk_size);
+            }
+        } else if (!from_host && to_host) {
+            copy_name = "cuMemcpyDtoH";
             err = cuMemcpyDtoH((void *)dst, (CUdeviceptr)src, c.chunk_size);
         } else if (from_host && !to_host) {
+            copy_name = "cuMemcpyHtoD";
             err = cuMemcpyHtoD((CUdeviceptr)dst, (void *)src, c.chunk_size);
         } else if (!from_host && !to_host) {
+            copy_name = "cuMemcpyDtoD";
             err = cuMemcpyDtoD((CUdeviceptr)dst, (CUdeviceptr)src, c.chunk_size);
         } else if (dst != src) {
             // Could reach here if a user called directly into the
@@ -708,7 +1478,8 @@ WEAK int do_multidimensional_copy(void *user_context, const device_copy &c,
     } else {
         ssize_t src_off = 0, dst_off = 0;
         for (int i = 0; i < (int)c.extent[d-1]; i++) {
-            int err = do_multidimensional_copy(user_context, c, src + src_off, dst + dst_off, d - 1, from_host, to_host);
+            int err = do_multidimensional_copy(user_context, c, src + src_off, dst + dst_off, d - 1, from_host, to_host,
+                                               stream, ctx, peer_ctx);
             dst_off += c.dst_stride_bytes[d-1];
             src_off += c.src_stride_bytes[d-1];
             if (err) {
@@ -767,7 +1538,68 @@ WEAK int halide_cuda_buffer_copy(void *user_context, struct halide_buffer_t *src
         }
         #endif
 
-        err = do_multidimensional_copy(user_context, c, c.src + c.src_begin, c.dst, dst->dimensions, from_host, to_host);
+        CUstream stream = stream_for_context(user_context, ctx.context);
+        err = flush_graph_region(user_context, stream);
+        if (err != 0) {
+            error(user_context) << "CUDA: cuLaunchKernel failed: " << get_error_name((CUresult)err);
+            return err;
+        }
+
+        // The host and device sides of a buffer in managed memory
+        // are the same memory.
+        if (src == dst && is_managed(src)) {
+            CUresult result = prefetch_managed(user_context, src, to_host, stream);
+            if (result != CUDA_SUCCESS) {
+                error(user_context) << "CUDA: cuStreamSynchronize failed: "
+                                    << get_error_name(result);
+            }
+            return result;
+        }
+
+        // A source device buffer may belong to another context, in a
+        // multi-GPU setup. Copy from it directly rather than through
+        // the host. Work on the source buffer's own stream must be
+        // done first, and peer access lets the copy go directly over
+        // the bus where the devices support it.
+        CUcontext peer_ctx = ctx.context;
+        if (!from_host && !to_host && cuMemcpyPeerAsync != NULL) {
+            CUcontext src_ctx = NULL;
+            if (cuPointerGetAttribute(&src_ctx, CU_POINTER_ATTRIBUTE_CONTEXT, (CUdeviceptr)src->device) == CUDA_SUCCESS &&
+                src_ctx != NULL && src_ctx != ctx.context) {
+                debug(user_context) << "    peer copy from context " << (void *)src_ctx << "\n";
+                if (cuCtxEnablePeerAccess != NULL) {
+                    // Fails harmlessly if already enabled, or if the
+                    // devices can't access each other, in which case
+                    // the driver stages the copy itself.
+                    cuCtxEnablePeerAccess(src_ctx, 0);
+                }
+                CUcontext old;
+                CUresult result = cuCtxPushCurrent(src_ctx);
+                if (result == CUDA_SUCCESS) {
+                    result = cuCtxSynchronize();
+                    cuCtxPopCurrent(&old);
+                }
+                if (result != CUDA_SUCCESS) {
+                    error(user_context) << "CUDA: cuCtxSynchronize failed: " << get_error_name(result);
+                    return result;
+                }
+                peer_ctx = src_ctx;
+            }
+        }
+
+        err = do_multidimensional_copy(user_context, c, c.src + c.src_begin, c.dst, dst->dimensions, from_host, to_host,
+                                       stream, ctx.context, peer_ctx);
+
+        // In async mode, copies to the host are where the host waits
+        // for the device.
+        if (err == 0 && async_mode && to_host && !from_host) {
+            CUresult result = cuStreamSynchronize != NULL ? cuStreamSynchronize(stream) : cuCtxSynchronize();
+            if (result != CUDA_SUCCESS) {
+                error(user_context) << "CUDA: cuStreamSynchronize failed: "
+                                    << get_error_name(result);
+                err = result;
+            }
+        }
 
         #ifdef DEBUG_RUNTIME
         uint64_t t_after = halide_current_time_ns(user_context);
@@ -825,7 +1657,12 @@ WEAK int halide_cuda_device_sync(void *user_context, struct halide_buffer_t *) {
     uint64_t t_before = halide_current_time_ns(user_context);
     #endif
 
-    CUresult err;
+    CUresult err = flush_graph_region(user_context, stream_for_context(user_context, ctx.context));
+    if (err != CUDA_SUCCESS) {
+        error(user_context) << "CUDA: cuLaunchKernel failed: "
+                            << get_error_name(err);
+        return err;
+    }
     if (cuStreamSynchronize != NULL) {
         CUstream stream;
         int result = halide_cuda_get_stream(user_context, ctx.context, &stream);
@@ -898,6 +1735,8 @@ WEAK int halide_cuda_run(void *user_context,
         return err;
     }
 
+    report_kernel_stats(user_context, f, entry_name, threadsX, threadsY, threadsZ, shared_mem_bytes);
+
     size_t num_args = 0;
     while (arg_sizes[num_args] != 0) {
         debug(user_context) << "    halide_cuda_run " << (int)num_args
@@ -923,13 +1762,44 @@ WEAK int halide_cuda_run(void *user_context,
         }
     }
 
-    CUstream stream = NULL;
-    // We use whether this routine was defined in the cuda driver library
-    // as a test for streams support in the cuda implementation.
-    if (cuStreamSynchronize != NULL) {
-        int result = halide_cuda_get_stream(user_context, ctx.context, &stream);
-        if (result != 0) {
-            error(user_context) << "CUDA: In halide_cuda_run, halide_cuda_get_stream returned " << result << "\n";
+    CUstream stream = stream_for_context(user_context, ctx.context);
+
+    if (in_graph_region(user_context) && !current_graph_region.abandoned) {
+        graph_region &r = current_graph_region;
+        graph_launch *l = make_graph_launch(f, blocksX, blocksY, blocksZ,
+                                            threadsX, threadsY, threadsZ,
+                                            shared_mem_bytes, num_args,
+                                            arg_sizes, translated_args);
+        if (l == NULL) {
+            // Stop capturing, and run the rest of the region as usual.
+            err = flush_graph_region(user_context, stream);
+            r.abandoned = true;
+        } else {
+            *r.tail = l;
+            r.tail = &l->next;
+            r.num_launches++;
+            if (r.replaying && r.next_cached != NULL && same_kernel_launch(l, r.next_cached)) {
+                // Deferred to halide_cuda_end_graph.
+                r.next_cached = r.next_cached->next;
+                free(dev_handles);
+                free(translated_args);
+                return 0;
+            }
+            // The launches no longer match the graph. Issue the ones
+            // deferred before this one, which is issued below.
+            if (r.replaying) {
+                r.replaying = false;
+                for (graph_launch *p = r.launches; p != l && err == CUDA_SUCCESS; p = p->next) {
+                    err = launch_graph_launch(p, stream);
+                }
+            }
+        }
+        if (err != CUDA_SUCCESS) {
+            free(dev_handles);
+            free(translated_args);
+            error(user_context) << "CUDA: cuLaunchKernel failed: "
+                                << get_error_name(err);
+            return err;
         }
     }
 
@@ -961,12 +1831,100 @@ WEAK int halide_cuda_run(void *user_context,
     return 0;
 }
 
+// The host side of a buffer allocated along with its device side is
+// page-locked, so that the driver can DMA directly to and from it
+// instead of staging copies through a pinned bounce buffer.
 WEAK int halide_cuda_device_and_host_malloc(void *user_context, struct halide_buffer_t *buf) {
-    return halide_default_device_and_host_malloc(user_context, buf, &cuda_device_interface);
+    debug(user_context)
+        << "CUDA: halide_cuda_device_and_host_malloc (user_context: " << user_context
+        << ", buf: " << buf << ")\n";
+
+    size_t size = buf->size_in_bytes();
+    void *host = NULL;
+    {
+        Context ctx(user_context);
+        if (ctx.error != CUDA_SUCCESS) {
+            return ctx.error;
+        }
+
+        if (managed_memory_mode && cuMemAllocManaged != NULL) {
+            CUdeviceptr p = 0;
+            debug(user_context) << "    cuMemAllocManaged " << (uint64_t)size << " -> ";
+            CUresult err = cuMemAllocManaged(&p, size, CU_MEM_ATTACH_GLOBAL);
+            if (err == CUDA_SUCCESS) {
+                debug(user_context) << (void *)p << "\n";
+                buf->host = (uint8_t *)p;
+                buf->device = p;
+                buf->device_interface = &cuda_device_interface;
+                buf->device_interface->impl->use_module();
+                return 0;
+            }
+            // Not all devices support managed memory.
+            debug(user_context) << get_error_name(err) << "\n";
+        }
+
+        debug(user_context) << "    cuMemHostAlloc " << (uint64_t)size << " -> ";
+        CUresult err = cuMemHostAlloc(&host, size, CU_MEMHOSTALLOC_PORTABLE);
+        if (err != CUDA_SUCCESS) {
+            // Page-locked memory is a limited resource, so fall back
+            // to pageable memory rather than failing.
+            debug(user_context) << get_error_name(err) << "\n";
+            return halide_default_device_and_host_malloc(user_context, buf, &cuda_device_interface);
+        }
+        debug(user_context) << host << "\n";
+    }
+
+    buf->host = (uint8_t *)host;
+    int result = halide_device_malloc(user_context, buf, &cuda_device_interface);
+    if (result != 0) {
+        Context ctx(user_context);
+        cuMemFreeHost(host);
+        buf->host = NULL;
+    }
+    return result;
 }
 
 WEAK int halide_cuda_device_and_host_free(void *user_context, struct halide_buffer_t *buf) {
-    return halide_default_device_and_host_free(user_context, buf, &cuda_device_interface);
+    debug(user_context)
+        << "CUDA: halide_cuda_device_and_host_free (user_context: " << user_context
+        << ", buf: " << buf << ")\n";
+
+    if (is_managed(buf)) {
+        Context ctx(user_context);
+        if (ctx.error != CUDA_SUCCESS) {
+            return ctx.error;
+        }
+        // Kernels may still be using the memory.
+        CUstream stream = stream_for_context(user_context, ctx.context);
+        flush_graph_region(user_context, stream);
+        debug(user_context) << "    cuMemFree " << (void *)buf->host << "\n";
+        CUresult err = cuMemFree((CUdeviceptr)buf->device);
+        buf->device_interface->impl->release_module();
+        buf->device_interface = NULL;
+        buf->device = 0;
+        buf->host = NULL;
+        buf->set_host_dirty(false);
+        buf->set_device_dirty(false);
+        return err;
+    }
+
+    int result = halide_device_free(user_context, buf);
+    if (buf->host) {
+        // Only memory from cuMemHostAlloc has host flags.
+        Context ctx(user_context);
+        unsigned int flags;
+        if (ctx.error == CUDA_SUCCESS &&
+            cuMemHostGetFlags(&flags, buf->host) == CUDA_SUCCESS) {
+            debug(user_context) << "    cuMemFreeHost " << (void *)buf->host << "\n";
+            cuMemFreeHost(buf->host);
+        } else {
+            halide_free(user_context, buf->host);
+        }
+        buf->host = NULL;
+    }
+    buf->set_host_dirty(false);
+    buf->set_device_dirty(false);
+    return result;
 }
 
 WEAK int halide_cuda_wrap_device_ptr(void *user_context, struct halide_buffer_t *buf, uint64_t device_ptr) {
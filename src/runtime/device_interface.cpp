@@ -26,6 +26,71 @@ struct device_handle_wrapper {
 // a copy internaly as well.
 WEAK halide_mutex device_copy_mutex;
 
+// A side table of the regions of host dirty buffers that have actually
+// been modified. See halide_set_host_dirty_region. Protected by
+// device_copy_mutex.
+struct dirty_region {
+    const halide_buffer_t *buf;
+    int min[MAX_COPY_DIMS], max[MAX_COPY_DIMS];
+};
+
+#define MAX_DIRTY_REGIONS 64
+WEAK dirty_region dirty_regions[MAX_DIRTY_REGIONS];
+WEAK int num_dirty_regions = 0;
+
+WEAK int find_dirty_region(const halide_buffer_t *buf) {
+    for (int i = 0; i < num_dirty_regions; i++) {
+        if (dirty_regions[i].buf == buf) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+WEAK void forget_dirty_region(const halide_buffer_t *buf) {
+    int i = find_dirty_region(buf);
+    if (i >= 0) {
+        dirty_regions[i] = dirty_regions[--num_dirty_regions];
+    }
+}
+
+// Copy just the given region of a buffer to its device allocation,
+// through a device crop. Returns halide_error_code_device_crop_unsupported
+// if the device interface can't crop.
+WEAK int copy_region_to_device(void *user_context, struct halide_buffer_t *buf,
+                               const halide_device_interface_t *device_interface,
+                               const dirty_region &region) {
+    if (device_interface->impl->device_crop == halide_default_device_crop) {
+        return halide_error_code_device_crop_unsupported;
+    }
+
+    halide_dimension_t dims[MAX_COPY_DIMS];
+    halide_buffer_t crop = *buf;
+    crop.dim = dims;
+    crop.device = 0;
+    crop.device_interface = NULL;
+    int64_t offset = 0;
+    for (int i = 0; i < buf->dimensions; i++) {
+        dims[i] = buf->dim[i];
+        dims[i].min = region.min[i];
+        dims[i].extent = region.max[i] - region.min[i] + 1;
+        offset += (int64_t)(region.min[i] - buf->dim[i].min) * buf->dim[i].stride;
+    }
+    crop.host = buf->host + offset * buf->type.bytes();
+
+    device_interface->impl->use_module();
+    int result = device_interface->impl->device_crop(user_context, buf, &crop);
+    if (result == 0) {
+        result = device_interface->impl->copy_to_device(user_context, &crop);
+        int release_result = device_interface->impl->device_release_crop(user_context, &crop);
+        if (result == 0) {
+            result = release_result;
+        }
+    }
+    device_interface->impl->release_module();
+    return result;
+}
+
 WEAK int copy_to_host_already_locked(void *user_context, struct halide_buffer_t *buf) {
     if (!buf->device_dirty()) {
         return 0;  // my, that was easy
@@ -47,6 +112,7 @@ WEAK int copy_to_host_already_locked(void *user_context, struct halide_buffer_t
         return halide_error_code_copy_to_host_failed;
     }
     buf->set_device_dirty(false);
+    forget_dirty_region(buf);
     halide_msan_annotate_buffer_is_initialized(user_context, buf);
 
     return result;
@@ -144,6 +210,13 @@ WEAK int copy_to_device_already_locked(void *user_context,
         return halide_error_code_incompatible_device_interface;
     }
 
+    // A new device allocation needs all of the buffer copied to it, not
+    // just the dirty region.
+    const bool fresh_allocation = (buf->device == 0);
+    if (fresh_allocation) {
+        forget_dirty_region(buf);
+    }
+
     if (buf->device == 0) {
         result = halide_device_malloc(user_context, buf, device_interface);
         if (result != 0) {
@@ -159,7 +232,17 @@ WEAK int copy_to_device_already_locked(void *user_context,
             debug(user_context) << "halide_copy_to_device " << buf << " dev_dirty is true error\n";
             return halide_error_code_copy_to_device_failed;
         } else {
-            result = device_interface->impl->copy_to_device(user_context, buf);
+            result = halide_error_code_device_crop_unsupported;
+            int i = find_dirty_region(buf);
+            if (i >= 0) {
+                dirty_region region = dirty_regions[i];
+                forget_dirty_region(buf);
+                debug(user_context) << "halide_copy_to_device " << buf << " copying dirty region only\n";
+                result = copy_region_to_device(user_context, buf, device_interface, region);
+            }
+            if (result == halide_error_code_device_crop_unsupported) {
+                result = device_interface->impl->copy_to_device(user_context, buf);
+            }
             if (result == 0) {
                 buf->set_host_dirty(false);
             } else {
@@ -230,6 +313,60 @@ WEAK int halide_device_malloc(void *user_context, struct halide_buffer_t *buf,
     }
 }
 
+WEAK int halide_set_host_dirty_region(void *user_context, struct halide_buffer_t *buf,
+                                      const int *min, const int *extent) {
+    int result = debug_log_and_validate_buf(user_context, buf, "halide_set_host_dirty_region");
+    if (result != 0) {
+        return result;
+    }
+
+    ScopedMutexLock lock(&device_copy_mutex);
+
+    if (buf->device_dirty()) {
+        return halide_error_host_and_device_dirty(user_context);
+    }
+
+    // Clamp the region to the buffer. An empty region leaves the
+    // buffer as it is.
+    int region_min[MAX_COPY_DIMS], region_max[MAX_COPY_DIMS];
+    for (int i = 0; i < buf->dimensions && i < MAX_COPY_DIMS; i++) {
+        region_min[i] = min[i] > buf->dim[i].min ? min[i] : buf->dim[i].min;
+        int buf_max = buf->dim[i].min + buf->dim[i].extent - 1;
+        region_max[i] = min[i] + extent[i] - 1 < buf_max ? min[i] + extent[i] - 1 : buf_max;
+        if (region_max[i] < region_min[i]) {
+            return 0;
+        }
+    }
+
+    int i = find_dirty_region(buf);
+    if (i >= 0) {
+        // Grow the existing region to the bounding box of both.
+        for (int d = 0; d < buf->dimensions; d++) {
+            if (region_min[d] < dirty_regions[i].min[d]) {
+                dirty_regions[i].min[d] = region_min[d];
+            }
+            if (region_max[d] > dirty_regions[i].max[d]) {
+                dirty_regions[i].max[d] = region_max[d];
+            }
+        }
+    } else if (!buf->host_dirty() && buf->device &&
+               buf->dimensions <= MAX_COPY_DIMS &&
+               num_dirty_regions < MAX_DIRTY_REGIONS) {
+        // Host and device were in sync, so this region is all that
+        // will need copying. If the buffer was already host dirty
+        // without a region, all of it still needs copying.
+        i = num_dirty_regions++;
+        dirty_regions[i].buf = buf;
+        for (int d = 0; d < buf->dimensions; d++) {
+            dirty_regions[i].min[d] = region_min[d];
+            dirty_regions[i].max[d] = region_max[d];
+        }
+    }
+
+    buf->set_host_dirty(true);
+    return 0;
+}
+
 /** Free any device memory associated with a halide_buffer_t. */
 WEAK int halide_device_free(void *user_context, struct halide_buffer_t *buf) {
     int result = debug_log_and_validate_buf(user_context, buf, "halide_device_free");
@@ -237,6 +374,11 @@ WEAK int halide_device_free(void *user_context, struct halide_buffer_t *buf) {
         return result;
     }
 
+    {
+        ScopedMutexLock lock(&device_copy_mutex);
+        forget_dirty_region(buf);
+    }
+
     const halide_device_interface_t *device_interface = buf->device_interface;
     if (device_interface != NULL) {
         // Ensure interface is not freed prematurely.
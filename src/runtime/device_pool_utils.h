@@ -0,0 +1,100 @@
+#ifndef HALIDE_RUNTIME_DEVICE_POOL_UTILS_H
+#define HALIDE_RUNTIME_DEVICE_POOL_UTILS_H
+
+#include "runtime_internal.h"
+#include "scoped_spin_lock.h"
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+// Device runtimes that keep freed device allocations around for reuse
+// bin them into size classes four to an octave, so an allocation
+// wastes at most a quarter of its size on rounding.
+
+// Allocations smaller than this are rounded up to it.
+const int min_pooled_block_log2 = 8;
+// This must be a power of two.
+const int pool_bins_per_octave = 4;
+const int pool_bins_per_octave_log2 = 2;
+const int num_pool_bins = (sizeof(size_t) * 8 - min_pooled_block_log2) * pool_bins_per_octave;
+
+// The bin holding blocks of at least the given size, which must be a
+// size class boundary or any size at all for blocks being returned.
+WEAK int pool_bin_for_size(size_t size) {
+    if (size < ((size_t)1 << min_pooled_block_log2)) {
+        size = (size_t)1 << min_pooled_block_log2;
+    }
+    int octave = 0;
+    while ((size >> octave) >= (size_t)(2 * pool_bins_per_octave)) {
+        octave++;
+    }
+    // The top bits of the size, below the leading one, select the bin
+    // within the octave.
+    int sub = (int)(size >> octave) - pool_bins_per_octave;
+    int bin = (octave + pool_bins_per_octave_log2 - min_pooled_block_log2) * pool_bins_per_octave + sub;
+    return bin < num_pool_bins ? bin : num_pool_bins - 1;
+}
+
+// Round a requested size up to the smallest size class that holds it.
+WEAK size_t pool_size_class(size_t size) {
+    if (size <= ((size_t)1 << min_pooled_block_log2)) {
+        return (size_t)1 << min_pooled_block_log2;
+    }
+    int octave = 0;
+    while ((size >> octave) >= (size_t)(2 * pool_bins_per_octave)) {
+        octave++;
+    }
+    size_t step = (size_t)1 << octave;
+    size_t rounded = (size + step - 1) & ~(step - 1);
+    // Rounding up may overflow into a size class of the next octave,
+    // which is still a class boundary.
+    return rounded < size ? size : rounded;
+}
+
+// Device crops on runtimes that can't express a crop as a device
+// pointer need a small handle for each crop. Tiled code can make
+// thousands of crops per run, so released handles are kept on a free
+// list rather than handed back to free. The list only grows to the
+// most crops ever live at once.
+struct free_crop_handle {
+    free_crop_handle *next;
+};
+
+// Take a handle of the given size from the free list, or malloc one.
+WEAK void *take_crop_handle(free_crop_handle **list, volatile int *lock, size_t size) {
+    {
+        ScopedSpinLock spinlock(lock);
+        free_crop_handle *h = *list;
+        if (h) {
+            *list = h->next;
+            return h;
+        }
+    }
+    return malloc(size < sizeof(free_crop_handle) ? sizeof(free_crop_handle) : size);
+}
+
+// Put a handle made by take_crop_handle on the free list.
+WEAK void return_crop_handle(free_crop_handle **list, volatile int *lock, void *handle) {
+    free_crop_handle *h = (free_crop_handle *)handle;
+    ScopedSpinLock spinlock(lock);
+    h->next = *list;
+    *list = h;
+}
+
+// Free all the handles on the free list.
+WEAK void release_crop_handles(free_crop_handle **list, volatile int *lock) {
+    free_crop_handle *h;
+    {
+        ScopedSpinLock spinlock(lock);
+        h = *list;
+        *list = NULL;
+    }
+    while (h) {
+        free_crop_handle *next = h->next;
+        free(h);
+        h = next;
+    }
+}
+
+}}} // namespace Halide::Runtime::Internal
+
+#endif // HALIDE_RUNTIME_DEVICE_POOL_UTILS_H
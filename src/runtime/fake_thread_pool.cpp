@@ -18,6 +18,21 @@ WEAK int halide_default_do_par_for(void *user_context, halide_task_t f,
     return 0;
 }
 
+WEAK int halide_work_stealing_do_par_for(void *user_context, halide_task_t f,
+                                         int min, int size, uint8_t *closure) {
+    return halide_default_do_par_for(user_context, f, min, size, closure);
+}
+
+WEAK int halide_guided_do_par_for(void *user_context, halide_task_t f,
+                                  int min, int size, uint8_t *closure) {
+    return halide_default_do_par_for(user_context, f, min, size, closure);
+}
+
+WEAK int halide_affinity_do_par_for(void *user_context, halide_task_t f,
+                                    int min, int size, uint8_t *closure) {
+    return halide_default_do_par_for(user_context, f, min, size, closure);
+}
+
 }
 
 namespace Halide { namespace Runtime { namespace Internal {
@@ -35,6 +50,22 @@ WEAK halide_thread *halide_spawn_thread(void (*f)(void *), void *closure) {
     return NULL;
 }
 
+WEAK int halide_semaphore_release(halide_semaphore_t *sema, int n) {
+    sema->_private[0] += n;
+    return 0;
+}
+
+WEAK int halide_semaphore_acquire(halide_semaphore_t *sema, int n) {
+    // Tasks run in order on this thread, so anything we could wait for
+    // has already happened.
+    if (sema->_private[0] < n) {
+        halide_error(NULL, "halide_semaphore_acquire would wait forever.");
+        return -1;
+    }
+    sema->_private[0] -= n;
+    return 0;
+}
+
 WEAK void halide_mutex_lock(halide_mutex *mutex) {
 }
 
@@ -51,6 +82,59 @@ WEAK int halide_set_num_threads(int n) {
     return 1;
 }
 
+WEAK int halide_get_num_threads() {
+    return 1;
+}
+
+WEAK struct halide_thread_pool *halide_thread_pool_create(int num_threads, int first_cpu, int num_cpus) {
+    // There are no threads to make, but return something distinct
+    // from NULL so that callers can tell this apart from failure.
+    static int fake_pool;
+    return (struct halide_thread_pool *)&fake_pool;
+}
+
+WEAK void halide_thread_pool_destroy(struct halide_thread_pool *pool) {
+}
+
+WEAK int halide_thread_pool_bind(void *user_context, struct halide_thread_pool *pool) {
+    return 0;
+}
+
+WEAK int halide_thread_pool_record_events(int max_events) {
+    // There is no thread pool to trace.
+    return max_events ? -1 : 0;
+}
+
+WEAK int halide_thread_pool_events_json(char *buf, size_t size) {
+    // An empty trace.
+    const char *trace = "{\"traceEvents\":[]}\n";
+    size_t length = 0;
+    for (; trace[length]; length++) {
+        if (buf && length + 1 < size) {
+            buf[length] = trace[length];
+        }
+    }
+    if (buf && size) {
+        buf[length < size ? length : size - 1] = 0;
+    }
+    return (int)length;
+}
+
+WEAK int halide_thread_pool_set_limits(void *user_context, int max_threads, int priority) {
+    if (max_threads < 0) {
+        halide_error(NULL, "halide_thread_pool_set_limits: max_threads must be >= 0.");
+        return -1;
+    }
+    return 0;
+}
+
+WEAK int halide_thread_pool_set_idle_policy(int spin_us) {
+    if (spin_us < 0) {
+        halide_error(NULL, "halide_thread_pool_set_idle_policy: must be >= 0.");
+    }
+    return 0;
+}
+
 WEAK halide_do_task_t halide_set_custom_do_task(halide_do_task_t f) {
     halide_do_task_t result = custom_do_task;
     custom_do_task = f;
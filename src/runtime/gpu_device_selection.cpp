@@ -8,6 +8,16 @@ WEAK int halide_gpu_device = 0;
 WEAK int halide_gpu_device_lock = 0;
 WEAK bool halide_gpu_device_initialized = false;
 
+// The devices set for particular user_contexts with
+// halide_set_gpu_device_for_user_context. Also protected by
+// halide_gpu_device_lock.
+struct user_context_gpu_device {
+    void *user_context;
+    int device;
+};
+const int max_user_context_gpu_devices = 64;
+WEAK user_context_gpu_device halide_user_context_gpu_devices[max_user_context_gpu_devices];
+
 }}} // namespace Halide::Runtime::Internal
 
 extern int atoi(const char *);
@@ -19,8 +29,44 @@ WEAK void halide_set_gpu_device(int d) {
     halide_gpu_device = d;
     halide_gpu_device_initialized = true;
 }
+WEAK int halide_set_gpu_device_for_user_context(void *user_context, int d) {
+    ScopedSpinLock lock(&halide_gpu_device_lock);
+    user_context_gpu_device *slot = NULL;
+    for (int i = 0; i < max_user_context_gpu_devices; i++) {
+        user_context_gpu_device &e = halide_user_context_gpu_devices[i];
+        if (e.user_context == user_context) {
+            slot = &e;
+            break;
+        } else if (slot == NULL && e.user_context == NULL) {
+            slot = &e;
+        }
+    }
+    if (slot == NULL) {
+        return -1;
+    }
+    slot->user_context = user_context;
+    slot->device = d;
+    return 0;
+}
+
+WEAK void halide_clear_gpu_device_for_user_context(void *user_context) {
+    ScopedSpinLock lock(&halide_gpu_device_lock);
+    for (int i = 0; i < max_user_context_gpu_devices; i++) {
+        if (halide_user_context_gpu_devices[i].user_context == user_context) {
+            halide_user_context_gpu_devices[i].user_context = NULL;
+        }
+    }
+}
+
 WEAK int halide_get_gpu_device(void *user_context) {
     ScopedSpinLock lock(&halide_gpu_device_lock);
+    if (user_context) {
+        for (int i = 0; i < max_user_context_gpu_devices; i++) {
+            if (halide_user_context_gpu_devices[i].user_context == user_context) {
+                return halide_user_context_gpu_devices[i].device;
+            }
+        }
+    }
     if (!halide_gpu_device_initialized) {
         const char *var = getenv("HL_GPU_DEVICE");
         if (var) {
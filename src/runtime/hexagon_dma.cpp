@@ -0,0 +1,319 @@
+#include "runtime_internal.h"
+#include "device_interface.h"
+#include "HalideRuntimeHexagonDma.h"
+#include "mini_hexagon_dma.h"
+#include "printer.h"
+#include "scoped_mutex_lock.h"
+
+namespace Halide { namespace Runtime { namespace Internal { namespace HexagonDma {
+
+extern WEAK halide_device_interface_t hexagon_dma_device_interface;
+
+// The device handle of a buffer wrapping a frame. Crops of the buffer
+// get their own handle, with the offset of the crop in the frame.
+struct dma_device_handle {
+    uint8_t *buffer;
+    uint16_t offset_x;
+    uint16_t offset_y;
+    int frame_width;
+    int frame_height;
+    int frame_stride;
+    void *dma_engine;
+    bool is_ubwc;
+    t_eDmaFmt fmt;
+    void *desc_buffer;
+};
+
+// Transfers on one engine are serialized, as an engine does one at
+// a time.
+WEAK halide_mutex engine_lock = { { 0 } };
+
+WEAK dma_device_handle *malloc_device_handle() {
+    dma_device_handle *handle = (dma_device_handle *)malloc(sizeof(dma_device_handle));
+    if (handle) {
+        memset(handle, 0, sizeof(dma_device_handle));
+        handle->fmt = eDmaFmt_RawData;
+    }
+    return handle;
+}
+
+WEAK bool dma_library_available(void *user_context) {
+    if (!hDmaWrapper_AllocDma || !nDmaWrapper_DmaTransferSetup) {
+        error(user_context) << "The Hexagon user DMA library isn't available.\n";
+        return false;
+    }
+    return true;
+}
+
+// Move the region of the frame of src given by the dims of dst into
+// the host memory of dst.
+WEAK int dma_copy_to_host(void *user_context, const halide_buffer_t *src, halide_buffer_t *dst) {
+    dma_device_handle *handle = reinterpret<dma_device_handle *>(src->device);
+    if (!handle->dma_engine) {
+        error(user_context) << "Hexagon DMA: the frame hasn't been prepared for copies to the host.\n";
+        return halide_error_code_copy_to_host_failed;
+    }
+    if (dst->dimensions != 2 || dst->dim[0].stride != 1) {
+        error(user_context) << "Hexagon DMA: only dense 2D regions of a frame can be copied.\n";
+        return halide_error_code_copy_to_host_failed;
+    }
+
+    t_StDmaWrapper_RoiAlignInfo walk_size;
+    nDmaWrapper_GetRecommendedWalkSize(handle->fmt, handle->is_ubwc, &walk_size);
+
+    t_StDmaWrapper_DmaTransferSetup setup;
+    setup.stFrame.aAddr = reinterpret<addr_t>(handle->buffer);
+    setup.stFrame.u16W = handle->frame_width;
+    setup.stFrame.u16H = handle->frame_height;
+    setup.stFrame.u16Stride = handle->frame_stride;
+    setup.stRoi.u16X = handle->offset_x + dst->dim[0].min - src->dim[0].min;
+    setup.stRoi.u16Y = handle->offset_y + dst->dim[1].min - src->dim[1].min;
+    setup.stRoi.u16W = dst->dim[0].extent;
+    setup.stRoi.u16H = dst->dim[1].extent;
+    setup.u16RoiStride = dst->dim[1].stride;
+    setup.eFmt = handle->fmt;
+    setup.bIsFmtUbwc = handle->is_ubwc;
+    setup.bUse16BitPaddingInL2 = false;
+    setup.pDescBuf = handle->desc_buffer;
+    setup.pTcmDataBuf = dst->host;
+    setup.eTransferType = eDmaWrapper_DdrToL2;
+
+    if (setup.stRoi.u16X % walk_size.u16W || setup.stRoi.u16Y % walk_size.u16H) {
+        error(user_context) << "Hexagon DMA: the region at (" << setup.stRoi.u16X << ", "
+                            << setup.stRoi.u16Y << ") isn't aligned to the walk size of "
+                            << walk_size.u16W << "x" << walk_size.u16H << ".\n";
+        return halide_error_code_copy_to_host_failed;
+    }
+
+    debug(user_context) << "Hexagon DMA: moving " << setup.stRoi.u16W << "x" << setup.stRoi.u16H
+                        << " at (" << setup.stRoi.u16X << ", " << setup.stRoi.u16Y << ")\n";
+
+    ScopedMutexLock lock(&engine_lock);
+    t_DmaWrapper_DmaEngineHandle engine = handle->dma_engine;
+    if (nDmaWrapper_DmaTransferSetup(engine, &setup) != DMA_SUCCESS ||
+        nDmaWrapper_Move(engine) != DMA_SUCCESS ||
+        nDmaWrapper_Wait(engine) != DMA_SUCCESS) {
+        error(user_context) << "Hexagon DMA: the transfer failed.\n";
+        return halide_error_code_copy_to_host_failed;
+    }
+    return 0;
+}
+
+}}}} // namespace Halide::Runtime::Internal::HexagonDma
+
+using namespace Halide::Runtime::Internal;
+using namespace Halide::Runtime::Internal::HexagonDma;
+
+extern "C" {
+
+WEAK int halide_hexagon_dma_device_malloc(void *user_context, halide_buffer_t *buf) {
+    error(user_context) << "Hexagon DMA: buffers must wrap a frame with "
+                        << "halide_hexagon_dma_device_wrap_native.\n";
+    return halide_error_code_device_malloc_failed;
+}
+
+WEAK int halide_hexagon_dma_device_free(void *user_context, halide_buffer_t *buf) {
+    // The frame isn't ours to free.
+    return halide_hexagon_dma_device_detach_native(user_context, buf);
+}
+
+WEAK int halide_hexagon_dma_device_sync(void *user_context, halide_buffer_t *buf) {
+    // Transfers are complete when buffer_copy returns.
+    return 0;
+}
+
+WEAK int halide_hexagon_dma_device_release(void *user_context) {
+    return 0;
+}
+
+WEAK int halide_hexagon_dma_copy_to_host(void *user_context, halide_buffer_t *buf) {
+    if (!buf->host) {
+        return halide_error_code_host_is_null;
+    }
+    return dma_copy_to_host(user_context, buf, buf);
+}
+
+WEAK int halide_hexagon_dma_copy_to_device(void *user_context, halide_buffer_t *buf) {
+    error(user_context) << "Hexagon DMA: copies from the host to a frame are not supported.\n";
+    return halide_error_code_copy_to_device_failed;
+}
+
+WEAK int halide_hexagon_dma_buffer_copy(void *user_context, halide_buffer_t *src,
+                                        const halide_device_interface_t *dst_device_interface,
+                                        halide_buffer_t *dst) {
+    if (dst_device_interface || src->device_interface != &hexagon_dma_device_interface) {
+        error(user_context) << "Hexagon DMA: only copies from a frame to the host are supported.\n";
+        return halide_error_code_device_buffer_copy_failed;
+    }
+    if (!dst->host) {
+        return halide_error_code_host_is_null;
+    }
+    return dma_copy_to_host(user_context, src, dst);
+}
+
+WEAK int halide_hexagon_dma_device_crop(void *user_context, const halide_buffer_t *src,
+                                        halide_buffer_t *dst) {
+    dma_device_handle *src_handle = reinterpret<dma_device_handle *>(src->device);
+    dma_device_handle *dst_handle = malloc_device_handle();
+    if (!dst_handle) {
+        return halide_error_code_out_of_memory;
+    }
+    *dst_handle = *src_handle;
+    dst_handle->offset_x += dst->dim[0].min - src->dim[0].min;
+    dst_handle->offset_y += dst->dim[1].min - src->dim[1].min;
+    dst->device = reinterpret<uint64_t>(dst_handle);
+    dst->device_interface = src->device_interface;
+    dst->set_device_dirty(src->device_dirty());
+    return 0;
+}
+
+WEAK int halide_hexagon_dma_device_release_crop(void *user_context, halide_buffer_t *buf) {
+    free(reinterpret<dma_device_handle *>(buf->device));
+    buf->device = 0;
+    return 0;
+}
+
+WEAK int halide_hexagon_dma_device_wrap_native(void *user_context, halide_buffer_t *buf, uint64_t mem) {
+    halide_assert(user_context, buf->device == 0);
+    if (buf->device != 0) {
+        return halide_error_code_device_wrap_native_failed;
+    }
+    if (buf->dimensions < 2) {
+        error(user_context) << "Hexagon DMA: a frame must have at least two dimensions.\n";
+        return halide_error_code_device_wrap_native_failed;
+    }
+    dma_device_handle *handle = malloc_device_handle();
+    if (!handle) {
+        return halide_error_code_out_of_memory;
+    }
+    handle->buffer = reinterpret<uint8_t *>(mem);
+    handle->frame_width = buf->dim[0].extent;
+    handle->frame_height = buf->dim[1].extent;
+    handle->frame_stride = buf->dim[1].stride;
+    buf->device_interface = &hexagon_dma_device_interface;
+    buf->device_interface->impl->use_module();
+    buf->device = reinterpret<uint64_t>(handle);
+    return 0;
+}
+
+WEAK int halide_hexagon_dma_device_detach_native(void *user_context, halide_buffer_t *buf) {
+    if (buf->device == 0) {
+        return 0;
+    }
+    if (buf->device_interface != &hexagon_dma_device_interface) {
+        error(user_context) << "Hexagon DMA: buffer doesn't wrap a frame.\n";
+        return halide_error_code_incompatible_device_interface;
+    }
+    free(reinterpret<dma_device_handle *>(buf->device));
+    buf->device_interface->impl->release_module();
+    buf->device = 0;
+    buf->device_interface = NULL;
+    return 0;
+}
+
+WEAK int halide_hexagon_dma_device_and_host_malloc(void *user_context, halide_buffer_t *buf) {
+    return halide_hexagon_dma_device_malloc(user_context, buf);
+}
+
+WEAK int halide_hexagon_dma_device_and_host_free(void *user_context, halide_buffer_t *buf) {
+    return halide_default_device_and_host_free(user_context, buf, &hexagon_dma_device_interface);
+}
+
+WEAK int halide_hexagon_dma_allocate_engine(void *user_context, void **dma_engine) {
+    if (!dma_library_available(user_context)) {
+        return halide_error_code_generic_error;
+    }
+    *dma_engine = hDmaWrapper_AllocDma();
+    if (!*dma_engine) {
+        error(user_context) << "Hexagon DMA: no engine is available.\n";
+        return halide_error_code_generic_error;
+    }
+    return 0;
+}
+
+WEAK int halide_hexagon_dma_deallocate_engine(void *user_context, void *dma_engine) {
+    if (nDmaWrapper_FreeDma((t_DmaWrapper_DmaEngineHandle)dma_engine) != DMA_SUCCESS) {
+        error(user_context) << "Hexagon DMA: freeing the engine failed.\n";
+        return halide_error_code_generic_error;
+    }
+    return 0;
+}
+
+WEAK int halide_hexagon_dma_prepare_for_copy_to_host(void *user_context, halide_buffer_t *buf,
+                                                     void *dma_engine, bool is_ubwc,
+                                                     halide_hexagon_image_fmt_t fmt) {
+    if (buf->device_interface != &hexagon_dma_device_interface || !buf->device) {
+        error(user_context) << "Hexagon DMA: buffer doesn't wrap a frame.\n";
+        return halide_error_code_incompatible_device_interface;
+    }
+    if (!dma_library_available(user_context)) {
+        return halide_error_code_generic_error;
+    }
+    dma_device_handle *handle = reinterpret<dma_device_handle *>(buf->device);
+    handle->dma_engine = dma_engine;
+    handle->is_ubwc = is_ubwc;
+    handle->fmt = (t_eDmaFmt)fmt;
+    if (!handle->desc_buffer) {
+        handle->desc_buffer = halide_malloc(user_context, nDmaWrapper_GetDescbuffsize(&handle->fmt, 1));
+        if (!handle->desc_buffer) {
+            return halide_error_code_out_of_memory;
+        }
+    }
+    return 0;
+}
+
+WEAK int halide_hexagon_dma_unprepare(void *user_context, halide_buffer_t *buf) {
+    dma_device_handle *handle = reinterpret<dma_device_handle *>(buf->device);
+    if (handle->dma_engine) {
+        nDmaWrapper_FinishFrame(handle->dma_engine);
+        handle->dma_engine = NULL;
+    }
+    halide_free(user_context, handle->desc_buffer);
+    handle->desc_buffer = NULL;
+    return 0;
+}
+
+WEAK const halide_device_interface_t *halide_hexagon_dma_device_interface() {
+    return &hexagon_dma_device_interface;
+}
+
+} // extern "C" linkage
+
+namespace Halide { namespace Runtime { namespace Internal { namespace HexagonDma {
+
+WEAK halide_device_interface_impl_t hexagon_dma_device_interface_impl = {
+    halide_use_jit_module,
+    halide_release_jit_module,
+    halide_hexagon_dma_device_malloc,
+    halide_hexagon_dma_device_free,
+    halide_hexagon_dma_device_sync,
+    halide_hexagon_dma_device_release,
+    halide_hexagon_dma_copy_to_host,
+    halide_hexagon_dma_copy_to_device,
+    halide_hexagon_dma_device_and_host_malloc,
+    halide_hexagon_dma_device_and_host_free,
+    halide_hexagon_dma_buffer_copy,
+    halide_hexagon_dma_device_crop,
+    halide_hexagon_dma_device_release_crop,
+    halide_hexagon_dma_device_wrap_native,
+    halide_hexagon_dma_device_detach_native,
+};
+
+WEAK halide_device_interface_t hexagon_dma_device_interface = {
+    halide_device_malloc,
+    halide_device_free,
+    halide_device_sync,
+    halide_device_release,
+    halide_copy_to_host,
+    halide_copy_to_device,
+    halide_device_and_host_malloc,
+    halide_device_and_host_free,
+    halide_buffer_copy,
+    halide_device_crop,
+    halide_device_release_crop,
+    halide_device_wrap_native,
+    halide_device_detach_native,
+    &hexagon_dma_device_interface_impl
+};
+
+}}}} // namespace Halide::Runtime::Internal::HexagonDma
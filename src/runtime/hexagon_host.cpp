@@ -1,9 +1,11 @@
 #include "runtime_internal.h"
 #include "device_buffer_utils.h"
 #include "device_interface.h"
+#include "device_pool_utils.h"
 #include "HalideRuntimeHexagonHost.h"
 #include "printer.h"
 #include "scoped_mutex_lock.h"
+#include "scoped_spin_lock.h"
 
 namespace Halide { namespace Runtime { namespace Internal { namespace Hexagon {
 
@@ -32,6 +34,7 @@ typedef int (*remote_run_fn)(halide_hexagon_handle_t, int,
 typedef int (*remote_release_library_fn)(halide_hexagon_handle_t);
 typedef int (*remote_poll_log_fn)(char *, int, int *);
 typedef void (*remote_poll_profiler_state_fn)(int *, int *);
+typedef int (*remote_poll_profiler_cycles_fn)(int *, uint64_t *, int);
 typedef int (*remote_power_fn)();
 typedef int (*remote_power_mode_fn)(int);
 typedef int (*remote_power_perf_fn)(int, unsigned int, unsigned int, int, unsigned int, unsigned int, int, int);
@@ -46,6 +49,7 @@ WEAK remote_run_fn remote_run = NULL;
 WEAK remote_release_library_fn remote_release_library = NULL;
 WEAK remote_poll_log_fn remote_poll_log = NULL;
 WEAK remote_poll_profiler_state_fn remote_poll_profiler_state = NULL;
+WEAK remote_poll_profiler_cycles_fn remote_poll_profiler_cycles = NULL;
 WEAK remote_power_fn remote_power_hvx_on = NULL;
 WEAK remote_power_fn remote_power_hvx_off = NULL;
 WEAK remote_power_perf_fn remote_set_performance = NULL;
@@ -89,6 +93,23 @@ WEAK void get_remote_profiler_state(int *func, int *threads) {
     remote_poll_profiler_state(func, threads);
 }
 
+// The simulator counts the cycles spent in each func. This adds them
+// to the profiler's cycle counts, so that the report has exact
+// simulated cycles per Func, rather than just samples of host time.
+WEAK void poll_profiler_cycles(void *user_context) {
+    if (!remote_poll_profiler_cycles) return;
+
+    while (true) {
+        int funcs[16];
+        uint64_t cycles[16];
+        int count = remote_poll_profiler_cycles(funcs, cycles, 16);
+        for (int i = 0; i < count; i++) {
+            halide_profiler_add_perf_counters(user_context, funcs[i], cycles[i], 0, 0);
+        }
+        if (count < 16) break;
+    }
+}
+
 template <typename T>
 __attribute__((always_inline)) void get_symbol(void *user_context, void *host_lib, const char* name, T &sym, bool required = true) {
     debug(user_context) << "    halide_get_library_symbol('" << name << "') -> \n";
@@ -142,6 +163,7 @@ WEAK int init_hexagon_runtime(void *user_context) {
     // These symbols are optional.
     get_symbol(user_context, host_lib, "halide_hexagon_remote_poll_log", remote_poll_log, /* required */ false);
     get_symbol(user_context, host_lib, "halide_hexagon_remote_poll_profiler_state", remote_poll_profiler_state, /* required */ false);
+    get_symbol(user_context, host_lib, "halide_hexagon_remote_poll_profiler_cycles", remote_poll_profiler_cycles, /* required */ false);
 
     // If these are unavailable, then the runtime always powers HVX on and so these are not necessary.
     get_symbol(user_context, host_lib, "halide_hexagon_remote_power_hvx_on", remote_power_hvx_on, /* required */ false);
@@ -165,6 +187,92 @@ struct module_state {
 WEAK module_state *state_list = NULL;
 WEAK halide_hexagon_handle_t shared_runtime = 0;
 
+// Each ION allocation is mapped into the host process and registered
+// with FastRPC, so that passing it to the remote side doesn't copy or
+// remap it. That's expensive enough that pipelines called in a loop
+// spend much of their time just allocating and freeing device
+// buffers. So ION allocations freed by Halide are kept in a pool,
+// still registered, and handed back out to later allocations of a
+// similar size, binned into the size classes defined in
+// device_pool_utils.h.
+struct pooled_block {
+    void *ion;
+    size_t size;
+    pooled_block *next;
+};
+
+WEAK pooled_block *device_pool[num_pool_bins];
+// This spinlock protects the above device_pool.
+volatile int WEAK device_pool_lock = 0;
+
+// Take an ION allocation of at least the given size class from the
+// pool. Returns NULL if there is none.
+WEAK void *take_pooled_block(size_t size) {
+    pooled_block *b = NULL;
+    {
+        ScopedSpinLock spinlock(&device_pool_lock);
+        pooled_block **prev_ptr = &device_pool[pool_bin_for_size(size)];
+        b = *prev_ptr;
+        while (b != NULL) {
+            if (b->size >= size) {
+                *prev_ptr = b->next;
+                break;
+            }
+            prev_ptr = &b->next;
+            b = b->next;
+        }
+    }  // spinlock
+    if (b == NULL) {
+        return NULL;
+    }
+    void *ion = b->ion;
+    free(b);
+    return ion;
+}
+
+// Put an ION allocation of the given size into the pool. Returns false
+// if it should be freed instead.
+WEAK bool return_pooled_block(void *ion, size_t size) {
+    pooled_block *b = (pooled_block *)malloc(sizeof(pooled_block));
+    if (b == NULL) {
+        return false;
+    }
+    b->ion = ion;
+    b->size = size;
+    ScopedSpinLock spinlock(&device_pool_lock);
+    pooled_block **bin = &device_pool[pool_bin_for_size(size)];
+    b->next = *bin;
+    *bin = b;
+    return true;
+}
+
+// Free all pooled ION allocations.
+WEAK void release_pooled_blocks(void *user_context) {
+    // Unlink the blocks under the lock, and free them outside it.
+    pooled_block *to_free = NULL;
+    {
+        ScopedSpinLock spinlock(&device_pool_lock);
+        for (int i = 0; i < num_pool_bins; i++) {
+            pooled_block *b = device_pool[i];
+            while (b != NULL) {
+                pooled_block *next = b->next;
+                b->next = to_free;
+                to_free = b;
+                b = next;
+            }
+            device_pool[i] = NULL;
+        }
+    }  // spinlock
+
+    while (to_free != NULL) {
+        pooled_block *next = to_free->next;
+        debug(user_context) << "    host_free ion=" << to_free->ion << "\n";
+        host_free(to_free->ion);
+        free(to_free);
+        to_free = next;
+    }
+}
+
 }}}}  // namespace Halide::Runtime::Internal::Hexagon
 
 using namespace Halide::Runtime::Internal;
@@ -380,6 +488,7 @@ WEAK int halide_hexagon_run(void *user_context,
     }
 
     halide_profiler_get_state()->get_remote_profiler_state = NULL;
+    poll_profiler_cycles(user_context);
 
     #ifdef DEBUG_RUNTIME
     uint64_t t_after = halide_current_time_ns(user_context);
@@ -410,6 +519,8 @@ WEAK int halide_hexagon_device_release(void *user_context) {
     }
     state_list = NULL;
 
+    release_pooled_blocks(user_context);
+
     if (shared_runtime) {
         debug(user_context) << "    releasing shared runtime\n";
         debug(user_context) << "    halide_remote_release_library " << shared_runtime << " -> ";
@@ -431,6 +542,18 @@ WEAK int halide_hexagon_device_release(void *user_context) {
 // arguments than simply mapping the pages.
 static const int min_ion_allocation_size = 4096;
 
+WEAK int halide_hexagon_release_unused_device_allocations(void *user_context) {
+    debug(user_context)
+        << "Hexagon: halide_hexagon_release_unused_device_allocations (user_context: "
+        << user_context << ")\n";
+
+    // Nothing can have been pooled if the runtime was never loaded.
+    if (host_free) {
+        release_pooled_blocks(user_context);
+    }
+    return 0;
+}
+
 WEAK int halide_hexagon_device_malloc(void *user_context, halide_buffer_t *buf) {
     int result = init_hexagon_runtime(user_context);
     if (result != 0) return result;
@@ -464,9 +587,21 @@ WEAK int halide_hexagon_device_malloc(void *user_context, halide_buffer_t *buf)
 
     void *ion;
     if (size >= min_ion_allocation_size) {
-        debug(user_context) << "    host_malloc len=" << (uint64_t)size << " -> ";
-        ion = host_malloc(size);
-        debug(user_context) << "        " << ion << "\n";
+        size = pool_size_class(size);
+        ion = take_pooled_block(size);
+        if (ion) {
+            debug(user_context) << "    reusing pooled allocation " << ion << "\n";
+        } else {
+            debug(user_context) << "    host_malloc len=" << (uint64_t)size << " -> ";
+            ion = host_malloc(size);
+            if (!ion) {
+                // Allocations sitting in the pool may be what's using
+                // up the memory, so give them back and try again.
+                release_pooled_blocks(user_context);
+                ion = host_malloc(size);
+            }
+            debug(user_context) << "        " << ion << "\n";
+        }
         if (!ion) {
             error(user_context) << "host_malloc failed\n";
             return -1;
@@ -484,7 +619,9 @@ WEAK int halide_hexagon_device_malloc(void *user_context, halide_buffer_t *buf)
     int err = halide_hexagon_wrap_device_handle(user_context, buf, ion, size);
     if (err != 0) {
         if (size >= min_ion_allocation_size) {
-            host_free(ion);
+            if (!return_pooled_block(ion, size)) {
+                host_free(ion);
+            }
         } else {
             halide_free(user_context, ion);
         }
@@ -519,8 +656,12 @@ WEAK int halide_hexagon_device_free(void *user_context, halide_buffer_t* buf) {
     void *ion = halide_hexagon_get_device_handle(user_context, buf);
     halide_hexagon_detach_device_handle(user_context, buf);
     if (size >= min_ion_allocation_size) {
-        debug(user_context) << "    host_free ion=" << ion << "\n";
-        host_free(ion);
+        if (return_pooled_block(ion, size)) {
+            debug(user_context) << "    returning ion=" << ion << " to the pool\n";
+        } else {
+            debug(user_context) << "    host_free ion=" << ion << "\n";
+            host_free(ion);
+        }
     } else {
         debug(user_context) << "    halide_free ion=" << ion << "\n";
         halide_free(user_context, ion);
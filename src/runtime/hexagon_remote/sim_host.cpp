@@ -1,6 +1,7 @@
 #include <vector>
 #include <sstream>
 #include <cassert>
+#include <map>
 #include <memory>
 #include <mutex>
 
@@ -195,6 +196,14 @@ int read_memory(void *dest, int src, int size) {
 // A frequently-updated local copy of the remote profiler state.
 int profiler_current_func;
 
+// Simulated cycles spent in each func (by profiler id) since the host
+// last polled them. Each step of the simulation is billed to the func
+// that was running when it started, so the attribution is exact to
+// within a step. HL_HEXAGON_SIM_PROFILER_STEP sets the step size in
+// cycles (1000 by default).
+std::map<int, HEX_8u_t> profiler_cycles;
+HEX_4u_t profiler_step = 0;
+
 int send_message(int msg, const std::vector<int> &arguments) {
     assert(sim);
 
@@ -260,9 +269,19 @@ int send_message(int msg, const std::vector<int> &arguments) {
         // If we want to return and continue simulating, we execute
         // 1000 cycles at a time, until the remote indicates it has
         // completed handling the current message.
+        if (profiler_step == 0) {
+            const char *step = getenv("HL_HEXAGON_SIM_PROFILER_STEP");
+            profiler_step = (step && atoi(step) > 0) ? atoi(step) : 1000;
+        }
         do {
             HEX_4u_t cycles;
-            state = sim->Step(1000, &cycles);
+            HEX_8u_t cycles_begin = 0, cycles_end = 0;
+            sim->GetSimulatedCycleCount(&cycles_begin);
+            state = sim->Step(profiler_step, &cycles);
+            sim->GetSimulatedCycleCount(&cycles_end);
+            if (profiler_current_func >= 0) {
+                profiler_cycles[profiler_current_func] += cycles_end - cycles_begin;
+            }
             if (read_memory(&msg, remote_msg, 4) != 0) {
                 return -1;
             }
@@ -495,4 +514,21 @@ int halide_hexagon_remote_poll_profiler_state(int *func, int *threads) {
     return 0;
 }
 
+DLLEXPORT
+int halide_hexagon_remote_poll_profiler_cycles(int *funcs, uint64_t *cycles, int max_count) {
+    std::lock_guard<std::mutex> guard(mutex);
+
+    // Hand over (and forget) as many of the per-func cycle counts as
+    // fit. The host calls this until it returns 0.
+    int count = 0;
+    while (count < max_count && !profiler_cycles.empty()) {
+        auto i = profiler_cycles.begin();
+        funcs[count] = i->first;
+        cycles[count] = i->second;
+        profiler_cycles.erase(i);
+        count++;
+    }
+    return count;
+}
+
 }  // extern "C"
@@ -1,11 +1,181 @@
 #include "HalideRuntime.h"
+#include "runtime_internal.h"
 
 extern "C" {
 
 extern long sysconf(int);
+extern int sched_getaffinity(int pid, size_t cpusetsize, void *mask);
+extern int sched_setaffinity(int pid, size_t cpusetsize, const void *mask);
+extern int madvise(void *addr, size_t length, int advice);
 
+}
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+// Read up to two whitespace-separated integers from a small file such
+// as a cgroup control file. A field that isn't a number (e.g. "max")
+// and missing fields are returned as -1. Returns false if the file
+// can't be read.
+WEAK bool read_cgroup_values(const char *path, int64_t *a, int64_t *b) {
+    void *f = fopen(path, "r");
+    if (!f) {
+        return false;
+    }
+    char buf[64];
+    size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[n] = 0;
+
+    int64_t *values[2] = {a, b};
+    const char *p = buf;
+    for (int i = 0; i < 2; i++) {
+        while (*p == ' ' || *p == '\t' || *p == '\n') p++;
+        bool negative = (*p == '-');
+        if (negative) p++;
+        if (*p < '0' || *p > '9') {
+            *values[i] = -1;
+        } else {
+            int64_t v = 0;
+            while (*p >= '0' && *p <= '9') {
+                v = v * 10 + (*p++ - '0');
+            }
+            *values[i] = negative ? -v : v;
+        }
+        while (*p && *p != ' ' && *p != '\t' && *p != '\n') p++;
+    }
+    return true;
+}
+
+// The number of cpus the cgroup CPU bandwidth quota allows, rounded
+// up, or zero if there is no quota.
+WEAK int cgroup_cpu_quota() {
+    int64_t quota = -1, period = -1;
+    // cgroup v2 has "<quota> <period>" or "max <period>" in cpu.max.
+    if (!read_cgroup_values("/sys/fs/cgroup/cpu.max", &quota, &period)) {
+        // cgroup v1 has them in separate files, with a quota of -1
+        // meaning unlimited.
+        int64_t unused;
+        if (!read_cgroup_values("/sys/fs/cgroup/cpu/cpu.cfs_quota_us", &quota, &unused) ||
+            !read_cgroup_values("/sys/fs/cgroup/cpu/cpu.cfs_period_us", &period, &unused)) {
+            return 0;
+        }
+    }
+    if (quota <= 0 || period <= 0) {
+        return 0;
+    }
+    return (int)((quota + period - 1) / period);
+}
+
+// The capacity of the given cpu, numbered as in sysfs: its
+// cpu_capacity where the kernel knows it (arm big.LITTLE, and hybrid x86
+// on recent kernels), or else its maximum frequency, or -1.
+WEAK int64_t read_cpu_capacity(int cpu) {
+    const char *files[] = {"cpu_capacity", "cpufreq/cpuinfo_max_freq"};
+    for (const char *file : files) {
+        char path[96];
+        char *end = path + sizeof(path);
+        char *p = halide_string_to_string(path, end, "/sys/devices/system/cpu/cpu");
+        p = halide_int64_to_string(p, end, cpu, 1);
+        p = halide_string_to_string(p, end, "/");
+        halide_string_to_string(p, end, file);
+        int64_t value = -1, unused;
+        if (read_cgroup_values(path, &value, &unused) && value > 0) {
+            return value;
+        }
+    }
+    return -1;
+}
+
+// Large enough for a glibc cpu_set_t (1024 cpus).
+const int kMaxAffinityCpus = 1024;
+
+}}}  // namespace Halide::Runtime::Internal
+
+extern "C" {
+
+// The number of cpus this process may use: the online cpus, limited to
+// those in the affinity mask of the calling thread, and to the cgroup
+// CPU quota if there is one. A process given a quota of 4 cpus on a
+// 96-core host would otherwise start 96 threads and be throttled.
+// HL_NUM_THREADS overrides this for the thread pool.
 WEAK int halide_host_cpu_count() {
-    return sysconf(84);
+    using namespace Halide::Runtime::Internal;
+
+    int count = sysconf(84);
+
+    uint64_t mask[kMaxAffinityCpus / 64] = {};
+    if (sched_getaffinity(0, sizeof(mask), mask) == 0) {
+        int allowed = 0;
+        for (int i = 0; i < kMaxAffinityCpus / 64; i++) {
+            allowed += __builtin_popcountll(mask[i]);
+        }
+        if (allowed > 0 && allowed < count) {
+            count = allowed;
+        }
+    }
+
+    int quota = cgroup_cpu_quota();
+    if (quota > 0 && quota < count) {
+        count = quota;
+    }
+
+    return count < 1 ? 1 : count;
+}
+
+WEAK int halide_set_current_thread_affinity(int cpu) {
+    using namespace Halide::Runtime::Internal;
+
+    if (cpu < 0 || cpu >= kMaxAffinityCpus) {
+        return -1;
+    }
+
+    // Interpret cpu as an index into the cpus this thread may run on,
+    // so that pinned workers stay within a restricted affinity mask.
+    uint64_t allowed[kMaxAffinityCpus / 64] = {};
+    int target = cpu;
+    if (sched_getaffinity(0, sizeof(allowed), allowed) == 0) {
+        for (int i = 0, seen = 0; i < kMaxAffinityCpus; i++) {
+            if ((allowed[i / 64] >> (i % 64)) & 1) {
+                if (seen++ == cpu) {
+                    target = i;
+                    break;
+                }
+            }
+        }
+    }
+
+    uint64_t mask[kMaxAffinityCpus / 64] = {};
+    mask[target / 64] = (uint64_t)1 << (target % 64);
+    return sched_setaffinity(0, sizeof(mask), mask);
+}
+
+WEAK int halide_host_cpu_capacities(int *capacities, int max_cpus) {
+    using namespace Halide::Runtime::Internal;
+
+    uint64_t allowed[kMaxAffinityCpus / 64] = {};
+    if (sched_getaffinity(0, sizeof(allowed), allowed) != 0) {
+        int count = sysconf(84);
+        for (int i = 0; i < count && i < kMaxAffinityCpus; i++) {
+            allowed[i / 64] |= (uint64_t)1 << (i % 64);
+        }
+    }
+
+    int n = 0;
+    for (int i = 0; i < kMaxAffinityCpus && n < max_cpus; i++) {
+        if ((allowed[i / 64] >> (i % 64)) & 1) {
+            int64_t capacity = read_cpu_capacity(i);
+            if (capacity <= 0) {
+                return 0;
+            }
+            capacities[n++] = (int)capacity;
+        }
+    }
+    return n;
+}
+
+WEAK int halide_advise_huge_pages(void *ptr, size_t size) {
+    // MADV_HUGEPAGE
+    return madvise(ptr, size, 14);
 }
 
 }
@@ -0,0 +1,94 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+
+// perf_event_open has no libc wrapper, and the syscall number varies
+// across platforms. This module is only used on x86 linux.
+#ifndef SYS_PERF_EVENT_OPEN
+
+#ifdef BITS_64
+#define SYS_PERF_EVENT_OPEN 298
+#endif
+
+#ifdef BITS_32
+#define SYS_PERF_EVENT_OPEN 336
+#endif
+
+#endif
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+// The first 64 bytes of struct perf_event_attr
+// (PERF_ATTR_SIZE_VER0). The kernel accepts any size it knows about.
+struct perf_event_attr_ver0 {
+    uint32_t type;
+    uint32_t size;
+    uint64_t config;
+    uint64_t sample_period;
+    uint64_t sample_type;
+    uint64_t read_format;
+    uint64_t flags;
+    uint32_t wakeup_events;
+    uint32_t bp_type;
+    uint64_t config1;
+};
+
+// PERF_TYPE_HARDWARE
+const uint32_t kPerfTypeHardware = 0;
+
+// PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, and
+// PERF_COUNT_HW_CACHE_MISSES, in the order the profiler expects.
+const uint64_t kPerfCounterConfigs[3] = {0, 1, 3};
+
+// exclude_kernel | exclude_hv, so that unprivileged processes may
+// count too.
+const uint64_t kPerfExcludeKernelAndHV = (1 << 5) | (1 << 6);
+
+}}}
+
+extern "C" {
+
+extern int syscall(int num, ...);
+extern ssize_t read(int fd, void *buf, size_t count);
+
+WEAK void halide_perf_counters_close(int *fds) {
+    for (int i = 0; i < 3; i++) {
+        if (fds[i] >= 0) {
+            close(fds[i]);
+            fds[i] = -1;
+        }
+    }
+}
+
+WEAK int halide_perf_counters_open(int *fds) {
+    for (int i = 0; i < 3; i++) {
+        fds[i] = -1;
+    }
+    for (int i = 0; i < 3; i++) {
+        perf_event_attr_ver0 attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = kPerfTypeHardware;
+        attr.size = sizeof(attr);
+        attr.config = kPerfCounterConfigs[i];
+        attr.flags = kPerfExcludeKernelAndHV;
+        // pid 0 and cpu -1 means the calling thread, on any cpu.
+        fds[i] = syscall(SYS_PERF_EVENT_OPEN, &attr, 0, -1, -1, 0);
+        if (fds[i] < 0) {
+            // Not supported by this kernel or cpu, or disallowed by
+            // /proc/sys/kernel/perf_event_paranoid.
+            halide_perf_counters_close(fds);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+WEAK int halide_perf_counters_read(const int *fds, uint64_t *values) {
+    for (int i = 0; i < 3; i++) {
+        if (read(fds[i], &values[i], sizeof(uint64_t)) != (ssize_t)sizeof(uint64_t)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+}
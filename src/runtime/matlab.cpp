@@ -173,6 +173,67 @@ INLINE mxArray *create_numeric_matrix(size_t M, size_t N, mxClassID type, mxComp
     }
 }
 
+// mexAtExit is looked up separately, because it is optional.
+int (*mexAtExit)(mex_exit_fn);
+
+// Matlab's APIs may only be called from the thread that called the
+// mexFunction, but the pipeline may print or report errors from the
+// threads of the Halide thread pool. While a pipeline is running,
+// messages are stored here (each one null terminated), and then
+// passed to Matlab once the pipeline has returned.
+WEAK halide_mutex deferred_messages_lock = { { 0 } };
+WEAK bool defer_messages = false;
+WEAK char deferred_messages[4096];
+WEAK size_t deferred_messages_size = 0;
+WEAK bool deferred_messages_dropped = false;
+
+WEAK void warn(const char *msg) {
+    halide_mutex_lock(&deferred_messages_lock);
+    if (defer_messages) {
+        size_t size = strlen(msg) + 1;
+        if (deferred_messages_size + size <= sizeof(deferred_messages)) {
+            memcpy(deferred_messages + deferred_messages_size, msg, size);
+            deferred_messages_size += size;
+        } else {
+            deferred_messages_dropped = true;
+        }
+        halide_mutex_unlock(&deferred_messages_lock);
+        return;
+    }
+    halide_mutex_unlock(&deferred_messages_lock);
+    mexWarnMsgTxt(msg);
+}
+
+WEAK void begin_deferring_messages() {
+    halide_mutex_lock(&deferred_messages_lock);
+    defer_messages = true;
+    deferred_messages_size = 0;
+    deferred_messages_dropped = false;
+    halide_mutex_unlock(&deferred_messages_lock);
+}
+
+// Pass the stored messages to Matlab. Must be called on the thread
+// that called the mexFunction, after the pipeline has returned.
+WEAK void end_deferring_messages() {
+    halide_mutex_lock(&deferred_messages_lock);
+    defer_messages = false;
+    halide_mutex_unlock(&deferred_messages_lock);
+    for (size_t i = 0; i < deferred_messages_size; i += strlen(deferred_messages + i) + 1) {
+        mexWarnMsgTxt(deferred_messages + i);
+    }
+    if (deferred_messages_dropped) {
+        mexWarnMsgTxt("Halide: some messages from the pipeline were dropped.\n");
+    }
+    deferred_messages_size = 0;
+    deferred_messages_dropped = false;
+}
+
+// Matlab unloads the mex library on 'clear mex', so the threads of the
+// thread pool must be stopped first.
+WEAK void shutdown_at_exit() {
+    halide_shutdown_thread_pool();
+}
+
 }  // namespace mex
 }  // namespace Runtime
 }  // namespace Halide
@@ -217,11 +278,11 @@ WEAK void halide_matlab_error(void *user_context, const char *msg) {
     // be a common problem, those APIs seem to be very fragile.
     stringstream error_msg(user_context);
     error_msg << "\nHalide Error: " << msg;
-    mexWarnMsgTxt(error_msg.str());
+    warn(error_msg.str());
 }
 
 WEAK void halide_matlab_print(void *, const char *msg) {
-    mexWarnMsgTxt(msg);
+    warn(msg);
 }
 
 WEAK int halide_matlab_init(void *user_context) {
@@ -239,6 +300,11 @@ WEAK int halide_matlab_init(void *user_context) {
         return halide_error_code_matlab_init_failed;
     }
 
+    mexAtExit = get_mex_symbol<int (*)(mex_exit_fn)>(user_context, "mexAtExit", false);
+    if (mexAtExit) {
+        mexAtExit(shutdown_at_exit);
+    }
+
     // Set up Halide's printing to go through Matlab. Also, don't exit
     // on error. We don't just replace halide_error/halide_printf,
     // because they'd have to be weak here, and there would be no
@@ -297,11 +363,10 @@ WEAK int halide_matlab_array_to_halide_buffer_t(void *user_context,
         buf->dim[i].extent = static_cast<int32_t>(get_dimension(arr, i));
     }
 
-    // Add back the dimensions with extent 1.
-    for (int i = 2; i < expected_dims; i++) {
-        if (buf->dim[i].extent == 0) {
-            buf->dim[i].extent = 1;
-        }
+    // Add back the dimensions with extent 1, including any trailing
+    // ones of the two that Matlab always has (e.g. of a column vector).
+    for (int i = dim_count; i < expected_dims; i++) {
+        buf->dim[i].extent = 1;
     }
 
     // Compute dense strides.
@@ -438,6 +503,9 @@ WEAK int halide_matlab_call_pipeline(void *user_context,
         }
     }
 
+    // The pipeline may use the thread pool, so its messages are passed
+    // to Matlab afterwards, on this thread.
+    begin_deferring_messages();
     result = pipeline(args);
 
     // Copy any GPU resident output buffers back to the CPU before returning.
@@ -454,6 +522,7 @@ WEAK int halide_matlab_call_pipeline(void *user_context,
             halide_device_free(user_context, buf);
         }
     }
+    end_deferring_messages();
 
     return result;
 }
@@ -1,6 +1,7 @@
 #include "HalideRuntimeMetal.h"
 #include "scoped_spin_lock.h"
 #include "device_buffer_utils.h"
+#include "device_pool_utils.h"
 #include "device_interface.h"
 #include "printer.h"
 
@@ -11,6 +12,9 @@
 extern "C" {
 extern objc_id MTLCreateSystemDefaultDevice();
 extern struct ObjectiveCClass _NSConcreteGlobalBlock;
+extern objc_id dispatch_data_create(const void *buffer, size_t size, objc_id queue, void *destructor);
+extern void dispatch_release(objc_id object);
+extern int getpagesize();
 }
 
 namespace Halide { namespace Runtime { namespace Internal { namespace Metal {
@@ -33,6 +37,16 @@ WEAK mtl_buffer *new_buffer(mtl_device *device, size_t length) {
                      length, 0  /* MTLResourceCPUCacheModeDefaultCache | MTLResourceStorageModeShared */);
 }
 
+// Make a buffer that uses existing storage, which must be page aligned,
+// instead of allocating its own. The storage must outlive the buffer.
+WEAK mtl_buffer *new_buffer_with_bytes_no_copy(mtl_device *device, void *bytes, size_t length) {
+    typedef mtl_buffer *(*new_buffer_method)(objc_id device, objc_sel sel, void *bytes, size_t length, size_t options, void *deallocator);
+    new_buffer_method method = (new_buffer_method)&objc_msgSend;
+    return (*method)(device, sel_getUid("newBufferWithBytesNoCopy:length:options:deallocator:"),
+                     bytes, length, 0  /* MTLResourceCPUCacheModeDefaultCache | MTLResourceStorageModeShared */,
+                     NULL);
+}
+
 WEAK mtl_command_queue *new_command_queue(mtl_device *device) {
     return (mtl_command_queue *)objc_msgSend(device, sel_getUid("newCommandQueue"));
 }
@@ -149,6 +163,25 @@ WEAK mtl_library *new_library_with_source(mtl_device *device, const char *source
     return result;
 }
 
+WEAK mtl_library *new_library_with_data(mtl_device *device, const char *data, size_t data_len) {
+    objc_id error_return;
+    // With the default (NULL) destructor, the data is copied.
+    objc_id dispatch_data = dispatch_data_create(data, data_len, NULL, NULL);
+
+    typedef mtl_library *(*new_library_with_data_method)(objc_id device, objc_sel sel, objc_id data, objc_id *error_return);
+    new_library_with_data_method method = (new_library_with_data_method)&objc_msgSend;
+    mtl_library *result = (*method)(device, sel_getUid("newLibraryWithData:error:"),
+                                    dispatch_data, &error_return);
+
+    dispatch_release(dispatch_data);
+
+    if (result == NULL) {
+        ns_log_object(error_return);
+    }
+
+    return result;
+}
+
 WEAK mtl_function *new_function_with_name(mtl_library *library, const char *name, size_t name_len) {
     objc_id name_str = wrap_string_as_ns_string(name, name_len);
     typedef mtl_function *(*new_function_with_name_method)(objc_id library, objc_sel sel, objc_id name);
@@ -205,6 +238,10 @@ struct device_handle {
     uint64_t offset;
 };
 
+// Released crop handles, kept for reuse by later crops.
+WEAK free_crop_handle *crop_handles = NULL;
+volatile int WEAK crop_handles_lock = 0;
+
 // Structure to hold the state of a module attached to the context.
 // Also used as a linked-list to keep track of all the different
 // modules that are attached to a context in order to release them all
@@ -215,6 +252,17 @@ struct module_state {
 };
 WEAK module_state *state_list = NULL;
 
+// When batch_mode is set, halide_metal_run encodes kernels into
+// pending_command_buffer, which is committed only when something needs
+// the results: halide_metal_device_sync, copies to and from the
+// device, or a kernel run outside batch mode. This saves creating,
+// committing and scheduling a command buffer per kernel. The pending
+// command buffer belongs to pending_command_queue, and both are
+// protected by the context lock.
+WEAK int batch_mode = 0;
+WEAK mtl_command_buffer *pending_command_buffer = NULL;
+WEAK mtl_command_queue *pending_command_queue = NULL;
+
 // API Capabilities.  If more capabilities need to be checked,
 // this can be refactored to something more robust/general.
 WEAK bool metal_api_supports_set_bytes;
@@ -342,6 +390,20 @@ WEAK command_buffer_completed_handler_block_literal command_buffer_completed_han
     &command_buffer_completed_handler_descriptor
 };
 
+// Commit the command buffer holding kernels encoded in batch mode,
+// if there is one. This must be called with the context lock held.
+WEAK void commit_pending_command_buffer(void *user_context) {
+    if (pending_command_buffer == NULL) {
+        return;
+    }
+    debug(user_context) << "Metal - Committing batched command buffer " << pending_command_buffer << "\n";
+    add_command_buffer_completed_handler(pending_command_buffer, &command_buffer_completed_handler_block);
+    commit_command_buffer(pending_command_buffer);
+    release_ns_object(pending_command_buffer);
+    pending_command_buffer = NULL;
+    pending_command_queue = NULL;
+}
+
 }}}} // namespace Halide::Runtime::Internal::Metal
 
 using namespace Halide::Runtime::Internal::Metal;
@@ -349,6 +411,10 @@ using namespace Halide::Runtime::Internal::Metal;
 extern "C" {
 
 
+WEAK void halide_metal_set_batch_mode(int batch) {
+    batch_mode = batch ? 1 : 0;
+}
+
 WEAK int halide_metal_device_malloc(void *user_context, halide_buffer_t* buf) {
     debug(user_context)
         << "halide_metal_device_malloc (user_context: " << user_context
@@ -459,8 +525,26 @@ WEAK int halide_metal_initialize_kernels(void *user_context, void **state_ptr, c
         uint64_t t_before_compile = halide_current_time_ns(user_context);
         #endif
 
-        debug(user_context) << "Metal - Allocating: new_library_with_source " << (*state)->library << "\n";
-        (*state)->library = new_library_with_source(metal_context.device, source, source_size);
+        // The compiler may have embedded a prebuilt library before the
+        // source, tagged with "HLML" and followed by its 32-bit
+        // little-endian size. Use it if the device can load it, and
+        // otherwise fall back to the source.
+        if (source_size > 8 &&
+            source[0] == 'H' && source[1] == 'L' && source[2] == 'M' && source[3] == 'L') {
+            const uint8_t *size_bytes = (const uint8_t *)source + 4;
+            int library_size = (int)(size_bytes[0] | (size_bytes[1] << 8) |
+                                     (size_bytes[2] << 16) | ((uint32_t)size_bytes[3] << 24));
+            halide_assert(user_context, library_size >= 0 && library_size <= source_size - 8);
+            debug(user_context) << "Metal - Allocating: new_library_with_data " << library_size << " bytes\n";
+            (*state)->library = new_library_with_data(metal_context.device, source + 8, library_size);
+            source += 8 + library_size;
+            source_size -= 8 + library_size;
+        }
+
+        if ((*state)->library == 0) {
+            debug(user_context) << "Metal - Allocating: new_library_with_source " << (*state)->library << "\n";
+            (*state)->library = new_library_with_source(metal_context.device, source, source_size);
+        }
         if ((*state)->library == 0) {
             error(user_context) << "Metal: new_library_with_source failed.\n";
             return -1;
@@ -483,6 +567,9 @@ WEAK int halide_metal_initialize_kernels(void *user_context, void **state_ptr, c
 namespace {
 
 inline void halide_metal_device_sync_internal(mtl_command_queue *queue, struct halide_buffer_t *buffer) {
+    // Command buffers on a queue run in the order they are committed,
+    // so waiting on the one below also waits on any batched kernels.
+    commit_pending_command_buffer(NULL);
     mtl_command_buffer *sync_command_buffer = new_command_buffer(queue);
     if (buffer != NULL) {
         mtl_buffer *metal_buffer = ((device_handle *)buffer->device)->buf;
@@ -547,6 +634,8 @@ WEAK int halide_metal_device_release(void *user_context) {
             state = state->next;
         }
 
+        release_crop_handles(&crop_handles, &crop_handles_lock);
+
         // Release the device itself, if we created it.
         if (acquired_device == device) {
             debug(user_context) <<  "Metal - Releasing: new_command_queue " << queue << "\n";
@@ -576,6 +665,11 @@ WEAK int halide_metal_copy_to_device(void *user_context, halide_buffer_t* buffer
 
     halide_assert(user_context, buffer->host && buffer->device);
 
+    // Batched kernels that haven't run yet may read the old contents.
+    if (pending_command_buffer != NULL) {
+        halide_metal_device_sync_internal(metal_context.queue, NULL);
+    }
+
     device_copy c = make_host_to_device_copy(buffer);
     mtl_buffer *metal_buffer = ((device_handle *)c.dst)->buf;
     c.dst = (uint64_t)buffer_contents(metal_buffer) + ((device_handle *)c.dst)->offset;
@@ -584,7 +678,11 @@ WEAK int halide_metal_copy_to_device(void *user_context, halide_buffer_t* buffer
                         << " metal_buffer = " << metal_buffer
                         << " host = " << buffer->host << "\n";
 
-    copy_memory(c, user_context);
+    // Buffers from halide_metal_device_and_host_malloc and
+    // halide_metal_wrap_host_memory share their storage with the host.
+    if (c.dst != c.src) {
+        copy_memory(c, user_context);
+    }
 
     if (is_buffer_managed(metal_buffer)) {
         size_t total_size = buffer->size_in_bytes();
@@ -626,7 +724,9 @@ WEAK int halide_metal_copy_to_host(void *user_context, halide_buffer_t* buffer)
     device_copy c = make_device_to_host_copy(buffer);
     c.src = (uint64_t)buffer_contents(((device_handle *)c.src)->buf) + ((device_handle *)c.src)->offset;
 
-    copy_memory(c, user_context);
+    if (c.src != c.dst) {
+        copy_memory(c, user_context);
+    }
 
     #ifdef DEBUG_RUNTIME
     uint64_t t_after = halide_current_time_ns(user_context);
@@ -658,10 +758,25 @@ WEAK int halide_metal_run(void *user_context,
         return metal_context.error;
     }
 
-    mtl_command_buffer *command_buffer = new_command_buffer(metal_context.queue);
-    if (command_buffer == 0) {
-        error(user_context) << "Metal: Could not allocate command buffer.\n";
-        return -1;
+    mtl_command_buffer *command_buffer = NULL;
+    if (batch_mode && pending_command_queue == metal_context.queue) {
+        command_buffer = pending_command_buffer;
+    } else {
+        // Work batched on another queue, or before leaving batch mode,
+        // goes first.
+        commit_pending_command_buffer(user_context);
+        command_buffer = new_command_buffer(metal_context.queue);
+        if (command_buffer == 0) {
+            error(user_context) << "Metal: Could not allocate command buffer.\n";
+            return -1;
+        }
+        if (batch_mode) {
+            // The command buffer must outlive the autorelease pool of
+            // this call.
+            retain_ns_object(command_buffer);
+            pending_command_buffer = command_buffer;
+            pending_command_queue = metal_context.queue;
+        }
     }
 
     mtl_compute_command_encoder *encoder = new_compute_command_encoder(command_buffer);
@@ -676,6 +791,8 @@ WEAK int halide_metal_run(void *user_context,
     mtl_function *function = new_function_with_name(state->library, entry_name, strlen(entry_name));
     if (function == 0) {
         error(user_context) << "Metal: Could not get function " << entry_name << "from Metal library.\n";
+        // A batched command buffer may still be used for later kernels.
+        end_encoding(encoder);
         return -1;
     }
 
@@ -683,6 +800,8 @@ WEAK int halide_metal_run(void *user_context,
     if (pipeline_state == 0) {
         error(user_context) << "Metal: Could not allocate pipeline state.\n";
         release_ns_object(function);
+        // A batched command buffer may still be used for later kernels.
+        end_encoding(encoder);
         return -1;
     }
     set_compute_pipeline_state(encoder, pipeline_state);
@@ -733,6 +852,8 @@ WEAK int halide_metal_run(void *user_context,
                 error(user_context) << "Metal: Could not allocate arguments buffer.\n";
                 release_ns_object(pipeline_state);
                 release_ns_object(function);
+                // A batched command buffer may still be used for later kernels.
+                end_encoding(encoder);
                 return -1;
             }
             args_ptr = (char *)buffer_contents(args_buffer);
@@ -780,9 +901,10 @@ WEAK int halide_metal_run(void *user_context,
                           threadsX, threadsY, threadsZ);
     end_encoding(encoder);
 
-    add_command_buffer_completed_handler(command_buffer, &command_buffer_completed_handler_block);
-
-    commit_command_buffer(command_buffer);
+    if (command_buffer != pending_command_buffer) {
+        add_command_buffer_completed_handler(command_buffer, &command_buffer_completed_handler_block);
+        commit_command_buffer(command_buffer);
+    }
 
     release_ns_object(pipeline_state);
     release_ns_object(function);
@@ -831,7 +953,8 @@ WEAK int halide_metal_device_crop(void *user_context,
     }
     offset *= src->type.bytes();
 
-    device_handle *new_handle = (device_handle *)malloc(sizeof(device_handle));
+    device_handle *new_handle =
+        (device_handle *)take_crop_handle(&crop_handles, &crop_handles_lock, sizeof(device_handle));
     if (new_handle == NULL) {
         error(user_context) << "halide_metal_device_crop: malloc failed making device handle.\n";
         return halide_error_code_out_of_memory;
@@ -863,7 +986,7 @@ WEAK int halide_metal_device_release_crop(void *user_context,
     device_handle *handle = (device_handle *)buf->device;
     
     release_ns_object(handle->buf);
-    free(handle);
+    return_crop_handle(&crop_handles, &crop_handles_lock, handle);
 
     #ifdef DEBUG_RUNTIME
     uint64_t t_after = halide_current_time_ns(user_context);
@@ -904,6 +1027,54 @@ WEAK int halide_metal_detach_buffer(void *user_context, struct halide_buffer_t *
     return 0;
 }
 
+WEAK int halide_metal_wrap_host_memory(void *user_context, struct halide_buffer_t *buf) {
+    debug(user_context)
+        << "halide_metal_wrap_host_memory (user_context: " << user_context
+        << ", buf: " << buf << ")\n";
+
+    halide_assert(user_context, buf->device == 0);
+    if (buf->device != 0) {
+        return halide_error_code_device_wrap_native_failed;
+    }
+    if (buf->host == NULL) {
+        return halide_error_code_host_is_null;
+    }
+    // Metal can only use whole pages of existing storage. Pages are
+    // mapped whole, so rounding the size up stays within the mapping.
+    size_t page_size = getpagesize();
+    if (((uintptr_t)buf->host & (page_size - 1)) != 0) {
+        error(user_context) << "halide_metal_wrap_host_memory: host pointer "
+                            << buf->host << " is not page aligned.\n";
+        return halide_error_code_unaligned_host_ptr;
+    }
+    size_t size = (buf->size_in_bytes() + page_size - 1) & ~(page_size - 1);
+
+    MetalContextHolder metal_context(user_context, true);
+    if (metal_context.error != 0) {
+        return metal_context.error;
+    }
+
+    device_handle *handle = (device_handle *)malloc(sizeof(device_handle));
+    if (handle == NULL) {
+        error(user_context) << "halide_metal_wrap_host_memory: malloc failed making device handle.\n";
+        return halide_error_code_out_of_memory;
+    }
+
+    mtl_buffer *metal_buf = new_buffer_with_bytes_no_copy(metal_context.device, buf->host, size);
+    if (metal_buf == 0) {
+        free(handle);
+        error(user_context) << "Metal: Failed to wrap host memory of size " << (int64_t)size << ".\n";
+        return halide_error_code_device_wrap_native_failed;
+    }
+    handle->buf = metal_buf;
+    handle->offset = 0;
+
+    buf->device = (uint64_t)handle;
+    buf->device_interface = &metal_device_interface;
+    buf->device_interface->impl->use_module();
+    return 0;
+}
+
 WEAK uintptr_t halide_metal_get_buffer(void *user_context, struct halide_buffer_t *buf) {
     if (buf->device == NULL) {
         return 0;
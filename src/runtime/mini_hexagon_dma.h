@@ -0,0 +1,84 @@
+#ifndef HALIDE_MINI_HEXAGON_DMA_H
+#define HALIDE_MINI_HEXAGON_DMA_H
+
+#include "runtime_internal.h"
+
+// The subset of the Hexagon user DMA wrapper library
+// (libhexagon_dma) that the runtime uses. Its functions are weak, so
+// that pipelines that don't use DMA load without the library.
+
+extern "C" {
+
+typedef void *t_DmaWrapper_DmaEngineHandle;
+typedef uintptr_t addr_t;
+
+typedef enum {
+    eDmaFmt_RawData,
+    eDmaFmt_NV12,
+    eDmaFmt_NV12_Y,
+    eDmaFmt_NV12_UV,
+    eDmaFmt_P010,
+    eDmaFmt_P010_Y,
+    eDmaFmt_P010_UV,
+    eDmaFmt_TP10,
+    eDmaFmt_TP10_Y,
+    eDmaFmt_TP10_UV,
+    eDmaFmt_NV124R,
+    eDmaFmt_NV124R_Y,
+    eDmaFmt_NV124R_UV,
+    eDmaFmt_Invalid,
+    eDmaFmt_MAX
+} t_eDmaFmt;
+
+typedef enum {
+    eDmaWrapper_DdrToL2,
+    eDmaWrapper_L2ToDdr
+} t_eDmaWrapper_TransationType;
+
+typedef struct stDmaWrapper_RoiAlignInfo {
+    uint16_t u16W;
+    uint16_t u16H;
+} t_StDmaWrapper_RoiAlignInfo;
+
+typedef struct stDmaWrapper_Roi {
+    uint16_t u16X;
+    uint16_t u16Y;
+    uint16_t u16W;
+    uint16_t u16H;
+} t_StDmaWrapper_Roi;
+
+typedef struct stDmaWrapper_FrameProp {
+    addr_t aAddr;
+    uint16_t u16W;
+    uint16_t u16H;
+    uint16_t u16Stride;
+} t_StDmaWrapper_FrameProp;
+
+typedef struct stDmaWrapper_DmaTransferSetup {
+    t_StDmaWrapper_FrameProp stFrame;
+    t_StDmaWrapper_Roi stRoi;
+    uint16_t u16RoiStride;
+    t_eDmaFmt eFmt;
+    bool bIsFmtUbwc;
+    bool bUse16BitPaddingInL2;
+    void *pDescBuf;
+    void *pTcmDataBuf;
+    t_eDmaWrapper_TransationType eTransferType;
+} t_StDmaWrapper_DmaTransferSetup;
+
+#define DMA_SUCCESS 0
+
+extern t_DmaWrapper_DmaEngineHandle hDmaWrapper_AllocDma() __attribute__((weak));
+extern int32_t nDmaWrapper_FreeDma(t_DmaWrapper_DmaEngineHandle hDmaHandle) __attribute__((weak));
+extern int32_t nDmaWrapper_Move(t_DmaWrapper_DmaEngineHandle hDmaHandle) __attribute__((weak));
+extern int32_t nDmaWrapper_Wait(t_DmaWrapper_DmaEngineHandle hDmaHandle) __attribute__((weak));
+extern int32_t nDmaWrapper_FinishFrame(t_DmaWrapper_DmaEngineHandle hDmaHandle) __attribute__((weak));
+extern int32_t nDmaWrapper_GetRecommendedWalkSize(t_eDmaFmt eFmtId, bool bIsUbwc,
+                                                  t_StDmaWrapper_RoiAlignInfo *pStWalkSize) __attribute__((weak));
+extern int32_t nDmaWrapper_GetDescbuffsize(t_eDmaFmt *aeFmtId, uint16_t nsize) __attribute__((weak));
+extern int32_t nDmaWrapper_DmaTransferSetup(t_DmaWrapper_DmaEngineHandle hDmaHandle,
+                                            t_StDmaWrapper_DmaTransferSetup *stpDmaTransferParm) __attribute__((weak));
+
+}  // extern "C"
+
+#endif  // HALIDE_MINI_HEXAGON_DMA_H
@@ -0,0 +1,57 @@
+#ifndef HALIDE_RUNTIME_NATIVE_BUFFER_UTILS_H
+#define HALIDE_RUNTIME_NATIVE_BUFFER_UTILS_H
+
+#include "HalideRuntime.h"
+#include "printer.h"
+
+// Helpers shared by the routines that wrap platform image buffers in
+// halide_buffer_t. See HalideRuntimeNativeBuffer.h.
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+// Point buf at a width x height image with the given channels
+// interleaved, and a row stride in elements.
+WEAK int set_image_shape(void *user_context, halide_buffer_t *buf, void *host, halide_type_t type,
+                         int width, int height, int channels, int x_stride, int row_stride) {
+    if (buf->host != NULL || buf->device != 0) {
+        error(user_context) << "Can't wrap a native buffer in a halide_buffer_t that already has memory.\n";
+        return halide_error_code_generic_error;
+    }
+    if (!(buf->dimensions == 3 || (buf->dimensions == 2 && channels == 1))) {
+        error(user_context) << "Can't wrap an image with " << channels
+                            << " channels in a halide_buffer_t with " << buf->dimensions << " dimensions.\n";
+        return halide_error_code_generic_error;
+    }
+    buf->host = (uint8_t *)host;
+    buf->type = type;
+    buf->flags = 0;
+    buf->dim[0].min = 0;
+    buf->dim[0].extent = width;
+    buf->dim[0].stride = x_stride;
+    buf->dim[0].flags = 0;
+    buf->dim[1].min = 0;
+    buf->dim[1].extent = height;
+    buf->dim[1].stride = row_stride;
+    buf->dim[1].flags = 0;
+    if (buf->dimensions == 3) {
+        buf->dim[2].min = 0;
+        buf->dim[2].extent = channels;
+        buf->dim[2].stride = 1;
+        buf->dim[2].flags = 0;
+    }
+    return 0;
+}
+
+// Copy back and free any device buffer made over the host memory.
+WEAK int release_device_over_host(void *user_context, halide_buffer_t *buf) {
+    if (buf->device == 0) {
+        return 0;
+    }
+    int result = halide_copy_to_host(user_context, buf);
+    int free_result = halide_device_free(user_context, buf);
+    return result != 0 ? result : free_result;
+}
+
+}}}  // namespace Halide::Runtime::Internal
+
+#endif  // HALIDE_RUNTIME_NATIVE_BUFFER_UTILS_H
@@ -2,6 +2,7 @@
 #include "scoped_spin_lock.h"
 #include "device_buffer_utils.h"
 #include "device_interface.h"
+#include "device_pool_utils.h"
 #include "printer.h"
 
 #include "mini_cl.h"
@@ -84,6 +85,14 @@ WEAK char device_type[256];
 WEAK int device_type_lock = 0;
 WEAK bool device_type_initialized = false;
 
+WEAK char program_cache_dir[1024];
+WEAK int program_cache_dir_lock = 0;
+WEAK bool program_cache_dir_initialized = false;
+
+WEAK int out_of_order_queue = 0;
+WEAK int out_of_order_queue_lock = 0;
+WEAK bool out_of_order_queue_initialized = false;
+
 }}}} // namespace Halide::Runtime::Internal::OpenCL
 
 using namespace Halide::Runtime::Internal::OpenCL;
@@ -130,6 +139,38 @@ WEAK const char *halide_opencl_get_device_type(void *user_context) {
     return device_type;
 }
 
+WEAK void halide_opencl_set_program_cache_dir(const char *dir) {
+    if (dir) {
+        strncpy(program_cache_dir, dir, sizeof(program_cache_dir) - 1);
+    } else {
+        program_cache_dir[0] = 0;
+    }
+    program_cache_dir_initialized = true;
+}
+
+WEAK const char *halide_opencl_get_program_cache_dir(void *user_context) {
+    ScopedSpinLock lock(&program_cache_dir_lock);
+    if (!program_cache_dir_initialized) {
+        const char *dir = getenv("HL_OCL_PROGRAM_CACHE_DIR");
+        halide_opencl_set_program_cache_dir(dir);
+    }
+    return program_cache_dir;
+}
+
+WEAK void halide_opencl_set_out_of_order_queue(int enable) {
+    out_of_order_queue = enable;
+    out_of_order_queue_initialized = true;
+}
+
+WEAK int halide_opencl_get_out_of_order_queue(void *user_context) {
+    ScopedSpinLock lock(&out_of_order_queue_lock);
+    if (!out_of_order_queue_initialized) {
+        const char *enable = getenv("HL_OCL_OUT_OF_ORDER");
+        halide_opencl_set_out_of_order_queue(enable && enable[0] == '1');
+    }
+    return out_of_order_queue;
+}
+
 // The default implementation of halide_acquire_cl_context uses the global
 // pointers above, and serializes access with a spin lock.
 // Overriding implementations of acquire/release must implement the following
@@ -216,6 +257,10 @@ struct device_handle {
     cl_mem mem;
 };
 
+// Released crop handles, kept for reuse by later crops.
+WEAK free_crop_handle *crop_handles = NULL;
+volatile int WEAK crop_handles_lock = 0;
+
 // Structure to hold the state of a module attached to the context.
 // Also used as a linked-list to keep track of all the different
 // modules that are attached to a context in order to release them all
@@ -226,6 +271,475 @@ struct module_state {
 };
 WEAK module_state *state_list = NULL;
 
+// Commands are ordered by the events they complete, rather than by the
+// command queue, so that the queue may be out-of-order. Each cl_mem
+// remembers the event of the last command that used it, and the next
+// command that uses it waits for that event. Commands on the same
+// cl_mem therefore run in the order they were enqueued, while commands
+// on different ones, such as a copy and an unrelated kernel, may
+// overlap. The host only waits for a command where it reads the
+// results.
+struct mem_event {
+    cl_mem mem;
+    cl_event event;
+    mem_event *next;
+};
+WEAK mem_event *mem_events = NULL;
+// This spinlock protects the above mem_events.
+volatile int WEAK mem_events_lock = 0;
+
+// Add the event of the last command that used mem, if any and not
+// already present, to a wait list. The wait list holds a reference
+// to it until release_wait_list.
+WEAK void add_mem_dependency(cl_mem mem, cl_event *wait_list, cl_uint *num_events) {
+    ScopedSpinLock spinlock(&mem_events_lock);
+    mem_event *m = mem_events;
+    while (m != NULL && m->mem != mem) {
+        m = m->next;
+    }
+    if (m == NULL) {
+        return;
+    }
+    for (cl_uint i = 0; i < *num_events; i++) {
+        if (wait_list[i] == m->event) {
+            return;
+        }
+    }
+    clRetainEvent(m->event);
+    wait_list[(*num_events)++] = m->event;
+}
+
+WEAK void release_wait_list(cl_event *wait_list, cl_uint num_events) {
+    for (cl_uint i = 0; i < num_events; i++) {
+        clReleaseEvent(wait_list[i]);
+    }
+}
+
+// Record that event is the last command to use mem.
+WEAK void set_mem_event(cl_mem mem, cl_event event) {
+    clRetainEvent(event);
+    cl_event old_event = NULL;
+    {
+        ScopedSpinLock spinlock(&mem_events_lock);
+        mem_event *m = mem_events;
+        while (m != NULL && m->mem != mem) {
+            m = m->next;
+        }
+        if (m != NULL) {
+            old_event = m->event;
+            m->event = event;
+        } else if ((m = (mem_event *)malloc(sizeof(mem_event))) != NULL) {
+            m->mem = mem;
+            m->event = event;
+            m->next = mem_events;
+            mem_events = m;
+        } else {
+            // Without a record, later commands won't wait for this
+            // one, so wait for it now.
+            old_event = event;
+            clWaitForEvents(1, &event);
+        }
+    }  // spinlock
+    if (old_event != NULL) {
+        clReleaseEvent(old_event);
+    }
+}
+
+// Forget the last command to use mem, when mem is released. If mem is
+// NULL, forget them all.
+WEAK void forget_mem_event(cl_mem mem) {
+    mem_event *to_free = NULL;
+    {
+        ScopedSpinLock spinlock(&mem_events_lock);
+        mem_event **prev_ptr = &mem_events;
+        while (*prev_ptr != NULL) {
+            mem_event *m = *prev_ptr;
+            if (mem == NULL || m->mem == mem) {
+                *prev_ptr = m->next;
+                m->next = to_free;
+                to_free = m;
+            } else {
+                prev_ptr = &m->next;
+            }
+        }
+    }  // spinlock
+    while (to_free != NULL) {
+        mem_event *next = to_free->next;
+        clReleaseEvent(to_free->event);
+        free(to_free);
+        to_free = next;
+    }
+}
+
+// Block until the last command to use mem is complete.
+WEAK cl_int wait_for_mem(cl_mem mem) {
+    cl_event wait_list[1];
+    cl_uint num_events = 0;
+    add_mem_dependency(mem, wait_list, &num_events);
+    cl_int err = CL_SUCCESS;
+    if (num_events > 0) {
+        err = clWaitForEvents(num_events, wait_list);
+    }
+    release_wait_list(wait_list, num_events);
+    return err;
+}
+
+// The host side of a buffer allocated with
+// halide_opencl_device_and_host_malloc is the mapping of a separate
+// buffer created with CL_MEM_ALLOC_HOST_PTR, which drivers back with
+// page-locked memory that copies to and from the device can DMA
+// from directly. This list maps each such host pointer back to the
+// buffer it came from.
+struct pinned_host_allocation {
+    void *host;
+    cl_mem mem;
+    pinned_host_allocation *next;
+};
+WEAK pinned_host_allocation *pinned_host_allocations = NULL;
+// This spinlock protects the above pinned_host_allocations.
+volatile int WEAK pinned_host_allocations_lock = 0;
+
+// On devices that share memory with the host
+// (CL_DEVICE_HOST_UNIFIED_MEMORY), halide_opencl_device_and_host_malloc
+// instead creates the device buffer with CL_MEM_USE_HOST_PTR over a
+// page-aligned host allocation, so that both sides use the same
+// storage. Copies between the two sides then just map or unmap the
+// buffer, which hands ownership of the storage to the host or the
+// device respectively. The buffer is created mapped, so the host
+// owns it to begin with.
+struct zero_copy_allocation {
+    void *host;
+    // The unaligned allocation that host points into.
+    void *orig;
+    size_t size;
+    cl_mem mem;
+    bool mapped;
+    zero_copy_allocation *next;
+};
+WEAK zero_copy_allocation *zero_copy_allocations = NULL;
+// This spinlock protects the above zero_copy_allocations.
+volatile int WEAK zero_copy_allocations_lock = 0;
+
+// Alignment of the host side of zero-copy allocations, in bytes.
+const size_t zero_copy_alignment = 4096;
+
+WEAK zero_copy_allocation *find_zero_copy_allocation(cl_mem mem) {
+    ScopedSpinLock spinlock(&zero_copy_allocations_lock);
+    zero_copy_allocation *z = zero_copy_allocations;
+    while (z != NULL && z->mem != mem) {
+        z = z->next;
+    }
+    return z;
+}
+
+// Unmap a zero-copy buffer, if it is one and is mapped, so that the
+// device may use it.
+WEAK cl_int give_zero_copy_to_device(void *user_context, cl_command_queue q, cl_mem mem) {
+    zero_copy_allocation *z = find_zero_copy_allocation(mem);
+    if (z == NULL || !z->mapped) {
+        return CL_SUCCESS;
+    }
+    debug(user_context) << "    clEnqueueUnmapMemObject " << (void *)mem << "\n";
+    cl_event wait_list[1];
+    cl_uint num_events = 0;
+    add_mem_dependency(mem, wait_list, &num_events);
+    cl_event event = NULL;
+    cl_int err = clEnqueueUnmapMemObject(q, mem, z->host, num_events,
+                                         num_events ? wait_list : NULL, &event);
+    release_wait_list(wait_list, num_events);
+    if (err == CL_SUCCESS) {
+        z->mapped = false;
+        set_mem_event(mem, event);
+        clReleaseEvent(event);
+    }
+    return err;
+}
+
+// Map a zero-copy buffer, if it is one and isn't mapped, so that the
+// host may use it. This waits for the device to be done with it.
+WEAK cl_int give_zero_copy_to_host(void *user_context, cl_command_queue q, cl_mem mem) {
+    zero_copy_allocation *z = find_zero_copy_allocation(mem);
+    if (z == NULL || z->mapped) {
+        return CL_SUCCESS;
+    }
+    debug(user_context) << "    clEnqueueMapBuffer " << (void *)mem << "\n";
+    cl_event wait_list[1];
+    cl_uint num_events = 0;
+    add_mem_dependency(mem, wait_list, &num_events);
+    cl_int err;
+    void *host = clEnqueueMapBuffer(q, mem, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE,
+                                    0, z->size, num_events,
+                                    num_events ? wait_list : NULL, NULL, &err);
+    release_wait_list(wait_list, num_events);
+    if (err != CL_SUCCESS) {
+        return err;
+    }
+    // Mapping a CL_MEM_USE_HOST_PTR buffer always gives back the host
+    // pointer it was created with.
+    halide_assert(user_context, host == z->host);
+    z->mapped = true;
+    return CL_SUCCESS;
+}
+
+// clCreateBuffer and clReleaseMemObject are slow on many drivers, so
+// device buffers freed by Halide are kept in a pool and handed back
+// out to later allocations of a similar size, rather than being
+// released. Blocks are binned into the size classes defined in
+// device_pool_utils.h, and are only reused within the context that
+// created them. Commands that use a block wait for the last command
+// that used it, so a block can be reused immediately, even if commands
+// enqueued before it was freed still use it.
+struct pooled_block {
+    cl_context context;
+    cl_mem mem;
+    size_t size;
+    pooled_block *next;
+};
+
+WEAK pooled_block *device_pool[num_pool_bins];
+// This spinlock protects the above device_pool.
+volatile int WEAK device_pool_lock = 0;
+
+// Take a block of at least the given size class for the given context
+// from the pool. Returns NULL if there is none.
+WEAK cl_mem take_pooled_block(cl_context ctx, size_t size) {
+    pooled_block *b = NULL;
+    {
+        ScopedSpinLock spinlock(&device_pool_lock);
+        pooled_block **prev_ptr = &device_pool[pool_bin_for_size(size)];
+        b = *prev_ptr;
+        while (b != NULL) {
+            if (b->context == ctx && b->size >= size) {
+                *prev_ptr = b->next;
+                break;
+            }
+            prev_ptr = &b->next;
+            b = b->next;
+        }
+    }  // spinlock
+    if (b == NULL) {
+        return NULL;
+    }
+    cl_mem mem = b->mem;
+    free(b);
+    return mem;
+}
+
+// Put a buffer of the given size into the pool. Returns false if the
+// buffer should be released instead.
+WEAK bool return_pooled_block(cl_context ctx, cl_mem mem, size_t size) {
+    pooled_block *b = (pooled_block *)malloc(sizeof(pooled_block));
+    if (b == NULL) {
+        return false;
+    }
+    b->context = ctx;
+    b->mem = mem;
+    b->size = size;
+    ScopedSpinLock spinlock(&device_pool_lock);
+    pooled_block **bin = &device_pool[pool_bin_for_size(size)];
+    b->next = *bin;
+    *bin = b;
+    return true;
+}
+
+// Release all pooled buffers owned by the given context.
+WEAK cl_int release_pooled_blocks(void *user_context, cl_context ctx) {
+    // Unlink the blocks under the lock, and release them outside it.
+    pooled_block *to_free = NULL;
+    {
+        ScopedSpinLock spinlock(&device_pool_lock);
+        for (int i = 0; i < num_pool_bins; i++) {
+            pooled_block **prev_ptr = &device_pool[i];
+            pooled_block *b = *prev_ptr;
+            while (b != NULL) {
+                pooled_block *next = b->next;
+                if (b->context == ctx) {
+                    *prev_ptr = next;
+                    b->next = to_free;
+                    to_free = b;
+                } else {
+                    prev_ptr = &b->next;
+                }
+                b = next;
+            }
+        }
+    }  // spinlock
+
+    cl_int result = CL_SUCCESS;
+    while (to_free != NULL) {
+        pooled_block *next = to_free->next;
+        debug(user_context) << "    clReleaseMemObject " << (void *)to_free->mem << "\n";
+        forget_mem_event(to_free->mem);
+        cl_int err = clReleaseMemObject(to_free->mem);
+        if (err != CL_SUCCESS) {
+            result = err;
+        }
+        free(to_free);
+        to_free = next;
+    }
+    return result;
+}
+
+// Compiled programs are cached on disk in the directory returned by
+// halide_opencl_get_program_cache_dir, so that later processes can
+// skip compiling the kernel source. A cached binary is only used for
+// the same source, build options, device and driver, all of which
+// are stored in the file and compared on load, as the file name is
+// just a hash of them.
+
+struct program_cache_header {
+    uint32_t magic;
+    uint32_t identity_size;
+    uint64_t source_size;
+    uint64_t binary_size;
+};
+
+const uint32_t kProgramCacheMagic = 0x4c43484c;  // "HLCL"
+
+WEAK uint64_t fnv1a_hash(uint64_t h, const char *data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        h = (h ^ (uint8_t)data[i]) * 1099511628211ULL;
+    }
+    return h;
+}
+
+// Describe the device and build options a program is compiled for,
+// and build the path of the cache file for it. Returns false if there
+// is no cache directory, or anything doesn't fit.
+WEAK bool program_cache_path(void *user_context, cl_device_id dev, const char *options,
+                             const char *src, size_t src_size,
+                             char *identity, size_t identity_capacity, size_t *identity_size,
+                             char *path, size_t path_capacity) {
+    const char *dir = halide_opencl_get_program_cache_dir(user_context);
+    if (dir == NULL || dir[0] == 0) {
+        return false;
+    }
+
+    const cl_device_info infos[] = { CL_DEVICE_NAME, CL_DEVICE_VERSION, CL_DRIVER_VERSION };
+    char *end = identity + identity_capacity;
+    char *c = identity;
+    for (size_t i = 0; i < sizeof(infos) / sizeof(infos[0]); i++) {
+        char value[256];
+        if (clGetDeviceInfo(dev, infos[i], sizeof(value), value, NULL) != CL_SUCCESS) {
+            return false;
+        }
+        value[sizeof(value) - 1] = 0;
+        c = halide_string_to_string(c, end, value);
+        c = halide_string_to_string(c, end, "\n");
+    }
+    c = halide_string_to_string(c, end, options);
+    if (c >= end - 1) {
+        return false;
+    }
+    *identity_size = c - identity;
+
+    uint64_t h = 14695981039346656037ULL;
+    h = fnv1a_hash(h, identity, *identity_size);
+    h = fnv1a_hash(h, src, src_size);
+
+    end = path + path_capacity;
+    c = halide_string_to_string(path, end, dir);
+    c = halide_string_to_string(c, end, "/halide_opencl_");
+    c = halide_uint64_to_string(c, end, h, 1);
+    c = halide_string_to_string(c, end, ".bin");
+    return c < end - 1;
+}
+
+WEAK bool read_and_compare_bytes(void *f, const char *expected, size_t bytes) {
+    char chunk[256];
+    while (bytes > 0) {
+        size_t n = bytes < sizeof(chunk) ? bytes : sizeof(chunk);
+        if (fread(chunk, n, 1, f) != 1 || memcmp(chunk, expected, n) != 0) {
+            return false;
+        }
+        expected += n;
+        bytes -= n;
+    }
+    return true;
+}
+
+// Create a program from a cached binary. Returns NULL if there is no
+// usable cached binary.
+WEAK cl_program load_cached_program(void *user_context, cl_context context, cl_device_id dev,
+                                    const char *path, const char *identity, size_t identity_size,
+                                    const char *src, size_t src_size) {
+    void *f = fopen(path, "rb");
+    if (!f) {
+        return NULL;
+    }
+    program_cache_header header;
+    bool ok = (fread(&header, sizeof(header), 1, f) == 1 &&
+               header.magic == kProgramCacheMagic &&
+               header.identity_size == identity_size &&
+               header.source_size == src_size &&
+               header.binary_size > 0 &&
+               read_and_compare_bytes(f, identity, identity_size) &&
+               read_and_compare_bytes(f, src, src_size));
+    unsigned char *binary = NULL;
+    if (ok) {
+        binary = (unsigned char *)malloc(header.binary_size);
+        ok = binary != NULL && fread(binary, header.binary_size, 1, f) == 1;
+    }
+    fclose(f);
+    if (!ok) {
+        free(binary);
+        return NULL;
+    }
+
+    cl_int err, binary_status;
+    size_t binary_size = header.binary_size;
+    const unsigned char *binaries[] = { binary };
+    debug(user_context) << "    clCreateProgramWithBinary " << path << " -> ";
+    cl_program program = clCreateProgramWithBinary(context, 1, &dev, &binary_size, binaries,
+                                                   &binary_status, &err);
+    free(binary);
+    if (err != CL_SUCCESS || binary_status != CL_SUCCESS) {
+        debug(user_context) << get_opencl_error_name(err != CL_SUCCESS ? err : binary_status) << "\n";
+        if (err == CL_SUCCESS) {
+            debug(user_context) << "    clReleaseProgram " << (void *)program << "\n";
+            clReleaseProgram(program);
+        }
+        return NULL;
+    }
+    debug(user_context) << (void *)program << "\n";
+    return program;
+}
+
+// Write the binary of a program that was just built to the cache.
+WEAK void save_program_binary(void *user_context, cl_program program, const char *path,
+                              const char *identity, size_t identity_size,
+                              const char *src, size_t src_size) {
+    size_t binary_size = 0;
+    if (clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, sizeof(binary_size), &binary_size, NULL) != CL_SUCCESS ||
+        binary_size == 0) {
+        return;
+    }
+    unsigned char *binary = (unsigned char *)malloc(binary_size);
+    if (binary == NULL) {
+        return;
+    }
+    if (clGetProgramInfo(program, CL_PROGRAM_BINARIES, sizeof(binary), &binary, NULL) != CL_SUCCESS) {
+        free(binary);
+        return;
+    }
+
+    debug(user_context) << "    caching program binary in " << path << "\n";
+    void *f = fopen(path, "wb");
+    if (f) {
+        program_cache_header header = { kProgramCacheMagic, (uint32_t)identity_size,
+                                        (uint64_t)src_size, (uint64_t)binary_size };
+        bool ok = (fwrite(&header, sizeof(header), 1, f) == 1 &&
+                   fwrite(identity, identity_size, 1, f) == 1 &&
+                   fwrite(src, src_size, 1, f) == 1 &&
+                   fwrite(binary, binary_size, 1, f) == 1);
+        fclose(f);
+        if (!ok) {
+            remove(path);
+        }
+    }
+    free(binary);
+}
+
 WEAK bool validate_device_pointer(void *user_context, halide_buffer_t* buf, size_t size=0) {
     if (buf->device == 0) {
         return true;
@@ -455,8 +969,21 @@ WEAK int create_opencl_context(void *user_context, cl_context *ctx, cl_command_q
         debug(user_context) << *ctx << "\n";
     }
 
+    // Use an out-of-order queue if requested and the device supports
+    // it. Commands are ordered by events either way.
+    cl_command_queue_properties queue_properties = 0;
+    if (halide_opencl_get_out_of_order_queue(user_context)) {
+        cl_command_queue_properties supported = 0;
+        err = clGetDeviceInfo(dev, CL_DEVICE_QUEUE_PROPERTIES, sizeof(supported), &supported, NULL);
+        if (err == CL_SUCCESS && (supported & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE)) {
+            queue_properties = CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE;
+        } else {
+            debug(user_context) << "    Device doesn't support out-of-order queues\n";
+        }
+    }
+
     debug(user_context) << "    clCreateCommandQueue ";
-    *q = clCreateCommandQueue(*ctx, dev, 0, &err);
+    *q = clCreateCommandQueue(*ctx, dev, queue_properties, &err);
     if (err != CL_SUCCESS) {
         debug(user_context) << get_opencl_error_name(err);
         error(user_context) << "CL: clCreateCommandQueue failed: "
@@ -498,8 +1025,45 @@ WEAK int halide_opencl_device_free(void *user_context, halide_buffer_t* buf) {
     #endif
 
     halide_assert(user_context, validate_device_pointer(user_context, buf));
-    debug(user_context) << "    clReleaseMemObject " << (void *)dev_ptr << "\n";
-    cl_int result = clReleaseMemObject((cl_mem)dev_ptr);
+
+    // Hand the buffer back to the pool, unless it shares its storage
+    // with a host allocation, or something else, such as a crop, still
+    // holds a reference to it.
+    cl_int result = CL_SUCCESS;
+    zero_copy_allocation *z = find_zero_copy_allocation(dev_ptr);
+    size_t size = 0;
+    cl_uint ref_count = 0;
+    if (z == NULL &&
+        clGetMemObjectInfo(dev_ptr, CL_MEM_SIZE, sizeof(size), &size, NULL) == CL_SUCCESS &&
+        clGetMemObjectInfo(dev_ptr, CL_MEM_REFERENCE_COUNT, sizeof(ref_count), &ref_count, NULL) == CL_SUCCESS &&
+        ref_count == 1 &&
+        return_pooled_block(ctx.context, dev_ptr, size)) {
+        debug(user_context) << "    returning " << (void *)dev_ptr << " to the pool\n";
+    } else {
+        if (z != NULL && z->orig == NULL) {
+            // The storage belongs to the caller of
+            // halide_opencl_wrap_host_memory. Hand it back to the host
+            // for good.
+            give_zero_copy_to_host(user_context, ctx.cmd_queue, dev_ptr);
+            {
+                ScopedSpinLock spinlock(&zero_copy_allocations_lock);
+                zero_copy_allocation **prev_ptr = &zero_copy_allocations;
+                while (*prev_ptr != z) {
+                    prev_ptr = &(*prev_ptr)->next;
+                }
+                *prev_ptr = z->next;
+            }  // spinlock
+            free(z);
+        } else if (z != NULL) {
+            // The host allocation outlives the buffer, and is freed by
+            // halide_opencl_device_and_host_free.
+            give_zero_copy_to_device(user_context, ctx.cmd_queue, dev_ptr);
+            z->mem = NULL;
+        }
+        debug(user_context) << "    clReleaseMemObject " << (void *)dev_ptr << "\n";
+        forget_mem_event(dev_ptr);
+        result = clReleaseMemObject((cl_mem)dev_ptr);
+    }
     // If clReleaseMemObject fails, it is unlikely to succeed in a later call, so
     // we just end our reference to it regardless.
     free((device_handle *)buf->device);
@@ -587,41 +1151,73 @@ WEAK int halide_opencl_initialize_kernels(void *user_context, void **state_ptr,
         options << "-D MAX_CONSTANT_BUFFER_SIZE=" << max_constant_buffer_size
                 << " -D MAX_CONSTANT_ARGS=" << max_constant_args;
 
-        const char * sources[] = { src };
-        debug(user_context) << "    clCreateProgramWithSource -> ";
-        cl_program program = clCreateProgramWithSource(ctx.context, 1, &sources[0], NULL, &err );
-        if (err != CL_SUCCESS) {
-            debug(user_context) << get_opencl_error_name(err) << "\n";
-            error(user_context) << "CL: clCreateProgramWithSource failed: "
-                                << get_opencl_error_name(err);
-            return err;
-        } else {
-            debug(user_context) << (void *)program << "\n";
+        // Try a binary compiled by an earlier process first.
+        char identity[1024], cache_path[1024];
+        size_t identity_size = 0;
+        bool use_cache = program_cache_path(user_context, dev, options.str(), src, size,
+                                            identity, sizeof(identity), &identity_size,
+                                            cache_path, sizeof(cache_path));
+        cl_program program = NULL;
+        if (use_cache) {
+            program = load_cached_program(user_context, ctx.context, dev, cache_path,
+                                          identity, identity_size, src, size);
+            if (program) {
+                debug(user_context) << "    clBuildProgram " << (void *)program
+                                    << " " << options.str() << "\n";
+                err = clBuildProgram(program, 1, devices, options.str(), NULL, NULL);
+                if (err != CL_SUCCESS) {
+                    debug(user_context) << "    cached binary failed to build ("
+                                        << get_opencl_error_name(err) << "), compiling source\n";
+                    debug(user_context) << "    clReleaseProgram " << (void *)program << "\n";
+                    clReleaseProgram(program);
+                    program = NULL;
+                }
+            }
         }
-        (*state)->program = program;
-
-        debug(user_context) << "    clBuildProgram " << (void *)program
-                            << " " << options.str() << "\n";
-        err = clBuildProgram(program, 1, devices, options.str(), NULL, NULL );
-        if (err != CL_SUCCESS) {
 
-            // Allocate an appropriately sized buffer for the build log.
-            char buffer[8192];
-
-            // Get build log
-            if (clGetProgramBuildInfo(program, dev,
-                                      CL_PROGRAM_BUILD_LOG,
-                                      sizeof(buffer), buffer,
-                                      NULL) == CL_SUCCESS) {
-                error(user_context) << "CL: clBuildProgram failed: "
-                                    << get_opencl_error_name(err)
-                                    << "\nBuild Log:\n"
-                                    << buffer << "\n";
+        if (program) {
+            (*state)->program = program;
+        } else {
+            const char * sources[] = { src };
+            debug(user_context) << "    clCreateProgramWithSource -> ";
+            program = clCreateProgramWithSource(ctx.context, 1, &sources[0], NULL, &err );
+            if (err != CL_SUCCESS) {
+                debug(user_context) << get_opencl_error_name(err) << "\n";
+                error(user_context) << "CL: clCreateProgramWithSource failed: "
+                                    << get_opencl_error_name(err);
+                return err;
             } else {
-                error(user_context) << "clGetProgramBuildInfo failed";
+                debug(user_context) << (void *)program << "\n";
             }
+            (*state)->program = program;
 
-            return err;
+            debug(user_context) << "    clBuildProgram " << (void *)program
+                                << " " << options.str() << "\n";
+            err = clBuildProgram(program, 1, devices, options.str(), NULL, NULL );
+            if (err != CL_SUCCESS) {
+
+                // Allocate an appropriately sized buffer for the build log.
+                char buffer[8192];
+
+                // Get build log
+                if (clGetProgramBuildInfo(program, dev,
+                                          CL_PROGRAM_BUILD_LOG,
+                                          sizeof(buffer), buffer,
+                                          NULL) == CL_SUCCESS) {
+                    error(user_context) << "CL: clBuildProgram failed: "
+                                        << get_opencl_error_name(err)
+                                        << "\nBuild Log:\n"
+                                        << buffer << "\n";
+                } else {
+                    error(user_context) << "clGetProgramBuildInfo failed";
+                }
+
+                return err;
+            }
+
+            if (use_cache) {
+                save_program_binary(user_context, program, cache_path, identity, identity_size, src, size);
+            }
         }
     }
 
@@ -634,7 +1230,7 @@ WEAK int halide_opencl_initialize_kernels(void *user_context, void **state_ptr,
 }
 
 // Used to generate correct timings when tracing
-WEAK int halide_opencl_device_sync(void *user_context, halide_buffer_t *) {
+WEAK int halide_opencl_device_sync(void *user_context, halide_buffer_t *buf) {
     debug(user_context) << "CL: halide_opencl_device_sync (user_context: " << user_context << ")\n";
 
     ClContext ctx(user_context);
@@ -644,9 +1240,15 @@ WEAK int halide_opencl_device_sync(void *user_context, halide_buffer_t *) {
     uint64_t t_before = halide_current_time_ns(user_context);
     #endif
 
-    cl_int err = clFinish(ctx.cmd_queue);
+    // Only wait for the commands that use the given buffer, if any.
+    cl_int err;
+    if (buf != NULL && buf->device != 0 && buf->device_interface == &opencl_device_interface) {
+        err = wait_for_mem(((device_handle *)buf->device)->mem);
+    } else {
+        err = clFinish(ctx.cmd_queue);
+    }
     if (err != CL_SUCCESS) {
-        error(user_context) << "CL: clFinish failed: "
+        error(user_context) << "CL: waiting for device failed: "
                             << get_opencl_error_name(err);
         return err;
     }
@@ -676,6 +1278,12 @@ WEAK int halide_opencl_device_release(void *user_context) {
     if (ctx) {
         err = clFinish(q);
         halide_assert(user_context, err == CL_SUCCESS);
+        forget_mem_event(NULL);
+
+        // Release the buffers pooled for this context.
+        err = release_pooled_blocks(user_context, ctx);
+        halide_assert(user_context, err == CL_SUCCESS);
+        release_crop_handles(&crop_handles, &crop_handles_lock);
 
         // Unload the modules attached to this context. Note that the list
         // nodes themselves are not freed, only the program objects are
@@ -712,6 +1320,22 @@ WEAK int halide_opencl_device_release(void *user_context) {
     return 0;
 }
 
+WEAK int halide_opencl_release_unused_device_allocations(void *user_context) {
+    debug(user_context)
+        << "CL: halide_opencl_release_unused_device_allocations (user_context: "
+        << user_context << ")\n";
+
+    // Don't create a context just to find that it has nothing pooled.
+    cl_context ctx;
+    cl_command_queue q;
+    int err = halide_acquire_cl_context(user_context, &ctx, &q, false);
+    if (err == 0 && ctx) {
+        err = release_pooled_blocks(user_context, ctx);
+    }
+    halide_release_cl_context(user_context);
+    return err;
+}
+
 WEAK int halide_opencl_device_malloc(void *user_context, halide_buffer_t* buf) {
     debug(user_context)
         << "CL: halide_opencl_device_malloc (user_context: " << user_context
@@ -745,9 +1369,28 @@ WEAK int halide_opencl_device_malloc(void *user_context, halide_buffer_t* buf) {
         return CL_OUT_OF_HOST_MEMORY;
     }
 
+    size = pool_size_class(size);
+    cl_mem dev_ptr = take_pooled_block(ctx.context, size);
+    if (dev_ptr) {
+        debug(user_context) << "    reusing pooled allocation " << (void *)dev_ptr << "\n";
+        dev_handle->mem = dev_ptr;
+        dev_handle->offset = 0;
+        buf->device = (uint64_t)dev_handle;
+        buf->device_interface = &opencl_device_interface;
+        buf->device_interface->impl->use_module();
+        return CL_SUCCESS;
+    }
+
     cl_int err;
     debug(user_context) << "    clCreateBuffer -> " << (int)size << " ";
-    cl_mem dev_ptr = clCreateBuffer(ctx.context, CL_MEM_READ_WRITE, size, NULL, &err);
+    dev_ptr = clCreateBuffer(ctx.context, CL_MEM_READ_WRITE, size, NULL, &err);
+    if (err == CL_MEM_OBJECT_ALLOCATION_FAILURE || err == CL_OUT_OF_RESOURCES) {
+        // Buffers sitting in the pool may be what's using up the
+        // memory, so give them back and try again.
+        debug(user_context) << "out of memory, trimming the pool -> ";
+        release_pooled_blocks(user_context, ctx.context);
+        dev_ptr = clCreateBuffer(ctx.context, CL_MEM_READ_WRITE, size, NULL, &err);
+    }
     if (err != CL_SUCCESS || dev_ptr == 0) {
         debug(user_context) << get_opencl_error_name(err) << "\n";
         error(user_context) << "CL: clCreateBuffer failed: "
@@ -794,24 +1437,52 @@ WEAK int do_multidimensional_copy(void *user_context, ClContext &ctx,
                             << (void *)c.src << " + " << src_idx
                             << " -> " << (void *)c.dst << " + " << dst_idx
                             << ", " << c.chunk_size << " bytes\n";
+        // Wait for the last commands to use the device buffers
+        // involved.
+        cl_mem src_mem = from_host ? NULL : ((device_handle *)c.src)->mem;
+        cl_mem dst_mem = to_host ? NULL : ((device_handle *)c.dst)->mem;
+        cl_event wait_list[2];
+        cl_uint num_events = 0;
+        if (src_mem) {
+            add_mem_dependency(src_mem, wait_list, &num_events);
+        }
+        if (dst_mem) {
+            add_mem_dependency(dst_mem, wait_list, &num_events);
+        }
+        const cl_event *waits = num_events ? wait_list : NULL;
+        cl_event event = NULL;
+
+        // Writes from the host block until the host memory may be
+        // reused, which needn't wait for the write itself to complete.
         if (!from_host && to_host) {
-            err = clEnqueueReadBuffer(ctx.cmd_queue, ((device_handle *)c.src)->mem,
+            err = clEnqueueReadBuffer(ctx.cmd_queue, src_mem,
                                       CL_FALSE, src_idx + ((device_handle *)c.src)->offset, c.chunk_size, (void *)(c.dst + dst_idx),
-                                      0, NULL, NULL);
+                                      num_events, waits, &event);
         } else if (from_host && !to_host) {
-            err = clEnqueueWriteBuffer(ctx.cmd_queue, ((device_handle *)c.dst)->mem,
-                                       CL_FALSE, dst_idx + ((device_handle *)c.dst)->offset, c.chunk_size, (void *)(c.src + src_idx),
-                                       0, NULL, NULL);
+            err = clEnqueueWriteBuffer(ctx.cmd_queue, dst_mem,
+                                       CL_TRUE, dst_idx + ((device_handle *)c.dst)->offset, c.chunk_size, (void *)(c.src + src_idx),
+                                       num_events, waits, &event);
         } else if (!from_host && !to_host) {
-            err = clEnqueueCopyBuffer(ctx.cmd_queue, ((device_handle *)c.src)->mem, ((device_handle *)c.dst)->mem,
+            err = clEnqueueCopyBuffer(ctx.cmd_queue, src_mem, dst_mem,
                                       src_idx + ((device_handle *)c.src)->offset, dst_idx  + ((device_handle *)c.dst)->offset,
-                                      c.chunk_size, 0, NULL, NULL);
+                                      c.chunk_size, num_events, waits, &event);
         } else if (c.dst != c.src) {
             // Could reach here if a user called directly into the
             // opencl API for a device->host copy on a source buffer
             // with device_dirty = false.
             memcpy((void *)c.dst, (void *)c.src, c.chunk_size);
         }
+        release_wait_list(wait_list, num_events);
+
+        if (event != NULL) {
+            if (src_mem) {
+                set_mem_event(src_mem, event);
+            }
+            if (dst_mem) {
+                set_mem_event(dst_mem, event);
+            }
+            clReleaseEvent(event);
+        }
 
         if (err) {
             error(user_context) << "CL: buffer copy failed: " << get_opencl_error_name(err);
@@ -881,12 +1552,57 @@ WEAK int halide_opencl_buffer_copy(void *user_context, struct halide_buffer_t *s
         }
         #endif
 
+        // A copy between the two sides of the same zero-copy buffer just
+        // changes which side owns the storage. Any other copy needs the
+        // device to own the device buffers involved.
+        if (src == dst && from_host != to_host &&
+            find_zero_copy_allocation(((device_handle *)dst->device)->mem) != NULL) {
+            cl_mem mem = ((device_handle *)dst->device)->mem;
+            if (from_host) {
+                err = give_zero_copy_to_device(user_context, ctx.cmd_queue, mem);
+            } else {
+                err = give_zero_copy_to_host(user_context, ctx.cmd_queue, mem);
+            }
+            if (err) {
+                error(user_context) << "CL: zero-copy buffer handoff failed: " << get_opencl_error_name(err);
+            }
+            return err;
+        }
+        if (!from_host) {
+            err = give_zero_copy_to_device(user_context, ctx.cmd_queue, ((device_handle *)src->device)->mem);
+        }
+        if (!err && !to_host) {
+            err = give_zero_copy_to_device(user_context, ctx.cmd_queue, ((device_handle *)dst->device)->mem);
+        }
+        if (err) {
+            error(user_context) << "CL: clEnqueueUnmapMemObject failed: " << get_opencl_error_name(err);
+            return err;
+        }
+
+        // Device to device copies go directly between the buffers with
+        // clEnqueueCopyBuffer, even when they are on different devices,
+        // as long as both devices are in the same context, which then
+        // migrates the data as needed. Buffers in different contexts
+        // can't be copied between without a command queue for each.
+        if (!from_host && !to_host) {
+            cl_context src_context = NULL;
+            if (clGetMemObjectInfo(((device_handle *)src->device)->mem, CL_MEM_CONTEXT,
+                                   sizeof(src_context), &src_context, NULL) == CL_SUCCESS &&
+                src_context != ctx.context) {
+                error(user_context) << "CL: can't copy between device buffers in different contexts";
+                return CL_INVALID_CONTEXT;
+            }
+        }
+
         err = do_multidimensional_copy(user_context, ctx, c, c.src_begin, 0, dst->dimensions, from_host, to_host);
 
-        // The reads/writes above are all non-blocking, so empty the command
-        // queue before we proceed so that other host code won't write
-        // to the buffer while the above writes are still running.
-        clFinish(ctx.cmd_queue);
+        // Reads to the host are non-blocking, so wait for them before
+        // the host uses the data. Writes from the host have already
+        // finished with the host memory, and copies between device
+        // buffers are ordered by their events, so those don't wait.
+        if (!err && !from_host && to_host) {
+            err = wait_for_mem(((device_handle *)src->device)->mem);
+        }
 
         #ifdef DEBUG_RUNTIME
         uint64_t t_after = halide_current_time_ns(user_context);
@@ -971,6 +1687,7 @@ WEAK int halide_opencl_run(void *user_context,
         }
         i += 1;
     }
+    const int num_args = i;
     cl_mem *sub_buffers = NULL;
     int sub_buffers_saved = 0;
     if (sub_buffers_needed > 0) {
@@ -981,6 +1698,17 @@ WEAK int halide_opencl_run(void *user_context,
         memset(sub_buffers, 0, sizeof(cl_mem) * sub_buffers_needed);
     }
 
+    // The kernel waits for the last command to use each of its buffers.
+    cl_event *wait_list = NULL;
+    cl_uint num_events = 0;
+    if (num_args > 0) {
+        wait_list = (cl_event *)malloc(sizeof(cl_event) * num_args);
+        if (wait_list == NULL) {
+            free(sub_buffers);
+            return halide_error_code_out_of_memory;
+        }
+    }
+
     i = 0;
     while (arg_sizes[i] != 0) {
         debug(user_context) << "    clSetKernelArg " << i
@@ -995,7 +1723,10 @@ WEAK int halide_opencl_run(void *user_context,
             cl_mem mem = ((device_handle *)((halide_buffer_t *)this_arg)->device)->mem;
             uint64_t offset = ((device_handle *)((halide_buffer_t *)this_arg)->device)->offset;
 
-            if (offset != 0) {
+            // The kernel can't use a zero-copy buffer the host owns.
+            err = give_zero_copy_to_device(user_context, ctx.cmd_queue, mem);
+            add_mem_dependency(mem, wait_list, &num_events);
+            if (err == CL_SUCCESS && offset != 0) {
                 cl_buffer_region region = {(size_t)offset, ((halide_buffer_t *)this_arg)->size_in_bytes()};
                 // The sub-buffer encompasses the linear range of addresses that
                 // span the crop.
@@ -1017,6 +1748,8 @@ WEAK int halide_opencl_run(void *user_context,
                 clReleaseMemObject(sub_buffers[sub_buf_index]);
             }
             free(sub_buffers);
+            release_wait_list(wait_list, num_events);
+            free(wait_list);
             return err;
         }
         i++;
@@ -1029,10 +1762,13 @@ WEAK int halide_opencl_run(void *user_context,
     if (err != CL_SUCCESS) {
         error(user_context) << "CL: clSetKernelArg failed "
                             << get_opencl_error_name(err);
+        release_wait_list(wait_list, num_events);
+        free(wait_list);
         return err;
     }
 
     // Launch kernel
+    cl_event event = NULL;
     debug(user_context)
         << "    clEnqueueNDRangeKernel "
         << blocksX << "x" << blocksY << "x" << blocksZ << ", "
@@ -1041,8 +1777,22 @@ WEAK int halide_opencl_run(void *user_context,
                                  // NDRange
                                  3, NULL, global_dim, local_dim,
                                  // Events
-                                 0, NULL, NULL);
+                                 num_events, num_events ? wait_list : NULL, &event);
     debug(user_context) << get_opencl_error_name(err) << "\n";
+    release_wait_list(wait_list, num_events);
+    free(wait_list);
+
+    // The kernel is now the last command to use each of its buffers.
+    // Submit it, as the host may not wait for it for a while.
+    if (err == CL_SUCCESS) {
+        for (int j = 0; j < num_args; j++) {
+            if (arg_is_buffer[j]) {
+                set_mem_event(((device_handle *)((halide_buffer_t *)args[j])->device)->mem, event);
+            }
+        }
+        clReleaseEvent(event);
+        clFlush(ctx.cmd_queue);
+    }
 
     // Now that the kernel is enqueued, OpenCL is holding its own
     // references to sub buffers and the local ones can be released.
@@ -1073,12 +1823,239 @@ WEAK int halide_opencl_run(void *user_context,
     return 0;
 }
 
+namespace {
+WEAK bool has_unified_memory(ClContext &ctx) {
+    cl_device_id dev;
+    cl_bool unified = CL_FALSE;
+    if (clGetContextInfo(ctx.context, CL_CONTEXT_DEVICES, sizeof(dev), &dev, NULL) != CL_SUCCESS ||
+        clGetDeviceInfo(dev, CL_DEVICE_HOST_UNIFIED_MEMORY, sizeof(unified), &unified, NULL) != CL_SUCCESS) {
+        return false;
+    }
+    return unified == CL_TRUE;
+}
+
+// Make a zero-copy buffer that uses the storage at host, and attach
+// it to buf. orig is the allocation that host points into, which is
+// freed along with the buffer, or NULL if the caller owns the
+// storage. Returns an error, leaving buf untouched and orig unfreed,
+// if the driver won't make one.
+WEAK int make_zero_copy_buffer(void *user_context, ClContext &ctx, halide_buffer_t *buf,
+                               void *host, void *orig) {
+    size_t size = buf->size_in_bytes();
+    zero_copy_allocation *z = (zero_copy_allocation *)malloc(sizeof(zero_copy_allocation));
+    device_handle *dev_handle = (device_handle *)malloc(sizeof(device_handle));
+    if (z == NULL || dev_handle == NULL) {
+        free(z);
+        free(dev_handle);
+        return CL_OUT_OF_HOST_MEMORY;
+    }
+    z->orig = orig;
+    z->host = host;
+    z->size = size;
+    z->mapped = false;
+
+    cl_int err;
+    debug(user_context) << "    clCreateBuffer (CL_MEM_USE_HOST_PTR) -> " << (int)size << " ";
+    z->mem = clCreateBuffer(ctx.context, CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR, size, z->host, &err);
+    if (err != CL_SUCCESS || z->mem == 0) {
+        debug(user_context) << get_opencl_error_name(err) << "\n";
+        free(z);
+        free(dev_handle);
+        return err != CL_SUCCESS ? err : CL_INVALID_MEM_OBJECT;
+    }
+    debug(user_context) << (void *)z->mem << "\n";
+
+    {
+        ScopedSpinLock spinlock(&zero_copy_allocations_lock);
+        z->next = zero_copy_allocations;
+        zero_copy_allocations = z;
+    }  // spinlock
+
+    // Start out mapped, as the host owns a freshly allocated buffer.
+    err = give_zero_copy_to_host(user_context, ctx.cmd_queue, z->mem);
+    if (err != CL_SUCCESS) {
+        debug(user_context) << "    clEnqueueMapBuffer failed: " << get_opencl_error_name(err) << "\n";
+        {
+            ScopedSpinLock spinlock(&zero_copy_allocations_lock);
+            zero_copy_allocation **prev_ptr = &zero_copy_allocations;
+            while (*prev_ptr != z) {
+                prev_ptr = &(*prev_ptr)->next;
+            }
+            *prev_ptr = z->next;
+        }  // spinlock
+        debug(user_context) << "    clReleaseMemObject " << (void *)z->mem << "\n";
+        clReleaseMemObject(z->mem);
+        free(z);
+        free(dev_handle);
+        return err;
+    }
+
+    dev_handle->mem = z->mem;
+    dev_handle->offset = 0;
+    buf->host = (uint8_t *)z->host;
+    buf->device = (uint64_t)dev_handle;
+    buf->device_interface = &opencl_device_interface;
+    buf->device_interface->impl->use_module();
+    return 0;
+}
+
+// Allocate buf as a zero-copy buffer. Returns an error, leaving buf
+// untouched, if the driver won't make one.
+WEAK int zero_copy_device_and_host_malloc(void *user_context, ClContext &ctx, halide_buffer_t *buf) {
+    void *orig = malloc(buf->size_in_bytes() + zero_copy_alignment - 1);
+    if (orig == NULL) {
+        return CL_OUT_OF_HOST_MEMORY;
+    }
+    void *host = (void *)(((uintptr_t)orig + zero_copy_alignment - 1) & ~(uintptr_t)(zero_copy_alignment - 1));
+    int err = make_zero_copy_buffer(user_context, ctx, buf, host, orig);
+    if (err != 0) {
+        free(orig);
+    }
+    return err;
+}
+}
+
 WEAK int halide_opencl_device_and_host_malloc(void *user_context, struct halide_buffer_t *buf) {
-    return halide_default_device_and_host_malloc(user_context, buf, &opencl_device_interface);
+    debug(user_context)
+        << "CL: halide_opencl_device_and_host_malloc (user_context: " << user_context
+        << ", buf: " << buf << ")\n";
+
+    {
+        ClContext ctx(user_context);
+        if (ctx.error != CL_SUCCESS) {
+            return ctx.error;
+        }
+        // Fall back to a separate pinned host allocation if the
+        // device doesn't share memory with the host, or the driver
+        // won't make a zero-copy buffer.
+        if (has_unified_memory(ctx) &&
+            zero_copy_device_and_host_malloc(user_context, ctx, buf) == 0) {
+            return 0;
+        }
+    }
+
+    pinned_host_allocation *pinned = (pinned_host_allocation *)malloc(sizeof(pinned_host_allocation));
+    if (pinned == NULL) {
+        return CL_OUT_OF_HOST_MEMORY;
+    }
+
+    size_t size = buf->size_in_bytes();
+    {
+        ClContext ctx(user_context);
+        if (ctx.error != CL_SUCCESS) {
+            free(pinned);
+            return ctx.error;
+        }
+
+        cl_int err;
+        debug(user_context) << "    clCreateBuffer (CL_MEM_ALLOC_HOST_PTR) -> " << (int)size << " ";
+        pinned->mem = clCreateBuffer(ctx.context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, size, NULL, &err);
+        if (err != CL_SUCCESS || pinned->mem == 0) {
+            // Fall back to pageable memory rather than failing.
+            debug(user_context) << get_opencl_error_name(err) << "\n";
+            free(pinned);
+            return halide_default_device_and_host_malloc(user_context, buf, &opencl_device_interface);
+        }
+        debug(user_context) << (void *)pinned->mem << "\n";
+
+        pinned->host = clEnqueueMapBuffer(ctx.cmd_queue, pinned->mem, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE,
+                                          0, size, 0, NULL, NULL, &err);
+        if (err != CL_SUCCESS || pinned->host == NULL) {
+            debug(user_context) << "    clEnqueueMapBuffer failed: " << get_opencl_error_name(err) << "\n";
+            debug(user_context) << "    clReleaseMemObject " << (void *)pinned->mem << "\n";
+            clReleaseMemObject(pinned->mem);
+            free(pinned);
+            return halide_default_device_and_host_malloc(user_context, buf, &opencl_device_interface);
+        }
+    }
+
+    buf->host = (uint8_t *)pinned->host;
+    int result = halide_device_malloc(user_context, buf, &opencl_device_interface);
+    if (result != 0) {
+        ClContext ctx(user_context);
+        clEnqueueUnmapMemObject(ctx.cmd_queue, pinned->mem, pinned->host, 0, NULL, NULL);
+        debug(user_context) << "    clReleaseMemObject " << (void *)pinned->mem << "\n";
+        clReleaseMemObject(pinned->mem);
+        free(pinned);
+        buf->host = NULL;
+        return result;
+    }
+
+    ScopedSpinLock spinlock(&pinned_host_allocations_lock);
+    pinned->next = pinned_host_allocations;
+    pinned_host_allocations = pinned;
+    return 0;
 }
 
 WEAK int halide_opencl_device_and_host_free(void *user_context, struct halide_buffer_t *buf) {
-    return halide_default_device_and_host_free(user_context, buf, &opencl_device_interface);
+    debug(user_context)
+        << "CL: halide_opencl_device_and_host_free (user_context: " << user_context
+        << ", buf: " << buf << ")\n";
+
+    int result = halide_device_free(user_context, buf);
+    if (buf->host) {
+        pinned_host_allocation *pinned = NULL;
+        {
+            ScopedSpinLock spinlock(&pinned_host_allocations_lock);
+            pinned_host_allocation **prev_ptr = &pinned_host_allocations;
+            while (*prev_ptr != NULL) {
+                if ((*prev_ptr)->host == buf->host) {
+                    pinned = *prev_ptr;
+                    *prev_ptr = pinned->next;
+                    break;
+                }
+                prev_ptr = &(*prev_ptr)->next;
+            }
+        }  // spinlock
+
+        zero_copy_allocation *z = NULL;
+        if (pinned == NULL) {
+            ScopedSpinLock spinlock(&zero_copy_allocations_lock);
+            zero_copy_allocation **prev_ptr = &zero_copy_allocations;
+            while (*prev_ptr != NULL) {
+                if ((*prev_ptr)->host == buf->host) {
+                    z = *prev_ptr;
+                    *prev_ptr = z->next;
+                    break;
+                }
+                prev_ptr = &(*prev_ptr)->next;
+            }
+        }  // spinlock
+
+        if (pinned) {
+            ClContext ctx(user_context);
+            if (ctx.error == CL_SUCCESS) {
+                clEnqueueUnmapMemObject(ctx.cmd_queue, pinned->mem, pinned->host, 0, NULL, NULL);
+                debug(user_context) << "    clReleaseMemObject " << (void *)pinned->mem << "\n";
+                clReleaseMemObject(pinned->mem);
+            }
+            free(pinned);
+        } else if (z) {
+            ClContext ctx(user_context);
+            if (ctx.error == CL_SUCCESS) {
+                // Freeing the device side above released the buffer,
+                // unless the buffer was detached from it.
+                if (z->mem != NULL) {
+                    if (z->mapped) {
+                        clEnqueueUnmapMemObject(ctx.cmd_queue, z->mem, z->host, 0, NULL, NULL);
+                    }
+                    debug(user_context) << "    clReleaseMemObject " << (void *)z->mem << "\n";
+                    forget_mem_event(z->mem);
+                    clReleaseMemObject(z->mem);
+                }
+                // Commands still in flight may use the storage.
+                clFinish(ctx.cmd_queue);
+            }
+            free(z->orig);
+            free(z);
+        } else {
+            halide_free(user_context, buf->host);
+        }
+        buf->host = NULL;
+    }
+    buf->set_host_dirty(false);
+    buf->set_device_dirty(false);
+    return result;
 }
 
 WEAK int halide_opencl_wrap_cl_mem(void *user_context, struct halide_buffer_t *buf, uint64_t mem) {
@@ -1119,6 +2096,34 @@ WEAK int halide_opencl_detach_cl_mem(void *user_context, halide_buffer_t *buf) {
     return 0;
 }
 
+WEAK int halide_opencl_wrap_host_memory(void *user_context, struct halide_buffer_t *buf) {
+    debug(user_context)
+        << "CL: halide_opencl_wrap_host_memory (user_context: " << user_context
+        << ", buf: " << buf << ")\n";
+
+    halide_assert(user_context, buf->device == 0);
+    if (buf->device != 0) {
+        return halide_error_code_device_wrap_native_failed;
+    }
+    if (buf->host == NULL) {
+        return halide_error_code_host_is_null;
+    }
+
+    ClContext ctx(user_context);
+    if (ctx.error != CL_SUCCESS) {
+        return ctx.error;
+    }
+    // The buffer starts out mapped, so whatever is in the host memory
+    // is where the host left it.
+    int err = make_zero_copy_buffer(user_context, ctx, buf, buf->host, NULL);
+    if (err != 0) {
+        error(user_context) << "CL: failed to wrap host memory: "
+                            << get_opencl_error_name(err) << "\n";
+        return halide_error_code_device_wrap_native_failed;
+    }
+    return 0;
+}
+
 WEAK uintptr_t halide_opencl_get_cl_mem(void *user_context, halide_buffer_t *buf) {
     if (buf->device == NULL) {
         return 0;
@@ -1149,7 +2154,8 @@ WEAK int halide_opencl_device_crop(void *user_context,
         offset += (dst->dim[i].min - src->dim[i].min) * src->dim[i].stride;
     }
     offset *= src->type.bytes();
-    device_handle *new_dev_handle = (device_handle *)malloc(sizeof(device_handle));
+    device_handle *new_dev_handle =
+        (device_handle *)take_crop_handle(&crop_handles, &crop_handles_lock, sizeof(device_handle));
     if (new_dev_handle == NULL) {
         error(user_context) << "CL: malloc failed making device handle for crop.\n";
         return halide_error_code_out_of_memory;
@@ -1187,7 +2193,7 @@ WEAK int halide_opencl_device_release_crop(void *user_context,
     debug(user_context) << "    clReleaseMemObject " << (void *)dev_ptr << "\n";
     // Sub-buffers are released with clReleaseMemObject
     cl_int result = clReleaseMemObject((cl_mem)dev_ptr);
-    free((device_handle *)buf->device);
+    return_crop_handle(&crop_handles, &crop_handles_lock, (device_handle *)buf->device);
     if (result != CL_SUCCESS) {
         // We may be called as a destructor, so don't raise an error
         // here.
@@ -20,6 +20,7 @@
     GLFUNC(PFNGLBINDBUFFERPROC, BindBuffer); \
     GLFUNC(PFNGLBINDBUFFERBASEPROC, BindBufferBase); \
     GLFUNC(PFNGLBUFFERDATAPROC, BufferData); \
+    GLFUNC(PFNGLBUFFERSUBDATAPROC, BufferSubData); \
     GLFUNC(PFNGLCREATEPROGRAMPROC, CreateProgram); \
     GLFUNC(PFNGLCOMPILESHADERPROC, CompileShader); \
     GLFUNC(PFNGLCREATESHADERPROC, CreateShader); \
@@ -93,6 +94,19 @@ WEAK KernelInfo *find_kernel_by_name(const char *kernel_name, const ModuleState
     return kernel;
 }
 
+// A device buffer released by halide_openglcompute_device_free, kept
+// for reuse by a later allocation of a similar size.
+struct PooledBuffer {
+    GLuint id;
+    size_t size;
+};
+
+// Creating and destroying buffer objects is expensive on most mobile
+// drivers, and pipelines tend to allocate the same sizes over and over, so
+// freed buffers are kept around until the pool is full or the device is
+// released.
+const int max_pooled_buffers = 16;
+
 // All persistent state maintained by the runtime.
 struct GlobalState {
     void init();
@@ -100,6 +114,10 @@ struct GlobalState {
 
     bool initialized;
 
+    // Pooled buffers, from the least to the most recently freed.
+    PooledBuffer pool[max_pooled_buffers];
+    int pool_size;
+
     // Declare pointers used OpenGL functions
 #define GLFUNC(PTYPE,VAR) PTYPE VAR
     USED_GL_FUNCTIONS;
@@ -143,6 +161,7 @@ WEAK void debug_buffer(void *user_context, halide_buffer_t *buf) {
 
 WEAK void GlobalState::init() {
     initialized = false;
+    pool_size = 0;
 #define GLFUNC(type, name) name = NULL;
     USED_GL_FUNCTIONS;
 #undef GLFUNC
@@ -216,6 +235,12 @@ WEAK int halide_openglcompute_device_release(void *user_context) {
         mod = next;
     }
 
+    if (global_state.initialized) {
+        for (int i = 0; i < global_state.pool_size; i++) {
+            global_state.DeleteBuffers(1, &global_state.pool[i].id);
+        }
+    }
+
     global_state = GlobalState();
 
 #ifdef DEBUG_RUNTIME
@@ -275,15 +300,35 @@ WEAK int halide_openglcompute_device_malloc(void *user_context, halide_buffer_t
         return 1;
     }
 
+    // Reuse the smallest pooled buffer that is big enough, as long as it
+    // doesn't waste more than half of its storage.
+    int best = -1;
+    for (int i = 0; i < global_state.pool_size; i++) {
+        size_t pooled = global_state.pool[i].size;
+        if (pooled >= size && pooled / 2 <= size &&
+            (best < 0 || pooled < global_state.pool[best].size)) {
+            best = i;
+        }
+    }
+
     GLuint the_buffer;
-    global_state.GenBuffers(1, &the_buffer);
-    if (global_state.CheckAndReportError(user_context, "oglc: GenBuffers")) { return 1; }
-    global_state.BindBuffer(GL_ARRAY_BUFFER, the_buffer);
-    if (global_state.CheckAndReportError(user_context, "oglc: BindBuffer")) { return 1; }
-    size_t size_in_bytes = buf->size_in_bytes();
-    halide_assert(user_context, size_in_bytes != 0);
-    global_state.BufferData(GL_ARRAY_BUFFER, size_in_bytes, NULL, GL_DYNAMIC_COPY);
-    if (global_state.CheckAndReportError(user_context, "oglc: BufferData")) { return 1; }
+    if (best >= 0) {
+        the_buffer = global_state.pool[best].id;
+        // Shift the newer entries down, to keep the pool in the order
+        // the buffers were freed.
+        for (int i = best + 1; i < global_state.pool_size; i++) {
+            global_state.pool[i - 1] = global_state.pool[i];
+        }
+        global_state.pool_size--;
+        debug(user_context) << "Reusing pooled dev_buffer " << the_buffer << "\n";
+    } else {
+        global_state.GenBuffers(1, &the_buffer);
+        if (global_state.CheckAndReportError(user_context, "oglc: GenBuffers")) { return 1; }
+        global_state.BindBuffer(GL_ARRAY_BUFFER, the_buffer);
+        if (global_state.CheckAndReportError(user_context, "oglc: BindBuffer")) { return 1; }
+        global_state.BufferData(GL_ARRAY_BUFFER, size, NULL, GL_DYNAMIC_COPY);
+        if (global_state.CheckAndReportError(user_context, "oglc: BufferData")) { return 1; }
+    }
 
     buf->device = the_buffer;
     buf->device_interface = &openglcompute_device_interface;
@@ -320,7 +365,20 @@ WEAK int halide_openglcompute_device_free(void *user_context, halide_buffer_t *b
                         << ", the_buffer:" << the_buffer
                         << ")\n";
 
-    global_state.DeleteBuffers(1, &the_buffer);
+    size_t size = buf->size_in_bytes();
+    if (global_state.pool_size < max_pooled_buffers) {
+        global_state.pool[global_state.pool_size].id = the_buffer;
+        global_state.pool[global_state.pool_size].size = size;
+        global_state.pool_size++;
+    } else {
+        // Evict the oldest pooled buffer to make room.
+        global_state.DeleteBuffers(1, &global_state.pool[0].id);
+        for (int i = 1; i < max_pooled_buffers; i++) {
+            global_state.pool[i - 1] = global_state.pool[i];
+        }
+        global_state.pool[max_pooled_buffers - 1].id = the_buffer;
+        global_state.pool[max_pooled_buffers - 1].size = size;
+    }
 
     buf->device = 0;
     buf->device_interface->impl->release_module();
@@ -357,8 +415,10 @@ WEAK int halide_openglcompute_copy_to_device(void *user_context, halide_buffer_t
 
     size_t size = buf->size_in_bytes();
     halide_assert(user_context, size != 0);
-    global_state.BufferData(GL_ARRAY_BUFFER, size, buf->host, GL_DYNAMIC_COPY);
-    if (global_state.CheckAndReportError(user_context, "oglc: BufferData")) { return 1; }
+    // The buffer object may come from the pool and be larger than this
+    // buffer, so update its contents in place rather than reallocating it.
+    global_state.BufferSubData(GL_ARRAY_BUFFER, 0, size, buf->host);
+    if (global_state.CheckAndReportError(user_context, "oglc: BufferSubData")) { return 1; }
 
     debug(user_context) << "  copied " << ((unsigned)size) << " bytes from " << buf->host << " to the device.\n";
 
@@ -459,10 +519,11 @@ WEAK int halide_openglcompute_run(void *user_context, void *state_ptr,
         return -1;
     }
 
+    // Each glGetError is a round trip to the driver that can cost as much
+    // as the dispatch itself, so set up all the state and dispatch before
+    // checking for errors once. GL errors are sticky until queried, so any
+    // failure along the way is still reported.
     global_state.UseProgram(kernel->program_id);
-    if (global_state.CheckAndReportError(user_context, "halide_openglcompute_run UseProgram")) {
-        return -1;
-    }
 
     // Populate uniforms with values passed in arguments.
     // Order of the passed arguments matches what was generated for this kernel.
@@ -476,17 +537,11 @@ WEAK int halide_openglcompute_run(void *user_context, void *state_ptr,
             // TODO(aam): Support types other than int
             int value = *((int *)args[i]);
             global_state.Uniform1i(i, value);
-            if (global_state.CheckAndReportError(user_context, "halide_openglcompute_run Uniform1i")) {
-                return -1;
-            }
         } else {
             uint64_t arg_value = ((halide_buffer_t *)args[i])->device;
 
             GLuint the_buffer = (GLuint)arg_value;
             global_state.BindBufferBase(GL_SHADER_STORAGE_BUFFER, i, the_buffer);
-            if (global_state.CheckAndReportError(user_context, "halide_openglcompute_run BindBufferBase")) {
-                return -1;
-            }
         }
         i++;
     }
@@ -0,0 +1,211 @@
+#include "runtime_internal.h"
+#include "HalideRuntimeNativeBuffer.h"
+#include "native_buffer_utils.h"
+#include "printer.h"
+
+namespace Halide { namespace Runtime { namespace Internal { namespace CVPixelBuffer {
+
+// From CoreVideo/CVPixelBuffer.h
+typedef void *CVPixelBufferRef;
+
+#define FOURCC(a, b, c, d) (((uint32_t)(a) << 24) | ((uint32_t)(b) << 16) | ((uint32_t)(c) << 8) | (uint32_t)(d))
+
+enum {
+    kCVPixelFormatType_24RGB = 0x18,
+    kCVPixelFormatType_32ARGB = 0x20,
+    kCVPixelFormatType_32BGRA = FOURCC('B', 'G', 'R', 'A'),
+    kCVPixelFormatType_32RGBA = FOURCC('R', 'G', 'B', 'A'),
+    kCVPixelFormatType_OneComponent8 = FOURCC('L', '0', '0', '8'),
+    kCVPixelFormatType_OneComponent16Half = FOURCC('L', '0', '0', 'h'),
+    kCVPixelFormatType_64RGBAHalf = FOURCC('R', 'G', 'h', 'A'),
+    kCVPixelFormatType_128RGBAFloat = FOURCC('R', 'G', 'f', 'A'),
+    kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange = FOURCC('4', '2', '0', 'v'),
+    kCVPixelFormatType_420YpCbCr8BiPlanarFullRange = FOURCC('4', '2', '0', 'f'),
+};
+
+#undef FOURCC
+
+// CoreVideo is loaded by any process that has a CVPixelBufferRef to
+// hand us, but pipelines aren't linked against it. Look it up when
+// first used instead.
+typedef int32_t (*lock_fn)(CVPixelBufferRef, uint64_t);
+typedef uint32_t (*get_format_fn)(CVPixelBufferRef);
+typedef unsigned char (*is_planar_fn)(CVPixelBufferRef);
+typedef void *(*get_base_address_fn)(CVPixelBufferRef);
+typedef size_t (*get_size_fn)(CVPixelBufferRef);
+typedef void *(*get_plane_base_address_fn)(CVPixelBufferRef, size_t);
+typedef size_t (*get_plane_size_fn)(CVPixelBufferRef, size_t);
+
+WEAK lock_fn CVPixelBufferLockBaseAddress = NULL;
+WEAK lock_fn CVPixelBufferUnlockBaseAddress = NULL;
+WEAK get_format_fn CVPixelBufferGetPixelFormatType = NULL;
+WEAK is_planar_fn CVPixelBufferIsPlanar = NULL;
+WEAK get_size_fn CVPixelBufferGetPlaneCount = NULL;
+WEAK get_base_address_fn CVPixelBufferGetBaseAddress = NULL;
+WEAK get_size_fn CVPixelBufferGetWidth = NULL;
+WEAK get_size_fn CVPixelBufferGetHeight = NULL;
+WEAK get_size_fn CVPixelBufferGetBytesPerRow = NULL;
+WEAK get_plane_base_address_fn CVPixelBufferGetBaseAddressOfPlane = NULL;
+WEAK get_plane_size_fn CVPixelBufferGetWidthOfPlane = NULL;
+WEAK get_plane_size_fn CVPixelBufferGetHeightOfPlane = NULL;
+WEAK get_plane_size_fn CVPixelBufferGetBytesPerRowOfPlane = NULL;
+
+WEAK void *get_core_video_symbol(const char *name) {
+    void *symbol = halide_get_symbol(name);
+    if (!symbol) {
+        void *lib = halide_load_library("/System/Library/Frameworks/CoreVideo.framework/CoreVideo");
+        if (lib) {
+            symbol = halide_get_library_symbol(lib, name);
+        }
+    }
+    return symbol;
+}
+
+WEAK bool load_core_video(void *user_context) {
+    if (CVPixelBufferGetBytesPerRowOfPlane == NULL) {
+        #define CV_FN(fn, type) fn = (type)get_core_video_symbol(#fn)
+        CV_FN(CVPixelBufferLockBaseAddress, lock_fn);
+        CV_FN(CVPixelBufferUnlockBaseAddress, lock_fn);
+        CV_FN(CVPixelBufferGetPixelFormatType, get_format_fn);
+        CV_FN(CVPixelBufferIsPlanar, is_planar_fn);
+        CV_FN(CVPixelBufferGetPlaneCount, get_size_fn);
+        CV_FN(CVPixelBufferGetBaseAddress, get_base_address_fn);
+        CV_FN(CVPixelBufferGetWidth, get_size_fn);
+        CV_FN(CVPixelBufferGetHeight, get_size_fn);
+        CV_FN(CVPixelBufferGetBytesPerRow, get_size_fn);
+        CV_FN(CVPixelBufferGetBaseAddressOfPlane, get_plane_base_address_fn);
+        CV_FN(CVPixelBufferGetWidthOfPlane, get_plane_size_fn);
+        CV_FN(CVPixelBufferGetHeightOfPlane, get_plane_size_fn);
+        CV_FN(CVPixelBufferGetBytesPerRowOfPlane, get_plane_size_fn);
+        #undef CV_FN
+    }
+    if (CVPixelBufferLockBaseAddress == NULL ||
+        CVPixelBufferUnlockBaseAddress == NULL ||
+        CVPixelBufferGetPixelFormatType == NULL ||
+        CVPixelBufferIsPlanar == NULL ||
+        CVPixelBufferGetPlaneCount == NULL ||
+        CVPixelBufferGetBaseAddress == NULL ||
+        CVPixelBufferGetWidth == NULL ||
+        CVPixelBufferGetHeight == NULL ||
+        CVPixelBufferGetBytesPerRow == NULL ||
+        CVPixelBufferGetBaseAddressOfPlane == NULL ||
+        CVPixelBufferGetWidthOfPlane == NULL ||
+        CVPixelBufferGetHeightOfPlane == NULL ||
+        CVPixelBufferGetBytesPerRowOfPlane == NULL) {
+        error(user_context) << "CoreVideo API not found.\n";
+        return false;
+    }
+    return true;
+}
+
+}}}}  // namespace Halide::Runtime::Internal::CVPixelBuffer
+
+using namespace Halide::Runtime::Internal::CVPixelBuffer;
+
+extern "C" {
+
+WEAK int halide_cv_pixel_buffer_wrap(void *user_context, struct halide_buffer_t *buf,
+                                     void *pixel_buffer, int plane) {
+    debug(user_context)
+        << "halide_cv_pixel_buffer_wrap (user_context: " << user_context
+        << ", buf: " << buf << ", pixel_buffer: " << pixel_buffer
+        << ", plane: " << plane << ")\n";
+
+    if (!load_core_video(user_context)) {
+        return halide_error_code_generic_error;
+    }
+
+    bool planar = CVPixelBufferIsPlanar(pixel_buffer) != 0;
+    int plane_count = planar ? (int)CVPixelBufferGetPlaneCount(pixel_buffer) : 1;
+    if (plane < 0 || plane >= plane_count) {
+        error(user_context) << "CVPixelBuffer has no plane " << plane << ".\n";
+        return halide_error_code_generic_error;
+    }
+
+    uint32_t format = CVPixelBufferGetPixelFormatType(pixel_buffer);
+    halide_type_t type(halide_type_uint, 8);
+    int channels = 0;
+    switch (format) {
+    case kCVPixelFormatType_32ARGB:
+    case kCVPixelFormatType_32BGRA:
+    case kCVPixelFormatType_32RGBA:
+        channels = 4;
+        break;
+    case kCVPixelFormatType_24RGB:
+        channels = 3;
+        break;
+    case kCVPixelFormatType_OneComponent8:
+        channels = 1;
+        break;
+    case kCVPixelFormatType_OneComponent16Half:
+        type = halide_type_t(halide_type_float, 16);
+        channels = 1;
+        break;
+    case kCVPixelFormatType_64RGBAHalf:
+        type = halide_type_t(halide_type_float, 16);
+        channels = 4;
+        break;
+    case kCVPixelFormatType_128RGBAFloat:
+        type = halide_type_t(halide_type_float, 32);
+        channels = 4;
+        break;
+    case kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange:
+    case kCVPixelFormatType_420YpCbCr8BiPlanarFullRange:
+        // Luma, then interleaved CbCr.
+        channels = plane + 1;
+        break;
+    default:
+        error(user_context) << "Can't wrap a CVPixelBuffer of format " << format << ".\n";
+        return halide_error_code_generic_error;
+    }
+
+    // Lock for reading and writing. Locks nest, so each plane may be
+    // locked separately.
+    int32_t err = CVPixelBufferLockBaseAddress(pixel_buffer, 0);
+    if (err != 0) {
+        error(user_context) << "CVPixelBufferLockBaseAddress failed: " << err << "\n";
+        return halide_error_code_generic_error;
+    }
+
+    void *host;
+    size_t width, height, bytes_per_row;
+    if (planar) {
+        host = CVPixelBufferGetBaseAddressOfPlane(pixel_buffer, plane);
+        width = CVPixelBufferGetWidthOfPlane(pixel_buffer, plane);
+        height = CVPixelBufferGetHeightOfPlane(pixel_buffer, plane);
+        bytes_per_row = CVPixelBufferGetBytesPerRowOfPlane(pixel_buffer, plane);
+    } else {
+        host = CVPixelBufferGetBaseAddress(pixel_buffer);
+        width = CVPixelBufferGetWidth(pixel_buffer);
+        height = CVPixelBufferGetHeight(pixel_buffer);
+        bytes_per_row = CVPixelBufferGetBytesPerRow(pixel_buffer);
+    }
+
+    int result = set_image_shape(user_context, buf, host, type, (int)width, (int)height,
+                                 channels, channels, (int)(bytes_per_row / type.bytes()));
+    if (result != 0) {
+        CVPixelBufferUnlockBaseAddress(pixel_buffer, 0);
+    }
+    return result;
+}
+
+WEAK int halide_cv_pixel_buffer_unwrap(void *user_context, struct halide_buffer_t *buf,
+                                       void *pixel_buffer) {
+    debug(user_context)
+        << "halide_cv_pixel_buffer_unwrap (user_context: " << user_context
+        << ", buf: " << buf << ", pixel_buffer: " << pixel_buffer << ")\n";
+
+    if (!load_core_video(user_context)) {
+        return halide_error_code_generic_error;
+    }
+    int result = release_device_over_host(user_context, buf);
+    buf->host = NULL;
+    int32_t err = CVPixelBufferUnlockBaseAddress(pixel_buffer, 0);
+    if (err != 0) {
+        error(user_context) << "CVPixelBufferUnlockBaseAddress failed: " << err << "\n";
+        return halide_error_code_generic_error;
+    }
+    return result;
+}
+
+}  // extern "C"
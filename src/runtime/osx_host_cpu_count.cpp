@@ -8,4 +8,20 @@ WEAK int halide_host_cpu_count() {
     return sysconf(58);
 }
 
+WEAK int halide_set_current_thread_affinity(int cpu) {
+    // OS X and iOS have no way to pin threads to cores.
+    return -1;
+}
+
+WEAK int halide_host_cpu_capacities(int *capacities, int max_cpus) {
+    // Threads can't be pinned to the performance cores of Apple
+    // silicon, so there is nothing to gain from telling them apart.
+    return 0;
+}
+
+WEAK int halide_advise_huge_pages(void *ptr, size_t size) {
+    // Superpages on OS X can only be requested through mmap.
+    return -1;
+}
+
 }
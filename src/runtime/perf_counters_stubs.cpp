@@ -0,0 +1,17 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+
+extern "C" {
+
+WEAK int halide_perf_counters_open(int *fds) {
+    return -1;
+}
+
+WEAK int halide_perf_counters_read(const int *fds, uint64_t *values) {
+    return -1;
+}
+
+WEAK void halide_perf_counters_close(int *fds) {
+}
+
+}
@@ -1,5 +1,16 @@
 #include "HalideRuntime.h"
 #include "runtime_internal.h"
+#include "scoped_spin_lock.h"
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+// Allocations of at least this many bytes are aligned to a huge page
+// boundary and the OS is asked to back them with huge pages. Zero
+// disables this.
+WEAK size_t huge_page_threshold = 0;
+const size_t kHugePageSize = 2 * 1024 * 1024;
+
+}}}
 
 extern "C" {
 
@@ -8,7 +19,12 @@ extern void free(void *);
 
 WEAK void *halide_default_malloc(void *user_context, size_t x) {
     // Allocate enough space for aligning the pointer we return.
-    const size_t alignment = halide_malloc_alignment();
+    size_t alignment = halide_malloc_alignment();
+    const size_t threshold = huge_page_threshold;
+    const bool huge = threshold != 0 && x >= threshold;
+    if (huge) {
+        alignment = kHugePageSize;
+    }
     void *orig = malloc(x + alignment);
     if (orig == NULL) {
         // Will result in a failed assertion and a call to halide_error
@@ -17,9 +33,21 @@ WEAK void *halide_default_malloc(void *user_context, size_t x) {
     // We want to store the original pointer prior to the pointer we return.
     void *ptr = (void *)(((size_t)orig + alignment + sizeof(void*) - 1) & ~(alignment - 1));
     ((void **)ptr)[-1] = orig;
+    if (huge) {
+        // Only whole huge pages can be advised. This is just a hint,
+        // so ignore any failure.
+        size_t huge_bytes = x & ~(kHugePageSize - 1);
+        if (huge_bytes) {
+            halide_advise_huge_pages(ptr, huge_bytes);
+        }
+    }
     return ptr;
 }
 
+WEAK void halide_set_huge_page_threshold(size_t bytes) {
+    huge_page_threshold = bytes;
+}
+
 WEAK void halide_default_free(void *user_context, void *ptr) {
     free(((void**)ptr)[-1]);
 }
@@ -28,8 +56,126 @@ WEAK void halide_default_free(void *user_context, void *ptr) {
 
 namespace Halide { namespace Runtime { namespace Internal {
 
+// A size-class pool for halide_pool_malloc. Requests are rounded up
+// to a power of two, and freed blocks are kept on a free list per
+// size class to be handed out again, so a pipeline that allocates the
+// same intermediates on every call stops going to the system
+// allocator after the first.
+const int kPoolMinClassBits = 6;    // 64 bytes
+const int kPoolMaxClassBits = 26;   // 64 MB. Larger blocks are not pooled.
+const int kPoolNumClasses = kPoolMaxClassBits - kPoolMinClassBits + 1;
+
+struct pool_size_class {
+    // Protects free_list.
+    volatile int lock;
+    void *free_list;
+};
+
+WEAK pool_size_class pool_classes[kPoolNumClasses];
+
+// Total bytes sitting on free lists, and the most we are willing to
+// keep there before handing blocks back to the system.
+WEAK volatile size_t pool_cached_bytes = 0;
+WEAK size_t pool_max_cached_bytes = 256 * 1024 * 1024;
+
+// Each pooled block records its system allocation and its size class
+// in the two words before the pointer handed out.
+WEAK void *pool_system_alloc(size_t x, int size_class) {
+    const size_t alignment = halide_malloc_alignment();
+    void *orig = malloc(x + alignment + 2 * sizeof(void *));
+    if (orig == NULL) {
+        return NULL;
+    }
+    void *ptr = (void *)(((size_t)orig + alignment + 2 * sizeof(void *) - 1) & ~(alignment - 1));
+    ((void **)ptr)[-1] = orig;
+    ((intptr_t *)ptr)[-2] = size_class;
+    return ptr;
+}
+
+WEAK int pool_size_class_for(size_t x) {
+    int bits = kPoolMinClassBits;
+    while (bits <= kPoolMaxClassBits && ((size_t)1 << bits) < x) {
+        bits++;
+    }
+    return bits <= kPoolMaxClassBits ? bits - kPoolMinClassBits : -1;
+}
+
+}}} // namespace Halide::Runtime::Internal
+
+extern "C" {
+
+WEAK void *halide_pool_malloc(void *user_context, size_t x) {
+    int size_class = pool_size_class_for(x);
+    if (size_class < 0) {
+        return pool_system_alloc(x, -1);
+    }
+    pool_size_class &c = pool_classes[size_class];
+    {
+        ScopedSpinLock lock(&c.lock);
+        void *ptr = c.free_list;
+        if (ptr) {
+            c.free_list = *(void **)ptr;
+            __sync_fetch_and_sub(&pool_cached_bytes, (size_t)1 << (size_class + kPoolMinClassBits));
+            return ptr;
+        }
+    }
+    return pool_system_alloc((size_t)1 << (size_class + kPoolMinClassBits), size_class);
+}
+
+WEAK void halide_pool_free(void *user_context, void *ptr) {
+    int size_class = (int)((intptr_t *)ptr)[-2];
+    if (size_class >= 0) {
+        size_t bytes = (size_t)1 << (size_class + kPoolMinClassBits);
+        // Keep the block unless that would take the pool over its
+        // limit.
+        if (__sync_add_and_fetch(&pool_cached_bytes, bytes) <= pool_max_cached_bytes) {
+            pool_size_class &c = pool_classes[size_class];
+            ScopedSpinLock lock(&c.lock);
+            *(void **)ptr = c.free_list;
+            c.free_list = ptr;
+            return;
+        }
+        __sync_fetch_and_sub(&pool_cached_bytes, bytes);
+    }
+    free(((void **)ptr)[-1]);
+}
+
+WEAK void halide_pool_allocator_release(void *user_context) {
+    for (int i = 0; i < kPoolNumClasses; i++) {
+        pool_size_class &c = pool_classes[i];
+        void *ptr;
+        {
+            ScopedSpinLock lock(&c.lock);
+            ptr = c.free_list;
+            c.free_list = NULL;
+        }
+        while (ptr) {
+            void *next = *(void **)ptr;
+            __sync_fetch_and_sub(&pool_cached_bytes, (size_t)1 << (i + kPoolMinClassBits));
+            free(((void **)ptr)[-1]);
+            ptr = next;
+        }
+    }
+}
+
+WEAK void halide_pool_allocator_set_limit(void *user_context, size_t bytes) {
+    pool_max_cached_bytes = bytes;
+    if (pool_cached_bytes > bytes) {
+        halide_pool_allocator_release(user_context);
+    }
+}
+
+}
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+#ifdef HALIDE_POOL_ALLOCATOR_BY_DEFAULT
+WEAK halide_malloc_t custom_malloc = halide_pool_malloc;
+WEAK halide_free_t custom_free = halide_pool_free;
+#else
 WEAK halide_malloc_t custom_malloc = halide_default_malloc;
 WEAK halide_free_t custom_free = halide_default_free;
+#endif
 
 }}} // namespace Halide::Runtime::Internal
 
@@ -1,5 +1,6 @@
 #include "HalideRuntime.h"
 #include "printer.h"
+#include "runtime_internal.h"
 
 extern "C" {
 
@@ -30,6 +31,8 @@ WEAK halide_error_handler_t error_handler = halide_default_error;
 extern "C" {
 
 WEAK void halide_error(void *user_context, const char *msg) {
+    // Dump the trace first, as the handler may not return.
+    halide_trace_ring_buffer_on_error(user_context);
     (*error_handler)(user_context, msg);
 }
 
@@ -1,5 +1,6 @@
 #include "HalideRuntime.h"
 #include "printer.h"
+#include "runtime_internal.h"
 #include "scoped_mutex_lock.h"
 
 // Note: The profiler thread may out-live any valid user_context, or
@@ -16,6 +17,75 @@ WEAK halide_profiler_state *halide_profiler_get_state() {
 
 namespace Halide { namespace Runtime { namespace Internal {
 
+// Latencies are histogrammed into buckets a quarter of an octave
+// wide. The first four buckets hold 0-3ns exactly, and the last one
+// holds everything over about 4.9 hours.
+const int kLatencyBuckets = 176;
+
+WEAK int latency_bucket(uint64_t ns) {
+    if (ns < 4) {
+        return (int)ns;
+    }
+    int log2 = 63 - __builtin_clzll(ns);
+    int sub = (int)((ns >> (log2 - 2)) & 3);
+    int b = 4 * (log2 - 1) + sub;
+    return b < kLatencyBuckets ? b : kLatencyBuckets - 1;
+}
+
+WEAK uint64_t latency_bucket_lower_bound(int b) {
+    if (b < 4) {
+        return (uint64_t)b;
+    }
+    int log2 = b / 4 + 1;
+    return (uint64_t)(4 + b % 4) << (log2 - 2);
+}
+
+// Per-pipeline state for measuring each run, hung off
+// halide_profiler_pipeline_stats::run_info. Allocated as one block,
+// with the arrays following the header.
+struct pipeline_run_info {
+    // When the current run started.
+    uint64_t start_time;
+    // Per-func time billed before the current run started.
+    uint64_t *func_time_at_start;
+    // The pipeline's histogram, then one per func.
+    uint32_t *histograms;
+};
+
+WEAK pipeline_run_info *create_run_info(int num_funcs) {
+    size_t bytes = (sizeof(pipeline_run_info) +
+                    num_funcs * sizeof(uint64_t) +
+                    (num_funcs + 1) * kLatencyBuckets * sizeof(uint32_t));
+    pipeline_run_info *info = (pipeline_run_info *)malloc(bytes);
+    if (!info) return NULL;
+    memset(info, 0, bytes);
+    info->func_time_at_start = (uint64_t *)(info + 1);
+    info->histograms = (uint32_t *)(info->func_time_at_start + num_funcs);
+    return info;
+}
+
+// Per-thread slots for the tasks of parallel loops, each holding the
+// id of the func its task is in. A task holds a slot from start to
+// end (see halide_profiler_acquire_thread_slot). Like current_func,
+// they are written by tasks and read by the profiler thread without
+// any locking.
+const int kMaxThreadSlots = 256;
+WEAK int thread_slot_func[kMaxThreadSlots];
+WEAK int thread_slot_in_use[kMaxThreadSlots];
+// One more than the highest slot ever taken.
+WEAK int thread_slots_high_water = 0;
+// The number of slots taken, and the most ever taken at once, as an
+// estimate of how many threads are available to run tasks.
+WEAK int thread_slots_taken = 0;
+WEAK int thread_slots_peak = 0;
+
+// The pipelines currently running, innermost last, so that
+// halide_profiler_pipeline_end knows which one finished. Guarded by
+// the profiler state's lock.
+const int kMaxRunningPipelines = 16;
+WEAK halide_profiler_pipeline_stats *running_pipelines[kMaxRunningPipelines];
+WEAK int num_running_pipelines = 0;
+
 WEAK halide_profiler_pipeline_stats *find_or_create_pipeline(const char *pipeline_name, int num_funcs, const uint64_t *func_names) {
     halide_profiler_state *s = halide_profiler_get_state();
 
@@ -45,8 +115,20 @@ WEAK halide_profiler_pipeline_stats *find_or_create_pipeline(const char *pipelin
     p->num_allocs = 0;
     p->active_threads_numerator = 0;
     p->active_threads_denominator = 0;
+    p->thread_time = 0;
+    p->idle_time = 0;
+    p->wait_time = 0;
+    p->cycles = 0;
+    p->instructions = 0;
+    p->cache_misses = 0;
+    p->run_info = create_run_info(num_funcs);
+    if (!p->run_info) {
+        free(p);
+        return NULL;
+    }
     p->funcs = (halide_profiler_func_stats *)malloc(num_funcs * sizeof(halide_profiler_func_stats));
     if (!p->funcs) {
+        free(p->run_info);
         free(p);
         return NULL;
     }
@@ -60,13 +142,18 @@ WEAK halide_profiler_pipeline_stats *find_or_create_pipeline(const char *pipelin
         p->funcs[i].stack_peak = 0;
         p->funcs[i].active_threads_numerator = 0;
         p->funcs[i].active_threads_denominator = 0;
+        p->funcs[i].thread_time = 0;
+        p->funcs[i].cycles = 0;
+        p->funcs[i].instructions = 0;
+        p->funcs[i].cache_misses = 0;
     }
     s->first_free_id += num_funcs;
     s->pipelines = p;
     return p;
 }
 
-WEAK void bill_func(halide_profiler_state *s, int func_id, uint64_t time, int active_threads) {
+WEAK void bill_func(halide_profiler_state *s, int func_id, uint64_t time, int active_threads,
+                    bool new_sample = true) {
     halide_profiler_pipeline_stats *p_prev = NULL;
     for (halide_profiler_pipeline_stats *p = s->pipelines; p;
          p = (halide_profiler_pipeline_stats *)(p->next)) {
@@ -82,9 +169,11 @@ WEAK void bill_func(halide_profiler_state *s, int func_id, uint64_t time, int ac
             f->active_threads_numerator += active_threads;
             f->active_threads_denominator += 1;
             p->time += time;
-            p->samples++;
-            p->active_threads_numerator += active_threads;
-            p->active_threads_denominator += 1;
+            if (new_sample) {
+                p->samples++;
+                p->active_threads_numerator += active_threads;
+                p->active_threads_denominator += 1;
+            }
             return;
         }
         p_prev = p;
@@ -92,6 +181,366 @@ WEAK void bill_func(halide_profiler_state *s, int func_id, uint64_t time, int ac
     // Someone must have called reset_state while a kernel was running. Do nothing.
 }
 
+WEAK halide_profiler_pipeline_stats *find_pipeline(halide_profiler_state *s, int func_id) {
+    for (halide_profiler_pipeline_stats *p = s->pipelines; p;
+         p = (halide_profiler_pipeline_stats *)(p->next)) {
+        if (func_id >= p->first_func_id && func_id < p->first_func_id + p->num_funcs) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+WEAK void bill_thread_time(halide_profiler_state *s, int func_id, uint64_t time) {
+    halide_profiler_pipeline_stats *p = find_pipeline(s, func_id);
+    if (p) {
+        p->funcs[func_id - p->first_func_id].thread_time += time;
+        p->thread_time += time;
+    }
+}
+
+// Bill a sample of the given length, for a pipeline whose calling
+// thread is in func_id. While tasks of parallel loops are running, the
+// wall clock time is shared between the funcs they are in, and each of
+// their threads is billed the time to its own func. Threads not
+// running a task (up to the most tasks ever seen running at once),
+// and tasks waiting on nested parallel loops, are billed as idle and
+// waiting time.
+WEAK void bill_threads(halide_profiler_state *s, int func_id, uint64_t time, int active_threads) {
+    int busy[kMaxThreadSlots];
+    int num_busy = 0, num_waiting = 0;
+    int high_water = thread_slots_high_water;
+    for (int i = 0; i < high_water; i++) {
+        if (!thread_slot_in_use[i]) continue;
+        int f = thread_slot_func[i];
+        if (f >= 0) {
+            busy[num_busy++] = f;
+        } else if (f == halide_profiler_waiting_for_tasks) {
+            num_waiting++;
+        }
+    }
+
+    if (num_busy == 0) {
+        bill_func(s, func_id, time, active_threads);
+        bill_thread_time(s, func_id, time);
+    } else {
+        uint64_t remainder = time % num_busy;
+        for (int i = 0; i < num_busy; i++) {
+            uint64_t share = time / num_busy + (i < (int)remainder ? 1 : 0);
+            bill_func(s, busy[i], share, active_threads, i == 0);
+            bill_thread_time(s, busy[i], time);
+        }
+    }
+
+    if (num_busy + num_waiting > 0) {
+        halide_profiler_pipeline_stats *p = find_pipeline(s, func_id);
+        int idle = thread_slots_peak - num_busy - num_waiting;
+        if (p) {
+            p->wait_time += num_waiting * time;
+            p->idle_time += (idle > 0 ? idle : 0) * time;
+        }
+    }
+}
+
+// Hardware performance counters are opened on the thread that starts
+// the outermost pipeline, if HL_PROFILER_PERF_COUNTERS is set. They
+// are read at every sample and at pipeline start and end, and each
+// delta is billed to the func running at the time, like time. All of
+// these are guarded by the profiler state's lock.
+WEAK int perf_counters_wanted = -1;
+WEAK int perf_counters_depth = 0;
+WEAK bool perf_counters_are_open = false;
+WEAK int perf_counter_fds[3];
+WEAK uint64_t perf_counter_last[3];
+
+WEAK void bill_perf_counters(halide_profiler_state *s, int func_id, const uint64_t *deltas) {
+    for (halide_profiler_pipeline_stats *p = s->pipelines; p;
+         p = (halide_profiler_pipeline_stats *)(p->next)) {
+        if (func_id >= p->first_func_id && func_id < p->first_func_id + p->num_funcs) {
+            halide_profiler_func_stats *f = p->funcs + func_id - p->first_func_id;
+            f->cycles += deltas[0];
+            f->instructions += deltas[1];
+            f->cache_misses += deltas[2];
+            p->cycles += deltas[0];
+            p->instructions += deltas[1];
+            p->cache_misses += deltas[2];
+            return;
+        }
+    }
+}
+
+WEAK void sample_perf_counters(halide_profiler_state *s, int func_id) {
+    if (!perf_counters_are_open) {
+        return;
+    }
+    uint64_t now[3];
+    if (halide_perf_counters_read(perf_counter_fds, now) != 0) {
+        return;
+    }
+    uint64_t deltas[3];
+    for (int i = 0; i < 3; i++) {
+        deltas[i] = now[i] - perf_counter_last[i];
+        perf_counter_last[i] = now[i];
+    }
+    if (func_id >= 0) {
+        bill_perf_counters(s, func_id, deltas);
+    }
+}
+
+// Called with the lock held at the end of each run of a pipeline.
+WEAK void record_run(halide_profiler_pipeline_stats *p, uint64_t end_time) {
+    pipeline_run_info *info = (pipeline_run_info *)(p->run_info);
+    uint64_t latency = end_time > info->start_time ? end_time - info->start_time : 0;
+    info->histograms[latency_bucket(latency)]++;
+    for (int i = 0; i < p->num_funcs; i++) {
+        uint64_t t = p->funcs[i].time - info->func_time_at_start[i];
+        // Only count the runs in which the func was sampled.
+        if (t) {
+            info->histograms[(i + 1) * kLatencyBuckets + latency_bucket(t)]++;
+        }
+    }
+}
+
+// Writes JSON into a fixed-size buffer, keeping track of how long
+// the output would have been if it had fit.
+class JSONWriter {
+    char *buf;
+    size_t size, length;
+    bool need_comma;
+
+    void put(char c) {
+        if (length + 1 < size) {
+            buf[length] = c;
+        }
+        length++;
+    }
+
+    void separate() {
+        if (need_comma) {
+            put(',');
+        }
+        need_comma = true;
+    }
+
+public:
+    JSONWriter(char *buf, size_t size) :
+        buf(buf), size(buf ? size : 0), length(0), need_comma(false) {}
+
+    void raw(const char *str) {
+        while (*str) {
+            put(*str++);
+        }
+    }
+
+    void begin_object() {
+        separate();
+        put('{');
+        need_comma = false;
+    }
+
+    void end_object() {
+        put('}');
+        need_comma = true;
+    }
+
+    void begin_array() {
+        separate();
+        put('[');
+        need_comma = false;
+    }
+
+    void end_array() {
+        put(']');
+        need_comma = true;
+    }
+
+    void key(const char *name) {
+        separate();
+        string(name);
+        put(':');
+        need_comma = false;
+    }
+
+    void string(const char *str) {
+        separate();
+        put('"');
+        for (; *str; str++) {
+            char c = *str;
+            if (c == '"' || c == '\\') {
+                put('\\');
+                put(c);
+            } else if ((unsigned char)c < 0x20) {
+                // Names shouldn't have control characters, but don't
+                // produce invalid output if they do.
+                put(' ');
+            } else {
+                put(c);
+            }
+        }
+        put('"');
+    }
+
+    void number(uint64_t val) {
+        separate();
+        char tmp[32];
+        halide_uint64_to_string(tmp, tmp + sizeof(tmp), val, 1);
+        raw(tmp);
+    }
+
+    void number(double val) {
+        separate();
+        char tmp[64];
+        halide_double_to_string(tmp, tmp + sizeof(tmp), val, 0);
+        raw(tmp);
+    }
+
+    // Null-terminates the output, and returns its full length.
+    int finish() {
+        if (size) {
+            buf[length < size ? length : size - 1] = 0;
+        }
+        return (int)length;
+    }
+};
+
+WEAK void write_latency_json(JSONWriter &w, const uint32_t *histogram) {
+    uint64_t count = 0;
+    for (int b = 0; b < kLatencyBuckets; b++) {
+        count += histogram[b];
+    }
+    w.key("latency_ns");
+    w.begin_object();
+    w.key("count");
+    w.number(count);
+
+    // Report the midpoint of the bucket each percentile falls in.
+    const int percentiles[] = {50, 90, 99};
+    const char *names[] = {"p50", "p90", "p99"};
+    for (int i = 0; i < 3 && count; i++) {
+        uint64_t seen = 0;
+        for (int b = 0; b < kLatencyBuckets; b++) {
+            seen += histogram[b];
+            if (seen * 100 >= percentiles[i] * count) {
+                uint64_t lo = latency_bucket_lower_bound(b);
+                uint64_t hi = b + 1 < kLatencyBuckets ? latency_bucket_lower_bound(b + 1) : lo;
+                w.key(names[i]);
+                w.number(lo + (hi - lo) / 2);
+                break;
+            }
+        }
+    }
+
+    // Sparse, as [lower bound, count] pairs.
+    w.key("histogram");
+    w.begin_array();
+    for (int b = 0; b < kLatencyBuckets; b++) {
+        if (histogram[b]) {
+            w.begin_array();
+            w.number(latency_bucket_lower_bound(b));
+            w.number((uint64_t)histogram[b]);
+            w.end_array();
+        }
+    }
+    w.end_array();
+    w.end_object();
+}
+
+WEAK void write_perf_counters_json(JSONWriter &w, uint64_t cycles, uint64_t instructions, uint64_t cache_misses) {
+    if (!cycles) return;
+    w.key("cycles");
+    w.number(cycles);
+    w.key("instructions");
+    w.number(instructions);
+    w.key("llc_misses");
+    w.number(cache_misses);
+}
+
+WEAK int profiler_report_json_unlocked(halide_profiler_state *s, char *buf, size_t size) {
+    JSONWriter w(buf, size);
+    w.begin_object();
+    w.key("pipelines");
+    w.begin_array();
+    for (halide_profiler_pipeline_stats *p = s->pipelines; p;
+         p = (halide_profiler_pipeline_stats *)(p->next)) {
+        if (!p->runs) continue;
+        const uint32_t *histograms = ((pipeline_run_info *)(p->run_info))->histograms;
+        w.begin_object();
+        w.key("name");
+        w.string(p->name);
+        w.key("runs");
+        w.number((uint64_t)p->runs);
+        w.key("samples");
+        w.number((uint64_t)p->samples);
+        w.key("time_ns");
+        w.number(p->time);
+        w.key("average_threads");
+        w.number(p->active_threads_denominator ?
+                 (double)p->active_threads_numerator / p->active_threads_denominator : 0.0);
+        w.key("thread_time_ns");
+        w.number(p->thread_time);
+        w.key("idle_time_ns");
+        w.number(p->idle_time);
+        w.key("wait_time_ns");
+        w.number(p->wait_time);
+        w.key("heap_allocations");
+        w.number((uint64_t)p->num_allocs);
+        w.key("memory_peak");
+        w.number(p->memory_peak);
+        w.key("memory_total");
+        w.number(p->memory_total);
+        write_perf_counters_json(w, p->cycles, p->instructions, p->cache_misses);
+        write_latency_json(w, histograms);
+
+        w.key("funcs");
+        w.begin_array();
+        for (int i = 0; i < p->num_funcs; i++) {
+            halide_profiler_func_stats *fs = p->funcs + i;
+            w.begin_object();
+            w.key("name");
+            w.string(fs->name);
+            w.key("time_ns");
+            w.number(fs->time);
+            w.key("average_threads");
+            w.number(fs->active_threads_denominator ?
+                     (double)fs->active_threads_numerator / fs->active_threads_denominator : 0.0);
+            w.key("thread_time_ns");
+            w.number(fs->thread_time);
+            w.key("heap_allocations");
+            w.number((uint64_t)fs->num_allocs);
+            w.key("memory_peak");
+            w.number(fs->memory_peak);
+            w.key("memory_total");
+            w.number(fs->memory_total);
+            w.key("stack_peak");
+            w.number(fs->stack_peak);
+            write_perf_counters_json(w, fs->cycles, fs->instructions, fs->cache_misses);
+            write_latency_json(w, histograms + (i + 1) * kLatencyBuckets);
+            w.end_object();
+        }
+        w.end_array();
+        w.end_object();
+    }
+    w.end_array();
+    w.end_object();
+    return w.finish();
+}
+
+// Called at process exit.
+WEAK void write_json_report_file(halide_profiler_state *s) {
+    const char *path = getenv("HL_PROFILER_JSON_FILE");
+    if (!path || !*path) return;
+    int length = profiler_report_json_unlocked(s, NULL, 0);
+    char *buf = (char *)malloc(length + 1);
+    if (!buf) return;
+    profiler_report_json_unlocked(s, buf, length + 1);
+    void *f = fopen(path, "wb");
+    if (f) {
+        fwrite(buf, 1, length, f);
+        fclose(f);
+    }
+    free(buf);
+}
+
 WEAK void sampling_profiler_thread(void *) {
     halide_profiler_state *s = halide_profiler_get_state();
 
@@ -117,8 +566,15 @@ WEAK void sampling_profiler_thread(void *) {
                 break;
             } else if (func >= 0) {
                 // Assume all time since I was last awake is due to
-                // the currently running func.
-                bill_func(s, func, t_now - t, active_threads);
+                // the currently running func, or funcs.
+                if (s->get_remote_profiler_state) {
+                    bill_func(s, func, t_now - t, active_threads);
+                } else {
+                    bill_threads(s, func, t_now - t, active_threads);
+                }
+            }
+            if (!s->get_remote_profiler_state) {
+                sample_perf_counters(s, func);
             }
             t = t_now;
 
@@ -169,6 +625,34 @@ WEAK halide_profiler_pipeline_stats *halide_profiler_get_pipeline_state(const ch
     return NULL;
 }
 
+// Take a per-thread slot for a task of a parallel loop, which starts
+// in the given func. Returns a pointer to the slot, for the task to
+// pass to halide_profiler_set_current_func, or if there are no free
+// slots, to the pipeline's current func.
+WEAK int *halide_profiler_acquire_thread_slot(halide_profiler_state *s, int func) {
+    for (int i = 0; i < kMaxThreadSlots; i++) {
+        if (!thread_slot_in_use[i] &&
+            __sync_bool_compare_and_swap(&thread_slot_in_use[i], 0, 1)) {
+            thread_slot_func[i] = func;
+            sync_compare_max_and_swap(&thread_slots_high_water, i + 1);
+            sync_compare_max_and_swap(&thread_slots_peak, __sync_add_and_fetch(&thread_slots_taken, 1));
+            return &thread_slot_func[i];
+        }
+    }
+    return &(s->current_func);
+}
+
+WEAK int halide_profiler_release_thread_slot(halide_profiler_state *s, int *slot) {
+    if (slot != &(s->current_func)) {
+        // Leave the slot looking unused before freeing it, so the
+        // profiler thread doesn't bill a stale func.
+        *(volatile int *)slot = halide_profiler_outside_of_halide;
+        __sync_lock_release(&thread_slot_in_use[slot - thread_slot_func]);
+        __sync_sub_and_fetch(&thread_slots_taken, 1);
+    }
+    return 0;
+}
+
 // Returns a token identifying this pipeline instance.
 WEAK int halide_profiler_pipeline_start(void *user_context,
                                         const char *pipeline_name,
@@ -191,6 +675,34 @@ WEAK int halide_profiler_pipeline_start(void *user_context,
     }
     p->runs++;
 
+    pipeline_run_info *info = (pipeline_run_info *)(p->run_info);
+    for (int i = 0; i < p->num_funcs; i++) {
+        info->func_time_at_start[i] = p->funcs[i].time;
+    }
+    info->start_time = halide_current_time_ns(user_context);
+    if (num_running_pipelines < kMaxRunningPipelines) {
+        running_pipelines[num_running_pipelines] = p;
+    }
+    num_running_pipelines++;
+
+    if (perf_counters_wanted < 0) {
+        const char *env = getenv("HL_PROFILER_PERF_COUNTERS");
+        perf_counters_wanted = (env && atoi(env)) ? 1 : 0;
+    }
+    if (perf_counters_wanted) {
+        if (perf_counters_depth++ == 0) {
+            perf_counters_are_open = (halide_perf_counters_open(perf_counter_fds) == 0);
+            if (perf_counters_are_open) {
+                // Establish the baseline.
+                sample_perf_counters(s, halide_profiler_outside_of_halide);
+            }
+        } else {
+            // A pipeline called from inside another one, e.g. by an
+            // extern stage. Bill what has happened so far to the caller.
+            sample_perf_counters(s, s->current_func);
+        }
+    }
+
     return p->first_func_id;
 }
 
@@ -304,8 +816,29 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
         if (!serial) {
             sstr << " average threads used: " << threads << "\n";
         }
+        if (p->idle_time || p->wait_time) {
+            // Time summed over threads, per run.
+            float runs_ms = p->runs * 1000000.0f;
+            uint64_t all_threads = p->thread_time + p->idle_time + p->wait_time;
+            sstr << " thread time/run: " << p->thread_time / runs_ms << " ms"
+                 << "  idle/run: " << p->idle_time / runs_ms << " ms"
+                 << " (" << (int)((100 * p->idle_time) / all_threads) << "%)"
+                 << "  waiting on nested tasks/run: " << p->wait_time / runs_ms << " ms\n";
+        }
         sstr << " heap allocations: " << p->num_allocs
              << "  peak heap usage: " << p->memory_peak << " bytes\n";
+        if (p->cycles) {
+            sstr << " cycles: " << p->cycles;
+            // Counts from a simulator may come without instructions
+            // or cache misses.
+            if (p->instructions) {
+                float ipc = p->instructions / (float)p->cycles;
+                sstr << "  instructions: " << p->instructions
+                     << "  ipc: " << ipc
+                     << "  llc misses: " << p->cache_misses;
+            }
+            sstr << "\n";
+        }
         halide_print(user_context, sstr.str());
 
         bool print_f_states = p->time || p->memory_total;
@@ -355,6 +888,13 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
                     sstr.erase(3);
                     cursor += 15;
                     while (sstr.size() < cursor) sstr << " ";
+
+                    float tt = fs->thread_time / (p->runs * 1000000.0f);
+                    sstr << "thread time: " << tt;
+                    sstr.erase(3);
+                    sstr << "ms";
+                    cursor += 22;
+                    while (sstr.size() < cursor) sstr << " ";
                 }
 
                 int alloc_avg = 0;
@@ -374,6 +914,21 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
                 if (fs->stack_peak > 0) {
                     sstr << " stack: " << fs->stack_peak;
                 }
+                if (fs->cycles && !fs->instructions) {
+                    sstr << " cycles: " << fs->cycles;
+                } else if (fs->cycles) {
+                    float ipc = fs->instructions / (float)fs->cycles;
+                    sstr << " ipc: " << ipc;
+                    sstr.erase(3);
+                    // Each last-level cache miss moves a 64-byte line
+                    // from memory. Time is in nanoseconds.
+                    uint64_t mb_per_s = 0;
+                    if (fs->time) {
+                        mb_per_s = (uint64_t)((fs->cache_misses * 64.0 * 1000.0) / fs->time);
+                    }
+                    sstr << " llc misses: " << fs->cache_misses
+                         << " (~" << mb_per_s << " MB/s)";
+                }
                 sstr << "\n";
 
                 halide_print(user_context, sstr.str());
@@ -382,6 +937,14 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
     }
 }
 
+WEAK void halide_profiler_add_perf_counters(void *user_context, int func_id, uint64_t cycles,
+                                            uint64_t instructions, uint64_t cache_misses) {
+    halide_profiler_state *s = halide_profiler_get_state();
+    ScopedMutexLock lock(&s->lock);
+    uint64_t deltas[3] = {cycles, instructions, cache_misses};
+    bill_perf_counters(s, func_id, deltas);
+}
+
 WEAK void halide_profiler_report(void *user_context) {
     halide_profiler_state *s = halide_profiler_get_state();
     ScopedMutexLock lock(&s->lock);
@@ -389,14 +952,22 @@ WEAK void halide_profiler_report(void *user_context) {
 }
 
 
+WEAK int halide_profiler_report_json(void *user_context, char *buf, size_t size) {
+    halide_profiler_state *s = halide_profiler_get_state();
+    ScopedMutexLock lock(&s->lock);
+    return profiler_report_json_unlocked(s, buf, size);
+}
+
 WEAK void halide_profiler_reset_unlocked(halide_profiler_state *s) {
     while (s->pipelines) {
         halide_profiler_pipeline_stats *p = s->pipelines;
         s->pipelines = (halide_profiler_pipeline_stats *)(p->next);
         free(p->funcs);
+        free(p->run_info);
         free(p);
     }
     s->first_free_id = 0;
+    num_running_pipelines = 0;
 }
 
 WEAK void halide_profiler_reset() {
@@ -426,6 +997,7 @@ WEAK void halide_profiler_shutdown() {
     // Print results. No need to lock anything because we just shut
     // down the thread.
     halide_profiler_report_unlocked(NULL, s);
+    write_json_report_file(s);
 
     halide_profiler_reset_unlocked(s);
 }
@@ -448,12 +1020,39 @@ WEAK void halide_windows_profiler_shutdown() {
     // Print results. Avoid locking as it will cause problems and
     // nothing should be running.
     halide_profiler_report_unlocked(NULL, s);
+    write_json_report_file(s);
 }
 #endif
 }
 
 WEAK void halide_profiler_pipeline_end(void *user_context, void *state) {
-    ((halide_profiler_state *)state)->current_func = halide_profiler_outside_of_halide;
+    halide_profiler_state *s = (halide_profiler_state *)state;
+    {
+        ScopedMutexLock lock(&s->lock);
+        if (perf_counters_depth) {
+            sample_perf_counters(s, s->current_func);
+            if (--perf_counters_depth == 0 && perf_counters_are_open) {
+                halide_perf_counters_close(perf_counter_fds);
+                perf_counters_are_open = false;
+            }
+        }
+        if (num_running_pipelines > 0) {
+            num_running_pipelines--;
+            if (num_running_pipelines < kMaxRunningPipelines) {
+                record_run(running_pipelines[num_running_pipelines],
+                           halide_current_time_ns(user_context));
+            }
+        }
+        if (num_running_pipelines == 0) {
+            // Tasks that failed never released their slots.
+            for (int i = 0; i < thread_slots_high_water; i++) {
+                thread_slot_func[i] = halide_profiler_outside_of_halide;
+                thread_slot_in_use[i] = 0;
+            }
+            thread_slots_taken = 0;
+        }
+    }
+    s->current_func = halide_profiler_outside_of_halide;
 }
 
 } // extern "C"
@@ -2,10 +2,13 @@
 
 extern "C" {
 
-WEAK __attribute__((always_inline)) int halide_profiler_set_current_func(halide_profiler_state *state, int tok, int t) {
+// Tasks of parallel loops pass the per-thread slot they got from
+// halide_profiler_acquire_thread_slot as thread_func, and everything
+// else passes NULL to set the pipeline's current func.
+WEAK __attribute__((always_inline)) int halide_profiler_set_current_func(halide_profiler_state *state, int tok, int t, int *thread_func) {
     // Use empty volatile asm blocks to prevent code motion. Otherwise
     // llvm reorders or elides the stores.
-    volatile int *ptr = &(state->current_func);
+    volatile int *ptr = thread_func ? thread_func : &(state->current_func);
     asm volatile ("":::);
     *ptr = tok + t;
     asm volatile ("":::);
@@ -1,4 +1,4 @@
-#include "HalideRuntime.h"
+#include "HalideRuntimeQurt.h"
 
 extern "C" {
 
@@ -120,3 +120,66 @@ WEAK void halide_free(void *user_context, void *ptr) {
 }
 
 }
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+// The HAP VTCM manager only exists on Hexagon v65 and later, so its
+// entry points are looked up when first needed rather than linked
+// against, which would keep pipelines from loading on older DSPs.
+typedef void *(*request_vtcm_fn)(unsigned int size, unsigned int single_page_flag);
+typedef int (*release_vtcm_fn)(void *ptr);
+
+WEAK request_vtcm_fn request_vtcm = NULL;
+WEAK release_vtcm_fn release_vtcm = NULL;
+WEAK int vtcm_looked_up = 0;
+
+// The live VTCM allocations, so that halide_vtcm_free can tell them
+// apart from the heap allocations made when VTCM was unavailable.
+static const int max_vtcm_allocations = 16;
+WEAK void *vtcm_allocations[max_vtcm_allocations] = { NULL, };
+
+}}} // namespace Halide::Runtime::Internal
+
+extern "C" {
+
+WEAK void *halide_vtcm_malloc(void *user_context, size_t size) {
+    if (!vtcm_looked_up) {
+        request_vtcm = (request_vtcm_fn)halide_get_symbol("HAP_request_VTCM");
+        release_vtcm = (release_vtcm_fn)halide_get_symbol("HAP_release_VTCM");
+        vtcm_looked_up = 1;
+    }
+
+    if (request_vtcm && release_vtcm) {
+        for (int i = 0; i < max_vtcm_allocations; ++i) {
+            if (__sync_val_compare_and_swap(vtcm_allocations + i, NULL, (void *)1) == NULL) {
+                // Ask for a single page, so the allocation is contiguous
+                // and covered by one TLB entry.
+                void *ptr = request_vtcm(size, 1);
+                if (ptr == NULL) {
+                    vtcm_allocations[i] = NULL;
+                    break;
+                }
+                vtcm_allocations[i] = ptr;
+                return ptr;
+            }
+        }
+    }
+
+    return halide_malloc(user_context, size);
+}
+
+WEAK void halide_vtcm_free(void *user_context, void *ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+    for (int i = 0; i < max_vtcm_allocations; ++i) {
+        if (vtcm_allocations[i] == ptr) {
+            release_vtcm(ptr);
+            vtcm_allocations[i] = NULL;
+            return;
+        }
+    }
+    halide_free(user_context, ptr);
+}
+
+}
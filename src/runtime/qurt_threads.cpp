@@ -32,6 +32,16 @@ int halide_host_cpu_count() {
     return 4;
 }
 
+WEAK int halide_set_current_thread_affinity(int cpu) {
+    // Hardware threads on Hexagon are scheduled by QuRT.
+    return -1;
+}
+
+WEAK int halide_host_cpu_capacities(int *capacities, int max_cpus) {
+    // The hardware threads are all alike.
+    return 0;
+}
+
 #define STACK_SIZE 256*1024
 
 WEAK struct halide_thread *halide_spawn_thread(void (*f)(void *), void *closure) {
@@ -113,4 +123,6 @@ struct thread_parker {
 
 #include "synchronization_common.h"
 
+// Traces of the thread pool can't be written to a file on the DSP.
+#define HALIDE_THREAD_POOL_NO_TRACE_FILE
 #include "thread_pool_common.h"
@@ -0,0 +1,15 @@
+#include "HalideRuntime.h"
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+WEAK CpuFeatures halide_get_cpu_features() {
+    // The V extension is the riscv_v feature, which is numbered past
+    // the features the runtime can check, so it is only detected by
+    // the compiler for host targets.
+    const uint64_t known = 0;
+    const uint64_t available = 0;
+    CpuFeatures features = {known, available};
+    return features;
+}
+
+}}} // namespace Halide::Runtime::Internal
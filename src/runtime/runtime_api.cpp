@@ -4,7 +4,9 @@
 #include "HalideRuntimeOpenGLCompute.h"
 #include "HalideRuntimeOpenCL.h"
 #include "HalideRuntimeMetal.h"
+#include "HalideRuntimeHexagonDma.h"
 #include "HalideRuntimeHexagonHost.h"
+#include "HalideRuntimeNativeBuffer.h"
 #include "HalideRuntimeQurt.h"
 
 // This runtime module will contain extern declarations of the Halide
@@ -15,9 +17,14 @@
 // cat src/runtime/runtime_internal.h src/runtime/HalideRuntime*.h | grep "^[^ ][^(]*halide_[^ ]*(" | grep -v '#define' | sed "s/[^(]*halide/halide/" | sed "s/(.*//" | sed "s/^h/    \(void *)\&h/" | sed "s/$/,/" | sort | uniq
 
 extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
+    (void *)&halide_android_hardware_buffer_unwrap,
+    (void *)&halide_android_hardware_buffer_unwrap_yuv,
+    (void *)&halide_android_hardware_buffer_wrap,
+    (void *)&halide_android_hardware_buffer_wrap_yuv,
     (void *)&halide_buffer_copy,
     (void *)&halide_buffer_to_string,
     (void *)&halide_can_use_target_features,
+    (void *)&halide_clear_gpu_device_for_user_context,
     (void *)&halide_cond_broadcast,
     (void *)&halide_cond_signal,
     (void *)&halide_cond_wait,
@@ -26,14 +33,22 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_copy_to_host,
     (void *)&halide_copy_to_host_legacy,
     (void *)&halide_create_temp_file,
+    (void *)&halide_cuda_begin_graph,
     (void *)&halide_cuda_detach_device_ptr,
     (void *)&halide_cuda_device_interface,
+    (void *)&halide_cuda_end_graph,
     (void *)&halide_cuda_get_device_ptr,
     (void *)&halide_cuda_initialize_kernels,
+    (void *)&halide_cuda_release_unused_device_allocations,
     (void *)&halide_cuda_run,
+    (void *)&halide_cuda_set_async_mode,
+    (void *)&halide_cuda_set_managed_memory_mode,
     (void *)&halide_cuda_wrap_device_ptr,
     (void *)&halide_current_time_ns,
+    (void *)&halide_cv_pixel_buffer_unwrap,
+    (void *)&halide_cv_pixel_buffer_wrap,
     (void *)&halide_debug_to_file,
+    (void *)&halide_debug_to_file_flush,
     (void *)&halide_default_can_use_target_features,
     (void *)&halide_device_and_host_free,
     (void *)&halide_device_and_host_free_as_destructor,
@@ -52,6 +67,7 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_double_to_string,
     (void *)&halide_downgrade_buffer_t,
     (void *)&halide_downgrade_buffer_t_device_fields,
+    (void *)&halide_dump_trace_ring_buffer,
     (void *)&halide_error,
     (void *)&halide_error_access_out_of_bounds,
     (void *)&halide_error_bad_fold,
@@ -85,17 +101,26 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_get_cpu_features,
     (void *)&halide_get_gpu_device,
     (void *)&halide_get_library_symbol,
+    (void *)&halide_get_num_threads,
     (void *)&halide_get_symbol,
     (void *)&halide_get_trace_file,
     (void *)&halide_hexagon_detach_device_handle,
     (void *)&halide_hexagon_device_interface,
     (void *)&halide_hexagon_device_release,
+    (void *)&halide_hexagon_dma_allocate_engine,
+    (void *)&halide_hexagon_dma_deallocate_engine,
+    (void *)&halide_hexagon_dma_device_detach_native,
+    (void *)&halide_hexagon_dma_device_interface,
+    (void *)&halide_hexagon_dma_device_wrap_native,
+    (void *)&halide_hexagon_dma_prepare_for_copy_to_host,
+    (void *)&halide_hexagon_dma_unprepare,
     (void *)&halide_hexagon_get_device_handle,
     (void *)&halide_hexagon_get_device_size,
     (void *)&halide_hexagon_initialize_kernels,
     (void *)&halide_hexagon_power_hvx_off,
     (void *)&halide_hexagon_power_hvx_off_as_destructor,
     (void *)&halide_hexagon_power_hvx_on,
+    (void *)&halide_hexagon_release_unused_device_allocations,
     (void *)&halide_hexagon_run,
     (void *)&halide_hexagon_set_performance,
     (void *)&halide_hexagon_set_performance_mode,
@@ -106,6 +131,7 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_malloc,
     (void *)&halide_matlab_call_pipeline,
     (void *)&halide_memoization_cache_cleanup,
+    (void *)&halide_memoization_cache_hash_buffer,
     (void *)&halide_memoization_cache_lookup,
     (void *)&halide_memoization_cache_release,
     (void *)&halide_memoization_cache_set_size,
@@ -118,7 +144,9 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_metal_initialize_kernels,
     (void *)&halide_metal_release_context,
     (void *)&halide_metal_run,
+    (void *)&halide_metal_set_batch_mode,
     (void *)&halide_metal_wrap_buffer,
+    (void *)&halide_metal_wrap_host_memory,
     (void *)&halide_msan_annotate_buffer_is_initialized,
     (void *)&halide_msan_annotate_buffer_is_initialized_as_destructor,
     (void *)&halide_msan_annotate_memory_is_initialized,
@@ -128,13 +156,19 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_opencl_device_interface,
     (void *)&halide_opencl_get_cl_mem,
     (void *)&halide_opencl_get_device_type,
+    (void *)&halide_opencl_get_out_of_order_queue,
     (void *)&halide_opencl_get_platform_name,
+    (void *)&halide_opencl_get_program_cache_dir,
     (void *)&halide_opencl_get_crop_offset,
     (void *)&halide_opencl_initialize_kernels,
+    (void *)&halide_opencl_release_unused_device_allocations,
     (void *)&halide_opencl_run,
     (void *)&halide_opencl_set_device_type,
+    (void *)&halide_opencl_set_out_of_order_queue,
     (void *)&halide_opencl_set_platform_name,
+    (void *)&halide_opencl_set_program_cache_dir,
     (void *)&halide_opencl_wrap_cl_mem,
+    (void *)&halide_opencl_wrap_host_memory,
     (void *)&halide_opengl_context_lost,
     (void *)&halide_opengl_create_context,
     (void *)&halide_opengl_detach_texture,
@@ -150,6 +184,7 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_openglcompute_run,
     (void *)&halide_pointer_to_string,
     (void *)&halide_print,
+    (void *)&halide_profiler_add_perf_counters,
     (void *)&halide_profiler_get_pipeline_state,
     (void *)&halide_profiler_get_state,
     (void *)&halide_profiler_memory_allocate,
@@ -162,6 +197,8 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_qurt_hvx_unlock,
     (void *)&halide_qurt_hvx_unlock_as_destructor,
     (void *)&halide_release_jit_module,
+    (void *)&halide_semaphore_acquire,
+    (void *)&halide_semaphore_release,
     (void *)&halide_set_custom_can_use_target_features,
     (void *)&halide_set_custom_do_par_for,
     (void *)&halide_set_custom_do_task,
@@ -174,17 +211,34 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_set_custom_trace,
     (void *)&halide_set_error_handler,
     (void *)&halide_set_gpu_device,
+    (void *)&halide_set_gpu_device_for_user_context,
+    (void *)&halide_set_host_dirty_region,
     (void *)&halide_set_num_threads,
+    (void *)&halide_shape_check_cache_lookup,
+    (void *)&halide_shape_check_cache_store,
     (void *)&halide_set_trace_file,
+    (void *)&halide_set_trace_ring_buffer,
+    (void *)&halide_set_trace_ring_buffer_error_fd,
+    (void *)&halide_set_trace_sampling,
     (void *)&halide_shutdown_thread_pool,
     (void *)&halide_shutdown_trace,
     (void *)&halide_sleep_ms,
     (void *)&halide_spawn_thread,
     (void *)&halide_start_clock,
     (void *)&halide_string_to_string,
+    (void *)&halide_thread_pool_bind,
+    (void *)&halide_thread_pool_create,
+    (void *)&halide_thread_pool_destroy,
+    (void *)&halide_thread_pool_events_json,
+    (void *)&halide_thread_pool_record_events,
+    (void *)&halide_thread_pool_set_core_class,
+    (void *)&halide_thread_pool_set_idle_policy,
+    (void *)&halide_thread_pool_set_limits,
     (void *)&halide_trace,
     (void *)&halide_trace_helper,
     (void *)&halide_uint64_to_string,
     (void *)&halide_upgrade_buffer_t,
     (void *)&halide_use_jit_module,
+    (void *)&halide_vtcm_free,
+    (void *)&halide_vtcm_malloc,
 };
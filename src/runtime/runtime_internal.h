@@ -78,6 +78,7 @@ int fileno(void *);
 int fclose(void *);
 int close(int);
 size_t fwrite(const void *, size_t, size_t, void *);
+size_t fread(void *, size_t, size_t, void *);
 ssize_t write(int fd, const void *buf, size_t bytes);
 int remove(const char *pathname);
 int ioctl(int fd, unsigned long request, ...);
@@ -134,7 +135,35 @@ WEAK int halide_profiler_pipeline_start(void *user_context,
                                         const char *pipeline_name,
                                         int num_funcs,
                                         const uint64_t *func_names);
+// The number of cpus this process may use, which is the default size of
+// the thread pool. On linux this respects the affinity mask and the cgroup
+// CPU quota.
 WEAK int halide_host_cpu_count();
+// Pin the calling thread to a single cpu. On linux cpu indexes the cpus in
+// the affinity mask of the calling thread. Returns zero on success, or
+// non-zero if the platform doesn't support it.
+WEAK int halide_set_current_thread_affinity(int cpu);
+// The relative capacities of the cpus halide_set_current_thread_affinity
+// indexes, larger for faster cores (e.g. the big cores of big.LITTLE, or
+// the performance cores of a hybrid x86), for up to max_cpus cpus. Returns
+// the number of cpus filled in, or zero if the platform can't tell cores
+// apart, in which case they should be treated as equal.
+WEAK int halide_host_cpu_capacities(int *capacities, int max_cpus);
+// Ask the OS to back the given range with huge pages. The range must
+// be aligned to 2MB. Returns zero on success, or non-zero if the
+// platform doesn't support it.
+WEAK int halide_advise_huge_pages(void *ptr, size_t size);
+
+// Hardware performance counters for the profiler. Open starts
+// counting cycles, instructions, and last-level cache misses for the
+// calling thread, filling in three file descriptors, and returns zero
+// on success. Read fills in the three current counts.
+WEAK int halide_perf_counters_open(int *fds);
+WEAK int halide_perf_counters_read(const int *fds, uint64_t *values);
+WEAK void halide_perf_counters_close(int *fds);
+
+// Dumps the trace ring buffer if requested. Called by halide_error.
+WEAK void halide_trace_ring_buffer_on_error(void *user_context);
 
 WEAK int halide_device_and_host_malloc(void *user_context, struct halide_buffer_t *buf,
                                        const struct halide_device_interface_t *device_interface);
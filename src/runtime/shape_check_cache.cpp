@@ -0,0 +1,38 @@
+#include "HalideRuntime.h"
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+// A direct-mapped set of the shape signatures that have passed the
+// checks of a pipeline compiled with check_shapes_once. Each
+// signature is seeded by the pipeline it was computed for, so
+// different pipelines can share the table, and a signature evicted by
+// another one that maps to the same entry just gets checked again.
+//
+// Races between threads are benign: at worst a signature is checked
+// again, or is evicted early.
+const int shape_check_cache_size = 256;
+WEAK uint64_t shape_check_cache[shape_check_cache_size];
+
+WEAK int shape_check_cache_index(uint64_t signature) {
+    return (int)((signature ^ (signature >> 32)) % shape_check_cache_size);
+}
+
+}}}  // namespace Halide::Runtime::Internal
+
+using namespace Halide::Runtime::Internal;
+
+extern "C" {
+
+WEAK int halide_shape_check_cache_lookup(uint64_t signature) {
+    // Zero marks an empty entry, and is never stored.
+    signature |= 1;
+    return shape_check_cache[shape_check_cache_index(signature)] == signature;
+}
+
+WEAK int halide_shape_check_cache_store(uint64_t signature) {
+    signature |= 1;
+    shape_check_cache[shape_check_cache_index(signature)] = signature;
+    return 0;
+}
+
+}
@@ -0,0 +1,59 @@
+#include "HalideRuntime.h"
+#include "scoped_mutex_lock.h"
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+WEAK halide_telemetry_t custom_telemetry = NULL;
+
+// The cycle counter and the clock at the first report, which later
+// reports measure the length of a tick against.
+WEAK halide_mutex telemetry_calibration_lock = { { 0 } };
+WEAK volatile bool telemetry_calibrated = false;
+WEAK uint64_t telemetry_calibration_ticks = 0;
+WEAK int64_t telemetry_calibration_ns = 0;
+
+}}}  // namespace Halide::Runtime::Internal
+
+extern "C" {
+
+WEAK halide_telemetry_t halide_set_custom_telemetry(halide_telemetry_t t) {
+    halide_telemetry_t result = custom_telemetry;
+    custom_telemetry = t;
+    return result;
+}
+
+WEAK int halide_telemetry_report(void *user_context, const char *pipeline_name,
+                                 int num_stages, const char *const *stage_names,
+                                 const uint64_t *ticks) {
+    halide_telemetry_t handler = custom_telemetry;
+    if (!handler) {
+        return 0;
+    }
+
+    halide_start_clock(user_context);
+    int64_t now = halide_current_time_ns(user_context);
+    if (!telemetry_calibrated) {
+        ScopedMutexLock lock(&telemetry_calibration_lock);
+        if (!telemetry_calibrated) {
+            telemetry_calibration_ticks = ticks[1];
+            telemetry_calibration_ns = now;
+            telemetry_calibrated = true;
+        }
+    }
+
+    halide_telemetry_record_t record;
+    record.pipeline_name = pipeline_name;
+    record.num_stages = num_stages;
+    record.stage_names = stage_names;
+    record.ticks = ticks;
+    record.ns_per_tick = 0;
+    int64_t elapsed_ns = now - telemetry_calibration_ns;
+    if (elapsed_ns >= 1000000 && ticks[1] > telemetry_calibration_ticks) {
+        record.ns_per_tick = (double)elapsed_ns / (double)(ticks[1] - telemetry_calibration_ticks);
+    }
+
+    (*handler)(user_context, &record);
+    return 0;
+}
+
+}
@@ -0,0 +1,12 @@
+#include "HalideRuntime.h"
+
+extern "C" {
+
+// Targets without a cycle counter we can read from user space (see
+// x86.ll and aarch64.ll) time stages with the clock instead.
+WEAK __attribute__((always_inline)) uint64_t halide_telemetry_ticks() {
+    halide_start_clock(NULL);
+    return (uint64_t)halide_current_time_ns(NULL);
+}
+
+}
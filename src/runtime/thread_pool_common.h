@@ -1,3 +1,5 @@
+#include "scoped_spin_lock.h"
+
 extern "C" void * pthread_self();
 
 namespace Halide { namespace Runtime { namespace Internal {
@@ -10,10 +12,53 @@ struct work {
     uint8_t *closure;
     int active_workers;
     int exit_status;
+    // The most threads that may work on this job at once (zero for no
+    // limit), and its priority. See halide_thread_pool_set_limits.
+    int max_workers;
+    int priority;
+    // Whether threads claim several tasks at once, in guided chunks.
+    // See halide_guided_do_par_for.
+    bool guided;
+    // Whether each task belongs to the thread in the lane with the same
+    // index, and which tasks have been claimed. The job's owner also
+    // takes any tasks left over. See halide_affinity_do_par_for.
+    bool affinity;
+    uint64_t affinity_claimed;
+    // Only kept while recording thread pool events: the job's number
+    // in the trace, when it was enqueued, and which threads have
+    // worked on it. See halide_thread_pool_record_events.
+    int trace_id;
+    int64_t enqueue_time;
+    uint64_t threads_joined[(MAX_THREADS + 63) / 64];
     bool running() { return next < max || active_workers > 0; }
 };
 
-// The work queue and thread pool is weak, so one big work queue is shared by all halide functions
+// The thread budget and priority for jobs launched with a given
+// user_context.
+struct thread_pool_limits {
+    void *user_context;
+    int max_threads;
+    int priority;
+};
+
+#define MAX_THREAD_POOL_LIMITS 16
+
+struct work_queue_t;
+
+// The argument to each worker thread.
+struct worker_info {
+    work_queue_t *queue;
+    int index;
+    // An address near the base of the thread's stack, used to
+    // recognize workers that launch nested parallel loops while
+    // recording thread pool events.
+    const char *stack_base;
+};
+
+// The work queue and thread pool is weak, so one big work queue is
+// shared by all halide functions, except those whose user_context is
+// bound to a pool made with halide_thread_pool_create, which each have
+// a work queue of their own.
 struct work_queue_t {
     // all fields are protected by this mutex.
     halide_mutex mutex;
@@ -21,6 +66,29 @@ struct work_queue_t {
     // The desired number threads doing work.
     int desired_num_threads;
 
+    // How long idle workers spin looking for new jobs before waiting
+    // on wakeup_a_team, in microseconds. See
+    // halide_thread_pool_set_idle_policy.
+    int idle_spin_us;
+
+    // Per-user_context thread budgets and priorities. See
+    // halide_thread_pool_set_limits. Only used in the global queue.
+    thread_pool_limits limits[MAX_THREAD_POOL_LIMITS];
+    int num_limits;
+
+    // The range of cpus the workers of a pool made with
+    // halide_thread_pool_create are pinned to. Empty for the global
+    // queue, and for pools without an affinity.
+    int first_cpu, num_cpus;
+
+    // The class of cores the workers are pinned to. See
+    // halide_thread_pool_set_core_class.
+    int core_class;
+
+    // Identifies the pool in recorded thread pool events. Zero for the
+    // global queue.
+    int trace_pool;
+
     // All fields after this must be zero in the initial state. See assert_zeroed
     // Field serves both to mark the offset in struct and as layout padding.
     int zero_marker;
@@ -48,6 +116,7 @@ struct work_queue_t {
 
     // Keep track of threads so they can be joined at shutdown
     halide_thread *threads[MAX_THREADS];
+    worker_info worker_infos[MAX_THREADS];
 
     // The number threads created
     int threads_created;
@@ -56,13 +125,18 @@ struct work_queue_t {
     // whether the thread pool has been initialized.
     bool shutdown, initialized;
 
+    // Whether worker threads pin themselves to cpus as they
+    // start. Set from HL_THREAD_AFFINITY at initialization.
+    bool pin_threads;
+
     bool running() const {
         return !shutdown;
     }
 
     // Used to check initial state is correct.
     void assert_zeroed() const {
-        // Assert that all fields except the mutex and desired hreads count are zeroed.
+        // Assert that all fields except the mutex, desired threads count,
+        // idle policy, limits, cpus and core class are zeroed.
         const char *bytes = ((const char *)&this->zero_marker);
         const char *limit = ((const char *)this) + sizeof(work_queue_t);
         while (bytes < limit && *bytes == 0) {
@@ -74,14 +148,116 @@ struct work_queue_t {
     // Return the work queue to initial state. Must be called while locked
     // and queue will remain locked.
     void reset() {
-        // Ensure all fields except the mutex and desired hreads count are zeroed.
+        // Ensure all fields except the mutex, desired threads count,
+        // idle policy, limits, cpus and core class are zeroed.
         char *bytes = ((char *)&this->zero_marker);
         char *limit = ((char *)this) + sizeof(work_queue_t);
         memset(bytes, 0, limit - bytes);
     }
 
 };
- WEAK work_queue_t work_queue = {};
+WEAK work_queue_t work_queue = {};
+
+// A user_context whose parallel loops run on a pool made with
+// halide_thread_pool_create.
+struct thread_pool_binding {
+    void *user_context;
+    work_queue_t *queue;
+};
+
+#define MAX_THREAD_POOL_BINDINGS 16
+
+// Protected by work_queue.mutex.
+WEAK thread_pool_binding thread_pool_bindings[MAX_THREAD_POOL_BINDINGS];
+WEAK int num_thread_pool_bindings = 0;
+
+// A task, or a whole job, recorded while tracing the thread pool. Jobs
+// have index -1 and span from being enqueued to finishing on the lane
+// of the thread that launched them.
+struct thread_pool_event {
+    int64_t start, end;
+    // When the job this belongs to was enqueued.
+    int64_t enqueued;
+    int pool, job, thread, index;
+    // For a job, its number of tasks and the number of threads that
+    // worked on it. For a task, the number of tasks in its chunk (see
+    // halide_guided_do_par_for).
+    int size, threads;
+};
+
+// Events are appended without taking a lock, by atomically claiming a
+// slot. Once the buffer is full further events are dropped.
+WEAK thread_pool_event *thread_pool_events = NULL;
+WEAK int thread_pool_events_capacity = 0;
+WEAK int thread_pool_events_count = 0;
+WEAK int thread_pool_next_job_id = 0;
+WEAK int thread_pool_next_trace_pool = 1;
+
+WEAK bool thread_pool_tracing() {
+    return __atomic_load_n(&thread_pool_events_capacity, __ATOMIC_RELAXED) > 0;
+}
+
+WEAK void record_thread_pool_event(const thread_pool_event &e) {
+    int i = __atomic_fetch_add(&thread_pool_events_count, 1, __ATOMIC_RELAXED);
+    if (i < thread_pool_events_capacity) {
+        thread_pool_events[i] = e;
+    } else {
+        __atomic_fetch_sub(&thread_pool_events_count, 1, __ATOMIC_RELAXED);
+    }
+}
+
+// Start recording into a buffer of the given number of events,
+// discarding any recorded so far, or stop recording if max_events is
+// zero. Must be called with work_queue.mutex held.
+WEAK int record_thread_pool_events_already_locked(int max_events) {
+    __atomic_store_n(&thread_pool_events_capacity, 0, __ATOMIC_RELAXED);
+    free(thread_pool_events);
+    thread_pool_events = NULL;
+    thread_pool_events_count = 0;
+    thread_pool_next_job_id = 0;
+    if (max_events > 0) {
+        halide_start_clock(NULL);
+        thread_pool_events = (thread_pool_event *)malloc(max_events * sizeof(thread_pool_event));
+        if (!thread_pool_events) {
+            return -1;
+        }
+        __atomic_store_n(&thread_pool_events_capacity, max_events, __ATOMIC_RELAXED);
+    }
+    return 0;
+}
+
+// If HL_THREAD_POOL_TRACE_FILE is set, the global pool records events
+// from when it starts, into a buffer of HL_THREAD_POOL_TRACE_EVENTS
+// events. Must be called with work_queue.mutex held.
+WEAK void default_record_thread_pool_events() {
+    const char *path = getenv("HL_THREAD_POOL_TRACE_FILE");
+    if (!path || !*path || thread_pool_events) {
+        return;
+    }
+    const char *events_str = getenv("HL_THREAD_POOL_TRACE_EVENTS");
+    int max_events = events_str ? atoi(events_str) : 0;
+    record_thread_pool_events_already_locked(max_events > 0 ? max_events : 1 << 18);
+}
+
+// The lane of the thread calling halide_do_par_for on a queue, in
+// recorded events and for affinity jobs: one more than the index of the
+// worker whose stack it is running on, or 0 if it isn't one of the
+// queue's workers. Must be called with the lock held.
+WEAK int current_lane(work_queue_t *q) {
+    char here;
+    const char *best = NULL;
+    int thread = 0;
+    // Stacks grow down, so this thread's stack is the closest one whose
+    // base is above this address.
+    for (int i = 0; i < q->threads_created; i++) {
+        const char *base = q->worker_infos[i].stack_base;
+        if (base && base >= &here && (!best || base < best)) {
+            best = base;
+            thread = i + 1;
+        }
+    }
+    return thread;
+}
 
 WEAK int clamp_num_threads(int desired_num_threads) {
     if (desired_num_threads > MAX_THREADS) {
@@ -107,42 +283,195 @@ WEAK int default_desired_num_threads() {
     return desired_num_threads;
 }
 
-WEAK void worker_thread_already_locked(work *owned_job) {
+WEAK int default_idle_spin_us() {
+    char *spin_str = getenv("HL_THREAD_POOL_SPIN_US");
+    int spin_us = spin_str ? atoi(spin_str) : 0;
+    return spin_us < 0 ? 0 : spin_us;
+}
+
+WEAK bool default_pin_threads() {
+    char *affinity_str = getenv("HL_THREAD_AFFINITY");
+    return affinity_str && atoi(affinity_str) != 0;
+}
+
+// The cpus of the given class, in the indexing of
+// halide_set_current_thread_affinity, fastest first. The big cores are
+// those with the largest capacity, and the little cores the rest. Where
+// the platform can't tell cores apart, they are all big.
+WEAK int cpus_of_class(int core_class, int *cpus, int max_cpus) {
+    int capacities[MAX_THREADS];
+    int n = halide_host_cpu_capacities(capacities, MAX_THREADS);
+    if (n == 0) {
+        n = halide_host_cpu_count();
+        n = n < MAX_THREADS ? n : MAX_THREADS;
+        for (int i = 0; i < n; i++) {
+            capacities[i] = 1;
+        }
+    }
+
+    // Sort the cpus by decreasing capacity, keeping their order among
+    // cpus of equal capacity.
+    int order[MAX_THREADS];
+    int biggest = 0;
+    for (int i = 0; i < n; i++) {
+        int j = i;
+        while (j > 0 && capacities[order[j - 1]] < capacities[i]) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+        biggest = capacities[i] > biggest ? capacities[i] : biggest;
+    }
+
+    int count = 0;
+    for (int i = 0; i < n && count < max_cpus; i++) {
+        bool big = capacities[order[i]] == biggest;
+        if (core_class == halide_core_class_all ||
+            (core_class == halide_core_class_big) == big) {
+            cpus[count++] = order[i];
+        }
+    }
+    return count;
+}
+
+// The queue for parallel loops launched with the given user_context.
+// Must be called with work_queue.mutex held.
+WEAK work_queue_t *queue_for(void *user_context) {
+    for (int i = 0; i < num_thread_pool_bindings; i++) {
+        if (thread_pool_bindings[i].user_context == user_context) {
+            return thread_pool_bindings[i].queue;
+        }
+    }
+    return &work_queue;
+}
+
+// Whether task idx of an affinity job is yet to be claimed.
+WEAK bool affinity_task_free(work *job, int idx) {
+    return idx < job->max && !((job->affinity_claimed >> idx) & 1);
+}
+
+// Find the job a thread should work on next: the highest priority job
+// that has not used up its thread budget. Jobs of equal priority are
+// taken from the top of the stack, innermost first. A thread only works
+// on an affinity job if the task of its lane is free, or if it owns the
+// job. Returns the link to the job in the stack, or NULL if there is no
+// such job. Must be called with the lock held.
+WEAK work **find_job(work_queue_t *q, int lane, work *owned_job) {
+    work **best = NULL;
+    for (work **link = &q->jobs; *link; link = &(*link)->next_job) {
+        work *job = *link;
+        if (job->max_workers > 0 && job->active_workers >= job->max_workers) {
+            continue;
+        }
+        if (job->affinity && job != owned_job && !affinity_task_free(job, lane)) {
+            continue;
+        }
+        if (!best || job->priority > (*best)->priority) {
+            best = link;
+        }
+    }
+    return best;
+}
+
+// Spin for up to spin_ns without holding the work queue lock, in case a
+// job arrives soon. Picking it up this way is much quicker than being
+// woken from wakeup_a_team. Must be called with the lock held, and
+// returns with it held. Returns true if there is a job for the thread
+// in the given lane to do or the pool is shutting down.
+WEAK bool spin_for_work(work_queue_t *q, int lane, int64_t spin_ns) {
+    halide_mutex_unlock(&q->mutex);
+    int64_t start = halide_current_time_ns(NULL);
+    bool found = false;
+    while (!found) {
+        // Only check the clock every so often, as it may be a syscall.
+        for (int i = 0; i < 256 && !found; i++) {
+            found = (__atomic_load_n(&q->jobs, __ATOMIC_RELAXED) != NULL ||
+                     __atomic_load_n(&q->shutdown, __ATOMIC_RELAXED));
+        }
+        if (halide_current_time_ns(NULL) - start >= spin_ns) {
+            break;
+        }
+    }
+    halide_mutex_lock(&q->mutex);
+    return find_job(q, lane, NULL) != NULL || q->shutdown;
+}
+
+WEAK void worker_thread_already_locked(work_queue_t *q, work *owned_job, int lane) {
+    // The number of times in a row this thread has spun without
+    // finding work. Each miss halves the time it spins next, so that
+    // workers stop burning cpu soon after the pool goes quiet.
+    int spin_misses = 0;
+
     // If I'm a job owner, then I was the thread that called
     // do_par_for, and I should only stay in this function until my
     // job is complete. If I'm a lowly worker thread, I should stay in
     // this function as long as the work queue is running.
     while (owned_job != NULL ? owned_job->running()
-           : work_queue.running()) {
+           : q->running()) {
 
-        if (work_queue.jobs == NULL) {
+        work **link = find_job(q, lane, owned_job);
+        if (link == NULL) {
             if (owned_job) {
                 // There are no jobs pending. Wait for the last worker
                 // to signal that the job is finished.
-                halide_cond_wait(&work_queue.wakeup_owners, &work_queue.mutex);
-            } else if (work_queue.a_team_size <= work_queue.target_a_team_size) {
-                // There are no jobs pending. Wait until more jobs are enqueued.
-                halide_cond_wait(&work_queue.wakeup_a_team, &work_queue.mutex);
+                halide_cond_wait(&q->wakeup_owners, &q->mutex);
+            } else if (q->a_team_size <= q->target_a_team_size) {
+                // There are no jobs pending. Spin for a while if the idle
+                // policy allows it, then wait until more jobs are enqueued.
+                int64_t spin_ns = ((int64_t)q->idle_spin_us * 1000) >> spin_misses;
+                if (spin_ns > 0 && spin_for_work(q, lane, spin_ns)) {
+                    continue;
+                }
+                if (spin_ns > 0 && spin_misses < 30) {
+                    spin_misses++;
+                }
+                halide_cond_wait(&q->wakeup_a_team, &q->mutex);
             } else {
                 // There are no jobs pending, and there are too many
                 // threads in the A team. Transition to the B team
                 // until the wakeup_b_team condition is fired.
-                work_queue.a_team_size--;
-                halide_cond_wait(&work_queue.wakeup_b_team, &work_queue.mutex);
-                work_queue.a_team_size++;
+                q->a_team_size--;
+                halide_cond_wait(&q->wakeup_b_team, &q->mutex);
+                q->a_team_size++;
             }
         } else {
             // Grab the next job.
-            work *job = work_queue.jobs;
+            work *job = *link;
+            spin_misses = 0;
 
-            // Claim a task from it.
+            // Claim a task from it, or for a guided job, a chunk of
+            // tasks. Chunks are a share of the remaining tasks, so
+            // they start large, to keep the lock quiet, and shrink to
+            // single tasks near the end, so that all the threads
+            // finish together even if tasks vary in cost.
             work myjob = *job;
-            job->next++;
+            int chunk = 1;
+            if (job->guided) {
+                int threads = q->threads_created + 1;
+                if (job->max_workers > 0 && job->max_workers < threads) {
+                    threads = job->max_workers;
+                }
+                chunk = (job->max - job->next) / (2 * threads);
+                if (chunk < 1) {
+                    chunk = 1;
+                }
+            }
+            if (job->affinity) {
+                // Take the task of my lane, or as the owner, the
+                // first one left over. next counts the tasks claimed.
+                int idx = lane;
+                while (!affinity_task_free(job, idx)) {
+                    idx = (idx + 1) % job->max;
+                }
+                job->affinity_claimed |= (uint64_t)1 << idx;
+                myjob.next = idx;
+            }
+            job->next += chunk;
 
             // If there were no more tasks pending for this job,
             // remove it from the stack.
             if (job->next == job->max) {
-                work_queue.jobs = job->next_job;
+                *link = job->next_job;
             }
 
             // Increment the active_worker count so that other threads
@@ -150,11 +479,39 @@ WEAK void worker_thread_already_locked(work *owned_job) {
             // though there are no outstanding tasks for it.
             job->active_workers++;
 
+            // Jobs enqueued while recording thread pool events have a
+            // trace_id.
+            bool tracing = job->trace_id >= 0;
+            if (tracing) {
+                job->threads_joined[lane / 64] |= (uint64_t)1 << (lane % 64);
+            }
+
             // Release the lock and do the task.
-            halide_mutex_unlock(&work_queue.mutex);
-            int result = halide_do_task(myjob.user_context, myjob.f, myjob.next,
-                                        myjob.closure);
-            halide_mutex_lock(&work_queue.mutex);
+            halide_mutex_unlock(&q->mutex);
+            thread_pool_event e;
+            if (tracing) {
+                e.start = halide_current_time_ns(NULL);
+            }
+            int result = 0;
+            for (int i = 0; i < chunk; i++) {
+                int r = halide_do_task(myjob.user_context, myjob.f, myjob.next + i,
+                                       myjob.closure);
+                if (r) {
+                    result = r;
+                }
+            }
+            if (tracing) {
+                e.end = halide_current_time_ns(NULL);
+                e.enqueued = myjob.enqueue_time;
+                e.pool = q->trace_pool;
+                e.job = myjob.trace_id;
+                e.thread = lane;
+                e.index = myjob.next;
+                e.size = chunk;
+                e.threads = 0;
+                record_thread_pool_event(e);
+            }
+            halide_mutex_lock(&q->mutex);
 
             // If this task failed, set the exit status on the job.
             if (result) {
@@ -164,44 +521,237 @@ WEAK void worker_thread_already_locked(work *owned_job) {
             // We are no longer active on this job
             job->active_workers--;
 
+            // If the job was at its thread budget and has tasks left,
+            // a waiting thread may now take one.
+            if (job->max_workers > 0 &&
+                job->active_workers == job->max_workers - 1 &&
+                job->next < job->max) {
+                halide_cond_broadcast(&q->wakeup_a_team);
+                halide_cond_broadcast(&q->wakeup_owners);
+            }
+
             // If the job is done and I'm not the owner of it, wake up
             // the owner.
             if (!job->running() && job != owned_job) {
-                halide_cond_broadcast(&work_queue.wakeup_owners);
+                halide_cond_broadcast(&q->wakeup_owners);
             }
         }
     }
 }
 
-WEAK void worker_thread(void *) {
-    halide_mutex_lock(&work_queue.mutex);
-    worker_thread_already_locked(NULL);
-    halide_mutex_unlock(&work_queue.mutex);
+WEAK void worker_thread(void *arg) {
+    worker_info *info = (worker_info *)arg;
+    work_queue_t *q = info->queue;
+    if (q->num_cpus > 0) {
+        // Workers of a pool with its own cpus share them round-robin.
+        halide_set_current_thread_affinity(q->first_cpu + info->index % q->num_cpus);
+    } else if (q->core_class != halide_core_class_all) {
+        // Workers of a pool restricted to a class of cores share them
+        // round-robin.
+        int cpus[MAX_THREADS];
+        int n = cpus_of_class(q->core_class, cpus, MAX_THREADS);
+        if (n > 0) {
+            halide_set_current_thread_affinity(cpus[info->index % n]);
+        }
+    } else if (q->pin_threads) {
+        // Worker i goes on the (i + 1)th fastest cpu, leaving the
+        // fastest for the thread that owns the first job, so that
+        // pools with fewer threads than cpus avoid the little cores
+        // of big.LITTLE and hybrid chips. Workers then stay put, so
+        // pages they first-touch while producing a buffer are
+        // allocated on their own NUMA node.
+        int cpus[MAX_THREADS];
+        int n = cpus_of_class(halide_core_class_all, cpus, MAX_THREADS);
+        if (n > 1) {
+            halide_set_current_thread_affinity(cpus[(info->index + 1) % n]);
+        }
+    }
+    char stack_base;
+    halide_mutex_lock(&q->mutex);
+    info->stack_base = &stack_base;
+    worker_thread_already_locked(q, NULL, info->index + 1);
+    halide_mutex_unlock(&q->mutex);
 }
 
-WEAK halide_do_task_t custom_do_task = halide_default_do_task;
-WEAK halide_do_par_for_t custom_do_par_for = halide_default_do_par_for;
+// Stop the workers of a queue and return it to its initial state.
+WEAK void shutdown_work_queue(work_queue_t *q) {
+    if (q->initialized) {
+        // Wake everyone up and tell them the party's over and it's time
+        // to go home
+        halide_mutex_lock(&q->mutex);
+        q->shutdown = true;
+        halide_cond_broadcast(&q->wakeup_owners);
+        halide_cond_broadcast(&q->wakeup_a_team);
+        halide_cond_broadcast(&q->wakeup_b_team);
+        halide_mutex_unlock(&q->mutex);
 
-}}}  // namespace Halide::Runtime::Internal
+        // Wait until they leave
+        for (int i = 0; i < q->threads_created; i++) {
+            halide_join_thread(q->threads[i]);
+        }
 
-using namespace Halide::Runtime::Internal;
+        // Tidy up
+        q->reset();
+    }
+}
 
-extern "C" {
+// The work-stealing engine for halide_work_stealing_do_par_for. Rather
+// than having every worker claim every loop iteration through the
+// shared work queue mutex, the iteration range is divided up front
+// into one contiguous slice per worker. Each worker drains its own
+// slice from the front, and when that runs dry it steals the back
+// half of some other worker's slice. The shared work queue is then
+// only touched once per worker per parallel loop.
+#define MAX_WORK_STEALING_SLOTS 64
 
-namespace {
-__attribute__((destructor))
-WEAK void halide_thread_pool_cleanup() {
-    halide_shutdown_thread_pool();
+struct work_stealing_slot {
+    // Protects next and max. Only contended while stealing.
+    volatile int lock;
+    int next, max;
+    // Pad slots out to a cache line to avoid false sharing.
+    char padding[64 - 3 * sizeof(int)];
+};
+
+struct work_stealing_job {
+    halide_task_t f;
+    uint8_t *closure;
+    int num_slots;
+    int exit_status;
+    work_stealing_slot slots[MAX_WORK_STEALING_SLOTS];
+};
+
+// Claim the next iteration from the front of a slot.
+WEAK bool work_stealing_pop(work_stealing_slot *slot, int *idx) {
+    ScopedSpinLock lock(&slot->lock);
+    if (slot->next >= slot->max) {
+        return false;
+    }
+    *idx = slot->next++;
+    return true;
 }
+
+// Move the back half of the victim's remaining iterations into the
+// thief's (empty) slot.
+WEAK bool work_stealing_steal(work_stealing_slot *victim, work_stealing_slot *thief) {
+    int lo, hi;
+    {
+        ScopedSpinLock lock(&victim->lock);
+        int remaining = victim->max - victim->next;
+        if (remaining <= 0) {
+            return false;
+        }
+        hi = victim->max;
+        lo = victim->next + remaining / 2;
+        victim->max = lo;
+    }
+    ScopedSpinLock lock(&thief->lock);
+    thief->next = lo;
+    thief->max = hi;
+    return true;
 }
 
-WEAK int halide_default_do_task(void *user_context, halide_task_t f, int idx,
-                                uint8_t *closure) {
-    return f(user_context, idx, closure);
+WEAK int work_stealing_task(void *user_context, int slot_idx, uint8_t *closure) {
+    work_stealing_job *job = (work_stealing_job *)closure;
+    work_stealing_slot *mine = job->slots + slot_idx;
+    while (true) {
+        int idx;
+        if (work_stealing_pop(mine, &idx)) {
+            int result = halide_do_task(user_context, job->f, idx, job->closure);
+            if (result) {
+                job->exit_status = result;
+            }
+            continue;
+        }
+        // My slice is empty. Go looking for someone else's.
+        bool stole = false;
+        for (int i = 1; i < job->num_slots && !stole; i++) {
+            work_stealing_slot *victim = job->slots + (slot_idx + i) % job->num_slots;
+            stole = work_stealing_steal(victim, mine);
+        }
+        if (!stole) {
+            // Every slice is empty or is being drained by its
+            // owner. Nothing left for this worker to do.
+            return 0;
+        }
+    }
 }
 
-WEAK int halide_default_do_par_for(void *user_context, halide_task_t f,
-                                   int min, int size, uint8_t *closure) {
+// Print a time in nanoseconds as the microseconds chrome traces use.
+WEAK char *thread_pool_us_to_string(char *dst, char *end, int64_t ns) {
+    if (ns < 0) {
+        ns = 0;
+    }
+    dst = halide_int64_to_string(dst, end, ns / 1000, 1);
+    dst = halide_string_to_string(dst, end, ".");
+    return halide_int64_to_string(dst, end, ns % 1000, 3);
+}
+
+// Append one event to a chrome trace. Like halide_thread_pool_events_json,
+// returns the length the output would have if it all fit.
+WEAK size_t thread_pool_event_json(const thread_pool_event &e, bool first,
+                                   char *buf, size_t size, size_t length) {
+    char tmp[512];
+    char *dst = tmp, *end = tmp + sizeof(tmp);
+    dst = halide_string_to_string(dst, end, first ? "\n" : ",\n");
+    dst = halide_string_to_string(dst, end, e.index < 0 ? "{\"name\":\"job\",\"cat\":\"job\"" : "{\"name\":\"task\",\"cat\":\"task\"");
+    dst = halide_string_to_string(dst, end, ",\"ph\":\"X\",\"ts\":");
+    dst = thread_pool_us_to_string(dst, end, e.start);
+    dst = halide_string_to_string(dst, end, ",\"dur\":");
+    dst = thread_pool_us_to_string(dst, end, e.end - e.start);
+    dst = halide_string_to_string(dst, end, ",\"pid\":");
+    dst = halide_int64_to_string(dst, end, e.pool, 1);
+    dst = halide_string_to_string(dst, end, ",\"tid\":");
+    dst = halide_int64_to_string(dst, end, e.thread, 1);
+    dst = halide_string_to_string(dst, end, ",\"args\":{\"job\":");
+    dst = halide_int64_to_string(dst, end, e.job, 1);
+    if (e.index < 0) {
+        dst = halide_string_to_string(dst, end, ",\"tasks\":");
+        dst = halide_int64_to_string(dst, end, e.size, 1);
+        dst = halide_string_to_string(dst, end, ",\"threads\":");
+        dst = halide_int64_to_string(dst, end, e.threads, 1);
+    } else {
+        dst = halide_string_to_string(dst, end, ",\"index\":");
+        dst = halide_int64_to_string(dst, end, e.index, 1);
+        if (e.size > 1) {
+            dst = halide_string_to_string(dst, end, ",\"chunk\":");
+            dst = halide_int64_to_string(dst, end, e.size, 1);
+        }
+        dst = halide_string_to_string(dst, end, ",\"queued_us\":");
+        dst = thread_pool_us_to_string(dst, end, e.start - e.enqueued);
+    }
+    dst = halide_string_to_string(dst, end, "}}");
+    for (const char *c = tmp; c < dst; c++, length++) {
+        if (length + 1 < size) {
+            buf[length] = *c;
+        }
+    }
+    return length;
+}
+
+// Called at process exit.
+WEAK void write_thread_pool_trace_file() {
+#ifndef HALIDE_THREAD_POOL_NO_TRACE_FILE
+    const char *path = getenv("HL_THREAD_POOL_TRACE_FILE");
+    if (!path || !*path || !thread_pool_events) return;
+    int length = halide_thread_pool_events_json(NULL, 0);
+    char *buf = (char *)malloc(length + 1);
+    if (!buf) return;
+    halide_thread_pool_events_json(buf, length + 1);
+    void *f = fopen(path, "wb");
+    if (f) {
+        fwrite(buf, 1, length, f);
+        fclose(f);
+    }
+    free(buf);
+#endif
+}
+
+// Run a parallel loop on the thread pool the user_context is bound to,
+// with the calling thread helping out. See halide_default_do_par_for,
+// halide_guided_do_par_for, and halide_affinity_do_par_for, whose jobs
+// must start at zero and have at most 64 tasks.
+WEAK int run_job(void *user_context, halide_task_t f, int min, int size,
+                 uint8_t *closure, bool guided, bool affinity) {
     // Our for loops are expected to gracefully handle sizes <= 0
     if (size <= 0) {
         return 0;
@@ -211,29 +761,55 @@ WEAK int halide_default_do_par_for(void *user_context, halide_task_t f,
     // field will be zero-initialized because it's a static global.
     halide_mutex_lock(&work_queue.mutex);
 
-    if (!work_queue.initialized) {
-        work_queue.assert_zeroed();
+    // Find the queue this job goes on, and its limits.
+    work_queue_t *q = queue_for(user_context);
+    int max_workers = 0, priority = 0;
+    for (int i = 0; i < work_queue.num_limits; i++) {
+        if (work_queue.limits[i].user_context == user_context) {
+            max_workers = work_queue.limits[i].max_threads;
+            priority = work_queue.limits[i].priority;
+        }
+    }
+    if (q != &work_queue) {
+        halide_mutex_unlock(&work_queue.mutex);
+        halide_mutex_lock(&q->mutex);
+    }
+
+    if (!q->initialized) {
+        q->assert_zeroed();
 
         // Compute the desired number of threads to use. Other code
         // can also mess with this value, but only when the work queue
         // is locked.
-        if (!work_queue.desired_num_threads) {
-            work_queue.desired_num_threads = default_desired_num_threads();
+        if (!q->desired_num_threads) {
+            q->desired_num_threads = default_desired_num_threads();
         }
-        work_queue.desired_num_threads = clamp_num_threads(work_queue.desired_num_threads);
-        work_queue.threads_created = 0;
+        q->desired_num_threads = clamp_num_threads(q->desired_num_threads);
+        q->threads_created = 0;
 
         // Everyone starts on the a team.
-        work_queue.a_team_size = work_queue.desired_num_threads;
+        q->a_team_size = q->desired_num_threads;
+
+        q->pin_threads = default_pin_threads();
 
-        work_queue.initialized = true;
+        if (!q->idle_spin_us) {
+            q->idle_spin_us = default_idle_spin_us();
+        }
+
+        if (q == &work_queue) {
+            default_record_thread_pool_events();
+        }
+
+        q->initialized = true;
     }
 
-    while (work_queue.threads_created < work_queue.desired_num_threads - 1) {
-        // We might need to make some new threads, if work_queue.desired_num_threads has
+    while (q->threads_created < q->desired_num_threads - 1) {
+        // We might need to make some new threads, if q->desired_num_threads has
         // increased.
-        work_queue.threads[work_queue.threads_created++] =
-            halide_spawn_thread(worker_thread, NULL);
+        worker_info *info = &q->worker_infos[q->threads_created];
+        info->queue = q;
+        info->index = q->threads_created;
+        q->threads[q->threads_created++] = halide_spawn_thread(worker_thread, info);
     }
 
     // Make the job.
@@ -245,44 +821,179 @@ WEAK int halide_default_do_par_for(void *user_context, halide_task_t f,
     job.closure = closure;   // Use this closure.
     job.exit_status = 0;     // The job hasn't failed yet
     job.active_workers = 0;  // Nobody is working on this yet
+    job.max_workers = max_workers;
+    job.priority = priority;
+    job.guided = guided;
+    job.affinity = affinity;
+    job.affinity_claimed = 0;
+    job.trace_id = -1;
+    int lane = 0;
+    if (thread_pool_tracing()) {
+        job.trace_id = __atomic_fetch_add(&thread_pool_next_job_id, 1, __ATOMIC_RELAXED);
+        job.enqueue_time = halide_current_time_ns(NULL);
+        memset(job.threads_joined, 0, sizeof(job.threads_joined));
+    }
+    if (job.trace_id >= 0 || affinity) {
+        lane = current_lane(q);
+    }
+
+    int wanted_threads = size;
+    if (job.max_workers > 0 && job.max_workers < wanted_threads) {
+        wanted_threads = job.max_workers;
+    }
 
-    if (!work_queue.jobs && size < work_queue.desired_num_threads) {
+    // Affinity jobs keep all the workers awake, so that each can take
+    // the task of its lane.
+    if (!q->jobs && wanted_threads < q->desired_num_threads && !affinity) {
         // If there's no nested parallelism happening and there are
-        // fewer tasks to do than threads, then set the target A team
-        // size so that some threads will put themselves to sleep
-        // until a larger job arrives.
-        work_queue.target_a_team_size = size;
+        // fewer tasks to do (or fewer threads allowed) than threads,
+        // then set the target A team size so that some threads will
+        // put themselves to sleep until a larger job arrives.
+        q->target_a_team_size = wanted_threads;
     } else {
         // Otherwise the target A team size is
         // desired_num_threads. This may still be less than
         // threads_created if desired_num_threads has been reduced by
         // other code.
-        work_queue.target_a_team_size = work_queue.desired_num_threads;
+        q->target_a_team_size = q->desired_num_threads;
     }
 
     // Push the job onto the stack.
-    job.next_job = work_queue.jobs;
-    work_queue.jobs = &job;
+    job.next_job = q->jobs;
+    q->jobs = &job;
 
     // Wake up our A team.
-    halide_cond_broadcast(&work_queue.wakeup_a_team);
+    halide_cond_broadcast(&q->wakeup_a_team);
 
     // If there are fewer threads than we would like on the a team,
     // wake up the b team too.
-    if (work_queue.target_a_team_size > work_queue.a_team_size) {
-        halide_cond_broadcast(&work_queue.wakeup_b_team);
+    if (q->target_a_team_size > q->a_team_size) {
+        halide_cond_broadcast(&q->wakeup_b_team);
     }
 
     // Do some work myself.
-    worker_thread_already_locked(&job);
+    worker_thread_already_locked(q, &job, lane);
 
-    halide_mutex_unlock(&work_queue.mutex);
+    halide_mutex_unlock(&q->mutex);
+
+    if (job.trace_id >= 0) {
+        thread_pool_event e;
+        e.start = e.enqueued = job.enqueue_time;
+        e.end = halide_current_time_ns(NULL);
+        e.pool = q->trace_pool;
+        e.job = job.trace_id;
+        e.thread = lane;
+        e.index = -1;
+        e.size = size;
+        e.threads = 0;
+        for (int i = 0; i < (int)(sizeof(job.threads_joined) / sizeof(job.threads_joined[0])); i++) {
+            e.threads += __builtin_popcountll(job.threads_joined[i]);
+        }
+        record_thread_pool_event(e);
+    }
 
     // Return zero if the job succeeded, otherwise return the exit
     // status of one of the failing jobs (whichever one failed last).
     return job.exit_status;
 }
 
+// Run a parallel loop as one work-stealing slice per worker. See
+// halide_work_stealing_do_par_for and halide_affinity_do_par_for.
+WEAK int run_work_stealing_job(void *user_context, halide_task_t f, int min, int size,
+                               uint8_t *closure, bool affinity) {
+    if (size <= 0) {
+        return 0;
+    }
+
+    halide_mutex_lock(&work_queue.mutex);
+    work_queue_t *q = queue_for(user_context);
+    if (q != &work_queue) {
+        halide_mutex_unlock(&work_queue.mutex);
+        halide_mutex_lock(&q->mutex);
+    }
+    int num_slots = q->desired_num_threads;
+    halide_mutex_unlock(&q->mutex);
+    if (!num_slots) {
+        num_slots = default_desired_num_threads();
+    }
+    num_slots = clamp_num_threads(num_slots);
+    if (num_slots > MAX_WORK_STEALING_SLOTS) {
+        num_slots = MAX_WORK_STEALING_SLOTS;
+    }
+    if (num_slots > size) {
+        num_slots = size;
+    }
+
+    if (num_slots == 1) {
+        for (int x = min; x < min + size; x++) {
+            int result = halide_do_task(user_context, f, x, closure);
+            if (result) {
+                return result;
+            }
+        }
+        return 0;
+    }
+
+    work_stealing_job job;
+    job.f = f;
+    job.closure = closure;
+    job.num_slots = num_slots;
+    job.exit_status = 0;
+    for (int i = 0; i < num_slots; i++) {
+        job.slots[i].lock = 0;
+        job.slots[i].next = min + (int)(((int64_t)size * i) / num_slots);
+        job.slots[i].max = min + (int)(((int64_t)size * (i + 1)) / num_slots);
+    }
+
+    // Hand one task per slot to the regular thread pool. This must
+    // bypass halide_do_par_for, which may well be pointing back here.
+    int result = run_job(user_context, work_stealing_task,
+                         0, num_slots, (uint8_t *)&job, false, affinity);
+    return result ? result : job.exit_status;
+}
+
+WEAK halide_do_task_t custom_do_task = halide_default_do_task;
+WEAK halide_do_par_for_t custom_do_par_for = halide_default_do_par_for;
+
+}}}  // namespace Halide::Runtime::Internal
+
+using namespace Halide::Runtime::Internal;
+
+extern "C" {
+
+namespace {
+__attribute__((destructor))
+WEAK void halide_thread_pool_cleanup() {
+    halide_shutdown_thread_pool();
+    write_thread_pool_trace_file();
+}
+}
+
+WEAK int halide_default_do_task(void *user_context, halide_task_t f, int idx,
+                                uint8_t *closure) {
+    return f(user_context, idx, closure);
+}
+
+WEAK int halide_default_do_par_for(void *user_context, halide_task_t f,
+                                   int min, int size, uint8_t *closure) {
+    return run_job(user_context, f, min, size, closure, false, false);
+}
+
+WEAK int halide_guided_do_par_for(void *user_context, halide_task_t f,
+                                  int min, int size, uint8_t *closure) {
+    return run_job(user_context, f, min, size, closure, true, false);
+}
+
+WEAK int halide_work_stealing_do_par_for(void *user_context, halide_task_t f,
+                                         int min, int size, uint8_t *closure) {
+    return run_work_stealing_job(user_context, f, min, size, closure, false);
+}
+
+WEAK int halide_affinity_do_par_for(void *user_context, halide_task_t f,
+                                    int min, int size, uint8_t *closure) {
+    return run_work_stealing_job(user_context, f, min, size, closure, true);
+}
+
 WEAK int halide_set_num_threads(int n) {
     if (n < 0) {
         halide_error(NULL, "halide_set_num_threads: must be >= 0.");
@@ -300,25 +1011,194 @@ WEAK int halide_set_num_threads(int n) {
     return old;
 }
 
+WEAK int halide_get_num_threads() {
+    halide_mutex_lock(&work_queue.mutex);
+    int n = work_queue.desired_num_threads;
+    if (!n) {
+        n = default_desired_num_threads();
+    }
+    halide_mutex_unlock(&work_queue.mutex);
+    return clamp_num_threads(n);
+}
+
+WEAK int halide_thread_pool_set_idle_policy(int spin_us) {
+    if (spin_us < 0) {
+        halide_error(NULL, "halide_thread_pool_set_idle_policy: must be >= 0.");
+    }
+    halide_mutex_lock(&work_queue.mutex);
+    if (spin_us <= 0) {
+        spin_us = default_idle_spin_us();
+    }
+    int old = work_queue.idle_spin_us;
+    work_queue.idle_spin_us = spin_us;
+    halide_mutex_unlock(&work_queue.mutex);
+    return old;
+}
+
+WEAK int halide_thread_pool_set_core_class(struct halide_thread_pool *pool, halide_core_class_t core_class) {
+    if (core_class < halide_core_class_all || core_class > halide_core_class_little) {
+        halide_error(NULL, "halide_thread_pool_set_core_class: unknown core class.");
+        return -1;
+    }
+    int num_threads = 0;
+    if (core_class != halide_core_class_all) {
+        int cpus[MAX_THREADS];
+        num_threads = cpus_of_class(core_class, cpus, MAX_THREADS);
+        if (num_threads == 0) {
+            halide_error(NULL, "halide_thread_pool_set_core_class: there are no cores of that class.");
+            return -1;
+        }
+    }
+    work_queue_t *q = pool ? (work_queue_t *)pool : &work_queue;
+    // Stop the workers, so that they pin themselves to the new cores
+    // when they restart for the next parallel loop.
+    shutdown_work_queue(q);
+    halide_mutex_lock(&q->mutex);
+    q->core_class = core_class;
+    q->desired_num_threads = num_threads ? clamp_num_threads(num_threads) : default_desired_num_threads();
+    halide_mutex_unlock(&q->mutex);
+    return 0;
+}
+
+WEAK int halide_thread_pool_set_limits(void *user_context, int max_threads, int priority) {
+    if (max_threads < 0) {
+        halide_error(NULL, "halide_thread_pool_set_limits: max_threads must be >= 0.");
+        return -1;
+    }
+    halide_mutex_lock(&work_queue.mutex);
+    int i = 0;
+    while (i < work_queue.num_limits && work_queue.limits[i].user_context != user_context) {
+        i++;
+    }
+    int result = 0;
+    if (max_threads == 0 && priority == 0) {
+        // Back to the defaults. Remove the entry, if any.
+        if (i < work_queue.num_limits) {
+            work_queue.limits[i] = work_queue.limits[--work_queue.num_limits];
+        }
+    } else if (i == MAX_THREAD_POOL_LIMITS) {
+        result = -1;
+    } else {
+        if (i == work_queue.num_limits) {
+            work_queue.num_limits++;
+        }
+        work_queue.limits[i].user_context = user_context;
+        work_queue.limits[i].max_threads = max_threads;
+        work_queue.limits[i].priority = priority;
+    }
+    halide_mutex_unlock(&work_queue.mutex);
+    if (result) {
+        halide_error(NULL, "halide_thread_pool_set_limits: too many user contexts with limits.");
+    }
+    return result;
+}
+
+WEAK int halide_thread_pool_record_events(int max_events) {
+    if (max_events < 0) {
+        halide_error(NULL, "halide_thread_pool_record_events: must be >= 0.");
+        return -1;
+    }
+    halide_mutex_lock(&work_queue.mutex);
+    int result = record_thread_pool_events_already_locked(max_events);
+    halide_mutex_unlock(&work_queue.mutex);
+    return result;
+}
+
+WEAK int halide_thread_pool_events_json(char *buf, size_t size) {
+    if (!buf) {
+        size = 0;
+    }
+    int count = __atomic_load_n(&thread_pool_events_count, __ATOMIC_ACQUIRE);
+    if (count > thread_pool_events_capacity) {
+        count = thread_pool_events_capacity;
+    }
+    const char *header = "{\"traceEvents\":[";
+    const char *footer = "\n]}\n";
+    size_t length = 0;
+    for (const char *c = header; *c; c++, length++) {
+        if (length + 1 < size) {
+            buf[length] = *c;
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        length = thread_pool_event_json(thread_pool_events[i], i == 0, buf, size, length);
+    }
+    for (const char *c = footer; *c; c++, length++) {
+        if (length + 1 < size) {
+            buf[length] = *c;
+        }
+    }
+    if (size) {
+        buf[length < size ? length : size - 1] = 0;
+    }
+    return (int)length;
+}
+
 WEAK void halide_shutdown_thread_pool() {
-    if (work_queue.initialized) {
-        // Wake everyone up and tell them the party's over and it's time
-        // to go home
-        halide_mutex_lock(&work_queue.mutex);
-        work_queue.shutdown = true;
-        halide_cond_broadcast(&work_queue.wakeup_owners);
-        halide_cond_broadcast(&work_queue.wakeup_a_team);
-        halide_cond_broadcast(&work_queue.wakeup_b_team);
-        halide_mutex_unlock(&work_queue.mutex);
+    shutdown_work_queue(&work_queue);
+}
 
-        // Wait until they leave
-        for (int i = 0; i < work_queue.threads_created; i++) {
-            halide_join_thread(work_queue.threads[i]);
+WEAK struct halide_thread_pool *halide_thread_pool_create(int num_threads, int first_cpu, int num_cpus) {
+    if (num_threads < 0 || first_cpu < 0 || num_cpus < 0) {
+        halide_error(NULL, "halide_thread_pool_create: arguments must be >= 0.");
+        return NULL;
+    }
+    work_queue_t *q = (work_queue_t *)malloc(sizeof(work_queue_t));
+    if (!q) {
+        return NULL;
+    }
+    memset(q, 0, sizeof(work_queue_t));
+    if (num_threads == 0) {
+        num_threads = default_desired_num_threads();
+    }
+    q->desired_num_threads = clamp_num_threads(num_threads);
+    q->first_cpu = first_cpu;
+    q->num_cpus = num_cpus;
+    q->trace_pool = __atomic_fetch_add(&thread_pool_next_trace_pool, 1, __ATOMIC_RELAXED);
+    return (struct halide_thread_pool *)q;
+}
+
+WEAK void halide_thread_pool_destroy(struct halide_thread_pool *pool) {
+    if (!pool) {
+        return;
+    }
+    work_queue_t *q = (work_queue_t *)pool;
+    halide_mutex_lock(&work_queue.mutex);
+    for (int i = 0; i < num_thread_pool_bindings; i++) {
+        if (thread_pool_bindings[i].queue == q) {
+            thread_pool_bindings[i--] = thread_pool_bindings[--num_thread_pool_bindings];
         }
+    }
+    halide_mutex_unlock(&work_queue.mutex);
+    shutdown_work_queue(q);
+    free(q);
+}
 
-        // Tidy up
-        work_queue.reset();
+WEAK int halide_thread_pool_bind(void *user_context, struct halide_thread_pool *pool) {
+    halide_mutex_lock(&work_queue.mutex);
+    int i = 0;
+    while (i < num_thread_pool_bindings && thread_pool_bindings[i].user_context != user_context) {
+        i++;
     }
+    int result = 0;
+    if (!pool) {
+        if (i < num_thread_pool_bindings) {
+            thread_pool_bindings[i] = thread_pool_bindings[--num_thread_pool_bindings];
+        }
+    } else if (i == MAX_THREAD_POOL_BINDINGS) {
+        result = -1;
+    } else {
+        if (i == num_thread_pool_bindings) {
+            num_thread_pool_bindings++;
+        }
+        thread_pool_bindings[i].user_context = user_context;
+        thread_pool_bindings[i].queue = (work_queue_t *)pool;
+    }
+    halide_mutex_unlock(&work_queue.mutex);
+    if (result) {
+        halide_error(NULL, "halide_thread_pool_bind: too many user contexts bound to thread pools.");
+    }
+    return result;
 }
 
 WEAK halide_do_task_t halide_set_custom_do_task(halide_do_task_t f) {
@@ -343,4 +1223,20 @@ WEAK int halide_do_par_for(void *user_context, halide_task_t f,
   return (*custom_do_par_for)(user_context, f, min, size, closure);
 }
 
+WEAK int halide_semaphore_release(halide_semaphore_t *sema, int n) {
+    __sync_fetch_and_add(&sema->_private[0], n);
+    return 0;
+}
+
+WEAK int halide_semaphore_acquire(halide_semaphore_t *sema, int n) {
+    while (true) {
+        int32_t value = __sync_fetch_and_add(&sema->_private[0], 0);
+        if (value >= n &&
+            __sync_bool_compare_and_swap(&sema->_private[0], value, value - n)) {
+            return 0;
+        }
+        halide_thread_yield();
+    }
+}
+
 }
@@ -141,6 +141,130 @@ WEAK int halide_trace_file_lock = 0;
 WEAK bool halide_trace_file_initialized = false;
 WEAK void *halide_trace_file_internally_opened = NULL;
 
+// An in-memory alternative to the trace file that keeps only the most
+// recent packets, for leaving tracing on in production and dumping
+// the trace on demand or when something goes wrong. Packets are in
+// the same format as in a trace file.
+class TraceRingBuffer {
+    volatile int lock;
+    uint8_t *buf;
+    uint32_t capacity;
+    // The oldest packet, where the next packet goes, and, when the
+    // packets wrap around the end of buf, where they stop before
+    // wrapping.
+    uint32_t tail, head, wrap;
+    uint32_t count;
+
+    void drop_oldest() {
+        tail += ((halide_trace_packet_t *)(buf + tail))->size;
+        count--;
+        if (count == 0) {
+            tail = head = 0;
+        } else if (tail == wrap) {
+            tail = 0;
+        }
+    }
+
+    // Find room for a packet, dropping old packets as
+    // necessary. Called with the lock held.
+    uint8_t *reserve(uint32_t size) {
+        while (1) {
+            if (count == 0) {
+                tail = head = 0;
+            }
+            if (count == 0 || tail < head) {
+                // The packets are in [tail, head), so there's free
+                // space after head and before tail.
+                if (head + size <= capacity) {
+                    break;
+                }
+                wrap = head;
+                head = 0;
+            }
+            // The packets are in [tail, wrap) and [0, head).
+            if (head + size <= tail) {
+                break;
+            }
+            drop_oldest();
+        }
+        uint8_t *result = buf + head;
+        head += size;
+        count++;
+        return result;
+    }
+
+public:
+    void init(uint8_t *b, uint32_t c) {
+        lock = 0;
+        buf = b;
+        capacity = c;
+        tail = head = wrap = count = 0;
+    }
+
+    uint32_t max_packet_size() const {
+        return capacity;
+    }
+
+    // Reserve room for a packet of the given size, and return it with
+    // the ring locked. Release it with release_packet.
+    halide_trace_packet_t *acquire_packet(uint32_t size) {
+        while (__sync_lock_test_and_set(&lock, 1)) { }
+        return (halide_trace_packet_t *)reserve(size);
+    }
+
+    void release_packet(halide_trace_packet_t *) {
+        __sync_lock_release(&lock);
+    }
+
+    // Write the packets to fd, oldest first, and empty the
+    // ring. Returns the number of bytes written, or -1 on failure.
+    int dump(int fd) {
+        ScopedSpinLock l(&lock);
+        int written = 0;
+        bool success = true;
+        if (count) {
+            uint32_t end = tail < head ? head : wrap;
+            success = (end - tail == (uint32_t)write(fd, buf + tail, end - tail));
+            written += end - tail;
+            if (success && tail >= head) {
+                success = (head == (uint32_t)write(fd, buf, head));
+                written += head;
+            }
+        }
+        tail = head = wrap = count = 0;
+        return success ? written : -1;
+    }
+};
+
+WEAK TraceRingBuffer *halide_trace_ring_buffer = NULL;
+WEAK int halide_trace_ring_buffer_error_fd = -1;
+
+// Only every Nth load and store event is traced. Zero means none
+// are.
+WEAK int halide_trace_load_store_period = 1;
+WEAK int halide_trace_load_store_counter = 0;
+
+// Lay out a trace event as a packet.
+WEAK void write_trace_packet(halide_trace_packet_t *packet, const halide_trace_event_t *e,
+                             int32_t id, uint32_t total_size, uint32_t value_bytes,
+                             uint32_t coords_bytes, uint32_t name_bytes, uint32_t trace_tag_bytes) {
+    packet->size = total_size;
+    packet->id = id;
+    packet->type = e->type;
+    packet->event = e->event;
+    packet->parent_id = e->parent_id;
+    packet->value_index = e->value_index;
+    packet->dimensions = e->dimensions;
+    if (e->coordinates) {
+        memcpy((void *)packet->coordinates(), e->coordinates, coords_bytes);
+    }
+    if (e->value) {
+        memcpy((void *)packet->value(), e->value, value_bytes);
+    }
+    memcpy((void *)packet->func(), e->func, name_bytes);
+    memcpy((void *)packet->trace_tag(), e->trace_tag ? e->trace_tag : "", trace_tag_bytes);
+}
+
 }}}
 
 extern "C" {
@@ -150,18 +274,39 @@ WEAK int32_t halide_default_trace(void *user_context, const halide_trace_event_t
 
     int32_t my_id = __sync_fetch_and_add(&ids, 1);
 
+    if (e->event == halide_trace_load || e->event == halide_trace_store) {
+        int period = halide_trace_load_store_period;
+        if (period == 0 ||
+            (period > 1 && (__sync_fetch_and_add(&halide_trace_load_store_counter, 1) % period) != 0)) {
+            return my_id;
+        }
+    }
+
+    // Compute the size of the packet for the binary format
+    uint32_t value_bytes = (uint32_t)(e->type.lanes * e->type.bytes());
+    uint32_t header_bytes = (uint32_t)sizeof(halide_trace_packet_t);
+    uint32_t coords_bytes = e->dimensions * (uint32_t)sizeof(int32_t);
+    uint32_t name_bytes = strlen(e->func) + 1;
+    uint32_t trace_tag_bytes = e->trace_tag ? (strlen(e->trace_tag) + 1) : 1;
+    uint32_t total_size_without_padding = header_bytes + value_bytes + coords_bytes + name_bytes + trace_tag_bytes;
+    uint32_t total_size = (total_size_without_padding + 3) & ~3;
+
+    // If we're keeping a ring buffer, that takes precedence over
+    // the trace file.
+    TraceRingBuffer *ring = halide_trace_ring_buffer;
+    if (ring) {
+        if (total_size <= ring->max_packet_size()) {
+            halide_trace_packet_t *packet = ring->acquire_packet(total_size);
+            write_trace_packet(packet, e, my_id, total_size, value_bytes,
+                               coords_bytes, name_bytes, trace_tag_bytes);
+            ring->release_packet(packet);
+        }
+        return my_id;
+    }
+
     // If we're dumping to a file, use a binary format
     int fd = halide_get_trace_file(user_context);
     if (fd > 0) {
-        // Compute the total packet size
-        uint32_t value_bytes = (uint32_t)(e->type.lanes * e->type.bytes());
-        uint32_t header_bytes = (uint32_t)sizeof(halide_trace_packet_t);
-        uint32_t coords_bytes = e->dimensions * (uint32_t)sizeof(int32_t);
-        uint32_t name_bytes = strlen(e->func) + 1;
-        uint32_t trace_tag_bytes = e->trace_tag ? (strlen(e->trace_tag) + 1) : 1;
-        uint32_t total_size_without_padding = header_bytes + value_bytes + coords_bytes + name_bytes + trace_tag_bytes;
-        uint32_t total_size = (total_size_without_padding + 3) & ~3;
-
         // Claim some space to write to in the trace buffer
         halide_trace_packet_t *packet = halide_trace_buffer->acquire_packet(user_context, fd, total_size);
 
@@ -170,21 +315,8 @@ WEAK int32_t halide_default_trace(void *user_context, const halide_trace_event_t
         }
 
         // Write a packet into it
-        packet->size = total_size;
-        packet->id = my_id;
-        packet->type = e->type;
-        packet->event = e->event;
-        packet->parent_id = e->parent_id;
-        packet->value_index = e->value_index;
-        packet->dimensions = e->dimensions;
-        if (e->coordinates) {
-            memcpy((void *)packet->coordinates(), e->coordinates, coords_bytes);
-        }
-        if (e->value) {
-            memcpy((void *)packet->value(), e->value, value_bytes);
-        }
-        memcpy((void *)packet->func(), e->func, name_bytes);
-        memcpy((void *)packet->trace_tag(), e->trace_tag ? e->trace_tag : "", trace_tag_bytes);
+        write_trace_packet(packet, e, my_id, total_size, value_bytes,
+                           coords_bytes, name_bytes, trace_tag_bytes);
 
         // Release it
         halide_trace_buffer->release_packet(packet);
@@ -345,6 +477,51 @@ WEAK int halide_get_trace_file(void *user_context) {
     return halide_trace_file;
 }
 
+WEAK int halide_set_trace_ring_buffer(void *user_context, size_t bytes) {
+    TraceRingBuffer *old = halide_trace_ring_buffer;
+    TraceRingBuffer *ring = NULL;
+    if (bytes) {
+        // Keep the packets 4-byte aligned, and the offsets in 32
+        // bits.
+        if (bytes > ((size_t)1 << 31)) {
+            bytes = (size_t)1 << 31;
+        }
+        bytes &= ~(size_t)3;
+        ring = (TraceRingBuffer *)malloc(sizeof(TraceRingBuffer) + bytes);
+        if (!ring) {
+            return halide_error_out_of_memory(user_context);
+        }
+        ring->init((uint8_t *)(ring + 1), (uint32_t)bytes);
+    }
+    // Pipelines must not be running while this is called, so it's
+    // safe to free the old ring.
+    halide_trace_ring_buffer = ring;
+    free(old);
+    return 0;
+}
+
+WEAK int halide_dump_trace_ring_buffer(void *user_context, int fd) {
+    if (!halide_trace_ring_buffer) {
+        return 0;
+    }
+    return halide_trace_ring_buffer->dump(fd);
+}
+
+WEAK void halide_set_trace_ring_buffer_error_fd(int fd) {
+    halide_trace_ring_buffer_error_fd = fd;
+}
+
+WEAK void halide_trace_ring_buffer_on_error(void *user_context) {
+    int fd = halide_trace_ring_buffer_error_fd;
+    if (fd >= 0) {
+        halide_dump_trace_ring_buffer(user_context, fd);
+    }
+}
+
+WEAK void halide_set_trace_sampling(int load_store_period) {
+    halide_trace_load_store_period = load_store_period < 0 ? 0 : load_store_period;
+}
+
 WEAK int32_t halide_trace(void *user_context, const halide_trace_event_t *e) {
     return (*halide_custom_trace)(user_context, e);
 }
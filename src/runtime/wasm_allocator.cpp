@@ -0,0 +1,8 @@
+// WebAssembly linear memory only grows, so memory freed back to
+// malloc is never returned to the host, and a module that allocates
+// and frees the same intermediates on every call fragments its heap
+// until it grows again. Default to the size-class pool instead, which
+// hands the same blocks back out on the next call.
+#define HALIDE_POOL_ALLOCATOR_BY_DEFAULT 1
+
+#include "posix_allocator.cpp"
@@ -0,0 +1,14 @@
+#include "HalideRuntime.h"
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+WEAK CpuFeatures halide_get_cpu_features() {
+    // A module using instructions the engine lacks fails to validate
+    // when it is loaded, so there is nothing to check at run time.
+    const uint64_t known = 0;
+    const uint64_t available = 0;
+    CpuFeatures features = {known, available};
+    return features;
+}
+
+}}} // namespace Halide::Runtime::Internal
@@ -0,0 +1,31 @@
+#include "HalideRuntime.h"
+
+extern "C" {
+
+// Provided by emscripten when linked with pthread support.
+extern int emscripten_num_logical_cores() __attribute__((weak));
+
+WEAK int halide_host_cpu_count() {
+    // Without shared memory there are no workers, so only the main
+    // thread runs tasks.
+    if (emscripten_num_logical_cores) {
+        return emscripten_num_logical_cores();
+    }
+    return 1;
+}
+
+WEAK int halide_set_current_thread_affinity(int cpu) {
+    // Web workers can't be pinned to cores.
+    return -1;
+}
+
+WEAK int halide_host_cpu_capacities(int *capacities, int max_cpus) {
+    return 0;
+}
+
+WEAK int halide_advise_huge_pages(void *ptr, size_t size) {
+    // Linear memory has no pages to advise.
+    return -1;
+}
+
+}
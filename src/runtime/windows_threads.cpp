@@ -29,6 +29,8 @@ extern WIN32API void DeleteCriticalSection(CriticalSection *);
 extern WIN32API void EnterCriticalSection(CriticalSection *);
 extern WIN32API void LeaveCriticalSection(CriticalSection *);
 extern WIN32API int32_t WaitForSingleObject(Thread, int32_t timeout);
+extern WIN32API Thread GetCurrentThread();
+extern WIN32API uintptr_t SetThreadAffinityMask(Thread, uintptr_t);
 
 } // extern "C"
 
@@ -59,6 +61,27 @@ WEAK int halide_host_cpu_count() {
     }
 }
 
+WEAK int halide_set_current_thread_affinity(int cpu) {
+    if (cpu < 0 || cpu >= (int)(sizeof(uintptr_t) * 8)) {
+        return -1;
+    }
+    uintptr_t old = SetThreadAffinityMask(GetCurrentThread(), (uintptr_t)1 << cpu);
+    return old ? 0 : -1;
+}
+
+WEAK int halide_host_cpu_capacities(int *capacities, int max_cpus) {
+    // The efficiency classes of hybrid cores are only available from
+    // GetSystemCpuSetInformation, which older versions of windows
+    // lack, so treat all cores as equal.
+    return 0;
+}
+
+WEAK int halide_advise_huge_pages(void *ptr, size_t size) {
+    // Large pages on windows must be requested up front with
+    // VirtualAlloc, and require a privilege most processes lack.
+    return -1;
+}
+
 WEAK halide_thread *halide_spawn_thread(void(*f)(void *), void *closure) {
     spawned_thread *t = (spawned_thread *)malloc(sizeof(spawned_thread));
     t->f = f;
@@ -1,4 +1,7 @@
 #include "HalideRuntime.h"
+#include "printer.h"
+#include "runtime_internal.h"
+#include "scoped_mutex_lock.h"
 
 // We support three formats, tiff, mat, and tmp.
 //
@@ -18,6 +21,11 @@
 //
 // It would be nice to use a format that web browsers read and display
 // directly, but those formats don't tend to satisfy the above goals.
+//
+// If HL_DEBUG_TO_FILE_ASYNC=1 is set, halide_debug_to_file copies the
+// buffer into a dense staging allocation and returns immediately; a
+// background thread does the actual writing. This keeps file I/O out of
+// the timing of pipelines run with debug_to_file enabled.
 
 namespace Halide { namespace Runtime { namespace Internal {
 
@@ -118,18 +126,8 @@ struct ScopedFile {
     }
 };
 
-}}} // namespace Halide::Runtime::Internal
-
-WEAK extern "C" int32_t halide_debug_to_file(void *user_context, const char *filename,
-                                             int32_t type_code, struct halide_buffer_t *buf) {
-
-    if (buf->dimensions > 4) {
-        halide_error(user_context, "Can't debug_to_file a Func with more than four dimensions\n");
-        return -1;
-    }
-
-    halide_copy_to_host(user_context, buf);
-
+WEAK int32_t write_debug_file(void *user_context, const char *filename,
+                              int32_t type_code, struct halide_buffer_t *buf) {
     ScopedFile f(filename, "wb");
     if (!f.open()) return -2;
 
@@ -355,3 +353,217 @@ WEAK extern "C" int32_t halide_debug_to_file(void *user_context, const char *fil
 
     return 0;
 }
+
+// A write waiting for the background writer. The buffer points at a
+// dense copy of the data, stored after the struct along with the
+// filename.
+struct debug_file_job {
+    debug_file_job *next;
+    const char *filename;
+    int32_t type_code;
+    halide_buffer_t buf;
+    halide_dimension_t dim[4];
+};
+
+struct debug_file_writer {
+    halide_mutex mutex;
+    // Signaled when a job is queued or on shutdown.
+    halide_cond wakeup;
+    // Broadcast when the queue has drained.
+    halide_cond idle;
+    debug_file_job *head, *tail;
+    halide_thread *thread;
+    // The first error since the last flush.
+    int32_t error;
+    bool busy, shutdown;
+    bool initialized, async;
+};
+
+WEAK debug_file_writer debug_writer;
+
+WEAK void debug_file_writer_thread(void *) {
+    debug_file_writer &w = debug_writer;
+    halide_mutex_lock(&w.mutex);
+    while (true) {
+        while (!w.head && !w.shutdown) {
+            halide_cond_wait(&w.wakeup, &w.mutex);
+        }
+        if (!w.head) {
+            break;
+        }
+        debug_file_job *job = w.head;
+        w.head = job->next;
+        if (!w.head) {
+            w.tail = NULL;
+        }
+        w.busy = true;
+        halide_mutex_unlock(&w.mutex);
+
+        // The writer may outlive any user_context.
+        int32_t result = write_debug_file(NULL, job->filename, job->type_code, &job->buf);
+        if (result != 0) {
+            error(NULL) << "Failed to write debug_to_file output " << job->filename
+                        << " with error " << result;
+        }
+        free(job);
+
+        halide_mutex_lock(&w.mutex);
+        if (result != 0 && w.error == 0) {
+            w.error = result;
+        }
+        w.busy = false;
+        if (!w.head) {
+            halide_cond_broadcast(&w.idle);
+        }
+    }
+    halide_mutex_unlock(&w.mutex);
+}
+
+// Copy buf into a new job, with the elements in dense order. Returns
+// NULL if the allocation fails.
+WEAK debug_file_job *make_debug_file_job(const char *filename, int32_t type_code,
+                                         const halide_buffer_t *buf) {
+    halide_dimension_t shape[4];
+    size_t elts = 1;
+    for (int i = 0; i < 4; i++) {
+        if (i < buf->dimensions) {
+            shape[i] = buf->dim[i];
+        } else {
+            shape[i].min = 0;
+            shape[i].extent = 1;
+            shape[i].stride = 0;
+        }
+        elts *= shape[i].extent;
+    }
+    const size_t bytes_per_element = buf->type.bytes();
+    const size_t data_bytes = elts * bytes_per_element;
+    const size_t name_bytes = strlen(filename) + 1;
+
+    debug_file_job *job = (debug_file_job *)malloc(sizeof(debug_file_job) + data_bytes + name_bytes);
+    if (!job) {
+        return NULL;
+    }
+    uint8_t *data = (uint8_t *)(job + 1);
+    char *name = (char *)(data + data_bytes);
+    memcpy(name, filename, name_bytes);
+
+    job->next = NULL;
+    job->filename = name;
+    job->type_code = type_code;
+    job->buf = *buf;
+    job->buf.host = data;
+    job->buf.device = 0;
+    job->buf.device_interface = NULL;
+    job->buf.flags = 0;
+    job->buf.dim = job->dim;
+    int32_t stride = 1;
+    for (int i = 0; i < buf->dimensions; i++) {
+        job->dim[i] = buf->dim[i];
+        job->dim[i].stride = stride;
+        stride *= buf->dim[i].extent;
+    }
+
+    // Rows that are already dense are copied in one go.
+    const size_t row_bytes = shape[0].extent * bytes_per_element;
+    const bool dense_rows = shape[0].stride == 1 || shape[0].extent == 1;
+    uint8_t *dst = data;
+    for (int32_t dim3 = shape[3].min; dim3 < shape[3].extent + shape[3].min; ++dim3) {
+        for (int32_t dim2 = shape[2].min; dim2 < shape[2].extent + shape[2].min; ++dim2) {
+            for (int32_t dim1 = shape[1].min; dim1 < shape[1].extent + shape[1].min; ++dim1) {
+                int idx[] = {shape[0].min, dim1, dim2, dim3};
+                if (dense_rows) {
+                    memcpy(dst, buf->address_of(idx), row_bytes);
+                    dst += row_bytes;
+                    continue;
+                }
+                for (int32_t dim0 = shape[0].min; dim0 < shape[0].extent + shape[0].min; ++dim0) {
+                    idx[0] = dim0;
+                    memcpy(dst, buf->address_of(idx), bytes_per_element);
+                    dst += bytes_per_element;
+                }
+            }
+        }
+    }
+    return job;
+}
+
+}}} // namespace Halide::Runtime::Internal
+
+extern "C" {
+
+WEAK int32_t halide_debug_to_file(void *user_context, const char *filename,
+                                  int32_t type_code, struct halide_buffer_t *buf) {
+
+    if (buf->dimensions > 4) {
+        halide_error(user_context, "Can't debug_to_file a Func with more than four dimensions\n");
+        return -1;
+    }
+
+    halide_copy_to_host(user_context, buf);
+
+    debug_file_writer &w = debug_writer;
+    {
+        ScopedMutexLock lock(&w.mutex);
+        if (!w.initialized) {
+            const char *async = getenv("HL_DEBUG_TO_FILE_ASYNC");
+            w.async = async && atoi(async) != 0;
+            w.initialized = true;
+        }
+        if (w.async && !w.thread && !w.shutdown) {
+            w.thread = halide_spawn_thread(debug_file_writer_thread, NULL);
+            if (!w.thread) {
+                w.async = false;
+            }
+        }
+        if (!w.async || w.shutdown) {
+            return write_debug_file(user_context, filename, type_code, buf);
+        }
+    }
+
+    // Make the staging copy outside the lock, so that pipelines calling
+    // debug_to_file in parallel don't serialize on it.
+    debug_file_job *job = make_debug_file_job(filename, type_code, buf);
+    if (!job) {
+        return write_debug_file(user_context, filename, type_code, buf);
+    }
+
+    ScopedMutexLock lock(&w.mutex);
+    if (w.tail) {
+        w.tail->next = job;
+    } else {
+        w.head = job;
+    }
+    w.tail = job;
+    halide_cond_signal(&w.wakeup);
+    return 0;
+}
+
+WEAK int halide_debug_to_file_flush(void *user_context) {
+    debug_file_writer &w = debug_writer;
+    ScopedMutexLock lock(&w.mutex);
+    while (w.head || w.busy) {
+        halide_cond_wait(&w.idle, &w.mutex);
+    }
+    int32_t result = w.error;
+    w.error = 0;
+    return result;
+}
+
+#ifndef WINDOWS
+__attribute__((destructor))
+#endif
+WEAK void halide_debug_to_file_shutdown() {
+    debug_file_writer &w = debug_writer;
+    halide_mutex_lock(&w.mutex);
+    halide_thread *thread = w.thread;
+    w.shutdown = true;
+    halide_cond_signal(&w.wakeup);
+    halide_mutex_unlock(&w.mutex);
+    if (thread) {
+        // The writer drains the queue before it exits.
+        halide_join_thread(thread);
+        w.thread = NULL;
+    }
+}
+
+}
@@ -152,3 +152,10 @@ define weak_odr void @x86_cpuid_halide(i32* %info) nounwind uwtable {
 
   ret void
 }
+
+; The cycle counter read by pipelines compiled with latency telemetry.
+define weak_odr i64 @halide_telemetry_ticks() nounwind alwaysinline {
+  %ticks = tail call i64 @llvm.readcyclecounter()
+  ret i64 %ticks
+}
+declare i64 @llvm.readcyclecounter()
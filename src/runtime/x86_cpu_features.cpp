@@ -19,7 +19,8 @@ WEAK CpuFeatures halide_get_cpu_features() {
                             (1ULL << halide_target_feature_avx512) |
                             (1ULL << halide_target_feature_avx512_knl) |
                             (1ULL << halide_target_feature_avx512_skylake) |
-                            (1ULL << halide_target_feature_avx512_cannonlake));
+                            (1ULL << halide_target_feature_avx512_cannonlake) |
+                            (1ULL << halide_target_feature_avx512_vnni));
 
     uint64_t available = 0;
 
@@ -61,6 +62,8 @@ WEAK CpuFeatures halide_get_cpu_features() {
         const uint32_t avx512_knl = avx512 | avx512pf | avx512er;
         const uint32_t avx512_skylake = avx512 | avx512vl | avx512bw | avx512dq;
         const uint32_t avx512_cannonlake = avx512_skylake | avx512ifma; // Assume ifma => vbmi
+        // In ecx, vs ebx for the above
+        const uint32_t avx512vnni = 1U << 11;
         if ((info2[1] & avx2) == avx2) {
             available |= 1ULL << halide_target_feature_avx2;
         }
@@ -71,6 +74,9 @@ WEAK CpuFeatures halide_get_cpu_features() {
             }
             if ((info2[1] & avx512_skylake) == avx512_skylake) {
                 available |= 1ULL << halide_target_feature_avx512_skylake;
+                if ((info2[2] & avx512vnni) == avx512vnni) {
+                    available |= 1ULL << halide_target_feature_avx512_vnni;
+                }
             }
             if ((info2[1] & avx512_cannonlake) == avx512_cannonlake) {
                 available |= 1ULL << halide_target_feature_avx512_cannonlake;
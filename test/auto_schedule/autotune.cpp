@@ -0,0 +1,56 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    int W = 1000;
+    int H = 1000;
+
+    Buffer<uint16_t> input(W + 2, H + 2);
+    for (int y = 0; y < input.height(); y++) {
+        for (int x = 0; x < input.width(); x++) {
+            input(x, y) = rand() & 0xfff;
+        }
+    }
+
+    Var x("x"), y("y");
+    Func blur_x("blur_x"), blur_y("blur_y");
+    blur_x(x, y) = (input(x, y) + input(x + 1, y) + input(x + 2, y)) / 3;
+    blur_y(x, y) = (blur_x(x, y) + blur_x(x, y + 1) + blur_x(x, y + 2)) / 3;
+
+    // Provide estimates on the pipeline output
+    blur_y.estimate(x, 0, W).estimate(y, 0, H);
+
+    // Auto-schedule the pipeline, timing a few candidate schedules
+    Target target = get_jit_target_from_environment();
+    Pipeline p(blur_y);
+    std::string schedule = p.auto_schedule(target, MachineParams::generic(), 4);
+
+    if (schedule.find("// Autotuned over") == std::string::npos) {
+        printf("Expected an autotuned schedule, got:\n%s\n", schedule.c_str());
+        return -1;
+    }
+
+    // Inspect the schedule
+    blur_y.print_loop_nest();
+
+    // Run the schedule
+    Buffer<uint16_t> out = p.realize(W, H);
+
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            uint16_t bx0 = (input(x, y) + input(x + 1, y) + input(x + 2, y)) / 3;
+            uint16_t bx1 = (input(x, y + 1) + input(x + 1, y + 1) + input(x + 2, y + 1)) / 3;
+            uint16_t bx2 = (input(x, y + 2) + input(x + 1, y + 2) + input(x + 2, y + 2)) / 3;
+            uint16_t correct = (bx0 + bx1 + bx2) / 3;
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,44 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    // A large reduction to a scalar has no pure dimension to parallelize
+    // over. The auto-scheduler should rfactor it into slices that can be
+    // computed in parallel.
+    const int N = 1 << 20;
+    Buffer<int> input(N);
+    for (int i = 0; i < N; i++) {
+        input(i) = (i * 7) % 1001 - 500;
+    }
+
+    Func total("total");
+    RDom r(0, N);
+    total() = 0;
+    total() += input(r);
+
+    Target target = get_jit_target_from_environment();
+    Pipeline p(total);
+
+    MachineParams params = MachineParams::generic();
+    std::string schedule = p.auto_schedule(target, params);
+
+    if (!target.has_gpu_feature() && schedule.find("rfactor") == std::string::npos) {
+        printf("Expected the reduction to be rfactored:\n%s\n", schedule.c_str());
+        return -1;
+    }
+
+    Buffer<int> out = p.realize();
+    int correct = 0;
+    for (int i = 0; i < N; i++) {
+        correct += input(i);
+    }
+    if (out() != correct) {
+        printf("total = %d instead of %d\n", out(), correct);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
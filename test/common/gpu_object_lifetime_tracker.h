@@ -21,7 +21,7 @@ class GpuObjectLifetimeTracker {
             is_global(is_global), total_created(0), live_count(0) {}
     };
 
-    std::array<ObjectType, 13> object_types = {{
+    std::array<ObjectType, 14> object_types = {{
         // OpenCL objects
         {"clCreateContext", "clReleaseContext", true},
         {"clCreateCommandQueue", "clReleaseCommandQueue", true},
@@ -34,6 +34,9 @@ class GpuObjectLifetimeTracker {
         // CUDA objects
         {"cuCtxCreate", "cuCtxDestroy", true},
         {"cuModuleLoad", "cuModuleUnload"},
+        // This must come before cuMemAlloc, as "cuMemFreeHost"
+        // contains "cuMemFree".
+        {"cuMemHostAlloc", "cuMemFreeHost"},
         {"cuMemAlloc", "cuMemFree"},
 
         // Metal objects
@@ -53,9 +56,11 @@ public:
             if (strstr(str, o.created)) {
                 o.total_created++;
                 o.live_count++;
+                return;
             }
             else if (strstr(str, o.destroyed)) {
                 o.live_count--;
+                return;
             }
         }
     }
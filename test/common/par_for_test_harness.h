@@ -0,0 +1,142 @@
+#ifndef PAR_FOR_TEST_HARNESS_H
+#define PAR_FOR_TEST_HARNESS_H
+
+// Shared by the AOT tests of the alternative do_par_for
+// implementations. Deliberately does not include Halide.h.
+
+#include <algorithm>
+#include <map>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+
+namespace Halide {
+namespace Internal {
+namespace Test {
+
+// A job (a whole parallel loop) or a task (one claim of iterations of
+// it) recorded by halide_thread_pool_record_events.
+struct ThreadPoolEvent {
+    bool is_job;
+    // The job the event belongs to, and the lane of the thread that
+    // launched the job or ran the task.
+    int job, lane;
+    // For jobs, the number of tasks. For tasks, the first index
+    // claimed and how many were claimed together.
+    int index, size;
+};
+
+inline bool read_event_field(const char *line, const char *field, int *value) {
+    const char *p = strstr(line, field);
+    return p && sscanf(p + strlen(field), "%d", value) == 1;
+}
+
+// Parse the Chrome trace written by halide_thread_pool_events_json,
+// which has one event per line.
+inline std::vector<ThreadPoolEvent> thread_pool_events() {
+    int length = halide_thread_pool_events_json(nullptr, 0);
+    std::vector<char> json(length + 1);
+    halide_thread_pool_events_json(json.data(), json.size());
+
+    std::vector<ThreadPoolEvent> events;
+    for (char *line = strtok(json.data(), "\n"); line; line = strtok(nullptr, "\n")) {
+        if (!strstr(line, "\"cat\":")) {
+            continue;
+        }
+        ThreadPoolEvent e = {strstr(line, "\"cat\":\"job\"") != nullptr, 0, 0, 0, 1};
+        bool ok = (read_event_field(line, "\"tid\":", &e.lane) &&
+                   read_event_field(line, "\"job\":", &e.job));
+        if (e.is_job) {
+            ok &= read_event_field(line, "\"tasks\":", &e.size);
+        } else {
+            ok &= read_event_field(line, "\"index\":", &e.index);
+            // Single tasks have no chunk field.
+            read_event_field(line, "\"chunk\":", &e.size);
+        }
+        if (!ok) {
+            printf("Malformed thread pool event: %s\n", line);
+            events.clear();
+            return events;
+        }
+        events.push_back(e);
+    }
+    return events;
+}
+
+// The tasks of each job, in the order of their indices.
+inline std::map<int, std::vector<ThreadPoolEvent>> tasks_by_job(const std::vector<ThreadPoolEvent> &events) {
+    std::map<int, std::vector<ThreadPoolEvent>> tasks;
+    for (const ThreadPoolEvent &e : events) {
+        if (!e.is_job) {
+            tasks[e.job].push_back(e);
+        }
+    }
+    for (auto &t : tasks) {
+        std::sort(t.second.begin(), t.second.end(),
+                  [](const ThreadPoolEvent &a, const ThreadPoolEvent &b) { return a.index < b.index; });
+    }
+    return tasks;
+}
+
+// Run a pipeline with a parallel loop over the rows of its output,
+// using the given do_par_for, for a range of thread counts (including
+// more threads than rows) and output sizes. If limit_threads is set,
+// each thread count also gets a thread budget smaller than the pool.
+// Each size is run calls times in a row, as in a pipeline called
+// repeatedly. Checks every output against correct(x, y), and the thread
+// pool events recorded by each call with
+// check_events(events, threads, rows), which returns false on failure.
+template<typename Pipeline, typename Correct, typename CheckEvents>
+int run_par_for_test(halide_do_par_for_t par_for, Pipeline pipeline,
+                     Correct correct, CheckEvents check_events,
+                     bool limit_threads, int calls) {
+    halide_do_par_for_t old_par_for = halide_set_custom_do_par_for(par_for);
+
+    for (int threads = 1; threads <= 16; threads++) {
+        halide_set_num_threads(threads);
+        if (limit_threads) {
+            halide_thread_pool_set_limits(nullptr, threads % 3, 0);
+        }
+        for (int rows = 1; rows < 100; rows += 7) {
+            for (int call = 0; call < calls; call++) {
+                Halide::Runtime::Buffer<int> out(16, rows);
+                out.fill(-1);
+                halide_thread_pool_record_events(1 << 16);
+                int ret = pipeline(out);
+                std::vector<ThreadPoolEvent> events = thread_pool_events();
+                halide_thread_pool_record_events(0);
+                if (ret) {
+                    printf("Non zero exit code: %d\n", ret);
+                    return -1;
+                }
+                for (int y = 0; y < out.height(); y++) {
+                    for (int x = 0; x < out.width(); x++) {
+                        if (out(x, y) != correct(x, y)) {
+                            printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct(x, y));
+                            return -1;
+                        }
+                    }
+                }
+                if (!check_events(events, threads, rows)) {
+                    printf("with %d threads, %d rows, call %d\n", threads, rows, call);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    halide_thread_pool_set_limits(nullptr, 0, 0);
+    halide_set_custom_do_par_for(old_par_for);
+    halide_shutdown_thread_pool();
+    return 0;
+}
+
+}  // namespace Test
+}  // namespace Internal
+}  // namespace Halide
+
+#endif  // PAR_FOR_TEST_HARNESS_H
@@ -0,0 +1,100 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Count the times the pipeline is lowered.
+class CountLowerings : public IRMutator2 {
+public:
+    using IRMutator2::mutate;
+
+    int count = 0;
+
+    Stmt mutate(const Stmt &s) override {
+        count++;
+        return s;
+    }
+};
+
+int check(const Buffer<int> &out, const Buffer<int> &in, int scale) {
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            int correct = in(x, y) * scale + x;
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const int W = 64, H = 32;
+
+    ImageParam input(Int(32), 2);
+    Param<int> scale;
+    Var x("x"), y("y");
+    Func f("f");
+    f(x, y) = input(x, y) * scale + x;
+    f.vectorize(x, 8);
+
+    Pipeline p(f);
+    CountLowerings *counter = new CountLowerings;
+    p.add_custom_lowering_pass(counter);
+    p.set_adaptive_jit(3);
+
+    Buffer<int> in(W, H);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            in(x, y) = x * 3 - y;
+        }
+    }
+    input.set(in);
+
+    // The first few calls run the general code; the third specializes
+    // the pipeline for scale = 5 and this input.
+    scale.set(5);
+    for (int i = 0; i < 4; i++) {
+        Buffer<int> out(W, H);
+        p.realize(out);
+        if (check(out, in, 5)) {
+            return -1;
+        }
+    }
+    if (counter->count != 2) {
+        printf("Expected two compilations, got %d\n", counter->count);
+        return -1;
+    }
+
+    // Other values still get the right answer from the general code.
+    scale.set(7);
+    Buffer<int> out(W, H);
+    p.realize(out);
+    if (check(out, in, 7)) {
+        return -1;
+    }
+
+    // As does a differently-shaped input.
+    Buffer<int> in2(W * 2, H);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W * 2; x++) {
+            in2(x, y) = x + y;
+        }
+    }
+    input.set(in2);
+    scale.set(5);
+    p.realize(out);
+    if (check(out, in2, 5)) {
+        return -1;
+    }
+
+    if (counter->count != 2) {
+        printf("Expected two compilations, got %d\n", counter->count);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int malloc_count = 0;
+int free_count = 0;
+
+void *my_malloc(void *user_context, size_t x) {
+    malloc_count++;
+    void *orig = malloc(x+32);
+    void *ptr = (void *)((((size_t)orig + 32) >> 5) << 5);
+    ((void **)ptr)[-1] = orig;
+    return ptr;
+}
+
+void my_free(void *user_context, void *ptr) {
+    free_count++;
+    free(((void**)ptr)[-1]);
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment().with_feature(Target::ArenaAllocations);
+    if (t.has_gpu_feature()) {
+        printf("Not running test for gpu targets\n");
+        return 0;
+    }
+
+    // A chain of dynamically-sized intermediates. Each one would
+    // normally get its own call to halide_malloc.
+    Func f1, f2, f3, f4, out;
+    Var x;
+    f1(x) = x;
+    f2(x) = f1(x) + f1(x + 1);
+    f3(x) = f2(x) * 2;
+    f4(x) = f3(x) + f3(x + 1);
+    out(x) = f4(x) - 1;
+
+    f1.compute_root();
+    f2.compute_root();
+    f3.compute_root();
+    f4.compute_root();
+
+    out.set_custom_allocator(my_malloc, my_free);
+    out.compile_jit(t);
+
+    for (int size : {1, 17, 1000}) {
+        malloc_count = 0;
+        free_count = 0;
+        Buffer<int> result = out.realize(size, t);
+
+        for (int i = 0; i < size; i++) {
+            int correct = 8 * i + 7;
+            if (result(i) != correct) {
+                printf("result(%d) = %d instead of %d\n", i, result(i), correct);
+                return -1;
+            }
+        }
+
+        if (malloc_count != 1 || free_count != 1) {
+            printf("Expected a single arena allocation, got %d mallocs and %d frees\n",
+                   malloc_count, free_count);
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
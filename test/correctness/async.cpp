@@ -0,0 +1,84 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Var x, y;
+
+    {
+        // A scanline pipeline, with the producer running ahead of the
+        // consumer on another thread.
+        Func f, g;
+        f(x, y) = x + y;
+        g(x, y) = f(x, y - 1) + f(x, y) + f(x, y + 1);
+
+        f.compute_at(g, y).store_root().async();
+
+        Buffer<int> result = g.realize(256, 256);
+        for (int y = 0; y < result.height(); y++) {
+            for (int x = 0; x < result.width(); x++) {
+                int correct = 3 * (x + y);
+                if (result(x, y) != correct) {
+                    printf("result(%d, %d) = %d instead of %d\n", x, y, result(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    {
+        // An async producer computed per tile of a parallel loop.
+        Func f, g;
+        Var yo, yi;
+        f(x, y) = x * y;
+        g(x, y) = f(x, y) + f(x + 1, y);
+
+        g.split(y, yo, yi, 16).parallel(yo);
+        f.compute_at(g, yi).store_at(g, yo).async();
+
+        Buffer<int> result = g.realize(100, 100);
+        for (int y = 0; y < result.height(); y++) {
+            for (int x = 0; x < result.width(); x++) {
+                int correct = x * y + (x + 1) * y;
+                if (result(x, y) != correct) {
+                    printf("result(%d, %d) = %d instead of %d\n", x, y, result(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    {
+        // The same on a single thread, where the producer runs to
+        // completion before the consumer starts.
+        Func f, g;
+        f(x, y) = x - y;
+        g(x, y) = f(x, y) * 2;
+
+        f.compute_at(g, y).store_root().async();
+        g.set_custom_do_par_for([](void *ctx, halide_task_t task, int min, int size, uint8_t *closure) {
+            for (int i = min; i < min + size; i++) {
+                int result = task(ctx, i, closure);
+                if (result) {
+                    return result;
+                }
+            }
+            return 0;
+        });
+
+        Buffer<int> result = g.realize(64, 64);
+        for (int y = 0; y < result.height(); y++) {
+            for (int x = 0; x < result.width(); x++) {
+                int correct = (x - y) * 2;
+                if (result(x, y) != correct) {
+                    printf("result(%d, %d) = %d instead of %d\n", x, y, result(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    const int W = 256, H = 256, bins = 64;
+
+    Buffer<uint8_t> in(W, H);
+    int reference_hist[bins] = {0};
+    int reference_max[bins];
+    float reference_sum[bins] = {0};
+    for (int i = 0; i < bins; i++) {
+        reference_max[i] = -1;
+    }
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            in(x, y) = rand() & 0xff;
+            int b = in(x, y) % bins;
+            reference_hist[b] += 1;
+            reference_max[b] = std::max(reference_max[b], x + y);
+            reference_sum[b] += in(x, y);
+        }
+    }
+
+    Var x("x");
+    RDom r(in);
+    Expr bin = cast<int>(in(r.x, r.y)) % bins;
+
+    Target target = get_jit_target_from_environment();
+
+    // An integer add, which is a single atomic instruction.
+    {
+        Func hist("hist");
+        hist(x) = 0;
+        hist(bin) += 1;
+        if (target.has_feature(Target::CUDA)) {
+            RVar rxo, rxi, ryo, ryi;
+            hist.update().atomic().gpu_tile(r.x, r.y, rxo, ryo, rxi, ryi, 16, 16);
+        } else {
+            hist.update().atomic().parallel(r.y);
+        }
+
+        Buffer<int32_t> result = hist.realize(bins);
+        result.copy_to_host();
+        for (int i = 0; i < bins; i++) {
+            if (result(i) != reference_hist[i]) {
+                printf("hist(%d) = %d instead of %d\n", i, result(i), reference_hist[i]);
+                return -1;
+            }
+        }
+    }
+
+    // An integer max.
+    {
+        Func m("m");
+        m(x) = -1;
+        m(bin) = max(m(bin), r.x + r.y);
+        m.atomic();
+        m.update().parallel(r.y);
+
+        Buffer<int32_t> result = m.realize(bins);
+        for (int i = 0; i < bins; i++) {
+            if (result(i) != reference_max[i]) {
+                printf("m(%d) = %d instead of %d\n", i, result(i), reference_max[i]);
+                return -1;
+            }
+        }
+    }
+
+    // A floating point add, which uses a compare-and-swap loop. The
+    // values are small integers, so the sum is exact in any order.
+    {
+        Func sum("sum");
+        sum(x) = 0.0f;
+        sum(bin) += cast<float>(in(r.x, r.y));
+        sum.update().atomic().parallel(r.y);
+
+        Buffer<float> result = sum.realize(bins);
+        for (int i = 0; i < bins; i++) {
+            if (result(i) != reference_sum[i]) {
+                printf("sum(%d) = %f instead of %f\n", i, result(i), reference_sum[i]);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+class CountPrefetches : public IRMutator2 {
+public:
+    using IRMutator2::mutate;
+    using IRMutator2::visit;
+
+    int count = 0;
+
+    Expr visit(const Call *op) override {
+        if (op->is_intrinsic(Call::prefetch)) {
+            count++;
+        }
+        return IRMutator2::visit(op);
+    }
+};
+
+int count_prefetches(Func f, const Target &t) {
+    CountPrefetches *counter = new CountPrefetches;
+    f.add_custom_lowering_pass(counter);
+    f.compile_jit(t);
+    return counter->count;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment().with_feature(Target::AutoPrefetch);
+
+    const int W = 1024, H = 256;
+    Buffer<float> in(H, W);
+    for (int y = 0; y < W; y++) {
+        for (int x = 0; x < H; x++) {
+            in(x, y) = rand() & 0xff;
+        }
+    }
+    ImageParam input(Float(32), 2, "input");
+    input.set(in);
+
+    Var x("x"), y("y");
+
+    // Reading a column of the input moves a row of the input per
+    // iteration of x, which should be prefetched.
+    {
+        Func transpose("transpose");
+        transpose(x, y) = input(y, x) * 2.0f;
+
+        if (count_prefetches(transpose, t) == 0) {
+            printf("Expected a prefetch of the input of the transpose\n");
+            return -1;
+        }
+
+        Buffer<float> out = transpose.realize(W, H, t);
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                float correct = in(y, x) * 2.0f;
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %f instead of %f\n", x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    // Reading along a row is left to the hardware prefetcher.
+    {
+        Func copy("copy");
+        copy(x, y) = input(x, y) * 2.0f;
+
+        if (count_prefetches(copy, t) != 0) {
+            printf("Did not expect a prefetch of the input of the copy\n");
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
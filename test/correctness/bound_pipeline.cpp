@@ -0,0 +1,61 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Buffer<int> lut(8);
+    for (int i = 0; i < 8; i++) {
+        lut(i) = i * i;
+    }
+
+    ImageParam input(Int(32), 1, "input");
+    Param<int> offset("offset");
+    Param<float> scale("scale");
+    Var x("x");
+
+    // Two outputs, one of which is a Tuple.
+    Func f("f"), g("g");
+    f(x) = input(x) * scale + lut(x % 8);
+    g(x) = Tuple(input(x) + offset, cast<uint8_t>(x));
+
+    Pipeline p({f, g});
+    Callable c = p.bind();
+
+    // The call-time arguments are in the order given by infer_arguments.
+    std::vector<Argument> args = p.infer_arguments();
+    if (args.size() != 3 ||
+        args[0].name != "input" ||
+        args[1].name != "offset" ||
+        args[2].name != "scale") {
+        printf("Unexpected argument order\n");
+        return -1;
+    }
+
+    Buffer<int> in(16);
+    Buffer<float> f_out(16);
+    Buffer<int> g_out0(16);
+    Buffer<uint8_t> g_out1(16);
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 16; j++) {
+            in(j) = i * 100 + j;
+        }
+        c(in, i, 0.5f, f_out, g_out0, g_out1);
+
+        for (int j = 0; j < 16; j++) {
+            float correct_f = in(j) * 0.5f + (j % 8) * (j % 8);
+            if (f_out(j) != correct_f) {
+                printf("f(%d) = %f instead of %f\n", j, f_out(j), correct_f);
+                return -1;
+            }
+            if (g_out0(j) != in(j) + i || g_out1(j) != j) {
+                printf("g(%d) = {%d, %d} instead of {%d, %d}\n",
+                       j, g_out0(j), g_out1(j), in(j) + i, j);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -220,6 +220,12 @@ bool test_all(int vector_width, Target t) {
             repeat_edge(input),
             test_min, test_extent, test_min, test_extent,
             vector_width, t);
+        // Staged into a padded buffer.
+        success &= check_repeat_edge(
+            input,
+            stage_padded(input, repeat_edge(input), 8),
+            -8, W + 16, -8, H + 16,
+            vector_width, t);
     }
 
     // constant_exterior:
@@ -258,6 +264,12 @@ bool test_all(int vector_width, Target t) {
             constant_exterior(input, exterior),
             test_min, test_extent, test_min, test_extent,
             vector_width, t);
+        // Staged into a padded buffer.
+        success &= check_constant_exterior(
+            input, exterior,
+            stage_padded(input, constant_exterior(input, exterior), 8),
+            -8, W + 16, -8, H + 16,
+            vector_width, t);
     }
 
     // repeat_image:
@@ -330,6 +342,12 @@ bool test_all(int vector_width, Target t) {
             mirror_image(input),
             test_min, test_extent, test_min, test_extent,
             vector_width, t);
+        // Staged into a padded buffer.
+        success &= check_mirror_image(
+            input,
+            stage_padded(input, mirror_image(input), 8),
+            -8, W + 16, -8, H + 16,
+            vector_width, t);
     }
 
     // mirror_interior:
@@ -0,0 +1,86 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+bool error_occurred = false;
+void my_error_handler(void *user_context, const char *msg) {
+    error_occurred = true;
+}
+
+// Realize f over [0, 32), and return whether that raised an error.
+bool realize_fails(Func f, const Target &t) {
+    error_occurred = false;
+    Buffer<float> out(32);
+    f.realize(out, t);
+    return error_occurred;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment().with_feature(Target::CheckShapesOnce);
+
+    ImageParam in(Float(32), 1);
+    Param<int> offset;
+    Param<float> gain;
+    Var x;
+
+    Func f;
+    f(x) = in(x + offset) * gain;
+    in.dim(0).set_stride(1);
+    f.set_error_handler(my_error_handler);
+    f.compile_jit(t);
+
+    Buffer<float> big(64), small(16), storage(128);
+    big.fill(1.0f);
+    small.fill(1.0f);
+    storage.fill(1.0f);
+    // Every other element of storage.
+    halide_dimension_t strided_shape[] = {{0, 64, 2}};
+    Buffer<float> strided(storage.data(), 1, strided_shape);
+
+    // Call with the same shapes many times, with different values of a
+    // param the checks don't depend on.
+    in.set(big);
+    offset.set(8);
+    for (int i = 0; i < 10; i++) {
+        gain.set((float)i);
+        if (realize_fails(f, t)) {
+            printf("Error incorrectly raised\n");
+            return -1;
+        }
+    }
+
+    // Each of these breaks a check after the shapes above passed
+    // them, and must still fail.
+    in.set(small);
+    if (!realize_fails(f, t)) {
+        printf("Error not raised for an input that is too small\n");
+        return -1;
+    }
+
+    in.set(big);
+    offset.set(40);
+    if (!realize_fails(f, t)) {
+        printf("Error not raised for an offset past the end of the input\n");
+        return -1;
+    }
+
+    offset.set(8);
+    in.set(strided);
+    if (!realize_fails(f, t)) {
+        printf("Error not raised for an input with the wrong stride\n");
+        return -1;
+    }
+
+    // And the shapes that passed still pass.
+    in.set(big);
+    for (int i = 0; i < 3; i++) {
+        if (realize_fails(f, t)) {
+            printf("Error incorrectly raised after a failed check\n");
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int check(const Buffer<int> &out) {
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            int correct = std::min(x * 5 + y, 100);
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const int W = 128, H = 64;
+    Var x("x"), y("y");
+
+    // Compile in the background, and wait for it.
+    {
+        Func f("f");
+        f(x, y) = min(x * 5 + y, 100);
+        f.vectorize(x, 8).parallel(y);
+
+        Pipeline p(f);
+        std::future<void *> compiled = p.compile_jit_async();
+        if (compiled.get() == nullptr) {
+            printf("compile_jit_async returned a null function\n");
+            return -1;
+        }
+        Buffer<int> out = p.realize(W, H);
+        if (check(out)) {
+            return -1;
+        }
+    }
+
+    // Tiered compilation: the quick version can be used straight away,
+    // and the optimized one once it's ready.
+    {
+        Func f("f");
+        f(x, y) = min(x * 5 + y, 100);
+        f.vectorize(x, 8).parallel(y);
+
+        Pipeline p(f);
+        std::future<void *> optimized = p.compile_jit_async(get_jit_target_from_environment(), true);
+        Buffer<int> out = p.realize(W, H);
+        if (check(out)) {
+            return -1;
+        }
+
+        void *fn = optimized.get();
+        out = p.realize(W, H);
+        if (check(out)) {
+            return -1;
+        }
+        if (p.compile_jit() != fn) {
+            printf("Pipeline didn't switch to the optimized jit module\n");
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    const int W = 64, H = 32;
+    const int num_pipelines = 8;
+    Var x("x"), y("y");
+
+    ImageParam input(Int(32), 2, "input");
+    Buffer<int> in(W, H);
+    in.for_each_element([&](int x, int y) {
+        in(x, y) = x * 3 + y;
+    });
+    input.set(in);
+
+    // Many small pipelines, some of which share a runtime feature
+    // (parallelism) and some of which use none.
+    std::vector<Pipeline> pipelines;
+    for (int i = 0; i < num_pipelines; i++) {
+        Func f("f" + std::to_string(i));
+        f(x, y) = input(x, y) * i + i;
+        if (i % 2) {
+            f.vectorize(x, 8).parallel(y);
+        }
+        pipelines.push_back(Pipeline(f));
+    }
+
+    std::vector<void *> functions = Pipeline::compile_jit(pipelines);
+    if ((int)functions.size() != num_pipelines) {
+        printf("compile_jit returned %d functions instead of %d\n",
+               (int)functions.size(), num_pipelines);
+        return -1;
+    }
+
+    for (int i = 0; i < num_pipelines; i++) {
+        if (functions[i] == nullptr) {
+            printf("compile_jit returned a null function for pipeline %d\n", i);
+            return -1;
+        }
+        // The Pipelines are already compiled, so realizing them must
+        // not compile them again.
+        if (pipelines[i].compile_jit() != functions[i]) {
+            printf("Pipeline %d was compiled again\n", i);
+            return -1;
+        }
+
+        Buffer<int> out = pipelines[i].realize(W, H);
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                int correct = in(x, y) * i + i;
+                if (out(x, y) != correct) {
+                    printf("pipeline %d: out(%d, %d) = %d instead of %d\n",
+                           i, x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
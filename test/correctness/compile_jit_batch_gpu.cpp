@@ -0,0 +1,60 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (!target.has_gpu_feature()) {
+        printf("Not running test because no gpu target enabled\n");
+        return 0;
+    }
+
+    const int W = 64, H = 32;
+    const int num_pipelines = 4;
+    Var x("x"), y("y"), xi("xi"), yi("yi");
+
+    // Each pipeline has its own kernels, and its own device module
+    // state, in the shared llvm module.
+    std::vector<Pipeline> pipelines;
+    for (int i = 0; i < num_pipelines; i++) {
+        Func f("f" + std::to_string(i)), g("g" + std::to_string(i));
+        f(x, y) = x * (i + 1) + y;
+        g(x, y) = f(x, y) + f(x + 1, y) * i;
+        f.compute_root().gpu_tile(x, y, xi, yi, 8, 8);
+        g.gpu_tile(x, y, xi, yi, 16, 4);
+        pipelines.push_back(Pipeline(g));
+    }
+
+    // Compile the batch twice, so that the second batch's kernels are
+    // loaded while the first batch's are still alive.
+    for (int batch = 0; batch < 2; batch++) {
+        Target t = batch == 0 ? target : target.with_feature(Target::NoAsserts);
+        std::vector<void *> functions = Pipeline::compile_jit(pipelines, t);
+        if ((int)functions.size() != num_pipelines) {
+            printf("compile_jit returned %d functions instead of %d\n",
+                   (int)functions.size(), num_pipelines);
+            return -1;
+        }
+
+        // Realize them in reverse order, so that kernels aren't only
+        // loaded in the order they were compiled.
+        for (int i = num_pipelines - 1; i >= 0; i--) {
+            Buffer<int> out = pipelines[i].realize(W, H, t);
+            out.copy_to_host();
+            for (int y = 0; y < H; y++) {
+                for (int x = 0; x < W; x++) {
+                    int correct = x * (i + 1) + y + ((x + 1) * (i + 1) + y) * i;
+                    if (out(x, y) != correct) {
+                        printf("batch %d, pipeline %d: out(%d, %d) = %d instead of %d\n",
+                               batch, i, x, y, out(x, y), correct);
+                        return -1;
+                    }
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+extern "C" DLLEXPORT int batch_extern(int x, int y) {
+    return x * 7 - y;
+}
+HalideExtern_2(int, batch_extern, int, int);
+
+template<typename F>
+bool check(const Buffer<int> &out, const char *name, F correct) {
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            if (out(x, y) != correct(x, y)) {
+                printf("%s(%d, %d) = %d instead of %d\n", name, x, y, out(x, y), correct(x, y));
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    const int W = 64, H = 32;
+    Var x("x"), y("y");
+
+    Param<int> offset("offset");
+    ImageParam input(Int(32), 2, "input");
+    Buffer<int> in(W, H);
+    in.for_each_element([&](int x, int y) {
+        in(x, y) = x + y * 5;
+    });
+    input.set(in);
+
+    // A Func computed at the root of two of the pipelines, with a
+    // parallel loop in each.
+    Func shared("shared");
+    shared(x, y) = input(x, y) * 2;
+    shared.compute_root().parallel(y);
+
+    // Pipelines with params, an extern call, an update, a Tuple and
+    // the shared Func.
+    Func with_param("with_param");
+    with_param(x, y) = input(x, y) + offset;
+
+    Func with_extern("with_extern");
+    with_extern(x, y) = batch_extern(x, y) + shared(x, y);
+
+    Func with_update("with_update");
+    RDom r(0, 4);
+    with_update(x, y) = shared(x, y);
+    with_update(x, y) += r * offset;
+    with_update.vectorize(x, 8);
+
+    Func with_tuple("with_tuple");
+    with_tuple(x, y) = Tuple(input(x, y), x - y);
+
+    std::vector<Pipeline> pipelines = {with_param, with_extern, with_update, with_tuple};
+    std::vector<void *> functions = Pipeline::compile_jit(pipelines);
+    for (size_t i = 0; i < pipelines.size(); i++) {
+        if (functions[i] == nullptr || pipelines[i].compile_jit() != functions[i]) {
+            printf("Pipeline %d was not compiled by the batch\n", (int)i);
+            return -1;
+        }
+    }
+
+    // Params can change between realizations without recompiling.
+    for (int o : {3, -11}) {
+        offset.set(o);
+        Buffer<int> out = pipelines[0].realize(W, H);
+        if (!check(out, "with_param", [&](int x, int y) { return in(x, y) + o; })) {
+            return -1;
+        }
+        out = pipelines[2].realize(W, H);
+        if (!check(out, "with_update", [&](int x, int y) { return in(x, y) * 2 + 6 * o; })) {
+            return -1;
+        }
+    }
+
+    Buffer<int> out = pipelines[1].realize(W, H);
+    if (!check(out, "with_extern", [&](int x, int y) { return x * 7 - y + in(x, y) * 2; })) {
+        return -1;
+    }
+
+    Realization tuple = pipelines[3].realize(W, H);
+    Buffer<int> first = tuple[0], second = tuple[1];
+    if (!check(first, "with_tuple[0]", [&](int x, int y) { return in(x, y); }) ||
+        !check(second, "with_tuple[1]", [&](int x, int y) { return x - y; })) {
+        return -1;
+    }
+
+    // A second batch, with new pipelines that call the same shared
+    // Func, and one compiled by the first batch, which is compiled
+    // again for the new target.
+    Target target = get_jit_target_from_environment().with_feature(Target::NoAsserts);
+    Func again("again");
+    again(x, y) = shared(x, y) + 1;
+    std::vector<Pipeline> second_batch = {again, pipelines[1]};
+    std::vector<void *> second_functions = Pipeline::compile_jit(second_batch, target);
+    if (second_functions[1] == functions[1]) {
+        printf("with_extern was not compiled again for the new target\n");
+        return -1;
+    }
+
+    out = second_batch[0].realize(W, H, target);
+    if (!check(out, "again", [&](int x, int y) { return in(x, y) * 2 + 1; })) {
+        return -1;
+    }
+    out = second_batch[1].realize(W, H, target);
+    if (!check(out, "with_extern", [&](int x, int y) { return x * 7 - y + in(x, y) * 2; })) {
+        return -1;
+    }
+
+    // The pipelines of the first batch still work.
+    offset.set(5);
+    out = pipelines[0].realize(W, H);
+    if (!check(out, "with_param", [&](int x, int y) { return in(x, y) + 5; })) {
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
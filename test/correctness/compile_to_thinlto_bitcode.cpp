@@ -0,0 +1,45 @@
+#include "Halide.h"
+#include <stdio.h>
+
+#include "test/common/halide_test_dirs.h"
+
+using namespace Halide;
+
+// Check that a file holds LLVM bitcode.
+bool is_bitcode(const std::string &filename) {
+    std::vector<char> contents = Internal::read_entire_file(filename);
+    return contents.size() > 4 &&
+        contents[0] == 'B' && contents[1] == 'C' &&
+        (uint8_t)contents[2] == 0xc0 && (uint8_t)contents[3] == 0xde;
+}
+
+int main(int argc, char **argv) {
+    Func f, g;
+    Var x, y;
+    f(x, y) = x + y;
+    g(x, y) = f(x, y) * 2;
+    f.compute_root();
+
+    std::string pipeline_file = Internal::get_test_tmp_dir() + "compile_to_thinlto_bitcode.thinlto.bc";
+    std::string runtime_file = Internal::get_test_tmp_dir() + "compile_to_thinlto_bitcode_runtime.thinlto.bc";
+
+    Internal::ensure_no_file_exists(pipeline_file);
+    Internal::ensure_no_file_exists(runtime_file);
+
+    // A pipeline with no runtime of its own, and the runtime it would
+    // share with other such pipelines.
+    Target t = get_host_target().with_feature(Target::NoRuntime);
+    g.compile_to(Outputs().thinlto_bitcode(pipeline_file), {}, "g", t);
+    compile_standalone_runtime(Outputs().thinlto_bitcode(runtime_file), t);
+
+    Internal::assert_file_exists(pipeline_file);
+    Internal::assert_file_exists(runtime_file);
+
+    if (!is_bitcode(pipeline_file) || !is_bitcode(runtime_file)) {
+        printf("Output is not LLVM bitcode\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,55 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <thread>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    // Realize one compiled pipeline from many threads at once, each
+    // with its own ParamMap and output. This test is intended to be
+    // run in a thread-sanitizer.
+    Param<int> offset;
+    Func f;
+    Var x, y;
+    f(x, y) = x + y * 10 + offset;
+    f.parallel(y);
+
+    Target t = get_jit_target_from_environment();
+    f.compile_jit(t);
+
+    constexpr int num_threads = 8;
+    constexpr int iters = 64;
+
+    std::vector<std::thread> threads;
+    std::vector<int> errors(num_threads, 0);
+    for (int i = 0; i < num_threads; i++) {
+        threads.emplace_back([&, i]{
+            for (int j = 0; j < iters; j++) {
+                Buffer<int> result(16, 16);
+                f.realize(result, t, { { offset, i * iters + j } });
+                for (int yy = 0; yy < 16; yy++) {
+                    for (int xx = 0; xx < 16; xx++) {
+                        if (result(xx, yy) != xx + yy * 10 + i * iters + j) {
+                            errors[i]++;
+                        }
+                    }
+                }
+            }
+        });
+    }
+
+    for (auto &th : threads) {
+        th.join();
+    }
+
+    for (int i = 0; i < num_threads; i++) {
+        if (errors[i]) {
+            printf("Thread %d saw %d incorrect values\n", i, errors[i]);
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+
+    return 0;
+}
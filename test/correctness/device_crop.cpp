@@ -108,6 +108,28 @@ int main(int argc, char **argv) {
         }
     }
 
+    printf("Test many short-lived crops.\n");
+    {
+        // Crops and their bookkeeping are recycled, so check they
+        // don't get mixed up when many are made and released, with
+        // several alive at once.
+        Halide::Runtime::Buffer<int32_t> gpu_buf = make_gpu_buffer(hexagon_rpc);
+        for (int t = 0; t < 1000; t++) {
+            int x = (t * 8) % 120, y = (t * 16) % 120;
+            Halide::Runtime::Buffer<int32_t> tile = gpu_buf.cropped({ {x, 8}, {y, 8} });
+            Halide::Runtime::Buffer<int32_t> sub = tile.cropped({ {x + 2, 4}, {y + 2, 4} });
+            assert(sub.raw_buffer()->device_interface != nullptr);
+            if (t % 100 == 0) {
+                sub.copy_to_host();
+                for (int i = 0; i < 4; i++) {
+                    for (int j = 0; j < 4; j++) {
+                        assert(sub(x + 2 + i, y + 2 + j) == (x + 2 + i) + 256 * (y + 2 + j));
+                    }
+                }
+            }
+        }
+    }
+
     printf("Test realizing to/from crop.\n");
     {
         ImageParam in(Int(32), 2);
@@ -0,0 +1,119 @@
+#include "Halide.h"
+#include <fstream>
+#include <iterator>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+#include "test/common/halide_test_dirs.h"
+
+using namespace Halide;
+
+#ifdef _WIN32
+#define QUIET " > NUL 2>&1"
+#else
+#define QUIET " > /dev/null 2>&1"
+#endif
+
+std::string read_file(const std::string &name) {
+    std::ifstream f(name, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+bool contains(const std::string &data, const std::string &s) {
+    return data.find(s) != std::string::npos;
+}
+
+Func make_pipeline(const std::string &name) {
+    Func f(name);
+    Var x("x"), y("y"), xi("xi"), yi("yi");
+    f(x, y) = x * 3 + y;
+    f.gpu_tile(x, y, xi, yi, 16, 8);
+    return f;
+}
+
+// Compile a pipeline ahead of time, and return the contents of the object.
+std::string compile_object(const std::string &name, const Target &t) {
+    std::string prefix = Internal::get_test_tmp_dir() + name;
+    std::string object_name = prefix + ".o";
+    Internal::ensure_no_file_exists(object_name);
+    make_pipeline(name).compile_to_file(prefix, std::vector<Argument>(), name, t);
+    Internal::assert_file_exists(object_name);
+    return read_file(object_name);
+}
+
+bool check(const Buffer<int> &out) {
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            if (out(x, y) != x * 3 + y) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), x * 3 + y);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    // The magic number at the start of a fatbin, little-endian.
+    const std::string fatbin_magic("\x50\xed\x55\xba", 4);
+
+    Target cuda("x86-64-linux-cuda-cuda_capability_50");
+    if (cuda.supported()) {
+        std::string plain = compile_object("embed_ptx", cuda);
+        if (!contains(plain, ".version") || contains(plain, fatbin_magic)) {
+            printf("Expected just the PTX without the cuda_sass feature\n");
+            return -1;
+        }
+
+        std::string sass = compile_object("embed_sass", cuda.with_feature(Target::CUDASass));
+        bool have_tools = system("ptxas --version" QUIET) == 0 &&
+                          system("fatbinary --version" QUIET) == 0;
+        if (have_tools && !contains(sass, fatbin_magic)) {
+            printf("Expected a fatbin with the cuda_sass feature\n");
+            return -1;
+        }
+        if (!have_tools && !contains(sass, ".version")) {
+            printf("Expected the PTX when the CUDA tools are missing\n");
+            return -1;
+        }
+    }
+
+    Target metal("x86-64-osx-metal");
+    if (metal.supported()) {
+        std::string plain = compile_object("embed_metal_source", metal);
+        if (!contains(plain, "kernel") || contains(plain, "HLML")) {
+            printf("Expected just the Metal source without the metal_library feature\n");
+            return -1;
+        }
+
+        std::string library = compile_object("embed_metal_library", metal.with_feature(Target::MetalLibrary));
+        bool have_tools = system("xcrun -sdk macosx -f metal" QUIET) == 0;
+        if (have_tools && !contains(library, "HLML")) {
+            printf("Expected a Metal library with the metal_library feature\n");
+            return -1;
+        }
+        if (!contains(library, "kernel")) {
+            printf("Expected the Metal source to be kept\n");
+            return -1;
+        }
+    }
+
+    // The runtime loads the embedded binaries.
+    Target jit = get_jit_target_from_environment();
+    if (jit.has_feature(Target::CUDA)) {
+        Buffer<int> out = make_pipeline("jit_sass").realize(64, 32, jit.with_feature(Target::CUDASass));
+        if (!check(out)) {
+            return -1;
+        }
+    }
+    if (jit.has_feature(Target::Metal)) {
+        Buffer<int> out = make_pipeline("jit_metal_library").realize(64, 32, jit.with_feature(Target::MetalLibrary));
+        if (!check(out)) {
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include "Halide.h"
+#include <stdio.h>
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+int bounds_queries = 0;
+int calls = 0;
+
+// A 3x1 box filter as an extern stage.
+extern "C" DLLEXPORT int box3(halide_buffer_t *in, halide_buffer_t *out) {
+    if (in->is_bounds_query()) {
+        bounds_queries++;
+        in->dim[0].min = out->dim[0].min - 1;
+        in->dim[0].extent = out->dim[0].extent + 2;
+        in->dim[1].min = out->dim[1].min;
+        in->dim[1].extent = out->dim[1].extent;
+        return 0;
+    }
+    calls++;
+    Halide::Runtime::Buffer<int> in_buf(*in), out_buf(*out);
+    if (in_buf.dim(0).min() > out_buf.dim(0).min() - 1 ||
+        in_buf.dim(0).max() < out_buf.dim(0).max() + 1) {
+        printf("Input to box3 is too small\n");
+        return -1;
+    }
+    out_buf.for_each_element([&](int x, int y) {
+        out_buf(x, y) = in_buf(x - 1, y) + in_buf(x, y) + in_buf(x + 1, y);
+    });
+    return 0;
+}
+
+using namespace Halide;
+
+int run(bool declare_footprint) {
+    Var x("x"), y("y"), xo("xo"), yo("yo"), xi("xi"), yi("yi");
+    Func g("g"), blur("blur"), h("h");
+    g(x, y) = x * 3 + y;
+
+    std::vector<ExternFuncArgument> args = {g};
+    blur.define_extern("box3", args, Int(32), {x, y});
+    if (declare_footprint) {
+        blur.extern_footprint({g(x - 1, y), g(x + 1, y)});
+    }
+
+    h(x, y) = blur(x, y) * 2;
+    h.tile(x, y, xo, yo, xi, yi, 16, 8);
+    g.compute_root();
+    blur.compute_at(h, xo);
+
+    bounds_queries = calls = 0;
+    Buffer<int> out = h.realize(64, 32);
+
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            int correct = 2 * (9 * x + 3 * y);
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    if (calls != 16) {
+        printf("Expected 16 calls to box3, got %d\n", calls);
+        return -1;
+    }
+    if (declare_footprint && bounds_queries != 0) {
+        printf("Expected no bounds queries with a declared footprint, got %d\n", bounds_queries);
+        return -1;
+    }
+    if (!declare_footprint && bounds_queries == 0) {
+        printf("Expected bounds queries without a declared footprint\n");
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (run(false) || run(true)) {
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
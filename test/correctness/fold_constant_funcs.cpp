@@ -0,0 +1,97 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Record the Funcs that are realized and the Buffers that are loaded from.
+class FindRealizations : public IRMutator2 {
+public:
+    using IRMutator2::mutate;
+    using IRMutator2::visit;
+
+    std::set<std::string> realized, loaded;
+
+    Stmt visit(const Realize *op) override {
+        realized.insert(op->name);
+        return IRMutator2::visit(op);
+    }
+
+    Expr visit(const Call *op) override {
+        if (op->call_type == Call::Image && op->image.defined()) {
+            loaded.insert(op->name);
+        }
+        return IRMutator2::visit(op);
+    }
+
+    bool loads_from(const std::string &prefix) const {
+        for (const std::string &l : loaded) {
+            if (l.compare(0, prefix.size(), prefix) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment().with_feature(Target::FoldConstantFuncs);
+
+    ImageParam input(UInt(8), 2);
+    Param<float> gain;
+    Var x("x"), y("y");
+
+    // A LUT computed from Expr math, through an intermediate Func with an
+    // update, and a set of weights that depend on a Param.
+    Func curve("curve"), lut("lut"), weights("weights"), out("out");
+    curve(x) = sqrt(cast<float>(x) / 255.0f);
+    RDom r(0, 8);
+    curve(x) += cast<float>(r) * 0.0f;
+    lut(x) = cast<uint8_t>(curve(x) * 255.0f + 0.5f);
+    weights(x) = gain * x;
+    out(x, y) = cast<float>(lut(input(x, y))) * weights(x % 4);
+
+    curve.compute_root();
+    lut.compute_root().bound(x, 0, 256);
+    weights.compute_root().bound(x, 0, 4);
+
+    FindRealizations *finder = new FindRealizations;
+    out.add_custom_lowering_pass(finder);
+
+    Buffer<uint8_t> in(64, 16);
+    for (int y = 0; y < in.height(); y++) {
+        for (int x = 0; x < in.width(); x++) {
+            in(x, y) = (uint8_t)(x * 5 + y * 11);
+        }
+    }
+    input.set(in);
+    gain.set(1.5f);
+    Buffer<float> result = out.realize(64, 16, t);
+
+    if (finder->realized.count("lut") || finder->realized.count("curve")) {
+        printf("lut should have been evaluated at compile time\n");
+        return -1;
+    }
+    if (!finder->loads_from("lut_folded")) {
+        printf("lut should have been replaced with a Buffer\n");
+        return -1;
+    }
+    if (!finder->realized.count("weights")) {
+        printf("weights depends on a Param and should not have been folded\n");
+        return -1;
+    }
+
+    for (int y = 0; y < result.height(); y++) {
+        for (int x = 0; x < result.width(); x++) {
+            uint8_t l = (uint8_t)(std::sqrt(in(x, y) / 255.0f) * 255.0f + 0.5f);
+            float correct = l * (1.5f * (x % 4));
+            if (result(x, y) != correct) {
+                printf("out(%d, %d) = %f instead of %f\n", x, y, result(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Count the kernel launches, i.e. the outermost GPU block loops.
+class CountKernels : public IRMutator2 {
+public:
+    using IRMutator2::mutate;
+    using IRMutator2::visit;
+
+    int count = 0;
+    bool in_kernel = false;
+
+    Stmt visit(const For *op) override {
+        if (op->for_type == ForType::GPUBlock && !in_kernel) {
+            count++;
+            in_kernel = true;
+            Stmt s = IRMutator2::visit(op);
+            in_kernel = false;
+            return s;
+        }
+        return IRMutator2::visit(op);
+    }
+};
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (!target.has_gpu_feature()) {
+        printf("No gpu target enabled. Skipping test.\n");
+        return 0;
+    }
+
+    target.set_feature(Target::FuseGPUStages);
+
+    const int W = 256, H = 128;
+    Buffer<float> in(W, H);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            in(x, y) = (float)((x * 7 + y * 13) % 17);
+        }
+    }
+
+    Var x("x"), y("y"), xi("xi"), yi("yi");
+
+    // A chain of pointwise stages with matching GPU schedules becomes
+    // a single kernel.
+    {
+        Func gain("gain"), offset("offset"), out("out");
+        gain(x, y) = in(x, y) * 2.0f;
+        offset(x, y) = gain(x, y) + 1.0f;
+        out(x, y) = offset(x, y) * offset(x, y);
+
+        gain.compute_root().gpu_tile(x, y, xi, yi, 16, 8);
+        offset.compute_root().gpu_tile(x, y, xi, yi, 16, 8);
+        out.gpu_tile(x, y, xi, yi, 16, 8);
+
+        CountKernels *counter = new CountKernels;
+        out.add_custom_lowering_pass(counter);
+        Buffer<float> result = out.realize(W, H, target);
+        if (counter->count != 1) {
+            printf("Expected one kernel, got %d\n", counter->count);
+            return -1;
+        }
+
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                float o = in(x, y) * 2.0f + 1.0f;
+                float correct = o * o;
+                if (result(x, y) != correct) {
+                    printf("out(%d, %d) = %f instead of %f\n", x, y, result(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    // A stencil consumer reads values produced by other threads, so the
+    // producer keeps its own kernel.
+    {
+        Func gain("gain"), out("out");
+        gain(x, y) = in(x, y) * 2.0f;
+        out(x, y) = gain(x, y) + gain(min(x + 1, W - 1), y);
+
+        gain.compute_root().gpu_tile(x, y, xi, yi, 16, 8);
+        out.gpu_tile(x, y, xi, yi, 16, 8);
+
+        CountKernels *counter = new CountKernels;
+        out.add_custom_lowering_pass(counter);
+        Buffer<float> result = out.realize(W, H, target);
+        if (counter->count != 2) {
+            printf("Expected two kernels, got %d\n", counter->count);
+            return -1;
+        }
+
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                float correct = in(x, y) * 2.0f + in(std::min(x + 1, W - 1), y) * 2.0f;
+                if (result(x, y) != correct) {
+                    printf("out(%d, %d) = %f instead of %f\n", x, y, result(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
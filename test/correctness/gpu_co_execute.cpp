@@ -0,0 +1,46 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (!target.has_gpu_feature()) {
+        printf("Not running test because no gpu target enabled\n");
+        return 0;
+    }
+
+    const int W = 256, H = 300;
+    Buffer<int> input(W, H + 2);
+    input.set_min(0, -1);
+    for (int y = -1; y <= H; y++) {
+        for (int x = 0; x < W; x++) {
+            input(x, y) = x * 5 - y * 3;
+        }
+    }
+
+    // A vertical stencil, so the two parts need overlapping regions
+    // of the input.
+    Var x, y, xi, yi;
+    Func f;
+    f(x, y) = input(x, y - 1) + 2 * input(x, y) + input(x, y + 1);
+    f.parallel(y).vectorize(x, 8);
+    f.co_execute(y).gpu_tile(x, y, xi, yi, 16, 8);
+
+    // Realize several times, so the split between the parts moves.
+    for (int i = 0; i < 4; i++) {
+        Buffer<int> out = f.realize(W, H, target);
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                int correct = input(x, y - 1) + 2 * input(x, y) + input(x, y + 1);
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
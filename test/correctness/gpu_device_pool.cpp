@@ -0,0 +1,76 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <string.h>
+
+using namespace Halide;
+
+int alloc_count = 0;
+int reuse_count = 0;
+
+void my_print(void *user_context, const char *str) {
+    if (strstr(str, "cuMemAlloc ") || strstr(str, "clCreateBuffer ")) {
+        alloc_count++;
+    } else if (strstr(str, "reusing pooled allocation")) {
+        reuse_count++;
+    }
+}
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (!target.has_feature(Target::CUDA) && !target.has_feature(Target::OpenCL)) {
+        printf("Not running test because neither cuda nor opencl is enabled\n");
+        return 0;
+    }
+
+    // We need debug output to see the device allocations.
+    target.set_feature(Target::Debug);
+
+    Internal::JITHandlers handlers;
+    handlers.custom_print = my_print;
+    Internal::JITSharedRuntime::set_default_handlers(handlers);
+
+    // A sequence of device stages, each with its own device allocation.
+    const int stage_count = 5;
+    Func f[stage_count];
+    Var x, xi;
+    f[0](x) = x;
+    for (int i = 1; i < stage_count; i++) {
+        f[i](x) = f[i - 1](x) + 1;
+    }
+    for (int i = 0; i < stage_count; i++) {
+        if (i < stage_count - 1) {
+            f[i].compute_root();
+        }
+        f[i].gpu_tile(x, xi, 32);
+    }
+    f[stage_count - 1].set_custom_print(my_print);
+    f[stage_count - 1].compile_jit(target);
+
+    int first_run_allocs = 0;
+    for (int run = 0; run < 4; run++) {
+        alloc_count = 0;
+        reuse_count = 0;
+        Buffer<int> result = f[stage_count - 1].realize(1000, target);
+        result.copy_to_host();
+        for (int i = 0; i < 1000; i++) {
+            if (result(i) != i + stage_count - 1) {
+                printf("result(%d) = %d instead of %d\n", i, result(i), i + stage_count - 1);
+                return -1;
+            }
+        }
+        if (run == 0) {
+            first_run_allocs = alloc_count;
+        } else if (alloc_count != 0 || reuse_count != first_run_allocs) {
+            // Everything allocated by the previous run, including the
+            // output, has been freed by now, so should be reused.
+            printf("Run %d made %d device allocations and reused %d (first run made %d)\n",
+                   run, alloc_count, reuse_count, first_run_allocs);
+            return -1;
+        }
+    }
+
+    Internal::JITSharedRuntime::release_all();
+
+    printf("Success!\n");
+    return 0;
+}
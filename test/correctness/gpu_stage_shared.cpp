@@ -0,0 +1,71 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (!target.has_gpu_feature()) {
+        printf("No gpu target enabled. Skipping test.\n");
+        return 0;
+    }
+
+    const int W = 256, H = 128;
+    Buffer<float> in(W + 2, H + 2);
+    in.set_min(-1, -1);
+    for (int y = -1; y <= H; y++) {
+        for (int x = -1; x <= W; x++) {
+            in(x, y) = (float)((x * 7 + y * 13) % 17);
+        }
+    }
+
+    Var x("x"), y("y"), bx("bx"), by("by"), tx("tx"), ty("ty");
+
+    // Stage an input image in shared memory.
+    {
+        ImageParam input(Float(32), 2, "input");
+        input.set(in);
+
+        Func blur("blur");
+        blur(x, y) = (input(x - 1, y) + input(x, y) + input(x + 1, y) +
+                      input(x, y - 1) + input(x, y + 1)) / 5;
+        blur.gpu_tile(x, y, bx, by, tx, ty, 16, 8);
+        input.stage_in_gpu_shared(blur, bx, 16, 8);
+
+        Buffer<float> out = blur.realize(W, H, target);
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                float correct = (in(x - 1, y) + in(x, y) + in(x + 1, y) +
+                                 in(x, y - 1) + in(x, y + 1)) / 5;
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %f instead of %f\n", x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    // Stage an intermediate Func, with a one-dimensional block of threads.
+    {
+        Func f("f"), g("g");
+        f(x, y) = in(x, y) * 2;
+        g(x, y) = f(x - 1, y) + f(x + 1, y);
+        f.compute_root().gpu_tile(x, y, bx, by, tx, ty, 16, 16);
+        g.gpu_tile(x, bx, tx, 64);
+        f.stage_in_gpu_shared(g, bx, 64);
+
+        Buffer<float> out = g.realize(W, H, target);
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                float correct = in(x - 1, y) * 2 + in(x + 1, y) * 2;
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %f instead of %f\n", x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -1,8 +1,25 @@
 // Don't include Halide.h: it is not necessary for this test.
 #include "HalideBuffer.h"
 
+#include <thread>
+#include <vector>
+
 using namespace Halide::Runtime;
 
+// Runs each task of the parallel Buffer methods on its own thread.
+struct ThreadPerTaskExecutor {
+    template<typename Task>
+    void operator()(int num_tasks, Task &&task) const {
+        std::vector<std::thread> threads;
+        for (int i = 0; i < num_tasks; i++) {
+            threads.emplace_back([&task, i]() { task(i); });
+        }
+        for (std::thread &t : threads) {
+            t.join();
+        }
+    }
+};
+
 template<typename T1, typename T2>
 void check_equal_shape(const Buffer<T1> &a, const Buffer<T2> &b) {
     if (a.dimensions() != b.dimensions()) abort();
@@ -90,6 +107,28 @@ int main(int argc, char **argv) {
         check_equal(a, b);
     }
 
+    {
+        // Check padding rows apart.
+        Buffer<float> a = Buffer<float>::make_with_padded_rows({256, 10, 3});
+        if (a.dim(1).stride() != 256 + 16 || a.dim(2).stride() != (256 + 16) * 10) {
+            printf("Unexpected strides for padded rows: %d %d\n", a.dim(1).stride(), a.dim(2).stride());
+            return -1;
+        }
+        a.for_each_element([&](int x, int y, int c) {
+            a(x, y, c) = x + 100.0f * y + 100000.0f * c;
+        });
+        Buffer<float> b(256, 10, 3);
+        b.copy_from(a);
+        check_equal(a, b);
+
+        // Rows that aren't a multiple of 1024 bytes apart aren't padded.
+        Buffer<uint8_t> c = Buffer<uint8_t>::make_with_padded_rows({1000, 10});
+        if (c.dim(1).stride() != 1000) {
+            printf("Unexpected stride for unpadded rows: %d\n", c.dim(1).stride());
+            return -1;
+        }
+    }
+
     {
         // Check lifting a function over scalars to a function over entire buffers.
         const int W = 5, H = 4, C = 3;
@@ -154,6 +193,33 @@ int main(int argc, char **argv) {
         assert(b.all_equal(42));
     }
 
+    {
+        // Check the parallel variants of fill, copy_from and
+        // for_each_value, on dense buffers and across layouts.
+        Buffer<float> a(300, 400, 3), b(300, 400, 3);
+        Buffer<float> c = Buffer<float>::make_interleaved(300, 400, 3);
+        a.parallel_fill(2.0f, ThreadPerTaskExecutor());
+        assert(a.all_equal(2.0f));
+        a.for_each_element([&](int x, int y, int c) {
+            a(x, y, c) = x + y * 300 + c * 120000;
+        });
+        b.parallel_copy_from(a, ThreadPerTaskExecutor());
+        check_equal(a, b);
+        c.parallel_copy_from(a, ThreadPerTaskExecutor());
+        check_equal(a, c);
+        b.parallel_for_each_value(ThreadPerTaskExecutor(), [](float &b, float c) { b += c; }, c);
+        b.for_each_element([&](int x, int y, int c) {
+            assert(b(x, y, c) == 2 * a(x, y, c));
+        });
+
+        // A window into a larger buffer.
+        Buffer<float> d(500, 500, 3);
+        d.fill(0.0f);
+        d.cropped(0, 100, 300).cropped(1, 50, 400).translated({-100, -50}).parallel_copy_from(a, ThreadPerTaskExecutor());
+        check_equal(a, d.cropped(0, 100, 300).cropped(1, 50, 400).translated({-100, -50}));
+        assert(d.cropped(1, 0, 50).all_equal(0.0f));
+    }
+
     {
         // Check the fields get zero-initialized with the default constructor.
         uint8_t buf[sizeof(Halide::Runtime::Buffer<float>)];
@@ -0,0 +1,101 @@
+#include "Halide.h"
+#include <limits>
+#include <stdio.h>
+
+using namespace Halide;
+
+// Division and modulo by a loop-invariant but non-constant denominator
+// are lowered to a multiply and shifts by a precomputed magic number
+// hoisted out of the loop. Check the results against Halide's Euclidean
+// semantics for a range of types and denominators.
+
+template<typename T>
+T euclidean_div(T a, T b) {
+    if (b == 0) return 0;
+    int64_t q = (int64_t)a / (int64_t)b;
+    int64_t r = (int64_t)a % (int64_t)b;
+    if (r < 0) {
+        q += (b > 0) ? -1 : 1;
+    }
+    return (T)q;
+}
+
+template<typename T>
+T euclidean_mod(T a, T b) {
+    if (b == 0) return 0;
+    int64_t r = (int64_t)a % (int64_t)b;
+    if (r < 0) {
+        r += (b > 0) ? (int64_t)b : -(int64_t)b;
+    }
+    return (T)r;
+}
+
+template<typename T>
+bool test(int vector_width) {
+    const int W = 1024;
+    Buffer<T> in(W);
+    for (int i = 0; i < W; i++) {
+        // Cover the extremes of the type as well as random values.
+        if (i == 0) {
+            in(i) = std::numeric_limits<T>::min();
+        } else if (i == 1) {
+            in(i) = std::numeric_limits<T>::max();
+        } else {
+            in(i) = (T)(rand() ^ (rand() << 16));
+        }
+    }
+
+    Param<T> d;
+    Var x;
+    Func f, g;
+    f(x) = in(x) / d;
+    g(x) = in(x) % d;
+    if (vector_width > 1) {
+        f.vectorize(x, vector_width);
+        g.vectorize(x, vector_width);
+    }
+
+    std::vector<int64_t> denominators = {1, 2, 3, 7, 10, 64, 127, 255, 641,
+                                         65535, 1000000007, 0x7fffffff,
+                                         0xffffffffLL, -1, -3, -128, -1000};
+    for (int i = 0; i < 16; i++) {
+        denominators.push_back(rand() ^ (rand() << 16));
+    }
+
+    for (int64_t den : denominators) {
+        T b = (T)den;
+        if (b == 0) continue;
+        d.set(b);
+        Buffer<T> q = f.realize(W);
+        Buffer<T> r = g.realize(W);
+        for (int i = 0; i < W; i++) {
+            T correct_q = euclidean_div<T>(in(i), b);
+            T correct_r = euclidean_mod<T>(in(i), b);
+            if (q(i) != correct_q || r(i) != correct_r) {
+                printf("%lld / %lld = %lld, %lld %% %lld = %lld instead of %lld and %lld "
+                       "(vector width %d)\n",
+                       (long long)in(i), (long long)b, (long long)q(i),
+                       (long long)in(i), (long long)b, (long long)r(i),
+                       (long long)correct_q, (long long)correct_r, vector_width);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    for (int vector_width : {1, 8}) {
+        if (!test<int32_t>(vector_width) ||
+            !test<uint32_t>(vector_width) ||
+            !test<int16_t>(vector_width) ||
+            !test<uint16_t>(vector_width) ||
+            !test<int8_t>(vector_width) ||
+            !test<uint8_t>(vector_width)) {
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -181,7 +181,7 @@ void do_test() {
     luma_buf.copy_from(color_buf);
     luma_buf.slice(2, 0);
 
-    std::vector<std::string> formats = {"ppm","pgm","tmp","mat"};
+    std::vector<std::string> formats = {"ppm","pgm","tmp","mat","hraw"};
 #ifndef HALIDE_NO_JPEG
     formats.push_back("jpg");
 #endif
@@ -221,8 +221,56 @@ void do_test() {
     }
 }
 
+// Run a vertical blur over an image in strips, and check it matches
+// running it over the whole image.
+void test_strips(const std::string &format) {
+    std::cout << "Testing strips for format: " << format << "\n";
+
+    const int width = 301, height = 257;
+    Buffer<uint8_t> buf(width, height, 3);
+    buf.for_each_element([&](int x, int y, int c) {
+        buf(x, y, c) = (x * 3 + y * 7 + c * 50) & 0xff;
+    });
+    const std::string input = Internal::get_test_tmp_dir() + "test_strips_in." + format;
+    const std::string output = Internal::get_test_tmp_dir() + "test_strips_out." + format;
+    Tools::save_image(buf, input);
+
+    ImageParam in(UInt(8), 3);
+    Var x, y, c;
+    Func blur;
+    Expr sum = (cast<uint16_t>(in(x, max(y - 1, 0), c)) +
+                in(x, y, c) +
+                in(x, min(y + 1, height - 1), c));
+    blur(x, y, c) = cast<uint8_t>(sum / 3);
+
+    Buffer<uint8_t> correct(width, height, 3);
+    in.set(buf);
+    blur.realize(correct);
+
+    bool ok = Tools::process_image_in_strips<Buffer<>>(input, output, 16, 1, [&](Buffer<> &strip_in, Buffer<> &strip_out) {
+        in.set(strip_in);
+        blur.realize(strip_out);
+    });
+    if (!ok) {
+        printf("process_image_in_strips failed\n");
+        abort();
+    }
+
+    Buffer<uint8_t> result = Tools::load_image(output);
+    result.for_each_element([&](int x, int y, int c) {
+        if (result(x, y, c) != correct(x, y, c)) {
+            printf("result(%d, %d, %d) = %d instead of %d\n", x, y, c, result(x, y, c), correct(x, y, c));
+            abort();
+        }
+    });
+}
+
 int main(int argc, char **argv) {
     do_test<uint8_t>();
     do_test<uint16_t>();
+    test_strips("ppm");
+#ifndef HALIDE_NO_PNG
+    test_strips("png");
+#endif
     return 0;
 }
@@ -0,0 +1,88 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+int fused_loops = 0;
+
+// Counts the loops of fused groups in the lowered code.
+class CountFusedLoops : public IRMutator2 {
+    class Count : public IRVisitor {
+        using IRVisitor::visit;
+
+        void visit(const For *op) override {
+            if (op->name.find(".fused.") != std::string::npos) {
+                fused_loops++;
+            }
+            IRVisitor::visit(op);
+        }
+    };
+
+public:
+    using IRMutator2::mutate;
+    Stmt mutate(const Stmt &s) override {
+        Count count;
+        s.accept(&count);
+        return s;
+    }
+};
+
+bool run(const Buffer<int> &input, const Target &t) {
+    Func f("f"), g("g"), h("h"), out("out");
+    Var x("x"), y("y"), xi("xi");
+
+    // f and g read the same input and have the same consumer, so they
+    // can be fused. h reads the input too, but it also reads f, so it
+    // can't be fused with f.
+    f(x, y) = input(x, y) * 2;
+    g(x, y) = input(x, y) + y;
+    h(x, y) = f(x, y) + input(x, y);
+    out(x, y) = f(x, y) + g(x, y) + h(x, y);
+
+    f.compute_root().split(x, x, xi, 8).vectorize(xi).parallel(y);
+    g.compute_root().split(x, x, xi, 8).vectorize(xi).parallel(y);
+    h.compute_root().split(x, x, xi, 8).vectorize(xi).parallel(y);
+
+    Pipeline p(out);
+    p.add_custom_lowering_pass(new CountFusedLoops);
+
+    fused_loops = 0;
+    Buffer<int> result = p.realize(input.width(), input.height(), t);
+    for (int y = 0; y < result.height(); y++) {
+        for (int x = 0; x < result.width(); x++) {
+            int in = input(x, y);
+            int correct = in * 2 + (in + y) + (in * 2 + in);
+            if (result(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, result(x, y), correct);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    Buffer<int> input(64, 16);
+    input.for_each_element([&](int x, int y) { input(x, y) = x * 3 + y * 5; });
+
+    Target t = get_jit_target_from_environment();
+    if (!run(input, t)) {
+        return -1;
+    }
+    if (fused_loops != 0) {
+        printf("There should be no fused loops without the InferComputeWith feature\n");
+        return -1;
+    }
+
+    if (!run(input, t.with_feature(Target::InferComputeWith))) {
+        return -1;
+    }
+    if (fused_loops == 0) {
+        printf("f and g should have been computed with each other\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -108,6 +108,59 @@ int main(int argc, char **argv) {
         }
     }
 
+    // Integer reductions over long domains are accumulated in
+    // independent lanes. Check domains that aren't a multiple of the
+    // number of lanes, with vectorized and scalar consumers.
+    {
+        const int K = 101;
+        Buffer<int32_t> a(K, 10);
+        Buffer<uint8_t> b(K);
+        for (int i = 0; i < K; i++) {
+            for (int j = 0; j < 10; j++) {
+                a(i, j) = (i * 37 + j * 11) % 51 - 25;
+            }
+            b(i) = (i * 73) % 251;
+        }
+
+        RDom k(0, K);
+        Func dot, prod, big;
+        dot(y) = sum(a(k, y) * b(k));
+        prod(y) = product(cast<uint32_t>(a(k, y) % 3 + 2));
+        big(x) = maximum(b(k) + cast<uint8_t>(x));
+        dot.vectorize(y, 4);
+
+        Buffer<int32_t> dot_im = dot.realize(10);
+        Buffer<uint32_t> prod_im = prod.realize(10);
+        Buffer<uint8_t> big_im = big.realize(4);
+
+        for (int y = 0; y < 10; y++) {
+            int32_t correct_dot = 0;
+            uint32_t correct_prod = 1;
+            for (int i = 0; i < K; i++) {
+                correct_dot += a(i, y) * b(i);
+                correct_prod *= (a(i, y) % 3 + 3) % 3 + 2;
+            }
+            if (dot_im(y) != correct_dot) {
+                printf("dot(%d) = %d instead of %d\n", y, dot_im(y), correct_dot);
+                return -1;
+            }
+            if (prod_im(y) != correct_prod) {
+                printf("prod(%d) = %u instead of %u\n", y, prod_im(y), correct_prod);
+                return -1;
+            }
+        }
+        for (int x = 0; x < 4; x++) {
+            uint8_t correct_big = 0;
+            for (int i = 0; i < K; i++) {
+                correct_big = std::max(correct_big, (uint8_t)(b(i) + x));
+            }
+            if (big_im(x) != correct_big) {
+                printf("big(%d) = %d instead of %d\n", x, big_im(x), correct_big);
+                return -1;
+            }
+        }
+    }
+
     // Verify that all inline reductions compile with implicit argument syntax.
     Buffer<float> input_3d = lambda(x, y, z, x * 100.0f + y * 10.0f + ((z + 5 % 10))).realize(10, 10, 10);
     RDom all_z(input_3d.min(2), input_3d.extent(2));
@@ -49,11 +49,63 @@ bool test_interleave() {
     return true;
 }
 
+template <typename T>
+bool test_deinterleave(int channels) {
+    Var x("x"), y("y"), c("c");
+
+    Buffer<T> input = Buffer<T>::make_interleaved(256, 128, channels);
+    for (int y = 0; y < input.height(); y++) {
+        for (int x = 0; x < input.width(); x++) {
+            for (int c = 0; c < channels; c++) {
+                input(x, y, c) = (T)(x * 7 + y * 3 + c * 11);
+            }
+        }
+    }
+
+    // Each channel is a load with a stride of the number of channels.
+    Func planar("planar");
+    planar(x, y, c) = input(x, y, c) + cast<T>(c);
+
+    Target target = get_jit_target_from_environment();
+    planar.bound(c, 0, channels).reorder(x, c, y);
+    if (target.has_gpu_feature()) {
+        Var xi("xi"), yi("yi");
+        planar.gpu_tile(x, y, xi, yi, 16, 16);
+    } else if (target.has_feature(Target::HVX_64)) {
+        const int vector_width = 64 / sizeof(T);
+        planar.hexagon().vectorize(x, vector_width);
+    } else if (target.has_feature(Target::HVX_128)) {
+        const int vector_width = 128 / sizeof(T);
+        planar.hexagon().vectorize(x, vector_width);
+    } else {
+        planar.vectorize(x, target.natural_vector_size<uint8_t>()).unroll(c);
+    }
+    Buffer<T> buff = planar.realize(256, 128, channels, target);
+    for (int y = 0; y < buff.height(); y++) {
+        for (int x = 0; x < buff.width(); x++) {
+            for (int c = 0; c < channels; c++) {
+                T correct = (T)(input(x, y, c) + c);
+                if (buff(x, y, c) != correct) {
+                    printf("planar(%d, %d, %d) = %d instead of %d\n", x, y, c, buff(x, y, c), correct);
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
 int main(int argc, char **argv) {
     if (!test_interleave<uint8_t>()) return -1;
     if (!test_interleave<uint16_t>()) return -1;
     if (!test_interleave<uint32_t>()) return -1;
 
+    for (int channels = 3; channels <= 4; channels++) {
+        if (!test_deinterleave<uint8_t>(channels)) return -1;
+        if (!test_deinterleave<uint16_t>(channels)) return -1;
+        if (!test_deinterleave<uint32_t>(channels)) return -1;
+    }
+
     printf("Success!\n");
     return 0;
 }
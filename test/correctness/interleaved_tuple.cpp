@@ -0,0 +1,97 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+class CountAllocations : public IRMutator2 {
+public:
+    using IRMutator2::mutate;
+    using IRMutator2::visit;
+
+    std::string prefix;
+    int count = 0;
+
+    CountAllocations(const std::string &p) : prefix(p) {}
+
+    Stmt visit(const Allocate *op) override {
+        if (starts_with(op->name, prefix)) {
+            count++;
+        }
+        return IRMutator2::visit(op);
+    }
+};
+
+int main(int argc, char **argv) {
+    const int W = 256, H = 64;
+
+    Var x("x"), y("y");
+
+    // A complex-valued Func, stored as an array of structs.
+    Func c("c");
+    c(x, y) = Tuple(cast<float>(x + y), cast<float>(x - y));
+
+    // Multiply it by itself, and by a shifted copy.
+    Func out("out");
+    Expr re = c(x, y)[0] * c(x + 1, y)[0] - c(x, y)[1] * c(x + 1, y)[1];
+    Expr im = c(x, y)[0] * c(x + 1, y)[1] + c(x, y)[1] * c(x + 1, y)[0];
+    out(x, y) = Tuple(re, im);
+
+    c.compute_at(out, y).store_tuple_interleaved().vectorize(x, 8);
+    out.vectorize(x, 8);
+
+    CountAllocations *counter = new CountAllocations("c");
+    out.add_custom_lowering_pass(counter);
+
+    Realization r = out.realize(W, H);
+    Buffer<float> r0 = r[0], r1 = r[1];
+
+    if (counter->count != 1) {
+        printf("Expected a single allocation for c, got %d\n", counter->count);
+        return -1;
+    }
+
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            float a_re = x + y, a_im = x - y;
+            float b_re = x + 1 + y, b_im = x + 1 - y;
+            float correct_re = a_re * b_re - a_im * b_im;
+            float correct_im = a_re * b_im + a_im * b_re;
+            if (r0(x, y) != correct_re || r1(x, y) != correct_im) {
+                printf("out(%d, %d) = {%f, %f} instead of {%f, %f}\n",
+                       x, y, r0(x, y), r1(x, y), correct_re, correct_im);
+                return -1;
+            }
+        }
+    }
+
+    // An RGBA accumulator with an update definition.
+    Func acc("acc");
+    RDom k(0, 4);
+    acc(x, y) = Tuple(0, 0, 0, 0);
+    acc(x, y) = Tuple(acc(x, y)[0] + (x + k),
+                      acc(x, y)[1] + (y + k),
+                      acc(x, y)[2] + x * k,
+                      acc(x, y)[3] + y * k);
+    Func total("total");
+    total(x, y) = acc(x, y)[0] + acc(x, y)[1] + acc(x, y)[2] + acc(x, y)[3];
+    acc.compute_root().store_tuple_interleaved().vectorize(x, 4).update().vectorize(x, 4);
+    total.vectorize(x, 4);
+
+    Buffer<int> t = total.realize(W, H);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            int correct = 0;
+            for (int i = 0; i < 4; i++) {
+                correct += (x + i) + (y + i) + x * i + y * i;
+            }
+            if (t(x, y) != correct) {
+                printf("total(%d, %d) = %d instead of %d\n", x, y, t(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include "Halide.h"
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "test/common/halide_test_dirs.h"
+
+using namespace Halide;
+
+// A chain of blurs, each computed at the root, so that bounds
+// inference makes many equal expressions.
+Func make_pipeline(ImageParam input) {
+    Var x("x"), y("y");
+    Func clamped = BoundaryConditions::repeat_edge(input);
+    Func prev = clamped;
+    for (int i = 0; i < 6; i++) {
+        Func blur("blur_" + std::to_string(i));
+        blur(x, y) = (prev(x - 1, y) + prev(x, y - 1) + prev(x + 1, y) + prev(x, y + 1)) / 4;
+        if (i < 5) {
+            blur.compute_root();
+        }
+        prev = blur;
+    }
+    return prev;
+}
+
+// Read the lowering profile, and return the number of interning
+// passes in it. Sets shrank if any of them reduced the number of
+// distinct IR nodes.
+int interning_passes(const std::string &profile, bool &shrank) {
+    std::ifstream file(profile);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    std::string json = contents.str();
+
+    const std::string name = "\"name\": \"Interning expressions...\"";
+    int count = 0;
+    shrank = false;
+    for (size_t i = json.find(name); i != std::string::npos; i = json.find(name, i + 1)) {
+        count++;
+        long long before = 0, after = 0;
+        size_t b = json.find("\"nodes_before\": ", i);
+        size_t a = json.find("\"nodes_after\": ", i);
+        if (b == std::string::npos || a == std::string::npos ||
+            sscanf(json.c_str() + b, "\"nodes_before\": %lld", &before) != 1 ||
+            sscanf(json.c_str() + a, "\"nodes_after\": %lld", &after) != 1) {
+            printf("Malformed lowering profile:\n%s", json.c_str());
+            exit(-1);
+        }
+        printf("Interning: %lld -> %lld nodes\n", before, after);
+        shrank |= after < before;
+    }
+    return count;
+}
+
+int main(int argc, char **argv) {
+    const int W = 97, H = 61;
+    ImageParam input(Int(32), 2, "input");
+    Buffer<int> in(W, H);
+    in.for_each_element([&](int x, int y) {
+        in(x, y) = (x * 37 + y * 101) % 256;
+    });
+    input.set(in);
+
+    Target target = get_jit_target_from_environment();
+
+    std::string plain_profile = Internal::get_test_tmp_dir() + "intern_exprs_plain.json";
+    std::string interned_profile = Internal::get_test_tmp_dir() + "intern_exprs_interned.json";
+    Internal::ensure_no_file_exists(plain_profile);
+    Internal::ensure_no_file_exists(interned_profile);
+
+#ifdef _WIN32
+    _putenv_s("HL_LOWER_PROFILE", plain_profile.c_str());
+#else
+    setenv("HL_LOWER_PROFILE", plain_profile.c_str(), 1);
+#endif
+    Buffer<int> plain = make_pipeline(input).realize(W, H, target);
+
+#ifdef _WIN32
+    _putenv_s("HL_LOWER_PROFILE", interned_profile.c_str());
+#else
+    setenv("HL_LOWER_PROFILE", interned_profile.c_str(), 1);
+#endif
+    Buffer<int> interned = make_pipeline(input).realize(W, H, target.with_feature(Target::InternExprs));
+
+    // Interning only runs with the feature, and it makes equal
+    // expressions share nodes.
+    bool shrank;
+    if (interning_passes(plain_profile, shrank) != 0) {
+        printf("Lowering interned expressions without intern_exprs\n");
+        return -1;
+    }
+    if (interning_passes(interned_profile, shrank) != 2) {
+        printf("Lowering didn't intern expressions twice with intern_exprs\n");
+        return -1;
+    }
+    if (!shrank) {
+        printf("Interning didn't reduce the number of distinct IR nodes\n");
+        return -1;
+    }
+
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            if (plain(x, y) != interned(x, y)) {
+                printf("interned(%d, %d) = %d instead of %d\n", x, y, interned(x, y), plain(x, y));
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
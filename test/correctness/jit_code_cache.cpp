@@ -0,0 +1,129 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+const int num_pipelines = 6;
+int compile_count[num_pipelines] = {0};
+
+// Counts how many times each pipeline is lowered.
+class CountCompiles : public IRMutator2 {
+    int index;
+
+public:
+    CountCompiles(int index) : index(index) {}
+
+    using IRMutator2::mutate;
+    Stmt mutate(const Stmt &s) override {
+        compile_count[index]++;
+        return s;
+    }
+};
+
+bool check(Pipeline p, int i, int W, int H) {
+    Buffer<int> out = p.realize(W, H);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            int correct = x * i + y;
+            if (out(x, y) != correct) {
+                printf("pipeline %d: out(%d, %d) = %d instead of %d\n",
+                       i, x, y, out(x, y), correct);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool check_counts(const int *expected) {
+    for (int i = 0; i < num_pipelines; i++) {
+        if (compile_count[i] != expected[i]) {
+            printf("Pipeline %d was compiled %d times instead of %d\n",
+                   i, compile_count[i], expected[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    // Only three pipelines may keep their code at once.
+#ifdef _WIN32
+    _putenv_s("HL_JIT_CODE_CACHE_SIZE", "3");
+#else
+    setenv("HL_JIT_CODE_CACHE_SIZE", "3", 1);
+#endif
+
+    const int W = 32, H = 16;
+    Var x("x"), y("y");
+
+    std::vector<Pipeline> pipelines;
+    for (int i = 0; i < num_pipelines; i++) {
+        Func f("f" + std::to_string(i));
+        f(x, y) = x * i + y;
+        if (i % 2) {
+            f.vectorize(x, 8);
+        }
+        Pipeline p(f);
+        p.add_custom_lowering_pass(new CountCompiles(i));
+        pipelines.push_back(p);
+    }
+
+    // Compiling all of them evicts the code of the first three.
+    for (int i = 0; i < num_pipelines; i++) {
+        if (!check(pipelines[i], i, W, H)) {
+            return -1;
+        }
+    }
+    {
+        int expected[] = {1, 1, 1, 1, 1, 1};
+        if (!check_counts(expected)) {
+            return -1;
+        }
+    }
+
+    // The last three still have theirs.
+    for (int i = 3; i < num_pipelines; i++) {
+        if (!check(pipelines[i], i, W, H)) {
+            return -1;
+        }
+    }
+    {
+        int expected[] = {1, 1, 1, 1, 1, 1};
+        if (!check_counts(expected)) {
+            return -1;
+        }
+    }
+
+    // The first one is compiled again, evicting the least recently
+    // used one, pipeline 3, which in turn evicts pipeline 5.
+    if (!check(pipelines[0], 0, W, H) ||
+        !check(pipelines[4], 4, W, H) ||
+        !check(pipelines[3], 3, W, H)) {
+        return -1;
+    }
+    {
+        int expected[] = {2, 1, 1, 2, 1, 1};
+        if (!check_counts(expected)) {
+            return -1;
+        }
+    }
+
+    // Destroying a pipeline makes room without evicting another.
+    pipelines[4] = Pipeline();
+    if (!check(pipelines[1], 1, W, H) ||
+        !check(pipelines[0], 0, W, H) ||
+        !check(pipelines[3], 3, W, H)) {
+        return -1;
+    }
+    {
+        int expected[] = {2, 2, 1, 2, 1, 1};
+        if (!check_counts(expected)) {
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
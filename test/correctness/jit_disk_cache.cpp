@@ -0,0 +1,203 @@
+#include "Halide.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "test/common/halide_test_dirs.h"
+
+using namespace Halide;
+
+#ifndef _WIN32
+
+std::string cache_dir;
+
+// The entries in the JIT cache directory.
+std::vector<std::string> cache_files() {
+    std::vector<std::string> files;
+    DIR *dir = opendir(cache_dir.c_str());
+    while (struct dirent *e = readdir(dir)) {
+        std::string name = e->d_name;
+        if (name.find("halide_jit_") == 0 && name.find(".tmp") == std::string::npos) {
+            files.push_back(cache_dir + "/" + name);
+        }
+    }
+    closedir(dir);
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+// Entries are written to a temporary file and renamed into place, so a
+// rebuilt entry is a new file.
+ino_t inode(const std::string &path) {
+    struct stat s;
+    if (stat(path.c_str(), &s) != 0) {
+        return 0;
+    }
+    return s.st_ino;
+}
+
+std::string read_file(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream contents;
+    contents << in.rdbuf();
+    return contents.str();
+}
+
+void write_file(const std::string &path, const std::string &contents) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(contents.data(), contents.size());
+}
+
+// A pipeline with an embedded table, whose values are in the object
+// code, and a Param.
+template<typename T>
+Func make_pipeline(const Buffer<int> &table, const Param<T> &p) {
+    Var x("x");
+    Func f("f");
+    f(x) = table(x % table.width()) * 3 + cast<int>(p);
+    return f;
+}
+
+bool check(Func f, const Buffer<int> &table, int p, const char *what) {
+    Buffer<int> out = f.realize(100);
+    for (int x = 0; x < 100; x++) {
+        int correct = table(x % table.width()) * 3 + p;
+        if (out(x) != correct) {
+            printf("%s: out(%d) = %d instead of %d\n", what, x, out(x), correct);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool expect_files(size_t n, const char *what) {
+    size_t count = cache_files().size();
+    if (count != n) {
+        printf("%s: %d cache entries instead of %d\n", what, (int)count, (int)n);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    cache_dir = Internal::get_test_tmp_dir() + "jit_disk_cache_" + std::to_string(getpid());
+    mkdir(cache_dir.c_str(), 0755);
+    setenv("HL_JIT_CACHE_DIR", cache_dir.c_str(), 1);
+
+    Buffer<int> table(8);
+    table.for_each_element([&](int x) { table(x) = x * x; });
+    Param<int> p("p");
+    p.set(5);
+
+    // A miss compiles the pipeline and stores it.
+    if (!check(make_pipeline(table, p), table, 5, "miss") ||
+        !expect_files(1, "miss")) {
+        return -1;
+    }
+    std::string entry = cache_files()[0];
+    ino_t stored = inode(entry);
+
+    // The same pipeline, defined again, loads the stored object and
+    // runs it, with any value of the Param.
+    Func again = make_pipeline(table, p);
+    if (!check(again, table, 5, "hit")) {
+        return -1;
+    }
+    p.set(-9);
+    if (!check(again, table, -9, "hit with a new param value") ||
+        !expect_files(1, "hit")) {
+        return -1;
+    }
+    if (inode(entry) != stored) {
+        printf("The cache entry was rebuilt on a hit\n");
+        return -1;
+    }
+
+    // A truncated entry is rejected and rebuilt. Overwriting the file
+    // keeps its inode.
+    std::string contents = read_file(entry);
+    write_file(entry, contents.substr(0, contents.size() / 2));
+    stored = inode(entry);
+    if (!check(make_pipeline(table, p), table, -9, "truncated") ||
+        !expect_files(1, "truncated")) {
+        return -1;
+    }
+    if (inode(entry) == stored || read_file(entry).size() != contents.size()) {
+        printf("A truncated cache entry wasn't rebuilt\n");
+        return -1;
+    }
+
+    // So is one with a corrupt size field.
+    std::string corrupt = contents;
+    for (int i = 0; i < 8; i++) {
+        corrupt[i] = (char)0xff;
+    }
+    write_file(entry, corrupt);
+    stored = inode(entry);
+    if (!check(make_pipeline(table, p), table, -9, "corrupt") ||
+        !expect_files(1, "corrupt")) {
+        return -1;
+    }
+    if (inode(entry) == stored || read_file(entry) == corrupt) {
+        printf("A corrupt cache entry wasn't rebuilt\n");
+        return -1;
+    }
+
+    // New contents of the embedded table make a different key, and so
+    // does a Param of a different type.
+    Buffer<int> other_table(8);
+    other_table.for_each_element([&](int x) { other_table(x) = 100 - x; });
+    if (!check(make_pipeline(other_table, p), other_table, -9, "new table") ||
+        !expect_files(2, "new table")) {
+        return -1;
+    }
+    Param<int16_t> p16("p");
+    p16.set(7);
+    if (!check(make_pipeline(table, p16), table, 7, "new param type") ||
+        !expect_files(3, "new param type")) {
+        return -1;
+    }
+
+    // An entry stored under the name of another key, as with a hash
+    // collision, is rejected because the key stored in it differs.
+    std::vector<std::string> files = cache_files();
+    for (const std::string &f : files) {
+        if (f != entry) {
+            write_file(f, contents);
+        }
+    }
+    if (!check(make_pipeline(other_table, p), other_table, -9, "mismatched key") ||
+        !check(make_pipeline(table, p16), table, 7, "mismatched key")) {
+        return -1;
+    }
+    for (const std::string &f : files) {
+        if (f != entry && read_file(f) == contents) {
+            printf("The entry with a mismatched key wasn't rebuilt\n");
+            return -1;
+        }
+    }
+
+    for (const std::string &f : cache_files()) {
+        std::remove(f.c_str());
+    }
+    rmdir(cache_dir.c_str());
+
+    printf("Success!\n");
+    return 0;
+}
+
+#else
+
+int main(int argc, char **argv) {
+    printf("Skipping test on Windows\n");
+    return 0;
+}
+
+#endif
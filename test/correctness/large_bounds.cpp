@@ -0,0 +1,57 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+// A chain of selects, each of whose conditions depends on the one
+// before it. Its exact bounds double in size at each step, so bounds
+// inference gives up on them, but it still has to find finite ones.
+Expr chain(Expr x, int steps) {
+    Expr e = x;
+    for (int i = 0; i < steps; i++) {
+        e = select(e > i, x + i, x - i);
+    }
+    return e;
+}
+
+int chain_ref(int x, int steps) {
+    int e = x;
+    for (int i = 0; i < steps; i++) {
+        e = e > i ? x + i : x - i;
+    }
+    return e;
+}
+
+int main(int argc, char **argv) {
+    const int steps = 24;
+    const int W = 50, H = 4;
+
+    // The output size isn't known at compile time, so the bounds of the
+    // chain aren't constant either.
+    ImageParam input(Int(32), 2, "input");
+    Var x("x"), y("y");
+    Func f("f");
+    f(x, y) = input(chain(x, steps), y);
+    f.compile_jit();
+
+    Buffer<int> in(W + 2 * steps, H);
+    in.set_min(-steps, 0);
+    in.for_each_element([&](int x, int y) {
+        in(x, y) = x * 3 + y * 1000;
+    });
+    input.set(in);
+
+    Buffer<int> out = f.realize(W, H);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            int correct = in(chain_ref(x, steps), y);
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Count the gathers whose per-lane offsets have been narrowed to 32 bits.
+class CountNarrowedGathers : public IRMutator2 {
+    using IRMutator2::visit;
+
+    Expr visit(const Load *op) override {
+        Expr base, offsets;
+        if (is_narrowed_index(op->index, &base, &offsets)) {
+            count++;
+        }
+        return IRMutator2::visit(op);
+    }
+
+public:
+    int count = 0;
+};
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (t.bits == 32) {
+        printf("Skipping test: LargeBuffers needs a 64-bit target\n");
+        return 0;
+    }
+
+    const int W = 256, H = 16;
+    Buffer<uint8_t> input(W, H);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            input(x, y) = (uint8_t)(x * 17 + y * 31);
+        }
+    }
+
+    // A lookup table indexed by the input is a gather whose offsets
+    // are bounded by the type of the input.
+    Var x, y;
+    Func lut, f;
+    lut(x) = x * x - 100;
+    f(x, y) = lut(input(x, y)) + lut(clamp(cast<int>(input(x, y)) + y, 0, 255));
+    lut.compute_root();
+    f.vectorize(x, 8);
+
+    CountNarrowedGathers *counter = new CountNarrowedGathers;
+    f.add_custom_lowering_pass(counter);
+
+    Buffer<int> out = f.realize(W, H, t.with_feature(Target::LargeBuffers));
+
+    if (counter->count == 0) {
+        printf("The gathers were not narrowed to 32-bit offsets\n");
+        return -1;
+    }
+
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            int i = input(x, y), j = std::min(std::max(i + y, 0), 255);
+            int correct = (i * i - 100) + (j * j - 100);
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
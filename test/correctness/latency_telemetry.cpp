@@ -0,0 +1,93 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+using namespace Halide;
+
+int reports = 0;
+std::vector<std::string> stage_names;
+bool ticks_ordered = true;
+
+void my_telemetry(void *user_context, const halide_telemetry_record_t *record) {
+    reports++;
+    stage_names.clear();
+    for (int i = 0; i < record->num_stages; i++) {
+        stage_names.push_back(record->stage_names[i]);
+        uint64_t begin = record->ticks[2 + 2 * i];
+        uint64_t end = record->ticks[3 + 2 * i];
+        if (begin > end || begin < record->ticks[0] || end > record->ticks[1]) {
+            printf("Stage %s ran from %llu to %llu, outside the call from %llu to %llu\n",
+                   record->stage_names[i],
+                   (unsigned long long)begin, (unsigned long long)end,
+                   (unsigned long long)record->ticks[0], (unsigned long long)record->ticks[1]);
+            ticks_ordered = false;
+        }
+    }
+}
+
+bool has_stage(const std::string &name) {
+    for (const std::string &s : stage_names) {
+        if (s == name) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (t.arch == Target::Hexagon) {
+        printf("Skipping test: latency telemetry isn't supported on Hexagon\n");
+        return 0;
+    }
+
+    t.set_feature(Target::LatencyTelemetry);
+
+    Func f("f"), g("g"), h("h"), out("out");
+    Var x("x"), y("y");
+
+    f(x, y) = x + y;
+    g(x, y) = f(x, y) * 2;
+    // h is computed inside out's loops, so it isn't timed.
+    h(x, y) = g(x, y) + 1;
+    out(x, y) = h(x, y) + g(x + 1, y);
+
+    f.compute_root().parallel(y);
+    g.compute_root().vectorize(x, 4);
+    h.compute_at(out, y);
+
+    out.set_custom_telemetry(my_telemetry);
+
+    for (int i = 0; i < 3; i++) {
+        Buffer<int> result = out.realize(32, 16, t);
+        for (int y = 0; y < 16; y++) {
+            for (int x = 0; x < 32; x++) {
+                int correct = (x + y) * 2 + 1 + (x + 1 + y) * 2;
+                if (result(x, y) != correct) {
+                    printf("result(%d, %d) = %d instead of %d\n", x, y, result(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    if (reports != 3) {
+        printf("Telemetry was reported %d times instead of 3\n", reports);
+        return -1;
+    }
+    if (stage_names.size() != 3 || !has_stage("f") || !has_stage("g") || !has_stage("out")) {
+        printf("The timed stages should be f, g and out. They were:");
+        for (const std::string &s : stage_names) {
+            printf(" %s", s.c_str());
+        }
+        printf("\n");
+        return -1;
+    }
+    if (!ticks_ordered) {
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Loop carry is only run by the Hexagon backend, so run it as a custom
+// lowering pass to test it on any target. Records whether it changed
+// the IR.
+class CarryLoads : public IRMutator2 {
+    bool &changed;
+
+public:
+    CarryLoads(bool &changed) : changed(changed) {}
+
+    using IRMutator2::mutate;
+    Stmt mutate(const Stmt &s) override {
+        Stmt result = loop_carry(s, 16);
+        changed = !result.same_as(s);
+        return result;
+    }
+};
+
+// Realize out with and without loop carry, and check both against the
+// reference bit for bit.
+template<typename F>
+bool check(Func out, int W, int H, const char *name, F correct) {
+    bool changed = false;
+    out.add_custom_lowering_pass(new CarryLoads(changed));
+    Buffer<int> result = out.realize(W, H);
+    if (!changed) {
+        printf("%s: loop carry didn't change the IR\n", name);
+        return false;
+    }
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            if (result(x, y) != correct(x, y)) {
+                printf("%s(%d, %d) = %d instead of %d\n", name, x, y, result(x, y), correct(x, y));
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    const int W = 67, H = 23;
+    Buffer<uint16_t> in(W + 2, H + 2);
+    in.set_min(-1, -1);
+    in.for_each_element([&](int x, int y) {
+        in(x, y) = (uint16_t)((x * 7919 + y * 104729) & 0xffff);
+    });
+    Var x("x"), y("y");
+
+    // A horizontal stencil, carried along the loop over x.
+    {
+        Func f("horizontal");
+        f(x, y) = (cast<int>(in(x - 1, y)) + 2 * cast<int>(in(x, y)) -
+                   3 * cast<int>(in(x + 1, y)));
+        if (!check(f, W, H, "horizontal", [&](int x, int y) {
+                return in(x - 1, y) + 2 * in(x, y) - 3 * in(x + 1, y);
+            })) {
+            return -1;
+        }
+    }
+
+    // A vertical stencil over rows of constant width, carried across
+    // the loop over y, with a set of slots per x.
+    {
+        const int w = 4;
+        Func g("vertical");
+        g(x, y) = (cast<int>(in(x, y - 1)) * 5 + cast<int>(in(x, y)) -
+                   cast<int>(in(x, y + 1)) * 7);
+        g.bound(x, 0, w);
+        if (!check(g, w, H, "vertical", [&](int x, int y) {
+                return in(x, y - 1) * 5 + in(x, y) - in(x, y + 1) * 7;
+            })) {
+            return -1;
+        }
+    }
+
+    // An unrolled and vectorized stencil, whose neighboring stores load
+    // some of the same values.
+    {
+        Func h("unrolled");
+        h(x, y) = (cast<int>(in(x - 1, y)) * 3 + cast<int>(in(x, y)) * 11 +
+                   cast<int>(in(x + 1, y)) * 13);
+        h.vectorize(x, 4).unroll(x, 2);
+        if (!check(h, 64, H, "unrolled", [&](int x, int y) {
+                return in(x - 1, y) * 3 + in(x, y) * 11 + in(x + 1, y) * 13;
+            })) {
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
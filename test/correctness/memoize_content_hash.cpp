@@ -0,0 +1,102 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+int call_count = 0;
+extern "C" DLLEXPORT int count_calls(int x) {
+    call_count++;
+    return 0;
+}
+HalideExtern_1(int, count_calls, int);
+
+const int W = 32, H = 16;
+
+bool check(const Buffer<float> &result, const Buffer<float> &input, const char *step) {
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            float correct = input(x, y) * 2;
+            if (result(x, y) != correct) {
+                printf("%s: result(%d, %d) = %f instead of %f\n",
+                       step, x, y, result(x, y), correct);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    ImageParam input(Float(32), 2);
+    Param<uint64_t> version;
+    Var x, y;
+
+    Func f, g;
+    f(x, y) = input(x, y) * 2 + count_calls(x);
+    f.compute_root().memoize(MemoizeKey::ContentHash, version);
+    g(x, y) = f(x, y);
+
+    Buffer<float> a(W, H);
+    a.for_each_element([&](int x, int y) { a(x, y) = x + y * 0.5f; });
+
+    // The first run computes f, and the second finds it in the cache.
+    input.set(a);
+    version.set(0);
+    Buffer<float> result = g.realize(W, H);
+    if (!check(result, a, "first run") || call_count != W * H) {
+        printf("First run called count_calls %d times\n", call_count);
+        return -1;
+    }
+    g.realize(result);
+    if (call_count != W * H) {
+        printf("Running again recomputed f\n");
+        return -1;
+    }
+
+    // A different buffer holding the same data also hits.
+    Buffer<float> b(W, H);
+    b.copy_from(a);
+    input.set(b);
+    g.realize(result);
+    if (!check(result, b, "copied input") || call_count != W * H) {
+        printf("A copy of the input recomputed f\n");
+        return -1;
+    }
+
+    // Changing the data in the same buffer misses.
+    b(3, 4) = 100.0f;
+    g.realize(result);
+    if (!check(result, b, "changed input") || call_count != 2 * W * H) {
+        printf("Changing the input did not recompute f\n");
+        return -1;
+    }
+
+    // With a version tag, the hash is reused until the version changes.
+    version.set(1);
+    g.realize(result);
+    if (call_count != 2 * W * H) {
+        printf("Setting a version recomputed f\n");
+        return -1;
+    }
+    b(5, 6) = 200.0f;
+    g.realize(result);
+    if (call_count != 2 * W * H) {
+        printf("Same version rehashed the input\n");
+        return -1;
+    }
+    version.set(2);
+    g.realize(result);
+    if (!check(result, b, "new version") || call_count != 3 * W * H) {
+        printf("A new version did not recompute f\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
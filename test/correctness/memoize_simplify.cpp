@@ -0,0 +1,63 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+// A chain of blurs, each computed at the root, so that lowering
+// simplifies many equal bounds expressions.
+Func make_pipeline(ImageParam input) {
+    Var x("x"), y("y");
+    Func clamped = BoundaryConditions::repeat_edge(input);
+    Func prev = clamped;
+    for (int i = 0; i < 6; i++) {
+        Func blur("blur_" + std::to_string(i));
+        blur(x, y) = (prev(x - 1, y) + prev(x, y - 1) + prev(x + 1, y) + prev(x, y + 1)) / 4;
+        if (i < 5) {
+            blur.compute_root().vectorize(x, 8);
+        }
+        prev = blur;
+    }
+    return prev;
+}
+
+int main(int argc, char **argv) {
+    const int W = 97, H = 61;
+    ImageParam input(Int(32), 2, "input");
+    Buffer<int> in(W, H);
+    in.for_each_element([&](int x, int y) {
+        in(x, y) = (x * 37 + y * 101) % 256;
+    });
+    input.set(in);
+
+    Target target = get_jit_target_from_environment();
+
+    // Without the feature, no simplification is reused.
+    int64_t hits_before = Internal::simplify_memo_hit_count();
+    Buffer<int> plain = make_pipeline(input).realize(W, H, target);
+    if (Internal::simplify_memo_hit_count() != hits_before) {
+        printf("Lowering reused simplifications without memoize_simplify\n");
+        return -1;
+    }
+
+    // With it, some are, and the pipeline computes the same thing.
+    hits_before = Internal::simplify_memo_hit_count();
+    Buffer<int> memoized = make_pipeline(input).realize(W, H, target.with_feature(Target::MemoizeSimplify));
+    int64_t hits = Internal::simplify_memo_hit_count() - hits_before;
+    if (hits == 0) {
+        printf("Lowering reused no simplifications with memoize_simplify\n");
+        return -1;
+    }
+    printf("%lld simplifications reused\n", (long long)hits);
+
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            if (plain(x, y) != memoized(x, y)) {
+                printf("memoized(%d, %d) = %d instead of %d\n", x, y, memoized(x, y), plain(x, y));
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
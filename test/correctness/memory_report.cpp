@@ -0,0 +1,54 @@
+#include "Halide.h"
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+
+#include "test/common/halide_test_dirs.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    ImageParam in(Float(32), 2, "in");
+    Func blur_x("blur_x"), blur_y("blur_y");
+    Var x("x"), y("y"), yo("yo"), yi("yi");
+    blur_x(x, y) = in(x, y) + in(x + 1, y) + in(x + 2, y);
+    blur_y(x, y) = blur_x(x, y) + blur_x(x, y + 1) + blur_x(x, y + 2);
+
+    // One strip of blur_x, 10 rows of 1000 floats, per parallel
+    // iteration of blur_y.
+    blur_y.split(y, yo, yi, 8).parallel(yo);
+    blur_x.compute_at(blur_y, yo);
+
+    in.dim(0).set_bounds_estimate(0, 1002);
+    in.dim(1).set_bounds_estimate(0, 802);
+    blur_y.estimate(x, 0, 1000).estimate(y, 0, 800);
+
+    std::string result_file = Internal::get_test_tmp_dir() + "memory_report.memory_report";
+    Internal::ensure_no_file_exists(result_file);
+
+    Target t = get_host_target().with_feature(Target::NoRuntime);
+    blur_y.compile_to(Outputs().memory_report(result_file), {in}, "memory_report", t);
+
+    Internal::assert_file_exists(result_file);
+    std::ifstream file(result_file);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    std::string report = contents.str();
+
+    const char *expected[] = {
+        "blur_x: float32, 40000 bytes, heap, inside",
+        "(parallel, 100 iterations)",
+        "input in: float32, 2 dimensions, 3214416 bytes",
+        "output blur_y: float32, 2 dimensions, 3200000 bytes",
+        "Peak: 4000000 bytes"
+    };
+    for (const char *e : expected) {
+        if (report.find(e) == std::string::npos) {
+            printf("Memory report does not contain \"%s\":\n%s\n", e, report.c_str());
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,115 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <string.h>
+
+using namespace Halide;
+
+// Check that a buffer holds the values written by fill_pattern.
+bool check_pattern(const Buffer<int> &buf, int seed) {
+    for (int y = 0; y < buf.height(); y++) {
+        for (int x = 0; x < buf.width(); x++) {
+            int correct = seed + x + y * 1000;
+            if (buf(x, y) != correct) {
+                printf("buf(%d, %d) = %d instead of %d\n", x, y, buf(x, y), correct);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void fill_pattern(Buffer<int> &buf, int seed) {
+    buf.for_each_element([&](int x, int y) {
+        buf(x, y) = seed + x + y * 1000;
+    });
+}
+
+// Copy a buffer to the device and back again, clearing the host memory
+// in between, so that the values that come back must have been stored in
+// the device buffer.
+bool round_trip(Buffer<int> &buf, int seed) {
+    fill_pattern(buf, seed);
+    buf.set_host_dirty();
+    if (buf.copy_to_device(DeviceAPI::OpenGLCompute) != 0) {
+        printf("copy_to_device failed\n");
+        return false;
+    }
+    memset(buf.data(), 0, buf.size_in_bytes());
+    buf.set_device_dirty();
+    if (buf.copy_to_host() != 0) {
+        printf("copy_to_host failed\n");
+        return false;
+    }
+    return check_pattern(buf, seed);
+}
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (!target.has_feature(Target::OpenGLCompute)) {
+        printf("Not running test because openglcompute is not enabled\n");
+        return 0;
+    }
+
+    // A freed device buffer goes into the pool, and is handed to the
+    // next allocation that fits it.
+    uint64_t pooled;
+    {
+        Buffer<int> a(64, 64);
+        if (!round_trip(a, 1)) {
+            return -1;
+        }
+        pooled = a.raw_buffer()->device;
+        a.device_free();
+    }
+
+    // A slightly smaller buffer reuses it. Only the first part of the
+    // pooled storage holds this buffer's data.
+    {
+        Buffer<int> b(60, 64);
+        if (!round_trip(b, 2)) {
+            return -1;
+        }
+        if (b.raw_buffer()->device != pooled) {
+            printf("Expected the pooled device buffer %d to be reused, got %d\n",
+                   (int)pooled, (int)b.raw_buffer()->device);
+            return -1;
+        }
+        b.device_free();
+    }
+
+    // A buffer that would waste more than half of the pooled storage
+    // gets a new one.
+    {
+        Buffer<int> c(8, 8);
+        if (!round_trip(c, 3)) {
+            return -1;
+        }
+        if (c.raw_buffer()->device == pooled) {
+            printf("A small buffer reused the large pooled device buffer\n");
+            return -1;
+        }
+        c.device_free();
+    }
+
+    // Pipelines run on pooled buffers, including an output smaller than
+    // the buffer it reuses.
+    {
+        Func f;
+        Var x, y, xi, yi;
+        f(x, y) = x + y * 1000 + 4;
+        f.gpu_tile(x, y, xi, yi, 8, 8, TailStrategy::Auto, DeviceAPI::OpenGLCompute);
+
+        for (int width : {64, 60, 64}) {
+            Buffer<int> out = f.realize(width, 64, target);
+            out.copy_to_host();
+            if (!check_pattern(out, 4)) {
+                return -1;
+            }
+        }
+    }
+
+    Internal::JITSharedRuntime::release_all();
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,61 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+size_t largest_allocation = 0;
+
+void *my_malloc(void *user_context, size_t x) {
+    if (x > largest_allocation) {
+        largest_allocation = x;
+    }
+    void *orig = malloc(x+32);
+    void *ptr = (void *)((((size_t)orig + 32) >> 5) << 5);
+    ((void **)ptr)[-1] = orig;
+    return ptr;
+}
+
+void my_free(void *user_context, void *ptr) {
+    free(((void**)ptr)[-1]);
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (t.has_gpu_feature()) {
+        printf("Not running test for gpu targets\n");
+        return 0;
+    }
+
+    t.set_feature(Target::PadStorageStrides);
+
+    // f is 1024 ints wide, so its rows would be 4096 bytes apart. Its
+    // consumer walks down its columns, so the rows should be padded
+    // apart by a cache line (16 ints).
+    Func f("f"), g("g");
+    Var x("x"), y("y");
+    f(x, y) = x * 3 + y;
+    g(x, y) = f(y, x);
+    f.compute_root();
+
+    g.set_custom_allocator(my_malloc, my_free);
+
+    const int W = 1024, H = 16;
+    Buffer<int> result = g.realize(H, W, t);
+    for (int y = 0; y < W; y++) {
+        for (int x = 0; x < H; x++) {
+            int correct = y * 3 + x;
+            if (result(x, y) != correct) {
+                printf("g(%d, %d) = %d instead of %d\n", x, y, result(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    if (largest_allocation < (W + 16) * H * sizeof(int)) {
+        printf("Allocation of %d bytes for f is not padded\n", (int)largest_allocation);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <string.h>
+
+using namespace Halide;
+
+// Pipelines with no embedded buffers or extern calls. Compiled
+// together with compile_jit, their functions share a module whose code
+// is generated and optimized in parallel, one function per thread.
+// Compiled one at a time, each module has a single function, which is
+// generated serially.
+std::vector<Pipeline> make_pipelines(ImageParam input, Param<float> scale) {
+    Var x("x"), y("y");
+    std::vector<Pipeline> pipelines;
+
+    Func blur("blur");
+    blur(x, y) = (input(x, y) + input(x + 1, y) * 2.0f + input(x + 2, y)) * scale;
+    blur.vectorize(x, 8).parallel(y);
+    pipelines.push_back(blur);
+
+    Func trig("trig");
+    trig(x, y) = sin(input(x, y) * scale) + sqrt(abs(input(x, y))) - exp(-input(x, y));
+    trig.vectorize(x, 4);
+    pipelines.push_back(trig);
+
+    Func sum("sum");
+    RDom r(0, 5);
+    sum(x, y) = 0.0f;
+    sum(x, y) += input(x + r, y) * (r + 1);
+    sum.update().parallel(y);
+    pipelines.push_back(sum);
+
+    Func quantize("quantize");
+    quantize(x, y) = cast<float>(cast<int>(input(x, y) * scale * 100.0f) / 7);
+    pipelines.push_back(quantize);
+
+    return pipelines;
+}
+
+int main(int argc, char **argv) {
+    const int W = 64, H = 32;
+    ImageParam input(Float(32), 2, "input");
+    Param<float> scale("scale");
+    Buffer<float> in(W + 8, H);
+    in.for_each_element([&](int x, int y) {
+        in(x, y) = (float)((x * 37 + y * 11) % 29) / 7.0f - 2.0f;
+    });
+    input.set(in);
+    scale.set(1.25f);
+
+    std::vector<Pipeline> batch = make_pipelines(input, scale);
+    std::vector<Pipeline> single = make_pipelines(input, scale);
+    Pipeline::compile_jit(batch);
+    for (Pipeline &p : single) {
+        p.compile_jit();
+    }
+
+    for (size_t i = 0; i < batch.size(); i++) {
+        Buffer<float> parallel_out = batch[i].realize(W, H);
+        Buffer<float> serial_out = single[i].realize(W, H);
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                if (memcmp(&parallel_out(x, y), &serial_out(x, y), sizeof(float)) != 0) {
+                    printf("Pipeline %d: out(%d, %d) is %f with parallel codegen and %f with serial codegen\n",
+                           (int)i, x, y, parallel_out(x, y), serial_out(x, y));
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
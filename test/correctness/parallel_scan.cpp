@@ -0,0 +1,70 @@
+#include <algorithm>
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    // The lengths of the scans aren't multiples of the block size, so
+    // the last block is partial.
+    const int W = 1000, H = 37;
+    Buffer<int> input(W, H);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            input(x, y) = (x * 17 + y * 31) % 101 - 50;
+        }
+    }
+
+    {
+        // A prefix sum along each row that reads the init value of
+        // the element being updated, as a summed-area table does.
+        Var x, y, u, ro, rin;
+        Func f;
+        f(x, y) = input(x, y);
+        RDom r(1, W - 1);
+        f(r, y) = f(r - 1, y) + f(r, y);
+
+        Func f_scan = f.update(0).parallel_scan(r, u, 64);
+        f_scan.update(0).vectorize(y, 8);
+        f.update(0).split(r, ro, rin, 64).parallel(ro).vectorize(rin, 8);
+
+        Buffer<int> out = f.realize(W, H);
+        for (int y = 0; y < H; y++) {
+            int correct = 0;
+            for (int x = 0; x < W; x++) {
+                correct += input(x, y);
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    {
+        // A running max that starts from the value before the scan,
+        // which is not the identity of max.
+        Var x, u;
+        Func f;
+        f(x) = 7;
+        RDom r(1, W - 1);
+        f(r) = max(f(r - 1), input(r, 3));
+
+        f.update(0).parallel_scan(r, u, 50);
+
+        Buffer<int> out = f.realize(W);
+        int correct = 7;
+        for (int x = 0; x < W; x++) {
+            if (x > 0) {
+                correct = std::max(correct, input(x, 3));
+            }
+            if (out(x) != correct) {
+                printf("out(%d) = %d instead of %d\n", x, out(x), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include "Halide.h"
+#include <mutex>
+#include <stdio.h>
+
+using namespace Halide;
+
+// Track the largest allocation made by the pipeline. The tasks of a
+// parallel loop may allocate concurrently.
+std::mutex malloc_mutex;
+size_t max_malloc_size = 0;
+
+void *my_malloc(void *user_context, size_t x) {
+    {
+        std::lock_guard<std::mutex> lock(malloc_mutex);
+        max_malloc_size = std::max(max_malloc_size, x);
+    }
+    void *orig = malloc(x+32);
+    void *ptr = (void *)((((size_t)orig + 32) >> 5) << 5);
+    ((void **)ptr)[-1] = orig;
+    return ptr;
+}
+
+void my_free(void *user_context, void *ptr) {
+    free(((void**)ptr)[-1]);
+}
+
+int main(int argc, char **argv) {
+    const int W = 256, H = 512;
+
+    Target t = get_jit_target_from_environment().with_feature(Target::PerTaskStorage);
+
+    for (int i = 0; i < 2; i++) {
+        Var x("x"), y("y");
+        Func f("f"), g("g");
+        f(x, y) = x * y;
+        g(x, y) = f(x, y - 1) + f(x, y) + f(x, y + 1);
+
+        f.store_root();
+        if (i == 0) {
+            // f can't slide across the parallel loop, so the loop is
+            // split into a strip per thread, over which f slides, and
+            // the storage of each strip is folded to a few rows, rather
+            // than sharing the whole image.
+            f.compute_at(g, y);
+            g.parallel(y);
+        } else {
+            // f slides over the serial rows of each parallel task, and
+            // the storage of each task is folded to a few rows.
+            Var yo("yo"), yi("yi");
+            g.split(y, yo, yi, 16).parallel(yo);
+            f.compute_at(g, yi);
+        }
+
+        max_malloc_size = 0;
+        g.set_custom_allocator(my_malloc, my_free);
+        Buffer<int> out = g.realize(W, H, t);
+
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                int correct = x * (y - 1) + x * y + x * (y + 1);
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+
+        // The whole of f would be W * (H + 2) ints.
+        size_t max_expected = W * 8 * sizeof(int);
+        if (max_malloc_size > max_expected) {
+            printf("Schedule %d allocated %d bytes for f. Expected at most %d\n",
+                   i, (int)max_malloc_size, (int)max_expected);
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,87 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+class CountLoops : public IRMutator2 {
+public:
+    using IRMutator2::mutate;
+    using IRMutator2::visit;
+
+    int count = 0;
+
+    Stmt visit(const For *op) override {
+        count++;
+        return IRMutator2::visit(op);
+    }
+};
+
+// Compile a 5x5 stencil with clamped edges, and return the number of
+// loops in the result.
+int compile_stencil(Buffer<uint16_t> input, float budget,
+                    Buffer<uint16_t> *result) {
+    Func clamped = BoundaryConditions::repeat_edge(input);
+    Var x("x"), y("y");
+    Func blur("blur");
+    Expr sum = cast<uint16_t>(0);
+    for (int dy = -2; dy <= 2; dy++) {
+        for (int dx = -2; dx <= 2; dx++) {
+            sum += clamped(x + dx, y + dy);
+        }
+    }
+    blur(x, y) = sum / 25;
+    blur.vectorize(x, 8);
+    if (budget > 0) {
+        blur.partition_budget(budget);
+    }
+
+    CountLoops *counter = new CountLoops;
+    blur.add_custom_lowering_pass(counter);
+    *result = blur.realize(input.width(), input.height());
+    return counter->count;
+}
+
+int main(int argc, char **argv) {
+    const int W = 64, H = 64;
+    Buffer<uint16_t> input(W, H);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            input(x, y) = rand() & 0xff;
+        }
+    }
+
+    Buffer<uint16_t> unlimited, limited;
+    int unlimited_loops = compile_stencil(input, 0, &unlimited);
+    // With no room to grow, there is nothing to partition.
+    int limited_loops = compile_stencil(input, 1.0f, &limited);
+
+    if (limited_loops >= unlimited_loops) {
+        printf("Expected fewer loops with a budget: %d vs %d\n",
+               limited_loops, unlimited_loops);
+        return -1;
+    }
+
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            int sum = 0;
+            for (int dy = -2; dy <= 2; dy++) {
+                for (int dx = -2; dx <= 2; dx++) {
+                    int cx = std::min(std::max(x + dx, 0), W - 1);
+                    int cy = std::min(std::max(y + dy, 0), H - 1);
+                    sum += input(cx, cy);
+                }
+            }
+            uint16_t correct = sum / 25;
+            if (unlimited(x, y) != correct || limited(x, y) != correct) {
+                printf("blur(%d, %d) = %d and %d instead of %d\n",
+                       x, y, unlimited(x, y), limited(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -9,6 +9,7 @@
 #include "HalideRuntimeCuda.h"
 #include "HalideRuntimeHexagonHost.h"
 #include "HalideRuntimeMetal.h"
+#include "HalideRuntimeNativeBuffer.h"
 #include "HalideRuntimeOpenCL.h"
 #include "HalideRuntimeOpenGL.h"
 #include "HalideRuntimeOpenGLCompute.h"
@@ -392,6 +392,35 @@ int vectorized_predicated_load_const_index_test() {
 
 }  // namespace
 
+int predicate_tail_strategy_test() {
+    int size = 73;
+    Var x("x"), y("y");
+    Func f ("f"), g("g"), ref("ref");
+
+    g(x, y) = x * y;
+    g.compute_root();
+
+    ref(x, y) = g(x, y) * 2 + 1;
+    Buffer<int> im_ref = ref.realize(size, size);
+
+    f(x, y) = g(x, y) * 2 + 1;
+
+    Target target = get_jit_target_from_environment();
+    if (target.features_any_of({Target::HVX_64, Target::HVX_128})) {
+        f.hexagon().vectorize(x, 32, TailStrategy::Predicate);
+    } else if (target.arch == Target::X86) {
+        f.vectorize(x, 32, TailStrategy::Predicate);
+        f.add_custom_lowering_pass(new CheckPredicatedStoreLoad(true, true));
+    }
+
+    Buffer<int> im = f.realize(size, size);
+    auto func = [&im_ref](int x, int y, int z) { return im_ref(x, y, z); };
+    if (check_image(im, func)) {
+        return -1;
+    }
+    return 0;
+}
+
 int main(int argc, char **argv) {
 
     printf("Running vectorized dense load with stride minus one test\n");
@@ -409,6 +438,11 @@ int main(int argc, char **argv) {
         return -1;
     }
 
+    printf("Running predicate tail strategy test\n");
+    if (predicate_tail_strategy_test() != 0) {
+        return -1;
+    }
+
     printf("Running scalar load test\n");
     if (scalar_load_test() != 0) {
         return -1;
@@ -0,0 +1,72 @@
+#include "Halide.h"
+#include <math.h>
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    const int levels = 5;
+    const int W = 256, H = 128;
+
+    Buffer<float> input(W, H, 3);
+    input.for_each_element([&](int x, int y, int c) {
+        input(x, y, c) = (float)((x * 7 + y * 13 + c * 29) % 31) / 31.0f;
+    });
+
+    Var x, y, c;
+    Func base;
+    base(x, y, c) = BoundaryConditions::repeat_edge(input)(x, y, c);
+
+    // Taking a Laplacian pyramid apart and collapsing it again should
+    // give back the image.
+    std::vector<Func> gaussian = Pyramid::gaussian(base, levels);
+    std::vector<Func> laplacian = Pyramid::laplacian(gaussian);
+    std::vector<Func> collapsed = Pyramid::collapse(laplacian);
+    if ((int)gaussian.size() != levels ||
+        (int)laplacian.size() != levels ||
+        (int)collapsed.size() != levels) {
+        printf("Wrong number of pyramid levels\n");
+        return -1;
+    }
+
+    Func output;
+    output(x, y, c) = collapsed[0](x, y, c);
+
+    // The levels use the names of the base's dimensions, so they can be
+    // scheduled with its Vars.
+    Var yo;
+    output.split(y, yo, y, 16).parallel(yo).vectorize(x, 8);
+    Pyramid::schedule_root(gaussian, 1, -1, 8, 2, 8);
+    Pyramid::schedule_at(collapsed, 1, 3, LoopLevel(output, yo), LoopLevel(output, y), 8);
+    Pyramid::schedule_root(collapsed, 3, -1, 8, 0);
+
+    Buffer<float> result = output.realize(W, H, 3);
+    for (int c = 0; c < 3; c++) {
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                float correct = input(x, y, c);
+                if (fabs(result(x, y, c) - correct) > 1e-4f) {
+                    printf("result(%d, %d, %d) = %f instead of %f\n",
+                           x, y, c, result(x, y, c), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    // Each level of the Gaussian pyramid of a constant is the same
+    // constant, at half the size.
+    Func flat;
+    flat(x, y) = 3.0f;
+    std::vector<Func> flat_pyramid = Pyramid::gaussian(flat, levels);
+    Buffer<float> coarsest = flat_pyramid[levels - 1].realize(W >> (levels - 1), H >> (levels - 1));
+    coarsest.for_each_value([&](float v) {
+        if (v != 3.0f) {
+            printf("Coarsest level of a constant is %f instead of 3\n", v);
+            exit(-1);
+        }
+    });
+
+    printf("Success!\n");
+    return 0;
+}
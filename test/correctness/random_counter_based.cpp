@@ -0,0 +1,137 @@
+#include "Halide.h"
+#include <math.h>
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment().with_feature(Target::ThreefryRandom);
+
+    const int W = 1024, H = 1024;
+    const double tol = 0.01;
+    Var x, y;
+
+    // The statistics of a random image.
+    {
+        Func f;
+        f(x, y) = random_float();
+        f.vectorize(x, 8).parallel(y);
+        Buffer<float> im = f.realize(W, H, t);
+
+        double sum = 0, sum_sq = 0, sum_dx = 0, sum_dx_sq = 0;
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                double v = im(x, y);
+                double dx = v - im((x + 1) % W, y);
+                sum += v;
+                sum_sq += v * v;
+                sum_dx += dx;
+                sum_dx_sq += dx * dx;
+            }
+        }
+        const double n = (double)W * H;
+        double mean = sum / n;
+        double variance = sum_sq / n - mean * mean;
+        double mean_dx = sum_dx / n;
+        double variance_dx = sum_dx_sq / n - mean_dx * mean_dx;
+        if (fabs(mean - 0.5) > tol || fabs(variance - 1.0 / 12) > tol ||
+            fabs(mean_dx) > tol || fabs(variance_dx - 1.0 / 6) > tol) {
+            printf("Bad statistics: mean %f variance %f mean_dx %f variance_dx %f\n",
+                   mean, variance, mean_dx, variance_dx);
+            return -1;
+        }
+    }
+
+    // Random ints have half their bits set, with no correlation
+    // between neighboring bits.
+    {
+        Func f;
+        f(x, y) = random_uint();
+        Buffer<uint32_t> im = f.realize(W, H, t);
+        int64_t set_bits = 0, changed_bits = 0;
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                uint32_t v = im(x, y);
+                for (int b = 0; b < 32; b++) {
+                    set_bits += (v >> b) & 1;
+                    changed_bits += ((v ^ (v << 1)) >> b) & 1;
+                }
+            }
+        }
+        const double correct = (double)W * H * 16;
+        if (fabs(set_bits / correct - 1) > tol || fabs(changed_bits / correct - 1) > tol) {
+            printf("Set bits %f and changed bits %f instead of %f\n",
+                   (double)set_bits, (double)changed_bits, correct);
+            return -1;
+        }
+    }
+
+    // The same seed gives the same stream at any vector width. The
+    // random Func is inlined into consumers with different schedules.
+    {
+        Param<int> seed;
+        seed.set(17);
+        Func f;
+        f(x, y) = random_uint(seed);
+        Buffer<uint32_t> reference;
+        for (int vec = 1; vec <= 16; vec *= 2) {
+            Func g;
+            g(x, y) = f(x, y);
+            if (vec > 1) {
+                g.vectorize(x, vec);
+            }
+            Buffer<uint32_t> im = g.realize(64, 64, t);
+            if (!reference.defined()) {
+                reference = im;
+                continue;
+            }
+            for (int y = 0; y < 64; y++) {
+                for (int x = 0; x < 64; x++) {
+                    if (im(x, y) != reference(x, y)) {
+                        printf("At vector width %d, f(%d, %d) = %u instead of %u\n",
+                               vec, x, y, im(x, y), reference(x, y));
+                        return -1;
+                    }
+                }
+            }
+        }
+
+        // A different seed gives a different stream.
+        seed.set(18);
+        Func g;
+        g(x, y) = f(x, y);
+        Buffer<uint32_t> im = g.realize(64, 64, t);
+        int same = 0;
+        for (int y = 0; y < 64; y++) {
+            for (int x = 0; x < 64; x++) {
+                same += im(x, y) == reference(x, y);
+            }
+        }
+        if (same > 2) {
+            printf("%d values were the same for different seeds\n", same);
+            return -1;
+        }
+    }
+
+    // The generator is picked by the target a Func is compiled for,
+    // not when it is defined.
+    {
+        Func f;
+        f(x, y) = random_uint();
+        Buffer<uint32_t> threefry = f.realize(64, 64, t);
+        Buffer<uint32_t> hash = f.realize(64, 64, t.without_feature(Target::ThreefryRandom));
+        int same = 0;
+        for (int y = 0; y < 64; y++) {
+            for (int x = 0; x < 64; x++) {
+                same += threefry(x, y) == hash(x, y);
+            }
+        }
+        if (same > 2) {
+            printf("%d values were the same for both generators\n", same);
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,138 @@
+#include "Halide.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+
+using namespace Halide;
+
+// A transport between threads standing in for ranks, with a queue of
+// messages for each pair of ranks.
+struct Mailboxes {
+    int num_ranks;
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::vector<std::deque<std::vector<char>>> queues;
+
+    Mailboxes(int n) : num_ranks(n), queues(n * n) {}
+};
+
+class ThreadTransport : public DistributedTransport {
+    Mailboxes &mail;
+    int my_rank;
+
+public:
+    ThreadTransport(Mailboxes &mail, int rank) : mail(mail), my_rank(rank) {}
+
+    int rank() override {
+        return my_rank;
+    }
+
+    int size() override {
+        return mail.num_ranks;
+    }
+
+    void send(int to, const void *data, size_t size) override {
+        std::lock_guard<std::mutex> lock(mail.mutex);
+        const char *p = (const char *)data;
+        mail.queues[my_rank * mail.num_ranks + to].emplace_back(p, p + size);
+        mail.cond.notify_all();
+    }
+
+    void recv(int from, void *data, size_t size) override {
+        std::unique_lock<std::mutex> lock(mail.mutex);
+        auto &q = mail.queues[from * mail.num_ranks + my_rank];
+        mail.cond.wait(lock, [&]() { return !q.empty(); });
+        if (q.front().size() != size) {
+            printf("Rank %d expected %d bytes from rank %d but got %d\n",
+                   my_rank, (int)size, from, (int)q.front().size());
+            exit(-1);
+        }
+        memcpy(data, q.front().data(), size);
+        q.pop_front();
+    }
+};
+
+int input_value(int x, int y) {
+    return (x * 5 + y * 11) % 37;
+}
+
+int main(int argc, char **argv) {
+    const int W = 80, H = 70, num_ranks = 3;
+
+    ImageParam in(Int(32), 2, "in");
+    Var x("x"), y("y");
+
+    // A stencil with a halo of two rows above and one below, partitioned
+    // along y.
+    Func clamped("clamped"), blur_y("blur_y"), out("out");
+    clamped = BoundaryConditions::repeat_edge(in, {{0, W}, {0, H}});
+    blur_y(x, y) = clamped(x, y - 2) + clamped(x, y) + clamped(x, y + 1);
+    out(x, y) = blur_y(x - 1, y) + blur_y(x + 1, y);
+    out.distribute(y);
+
+    Pipeline p(out);
+    p.compile_jit();
+
+    // Each rank holds a band of rows of the input, the same bands as the
+    // output slices.
+    std::vector<Buffer<int>> local(num_ranks);
+    for (int r = 0; r < num_ranks; r++) {
+        const int rows = (H + num_ranks - 1) / num_ranks;
+        const int y_min = r * rows, y_extent = std::min(rows, H - y_min);
+        local[r] = Buffer<int>(W, y_extent);
+        local[r].set_min(0, y_min);
+        local[r].for_each_element([&](int x, int y) {
+            local[r](x, y) = input_value(x, y);
+        });
+    }
+
+    Mailboxes mail(num_ranks);
+    std::vector<std::thread> threads;
+    std::vector<Buffer<int>> results(num_ranks);
+    for (int r = 0; r < num_ranks; r++) {
+        threads.emplace_back([&, r]() {
+            ThreadTransport transport(mail, r);
+            Realization slice = p.realize_distributed({W, H}, {{in.name(), local[r]}}, transport);
+            results[r] = slice[0];
+        });
+    }
+    for (std::thread &t : threads) {
+        t.join();
+    }
+
+    int rows_seen = 0;
+    for (int r = 0; r < num_ranks; r++) {
+        const Buffer<int> &slice = results[r];
+        if (slice.dim(1).min() != rows_seen || slice.width() != W) {
+            printf("Rank %d computed rows starting at %d instead of %d\n", r, slice.dim(1).min(), rows_seen);
+            return -1;
+        }
+        rows_seen += slice.height();
+        for (int y = slice.dim(1).min(); y <= slice.dim(1).max(); y++) {
+            for (int x = 0; x < W; x++) {
+                int correct = 0;
+                for (int dx = -1; dx <= 1; dx += 2) {
+                    int cx = std::min(std::max(x + dx, 0), W - 1);
+                    for (int dy : {-2, 0, 1}) {
+                        int cy = std::min(std::max(y + dy, 0), H - 1);
+                        correct += input_value(cx, cy);
+                    }
+                }
+                if (slice(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d on rank %d\n", x, y, slice(x, y), correct, r);
+                    return -1;
+                }
+            }
+        }
+    }
+    if (rows_seen != H) {
+        printf("The slices covered %d rows instead of %d\n", rows_seen, H);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
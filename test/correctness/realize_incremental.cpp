@@ -0,0 +1,72 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    const int W = 128, H = 96;
+
+    Buffer<int> input(W + 2, H + 2);
+    input.set_min(-1, -1);
+    input.for_each_element([&](int x, int y) {
+        input(x, y) = (x * 7 + y * 13) % 50;
+    });
+
+    ImageParam in(Int(32), 2, "in");
+    in.set(input);
+    Var x("x"), y("y");
+
+    Func blur_x("blur_x"), blur_y("blur_y");
+    blur_x(x, y) = in(x - 1, y) + in(x, y) + in(x + 1, y);
+    blur_y(x, y) = blur_x(x, y - 1) + blur_x(x, y) + blur_x(x, y + 1);
+    blur_x.compute_root();
+    blur_y.vectorize(x, 8, TailStrategy::GuardWithIf);
+
+    Pipeline p(blur_y);
+    Buffer<int> out(W, H);
+    Realization r(out);
+    p.realize(r);
+
+    // Edit a small region of the input, and poison the output so we can
+    // tell what was recomputed.
+    const int x0 = 40, y0 = 30, w = 5, h = 3;
+    for (int y = y0; y < y0 + h; y++) {
+        for (int x = x0; x < x0 + w; x++) {
+            input(x, y) = 1000 + x - y;
+        }
+    }
+    out.fill(-1);
+
+    std::vector<std::vector<std::pair<int, int>>> recomputed =
+        p.realize_incremental(r, in.name(), {{x0, w}, {y0, h}});
+
+    // The 3x3 stencil spreads the change by one pixel on each side.
+    if (recomputed.size() != 1 || recomputed[0].size() != 2 ||
+        recomputed[0][0] != std::make_pair(x0 - 1, w + 2) ||
+        recomputed[0][1] != std::make_pair(y0 - 1, h + 2)) {
+        printf("Recomputed the wrong region\n");
+        return -1;
+    }
+
+    Buffer<int> correct = p.realize(W, H);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            bool inside = x >= x0 - 1 && x <= x0 + w && y >= y0 - 1 && y <= y0 + h;
+            int expected = inside ? correct(x, y) : -1;
+            if (out(x, y) != expected) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), expected);
+                return -1;
+            }
+        }
+    }
+
+    // A change to something the pipeline doesn't use recomputes nothing.
+    Buffer<int> unused(4);
+    if (!p.realize_incremental(r, unused.name(), {{0, 4}}).empty()) {
+        printf("Recomputed an output for an unused input\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
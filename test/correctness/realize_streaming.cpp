@@ -0,0 +1,87 @@
+#include "Halide.h"
+#include <algorithm>
+#include <mutex>
+#include <stdio.h>
+
+using namespace Halide;
+
+// The value of the input at each coordinate, which stands in for a
+// file too large to load.
+int input_value(int x, int y) {
+    return (x * 17 + y * 31) % 101;
+}
+
+int main(int argc, char **argv) {
+    const int W = 300, H = 200, tile_w = 64, tile_h = 48;
+
+    ImageParam in(Int(32), 2, "in");
+    Param<int> scale("scale");
+    Var x("x"), y("y");
+
+    Func blur("blur"), out("out");
+    blur(x, y) = in(x - 1, y) + in(x, y) + in(x + 1, y);
+    out(x, y) = (blur(x, y - 1) + blur(x, y + 1)) * scale;
+    blur.compute_at(out, y);
+    out.vectorize(x, 8);
+    scale.set(3);
+
+    std::mutex mutex;
+    int fetches = 0, largest_region = 0;
+    bool bad_region = false;
+    auto fetch = [&](const std::string &name, Buffer<> &region) {
+        Buffer<int> r = region;
+        std::lock_guard<std::mutex> lock(mutex);
+        fetches++;
+        largest_region = std::max(largest_region, r.width() * r.height());
+        // Each region is one tile plus the one pixel footprint of the
+        // stencil on each side.
+        if (name != in.name() || r.width() > tile_w + 2 || r.height() > tile_h + 2) {
+            bad_region = true;
+        }
+        r.for_each_element([&](int x, int y) {
+            r(x, y) = input_value(x, y);
+        });
+    };
+
+    Buffer<int> result(W, H);
+    int tiles = 0;
+    auto sink = [&](Realization &tile) {
+        Buffer<int> t = tile[0];
+        tiles++;
+        t.for_each_element([&](int x, int y) {
+            result(x, y) = t(x, y);
+        });
+    };
+
+    Pipeline p(out);
+    p.realize_streaming({W, H}, {tile_w, tile_h}, fetch, sink);
+
+    const int expected_tiles = ((W + tile_w - 1) / tile_w) * ((H + tile_h - 1) / tile_h);
+    if (tiles != expected_tiles || fetches != expected_tiles) {
+        printf("Ran %d tiles and %d fetches instead of %d\n", tiles, fetches, expected_tiles);
+        return -1;
+    }
+    if (bad_region) {
+        printf("Fetched a region larger than one tile of input (largest %d)\n", largest_region);
+        return -1;
+    }
+
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            int correct = 0;
+            for (int dy = -1; dy <= 1; dy += 2) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    correct += input_value(x + dx, y + dy);
+                }
+            }
+            correct *= 3;
+            if (result(x, y) != correct) {
+                printf("result(%d, %d) = %d instead of %d\n", x, y, result(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -9,7 +9,9 @@ int main(int argc, char **argv) {
                             Target::CUDACapability32,
                             Target::CUDACapability35,
                             Target::CUDACapability50,
-                            Target::CUDACapability61})) {
+                            Target::CUDACapability61,
+                            Target::CUDACapability70,
+                            Target::CUDACapability75})) {
         printf("This test requires cuda enabled with cuda capability 3.0 or greater\n");
         return 0;
     }
@@ -380,6 +382,43 @@ int main(int argc, char **argv) {
         }
     }
 
+    {
+        // Sum rows using a butterfly tree of warp shuffles. Each lane
+        // accumulates a strided part of the row serially, and the
+        // partial sums are then folded across the warp.
+        Func f, g;
+        Var x, y;
+        f(x, y) = cast<float>((x + y) % 17);
+        f.compute_root();
+
+        RDom r(0, 1024);
+        g(y) = 0.0f;
+        g(y) += f(r, y);
+
+        Var yi, lane;
+        RVar ro, ri;
+        Func intm = g.update().split(r, ro, ri, 32).rfactor(ri, lane);
+        g.gpu_tile(y, yi, 4);
+        g.update().gpu_tile(y, yi, 4);
+        intm.compute_at(g, yi).gpu_lanes(lane);
+        intm.update().reorder(ro, lane).gpu_lanes(lane);
+
+        Buffer<float> out = g.realize(64);
+
+        for (int y = 0; y < out.width(); y++) {
+            float correct = 0;
+            for (int x = 0; x < 1024; x++) {
+                correct += (x + y) % 17;
+            }
+            // The floats are small integers, so they should be exact.
+            float actual = out(y);
+            if (correct != actual) {
+                printf("out(%d) = %f instead of %f\n", y, actual, correct);
+                return -1;
+            }
+        }
+    }
+
     printf("Success!\n");
     return 0;
 }
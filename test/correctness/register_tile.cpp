@@ -0,0 +1,58 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    const int vec = target.natural_vector_size<float>();
+    const int regs = target.vector_register_count();
+    if (vec <= 0 || regs <= 0) {
+        printf("Bad register file estimate: %d registers of %d lanes\n", regs, vec);
+        return -1;
+    }
+
+    // A matrix size that leaves partial register blocks in both
+    // dimensions, which GuardWithIf handles without reading past the
+    // ends of the inputs.
+    const int N = vec * 8 + 3, K = 37;
+
+    Buffer<float> A(K, N), B(N, K);
+    for (int y = 0; y < N; y++) {
+        for (int x = 0; x < K; x++) {
+            A(x, y) = (float)((x * 3 + y * 5) % 7) - 3.0f;
+        }
+    }
+    for (int y = 0; y < K; y++) {
+        for (int x = 0; x < N; x++) {
+            B(x, y) = (float)((x * 11 + y * 2) % 9) - 4.0f;
+        }
+    }
+
+    Var x("x"), y("y");
+    RDom k(0, K);
+
+    Func prod("prod"), out("out");
+    prod(x, y) = 0.0f;
+    prod(x, y) += A(k, y) * B(x, k);
+    out(x, y) = prod(x, y);
+
+    prod.compute_root().register_tile(x, y, target, TailStrategy::GuardWithIf);
+
+    Buffer<float> result = out.realize(N, N, target);
+    for (int y = 0; y < N; y++) {
+        for (int x = 0; x < N; x++) {
+            float correct = 0.0f;
+            for (int i = 0; i < K; i++) {
+                correct += A(i, y) * B(x, i);
+            }
+            if (result(x, y) != correct) {
+                printf("out(%d, %d) = %f instead of %f\n", x, y, result(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int malloc_count = 0;
+
+void *my_malloc(void *user_context, size_t x) {
+    malloc_count++;
+    void *orig = malloc(x+32);
+    void *ptr = (void *)((((size_t)orig + 32) >> 5) << 5);
+    ((void **)ptr)[-1] = orig;
+    return ptr;
+}
+
+void my_free(void *user_context, void *ptr) {
+    free(((void**)ptr)[-1]);
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (t.has_gpu_feature()) {
+        printf("Not running test for gpu targets\n");
+        return 0;
+    }
+
+    t.set_feature(Target::ReuseProducerStorage);
+
+    // f2 and f3 are pointwise in their only producer, so they are
+    // computed in place over f1. f4 reads f3 at two points, so it
+    // needs storage of its own.
+    Func f1("f1"), f2("f2"), f3("f3"), f4("f4"), out("out");
+    Var x("x"), y("y"), xi("xi");
+    f1(x, y) = x + y;
+    f2(x, y) = f1(x, y) * 3;
+    f3(x, y) = f2(x, y) - x;
+    f4(x, y) = f3(x, y) + f3(x + 1, y);
+    out(x, y) = f4(x, y) + 1;
+
+    f1.compute_root();
+    f2.compute_root().split(x, x, xi, 8, TailStrategy::GuardWithIf).vectorize(xi).parallel(y);
+    f3.compute_root();
+    f4.compute_root();
+
+    out.set_custom_allocator(my_malloc, my_free);
+
+    for (int size : {5, 100}) {
+        malloc_count = 0;
+        Buffer<int> result = out.realize(size, 7, t);
+        for (int y = 0; y < result.height(); y++) {
+            for (int x = 0; x < result.width(); x++) {
+                auto f3 = [&](int x) { return (x + y) * 3 - x; };
+                int correct = f3(x) + f3(x + 1) + 1;
+                if (result(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, result(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+        if (malloc_count != 2) {
+            printf("Expected two allocations, got %d\n", malloc_count);
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,87 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+// A small pipeline with an update stage. Each call makes new Funcs
+// with the same names.
+Pipeline make_pipeline(Func &in, Func &blur, Func &hist, Func &out) {
+    Var x("x"), y("y");
+    in = Func("in");
+    blur = Func("blur");
+    hist = Func("hist");
+    out = Func("out");
+    in(x, y) = (x * 17 + y * 31) % 64;
+    blur(x, y) = (in(x - 1, y) + in(x, y) + in(x + 1, y)) / 3;
+    RDom r(0, 64, 0, 64, "r");
+    hist(x) = 0;
+    hist(clamp(blur(r.x, r.y), 0, 63)) += 1;
+    out(x, y) = blur(x, y) + hist(x % 64);
+    return Pipeline(out);
+}
+
+int main(int argc, char **argv) {
+    Func in, blur, hist, out;
+    Pipeline p = make_pipeline(in, blur, hist, out);
+
+    Var x("x"), y("y"), xo("xo"), yo("yo"), xi("xi"), yi("yi"), t("t");
+    RVar rx("r$x"), ry("r$y");
+    out.tile(x, y, xo, yo, xi, yi, 16, 8, TailStrategy::GuardWithIf)
+        .fuse(xo, yo, t)
+        .parallel(t)
+        .vectorize(xi, 4);
+    blur.compute_at(out, t).store_in(MemoryType::Stack).vectorize(x, 8);
+    in.compute_root().reorder_storage(y, x).bound(x, -1, 66);
+    hist.compute_root();
+    hist.update(0).unroll(rx, 2);
+
+    Buffer<int> correct = p.realize(64, 64);
+
+    std::string schedule = serialize_schedule(p);
+    printf("%s", schedule.c_str());
+
+    // Applying the schedule to the unscheduled pipeline should give
+    // back the same schedule, and the same result.
+    Pipeline p2 = make_pipeline(in, blur, hist, out);
+    apply_schedule(p2, schedule);
+    std::string schedule2 = serialize_schedule(p2);
+    if (schedule2 != schedule) {
+        printf("Schedule after a round trip:\n%s", schedule2.c_str());
+        return -1;
+    }
+    Buffer<int> result = p2.realize(64, 64);
+    for (int y = 0; y < 64; y++) {
+        for (int x = 0; x < 64; x++) {
+            if (result(x, y) != correct(x, y)) {
+                printf("result(%d, %d) = %d instead of %d\n", x, y, result(x, y), correct(x, y));
+                return -1;
+            }
+        }
+    }
+
+    // Directives may be chained, and mixed with comments.
+    Pipeline p3 = make_pipeline(in, blur, hist, out);
+    apply_schedule(p3,
+                   "# Tile the output\n"
+                   "out.split(y, yo, yi, 8, TailStrategy::GuardWithIf).parallel(yo)\n"
+                   "blur.compute_at(out, yo); blur.vectorize(x, 4)\n"
+                   "hist.compute_root()\n");
+    std::string schedule3 = serialize_schedule(p3);
+    if (schedule3.find("blur.compute_at(out, yo)\n") == std::string::npos ||
+        schedule3.find("out.parallel(yo)\n") == std::string::npos) {
+        printf("Chained schedule was not applied:\n%s", schedule3.c_str());
+        return -1;
+    }
+    result = p3.realize(64, 64);
+    for (int y = 0; y < 64; y++) {
+        for (int x = 0; x < 64; x++) {
+            if (result(x, y) != correct(x, y)) {
+                printf("result(%d, %d) = %d instead of %d\n", x, y, result(x, y), correct(x, y));
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -51,6 +51,7 @@ struct Test {
     bool use_avx512_cannonlake{false};
     bool use_avx512_knl{false};
     bool use_avx512_skylake{false};
+    bool use_avx512_vnni{false};
     bool use_avx{false};
     bool use_power_arch_2_07{false};
     bool use_sse41{false};
@@ -86,6 +87,7 @@ struct Test {
         use_avx512_knl = target.has_feature(Target::AVX512_KNL);
         use_avx512_cannonlake = target.has_feature(Target::AVX512_Cannonlake);
         use_avx512_skylake = use_avx512_cannonlake || target.has_feature(Target::AVX512_Skylake);
+        use_avx512_vnni = use_avx512_skylake && target.has_feature(Target::AVX512_VNNI);
         use_avx512 = use_avx512_knl || use_avx512_skylake || use_avx512_cannonlake || target.has_feature(Target::AVX512);
         use_avx2 = use_avx512 || target.has_feature(Target::AVX2);
         use_avx = use_avx2 || target.has_feature(Target::AVX);
@@ -361,6 +363,8 @@ struct Test {
             check("pavgb", 8*w, u8((u16(u8_1) + u16(u8_2) + 1)>>1));
             check("pavgw", 4*w, u16((u32(u16_1) + u32(u16_2) + 1)/2));
             check("pavgw", 4*w, u16((u32(u16_1) + u32(u16_2) + 1)>>1));
+            check("pavgb", 8*w, u8((u16(u8_1) + u16(u8_2))/2));
+            check("pavgw", 4*w, u16((u32(u16_1) + u32(u16_2))/2));
             check("pmaxsw", 4*w, max(i16_1, i16_2));
             check("pminsw", 4*w, min(i16_1, i16_2));
             check("pmaxub", 8*w, max(u8_1, u8_2));
@@ -447,6 +451,11 @@ struct Test {
                 check("pabsb", 8*w, abs(i8_1));
                 check("pabsw", 4*w, abs(i16_1));
                 check("pabsd", 2*w, abs(i32_1));
+
+                const char *check_pmulhrsw = (use_avx2 && w > 3) ? "vpmulhrsw*ymm" : "pmulhrsw";
+                check(check_pmulhrsw, 4*w, i16((i32(i16_1) * i32(i16_2) + 16384) / 32768));
+                check(check_pmulhrsw, 4*w, i16((i32(i16_1) * i32(i16_2) + (1 << 14)) >> 15));
+                check(check_pmulhrsw, 4*w, i16((i32(i16_1) + 8) >> 4));
             }
         }
 
@@ -645,6 +654,16 @@ struct Test {
             check("vpminuq", 8, min(u64_1, u64_2));
             check("vpmaxsq", 8, max(i64_1, i64_2));
             check("vpminsq", 8, min(i64_1, i64_2));
+
+            // Comparisons write mask registers directly.
+            check("vpcmpled", 16, select(i32_1 <= i32_2, i32_1, i32_3));
+            check("vpcmpleud", 16, select(u32_1 <= u32_2, u32_1, u32_3));
+            check("vpcmpneqd", 16, select(i32_1 != i32_2, i32_1, i32_3));
+        }
+        if (use_avx512_vnni) {
+            check("vpdpbusd", 16, i32_1 + i32(u8_1) * i32(i8_1) + i32(u8_2) * i32(i8_2) +
+                                      i32(u8_3) * i32(i8_3) + i32(u8_1) * i32(i8_3));
+            check("vpdpwssd", 16, i32_1 + i32(i16_1) * i32(i16_2) + i32(i16_3) * i32(i16_1));
         }
     }
 
@@ -1416,6 +1435,17 @@ struct Test {
         // Interleave or deinterleave two vectors. Given that we use
         // interleaving loads and stores, it's hard to hit this op with
         // halide.
+
+        // SDOT/UDOT X   -       Dot Product
+        // Requires the ARMv8.2 dot product extension
+        if (target.has_feature(Target::ARMDotProd)) {
+            for (int w = 1; w <= 2; w++) {
+                check(arm32 ? "vsdot.s8" : "sdot", 4*w, i32_1 + i32(i8_1) * i8_2 + i32(i8_2) * i8_3 +
+                                                        i32(i8_3) * i8_1 + i32(i8_1) * i8_1);
+                check(arm32 ? "vudot.u8" : "udot", 4*w, u32_1 + u32(u8_1) * u8_2 + u32(u8_2) * u8_3 +
+                                                        u32(u8_3) * u8_1 + u32(u8_1) * u8_1);
+            }
+        }
     }
 
     void check_hvx_all() {
@@ -2055,6 +2085,83 @@ check("v*.w += vrmpy(v*.b,v*.b)", hvx_width, i32_1 + i32(i8_1)*i8_1 + i32(i8_2)*
         }
     }
 
+    void check_wasm_all() {
+        Expr f32_1 = in_f32(x), f32_2 = in_f32(x+16);
+        Expr f64_1 = in_f64(x), f64_2 = in_f64(x+16);
+        Expr i8_1  = in_i8(x),  i8_2  = in_i8(x+16);
+        Expr u8_1  = in_u8(x),  u8_2  = in_u8(x+16);
+        Expr i16_1 = in_i16(x), i16_2 = in_i16(x+16);
+        Expr u16_1 = in_u16(x), u16_2 = in_u16(x+16);
+        Expr i32_1 = in_i32(x), i32_2 = in_i32(x+16);
+
+        for (int w = 1; w <= 4; w++) {
+            check("i8x16.add", 16*w, i8_1 + i8_2);
+            check("i16x8.add", 8*w, i16_1 + i16_2);
+            check("i32x4.add", 4*w, i32_1 + i32_2);
+            check("i8x16.sub", 16*w, i8_1 - i8_2);
+            check("i16x8.sub", 8*w, i16_1 - i16_2);
+            check("i32x4.sub", 4*w, i32_1 - i32_2);
+            check("i16x8.mul", 8*w, i16_1 * i16_2);
+            check("i32x4.mul", 4*w, i32_1 * i32_2);
+
+            check("f32x4.add", 4*w, f32_1 + f32_2);
+            check("f32x4.mul", 4*w, f32_1 * f32_2);
+            check("f32x4.sqrt", 4*w, sqrt(f32_1));
+            check("f64x2.add", 2*w, f64_1 + f64_2);
+            check("f64x2.div", 2*w, f64_1 / f64_2);
+
+            // The names of the saturating ops changed between
+            // versions of the proposal.
+            check("i8x16.add_sat*_s", 16*w, i8_sat(i16(i8_1) + i16(i8_2)));
+            check("i8x16.add_sat*_u", 16*w, u8_sat(u16(u8_1) + u16(u8_2)));
+            check("i16x8.add_sat*_s", 8*w, i16_sat(i32(i16_1) + i32(i16_2)));
+            check("i16x8.add_sat*_u", 8*w, u16_sat(u32(u16_1) + u32(u16_2)));
+            check("i8x16.sub_sat*_s", 16*w, i8_sat(i16(i8_1) - i16(i8_2)));
+            check("i8x16.sub_sat*_u", 16*w, u8(max(i16(u8_1) - i16(u8_2), 0)));
+            check("i16x8.sub_sat*_s", 8*w, i16_sat(i32(i16_1) - i32(i16_2)));
+            check("i16x8.sub_sat*_u", 8*w, u16(max(i32(u16_1) - i32(u16_2), 0)));
+        }
+    }
+
+    void check_riscv_all() {
+        Expr f32_1 = in_f32(x), f32_2 = in_f32(x+16);
+        Expr f64_1 = in_f64(x), f64_2 = in_f64(x+16);
+        Expr i8_1  = in_i8(x),  i8_2  = in_i8(x+16);
+        Expr u8_1  = in_u8(x),  u8_2  = in_u8(x+16);
+        Expr i16_1 = in_i16(x), i16_2 = in_i16(x+16);
+        Expr u16_1 = in_u16(x), u16_2 = in_u16(x+16);
+        Expr i32_1 = in_i32(x), i32_2 = in_i32(x+16);
+        Expr u32_1 = in_u32(x), u32_2 = in_u32(x+16);
+
+        // RVV instructions don't encode the element width, so these
+        // can only check the operation.
+        for (int w = 1; w <= 4; w++) {
+            check("vadd.v", 16*w, i8_1 + i8_2);
+            check("vadd.v", 8*w, i16_1 + i16_2);
+            check("vadd.v", 4*w, i32_1 + i32_2);
+            check("vsub.vv", 16*w, i8_1 - i8_2);
+            check("vsub.vv", 4*w, i32_1 - i32_2);
+            check("vmul.vv", 8*w, i16_1 * i16_2);
+            check("vmul.vv", 4*w, i32_1 * i32_2);
+            check("vmax.vv", 4*w, max(i32_1, i32_2));
+            check("vminu.vv", 8*w, min(u16_1, u16_2));
+
+            check("vfadd.vv", 4*w, f32_1 + f32_2);
+            check("vfmul.vv", 4*w, f32_1 * f32_2);
+            check("vfsqrt.v", 4*w, sqrt(f32_1));
+            check("vfadd.vv", 2*w, f64_1 + f64_2);
+            check("vfdiv.vv", 2*w, f64_1 / f64_2);
+
+            check("vsadd.vv", 16*w, i8_sat(i16(i8_1) + i16(i8_2)));
+            check("vsaddu.vv", 16*w, u8_sat(u16(u8_1) + u16(u8_2)));
+            check("vsadd.vv", 8*w, i16_sat(i32(i16_1) + i32(i16_2)));
+            check("vsaddu.vv", 4*w, u32_sat(u64(u32_1) + u64(u32_2)));
+            check("vssub.vv", 16*w, i8_sat(i16(i8_1) - i16(i8_2)));
+            check("vssubu.vv", 8*w, u16(max(i32(u16_1) - i32(u16_2), 0)));
+            check("vssub.vv", 4*w, i32_sat(i64(i32_1) - i64(i32_2)));
+        }
+    }
+
     bool test_all() {
         // Queue up a bunch of tasks representing each test to run.
         if (target.arch == Target::X86) {
@@ -2065,6 +2172,10 @@ check("v*.w += vrmpy(v*.b,v*.b)", hvx_width, i32_1 + i32(i8_1)*i8_1 + i32(i8_2)*
             check_hvx_all();
         } else if (target.arch == Target::POWERPC) {
             check_altivec_all();
+        } else if (target.arch == Target::WebAssembly) {
+            check_wasm_all();
+        } else if (target.arch == Target::RISCV && target.has_feature(Target::RISCV_V)) {
+            check_riscv_all();
         }
 
         Halide::Internal::ThreadPool<TestResult> pool(num_threads);
@@ -0,0 +1,66 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+int call_count = 0;
+extern "C" DLLEXPORT int call_counter(int x) {
+    call_count++;
+    return x;
+}
+HalideExtern_1(int, call_counter, int);
+
+int main(int argc, char **argv) {
+    const int W = 128, H = 96, tile = 16;
+    const int tiles_x = W / tile, tiles_y = H / tile;
+
+    // A sparse mask with one entry per tile.
+    Buffer<bool> tile_mask(tiles_x, tiles_y);
+    int active_tiles = 0;
+    tile_mask.for_each_element([&](int x, int y) {
+        tile_mask(x, y) = (x * 3 + y * 5) % 7 == 0;
+        active_tiles += tile_mask(x, y);
+    });
+
+    Var x("x"), y("y"), xo("xo"), yo("yo"), xi("xi"), yi("yi");
+    Func mask("mask"), producer("producer"), consumer("consumer");
+    mask(x, y) = tile_mask(x, y);
+    producer(x, y) = call_counter(x + y);
+    consumer(x, y) = producer(x, y) * 2;
+
+    mask.compute_root();
+    consumer.tile(x, y, xo, yo, xi, yi, tile, tile, TailStrategy::GuardWithIf)
+        .skip_unless(mask(x / tile, y / tile), xo);
+    producer.compute_at(consumer, xo);
+
+    const int sentinel = -1;
+    Buffer<int> out(W, H);
+    out.fill(sentinel);
+    consumer.realize(out);
+
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            int correct = tile_mask(x / tile, y / tile) ? (x + y) * 2 : sentinel;
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    // The producer should only have been computed for the active tiles.
+    if (call_count != active_tiles * tile * tile) {
+        printf("The producer was computed at %d points instead of %d\n",
+               call_count, active_tiles * tile * tile);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <atomic>
+
+using namespace Halide;
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+std::atomic<int> count;
+extern "C" DLLEXPORT int call_counter(int x, int y) {
+    count++;
+    return 0;
+}
+HalideExtern_2(int, call_counter, int, int);
+
+int check(const Buffer<int> &out) {
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            int correct = 3 * (x + y);
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    // Parallel loops are split into one strip per thread.
+#ifdef _WIN32
+    _putenv_s("HL_NUM_THREADS", "4");
+#else
+    setenv("HL_NUM_THREADS", "4", 1);
+#endif
+
+    Target t = get_jit_target_from_environment().with_feature(Target::PerTaskStorage);
+
+    const int W = 16, H = 32;
+    Var x("x"), y("y"), yo("yo"), yi("yi");
+
+    // Tasks of eight rows each slide over their own rows.
+    {
+        count = 0;
+        Func g("g"), out("out");
+        g(x, y) = call_counter(x, y) + x + y;
+        out(x, y) = g(x, y - 1) + g(x, y) + g(x, y + 1);
+
+        out.split(y, yo, yi, 8).parallel(yo);
+        g.store_root().compute_at(out, yi);
+
+        Buffer<int> result = out.realize(W, H, t);
+        if (check(result)) {
+            return -1;
+        }
+        int correct = (H / 8) * (8 + 2) * W;
+        if (count != correct) {
+            printf("g was called %d times instead of %d times\n", (int)count, correct);
+            return -1;
+        }
+    }
+
+    // A parallel loop over single rows is split into four strips, one
+    // per thread, which each slide after computing the footprint of their first row.
+    {
+        count = 0;
+        Func g("g"), out("out");
+        g(x, y) = call_counter(x, y) + x + y;
+        out(x, y) = g(x, y - 1) + g(x, y) + g(x, y + 1);
+
+        out.parallel(y);
+        g.store_root().compute_at(out, y);
+
+        Buffer<int> result = out.realize(W, H, t);
+        if (check(result)) {
+            return -1;
+        }
+        int correct = (H + 4 * 2) * W;
+        if (count != correct) {
+            printf("g was called %d times instead of %d times\n", (int)count, correct);
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include "Halide.h"
+#include <algorithm>
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    const int W = 128, H = 64;
+    Buffer<uint8_t> in(W + 2, H + 2);
+    for (int y = 0; y < H + 2; y++) {
+        for (int x = 0; x < W + 2; x++) {
+            in(x, y) = (uint8_t)((x * 73 + y * 151 + (x * y) % 17) & 0xff);
+        }
+    }
+
+    Var x("x"), y("y");
+
+    // A vectorized 3x3 median filter.
+    {
+        RDom r(0, 3, 0, 3);
+        Func f("f");
+        f(x, y) = median(in(x + r.x, y + r.y));
+        f.vectorize(x, 16);
+        Buffer<uint8_t> out = f.realize(W, H);
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                uint8_t window[9];
+                for (int i = 0; i < 9; i++) {
+                    window[i] = in(x + i % 3, y + i / 3);
+                }
+                std::sort(window, window + 9);
+                if (out(x, y) != window[4]) {
+                    printf("median(%d, %d) = %d instead of %d\n", x, y, out(x, y), window[4]);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    // The second smallest of a 5-point cross, using the predicate of the
+    // domain to drop the corners.
+    {
+        RDom r(-1, 3, -1, 3);
+        r.where(r.x == 0 || r.y == 0);
+        Func f("f");
+        f(x, y) = kth_smallest(in(x + 1 + r.x, y + 1 + r.y), 1);
+        f.vectorize(x, 8);
+        Buffer<uint8_t> out = f.realize(W, H);
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                uint8_t cross[5] = {in(x + 1, y + 1), in(x, y + 1), in(x + 2, y + 1),
+                                    in(x + 1, y), in(x + 1, y + 2)};
+                std::sort(cross, cross + 5);
+                if (out(x, y) != cross[1]) {
+                    printf("kth_smallest(%d, %d) = %d instead of %d\n", x, y, out(x, y), cross[1]);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    // Sorting a handful of values as the outputs of a Tuple.
+    {
+        std::vector<Expr> values;
+        for (int i = 0; i < 6; i++) {
+            values.push_back(cast<int>(in(x + i, y)) * (i % 2 ? 1 : -1));
+        }
+        Func f("f");
+        f(x, y) = Tuple(sort_network(values));
+        f.vectorize(x, 8);
+        Realization out = f.realize(W, H);
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                int correct[6];
+                for (int i = 0; i < 6; i++) {
+                    correct[i] = in(x + i, y) * (i % 2 ? 1 : -1);
+                }
+                std::sort(correct, correct + 6);
+                for (int i = 0; i < 6; i++) {
+                    Buffer<int> b = out[i];
+                    if (b(x, y) != correct[i]) {
+                        printf("sorted %d at (%d, %d) = %d instead of %d\n", i, x, y, b(x, y), correct[i]);
+                        return -1;
+                    }
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -34,6 +34,32 @@ int main(int argc, char **argv) {
 
     h.realize(10, 10);
 
+    // A tile of a Func computed inside a parallel loop, whose size
+    // depends on where the tile is but is at most 32x32, should also
+    // go on the stack.
+    {
+        Func f, g;
+        f(x, y) = x * y;
+        g(x, y) = f(x, y) + f(x, y + 1);
+
+        Var xo, yo;
+        g.tile(x, y, xo, yo, xi, yi, 32, 31, TailStrategy::GuardWithIf).parallel(yo);
+        f.compute_at(g, xo);
+
+        g.set_custom_allocator(&my_malloc, &my_free);
+
+        Buffer<int> out = g.realize(100, 70);
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                int correct = x * y + x * (y + 1);
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
     printf("Success!\n");
     return 0;
 }
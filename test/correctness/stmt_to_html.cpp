@@ -1,4 +1,6 @@
 #include "Halide.h"
+#include <fstream>
+#include <sstream>
 #include <stdio.h>
 
 #include "test/common/halide_test_dirs.h"
@@ -45,6 +47,29 @@ int main() {
     tuple_func.compile_to_lowered_stmt(result_file_3, {}, Halide::HTML);
     Internal::assert_file_exists(result_file_3);
 
+    // Annotate with a profiler report.
+    std::string report_file = Internal::get_test_tmp_dir() + "stmt_to_html_profile.json";
+    {
+        std::ofstream report(report_file.c_str());
+        report << "{\"pipelines\": [{\"name\": \"gradient_fast\", \"runs\": 2, \"time_ns\": 4000000, "
+               << "\"funcs\": [{\"name\": \"gradient_fast\", \"time_ns\": 3000000, \"average_threads\": 3.5, "
+               << "\"heap_allocations\": 0, \"latency\": {\"p50_ns\": 1500000}}]}]}";
+    }
+    std::string result_file_4 = Internal::get_test_tmp_dir() + "stmt_to_html_dump_4.html";
+    Internal::ensure_no_file_exists(result_file_4);
+    gradient_fast.compile_to_lowered_stmt(result_file_4, {}, Halide::HTML,
+                                          get_target_from_environment(), report_file);
+    Internal::assert_file_exists(result_file_4);
+    {
+        std::ifstream html(result_file_4.c_str());
+        std::stringstream contents;
+        contents << html.rdbuf();
+        if (contents.str().find("1.5 ms/run (75%)") == std::string::npos) {
+            printf("Profile annotation missing from %s\n", result_file_4.c_str());
+            return -1;
+        }
+    }
+
     printf("Success!\n");
     return 0;
 }
@@ -499,6 +499,38 @@ int main(int argc, char **argv) {
     }
 
 
+    {
+        // A 5-tap vertical stencil folded by a factor that isn't a
+        // power of two. The folded coordinates are computed from a
+        // per-row rotating base rather than a modulo.
+        custom_malloc_size = 0;
+        Func f, g;
+
+        f(x, y) = x * y;
+        g(x, y) = f(x, y - 2) + f(x, y - 1) + f(x, y) + f(x, y + 1) + f(x, y + 2);
+        f.store_root().compute_at(g, y).fold_storage(y, 5);
+
+        g.set_custom_allocator(my_malloc, my_free);
+
+        Buffer<int> im = g.realize(100, 1000);
+
+        size_t expected_size = 100*5*sizeof(int) + sizeof(int);
+        if (custom_malloc_size == 0 || custom_malloc_size != expected_size) {
+            printf("Scratch space allocated was %d instead of %d\n", (int)custom_malloc_size, (int)expected_size);
+            return -1;
+        }
+
+        for (int y = 0; y < im.height(); y++) {
+            for (int x = 0; x < im.width(); x++) {
+                int correct = 5 * x * y;
+                if (im(x, y) != correct) {
+                    printf("im(%d, %d) = %d instead of %d\n", x, y, im(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
     {
         // Check a case which used to be problematic
         Func input, a, b, c, output;
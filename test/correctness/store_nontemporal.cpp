@@ -0,0 +1,52 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    const int W = 1024, H = 256;
+
+    Var x("x"), y("y"), xi("xi");
+
+    // A large intermediate Func that is written once and read by the
+    // next stage, stored with non-temporal stores.
+    Func f("f"), g("g");
+    f(x, y) = x * 3 + y;
+    g(x, y) = f(x, y) + f(W - 1 - x, y);
+
+    Target target = get_jit_target_from_environment();
+    f.compute_root().store_nontemporal().vectorize(x, target.natural_vector_size<int>()).parallel(y);
+    g.vectorize(x, 8).parallel(y);
+
+    Buffer<int> out = g.realize(W, H);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            int correct = (x * 3 + y) + ((W - 1 - x) * 3 + y);
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    // A Tuple-valued output with a split and a serial tail.
+    Func h("h");
+    h(x, y) = Tuple(cast<float>(x + y), cast<uint8_t>(x - y));
+    h.store_nontemporal().split(x, x, xi, 16, TailStrategy::GuardWithIf).vectorize(xi);
+
+    Realization r = h.realize(W - 3, H);
+    Buffer<float> r0 = r[0];
+    Buffer<uint8_t> r1 = r[1];
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W - 3; x++) {
+            if (r0(x, y) != (float)(x + y) || r1(x, y) != (uint8_t)(x - y)) {
+                printf("h(%d, %d) = {%f, %d} instead of {%f, %d}\n",
+                       x, y, r0(x, y), r1(x, y), (float)(x + y), (uint8_t)(x - y));
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
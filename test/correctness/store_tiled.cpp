@@ -0,0 +1,99 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+class CountAllocations : public IRMutator2 {
+public:
+    using IRMutator2::mutate;
+    using IRMutator2::visit;
+
+    int count = 0;
+
+    Stmt visit(const Allocate *op) override {
+        count++;
+        return IRMutator2::visit(op);
+    }
+};
+
+int main(int argc, char **argv) {
+    // Extents that are not a multiple of the tile size.
+    const int W = 100, H = 37;
+
+    Var x("x"), y("y"), c("c");
+
+    // A transpose of an intermediate stored in 8x8 tiles.
+    {
+        Func f("f"), g("g");
+        f(x, y) = x * 1000 + y;
+        g(x, y) = f(y, x) + f(y + 1, x + 3);
+        f.compute_root().store_tiled(x, y, 8, 8);
+
+        Buffer<int> out = g.realize(W, H);
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                int correct = (y * 1000 + x) + ((y + 1) * 1000 + x + 3);
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    // Tiles of different sizes in each dimension on a three-dimensional
+    // Func with an update, computed within the tiles of the consumer.
+    {
+        Func f("f"), g("g");
+        f(c, x, y) = c + x * 10 + y * 100;
+        f(c, x, y) += 1;
+        g(x, y, c) = f(c, y, x);
+
+        Var xo, yo, xi, yi;
+        g.tile(x, y, xo, yo, xi, yi, 16, 16);
+        f.compute_at(g, xo).store_tiled(x, y, 4, 2);
+
+        Buffer<int> out = g.realize(W, H, 3);
+        for (int c = 0; c < 3; c++) {
+            for (int y = 0; y < H; y++) {
+                for (int x = 0; x < W; x++) {
+                    int correct = c + y * 10 + x * 100 + 1;
+                    if (out(x, y, c) != correct) {
+                        printf("out(%d, %d, %d) = %d instead of %d\n", x, y, c, out(x, y, c), correct);
+                        return -1;
+                    }
+                }
+            }
+        }
+    }
+
+    // An interleaved Tuple stored in tiles, which is still a single
+    // allocation.
+    {
+        Func f("f"), g("g");
+        f(x, y) = Tuple(x + y, x - y);
+        g(x, y) = f(y, x)[0] * f(y, x)[1];
+        f.compute_root().store_tuple_interleaved().store_tiled(x, y, 8, 4);
+
+        CountAllocations *counter = new CountAllocations;
+        g.add_custom_lowering_pass(counter);
+        Buffer<int> out = g.realize(W, H);
+        if (counter->count != 1) {
+            printf("Expected one allocation instead of %d\n", counter->count);
+            return -1;
+        }
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                int correct = (y + x) * (y - x);
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
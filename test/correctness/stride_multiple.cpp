@@ -0,0 +1,80 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <vector>
+
+using namespace Halide;
+
+bool error_occurred = false;
+void my_error_handler(void *user_context, const char *msg) {
+    error_occurred = true;
+}
+
+int main(int argc, char **argv) {
+    const int W = 100, H = 20;
+
+    ImageParam input(UInt(8), 2);
+    input.set_host_alignment(32);
+    input.dim(0).set_min(0);
+    input.dim(1).set_stride_multiple(32);
+
+    Var x, y;
+    Func f;
+    f(x, y) = input(x, y) + 1;
+    f.output_buffer().dim(0).set_min(0);
+    f.vectorize(x, 32, TailStrategy::GuardWithIf);
+    f.set_error_handler(&my_error_handler);
+
+    // Rows padded out to a multiple of the promised stride.
+    for (int stride : {128, 160}) {
+        std::vector<uint8_t> storage(stride * H + 32);
+        uint8_t *data = (uint8_t *)(((uintptr_t)storage.data() + 31) & ~(uintptr_t)31);
+        halide_dimension_t shape[] = {{0, W, 1}, {0, H, stride}};
+        Buffer<uint8_t> in(data, 2, shape);
+        in.for_each_element([&](int x, int y) { in(x, y) = (uint8_t)(x * 3 + y); });
+        input.set(in);
+
+        Buffer<uint8_t> out = f.realize(W, H);
+        if (error_occurred) {
+            printf("Unexpected error with stride %d\n", stride);
+            return -1;
+        }
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                uint8_t correct = (uint8_t)(in(x, y) + 1);
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    // A stride that breaks the promise is an error.
+    {
+        std::vector<uint8_t> storage(W * H + 32);
+        uint8_t *data = (uint8_t *)(((uintptr_t)storage.data() + 31) & ~(uintptr_t)31);
+        halide_dimension_t shape[] = {{0, W, 1}, {0, H, W}};
+        Buffer<uint8_t> in(data, 2, shape);
+        input.set(in);
+        f.realize(W, H);
+        if (!error_occurred) {
+            printf("There should have been an error for a stride of %d\n", W);
+            return -1;
+        }
+        error_occurred = false;
+    }
+
+    // Bounds inference proposes a stride rounded up to the multiple.
+    {
+        input.reset();
+        f.infer_input_bounds(W, H);
+        Buffer<uint8_t> in = input.get();
+        if (in.dim(1).stride() < W || in.dim(1).stride() % 32 != 0) {
+            printf("Bounds inference proposed a stride of %d\n", in.dim(1).stride());
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include "Halide.h"
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+
+#include "test/common/halide_test_dirs.h"
+
+using namespace Halide;
+
+// A blur with its input computed at the root. Each call makes new
+// Funcs with the same names.
+Func make_pipeline() {
+    Var x("x"), y("y");
+    Func in("in"), blur("blur");
+    in(x, y) = x + y * 3;
+    blur(x, y) = in(x - 1, y) + in(x, y) + in(x + 1, y);
+    in.compute_root();
+    return blur;
+}
+
+int main(int argc, char **argv) {
+    // Without a GPU API in the target, this tunes CPU tiles.
+    Target target = get_jit_target_from_environment();
+    bool gpu = get_default_device_api_for_target(target) != DeviceAPI::Host;
+
+    const int W = 256, H = 128;
+    Var x("x"), y("y");
+    std::vector<std::pair<int, int>> shapes = {{8, 8}, {16, 4}, {32, 2}};
+
+    std::string schedule_file = Internal::get_test_tmp_dir() + "tune_gpu_tile.schedule";
+    Internal::ensure_no_file_exists(schedule_file);
+
+    std::string schedule = tune_gpu_tile(make_pipeline, "blur", x, y, shapes,
+                                         {W, H}, target, schedule_file, 3);
+    printf("%s", schedule.c_str());
+
+    // Every candidate is reported, and one of them is chosen.
+    for (const auto &shape : shapes) {
+        std::ostringstream line;
+        line << "# " << shape.first << "x" << shape.second << ": ";
+        if (schedule.find(line.str()) == std::string::npos) {
+            printf("The time of blocks of %dx%d is missing\n", shape.first, shape.second);
+            return -1;
+        }
+    }
+    bool chosen = false;
+    for (const auto &shape : shapes) {
+        std::ostringstream line;
+        line << "blur.split(x, x, xi, " << shape.first << ", Auto)\n"
+             << "blur.split(y, y, yi, " << shape.second << ", Auto)\n";
+        chosen |= schedule.find(line.str()) != std::string::npos;
+    }
+    if (!chosen) {
+        printf("No candidate was chosen\n");
+        return -1;
+    }
+    if (schedule.find(gpu ? "blur.gpu_threads(xi)" : "blur.parallel(y)") == std::string::npos) {
+        printf("The schedule doesn't tile blur for the target\n");
+        return -1;
+    }
+
+    // The file holds the same schedule.
+    Internal::assert_file_exists(schedule_file);
+    std::ifstream file(schedule_file);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    if (contents.str() != schedule) {
+        printf("The schedule file holds:\n%s", contents.str().c_str());
+        return -1;
+    }
+
+    // Loading the file schedules a new instance of the pipeline.
+    Func blur = make_pipeline();
+    Pipeline p(blur);
+    apply_schedule_file(p, schedule_file);
+    Buffer<int> out = p.realize(W, H, target);
+    out.copy_to_host();
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            int correct = 3 * (x + y * 3);
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
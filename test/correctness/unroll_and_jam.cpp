@@ -0,0 +1,97 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    // Sizes that leave partial jams in every case.
+    const int N = 37, K = 29;
+
+    Buffer<float> A(K, N), B(N, K);
+    for (int y = 0; y < N; y++) {
+        for (int x = 0; x < K; x++) {
+            A(x, y) = (float)((x * 3 + y * 5) % 7) - 3.0f;
+        }
+    }
+    for (int y = 0; y < K; y++) {
+        for (int x = 0; x < N; x++) {
+            B(x, y) = (float)((x * 11 + y * 2) % 9) - 4.0f;
+        }
+    }
+
+    Var x("x"), y("y");
+
+    {
+        // Jam rows of a matrix multiply into the reduction loop, so
+        // that each row gets its own accumulator.
+        RDom k(0, K);
+        Func prod("prod");
+        prod(x, y) = 0.0f;
+        prod(x, y) += A(k, y) * B(x, k);
+
+        prod.update()
+            .reorder(x, k, y)
+            .vectorize(x, 8, TailStrategy::GuardWithIf)
+            .unroll_and_jam(y, 4, TailStrategy::GuardWithIf);
+
+        Buffer<float> result = prod.realize(N, N);
+        for (int y = 0; y < N; y++) {
+            for (int x = 0; x < N; x++) {
+                float correct = 0.0f;
+                for (int i = 0; i < K; i++) {
+                    correct += A(i, y) * B(x, i);
+                }
+                if (result(x, y) != correct) {
+                    printf("prod(%d, %d) = %f instead of %f\n", x, y, result(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    {
+        // Jam a reduction loop inside a pure loop, which is legal
+        // because each x is independent.
+        RDom r(0, K);
+        Func sums("sums");
+        sums(x) = 0.0f;
+        sums(x) += A(r, x) * (r + 1);
+
+        sums.update()
+            .reorder(x, r)
+            .unroll_and_jam(r, 3);
+
+        Buffer<float> result = sums.realize(N);
+        for (int x = 0; x < N; x++) {
+            float correct = 0.0f;
+            for (int i = 0; i < K; i++) {
+                correct += A(i, x) * (i + 1);
+            }
+            if (result(x) != correct) {
+                printf("sums(%d) = %f instead of %f\n", x, result(x), correct);
+                return -1;
+            }
+        }
+    }
+
+    {
+        // Jam a pure loop of a pure definition.
+        Func f("f");
+        f(x, y) = A(x % K, y) + y;
+        f.unroll_and_jam(y, 2);
+
+        Buffer<float> result = f.realize(N, N);
+        for (int y = 0; y < N; y++) {
+            for (int x = 0; x < N; x++) {
+                float correct = A(x % K, y) + y;
+                if (result(x, y) != correct) {
+                    printf("f(%d, %d) = %f instead of %f\n", x, y, result(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
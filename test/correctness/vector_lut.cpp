@@ -0,0 +1,92 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+template<typename T>
+int check(const Buffer<T> &out, const Buffer<T> &lut, const Buffer<uint8_t> &in, int mask, const char *name) {
+    for (int x = 0; x < out.width(); x++) {
+        T correct = lut(in(x) & mask);
+        if (out(x) != correct) {
+            printf("%s: out(%d) = %f instead of %f\n", name, x, (double)out(x), (double)correct);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const int W = 1024;
+    Target target = get_jit_target_from_environment();
+
+    Buffer<uint8_t> in(W);
+    for (int x = 0; x < W; x++) {
+        in(x) = (uint8_t)((x * 37 + 11) ^ (x >> 3));
+    }
+
+    Var x("x");
+
+    // Lookups in a tiny byte table, which may be done in registers.
+    {
+        Buffer<uint8_t> lut(16);
+        for (int i = 0; i < 16; i++) {
+            lut(i) = (uint8_t)(i * i + 3);
+        }
+        Func f("f");
+        f(x) = lut(clamp(cast<int>(in(x)) & 15, 0, 15));
+        f.vectorize(x, 32);
+        Buffer<uint8_t> out = f.realize(W, target);
+        if (check(out, lut, in, 15, "byte table")) {
+            return -1;
+        }
+    }
+
+    // A tiny byte table computed by another Func.
+    {
+        Buffer<uint8_t> expected(8);
+        for (int i = 0; i < 8; i++) {
+            expected(i) = (uint8_t)(i * 29);
+        }
+        Func table("table"), f("f");
+        table(x) = cast<uint8_t>(x * 29);
+        f(x) = table(cast<int>(in(x)) & 7);
+        table.compute_root().bound(x, 0, 8);
+        f.vectorize(x, 16);
+        Buffer<uint8_t> out = f.realize(W, target);
+        if (check(out, expected, in, 7, "computed byte table")) {
+            return -1;
+        }
+    }
+
+    // Lookups of 32-bit values, which may be hardware gathers.
+    {
+        Buffer<float> lut(256);
+        for (int i = 0; i < 256; i++) {
+            lut(i) = i * 0.25f - 7.0f;
+        }
+        Func f("f");
+        f(x) = lut(in(x));
+        f.vectorize(x, 16);
+        Buffer<float> out = f.realize(W, target);
+        if (check(out, lut, in, 255, "float table")) {
+            return -1;
+        }
+    }
+
+    {
+        Buffer<int> lut(256);
+        for (int i = 0; i < 256; i++) {
+            lut(i) = i * 1001 - 50000;
+        }
+        Func f("f");
+        f(x) = lut(in(x));
+        f.vectorize(x, 8);
+        Buffer<int> out = f.realize(W, target);
+        if (check(out, lut, in, 255, "int table")) {
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include "Halide.h"
+#include <cmath>
+#include <functional>
+#include <stdio.h>
+
+using namespace Halide;
+
+// The error of approx in units in the last place of the correct
+// result, or zero if it is within the absolute tolerance.
+double ulp_error(float approx, double correct, double abs_tolerance) {
+    double err = std::abs((double)approx - correct);
+    if (err <= abs_tolerance) {
+        return 0;
+    }
+    int e;
+    std::frexp(correct, &e);
+    double ulp = std::ldexp(1.0, std::max(e, -125) - 24);
+    return err / ulp;
+}
+
+const int N = 100000;
+
+Var x;
+
+bool check(const char *name, Expr e, std::function<double(int)> reference, double max_ulp,
+           double abs_tolerance = 0) {
+    Func f;
+    f(x) = e;
+    f.vectorize(x, 8);
+    Buffer<float> im = f.realize(N);
+
+    double max_err = 0;
+    int max_err_i = 0;
+    for (int i = 0; i < N; i++) {
+        double err = ulp_error(im(i), reference(i), abs_tolerance);
+        if (err > max_err) {
+            max_err = err;
+            max_err_i = i;
+        }
+    }
+    printf("%s: maximum error %g ULP at %d\n", name, max_err, max_err_i);
+    if (max_err > max_ulp) {
+        printf("Error exceeds %g ULP\n", max_ulp);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    // Arguments spread over [-100, 100], denser near zero, a second
+    // set in a different order for atan2, and ones in range for log
+    // and exp.
+    Buffer<float> a(N), b(N), pos(N), small(N);
+    for (int i = 0; i < N; i++) {
+        float t = (i - N / 2) / (float)(N / 2);
+        a(i) = 100.0f * t * t * t;
+        float s = ((i * 7919) % N - N / 2) / (float)(N / 2);
+        b(i) = 100.0f * s * s * s;
+        pos(i) = std::abs(a(i)) + 1e-3f;
+        small(i) = a(i) * 0.8f;
+    }
+
+    auto of = [](double (*fn)(double), const Buffer<float> &in) {
+        return [=](int i) { return fn(in(i)); };
+    };
+
+    bool ok = true;
+
+    // The vectorized versions of the math library functions.
+    ok = ok && check("sin", sin(a(x)), of(std::sin, a), 3, 2e-7);
+    ok = ok && check("cos", cos(a(x)), of(std::cos, a), 3, 2e-7);
+    ok = ok && check("atan", atan(a(x)), of(std::atan, a), 4);
+    ok = ok && check("atan2", atan2(a(x), b(x)),
+                     [&](int i) { return std::atan2((double)a(i), (double)b(i)); }, 4);
+    ok = ok && check("log", log(pos(x)), of(std::log, pos), 3);
+    ok = ok && check("exp", exp(small(x)), of(std::exp, small), 3);
+
+    // The precision tiers of the fast versions.
+    ok = ok && check("fast_sin", fast_sin(a(x)), of(std::sin, a), 32, 2e-6);
+    ok = ok && check("fast_cos", fast_cos(a(x)), of(std::cos, a), 32, 2e-6);
+    ok = ok && check("fast_sin (2 ULP)", fast_sin(a(x), 2), of(std::sin, a), 3, 2e-7);
+    ok = ok && check("fast_atan", fast_atan(a(x)), of(std::atan, a), 512);
+    ok = ok && check("fast_atan (16 ULP)", fast_atan(a(x), 16), of(std::atan, a), 16);
+    ok = ok && check("fast_atan (4 ULP)", fast_atan(a(x), 4), of(std::atan, a), 4);
+    ok = ok && check("fast_log (2 ULP)", fast_log(pos(x), 2), of(std::log, pos), 3);
+    ok = ok && check("fast_exp (2 ULP)", fast_exp(small(x), 2), of(std::exp, small), 3);
+
+    if (!ok) {
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
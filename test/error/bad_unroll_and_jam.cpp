@@ -0,0 +1,21 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    RDom r(0, 10, 0, 10);
+
+    Func f("f");
+    Var x, y;
+    f(x, y) = x + y;
+    f(r.x, r.y) += f(r.y, r.x);
+
+    // Jamming r.y inside r.x would reorder the reduction domain.
+    f.update().unroll_and_jam(r.y, 2);
+
+    f.realize(10, 10);
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,44 @@
+#include "HalideRuntime.h"
+#include "HalideBuffer.h"
+
+#include <stdio.h>
+
+#include "affinity_par_for.h"
+
+#include "test/common/par_for_test_harness.h"
+
+using namespace Halide::Internal::Test;
+
+int main(int argc, char **argv) {
+    // Slice i of a loop only ever runs on lane i, the calling thread
+    // being lane 0 and worker i - 1 lane i, on every call. The thread
+    // that launched the loop may also take the slices of threads that
+    // haven't arrived. The nested loops are launched from the lanes of
+    // the outer loop.
+    auto check_events = [](const std::vector<ThreadPoolEvent> &events, int threads, int rows) {
+        std::map<int, std::vector<ThreadPoolEvent>> tasks = tasks_by_job(events);
+        for (const ThreadPoolEvent &e : events) {
+            if (!e.is_job) {
+                continue;
+            }
+            for (const ThreadPoolEvent &t : tasks[e.job]) {
+                if (t.lane != t.index && t.lane != e.lane) {
+                    printf("Slice %d of a loop launched from lane %d ran on lane %d\n",
+                           t.index, e.lane, t.lane);
+                    return false;
+                }
+            }
+        }
+        return true;
+    };
+
+    int ret = run_par_for_test(halide_affinity_do_par_for, affinity_par_for,
+                               [](int x, int y) { return x * 3 + y * 7 + 1; },
+                               check_events, true, 2);
+    if (ret) {
+        return ret;
+    }
+
+    printf("Success\n");
+    return 0;
+}
@@ -0,0 +1,25 @@
+#include "Halide.h"
+
+namespace {
+
+class AffinityParFor : public Halide::Generator<AffinityParFor> {
+public:
+    Output<Buffer<int>> output{"output", 2};
+
+    void generate() {
+        // A parallel loop over rows, with a nested parallel loop in
+        // each one.
+        Var x, y, xo, xi;
+
+        Func f;
+        f(x, y) = x * 3 + y * 7;
+        output(x, y) = f(x, y) + 1;
+
+        output.parallel(y);
+        f.compute_at(output, y).split(x, xo, xi, 4).parallel(xo);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(AffinityParFor, affinity_par_for)
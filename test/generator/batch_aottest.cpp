@@ -0,0 +1,58 @@
+#include <stdio.h>
+#include "HalideRuntime.h"
+#include "HalideBuffer.h"
+
+#include "batch.h"
+
+using namespace Halide::Runtime;
+
+const int W = 64, H = 16, N = 10;
+
+int main(int argc, char **argv) {
+    // A batch is an extra outermost dimension on every buffer.
+    Buffer<uint8_t> input(W, H, N);
+    input.for_each_element([&](int x, int y, int n) {
+        input(x, y, n) = (uint8_t)(x + y * 3 + n * 7);
+    });
+    Buffer<int16_t> output(W, H, N);
+
+    int result = batch_batch(input, 5, output);
+    if (result != 0) {
+        printf("batch_batch failed: %d\n", result);
+        return -1;
+    }
+
+    for (int n = 0; n < N; n++) {
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                int16_t correct = input(x, y, n) * 2 + 5;
+                if (output(x, y, n) != correct) {
+                    printf("output(%d, %d, %d) = %d instead of %d\n",
+                           x, y, n, output(x, y, n), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    // Each item must give the same result as calling the pipeline on it alone.
+    Buffer<int16_t> single(W, H);
+    batch(input.sliced(2, 3), 5, single);
+    if (single(7, 4) != output(7, 4, 3)) {
+        printf("single(7, 4) = %d instead of %d\n", single(7, 4), output(7, 4, 3));
+        return -1;
+    }
+
+    // Mismatched batch sizes are an error.
+    Buffer<int16_t> short_output(W, H, N - 1);
+    halide_set_error_handler([](void *, const char *msg) {
+        printf("Expected error: %s\n", msg);
+    });
+    if (batch_batch(input, 5, short_output) == 0) {
+        printf("Expected mismatched batch sizes to fail\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
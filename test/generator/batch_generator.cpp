@@ -0,0 +1,20 @@
+#include "Halide.h"
+
+namespace {
+
+class Batch : public Halide::Generator<Batch> {
+public:
+    Input<Buffer<uint8_t>> input{"input", 2};
+    Input<int> offset{"offset"};
+    Output<Buffer<int16_t>> output{"output", 2};
+
+    void generate() {
+        Var x, y;
+        output(x, y) = cast<int16_t>(input(x, y)) * 2 + offset;
+        output.vectorize(x, natural_vector_size<int16_t>());
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(Batch, batch)
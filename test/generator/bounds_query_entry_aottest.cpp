@@ -0,0 +1,96 @@
+#include "HalideRuntime.h"
+#include "HalideBuffer.h"
+
+#include <stdio.h>
+
+#include "bounds_query_entry.h"
+
+using namespace Halide::Runtime;
+
+int malloc_count = 0;
+
+void *counting_malloc(void *user_context, size_t size) {
+    malloc_count++;
+    return halide_default_malloc(user_context, size);
+}
+
+const int W = 100, H = 80;
+
+int main(int argc, char **argv) {
+    halide_set_custom_malloc(counting_malloc);
+
+    Buffer<uint8_t> out(W, H);
+    out.fill(7);
+
+    // A bounds query through the full entry point.
+    Buffer<uint8_t> query_full(nullptr, 0, 0);
+    int ret = bounds_query_entry(query_full, out);
+    if (ret) {
+        printf("bounds_query_entry failed: %d\n", ret);
+        return -1;
+    }
+
+    // The same bounds query through the bounds query entry point.
+    Buffer<uint8_t> query(nullptr, 0, 0);
+    malloc_count = 0;
+    ret = bounds_query_entry_bounds_query(query, out);
+    if (ret) {
+        printf("bounds_query_entry_bounds_query failed: %d\n", ret);
+        return -1;
+    }
+    if (malloc_count != 0) {
+        printf("The bounds query entry point allocated %d times\n", malloc_count);
+        return -1;
+    }
+
+    if (!query.is_bounds_query()) {
+        printf("The bounds query entry point set the host pointer\n");
+        return -1;
+    }
+    for (int i = 0; i < 2; i++) {
+        if (query.dim(i).min() != query_full.dim(i).min() ||
+            query.dim(i).extent() != query_full.dim(i).extent() ||
+            query.dim(i).stride() != query_full.dim(i).stride()) {
+            printf("Dimension %d of the bounds query is [%d, %d] with stride %d instead of [%d, %d] with stride %d\n",
+                   i, query.dim(i).min(), query.dim(i).extent(), query.dim(i).stride(),
+                   query_full.dim(i).min(), query_full.dim(i).extent(), query_full.dim(i).stride());
+            return -1;
+        }
+    }
+    if (query.dim(0).min() != -1 || query.dim(0).extent() != W + 2 ||
+        query.dim(1).min() != -1 || query.dim(1).extent() != H + 2) {
+        printf("Unexpected input region: [%d, %d] x [%d, %d]\n",
+               query.dim(0).min(), query.dim(0).extent(),
+               query.dim(1).min(), query.dim(1).extent());
+        return -1;
+    }
+
+    // With real buffers, the bounds query entry point does nothing.
+    Buffer<uint8_t> in(W + 2, H + 2);
+    in.set_min(-1, -1);
+    in.fill(100);
+    ret = bounds_query_entry_bounds_query(in, out);
+    if (ret) {
+        printf("bounds_query_entry_bounds_query failed: %d\n", ret);
+        return -1;
+    }
+    if (!out.all_equal(7)) {
+        printf("The bounds query entry point wrote to the output\n");
+        return -1;
+    }
+
+    ret = bounds_query_entry(in, out);
+    if (ret) {
+        printf("bounds_query_entry failed: %d\n", ret);
+        return -1;
+    }
+    if (!out.all_equal(100)) {
+        printf("The pipeline computed the wrong output\n");
+        return -1;
+    }
+
+    halide_set_custom_malloc(halide_default_malloc);
+
+    printf("Success!\n");
+    return 0;
+}
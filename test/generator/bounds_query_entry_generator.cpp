@@ -0,0 +1,26 @@
+#include "Halide.h"
+
+namespace {
+
+class BoundsQueryEntry : public Halide::Generator<BoundsQueryEntry> {
+public:
+    Input<Buffer<uint8_t>> input{"input", 2};
+    Output<Buffer<uint8_t>> output{"output", 2};
+
+    void generate() {
+        Var x, y;
+
+        Func in16, blur_x;
+        in16(x, y) = cast<uint16_t>(input(x, y));
+        blur_x(x, y) = in16(x - 1, y) + 2 * in16(x, y) + in16(x + 1, y);
+        output(x, y) = cast<uint8_t>((blur_x(x, y - 1) + 2 * blur_x(x, y) + blur_x(x, y + 1)) / 16);
+
+        // A heap-allocated intermediate, which the bounds query entry
+        // point should never allocate.
+        blur_x.compute_root();
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(BoundsQueryEntry, bounds_query_entry)
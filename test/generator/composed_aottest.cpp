@@ -0,0 +1,35 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "HalideBuffer.h"
+#include "composed.h"
+
+using namespace Halide::Runtime;
+
+int main(int argc, char **argv) {
+    const int W = 67, H = 43;
+    Buffer<uint16_t> input(W, H);
+    input.for_each_element([&](int x, int y) {
+        input(x, y) = (x * 37 + y * 101) % 1024;
+    });
+
+    // The unconnected Inputs of both Generators are arguments of the
+    // composed pipeline.
+    Buffer<uint16_t> output(W, H);
+    composed(input, input, output);
+
+    output.for_each_element([&](int x, int y) {
+        int l = input(x > 0 ? x - 1 : 0, y);
+        int r = input(x < W - 1 ? x + 1 : W - 1, y);
+        int blurred = (l + 2 * input(x, y) + r) / 4;
+        int sharpened = 2 * input(x, y) - blurred;
+        int correct = sharpened < 0 ? 0 : (sharpened > 65535 ? 65535 : sharpened);
+        if (output(x, y) != correct) {
+            printf("output(%d, %d) = %d instead of %d\n", x, y, output(x, y), correct);
+            exit(-1);
+        }
+    });
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,49 @@
+#include "Halide.h"
+
+using namespace Halide;
+
+namespace {
+
+// Two stages of a pipeline written as separate Generators, which
+// GenGen composes into one pipeline with -g composed_blur,composed_sharpen.
+class ComposedBlur : public Generator<ComposedBlur> {
+public:
+    Input<Buffer<uint16_t>> input{ "input", 2 };
+    Output<Buffer<uint16_t>> blurred{ "blurred", 2 };
+
+    void generate() {
+        Func clamped = BoundaryConditions::repeat_edge(input);
+        blurred(x, y) = (clamped(x - 1, y) + 2 * clamped(x, y) + clamped(x + 1, y)) / 4;
+    }
+
+    void schedule() {
+        blurred.vectorize(x, natural_vector_size<uint16_t>());
+    }
+
+private:
+    Var x{"x"}, y{"y"};
+};
+
+class ComposedSharpen : public Generator<ComposedSharpen> {
+public:
+    Input<Func> input{ "blurred_input", UInt(16), 2 };
+    Input<Buffer<uint16_t>> original{ "original", 2 };
+    Output<Buffer<uint16_t>> output{ "output", 2 };
+
+    void generate() {
+        Expr detail = cast<int32_t>(original(x, y)) - input(x, y);
+        output(x, y) = cast<uint16_t>(clamp(original(x, y) + detail, 0, 65535));
+    }
+
+    void schedule() {
+        output.vectorize(x, natural_vector_size<uint16_t>());
+    }
+
+private:
+    Var x{"x"}, y{"y"};
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(ComposedBlur, composed_blur)
+HALIDE_REGISTER_GENERATOR(ComposedSharpen, composed_sharpen)
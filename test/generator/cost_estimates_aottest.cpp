@@ -0,0 +1,43 @@
+#include "HalideRuntime.h"
+
+#include <stdio.h>
+
+#include "cost_estimates.h"
+
+int main(int argc, char **argv) {
+    const halide_filter_metadata_t *md = cost_estimates_metadata();
+
+    if (md->version != 1) {
+        printf("Unexpected metadata version %d\n", md->version);
+        return -1;
+    }
+
+    // blur_x is needed over 1000 x 1002 pixels of uint16_t, and is
+    // counted as if it were stored over all of them.
+    if (md->estimated_peak_intermediate_bytes != 1000 * 1002 * 2) {
+        printf("Unexpected peak intermediate bytes %lld\n",
+               (long long)md->estimated_peak_intermediate_bytes);
+        return -1;
+    }
+
+    if (md->estimated_arithmetic_ops <= 0 || md->estimated_bytes_loaded <= 0) {
+        printf("Unexpected costs: arithmetic %lld, bytes loaded %lld\n",
+               (long long)md->estimated_arithmetic_ops,
+               (long long)md->estimated_bytes_loaded);
+        return -1;
+    }
+
+    // 1000 rows in parallel strips of 100.
+    if (md->estimated_parallelism != 10) {
+        printf("Unexpected parallelism %lld\n", (long long)md->estimated_parallelism);
+        return -1;
+    }
+
+    if (md->uses_gpu) {
+        printf("Unexpectedly uses a GPU\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,28 @@
+#include "Halide.h"
+
+namespace {
+
+class CostEstimates : public Halide::Generator<CostEstimates> {
+public:
+    Input<Buffer<uint8_t>> input{"input", 2};
+    Output<Buffer<uint16_t>> output{"output", 2};
+
+    void generate() {
+        Var x, y, yo, yi;
+
+        Func blur_x;
+        blur_x(x, y) = cast<uint16_t>(input(x - 1, y)) + input(x, y) + input(x + 1, y);
+        output(x, y) = blur_x(x, y - 1) + blur_x(x, y) + blur_x(x, y + 1);
+
+        input.dim(0).set_bounds_estimate(0, 1000);
+        input.dim(1).set_bounds_estimate(0, 1000);
+        output.estimate(x, 0, 1000).estimate(y, 0, 1000);
+
+        output.split(y, yo, yi, 100).parallel(yo);
+        blur_x.compute_at(output, yo);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(CostEstimates, cost_estimates)
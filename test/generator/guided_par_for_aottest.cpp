@@ -0,0 +1,69 @@
+#include "HalideRuntime.h"
+#include "HalideBuffer.h"
+
+#include <stdio.h>
+
+#include "guided_par_for.h"
+
+#include "test/common/par_for_test_harness.h"
+
+using namespace Halide::Internal::Test;
+
+int main(int argc, char **argv) {
+    // Threads claim chunks of the loop in order. Each chunk is a share
+    // of the iterations left, so they shrink down the loop, and the
+    // last ones are single iterations.
+    auto check_events = [](const std::vector<ThreadPoolEvent> &events, int threads, int rows) {
+        std::map<int, std::vector<ThreadPoolEvent>> tasks = tasks_by_job(events);
+        for (const ThreadPoolEvent &e : events) {
+            if (!e.is_job) {
+                continue;
+            }
+            const std::vector<ThreadPoolEvent> &chunks = tasks[e.job];
+            int next = 0;
+            for (size_t i = 0; i < chunks.size(); i++) {
+                if (chunks[i].index != next) {
+                    printf("A chunk starts at %d instead of %d\n", chunks[i].index, next);
+                    return false;
+                }
+                if (i > 0 && chunks[i].size > chunks[i - 1].size) {
+                    printf("A chunk of %d iterations follows one of %d\n",
+                           chunks[i].size, chunks[i - 1].size);
+                    return false;
+                }
+                next += chunks[i].size;
+            }
+            if (next != e.size) {
+                printf("The chunks cover %d of %d iterations\n", next, e.size);
+                return false;
+            }
+            if (chunks.back().size != 1) {
+                printf("The last chunk has %d iterations\n", chunks.back().size);
+                return false;
+            }
+            // With at most 16 threads, loops this long start with
+            // chunks of several iterations.
+            if (e.size >= 64 && chunks.front().size == 1) {
+                printf("The first chunk of a loop of %d iterations is a single one\n", e.size);
+                return false;
+            }
+        }
+        return true;
+    };
+
+    int ret = run_par_for_test(halide_guided_do_par_for, guided_par_for,
+                               [](int x, int y) {
+                                   int correct = y * 7;
+                                   for (int r = 0; r < 64 && r < y; r++) {
+                                       correct += (x + r) % 3;
+                                   }
+                                   return correct;
+                               },
+                               check_events, true, 1);
+    if (ret) {
+        return ret;
+    }
+
+    printf("Success\n");
+    return 0;
+}
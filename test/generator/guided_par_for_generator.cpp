@@ -0,0 +1,27 @@
+#include "Halide.h"
+
+namespace {
+
+class GuidedParFor : public Halide::Generator<GuidedParFor> {
+public:
+    Output<Buffer<int>> output{"output", 2};
+
+    void generate() {
+        // A parallel loop over rows whose cost grows down the image.
+        Var x, y;
+        RDom r(0, 64);
+        r.where(r < y);
+
+        Func work;
+        work(x, y) = 0;
+        work(x, y) += (x + r) % 3;
+
+        output(x, y) = work(x, y) + y * 7;
+        work.compute_at(output, y);
+        output.parallel(y).vectorize(x, 8);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(GuidedParFor, guided_par_for)
@@ -56,8 +56,9 @@ public:
     double get_scalar() const { return data[0]; }
     size_t get_element_size() const { return sizeof(T); }
 
-    T &operator () (int i, int j) { return data[i * dims[0] + j]; }
-    T operator () (int i, int j) const { return data[i * dims[0] + j]; }
+    // Matlab arrays are column major.
+    T &operator () (int i, int j) { return data[i + j * dims[0]]; }
+    T operator () (int i, int j) const { return data[i + j * dims[0]]; }
 };
 
 extern "C" {
@@ -68,6 +69,12 @@ DLLEXPORT int mexWarnMsgTxt(const char *msg) {
     return 0;
 }
 
+void (*exit_fn)() = nullptr;
+DLLEXPORT int mexAtExit(void (*fn)()) {
+    exit_fn = fn;
+    return 0;
+}
+
 DLLEXPORT size_t mxGetNumberOfDimensions_730(const mxArray *a) {
     return a->get_number_of_dimensions();
 }
@@ -162,13 +169,22 @@ int main(int argc, char **argv) {
         for (int j = 0; j < 5; j++) {
             float in = input(i, j);
             float expected = in * scale(0, 0) * (negate(0, 0) ? -1.0f : 1.0f);
-            if (output(i, j) == expected) {
+            if (output(i, j) != expected) {
                 printf("output(%d, %d) = %f instead of %f\n",
                        i, j, output(i, j), expected);
+                return -1;
             }
         }
     }
 
+    // The runtime should have registered a function to stop the
+    // thread pool before Matlab unloads the mex library.
+    if (!exit_fn) {
+        printf("mexAtExit was not called\n");
+        return -1;
+    }
+    exit_fn();
+
     printf("Success!\n");
     return 0;
 }
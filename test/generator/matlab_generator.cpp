@@ -15,6 +15,9 @@ public:
     void generate() {
         Var x, y;
         output(x, y) = input(x, y) * scale * select(negate, -1.0f, 1.0f);
+
+        // Use the thread pool from within the mexFunction.
+        output.parallel(y);
     }
 };
 
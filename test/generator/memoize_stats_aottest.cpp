@@ -0,0 +1,69 @@
+#include "HalideRuntime.h"
+#include "HalideBuffer.h"
+
+#include <stdio.h>
+
+#include "memoize_stats.h"
+
+using namespace Halide::Runtime;
+
+int check_stats(const char *when, uint64_t hits, uint64_t misses, int32_t entries) {
+    halide_memoization_cache_stats_t stats;
+    halide_memoization_cache_get_stats(&stats);
+    if (stats.hits != hits || stats.misses != misses || stats.entries != entries) {
+        printf("%s: got %d hits, %d misses, %d entries instead of %d, %d, %d\n", when,
+               (int)stats.hits, (int)stats.misses, (int)stats.entries,
+               (int)hits, (int)misses, (int)entries);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    Buffer<float> out(16, 16);
+
+    halide_memoization_cache_reset_stats();
+
+    if (memoize_stats(1.0f, out) ||
+        check_stats("First call", 0, 1, 1)) {
+        return -1;
+    }
+
+    if (memoize_stats(1.0f, out) ||
+        check_stats("Repeated call", 1, 1, 1)) {
+        return -1;
+    }
+
+    if (memoize_stats(2.0f, out) ||
+        check_stats("New value", 1, 2, 2)) {
+        return -1;
+    }
+
+    // Shrink the cache so that each new result evicts the old ones.
+    halide_memoization_cache_set_size(1);
+    if (memoize_stats(3.0f, out)) {
+        return -1;
+    }
+    halide_memoization_cache_stats_t stats;
+    halide_memoization_cache_get_stats(&stats);
+    if (stats.evictions != 2 || stats.entries != 1) {
+        printf("Expected 2 evictions and 1 entry, got %d and %d\n",
+               (int)stats.evictions, (int)stats.entries);
+        return -1;
+    }
+
+    // Switching policy keeps everything that is already cached.
+    halide_memoization_cache_set_eviction_policy(halide_memoization_evict_lfu_size);
+    halide_memoization_cache_set_size(0);
+    if (memoize_stats(3.0f, out) ||
+        check_stats("After policy change", 1, 3, 1)) {
+        return -1;
+    }
+
+    halide_memoization_cache_set_eviction_policy(halide_memoization_evict_lru);
+    halide_memoization_cache_set_size(0);
+    halide_memoization_cache_cleanup();
+
+    printf("Success\n");
+    return 0;
+}
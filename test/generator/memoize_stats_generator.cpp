@@ -0,0 +1,23 @@
+#include "Halide.h"
+
+namespace {
+
+class MemoizeStats : public Halide::Generator<MemoizeStats> {
+public:
+    Input<float> value{"value"};
+    Output<Buffer<float>> output{"output", 2};
+
+    void generate() {
+        Var x, y;
+
+        Func expensive;
+        expensive(x, y) = sqrt(x * value + y);
+        expensive.compute_root().memoize();
+
+        output(x, y) = expensive(x, y) * 2.0f;
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(MemoizeStats, memoize_stats)
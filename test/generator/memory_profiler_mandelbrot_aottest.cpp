@@ -1,6 +1,7 @@
 #include <map>
 #include <cstring>
 #include <string>
+#include <vector>
 #include <assert.h>
 #include <math.h>
 #include <stdio.h>
@@ -90,6 +91,15 @@ int main(int argc, char **argv) {
 
     validate(state);
 
+    // Check the machine-readable report.
+    int length = halide_profiler_report_json(nullptr, nullptr, 0);
+    std::vector<char> json(length + 1);
+    int written = halide_profiler_report_json(nullptr, json.data(), json.size());
+    assert(written == length);
+    assert((int)strlen(json.data()) == length);
+    assert(strstr(json.data(), "\"name\":\"memory_profiler_mandelbrot\""));
+    assert(strstr(json.data(), "\"latency_ns\":{\"count\":"));
+
     printf("Success!\n");
     return 0;
 }
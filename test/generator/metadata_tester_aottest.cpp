@@ -1012,6 +1012,14 @@ void check_metadata(const halide_filter_metadata_t &md, bool expect_ucon_at_0) {
         match_argument(expected[i], md.arguments[i]);
     }
 
+    // The Generator gives no estimates, so nothing can be estimated.
+    EXPECT_EQ(1, md.version);
+    EXPECT_EQ(-1, md.estimated_peak_intermediate_bytes);
+    EXPECT_EQ(-1, md.estimated_arithmetic_ops);
+    EXPECT_EQ(-1, md.estimated_bytes_loaded);
+    EXPECT_EQ(-1, md.estimated_parallelism);
+    EXPECT_EQ(0, md.uses_gpu);
+
     for (int i = 0; i < kExpectedArgumentCount; ++i) {
         delete kExpectedArguments[i].def;
         delete kExpectedArguments[i].min;
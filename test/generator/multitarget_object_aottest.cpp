@@ -0,0 +1,73 @@
+#include <atomic>
+#include <stdio.h>
+#include "HalideRuntime.h"
+#include "multitarget_object.h"
+#include "HalideBuffer.h"
+
+using namespace Halide::Runtime;
+
+// The multitarget generator, compiled for a debug and a non-debug
+// target into a single object file that also contains the runtime,
+// rather than a static library of one object per target.
+
+void my_error_handler(void *user_context, const char *message) {
+    // Don't use the word "error": if CMake sees it in the output
+    // from an add_custom_command() on Windows, it can decide that
+    // the command failed, regardless of error code.
+    printf("Saw: (%s)\n", message);
+}
+
+static std::atomic<int> can_use_count;
+
+// Reject the debug variant, so the baseline (the last target) is used.
+int my_can_use_target_features(uint64_t features) {
+    can_use_count += 1;
+    if (features & (1ULL << halide_target_feature_debug)) {
+        return 0;
+    }
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    const int W = 32, H = 32;
+    Buffer<uint32_t> output(W, H);
+
+    halide_set_error_handler(my_error_handler);
+    halide_set_custom_can_use_target_features(my_can_use_target_features);
+
+    for (int i = 0; i < 10; ++i) {
+        if (HalideTest::multitarget_object(output) != 0) {
+            printf("Error at multitarget_object\n");
+            return -1;
+        }
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                const uint32_t expected = 0xf00dcafe;
+                const uint32_t actual = output(x, y);
+                if (actual != expected) {
+                    printf("Error at %d, %d: expected %x, got %x\n", x, y, expected, actual);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    // The variant chosen is cached across calls.
+    if (can_use_count != 1) {
+        printf("Error: halide_can_use_target_features was called %d times!\n", (int) can_use_count);
+        return -1;
+    }
+
+    {
+        // The wrapper propagates errors from the variant it calls.
+        Buffer<uint8_t> bad_type(W, H);
+        int result = HalideTest::multitarget_object(bad_type);
+        if (result != halide_error_code_bad_type) {
+            printf("Error: expected to fail with halide_error_code_bad_type (%d) but actually got %d!\n", (int) halide_error_code_bad_type, result);
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "HalideBuffer.h"
+#include "halide_pipeline_graph.h"
+#include "pipeline_graph.h"
+
+using namespace Halide::Runtime;
+using namespace Halide::Tools;
+
+int main(int argc, char **argv) {
+    const int W = 64, H = 32, frames = 5;
+
+    // Each pipeline computes input_a(x + 1, y) * gain + input_b(x, y).
+    // Per frame, a and b run concurrently on the frame's input, then c
+    // combines their outputs.
+    PipelineGraph graph;
+    int a = graph.add(pipeline_graph_argv, pipeline_graph_metadata);
+    int b = graph.add(pipeline_graph_argv, pipeline_graph_metadata);
+    int c = graph.add(pipeline_graph_argv, pipeline_graph_metadata);
+    graph.connect(a, "output", c, "input_a");
+    graph.connect(b, "output", c, "input_b");
+
+    // The inputs must cover what the first two pipelines read, which
+    // is two pixels to the right of the output.
+    std::vector<Buffer<int32_t>> inputs, outputs;
+    for (int f = 0; f < frames; f++) {
+        inputs.emplace_back(W + 2, H);
+        inputs.back().for_each_element([&](int x, int y) {
+            inputs.back()(x, y) = x + y * 7 + f * 100;
+        });
+        outputs.emplace_back(W, H);
+    }
+    int gains[] = {2, 3, 5};
+
+    auto bind = [&](int frame, int node, const halide_filter_argument_t &arg) -> void * {
+        std::string name = arg.name;
+        if (name == "gain") {
+            return &gains[node];
+        } else if (name == "output") {
+            return outputs[frame].raw_buffer();
+        } else {
+            return inputs[frame].raw_buffer();
+        }
+    };
+
+    int error = graph.run(frames, bind);
+    if (error) {
+        printf("The graph failed with error %d\n", error);
+        return -1;
+    }
+
+    for (int f = 0; f < frames; f++) {
+        Buffer<int32_t> &in = inputs[f];
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                int av = in(x + 2, y) * 2 + in(x + 1, y);
+                int bv = in(x + 1, y) * 3 + in(x, y);
+                int correct = av * 5 + bv;
+                if (outputs[f](x, y) != correct) {
+                    printf("outputs[%d](%d, %d) = %d instead of %d\n", f, x, y, outputs[f](x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,29 @@
+#include "Halide.h"
+
+namespace {
+
+// A stage of a graph of pipelines in pipeline_graph_aottest, which
+// reads input_a one pixel to the right so that the graph must size the
+// buffers it passes between pipelines by bounds queries.
+class PipelineGraph : public Halide::Generator<PipelineGraph> {
+public:
+    Input<Buffer<int32_t>> input_a{ "input_a", 2 };
+    Input<Buffer<int32_t>> input_b{ "input_b", 2 };
+    Input<int32_t> gain{ "gain", 1 };
+    Output<Buffer<int32_t>> output{ "output", 2 };
+
+    void generate() {
+        output(x, y) = input_a(x + 1, y) * gain + input_b(x, y);
+    }
+
+    void schedule() {
+        output.vectorize(x, natural_vector_size<int32_t>()).parallel(y);
+    }
+
+private:
+    Var x{"x"}, y{"y"};
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(PipelineGraph, pipeline_graph)
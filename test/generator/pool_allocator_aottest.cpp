@@ -0,0 +1,46 @@
+#include "HalideRuntime.h"
+#include "HalideBuffer.h"
+
+#include <stdio.h>
+
+#include "pool_allocator.h"
+
+using namespace Halide::Runtime;
+
+int main(int argc, char **argv) {
+    halide_set_custom_malloc(halide_pool_malloc);
+    halide_set_custom_free(halide_pool_free);
+
+    for (int i = 0; i < 200; i++) {
+        // Cycle through a few sizes so that blocks get recycled both
+        // within and across size classes.
+        int size = 8 + (i % 5) * 37;
+        Buffer<int> out(size, size);
+        int ret = pool_allocator(out);
+        if (ret) {
+            printf("Non zero exit code: %d\n", ret);
+            return -1;
+        }
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                int correct = 4 * (x + y) + 2;
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+        if (i == 100) {
+            // Dropping the cached blocks mid-stream must be safe.
+            halide_pool_allocator_release(NULL);
+            halide_pool_allocator_set_limit(NULL, 64 * 1024);
+        }
+    }
+
+    halide_pool_allocator_release(NULL);
+    halide_set_custom_malloc(halide_default_malloc);
+    halide_set_custom_free(halide_default_free);
+
+    printf("Success\n");
+    return 0;
+}
@@ -0,0 +1,26 @@
+#include "Halide.h"
+
+namespace {
+
+class PoolAllocator : public Halide::Generator<PoolAllocator> {
+public:
+    Output<Buffer<int>> output{"output", 2};
+
+    void generate() {
+        Var x, y;
+
+        // Heap-allocated intermediates whose size depends on the
+        // output size.
+        Func f, g;
+        f(x, y) = x + y;
+        g(x, y) = f(x, y) + f(x + 1, y);
+        output(x, y) = g(x, y) + g(x, y + 1);
+
+        f.compute_root();
+        g.compute_root();
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(PoolAllocator, pool_allocator)
@@ -0,0 +1,55 @@
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <string>
+
+#include "HalideRuntime.h"
+#include "HalideBuffer.h"
+#include "runtime_cache.h"
+
+using namespace Halide::Runtime;
+
+// runtime_cache is built by running its generator twice with the same
+// HL_RUNTIME_CACHE_DIR and target. The first run links the runtime and
+// stores it; the second, which produced the library linked here, loads
+// it from the cache. This test links no other runtime, so it checks the
+// cached runtime works, and the build log that the second run hit.
+
+int main(int argc, char **argv) {
+    std::ifstream log(RUNTIME_CACHE_LOG);
+    std::stringstream contents;
+    contents << log.rdbuf();
+    if (contents.str().find("Runtime cache hit") == std::string::npos) {
+        printf("The second generator run didn't load the runtime from %s\n", RUNTIME_CACHE_LOG);
+        return -1;
+    }
+
+    const int W = 67, H = 45;
+    Buffer<int32_t> input(W, H), output(W, H);
+    input.for_each_element([&](int x, int y) {
+        input(x, y) = x * 13 - y * 7;
+    });
+
+    for (int threads = 1; threads <= 4; threads++) {
+        halide_set_num_threads(threads);
+        output.fill(0);
+        if (runtime_cache(input, output) != 0) {
+            printf("Error at runtime_cache\n");
+            return -1;
+        }
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                int correct = input(x, y) * 3 + x - y;
+                if (output(x, y) != correct) {
+                    printf("output(%d, %d) = %d instead of %d\n", x, y, output(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    halide_shutdown_thread_pool();
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,20 @@
+#include "Halide.h"
+
+namespace {
+
+class RuntimeCache : public Halide::Generator<RuntimeCache> {
+public:
+    Input<Buffer<int32_t>> input{"input", 2};
+    Output<Buffer<int32_t>> output{"output", 2};
+
+    void generate() {
+        Var x, y;
+        output(x, y) = input(x, y) * 3 + x - y;
+        // Uses the thread pool and the allocator of the runtime.
+        output.vectorize(x, natural_vector_size<int32_t>()).parallel(y);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(RuntimeCache, runtime_cache)
@@ -0,0 +1,123 @@
+#include "HalideRuntime.h"
+#include "HalideBuffer.h"
+
+#include <stdio.h>
+#include <vector>
+
+#include "trace_ring_buffer.h"
+
+using namespace Halide::Runtime;
+
+namespace {
+
+struct TraceSummary {
+    int packets = 0;
+    int stores = 0;
+    bool saw_end_pipeline = false;
+    bool ids_increasing = true;
+};
+
+// Dump the ring to a temporary file and walk the packets in it.
+bool dump_and_parse(TraceSummary *summary) {
+    FILE *f = tmpfile();
+    if (!f) {
+        printf("Could not create a temporary file\n");
+        return false;
+    }
+    int bytes = halide_dump_trace_ring_buffer(nullptr, fileno(f));
+    if (bytes < 0) {
+        printf("Dumping the trace ring buffer failed\n");
+        return false;
+    }
+    std::vector<uint8_t> data(bytes);
+    rewind(f);
+    if (bytes && fread(data.data(), 1, bytes, f) != (size_t)bytes) {
+        printf("Could not read back the trace\n");
+        return false;
+    }
+    fclose(f);
+
+    int last_id = 0;
+    size_t offset = 0;
+    while (offset < data.size()) {
+        const halide_trace_packet_t *p = (const halide_trace_packet_t *)(data.data() + offset);
+        if (p->size < sizeof(halide_trace_packet_t) || p->size % 4 || offset + p->size > data.size()) {
+            printf("Malformed packet at offset %d\n", (int)offset);
+            return false;
+        }
+        summary->packets++;
+        if (p->event == halide_trace_store) {
+            summary->stores++;
+        }
+        if (p->event == halide_trace_end_pipeline) {
+            summary->saw_end_pipeline = true;
+        }
+        summary->ids_increasing &= p->id > last_id;
+        last_id = p->id;
+        offset += p->size;
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    // Far too small to hold the whole trace.
+    const size_t ring_bytes = 4096;
+    if (halide_set_trace_ring_buffer(nullptr, ring_bytes) != 0) {
+        printf("Could not allocate the trace ring buffer\n");
+        return -1;
+    }
+
+    Buffer<int> out(64, 64);
+    if (trace_ring_buffer(out) != 0) {
+        printf("Pipeline failed\n");
+        return -1;
+    }
+
+    // The ring should hold only the most recent packets, ending in
+    // the end of the pipeline.
+    TraceSummary full;
+    if (!dump_and_parse(&full)) return -1;
+    if (full.packets == 0 || full.stores == 0 || !full.saw_end_pipeline || !full.ids_increasing) {
+        printf("Unexpected ring contents: %d packets, %d stores\n", full.packets, full.stores);
+        return -1;
+    }
+
+    // The dump empties the ring.
+    TraceSummary empty;
+    if (!dump_and_parse(&empty)) return -1;
+    if (empty.packets != 0) {
+        printf("Ring was not emptied by the dump\n");
+        return -1;
+    }
+
+    // With loads and stores sampled out entirely, only the structure
+    // of the pipeline is left, which fits in the ring.
+    halide_set_trace_sampling(0);
+    if (trace_ring_buffer(out) != 0) {
+        printf("Pipeline failed\n");
+        return -1;
+    }
+    TraceSummary realizations;
+    if (!dump_and_parse(&realizations)) return -1;
+    if (realizations.stores != 0 || !realizations.saw_end_pipeline) {
+        printf("Sampling didn't remove the stores: %d stores\n", realizations.stores);
+        return -1;
+    }
+    halide_set_trace_sampling(1);
+
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            if (out(x, y) != 2 * (x + y)) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), 2 * (x + y));
+                return -1;
+            }
+        }
+    }
+
+    halide_set_trace_ring_buffer(nullptr, 0);
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,23 @@
+#include "Halide.h"
+
+namespace {
+
+class TraceRingBuffer : public Halide::Generator<TraceRingBuffer> {
+public:
+    Output<Buffer<int>> output{"output", 2};
+
+    void generate() {
+        Var x, y;
+
+        Func f;
+        f(x, y) = x + y;
+        output(x, y) = f(x, y) * 2;
+
+        f.compute_root().trace_stores().trace_realizations();
+        output.trace_stores().trace_realizations();
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(TraceRingBuffer, trace_ring_buffer)
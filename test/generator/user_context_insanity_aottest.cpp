@@ -43,6 +43,25 @@ int main(int argc, char **argv) {
     for (int i = 0; i < num_launcher_tasks; ++i)
         assert(got_context[i] == true);
 
+    // Again, with some of the instances running on thread pools of
+    // their own.
+    halide_thread_pool *pools[2] = {halide_thread_pool_create(2, 0, 0),
+                                    halide_thread_pool_create(3, 0, 0)};
+    for (int i = 0; i < 16; i++) {
+        int ret = halide_thread_pool_bind(&got_context[i], pools[i % 2]);
+        assert(ret == 0);
+    }
+    for (int i = 0; i < num_launcher_tasks; ++i)
+        got_context[i] = false;
+
+    halide_do_par_for(nullptr, launcher_task, 0, num_launcher_tasks, nullptr);
+
+    for (int i = 0; i < num_launcher_tasks; ++i)
+        assert(got_context[i] == true);
+
+    halide_thread_pool_destroy(pools[0]);
+    halide_thread_pool_destroy(pools[1]);
+
     printf("Success!\n");
     return 0;
 }
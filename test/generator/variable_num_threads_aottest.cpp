@@ -16,6 +16,11 @@ using namespace Halide::Runtime;
 void mess_with_num_threads(void *) {
     while (!stop) {
         halide_set_num_threads((rand() % max_threads) + 1);
+        // Also toggle between sleeping and spinning idle workers.
+        halide_thread_pool_set_idle_policy((rand() % 2) * 50);
+        // And the thread budget of the pipeline, which runs with a
+        // NULL user_context.
+        halide_thread_pool_set_limits(NULL, rand() % 3, 0);
     }
 }
 
@@ -45,6 +50,22 @@ int main(int argc, char **argv) {
 
     stop = true;
     halide_join_thread(t);
+    halide_thread_pool_set_limits(NULL, 0, 0);
+
+    // Restricting the pool to the big cores (all of them, on machines
+    // whose cores are alike) restarts its workers on those cores.
+    if (halide_thread_pool_set_core_class(NULL, halide_core_class_big) != 0) {
+        printf("Failed to restrict the thread pool to the big cores\n");
+        return -1;
+    }
+    for (int i = 0; i < 10; i++) {
+        int ret = variable_num_threads(out);
+        if (ret) {
+            printf("Non zero exit code on the big cores: %d\n", ret);
+            return -1;
+        }
+    }
+    halide_thread_pool_set_core_class(NULL, halide_core_class_all);
 
     printf("Success\n");
     return 0;
@@ -0,0 +1,53 @@
+#include "HalideRuntime.h"
+#include "HalideBuffer.h"
+
+#include <stdio.h>
+
+#include "work_stealing.h"
+
+#include "test/common/par_for_test_harness.h"
+
+using namespace Halide::Internal::Test;
+
+int main(int argc, char **argv) {
+    // The loop is divided into one slice per thread, but never more
+    // slices than rows, so with more threads than rows some threads
+    // get no slice at all. Each slice is one task of the thread pool,
+    // and a loop with a single slice runs on the calling thread.
+    auto check_events = [](const std::vector<ThreadPoolEvent> &events, int threads, int rows) {
+        int slices = std::min(threads, rows);
+        int jobs = 0;
+        for (const ThreadPoolEvent &e : events) {
+            if (e.is_job) {
+                jobs++;
+                if (e.size != slices) {
+                    printf("The loop was divided into %d slices instead of %d\n", e.size, slices);
+                    return false;
+                }
+            }
+        }
+        if (jobs != (slices > 1 ? 1 : 0)) {
+            printf("%d loops were run on the thread pool\n", jobs);
+            return false;
+        }
+        for (const auto &job : tasks_by_job(events)) {
+            for (int i = 0; i < (int)job.second.size(); i++) {
+                if (job.second[i].index != i || job.second.size() != (size_t)slices) {
+                    printf("The slices weren't each run once\n");
+                    return false;
+                }
+            }
+        }
+        return true;
+    };
+
+    int ret = run_par_for_test(halide_work_stealing_do_par_for, work_stealing,
+                               [](int x, int y) { return x * 3 + y * 7; },
+                               check_events, false, 1);
+    if (ret) {
+        return ret;
+    }
+
+    printf("Success\n");
+    return 0;
+}
@@ -0,0 +1,20 @@
+#include "Halide.h"
+
+namespace {
+
+class WorkStealing : public Halide::Generator<WorkStealing> {
+public:
+    Output<Buffer<int>> output{"output", 2};
+
+    void generate() {
+        // A parallel loop over many tiny tasks.
+        Var x, y;
+
+        output(x, y) = x * 3 + y * 7;
+        output.parallel(y).vectorize(x, 8);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(WorkStealing, work_stealing)
@@ -91,6 +91,7 @@ int main(int argc, char **argv) {
         {"repeat_image", repeat_image(input), 0.0},
         {"mirror_image", mirror_image(input), 0.0},
         {"mirror_interior", mirror_interior(input), 0.0},
+        {"stage_padded", stage_padded(input, repeat_edge(input), 10), 0.0},
         {nullptr, Func(), 0.0}}; // Sentinel
 
     // Time each
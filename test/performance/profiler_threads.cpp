@@ -0,0 +1,69 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace Halide;
+
+int idle_percentage = -1;
+float heavy_thread_ms = 0, light_thread_ms = 0;
+void my_print(void *, const char *msg) {
+    float this_ms, idle_ms;
+    int this_percentage;
+    if (sscanf(msg, " thread time/run: %f ms  idle/run: %f ms (%d%%)",
+               &this_ms, &idle_ms, &this_percentage) == 3) {
+        idle_percentage = this_percentage;
+    }
+    const char *p = strstr(msg, "thread time: ");
+    if (p && sscanf(p, "thread time: %fms", &this_ms) == 1) {
+        if (strstr(msg, " heavy: ")) {
+            heavy_thread_ms = this_ms;
+        } else if (strstr(msg, " light: ")) {
+            light_thread_ms = this_ms;
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    // Make sure there are several threads to be idle.
+#ifdef _WIN32
+    _putenv_s("HL_NUM_THREADS", "4");
+#else
+    setenv("HL_NUM_THREADS", "4", 1);
+#endif
+
+    // A parallel loop in which one task has far more work than the
+    // others, so most threads sit idle while it finishes.
+    Var x, y;
+    Func heavy("heavy"), light("light"), out("out");
+    heavy(x, y) = cast<float>(x + y);
+    RDom r(0, 400);
+    r.where(y == 0);
+    heavy(x, y) = sin(heavy(x, y) + r);
+    light(x, y) = cast<float>(x * y);
+    out(x, y) = heavy(x, y) + light(x, y);
+
+    out.parallel(y);
+    heavy.compute_at(out, y);
+    light.compute_at(out, y);
+
+    out.set_custom_print(&my_print);
+    Target t = get_jit_target_from_environment().with_feature(Target::Profile);
+    out.realize(20000, 8, t);
+
+    printf("Idle thread time: %d%%, thread time in heavy: %fms, in light: %fms\n",
+           idle_percentage, heavy_thread_ms, light_thread_ms);
+
+    if (idle_percentage < 0) {
+        printf("The profiler didn't report any idle thread time\n");
+        return -1;
+    }
+
+    if (heavy_thread_ms <= light_thread_ms) {
+        printf("The heavy func should have used more thread time than the light one\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -129,6 +129,25 @@ int main(int argc, char **argv) {
         std::cout << "One argument Pipeline realize reusing Realization/Target/ParamMap time " << t * 1e6 << "us.\n";
     }
 
+    {
+        Func f;
+        Param<int> in;
+
+        f() = in + 42;
+
+        Pipeline p(f);
+        Callable c = p.bind();
+
+        auto buf = Buffer<int32_t>::make_scalar();
+        double t = benchmark([&]() { c(0, buf); });
+        std::cout << "One argument bound Pipeline call time " << t * 1e6 << "us.\n";
+
+        if (buf() != 42) {
+            std::cout << "Bound Pipeline computed " << buf() << " instead of 42\n";
+            return -1;
+        }
+    }
+
     for (int i = 10; i < 100; i += 10) {
         Func f;
         std::vector<Param<int>> params(i);
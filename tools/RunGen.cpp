@@ -5,6 +5,7 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <map>
@@ -14,6 +15,10 @@
 #include <string>
 #include <vector>
 
+#ifdef __linux__
+#include <sched.h>
+#endif
+
 extern "C" int halide_rungen_redirect_argv(void **args);
 extern "C" const struct halide_filter_metadata_t *halide_rungen_redirect_metadata();
 
@@ -730,6 +735,266 @@ uint64_t calc_pixels_out(const std::map<std::string, ArgData> &args) {
     return pixels_out;
 }
 
+// Pin the calling thread to the given cpu, so that benchmarks don't migrate
+// between cores (or sockets) mid-run. Returns false if unsupported.
+bool pin_to_cpu(int cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void) cpu;
+    return false;
+#endif
+}
+
+// Return the current frequency of the given cpu in kHz, or 0 if unknown.
+// A frequency well below the maximum usually means the governor is
+// scaling, and that the timings are not comparable across runs.
+int64_t cpu_frequency_khz(int cpu) {
+    std::ifstream f("/sys/devices/system/cpu/cpu" + std::to_string(cpu < 0 ? 0 : cpu) + "/cpufreq/scaling_cur_freq");
+    int64_t khz = 0;
+    if (!(f >> khz)) {
+        return 0;
+    }
+    return khz;
+}
+
+void write_benchmark_json(std::ostream &o, const std::string &name,
+                          const Halide::Tools::BenchmarkResult &result,
+                          double megapixels, int cpu) {
+    o << std::setprecision(9)
+      << "{\n"
+      << "  \"name\": \"" << name << "\",\n"
+      << "  \"best\": " << result.wall_time << ",\n"
+      << "  \"median\": " << result.median_time << ",\n"
+      << "  \"p90\": " << result.p90_time << ",\n"
+      << "  \"stddev\": " << result.stddev << ",\n"
+      << "  \"samples\": " << result.samples << ",\n"
+      << "  \"iterations\": " << result.iterations << ",\n"
+      << "  \"megapixels_per_sec\": " << megapixels / result.median_time << ",\n"
+      << "  \"cpu\": " << cpu << ",\n"
+      << "  \"cpu_frequency_khz\": " << cpu_frequency_khz(cpu) << ",\n"
+      << "  \"sample_times\": [";
+    for (size_t i = 0; i < result.sample_times.size(); i++) {
+        o << (i > 0 ? ", " : "") << result.sample_times[i];
+    }
+    o << "]\n"
+      << "}\n";
+}
+
+// Read the value of a numeric field from the JSON written by
+// write_benchmark_json. Returns false if the field isn't there.
+bool read_benchmark_json_field(const std::string &path, const std::string &field, double *value) {
+    std::ifstream f(path);
+    std::stringstream contents;
+    contents << f.rdbuf();
+    const std::string json = contents.str();
+    const std::string key = "\"" + field + "\":";
+    size_t pos = json.find(key);
+    if (!f || pos == std::string::npos) {
+        return false;
+    }
+    std::istringstream num(json.substr(pos + key.size()));
+    return (bool) (num >> *value);
+}
+
+// Make the argv for a call to the filter from the current argument values.
+std::vector<void*> make_filter_argv(std::map<std::string, ArgData> &args) {
+    std::vector<void*> filter_argv(args.size(), nullptr);
+    for (auto &arg_pair : args) {
+        auto &arg = arg_pair.second;
+        switch (arg.metadata->kind) {
+            case halide_argument_kind_input_scalar:
+                filter_argv[arg.index] = &arg.scalar_value;
+                break;
+            case halide_argument_kind_input_buffer:
+            case halide_argument_kind_output_buffer:
+                filter_argv[arg.index] = arg.buffer_value.raw_buffer();
+                break;
+        }
+    }
+    return filter_argv;
+}
+
+// Run a bounds query for the given default output shape, adapt the
+// inputs to the constraints it finds and allocate the outputs.
+void prepare_buffers(std::map<std::string, ArgData> &args, const Shape &default_output_shape) {
+    std::vector<Shape> constrained_shapes = run_bounds_query(args, default_output_shape);
+
+    for (auto &arg_pair : args) {
+        auto &arg_name = arg_pair.first;
+        auto &arg = arg_pair.second;
+        const Shape &constrained_shape = constrained_shapes[arg.index];
+        switch (arg.metadata->kind) {
+            case halide_argument_kind_input_buffer: {
+                info() << "Input " << arg_name << ": Shape is " << get_shape(arg.buffer_value);
+                bool updated = adapt_input_buffer_layout(constrained_shape, &arg.buffer_value);
+                info() << "Input " << arg_name << ": BoundsQuery result is " << constrained_shape;
+                if (updated) {
+                    info() << "Input " << arg_name << ": Updated Shape is " << get_shape(arg.buffer_value);
+                }
+                break;
+            }
+            case halide_argument_kind_output_buffer: {
+                arg.buffer_value = allocate_buffer(arg.metadata->type, make_legal_output_buffer_shape(constrained_shape));
+                info() << "Output " << arg_name << ": BoundsQuery result is " << constrained_shape;
+                info() << "Output " << arg_name << ": Shape is " << get_shape(arg.buffer_value);
+                break;
+            }
+        }
+    }
+}
+
+Halide::Tools::BenchmarkResult benchmark_filter(std::map<std::string, ArgData> &args,
+                                                const BenchmarkConfig &config) {
+    std::vector<void*> filter_argv = make_filter_argv(args);
+    const auto benchmark_inner = [&filter_argv, &args]() {
+        // Ignore result since our halide_error() should catch everything.
+        (void) halide_rungen_redirect_argv(&filter_argv[0]);
+        // Ensure that all outputs are finished, otherwise we may just be
+        // measuring how long it takes to do a kernel launch for GPU code.
+        for (auto &arg_pair : args) {
+            auto &arg = arg_pair.second;
+            if (arg.metadata->kind == halide_argument_kind_output_buffer) {
+                Buffer<> &b = arg.buffer_value;
+                b.device_sync();
+            }
+        }
+    };
+    return Halide::Tools::benchmark(benchmark_inner, config);
+}
+
+std::string extents_string(const Shape &shape) {
+    std::ostringstream o;
+    o << "[";
+    for (size_t i = 0; i < shape.size(); i++) {
+        o << (i > 0 ? "," : "") << shape[i].extent;
+    }
+    o << "]";
+    return o.str();
+}
+
+// The values to sweep a scalar input over.
+struct SweepInput {
+    std::string name;
+    std::vector<std::string> values;
+};
+
+// Benchmark the filter at every combination of the given output
+// extents, scalar input values and thread counts, reusing the loaded
+// inputs (and the thread pool) throughout. Prints a row per
+// combination, and writes the rows to csv_path as CSV if it isn't
+// empty.
+//
+// The strong scaling efficiency of a row is the speedup over the first
+// thread count at the same extents and inputs, divided by the increase
+// in threads. The weak scaling efficiency is the throughput per thread
+// relative to that of the first extents and thread count at the same
+// inputs; it is meaningful for rows whose extents grow with the thread
+// count.
+void do_sweep(const halide_filter_metadata_t *md,
+              std::map<std::string, ArgData> &args,
+              const std::vector<Shape> &sweep_extents,
+              const std::vector<SweepInput> &sweep_inputs,
+              const std::vector<int> &sweep_threads,
+              const BenchmarkConfig &config,
+              const std::string &csv_path) {
+    std::ostringstream csv;
+    csv << "extents";
+    for (const auto &in : sweep_inputs) {
+        csv << "," << in.name;
+    }
+    csv << ",threads,sec_per_iter,megapixels_per_sec,strong_efficiency,weak_efficiency\n";
+
+    // Indexed by the combination of input values, the throughput per
+    // thread of the first extents and thread count.
+    std::map<std::vector<size_t>, double> weak_baseline;
+
+    std::cout << "Sweep of " << md->name << ":\n";
+    for (const Shape &extents : sweep_extents) {
+        std::vector<size_t> which(sweep_inputs.size(), 0);
+        while (true) {
+            std::ostringstream params;
+            for (size_t i = 0; i < sweep_inputs.size(); i++) {
+                auto &arg = args[sweep_inputs[i].name];
+                const std::string &value = sweep_inputs[i].values[which[i]];
+                if (!parse_scalar(arg.metadata->type, value, &arg.scalar_value)) {
+                    fail() << "Argument value for: " << sweep_inputs[i].name << " could not be parsed as type "
+                           << arg.metadata->type << ": " << value;
+                }
+                params << " " << sweep_inputs[i].name << "=" << value;
+            }
+
+            // The outputs (and the region of the inputs used) may
+            // depend on both the extents and the scalar inputs.
+            prepare_buffers(args, extents);
+            double megapixels = (double) calc_pixels_out(args) / (1024.0 * 1024.0);
+            std::string output_extents = extents.empty() ? "default" : extents_string(extents);
+
+            double strong_baseline = 0;
+            for (int threads : sweep_threads) {
+                if (threads > 0) {
+                    halide_set_num_threads(threads);
+                }
+                auto result = benchmark_filter(args, config);
+                double mpix_per_sec = megapixels / result.median_time;
+
+                double strong = 0, weak = 0;
+                if (threads > 0) {
+                    double per_thread = mpix_per_sec / threads;
+                    if (strong_baseline == 0) {
+                        strong_baseline = result.median_time * threads;
+                    }
+                    if (!weak_baseline.count(which)) {
+                        weak_baseline[which] = per_thread;
+                    }
+                    strong = strong_baseline / (result.median_time * threads);
+                    weak = per_thread / weak_baseline[which];
+                }
+
+                std::cout << "  output_extents=" << output_extents << params.str()
+                          << " threads=" << (threads > 0 ? std::to_string(threads) : "default")
+                          << std::setprecision(6) << ": " << result.median_time << " sec/iter, "
+                          << mpix_per_sec << " mpix/sec";
+                if (threads > 0) {
+                    std::cout << std::setprecision(3) << ", strong scaling " << (strong * 100.0)
+                              << "%, weak scaling " << (weak * 100.0) << "%";
+                }
+                std::cout << "\n";
+
+                csv << "\"" << output_extents << "\"";
+                for (size_t i = 0; i < sweep_inputs.size(); i++) {
+                    csv << "," << sweep_inputs[i].values[which[i]];
+                }
+                csv << std::setprecision(9) << "," << threads << "," << result.median_time
+                    << "," << mpix_per_sec << "," << strong << "," << weak << "\n";
+            }
+
+            // Advance to the next combination of input values.
+            size_t i = 0;
+            for (; i < which.size(); i++) {
+                if (++which[i] < sweep_inputs[i].values.size()) {
+                    break;
+                }
+                which[i] = 0;
+            }
+            if (i == which.size()) {
+                break;
+            }
+        }
+    }
+
+    if (!csv_path.empty()) {
+        std::ofstream f(csv_path);
+        f << csv.str();
+        if (!f) {
+            fail() << "Unable to write sweep results to " << csv_path;
+        }
+    }
+}
+
 void usage(const char *argv0) {
 const std::string usage = R"USAGE(
 Usage: $NAME$ argument=value [argument=value... ] [flags]
@@ -752,6 +1017,11 @@ Arguments:
     uses float32 input and output, and you load/save to PNG), we'll use the most
     robust approximation within the format and issue a warning to stdout.
 
+    The HRAW format (.hraw) holds buffers of any type and dimensionality
+    exactly, and inputs in it are memory-mapped rather than copied, so it is
+    the best choice for very large inputs and for outputs you want to compare
+    exactly.
+
     (We anticipate adding other image formats in the future, in particular,
     TIFF and TMP.)
 
@@ -808,11 +1078,55 @@ Flags:
         Override the default maximum number of benchmarking iterations; ignored
         if --benchmarks is not also specified.
 
+    --benchmark_warmup_iters=NUM [default = 0]:
+        Run the filter this many times before taking any samples; ignored
+        if --benchmarks is not also specified.
+
+    --benchmark_samples=NUM [default = 0]:
+        If nonzero, take exactly this many samples rather than sampling
+        until the results are consistent, so that the median, p90 and
+        standard deviation are comparable across runs; ignored if
+        --benchmarks is not also specified.
+
+    --benchmark_json=FILE:
+        Write the benchmark results (best, median, p90, stddev and each
+        sample time, in seconds per iteration) to FILE as JSON.
+
+    --benchmark_baseline=FILE:
+        Compare the median time against that in FILE, a result previously
+        written with --benchmark_json, and exit with a nonzero status if it
+        is slower by more than --benchmark_tolerance.
+
+    --benchmark_tolerance=FRACTION [default = 0.05]:
+        The fractional slowdown over the baseline median that is tolerated.
+
+    --pin_cpu=NUM:
+        Pin the benchmark to the given cpu, so that it doesn't migrate
+        between cores. Pinning is currently only supported on Linux. Note
+        that other threads in Halide's thread pool are not pinned; see
+        HL_THREAD_AFFINITY for that.
+
     --track_memory:
         Override Halide memory allocator to track high-water mark of memory
         allocation during run; note that this may slow down execution, so
         benchmarks may be inaccurate if you combine --benchmark with this.
 
+    --sweep_threads=NUM,NUM,...
+    --sweep_output_extents=[NUM,NUM,...]:[NUM,NUM,...]:...
+    --sweep_input=NAME:VALUE,VALUE,...
+        Benchmark the filter at every combination of the given thread
+        counts (set with halide_set_num_threads), output extents and
+        values of the scalar input NAME (--sweep_input may be repeated),
+        loading the inputs once. The inputs must be large enough for all
+        of the output extents. A swept scalar input need not be given
+        otherwise. For each combination, prints the median time, the
+        throughput, and the strong and weak scaling efficiencies relative
+        to the first thread count (and, for weak scaling, the first
+        output extents). The --benchmark_* flags configure each benchmark.
+
+    --sweep_csv=FILE:
+        Also write the results of a sweep to FILE as CSV.
+
 Known Issues:
 
     * Filters running on GPU (vs CPU) have not been tested.
@@ -905,6 +1219,15 @@ int main(int argc, char **argv) {
     double benchmark_min_time = BenchmarkConfig().min_time;
     int benchmark_min_iters = BenchmarkConfig().min_iters;
     int benchmark_max_iters = BenchmarkConfig().max_iters;
+    int benchmark_warmup_iters = BenchmarkConfig().warmup_iters;
+    int benchmark_samples = BenchmarkConfig().samples;
+    std::string benchmark_json, benchmark_baseline;
+    double benchmark_tolerance = 0.05;
+    int pin_cpu = -1;
+    std::vector<int> sweep_threads;
+    std::vector<Shape> sweep_extents;
+    std::vector<SweepInput> sweep_inputs;
+    std::string sweep_csv;
     for (int i = 1; i < argc; ++i) {
         if (argv[i][0] == '-') {
             const char *p = argv[i] + 1; // skip -
@@ -962,8 +1285,61 @@ int main(int argc, char **argv) {
                 if (!parse_scalar(flag_value, &benchmark_max_iters)) {
                     fail() << "Invalid value for flag: " << flag_name;
                 }
+            } else if (flag_name == "benchmark_warmup_iters") {
+                if (!parse_scalar(flag_value, &benchmark_warmup_iters)) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
+            } else if (flag_name == "benchmark_samples") {
+                if (!parse_scalar(flag_value, &benchmark_samples)) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
+            } else if (flag_name == "benchmark_json") {
+                benchmark_json = flag_value;
+            } else if (flag_name == "benchmark_baseline") {
+                benchmark_baseline = flag_value;
+            } else if (flag_name == "benchmark_tolerance") {
+                if (!parse_scalar(flag_value, &benchmark_tolerance)) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
+            } else if (flag_name == "pin_cpu") {
+                if (!parse_scalar(flag_value, &pin_cpu)) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
             } else if (flag_name == "output_extents") {
                 default_output_shape = parse_extents(flag_value);
+            } else if (flag_name == "sweep_threads") {
+                for (const std::string &t : split_string(flag_value, ",")) {
+                    int threads = 0;
+                    if (!parse_scalar(t, &threads) || threads <= 0) {
+                        fail() << "Invalid value for flag: " << flag_name;
+                    }
+                    sweep_threads.push_back(threads);
+                }
+            } else if (flag_name == "sweep_output_extents") {
+                for (const std::string &e : split_string(flag_value, ":")) {
+                    sweep_extents.push_back(parse_extents(e));
+                }
+            } else if (flag_name == "sweep_input") {
+                std::vector<std::string> name_values = split_string(flag_value, ":");
+                if (name_values.size() != 2 || name_values[0].empty() || name_values[1].empty()) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
+                const std::string &arg_name = name_values[0];
+                auto it = args.find(arg_name);
+                if (it == args.end() || it->second.metadata->kind != halide_argument_kind_input_scalar) {
+                    fail() << "--sweep_input must name a scalar input: " << arg_name;
+                }
+                if (!it->second.raw_string.empty()) {
+                    fail() << "Argument value specified multiple times for: " << arg_name;
+                }
+                std::vector<std::string> values = split_string(name_values[1], ",");
+                // The first value is used to check and parse the
+                // arguments like any other.
+                it->second.raw_string = values[0];
+                found.insert(arg_name);
+                sweep_inputs.push_back({arg_name, values});
+            } else if (flag_name == "sweep_csv") {
+                sweep_csv = flag_value;
             } else {
                 usage(argv[0]);
                 fail() << "Unknown flag: " << flag_name;
@@ -1001,8 +1377,10 @@ int main(int argc, char **argv) {
         return 0;
     }
 
+    bool sweep = !sweep_threads.empty() || !sweep_extents.empty() || !sweep_inputs.empty();
+
     // It's OK to omit output arguments when we are benchmarking or tracking memory.
-    bool ok_to_omit_outputs = (benchmark || track_memory);
+    bool ok_to_omit_outputs = (benchmark || track_memory || sweep);
 
     if (benchmark && track_memory) {
         warn() << "Using --track_memory with --benchmarks will produce inaccurate benchmark results.";
@@ -1059,33 +1437,33 @@ int main(int argc, char **argv) {
         }
     }
 
-    // Run a bounds query: we need to figure out how to allocate the output buffers,
-    // and the input buffers might need reshaping to satisfy constraints (e.g. a chunky/interleaved layout).
-    std::vector<Shape> constrained_shapes = run_bounds_query(args, default_output_shape);
+    BenchmarkConfig config;
+    config.min_time = benchmark_min_time;
+    config.max_time = benchmark_min_time * 4;
+    config.min_iters = benchmark_min_iters;
+    config.max_iters = benchmark_max_iters;
+    config.warmup_iters = benchmark_warmup_iters;
+    config.samples = benchmark_samples;
 
-    for (auto &arg_pair : args) {
-        auto &arg_name = arg_pair.first;
-        auto &arg = arg_pair.second;
-        const Shape &constrained_shape = constrained_shapes[arg.index];
-        switch (arg.metadata->kind) {
-            case halide_argument_kind_input_buffer: {
-                info() << "Input " << arg_name << ": Shape is " << get_shape(arg.buffer_value);
-                bool updated = adapt_input_buffer_layout(constrained_shape, &arg.buffer_value);
-                info() << "Input " << arg_name << ": BoundsQuery result is " << constrained_shape;
-                if (updated) {
-                    info() << "Input " << arg_name << ": Updated Shape is " << get_shape(arg.buffer_value);
-                }
-                break;
-            }
-            case halide_argument_kind_output_buffer: {
-                arg.buffer_value = allocate_buffer(arg.metadata->type, make_legal_output_buffer_shape(constrained_shape));
-                info() << "Output " << arg_name << ": BoundsQuery result is " << constrained_shape;
-                info() << "Output " << arg_name << ": Shape is " << get_shape(arg.buffer_value);
-                break;
-            }
+    if (sweep) {
+        if (pin_cpu >= 0 && !pin_to_cpu(pin_cpu)) {
+            warn() << "Unable to pin the benchmark to cpu " << pin_cpu;
+        }
+        if (sweep_extents.empty()) {
+            sweep_extents.push_back(default_output_shape);
+        }
+        if (sweep_threads.empty()) {
+            // Zero means the default number of threads.
+            sweep_threads.push_back(0);
         }
+        do_sweep(md, args, sweep_extents, sweep_inputs, sweep_threads, config, sweep_csv);
+        return 0;
     }
 
+    // Run a bounds query: we need to figure out how to allocate the output buffers,
+    // and the input buffers might need reshaping to satisfy constraints (e.g. a chunky/interleaved layout).
+    prepare_buffers(args, default_output_shape);
+
     uint64_t pixels_out = calc_pixels_out(args);
     double megapixels = (double) pixels_out / (1024.0 * 1024.0);
 
@@ -1096,52 +1474,51 @@ int main(int argc, char **argv) {
     }
 
     {
-        std::vector<void*> filter_argv(args.size(), nullptr);
-        for (auto &arg_pair : args) {
-            auto &arg = arg_pair.second;
-            switch (arg.metadata->kind) {
-                case halide_argument_kind_input_scalar:
-                    filter_argv[arg.index] = &arg.scalar_value;
-                    break;
-                case halide_argument_kind_input_buffer:
-                case halide_argument_kind_output_buffer:
-                    filter_argv[arg.index] = arg.buffer_value.raw_buffer();
-                    break;
-            }
-        }
-
         if (benchmark) {
-            const auto benchmark_inner = [&filter_argv, &args]() {
-                // Ignore result since our halide_error() should catch everything.
-                (void) halide_rungen_redirect_argv(&filter_argv[0]);
-                // Ensure that all outputs are finished, otherwise we may just be
-                // measuring how long it takes to do a kernel launch for GPU code.
-                for (auto &arg_pair : args) {
-                    auto &arg = arg_pair.second;
-                    if (arg.metadata->kind == halide_argument_kind_output_buffer) {
-                        Buffer<> &b = arg.buffer_value;
-                        b.device_sync();
-                    }
-                }
-            };
-
             info() << "Benchmarking filter...";
 
-            BenchmarkConfig config;
-            config.min_time = benchmark_min_time;
-            config.max_time = benchmark_min_time * 4;
-            config.min_iters = benchmark_min_iters;
-            config.max_iters = benchmark_max_iters;
-            auto result = Halide::Tools::benchmark(benchmark_inner, config);
+            if (pin_cpu >= 0 && !pin_to_cpu(pin_cpu)) {
+                warn() << "Unable to pin the benchmark to cpu " << pin_cpu;
+            }
+
+            auto result = benchmark_filter(args, config);
 
             std::cout << "Benchmark for " << md->name << " produces best case of " << result.wall_time << " sec/iter (over "
                 << result.samples << " samples, "
                 << result.iterations << " iterations, "
                 << "accuracy " << std::setprecision(2) << (result.accuracy * 100.0) << "%).\n";
             std::cout << "Best output throughput is " << (megapixels / result.wall_time) << " mpix/sec.\n";
+            std::cout << std::setprecision(6) << "Median " << result.median_time << " sec/iter, p90 "
+                << result.p90_time << " sec/iter, stddev " << result.stddev << " sec.\n";
+
+            if (!benchmark_json.empty()) {
+                std::ofstream f(benchmark_json);
+                write_benchmark_json(f, md->name, result, megapixels, pin_cpu);
+                if (!f) {
+                    fail() << "Unable to write benchmark results to " << benchmark_json;
+                }
+            }
+
+            if (!benchmark_baseline.empty()) {
+                double baseline_median = 0;
+                if (!read_benchmark_json_field(benchmark_baseline, "median", &baseline_median) ||
+                    baseline_median <= 0) {
+                    fail() << "Unable to read a median time from " << benchmark_baseline;
+                }
+                double slowdown = result.median_time / baseline_median - 1.0;
+                std::cout << "Median is " << std::setprecision(3) << (slowdown * 100.0)
+                    << "% slower than the baseline of " << baseline_median << " sec/iter.\n";
+                if (slowdown > benchmark_tolerance) {
+                    std::cerr << "Performance regression: median " << result.median_time
+                              << " sec/iter exceeds baseline " << baseline_median
+                              << " sec/iter by more than " << (benchmark_tolerance * 100.0) << "%\n";
+                    return 1;
+                }
+            }
 
         } else {
             info() << "Running filter...";
+            std::vector<void*> filter_argv = make_filter_argv(args);
             // Ignore result since our halide_error() should catch everything.
             (void) halide_rungen_redirect_argv(&filter_argv[0]);
         }
@@ -0,0 +1,199 @@
+// Records benchmark results in a history file, and flags statistically
+// significant slowdowns against the previous result for the same
+// benchmark and target. Usage:
+//
+//   benchmark_history record HISTORY TARGET NAME RESULT_JSON
+//   benchmark_history run HISTORY TARGET NAME SAMPLES COMMAND [ARGS...]
+//
+// 'record' reads a result written by RunGen's --benchmark_json flag.
+// 'run' times SAMPLES runs of COMMAND (after one untimed warmup run), for
+// programs such as the performance tests that do their own setup.
+//
+// The history file has one JSON object per line. The exit status is
+// nonzero if the new result is slower than the previous one by more
+// than HL_BENCHMARK_MIN_SLOWDOWN (default 0.02) and Welch's t statistic
+// for the difference exceeds HL_BENCHMARK_T_THRESHOLD (default 3).
+
+#include "halide_benchmark.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Find the value of "key" in a line of JSON, as written by RunGen and by
+// this tool. Returns the text after the colon, or "" if not present.
+std::string json_field(const std::string &json, const std::string &key) {
+    const std::string k = "\"" + key + "\":";
+    size_t pos = json.find(k);
+    if (pos == std::string::npos) {
+        return "";
+    }
+    return json.substr(pos + k.size());
+}
+
+std::string json_string(const std::string &json, const std::string &key) {
+    std::string v = json_field(json, key);
+    size_t start = v.find('"');
+    size_t end = start == std::string::npos ? start : v.find('"', start + 1);
+    if (end == std::string::npos) {
+        return "";
+    }
+    return v.substr(start + 1, end - start - 1);
+}
+
+std::vector<double> json_numbers(const std::string &json, const std::string &key) {
+    std::vector<double> result;
+    std::string v = json_field(json, key);
+    size_t start = v.find('[');
+    size_t end = start == std::string::npos ? start : v.find(']', start);
+    if (end == std::string::npos) {
+        return result;
+    }
+    std::istringstream in(v.substr(start + 1, end - start - 1));
+    double d;
+    while (in >> d) {
+        result.push_back(d);
+        char comma;
+        in >> comma;
+    }
+    return result;
+}
+
+double env_or(const char *name, double value) {
+    const char *v = getenv(name);
+    return v ? atof(v) : value;
+}
+
+void mean_and_variance(const std::vector<double> &v, double *mean, double *variance) {
+    *mean = 0;
+    for (double x : v) {
+        *mean += x;
+    }
+    *mean /= v.size();
+    *variance = 0;
+    for (double x : v) {
+        *variance += (x - *mean) * (x - *mean);
+    }
+    *variance /= std::max<size_t>(v.size() - 1, 1);
+}
+
+double median(std::vector<double> v) {
+    std::sort(v.begin(), v.end());
+    return Halide::Tools::benchmark_percentile(v, 0.5);
+}
+
+// Return the sample times of the most recent entry for this target and
+// name in the history file, or an empty list if there isn't one.
+std::vector<double> previous_samples(const std::string &history,
+                                     const std::string &target,
+                                     const std::string &name) {
+    std::vector<double> result;
+    std::ifstream in(history);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (json_string(line, "target") == target &&
+            json_string(line, "name") == name) {
+            result = json_numbers(line, "samples");
+        }
+    }
+    return result;
+}
+
+int record(const std::string &history, const std::string &target,
+           const std::string &name, const std::vector<double> &samples) {
+    if (samples.empty()) {
+        std::cerr << "No samples for " << name << "\n";
+        return 1;
+    }
+
+    std::vector<double> old = previous_samples(history, target, name);
+
+    {
+        std::ofstream out(history, std::ios::app);
+        out << std::setprecision(9)
+            << "{\"target\": \"" << target << "\", \"name\": \"" << name
+            << "\", \"time\": " << (long long)time(nullptr)
+            << ", \"median\": " << median(samples) << ", \"samples\": [";
+        for (size_t i = 0; i < samples.size(); i++) {
+            out << (i > 0 ? ", " : "") << samples[i];
+        }
+        out << "]}\n";
+        if (!out) {
+            std::cerr << "Unable to write " << history << "\n";
+            return 1;
+        }
+    }
+
+    std::cout << name << " (" << target << "): median " << median(samples) << " s";
+    if (old.size() < 2 || samples.size() < 2) {
+        std::cout << ", no previous result to compare against\n";
+        return 0;
+    }
+
+    double new_mean, new_var, old_mean, old_var;
+    mean_and_variance(samples, &new_mean, &new_var);
+    mean_and_variance(old, &old_mean, &old_var);
+    double se = std::sqrt(new_var / samples.size() + old_var / old.size());
+    double t = se > 0 ? (new_mean - old_mean) / se : 0;
+    double slowdown = median(samples) / median(old) - 1;
+
+    std::cout << ", " << std::setprecision(3) << slowdown * 100 << "% vs previous, t = " << t << "\n";
+
+    if (slowdown > env_or("HL_BENCHMARK_MIN_SLOWDOWN", 0.02) &&
+        t > env_or("HL_BENCHMARK_T_THRESHOLD", 3.0)) {
+        std::cerr << "Performance regression in " << name << " (" << target << "): median "
+                  << median(old) << " s -> " << median(samples) << " s\n";
+        return 1;
+    }
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    const std::string mode = argc > 1 ? argv[1] : "";
+    if (mode == "record" && argc == 6) {
+        std::ifstream in(argv[5]);
+        std::stringstream contents;
+        contents << in.rdbuf();
+        if (!in) {
+            std::cerr << "Unable to read " << argv[5] << "\n";
+            return 1;
+        }
+        return record(argv[2], argv[3], argv[4], json_numbers(contents.str(), "sample_times"));
+    } else if (mode == "run" && argc >= 7) {
+        int count = atoi(argv[5]);
+        std::string command;
+        for (int i = 6; i < argc; i++) {
+            command += std::string(i > 6 ? " " : "") + "'" + argv[i] + "'";
+        }
+        command += " > /dev/null";
+        if (system(command.c_str()) != 0) {
+            std::cerr << "Command failed: " << command << "\n";
+            return 1;
+        }
+        std::vector<double> samples;
+        for (int i = 0; i < count; i++) {
+            int status = 0;
+            samples.push_back(Halide::Tools::benchmark(1, 1, [&]() { status = system(command.c_str()); }));
+            if (status != 0) {
+                std::cerr << "Command failed: " << command << "\n";
+                return 1;
+            }
+        }
+        return record(argv[2], argv[3], argv[4], samples);
+    }
+
+    std::cerr << "Usage:\n"
+              << "  " << argv[0] << " record HISTORY TARGET NAME RESULT_JSON\n"
+              << "  " << argv[0] << " run HISTORY TARGET NAME SAMPLES COMMAND [ARGS...]\n";
+    return 1;
+}
@@ -0,0 +1,159 @@
+// Measures the relative cost of each class of operation on this machine
+// and writes a cost model file for the auto-scheduler to use in place of
+// its default costs. Usage:
+//
+//   calibrate_cost_model [output_file]
+//
+// Point HL_AUTOSCHEDULE_COST_MODEL at the output file to use it.
+
+#include "Halide.h"
+#include "halide_benchmark.h"
+
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace Halide;
+using namespace Halide::Tools;
+
+namespace {
+
+// The number of times each operation is applied to each value, and the
+// number of values computed, per benchmark run.
+const int chain_length = 32;
+const int width = 1 << 16;
+
+Var x("x");
+Param<int32_t> pi("pi");
+Param<float> pf("pf");
+Param<double> pd("pd");
+
+// A small input that stays in cache, so that the benchmarks measure the
+// operations rather than the loads.
+Buffer<int32_t> small_input(1024);
+
+// Return the time in seconds to compute one value of 'f'.
+double time_per_value(Func f) {
+    f.vectorize(x, 8);
+    f.compile_jit();
+
+    Buffer<> out(f.output_types()[0], width);
+    return benchmark([&]() { f.realize(out); }) / width;
+}
+
+// Return the time in seconds to apply 'step' once to a value, which is
+// initially 'init'.
+double time_per_step(Expr init, std::function<Expr(Expr)> step) {
+    Func base("base"), chain("chain");
+    base(x) = init;
+    Expr e = init;
+    for (int i = 0; i < chain_length; i++) {
+        e = step(e);
+    }
+    chain(x) = e;
+    return (time_per_value(chain) - time_per_value(base)) / chain_length;
+}
+
+struct Benchmark {
+    // The name of the cost being measured.
+    std::string name;
+    // The expression the operation is applied to.
+    Expr init;
+    // One step of the benchmark, and the number of times it applies the
+    // operation.
+    std::function<Expr(Expr)> step;
+    int ops;
+    // The other costs incurred by each step, which have been measured by
+    // the benchmarks before this one.
+    std::vector<std::string> includes;
+};
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    for (int i = 0; i < small_input.width(); i++) {
+        small_input(i) = rand();
+    }
+    pi.set(13);
+    pf.set(1.0001f);
+    pd.set(1.0001);
+
+    Expr ei = small_input(x % small_input.width());
+    Expr ef = cast<float>(ei) / pf;
+    Expr ed = cast<double>(ei) / pd;
+
+    std::vector<Benchmark> benchmarks = {
+        {"add", ei, [](Expr e) { return e + pi; }, 1, {}},
+        {"mul", ei, [](Expr e) { return e * pi; }, 1, {}},
+        {"div", ei, [](Expr e) { return e / pi; }, 1, {}},
+        {"bitwise", ei, [](Expr e) { return e ^ pi; }, 1, {}},
+        {"cast", ei, [](Expr e) { return cast<int32_t>(cast<uint16_t>(e)); }, 2, {}},
+        {"compare", ei, [](Expr e) { return e + cast<int32_t>(e < pi); }, 1, {"add", "cast"}},
+        {"select", ei, [](Expr e) { return select(e < pi, e + 1, e - 1); }, 1, {"compare", "add"}},
+        {"load", ei, [](Expr e) { return e + small_input(e & 1023); }, 1, {"add", "bitwise"}},
+        {"intrinsic", ei, [](Expr e) { return e + count_leading_zeros(e); }, 1, {"add"}},
+        {"math_f32", ef, [](Expr e) { return sin(e) + pf; }, 1, {"add"}},
+        {"math_f64", ed, [](Expr e) { return sin(e) + pd; }, 1, {"add"}},
+    };
+
+    // The model is in units of the cost of an add.
+    double t_add = 0;
+    std::map<std::string, double> cost;
+    Internal::CostModel model;
+    std::map<std::string, int64_t *> fields = {
+        {"add", &model.add}, {"mul", &model.mul}, {"div", &model.div},
+        {"compare", &model.compare}, {"select", &model.select},
+        {"cast", &model.cast}, {"load", &model.load},
+        {"bitwise", &model.bitwise}, {"intrinsic", &model.intrinsic},
+        {"math_f32", &model.math_f32}, {"math_f64", &model.math_f64}};
+
+    for (const Benchmark &b : benchmarks) {
+        double t = time_per_step(b.init, b.step);
+        if (b.name == "add") {
+            t_add = t;
+        }
+        double c = t / t_add;
+        for (const std::string &other : b.includes) {
+            c -= cost[other];
+        }
+        cost[b.name] = std::max(c / b.ops, 1.0);
+        *fields[b.name] = (int64_t)(cost[b.name] + 0.5);
+        std::cerr << b.name << ": " << t * 1e9 << " ns per op, cost " << cost[b.name] << "\n";
+    }
+    // There is no f16 math on most hosts, so scale from the f32 cost in the
+    // same ratio as the default model.
+    model.math_f16 = std::max<int64_t>(model.math_f32 / 2, 1);
+
+    // The balance is the cost of loading a byte from beyond the last level
+    // cache, so stream through a buffer much larger than any cache.
+    {
+        const int big = 1 << 26;
+        Buffer<int32_t> big_input(big);
+        big_input.fill(1);
+        Func stream("stream");
+        stream(x) = big_input(x) + pi;
+        stream.vectorize(x, 8);
+        stream.compile_jit();
+        Buffer<int32_t> out(big);
+        double t = benchmark([&]() { stream.realize(out); }) / big;
+        // Each value loads and stores four bytes.
+        double balance = (t / t_add - 1) / 8;
+        model.balance = Expr((int32_t)std::max(balance + 0.5, 1.0));
+        std::cerr << "balance: " << t * 1e9 / 8 << " ns per byte, cost " << balance << "\n";
+    }
+
+    std::string text = "# Cost model calibrated by calibrate_cost_model\n" + model.to_string();
+    if (argc > 1) {
+        std::ofstream f(argv[1]);
+        f << text;
+        if (!f) {
+            std::cerr << "Unable to write " << argv[1] << "\n";
+            return -1;
+        }
+    } else {
+        std::cout << text;
+    }
+    return 0;
+}
@@ -4,8 +4,10 @@
 #include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <cmath>
 #include <functional>
 #include <limits>
+#include <vector>
 
 namespace Halide {
 namespace Tools {
@@ -94,6 +96,16 @@ struct BenchmarkConfig {
     // this. Controls accuracy. The closer to zero this gets the more
     // reliable the answer, but the longer it may take to run.
     double accuracy{0.03};
+
+    // Run the operation this many times before taking any samples, so
+    // that caches, page tables and clock governors have settled.
+    uint64_t warmup_iters{0};
+
+    // If nonzero, ignore accuracy and max_time, and take exactly this
+    // many samples once the iterations per sample has been chosen
+    // (still subject to max_iters). Useful when comparing distributions
+    // across runs, as the sample count is then fixed.
+    uint64_t samples{0};
 };
 
 struct BenchmarkResult {
@@ -114,11 +126,32 @@ struct BenchmarkResult {
     // Will be <= config.accuracy unless max_iters is exceeded.
     double accuracy;
 
+    // The elapsed wall-clock time per iteration (seconds) of each sample
+    // used for measurement, in increasing order, and statistics over them.
+    std::vector<double> sample_times;
+    double median_time;
+    double p90_time;
+    double stddev;
+
     operator double() const { return wall_time; }
 };
 
+// Return the p'th percentile (0 <= p <= 1) of a sorted, non-empty list
+// of times, interpolating between neighbouring samples.
+inline double benchmark_percentile(const std::vector<double> &sorted, double p) {
+    assert(!sorted.empty());
+    double pos = p * (sorted.size() - 1);
+    size_t lo = (size_t)pos;
+    size_t hi = std::min(lo + 1, sorted.size() - 1);
+    return sorted[lo] + (sorted[hi] - sorted[lo]) * (pos - lo);
+}
+
 inline BenchmarkResult benchmark(std::function<void()> op, const BenchmarkConfig& config = {}) {
-    BenchmarkResult result{0, 0, 0};
+    BenchmarkResult result{0, 0, 0, 0, {}, 0, 0, 0};
+
+    for (uint64_t i = 0; i < config.warmup_iters; i++) {
+        op();
+    }
 
     const double min_time = std::max(10 * 1e-6, config.min_time);
     const double max_time = std::max(config.min_time, config.max_time);
@@ -135,14 +168,18 @@ inline BenchmarkResult benchmark(std::function<void()> op, const BenchmarkConfig
     constexpr int kMinSamples = 3;
     double times[kMinSamples + 1] = {0};
 
+    std::vector<double> &all_times = result.sample_times;
+
     double total_time = 0;
     uint64_t iters_per_sample = min_iters;
     while (result.iterations < max_iters) {
         result.samples = 0;
         result.iterations = 0;
         total_time = 0;
+        all_times.clear();
         for (int i = 0; i < kMinSamples; i++) {
             times[i] = benchmark(1, iters_per_sample, op);
+            all_times.push_back(times[i]);
             result.samples++;
             result.iterations += iters_per_sample;
             total_time += times[i] * iters_per_sample;
@@ -162,10 +199,19 @@ inline BenchmarkResult benchmark(std::function<void()> op, const BenchmarkConfig
     // - No matter what, don't go over max_iters or max_time; this is important, in case
     // we happen to get faster results for the first samples, then happen to transition
     // to throttled-down CPU state.
-    while ((times[0] * accuracy < times[kMinSamples - 1] || total_time < min_time) &&
-                 total_time < max_time &&
-                 result.iterations < max_iters) {
+    auto keep_going = [&]() {
+        if (result.iterations >= max_iters) {
+            return false;
+        }
+        if (config.samples > 0) {
+            return result.samples < config.samples;
+        }
+        return (times[0] * accuracy < times[kMinSamples - 1] || total_time < min_time) &&
+               total_time < max_time;
+    };
+    while (keep_going()) {
         times[kMinSamples] = benchmark(1, iters_per_sample, op);
+        all_times.push_back(times[kMinSamples]);
         result.samples++;
         result.iterations += iters_per_sample;
         total_time += times[kMinSamples] * iters_per_sample;
@@ -174,6 +220,20 @@ inline BenchmarkResult benchmark(std::function<void()> op, const BenchmarkConfig
     result.wall_time = times[0];
     result.accuracy = (times[kMinSamples - 1] / times[0]) - 1.0;
 
+    std::sort(all_times.begin(), all_times.end());
+    result.median_time = benchmark_percentile(all_times, 0.5);
+    result.p90_time = benchmark_percentile(all_times, 0.9);
+    double mean = 0;
+    for (double t : all_times) {
+        mean += t;
+    }
+    mean /= all_times.size();
+    double variance = 0;
+    for (double t : all_times) {
+        variance += (t - mean) * (t - mean);
+    }
+    result.stddev = std::sqrt(variance / all_times.size());
+
     return result;
 }
 
@@ -5,15 +5,25 @@
 #define HALIDE_IMAGE_IO_H
 
 #include <algorithm>
+#include <condition_variable>
 #include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
+#include <deque>
 #include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <string>
+#include <thread>
 #include <vector>
 #include <cctype>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
 
 #ifndef HALIDE_NO_PNG
 #include "png.h"
@@ -1306,6 +1316,213 @@ bool save_mat(ImageType &im, const std::string &filename) {
     return true;
 }
 
+// ".hraw" is a simple self-describing format for buffers of any type and
+// dimensionality, designed to be memory-mapped rather than parsed: a
+// RawHeader, then the shape as an array of halide_dimension_t, then the
+// payload in native byte order at a page-aligned offset. Strides are in
+// elements and are relative to the element with the lowest address, which
+// is at the start of the payload.
+struct RawHeader {
+    char magic[8];
+    uint32_t byte_order;
+    uint8_t type_code;
+    uint8_t type_bits;
+    uint16_t type_lanes;
+    int32_t dimensions;
+    uint32_t reserved;
+    uint64_t payload_offset;
+    uint64_t payload_bytes;
+};
+
+constexpr char kRawMagic[8] = {'H', 'L', 'R', 'A', 'W', '\0', '\0', '\1'};
+constexpr uint32_t kRawByteOrder = 0x01020304;
+constexpr uint64_t kRawPayloadAlignment = 4096;
+
+// Check a .hraw header and shape, and compute the offset from the start of
+// the payload to the element at the min coordinate.
+template<CheckFunc check>
+bool check_raw_header(const RawHeader &header, const std::vector<halide_dimension_t> &shape,
+                      uint64_t file_size, uint64_t *host_offset) {
+    if (!check(memcmp(header.magic, kRawMagic, sizeof(kRawMagic)) == 0, "File is not recognized as a .hraw file")) {
+        return false;
+    }
+    if (!check(header.byte_order == kRawByteOrder, "The .hraw file has the wrong byte order for this machine")) {
+        return false;
+    }
+    if (!check(header.type_bits > 0 && header.type_lanes == 1, "Bad type in .hraw header")) {
+        return false;
+    }
+    const uint64_t elem_size = (header.type_bits + 7) / 8;
+    uint64_t span = 1, offset = 0;
+    for (const halide_dimension_t &d : shape) {
+        if (!check(d.extent > 0, "Bad extent in .hraw shape")) {
+            return false;
+        }
+        const uint64_t stride = std::abs((int64_t)d.stride);
+        span += stride * (d.extent - 1);
+        if (d.stride < 0) {
+            offset += stride * (d.extent - 1);
+        }
+    }
+    if (!check(span * elem_size <= header.payload_bytes &&
+               header.payload_offset + header.payload_bytes <= file_size,
+               "The .hraw payload is too small for its shape")) {
+        return false;
+    }
+    *host_offset = offset * elem_size;
+    return true;
+}
+
+#ifndef _WIN32
+// The context for releasing the host memory of a Buffer that is a view
+// onto a memory-mapped .hraw file.
+struct RawMapping {
+    void *addr;
+    size_t length;
+
+    static void release(void *p) {
+        RawMapping *m = (RawMapping *)p;
+        munmap(m->addr, m->length);
+        delete m;
+    }
+};
+#endif
+
+// Load a .hraw file. Where possible this memory-maps the file rather than
+// copying it: the mapping is private, so writes to the image are not
+// written back to the file, and pages that are never written are shared
+// with any other process that maps the same file.
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool load_raw(const std::string &filename, ImageType *im) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    FileOpener f(filename, "rb");
+    if (!check(f.f != nullptr, "File could not be opened for reading")) {
+        return false;
+    }
+    RawHeader header;
+    if (!check(f.read_bytes(&header, sizeof(header)), "Could not read .hraw header")) {
+        return false;
+    }
+    if (!check(header.dimensions >= 0 && header.dimensions <= 64, "Bad dimensions in .hraw header")) {
+        return false;
+    }
+    std::vector<halide_dimension_t> shape(header.dimensions);
+    if (!check(f.read_vector(&shape), "Could not read .hraw shape")) {
+        return false;
+    }
+    if (!check(fseek(f.f, 0, SEEK_END) == 0, "Could not seek in .hraw file")) {
+        return false;
+    }
+    const uint64_t file_size = ftell(f.f);
+    uint64_t host_offset;
+    if (!check_raw_header<check>(header, shape, file_size, &host_offset)) {
+        return false;
+    }
+    const halide_type_t im_type((halide_type_code_t)header.type_code, header.type_bits);
+
+#ifndef _WIN32
+    void *addr = mmap(nullptr, file_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(f.f), 0);
+    if (addr != MAP_FAILED) {
+        uint8_t *host = (uint8_t *)addr + header.payload_offset + host_offset;
+        *im = ImageType(im_type, host, header.dimensions, shape.data(),
+                        RawMapping::release, new RawMapping{addr, (size_t)file_size});
+        return true;
+    }
+    // Fall back to reading the file.
+#endif
+
+    *im = ImageType(im_type, nullptr, header.dimensions, shape.data());
+    im->allocate();
+    if (!check(fseek(f.f, header.payload_offset, SEEK_SET) == 0 &&
+               f.read_bytes(im->begin(), im->size_in_bytes()), "Could not read .hraw payload")) {
+        return false;
+    }
+    im->set_host_dirty();
+    return true;
+}
+
+inline const std::set<FormatInfo> &query_raw() {
+    // Any type and (reasonable) dimensionality.
+    static std::set<FormatInfo> info = []() {
+        std::set<FormatInfo> info;
+        const halide_type_t types[] = {
+            halide_type_t(halide_type_uint, 1),
+            halide_type_t(halide_type_uint, 8),
+            halide_type_t(halide_type_int, 8),
+            halide_type_t(halide_type_uint, 16),
+            halide_type_t(halide_type_int, 16),
+            halide_type_t(halide_type_float, 16),
+            halide_type_t(halide_type_uint, 32),
+            halide_type_t(halide_type_int, 32),
+            halide_type_t(halide_type_float, 32),
+            halide_type_t(halide_type_uint, 64),
+            halide_type_t(halide_type_int, 64),
+            halide_type_t(halide_type_float, 64),
+        };
+        for (const halide_type_t &t : types) {
+            for (int d = 0; d <= 16; d++) {
+                info.insert({t, d});
+            }
+        }
+        return info;
+    }();
+    return info;
+}
+
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool save_raw(ImageType &im, const std::string &filename) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    im.copy_to_host();
+
+    const halide_type_t im_type = im.type();
+    const size_t elem_size = im_type.bytes();
+
+    // If the image is dense with positive strides, its memory is written
+    // as-is, in whatever order the strides give. Otherwise it is written in
+    // planar order.
+    bool dense = (uint8_t *)im.begin() + im.number_of_elements() * elem_size == (uint8_t *)im.end();
+    for (int d = 0; d < im.dimensions(); d++) {
+        dense = dense && im.dim(d).stride() > 0;
+    }
+    std::vector<halide_dimension_t> shape(im.dimensions());
+    int32_t stride = 1;
+    for (int d = 0; d < im.dimensions(); d++) {
+        shape[d].min = im.dim(d).min();
+        shape[d].extent = im.dim(d).extent();
+        shape[d].stride = dense ? im.dim(d).stride() : stride;
+        shape[d].flags = 0;
+        stride *= im.dim(d).extent();
+    }
+
+    RawHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kRawMagic, sizeof(kRawMagic));
+    header.byte_order = kRawByteOrder;
+    header.type_code = im_type.code;
+    header.type_bits = im_type.bits;
+    header.type_lanes = 1;
+    header.dimensions = im.dimensions();
+    const uint64_t header_bytes = sizeof(header) + shape.size() * sizeof(halide_dimension_t);
+    header.payload_offset = (header_bytes + kRawPayloadAlignment - 1) & ~(kRawPayloadAlignment - 1);
+    header.payload_bytes = im.number_of_elements() * elem_size;
+
+    FileOpener f(filename, "wb");
+    if (!check(f.f != nullptr, "File could not be opened for writing")) {
+        return false;
+    }
+    std::vector<uint8_t> padding(header.payload_offset - header_bytes, 0);
+    if (!check(f.write_bytes(&header, sizeof(header)) &&
+               f.write_vector(shape) &&
+               f.write_vector(padding), "Could not write .hraw header")) {
+        return false;
+    }
+    if (dense) {
+        return check(f.write_bytes(im.begin(), header.payload_bytes), "Could not write .hraw payload");
+    }
+    return write_planar_payload<ImageType, check>(im, f);
+}
 
 template<typename ImageType, Internal::CheckFunc check>
 struct ImageIO {
@@ -1328,6 +1545,7 @@ bool find_imageio(const std::string &filename, ImageIO<ImageType, check> *result
         {"png", {load_png<ImageType, check>, save_png<ImageType, check>, query_png}},
 #endif
         {"ppm", {load_ppm<ImageType, check>, save_ppm<ImageType, check>, query_ppm}},
+        {"hraw", {load_raw<ImageType, check>, save_raw<ImageType, check>, query_raw}},
         {"tmp", {load_tmp<ImageType, check>, save_tmp<ImageType, check>, query_tmp}},
         {"mat", {load_mat<ImageType, check>, save_mat<ImageType, check>, query_mat}}
     };
@@ -1706,6 +1924,640 @@ void convert_and_save_image(ImageType &im, const std::string &filename) {
     }
 }
 
+namespace Internal {
+
+// Decodes an image one row at a time, producing rows in the interleaved,
+// big-endian layout that read_big_endian_row() expects.
+struct RowDecoder {
+    int width = 0, height = 0, channels = 0, bit_depth = 0;
+    virtual ~RowDecoder() {}
+    virtual bool read_row(uint8_t *dst) = 0;
+};
+
+// The inverse of RowDecoder: consumes rows in the layout produced by
+// write_big_endian_row().
+struct RowEncoder {
+    virtual ~RowEncoder() {}
+    virtual bool write_row(const uint8_t *src) = 0;
+    virtual bool finish() = 0;
+};
+
+#ifndef HALIDE_NO_PNG
+
+template<CheckFunc check>
+class PngRowDecoder : public RowDecoder {
+    FileOpener f;
+    png_structp png_ptr = nullptr;
+    png_infop info_ptr = nullptr;
+
+public:
+    PngRowDecoder(const std::string &filename) : f(filename, "rb") {}
+
+    ~PngRowDecoder() override {
+        if (png_ptr != nullptr) {
+            png_destroy_read_struct(&png_ptr, info_ptr ? &info_ptr : nullptr, nullptr);
+        }
+    }
+
+    bool open() {
+        if (!check(f.f != nullptr, "File could not be opened for reading")) {
+            return false;
+        }
+        png_byte header[8];
+        if (!check(f.read_array(header), "File ended before end of header")) {
+            return false;
+        }
+        if (!check(!png_sig_cmp(header, 0, 8), "File is not recognized as a PNG file")) {
+            return false;
+        }
+        png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+        if (!check(png_ptr != nullptr, "png_create_read_struct failed")) {
+            return false;
+        }
+        info_ptr = png_create_info_struct(png_ptr);
+        if (!check(info_ptr != nullptr, "png_create_info_struct failed")) {
+            return false;
+        }
+        if (!check(!setjmp(png_jmpbuf(png_ptr)), "Error loading PNG")) {
+            return false;
+        }
+        png_init_io(png_ptr, f.f);
+        png_set_sig_bytes(png_ptr, 8);
+        png_read_info(png_ptr, info_ptr);
+        if (!check(png_get_interlace_type(png_ptr, info_ptr) == PNG_INTERLACE_NONE,
+                   "Interlaced PNG files cannot be read in strips")) {
+            return false;
+        }
+        width = png_get_image_width(png_ptr, info_ptr);
+        height = png_get_image_height(png_ptr, info_ptr);
+        channels = png_get_channels(png_ptr, info_ptr);
+        bit_depth = png_get_bit_depth(png_ptr, info_ptr);
+        png_read_update_info(png_ptr, info_ptr);
+        return true;
+    }
+
+    bool read_row(uint8_t *dst) override {
+        if (!check(!setjmp(png_jmpbuf(png_ptr)), "Error loading PNG")) {
+            return false;
+        }
+        png_read_row(png_ptr, dst, nullptr);
+        return true;
+    }
+};
+
+template<CheckFunc check>
+class PngRowEncoder : public RowEncoder {
+    FileOpener f;
+    png_structp png_ptr = nullptr;
+    png_infop info_ptr = nullptr;
+
+public:
+    PngRowEncoder(const std::string &filename) : f(filename, "wb") {}
+
+    ~PngRowEncoder() override {
+        if (png_ptr != nullptr) {
+            png_destroy_write_struct(&png_ptr, info_ptr ? &info_ptr : nullptr);
+        }
+    }
+
+    bool open(int width, int height, int channels, int bit_depth) {
+        if (!check(channels >= 1 && channels <= 4,
+                   "Can't write PNG files that have other than 1, 2, 3, or 4 channels")) {
+            return false;
+        }
+        if (!check(bit_depth == 8 || bit_depth == 16, "Can't write PNG files with this type")) {
+            return false;
+        }
+        const png_byte color_types[4] = {
+            PNG_COLOR_TYPE_GRAY,
+            PNG_COLOR_TYPE_GRAY_ALPHA,
+            PNG_COLOR_TYPE_RGB,
+            PNG_COLOR_TYPE_RGB_ALPHA
+        };
+        if (!check(f.f != nullptr, "[write_png_file] File could not be opened for writing")) {
+            return false;
+        }
+        png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+        if (!check(png_ptr != nullptr, "[write_png_file] png_create_write_struct failed")) {
+            return false;
+        }
+        info_ptr = png_create_info_struct(png_ptr);
+        if (!check(info_ptr != nullptr, "[write_png_file] png_create_info_struct failed")) {
+            return false;
+        }
+        if (!check(!setjmp(png_jmpbuf(png_ptr)), "Error saving PNG")) {
+            return false;
+        }
+        png_init_io(png_ptr, f.f);
+        png_set_IHDR(png_ptr, info_ptr, width, height,
+                     bit_depth, color_types[channels - 1], PNG_INTERLACE_NONE,
+                     PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
+        png_write_info(png_ptr, info_ptr);
+        return true;
+    }
+
+    bool write_row(const uint8_t *src) override {
+        if (!check(!setjmp(png_jmpbuf(png_ptr)), "Error saving PNG")) {
+            return false;
+        }
+        png_write_row(png_ptr, const_cast<uint8_t *>(src));
+        return true;
+    }
+
+    bool finish() override {
+        if (!check(!setjmp(png_jmpbuf(png_ptr)), "Error saving PNG")) {
+            return false;
+        }
+        png_write_end(png_ptr, NULL);
+        return true;
+    }
+};
+
+#endif  // not HALIDE_NO_PNG
+
+template<CheckFunc check>
+class PnmRowDecoder : public RowDecoder {
+    FileOpener f;
+    size_t row_bytes = 0;
+
+public:
+    PnmRowDecoder(const std::string &filename) : f(filename, "rb") {}
+
+    bool open(int expected_channels) {
+        const char *hdr_fmt = expected_channels == 3 ? "P6" : "P5";
+        if (!read_pnm_header<check>(f, hdr_fmt, &width, &height, &bit_depth)) {
+            return false;
+        }
+        channels = expected_channels;
+        row_bytes = width * channels * (bit_depth / 8);
+        return true;
+    }
+
+    bool read_row(uint8_t *dst) override {
+        return check(f.read_bytes(dst, row_bytes), "Could not read data");
+    }
+};
+
+template<CheckFunc check>
+class PnmRowEncoder : public RowEncoder {
+    FileOpener f;
+    size_t row_bytes = 0;
+
+public:
+    PnmRowEncoder(const std::string &filename) : f(filename, "wb") {}
+
+    bool open(int width, int height, int channels, int expected_channels, int bit_depth) {
+        if (!check(channels == expected_channels, "Wrong number of channels")) {
+            return false;
+        }
+        if (!check(bit_depth == 8 || bit_depth == 16, "Can't write PNM files with this type")) {
+            return false;
+        }
+        if (!check(f.f != nullptr, "File could not be opened for writing")) {
+            return false;
+        }
+        const char *hdr_fmt = channels == 3 ? "P6" : "P5";
+        fprintf(f.f, "%s\n%d %d\n%d\n", hdr_fmt, width, height, (1<<bit_depth)-1);
+        row_bytes = width * channels * (bit_depth / 8);
+        return true;
+    }
+
+    bool write_row(const uint8_t *src) override {
+        return check(f.write_bytes(src, row_bytes), "Could not write data");
+    }
+
+    bool finish() override {
+        return check(fflush(f.f) == 0, "Could not write data");
+    }
+};
+
+#ifndef HALIDE_NO_JPEG
+
+template<CheckFunc check>
+class JpgRowDecoder : public RowDecoder {
+    FileOpener f;
+    struct jpeg_decompress_struct cinfo;
+    struct jpeg_error_mgr jerr;
+    bool created = false;
+
+public:
+    JpgRowDecoder(const std::string &filename) : f(filename, "rb") {}
+
+    ~JpgRowDecoder() override {
+        if (created) {
+            jpeg_destroy_decompress(&cinfo);
+        }
+    }
+
+    bool open() {
+        if (!check(f.f != nullptr, "File could not be opened for reading")) {
+            return false;
+        }
+        cinfo.err = jpeg_std_error(&jerr);
+        jpeg_create_decompress(&cinfo);
+        created = true;
+        jpeg_stdio_src(&cinfo, f.f);
+        jpeg_read_header(&cinfo, TRUE);
+        jpeg_start_decompress(&cinfo);
+        width = cinfo.output_width;
+        height = cinfo.output_height;
+        channels = cinfo.output_components;
+        bit_depth = 8;
+        return true;
+    }
+
+    bool read_row(uint8_t *dst) override {
+        return check(jpeg_read_scanlines(&cinfo, &dst, 1) == 1, "Could not read data");
+    }
+};
+
+template<CheckFunc check>
+class JpgRowEncoder : public RowEncoder {
+    FileOpener f;
+    struct jpeg_compress_struct cinfo;
+    struct jpeg_error_mgr jerr;
+    bool created = false;
+
+public:
+    JpgRowEncoder(const std::string &filename) : f(filename, "wb") {}
+
+    ~JpgRowEncoder() override {
+        if (created) {
+            jpeg_destroy_compress(&cinfo);
+        }
+    }
+
+    bool open(int width, int height, int channels, int bit_depth) {
+        if (!check(channels == 1 || channels == 3, "Wrong number of channels")) {
+            return false;
+        }
+        if (!check(bit_depth == 8, "Can't write JPEG files with this type")) {
+            return false;
+        }
+        if (!check(f.f != nullptr, "File could not be opened for writing")) {
+            return false;
+        }
+        // Matches save_jpg().
+        constexpr int quality = 99;
+        cinfo.err = jpeg_std_error(&jerr);
+        jpeg_create_compress(&cinfo);
+        created = true;
+        jpeg_stdio_dest(&cinfo, f.f);
+        cinfo.image_width = width;
+        cinfo.image_height = height;
+        cinfo.input_components = channels;
+        cinfo.in_color_space = (channels == 3) ? JCS_RGB : JCS_GRAYSCALE;
+        jpeg_set_defaults(&cinfo);
+        jpeg_set_quality(&cinfo, quality, TRUE);
+        jpeg_start_compress(&cinfo, TRUE);
+        return true;
+    }
+
+    bool write_row(const uint8_t *src) override {
+        uint8_t *row = const_cast<uint8_t *>(src);
+        return check(jpeg_write_scanlines(&cinfo, &row, 1) == 1, "Could not write data");
+    }
+
+    bool finish() override {
+        jpeg_finish_compress(&cinfo);
+        return true;
+    }
+};
+
+#endif  // not HALIDE_NO_JPEG
+
+template<CheckFunc check>
+std::unique_ptr<RowDecoder> open_row_decoder(const std::string &filename) {
+    const std::string ext = get_lowercase_extension(filename);
+#ifndef HALIDE_NO_PNG
+    if (ext == "png") {
+        std::unique_ptr<PngRowDecoder<check>> d(new PngRowDecoder<check>(filename));
+        return d->open() ? std::move(d) : nullptr;
+    }
+#endif
+#ifndef HALIDE_NO_JPEG
+    if (ext == "jpg" || ext == "jpeg") {
+        std::unique_ptr<JpgRowDecoder<check>> d(new JpgRowDecoder<check>(filename));
+        return d->open() ? std::move(d) : nullptr;
+    }
+#endif
+    if (ext == "pgm" || ext == "ppm") {
+        std::unique_ptr<PnmRowDecoder<check>> d(new PnmRowDecoder<check>(filename));
+        return d->open(ext == "ppm" ? 3 : 1) ? std::move(d) : nullptr;
+    }
+    check(false, ("unsupported file extension \"" + ext + "\" for reading in strips").c_str());
+    return nullptr;
+}
+
+template<CheckFunc check>
+std::unique_ptr<RowEncoder> open_row_encoder(const std::string &filename, int width, int height,
+                                             int channels, int bit_depth) {
+    const std::string ext = get_lowercase_extension(filename);
+#ifndef HALIDE_NO_PNG
+    if (ext == "png") {
+        std::unique_ptr<PngRowEncoder<check>> e(new PngRowEncoder<check>(filename));
+        return e->open(width, height, channels, bit_depth) ? std::move(e) : nullptr;
+    }
+#endif
+#ifndef HALIDE_NO_JPEG
+    if (ext == "jpg" || ext == "jpeg") {
+        std::unique_ptr<JpgRowEncoder<check>> e(new JpgRowEncoder<check>(filename));
+        return e->open(width, height, channels, bit_depth) ? std::move(e) : nullptr;
+    }
+#endif
+    if (ext == "pgm" || ext == "ppm") {
+        std::unique_ptr<PnmRowEncoder<check>> e(new PnmRowEncoder<check>(filename));
+        return e->open(width, height, channels, ext == "ppm" ? 3 : 1, bit_depth) ? std::move(e) : nullptr;
+    }
+    check(false, ("unsupported file extension \"" + ext + "\" for writing in strips").c_str());
+    return nullptr;
+}
+
+// Make an image covering all columns and channels, and rows [y, y + rows).
+template<typename ImageType>
+ImageType make_strip(const halide_type_t &type, int width, int channels, int y, int rows) {
+    std::vector<int> im_dimensions = { width, rows };
+    if (channels > 1) {
+        im_dimensions.push_back(channels);
+    }
+    ImageType im(type, im_dimensions);
+    im.translate(1, y);
+    return im;
+}
+
+// A fixed-capacity queue for handing strips between threads. close() is
+// called by the producer when it is done, or by the consumer to tell the
+// producer to stop: after it, push() fails and pop() fails once empty.
+template<typename T>
+class StripQueue {
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::deque<T> items;
+    const size_t capacity;
+    bool closed = false;
+
+public:
+    explicit StripQueue(size_t capacity) : capacity(capacity) {}
+
+    bool push(const T &item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [&]() { return closed || items.size() < capacity; });
+        if (closed) {
+            return false;
+        }
+        items.push_back(item);
+        cond.notify_all();
+        return true;
+    }
+
+    bool pop(T *item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [&]() { return closed || !items.empty(); });
+        if (items.empty()) {
+            return false;
+        }
+        *item = items.front();
+        items.pop_front();
+        cond.notify_all();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        cond.notify_all();
+    }
+};
+
+}  // namespace Internal
+
+// Reads an image a strip of rows at a time, top to bottom, so that images
+// too large to hold in memory can be processed piecewise. Supports png,
+// jpg, pgm and ppm files (png files must not be interlaced).
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+class StripReader {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    std::unique_ptr<Internal::RowDecoder> decoder;
+    std::vector<uint8_t> row;
+    int y = 0;
+
+public:
+    bool open(const std::string &filename) {
+        decoder = Internal::open_row_decoder<check>(filename);
+        if (!decoder) {
+            return false;
+        }
+        row.resize(decoder->width * decoder->channels * (decoder->bit_depth / 8));
+        y = 0;
+        return true;
+    }
+
+    int width() const { return decoder->width; }
+    int height() const { return decoder->height; }
+    int channels() const { return decoder->channels; }
+    halide_type_t type() const { return halide_type_t(halide_type_uint, decoder->bit_depth); }
+
+    // The first row that hasn't been read yet.
+    int next_row() const { return y; }
+
+    // Make an image of the right type and size for rows [y_min, y_min + rows).
+    ImageType make_strip(int y_min, int rows) const {
+        return Internal::make_strip<ImageType>(type(), width(), channels(), y_min, rows);
+    }
+
+    // Read rows from next_row() up to the last row of the given image into
+    // it. Earlier rows of the image are left alone, which allows callers to
+    // fill them from a previous strip to make overlapping strips.
+    bool read_rows(ImageType *strip) {
+        if (!check(strip->dim(1).min() <= y && strip->dim(1).max() < height(),
+                   "Strip must start at or before the next row, and end within the image")) {
+            return false;
+        }
+        auto copy_to_image = decoder->bit_depth == 8 ?
+            Internal::read_big_endian_row<uint8_t, ImageType> :
+            Internal::read_big_endian_row<uint16_t, ImageType>;
+        for (; y <= strip->dim(1).max(); y++) {
+            if (!decoder->read_row(row.data())) {
+                return false;
+            }
+            copy_to_image(row.data(), y, strip);
+        }
+        strip->set_host_dirty();
+        return true;
+    }
+
+    // Read the next (up to) 'rows' rows into a new image.
+    bool read(int rows, ImageType *strip) {
+        *strip = make_strip(y, std::min(rows, height() - y));
+        return read_rows(strip);
+    }
+};
+
+// Writes an image a strip of rows at a time, top to bottom. Supports the
+// same formats as StripReader.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+class StripWriter {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    std::unique_ptr<Internal::RowEncoder> encoder;
+    std::vector<uint8_t> row;
+    halide_type_t im_type;
+    int width = 0, height = 0, channels = 0, y = 0;
+
+public:
+    bool open(const std::string &filename, const halide_type_t &type, int width, int height, int channels) {
+        if (!check(type.code == halide_type_uint && (type.bits == 8 || type.bits == 16),
+                   "Only uint8 and uint16 images can be written in strips")) {
+            return false;
+        }
+        encoder = Internal::open_row_encoder<check>(filename, width, height, channels, type.bits);
+        if (!encoder) {
+            return false;
+        }
+        this->im_type = type;
+        this->width = width;
+        this->height = height;
+        this->channels = channels;
+        row.resize(width * channels * (type.bits / 8));
+        y = 0;
+        return true;
+    }
+
+    // The first row that hasn't been written yet.
+    int next_row() const { return y; }
+
+    // Write the rows of the given image, which must start at next_row().
+    // "strip" is not const-ref because copy_to_host() is not const.
+    bool write(ImageType &strip) {
+        if (!check(strip.type() == im_type && strip.width() == width && strip.channels() == channels,
+                   "Strip does not match the type and size of the image")) {
+            return false;
+        }
+        if (!check(strip.dim(1).min() == y && strip.dim(1).max() < height,
+                   "Strip must start at the next row, and end within the image")) {
+            return false;
+        }
+        strip.copy_to_host();
+        auto copy_from_image = im_type.bits == 8 ?
+            Internal::write_big_endian_row<uint8_t, ImageType> :
+            Internal::write_big_endian_row<uint16_t, ImageType>;
+        for (; y <= strip.dim(1).max(); y++) {
+            copy_from_image(strip, y, row.data());
+            if (!encoder->write_row(row.data())) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Finish the file. Fails if not all rows have been written.
+    bool close() {
+        if (!check(y == height, "Not all rows of the image were written")) {
+            return false;
+        }
+        bool result = encoder->finish();
+        encoder.reset();
+        return result;
+    }
+};
+
+// Process an image too large to hold in memory in strips of 'strip_rows'
+// rows, writing the result to another file as it goes. For each strip,
+// 'process' is called with the input rows of the strip plus 'halo' rows
+// above and below (clamped to the image), and an output image covering
+// just the strip's rows to fill in. Decoding, processing and encoding run
+// on separate threads, so they overlap; 'process' is always called on the
+// calling thread. The output has the same width and height as the input,
+// and by default the same type and number of channels.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool process_image_in_strips(const std::string &input_filename,
+                             const std::string &output_filename,
+                             int strip_rows, int halo,
+                             const std::function<void(ImageType &input, ImageType &output)> &process,
+                             halide_type_t output_type = halide_type_t(),
+                             int output_channels = 0) {
+    if (!check(strip_rows > 0 && halo >= 0, "strip_rows must be positive and halo non-negative")) {
+        return false;
+    }
+
+    StripReader<ImageType, check> reader;
+    if (!reader.open(input_filename)) {
+        return false;
+    }
+    const int width = reader.width();
+    const int height = reader.height();
+    if (output_type.bits == 0) {
+        output_type = reader.type();
+    }
+    if (output_channels == 0) {
+        output_channels = reader.channels();
+    }
+
+    StripWriter<ImageType, check> writer;
+    if (!writer.open(output_filename, output_type, width, height, output_channels)) {
+        return false;
+    }
+
+    // Allow one strip to be in flight in each queue, in addition to the
+    // one being worked on at each stage.
+    Internal::StripQueue<ImageType> decoded(1), processed(1);
+    bool decode_ok = true, encode_ok = true;
+
+    std::thread decode_thread([&]() {
+        ImageType prev;
+        bool have_prev = false;
+        for (int y = 0; y < height; y += strip_rows) {
+            const int y_min = std::max(0, y - halo);
+            const int y_end = std::min(height, y + strip_rows + halo);
+            ImageType strip = reader.make_strip(y_min, y_end - y_min);
+            if (have_prev) {
+                // Rows in the halo shared with the previous strip have
+                // already been read.
+                strip.copy_from(prev);
+            }
+            if (!reader.read_rows(&strip)) {
+                decode_ok = false;
+                break;
+            }
+            if (!decoded.push(strip)) {
+                break;
+            }
+            prev = strip;
+            have_prev = true;
+        }
+        decoded.close();
+    });
+
+    std::thread encode_thread([&]() {
+        ImageType strip;
+        while (processed.pop(&strip)) {
+            if (!writer.write(strip)) {
+                encode_ok = false;
+                processed.close();
+                break;
+            }
+        }
+    });
+
+    ImageType input;
+    for (int y = 0; decoded.pop(&input); y += strip_rows) {
+        ImageType output = Internal::make_strip<ImageType>(output_type, width, output_channels,
+                                                           y, std::min(strip_rows, height - y));
+        process(input, output);
+        if (!processed.push(output)) {
+            decoded.close();
+            break;
+        }
+    }
+    processed.close();
+
+    decode_thread.join();
+    encode_thread.join();
+
+    return decode_ok && encode_ok && writer.close();
+}
+
 }  // namespace Tools
 }  // namespace Halide
 
@@ -0,0 +1,72 @@
+#ifndef HALIDE_MPI_TRANSPORT_H
+#define HALIDE_MPI_TRANSPORT_H
+
+/** \file
+ *
+ * A DistributedTransport over MPI, for Pipeline::realize_distributed.
+ * Run one process per rank under mpirun, with MPI initialized:
+ *
+ *     MPI_Init(&argc, &argv);
+ *     Halide::Tools::MPITransport transport;
+ *     Halide::Realization slice = pipeline.realize_distributed(sizes, local_inputs, transport);
+ *     MPI_Finalize();
+ */
+
+#include <algorithm>
+#include <climits>
+
+#include <mpi.h>
+
+#include "Halide.h"
+
+namespace Halide {
+namespace Tools {
+
+class MPITransport : public DistributedTransport {
+    MPI_Comm comm;
+
+    // MPI counts are ints, so large messages go in pieces.
+    static size_t max_piece() {
+        return INT_MAX;
+    }
+
+public:
+    MPITransport(MPI_Comm comm = MPI_COMM_WORLD) : comm(comm) {}
+
+    int rank() override {
+        int r = 0;
+        MPI_Comm_rank(comm, &r);
+        return r;
+    }
+
+    int size() override {
+        int s = 1;
+        MPI_Comm_size(comm, &s);
+        return s;
+    }
+
+    void send(int to, const void *data, size_t size) override {
+        const char *p = (const char *)data;
+        do {
+            size_t piece = std::min(size, max_piece());
+            MPI_Send(const_cast<char *>(p), (int)piece, MPI_BYTE, to, 0, comm);
+            p += piece;
+            size -= piece;
+        } while (size > 0);
+    }
+
+    void recv(int from, void *data, size_t size) override {
+        char *p = (char *)data;
+        do {
+            size_t piece = std::min(size, max_piece());
+            MPI_Recv(p, (int)piece, MPI_BYTE, from, 0, comm, MPI_STATUS_IGNORE);
+            p += piece;
+            size -= piece;
+        } while (size > 0);
+    }
+};
+
+}  // namespace Tools
+}  // namespace Halide
+
+#endif  // HALIDE_MPI_TRANSPORT_H
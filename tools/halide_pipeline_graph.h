@@ -0,0 +1,288 @@
+#ifndef HALIDE_PIPELINE_GRAPH_H
+#define HALIDE_PIPELINE_GRAPH_H
+
+/** \file
+ *
+ * An executor for a graph of ahead-of-time compiled pipelines, some of
+ * which consume the outputs of others. Independent pipelines, and the
+ * pipelines of successive frames, run concurrently on the Halide
+ * runtime's thread pool.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+
+namespace Halide {
+namespace Tools {
+
+// A graph of calls to AOT pipelines. Each pipeline is added by its
+// argv-style entry point and its metadata, which the generated code
+// provides as <name>_argv and <name>_metadata:
+//
+//     PipelineGraph graph;
+//     int a = graph.add(denoise_argv, denoise_metadata);
+//     int b = graph.add(sharpen_argv, sharpen_metadata);
+//     graph.connect(a, "output", b, "input");
+//     graph.run(num_frames, bind);
+//
+// Buffers passed from one pipeline to another are allocated by the
+// graph, sized by bounds queries of their consumers. Every other
+// argument is supplied by 'bind' (see run()).
+class PipelineGraph {
+public:
+    typedef int (*ArgvFn)(void **);
+    typedef const halide_filter_metadata_t *(*MetadataFn)();
+
+    // Add a pipeline to the graph, and return its index.
+    int add(ArgvFn argv, MetadataFn metadata) {
+        Node n;
+        n.argv = argv;
+        n.metadata = metadata();
+        n.connections.resize(n.metadata->num_arguments, -1);
+        nodes.push_back(n);
+        return (int)nodes.size() - 1;
+    }
+
+    // Pass the output buffer 'output' of pipeline 'from' to the input
+    // 'input' of pipeline 'to'. An output may feed several inputs.
+    void connect(int from, const std::string &output, int to, const std::string &input) {
+        assert(from != to);
+        int out_arg = find_argument(from, output, halide_argument_kind_output_buffer);
+        int in_arg = find_argument(to, input, halide_argument_kind_input_buffer);
+        assert(nodes[to].connections[in_arg] < 0 && "Input is already connected");
+        int e = nodes[from].connections[out_arg];
+        if (e < 0) {
+            Edge edge;
+            edge.from = from;
+            edge.from_arg = out_arg;
+            edges.push_back(edge);
+            e = (int)edges.size() - 1;
+            nodes[from].connections[out_arg] = e;
+        }
+        edges[e].to.push_back({to, in_arg});
+        nodes[to].connections[in_arg] = e;
+    }
+
+    // Run the graph for num_frames frames, and return the first
+    // non-zero error code of a pipeline, or zero.
+    //
+    // Arguments that aren't connected to another pipeline are given
+    // by bind(frame, node, arg), which returns the value to pass for
+    // argument 'arg' (a halide_filter_argument_t) of pipeline 'node'
+    // in frame 'frame', in the form the argv entry point takes: a
+    // halide_buffer_t * for buffers, and a pointer to the value for
+    // scalars. It is called from the thread pool, and the values it
+    // returns must stay valid until the frame is done. The shapes of
+    // the buffers must be the same in every frame.
+    //
+    // The pipelines are run in waves. A pipeline runs in the wave
+    // after the last of the pipelines it depends on, and each frame
+    // starts one wave after the previous one, so a wave holds
+    // independent pipelines of up to as many frames as the graph is
+    // deep. Each buffer passed between pipelines is allocated once per
+    // frame that may be in flight.
+    template<typename BindFn>
+    int run(int num_frames, BindFn bind, void *user_context = nullptr) {
+        if (nodes.empty() || num_frames <= 0) {
+            return 0;
+        }
+        compute_levels();
+        int error = size_edges(bind);
+        if (error) {
+            return error;
+        }
+
+        struct Task {
+            int frame, node;
+        };
+        struct Wave {
+            PipelineGraph *graph;
+            BindFn *bind;
+            std::vector<Task> tasks;
+            std::vector<int> errors;
+        } wave;
+        wave.graph = this;
+        wave.bind = &bind;
+
+        auto run_task = [](void *user_context, int i, uint8_t *closure) -> int {
+            Wave *w = (Wave *)closure;
+            const Task &t = w->tasks[i];
+            std::vector<void *> args = w->graph->node_args(t.frame, t.node, *w->bind);
+            w->errors[i] = w->graph->nodes[t.node].argv(args.data());
+            return 0;
+        };
+
+        for (int w = 0; w < num_frames + depth - 1; w++) {
+            wave.tasks.clear();
+            for (int frame = std::max(0, w - depth + 1); frame <= std::min(w, num_frames - 1); frame++) {
+                for (size_t n = 0; n < nodes.size(); n++) {
+                    if (nodes[n].level == w - frame) {
+                        wave.tasks.push_back({frame, (int)n});
+                    }
+                }
+            }
+            wave.errors.assign(wave.tasks.size(), 0);
+            int result = halide_do_par_for(user_context, run_task, 0, (int)wave.tasks.size(), (uint8_t *)&wave);
+            if (result) {
+                return result;
+            }
+            for (int e : wave.errors) {
+                if (e) {
+                    return e;
+                }
+            }
+        }
+        return 0;
+    }
+
+private:
+    struct Node {
+        ArgvFn argv;
+        const halide_filter_metadata_t *metadata;
+        // For each argument, the connecting edge, or -1.
+        std::vector<int> connections;
+        // The length of the longest chain of pipelines this one
+        // depends on.
+        int level = 0;
+    };
+
+    struct Edge {
+        int from, from_arg;
+        std::vector<std::pair<int, int>> to;
+        // One buffer per frame in flight.
+        std::vector<Runtime::Buffer<>> buffers;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<Edge> edges;
+    int depth = 0;
+
+    int find_argument(int node, const std::string &name, int kind) {
+        const halide_filter_metadata_t *md = nodes[node].metadata;
+        for (int i = 0; i < md->num_arguments; i++) {
+            if (md->arguments[i].name == name) {
+                assert(md->arguments[i].kind == kind && "Argument is not the right kind of buffer");
+                return i;
+            }
+        }
+        assert(false && "No such argument");
+        return -1;
+    }
+
+    void compute_levels() {
+        // Relax the levels once per node; the graph must be acyclic.
+        for (Node &n : nodes) {
+            n.level = 0;
+        }
+        for (size_t iter = 0; iter < nodes.size(); iter++) {
+            for (const Edge &e : edges) {
+                for (const auto &to : e.to) {
+                    nodes[to.first].level = std::max(nodes[to.first].level, nodes[e.from].level + 1);
+                }
+            }
+        }
+        depth = 0;
+        for (Node &n : nodes) {
+            assert(n.level < (int)nodes.size() && "The pipeline graph has a cycle");
+            depth = std::max(depth, n.level + 1);
+        }
+    }
+
+    // The argv of a pipeline for a frame.
+    template<typename BindFn>
+    std::vector<void *> node_args(int frame, int node, BindFn &bind) {
+        const Node &n = nodes[node];
+        std::vector<void *> args(n.metadata->num_arguments);
+        for (int i = 0; i < n.metadata->num_arguments; i++) {
+            int e = n.connections[i];
+            if (e >= 0) {
+                args[i] = edges[e].buffers[frame % depth].raw_buffer();
+            } else {
+                args[i] = bind(frame, node, n.metadata->arguments[i]);
+            }
+        }
+        return args;
+    }
+
+    // Size the buffers between pipelines to cover what all of their
+    // consumers read, by bounds queries of the consumers of each
+    // buffer before its producer.
+    template<typename BindFn>
+    int size_edges(BindFn &bind) {
+        std::vector<std::vector<int>> mins(edges.size()), maxes(edges.size());
+        std::vector<int> order(nodes.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            order[i] = (int)i;
+        }
+        std::sort(order.begin(), order.end(), [&](int a, int b) { return nodes[a].level > nodes[b].level; });
+
+        for (int node : order) {
+            const Node &n = nodes[node];
+            const halide_filter_metadata_t *md = n.metadata;
+            std::vector<Runtime::Buffer<>> queries(md->num_arguments);
+            std::vector<void *> args(md->num_arguments);
+            for (int i = 0; i < md->num_arguments; i++) {
+                const halide_filter_argument_t &arg = md->arguments[i];
+                int e = n.connections[i];
+                if (e < 0) {
+                    args[i] = bind(0, node, arg);
+                    continue;
+                }
+                queries[i] = Runtime::Buffer<>(arg.type, nullptr, std::vector<int>(arg.dimensions, 0));
+                if (arg.kind == halide_argument_kind_output_buffer) {
+                    // All the consumers of this output have been queried.
+                    for (int d = 0; d < arg.dimensions; d++) {
+                        queries[i].raw_buffer()->dim[d].min = mins[e][d];
+                        queries[i].raw_buffer()->dim[d].extent = maxes[e][d] - mins[e][d] + 1;
+                    }
+                }
+                args[i] = queries[i].raw_buffer();
+            }
+            int error = n.argv(args.data());
+            if (error) {
+                return error;
+            }
+            for (int i = 0; i < md->num_arguments; i++) {
+                int e = n.connections[i];
+                if (e < 0 || md->arguments[i].kind != halide_argument_kind_input_buffer) {
+                    continue;
+                }
+                const halide_buffer_t *q = queries[i].raw_buffer();
+                if (mins[e].empty()) {
+                    mins[e].assign(q->dimensions, INT_MAX);
+                    maxes[e].assign(q->dimensions, INT_MIN);
+                }
+                for (int d = 0; d < q->dimensions; d++) {
+                    mins[e][d] = std::min(mins[e][d], q->dim[d].min);
+                    maxes[e][d] = std::max(maxes[e][d], q->dim[d].min + q->dim[d].extent - 1);
+                }
+            }
+        }
+
+        for (size_t e = 0; e < edges.size(); e++) {
+            const halide_filter_argument_t &arg = nodes[edges[e].from].metadata->arguments[edges[e].from_arg];
+            std::vector<int> extents;
+            for (int d = 0; d < arg.dimensions; d++) {
+                extents.push_back(maxes[e][d] - mins[e][d] + 1);
+            }
+            edges[e].buffers.clear();
+            for (int f = 0; f < depth; f++) {
+                edges[e].buffers.emplace_back(arg.type, extents);
+                edges[e].buffers.back().set_min(mins[e]);
+            }
+        }
+        return 0;
+    }
+};
+
+}  // namespace Tools
+}  // namespace Halide
+
+#endif  // HALIDE_PIPELINE_GRAPH_H
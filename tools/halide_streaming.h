@@ -0,0 +1,171 @@
+#ifndef HALIDE_STREAMING_H
+#define HALIDE_STREAMING_H
+
+/** \file
+ *
+ * A driver that runs an ahead-of-time compiled pipeline one tile of
+ * its output at a time, for inputs and outputs too large to hold in
+ * memory. This is the AOT counterpart of Pipeline::realize_streaming.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <exception>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include "HalideBuffer.h"
+
+namespace Halide {
+namespace Tools {
+
+// The type and dimensionality of an input that realize_streaming
+// streams.
+struct StreamedInput {
+    halide_type_t type;
+    int dimensions;
+};
+
+// Run a pipeline over an output of the given sizes, split into tiles of
+// tile_sizes (smaller at the far edges), and return the first non-zero
+// error code of the pipeline, or zero.
+//
+// 'run' calls the pipeline, as run(inputs, output), where 'inputs' is a
+// halide_buffer_t ** with one entry per element of 'streamed_inputs',
+// and 'output' is a Runtime::Buffer<T> &. It is usually a lambda that
+// forwards to the AOT entry point with any other arguments bound:
+//
+//     auto run = [&](halide_buffer_t **in, Runtime::Buffer<uint8_t> &out) {
+//         return my_pipeline(in[0], gain, out);
+//     };
+//
+// For each tile, 'run' is first called with bounds query buffers to find
+// the region of each input the tile needs. A buffer of just that region
+// is allocated, and 'fetch' is called as fetch(i, region) to fill in
+// the region of the i'th input. The inputs of the next tile are fetched
+// on another thread while the current tile runs. 'sink' is then called
+// as sink(tile) with each finished tile of the output, whose mins are
+// its position in the whole output.
+template<typename T, typename RunFn, typename FetchFn, typename SinkFn>
+int realize_streaming(const std::vector<StreamedInput> &streamed_inputs,
+                      const std::vector<int> &sizes,
+                      const std::vector<int> &tile_sizes,
+                      RunFn run, FetchFn fetch, SinkFn sink) {
+    assert(sizes.size() == tile_sizes.size());
+
+    std::vector<int> tile_counts;
+    int num_tiles = 1;
+    for (size_t d = 0; d < sizes.size(); d++) {
+        assert(sizes[d] > 0 && tile_sizes[d] > 0);
+        tile_counts.push_back((sizes[d] + tile_sizes[d] - 1) / tile_sizes[d]);
+        num_tiles *= tile_counts.back();
+    }
+
+    struct Tile {
+        Runtime::Buffer<T> output;
+        std::vector<Runtime::Buffer<>> inputs;
+        std::vector<halide_buffer_t *> input_ptrs;
+        std::future<void> fetched;
+        std::exception_ptr fetch_error;
+        int error = 0;
+
+        ~Tile() {
+            if (fetched.valid()) {
+                fetched.wait();
+            }
+        }
+    };
+
+    // Make the buffers of a tile, and start fetching its inputs.
+    auto start_tile = [&](int index) {
+        std::unique_ptr<Tile> tile(new Tile);
+        std::vector<int> mins, extents;
+        for (size_t d = 0; d < sizes.size(); d++) {
+            mins.push_back((index % tile_counts[d]) * tile_sizes[d]);
+            extents.push_back(std::min(tile_sizes[d], sizes[d] - mins.back()));
+            index /= tile_counts[d];
+        }
+        tile->output = Runtime::Buffer<T>(extents);
+        tile->output.set_min(mins);
+
+        for (const StreamedInput &in : streamed_inputs) {
+            tile->inputs.emplace_back(in.type, nullptr, std::vector<int>(in.dimensions, 0));
+        }
+        for (Runtime::Buffer<> &in : tile->inputs) {
+            tile->input_ptrs.push_back(in.raw_buffer());
+        }
+        if (tile->inputs.empty()) {
+            return tile;
+        }
+
+        // Query the bounds until they stop changing.
+        const int max_iters = 16;
+        for (int iter = 0; iter < max_iters; iter++) {
+            std::vector<Runtime::Buffer<>> orig(tile->inputs);
+            tile->error = run(tile->input_ptrs.data(), tile->output);
+            if (tile->error) {
+                return tile;
+            }
+            bool changed = false;
+            for (size_t i = 0; i < tile->inputs.size(); i++) {
+                for (int d = 0; d < tile->inputs[i].dimensions(); d++) {
+                    changed |= (tile->inputs[i].dim(d).min() != orig[i].dim(d).min() ||
+                                tile->inputs[i].dim(d).extent() != orig[i].dim(d).extent() ||
+                                tile->inputs[i].dim(d).stride() != orig[i].dim(d).stride());
+                }
+            }
+            if (!changed) {
+                break;
+            }
+        }
+
+        for (Runtime::Buffer<> &in : tile->inputs) {
+            in.allocate();
+        }
+
+        Tile *tile_ptr = tile.get();
+        tile->fetched = std::async(std::launch::async, [tile_ptr, &fetch]() {
+            try {
+                for (size_t i = 0; i < tile_ptr->inputs.size(); i++) {
+                    fetch((int)i, tile_ptr->inputs[i]);
+                    tile_ptr->inputs[i].set_host_dirty();
+                }
+            } catch (...) {
+                tile_ptr->fetch_error = std::current_exception();
+            }
+        });
+        return tile;
+    };
+
+    std::unique_ptr<Tile> next = start_tile(0);
+    for (int i = 0; i < num_tiles; i++) {
+        std::unique_ptr<Tile> tile = std::move(next);
+        if (tile->error) {
+            return tile->error;
+        }
+        if (i + 1 < num_tiles) {
+            next = start_tile(i + 1);
+        }
+
+        if (tile->fetched.valid()) {
+            tile->fetched.wait();
+        }
+        if (tile->fetch_error) {
+            std::rethrow_exception(tile->fetch_error);
+        }
+
+        int error = run(tile->input_ptrs.data(), tile->output);
+        if (error) {
+            return error;
+        }
+        tile->output.copy_to_host();
+        sink(tile->output);
+    }
+    return 0;
+}
+
+}  // namespace Tools
+}  // namespace Halide
+
+#endif  // HALIDE_STREAMING_H
@@ -0,0 +1,589 @@
+#include "HalideTraceUtils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/** \file
+ *
+ * A tool which reads a binary Halide trace and runs its loads and
+ * stores through a model of a multi-level cache hierarchy, reporting
+ * for each traced Func how often its accesses miss at each level and
+ * how many bytes it moves to and from memory. This lets schedules be
+ * compared for a cache hierarchy other than the one of the machine at
+ * hand.
+ *
+ * Traces carry the coordinates of each access rather than its address,
+ * so the tool lays the Funcs out in memory the way Halide does by
+ * default: each realization is a dense allocation over its bounds, with
+ * the innermost dimension first, and one allocation per Tuple element.
+ * Allocations are made from a stack, so a Func computed at an inner loop
+ * reuses the memory of its previous realization, as it usually does with
+ * a real allocator. Funcs whose realizations aren't traced, such as the
+ * inputs, are laid out once over all the coordinates the trace touches,
+ * which the tool finds in a first pass over the trace.
+ */
+
+using namespace Halide;
+using namespace Internal;
+
+using std::map;
+using std::string;
+using std::unordered_map;
+using std::vector;
+
+namespace {
+
+struct CacheConfig {
+    string name;
+    uint64_t size;
+    int ways;
+};
+
+// One set-associative, write-back, write-allocate cache with LRU
+// replacement.
+class Cache {
+    struct Line {
+        uint64_t line = 0;
+        bool valid = false, dirty = false;
+        // The Func that last stored to the line, which is charged for
+        // writing it back.
+        int owner = -1;
+    };
+
+    // Each set is ways lines, most recently used first.
+    vector<Line> lines;
+    uint64_t num_sets;
+    int ways;
+
+public:
+    CacheConfig config;
+
+    Cache(const CacheConfig &config, int line_size) : config(config) {
+        ways = config.ways;
+        num_sets = std::max<uint64_t>(1, config.size / ((uint64_t)ways * line_size));
+        lines.resize(num_sets * ways);
+    }
+
+    // Access a line, making it the most recently used in its set, and
+    // return whether it was present. A line that isn't is filled, and
+    // if that evicts a dirty line, the evicted line is returned in
+    // *evicted.
+    bool access(uint64_t line, bool write, int func, Line *evicted) {
+        Line *set = &lines[(line % num_sets) * ways];
+        int i = 0;
+        while (i < ways && !(set[i].valid && set[i].line == line)) {
+            i++;
+        }
+        bool hit = i < ways;
+        Line l;
+        if (hit) {
+            l = set[i];
+        } else {
+            i = ways - 1;
+            if (set[i].valid && set[i].dirty) {
+                *evicted = set[i];
+            }
+            l.line = line;
+            l.valid = true;
+        }
+        if (write) {
+            l.dirty = true;
+            l.owner = func;
+        }
+        std::copy_backward(set, set + i, set + i + 1);
+        set[0] = l;
+        return hit;
+    }
+
+    // Remove and return all the dirty lines.
+    vector<Line> flush() {
+        vector<Line> dirty;
+        for (Line &l : lines) {
+            if (l.valid && l.dirty) {
+                dirty.push_back(l);
+                l.dirty = false;
+            }
+        }
+        return dirty;
+    }
+
+    friend class Hierarchy;
+};
+
+struct FuncStats {
+    uint64_t loads = 0, stores = 0;
+    uint64_t bytes_loaded = 0, bytes_stored = 0;
+    // Line accesses and misses at each level.
+    vector<uint64_t> accesses, misses;
+    // Bytes read from and written back to memory.
+    uint64_t memory_read = 0, memory_written = 0;
+};
+
+class Hierarchy {
+    vector<Cache> levels;
+    int line_size;
+
+    // Write a dirty line evicted from the given level back to the next
+    // one, or to memory.
+    void write_back(size_t level, const Cache::Line &line, vector<FuncStats> &stats) {
+        if (level + 1 == levels.size()) {
+            if (line.owner >= 0) {
+                stats[line.owner].memory_written += line_size;
+            }
+            return;
+        }
+        Cache::Line evicted;
+        levels[level + 1].access(line.line, true, line.owner, &evicted);
+        if (evicted.valid) {
+            write_back(level + 1, evicted, stats);
+        }
+    }
+
+public:
+    Hierarchy(const vector<CacheConfig> &configs, int line_size) : line_size(line_size) {
+        for (const CacheConfig &c : configs) {
+            levels.emplace_back(c, line_size);
+        }
+    }
+
+    size_t size() const {
+        return levels.size();
+    }
+
+    const CacheConfig &config(size_t level) const {
+        return levels[level].config;
+    }
+
+    // A load or store by func of a line. The store only dirties the
+    // first level; lines are written to the next level when evicted.
+    void access(uint64_t line, bool write, int func, vector<FuncStats> &stats) {
+        FuncStats &s = stats[func];
+        for (size_t i = 0; i < levels.size(); i++) {
+            Cache::Line evicted;
+            s.accesses[i]++;
+            bool hit = levels[i].access(line, write && i == 0, func, &evicted);
+            if (evicted.valid) {
+                write_back(i, evicted, stats);
+            }
+            if (hit) {
+                return;
+            }
+            s.misses[i]++;
+        }
+        s.memory_read += line_size;
+    }
+
+    // Write all the dirty lines back, as would eventually happen.
+    void flush(vector<FuncStats> &stats) {
+        for (size_t i = 0; i < levels.size(); i++) {
+            for (const Cache::Line &l : levels[i].flush()) {
+                write_back(i, l, stats);
+            }
+        }
+    }
+};
+
+// Where the elements of one Tuple element of a Func live.
+struct Layout {
+    uint64_t base = 0;
+    uint32_t bytes = 0;
+    vector<int> mins, extents;
+    vector<int64_t> strides;
+
+    uint64_t size() const {
+        uint64_t elems = 1;
+        for (int e : extents) {
+            elems *= std::max(e, 0);
+        }
+        return elems * bytes;
+    }
+
+    void make_dense() {
+        strides.resize(mins.size());
+        int64_t stride = 1;
+        for (size_t i = 0; i < mins.size(); i++) {
+            strides[i] = stride;
+            stride *= std::max(extents[i], 1);
+        }
+    }
+
+    // The address of the given lane of the given vector of coordinates,
+    // or false if it's outside the layout.
+    bool address(const int *coords, int dims, int lanes, int lane, uint64_t *addr) const {
+        if (dims != (int)mins.size()) {
+            return false;
+        }
+        int64_t offset = 0;
+        for (int i = 0; i < dims; i++) {
+            int c = coords[i * lanes + lane] - mins[i];
+            if (c < 0 || c >= extents[i]) {
+                return false;
+            }
+            offset += c * strides[i];
+        }
+        *addr = base + offset * bytes;
+        return true;
+    }
+};
+
+// What the first pass finds out about each Func: the type of each Tuple
+// element, and the bounds of the coordinates accessed.
+struct FuncInfo {
+    vector<uint32_t> bytes;
+    vector<int> mins, maxs;
+
+    // The layout for accesses outside any traced realization.
+    vector<Layout> fallback;
+};
+
+// Allocates addresses from a stack, with allocations freed in any
+// order, and memory reclaimed once everything above it is freed.
+class Allocator {
+    struct Block {
+        uint64_t end;
+        bool freed;
+    };
+    map<uint64_t, Block> blocks;
+    uint64_t top;
+
+public:
+    Allocator(uint64_t base) : top(base) {}
+
+    uint64_t allocate(uint64_t size) {
+        uint64_t base = top;
+        // Like most allocators, align allocations to cache lines.
+        top = (top + size + 63) & ~(uint64_t)63;
+        blocks[base] = {top, false};
+        return base;
+    }
+
+    void free(uint64_t base) {
+        auto it = blocks.find(base);
+        if (it == blocks.end()) {
+            return;
+        }
+        it->second.freed = true;
+        while (!blocks.empty() && blocks.rbegin()->second.freed) {
+            top = blocks.rbegin()->first;
+            blocks.erase(std::prev(blocks.end()));
+        }
+    }
+};
+
+uint64_t parse_size(const string &s) {
+    char *end = nullptr;
+    uint64_t v = strtoull(s.c_str(), &end, 10);
+    if (*end == 'k' || *end == 'K') {
+        v <<= 10;
+    } else if (*end == 'm' || *end == 'M') {
+        v <<= 20;
+    } else if (*end == 'g' || *end == 'G') {
+        v <<= 30;
+    }
+    return v;
+}
+
+void report(const vector<string> &names, const vector<FuncStats> &stats, const Hierarchy &caches) {
+    FuncStats total;
+    total.accesses.resize(caches.size());
+    total.misses.resize(caches.size());
+    for (size_t f = 0; f < names.size(); f++) {
+        const FuncStats &s = stats[f];
+        if (!s.loads && !s.stores && !s.memory_written) {
+            continue;
+        }
+        printf("Func %s:\n", names[f].c_str());
+        printf("  loads: %llu (%llu bytes)\n", (unsigned long long)s.loads, (unsigned long long)s.bytes_loaded);
+        printf("  stores: %llu (%llu bytes)\n", (unsigned long long)s.stores, (unsigned long long)s.bytes_stored);
+        for (size_t i = 0; i < caches.size(); i++) {
+            if (s.accesses[i]) {
+                printf("  %s: %llu line accesses, %llu misses (%.2f%%)\n", caches.config(i).name.c_str(),
+                       (unsigned long long)s.accesses[i], (unsigned long long)s.misses[i],
+                       100.0 * s.misses[i] / s.accesses[i]);
+            }
+            total.accesses[i] += s.accesses[i];
+            total.misses[i] += s.misses[i];
+        }
+        printf("  memory: %llu bytes read, %llu bytes written",
+               (unsigned long long)s.memory_read, (unsigned long long)s.memory_written);
+        if (s.stores) {
+            printf(", %.2f bytes per element stored", (double)(s.memory_read + s.memory_written) / s.stores);
+        }
+        printf("\n");
+        total.memory_read += s.memory_read;
+        total.memory_written += s.memory_written;
+    }
+    printf("Total:\n");
+    for (size_t i = 0; i < caches.size(); i++) {
+        printf("  %s: %llu line accesses, %llu misses (%.2f%%)\n", caches.config(i).name.c_str(),
+               (unsigned long long)total.accesses[i], (unsigned long long)total.misses[i],
+               total.accesses[i] ? 100.0 * total.misses[i] / total.accesses[i] : 0.0);
+    }
+    printf("  memory: %llu bytes read, %llu bytes written\n",
+           (unsigned long long)total.memory_read, (unsigned long long)total.memory_written);
+}
+
+void usage(char *const *argv) {
+    const string usage =
+        "Usage: " + string(argv[0]) + " [-i trace_file] [-l line_size] [-c name:size:ways ...]\n"
+        "\n"
+        "This tool reads a binary trace produced by Halide (from stdin if no\n"
+        "file is given), simulates the loads and stores in it on a hierarchy\n"
+        "of caches, and reports for each Func:\n"
+        " - the number of loads and stores, and bytes loaded and stored\n"
+        " - the cache lines it accesses at each level, and how many miss\n"
+        " - the bytes it reads from memory, and the bytes written back to\n"
+        "   memory from lines it stored to\n"
+        "The caches are write-back and write-allocate with LRU replacement,\n"
+        "and each -c adds a level, from the one nearest the core outwards,\n"
+        "with its size in bytes (with an optional K, M or G suffix) and\n"
+        "associativity. The default is -c L1:32K:8 -c L2:256K:8 -c L3:8M:16,\n"
+        "with 64-byte lines.\n"
+        "To generate a suitable binary trace, use the target features\n"
+        "trace_loads, trace_stores and trace_realizations, and run with\n"
+        "HL_TRACE_FILE=<filename>.\n";
+    fprintf(stderr, "%s\n", usage.c_str());
+    exit(1);
+}
+
+}  // namespace
+
+int main(int argc, char *const *argv) {
+    FILE *file_desc = stdin;
+    int line_size = 64;
+    vector<CacheConfig> configs;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-i" && i + 1 < argc) {
+            i++;
+            file_desc = fopen(argv[i], "rb");
+            if (file_desc == nullptr) {
+                fprintf(stderr, "Error opening file: %s. Exiting.\n", argv[i]);
+                exit(1);
+            }
+        } else if (arg == "-l" && i + 1 < argc) {
+            line_size = atoi(argv[++i]);
+            if (line_size <= 0 || (line_size & (line_size - 1))) {
+                fprintf(stderr, "The line size must be a power of two\n");
+                exit(1);
+            }
+        } else if (arg == "-c" && i + 1 < argc) {
+            string spec = argv[++i];
+            size_t a = spec.find(':'), b = spec.rfind(':');
+            if (a == string::npos || a == b) {
+                usage(argv);
+            }
+            CacheConfig c{spec.substr(0, a), parse_size(spec.substr(a + 1, b - a - 1)),
+                          atoi(spec.substr(b + 1).c_str())};
+            if (c.size == 0 || c.ways <= 0) {
+                usage(argv);
+            }
+            configs.push_back(c);
+        } else {
+            usage(argv);
+        }
+    }
+    if (configs.empty()) {
+        configs = {{"L1", 32 << 10, 8}, {"L2", 256 << 10, 8}, {"L3", 8 << 20, 16}};
+    }
+
+    // The trace is read twice, so keep a copy of it if it's a stream.
+    FILE *copy = nullptr;
+    if (file_desc == stdin) {
+        copy = tmpfile();
+        if (copy == nullptr) {
+            fprintf(stderr, "Error making a temporary copy of the trace. Exiting.\n");
+            exit(1);
+        }
+    }
+
+    map<string, int> func_ids;
+    vector<string> names;
+    vector<FuncInfo> info;
+    auto func_id = [&](const char *name) {
+        auto it = func_ids.find(name);
+        if (it != func_ids.end()) {
+            return it->second;
+        }
+        int id = (int)names.size();
+        func_ids[name] = id;
+        names.push_back(name);
+        info.emplace_back();
+        return id;
+    };
+
+    // First pass: find the types and bounds of the accesses to each Func.
+    uint64_t packet_count = 0;
+    for (;;) {
+        Packet p;
+        if (!p.read_from_filedesc(file_desc)) {
+            break;
+        }
+        if (copy) {
+            fwrite(&p, 1, p.size, copy);
+        }
+        packet_count++;
+        if (p.event != halide_trace_load && p.event != halide_trace_store) {
+            continue;
+        }
+        FuncInfo &f = info[func_id(p.func())];
+        const int lanes = p.type.lanes;
+        const int dims = p.dimensions / lanes;
+        if (f.bytes.size() <= (size_t)p.value_index) {
+            f.bytes.resize(p.value_index + 1, 0);
+        }
+        f.bytes[p.value_index] = p.type.bytes();
+        if (f.mins.empty()) {
+            f.mins.resize(dims, INT32_MAX);
+            f.maxs.resize(dims, INT32_MIN);
+        }
+        for (int d = 0; d < std::min(dims, (int)f.mins.size()); d++) {
+            for (int lane = 0; lane < lanes; lane++) {
+                int c = p.coordinates()[d * lanes + lane];
+                f.mins[d] = std::min(f.mins[d], c);
+                f.maxs[d] = std::max(f.maxs[d], c);
+            }
+        }
+    }
+    if (copy) {
+        file_desc = copy;
+    }
+    fprintf(stderr, "[INFO] Read %llu packets. Simulating caches.\n", (unsigned long long)packet_count);
+
+    // The fallback layouts live far from the realizations.
+    Allocator fallback_allocator(1ULL << 44);
+    for (FuncInfo &f : info) {
+        for (uint32_t bytes : f.bytes) {
+            Layout l;
+            l.bytes = bytes;
+            l.mins = f.mins;
+            for (size_t d = 0; d < f.mins.size(); d++) {
+                l.extents.push_back(f.maxs[d] - f.mins[d] + 1);
+            }
+            l.make_dense();
+            l.base = fallback_allocator.allocate(bytes ? l.size() : 0);
+            f.fallback.push_back(l);
+        }
+    }
+
+    // Second pass: simulate the caches.
+    Hierarchy caches(configs, line_size);
+    vector<FuncStats> stats(names.size());
+    for (FuncStats &s : stats) {
+        s.accesses.resize(caches.size());
+        s.misses.resize(caches.size());
+    }
+    Allocator allocator(1ULL << 32);
+    // The layouts of each active realization, by the id of its begin
+    // event, and the realization each active produce and consume event
+    // is within. Loads and stores name the event they are within.
+    unordered_map<int, vector<Layout>> realizations;
+    unordered_map<int, int> realization_of;
+    vector<uint64_t> lines;
+
+    rewind(file_desc);
+    for (;;) {
+        Packet p;
+        if (!p.read_from_filedesc(file_desc)) {
+            break;
+        }
+        switch (p.event) {
+        case halide_trace_load:
+        case halide_trace_store: {
+            const int f = func_id(p.func());
+            FuncStats &s = stats[f];
+            const int lanes = p.type.lanes;
+            const int dims = p.dimensions / lanes;
+            const uint32_t bytes = p.type.bytes();
+            const bool is_store = p.event == halide_trace_store;
+            if (is_store) {
+                s.stores += lanes;
+                s.bytes_stored += lanes * bytes;
+            } else {
+                s.loads += lanes;
+                s.bytes_loaded += lanes * bytes;
+            }
+            const Layout *layout = &info[f].fallback[p.value_index];
+            auto r = realization_of.find(p.parent_id);
+            if (r != realization_of.end()) {
+                const vector<Layout> &layouts = realizations[r->second];
+                if ((size_t)p.value_index < layouts.size()) {
+                    layout = &layouts[p.value_index];
+                }
+            }
+            // Each line a vector touches is accessed once.
+            lines.clear();
+            for (int lane = 0; lane < lanes; lane++) {
+                uint64_t addr;
+                if (!layout->address(p.coordinates(), dims, lanes, lane, &addr) &&
+                    !info[f].fallback[p.value_index].address(p.coordinates(), dims, lanes, lane, &addr)) {
+                    continue;
+                }
+                for (uint64_t l = addr / line_size; l <= (addr + bytes - 1) / line_size; l++) {
+                    if (std::find(lines.begin(), lines.end(), l) == lines.end()) {
+                        lines.push_back(l);
+                    }
+                }
+            }
+            for (uint64_t l : lines) {
+                caches.access(l, is_store, f, stats);
+            }
+            break;
+        }
+        case halide_trace_begin_realization: {
+            const int f = func_id(p.func());
+            vector<Layout> &layouts = realizations[p.id];
+            for (uint32_t bytes : info[f].bytes) {
+                Layout l;
+                l.bytes = bytes;
+                for (int d = 0; d + 1 < p.dimensions; d += 2) {
+                    l.mins.push_back(p.coordinates()[d]);
+                    l.extents.push_back(p.coordinates()[d + 1]);
+                }
+                l.make_dense();
+                l.base = allocator.allocate(l.size());
+                layouts.push_back(l);
+            }
+            realization_of[p.id] = p.id;
+            break;
+        }
+        case halide_trace_end_realization: {
+            auto it = realizations.find(p.parent_id);
+            if (it != realizations.end()) {
+                for (const Layout &l : it->second) {
+                    allocator.free(l.base);
+                }
+                realizations.erase(it);
+            }
+            realization_of.erase(p.parent_id);
+            break;
+        }
+        case halide_trace_produce:
+        case halide_trace_consume: {
+            auto it = realization_of.find(p.parent_id);
+            if (it != realization_of.end()) {
+                realization_of[p.id] = it->second;
+            }
+            break;
+        }
+        case halide_trace_end_produce:
+        case halide_trace_end_consume:
+            realization_of.erase(p.parent_id);
+            break;
+        default:
+            break;
+        }
+    }
+    fclose(file_desc);
+
+    caches.flush(stats);
+    report(names, stats, caches);
+    return 0;
+}
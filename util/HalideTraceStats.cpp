@@ -0,0 +1,316 @@
+#include "HalideTraceUtils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/** \file
+ *
+ * A tool which reads a binary Halide trace and reports, for each traced
+ * Func, how much data it loads and stores, how far apart reuses of the
+ * same values are, how much of it is recomputed, and how large the
+ * working set of each of its productions is. Together these show
+ * whether a compute_at or store_at choice is cache-friendly.
+ */
+
+using namespace Halide;
+using namespace Internal;
+
+using std::map;
+using std::string;
+using std::unordered_map;
+using std::unordered_set;
+using std::vector;
+
+namespace {
+
+// The cache sizes, in bytes, at which reuse distances are reported.
+const uint64_t cache_sizes[] = {4 << 10, 32 << 10, 256 << 10, 2 << 20, 16 << 20};
+const int num_cache_sizes = sizeof(cache_sizes) / sizeof(cache_sizes[0]);
+
+struct FuncStats {
+    uint64_t loads = 0, stores = 0;
+    uint64_t bytes_loaded = 0, bytes_stored = 0;
+
+    // The distinct elements ever stored to, for the recompute ratio.
+    unordered_set<uint64_t> stored;
+
+    // Number of loads with a reuse distance below each of cache_sizes,
+    // and the number that touch an element for the first time.
+    uint64_t reuse_within[num_cache_sizes] = {0};
+    uint64_t cold_loads = 0;
+
+    uint64_t realizations = 0, productions = 0;
+    uint64_t working_set_total = 0, working_set_max = 0;
+};
+
+// Hash an element of a Func to 64 bits.
+uint64_t element_hash(int func_id, int value_index, const int *coords, int dims, int lanes, int lane) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    auto mix = [&](uint64_t v) {
+        h ^= v;
+        h *= 0x100000001b3ULL;
+        h ^= h >> 29;
+    };
+    mix(func_id);
+    mix(value_index);
+    for (int i = 0; i < dims; i++) {
+        mix((uint32_t)coords[i * lanes + lane]);
+    }
+    return h;
+}
+
+// Computes LRU stack distances in bytes: the total size of the distinct
+// elements touched since the last access to an element. A Fenwick tree
+// over access times holds the size of each element at the time of its
+// most recent access.
+class ReuseDistance {
+    unordered_map<uint64_t, std::pair<uint64_t, uint32_t>> last_access;
+    vector<uint64_t> tree;
+    uint64_t now = 0;
+
+    void add(uint64_t t, int64_t v) {
+        for (t++; t <= tree.size(); t += t & -t) {
+            tree[t - 1] += v;
+        }
+    }
+
+    uint64_t prefix_sum(uint64_t t) const {
+        uint64_t s = 0;
+        for (; t > 0; t -= t & -t) {
+            s += tree[t - 1];
+        }
+        return s;
+    }
+
+    // Renumber the live access times densely once we run out of room.
+    void compact() {
+        vector<std::pair<uint64_t, uint64_t>> live;
+        live.reserve(last_access.size());
+        for (const auto &it : last_access) {
+            live.emplace_back(it.second.first, it.first);
+        }
+        std::sort(live.begin(), live.end());
+        tree.assign(std::max((size_t)1 << 20, 2 * live.size()), 0);
+        now = 0;
+        for (const auto &l : live) {
+            auto &entry = last_access[l.second];
+            entry.first = now;
+            add(now, entry.second);
+            now++;
+        }
+    }
+
+public:
+    ReuseDistance() : tree((size_t)1 << 20, 0) {}
+
+    // Record an access, and return the reuse distance, or -1 if this
+    // is the first access to the element.
+    int64_t access(uint64_t element, uint32_t bytes) {
+        if (now == tree.size()) {
+            compact();
+        }
+        int64_t distance = -1;
+        auto it = last_access.find(element);
+        if (it != last_access.end()) {
+            uint64_t t = it->second.first;
+            distance = prefix_sum(now) - prefix_sum(t + 1);
+            add(t, -(int64_t)it->second.second);
+        }
+        last_access[element] = {now, bytes};
+        add(now, bytes);
+        now++;
+        return distance;
+    }
+};
+
+// A produce, consume, or realization event that hasn't ended yet.
+struct ActiveEvent {
+    int func_id;
+    int parent_id;
+    bool is_production;
+    unordered_set<uint64_t> touched;
+    uint64_t bytes_touched = 0;
+};
+
+void report(const vector<string> &names, const vector<FuncStats> &stats) {
+    for (size_t i = 0; i < names.size(); i++) {
+        const FuncStats &s = stats[i];
+        printf("Func %s:\n", names[i].c_str());
+        printf("  loads: %llu (%llu bytes)\n", (unsigned long long)s.loads, (unsigned long long)s.bytes_loaded);
+        printf("  stores: %llu (%llu bytes)\n", (unsigned long long)s.stores, (unsigned long long)s.bytes_stored);
+        if (!s.stored.empty()) {
+            printf("  distinct elements stored: %llu, recompute ratio: %.3f\n",
+                   (unsigned long long)s.stored.size(), (double)s.stores / s.stored.size());
+        }
+        printf("  realizations: %llu, productions: %llu\n",
+               (unsigned long long)s.realizations, (unsigned long long)s.productions);
+        if (s.productions) {
+            printf("  working set per production: mean %.0f bytes, max %llu bytes\n",
+                   (double)s.working_set_total / s.productions, (unsigned long long)s.working_set_max);
+        }
+        if (s.loads) {
+            printf("  loads reused within:");
+            for (int c = 0; c < num_cache_sizes; c++) {
+                printf(" %lluKB: %.1f%%", (unsigned long long)(cache_sizes[c] >> 10),
+                       100.0 * s.reuse_within[c] / s.loads);
+            }
+            printf(", first touch: %.1f%%\n", 100.0 * s.cold_loads / s.loads);
+        }
+    }
+}
+
+void usage(char *const *argv) {
+    const string usage =
+        "Usage: " + string(argv[0]) + " [-i trace_file]\n"
+        "\n"
+        "This tool reads a binary trace produced by Halide (from stdin if no\n"
+        "file is given), and reports for each Func:\n"
+        " - the number of loads and stores, and bytes loaded and stored\n"
+        " - the recompute ratio: stores per distinct element stored\n"
+        " - the mean and max working set of its productions: the bytes of\n"
+        "   distinct elements of any Func touched while it was being produced\n"
+        " - the fraction of its loads whose reuse distance (the bytes of\n"
+        "   distinct elements touched since the last access to the same\n"
+        "   element) fits in caches of various sizes\n"
+        "To generate a suitable binary trace, use the target features\n"
+        "trace_loads, trace_stores and trace_realizations, and run with\n"
+        "HL_TRACE_FILE=<filename>.\n";
+    fprintf(stderr, "%s\n", usage.c_str());
+    exit(1);
+}
+
+}  // namespace
+
+int main(int argc, char *const *argv) {
+    FILE *file_desc = stdin;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-i" && i + 1 < argc) {
+            i++;
+            file_desc = fopen(argv[i], "r");
+            if (file_desc == nullptr) {
+                fprintf(stderr, "Error opening file: %s. Exiting.\n", argv[i]);
+                exit(1);
+            }
+        } else {
+            usage(argv);
+        }
+    }
+
+    map<string, int> func_ids;
+    vector<string> names;
+    vector<FuncStats> stats;
+    auto func_id = [&](const char *name) {
+        auto it = func_ids.find(name);
+        if (it != func_ids.end()) {
+            return it->second;
+        }
+        int id = (int)names.size();
+        func_ids[name] = id;
+        names.push_back(name);
+        stats.emplace_back();
+        return id;
+    };
+
+    unordered_map<int, ActiveEvent> active;
+    ReuseDistance reuse;
+    uint64_t packet_count = 0;
+
+    for (;;) {
+        Packet p;
+        if (!p.read_from_filedesc(file_desc)) {
+            break;
+        }
+        packet_count++;
+        if ((packet_count % 10000000) == 0) {
+            fprintf(stderr, "[INFO] Read %llu packets so far.\n", (unsigned long long)packet_count);
+        }
+
+        switch (p.event) {
+        case halide_trace_load:
+        case halide_trace_store: {
+            const int f = func_id(p.func());
+            FuncStats &s = stats[f];
+            const int lanes = p.type.lanes;
+            const int dims = p.dimensions / lanes;
+            const uint32_t bytes = p.type.bytes();
+            const bool is_store = p.event == halide_trace_store;
+            if (is_store) {
+                s.stores += lanes;
+                s.bytes_stored += lanes * bytes;
+            } else {
+                s.loads += lanes;
+                s.bytes_loaded += lanes * bytes;
+            }
+            for (int lane = 0; lane < lanes; lane++) {
+                uint64_t e = element_hash(f, p.value_index, p.coordinates(), dims, lanes, lane);
+                int64_t distance = reuse.access(e, bytes);
+                if (is_store) {
+                    s.stored.insert(e);
+                } else if (distance < 0) {
+                    s.cold_loads++;
+                } else {
+                    for (int c = 0; c < num_cache_sizes; c++) {
+                        s.reuse_within[c] += (uint64_t)distance < cache_sizes[c];
+                    }
+                }
+                // Count the element in the working set of every
+                // enclosing production.
+                for (auto it = active.find(p.parent_id); it != active.end();
+                     it = active.find(it->second.parent_id)) {
+                    ActiveEvent &a = it->second;
+                    if (a.is_production && a.touched.insert(e).second) {
+                        a.bytes_touched += bytes;
+                    }
+                }
+            }
+            break;
+        }
+        case halide_trace_begin_realization:
+        case halide_trace_produce:
+        case halide_trace_consume: {
+            ActiveEvent &a = active[p.id];
+            a.func_id = func_id(p.func());
+            a.parent_id = p.parent_id;
+            a.is_production = p.event == halide_trace_produce;
+            if (p.event == halide_trace_begin_realization) {
+                stats[a.func_id].realizations++;
+            }
+            break;
+        }
+        case halide_trace_end_produce: {
+            auto it = active.find(p.parent_id);
+            if (it != active.end()) {
+                FuncStats &s = stats[it->second.func_id];
+                s.productions++;
+                s.working_set_total += it->second.bytes_touched;
+                s.working_set_max = std::max(s.working_set_max, it->second.bytes_touched);
+                active.erase(it);
+            }
+            break;
+        }
+        case halide_trace_end_consume:
+        case halide_trace_end_realization:
+            active.erase(p.parent_id);
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (file_desc != stdin) {
+        fclose(file_desc);
+    }
+
+    printf("Read %llu packets.\n", (unsigned long long)packet_count);
+    report(names, stats);
+    return 0;
+}
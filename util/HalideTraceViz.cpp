@@ -20,6 +20,7 @@ typedef int64_t ssize_t;
 #include <string>
 #include <list>
 #include <set>
+#include <thread>
 
 #include "inconsolata.h"
 #include "HalideRuntime.h"
@@ -125,19 +126,96 @@ struct FuncInfo {
     } stats;
 };
 
-// Composite a single pixel of b over a single pixel of a, writing the result into dst
-void composite(uint8_t *a, uint8_t *b, uint8_t *dst) {
-    uint8_t alpha = b[3];
-    // alpha is almost always 0 or 255.
-    if (alpha == 0) {
-        ((uint32_t *)dst)[0] = ((uint32_t *)a)[0];
-    } else if (alpha == 255) {
-        ((uint32_t *)dst)[0] = ((uint32_t *)b)[0];
-    } else {
-        dst[0] = (alpha * b[0] + (255 - alpha) * a[0]) / 255;
-        dst[1] = (alpha * b[1] + (255 - alpha) * a[1]) / 255;
-        dst[2] = (alpha * b[2] + (255 - alpha) * a[2]) / 255;
-        dst[3] = 255 - (((255 - a[3]) * (255 - alpha)) / 255);
+// Divide x in [0, 255 * 255] by 255, rounding down. Unlike an integer
+// division, this vectorizes.
+inline uint32_t div_255(uint32_t x) {
+    return (x + (x >> 8) + 1) >> 8;
+}
+
+// Composite a single pixel of b over a single pixel of a. Branch-free
+// so that compositing whole rows vectorizes; gives exactly the same
+// result as copying a or b when b's alpha is 0 or 255.
+inline uint32_t composite(uint32_t a, uint32_t b) {
+    uint32_t alpha = b >> 24;
+    uint32_t inv_alpha = 255 - alpha;
+    uint32_t result = (255 - div_255((255 - (a >> 24)) * inv_alpha)) << 24;
+    for (int c = 0; c < 24; c += 8) {
+        uint32_t bc = (b >> c) & 0xff, ac = (a >> c) & 0xff;
+        result |= div_255(alpha * bc + inv_alpha * ac) << c;
+    }
+    return result;
+}
+
+// Scale the alpha of a pixel by inv_decay / 2^24.
+inline uint32_t decay(uint32_t color, uint32_t inv_decay) {
+    uint32_t alpha = ((color >> 24) * inv_decay) & 0xff000000;
+    return alpha | (color & 0x00ffffff);
+}
+
+// There are three layers - image data, an animation on top of
+// it, and text labels. These layers get composited.
+struct Buffers {
+    std::vector<uint32_t> image, anim, anim_decay, text, blend;
+
+    void resize(const Point &frame_size) {
+        const int frame_elems = frame_size.x * frame_size.y;
+        image.resize(frame_elems, 0);
+        anim.resize(frame_elems, 0);
+        anim_decay.resize(frame_elems, 0);
+        text.resize(frame_elems, 0);
+        blend.resize(frame_elems, 0);
+    }
+};
+
+// The number of threads to composite frames with.
+int num_compositing_threads = std::max(1, (int)std::thread::hardware_concurrency());
+
+// Composite pixels [begin, end) of a frame into blend, then decay the
+// animation layers for the next frame in the same pass.
+void composite_pixels(Buffers &buffers, size_t begin, size_t end,
+                      uint32_t inv_decay_during_compute, uint32_t inv_decay_after_compute) {
+    uint32_t *anim = buffers.anim.data();
+    uint32_t *anim_decay = buffers.anim_decay.data();
+    const uint32_t *image = buffers.image.data();
+    const uint32_t *text = buffers.text.data();
+    uint32_t *blend = buffers.blend.data();
+    for (size_t i = begin; i < end; i++) {
+        // anim over anim_decay
+        uint32_t d = composite(anim_decay[i], anim[i]);
+        // anim_decay over image, then text over that
+        blend[i] = composite(composite(image[i], d), text[i]);
+        anim_decay[i] = decay(d, inv_decay_after_compute);
+        anim[i] = decay(anim[i], inv_decay_during_compute);
+    }
+}
+
+// Composite a whole frame, split across threads.
+void composite_frame(Buffers &buffers, int decay_factor_during_compute, int decay_factor_after_compute) {
+    // A factor of 1 means no decay, which (1 << 24) / 1 leaves
+    // the alpha unchanged.
+    const uint32_t inv_during = (1 << 24) / std::max(1, decay_factor_during_compute);
+    const uint32_t inv_after = (1 << 24) / std::max(1, decay_factor_after_compute);
+
+    const size_t size = buffers.image.size();
+    // Don't bother with threads for small frames.
+    const size_t min_pixels_per_thread = 1 << 16;
+    size_t threads = std::min((size_t)num_compositing_threads,
+                              std::max((size_t)1, size / min_pixels_per_thread));
+    if (threads <= 1) {
+        composite_pixels(buffers, 0, size, inv_during, inv_after);
+        return;
+    }
+
+    vector<std::thread> workers;
+    const size_t chunk = (size + threads - 1) / threads;
+    for (size_t t = 1; t < threads; t++) {
+        size_t begin = std::min(size, t * chunk);
+        size_t end = std::min(size, begin + chunk);
+        workers.emplace_back(composite_pixels, std::ref(buffers), begin, end, inv_during, inv_after);
+    }
+    composite_pixels(buffers, 0, std::min(size, chunk), inv_during, inv_after);
+    for (std::thread &w : workers) {
+        w.join();
     }
 }
 
@@ -216,6 +294,9 @@ parameters should be set zero or one times:
  --hold frames: How many frames to output after the end of the
     trace. Defaults to 250.
 
+ --threads n: How many threads to composite frames with. Defaults to
+    the number of cores.
+
 The following parameters can be set once per Func. With the exception
 of label, they continue to take effect for all subsequently defined
 Funcs.
@@ -364,20 +445,6 @@ double parse_double(const char *str) {
     return result;
 }
 
-void do_decay(int decay_factor, std::vector<uint32_t> &storage) {
-    if (decay_factor != 1) {
-        const uint32_t inv_d1 = (1 << 24) / std::max(1, decay_factor);
-        for (size_t i = 0; i < storage.size(); i++) {
-            uint32_t color = storage[i];
-            uint32_t rgb = color & 0x00ffffff;
-            uint32_t alpha = (color >> 24);
-            alpha *= inv_d1;
-            alpha &= 0xff000000;
-            storage[i] = alpha | rgb;
-        }
-    }
-}
-
 // Given a FuncConfig, check each field for "use some reasonable default"
 // value and fill in something reasonable.
 FuncConfig fix_func_config_defaults(const FuncConfig &cfg) {
@@ -524,6 +591,9 @@ void process_args(int argc, char **argv, GlobalConfig &global, map<string, FuncI
         } else if (next == "--hold") {
             expect(i + 1 < argc, i);
             global.hold_frames = parse_int(argv[++i]);
+        } else if (next == "--threads") {
+            expect(i + 1 < argc, i);
+            num_compositing_threads = std::max(1, parse_int(argv[++i]));
         } else if (next == "--uninit") {
             expect(i + 3 < argc, i);
             int r = parse_int(argv[++i]);
@@ -554,20 +624,7 @@ int run(int argc, char **argv) {
     bool all_args_final = false;
     bool seen_global_config_tag = false;
 
-    // There are three layers - image data, an animation on top of
-    // it, and text labels. These layers get composited.
-    struct Buffers {
-        std::vector<uint32_t> image, anim, anim_decay, text, blend;
-
-        void resize(const Point &frame_size) {
-            const int frame_elems = frame_size.x * frame_size.y;
-            image.resize(frame_elems, 0);
-            anim.resize(frame_elems, 0);
-            anim_decay.resize(frame_elems, 0);
-            text.resize(frame_elems, 0);
-            blend.resize(frame_elems, 0);
-        }
-    } buffers;
+    Buffers buffers;
 
     // Leave buffers unallocated for now;
     // we'll allocate once all tags and flags are processed
@@ -596,20 +653,10 @@ int run(int argc, char **argv) {
             const ssize_t frame_bytes = buffers.image.size() * sizeof(uint32_t);
 
             while (halide_clock > video_clock) {
-                // Composite text over anim over image
-                for (int i = 0; i < buffers.image.size(); i++) {
-                    uint8_t *anim_decay_px  = (uint8_t *)(buffers.anim_decay.data() + i);
-                    uint8_t *anim_px  = (uint8_t *)(buffers.anim.data() + i);
-                    uint8_t *image_px = (uint8_t *)(buffers.image.data() + i);
-                    uint8_t *text_px  = (uint8_t *)(buffers.text.data() + i);
-                    uint8_t *blend_px = (uint8_t *)(buffers.blend.data() + i);
-                    // anim over anim_decay
-                    composite(anim_decay_px, anim_px, anim_decay_px);
-                    // anim_decay over image
-                    composite(image_px, anim_decay_px, blend_px);
-                    // text over image
-                    composite(blend_px, text_px, blend_px);
-                }
+                // Composite text over anim over image, and decay the
+                // anim and anim_decay for the next frame
+                composite_frame(buffers, global.decay_factor_during_compute,
+                                global.decay_factor_after_compute);
 
                 // Dump the frame
                 ssize_t bytes_written = write(1, buffers.blend.data(), frame_bytes);
@@ -619,12 +666,6 @@ int run(int argc, char **argv) {
                 }
 
                 video_clock += global.timestep;
-
-                // Decay the anim_decay
-                do_decay(global.decay_factor_after_compute, buffers.anim_decay);
-
-                // Also decay the anim
-                do_decay(global.decay_factor_during_compute, buffers.anim);
             }
 
             // Blank anim